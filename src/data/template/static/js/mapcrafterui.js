@@ -5,27 +5,161 @@ var MCTileLayer = L.TileLayer.extend({
 	initialize: function(url, options) {
 		this._url = url;
 		this._imageFormat = options["imageFormat"];
+		this._tileStore = options["tileStore"];
+		// the indexes of the loaded bundles (or the callbacks waiting for them)
+		this._bundleIndexes = {};
 		
 		L.setOptions(this, options);
 	},
 	
-	getTileUrl: function(tile) {
+	/**
+	 * Returns the path of a tile in the quadtree (empty for the base tile), or null if
+	 * the tile is outside of the map.
+	 */
+	_getTilePath: function(tile) {
 		var zoom = this._map.getZoom();
+		if(tile.x < 0 || tile.x >= Math.pow(2, zoom) || tile.y < 0 || tile.y >= Math.pow(2, zoom))
+			return null;
+		var path = [];
+		for(var z = zoom - 1; z >= 0; --z) {
+			var x = Math.floor(tile.x / Math.pow(2, z)) % 2;
+			var y = Math.floor(tile.y / Math.pow(2, z)) % 2;
+			path.push(x + 2 * y + 1);
+		}
+		return path;
+	},
+	
+	getTileUrl: function(tile) {
+		var path = this._getTilePath(tile);
 		var url = this._url;
-		if(tile.x < 0 || tile.x >= Math.pow(2, zoom) || tile.y < 0 || tile.y >= Math.pow(2, zoom)) {
+		if(path == null) {
 			url += "/blank";
-		} else if(zoom == 0) {
+		} else if(path.length == 0) {
 			url += "/base";
 		} else {
-			for(var z = zoom - 1; z >= 0; --z) {
-				var x = Math.floor(tile.x / Math.pow(2, z)) % 2;
-				var y = Math.floor(tile.y / Math.pow(2, z)) % 2;
-				url += "/" + (x + 2 * y + 1);
-			}
+			url += "/" + path.join("/");
 		}
 		url = url + "." + this._imageFormat;
 		return url;
 	},
+	
+	/**
+	 * Loads the tiles from the bundles of the tile store "pack". A bundle has the tiles of
+	 * a zoom level below the same tile four zoom levels above, its index has the offset
+	 * and size of each tile in the bundle file. The index and the tiles are loaded with
+	 * HTTP range requests.
+	 */
+	_loadTile: function(tile, tilePoint) {
+		if(this._tileStore != "pack") {
+			L.TileLayer.prototype._loadTile.call(this, tile, tilePoint);
+			return;
+		}
+		
+		tile._layer = this;
+		tile.onload = this._tileOnLoad;
+		tile.onerror = this._tileOnError;
+		this._adjustTilePoint(tilePoint);
+		
+		var path = this._getTilePath(tilePoint);
+		if(path == null) {
+			tile.src = L.Util.emptyImageUrl;
+			return;
+		}
+		var levels = Math.min(path.length, 4);
+		var name = path.slice(0, path.length - levels).join("");
+		var x = 0, y = 0;
+		for(var i = path.length - levels; i < path.length; i++) {
+			x = x * 2 + (path[i] - 1) % 2;
+			y = y * 2 + Math.floor((path[i] - 1) / 2);
+		}
+		var slot = y * 16 + x;
+		var url = this._url + "/bundles/" + path.length + "/" + (name == "" ? "base" : name) + ".bundle";
+		this.fire("tileloadstart", {tile: tile, url: url});
+		
+		var layer = this;
+		var format = this._imageFormat == "jpg" ? "jpeg" : this._imageFormat;
+		this._getBundleIndex(url, function(index) {
+			if(index == null || index[slot].size == 0) {
+				tile.src = L.Util.emptyImageUrl;
+				return;
+			}
+			layer._requestRange(url, index[slot].offset, index[slot].size, function(data) {
+				if(data == null) {
+					tile.src = L.Util.emptyImageUrl;
+					return;
+				}
+				var objectUrl = URL.createObjectURL(new Blob([data], {type: "image/" + format}));
+				tile.onload = function(e) {
+					URL.revokeObjectURL(objectUrl);
+					layer._tileOnLoad.call(this, e);
+				};
+				tile.src = objectUrl;
+			});
+		});
+	},
+	
+	/**
+	 * Calls the callback with the index of a bundle, or null if the bundle does not exist.
+	 */
+	_getBundleIndex: function(url, callback) {
+		var cached = this._bundleIndexes[url];
+		if(cached !== undefined && cached.callbacks === undefined) {
+			callback(cached);
+			return;
+		}
+		if(cached !== undefined) {
+			cached.callbacks.push(callback);
+			return;
+		}
+		
+		var layer = this;
+		this._bundleIndexes[url] = {callbacks: [callback]};
+		this._requestRange(url, 0, 12 + 256 * 12, function(data) {
+			var index = null;
+			if(data != null && data.byteLength >= 12 + 256 * 12) {
+				var view = new DataView(data);
+				// "MCTB", version 1 and 256 slots, all little endian
+				if(view.getUint32(0, true) == 0x4d435442 && view.getUint32(4, true) == 1
+						&& view.getUint32(8, true) == 256) {
+					index = [];
+					for(var i = 0; i < 256; i++) {
+						index.push({
+							offset: view.getUint32(12 + i * 12, true),
+							size: view.getUint32(12 + i * 12 + 4, true),
+						});
+					}
+				}
+			}
+			var callbacks = layer._bundleIndexes[url].callbacks;
+			layer._bundleIndexes[url] = index;
+			for(var i = 0; i < callbacks.length; i++)
+				callbacks[i](index);
+		});
+	},
+	
+	/**
+	 * Requests a range of bytes of a file and calls the callback with them as ArrayBuffer,
+	 * or with null if the request failed.
+	 */
+	_requestRange: function(url, offset, size, callback) {
+		var request = new XMLHttpRequest();
+		request.open("GET", url, true);
+		request.responseType = "arraybuffer";
+		request.setRequestHeader("Range", "bytes=" + offset + "-" + (offset + size - 1));
+		request.onload = function() {
+			if(request.status == 206)
+				callback(request.response);
+			// the server might not support range requests and send the whole file
+			else if(request.status == 200)
+				callback(request.response.slice(offset, offset + size));
+			else
+				callback(null);
+		};
+		request.onerror = function() {
+			callback(null);
+		};
+		request.send();
+	},
 });
 
 /**
@@ -38,6 +172,7 @@ function createMCTileLayer(mapName, mapConfig, mapRotation) {
 		noWrap: true,
 		continuousWorld: true,
 		imageFormat: mapConfig.imageFormat,
+		tileStore: mapConfig.tileStore,
 	});
 };
 
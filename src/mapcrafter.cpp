@@ -19,10 +19,12 @@
 
 #include "mapcraftercore/config/loggingconfig.h"
 #include "mapcraftercore/renderer/manager.h"
+#include "mapcraftercore/renderer/renderservice.h"
 #include "mapcraftercore/util.h"
 #include "mapcraftercore/version.h"
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <cstring>
 #include <boost/program_options.hpp>
@@ -47,7 +49,7 @@ int main(int argc, char** argv) {
 	}
 
 	renderer::RenderOpts opts;
-	std::string arg_color, arg_config;
+	std::string arg_color, arg_config, arg_shard, arg_max_time;
 
 	po::options_description general("General options");
 	general.add_options()
@@ -61,7 +63,23 @@ int main(int argc, char** argv) {
 			"the path to the global logging configuration file to use (automatically determined if not specified)")
 		("color", po::value<std::string>(&arg_color)->default_value("auto"),
 			"whether terminal output is colored (true, false or auto)")
-		("batch,b", "deactivates the animated progress bar and enables the progress logger instead");
+		("batch,b", "deactivates the animated progress bar and enables the progress logger instead")
+		("cache-stats", po::value<fs::path>(&opts.cache_stats),
+			"writes the region/chunk cache statistics of the rendered maps to the specified JSON file")
+		("profile", po::value<fs::path>(&opts.profile),
+			"measures the time spent in the stages of the rendering and writes it to the specified JSON file")
+		("block-profile", po::value<fs::path>(&opts.block_profile),
+			"samples the render time and blits of the block types and writes them as sorted report to the specified file")
+		("block-profile-sampling", po::value<int>(&opts.block_profile_sampling)->default_value(16),
+			"measures one in the specified count of blocks for the --block-profile")
+		("trace", po::value<fs::path>(&opts.trace),
+			"writes a timeline of the rendering threads to the specified JSON file (for chrome://tracing or Perfetto)")
+		("metrics-file", po::value<fs::path>(&opts.metrics_file),
+			"rewrites the specified file with the progress and metrics of the rendering (in the Prometheus text format) periodically")
+		("metrics-interval", po::value<int>(&opts.metrics_interval)->default_value(10),
+			"the seconds between the updates of the metrics file")
+		("slow-tiles", po::value<double>(&opts.slow_tiles)->default_value(0),
+			"logs the render tiles which take longer than the specified seconds to render, and the slowest ones at the end (0 to disable)");
 
 	po::options_description renderer("Renderer options");
 	renderer.add_options()
@@ -77,7 +95,43 @@ int main(int argc, char** argv) {
 			"renders the specified map(s) completely")
 		("render-force-all,F", "force renders all maps")
 		("jobs,j", po::value<int>(&opts.jobs)->default_value(1),
-			"the count of jobs to use when rendering the map");
+			"the count of jobs to use when rendering the map")
+		("concurrent-renders", po::value<int>(&opts.concurrent_renders)->default_value(1),
+			"the count of maps/rotations to render at the same time, they share the jobs")
+		("single-pass", "renders the maps with the same world and render view in one pass")
+		("memory-limit", po::value<int>(&opts.memory_limit)->default_value(0),
+			"the memory in MiB the caches may use, they are made smaller to fit (0 for no limit)")
+		("pin-threads", "pins the render threads to the CPUs and keeps their caches on their NUMA nodes")
+		("huge-pages", "allocates the chunk caches, block images and tile images from huge pages")
+		("max-time", po::value<std::string>(&arg_max_time),
+			"stops rendering new tiles after the specified time (for example 20m, 2h, 90s),"
+			" the next run renders the remaining tiles")
+		("shard", po::value<std::string>(&arg_shard),
+			"renders only the specified shard of the maps (<i>/<n>, for example 1/4)")
+		("merge-shards", "renders the top levels of the maps after all shards were rendered")
+		("changed-chunks", po::value<fs::path>(&opts.changed_chunks),
+			"renders only the tiles of the chunks in the specified file (lines of world, chunk x"
+			" and chunk z) instead of scanning which tiles changed")
+		("watch", po::value<int>(&opts.watch),
+			"keeps running and renders the maps again whenever the worlds were modified,"
+			" checks the worlds every specified seconds")
+		("service", po::value<fs::path>(&opts.service),
+			"renders the configuration files listed in the specified file (lines of configuration"
+			" file, jobs and memory limit in MiB) with shared threads and caches, instead of --config")
+		("service-slice", po::value<int>(&opts.service_slice)->default_value(300),
+			"the seconds a configuration of --service renders before the other ones get their turn")
+		("plan", "only shows the required tiles of the maps and estimates how long rendering them takes,"
+			" measured by rendering a few tiles of every map")
+		("tune", "only renders a sample of every map with different tile widths and chunk cache sizes"
+			" and recommends the fastest ones")
+		("optimize-tiles", "only recompresses the PNG tiles of the rendered maps which were not rendered"
+			" again for a while with the best compression, with the lowest priority")
+		("optimize-age", po::value<int>(&opts.optimize_age)->default_value(7),
+			"the days after which a tile is recompressed by --optimize-tiles")
+		("recomposite", "only composes the composite tiles of the rendered maps again of their"
+			" render tiles")
+		("reencode", "only encodes the tiles of the rendered maps again with the image format and"
+			" quality of the configuration file");
 
 	po::options_description all("Allowed options");
 	all.add(general).add(logging).add(renderer);
@@ -161,7 +215,7 @@ int main(int argc, char** argv) {
 		return 0;
 	}
 
-	if (!vm.count("config")) {
+	if (!vm.count("config") && !vm.count("service")) {
 		std::cerr << "You have to specify a configuration file!" << std::endl;
 		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
 		return 1;
@@ -180,6 +234,150 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 
+	if (opts.jobs < 1 || opts.concurrent_renders < 1) {
+		std::cerr << "The count of jobs and concurrent renders must be at least 1!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (opts.block_profile_sampling < 1) {
+		std::cerr << "The sampling of --block-profile must be at least 1!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (opts.memory_limit < 0) {
+		std::cerr << "The memory limit must be a positive number or 0!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	opts.max_time = 0;
+	if (vm.count("max-time")) {
+		// the time is given in minutes without a unit
+		int factor = 60;
+		std::string number = arg_max_time;
+		if (!number.empty() && std::strchr("smh", number.back())) {
+			factor = number.back() == 's' ? 1 : (number.back() == 'm' ? 60 : 3600);
+			number.pop_back();
+		}
+		std::istringstream in(number);
+		if (!(in >> opts.max_time) || !in.eof() || opts.max_time < 1) {
+			std::cerr << "Invalid argument '" << arg_max_time << "' for '--max-time'." << std::endl;
+			std::cerr << "The time must be a positive number with an optional unit s, m or h." << std::endl;
+			std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+			return 1;
+		}
+		opts.max_time *= factor;
+	}
+
+	opts.shard = 0;
+	opts.shards = 1;
+	opts.merge_shards = vm.count("merge-shards");
+	opts.single_pass = vm.count("single-pass");
+	opts.pin_threads = vm.count("pin-threads");
+	opts.huge_pages = vm.count("huge-pages");
+	if (opts.huge_pages && !util::HugePageArena::setEnabled(true))
+		std::cerr << "Huge pages are not supported on this system, ignoring --huge-pages." << std::endl;
+	if (vm.count("shard")) {
+		char slash;
+		std::istringstream in(arg_shard);
+		if (!(in >> opts.shard >> slash >> opts.shards) || !in.eof() || slash != '/'
+				|| opts.shard < 1 || opts.shard > opts.shards) {
+			std::cerr << "Invalid argument '" << arg_shard << "' for '--shard'." << std::endl;
+			std::cerr << "The shard must be given as <i>/<n> with 1 <= i <= n." << std::endl;
+			std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+			return 1;
+		}
+		opts.shard--;
+	}
+	if (opts.shards > 1 && opts.merge_shards) {
+		std::cerr << "You may only use one of --shard or --merge-shards!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	opts.watch = vm.count("watch") ? opts.watch : 0;
+	if (vm.count("watch") && opts.watch < 1) {
+		std::cerr << "The interval of --watch must be at least 1 second!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+	if (opts.watch > 0 && (opts.shards > 1 || opts.merge_shards || opts.max_time > 0)) {
+		std::cerr << "You may not use --watch with --shard, --merge-shards or --max-time!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	opts.plan = vm.count("plan");
+	if (opts.plan && (opts.watch > 0 || opts.shards > 1 || opts.merge_shards)) {
+		std::cerr << "You may not use --plan with --watch, --shard or --merge-shards!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+	opts.tune = vm.count("tune");
+	if (opts.tune && (opts.plan || opts.watch > 0 || opts.shards > 1 || opts.merge_shards)) {
+		std::cerr << "You may not use --tune with --plan, --watch, --shard or --merge-shards!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	opts.optimize_tiles = vm.count("optimize-tiles");
+	if (opts.optimize_tiles && (opts.plan || opts.tune || opts.watch > 0 || opts.shards > 1
+			|| opts.merge_shards)) {
+		std::cerr << "You may not use --optimize-tiles with --plan, --tune, --watch, --shard or --merge-shards!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+	opts.recomposite = vm.count("recomposite");
+	opts.reencode = vm.count("reencode");
+	if ((opts.recomposite || opts.reencode) && (opts.plan || opts.tune || opts.optimize_tiles
+			|| opts.watch > 0 || opts.shards > 1 || opts.merge_shards
+			|| (opts.recomposite && opts.reencode))) {
+		std::cerr << "You may not use --recomposite or --reencode with each other, --plan, --tune, --optimize-tiles, --watch, --shard or --merge-shards!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+	if (!opts.changed_chunks.empty() && (opts.tune || opts.optimize_tiles || opts.recomposite
+			|| opts.reencode || opts.watch > 0)) {
+		std::cerr << "You may not use --changed-chunks with --tune, --optimize-tiles, --recomposite, --reencode or --watch!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+	if (opts.optimize_age < 0) {
+		std::cerr << "The age of the tiles to optimize must not be negative!" << std::endl;
+		return 1;
+	}
+	if (!opts.service.empty() && (vm.count("config") || opts.skip_all || opts.shards > 1
+			|| opts.merge_shards || opts.max_time > 0 || opts.plan || opts.tune
+			|| opts.optimize_tiles || opts.recomposite || opts.reencode
+			|| !opts.changed_chunks.empty())) {
+		std::cerr << "You may only use --service with --render-force-all, --jobs, --memory-limit, --huge-pages and --watch!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+	if (opts.service_slice < 1) {
+		std::cerr << "The time slice of --service must be at least 1 second!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (!opts.service.empty()) {
+		config::LoggingConfig::configureLogging(opts.logging_config);
+		util::StatusReporter::installSignalHandler();
+
+		std::vector<renderer::ServiceTenant> tenants;
+		if (!renderer::RenderService::readTenants(opts.service, tenants))
+			return 1;
+		renderer::RenderService service(opts.jobs, opts.service_slice, opts.memory_limit);
+		service.setForceRender(opts.force_all);
+		service.setWatch(opts.watch);
+		for (auto it = tenants.begin(); it != tenants.end(); ++it)
+			if (!service.addTenant(*it))
+				return 1;
+		return service.run() ? 0 : 1;
+	}
+
 	// ###
 	// ### First big step: Load/parse/validate the configuration file
 	// ###
@@ -205,9 +403,49 @@ int main(int argc, char** argv) {
 	// configure logging from this configuration file
 	config.configureLogging();
 
+	// SIGUSR1 logs a report of what the rendering is doing
+	util::StatusReporter::installSignalHandler();
+
 	renderer::RenderManager manager(config);
 	manager.setRenderBehaviors(renderer::RenderBehaviors::fromRenderOpts(config, opts));
-	if (!manager.run(opts.jobs, opts.batch))
+	manager.setCacheStatsFile(opts.cache_stats);
+	manager.setProfileFile(opts.profile);
+	manager.setBlockProfileFile(opts.block_profile, opts.block_profile_sampling);
+	manager.setTraceFile(opts.trace);
+	manager.setMetricsFile(opts.metrics_file, opts.metrics_interval);
+	manager.setSlowTileTime(opts.slow_tiles);
+	manager.setShard(opts.shard, opts.shards);
+	manager.setMergeShards(opts.merge_shards);
+	manager.setConcurrentRenders(opts.concurrent_renders);
+	manager.setSinglePass(opts.single_pass);
+	manager.setMemoryLimit((size_t) opts.memory_limit * 1024 * 1024);
+	manager.setPinThreads(opts.pin_threads);
+	manager.setMaxTime(opts.max_time);
+	if (!opts.changed_chunks.empty()) {
+		std::map<std::string, std::set<mc::ChunkPos> > changed_chunks;
+		if (!renderer::RenderManager::readChangedChunks(opts.changed_chunks, changed_chunks))
+			return 1;
+		manager.setChangedChunks(changed_chunks);
+	}
+	if (opts.plan) {
+		if (!manager.plan(opts.jobs))
+			return 1;
+	} else if (opts.tune) {
+		if (!manager.tune(opts.jobs))
+			return 1;
+	} else if (opts.optimize_tiles) {
+		if (!manager.optimizeTiles(opts.jobs, opts.optimize_age * 24 * 60 * 60))
+			return 1;
+	} else if (opts.recomposite) {
+		if (!manager.recompositeTiles(opts.jobs))
+			return 1;
+	} else if (opts.reencode) {
+		if (!manager.reencodeTiles(opts.jobs))
+			return 1;
+	} else if (opts.watch > 0) {
+		if (!manager.watch(opts.jobs, opts.batch, opts.watch))
+			return 1;
+	} else if (!manager.run(opts.jobs, opts.batch))
 		return 1;
 	return 0;
 }
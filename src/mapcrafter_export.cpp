@@ -17,14 +17,187 @@
  * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "mapcraftercore/version.h"
+#include "accumulator.h"
+#include "mapcraftercore/util.h"
+#include "mapcraftercore/config/mapcrafterconfig.h"
+#include "mapcraftercore/config/webconfig.h"
+#include "mapcraftercore/renderer/mapexporter.h"
+#include "mapcraftercore/renderer/tilestore.h"
 
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
 
-using namespace mapcrafter;
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace util = mapcrafter::util;
+namespace config = mapcrafter::config;
+namespace renderer = mapcrafter::renderer;
 
 int main(int argc, char** argv) {
-	std::cout << "New features! Woohooo!" << std::endl;
+	std::string config_file, map, rotation_name, output_file, crop;
+	int verbosity = 0;
+	int zoom = -1;
+	int threads = 1;
+
+	po::options_description all("Allowed options");
+	all.add_options()
+		("help,h", "shows this help message")
+		("verbose,v", accumulator<int>(&verbosity),
+				"shows the progress and more information")
+
+		("config,c", po::value<std::string>(&config_file),
+			"the path to the configuration file (required)")
+		("map,m", po::value<std::string>(&map),
+			"the name of the map to export (required)")
+		("rotation,r", po::value<std::string>(&rotation_name),
+			"the rotation of the map to export (like tl or top-left), "
+			"defaults to the first rotation of the map")
+		("zoom,z", po::value<int>(&zoom),
+			"the zoom level to export, defaults to the max zoom level of the map")
+		("crop", po::value<std::string>(&crop),
+			"the area to export as x,y,width,height in pixels of the image of the whole "
+			"map, defaults to the whole map")
+		("output,o", po::value<std::string>(&output_file),
+			"the image file to write, a .png or .tif/.tiff file (required)")
+		("jobs,j", po::value<int>(&threads)->default_value(1),
+			"the count of threads to use for reading the tiles");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, all), vm);
+	} catch (po::error& ex) {
+		std::cout << "There is a problem parsing the command line arguments: "
+				<< ex.what() << std::endl << std::endl;
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	if (!vm.count("config") || !vm.count("map") || !vm.count("output")) {
+		std::cerr << "You have to specify a configuration file, a map and an output file!"
+				<< std::endl;
+		return 1;
+	}
+
+	util::LogLevel log_level = util::LogLevel::WARNING;
+	if (verbosity == 1)
+		log_level = util::LogLevel::INFO;
+	else if (verbosity > 1)
+		log_level = util::LogLevel::DEBUG;
+	util::Logging::getInstance().setSinkVerbosity("__output__", log_level);
+	util::Logging::getInstance().setSinkLogProgress("__output__", true);
+
+	config::MapcrafterConfig config;
+	config::ValidationMap validation = config.parseFile(config_file);
+
+	if (!validation.isEmpty()) {
+		if (validation.isCritical())
+			LOG(FATAL) << "Your configuration file is invalid!";
+		else
+			LOG(WARNING) << "Some notes on your configuration file:";
+		validation.log();
+		LOG(WARNING) << "Please read the documentation about the new configuration file format.";
+	}
+	if (validation.isCritical())
+		return 1;
+
+	if (threads < 1) {
+		std::cerr << "The count of threads must be at least one!" << std::endl;
+		return 1;
+	}
+
+	std::unique_ptr<renderer::ImageStreamWriter> writer =
+			renderer::createImageStreamWriter(output_file);
+	if (!writer) {
+		std::cerr << "The output file must be a .png or .tif/.tiff file!" << std::endl;
+		return 1;
+	}
+
+	if (!config.hasMap(map)) {
+		LOG(ERROR) << "There is no map " << map << "!";
+		return 1;
+	}
+	const config::MapSection& map_config = config.getMap(map);
+	int rotation = *map_config.getRotations().begin();
+	if (vm.count("rotation")) {
+		rotation = config::stringToRotation(rotation_name, config::ROTATION_NAMES);
+		if (rotation == -1)
+			rotation = config::stringToRotation(rotation_name, config::ROTATION_NAMES_SHORT);
+		if (rotation == -1 || !map_config.getRotations().count(rotation)) {
+			LOG(ERROR) << "Map " << map << " has no rotation " << rotation_name << "!";
+			return 1;
+		}
+	}
+
+	config::WebConfig web_config(config);
+	if (!web_config.readConfigJS() || web_config.getMapLastRendered(map, rotation) == 0) {
+		LOG(ERROR) << "Map " << map << " in rotation " << config::ROTATION_NAMES[rotation]
+				<< " is not rendered yet!";
+		return 1;
+	}
+	int max_zoom = web_config.getMapMaxZoom(map);
+	if (!vm.count("zoom"))
+		zoom = max_zoom;
+	if (zoom < 0 || zoom > max_zoom) {
+		LOG(ERROR) << "The zoom level must be between 0 and " << max_zoom << "!";
+		return 1;
+	}
+
+	fs::path output_dir = config.getOutputPath(map + "/"
+			+ config::ROTATION_NAMES_SHORT[rotation]);
+	// the JPEG tiles are exported with the background color of the web interface where
+	// there are no tiles, the other images with transparent pixels
+	renderer::RGBAPixel background = 0;
+	if (map_config.getImageFormat() == config::ImageFormat::JPEG) {
+		config::Color color = config.getBackgroundColor();
+		background = renderer::rgba(color.red, color.green, color.blue, 255);
+	}
+	renderer::MapExporter exporter(renderer::createTileStore(map_config, output_dir),
+			map_config.getImageFormat(), web_config.getMapTileSize(map), background);
+
+	renderer::ExportArea area = exporter.getMapArea(zoom);
+	if (area.isEmpty()) {
+		LOG(ERROR) << "There are no tiles of zoom level " << zoom << "!";
+		return 1;
+	}
+	if (vm.count("crop")) {
+		int x, y, width, height;
+		char end;
+		if (std::sscanf(crop.c_str(), "%d,%d,%d,%d%c", &x, &y, &width, &height, &end) != 4
+				|| x < 0 || y < 0 || width <= 0 || height <= 0) {
+			LOG(ERROR) << "Invalid crop '" << crop << "', it must be x,y,width,height!";
+			return 1;
+		}
+		// the crop is clipped to the image of the whole map
+		width = std::min(width, area.width - x);
+		height = std::min(height, area.height - y);
+		if (width <= 0 || height <= 0) {
+			LOG(ERROR) << "The crop is outside of the image of the map (" << area.width
+					<< "x" << area.height << " pixels)!";
+			return 1;
+		}
+		area = renderer::ExportArea(area.x + x, area.y + y, width, height);
+	}
 
-	return 0;
+	LOGN(INFO, "progress") << "Exporting zoom level " << zoom << " of map " << map
+			<< " in rotation " << config::ROTATION_NAMES[rotation] << " ("
+			<< area.width << "x" << area.height << " pixels) ...";
+	util::LogOutputProgressHandler progress;
+	if (!exporter.exportImage(*writer, output_file, zoom, area, threads, &progress)) {
+		LOG(ERROR) << "Unable to write '" << output_file << "'!";
+		return 1;
+	}
+	LOG(INFO) << "Exported " << exporter.getReadTiles() << " tiles.";
+	return exporter.getFailedTiles() == 0 ? 0 : 1;
 }
@@ -19,13 +19,17 @@
 
 #include "accumulator.h"
 #include "mapcraftercore/util.h"
+#include "mapcraftercore/compat/thread.h"
 #include "mapcraftercore/config/mapcrafterconfig.h"
 #include "mapcraftercore/mc/world.h"
 #include "mapcraftercore/mc/worldentities.h"
 
+#include <algorithm>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 #include <boost/program_options.hpp>
@@ -55,36 +59,71 @@ typedef std::map<std::string, std::vector<Marker>> MarkerGroup;
 // map (marker group name -> map ( world name -> array of markers) )
 typedef std::map<std::string, MarkerGroup > Markers;
 
-Markers findMarkers(const config::MapcrafterConfig& config) {
+Markers findMarkers(const config::MapcrafterConfig& config, int threads) {
 	Markers markers;
 	auto groups = config.getMarkers();
 	for (auto group_it = groups.begin(); group_it != groups.end(); ++group_it)
 		markers[group_it->getShortName()];
 
+	// the world sections of the same world (with different crops for example) share
+	// the entities cache of the region directory, it's loaded only once
 	auto config_worlds = config.getWorlds();
-	auto config_markers = config.getMarkers();
+	std::vector<std::pair<std::string, mc::World> > worlds;
+	std::map<std::string, std::unique_ptr<mc::WorldEntitiesCache> > entities;
+	std::map<std::string, std::string> entities_world_names;
 	for (auto world_it = config_worlds.begin(); world_it != config_worlds.end();
 			++world_it) {
-		mc::WorldCrop world_crop = world_it->second.getWorldCrop();
 		mc::World world(world_it->second.getInputDir().string(),
 				world_it->second.getDimension());
+		world.setCacheDir(world_it->second.getRemoteCacheDir());
 		if (!world.load()) {
 			LOG(ERROR) << "Unable to load world " << world_it->first << "!";
 			continue;
 		}
+		std::unique_ptr<mc::WorldEntitiesCache>& cache = entities[
+				world.getRegionDir().string()];
+		if (!cache) {
+			cache.reset(new mc::WorldEntitiesCache(world));
+			entities_world_names[world.getRegionDir().string()] = world_it->first;
+		}
+		worlds.push_back(std::make_pair(world_it->first, world));
+	}
 
-		LOGN(INFO, "progress") << "Loading entities of world '" << world_it->first << "' ...";
-		mc::WorldEntitiesCache entities(world);
-		util::LogOutputProgressHandler progress;
-		entities.update(&progress);
+	// the different worlds are loaded at the same time, they share the threads
+	if (entities.size() == 1 || threads == 1) {
+		for (auto it = entities.begin(); it != entities.end(); ++it) {
+			LOGN(INFO, "progress") << "Loading entities of world '"
+					<< entities_world_names[it->first] << "' ...";
+			util::LogOutputProgressHandler progress;
+			it->second->update(&progress, threads);
+		}
+	} else {
+		LOGN(INFO, "progress") << "Loading entities of " << entities.size() << " worlds ...";
+		int world_threads = std::max(1, threads / (int) entities.size());
+		std::vector<thread_ns::thread> update_threads;
+		for (auto it = entities.begin(); it != entities.end(); ++it) {
+			mc::WorldEntitiesCache* cache = it->second.get();
+			update_threads.push_back(thread_ns::thread([cache, world_threads]() {
+				cache->update(nullptr, world_threads);
+			}));
+		}
+		for (auto it = update_threads.begin(); it != update_threads.end(); ++it)
+			it->join();
+	}
 
-		// Setting world crop after WorldEntitiesCache is fully updated
-		// to allow markers of the same non-cropped world to be generated
+	auto config_markers = config.getMarkers();
+	for (auto world_it = worlds.begin(); world_it != worlds.end(); ++world_it) {
+		config::WorldSection world_config = config.getWorld(world_it->first);
+		mc::WorldCrop world_crop = world_config.getWorldCrop();
+		// the world crop is set after updating the entities, so the markers of the
+		// same non-cropped world can be generated
+		mc::World& world = world_it->second;
 		world.setWorldCrop(world_crop);
+		const mc::WorldEntitiesCache& cache = *entities[world.getRegionDir().string()];
 
 		// use name of the world section as world name, not the world_name
-		std::string world_name = world_it->second.getShortName();
-		std::vector<mc::SignEntity> signs = entities.getSigns(world.getWorldCrop());
+		std::string world_name = world_config.getShortName();
+		std::vector<mc::SignEntity> signs = cache.getSigns(world.getWorldCrop());
 		for (auto sign_it = signs.begin(); sign_it != signs.end(); ++sign_it) {
 			// don't use signs not contained in the world boundaries
 			if (!world_crop.isBlockContainedXZ(sign_it->getPos())
@@ -160,6 +199,7 @@ int main(int argc, char** argv) {
 	std::string config_file;
 	std::string output_file;
 	int verbosity = 0;
+	int threads = 1;
  
 	po::options_description all("Allowed options");
 	all.add_options()
@@ -171,7 +211,9 @@ int main(int argc, char** argv) {
 			"the path to the configuration file (required)")
 		("output-file,o", po::value<std::string>(&output_file),
 			"file to write the generated markers to, "
-			"defaults to markers-generated.js in the output directory.");
+			"defaults to markers-generated.js in the output directory.")
+		("jobs,j", po::value<int>(&threads)->default_value(1),
+			"the count of threads to use for scanning the worlds");
 
 	po::variables_map vm;
 	try {
@@ -216,7 +258,12 @@ int main(int argc, char** argv) {
 		LOG(WARNING) << "Please read the documentation about the new configuration file format.";
 	}
 
-	Markers markers = findMarkers(config);
+	if (threads < 1) {
+		std::cerr << "The count of threads must be at least one!" << std::endl;
+		return 1;
+	}
+
+	Markers markers = findMarkers(config, threads);
 
 	// count how many markers / markers of which group were found
 	int markers_count = 0;
@@ -248,8 +295,18 @@ int main(int argc, char** argv) {
 	else {
 		if (output_file == "")
 			output_file = config.getOutputPath("markers-generated.js").string();
+		// the file is only written if the markers changed, so browsers can keep it cached
+		std::string json = createMarkersJSON(config, markers);
+		std::ifstream in(output_file);
+		std::stringstream old_json;
+		old_json << in.rdbuf();
+		if (in && old_json.str() == json) {
+			LOG(INFO) << "The markers didn't change.";
+			return 0;
+		}
+		in.close();
 		std::ofstream out(output_file);
-		out << createMarkersJSON(config, markers);
+		out << json;
 		out.close();
 		if (!out) {
 			LOG(ERROR) << "Unable to write to file '" << output_file << "'!";
@@ -0,0 +1,372 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapcraftercore/compat/thread.h"
+#include "mapcraftercore/config/loggingconfig.h"
+#include "mapcraftercore/renderer/manager.h"
+#include "mapcraftercore/util.h"
+#include "mapcraftercore/version.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+using boost::asio::ip::tcp;
+
+using namespace mapcrafter;
+
+namespace {
+
+// count of threads answering the requests, the tiles are rendered one after another
+// with all render threads
+const int CONNECTION_THREADS = 8;
+
+// the most bytes of the header of a request
+const size_t MAX_REQUEST_SIZE = 8192;
+
+// the seconds a client has to send the header of a request, so idle connections don't
+// keep the connection threads busy
+const int REQUEST_TIMEOUT = 10;
+
+std::string getContentType(const std::string& extension) {
+	if (extension == ".html")
+		return "text/html";
+	if (extension == ".js")
+		return "application/javascript";
+	if (extension == ".css")
+		return "text/css";
+	if (extension == ".json")
+		return "application/json";
+	if (extension == ".png")
+		return "image/png";
+	if (extension == ".jpg")
+		return "image/jpeg";
+	if (extension == ".webp")
+		return "image/webp";
+	return "application/octet-stream";
+}
+
+/**
+ * Parses the url of a tile relative to the output directory, for example
+ * <map>/<rotation>/1/4/2.png or <map>/<rotation>/base.png. Returns false if it's not
+ * the url of a tile of a map.
+ */
+bool parseTileUrl(const config::MapcrafterConfig& config, const std::string& url,
+		std::string& map, int& rotation, renderer::TilePath& tile) {
+	std::vector<std::string> parts;
+	std::istringstream in(url);
+	std::string part;
+	while (std::getline(in, part, '/'))
+		parts.push_back(part);
+	if (parts.size() < 3 || !config.hasMap(parts[0]))
+		return false;
+	map = parts[0];
+	rotation = -1;
+	for (int i = 0; i < 4; i++)
+		if (parts[1] == config::ROTATION_NAMES_SHORT[i])
+			rotation = i;
+	if (rotation == -1)
+		return false;
+
+	// the last part of the path has the image format suffix
+	std::string suffix = "." + config.getMap(map).getImageFormatSuffix();
+	std::string& last = parts.back();
+	if (last.size() <= suffix.size() || !util::endswith(last, suffix))
+		return false;
+	last = last.substr(0, last.size() - suffix.size());
+	tile = renderer::TilePath();
+	if (parts.size() == 3 && last == "base")
+		return true;
+	for (size_t i = 2; i < parts.size(); i++) {
+		if (parts[i].size() != 1 || parts[i][0] < '1' || parts[i][0] > '4'
+				|| tile.getDepth() >= renderer::TilePath::MAX_DEPTH)
+			return false;
+		tile += parts[i][0] - '0';
+	}
+	return true;
+}
+
+void writeResponse(tcp::socket& socket, const std::string& status,
+		const std::string& content_type, const std::string& data, bool head) {
+	std::ostringstream response;
+	response << "HTTP/1.0 " << status << "\r\n";
+	response << "Content-Type: " << content_type << "\r\n";
+	response << "Content-Length: " << data.size() << "\r\n";
+	response << "Connection: close\r\n\r\n";
+	if (!head)
+		response << data;
+	boost::system::error_code error;
+	boost::asio::write(socket, boost::asio::buffer(response.str()), error);
+}
+
+/**
+ * Reads the header of a request with the io_service of the socket. Returns false if
+ * that fails or if the client doesn't send it in time.
+ */
+bool readRequest(boost::asio::io_service& io_service, tcp::socket& socket,
+		boost::asio::streambuf& buffer) {
+	boost::system::error_code error;
+	boost::asio::deadline_timer timer(io_service,
+			boost::posix_time::seconds(REQUEST_TIMEOUT));
+	boost::asio::async_read_until(socket, buffer, "\r\n\r\n",
+			[&](const boost::system::error_code& read_error, size_t) {
+		error = read_error;
+		timer.cancel();
+	});
+	timer.async_wait([&](const boost::system::error_code& timer_error) {
+		// the read fails with operation_aborted if the deadline passed
+		if (timer_error != boost::asio::error::operation_aborted)
+			socket.cancel();
+	});
+	io_service.reset();
+	io_service.run();
+	return !error;
+}
+
+/**
+ * Answers the request of a connection: The tiles of the maps are rendered on demand if
+ * they're outdated, the other files are taken from the output directory.
+ */
+void handleConnection(boost::asio::io_service& io_service, tcp::socket& socket,
+		const config::MapcrafterConfig& config, renderer::RenderManager& manager) {
+	boost::asio::streambuf buffer(MAX_REQUEST_SIZE);
+	if (!readRequest(io_service, socket, buffer))
+		return;
+
+	std::istream request(&buffer);
+	std::string method, url, version;
+	if (!(request >> method >> url >> version) || url.empty() || url[0] != '/') {
+		writeResponse(socket, "400 Bad Request", "text/plain", "Bad Request", false);
+		return;
+	}
+	bool head = method == "HEAD";
+	if (method != "GET" && !head) {
+		writeResponse(socket, "405 Method Not Allowed", "text/plain",
+				"Method Not Allowed", false);
+		return;
+	}
+	url = url.substr(1, url.find('?') - 1);
+	if (url.empty() || url.back() == '/')
+		url += "index.html";
+	// the files outside of the output directory are not served
+	if (url.find("..") != std::string::npos || url.find('\\') != std::string::npos) {
+		writeResponse(socket, "404 Not Found", "text/plain", "Not Found", head);
+		return;
+	}
+
+	std::string map;
+	int rotation;
+	renderer::TilePath tile;
+	std::string data;
+	if (parseTileUrl(config, url, map, rotation, tile)) {
+		if (manager.renderTile(map, rotation, tile, data))
+			writeResponse(socket, "200 OK",
+					getContentType(fs::path(url).extension().string()), data, head);
+		else
+			writeResponse(socket, "404 Not Found", "text/plain", "Not Found", head);
+		return;
+	}
+
+	fs::path file = config.getOutputPath(url);
+	std::ifstream in(file.string().c_str(), std::ios::binary);
+	if (!fs::is_regular_file(file) || !in) {
+		writeResponse(socket, "404 Not Found", "text/plain", "Not Found", head);
+		return;
+	}
+	std::stringstream contents;
+	contents << in.rdbuf();
+	writeResponse(socket, "200 OK", getContentType(file.extension().string()),
+			contents.str(), head);
+}
+
+}
+
+int main(int argc, char** argv) {
+	renderer::RenderOpts opts;
+	std::string arg_color, arg_config, arg_address;
+	int arg_port;
+
+	po::options_description general("General options");
+	general.add_options()
+		("help,h", "shows this help message")
+		("version,v", "shows the version of Mapcrafter");
+
+	po::options_description logging("Logging/output options");
+	logging.add_options()
+		("logging-config", po::value<fs::path>(&opts.logging_config),
+			"the path to the global logging configuration file to use (automatically determined if not specified)")
+		("color", po::value<std::string>(&arg_color)->default_value("auto"),
+			"whether terminal output is colored (true, false or auto)");
+
+	po::options_description server("Server options");
+	server.add_options()
+		("config,c", po::value<std::string>(&arg_config),
+			"the path to the configuration file to use (required)")
+		("render-skip,s", po::value<std::vector<std::string>>(&opts.render_skip)->multitoken(),
+			"does not serve the specified map(s)")
+		("jobs,j", po::value<int>(&opts.jobs)->default_value(1),
+			"the count of jobs to use when rendering the tiles")
+		("memory-limit", po::value<int>(&opts.memory_limit)->default_value(0),
+			"the memory in MiB the caches may use, they are made smaller to fit (0 for no limit)")
+		("address", po::value<std::string>(&arg_address)->default_value("127.0.0.1"),
+			"the address the server listens on")
+		("port,p", po::value<int>(&arg_port)->default_value(8080),
+			"the port the server listens on");
+
+	po::options_description all("Allowed options");
+	all.add(general).add(logging).add(server);
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, all), vm);
+	} catch (po::error& ex) {
+		std::cerr << "There is a problem parsing the command line arguments: "
+				<< ex.what() << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	po::notify(vm);
+
+	if (arg_color == "true")
+		util::setcolor::setEnabled(util::TerminalColorStates::ENABLED);
+	else if (arg_color == "false")
+		util::setcolor::setEnabled(util::TerminalColorStates::DISABLED);
+	else if (arg_color == "auto")
+		util::setcolor::setEnabled(util::TerminalColorStates::AUTO);
+	else {
+		std::cerr << "Invalid argument '" << arg_color << "' for '--color'." << std::endl;
+		std::cerr << "Allowed arguments are 'true', 'false' or 'auto'." << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (vm.count("help")) {
+		std::cout << all << std::endl;
+		std::cout << "Mapcrafter online documentation: <http://docs.mapcrafter.org>" << std::endl;
+		return 0;
+	}
+
+	if (vm.count("version")) {
+		std::cout << "Mapcrafter version: " << MAPCRAFTER_VERSION;
+		if (strlen(MAPCRAFTER_GITVERSION))
+			std::cout << " (" << MAPCRAFTER_GITVERSION << ")";
+		std::cout << std::endl;
+		return 0;
+	}
+
+	if (!vm.count("config")) {
+		std::cerr << "You have to specify a configuration file!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (opts.jobs < 1) {
+		std::cerr << "The count of jobs must be at least 1!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (opts.memory_limit < 0) {
+		std::cerr << "The memory limit must be a positive number or 0!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	if (arg_port < 1 || arg_port > 65535) {
+		std::cerr << "The port must be a number between 1 and 65535!" << std::endl;
+		std::cerr << "Use '" << argv[0] << " --help' for more information." << std::endl;
+		return 1;
+	}
+
+	opts.config = arg_config;
+	opts.skip_all = false;
+	opts.force_all = false;
+	if (!vm.count("logging-config"))
+		opts.logging_config = util::findLoggingConfigFile();
+
+	config::MapcrafterConfig config;
+	config::ValidationMap validation = config.parseFile(opts.config.string());
+
+	// show infos/warnings/errors if configuration file has something
+	if (!validation.isEmpty()) {
+		if (validation.isCritical())
+			LOG(FATAL) << "Unable to parse configuration file:";
+		else
+			LOG(WARNING) << "There is a problem parsing the configuration file:";
+		validation.log();
+		LOG(WARNING) << "Please have a look at the documentation.";
+	}
+	if (validation.isCritical())
+		return 1;
+
+	config::LoggingConfig::configureLogging(opts.logging_config);
+	config.configureLogging();
+
+	renderer::RenderManager manager(config);
+	manager.setRenderBehaviors(renderer::RenderBehaviors::fromRenderOpts(config, opts));
+	manager.setMemoryLimit((size_t) opts.memory_limit * 1024 * 1024);
+	if (!manager.prepareOnDemand(opts.jobs))
+		return 1;
+
+	boost::asio::io_service io_service;
+	tcp::acceptor acceptor(io_service);
+	try {
+		tcp::endpoint endpoint(boost::asio::ip::address::from_string(arg_address), arg_port);
+		acceptor.open(endpoint.protocol());
+		acceptor.set_option(tcp::acceptor::reuse_address(true));
+		acceptor.bind(endpoint);
+		acceptor.listen();
+	} catch (boost::system::system_error& ex) {
+		LOG(FATAL) << "Unable to listen on " << arg_address << ":" << arg_port
+				<< " (" << ex.what() << ").";
+		return 1;
+	}
+	LOG(INFO) << "Serving the maps on http://" << arg_address << ":" << arg_port << "/.";
+
+	// the connection threads accept the connections one after another and answer them,
+	// every thread has an own io_service for the deadline of the requests
+	thread_ns::mutex accept_mutex;
+	std::vector<thread_ns::thread> threads;
+	for (int i = 0; i < CONNECTION_THREADS; i++)
+		threads.push_back(thread_ns::thread([&]() {
+			boost::asio::io_service connection_service;
+			while (true) {
+				tcp::socket socket(connection_service);
+				boost::system::error_code error;
+				{
+					thread_ns::unique_lock<thread_ns::mutex> lock(accept_mutex);
+					acceptor.accept(socket, error);
+				}
+				if (!error)
+					handleConnection(connection_service, socket, config, manager);
+			}
+		}));
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+		it->join();
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "accumulator.h"
+#include "mapcraftercore/util.h"
+#include "mapcraftercore/compat/thread.h"
+#include "mapcraftercore/config/mapcrafterconfig.h"
+#include "mapcraftercore/mc/snapshot.h"
+#include "mapcraftercore/mc/world.h"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace util = mapcrafter::util;
+namespace config = mapcrafter::config;
+namespace mc = mapcrafter::mc;
+
+/**
+ * Converts the region files of the worlds with a snapshot directory into their render
+ * snapshots. Returns false if a region could not be converted.
+ */
+bool convertWorlds(const config::MapcrafterConfig& config, int threads) {
+	// the region files to convert (region file -> snapshot file), world sections of
+	// the same world with the same snapshot directory are converted only once
+	std::map<std::string, std::string> regions;
+	auto worlds = config.getWorlds();
+	for (auto world_it = worlds.begin(); world_it != worlds.end(); ++world_it) {
+		fs::path snapshot_dir = world_it->second.getSnapshotDir();
+		if (snapshot_dir.empty())
+			continue;
+		mc::World world(world_it->second.getInputDir().string(),
+				world_it->second.getDimension());
+		if (world.isRemote()) {
+			LOG(WARNING) << "Snapshots of remote world " << world_it->first
+					<< " are not supported.";
+			continue;
+		}
+		if (!world.load()) {
+			LOG(ERROR) << "Unable to load world " << world_it->first << "!";
+			continue;
+		}
+		boost::system::error_code error;
+		fs::create_directories(snapshot_dir, error);
+		if (!fs::is_directory(snapshot_dir)) {
+			LOG(ERROR) << "Unable to create snapshot directory '"
+					<< snapshot_dir.string() << "'!";
+			return false;
+		}
+		const auto& available = world.getAvailableRegions();
+		for (auto it = available.begin(); it != available.end(); ++it) {
+			std::string region_file = world.getRegionPath(*it).string();
+			regions[region_file] = mc::World::getSnapshotPath(snapshot_dir,
+					region_file).string();
+		}
+	}
+	if (regions.empty()) {
+		LOG(WARNING) << "There are no worlds with a snapshot directory ('snapshot_dir').";
+		return true;
+	}
+
+	LOGN(INFO, "progress") << "Converting " << regions.size() << " regions ...";
+	std::vector<std::pair<std::string, std::string> > queue(regions.begin(), regions.end());
+	std::atomic<size_t> next(0);
+	std::atomic<int> decoded(0), reused(0), failed(0);
+	util::LogOutputProgressHandler progress;
+	progress.setMax(queue.size());
+	thread_ns::mutex progress_mutex;
+
+	auto convert = [&]() {
+		size_t i;
+		while ((i = next++) < queue.size()) {
+			int region_decoded = 0, region_reused = 0;
+			if (!mc::convertRegionSnapshot(queue[i].first, queue[i].second,
+					region_decoded, region_reused)) {
+				LOG(ERROR) << "Unable to convert region '" << queue[i].first << "'!";
+				failed++;
+			}
+			decoded += region_decoded;
+			reused += region_reused;
+			thread_ns::unique_lock<thread_ns::mutex> lock(progress_mutex);
+			progress.setValue(progress.getValue() + 1);
+		}
+	};
+	std::vector<thread_ns::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.push_back(thread_ns::thread(convert));
+	convert();
+	for (auto it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+
+	LOG(INFO) << "Decoded " << decoded << " chunks, " << reused
+			<< " chunks were unchanged.";
+	return failed == 0;
+}
+
+int main(int argc, char** argv) {
+	std::string config_file;
+	int verbosity = 0;
+	int threads = 1;
+
+	po::options_description all("Allowed options");
+	all.add_options()
+		("help,h", "shows this help message")
+		("verbose,v", accumulator<int>(&verbosity),
+				"shows the progress and more information")
+
+		("config,c", po::value<std::string>(&config_file),
+			"the path to the configuration file (required)")
+		("jobs,j", po::value<int>(&threads)->default_value(1),
+			"the count of threads to use for converting the regions");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, all), vm);
+	} catch (po::error& ex) {
+		std::cout << "There is a problem parsing the command line arguments: "
+				<< ex.what() << std::endl << std::endl;
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	if (!vm.count("config")) {
+		std::cerr << "You have to specify a configuration file!" << std::endl;
+		return 1;
+	}
+
+	util::LogLevel log_level = util::LogLevel::WARNING;
+	if (verbosity == 1)
+		log_level = util::LogLevel::INFO;
+	else if (verbosity > 1)
+		log_level = util::LogLevel::DEBUG;
+	util::Logging::getInstance().setSinkVerbosity("__output__", log_level);
+	util::Logging::getInstance().setSinkLogProgress("__output__", true);
+
+	config::MapcrafterConfig config;
+	config::ValidationMap validation = config.parseFile(config_file);
+
+	if (!validation.isEmpty()) {
+		if (validation.isCritical())
+			LOG(FATAL) << "Your configuration file is invalid!";
+		else
+			LOG(WARNING) << "Some notes on your configuration file:";
+		validation.log();
+		LOG(WARNING) << "Please read the documentation about the new configuration file format.";
+	}
+	if (validation.isCritical())
+		return 1;
+
+	if (threads < 1) {
+		std::cerr << "The count of threads must be at least one!" << std::endl;
+		return 1;
+	}
+
+	return convertWorlds(config, threads) ? 0 : 1;
+}
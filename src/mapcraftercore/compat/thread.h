@@ -27,6 +27,7 @@
 namespace thread_ns = boost;
 #else
 #  include <condition_variable>
+#  include <future>
 #  include <mutex>
 namespace thread_ns = std;
 #endif
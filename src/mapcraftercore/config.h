@@ -0,0 +1,42 @@
+/*
+ * Copyright 2012-2014 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define HAVE_NULLPTR
+#define HAVE_ENUM_CLASS_COMPARISON
+#define HAVE_ENUM_CLASS_FORWARD_DECLARATION
+#define HAVE_THREAD_LOCAL
+#define HAVE_OPENAT
+#define HAVE_POSIX_FADVISE
+#define HAVE_MADVISE_HUGEPAGE
+
+#define HAVE_ENDIAN_H
+/* #undef ENDIAN_H_FREEBSD */
+
+#define HAVE_SYS_IOCTL_H
+#define HAVE_UNISTD_H
+#define HAVE_SYSLOG_H
+
+/* #undef HAVE_LIBDEFLATE */
+/* #undef HAVE_LIBWEBP */
+
+/* #undef OPT_USE_BOOST_THREAD */
+/* #undef OPT_MEMORY_TRACKING */
+/* #undef OPT_USDT */
+
+#define LOG_MAX_LEVEL DEBUG
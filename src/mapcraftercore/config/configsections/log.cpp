@@ -74,6 +74,7 @@ void LogSection::dump(std::ostream& out) const {
 	out << "  type = " << type << std::endl;
 	out << "  verbosity = " << verbosity << std::endl;
 	out << "  log_progress = " << log_progress << std::endl;
+	out << "  asynchronous = " << asynchronous << std::endl;
 
 	if (getType() == LogSinkType::OUTPUT || getType() == LogSinkType::FILE) {
 		out << "  format = " << format << std::endl;
@@ -101,6 +102,8 @@ void LogSection::configureLogging() const {
 		logging.setSinkVerbosity(sink_name, verbosity.getValue());
 	if (log_progress.isLoaded())
 		logging.setSinkLogProgress(sink_name, log_progress.getValue());
+	if (asynchronous.isLoaded())
+		logging.setSinkAsynchronous(sink_name, asynchronous.getValue());
 
 	// try to create file log sink
 	if (getType() == LogSinkType::FILE) {
@@ -143,6 +146,10 @@ bool LogSection::getLogProgress() const {
 	return log_progress.getValue();
 }
 
+bool LogSection::isAsynchronous() const {
+	return asynchronous.getValue();
+}
+
 std::string LogSection::getFormat() const {
 	return format.getValue();
 }
@@ -170,6 +177,8 @@ bool LogSection::parseField(const std::string key, const std::string value,
 		verbosity.load(key, value, validation);
 	else if (key == "log_progress")
 		log_progress.load(key, value, validation);
+	else if (key == "asynchronous")
+		asynchronous.load(key, value, validation);
 	else if (key == "format")
 		format.load(key, value, validation);
 	else if (key == "date_format")
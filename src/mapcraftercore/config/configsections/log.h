@@ -52,6 +52,7 @@ public:
 	LogSinkType getType() const;
 	util::LogLevel getVerbosity() const;
 	bool getLogProgress() const;
+	bool isAsynchronous() const;
 
 	// only for output, file log
 	std::string getFormat() const;
@@ -76,7 +77,7 @@ private:
 
 	Field<LogSinkType> type;
 	Field<util::LogLevel> verbosity;
-	Field<bool> log_progress;
+	Field<bool> log_progress, asynchronous;
 
 	// only for output, file log
 	Field<std::string> format, date_format;
@@ -30,7 +30,72 @@ config::ImageFormat as<config::ImageFormat>(const std::string& from) {
 		return config::ImageFormat::PNG;
 	else if (from == "jpeg")
 		return config::ImageFormat::JPEG;
-	throw std::invalid_argument("Must be 'png' or 'jpeg'!");
+	else if (from == "webp")
+		return config::ImageFormat::WEBP;
+	throw std::invalid_argument("Must be 'png', 'jpeg' or 'webp'!");
+}
+
+template <>
+config::PNGPalette as<config::PNGPalette>(const std::string& from) {
+	if (from == "tile")
+		return config::PNGPalette::TILE;
+	else if (from == "map")
+		return config::PNGPalette::MAP;
+	throw std::invalid_argument("Must be 'tile' or 'map'!");
+}
+
+template <>
+config::JPEGSubsampling as<config::JPEGSubsampling>(const std::string& from) {
+	if (from == "444")
+		return config::JPEGSubsampling::S444;
+	else if (from == "422")
+		return config::JPEGSubsampling::S422;
+	else if (from == "420")
+		return config::JPEGSubsampling::S420;
+	throw std::invalid_argument("Must be '444', '422' or '420'!");
+}
+
+template <>
+config::TileStoreType as<config::TileStoreType>(const std::string& from) {
+	if (from == "files")
+		return config::TileStoreType::FILES;
+	else if (from == "pack")
+		return config::TileStoreType::PACK;
+	throw std::invalid_argument("Must be 'files' or 'pack'!");
+}
+
+template <>
+config::PNGFilter as<config::PNGFilter>(const std::string& from) {
+	if (from == "all")
+		return config::PNGFilter::ALL;
+	else if (from == "none")
+		return config::PNGFilter::NONE;
+	else if (from == "sub")
+		return config::PNGFilter::SUB;
+	else if (from == "up")
+		return config::PNGFilter::UP;
+	else if (from == "average")
+		return config::PNGFilter::AVERAGE;
+	else if (from == "paeth")
+		return config::PNGFilter::PAETH;
+	throw std::invalid_argument("Must be one of 'all', 'none', 'sub', 'up', 'average' "
+			"or 'paeth'!");
+}
+
+template <>
+config::PNGZlibStrategy as<config::PNGZlibStrategy>(const std::string& from) {
+	if (from == "auto")
+		return config::PNGZlibStrategy::AUTO;
+	else if (from == "default")
+		return config::PNGZlibStrategy::DEFAULT;
+	else if (from == "filtered")
+		return config::PNGZlibStrategy::FILTERED;
+	else if (from == "huffman")
+		return config::PNGZlibStrategy::HUFFMAN;
+	else if (from == "rle")
+		return config::PNGZlibStrategy::RLE;
+	throw std::invalid_argument("Must be one of 'auto', 'default', 'filtered', 'huffman' "
+			"or 'rle'!");
 }
 
 template <>
@@ -125,11 +190,81 @@ std::ostream& operator<<(std::ostream& out, ImageFormat image_format) {
 		out << "png";
 	else if (image_format == ImageFormat::JPEG)
 		out << "jpeg";
+	else if (image_format == ImageFormat::WEBP)
+		out << "webp";
+	return out;
+}
+
+TileOutput::TileOutput()
+	: format(ImageFormat::PNG), quality(-1), lossless(false), half_size(false) {
+}
+
+std::string TileOutput::getImageFormatSuffix() const {
+	if (format == ImageFormat::PNG)
+		return "png";
+	else if (format == ImageFormat::WEBP)
+		return "webp";
+	return "jpg";
+}
+
+std::ostream& operator<<(std::ostream& out, PNGPalette png_palette) {
+	if (png_palette == PNGPalette::TILE)
+		out << "tile";
+	else if (png_palette == PNGPalette::MAP)
+		out << "map";
+	return out;
+}
+
+std::ostream& operator<<(std::ostream& out, JPEGSubsampling jpeg_subsampling) {
+	if (jpeg_subsampling == JPEGSubsampling::S444)
+		out << "444";
+	else if (jpeg_subsampling == JPEGSubsampling::S422)
+		out << "422";
+	else if (jpeg_subsampling == JPEGSubsampling::S420)
+		out << "420";
+	return out;
+}
+
+std::ostream& operator<<(std::ostream& out, TileStoreType tile_store) {
+	if (tile_store == TileStoreType::FILES)
+		out << "files";
+	else if (tile_store == TileStoreType::PACK)
+		out << "pack";
+	return out;
+}
+
+std::ostream& operator<<(std::ostream& out, PNGFilter png_filter) {
+	if (png_filter == PNGFilter::ALL)
+		out << "all";
+	else if (png_filter == PNGFilter::NONE)
+		out << "none";
+	else if (png_filter == PNGFilter::SUB)
+		out << "sub";
+	else if (png_filter == PNGFilter::UP)
+		out << "up";
+	else if (png_filter == PNGFilter::AVERAGE)
+		out << "average";
+	else if (png_filter == PNGFilter::PAETH)
+		out << "paeth";
+	return out;
+}
+
+std::ostream& operator<<(std::ostream& out, PNGZlibStrategy png_zlib_strategy) {
+	if (png_zlib_strategy == PNGZlibStrategy::AUTO)
+		out << "auto";
+	else if (png_zlib_strategy == PNGZlibStrategy::DEFAULT)
+		out << "default";
+	else if (png_zlib_strategy == PNGZlibStrategy::FILTERED)
+		out << "filtered";
+	else if (png_zlib_strategy == PNGZlibStrategy::HUFFMAN)
+		out << "huffman";
+	else if (png_zlib_strategy == PNGZlibStrategy::RLE)
+		out << "rle";
 	return out;
 }
 
 MapSection::MapSection()
-	: texture_size(12), render_unknown_blocks(false),
+	: texture_size(12), tile_sync_interval(0), render_unknown_blocks(false),
 	  render_leaves_transparent(false), render_biomes(false) {
 }
 
@@ -153,15 +288,56 @@ void MapSection::dump(std::ostream& out) const {
 	out << "  texture_dir = " << texture_dir << std::endl;
 	out << "  texture_size = " << texture_size << std::endl;
 	out << "  water_opacity = " << water_opacity << std::endl;
+	out << "  preview_levels = " << preview_levels << std::endl;
+	out << "  progressive_levels = " << progressive_levels << std::endl;
 	out << "  image_format = " << image_format << std::endl;
 	out << "  png_indexed = " << png_indexed << std::endl;
+	out << "  png_palette = " << png_palette << std::endl;
+	out << "  png_compression_level = " << png_compression_level << std::endl;
+	out << "  png_composite_compression_level = " << png_composite_compression_level << std::endl;
+	out << "  png_filter = " << png_filter << std::endl;
+	out << "  png_zlib_strategy = " << png_zlib_strategy << std::endl;
 	out << "  jpeg_quality = " << jpeg_quality << std::endl;
+	out << "  jpeg_fast_dct = " << jpeg_fast_dct << std::endl;
+	out << "  jpeg_subsampling = " << jpeg_subsampling << std::endl;
+	out << "  webp_lossless = " << webp_lossless << std::endl;
+	out << "  webp_quality = " << webp_quality << std::endl;
+	out << "  tile_deduplication = " << tile_deduplication << std::endl;
+	out << "  tile_store = " << tile_store << std::endl;
+	out << "  tile_sync = " << tile_sync << std::endl;
+	out << "  additional_outputs = " << additional_outputs << std::endl;
+	out << "  upload_url = " << upload_url << std::endl;
+	out << "  upload_region = " << upload_region << std::endl;
+	out << "  upload_threads = " << upload_threads << std::endl;
+	out << "  upload_retries = " << upload_retries << std::endl;
 	out << "  lighting_intensity = " << lighting_intensity << std::endl;
 	out << "  lighting_water_intensity = " << water_opacity << std::endl;
 	out << "  render_unknown_blocks = " << render_unknown_blocks << std::endl;
 	out << "  render_leaves_transparent = " << render_leaves_transparent << std::endl;
 	out << "  render_biomes = " << render_biomes << std::endl;
+	out << "  render_block_colors = " << render_block_colors << std::endl;
+	out << "  height_shading = " << height_shading << std::endl;
+	out << "  render_front_to_back = " << render_front_to_back << std::endl;
 	out << "  use_image_timestamps = " << use_image_mtimes << std::endl;
+	out << "  use_chunk_hashes = " << use_chunk_hashes << std::endl;
+	out << "  use_tile_hashes = " << use_tile_hashes << std::endl;
+	out << "  use_tile_costs = " << use_tile_costs << std::endl;
+	out << "  cache_block_images = " << cache_block_images << std::endl;
+	out << "  cache_tile_thumbnails = " << cache_tile_thumbnails << std::endl;
+	out << "  cache_tile_geometry = " << cache_tile_geometry << std::endl;
+	out << "  tile_cache_dir = " << tile_cache_dir << std::endl;
+	out << "  prefetch_threads = " << prefetch_threads << std::endl;
+	out << "  region_decode_threads = " << region_decode_threads << std::endl;
+	out << "  region_read_ahead = " << region_read_ahead << std::endl;
+	out << "  write_threads = " << write_threads << std::endl;
+	out << "  chunk_cache_size = " << chunk_cache_size << std::endl;
+	out << "  rotation_chunk_cache_size = " << rotation_chunk_cache_size << std::endl;
+	out << "  unpack_chunks = " << unpack_chunks << std::endl;
+	out << "  compressed_chunk_cache_size = " << compressed_chunk_cache_size << std::endl;
+	out << "  shared_memory_chunk_cache_size = " << shared_memory_chunk_cache_size
+			<< std::endl;
+	out << "  render_tiles_partially = " << render_tiles_partially << std::endl;
+	out << "  priority_points = " << priority_points << std::endl;
 }
 
 void MapSection::setConfigDir(const fs::path& config_dir) {
@@ -216,6 +392,14 @@ int MapSection::getTileWidth() const {
 	return tile_width.getValue();
 }
 
+int MapSection::getPreviewLevels() const {
+	return preview_levels.getValue();
+}
+
+int MapSection::getProgressiveLevels() const {
+	return progressive_levels.getValue();
+}
+
 ImageFormat MapSection::getImageFormat() const {
 	return image_format.getValue();
 }
@@ -223,17 +407,90 @@ ImageFormat MapSection::getImageFormat() const {
 std::string MapSection::getImageFormatSuffix() const {
 	if (getImageFormat() == ImageFormat::PNG)
 		return "png";
+	else if (getImageFormat() == ImageFormat::WEBP)
+		return "webp";
 	return "jpg";
 }
 
+const std::vector<TileOutput>& MapSection::getAdditionalOutputs() const {
+	return additional_outputs_list;
+}
+
+std::string MapSection::getUploadURL() const {
+	return upload_url.getValue();
+}
+
+std::string MapSection::getUploadRegion() const {
+	return upload_region.getValue();
+}
+
+int MapSection::getUploadThreads() const {
+	return upload_threads.getValue();
+}
+
+int MapSection::getUploadRetries() const {
+	return upload_retries.getValue();
+}
+
 bool MapSection::isPNGIndexed() const {
 	return png_indexed.getValue();
 }
 
+PNGPalette MapSection::getPNGPalette() const {
+	return png_palette.getValue();
+}
+
+int MapSection::getPNGCompressionLevel() const {
+	return png_compression_level.getValue();
+}
+
+int MapSection::getPNGCompositeCompressionLevel() const {
+	// the composite tiles are compressed like the render tiles if not specified
+	if (!png_composite_compression_level.isLoaded())
+		return getPNGCompressionLevel();
+	return png_composite_compression_level.getValue();
+}
+
+PNGFilter MapSection::getPNGFilter() const {
+	return png_filter.getValue();
+}
+
+PNGZlibStrategy MapSection::getPNGZlibStrategy() const {
+	return png_zlib_strategy.getValue();
+}
+
 int MapSection::getJPEGQuality() const {
 	return jpeg_quality.getValue();
 }
 
+bool MapSection::useJPEGFastDCT() const {
+	return jpeg_fast_dct.getValue();
+}
+
+JPEGSubsampling MapSection::getJPEGSubsampling() const {
+	return jpeg_subsampling.getValue();
+}
+
+bool MapSection::isWebPLossless() const {
+	return webp_lossless.getValue();
+}
+
+int MapSection::getWebPQuality() const {
+	return webp_quality.getValue();
+}
+
+bool MapSection::useTileDeduplication() const {
+	return tile_deduplication.getValue();
+}
+
+TileStoreType MapSection::getTileStore() const {
+	return tile_store.getValue();
+}
+
+int MapSection::getTileSyncInterval() const {
+	return tile_sync_interval;
+}
+
 double MapSection::getLightingIntensity() const {
 	return lighting_intensity.getValue();
 }
@@ -254,10 +511,94 @@ bool MapSection::renderBiomes() const {
 	return render_biomes.getValue();
 }
 
+bool MapSection::renderBlockColors() const {
+	return render_block_colors.getValue();
+}
+
+bool MapSection::renderFrontToBack() const {
+	return render_front_to_back.getValue();
+}
+
+bool MapSection::useHeightShading() const {
+	return height_shading.getValue();
+}
+
 bool MapSection::useImageModificationTimes() const {
 	return use_image_mtimes.getValue();
 }
 
+bool MapSection::useChunkHashes() const {
+	return use_chunk_hashes.getValue();
+}
+
+bool MapSection::useTileHashes() const {
+	return use_tile_hashes.getValue();
+}
+
+bool MapSection::useTileCosts() const {
+	return use_tile_costs.getValue();
+}
+
+bool MapSection::cacheBlockImages() const {
+	return cache_block_images.getValue();
+}
+
+bool MapSection::cacheTileThumbnails() const {
+	return cache_tile_thumbnails.getValue();
+}
+
+bool MapSection::cacheTileGeometry() const {
+	return cache_tile_geometry.getValue();
+}
+
+fs::path MapSection::getTileCacheDir() const {
+	return tile_cache_dir.getValue();
+}
+
+int MapSection::getPrefetchThreads() const {
+	return prefetch_threads.getValue();
+}
+
+int MapSection::getRegionDecodeThreads() const {
+	return region_decode_threads.getValue();
+}
+
+int MapSection::getRegionReadAhead() const {
+	return region_read_ahead.getValue();
+}
+
+int MapSection::getWriteThreads() const {
+	return write_threads.getValue();
+}
+
+int MapSection::getChunkCacheSize() const {
+	return chunk_cache_size.getValue();
+}
+
+int MapSection::getRotationChunkCacheSize() const {
+	return rotation_chunk_cache_size.getValue();
+}
+
+bool MapSection::unpackChunks() const {
+	return unpack_chunks.getValue();
+}
+
+int MapSection::getCompressedChunkCacheSize() const {
+	return compressed_chunk_cache_size.getValue();
+}
+
+int MapSection::getSharedMemoryChunkCacheSize() const {
+	return shared_memory_chunk_cache_size.getValue();
+}
+
+bool MapSection::renderTilesPartially() const {
+	return render_tiles_partially.getValue();
+}
+
+const std::vector<mc::BlockPos>& MapSection::getPriorityPoints() const {
+	return priority_points_list;
+}
+
 TileSetGroupID MapSection::getTileSetGroup() const {
 	return TileSetGroupID(getWorld(), getRenderView(), getTileWidth());
 }
@@ -289,17 +630,56 @@ void MapSection::preParse(const INIConfigSection& section,
 	texture_blur.setDefault(0);
 	water_opacity.setDefault(1.0);
 	tile_width.setDefault(1);
+	preview_levels.setDefault(0);
+	progressive_levels.setDefault(0);
 
 	image_format.setDefault(ImageFormat::PNG);
 	png_indexed.setDefault(false);
+	png_palette.setDefault(PNGPalette::TILE);
+	png_compression_level.setDefault(6);
+	png_filter.setDefault(PNGFilter::ALL);
+	png_zlib_strategy.setDefault(PNGZlibStrategy::AUTO);
 	jpeg_quality.setDefault(85);
+	jpeg_fast_dct.setDefault(false);
+	jpeg_subsampling.setDefault(JPEGSubsampling::S420);
+	webp_lossless.setDefault(true);
+	webp_quality.setDefault(75);
+	tile_deduplication.setDefault(false);
+	tile_store.setDefault(TileStoreType::FILES);
+	tile_sync.setDefault("none");
 
 	lighting_intensity.setDefault(1.0);
 	lighting_water_intensity.setDefault(1.0);
 	render_unknown_blocks.setDefault(false);
 	render_leaves_transparent.setDefault(true);
 	render_biomes.setDefault(true);
+	render_block_colors.setDefault(false);
+	height_shading.setDefault(true);
+	render_front_to_back.setDefault(false);
 	use_image_mtimes.setDefault(true);
+	use_chunk_hashes.setDefault(false);
+	use_tile_hashes.setDefault(false);
+	use_tile_costs.setDefault(false);
+	cache_block_images.setDefault(false);
+	cache_tile_thumbnails.setDefault(false);
+	cache_tile_geometry.setDefault(false);
+	tile_cache_dir.setDefault(fs::path());
+	prefetch_threads.setDefault(0);
+	region_decode_threads.setDefault(0);
+	region_read_ahead.setDefault(0);
+	write_threads.setDefault(0);
+	chunk_cache_size.setDefault(1024);
+	rotation_chunk_cache_size.setDefault(0);
+	unpack_chunks.setDefault(false);
+	compressed_chunk_cache_size.setDefault(0);
+	shared_memory_chunk_cache_size.setDefault(0);
+	render_tiles_partially.setDefault(false);
+	additional_outputs.setDefault("");
+	upload_url.setDefault("");
+	upload_region.setDefault("us-east-1");
+	upload_threads.setDefault(4);
+	upload_retries.setDefault(3);
+	priority_points.setDefault("");
 }
 
 bool MapSection::parseField(const std::string key, const std::string value,
@@ -340,14 +720,58 @@ bool MapSection::parseField(const std::string key, const std::string value,
 		tile_width.load(key, value, validation);
 		if (tile_width.getValue() < 1)
 			validation.error("'tile_width' must be a positive number!");
+	} else if (key == "preview_levels") {
+		if (preview_levels.load(key, value, validation)
+				&& (preview_levels.getValue() < 0 || preview_levels.getValue() > 4))
+			validation.error("'preview_levels' must be a number between 0 and 4!");
+	} else if (key == "progressive_levels") {
+		if (progressive_levels.load(key, value, validation)
+				&& (progressive_levels.getValue() < 0 || progressive_levels.getValue() > 4))
+			validation.error("'progressive_levels' must be a number between 0 and 4!");
 	} else if (key == "image_format") {
 		image_format.load(key, value, validation);
+#ifndef HAVE_LIBWEBP
+		if (image_format.getValue() == ImageFormat::WEBP)
+			validation.error("Mapcrafter was built without libwebp, "
+					"the image format 'webp' is not available!");
+#endif
 	} else if (key == "png_indexed") {
 		png_indexed.load(key, value, validation);
+	} else if (key == "png_palette") {
+		png_palette.load(key, value, validation);
+	} else if (key == "png_compression_level") {
+		if (png_compression_level.load(key, value, validation)
+				&& (png_compression_level.getValue() < 0 || png_compression_level.getValue() > 9))
+			validation.error("'png_compression_level' must be a number between 0 and 9!");
+	} else if (key == "png_composite_compression_level") {
+		if (png_composite_compression_level.load(key, value, validation)
+				&& (png_composite_compression_level.getValue() < 0
+					|| png_composite_compression_level.getValue() > 9))
+			validation.error("'png_composite_compression_level' must be a number between 0 and 9!");
+	} else if (key == "png_filter") {
+		png_filter.load(key, value, validation);
+	} else if (key == "png_zlib_strategy") {
+		png_zlib_strategy.load(key, value, validation);
 	} else if (key == "jpeg_quality") {
 		if (jpeg_quality.load(key, value, validation)
 				&& (jpeg_quality.getValue() < 0 || jpeg_quality.getValue() > 100))
 			validation.error("'jpeg_quality' must be a number between 0 and 100!");
+	} else if (key == "jpeg_fast_dct") {
+		jpeg_fast_dct.load(key, value, validation);
+	} else if (key == "jpeg_subsampling") {
+		jpeg_subsampling.load(key, value, validation);
+	} else if (key == "webp_lossless") {
+		webp_lossless.load(key, value, validation);
+	} else if (key == "webp_quality") {
+		if (webp_quality.load(key, value, validation)
+				&& (webp_quality.getValue() < 0 || webp_quality.getValue() > 100))
+			validation.error("'webp_quality' must be a number between 0 and 100!");
+	} else if (key == "tile_deduplication") {
+		tile_deduplication.load(key, value, validation);
+	} else if (key == "tile_store") {
+		tile_store.load(key, value, validation);
+	} else if (key == "tile_sync") {
+		tile_sync.load(key, value, validation);
 	} else if (key == "lighting_intensity") {
 		lighting_intensity.load(key, value, validation);
 	} else if (key == "lighting_water_intensity") {
@@ -358,8 +782,83 @@ bool MapSection::parseField(const std::string key, const std::string value,
 		render_leaves_transparent.load(key, value, validation);
 	} else if (key == "render_biomes") {
 		render_biomes.load(key, value, validation);
+	} else if (key == "render_block_colors") {
+		render_block_colors.load(key, value, validation);
+	} else if (key == "height_shading") {
+		height_shading.load(key, value, validation);
+	} else if (key == "render_front_to_back") {
+		render_front_to_back.load(key, value, validation);
 	} else if (key == "use_image_mtimes") {
 		use_image_mtimes.load(key, value, validation);
+	} else if (key == "use_chunk_hashes") {
+		use_chunk_hashes.load(key, value, validation);
+	} else if (key == "use_tile_hashes") {
+		use_tile_hashes.load(key, value, validation);
+	} else if (key == "use_tile_costs") {
+		use_tile_costs.load(key, value, validation);
+	} else if (key == "cache_block_images") {
+		cache_block_images.load(key, value, validation);
+	} else if (key == "cache_tile_thumbnails") {
+		cache_tile_thumbnails.load(key, value, validation);
+	} else if (key == "cache_tile_geometry") {
+		cache_tile_geometry.load(key, value, validation);
+	} else if (key == "tile_cache_dir") {
+		if (tile_cache_dir.load(key, value, validation))
+			tile_cache_dir.setValue(BOOST_FS_ABSOLUTE(tile_cache_dir.getValue(), config_dir));
+	} else if (key == "prefetch_threads") {
+		if (prefetch_threads.load(key, value, validation)
+				&& prefetch_threads.getValue() < 0)
+			validation.error("'prefetch_threads' must be a positive number or 0!");
+	} else if (key == "region_decode_threads") {
+		if (region_decode_threads.load(key, value, validation)
+				&& region_decode_threads.getValue() < 0)
+			validation.error("'region_decode_threads' must be a positive number or 0!");
+	} else if (key == "region_read_ahead") {
+		if (region_read_ahead.load(key, value, validation)
+				&& region_read_ahead.getValue() < 0)
+			validation.error("'region_read_ahead' must be a positive number or 0!");
+	} else if (key == "write_threads") {
+		if (write_threads.load(key, value, validation)
+				&& write_threads.getValue() < 0)
+			validation.error("'write_threads' must be a positive number or 0!");
+	} else if (key == "chunk_cache_size") {
+		if (chunk_cache_size.load(key, value, validation)
+				&& chunk_cache_size.getValue() <= 0)
+			validation.error("'chunk_cache_size' must be a positive number!");
+	} else if (key == "rotation_chunk_cache_size") {
+		if (rotation_chunk_cache_size.load(key, value, validation)
+				&& rotation_chunk_cache_size.getValue() < 0)
+			validation.error("'rotation_chunk_cache_size' must be a positive number or 0!");
+	} else if (key == "unpack_chunks") {
+		unpack_chunks.load(key, value, validation);
+	} else if (key == "compressed_chunk_cache_size") {
+		if (compressed_chunk_cache_size.load(key, value, validation)
+				&& compressed_chunk_cache_size.getValue() < 0)
+			validation.error("'compressed_chunk_cache_size' must be a positive number or 0!");
+	} else if (key == "shared_memory_chunk_cache_size") {
+		if (shared_memory_chunk_cache_size.load(key, value, validation)
+				&& shared_memory_chunk_cache_size.getValue() < 0)
+			validation.error("'shared_memory_chunk_cache_size' must be a positive number or 0!");
+	} else if (key == "render_tiles_partially") {
+		render_tiles_partially.load(key, value, validation);
+	} else if (key == "priority_points") {
+		priority_points.load(key, value, validation);
+	} else if (key == "additional_outputs") {
+		additional_outputs.load(key, value, validation);
+	} else if (key == "upload_url") {
+		if (upload_url.load(key, value, validation) && !upload_url.getValue().empty()
+				&& !util::isHTTPURL(upload_url.getValue()))
+			validation.error("'upload_url' must be a http:// URL!");
+	} else if (key == "upload_region") {
+		upload_region.load(key, value, validation);
+	} else if (key == "upload_threads") {
+		if (upload_threads.load(key, value, validation)
+				&& upload_threads.getValue() <= 0)
+			validation.error("'upload_threads' must be a positive number!");
+	} else if (key == "upload_retries") {
+		if (upload_retries.load(key, value, validation)
+				&& upload_retries.getValue() < 0)
+			validation.error("'upload_retries' must be a positive number or 0!");
 	} else
 		return false;
 	return true;
@@ -384,10 +883,105 @@ void MapSection::postParse(const INIConfigSection& section,
 		}
 	}
 
+	// parse the points of interest, pairs of x and z block coordinates
+	priority_points_list.clear();
+	ss.clear();
+	ss.str(priority_points.getValue());
+	while (ss >> elem) {
+		int x, z;
+		char separator, rest;
+		std::stringstream point(elem);
+		if (point >> x >> separator >> z && separator == ',' && !(point >> rest))
+			priority_points_list.push_back(mc::BlockPos(x, z, 0));
+		else
+			validation.error("Invalid priority point '" + elem + "'! "
+					+ "The points must be specified as x,z pairs.");
+	}
+
+	// parse the additional outputs, <format>[:<quality>|:lossless][@1x]
+	additional_outputs_list.clear();
+	ss.clear();
+	ss.str(additional_outputs.getValue());
+	std::set<std::string> output_names;
+	output_names.insert(getImageFormatSuffix());
+	while (ss >> elem) {
+		TileOutput output;
+		std::string spec = elem;
+		if (spec.size() > 3 && spec.substr(spec.size() - 3) == "@1x") {
+			output.half_size = true;
+			spec = spec.substr(0, spec.size() - 3);
+		}
+		std::string quality;
+		size_t colon = spec.find(':');
+		if (colon != std::string::npos) {
+			quality = spec.substr(colon + 1);
+			spec = spec.substr(0, colon);
+		}
+		try {
+			output.format = util::as<ImageFormat>(spec);
+			if (quality == "lossless" && output.format == ImageFormat::WEBP)
+				output.lossless = true;
+			else if (!quality.empty())
+				output.quality = util::as<int>(quality);
+		} catch (std::invalid_argument& e) {
+			validation.error("Invalid output '" + elem + "'! The outputs must be "
+					+ "specified as <format>[:<quality>][@1x].");
+			continue;
+		}
+		if (!quality.empty() && !output.lossless && (output.format == ImageFormat::PNG
+				|| output.quality < 0 || output.quality > 100)) {
+			validation.error("Invalid quality of output '" + elem + "'! "
+					+ "JPEG and WebP outputs have a quality between 0 and 100.");
+			continue;
+		}
+#ifndef HAVE_LIBWEBP
+		if (output.format == ImageFormat::WEBP) {
+			validation.error("Mapcrafter was built without libwebp, "
+					"the output '" + elem + "' is not available!");
+			continue;
+		}
+#endif
+		output.name = output.getImageFormatSuffix() + (output.half_size ? "@1x" : "");
+		if (!output_names.insert(output.name).second) {
+			validation.error("There is already an output with the image format and size "
+					"of output '" + elem + "'!");
+			continue;
+		}
+		additional_outputs_list.push_back(output);
+	}
+
+	// the uploads read the files of the tiles
+	if (!upload_url.getValue().empty() && tile_store.getValue() == TileStoreType::PACK)
+		validation.error("'upload_url' is only available for the file tile store!");
+
+	// the tiles are synced never, only at the end or every n tiles
+	tile_sync_interval = 0;
+	if (tile_sync.getValue() == "end")
+		tile_sync_interval = -1;
+	else if (tile_sync.getValue() != "none") {
+		try {
+			tile_sync_interval = util::as<int>(tile_sync.getValue());
+		} catch (std::invalid_argument& e) {
+		}
+		if (tile_sync_interval <= 0) {
+			tile_sync_interval = 0;
+			validation.error("'tile_sync' must be 'none', 'end' or a positive number!");
+		}
+	}
+
 	// check if required options were specified
 	if (!isGlobal()) {
 		world.require(validation, "You have to specify a world ('world')!");
 		texture_dir.require(validation, "You have to specify a texture directory ('texture_dir')!");
+		if (render_block_colors.getValue()
+				&& render_view.getValue() != renderer::RenderViewType::TOPDOWN)
+			validation.error("'render_block_colors' is only available for the topdown render view!");
+		if (render_front_to_back.getValue()
+				&& render_view.getValue() != renderer::RenderViewType::ISOMETRIC)
+			validation.error("'render_front_to_back' is only available for the isometric render view!");
+		// the preview tiles are rendered with the textures scaled down by a power of two
+		if (texture_size.getValue() % (1 << preview_levels.getValue()) != 0)
+			validation.error("'texture_size' must be divisible by 2^preview_levels!");
 	}
 }
 
@@ -22,12 +22,14 @@
 
 #include "../configsection.h"
 #include "../validation.h"
+#include "../../mc/pos.h"
 #include "../../renderer/rendermode.h"
 #include "../../renderer/renderview.h"
 
 #include <iostream>
 #include <set>
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -76,11 +78,88 @@ public:
 
 enum class ImageFormat {
 	PNG,
-	JPEG
+	JPEG,
+	WEBP
 };
 
 std::ostream& operator<<(std::ostream& out, ImageFormat image_format);
 
+/**
+ * An additional output of the tiles of a map. The tiles are encoded for it from the same
+ * rendered images as the tiles of the map, optionally resized to the half size (like
+ * @1x tiles of a map rendered for HiDPI screens).
+ */
+struct TileOutput {
+	TileOutput();
+
+	/**
+	 * Returns the suffix of the image files, png, jpg or webp.
+	 */
+	std::string getImageFormatSuffix() const;
+
+	ImageFormat format;
+	// the quality of JPEG and WebP images, -1 for the quality of the map
+	int quality;
+	// whether WebP images are lossless
+	bool lossless;
+	// whether the images are resized to the half size
+	bool half_size;
+	// the name of the output, it's the directory of its tiles, like webp or png@1x
+	std::string name;
+};
+
+enum class PNGFilter {
+	// let libpng choose the best filter for every row
+	ALL,
+	NONE,
+	SUB,
+	UP,
+	AVERAGE,
+	PAETH
+};
+
+std::ostream& operator<<(std::ostream& out, PNGFilter png_filter);
+
+enum class PNGZlibStrategy {
+	// let libpng choose, that's the filtered strategy if the rows are filtered
+	AUTO,
+	DEFAULT,
+	FILTERED,
+	HUFFMAN,
+	RLE
+};
+
+std::ostream& operator<<(std::ostream& out, PNGZlibStrategy png_zlib_strategy);
+
+enum class PNGPalette {
+	// every indexed PNG has its own palette
+	TILE,
+	// one palette for all indexed PNGs of a map
+	MAP
+};
+
+std::ostream& operator<<(std::ostream& out, PNGPalette png_palette);
+
+enum class JPEGSubsampling {
+	// no chroma subsampling
+	S444,
+	// half the horizontal chroma resolution
+	S422,
+	// half the horizontal and vertical chroma resolution, the default of libjpeg
+	S420
+};
+
+std::ostream& operator<<(std::ostream& out, JPEGSubsampling jpeg_subsampling);
+
+enum class TileStoreType {
+	// every tile in its own file
+	FILES,
+	// the tiles packed into bundle files
+	PACK
+};
+
+std::ostream& operator<<(std::ostream& out, TileStoreType tile_store);
+
 class INIConfigSection;
 
 class MapSection : public ConfigSection {
@@ -106,18 +185,58 @@ public:
 	int getTextureBlur() const;
 	double getWaterOpacity() const;
 	int getTileWidth() const;
+	int getPreviewLevels() const;
+	int getProgressiveLevels() const;
 
 	ImageFormat getImageFormat() const;
 	std::string getImageFormatSuffix() const;
 	bool isPNGIndexed() const;
+	PNGPalette getPNGPalette() const;
+	int getPNGCompressionLevel() const;
+	int getPNGCompositeCompressionLevel() const;
+	PNGFilter getPNGFilter() const;
+	PNGZlibStrategy getPNGZlibStrategy() const;
 	int getJPEGQuality() const;
+	bool useJPEGFastDCT() const;
+	JPEGSubsampling getJPEGSubsampling() const;
+	bool isWebPLossless() const;
+	int getWebPQuality() const;
+	bool useTileDeduplication() const;
+	TileStoreType getTileStore() const;
+	int getTileSyncInterval() const;
+	const std::vector<TileOutput>& getAdditionalOutputs() const;
+	std::string getUploadURL() const;
+	std::string getUploadRegion() const;
+	int getUploadThreads() const;
+	int getUploadRetries() const;
 
 	double getLightingIntensity() const;
 	double getLightingWaterIntensity() const;
 	bool renderUnknownBlocks() const;
 	bool renderLeavesTransparent() const;
 	bool renderBiomes() const;
+	bool renderBlockColors() const;
+	bool renderFrontToBack() const;
+	bool useHeightShading() const;
 	bool useImageModificationTimes() const;
+	bool useChunkHashes() const;
+	bool useTileHashes() const;
+	bool useTileCosts() const;
+	bool cacheBlockImages() const;
+	bool cacheTileThumbnails() const;
+	bool cacheTileGeometry() const;
+	fs::path getTileCacheDir() const;
+	int getPrefetchThreads() const;
+	int getRegionDecodeThreads() const;
+	int getRegionReadAhead() const;
+	int getWriteThreads() const;
+	int getChunkCacheSize() const;
+	int getRotationChunkCacheSize() const;
+	bool unpackChunks() const;
+	int getCompressedChunkCacheSize() const;
+	int getSharedMemoryChunkCacheSize() const;
+	bool renderTilesPartially() const;
+	const std::vector<mc::BlockPos>& getPriorityPoints() const;
 
 	TileSetGroupID getTileSetGroup() const;
 	TileSetID getTileSet(int rotation) const;
@@ -144,16 +263,44 @@ private:
 	std::set<int> rotations_set;
 
 	Field<fs::path> texture_dir;
-	Field<int> texture_size, texture_blur, tile_width;
+	Field<int> texture_size, texture_blur, tile_width, preview_levels, progressive_levels;
 	Field<double> water_opacity;
 
 	Field<ImageFormat> image_format;
     Field<bool> png_indexed;
+	Field<PNGPalette> png_palette;
+	Field<int> png_compression_level, png_composite_compression_level;
+	Field<PNGFilter> png_filter;
+	Field<PNGZlibStrategy> png_zlib_strategy;
 	Field<int> jpeg_quality;
+	Field<bool> jpeg_fast_dct;
+	Field<JPEGSubsampling> jpeg_subsampling;
+	Field<bool> webp_lossless;
+	Field<int> webp_quality;
+	Field<bool> tile_deduplication;
+	Field<TileStoreType> tile_store;
+	// the tiles after which the written tiles are synced to disk, 0 for never and -1
+	// for only once all tiles are written
+	Field<std::string> tile_sync;
+	int tile_sync_interval;
+	Field<std::string> additional_outputs;
+	std::vector<TileOutput> additional_outputs_list;
+	Field<std::string> upload_url, upload_region;
+	Field<int> upload_threads, upload_retries;
 
 	Field<double> lighting_intensity, lighting_water_intensity;
 	Field<bool> cave_high_contrast;
-	Field<bool> render_unknown_blocks, render_leaves_transparent, render_biomes, use_image_mtimes;
+	Field<bool> render_unknown_blocks, render_leaves_transparent, render_biomes, use_image_mtimes,
+		use_chunk_hashes, use_tile_hashes, use_tile_costs, cache_block_images,
+		cache_tile_thumbnails, cache_tile_geometry;
+	Field<fs::path> tile_cache_dir;
+	Field<bool> render_block_colors, height_shading, render_front_to_back;
+	Field<int> prefetch_threads, region_decode_threads, region_read_ahead, write_threads, chunk_cache_size, rotation_chunk_cache_size;
+	Field<bool> unpack_chunks;
+	Field<int> compressed_chunk_cache_size, shared_memory_chunk_cache_size;
+	Field<bool> render_tiles_partially;
+	Field<std::string> priority_points;
+	std::vector<mc::BlockPos> priority_points_list;
 
 	std::set<TileSetID> tile_sets;
 };
@@ -19,6 +19,7 @@
 
 #include "../configsections/world.h"
 #include "../iniconfig.h"
+#include "../../mc/regionstorage.h"
 #include "../../util.h"
 
 #include <sstream>
@@ -70,12 +71,15 @@ std::string WorldSection::getPrettyName() const {
 void WorldSection::dump(std::ostream& out) const {
 	out << getPrettyName() << ":" << std::endl;
 	out << "  input_dir = " << input_dir << std::endl;
+	out << "  remote_cache_dir = " << remote_cache_dir << std::endl;
+	out << "  snapshot_dir = " << snapshot_dir << std::endl;
 	out << "  dimension = " << dimension << std::endl;
 	out << "  world_name = " << world_name << std::endl;
 	out << "  default_view = " << default_view << std::endl;
 	out << "  default_zoom = " << default_zoom << std::endl;
 	out << "  default_rotation = " << default_rotation << std::endl;
 	out << "  sea_level = " << sea_level << std::endl;
+	out << "  collect_signs = " << collect_signs << std::endl;
 	out << "  min_y = " << min_y << std::endl;
 	out << "  max_y = " << max_y << std::endl;
 	out << "  min_x = " << min_x << std::endl;
@@ -101,6 +105,14 @@ fs::path WorldSection::getInputDir() const {
 	return input_dir.getValue();
 }
 
+fs::path WorldSection::getRemoteCacheDir() const {
+	return remote_cache_dir.getValue();
+}
+
+fs::path WorldSection::getSnapshotDir() const {
+	return snapshot_dir.getValue();
+}
+
 mc::Dimension WorldSection::getDimension() const {
 	return dimension.getValue();
 }
@@ -125,6 +137,10 @@ int WorldSection::getSeaLevel() const {
 	return sea_level.getValue();
 }
 
+bool WorldSection::collectSigns() const {
+	return collect_signs.getValue();
+}
+
 bool WorldSection::hasCropUnpopulatedChunks() const {
 	return crop_unpopulated_chunks.getValue();
 }
@@ -152,6 +168,8 @@ void WorldSection::preParse(const INIConfigSection& section,
 	default_zoom.setDefault(0);
 	default_rotation.setDefault(-1);
 	sea_level.setDefault(64);
+	collect_signs.setDefault(false);
+	snapshot_dir.setDefault(fs::path());
 
 	crop_unpopulated_chunks.setDefault(false);
 }
@@ -159,12 +177,20 @@ void WorldSection::preParse(const INIConfigSection& section,
 bool WorldSection::parseField(const std::string key, const std::string value,
 		ValidationList& validation) {
 	if (key == "input_dir") {
-		if (input_dir.load(key, value, validation)) {
+		// a remote world is checked when it's loaded
+		if (input_dir.load(key, value, validation) && !mc::isRemotePath(value)) {
 			input_dir.setValue(BOOST_FS_ABSOLUTE(input_dir.getValue(), config_dir));
 			if (!fs::is_directory(input_dir.getValue()))
 				validation.error("'input_dir' must be an existing directory! '"
 						+ input_dir.getValue().string() + "' does not exist!");
 		}
+	} else if (key == "remote_cache_dir") {
+		if (remote_cache_dir.load(key, value, validation))
+			remote_cache_dir.setValue(BOOST_FS_ABSOLUTE(remote_cache_dir.getValue(),
+					config_dir));
+	} else if (key == "snapshot_dir") {
+		if (snapshot_dir.load(key, value, validation))
+			snapshot_dir.setValue(BOOST_FS_ABSOLUTE(snapshot_dir.getValue(), config_dir));
 	} else if (key == "dimension")
 		dimension.load(key, value, validation);
 	else if (key == "world_name")
@@ -181,7 +207,8 @@ bool WorldSection::parseField(const std::string key, const std::string value,
 		default_rotation.setValue(rotation);
 	} else if (key == "sea_level") {
 		sea_level.load(key,value, validation);
-	}
+	} else if (key == "collect_signs")
+		collect_signs.load(key, value, validation);
 
 	else if (key == "crop_min_y") {
 		if (min_y.load(key, value, validation))
@@ -262,6 +289,7 @@ void WorldSection::postParse(const INIConfigSection& section,
 	// check if required options were specified
 	if (!isGlobal()) {
 		input_dir.require(validation, "You have to specify an input directory ('input_dir')!");
+		remote_cache_dir.setDefault(config_dir / "remote_cache" / getSectionName());
 	}
 }
 
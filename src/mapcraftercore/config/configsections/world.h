@@ -50,6 +50,8 @@ public:
 	std::string getShortName();
 
 	fs::path getInputDir() const;
+	fs::path getRemoteCacheDir() const;
+	fs::path getSnapshotDir() const;
 	mc::Dimension getDimension() const;
 	std::string getWorldName() const;
 
@@ -57,6 +59,7 @@ public:
 	int getDefaultZoom() const;
 	int getDefaultRotation() const;
 	int getSeaLevel() const;
+	bool collectSigns() const;
 
 	bool hasCropUnpopulatedChunks() const;
 	std::string getBlockMask() const;
@@ -75,13 +78,14 @@ protected:
 private:
 	fs::path config_dir;
 
-	Field<fs::path> input_dir;
+	Field<fs::path> input_dir, remote_cache_dir, snapshot_dir;
 	Field<mc::Dimension> dimension;
 	Field<std::string> world_name;
 
 	Field<mc::BlockPos> default_view;
 	Field<int> default_zoom, default_rotation;
 	Field<int> sea_level;
+	Field<bool> collect_signs;
 
 	Field<int> min_y, max_y;
 	Field<int> min_x, max_x, min_z, max_z;
@@ -259,6 +259,17 @@ picojson::value WebConfig::getConfigJSON() const {
 		map_json["renderView"] = picojson::value(util::str(map_it->getRenderView()));
 		map_json["textureSize"] = picojson::value((double) map_it->getTextureSize());
 		map_json["imageFormat"] = picojson::value(map_it->getImageFormatSuffix());
+		map_json["tileStore"] = picojson::value(util::str(map_it->getTileStore()));
+		picojson::array outputs_json;
+		auto outputs = map_it->getAdditionalOutputs();
+		for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+			picojson::object output_json;
+			output_json["name"] = picojson::value(it->name);
+			output_json["imageFormat"] = picojson::value(it->getImageFormatSuffix());
+			output_json["halfSize"] = picojson::value(it->half_size);
+			outputs_json.push_back(picojson::value(output_json));
+		}
+		map_json["outputs"] = picojson::value(outputs_json);
 		if (world.getDefaultView() != mc::BlockPos(0, 0, 0)) {
 			mc::BlockPos default_view = world.getDefaultView();
 			picojson::array default_view_json;
@@ -0,0 +1,417 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blockstate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+
+namespace mapcrafter {
+namespace mc {
+
+const std::string& BlockState::getProperty(const std::string& key) const {
+	static const std::string empty;
+	for (auto it = properties.begin(); it != properties.end(); ++it)
+		if (it->first == key)
+			return it->second;
+	return empty;
+}
+
+namespace {
+
+struct LegacyBlock {
+	const char* name;
+	uint16_t id;
+	uint8_t data;
+};
+
+// the names (without the "minecraft:" namespace) of the block states
+// and their block ID and data value of the old chunk format
+const LegacyBlock LEGACY_BLOCKS[] = {
+	{"air", 0, 0}, {"cave_air", 0, 0}, {"void_air", 0, 0},
+	{"stone", 1, 0}, {"granite", 1, 1}, {"polished_granite", 1, 2}, {"diorite", 1, 3},
+	{"polished_diorite", 1, 4}, {"andesite", 1, 5}, {"polished_andesite", 1, 6},
+	{"grass_block", 2, 0}, {"dirt", 3, 0}, {"coarse_dirt", 3, 1}, {"podzol", 3, 2},
+	{"cobblestone", 4, 0},
+	{"oak_planks", 5, 0}, {"spruce_planks", 5, 1}, {"birch_planks", 5, 2},
+	{"jungle_planks", 5, 3}, {"acacia_planks", 5, 4}, {"dark_oak_planks", 5, 5},
+	{"oak_sapling", 6, 0}, {"spruce_sapling", 6, 1}, {"birch_sapling", 6, 2},
+	{"jungle_sapling", 6, 3}, {"acacia_sapling", 6, 4}, {"dark_oak_sapling", 6, 5},
+	{"bedrock", 7, 0}, {"water", 9, 0}, {"lava", 11, 0},
+	// the underwater plants are rendered as water
+	{"seagrass", 9, 0}, {"tall_seagrass", 9, 0}, {"kelp", 9, 0}, {"kelp_plant", 9, 0},
+	{"bubble_column", 9, 0},
+	{"sand", 12, 0}, {"red_sand", 12, 1}, {"gravel", 13, 0},
+	{"gold_ore", 14, 0}, {"iron_ore", 15, 0}, {"coal_ore", 16, 0},
+	{"oak_log", 17, 0}, {"spruce_log", 17, 1}, {"birch_log", 17, 2}, {"jungle_log", 17, 3},
+	{"oak_wood", 17, 12}, {"spruce_wood", 17, 13}, {"birch_wood", 17, 14},
+	{"jungle_wood", 17, 15},
+	{"oak_leaves", 18, 0}, {"spruce_leaves", 18, 1}, {"birch_leaves", 18, 2},
+	{"jungle_leaves", 18, 3},
+	{"sponge", 19, 0}, {"wet_sponge", 19, 1}, {"glass", 20, 0},
+	{"lapis_ore", 21, 0}, {"lapis_block", 22, 0}, {"dispenser", 23, 0},
+	{"sandstone", 24, 0}, {"chiseled_sandstone", 24, 1}, {"cut_sandstone", 24, 2},
+	{"note_block", 25, 0}, {"powered_rail", 27, 0}, {"detector_rail", 28, 0},
+	{"sticky_piston", 29, 0}, {"cobweb", 30, 0}, {"grass", 31, 1}, {"short_grass", 31, 1},
+	{"fern", 31, 2},
+	{"dead_bush", 32, 0}, {"piston", 33, 0}, {"piston_head", 34, 0},
+	{"dandelion", 37, 0}, {"poppy", 38, 0}, {"blue_orchid", 38, 1}, {"allium", 38, 2},
+	{"azure_bluet", 38, 3}, {"red_tulip", 38, 4}, {"orange_tulip", 38, 5},
+	{"white_tulip", 38, 6}, {"pink_tulip", 38, 7}, {"oxeye_daisy", 38, 8},
+	{"brown_mushroom", 39, 0}, {"red_mushroom", 40, 0},
+	{"gold_block", 41, 0}, {"iron_block", 42, 0},
+	{"smooth_stone", 43, 8}, {"stone_slab", 44, 0}, {"smooth_stone_slab", 44, 0},
+	{"sandstone_slab", 44, 1},
+	{"petrified_oak_slab", 44, 2}, {"cobblestone_slab", 44, 3}, {"brick_slab", 44, 4},
+	{"stone_brick_slab", 44, 5}, {"nether_brick_slab", 44, 6}, {"quartz_slab", 44, 7},
+	{"bricks", 45, 0}, {"tnt", 46, 0}, {"bookshelf", 47, 0},
+	{"mossy_cobblestone", 48, 0}, {"obsidian", 49, 0},
+	{"torch", 50, 5}, {"wall_torch", 50, 0}, {"fire", 51, 0}, {"spawner", 52, 0},
+	{"oak_stairs", 53, 0}, {"chest", 54, 0}, {"redstone_wire", 55, 0},
+	{"diamond_ore", 56, 0}, {"diamond_block", 57, 0}, {"crafting_table", 58, 0},
+	{"wheat", 59, 0}, {"farmland", 60, 0}, {"furnace", 61, 0},
+	{"sign", 63, 0}, {"oak_sign", 63, 0}, {"oak_door", 64, 0}, {"ladder", 65, 0},
+	{"rail", 66, 0}, {"cobblestone_stairs", 67, 0},
+	{"wall_sign", 68, 0}, {"oak_wall_sign", 68, 0}, {"lever", 69, 0},
+	{"stone_pressure_plate", 70, 0}, {"iron_door", 71, 0},
+	{"oak_pressure_plate", 72, 0}, {"redstone_ore", 73, 0},
+	{"redstone_torch", 76, 5}, {"redstone_wall_torch", 76, 0}, {"stone_button", 77, 0},
+	{"snow", 78, 0}, {"ice", 79, 0}, {"snow_block", 80, 0}, {"cactus", 81, 0},
+	{"clay", 82, 0}, {"sugar_cane", 83, 0}, {"jukebox", 84, 0}, {"oak_fence", 85, 0},
+	{"carved_pumpkin", 86, 0}, {"pumpkin", 86, 0}, {"netherrack", 87, 0},
+	{"soul_sand", 88, 0}, {"glowstone", 89, 0}, {"nether_portal", 90, 0},
+	{"jack_o_lantern", 91, 0}, {"cake", 92, 0}, {"repeater", 93, 0},
+	{"oak_trapdoor", 96, 0},
+	{"infested_stone", 97, 0}, {"infested_cobblestone", 97, 1},
+	{"infested_stone_bricks", 97, 2}, {"infested_mossy_stone_bricks", 97, 3},
+	{"infested_cracked_stone_bricks", 97, 4}, {"infested_chiseled_stone_bricks", 97, 5},
+	{"stone_bricks", 98, 0}, {"mossy_stone_bricks", 98, 1},
+	{"cracked_stone_bricks", 98, 2}, {"chiseled_stone_bricks", 98, 3},
+	{"brown_mushroom_block", 99, 14}, {"red_mushroom_block", 100, 14},
+	{"mushroom_stem", 99, 10}, {"iron_bars", 101, 0}, {"glass_pane", 102, 0},
+	{"melon", 103, 0}, {"pumpkin_stem", 104, 0}, {"melon_stem", 105, 0},
+	{"attached_pumpkin_stem", 104, 7}, {"attached_melon_stem", 105, 7},
+	{"vine", 106, 0}, {"oak_fence_gate", 107, 0}, {"brick_stairs", 108, 0},
+	{"stone_brick_stairs", 109, 0}, {"mycelium", 110, 0}, {"lily_pad", 111, 0},
+	{"nether_bricks", 112, 0}, {"nether_brick_fence", 113, 0},
+	{"nether_brick_stairs", 114, 0}, {"nether_wart", 115, 0},
+	{"enchanting_table", 116, 0}, {"brewing_stand", 117, 0}, {"cauldron", 118, 0},
+	{"end_portal", 119, 0}, {"end_portal_frame", 120, 0}, {"end_stone", 121, 0},
+	{"dragon_egg", 122, 0}, {"redstone_lamp", 123, 0},
+	{"oak_slab", 126, 0}, {"spruce_slab", 126, 1}, {"birch_slab", 126, 2},
+	{"jungle_slab", 126, 3}, {"acacia_slab", 126, 4}, {"dark_oak_slab", 126, 5},
+	{"cocoa", 127, 0}, {"sandstone_stairs", 128, 0}, {"emerald_ore", 129, 0},
+	{"ender_chest", 130, 0}, {"tripwire_hook", 131, 0}, {"tripwire", 132, 0},
+	{"emerald_block", 133, 0}, {"spruce_stairs", 134, 0}, {"birch_stairs", 135, 0},
+	{"jungle_stairs", 136, 0}, {"command_block", 137, 0}, {"beacon", 138, 0},
+	{"cobblestone_wall", 139, 0}, {"mossy_cobblestone_wall", 139, 1},
+	{"flower_pot", 140, 0}, {"carrots", 141, 0}, {"potatoes", 142, 0},
+	{"oak_button", 143, 0},
+	{"skeleton_skull", 144, 1}, {"wither_skeleton_skull", 144, 1}, {"zombie_head", 144, 1},
+	{"player_head", 144, 1}, {"creeper_head", 144, 1}, {"dragon_head", 144, 1},
+	{"skeleton_wall_skull", 144, 2}, {"wither_skeleton_wall_skull", 144, 2},
+	{"zombie_wall_head", 144, 2}, {"player_wall_head", 144, 2},
+	{"creeper_wall_head", 144, 2}, {"dragon_wall_head", 144, 2},
+	{"anvil", 145, 0}, {"chipped_anvil", 145, 4}, {"damaged_anvil", 145, 8},
+	{"trapped_chest", 146, 0}, {"light_weighted_pressure_plate", 147, 0},
+	{"heavy_weighted_pressure_plate", 148, 0}, {"comparator", 149, 0},
+	{"daylight_detector", 151, 0}, {"redstone_block", 152, 0},
+	{"nether_quartz_ore", 153, 0}, {"hopper", 154, 0},
+	{"quartz_block", 155, 0}, {"chiseled_quartz_block", 155, 1}, {"quartz_pillar", 155, 2},
+	{"quartz_stairs", 156, 0}, {"activator_rail", 157, 0}, {"dropper", 158, 0},
+	{"acacia_leaves", 161, 0}, {"dark_oak_leaves", 161, 1},
+	{"acacia_log", 162, 0}, {"dark_oak_log", 162, 1},
+	{"acacia_wood", 162, 12}, {"dark_oak_wood", 162, 13},
+	{"acacia_stairs", 163, 0}, {"dark_oak_stairs", 164, 0}, {"slime_block", 165, 0},
+	{"barrier", 166, 0}, {"iron_trapdoor", 167, 0},
+	{"prismarine", 168, 0}, {"prismarine_bricks", 168, 1}, {"dark_prismarine", 168, 2},
+	{"sea_lantern", 169, 0}, {"hay_block", 170, 0}, {"terracotta", 172, 0},
+	{"coal_block", 173, 0}, {"packed_ice", 174, 0},
+	{"sunflower", 175, 0}, {"lilac", 175, 1}, {"tall_grass", 175, 2},
+	{"large_fern", 175, 3}, {"rose_bush", 175, 4}, {"peony", 175, 5},
+	{"red_sandstone", 179, 0}, {"chiseled_red_sandstone", 179, 1},
+	{"cut_red_sandstone", 179, 2}, {"red_sandstone_stairs", 180, 0},
+	{"red_sandstone_slab", 182, 0},
+	{"spruce_fence_gate", 183, 0}, {"birch_fence_gate", 184, 0},
+	{"jungle_fence_gate", 185, 0}, {"dark_oak_fence_gate", 186, 0},
+	{"acacia_fence_gate", 187, 0},
+	{"spruce_fence", 188, 0}, {"birch_fence", 189, 0}, {"jungle_fence", 190, 0},
+	{"dark_oak_fence", 191, 0}, {"acacia_fence", 192, 0},
+	{"spruce_door", 193, 0}, {"birch_door", 194, 0}, {"jungle_door", 195, 0},
+	{"acacia_door", 196, 0}, {"dark_oak_door", 197, 0},
+	{"end_rod", 198, 0}, {"chorus_plant", 199, 0}, {"chorus_flower", 200, 0},
+	{"purpur_block", 201, 0}, {"purpur_pillar", 202, 0}, {"purpur_stairs", 203, 0},
+	{"purpur_slab", 205, 0}, {"end_stone_bricks", 206, 0}, {"beetroots", 207, 0},
+	{"grass_path", 208, 0}, {"dirt_path", 208, 0}, {"end_gateway", 209, 0},
+	{"repeating_command_block", 210, 0}, {"chain_command_block", 211, 0},
+	{"frosted_ice", 212, 0}, {"magma_block", 213, 0}, {"nether_wart_block", 214, 0},
+	{"red_nether_bricks", 215, 0}, {"bone_block", 216, 0}, {"structure_void", 217, 0},
+	{"observer", 218, 0}, {"shulker_box", 229, 0}, {"structure_block", 255, 0},
+};
+
+// the colors of the colored blocks, in the order of their data values
+const char* COLORS[] = {
+	"white", "orange", "magenta", "light_blue", "yellow", "lime", "pink", "gray",
+	"light_gray", "cyan", "purple", "blue", "brown", "green", "red", "black"
+};
+
+// the colored blocks (the name without the color prefix) and their block IDs
+const LegacyBlock COLORED_BLOCKS[] = {
+	{"wool", 35, 0}, {"stained_glass", 95, 0}, {"terracotta", 159, 0},
+	{"stained_glass_pane", 160, 0}, {"carpet", 171, 0}, {"concrete", 251, 0},
+	{"concrete_powder", 252, 0},
+};
+
+typedef std::unordered_map<std::string, std::pair<uint16_t, uint8_t> > LegacyBlockMap;
+
+const LegacyBlockMap& getLegacyBlocks() {
+	static const LegacyBlockMap blocks = []() {
+		LegacyBlockMap blocks;
+		for (size_t i = 0; i < sizeof(LEGACY_BLOCKS) / sizeof(LegacyBlock); i++)
+			blocks[std::string("minecraft:") + LEGACY_BLOCKS[i].name]
+				= std::make_pair(LEGACY_BLOCKS[i].id, LEGACY_BLOCKS[i].data);
+		for (int color = 0; color < 16; color++) {
+			std::string prefix = std::string("minecraft:") + COLORS[color] + "_";
+			for (size_t i = 0; i < sizeof(COLORED_BLOCKS) / sizeof(LegacyBlock); i++)
+				blocks[prefix + COLORED_BLOCKS[i].name]
+					= std::make_pair(COLORED_BLOCKS[i].id, (uint8_t) color);
+			// the color of beds and banners is stored in their tile entities,
+			// the shulker boxes and glazed terracotta have one block ID per color
+			blocks[prefix + "bed"] = std::make_pair(26, 0);
+			blocks[prefix + "banner"] = std::make_pair(176, 0);
+			blocks[prefix + "wall_banner"] = std::make_pair(177, 0);
+			blocks[prefix + "shulker_box"] = std::make_pair(219 + color, 0);
+			blocks[prefix + "glazed_terracotta"] = std::make_pair(235 + color, 0);
+		}
+		return blocks;
+	}();
+	return blocks;
+}
+
+/**
+ * Returns the index of a value in a list of values, or -1 if it's not one of them.
+ */
+int indexOf(const std::string& value, std::initializer_list<const char*> values) {
+	int i = 0;
+	for (auto it = values.begin(); it != values.end(); ++it, i++)
+		if (value == *it)
+			return i;
+	return -1;
+}
+
+/**
+ * Returns the data value of the facing property of a block, the data values of the
+ * facings are in the order north, south, west, east.
+ */
+uint8_t faceData(const BlockState& state, std::initializer_list<uint8_t> values) {
+	int index = indexOf(state.getProperty("facing"), {"north", "south", "west", "east"});
+	return index == -1 ? 0 : *(values.begin() + index);
+}
+
+}
+
+bool lookupBlockState(const BlockState& state, uint16_t& id, uint8_t& data) {
+	const LegacyBlockMap& blocks = getLegacyBlocks();
+	auto it = blocks.find(state.name);
+	if (it == blocks.end()) {
+		id = 0;
+		data = 0;
+		return false;
+	}
+	id = it->second.first;
+	data = it->second.second;
+	if (state.properties.empty())
+		return true;
+
+	bool top = state.getProperty("half") == "top" || state.getProperty("half") == "upper";
+	const std::string& axis = state.getProperty("axis");
+	switch (id) {
+	// the liquids and cauldrons
+	case 9:
+	case 11:
+	case 118:
+		data = std::atoi(state.getProperty("level").c_str()) & 0xf;
+		if (id != 118 && data != 0)
+			id--;
+		break;
+	// logs and pillars
+	case 17:
+	case 162:
+		if (data < 12)
+			data |= axis == "x" ? 4 : (axis == "z" ? 8 : 0);
+		break;
+	case 155:
+		if (data == 2)
+			data = axis == "x" ? 3 : (axis == "z" ? 4 : 2);
+		break;
+	case 170:
+	case 202:
+	case 216:
+		data = axis == "x" ? 4 : (axis == "z" ? 8 : 0);
+		break;
+	// slabs
+	case 44:
+	case 126:
+	case 182:
+	case 205:
+		if (state.getProperty("type") == "double")
+			id--;
+		else if (state.getProperty("type") == "top")
+			data |= 8;
+		break;
+	// stairs
+	case 53: case 67: case 108: case 109: case 114: case 128: case 134: case 135:
+	case 136: case 156: case 163: case 164: case 180: case 203:
+		data = faceData(state, {3, 2, 1, 0}) | (top ? 4 : 0);
+		break;
+	// doors
+	case 64: case 71: case 193: case 194: case 195: case 196: case 197:
+		if (top)
+			data = 8 | (state.getProperty("hinge") == "right" ? 1 : 0);
+		else
+			data = faceData(state, {3, 1, 2, 0})
+				| (state.getProperty("open") == "true" ? 4 : 0);
+		break;
+	case 175:
+		if (top)
+			data = 8;
+		break;
+	// the torches on walls, the standing ones have the data value 5
+	case 50:
+	case 76:
+		if (data == 0)
+			data = faceData(state, {4, 3, 2, 1});
+		if (id == 76 && state.getProperty("lit") == "false")
+			id = 75;
+		break;
+	// blocks facing in four directions
+	case 23: case 54: case 61: case 65: case 68: case 130: case 146: case 158:
+		data = faceData(state, {2, 3, 4, 5});
+		if (id == 23 || id == 158)
+			data = std::max(0, indexOf(state.getProperty("facing"),
+					{"down", "up", "north", "south", "west", "east"}));
+		if (id == 61 && state.getProperty("lit") == "true")
+			id = 62;
+		break;
+	case 86:
+	case 91:
+		data = faceData(state, {2, 0, 1, 3});
+		break;
+	case 26:
+		data = faceData(state, {2, 0, 1, 3}) | (state.getProperty("part") == "head" ? 8 : 0);
+		break;
+	case 63:
+		data = std::atoi(state.getProperty("rotation").c_str()) & 0xf;
+		break;
+	// rails
+	case 27: case 28: case 66: case 157: {
+		int shape = indexOf(state.getProperty("shape"), {"north_south", "east_west",
+			"ascending_east", "ascending_west", "ascending_north", "ascending_south",
+			"south_east", "south_west", "north_west", "north_east"});
+		data = std::max(shape, 0);
+		if (id != 66 && state.getProperty("powered") == "true")
+			data |= 8;
+		break;
+	}
+	// blocks with an age or growth stage
+	case 59: case 104: case 105: case 115: case 141: case 142: case 207:
+		if (data == 0)
+			data = std::atoi(state.getProperty("age").c_str()) & 0x7;
+		break;
+	case 60:
+		data = std::atoi(state.getProperty("moisture").c_str()) & 0x7;
+		break;
+	case 78:
+		data = std::max(std::atoi(state.getProperty("layers").c_str()) - 1, 0) & 0x7;
+		break;
+	case 73:
+	case 123:
+		if (state.getProperty("lit") == "true")
+			id++;
+		break;
+	}
+	return true;
+}
+
+bool unpackBlockStates(const uint8_t* data, int32_t longs, int bits, uint16_t* indices) {
+	if (bits < 1 || bits > 16)
+		return false;
+	// the indices either span the longs or every long has a whole number of indices
+	bool spanning;
+	int per_long = 64 / bits;
+	if (longs == 4096 * bits / 64)
+		spanning = true;
+	else if (longs == (4096 + per_long - 1) / per_long)
+		spanning = false;
+	else
+		return false;
+
+	const uint64_t mask = (1ULL << bits) - 1;
+	auto readLong = [data](int32_t i) {
+		uint64_t value = 0;
+		const uint8_t* bytes = data + 8 * i;
+		for (int j = 0; j < 8; j++)
+			value = (value << 8) | bytes[j];
+		return value;
+	};
+
+	if (!spanning) {
+		int index = 0;
+		for (int32_t i = 0; i < longs; i++) {
+			uint64_t value = readLong(i);
+			for (int j = 0; j < per_long && index < 4096; j++, value >>= bits)
+				indices[index++] = value & mask;
+		}
+		return true;
+	}
+
+	// the bits of the indices which don't fit into the current long anymore are in
+	// the lowest bits of the next long
+	uint64_t value = readLong(0);
+	int available = 64;
+	int32_t next = 1;
+	for (int index = 0; index < 4096; index++) {
+		if (available >= bits) {
+			indices[index] = value & mask;
+			value >>= bits;
+			available -= bits;
+			if (available == 0 && next < longs) {
+				value = readLong(next++);
+				available = 64;
+			}
+		} else {
+			uint64_t following = readLong(next++);
+			indices[index] = (value | (following << available)) & mask;
+			value = following >> (bits - available);
+			available = 64 - (bits - available);
+		}
+	}
+	return true;
+}
+
+int getBlockStateBits(size_t palette_size) {
+	int bits = 4;
+	while (bits < 16 && (1u << bits) < palette_size)
+		bits++;
+	return bits;
+}
+
+}
+}
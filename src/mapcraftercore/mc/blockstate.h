@@ -0,0 +1,71 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCKSTATE_H_
+#define BLOCKSTATE_H_
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mapcrafter {
+namespace mc {
+
+/**
+ * A block state of the section palettes of the chunk format of Minecraft 1.13 and
+ * newer: The namespaced name of the block and its properties.
+ */
+struct BlockState {
+	std::string name;
+	std::vector<std::pair<std::string, std::string> > properties;
+
+	/**
+	 * Returns the value of a property, or an empty string if the block state doesn't
+	 * have it.
+	 */
+	const std::string& getProperty(const std::string& key) const;
+};
+
+/**
+ * Looks up the block ID and block data value (of the old chunk format, which is what the
+ * renderer uses) of a block state. Only the properties which are relevant for the
+ * rendering of the most common blocks are mapped. Returns false if the block is
+ * unknown, it's rendered as air then.
+ */
+bool lookupBlockState(const BlockState& state, uint16_t& id, uint8_t& data);
+
+/**
+ * Unpacks the palette indices of the 4096 blocks of a section from the "BlockStates"
+ * long array (big-endian, like all NBT data) of a section. The indices are bits wide,
+ * they either span two longs (Minecraft < 1.16) or not (Minecraft >= 1.16), which one
+ * is detected from the length of the array. Returns false if the length doesn't fit
+ * either of them.
+ */
+bool unpackBlockStates(const uint8_t* data, int32_t longs, int bits, uint16_t* indices);
+
+/**
+ * Returns the count of bits per palette index of a palette with the specified size.
+ */
+int getBlockStateBits(size_t palette_size);
+
+}
+}
+
+#endif /* BLOCKSTATE_H_ */
@@ -19,19 +19,33 @@
 
 #include "chunk.h"
 
+#include "blockstate.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <iostream>
+#include <set>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace mapcrafter {
 namespace mc {
 
-const uint8_t* ChunkSection::getArray(int i) const {
+uint32_t ChunkSection::getArray(int i) const {
 	if (i == 0)
 		return data;
 	else if (i == 1)
 		return block_light;
-	else
+	else if (i == 2)
 		return sky_light;
+	else if (i == 3)
+		return blocks;
+	else
+		return add;
 }
 
 Chunk::Chunk()
@@ -50,30 +64,319 @@ void Chunk::setWorldCrop(const WorldCrop& world_crop) {
 	this->world_crop = world_crop;
 }
 
-int Chunk::positionToKey(int x, int z, int y) const {
+void rotateBlockPos(int& x, int& z, int rotation) {
+	int nx = x, nz = z;
+	for (int i = 0; i < rotation; i++) {
+		nx = z;
+		nz = 15 - x;
+		x = nx;
+		z = nz;
+	}
+}
+
+namespace {
+
+/**
+ * Checks whether a tag name (not null-terminated) is equal to a specific name.
+ */
+bool isTagName(const char* name, uint16_t len, const char* expected) {
+	return std::strlen(expected) == len && std::memcmp(name, expected, len) == 0;
+}
+
+/**
+ * Reads a block state compound of a section palette (the tag type and name are already
+ * read) and returns its block ID and data value as id << 4 | data.
+ */
+uint16_t readBlockState(nbt::BufferReader& reader) {
+	BlockState state;
+	int8_t type;
+	while ((type = reader.readByte()) != nbt::TagEnd::TAG_TYPE) {
+		uint16_t name_len;
+		const char* name = reader.readString(name_len);
+		if (type == nbt::TagString::TAG_TYPE && isTagName(name, name_len, "Name"))
+			state.name = reader.readStdString();
+		else if (type == nbt::TagCompound::TAG_TYPE
+				&& isTagName(name, name_len, "Properties")) {
+			while ((type = reader.readByte()) != nbt::TagEnd::TAG_TYPE) {
+				std::string key = reader.readStdString();
+				if (type == nbt::TagString::TAG_TYPE)
+					state.properties.push_back(std::make_pair(key, reader.readStdString()));
+				else
+					reader.skipPayload(type);
+			}
+		} else
+			reader.skipPayload(type);
+	}
+
+	uint16_t id;
+	uint8_t data;
+	lookupBlockState(state, id, data);
+	return id << 4 | data;
+}
+
+/**
+ * Checks whether the generation status of a chunk (Minecraft >= 1.13) means that the
+ * trees, ores and other structures are already populated.
+ */
+bool isPopulatedStatus(const std::string& status) {
+	static const char* populated[] = {"decorated", "lighted", "mobs_spawned", "finalized",
+		"fullchunk", "postprocessed", "features", "light", "spawn", "heightmaps", "full"};
+	for (size_t i = 0; i < sizeof(populated) / sizeof(const char*); i++)
+		if (status == populated[i])
+			return true;
+	return false;
+}
+
+/**
+ * Reads the biomes of a chunk from an int array (Minecraft >= 1.13, the tag type and
+ * name are already read). Minecraft >= 1.15 stores them in cells of 4x4x4 blocks, the
+ * biomes of the cells at sea level are used then.
+ */
+bool readIntBiomes(nbt::BufferReader& reader, uint8_t biomes[256]) {
+	int32_t len = reader.readInt();
+	if (len != 256 && len != 1024) {
+		if (len < 0)
+			throw nbt::NBTError("Invalid length of int array!");
+		reader.readBytes(4 * (size_t) len);
+		return false;
+	}
+	int32_t values[1024];
+	for (int32_t i = 0; i < len; i++)
+		values[i] = reader.readInt();
+	for (int i = 0; i < 256; i++) {
+		int x = i % 16, z = i / 16;
+		int32_t biome = len == 256 ? values[i] : values[(16 << 4) | ((z / 4) << 2) | (x / 4)];
+		biomes[i] = biome >= 0 && biome < 256 ? biome : 0;
+	}
+	return true;
+}
+
+/**
+ * Checks whether all bytes of an array have the same value.
+ */
+bool isUniform(const uint8_t* array, size_t len) {
+	for (size_t i = 1; i < len; i++)
+		if (array[i] != array[0])
+			return false;
+	return true;
+}
+
+/**
+ * Maps the columns (z*16+x) of rotated sections to the columns of the original sections.
+ */
+void getRotatedColumns(int rotation, int columns[256]) {
+	for (int i = 0; i < 256; i++) {
+		int x = i % 16, z = i / 16;
+		rotateBlockPos(x, z, rotation);
+		columns[i] = z * 16 + x;
+	}
+}
+
+/**
+ * Copies an array of a section (block IDs or a nibble array with two blocks per byte)
+ * with the columns rotated.
+ */
+void rotateArray(uint8_t* dest, const uint8_t* src, size_t size, const int columns[256]) {
+	if (size == 4096) {
+		for (int j = 0; j < 4096; j++)
+			dest[j] = src[(j & ~0xff) | columns[j & 0xff]];
+	} else {
+		for (int j = 0; j < 4096; j += 2) {
+			int k1 = (j & ~0xff) | columns[j & 0xff];
+			int k2 = (j & ~0xff) | columns[(j + 1) & 0xff];
+			uint8_t low = (src[k1 / 2] >> ((k1 % 2) * 4)) & 0xf;
+			uint8_t high = (src[k2 / 2] >> ((k2 % 2) * 4)) & 0xf;
+			dest[j / 2] = low | (high << 4);
+		}
+	}
+}
+
+/**
+ * Expands a nibble array of a section (two values per byte, the lower nibble first) into
+ * a byte per value.
+ */
+void expandNibbles(uint8_t* dest, const uint8_t* src) {
+#ifdef __SSE2__
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	for (int i = 0; i < 2048; i += 16) {
+		__m128i nibbles = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i low = _mm_and_si128(nibbles, mask);
+		__m128i high = _mm_and_si128(_mm_srli_epi16(nibbles, 4), mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 2 * i),
+				_mm_unpacklo_epi8(low, high));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 2 * i + 16),
+				_mm_unpackhi_epi8(low, high));
+	}
+#else
+	for (int i = 0; i < 2048; i++) {
+		dest[2 * i] = src[i] & 0xf;
+		dest[2 * i + 1] = src[i] >> 4;
+	}
+#endif
+}
+
+/**
+ * Combines the block IDs of a section with its expanded Add values (the high bits).
+ */
+void combineBlockIDs(uint16_t* dest, const uint8_t* blocks, const uint8_t* add) {
+#ifdef __SSE2__
+	for (int i = 0; i < 4096; i += 16) {
+		__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + i));
+		__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_unpacklo_epi8(low, high));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 8),
+				_mm_unpackhi_epi8(low, high));
+	}
+#else
+	for (int i = 0; i < 4096; i++)
+		dest[i] = blocks[i] | (add[i] << 8);
+#endif
+}
+
+// size of the shared bytes of uniform arrays, big enough for the block IDs
+const size_t UNIFORM_ARRAY_SIZE = 16 * 16 * 16;
+
+// the revision of the last cleared chunk, shared by all chunks (also of other threads)
+std::atomic<uint64_t> last_chunk_revision(0);
+
+}
+
+uint16_t Chunk::positionToKey(int x, int z, int y) const {
 	return y + 256 * (x + 16 * z);
 }
 
 bool Chunk::readNBT(const char* data, size_t len, nbt::Compression compression) {
+	util::ProfileScope profile(util::ProfileStage::NBT_DECODE);
 	clear();
 
-	nbt::NBTFile nbt;
-	nbt.readNBT(data, len, compression);
+	// keep the buffer for the decompressed data, chunks have similar sizes
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local nbt::DecompressedBuffer decompressed;
+#else
+	nbt::DecompressedBuffer decompressed;
+#endif
+	{
+		util::ProfileScope profile(util::ProfileStage::INFLATE);
+		nbt::decompress(data, len, decompressed, compression);
+	}
+
+	// walk through the NBT data directly instead of building the whole tag tree,
+	// the root tag is a compound with an empty name containing the "Level" compound
+	nbt::BufferReader reader(decompressed.data(), decompressed.size());
+	std::vector<RawSection> raw_sections;
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local std::vector<uint16_t> palettes;
+	palettes.clear();
+#else
+	std::vector<uint16_t> palettes;
+#endif
+	if (reader.readByte() != nbt::TagCompound::TAG_TYPE)
+		throw nbt::NBTError("First tag is not a tag compound!");
+	reader.skipPayload(nbt::TagString::TAG_TYPE);
+
+	bool found_level = false;
+	int8_t type;
+	while ((type = reader.readByte()) != nbt::TagEnd::TAG_TYPE) {
+		uint16_t name_len;
+		const char* name = reader.readString(name_len);
+		if (type == nbt::TagCompound::TAG_TYPE && !found_level
+				&& isTagName(name, name_len, "Level")) {
+			found_level = true;
+			if (!readLevel(reader, raw_sections, palettes))
+				return false;
+		} else
+			reader.skipPayload(type);
+	}
 
 	// find "level" tag
-	if (!nbt.hasTag<nbt::TagCompound>("Level")) {
+	if (!found_level) {
 		LOG(ERROR) << "Corrupt chunk: No level tag found!";
 		return false;
 	}
-	const nbt::TagCompound& level = nbt.findTag<nbt::TagCompound>("Level");
+	// the sections with palettes are decoded into the arrays of the old format first
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local std::vector<uint8_t> paletted;
+#else
+	std::vector<uint8_t> paletted;
+#endif
+	decodePaletteSections(raw_sections, palettes, paletted);
+	// apply the world crop and block mask to the sections once here,
+	// the raw sections of cropped sections point then into the other buffer
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local std::vector<uint8_t> cropped;
+#else
+	std::vector<uint8_t> cropped;
+#endif
+	cropSections(raw_sections, cropped);
+	// the raw sections point into the decompressed data, so copy them now
+	storeSections(raw_sections);
+	// sort the extra data for the lookups, the first one of a position is used
+	std::stable_sort(extra_data_list.begin(), extra_data_list.end(),
+			[](const std::pair<uint16_t, uint16_t>& a, const std::pair<uint16_t, uint16_t>& b) {
+		return a.first < b.first;
+	});
+	return true;
+}
+
+bool Chunk::readLevel(nbt::BufferReader& reader, std::vector<RawSection>& raw_sections,
+		std::vector<uint16_t>& palettes) {
+	bool found_xpos = false, found_zpos = false;
+	bool found_terrain_populated = false, found_biomes = false;
+	int32_t xpos = 0, zpos = 0;
+
+	raw_sections.reserve(CHUNK_HEIGHT);
+
+	int8_t type;
+	while ((type = reader.readByte()) != nbt::TagEnd::TAG_TYPE) {
+		uint16_t name_len;
+		const char* name = reader.readString(name_len);
+
+		if (type == nbt::TagInt::TAG_TYPE && isTagName(name, name_len, "xPos")) {
+			xpos = reader.readInt();
+			found_xpos = true;
+		} else if (type == nbt::TagInt::TAG_TYPE && isTagName(name, name_len, "zPos")) {
+			zpos = reader.readInt();
+			found_zpos = true;
+		} else if (type == nbt::TagByte::TAG_TYPE
+				&& isTagName(name, name_len, "TerrainPopulated")) {
+			terrain_populated = reader.readByte();
+			found_terrain_populated = true;
+		} else if (type == nbt::TagString::TAG_TYPE && isTagName(name, name_len, "Status")) {
+			// Minecraft >= 1.13 has the generation status of the chunk instead
+			terrain_populated = isPopulatedStatus(reader.readStdString());
+			found_terrain_populated = true;
+		} else if (type == nbt::TagByteArray::TAG_TYPE
+				&& isTagName(name, name_len, "Biomes")) {
+			found_biomes = reader.readByteArray(biomes, 256);
+		} else if (type == nbt::TagIntArray::TAG_TYPE
+				&& isTagName(name, name_len, "Biomes")) {
+			found_biomes = readIntBiomes(reader, biomes);
+		} else if (type == nbt::TagList::TAG_TYPE
+				&& (isTagName(name, name_len, "TileEntities")
+						|| isTagName(name, name_len, "Sections"))) {
+			bool is_sections = name[0] == 'S';
+			int8_t list_type = reader.readByte();
+			int32_t list_len = reader.readInt();
+			for (int32_t i = 0; i < list_len; i++) {
+				// ignore lists which don't contain compounds, can happen sometimes with
+				// the empty chunks of the end
+				if (list_type != nbt::TagCompound::TAG_TYPE)
+					reader.skipPayload(list_type);
+				else if (is_sections)
+					readSection(reader, raw_sections, palettes);
+				else
+					readTileEntity(reader);
+			}
+		} else
+			reader.skipPayload(type);
+	}
 
 	// then find x/z pos of the chunk
-	if (!level.hasTag<nbt::TagInt>("xPos") || !level.hasTag<nbt::TagInt>("zPos")) {
+	if (!found_xpos || !found_zpos) {
 		LOG(ERROR) << "Corrupt chunk: No x/z position found!";
 		return false;
 	}
-	chunkpos_original = ChunkPos(level.findTag<nbt::TagInt>("xPos").payload,
-	                             level.findTag<nbt::TagInt>("zPos").payload);
+	chunkpos_original = ChunkPos(xpos, zpos);
 	chunkpos = chunkpos_original;
 	if (rotation)
 		chunkpos.rotate(rotation);
@@ -82,111 +385,664 @@ bool Chunk::readNBT(const char* data, size_t len, nbt::Compression compression)
 	// check whether this chunk is completely contained within the cropped world
 	chunk_completely_contained = world_crop.isChunkCompletelyContained(chunkpos_original);
 
-	if (level.hasTag<nbt::TagByte>("TerrainPopulated"))
-		terrain_populated = level.findTag<nbt::TagByte>("TerrainPopulated").payload;
-	else
+	if (!found_terrain_populated)
 		LOG(ERROR) << "Corrupt chunk " << chunkpos << ": No terrain populated tag found!";
-
-	if (level.hasArray<nbt::TagByteArray>("Biomes", 256)) {
-		const nbt::TagByteArray& biomes_tag = level.findTag<nbt::TagByteArray>("Biomes");
-		std::copy(biomes_tag.payload.begin(), biomes_tag.payload.end(), biomes);
-	} else
+	if (!found_biomes)
 		LOG(ERROR) << "Corrupt chunk " << chunkpos << ": No biome data found!";
+	return true;
+}
 
-	const nbt::TagList& tile_entities_tag = level.findTag<nbt::TagList>("TileEntities");
-
-	if (tile_entities_tag.tag_type == nbt::TagCompound::TAG_TYPE) {
-		// go through all entities
-		for (auto it = tile_entities_tag.payload.begin(); it != tile_entities_tag.payload.end(); ++it) {
-			const nbt::TagCompound &entity = (*it)->cast<nbt::TagCompound>();
-			std::string id = entity.findTag<nbt::TagString>("id").payload; // Not an integer, e.g. for beds: 'minecraft:bed'
-			mc::BlockPos pos(
-					entity.findTag<nbt::TagInt>("x").payload,
-					entity.findTag<nbt::TagInt>("z").payload,
-					entity.findTag<nbt::TagInt>("y").payload
-			);
-
-			if (id == "minecraft:bed") { // bed, stored as a string here
-				uint16_t color = (uint16_t) entity.findTag<nbt::TagInt>("color").payload;
-				insertExtraData(pos, color);
-			}
+void Chunk::loadRotated(const Chunk& chunk, int rotation) {
+	// the revision must change like when the chunk is loaded
+	uint64_t revision = ++last_chunk_revision;
+	*this = chunk;
+	this->revision = revision;
+	this->rotation = rotation;
+	if (rotation == 0)
+		return;
+	chunkpos = chunkpos_original;
+	chunkpos.rotate(rotation);
+
+	int columns[256];
+	getRotatedColumns(rotation, columns);
+	// the arrays are at different offsets, except the shared uniform arrays
+	std::set<uint32_t> rotated;
+	for (auto it = sections.begin(); it != sections.end(); ++it) {
+		for (int i = 0; i < 5; i++) {
+			uint32_t offset = it->getArray(i);
+			if (rotated.insert(offset).second)
+				rotateArray(&section_data[offset], &chunk.section_data[offset],
+						i == 3 ? 4096 : 2048, columns);
 		}
 	}
+	for (int i = 0; i < 256; i++) {
+		biomes[i] = chunk.biomes[columns[i]];
+		column_heights[i] = chunk.column_heights[columns[i]];
+		column_water_depths[i] = chunk.column_water_depths[columns[i]];
+	}
 
-	// find sections list
-	// ignore it if section list does not exist, can happen sometimes with the empty
-	// chunks of the end
-	if (!level.hasList<nbt::TagCompound>("Sections"))
-		return true;
-	
-	const nbt::TagList& sections_tag = level.findTag<nbt::TagList>("Sections");
-	if (sections_tag.tag_type != nbt::TagCompound::TAG_TYPE)
+	// the keys of the extra data are rotated like the sections
+	for (auto it = extra_data_list.begin(); it != extra_data_list.end(); ++it) {
+		int y = it->first % 256, x = (it->first / 256) % 16, z = it->first / (256 * 16);
+		rotateBlockPos(x, z, 4 - rotation);
+		it->first = positionToKey(x, z, y);
+	}
+	std::stable_sort(extra_data_list.begin(), extra_data_list.end(),
+			[](const std::pair<uint16_t, uint16_t>& a, const std::pair<uint16_t, uint16_t>& b) {
+		return a.first < b.first;
+	});
+
+	// the copied unpacked arrays are still the ones of the original rotation
+	if (chunk.isUnpacked())
+		unpackSections();
+}
+
+bool Chunk::readSnapshot(const uint8_t* data, size_t len, bool transform) {
+	util::ProfileScope profile(util::ProfileStage::NBT_DECODE);
+	clear();
+
+	size_t pos = 0;
+	auto read = [data, len, &pos](void* dest, size_t size) {
+		if (len - pos < size)
+			return false;
+		std::memcpy(dest, data + pos, size);
+		pos += size;
 		return true;
+	};
+
+	int32_t xpos, zpos;
+	uint8_t populated, section_count;
+	if (!read(&xpos, 4) || !read(&zpos, 4) || !read(&populated, 1) || !read(biomes, 256)
+			|| !read(&section_count, 1) || section_count > CHUNK_HEIGHT)
+		return false;
+	terrain_populated = populated;
+	chunkpos_original = ChunkPos(xpos, zpos);
+	chunkpos = chunkpos_original;
+	if (rotation)
+		chunkpos.rotate(rotation);
+	chunk_completely_contained = world_crop.isChunkCompletelyContained(chunkpos_original);
 
-	// go through all sections
-	for (auto it = sections_tag.payload.begin(); it != sections_tag.payload.end(); ++it) {
-		const nbt::TagCompound& section_tag = (*it)->cast<nbt::TagCompound>();
-		
-		// make sure section is valid
-		if (!section_tag.hasTag<nbt::TagByte>("Y")
-				|| !section_tag.hasArray<nbt::TagByteArray>("Blocks", 4096)
-				|| !section_tag.hasArray<nbt::TagByteArray>("Data", 2048)
-				|| !section_tag.hasArray<nbt::TagByteArray>("BlockLight", 2048)
-				|| !section_tag.hasArray<nbt::TagByteArray>("SkyLight", 2048))
+	// the raw sections point into the snapshot data, the uniform arrays into a buffer
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local std::vector<uint8_t> uniform;
+#else
+	std::vector<uint8_t> uniform;
+#endif
+	uniform.resize(section_count * 5 * UNIFORM_ARRAY_SIZE);
+	std::vector<RawSection> raw_sections(section_count);
+	for (int i = 0; i < section_count; i++) {
+		RawSection& section = raw_sections[i];
+		uint8_t y;
+		if (!read(&y, 1) || y >= CHUNK_HEIGHT)
+			return false;
+		section.y = y;
+		section.block_states = nullptr;
+		const uint8_t** arrays[5] = {&section.blocks, &section.add, &section.data,
+				&section.block_light, &section.sky_light};
+		for (int j = 0; j < 5; j++) {
+			size_t size = j == 0 ? 4096 : 2048;
+			uint8_t uniform_array, value;
+			if (!read(&uniform_array, 1))
+				return false;
+			if (uniform_array) {
+				if (!read(&value, 1))
+					return false;
+				uint8_t* array = &uniform[(i * 5 + j) * UNIFORM_ARRAY_SIZE];
+				std::fill(array, array + size, value);
+				*arrays[j] = array;
+			} else {
+				if (len - pos < size)
+					return false;
+				*arrays[j] = data + pos;
+				pos += size;
+			}
+		}
+	}
+
+	uint32_t count;
+	if (!read(&count, 4) || count > (len - pos) / 4)
+		return false;
+	for (uint32_t i = 0; i < count; i++) {
+		uint16_t key = 0, value = 0;
+		read(&key, 2);
+		read(&value, 2);
+		if (transform)
+			insertExtraData(LocalBlockPos((key / 256) % 16, key / 4096, key % 256), value);
+		else
+			extra_data_list.push_back(std::make_pair(key, value));
+	}
+	if (!read(&count, 4))
+		return false;
+	for (uint32_t i = 0; i < count; i++) {
+		int32_t x, z, y;
+		if (!read(&x, 4) || !read(&z, 4) || !read(&y, 4))
+			return false;
+		Sign sign;
+		sign.first = mc::BlockPos(x, z, y);
+		for (int j = 0; j < 4; j++) {
+			uint16_t line_len;
+			if (!read(&line_len, 2) || len - pos < line_len)
+				return false;
+			sign.second[j].assign(reinterpret_cast<const char*>(data + pos), line_len);
+			pos += line_len;
+		}
+		signs.push_back(sign);
+	}
+
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local std::vector<uint8_t> cropped;
+#else
+	std::vector<uint8_t> cropped;
+#endif
+	if (transform)
+		cropSections(raw_sections, cropped);
+	storeSections(raw_sections, transform);
+	std::stable_sort(extra_data_list.begin(), extra_data_list.end(),
+			[](const std::pair<uint16_t, uint16_t>& a, const std::pair<uint16_t, uint16_t>& b) {
+		return a.first < b.first;
+	});
+	return true;
+}
+
+void Chunk::writeSnapshot(std::vector<uint8_t>& data) const {
+	auto write = [&data](const void* src, size_t size) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src);
+		data.insert(data.end(), bytes, bytes + size);
+	};
+
+	data.clear();
+	int32_t xpos = chunkpos_original.x, zpos = chunkpos_original.z;
+	uint8_t populated = terrain_populated, section_count = sections.size();
+	write(&xpos, 4);
+	write(&zpos, 4);
+	write(&populated, 1);
+	write(biomes, 256);
+	write(&section_count, 1);
+	for (auto it = sections.begin(); it != sections.end(); ++it) {
+		write(&it->y, 1);
+		uint32_t arrays[5] = {it->blocks, it->add, it->data, it->block_light, it->sky_light};
+		for (int j = 0; j < 5; j++) {
+			size_t size = j == 0 ? 4096 : 2048;
+			const uint8_t* array = &section_data[arrays[j]];
+			uint8_t uniform_array = isUniform(array, size);
+			write(&uniform_array, 1);
+			write(array, uniform_array ? 1 : size);
+		}
+	}
+
+	uint32_t count = extra_data_list.size();
+	write(&count, 4);
+	for (auto it = extra_data_list.begin(); it != extra_data_list.end(); ++it) {
+		write(&it->first, 2);
+		write(&it->second, 2);
+	}
+	count = signs.size();
+	write(&count, 4);
+	for (auto it = signs.begin(); it != signs.end(); ++it) {
+		int32_t pos[3] = {it->first.x, it->first.z, it->first.y};
+		write(pos, 12);
+		for (int j = 0; j < 4; j++) {
+			uint16_t line_len = std::min<size_t>(it->second[j].size(), 0xffff);
+			write(&line_len, 2);
+			write(it->second[j].data(), line_len);
+		}
+	}
+}
+
+void Chunk::readSection(nbt::BufferReader& reader, std::vector<RawSection>& raw_sections,
+		std::vector<uint16_t>& palettes) {
+	RawSection section = {-1, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, 0, 0};
+
+	int8_t type;
+	while ((type = reader.readByte()) != nbt::TagEnd::TAG_TYPE) {
+		uint16_t name_len;
+		const char* name = reader.readString(name_len);
+
+		if (type == nbt::TagByte::TAG_TYPE && isTagName(name, name_len, "Y"))
+			section.y = reader.readByte();
+		else if (type == nbt::TagList::TAG_TYPE && isTagName(name, name_len, "Palette")) {
+			int8_t list_type = reader.readByte();
+			int32_t list_len = reader.readInt();
+			section.palette_offset = palettes.size();
+			for (int32_t i = 0; i < list_len; i++) {
+				if (list_type != nbt::TagCompound::TAG_TYPE)
+					reader.skipPayload(list_type);
+				else
+					palettes.push_back(readBlockState(reader));
+			}
+			section.palette_size = palettes.size() - section.palette_offset;
+		} else if (type == nbt::TagLongArray::TAG_TYPE
+				&& isTagName(name, name_len, "BlockStates")) {
+			section.block_states_len = reader.readInt();
+			if (section.block_states_len < 0)
+				throw nbt::NBTError("Invalid length of long array!");
+			section.block_states = reader.readBytes(8 * (size_t) section.block_states_len);
+		} else if (type != nbt::TagByteArray::TAG_TYPE)
+			reader.skipPayload(type);
+		else if (isTagName(name, name_len, "Blocks"))
+			section.blocks = reader.readByteArray(4096);
+		else if (isTagName(name, name_len, "Add"))
+			section.add = reader.readByteArray(2048);
+		else if (isTagName(name, name_len, "Data"))
+			section.data = reader.readByteArray(2048);
+		else if (isTagName(name, name_len, "BlockLight"))
+			section.block_light = reader.readByteArray(2048);
+		else if (isTagName(name, name_len, "SkyLight"))
+			section.sky_light = reader.readByteArray(2048);
+		else
+			reader.skipPayload(type);
+	}
+
+	// the sections with a palette don't need the other arrays
+	if (section.y >= 0 && section.y < CHUNK_HEIGHT && section.block_states != nullptr
+			&& section.palette_size > 0) {
+		raw_sections.push_back(section);
+		return;
+	}
+	section.block_states = nullptr;
+
+	// make sure section is valid, the add array is optional
+	if (section.y < 0 || section.y >= CHUNK_HEIGHT || section.blocks == nullptr
+			|| section.data == nullptr || section.block_light == nullptr
+			|| section.sky_light == nullptr)
+		return;
+	raw_sections.push_back(section);
+}
+
+void Chunk::decodePaletteSections(std::vector<RawSection>& raw_sections,
+		const std::vector<uint16_t>& palettes, std::vector<uint8_t>& buffer) const {
+	size_t count = 0;
+	for (auto it = raw_sections.begin(); it != raw_sections.end(); ++it)
+		if (it->block_states != nullptr)
+			count++;
+	if (count == 0)
+		return;
+
+	// the block IDs, add and data arrays of the sections, and the light arrays for
+	// the sections without light: no block light and full sky light
+	const size_t section_size = 4096 + 2 * 2048;
+	buffer.resize(count * section_size + 2 * 2048);
+	uint8_t* no_block_light = &buffer[count * section_size];
+	uint8_t* full_sky_light = no_block_light + 2048;
+	std::fill(no_block_light, no_block_light + 2048, 0);
+	std::fill(full_sky_light, full_sky_light + 2048, 0xff);
+
+	uint16_t indices[4096];
+	size_t i = 0;
+	for (auto it = raw_sections.begin(); it != raw_sections.end(); ++it) {
+		if (it->block_states == nullptr)
 			continue;
-		
-		const nbt::TagByte& y = section_tag.findTag<nbt::TagByte>("Y");
-		if (y.payload >= CHUNK_HEIGHT)
+		RawSection& section = *it;
+		uint8_t* blocks = &buffer[i * section_size];
+		uint8_t* add = blocks + 4096;
+		uint8_t* data = add + 2048;
+		i++;
+		const uint8_t* block_states = section.block_states;
+		section.block_states = nullptr;
+		if (!unpackBlockStates(block_states, section.block_states_len,
+				getBlockStateBits(section.palette_size), indices)) {
+			LOG(ERROR) << "Corrupt chunk " << chunkpos << ": Invalid block states in section "
+					<< section.y << "!";
+			section.blocks = nullptr;
 			continue;
-		const nbt::TagByteArray& blocks = section_tag.findTag<nbt::TagByteArray>("Blocks");
-		const nbt::TagByteArray& data = section_tag.findTag<nbt::TagByteArray>("Data");
+		}
+
+		// the palette entries are looked up once per section, the indices are only
+		// used to copy them
+		const uint16_t* palette = &palettes[section.palette_offset];
+		uint16_t palette_size = section.palette_size;
+		uint16_t ids = 0;
+		std::fill(add, data + 2048, 0);
+		for (int j = 0; j < 4096; j++) {
+			uint16_t block = indices[j] < palette_size ? palette[indices[j]] : 0;
+			blocks[j] = (block >> 4) & 0xff;
+			data[j / 2] |= (block & 0xf) << ((j % 2) * 4);
+			add[j / 2] |= (block >> 12) << ((j % 2) * 4);
+			ids |= block;
+		}
+
+		section.blocks = blocks;
+		// the add array is usually not needed at all
+		section.add = (ids >> 12) ? add : nullptr;
+		section.data = data;
+		if (section.block_light == nullptr)
+			section.block_light = no_block_light;
+		if (section.sky_light == nullptr)
+			section.sky_light = full_sky_light;
+	}
+
+	// remove the broken sections
+	raw_sections.erase(std::remove_if(raw_sections.begin(), raw_sections.end(),
+			[](const RawSection& section) { return section.blocks == nullptr; }),
+			raw_sections.end());
+}
 
-		const nbt::TagByteArray& block_light = section_tag.findTag<nbt::TagByteArray>("BlockLight");
-		const nbt::TagByteArray& sky_light = section_tag.findTag<nbt::TagByteArray>("SkyLight");
+void Chunk::cropSections(std::vector<RawSection>& raw_sections,
+		std::vector<uint8_t>& buffer) const {
+	bool crop_all = !terrain_populated && world_crop.hasCropUnpopulatedChunks();
+	const BlockMask* mask = world_crop.hasBlockMask() ? world_crop.getBlockMask() : nullptr;
 
-		// create a ChunkSection-object
+	// find the sections with blocks which are not rendered
+	std::vector<RawSection*> crop;
+	for (auto it = raw_sections.begin(); it != raw_sections.end(); ++it) {
+		if (crop_all || mask != nullptr || !chunk_completely_contained
+				|| !world_crop.isBlockContainedY(BlockPos(0, 0, it->y * 16))
+				|| !world_crop.isBlockContainedY(BlockPos(0, 0, it->y * 16 + 15)))
+			crop.push_back(&(*it));
+	}
+	if (crop.empty())
+		return;
+
+	// copy the arrays of these sections and make the hidden blocks air,
+	// with block data and block light 0 and sky light 15
+	const size_t section_size = 4096 + 4 * 2048;
+	buffer.resize(crop.size() * section_size);
+	auto setNibble = [](uint8_t* array, int i, uint8_t value) {
+		if (i % 2 == 0)
+			array[i / 2] = (array[i / 2] & 0xf0) | value;
+		else
+			array[i / 2] = (array[i / 2] & 0x0f) | (value << 4);
+	};
+	for (size_t i = 0; i < crop.size(); i++) {
+		RawSection& section = *crop[i];
+		uint8_t* blocks = &buffer[i * section_size];
+		uint8_t* add = blocks + 4096;
+		uint8_t* data = add + 2048;
+		uint8_t* block_light = data + 2048;
+		uint8_t* sky_light = block_light + 2048;
+		std::memcpy(blocks, section.blocks, 4096);
+		if (section.add != nullptr)
+			std::memcpy(add, section.add, 2048);
+		else
+			std::fill(add, add + 2048, 0);
+		std::memcpy(data, section.data, 2048);
+		std::memcpy(block_light, section.block_light, 2048);
+		std::memcpy(sky_light, section.sky_light, 2048);
+
+		for (int j = 0; j < 4096; j++) {
+			bool hidden = crop_all
+					|| !checkBlockWorldCrop(j % 16, (j / 16) % 16, section.y * 16 + j / 256);
+			if (!hidden && mask != nullptr) {
+				uint16_t id = blocks[j] + (((add[j / 2] >> ((j % 2) * 4)) & 0xf) << 8);
+				BlockMask::BlockState block_state = mask->getBlockState(id);
+				if (block_state == BlockMask::BlockState::COMPLETELY_HIDDEN)
+					hidden = true;
+				else if (block_state != BlockMask::BlockState::COMPLETELY_SHOWN)
+					hidden = mask->isHidden(id, (data[j / 2] >> ((j % 2) * 4)) & 0xf);
+			}
+			if (hidden) {
+				blocks[j] = 0;
+				setNibble(add, j, 0);
+				setNibble(data, j, 0);
+				setNibble(block_light, j, 0);
+				setNibble(sky_light, j, 15);
+			}
+		}
+
+		section.blocks = blocks;
+		section.add = add;
+		section.data = data;
+		section.block_light = block_light;
+		section.sky_light = sky_light;
+	}
+}
+
+void Chunk::storeSections(const std::vector<RawSection>& raw_sections, bool rotate) {
+	// offsets of the shared bytes of the uniform arrays, for every value
+	int64_t uniform_offsets[256];
+	std::fill(&uniform_offsets[0], &uniform_offsets[256], -1);
+	// the sections are stored rotated
+	int rotation = rotate ? this->rotation : 0;
+	int columns[256];
+	getRotatedColumns(rotation, columns);
+	// the arrays which need to be copied: (offset, array, size)
+	struct Copy {
+		uint32_t offset;
+		const uint8_t* array;
+		size_t size;
+	};
+	std::vector<Copy> copies;
+	copies.reserve(raw_sections.size() * 5);
+	uint32_t size = 0;
+
+	// get the offsets of the arrays first to allocate the buffer only once
+	auto allocate = [&](const uint8_t* array, size_t array_size, uint8_t& uniform_value) {
+		// a missing array (only Add) has only zeros
+		if (array == nullptr || isUniform(array, array_size)) {
+			uniform_value = array == nullptr ? 0 : array[0];
+			if (uniform_offsets[uniform_value] == -1) {
+				uniform_offsets[uniform_value] = size;
+				size += UNIFORM_ARRAY_SIZE;
+			}
+			return (uint32_t) uniform_offsets[uniform_value];
+		}
+		Copy copy = {size, array, array_size};
+		copies.push_back(copy);
+		size += array_size;
+		return copy.offset;
+	};
+
+	sections.reserve(raw_sections.size());
+	for (auto it = raw_sections.begin(); it != raw_sections.end(); ++it) {
+		// the uniform values of blocks and add, or 1 if the array is not uniform
+		uint8_t blocks_value = 1, add_value = 1, unused;
 		ChunkSection section;
-		section.y = y.payload;
-		std::copy(blocks.payload.begin(), blocks.payload.end(), section.blocks);
-		if (!section_tag.hasArray<nbt::TagByteArray>("Add", 2048))
-			std::fill(&section.add[0], &section.add[2048], 0);
-		else {
-			const nbt::TagByteArray& add = section_tag.findTag<nbt::TagByteArray>("Add");
-			std::copy(add.payload.begin(), add.payload.end(), section.add);
+		section.y = it->y;
+		section.blocks = allocate(it->blocks, 4096, blocks_value);
+		section.add = allocate(it->add, 2048, add_value);
+		section.data = allocate(it->data, 2048, unused);
+		section.block_light = allocate(it->block_light, 2048, unused);
+		section.sky_light = allocate(it->sky_light, 2048, unused);
+		section.air = blocks_value == 0 && add_value == 0;
+		// if a section appears twice, the last one is used
+		if (section_offsets[section.y] != -1) {
+			sections[section_offsets[section.y]] = section;
+		} else {
+			section_offsets[section.y] = sections.size();
+			sections.push_back(section);
 		}
-		std::copy(data.payload.begin(), data.payload.end(), section.data);
-		std::copy(block_light.payload.begin(), block_light.payload.end(), section.block_light);
-		std::copy(sky_light.payload.begin(), sky_light.payload.end(), section.sky_light);
+	}
 
-		// add this section to the section list
-		section_offsets[section.y] = sections.size();
-		sections.push_back(section);
+	// don't keep a much bigger buffer of a previously loaded chunk
+	if (section_data.capacity() > 2 * size)
+		decltype(section_data)().swap(section_data);
+	section_data.resize(size);
+	for (size_t i = 0; i < copies.size(); i++) {
+		uint8_t* dest = &section_data[copies[i].offset];
+		const uint8_t* src = copies[i].array;
+		if (rotation == 0)
+			std::memcpy(dest, src, copies[i].size);
+		else
+			rotateArray(dest, src, copies[i].size, columns);
 	}
+	for (int i = 0; i < 256; i++)
+		if (uniform_offsets[i] != -1)
+			std::fill(&section_data[uniform_offsets[i]],
+					&section_data[uniform_offsets[i] + UNIFORM_ARRAY_SIZE], i);
 
-	return true;
+	if (rotation) {
+		uint8_t original_biomes[256];
+		std::copy(&biomes[0], &biomes[256], &original_biomes[0]);
+		for (int i = 0; i < 256; i++)
+			biomes[i] = original_biomes[columns[i]];
+	}
+	calculateHeights();
+}
+
+void Chunk::calculateHeights() {
+	highest_block = -1;
+	std::fill(&column_heights[0], &column_heights[256], -1);
+	int remaining = 256;
+	for (int s = CHUNK_HEIGHT - 1; s >= 0 && remaining > 0; s--) {
+		if (section_offsets[s] == -1 || sections[section_offsets[s]].air)
+			continue;
+		const ChunkSection& section = sections[section_offsets[s]];
+		const uint8_t* blocks = &section_data[section.blocks];
+		const uint8_t* add = &section_data[section.add];
+		for (int i = 0; i < 256; i++) {
+			if (column_heights[i] != -1)
+				continue;
+			// i is z*16+x, the same as the offset of the block in a layer of the section
+			for (int y = 15; y >= 0; y--) {
+				int offset = y * 256 + i;
+				if (blocks[offset] != 0 || (add[offset / 2] >> ((offset % 2) * 4)) & 0xf) {
+					column_heights[i] = s * 16 + y;
+					highest_block = std::max(highest_block, s * 16 + y);
+					remaining--;
+					break;
+				}
+			}
+		}
+	}
+
+	// the water at the surface of oceans and lakes, the renderers draw a preblit water
+	// block for deep water instead of the single water blocks
+	std::fill(&column_water_depths[0], &column_water_depths[256], 0);
+	for (int i = 0; i < 256; i++) {
+		LocalBlockPos pos(i % 16, i / 16, column_heights[i]);
+		for (; pos.y >= 0; pos.y--) {
+			uint16_t id = getBlockID(pos);
+			if ((id != 8 && id != 9) || getBlockData(pos) != 0)
+				break;
+			column_water_depths[i]++;
+		}
+	}
+}
+
+void Chunk::readTileEntity(nbt::BufferReader& reader) {
+	std::string id; // Not an integer, e.g. for beds: 'minecraft:bed'
+	int32_t x = 0, y = 0, z = 0, color = 0;
+	int found_pos = 0;
+	bool found_color = false;
+	std::array<std::string, 4> lines;
+
+	int8_t type;
+	while ((type = reader.readByte()) != nbt::TagEnd::TAG_TYPE) {
+		uint16_t name_len;
+		const char* name = reader.readString(name_len);
+
+		if (type == nbt::TagString::TAG_TYPE && isTagName(name, name_len, "id")) {
+			id = reader.readStdString();
+		} else if (type == nbt::TagString::TAG_TYPE && name_len == 5
+				&& std::equal(name, name + 4, "Text") && name[4] >= '1' && name[4] <= '4') {
+			lines[name[4] - '1'] = reader.readStdString();
+		} else if (type != nbt::TagInt::TAG_TYPE) {
+			reader.skipPayload(type);
+		} else if (isTagName(name, name_len, "x")) {
+			x = reader.readInt();
+			found_pos++;
+		} else if (isTagName(name, name_len, "y")) {
+			y = reader.readInt();
+			found_pos++;
+		} else if (isTagName(name, name_len, "z")) {
+			z = reader.readInt();
+			found_pos++;
+		} else if (isTagName(name, name_len, "color")) {
+			color = reader.readInt();
+			found_color = true;
+		} else {
+			reader.skipPayload(type);
+		}
+	}
+
+	if (id == "minecraft:bed" && found_pos == 3 && found_color) { // bed, stored as a string here
+		insertExtraData(mc::BlockPos(x, z, y), (uint16_t) color);
+	} else if ((id == "Sign" || id == "minecraft:sign") && found_pos == 3) {
+		signs.push_back(std::make_pair(mc::BlockPos(x, z, y), lines));
+	}
 }
 
 void Chunk::clear() {
 	sections.clear();
+	section_data.clear();
+	unpacked_ids.clear();
+	unpacked_data.clear();
+	extra_data_list.clear();
+	signs.clear();
 	for (int i = 0; i < CHUNK_HEIGHT; i++)
 		section_offsets[i] = -1;
+	std::fill(&column_heights[0], &column_heights[256], -1);
+	std::fill(&column_water_depths[0], &column_water_depths[256], 0);
+	highest_block = -1;
+	revision = ++last_chunk_revision;
+}
+
+void Chunk::unpackSections() {
+	unpacked_ids.resize(sections.size() * 4096);
+	unpacked_data.resize(sections.size() * 3 * 4096);
+	uint8_t add[4096];
+	for (size_t i = 0; i < sections.size(); i++) {
+		const ChunkSection& section = sections[i];
+		expandNibbles(add, &section_data[section.add]);
+		combineBlockIDs(&unpacked_ids[i * 4096], &section_data[section.blocks], add);
+		for (int array = 0; array < 3; array++)
+			expandNibbles(&unpacked_data[(i * 3 + array) * 4096],
+					&section_data[section.getArray(array)]);
+	}
+}
+
+bool Chunk::isUnpacked() const {
+	return !sections.empty() && !unpacked_ids.empty();
 }
 
 bool Chunk::hasSection(int section) const {
 	return section < CHUNK_HEIGHT && section_offsets[section] != -1;
 }
 
-void rotateBlockPos(int& x, int& z, int rotation) {
-	int nx = x, nz = z;
-	for (int i = 0; i < rotation; i++) {
-		nx = z;
-		nz = 15 - x;
-		x = nx;
-		z = nz;
+bool Chunk::isSectionAir(int section) const {
+	return hasSection(section) && sections[section_offsets[section]].air;
+}
+
+uint64_t Chunk::getContentHash() const {
+	// FNV-1a like hash, but over 64-bit words instead of single bytes
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	auto hashBytes = [&hash, prime](const uint8_t* data, size_t len) {
+		for (size_t i = 0; i + 8 <= len; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, 8);
+			hash = (hash ^ word) * prime;
+		}
+		for (size_t i = len - len % 8; i < len; i++)
+			hash = (hash ^ data[i]) * prime;
+	};
+
+	for (int y = 0; y < CHUNK_HEIGHT; y++) {
+		if (section_offsets[y] == -1)
+			continue;
+		const ChunkSection& section = sections[section_offsets[y]];
+		hash = (hash ^ (uint64_t) (y + 1)) * prime;
+		hashBytes(&section_data[section.blocks], 4096);
+		hashBytes(&section_data[section.add], 2048);
+		hashBytes(&section_data[section.data], 2048);
+		hashBytes(&section_data[section.block_light], 2048);
+		hashBytes(&section_data[section.sky_light], 2048);
 	}
+	hashBytes(biomes, 256);
+	for (auto it = extra_data_list.begin(); it != extra_data_list.end(); ++it)
+		hash = (hash ^ (((uint64_t) it->first << 16) | it->second)) * prime;
+	return hash;
+}
+
+uint64_t Chunk::getRevision() const {
+	return revision;
+}
+
+size_t Chunk::getMemoryUsage() const {
+	return sizeof(Chunk) + sections.capacity() * sizeof(ChunkSection)
+			+ section_data.capacity() + unpacked_ids.capacity() * sizeof(uint16_t)
+			+ unpacked_data.capacity()
+			+ extra_data_list.capacity() * sizeof(std::pair<uint16_t, uint16_t>)
+			+ signs.capacity() * sizeof(Sign);
 }
 
-uint16_t Chunk::getBlockID(const LocalBlockPos& pos, bool force) const {
+const uint8_t* Chunk::getSectionArray(int section, int array) const {
+	if (!hasSection(section))
+		return nullptr;
+	return &section_data[sections[section_offsets[section]].getArray(array)];
+}
+
+uint16_t Chunk::getBlockID(const LocalBlockPos& pos) const {
 	// at first find out the section and check if it's valid and contained
 	int section = pos.y / 16;
 	if (section >= CHUNK_HEIGHT || section_offsets[section] == -1)
@@ -196,36 +1052,22 @@ uint16_t Chunk::getBlockID(const LocalBlockPos& pos, bool force) const {
 	//	return 0;
 	//}
 
-	// if rotated: rotate position to position with original rotation
+	// the sections are already rotated and cropped
 	int x = pos.x;
 	int z = pos.z;
-	if (rotation)
-		rotateBlockPos(x, z, rotation);
-
-	// check whether this block is really rendered
-	if (!checkBlockWorldCrop(x, z, pos.y))
-		return 0;
 
 	// calculate the offset and get the block ID
 	// and don't forget the add data
 	int offset = ((pos.y % 16) * 16 + z) * 16 + x;
+	if (!unpacked_ids.empty())
+		return unpacked_ids[section_offsets[section] * 4096 + offset];
+	const ChunkSection& chunk_section = sections[section_offsets[section]];
 	uint16_t add = 0;
 	if ((offset % 2) == 0)
-		add = sections[section_offsets[section]].add[offset / 2] & 0xf;
+		add = section_data[chunk_section.add + offset / 2] & 0xf;
 	else
-		add = (sections[section_offsets[section]].add[offset / 2] >> 4) & 0x0f;
-	uint16_t id = sections[section_offsets[section]].blocks[offset] + (add << 8);
-	if (!force && world_crop.hasBlockMask()) {
-		const BlockMask* mask = world_crop.getBlockMask();
-		BlockMask::BlockState block_state = mask->getBlockState(id);
-		if (block_state == BlockMask::BlockState::COMPLETELY_HIDDEN)
-			return 0;
-		else if (block_state == BlockMask::BlockState::COMPLETELY_SHOWN)
-			return id;
-		if (mask->isHidden(id, getBlockData(pos, true)))
-			return 0;
-	}
-	return id;
+		add = (section_data[chunk_section.add + offset / 2] >> 4) & 0x0f;
+	return section_data[chunk_section.blocks + offset] + (add << 8);
 }
 
 bool Chunk::checkBlockWorldCrop(int x, int z, int y) const {
@@ -233,47 +1075,40 @@ bool Chunk::checkBlockWorldCrop(int x, int z, int y) const {
 	if (!terrain_populated && world_crop.hasCropUnpopulatedChunks())
 		return false;
 	// now about the actual world cropping:
-	// get the global position of the block, with the original world rotation
-	BlockPos global_pos = LocalBlockPos(x, z, y).toGlobalPos(chunkpos_original);
 	// check whether the block is contained in the y-bounds.
-	if (!world_crop.isBlockContainedY(global_pos))
+	if (!world_crop.isBlockContainedY(BlockPos(0, 0, y)))
 		return false;
 	// only check x/z-bounds if the chunk is not completely contained
-	if (!chunk_completely_contained && !world_crop.isBlockContainedXZ(global_pos))
-		return false;
+	if (!chunk_completely_contained) {
+		BlockPos global_pos = LocalBlockPos(x, z, y).toGlobalPos(chunkpos_original);
+		if (!world_crop.isBlockContainedXZ(global_pos))
+			return false;
+	}
 	return true;
 }
 
-uint8_t Chunk::getData(const LocalBlockPos& pos, int array, bool force) const {
+uint8_t Chunk::getData(const LocalBlockPos& pos, int array) const {
 	// at first find out the section and check if it's valid and contained
 	int section = pos.y / 16;
 	if (section >= CHUNK_HEIGHT || section_offsets[section] == -1)
 		// not existing sections should always have skylight
 		return array == 2 ? 15 : 0;
 
-	// if rotated: rotate position to position with original rotation
+	// the sections are already rotated and cropped
 	int x = pos.x;
 	int z = pos.z;
-	if (rotation)
-		rotateBlockPos(x, z, rotation);
-
-	// check whether this block is really rendered
-	if (!checkBlockWorldCrop(x, z, pos.y))
-		return array == 2 ? 15 : 0;
 
 	uint8_t data = 0;
 	// calculate the offset and get the block data
 	int offset = ((pos.y % 16) * 16 + z) * 16 + x;
+	if (!unpacked_data.empty())
+		return unpacked_data[(section_offsets[section] * 3 + array) * 4096 + offset];
 	// handle bottom/top nibble
+	uint32_t array_offset = sections[section_offsets[section]].getArray(array);
 	if ((offset % 2) == 0)
-		data = sections[section_offsets[section]].getArray(array)[offset / 2] & 0xf;
+		data = section_data[array_offset + offset / 2] & 0xf;
 	else
-		data = (sections[section_offsets[section]].getArray(array)[offset / 2] >> 4) & 0x0f;
-	if (!force && world_crop.hasBlockMask()) {
-		const BlockMask* mask = world_crop.getBlockMask();
-		if (mask->isHidden(getBlockID(pos, true), data))
-			return array == 2 ? 15 : 0;
-	}
+		data = (section_data[array_offset + offset / 2] >> 4) & 0x0f;
 	return data;
 }
 
@@ -285,8 +1120,8 @@ uint16_t Chunk::getBlockExtraData(const LocalBlockPos& pos, uint16_t id) const {
 	return 0;
 }
 
-uint8_t Chunk::getBlockData(const LocalBlockPos& pos, bool force) const {
-	return getData(pos, 0, force);
+uint8_t Chunk::getBlockData(const LocalBlockPos& pos) const {
+	return getData(pos, 0);
 }
 
 uint8_t Chunk::getBlockLight(const LocalBlockPos& pos) const {
@@ -298,33 +1133,49 @@ uint8_t Chunk::getSkyLight(const LocalBlockPos& pos) const {
 }
 
 uint8_t Chunk::getBiomeAt(const LocalBlockPos& pos) const {
-	int x = pos.x;
-	int z = pos.z;
-	if (rotation)
-		rotateBlockPos(x, z, rotation);
+	return biomes[pos.z * 16 + pos.x];
+}
+
+int Chunk::getHighestBlock(const LocalBlockPos& pos) const {
+	return column_heights[pos.z * 16 + pos.x];
+}
 
-	return biomes[z * 16 + x];
+int Chunk::getHighestBlock() const {
+	return highest_block;
+}
+
+int Chunk::getWaterDepth(const LocalBlockPos& pos) const {
+	return column_water_depths[pos.z * 16 + pos.x];
 }
 
 const ChunkPos& Chunk::getPos() const {
 	return chunkpos;
 }
 
-void Chunk::insertExtraData(const LocalBlockPos &pos, uint16_t extra_data) {
-	int key = positionToKey(pos.x, pos.z, pos.y);
-	std::pair<int,uint16_t> pair (key, extra_data);
-	extra_data_map.insert(pair);
+const std::vector<Chunk::Sign>& Chunk::getSigns() const {
+	return signs;
 }
 
-uint16_t Chunk::getExtraData(const LocalBlockPos &pos, uint16_t default_value) const {
+void Chunk::insertExtraData(const LocalBlockPos &pos, uint16_t extra_data) {
+	// the keys are rotated like the sections
 	int x = pos.x;
 	int z = pos.z;
 	if (rotation)
-		rotateBlockPos(x, z, rotation);
-	int key = positionToKey(x, z, pos.y);
+		rotateBlockPos(x, z, 4 - rotation);
+	extra_data_list.push_back(std::make_pair(positionToKey(x, z, pos.y), extra_data));
+}
+
+uint16_t Chunk::getExtraData(const LocalBlockPos &pos, uint16_t default_value) const {
+	if (extra_data_list.empty())
+		return default_value;
 
-	auto result = extra_data_map.find(key);
-	if (result == extra_data_map.end()) {
+	uint16_t key = positionToKey(pos.x, pos.z, pos.y);
+	auto result = std::lower_bound(extra_data_list.begin(), extra_data_list.end(),
+			std::make_pair(key, (uint16_t) 0),
+			[](const std::pair<uint16_t, uint16_t>& a, const std::pair<uint16_t, uint16_t>& b) {
+		return a.first < b.first;
+	});
+	if (result == extra_data_list.end() || result->first != key) {
 		// Not found, possibly from an old world
 		// Default value is 14 = red
 		return default_value;
@@ -23,9 +23,13 @@
 #include "nbt.h"
 #include "pos.h"
 #include "worldcrop.h"
+#include "../util/memory.h"
 
+#include <array>
 #include <stdint.h>
-#include <unordered_map>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace mapcrafter {
 namespace mc {
@@ -35,19 +39,26 @@ const int CHUNK_HEIGHT = 16;
 
 /**
  * A 16x16x16 section of a chunk.
+ *
+ * The arrays with the block data of all sections of a chunk are stored in one buffer of
+ * the chunk, a section has only the offsets of its arrays in this buffer. Arrays with
+ * only one value (for example the Add array, which is usually not stored at all, or
+ * most arrays of air and stone sections) are not stored for every section, uniform
+ * arrays with the same value share the same bytes of the buffer.
  */
 struct ChunkSection {
 	uint8_t y;
-	uint8_t blocks[16 * 16 * 16];
-	uint8_t add[16 * 16 * 8];
-	uint8_t data[16 * 16 * 8];
-	uint8_t block_light[16 * 16 * 8];
-	uint8_t sky_light[16 * 16 * 8];
+	// whether the section contains only air blocks
+	bool air;
+	// offsets of the block IDs (4096 bytes) and the add, block data, block light and
+	// sky light nibbles (2048 bytes each) in the section buffer of the chunk
+	uint32_t blocks, add, data, block_light, sky_light;
 
 	/**
-	 * Returns one of the data arrays (1: block data, 2: block light, 3: sky light).
+	 * Returns the offset of one of the data arrays (0: block data, 1: block light,
+	 * 2: sky light, 3: block IDs, 4: add nibbles).
 	 */
-	const uint8_t* getArray(int i) const;
+	uint32_t getArray(int i) const;
 };
 
 /**
@@ -55,9 +66,16 @@ struct ChunkSection {
  * data such as block IDs, block data values and block lighting data.
  *
  * To save memory, the class stores only the sections which exist in the NBT data.
+ * The sections are stored already rotated and with the blocks hidden by the world crop
+ * or block mask replaced by air, so a block lookup is only an array access.
  */
 class Chunk {
 public:
+	/**
+	 * The position (original, unrotated) and the unparsed lines of a sign.
+	 */
+	typedef std::pair<mc::BlockPos, std::array<std::string, 4> > Sign;
+
 	Chunk();
 	~Chunk();
 
@@ -78,25 +96,113 @@ public:
 	bool readNBT(const char* data, size_t len,
 			nbt::Compression compression = nbt::Compression::ZLIB);
 
+	/**
+	 * Loads the data of an already loaded chunk with rotation 0 rotated by the specified
+	 * rotation. This is the same as reading the NBT data of the chunk with that rotation,
+	 * but the chunk data doesn't need to be read and decoded again.
+	 */
+	void loadRotated(const Chunk& chunk, int rotation);
+
+	/**
+	 * Reads the chunk from its render snapshot (see writeSnapshot and RegionSnapshot).
+	 * The rotation and world crop are applied like when reading the NBT data, so the
+	 * loaded chunk is the same. If transform is not set, the data was written from a
+	 * chunk with the rotation and world crop of this chunk and is loaded as it is (like
+	 * from the compressed chunk cache). Returns false if the data is invalid.
+	 */
+	bool readSnapshot(const uint8_t* data, size_t len, bool transform = true);
+
+	/**
+	 * Writes the loaded data of the chunk in the render snapshot format: the already
+	 * decoded sections (uniform arrays with only their value), the biomes, extra data
+	 * and signs. For render snapshots, the chunk must be loaded without rotation and
+	 * world crop.
+	 */
+	void writeSnapshot(std::vector<uint8_t>& data) const;
+
 	/**
 	 * Clears all loaded chunk data.
 	 */
 	void clear();
 
+	/**
+	 * Unpacks the arrays of the loaded sections into 16-bit block IDs and a byte per
+	 * block for the block data, block light and sky light, so looking up a block is a
+	 * single load instead of combining the block ID with the Add nibbles and extracting
+	 * the nibbles. The unpacked arrays need about twice the memory of the sections.
+	 * Loading the chunk again (or clearing it) discards them, a rotated copy of an
+	 * unpacked chunk (see loadRotated) is unpacked too.
+	 */
+	void unpackSections();
+
+	/**
+	 * Returns whether the sections are unpacked.
+	 */
+	bool isUnpacked() const;
+
 	/**
 	 * Returns whether the chunk has a specific section.
 	 */
 	bool hasSection(int section) const;
 
+	/**
+	 * Returns whether the chunk has a specific section, which contains only air blocks.
+	 */
+	bool isSectionAir(int section) const;
+
+	/**
+	 * Returns the y-coordinate of the highest block which is not air in a specific
+	 * column of the chunk (local coordinates, y is ignored) or in the whole chunk.
+	 * Returns -1 if there are only air blocks. All blocks above are air, but the
+	 * highest block itself may still be hidden by the world crop or block mask.
+	 */
+	int getHighestBlock(const LocalBlockPos& pos) const;
+	int getHighestBlock() const;
+
+	/**
+	 * Returns the count of full water blocks (still or flowing water with data 0) from
+	 * the highest block of a column (local coordinates, y is ignored) downwards, 0 if
+	 * the highest block is not full water. The first block below them which is not full
+	 * water has the y-coordinate getHighestBlock(pos) - getWaterDepth(pos).
+	 */
+	int getWaterDepth(const LocalBlockPos& pos) const;
+
+	/**
+	 * Returns a 64-bit hash of the loaded block data (sections, biomes and extra data).
+	 * Chunks with the same content (with the same rotation, world crop and block mask)
+	 * have the same hash, it's not a cryptographic hash though.
+	 */
+	uint64_t getContentHash() const;
+
+	/**
+	 * Returns a number which identifies the currently loaded data of this chunk object.
+	 * It changes every time the chunk is cleared or loaded, also if the object is reused
+	 * for another chunk (like the world cache does), so data computed from the chunk
+	 * can be cached with it.
+	 */
+	uint64_t getRevision() const;
+
+	/**
+	 * Returns the approximate count of bytes the chunk data uses in memory.
+	 */
+	size_t getMemoryUsage() const;
+
+	/**
+	 * Returns one of the arrays of a section (see ChunkSection::getArray), the blocks
+	 * have the index ((y%16)*16 + z)*16 + x (rotated). Returns nullptr if the chunk
+	 * doesn't have the section.
+	 */
+	const uint8_t* getSectionArray(int section, int array) const;
+
 	/**
 	 * Returns the block ID at a specific position (local coordinates).
 	 */
-	uint16_t getBlockID(const LocalBlockPos& pos, bool force = false) const;
+	uint16_t getBlockID(const LocalBlockPos& pos) const;
 
 	/**
 	 * Returns the block data value at a specific position (local coordinates).
 	 */
-	uint8_t getBlockData(const LocalBlockPos& pos, bool force = false) const;
+	uint8_t getBlockData(const LocalBlockPos& pos) const;
 
 	/**
 	 * Returns some additional block data, originally stored somewhere else (e.g. in an NBT tag)
@@ -124,6 +230,12 @@ public:
 	 */
 	const ChunkPos& getPos() const;
 
+	/**
+	 * Returns the signs of the chunk, their tile entities are read anyway for the extra
+	 * data of other blocks. The world crop isn't applied to them.
+	 */
+	const std::vector<Sign>& getSigns() const;
+
 private:
 	// internal original chunk position and public chunk position (which may be rotated)
 	ChunkPos chunkpos, chunkpos_original;
@@ -143,12 +255,92 @@ private:
 	int section_offsets[CHUNK_HEIGHT];
 	// the array with the sections, see indexes above
 	std::vector<ChunkSection> sections;
+	// the buffer with the arrays of the sections, the buffers of the cached chunks are
+	// allocated from the huge page arena if it's enabled
+	std::vector<uint8_t, util::ArenaAllocator<uint8_t> > section_data;
+	// the unpacked block IDs and the unpacked block data, block light and sky light of
+	// the sections (4096 values per array, in the order of the sections array), empty
+	// if the sections are not unpacked, see unpackSections()
+	std::vector<uint16_t, util::ArenaAllocator<uint16_t> > unpacked_ids;
+	std::vector<uint8_t, util::ArenaAllocator<uint8_t> > unpacked_data;
 
-	// the biomes in this chunk, as index z*16+x
+	// the biomes in this chunk, as index z*16+x (rotated)
 	uint8_t biomes[256];
 
-	// extra_data (e.g. from attributes read from NBT data, like beds) are stored in this map
-	std::unordered_map<int, uint16_t> extra_data_map;
+	// the y-coordinates of the highest non-air blocks of the columns, as index z*16+x
+	// (rotated),
+	// and of the whole chunk (-1 if there are only air blocks)
+	int16_t column_heights[256];
+	int highest_block;
+	// the counts of full water blocks from the highest blocks of the columns downwards,
+	// as index z*16+x (rotated), see getWaterDepth()
+	int16_t column_water_depths[256];
+
+	// see getRevision(), set when the chunk is cleared
+	uint64_t revision;
+
+	// extra_data (e.g. from attributes read from NBT data, like beds) are stored in this
+	// vector as (position key (rotated), extra data), sorted by the keys
+	std::vector<std::pair<uint16_t, uint16_t>> extra_data_list;
+	// the signs of the tile entities
+	std::vector<Sign> signs;
+
+	/**
+	 * The arrays of a section, pointing into the decompressed NBT data.
+	 *
+	 * The sections of Minecraft 1.13 and newer have the palette indices of the blocks
+	 * (the big-endian "BlockStates" long array) and a palette instead of these arrays,
+	 * the light arrays are optional there.
+	 */
+	struct RawSection {
+		int y;
+		const uint8_t *blocks, *add, *data, *block_light, *sky_light;
+		const uint8_t* block_states;
+		int32_t block_states_len;
+		// the block IDs and data values (id << 4 | data) of the palette of the section
+		// are palettes[palette_offset] to palettes[palette_offset + palette_size - 1]
+		size_t palette_offset, palette_size;
+	};
+
+	/**
+	 * Read the "Level" compound, a section compound and a tile entity compound of the
+	 * chunk NBT data (the tag type and name are already read). They interpret
+	 * only the tags needed for rendering and skip everything else. The sections are
+	 * collected in raw_sections, the palettes of the sections in palettes.
+	 */
+	bool readLevel(nbt::BufferReader& reader, std::vector<RawSection>& raw_sections,
+			std::vector<uint16_t>& palettes);
+	void readSection(nbt::BufferReader& reader, std::vector<RawSection>& raw_sections,
+			std::vector<uint16_t>& palettes);
+	void readTileEntity(nbt::BufferReader& reader);
+
+	/**
+	 * Decodes the palette indices of the sections with a palette into block ID, add
+	 * and data arrays in a buffer, the raw sections point then into this buffer. The
+	 * palette is mapped once per section, so the rest of the chunk code only sees the
+	 * same arrays like in the old chunk format.
+	 */
+	void decodePaletteSections(std::vector<RawSection>& raw_sections,
+			const std::vector<uint16_t>& palettes, std::vector<uint8_t>& buffer) const;
+
+	/**
+	 * Makes the blocks of the read sections air which are hidden by the world crop or
+	 * the block mask. The arrays of the affected sections are copied into a buffer
+	 * first, the raw sections point then into this buffer.
+	 */
+	void cropSections(std::vector<RawSection>& raw_sections,
+			std::vector<uint8_t>& buffer) const;
+
+	/**
+	 * Copies the arrays of the read sections into the section buffer, rotated unless
+	 * the arrays are already rotated.
+	 */
+	void storeSections(const std::vector<RawSection>& raw_sections, bool rotate = true);
+
+	/**
+	 * Calculates the heights and water depths of the columns from the stored sections.
+	 */
+	void calculateHeights();
 
 	/**
 	 * Checks whether a block (local coordinates, original/unrotated) is in the cropped
@@ -162,9 +354,9 @@ private:
 	 *   1: block light,
 	 *   2: sky light
 	 */
-	uint8_t getData(const LocalBlockPos& pos, int array, bool force = false) const;
+	uint8_t getData(const LocalBlockPos& pos, int array) const;
 
-	int positionToKey(int x, int z, int y) const;
+	uint16_t positionToKey(int x, int z, int y) const;
 	void insertExtraData(const LocalBlockPos& pos, uint16_t extra_data);
 	uint16_t getExtraData(const LocalBlockPos& pos, uint16_t default_value = 0) const;
 };
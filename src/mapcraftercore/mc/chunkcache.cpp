@@ -0,0 +1,415 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chunkcache.h"
+
+#include "../util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/map.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace ipc = boost::interprocess;
+
+namespace mapcrafter {
+namespace mc {
+
+namespace {
+
+const size_t SHARD_COUNT = 16;
+
+// the references and the completeness of the entries are changed by the processes
+// without the lock, so they must work between processes
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_BOOL_LOCK_FREE == 2,
+		"The shared memory chunk cache requires lock-free atomics.");
+
+struct SharedChunkKey {
+	uint64_t world;
+	int x, z;
+	int timestamp;
+
+	bool operator<(const SharedChunkKey& other) const {
+		return std::tie(world, x, z, timestamp)
+				< std::tie(other.world, other.x, other.z, other.timestamp);
+	}
+};
+
+struct SharedChunkEntry {
+	// the data of the chunk, as handle since the segment is mapped at different
+	// addresses in the processes
+	ipc::managed_shared_memory::handle_t data;
+	size_t size;
+	// the processes copying the chunk at the moment, and whether the chunk is written
+	// completely, both are only increased or set with the lock held, but released
+	// without it, so a process which can't get the lock in time doesn't keep the entry
+	// from being evicted forever
+	std::atomic<int> refs;
+	std::atomic<bool> complete;
+	uint64_t last_used;
+
+	SharedChunkEntry()
+		: data(), size(0), refs(0), complete(false), last_used(0) {}
+};
+
+typedef ipc::allocator<std::pair<const SharedChunkKey, SharedChunkEntry>,
+		ipc::managed_shared_memory::segment_manager> SharedChunkAllocator;
+typedef ipc::map<SharedChunkKey, SharedChunkEntry, std::less<SharedChunkKey>,
+		SharedChunkAllocator> SharedChunkMap;
+
+struct SharedChunkHeader {
+	int processes;
+	uint64_t access_counter;
+	size_t size;
+
+	SharedChunkHeader()
+		: processes(0), access_counter(0), size(0) {}
+};
+
+typedef ipc::scoped_lock<ipc::interprocess_mutex> SharedLock;
+
+boost::posix_time::ptime getLockDeadline(int timeout) {
+	return boost::posix_time::microsec_clock::universal_time()
+			+ boost::posix_time::milliseconds(timeout);
+}
+
+SharedChunkKey makeSharedChunkKey(uint64_t world, const ChunkPos& pos, int timestamp) {
+	SharedChunkKey key;
+	key.world = world;
+	key.x = pos.x;
+	key.z = pos.z;
+	key.timestamp = timestamp;
+	return key;
+}
+
+}
+
+ChunkCache::ChunkCache(size_t capacity)
+	: capacity(capacity), shard_capacity((capacity + SHARD_COUNT - 1) / SHARD_COUNT) {
+	if (shard_capacity == 0)
+		shard_capacity = 1;
+	for (size_t i = 0; i < SHARD_COUNT; i++)
+		shards.push_back(std::unique_ptr<Shard>(new Shard()));
+}
+
+ChunkCache::ChunkPtr ChunkCache::get(const ChunkPos& pos) {
+	Shard& shard = getShard(pos);
+	thread_ns::unique_lock<thread_ns::mutex> lock(shard.mutex);
+	auto it = shard.index.find(pos);
+	if (it == shard.index.end())
+		return ChunkPtr();
+	// mark the chunk as most recently used
+	shard.chunks.splice(shard.chunks.begin(), shard.chunks, it->second);
+	return it->second->second;
+}
+
+ChunkCache::ChunkPtr ChunkCache::put(const ChunkPos& pos, ChunkPtr chunk) {
+	Shard& shard = getShard(pos);
+	thread_ns::unique_lock<thread_ns::mutex> lock(shard.mutex);
+	auto it = shard.index.find(pos);
+	if (it != shard.index.end()) {
+		// another thread was faster, keep the chunk already cached
+		shard.chunks.splice(shard.chunks.begin(), shard.chunks, it->second);
+		return it->second->second;
+	}
+
+	shard.chunks.push_front(std::make_pair(pos, chunk));
+	shard.index[pos] = shard.chunks.begin();
+	while (shard.chunks.size() > shard_capacity) {
+		shard.index.erase(shard.chunks.back().first);
+		shard.chunks.pop_back();
+	}
+	return chunk;
+}
+
+size_t ChunkCache::size() const {
+	size_t size = 0;
+	for (size_t i = 0; i < shards.size(); i++) {
+		thread_ns::unique_lock<thread_ns::mutex> lock(shards[i]->mutex);
+		size += shards[i]->chunks.size();
+	}
+	return size;
+}
+
+size_t ChunkCache::getCapacity() const {
+	return capacity;
+}
+
+ChunkCache::Shard& ChunkCache::getShard(const ChunkPos& pos) {
+	return *shards[chunk_hash_function()(pos) % SHARD_COUNT];
+}
+
+CompressedChunkCache::CompressedChunkCache(size_t capacity)
+	: capacity(capacity), shard_capacity(capacity / SHARD_COUNT) {
+	for (size_t i = 0; i < SHARD_COUNT; i++) {
+		shards.push_back(std::unique_ptr<Shard>(new Shard()));
+		shards.back()->size = 0;
+	}
+}
+
+bool CompressedChunkCache::get(const ChunkPos& pos, Chunk& chunk) {
+	DataPtr data;
+	{
+		Shard& shard = getShard(pos);
+		thread_ns::unique_lock<thread_ns::mutex> lock(shard.mutex);
+		auto it = shard.index.find(pos);
+		if (it == shard.index.end())
+			return false;
+		shard.chunks.splice(shard.chunks.begin(), shard.chunks, it->second);
+		data = it->second->second;
+	}
+	// the data stays valid even if the chunk is evicted meanwhile
+	return chunk.readSnapshot(data->data(), data->size(), false);
+}
+
+void CompressedChunkCache::put(const ChunkPos& pos, const Chunk& chunk) {
+	Shard& shard = getShard(pos);
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(shard.mutex);
+		if (shard.index.count(pos))
+			return;
+	}
+
+	// compact the chunk without holding the lock
+	std::shared_ptr<std::vector<uint8_t> > data = std::make_shared<std::vector<uint8_t> >();
+	chunk.writeSnapshot(*data);
+	data->shrink_to_fit();
+	if (data->size() > shard_capacity)
+		return;
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(shard.mutex);
+	if (shard.index.count(pos))
+		return;
+	shard.chunks.push_front(std::make_pair(pos, data));
+	shard.index[pos] = shard.chunks.begin();
+	shard.size += data->size();
+	while (shard.size > shard_capacity) {
+		shard.size -= shard.chunks.back().second->size();
+		shard.index.erase(shard.chunks.back().first);
+		shard.chunks.pop_back();
+	}
+}
+
+size_t CompressedChunkCache::size() const {
+	size_t size = 0;
+	for (size_t i = 0; i < shards.size(); i++) {
+		thread_ns::unique_lock<thread_ns::mutex> lock(shards[i]->mutex);
+		size += shards[i]->size;
+	}
+	return size;
+}
+
+size_t CompressedChunkCache::getCapacity() const {
+	return capacity;
+}
+
+CompressedChunkCache::Shard& CompressedChunkCache::getShard(const ChunkPos& pos) {
+	return *shards[chunk_hash_function()(pos) % SHARD_COUNT];
+}
+
+struct SharedMemoryChunkCache::Segment {
+	ipc::managed_shared_memory memory;
+	ipc::interprocess_mutex* mutex;
+	SharedChunkHeader* header;
+	SharedChunkMap* chunks;
+	// the bytes of chunk data the segment takes before chunks are evicted, the rest is
+	// left for the index and the fragmentation of the segment
+	size_t budget;
+};
+
+SharedMemoryChunkCache::SharedMemoryChunkCache(const std::string& name, size_t capacity,
+		int lock_timeout)
+	: name(name), lock_timeout(lock_timeout), usable(true) {
+	try {
+		segment.reset(new Segment());
+		segment->memory = ipc::managed_shared_memory(ipc::open_or_create, name.c_str(),
+				capacity);
+		segment->mutex = segment->memory.find_or_construct<ipc::interprocess_mutex>(
+				"mutex")();
+		segment->header = segment->memory.find_or_construct<SharedChunkHeader>("header")();
+		segment->chunks = segment->memory.find_or_construct<SharedChunkMap>("chunks")(
+				std::less<SharedChunkKey>(),
+				SharedChunkAllocator(segment->memory.get_segment_manager()));
+		segment->budget = segment->memory.get_size() / 4 * 3;
+	} catch (const ipc::interprocess_exception& e) {
+		throw std::runtime_error("Unable to open shared memory segment '" + name + "': "
+				+ e.what());
+	}
+
+	SharedLock lock(*segment->mutex, getLockDeadline(lock_timeout));
+	if (!lock.owns())
+		throw std::runtime_error("Unable to lock shared memory segment '" + name + "'");
+	segment->header->processes++;
+}
+
+SharedMemoryChunkCache::~SharedMemoryChunkCache() {
+	bool last = false;
+	{
+		SharedLock lock(*segment->mutex, getLockDeadline(lock_timeout));
+		if (lock.owns())
+			last = --segment->header->processes == 0;
+	}
+	segment.reset();
+	// processes which open the segment afterwards create a new one
+	if (last)
+		ipc::shared_memory_object::remove(name.c_str());
+}
+
+bool SharedMemoryChunkCache::get(uint64_t world, const ChunkPos& pos, int timestamp,
+		Chunk& chunk) {
+	SharedChunkKey key = makeSharedChunkKey(world, pos, timestamp);
+	SharedChunkMap::iterator it;
+	{
+		if (!usable)
+			return false;
+		SharedLock lock(*segment->mutex, getLockDeadline(lock_timeout));
+		if (!checkLock(lock.owns()))
+			return false;
+		it = segment->chunks->find(key);
+		if (it == segment->chunks->end() || !it->second.complete)
+			return false;
+		// the reference keeps the chunk from being evicted while it's read
+		it->second.refs++;
+		it->second.last_used = ++segment->header->access_counter;
+	}
+
+	const uint8_t* data = static_cast<const uint8_t*>(
+			segment->memory.get_address_from_handle(it->second.data));
+	bool ok = chunk.readSnapshot(data, it->second.size, false);
+	it->second.refs--;
+	return ok;
+}
+
+void SharedMemoryChunkCache::put(uint64_t world, const ChunkPos& pos, int timestamp,
+		const Chunk& chunk) {
+	SharedChunkKey key = makeSharedChunkKey(world, pos, timestamp);
+	{
+		if (!usable)
+			return;
+		SharedLock lock(*segment->mutex, getLockDeadline(lock_timeout));
+		if (!checkLock(lock.owns()) || segment->chunks->count(key))
+			return;
+	}
+
+	// compact the chunk without holding the lock
+	std::vector<uint8_t> data;
+	chunk.writeSnapshot(data);
+	if (data.size() > segment->budget)
+		return;
+
+	SharedChunkMap::iterator it;
+	void* address;
+	{
+		if (!usable)
+			return;
+		SharedLock lock(*segment->mutex, getLockDeadline(lock_timeout));
+		if (!checkLock(lock.owns()) || segment->chunks->count(key))
+			return;
+		address = allocate(data.size());
+		if (address == nullptr)
+			return;
+		try {
+			it = segment->chunks->try_emplace(key).first;
+		} catch (const ipc::bad_alloc&) {
+			segment->memory.deallocate(address);
+			return;
+		}
+		SharedChunkEntry& entry = it->second;
+		entry.data = segment->memory.get_handle_from_address(address);
+		entry.size = data.size();
+		entry.refs = 1;
+		entry.last_used = ++segment->header->access_counter;
+		segment->header->size += data.size();
+	}
+
+	// other processes skip the chunk until it's complete
+	std::memcpy(address, data.data(), data.size());
+	it->second.complete = true;
+	it->second.refs--;
+}
+
+size_t SharedMemoryChunkCache::size() const {
+	if (!usable)
+		return 0;
+	SharedLock lock(*segment->mutex, getLockDeadline(lock_timeout));
+	if (!checkLock(lock.owns()))
+		return 0;
+	return segment->header->size;
+}
+
+size_t SharedMemoryChunkCache::getCapacity() const {
+	return segment->memory.get_size();
+}
+
+const std::string& SharedMemoryChunkCache::getName() const {
+	return name;
+}
+
+bool SharedMemoryChunkCache::checkLock(bool owns) const {
+	if (!owns && usable.exchange(false))
+		LOG(WARNING) << "Unable to lock shared memory segment '" << name
+				<< "' in time, not using it anymore.";
+	return owns;
+}
+
+void* SharedMemoryChunkCache::allocate(size_t size) {
+	if (segment->header->size + size > segment->budget)
+		evict();
+	void* address = segment->memory.allocate(size, std::nothrow);
+	if (address == nullptr) {
+		// the segment is fragmented or the index took more space than expected
+		evict();
+		address = segment->memory.allocate(size, std::nothrow);
+	}
+	return address;
+}
+
+void SharedMemoryChunkCache::evict() {
+	std::vector<std::pair<uint64_t, SharedChunkMap::iterator> > unused;
+	for (auto it = segment->chunks->begin(); it != segment->chunks->end(); ++it)
+		if (it->second.refs == 0 && it->second.complete)
+			unused.push_back(std::make_pair(it->second.last_used, it));
+	if (unused.empty())
+		return;
+
+	// evict an eighth of the chunks at once, so not every put has to look for the least
+	// recently used chunks
+	size_t count = std::max<size_t>(1, unused.size() / 8);
+	std::nth_element(unused.begin(), unused.begin() + (count - 1), unused.end(),
+			[](const std::pair<uint64_t, SharedChunkMap::iterator>& entry1,
+					const std::pair<uint64_t, SharedChunkMap::iterator>& entry2) {
+		return entry1.first < entry2.first;
+	});
+	for (size_t i = 0; i < count; i++) {
+		SharedChunkEntry& entry = unused[i].second->second;
+		segment->header->size -= entry.size;
+		segment->memory.deallocate(segment->memory.get_address_from_handle(entry.data));
+		segment->chunks->erase(unused[i].second);
+	}
+}
+
+}
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNKCACHE_H_
+#define CHUNKCACHE_H_
+
+#include "chunk.h"
+#include "pos.h"
+#include "../compat/thread.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mapcrafter {
+namespace mc {
+
+/**
+ * Hash function to use chunk positions in unordered_set/map.
+ */
+struct chunk_hash_function {
+	size_t operator()(const ChunkPos& chunk) const {
+		return (static_cast<size_t>(static_cast<uint32_t>(chunk.x)) * 0x9e3779b1u)
+				^ static_cast<uint32_t>(chunk.z);
+	}
+};
+
+/**
+ * A thread-safe cache of decoded chunks which can be shared by the world caches of
+ * multiple render threads, so every chunk has to be read and decoded only once even
+ * if it is needed by tiles which are rendered by different threads.
+ *
+ * The chunks in the cache are immutable and reference counted. A chunk which is evicted
+ * from the cache stays valid as long as somebody still has a reference to it.
+ *
+ * The cache is split into a few shards with an own lock and least recently used
+ * eviction each to keep the contention between the threads low.
+ */
+class ChunkCache {
+public:
+	typedef std::shared_ptr<const Chunk> ChunkPtr;
+
+	/**
+	 * Creates a cache which holds at most (approximately) the specified count of chunks.
+	 */
+	ChunkCache(size_t capacity = 2048);
+
+	/**
+	 * Returns the cached chunk with the specified position, or a null pointer if the
+	 * chunk is not in the cache.
+	 */
+	ChunkPtr get(const ChunkPos& pos);
+
+	/**
+	 * Puts a chunk into the cache. If another thread has already put the same chunk into
+	 * the cache, the chunk already cached is kept and returned, otherwise the supplied
+	 * chunk is returned.
+	 */
+	ChunkPtr put(const ChunkPos& pos, ChunkPtr chunk);
+
+	/**
+	 * Returns the count of chunks currently in the cache.
+	 */
+	size_t size() const;
+
+	/**
+	 * Returns the maximum count of chunks in the cache.
+	 */
+	size_t getCapacity() const;
+
+private:
+	typedef std::list<std::pair<ChunkPos, ChunkPtr> > ChunkList;
+
+	struct Shard {
+		mutable thread_ns::mutex mutex;
+		// chunks ordered from most to least recently used
+		ChunkList chunks;
+		std::unordered_map<ChunkPos, ChunkList::iterator, chunk_hash_function> index;
+	};
+
+	size_t capacity, shard_capacity;
+	std::vector<std::unique_ptr<Shard> > shards;
+
+	Shard& getShard(const ChunkPos& pos);
+};
+
+/**
+ * A thread-safe second level cache for the chunks evicted from the chunk caches of world
+ * caches, so a chunk which is needed again after a while (for example by the composite
+ * tiles or at the borders of the render tiles of another thread) is not read and
+ * decoded again.
+ *
+ * The chunks are stored compacted in the render snapshot format (see
+ * Chunk::writeSnapshot), which needs only a fraction of the memory of a decoded chunk
+ * since most of its arrays have only one value. Loading a chunk from it is only copying
+ * its arrays back. The chunks are stored as they were loaded (rotated and cropped), so
+ * a cache is only used by the world caches of the same world with the same rotation.
+ *
+ * The cache holds chunks up to a budget of bytes, with a few shards with an own lock
+ * and least recently used eviction each like the ChunkCache.
+ */
+class CompressedChunkCache {
+public:
+	/**
+	 * Creates a cache which holds at most (approximately) the specified count of bytes
+	 * of compacted chunks.
+	 */
+	CompressedChunkCache(size_t capacity);
+
+	/**
+	 * Loads the chunk with the specified position from the cache into a chunk which has
+	 * the rotation and world crop of the cached chunks set. Returns false if the chunk is
+	 * not in the cache.
+	 */
+	bool get(const ChunkPos& pos, Chunk& chunk);
+
+	/**
+	 * Puts a chunk into the cache, if it's not in the cache already.
+	 */
+	void put(const ChunkPos& pos, const Chunk& chunk);
+
+	/**
+	 * Returns the count of bytes of the chunks currently in the cache, or 0 if the
+	 * segment isn't used anymore.
+	 */
+	size_t size() const;
+
+	/**
+	 * Returns the maximum count of bytes of the chunks in the cache.
+	 */
+	size_t getCapacity() const;
+
+private:
+	typedef std::shared_ptr<const std::vector<uint8_t> > DataPtr;
+	typedef std::list<std::pair<ChunkPos, DataPtr> > ChunkList;
+
+	struct Shard {
+		mutable thread_ns::mutex mutex;
+		// chunks ordered from most to least recently used
+		ChunkList chunks;
+		std::unordered_map<ChunkPos, ChunkList::iterator, chunk_hash_function> index;
+		// the bytes of the chunks
+		size_t size;
+	};
+
+	size_t capacity, shard_capacity;
+	std::vector<std::unique_ptr<Shard> > shards;
+
+	Shard& getShard(const ChunkPos& pos);
+};
+
+/**
+ * A cache of decoded chunks in a named shared memory segment, shared by the processes
+ * on one host which render the same worlds (for example with different configuration
+ * files), so every chunk is read and decoded by only one of them.
+ *
+ * The chunks are stored in the render snapshot format like in the CompressedChunkCache.
+ * They are keyed by a key of the world, the position and the timestamp of the chunk, so
+ * modified chunks are never taken from the cache. The key of the world has to identify
+ * the world directory, its dimension, rotation and world crop, since the chunks are
+ * stored as they were loaded.
+ *
+ * The entries are reference counted while a process copies a chunk from or into the
+ * segment, the least recently used entries without references are evicted when the
+ * segment is full. The segment is created by the first process and removed when the
+ * last one detaches from it. A process which can't get the lock of the segment (the
+ * interprocess mutex named "mutex" in the segment) in time, for example because another
+ * process crashed while holding it, stops using the segment and treats all chunks as not
+ * cached from then on, so it doesn't wait for the lock again for every chunk.
+ */
+class SharedMemoryChunkCache {
+public:
+	/**
+	 * Opens the segment with the specified name, or creates it with the specified size
+	 * in bytes if it doesn't exist yet. Throws a std::runtime_error if that fails.
+	 * The lock timeout is how long the process waits for the lock of the segment in
+	 * milliseconds.
+	 */
+	SharedMemoryChunkCache(const std::string& name, size_t capacity,
+			int lock_timeout = 1000);
+	~SharedMemoryChunkCache();
+
+	/**
+	 * Loads the chunk with the specified world key, position and timestamp from the
+	 * cache into a chunk which has the rotation and world crop of the cached chunks set.
+	 * Returns false if the chunk is not in the cache.
+	 */
+	bool get(uint64_t world, const ChunkPos& pos, int timestamp, Chunk& chunk);
+
+	/**
+	 * Puts a chunk into the cache, if it's not in the cache already.
+	 */
+	void put(uint64_t world, const ChunkPos& pos, int timestamp, const Chunk& chunk);
+
+	/**
+	 * Returns the count of bytes of the chunks currently in the cache, or 0 if the
+	 * segment isn't used anymore.
+	 */
+	size_t size() const;
+
+	/**
+	 * Returns the size of the segment in bytes, which is the size of the process that
+	 * created it.
+	 */
+	size_t getCapacity() const;
+
+	/**
+	 * Returns the name of the segment.
+	 */
+	const std::string& getName() const;
+
+private:
+	struct Segment;
+
+	std::string name;
+	int lock_timeout;
+	mutable std::atomic<bool> usable;
+	std::unique_ptr<Segment> segment;
+
+	/**
+	 * Returns whether the lock of the segment was taken in time. The segment isn't used
+	 * anymore by this process after the first time it wasn't.
+	 */
+	bool checkLock(bool owns) const;
+
+	/**
+	 * Allocates the data of a chunk in the segment, evicts chunks if the segment is
+	 * full. The lock of the segment must be held. Returns null if there is no space.
+	 */
+	void* allocate(size_t size);
+
+	/**
+	 * Evicts the least recently used chunks without references. The lock of the segment
+	 * must be held.
+	 */
+	void evict();
+};
+
+}
+}
+
+#endif /* CHUNKCACHE_H_ */
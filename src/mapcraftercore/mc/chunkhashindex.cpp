@@ -0,0 +1,121 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chunkhashindex.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace mapcrafter {
+namespace mc {
+
+namespace {
+
+// "MCCH" and version of the index file format, the byte order of the host is used
+const uint32_t INDEX_MAGIC = 0x4d434348;
+const uint32_t INDEX_VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}
+
+ChunkHashIndex::ChunkHashIndex() {
+}
+
+ChunkHashIndex::~ChunkHashIndex() {
+}
+
+bool ChunkHashIndex::read(const std::string& filename) {
+	hashes.clear();
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	uint32_t magic, version, count;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, count)
+			|| magic != INDEX_MAGIC || version != INDEX_VERSION)
+		return false;
+
+	for (uint32_t i = 0; i < count; i++) {
+		int32_t x, z;
+		uint64_t hash;
+		if (!readValue(in, x) || !readValue(in, z) || !readValue(in, hash))
+			break;
+		hashes[ChunkPos(x, z)] = hash;
+	}
+
+	// a truncated index is not valid at all
+	if (hashes.size() != count) {
+		hashes.clear();
+		return false;
+	}
+	return true;
+}
+
+bool ChunkHashIndex::write(const std::string& filename) const {
+	// write to a temporary file first to not leave a broken index behind
+	std::string tmp_filename = filename + ".tmp";
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	writeValue(out, INDEX_MAGIC);
+	writeValue(out, INDEX_VERSION);
+	writeValue(out, (uint32_t) hashes.size());
+	for (auto it = hashes.begin(); it != hashes.end(); ++it) {
+		writeValue(out, (int32_t) it->first.x);
+		writeValue(out, (int32_t) it->first.z);
+		writeValue(out, it->second);
+	}
+	out.close();
+	if (!out)
+		return false;
+	return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+bool ChunkHashIndex::find(const ChunkPos& pos, uint64_t& hash) const {
+	auto it = hashes.find(pos);
+	if (it == hashes.end())
+		return false;
+	hash = it->second;
+	return true;
+}
+
+void ChunkHashIndex::update(const ChunkPos& pos, uint64_t hash) {
+	hashes[pos] = hash;
+}
+
+void ChunkHashIndex::remove(const ChunkPos& pos) {
+	hashes.erase(pos);
+}
+
+size_t ChunkHashIndex::size() const {
+	return hashes.size();
+}
+
+}
+}
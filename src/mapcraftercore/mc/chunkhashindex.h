@@ -0,0 +1,83 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNKHASHINDEX_H_
+#define CHUNKHASHINDEX_H_
+
+#include "pos.h"
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace mc {
+
+/**
+ * An index with the content hashes (see Chunk::getContentHash) of the chunks of a
+ * rendered map rotation.
+ *
+ * The index is persisted between the renderings. Tiles whose chunks were only touched
+ * (for example saved again by Minecraft without changing any blocks) have newer chunk
+ * timestamps, but the same chunk hashes, and don't need to be rendered again.
+ */
+class ChunkHashIndex {
+public:
+	ChunkHashIndex();
+	~ChunkHashIndex();
+
+	/**
+	 * Reads the index from a file. Returns false if the file does not exist or is not a
+	 * valid index file, the index is empty then.
+	 */
+	bool read(const std::string& filename);
+
+	/**
+	 * Writes the index to a file.
+	 */
+	bool write(const std::string& filename) const;
+
+	/**
+	 * Looks up the hash of a chunk. Returns true and copies it to hash if there is one.
+	 */
+	bool find(const ChunkPos& pos, uint64_t& hash) const;
+
+	/**
+	 * Adds or replaces the hash of a chunk.
+	 */
+	void update(const ChunkPos& pos, uint64_t hash);
+
+	/**
+	 * Removes the hash of a chunk (for example if the chunk does not exist anymore).
+	 */
+	void remove(const ChunkPos& pos);
+
+	/**
+	 * Returns the count of chunks in the index.
+	 */
+	size_t size() const;
+
+private:
+	std::map<ChunkPos, uint64_t> hashes;
+};
+
+}
+}
+
+#endif /* CHUNKHASHINDEX_H_ */
@@ -19,12 +19,22 @@
 
 #include "nbt.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 
+#ifdef HAVE_LIBDEFLATE
+#  include <libdeflate.h>
+#else
+#  include <zlib.h>
+#endif
+
 namespace mapcrafter {
 namespace mc {
 namespace nbt {
@@ -381,6 +391,446 @@ NBTFile::NBTFile() {
 NBTFile::~NBTFile() {
 }
 
+#ifdef HAVE_LIBDEFLATE
+
+void decompress(const char* buffer, size_t len, DecompressedBuffer& decompressed,
+		Compression compression) {
+	if (compression == Compression::NO_COMPRESSION) {
+		decompressed.assign(buffer, buffer + len);
+		return;
+	}
+
+	// the decompressor has no state between calls, so keep one per thread
+	typedef std::unique_ptr<libdeflate_decompressor, void (*)(libdeflate_decompressor*)>
+		DecompressorPtr;
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local DecompressorPtr decompressor(libdeflate_alloc_decompressor(),
+			libdeflate_free_decompressor);
+#else
+	DecompressorPtr decompressor(libdeflate_alloc_decompressor(),
+			libdeflate_free_decompressor);
+#endif
+	if (!decompressor)
+		throw NBTError("Unable to allocate decompressor!");
+
+	// libdeflate needs an output buffer which is big enough for all data, use the
+	// whole (already allocated) buffer and try until it's big enough
+	decompressed.resize(std::max(decompressed.capacity(), 4 * len + 4096));
+	while (true) {
+		size_t size = 0;
+		libdeflate_result result;
+		if (compression == Compression::GZIP)
+			result = libdeflate_gzip_decompress(decompressor.get(), buffer, len,
+					&decompressed[0], decompressed.size(), &size);
+		else
+			result = libdeflate_zlib_decompress(decompressor.get(), buffer, len,
+					&decompressed[0], decompressed.size(), &size);
+		if (result == LIBDEFLATE_SUCCESS) {
+			decompressed.resize(size);
+			return;
+		} else if (result != LIBDEFLATE_INSUFFICIENT_SPACE) {
+			throw NBTError("Error while decompressing data: libdeflate error "
+					+ util::str((int) result));
+		}
+		// the data decompressed so far is discarded, so don't copy it
+		size_t capacity = decompressed.size() * 2;
+		decompressed.clear();
+		decompressed.resize(capacity);
+	}
+}
+
+#else
+
+void decompress(const char* buffer, size_t len, DecompressedBuffer& decompressed,
+		Compression compression) {
+	if (compression == Compression::NO_COMPRESSION) {
+		decompressed.assign(buffer, buffer + len);
+		return;
+	}
+
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	// 16 + max window bits: gzip header, otherwise zlib header
+	int window_bits = compression == Compression::GZIP ? 16 + MAX_WBITS : MAX_WBITS;
+	if (inflateInit2(&stream, window_bits) != Z_OK)
+		throw NBTError("Unable to initialize zlib: " + std::string(stream.msg ? stream.msg : ""));
+
+	// use the whole (already allocated) buffer, chunks are usually inflated with
+	// one call then, the buffer grows only if that's not enough
+	decompressed.resize(std::max(decompressed.capacity(), 4 * len + 4096));
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer));
+	stream.avail_in = len;
+	int status;
+	do {
+		if (stream.total_out == decompressed.size())
+			decompressed.resize(decompressed.size() * 2);
+		stream.next_out = &decompressed[stream.total_out];
+		stream.avail_out = decompressed.size() - stream.total_out;
+		status = inflate(&stream, Z_NO_FLUSH);
+	} while (status == Z_OK);
+
+	size_t size = stream.total_out;
+	std::string message = stream.msg ? stream.msg : "";
+	inflateEnd(&stream);
+	if (status != Z_STREAM_END)
+		throw NBTError("Error while decompressing " + std::string(compression
+				== Compression::GZIP ? "gzip" : "zlib") + " data: " + message
+				+ " (" + util::str(status) + ")");
+	decompressed.resize(size);
+}
+
+#endif
+
+BufferReader::BufferReader(const uint8_t* data, size_t len)
+	: ptr(data), end(data + len) {
+}
+
+bool BufferReader::eof() const {
+	return ptr >= end;
+}
+
+const uint8_t* BufferReader::advance(size_t count) {
+	if ((size_t) (end - ptr) < count)
+		throw NBTError("Unexpected end of NBT data!");
+	const uint8_t* current = ptr;
+	ptr += count;
+	return current;
+}
+
+int8_t BufferReader::readByte() {
+	return *advance(1);
+}
+
+int16_t BufferReader::readShort() {
+	int16_t value;
+	std::memcpy(&value, advance(2), 2);
+	return util::bigEndian16(value);
+}
+
+int32_t BufferReader::readInt() {
+	int32_t value;
+	std::memcpy(&value, advance(4), 4);
+	return util::bigEndian32(value);
+}
+
+int64_t BufferReader::readLong() {
+	int64_t value;
+	std::memcpy(&value, advance(8), 8);
+	return util::bigEndian64(value);
+}
+
+const uint8_t* BufferReader::readBytes(size_t count) {
+	return advance(count);
+}
+
+const char* BufferReader::readString(uint16_t& len) {
+	len = readShort();
+	return reinterpret_cast<const char*>(advance(len));
+}
+
+std::string BufferReader::readStdString() {
+	uint16_t len;
+	const char* string = readString(len);
+	return std::string(string, len);
+}
+
+bool BufferReader::readByteArray(uint8_t* dest, int32_t expected_len) {
+	int32_t len = readInt();
+	if (len < 0)
+		throw NBTError("Invalid length of byte array!");
+	const uint8_t* data = advance(len);
+	if (len != expected_len)
+		return false;
+	std::memcpy(dest, data, len);
+	return true;
+}
+
+const uint8_t* BufferReader::readByteArray(int32_t expected_len) {
+	int32_t len = readInt();
+	if (len < 0)
+		throw NBTError("Invalid length of byte array!");
+	const uint8_t* data = advance(len);
+	if (len != expected_len)
+		return nullptr;
+	return data;
+}
+
+namespace {
+
+// tags can't be nested deeper, to limit the recursion of the parser
+const int MAX_DOCUMENT_DEPTH = 512;
+
+}
+
+void BufferReader::skipPayload(int8_t type, int depth) {
+	if (depth > MAX_DOCUMENT_DEPTH)
+		throw NBTError("NBT data is nested too deeply!");
+
+	switch (type) {
+	case TagByte::TAG_TYPE: advance(1); break;
+	case TagShort::TAG_TYPE: advance(2); break;
+	case TagInt::TAG_TYPE: advance(4); break;
+	case TagLong::TAG_TYPE: advance(8); break;
+	case TagFloat::TAG_TYPE: advance(4); break;
+	case TagDouble::TAG_TYPE: advance(8); break;
+	case TagByteArray::TAG_TYPE: {
+		int32_t len = readInt();
+		if (len < 0)
+			throw NBTError("Invalid length of byte array!");
+		advance(len);
+		break;
+	}
+	case TagString::TAG_TYPE: {
+		uint16_t len;
+		readString(len);
+		break;
+	}
+	case TagList::TAG_TYPE: {
+		int8_t tag_type = readByte();
+		int32_t len = readInt();
+		for (int32_t i = 0; i < len; i++)
+			skipPayload(tag_type, depth + 1);
+		break;
+	}
+	case TagCompound::TAG_TYPE: {
+		while (true) {
+			int8_t tag_type = readByte();
+			if (tag_type == TagEnd::TAG_TYPE)
+				break;
+			uint16_t len;
+			readString(len);
+			skipPayload(tag_type, depth + 1);
+		}
+		break;
+	}
+	case TagIntArray::TAG_TYPE: {
+		int32_t len = readInt();
+		if (len < 0)
+			throw NBTError("Invalid length of int array!");
+		advance(4 * (size_t) len);
+		break;
+	}
+	case TagLongArray::TAG_TYPE: {
+		int32_t len = readInt();
+		if (len < 0)
+			throw NBTError("Invalid length of long array!");
+		advance(8 * (size_t) len);
+		break;
+	}
+	default:
+		throw NBTError("Unknown tag type " + util::str((int) type) + "!");
+	}
+}
+
+bool Document::Node::hasName(const char* name) const {
+	return std::strlen(name) == name_len && std::memcmp(this->name, name, name_len) == 0;
+}
+
+std::string Document::Node::getName() const {
+	return std::string(name, name_len);
+}
+
+int64_t Document::Node::getInt() const {
+	BufferReader reader(payload, 8);
+	switch (type) {
+	case TagByte::TAG_TYPE: return reader.readByte();
+	case TagShort::TAG_TYPE: return reader.readShort();
+	case TagInt::TAG_TYPE: return reader.readInt();
+	case TagLong::TAG_TYPE: return reader.readLong();
+	default: throw InvalidTagCast();
+	}
+}
+
+double Document::Node::getDouble() const {
+	BufferReader reader(payload, 8);
+	if (type == TagFloat::TAG_TYPE) {
+		int32_t bits = reader.readInt();
+		float value;
+		std::memcpy(&value, &bits, 4);
+		return value;
+	} else if (type == TagDouble::TAG_TYPE) {
+		int64_t bits = reader.readLong();
+		double value;
+		std::memcpy(&value, &bits, 8);
+		return value;
+	}
+	throw InvalidTagCast();
+}
+
+std::string Document::Node::getString() const {
+	if (type != TagString::TAG_TYPE)
+		throw InvalidTagCast();
+	return std::string(reinterpret_cast<const char*>(payload), length);
+}
+
+Document::Document() {
+}
+
+Document::~Document() {
+}
+
+void Document::parse(const uint8_t* data, size_t len) {
+	nodes.clear();
+	BufferReader reader(data, len);
+	Node root = {reader.readByte(), -1, nullptr, 0, nullptr, 0, 0, 0};
+	if (root.type != TagCompound::TAG_TYPE)
+		throw NBTError("First tag is not a tag compound!");
+	root.name = reader.readString(root.name_len);
+	nodes.push_back(root);
+	parsePayload(reader, 0, 0);
+}
+
+void Document::clear() {
+	nodes.clear();
+}
+
+const Document::Node& Document::getRoot() const {
+	return nodes[0];
+}
+
+size_t Document::size() const {
+	return nodes.size();
+}
+
+const Document::Node* Document::getFirstChild(const Node& node) const {
+	return node.first_child == 0 ? nullptr : &nodes[node.first_child];
+}
+
+const Document::Node* Document::getNextSibling(const Node& node) const {
+	return node.next_sibling == 0 ? nullptr : &nodes[node.next_sibling];
+}
+
+const Document::Node* Document::findChild(const Node& compound, const char* name,
+		int8_t type) const {
+	if (compound.type != TagCompound::TAG_TYPE)
+		return nullptr;
+	for (const Node* child = getFirstChild(compound); child != nullptr;
+			child = getNextSibling(*child))
+		if (child->hasName(name) && (type == -1 || child->type == type))
+			return child;
+	return nullptr;
+}
+
+void Document::parsePayload(BufferReader& reader, size_t index, int depth) {
+	if (depth > MAX_DOCUMENT_DEPTH)
+		throw NBTError("NBT data is nested too deeply!");
+
+	// nodes may be reallocated while parsing the children, so access it by index
+	int8_t type = nodes[index].type;
+	if (type == TagCompound::TAG_TYPE || type == TagList::TAG_TYPE) {
+		bool list = type == TagList::TAG_TYPE;
+		int8_t list_type = -1;
+		int32_t count = -1;
+		if (list) {
+			list_type = reader.readByte();
+			count = reader.readInt();
+			nodes[index].list_type = list_type;
+			nodes[index].length = count;
+		}
+		size_t last_child = 0;
+		for (int32_t i = 0; !list || i < count; i++) {
+			Node child = {list_type, -1, "", 0, nullptr, 0, 0, 0};
+			if (!list) {
+				child.type = reader.readByte();
+				if (child.type == TagEnd::TAG_TYPE)
+					break;
+				child.name = reader.readString(child.name_len);
+				nodes[index].length++;
+			}
+			size_t child_index = nodes.size();
+			nodes.push_back(child);
+			if (last_child == 0)
+				nodes[index].first_child = child_index;
+			else
+				nodes[last_child].next_sibling = child_index;
+			last_child = child_index;
+			parsePayload(reader, child_index, depth + 1);
+		}
+		return;
+	}
+
+	Node& node = nodes[index];
+	node.payload = reader.readBytes(0);
+	switch (type) {
+	case TagByte::TAG_TYPE:
+	case TagShort::TAG_TYPE:
+	case TagInt::TAG_TYPE:
+	case TagLong::TAG_TYPE:
+	case TagFloat::TAG_TYPE:
+	case TagDouble::TAG_TYPE:
+		reader.skipPayload(type);
+		break;
+	case TagString::TAG_TYPE: {
+		uint16_t len;
+		node.payload = reinterpret_cast<const uint8_t*>(reader.readString(len));
+		node.length = len;
+		break;
+	}
+	case TagByteArray::TAG_TYPE:
+	case TagIntArray::TAG_TYPE:
+	case TagLongArray::TAG_TYPE: {
+		int32_t len = reader.readInt();
+		if (len < 0)
+			throw NBTError("Invalid length of array!");
+		size_t element_size = type == TagLongArray::TAG_TYPE ? 8
+				: (type == TagIntArray::TAG_TYPE ? 4 : 1);
+		node.payload = reader.readBytes(element_size * len);
+		node.length = len;
+		break;
+	}
+	default:
+		throw NBTError("Unknown tag type " + util::str((int) type) + "!");
+	}
+}
+
+void Document::dump(std::ostream& stream) const {
+	if (!nodes.empty())
+		dump(stream, nodes[0], "", true);
+}
+
+void Document::dump(std::ostream& stream, const Node& node,
+		const std::string& indendation, bool named) const {
+	const char* type = "TAG_Unknown";
+	if (node.type >= 0 && node.type <= 12)
+		type = TAG_NAMES[node.type];
+	stream << indendation << type;
+	if (named)
+		stream << "(\"" << node.getName() << "\")";
+	stream << ": ";
+
+	switch (node.type) {
+	case TagByte::TAG_TYPE:
+	case TagShort::TAG_TYPE:
+	case TagInt::TAG_TYPE:
+	case TagLong::TAG_TYPE:
+		stream << node.getInt() << std::endl;
+		break;
+	case TagFloat::TAG_TYPE:
+	case TagDouble::TAG_TYPE:
+		stream << node.getDouble() << std::endl;
+		break;
+	case TagString::TAG_TYPE:
+		stream << node.getString() << std::endl;
+		break;
+	case TagByteArray::TAG_TYPE:
+	case TagIntArray::TAG_TYPE:
+	case TagLongArray::TAG_TYPE:
+		stream << node.length << " entries" << std::endl;
+		break;
+	case TagList::TAG_TYPE:
+	case TagCompound::TAG_TYPE:
+		stream << node.length << " entries";
+		if (node.type == TagList::TAG_TYPE)
+			stream << " of type " << static_cast<int>(node.list_type);
+		stream << std::endl << indendation << "{" << std::endl;
+		for (const Node* child = getFirstChild(node); child != nullptr;
+				child = getNextSibling(*child))
+			dump(stream, *child, indendation + "   ", node.type == TagCompound::TAG_TYPE);
+		stream << indendation << "}" << std::endl;
+		break;
+	}
+}
+
 void NBTFile::decompressStream(std::istream& stream, std::stringstream& decompressed,
         Compression compression) {
 	if (compression == Compression::NO_COMPRESSION) {
@@ -410,11 +860,15 @@ void NBTFile::decompressStream(std::istream& stream, std::stringstream& decompre
 void NBTFile::readCompressed(std::istream& stream, Compression compression) {
 	std::stringstream decompressed(std::ios::in | std::ios::out | std::ios::binary);
 	decompressStream(stream, decompressed, compression);
-	int8_t type = ((TagByte&) TagByte().read(decompressed)).payload;
+	readUncompressed(decompressed);
+}
+
+void NBTFile::readUncompressed(std::istream& stream) {
+	int8_t type = ((TagByte&) TagByte().read(stream)).payload;
 	if (type != TagCompound::TAG_TYPE)
 		throw NBTError("First tag is not a tag compound!");
-	std::string name = ((TagString&) TagString().read(decompressed)).payload;
-	TagCompound::read(decompressed);
+	std::string name = ((TagString&) TagString().read(stream)).payload;
+	TagCompound::read(stream);
 	setName(name);
 }
 
@@ -431,9 +885,12 @@ void NBTFile::readNBT(const char* filename, Compression compression) {
 }
 
 void NBTFile::readNBT(const char* buffer, size_t len, Compression compression) {
-	std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
-	stream.write(buffer, len);
-	readCompressed(stream, compression);
+	// decompress the whole buffer at once and read the tags directly from it
+	DecompressedBuffer decompressed;
+	decompress(buffer, len, decompressed, compression);
+	boost::iostreams::stream<boost::iostreams::array_source> stream(
+			reinterpret_cast<const char*>(decompressed.data()), decompressed.size());
+	readUncompressed(stream);
 }
 
 void NBTFile::writeNBT(std::ostream& stream, Compression compression) {
@@ -484,6 +941,8 @@ Tag* createTag(int8_t type) {
 		return new TagCompound;
 	case TagIntArray::TAG_TYPE:
 		return new TagIntArray;
+	case TagLongArray::TAG_TYPE:
+		return new TagLongArray;
 	default:
 		return nullptr;
 	}
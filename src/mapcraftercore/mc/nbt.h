@@ -68,7 +68,8 @@ enum class TagType : int8_t {
 	TAG_STRING = 8,
 	TAG_LIST = 9,
 	TAG_COMPOUND = 10,
-	TAG_INT_ARRAY = 11
+	TAG_INT_ARRAY = 11,
+	TAG_LONG_ARRAY = 12
 };
 
 enum class Compression {
@@ -88,6 +89,7 @@ static const char* TAG_NAMES[] = {
 	"TAG_List",
 	"TAG_Compound",
 	"TAG_Int_Array",
+	"TAG_Long_Array",
 };
 
 template <typename T>
@@ -98,7 +100,7 @@ void dumpTag(std::ostream& stream, const std::string& indendation, T tag) {
 template <typename T, typename P>
 void dumpTag(std::ostream& stream, const std::string& indendation, T tag, P payloadrepr) {
 	const char* type = "TAG_Unknown";
-	if (tag.getType() >= 0 && tag.getType() <= 11)
+	if (tag.getType() >= 0 && tag.getType() <= 12)
 		type = TAG_NAMES[tag.getType()];
 	stream << indendation << type;
 	if (tag.isNamed())
@@ -244,6 +246,7 @@ public:
 
 typedef TagArray<int8_t, TagType::TAG_BYTE_ARRAY> TagByteArray;
 typedef TagArray<int32_t, TagType::TAG_INT_ARRAY> TagIntArray;
+typedef TagArray<int64_t, TagType::TAG_LONG_ARRAY> TagLongArray;
 
 class TagString: public Tag {
 public:
@@ -314,8 +317,9 @@ public:
 	template <typename T>
 	bool hasArray(const std::string& name, int32_t len = -1) const {
 		static_assert(std::is_same<T, TagByteArray>::value
-				|| std::is_same<T, TagIntArray>::value,
-			"Only TagByteArray and TagIntArray are allowed as template argument!");
+				|| std::is_same<T, TagIntArray>::value
+				|| std::is_same<T, TagLongArray>::value,
+			"Only TagByteArray, TagIntArray and TagLongArray are allowed as template argument!");
 		if (!hasTag<T>(name))
 			return false;
 		T& tag = payload.at(name)->cast<T>();
@@ -354,6 +358,7 @@ class NBTFile: public TagCompound {
 private:
 	void decompressStream(std::istream& stream, std::stringstream& decompressed,
 	        Compression compression);
+	void readUncompressed(std::istream& stream);
 public:
 	NBTFile();
 	NBTFile(const std::string name) : TagCompound(name) {}
@@ -370,6 +375,168 @@ public:
 
 Tag* createTag(int8_t type);
 
+/**
+ * A buffer for decompressed data, its bytes aren't zeroed when it's resized.
+ */
+typedef std::vector<uint8_t, util::DefaultInitAllocator<uint8_t> > DecompressedBuffer;
+
+/**
+ * Decompresses a buffer with (gzip/zlib) compressed NBT data in one go with zlib (or
+ * libdeflate if available). The already allocated memory of the output buffer is
+ * reused, so reuse the output buffer when decompressing many chunks. Throws an
+ * NBTError if the data can't be decompressed.
+ */
+void decompress(const char* buffer, size_t len, DecompressedBuffer& decompressed,
+		Compression compression);
+
+/**
+ * A simple reader to walk through uncompressed NBT data without building the tag tree.
+ *
+ * All read methods throw an NBTError if the end of the buffer is reached.
+ */
+class BufferReader {
+public:
+	BufferReader(const uint8_t* data, size_t len);
+
+	/**
+	 * Returns whether the end of the buffer is reached.
+	 */
+	bool eof() const;
+
+	int8_t readByte();
+	int16_t readShort();
+	int32_t readInt();
+	int64_t readLong();
+
+	/**
+	 * Returns a pointer to the next count bytes of the buffer and skips them.
+	 */
+	const uint8_t* readBytes(size_t count);
+
+	/**
+	 * Reads a string (also used for tag names) and returns its length and a pointer to
+	 * it. The string is not null-terminated.
+	 */
+	const char* readString(uint16_t& len);
+	std::string readStdString();
+
+	/**
+	 * Reads the length of a byte array and copies it to a buffer if the length is
+	 * expected_len, skips it otherwise. Returns whether the array was copied.
+	 */
+	bool readByteArray(uint8_t* dest, int32_t expected_len);
+
+	/**
+	 * Reads the length of a byte array and returns a pointer to the array in the buffer
+	 * if the length is expected_len, skips it and returns nullptr otherwise.
+	 */
+	const uint8_t* readByteArray(int32_t expected_len);
+
+	/**
+	 * Skips the payload of a tag with a specific type. The depth is the nesting depth of
+	 * the tag, it throws an NBTError if the tags are nested too deeply.
+	 */
+	void skipPayload(int8_t type, int depth = 0);
+
+private:
+	const uint8_t* ptr;
+	const uint8_t* end;
+
+	const uint8_t* advance(size_t count);
+};
+
+/**
+ * A read-only NBT document of uncompressed NBT data.
+ *
+ * Unlike NBTFile, which builds a tree of separately allocated tags, all tags of a
+ * document are stored in one vector, and the names, strings and arrays point directly
+ * into the NBT data. So the NBT data must outlive the document. Clearing the document
+ * frees all tags at once and parsing another document into the same object reuses the
+ * memory of the tags.
+ */
+class Document {
+public:
+	/**
+	 * A tag of the document.
+	 */
+	struct Node {
+		int8_t type;
+		// the type of the elements if this is a list
+		int8_t list_type;
+		// the name of the tag (not null-terminated), empty for list elements
+		const char* name;
+		uint16_t name_len;
+		// the payload of the tag in the NBT data (the data of strings and arrays)
+		const uint8_t* payload;
+		// length of strings and arrays, count of the elements of lists and compounds
+		int32_t length;
+		// indexes of the first child and the next sibling, 0 if there is none
+		uint32_t first_child, next_sibling;
+
+		/**
+		 * Returns whether the tag has a specific name.
+		 */
+		bool hasName(const char* name) const;
+		std::string getName() const;
+
+		/**
+		 * Return the payload of byte, short, int, long, float, double and string tags.
+		 * Throw an InvalidTagCast if the tag has another type.
+		 */
+		int64_t getInt() const;
+		double getDouble() const;
+		std::string getString() const;
+	};
+
+	Document();
+	~Document();
+
+	/**
+	 * Parses uncompressed NBT data. Throws an NBTError if the data is invalid.
+	 */
+	void parse(const uint8_t* data, size_t len);
+
+	/**
+	 * Clears the document.
+	 */
+	void clear();
+
+	/**
+	 * Returns the root compound. The document must not be empty.
+	 */
+	const Node& getRoot() const;
+
+	/**
+	 * Returns the count of tags in the document.
+	 */
+	size_t size() const;
+
+	/**
+	 * Walk through the elements of a list or compound, return nullptr if there is no
+	 * (further) element.
+	 */
+	const Node* getFirstChild(const Node& node) const;
+	const Node* getNextSibling(const Node& node) const;
+
+	/**
+	 * Returns the tag with a specific name (and type, if type is not -1) of a compound,
+	 * or nullptr if there is no such tag.
+	 */
+	const Node* findChild(const Node& compound, const char* name, int8_t type = -1) const;
+
+	/**
+	 * Dumps the document in the same format as Tag::dump.
+	 */
+	void dump(std::ostream& stream) const;
+
+private:
+	std::vector<Node> nodes;
+
+	void parsePayload(BufferReader& reader, size_t index, int depth);
+	void dump(std::ostream& stream, const Node& node, const std::string& indendation,
+			bool named) const;
+};
+
 }
 }
 }
@@ -18,41 +18,107 @@
  */
 
 #include "region.h"
+#include "regionstorage.h"
+#include "snapshot.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 namespace mapcrafter {
 namespace mc {
 
+ChunkData::ChunkData()
+	: ptr(nullptr), length(0) {
+}
+
+ChunkData::ChunkData(const uint8_t* data, size_t size)
+	: ptr(data), length(size) {
+}
+
+const uint8_t* ChunkData::data() const {
+	return ptr;
+}
+
+size_t ChunkData::size() const {
+	return length;
+}
+
+bool ChunkData::empty() const {
+	return length == 0;
+}
+
+/**
+ * Contents of a region file. Either the memory mapped file or a buffer with the
+ * contents of the file if memory mapping is not possible.
+ */
+struct RegionFileData {
+	boost::iostreams::mapped_file_source mapping;
+	std::vector<uint8_t> buffer;
+
+	const uint8_t* data;
+	size_t size;
+};
+
 RegionFile::RegionFile()
 	: rotation(0) {
+	std::fill(chunk_exists, chunk_exists + 1024, false);
+	std::fill(chunk_data_size, chunk_data_size + 1024, 0);
+	std::fill(chunk_data_pending, chunk_data_pending + 1024, false);
+	std::fill(chunk_timestamps, chunk_timestamps + 1024, 0);
 }
 
 RegionFile::RegionFile(const std::string& filename)
 	: filename(filename), rotation(0) {
 	regionpos_original = RegionPos::byFilename(filename);
 	regionpos = regionpos_original;
+	std::fill(chunk_exists, chunk_exists + 1024, false);
+	std::fill(chunk_data_size, chunk_data_size + 1024, 0);
+	std::fill(chunk_data_pending, chunk_data_pending + 1024, false);
+	std::fill(chunk_timestamps, chunk_timestamps + 1024, 0);
 }
 
 RegionFile::~RegionFile() {
 }
 
-bool RegionFile::readHeaders(std::ifstream& file, uint32_t chunk_offsets[1024]) {
-	if (!file)
-		return false;
-
+void RegionFile::clearHeaders() {
 	containing_chunks.clear();
 	for (int i = 0; i < 1024; i++) {
-		chunk_offsets[i] = 0;
 		chunk_exists[i] = false;
 		chunk_timestamps[i] = 0;
 		chunk_data_compression[i] = 0;
+		chunk_data_offset[i] = 0;
+		chunk_data_size[i] = 0;
+		chunk_data[i].clear();
+		chunk_data_pending[i] = false;
+		chunk_data_sectors[i] = 0;
 	}
+}
+
+bool RegionFile::addChunk(int x, int z, uint32_t timestamp) {
+	// get the original (not rotated) position of the chunk
+	ChunkPos chunkpos(x + regionpos_original.x * 32, z + regionpos_original.z * 32);
+	// check if this chunk is not cropped
+	if (!world_crop.isChunkContained(chunkpos))
+		return false;
+
+	// now rotate this chunk position for the public set with available chunks
+	if (rotation)
+		chunkpos.rotate(rotation);
+
+	chunk_exists[z * 32 + x] = true;
+	containing_chunks.insert(chunkpos);
+	chunk_timestamps[z * 32 + x] = timestamp;
+	return true;
+}
+
+bool RegionFile::readHeaders(const uint8_t* header, size_t filesize,
+		uint32_t chunk_offsets[1024]) {
+	clearHeaders();
+	std::fill(&chunk_offsets[0], &chunk_offsets[1024], 0);
 
-	file.seekg(0, std::ios::end);
-	size_t filesize = file.tellg();
-	file.seekg(0, std::ios::beg);
 	// make sure the region file has a header
 	if (filesize < 8192) {
 		LOG(ERROR) << "Corrupt region '" << filename << "': Header is too short.";
@@ -61,9 +127,8 @@ bool RegionFile::readHeaders(std::ifstream& file, uint32_t chunk_offsets[1024])
 
 	for (int x = 0; x < 32; x++) {
 		for (int z = 0; z < 32; z++) {
-			file.seekg(4 * (x + z * 32), std::ios::beg);
 			int tmp;
-			file.read(reinterpret_cast<char*>(&tmp), 4);
+			std::memcpy(&tmp, header + 4 * (x + z * 32), 4);
 			if (tmp == 0)
 				continue;
 			uint32_t offset = util::bigEndian32(tmp << 8) * 4096;
@@ -72,35 +137,90 @@ bool RegionFile::readHeaders(std::ifstream& file, uint32_t chunk_offsets[1024])
 						<< x << ":" << z << ".";
 				return false;
 			}
-			//uint8_t sectors = ((uint8_t*) &tmp)[3];
+			chunk_data_sectors[z * 32 + x] = reinterpret_cast<uint8_t*>(&tmp)[3];
 
-			file.seekg(4096, std::ios::cur);
 			uint32_t timestamp;
-			file.read(reinterpret_cast<char*>(&timestamp), 4);
+			std::memcpy(&timestamp, header + 4096 + 4 * (x + z * 32), 4);
 			timestamp = util::bigEndian32(timestamp);
 
-			// get the original (not rotated) position of the chunk
-			ChunkPos chunkpos(x + regionpos_original.x * 32, z + regionpos_original.z * 32);
-			// check if this chunk is not cropped
-			if (!world_crop.isChunkContained(chunkpos))
-				continue;
+			// set offset of this chunk if it's not cropped
+			if (addChunk(x, z, timestamp))
+				chunk_offsets[z * 32 + x] = offset;
+		}
+	}
+	return true;
+}
 
-			// now rotate this chunk position for the public set with available chunks
-			if (rotation)
-				chunkpos.rotate(rotation);
-			
-			chunk_exists[z * 32 + x] = true;
-			containing_chunks.insert(chunkpos);
-
-			// set offset and timestamp of this chunk
-			// now with the original coordinates again
-			chunk_offsets[z * 32 + x] = offset;
-			chunk_timestamps[z * 32 + x] = timestamp;
+bool RegionFile::readPendingChunkData(size_t index) const {
+	util::MemoryScope memory(util::MemorySubsystem::REGION_BUFFERS);
+	util::ProfileScope profile(util::ProfileStage::REGION_IO);
+	chunk_data_pending[index] = false;
+	if (!region_handle || !region_handle->isOpen())
+		return false;
+
+	int x = index % 32;
+	int z = index / 32;
+	size_t offset = chunk_data_offset[index];
+	size_t filesize = region_handle->getFilesize();
+
+	// read all sectors of the chunk at once, sectors have a size of 4096 bytes
+	// (but the chunk might be bigger than specified or the file too short)
+	size_t length = std::min(std::max<size_t>(chunk_data_sectors[index], 1) * 4096,
+			filesize - offset);
+	std::vector<uint8_t> sectors(length);
+	MAPCRAFTER_PROBE3(region__read__start, filename.c_str(), x, z);
+	if (!region_handle->read(offset, &sectors[0], length)) {
+		MAPCRAFTER_PROBE4(region__read__end, filename.c_str(), x, z, 0);
+		LOG(ERROR) << "Unable to read chunk " << x << ":" << z << " of region '"
+				<< filename << "'.";
+		return false;
+	}
+	MAPCRAFTER_PROBE4(region__read__end, filename.c_str(), x, z, length);
+
+	// get data size and compression type
+	uint32_t size;
+	std::memcpy(&size, &sectors[0], 4);
+	size = util::bigEndian32(size);
+	if (size == 0) {
+		LOG(ERROR)  << "Corrupt region '" << filename << "': Size of chunk "
+			<< x << ":" << z << " is zero.";
+		return false;
+	}
+	size -= 1;
+	if (filesize < offset + 5 + size) {
+		LOG(ERROR) << "Corrupt region '" << filename << "': Invalid size of chunk "
+			<< x << ":" << z << ".";
+		return false;
+	}
+
+	chunk_data_compression[index] = sectors[4];
+	std::vector<uint8_t>& data = chunk_data[index];
+	if (5 + size <= length) {
+		data.assign(sectors.begin() + 5, sectors.begin() + 5 + size);
+	} else {
+		data.resize(size);
+		std::copy(sectors.begin() + 5, sectors.end(), data.begin());
+		size_t remaining = size - (length - 5);
+		if (!region_handle->read(offset + length, &data[length - 5], remaining)) {
+			LOG(ERROR) << "Unable to read chunk " << x << ":" << z << " of region '"
+					<< filename << "'.";
+			data.clear();
+			return false;
 		}
 	}
 	return true;
 }
 
+ChunkData RegionFile::getChunkDataByIndex(size_t index) const {
+	if (chunk_data_pending[index])
+		readPendingChunkData(index);
+	if (!chunk_data[index].empty())
+		return ChunkData(chunk_data[index].data(), chunk_data[index].size());
+	if (chunk_data_size[index] == 0 || !region_data)
+		return ChunkData();
+	return ChunkData(region_data->data + chunk_data_offset[index], chunk_data_size[index]);
+}
+
 size_t RegionFile::getChunkIndex(const mc::ChunkPos& chunkpos) const {
 	ChunkPos unrotated = chunkpos;
 	if (rotation)
@@ -122,21 +242,74 @@ void RegionFile::setWorldCrop(const WorldCrop& world_crop) {
 	this->world_crop = world_crop;
 }
 
+void RegionFile::setCacheDir(const fs::path& cache_dir) {
+	this->cache_dir = cache_dir;
+}
+
+void RegionFile::setSnapshotFile(const std::string& snapshot_file) {
+	this->snapshot_file = snapshot_file;
+}
+
+void RegionFile::readSnapshot() {
+	snapshot.reset();
+	if (snapshot_file.empty())
+		return;
+	std::shared_ptr<RegionSnapshot> opened = std::make_shared<RegionSnapshot>();
+	if (opened->read(snapshot_file))
+		snapshot = opened;
+}
+
 bool RegionFile::read() {
-	std::ifstream file(filename.c_str(), std::ios_base::binary);
+	util::MemoryScope memory(util::MemorySubsystem::REGION_BUFFERS);
+	std::shared_ptr<RegionFileData> contents = std::make_shared<RegionFileData>();
+	try {
+		// an empty file can't be mapped, but it's corrupt anyways
+		if (!isRemotePath(filename) && fs::file_size(filename) >= 8192)
+			contents->mapping.open(filename);
+	} catch (const std::exception& e) {
+		LOG(DEBUG) << "Unable to memory map region '" << filename << "': " << e.what();
+	}
+
+	if (isRemotePath(filename)) {
+		std::shared_ptr<RegionReader> reader = openRegionReader(filename, cache_dir);
+		if (!reader->isOpen())
+			return false;
+		contents->buffer.resize(reader->getFilesize());
+		if (!contents->buffer.empty()
+				&& !reader->read(0, &contents->buffer[0], contents->buffer.size()))
+			return false;
+		contents->data = contents->buffer.data();
+		contents->size = contents->buffer.size();
+	} else if (contents->mapping.is_open()) {
+		contents->data = reinterpret_cast<const uint8_t*>(contents->mapping.data());
+		contents->size = contents->mapping.size();
+	} else {
+		std::ifstream file(filename.c_str(), std::ios_base::binary);
+		if (!file)
+			return false;
+		file.seekg(0, std::ios::end);
+		size_t filesize = file.tellg();
+		file.seekg(0, std::ios::beg);
+		contents->buffer.resize(filesize);
+		if (filesize > 0)
+			file.read(reinterpret_cast<char*>(&contents->buffer[0]), filesize);
+		if (!file)
+			return false;
+		contents->data = contents->buffer.data();
+		contents->size = filesize;
+	}
+
+	const uint8_t* regiondata = contents->data;
+	size_t filesize = contents->size;
 	uint32_t chunk_offsets[1024];
-	if (!readHeaders(file, chunk_offsets))
+	region_data.reset();
+	region_handle.reset();
+	if (!readHeaders(regiondata, filesize, chunk_offsets))
 		return false;
-	file.seekg(0, std::ios::end);
-	size_t filesize = file.tellg();
-	file.seekg(0, std::ios::beg);
-
-	std::vector<uint8_t> regiondata(filesize);
-	file.read(reinterpret_cast<char*>(&regiondata[0]), filesize);
 
 	for (int i = 0; i < 1024; i++) {
 		// get the offsets, where the chunk data starts
-		int offset = chunk_offsets[i];
+		uint32_t offset = chunk_offsets[i];
 		if (offset == 0)
 			continue;
 
@@ -145,7 +318,8 @@ bool RegionFile::read() {
 		int z = (i - x) / 32;
 
 		// get data size and compression type
-		uint32_t size = *(reinterpret_cast<uint32_t*>(&regiondata[offset]));
+		uint32_t size;
+		std::memcpy(&size, regiondata + offset, 4);
 		if (size == 0) {
 			LOG(ERROR)  << "Corrupt region '" << filename << "': Size of chunk "
 				<< x << ":" << z << " is zero.";
@@ -160,17 +334,102 @@ bool RegionFile::read() {
 		}
 
 		chunk_data_compression[i] = compression;
-		chunk_data[i].resize(size);
-		std::copy(&regiondata[offset+5], &regiondata[offset+5+size], chunk_data[i].begin());
+		chunk_data_offset[i] = offset + 5;
+		chunk_data_size[i] = size;
 	}
 
+	region_data = contents;
+	readSnapshot();
+	return true;
+}
+
+bool RegionFile::readLazily() {
+	util::MemoryScope memory(util::MemorySubsystem::REGION_BUFFERS);
+	util::ProfileScope profile(util::ProfileStage::REGION_IO);
+	region_data.reset();
+	region_handle = openRegionReader(filename, cache_dir);
+	if (!region_handle->isOpen())
+		return false;
+
+	size_t filesize = region_handle->getFilesize();
+	uint8_t header[8192];
+	if (filesize >= sizeof(header) && !region_handle->read(0, header, sizeof(header)))
+		return false;
+	uint32_t chunk_offsets[1024];
+	if (!readHeaders(header, filesize, chunk_offsets))
+		return false;
+
+	for (int i = 0; i < 1024; i++) {
+		if (chunk_offsets[i] == 0)
+			continue;
+		chunk_data_offset[i] = chunk_offsets[i];
+		chunk_data_pending[i] = true;
+	}
+	readSnapshot();
 	return true;
 }
 
+bool RegionFile::readHeaderFile(uint8_t header[8192], size_t& filesize) const {
+	std::shared_ptr<RegionReader> reader = openRegionReader(filename, cache_dir);
+	if (!reader->isOpen())
+		return false;
+	filesize = reader->getFilesize();
+	return reader->read(0, header, std::min(filesize, (size_t) 8192));
+}
+
 bool RegionFile::readOnlyHeaders() {
-	std::ifstream file(filename.c_str(), std::ios_base::binary);
+	uint8_t header[8192];
+	size_t filesize;
+	if (!readHeaderFile(header, filesize))
+		return false;
+	uint32_t chunk_offsets[1024];
+	region_data.reset();
+	region_handle.reset();
+	return readHeaders(header, filesize, chunk_offsets);
+}
+
+bool RegionFile::readOnlyHeaders(RegionIndex& index) {
+	std::time_t mtime;
+	uint64_t size;
+	if (!RegionIndex::stat(filename, mtime, size))
+		return readOnlyHeaders();
+
+	region_data.reset();
+	region_handle.reset();
+
+	// take the headers from the index if the region file was not modified
+	RegionIndex::Entry entry;
+	if (index.find(filename, mtime, size, entry)) {
+		clearHeaders();
+		for (int i = 0; i < 1024; i++)
+			if (entry.chunk_exists[i])
+				addChunk(i % 32, i / 32, entry.chunk_timestamps[i]);
+		return true;
+	}
+
+	uint8_t header[8192];
+	size_t filesize;
+	if (!readHeaderFile(header, filesize))
+		return false;
 	uint32_t chunk_offsets[1024];
-	return readHeaders(file, chunk_offsets);
+	if (!readHeaders(header, filesize, chunk_offsets))
+		return false;
+
+	// the index has the headers of the region file without world cropping
+	RegionIndex::Entry new_entry;
+	new_entry.mtime = mtime;
+	new_entry.size = size;
+	for (int i = 0; i < 1024; i++) {
+		uint32_t location, timestamp;
+		std::memcpy(&location, header + 4 * i, 4);
+		std::memcpy(&timestamp, header + 4096 + 4 * i, 4);
+		if (location == 0)
+			continue;
+		new_entry.chunk_exists[i] = true;
+		new_entry.chunk_timestamps[i] = util::bigEndian32(timestamp);
+	}
+	index.update(filename, new_entry);
+	return true;
 }
 
 bool RegionFile::write(std::string filename) const {
@@ -180,15 +439,19 @@ bool RegionFile::write(std::string filename) const {
 		throw std::invalid_argument("You have to specify a filename!");
 
 	uint32_t offsets[1024];
-	for (int i = 0; i < 1024; i++)
+	uint8_t sectors[1024];
+	for (int i = 0; i < 1024; i++) {
 		offsets[i] = 0;
+		sectors[i] = 0;
+	}
 
 	std::stringstream out_data, out_header;
 
 	// write chunk data to a temporary string stream
 	int position = 8192;
 	for (int i = 0; i < 1024; i++) {
-		if (chunk_data[i].size() == 0)
+		ChunkData data = getChunkDataByIndex(i);
+		if (data.empty())
 			continue;
 		// pad every chunk data with zeros to the next n*4096 bytes
 		if (position % 4096 != 0) {
@@ -200,9 +463,9 @@ bool RegionFile::write(std::string filename) const {
 
 		// calculate the offset, the chunk starts at 4096*offset bytes
 		offsets[i] = position / 4096;
+		sectors[i] = std::min<size_t>((data.size() + 5 + 4095) / 4096, 255);
 
 		// get chunk data, size and compression type
-		const std::vector<uint8_t>& data = chunk_data[i];
 		uint32_t size = data.size();
 		size = util::bigEndian32(size + 1);
 		uint8_t compression = chunk_data_compression[i];
@@ -210,13 +473,14 @@ bool RegionFile::write(std::string filename) const {
 		// append everything to the data
 		out_data.write(reinterpret_cast<char*>(&size), 4);
 		out_data.write(reinterpret_cast<char*>(&compression), 1);
-		out_data.write(reinterpret_cast<const char*>(&data[0]), data.size());
+		out_data.write(reinterpret_cast<const char*>(data.data()), data.size());
 		position += data.size() + 5;
 	}
 
 	// create the header with offsets and timestamps
 	for (int i = 0; i < 1024; i++) {
-		uint32_t offset_big_endian = util::bigEndian32(offsets[i]) >> 8;
+		uint32_t offset_big_endian = util::bigEndian32(offsets[i]) >> 8
+				| (uint32_t) sectors[i] << 24;
 		out_header.write(reinterpret_cast<char*>(&offset_big_endian), 4);
 	}
 
@@ -238,6 +502,10 @@ const std::string& RegionFile::getFilename() const {
 	return filename;
 }
 
+bool RegionFile::isMemoryMapped() const {
+	return region_data && region_data->mapping.is_open();
+}
+
 const RegionPos& RegionFile::getPos() const {
 	return regionpos;
 }
@@ -262,12 +530,16 @@ void RegionFile::setChunkTimestamp(const ChunkPos& chunk, uint32_t timestamp) {
 	chunk_timestamps[getChunkIndex(chunk)] = timestamp;
 }
 
-const std::vector<uint8_t>& RegionFile::getChunkData(const ChunkPos& chunk) const {
-	return chunk_data[getChunkIndex(chunk)];
+ChunkData RegionFile::getChunkData(const ChunkPos& chunk) const {
+	return getChunkDataByIndex(getChunkIndex(chunk));
 }
 
 uint8_t RegionFile::getChunkDataCompression(const ChunkPos& chunk) const {
-	return chunk_data_compression[getChunkIndex(chunk)];
+	size_t index = getChunkIndex(chunk);
+	// the compression type is stored with the data of the chunk
+	if (chunk_data_pending[index])
+		readPendingChunkData(index);
+	return chunk_data_compression[index];
 }
 
 void RegionFile::setChunkData(const ChunkPos& chunk, const std::vector<uint8_t>& data,
@@ -275,6 +547,9 @@ void RegionFile::setChunkData(const ChunkPos& chunk, const std::vector<uint8_t>&
 	size_t index = getChunkIndex(chunk);
 	chunk_data[index] = data;
 	chunk_data_compression[index] = compression;
+	// the chunk data from the region file is not used anymore
+	chunk_data_size[index] = 0;
+	chunk_data_pending[index] = false;
 
 	if (data.size() == 0) {
 		chunk_exists[index] = false;
@@ -285,15 +560,77 @@ void RegionFile::setChunkData(const ChunkPos& chunk, const std::vector<uint8_t>&
 	}
 }
 
+bool RegionFile::prefetchChunk(const ChunkPos& chunk) const {
+	size_t index = getChunkIndex(chunk);
+	if (!chunk_data_pending[index] || !region_handle || !region_handle->isOpen())
+		return true;
+
+	size_t offset = chunk_data_offset[index];
+	size_t length = std::min(std::max<size_t>(chunk_data_sectors[index], 1) * 4096,
+			region_handle->getFilesize() - offset);
+	std::vector<uint8_t> sectors(length);
+	return region_handle->read(offset, &sectors[0], length);
+}
+
+size_t RegionFile::readAheadChunks(const std::vector<ChunkPos>& chunks) const {
+	if (!region_handle || !region_handle->isOpen())
+		return 0;
+	size_t filesize = region_handle->getFilesize();
+	std::vector<std::pair<size_t, size_t> > ranges;
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		size_t index = getChunkIndex(*it);
+		if (!chunk_data_pending[index] || chunk_data_offset[index] >= filesize)
+			continue;
+		size_t offset = chunk_data_offset[index];
+		size_t length = std::min(std::max<size_t>(chunk_data_sectors[index], 1) * 4096,
+				filesize - offset);
+		ranges.push_back(std::make_pair(offset, offset + length));
+	}
+	std::sort(ranges.begin(), ranges.end());
+
+	// reading a gap of a few sectors is cheaper than seeking over it
+	const size_t MAX_GAP = 16 * 4096;
+	size_t bytes = 0;
+	for (size_t i = 0; i < ranges.size(); ) {
+		size_t begin = ranges[i].first, end = ranges[i].second;
+		for (i++; i < ranges.size() && ranges[i].first <= end + MAX_GAP; i++)
+			end = std::max(end, ranges[i].second);
+		region_handle->willNeed(begin, end - begin);
+		bytes += end - begin;
+	}
+	return bytes;
+}
+
 /**
  * This method tries to load a chunk from the region data and returns a status.
  */
-int RegionFile::loadChunk(const ChunkPos& pos, Chunk& chunk) {
+int RegionFile::loadChunk(const ChunkPos& pos, Chunk& chunk, bool unrotated) {
+	util::TraceScope trace("chunk load");
 	int index = getChunkIndex(pos);
 
+	// load the chunk from the render snapshot if it's up to date there,
+	// the region file data of the chunk isn't even read then
+	if (snapshot && chunk_exists[index]) {
+		ChunkData data = snapshot->getChunkData(index, chunk_timestamps[index]);
+		if (!data.empty()) {
+			chunk.setRotation(unrotated ? 0 : rotation);
+			chunk.setWorldCrop(world_crop);
+			util::MemoryScope memory(util::MemorySubsystem::CHUNK_CACHE);
+			if (chunk.readSnapshot(data.data(), data.size()))
+				return CHUNK_OK;
+			LOG(WARNING) << "Invalid snapshot data of chunk " << pos << ".";
+		}
+	}
+
+	// read the chunk data if the region is read lazily
+	if (chunk_data_pending[index] && !readPendingChunkData(index))
+		return CHUNK_DATA_INVALID;
+
 	// check if the chunk exists
-	if (chunk_data[index].size() == 0)
+	ChunkData data = getChunkDataByIndex(index);
+	if (data.empty())
 		return CHUNK_DOES_NOT_EXIST;
+	util::Profiler::addMetric(util::Metric::CHUNK_BYTES_READ, data.size());
 
 	// get compression type and size of the data
 	uint8_t compression = chunk_data_compression[index];
@@ -302,14 +639,14 @@ int RegionFile::loadChunk(const ChunkPos& pos, Chunk& chunk) {
 		comp = nbt::Compression::GZIP;
 	else if (compression == 2)
 		comp = nbt::Compression::ZLIB;
-	size_t size = chunk_data[index].size();
 
 	// set the chunk rotation
-	chunk.setRotation(rotation);
+	chunk.setRotation(unrotated ? 0 : rotation);
 	chunk.setWorldCrop(world_crop);
-	// try to load the chunk
+	// try to load the chunk, the decoded chunk data is counted for the chunk cache
+	util::MemoryScope memory(util::MemorySubsystem::CHUNK_CACHE);
 	try {
-		if (!chunk.readNBT(reinterpret_cast<char*>(&chunk_data[index][0]), size, comp))
+		if (!chunk.readNBT(reinterpret_cast<const char*>(data.data()), data.size(), comp))
 			return CHUNK_DATA_INVALID;
 	} catch (const nbt::NBTError& err) {
 		LOG(ERROR) << "Unable to read chunk at " << pos << " : " << err.what();
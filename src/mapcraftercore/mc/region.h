@@ -22,15 +22,47 @@
 
 #include "chunk.h"
 #include "pos.h"
+#include "regionindex.h"
 #include "worldcrop.h"
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
 
 namespace mapcrafter {
 namespace mc {
 
+/**
+ * A non-owning view of the raw (compressed) data of a chunk.
+ *
+ * It points either directly into the (memory mapped) region file or into chunk data
+ * set with RegionFile::setChunkData and is valid as long as the region file (or a
+ * copy of it) exists and the data of the chunk is not changed.
+ */
+class ChunkData {
+public:
+	ChunkData();
+	ChunkData(const uint8_t* data, size_t size);
+
+	const uint8_t* data() const;
+	size_t size() const;
+	bool empty() const;
+
+private:
+	const uint8_t* ptr;
+	size_t length;
+};
+
+// contents of a region file and an open handle to read chunks lazily,
+// both defined in region.cpp
+struct RegionFileData;
+class RegionReader;
+class RegionSnapshot;
+
 /**
  * This class represents a Minecraft region file.
  */
@@ -58,18 +90,48 @@ public:
 	 */
 	void setWorldCrop(const WorldCrop& world_crop);
 
+	/**
+	 * Sets the directory to cache the data of a remote region file in (see
+	 * openRegionReader), the data is not cached if it's empty.
+	 */
+	void setCacheDir(const fs::path& cache_dir);
+
+	/**
+	 * Sets the render snapshot file of the region (see RegionSnapshot), it's opened
+	 * when the region is read. The chunks are loaded from the snapshot if it has them
+	 * with the same timestamp, otherwise from the region file.
+	 */
+	void setSnapshotFile(const std::string& snapshot_file);
+
 	/**
 	 * Reads the whole region file with the data of all chunks. Returns false if the
 	 * region file is corrupted.
+	 *
+	 * The region file is memory mapped if possible, the chunk data is not copied then.
+	 * If the file can't be mapped, it is read into memory at once instead.
 	 */
 	bool read();
 
+	/**
+	 * Reads only the headers of the region file and keeps the file open. The data of a
+	 * chunk is read from the file the first time it is requested (with loadChunk or
+	 * getChunkData). Returns false if the region header is corrupted.
+	 */
+	bool readLazily();
+
 	/**
 	 * Reads only the headers (timestamps and which chunks exist) of the region file.
 	 * Returns false if the region header is corrupted (size < 8192).
 	 */
 	bool readOnlyHeaders();
 
+	/**
+	 * Same as readOnlyHeaders, but takes the headers from a region index if the region
+	 * file was not modified since the index entry was created, and updates the index
+	 * otherwise.
+	 */
+	bool readOnlyHeaders(RegionIndex& index);
+
 	/**
 	 * Writes the region to a file. You can also specify a different filename to write
 	 * the region file to.
@@ -81,6 +143,11 @@ public:
 	 */
 	const std::string& getFilename() const;
 
+	/**
+	 * Returns whether the data of the region file is memory mapped.
+	 */
+	bool isMemoryMapped() const;
+
 	/**
 	 * Returns the region position of the region file.
 	 */
@@ -108,10 +175,10 @@ public:
 	void setChunkTimestamp(const ChunkPos& chunk, uint32_t timestamp);
 
 	/**
-	 * Returns the raw (compressed) data of a specific chunk. Returns an empty array if
+	 * Returns the raw (compressed) data of a specific chunk. Returns an empty view if
 	 * the chunk does not exist.
 	 */
-	const std::vector<uint8_t>& getChunkData(const ChunkPos& chunk) const;
+	ChunkData getChunkData(const ChunkPos& chunk) const;
 
 	/**
 	 * Returns the type of the compressed chunk data (one byte, see specification of
@@ -128,10 +195,28 @@ public:
 			uint8_t compression);
 
 	/**
-	 * Loads a specific chunk into the supplied Chunk-object.
+	 * Reads the data of a chunk of a lazily read region file without keeping it. This
+	 * is used to get the data of a chunk into the page cache of the operating system
+	 * before it is actually needed. Returns false if reading the data failed.
+	 */
+	bool prefetchChunk(const ChunkPos& chunk) const;
+
+	/**
+	 * Tells the operating system that the data of some chunks of a lazily read region
+	 * file will be read soon, so it reads the data ahead in the background. The sectors
+	 * of the chunks are sorted by their offset and merged into few ranges (also over
+	 * small gaps between them), so they are read in one sequential pass over the file
+	 * instead of one seek per chunk. Returns the count of bytes read ahead.
+	 */
+	size_t readAheadChunks(const std::vector<ChunkPos>& chunks) const;
+
+	/**
+	 * Loads a specific chunk into the supplied Chunk-object. The chunk is loaded with the
+	 * rotation of the region, or with the original rotation of the world if unrotated is
+	 * set (the position of the chunk is still a rotated one).
 	 * Returns as integer one of the RegionFile::CHUNK_* status codes.
 	 */
-	int loadChunk(const ChunkPos& pos, Chunk& chunk);
+	int loadChunk(const ChunkPos& pos, Chunk& chunk, bool unrotated = false);
 
 private:
 	std::string filename;
@@ -141,6 +226,11 @@ private:
 	int rotation;
 	// and possible boundaries of the world
 	WorldCrop world_crop;
+	// cache directory for remote region files
+	fs::path cache_dir;
+	// the render snapshot file of the region and the opened snapshot, may be null
+	std::string snapshot_file;
+	std::shared_ptr<const RegionSnapshot> snapshot;
 
 	// a set with all available chunks
 	ChunkMap containing_chunks;
@@ -155,13 +245,58 @@ private:
 	uint32_t chunk_timestamps[1024];
 
 	// actual chunk data with compression type
-	uint8_t chunk_data_compression[1024];
-	std::vector<uint8_t> chunk_data[1024];
+	mutable uint8_t chunk_data_compression[1024];
+	// chunk data of the read region file as offsets into the region file data,
+	// (shared between copies of this object, it's never modified)
+	std::shared_ptr<const RegionFileData> region_data;
+	uint32_t chunk_data_offset[1024];
+	uint32_t chunk_data_size[1024];
+	// chunk data set with setChunkData or read lazily from the region file,
+	// takes precedence over the region file data
+	mutable std::vector<uint8_t> chunk_data[1024];
+
+	// open region file if it is read lazily, and which chunks were not read yet
+	// (chunk_data_offset is the offset of the chunk in the file until then)
+	std::shared_ptr<RegionReader> region_handle;
+	mutable bool chunk_data_pending[1024];
+	uint8_t chunk_data_sectors[1024];
+
+	/**
+	 * Reads the headers of a region file from a buffer with the first 8192 bytes of it.
+	 */
+	bool readHeaders(const uint8_t* header, size_t filesize, uint32_t chunk_offsets[1024]);
+
+	/**
+	 * Reads the first (up to) 8192 bytes of the region file into a buffer. Returns false
+	 * if the file can't be opened.
+	 */
+	bool readHeaderFile(uint8_t header[8192], size_t& filesize) const;
+
+	/**
+	 * Opens the render snapshot file if there is one.
+	 */
+	void readSnapshot();
+
+	/**
+	 * Resets the information about the chunks, as if the region has no chunks.
+	 */
+	void clearHeaders();
+
+	/**
+	 * Marks a chunk (local original coordinates) as existing if it's not cropped.
+	 * Returns whether the chunk is contained in the cropped world.
+	 */
+	bool addChunk(int x, int z, uint32_t timestamp);
+
+	/**
+	 * Reads the data of a chunk from the lazily read region file.
+	 */
+	bool readPendingChunkData(size_t index) const;
 
 	/**
-	 * Reads the headers of a region file.
+	 * Returns the data of a chunk by its index (see below).
 	 */
-	bool readHeaders(std::ifstream& file, uint32_t chunk_offsets[1024]);
+	ChunkData getChunkDataByIndex(size_t index) const;
 
 	/**
 	 * Calculates the index (chunk_* arrays) for a specific chunks.
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "regionindex.h"
+
+#include "../util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+
+namespace mapcrafter {
+namespace mc {
+
+namespace {
+
+// "MCRI" and version of the index file format, the byte order of the host is used,
+// version 2 added the scanned tiles of the tile sets, version 3 the broken regions and
+// chunks
+const uint32_t INDEX_MAGIC = 0x4d435249;
+const uint32_t INDEX_VERSION = 3;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}
+
+RegionIndex::Entry::Entry()
+	: mtime(0), size(0), broken(false), used(true) {
+	std::fill(&chunk_timestamps[0], &chunk_timestamps[1024], 0);
+}
+
+RegionIndex::RegionIndex() {
+}
+
+RegionIndex::~RegionIndex() {
+}
+
+bool RegionIndex::read(const std::string& filename) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	entries.clear();
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	uint32_t magic, version, count;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, count)
+			|| magic != INDEX_MAGIC || version < 1 || version > INDEX_VERSION)
+		return false;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint16_t name_length;
+		if (!readValue(in, name_length))
+			break;
+		std::string name(name_length, '\0');
+		int64_t mtime;
+		uint16_t chunks;
+		Entry entry;
+		if (!in.read(&name[0], name_length) || !readValue(in, mtime)
+				|| !readValue(in, entry.size) || !readValue(in, chunks) || chunks > 1024)
+			break;
+		entry.mtime = mtime;
+		entry.used = false;
+
+		// the existing chunks as (index, timestamp)
+		bool valid = true;
+		for (uint16_t j = 0; j < chunks && valid; j++) {
+			uint16_t index;
+			uint32_t timestamp;
+			valid = readValue(in, index) && readValue(in, timestamp) && index < 1024;
+			if (valid) {
+				entry.chunk_exists[index] = true;
+				entry.chunk_timestamps[index] = timestamp;
+			}
+		}
+
+		// the scanned tiles of the tile sets as (key, count of values, x/y/timestamp...)
+		uint16_t tile_sets = 0;
+		if (valid && version >= 2)
+			valid = readValue(in, tile_sets);
+		for (uint16_t j = 0; j < tile_sets && valid; j++) {
+			uint16_t key_length = 0;
+			uint32_t values;
+			valid = readValue(in, key_length);
+			std::string key(key_length, '\0');
+			valid = valid && in.read(&key[0], key_length) && readValue(in, values)
+					&& values % 3 == 0;
+			if (!valid)
+				break;
+			std::vector<int32_t>& tiles = entry.tiles[key];
+			tiles.resize(values);
+			valid = values == 0 || in.read(reinterpret_cast<char*>(&tiles[0]),
+					values * sizeof(int32_t));
+		}
+
+		// whether the region is broken and the broken chunks as (index)
+		uint8_t broken = 0;
+		uint16_t broken_chunks = 0;
+		if (valid && version >= 3)
+			valid = readValue(in, broken) && readValue(in, broken_chunks)
+				&& broken_chunks <= 1024;
+		entry.broken = broken != 0;
+		for (uint16_t j = 0; j < broken_chunks && valid; j++) {
+			uint16_t index;
+			valid = readValue(in, index) && index < 1024;
+			if (valid)
+				entry.chunk_broken[index] = true;
+		}
+		if (!valid)
+			break;
+		entries[name] = entry;
+	}
+
+	// a truncated index is not valid at all
+	if (entries.size() != count) {
+		entries.clear();
+		return false;
+	}
+	return true;
+}
+
+bool RegionIndex::write(const std::string& filename, bool drop_unused) const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// write to a temporary file first to not leave a broken index behind
+	std::string tmp_filename = filename + ".tmp";
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	uint32_t count = 0;
+	for (auto it = entries.begin(); it != entries.end(); ++it)
+		if (!drop_unused || it->second.used)
+			count++;
+	writeValue(out, INDEX_MAGIC);
+	writeValue(out, INDEX_VERSION);
+	writeValue(out, count);
+
+	for (auto it = entries.begin(); it != entries.end(); ++it) {
+		const Entry& entry = it->second;
+		if (drop_unused && !entry.used)
+			continue;
+		writeValue(out, (uint16_t) it->first.size());
+		out.write(it->first.c_str(), it->first.size());
+		writeValue(out, (int64_t) entry.mtime);
+		writeValue(out, entry.size);
+		writeValue(out, (uint16_t) entry.chunk_exists.count());
+		for (uint16_t i = 0; i < 1024; i++) {
+			if (!entry.chunk_exists[i])
+				continue;
+			writeValue(out, i);
+			writeValue(out, entry.chunk_timestamps[i]);
+		}
+		writeValue(out, (uint16_t) entry.tiles.size());
+		for (auto tiles_it = entry.tiles.begin(); tiles_it != entry.tiles.end(); ++tiles_it) {
+			const std::vector<int32_t>& tiles = tiles_it->second;
+			writeValue(out, (uint16_t) tiles_it->first.size());
+			out.write(tiles_it->first.c_str(), tiles_it->first.size());
+			writeValue(out, (uint32_t) tiles.size());
+			if (!tiles.empty())
+				out.write(reinterpret_cast<const char*>(&tiles[0]),
+						tiles.size() * sizeof(int32_t));
+		}
+		writeValue(out, (uint8_t) entry.broken);
+		writeValue(out, (uint16_t) entry.chunk_broken.count());
+		for (uint16_t i = 0; i < 1024; i++)
+			if (entry.chunk_broken[i])
+				writeValue(out, i);
+	}
+	out.close();
+	if (!out)
+		return false;
+	return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+bool RegionIndex::find(const std::string& region_file, std::time_t mtime,
+		uint64_t size, Entry& entry) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = entries.find(region_file);
+	if (it == entries.end())
+		return false;
+	// the entry is still needed, even if it's outdated, it's updated then
+	it->second.used = true;
+	if (it->second.mtime != mtime || it->second.size != size || it->second.broken)
+		return false;
+	entry.mtime = it->second.mtime;
+	entry.size = it->second.size;
+	entry.chunk_exists = it->second.chunk_exists;
+	std::copy(&it->second.chunk_timestamps[0], &it->second.chunk_timestamps[1024],
+			&entry.chunk_timestamps[0]);
+	entry.used = true;
+	return true;
+}
+
+void RegionIndex::update(const std::string& region_file, const Entry& entry) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	Entry& new_entry = entries[region_file];
+	// the broken chunks which weren't modified with the region file are still broken
+	std::bitset<1024> chunk_broken;
+	for (int i = 0; i < 1024; i++)
+		chunk_broken[i] = new_entry.chunk_broken[i] && entry.chunk_exists[i]
+				&& new_entry.chunk_timestamps[i] == entry.chunk_timestamps[i];
+	new_entry = entry;
+	new_entry.chunk_broken = chunk_broken;
+	new_entry.used = true;
+}
+
+bool RegionIndex::findTiles(const std::string& region_file, std::time_t mtime,
+		uint64_t size, const std::string& key, std::vector<int32_t>& tiles) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = entries.find(region_file);
+	if (it == entries.end())
+		return false;
+	it->second.used = true;
+	if (it->second.mtime != mtime || it->second.size != size)
+		return false;
+	auto tiles_it = it->second.tiles.find(key);
+	if (tiles_it == it->second.tiles.end())
+		return false;
+	tiles = tiles_it->second;
+	return true;
+}
+
+void RegionIndex::updateTiles(const std::string& region_file, std::time_t mtime,
+		uint64_t size, const std::string& key, const std::vector<int32_t>& tiles) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = entries.find(region_file);
+	if (it == entries.end() || it->second.mtime != mtime || it->second.size != size)
+		return;
+	it->second.tiles[key] = tiles;
+}
+
+bool RegionIndex::isRegionBroken(const std::string& region_file, std::time_t mtime,
+		uint64_t size) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = entries.find(region_file);
+	return it != entries.end() && it->second.broken && it->second.mtime == mtime
+			&& it->second.size == size;
+}
+
+void RegionIndex::setRegionBroken(const std::string& region_file, std::time_t mtime,
+		uint64_t size) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// the headers of a broken region file are useless
+	Entry& entry = entries[region_file];
+	entry = Entry();
+	entry.mtime = mtime;
+	entry.size = size;
+	entry.broken = true;
+}
+
+bool RegionIndex::findBrokenChunks(const std::string& region_file, std::time_t mtime,
+		uint64_t size, std::bitset<1024>& broken) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = entries.find(region_file);
+	if (it == entries.end() || it->second.mtime != mtime || it->second.size != size
+			|| it->second.chunk_broken.none())
+		return false;
+	broken = it->second.chunk_broken;
+	return true;
+}
+
+void RegionIndex::setChunkBroken(const std::string& region_file, std::time_t mtime,
+		uint64_t size, int index) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = entries.find(region_file);
+	if (it == entries.end() || it->second.mtime != mtime || it->second.size != size
+			|| it->second.broken || index < 0 || index >= 1024)
+		return;
+	it->second.chunk_broken[index] = true;
+}
+
+size_t RegionIndex::size() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return entries.size();
+}
+
+bool RegionIndex::stat(const std::string& region_file, std::time_t& mtime,
+		uint64_t& size) {
+	boost::system::error_code error;
+	mtime = fs::last_write_time(region_file, error);
+	if (!error)
+		size = fs::file_size(region_file, error);
+	return !error;
+}
+
+}
+}
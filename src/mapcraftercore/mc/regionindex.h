@@ -0,0 +1,165 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REGIONINDEX_H_
+#define REGIONINDEX_H_
+
+#include "../compat/thread.h"
+
+#include <bitset>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace mc {
+
+/**
+ * An index with the headers (which chunks exist and their timestamps) of region files.
+ *
+ * The index is persisted between the renderings. Scanning the tiles of a world needs
+ * only the headers of the region files, and the headers of region files which weren't
+ * modified since the last rendering (same modification time and size) are taken from
+ * the index instead of reading the region files again.
+ *
+ * The tile sets can store the render tiles they scanned from a region file in its entry
+ * as well, so the regions of unchanged region files don't have to be mapped to tiles
+ * again.
+ *
+ * The index also remembers the region files and chunks which turned out to be broken
+ * while rendering, so they aren't read (and reported) again and again by every thread
+ * and every rendering until they are modified.
+ *
+ * Looking up and updating entries is thread-safe, so multiple threads can scan regions
+ * with the same index.
+ */
+class RegionIndex {
+public:
+	/**
+	 * The headers of a region file. The chunks are indexed with z*32+x (local and
+	 * original, not rotated coordinates).
+	 */
+	struct Entry {
+		Entry();
+
+		std::time_t mtime;
+		uint64_t size;
+		std::bitset<1024> chunk_exists;
+		uint32_t chunk_timestamps[1024];
+
+		// the scanned render tiles of tile sets (key of the tile set -> tiles as
+		// x, y, timestamp), removed when the region file is modified
+		std::map<std::string, std::vector<int32_t> > tiles;
+
+		// whether the region file is broken, and the broken chunks, which are known to
+		// be broken as long as their timestamps don't change
+		bool broken;
+		std::bitset<1024> chunk_broken;
+
+		// whether the entry is still needed (looked up or updated since reading the index)
+		bool used;
+	};
+
+	RegionIndex();
+	~RegionIndex();
+
+	/**
+	 * Reads the index from a file. Returns false if the file does not exist or is not a
+	 * valid index file, the index is empty then.
+	 */
+	bool read(const std::string& filename);
+
+	/**
+	 * Writes the index to a file. Entries which were not used since reading the index
+	 * are dropped if drop_unused is set (for example regions which do not exist
+	 * anymore).
+	 */
+	bool write(const std::string& filename, bool drop_unused = true) const;
+
+	/**
+	 * Looks up the entry of a region file. Returns true and copies it (without the
+	 * scanned tiles) to entry if there is one and the region file has the specified
+	 * modification time and size.
+	 */
+	bool find(const std::string& region_file, std::time_t mtime, uint64_t size,
+			Entry& entry);
+
+	/**
+	 * Adds or replaces the entry of a region file.
+	 */
+	void update(const std::string& region_file, const Entry& entry);
+
+	/**
+	 * Looks up the scanned tiles of a tile set in the entry of a region file. Returns
+	 * false if there are none or the region file was modified.
+	 */
+	bool findTiles(const std::string& region_file, std::time_t mtime, uint64_t size,
+			const std::string& key, std::vector<int32_t>& tiles);
+
+	/**
+	 * Stores the scanned tiles of a tile set in the entry of a region file. They are
+	 * only stored if the entry has the specified modification time and size, i.e. the
+	 * tiles were scanned from the headers of the entry.
+	 */
+	void updateTiles(const std::string& region_file, std::time_t mtime, uint64_t size,
+			const std::string& key, const std::vector<int32_t>& tiles);
+
+	/**
+	 * Returns whether a region file with the specified modification time and size is
+	 * known to be broken, or marks it as broken.
+	 */
+	bool isRegionBroken(const std::string& region_file, std::time_t mtime, uint64_t size);
+	void setRegionBroken(const std::string& region_file, std::time_t mtime, uint64_t size);
+
+	/**
+	 * Returns the chunks of a region file known to be broken (index z*32+x, original
+	 * coordinates). Returns false if there are none or the region file was modified.
+	 */
+	bool findBrokenChunks(const std::string& region_file, std::time_t mtime, uint64_t size,
+			std::bitset<1024>& broken);
+
+	/**
+	 * Marks a chunk of a region file as broken. This is only remembered if the index has
+	 * the headers of the region file with the specified modification time and size.
+	 */
+	void setChunkBroken(const std::string& region_file, std::time_t mtime, uint64_t size,
+			int index);
+
+	/**
+	 * Returns the count of region files in the index.
+	 */
+	size_t size() const;
+
+	/**
+	 * Reads modification time and size of a region file. Returns false if the file
+	 * does not exist.
+	 */
+	static bool stat(const std::string& region_file, std::time_t& mtime, uint64_t& size);
+
+private:
+	mutable thread_ns::mutex mutex;
+	std::map<std::string, Entry> entries;
+};
+
+}
+}
+
+#endif /* REGIONINDEX_H_ */
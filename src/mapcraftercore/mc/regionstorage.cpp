@@ -0,0 +1,347 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "regionstorage.h"
+
+#include "../compat/thread.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <set>
+
+#ifdef HAVE_UNISTD_H
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace mapcrafter {
+namespace mc {
+
+bool isRemotePath(const std::string& path) {
+	return util::isHTTPURL(path);
+}
+
+RegionReader::~RegionReader() {
+}
+
+void RegionReader::willNeed(size_t offset, size_t size) {
+}
+
+namespace {
+
+/**
+ * A region file on the local filesystem. Uses pread where available so the threads
+ * reading from the file don't need to synchronize their reads.
+ */
+class LocalRegionReader : public RegionReader {
+public:
+	LocalRegionReader(const std::string& filename)
+		: filesize(0) {
+#ifdef HAVE_UNISTD_H
+		fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd != -1) {
+			off_t end = ::lseek(fd, 0, SEEK_END);
+			filesize = end < 0 ? 0 : end;
+		}
+#else
+		file.open(filename.c_str(), std::ios::binary);
+		if (file) {
+			file.seekg(0, std::ios::end);
+			filesize = file.tellg();
+		}
+#endif
+	}
+
+	virtual ~LocalRegionReader() {
+#ifdef HAVE_UNISTD_H
+		if (fd != -1)
+			::close(fd);
+#endif
+	}
+
+	virtual bool isOpen() const {
+#ifdef HAVE_UNISTD_H
+		return fd != -1;
+#else
+		return file.is_open();
+#endif
+	}
+
+	virtual size_t getFilesize() const {
+		return filesize;
+	}
+
+	virtual bool read(size_t offset, uint8_t* buffer, size_t size) {
+#ifdef HAVE_UNISTD_H
+		size_t done = 0;
+		while (done < size) {
+			ssize_t count = ::pread(fd, buffer + done, size - done, offset + done);
+			if (count <= 0)
+				return false;
+			done += count;
+		}
+		return true;
+#else
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		file.clear();
+		file.seekg(offset, std::ios::beg);
+		file.read(reinterpret_cast<char*>(buffer), size);
+		return !file.fail();
+#endif
+	}
+
+	virtual void willNeed(size_t offset, size_t size) {
+#if defined(HAVE_UNISTD_H) && defined(HAVE_POSIX_FADVISE)
+		if (fd != -1)
+			::posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+#endif
+	}
+
+private:
+	size_t filesize;
+#ifdef HAVE_UNISTD_H
+	int fd;
+#else
+	std::ifstream file;
+	thread_ns::mutex mutex;
+#endif
+};
+
+/**
+ * Sends a GET request for a http:// URL, optionally only for a range of bytes
+ * ("<first>-<last>"). Returns false if the server can't be reached or the response is
+ * invalid, but not if the status code says the request failed.
+ */
+bool httpGet(const std::string& url, const std::string& range,
+		util::HTTPResponse& response) {
+	std::map<std::string, std::string> headers;
+	if (!range.empty())
+		headers["Range"] = "bytes=" + range;
+	return util::httpRequest("GET", url, headers, "", response);
+}
+
+/**
+ * A region file on a HTTP server, see openRegionReader.
+ */
+class RemoteRegionReader : public RegionReader {
+public:
+	RemoteRegionReader(const std::string& url, const fs::path& cache_dir)
+		: url(url), opened(false), filesize(0) {
+		util::HTTPResponse response;
+		if (!httpGet(url, "0-8191", response))
+			return;
+		if (response.status == 206) {
+			// Content-Range: bytes 0-8191/<size of the file>
+			std::string content_range = response.getHeader("content-range");
+			size_t slash = content_range.rfind('/');
+			if (slash == std::string::npos) {
+				LOG(ERROR) << "Invalid response to the request of '" << url << "'.";
+				return;
+			}
+			filesize = std::strtoull(content_range.c_str() + slash + 1, nullptr, 10);
+			header = response.body;
+		} else if (response.status == 200) {
+			LOG(WARNING) << "The server of '" << url << "' doesn't support range "
+					<< "requests, reading the whole region file.";
+			filesize = response.body.size();
+			contents = response.body;
+		} else if (response.status == 416) {
+			// the file is empty
+			filesize = 0;
+		} else {
+			LOG(ERROR) << "Unable to request '" << url << "': HTTP status "
+					<< response.status << ".";
+			return;
+		}
+		opened = true;
+
+		if (!cache_dir.empty() && contents.empty()) {
+			std::string etag = response.getHeader("etag");
+			if (etag.empty())
+				etag = response.getHeader("last-modified");
+			openCache(cache_dir / url.substr(url.rfind('/') + 1),
+					etag + " " + util::str(filesize));
+		}
+	}
+
+	virtual ~RemoteRegionReader() {
+	}
+
+	virtual bool isOpen() const {
+		return opened;
+	}
+
+	virtual size_t getFilesize() const {
+		return filesize;
+	}
+
+	virtual bool read(size_t offset, uint8_t* buffer, size_t size) {
+		if (offset + size > filesize)
+			return false;
+		if (!contents.empty()) {
+			std::memcpy(buffer, contents.data() + offset, size);
+			return true;
+		}
+		if (offset + size <= header.size()) {
+			std::memcpy(buffer, header.data() + offset, size);
+			return true;
+		}
+		if (size == 0)
+			return true;
+
+		fs::path cache_file;
+		if (!cache_dir.empty()) {
+			cache_file = cache_dir / (util::str(offset) + "-" + util::str(size));
+			std::ifstream in(cache_file.string().c_str(), std::ios::binary);
+			if (in && in.read(reinterpret_cast<char*>(buffer), size))
+				return true;
+		}
+
+		util::HTTPResponse response;
+		if (!httpGet(url, util::str(offset) + "-" + util::str(offset + size - 1), response))
+			return false;
+		if (response.status != 206 || response.body.size() != size) {
+			LOG(ERROR) << "Unable to request bytes " << offset << "-" << offset + size - 1
+					<< " of '" << url << "': HTTP status " << response.status << ".";
+			return false;
+		}
+		std::memcpy(buffer, response.body.data(), size);
+
+		// write to a temporary file first, another thread might read the same sectors
+		if (!cache_file.empty()) {
+			fs::path tmp_file = cache_dir / fs::unique_path("%%%%%%%%.tmp");
+			std::ofstream out(tmp_file.string().c_str(), std::ios::binary);
+			out.write(response.body.data(), size);
+			out.close();
+			boost::system::error_code error;
+			if (out)
+				fs::rename(tmp_file, cache_file, error);
+			if (!out || error)
+				fs::remove(tmp_file, error);
+		}
+		return true;
+	}
+
+private:
+	/**
+	 * Uses a cache directory for the sectors of the region file. The files in the
+	 * directory are dropped if the region file was modified, i.e. the validator of the
+	 * region file (its ETag or modification time and its size) changed.
+	 */
+	void openCache(const fs::path& cache_dir, const std::string& validator) {
+		fs::path validator_file = cache_dir / "validator";
+		std::string cached_validator;
+		std::ifstream in(validator_file.string().c_str());
+		std::getline(in, cached_validator);
+		in.close();
+		if (cached_validator != validator) {
+			boost::system::error_code error;
+			fs::remove_all(cache_dir, error);
+			fs::create_directories(cache_dir, error);
+			std::ofstream out(validator_file.string().c_str());
+			out << validator << std::endl;
+			if (error || !out) {
+				LOG(WARNING) << "Unable to use cache directory " << cache_dir << ".";
+				return;
+			}
+		}
+		this->cache_dir = cache_dir;
+	}
+
+	std::string url;
+	fs::path cache_dir;
+
+	bool opened;
+	size_t filesize;
+	// the first 8192 bytes of the region file
+	std::string header;
+	// the whole region file if the server doesn't support range requests
+	std::string contents;
+};
+
+}
+
+std::shared_ptr<RegionReader> openRegionReader(const std::string& filename,
+		const fs::path& cache_dir) {
+	if (!isRemotePath(filename))
+		return std::make_shared<LocalRegionReader>(filename);
+
+	// the region files are opened again and again (by the tile set scanning, the world
+	// caches, the chunk prefetchers, ...), the recently opened remote region files are
+	// kept open so their headers are not requested every time
+	static thread_ns::mutex mutex;
+	static std::deque<std::pair<std::string, std::shared_ptr<RegionReader> > > recent;
+	std::string key = filename + "\n" + cache_dir.string();
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	for (auto it = recent.begin(); it != recent.end(); ++it) {
+		if (it->first == key) {
+			std::shared_ptr<RegionReader> reader = it->second;
+			recent.erase(it);
+			recent.push_front(std::make_pair(key, reader));
+			return reader;
+		}
+	}
+	lock.unlock();
+
+	std::shared_ptr<RegionReader> reader = std::make_shared<RemoteRegionReader>(
+			filename, cache_dir);
+	if (reader->isOpen()) {
+		lock.lock();
+		recent.push_front(std::make_pair(key, reader));
+		if (recent.size() > 64)
+			recent.pop_back();
+	}
+	return reader;
+}
+
+bool listRemoteRegions(const std::string& region_dir, std::vector<std::string>& filenames) {
+	util::HTTPResponse response;
+	if (!httpGet(region_dir + "/", "", response))
+		return false;
+	if (response.status != 200) {
+		LOG(ERROR) << "Unable to request '" << region_dir << "/': HTTP status "
+				<< response.status << ".";
+		return false;
+	}
+
+	// take everything from the listing that looks like the name of a region file
+	std::set<std::string> found;
+	const std::string& listing = response.body;
+	for (size_t i = listing.find("r."); i != std::string::npos; i = listing.find("r.", i + 1)) {
+		int x, z;
+		char filename[64];
+		if (std::sscanf(listing.c_str() + i, "r.%d.%d.mca", &x, &z) != 2)
+			continue;
+		std::snprintf(filename, sizeof(filename), "r.%d.%d.mca", x, z);
+		if (listing.compare(i, std::strlen(filename), filename) == 0)
+			found.insert(filename);
+	}
+	filenames.assign(found.begin(), found.end());
+	return true;
+}
+
+}
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REGIONSTORAGE_H_
+#define REGIONSTORAGE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace mc {
+
+/**
+ * Returns whether a world or region file is not on the local filesystem, but on a HTTP
+ * server (i.e. the path is a URL starting with "http://").
+ */
+bool isRemotePath(const std::string& path);
+
+/**
+ * An open region file to read chunk data from. Copies of a region file share one reader,
+ * so it must be possible to read from multiple threads at the same time.
+ */
+class RegionReader {
+public:
+	virtual ~RegionReader();
+
+	/**
+	 * Returns whether the region file could be opened.
+	 */
+	virtual bool isOpen() const = 0;
+
+	/**
+	 * Returns the size of the region file in bytes.
+	 */
+	virtual size_t getFilesize() const = 0;
+
+	/**
+	 * Reads size bytes at a specific offset of the file. Returns false if not all
+	 * bytes could be read.
+	 */
+	virtual bool read(size_t offset, uint8_t* buffer, size_t size) = 0;
+
+	/**
+	 * Tells that size bytes at a specific offset of the file will be read soon, so they
+	 * can be read ahead in the background. Does nothing by default.
+	 */
+	virtual void willNeed(size_t offset, size_t size);
+};
+
+/**
+ * Opens a region file for reading, either a local file or a remote one on a HTTP server.
+ *
+ * Remote region files are read with HTTP range requests: Opening the file requests only
+ * the 8192 bytes of the header, reading the chunk data then requests only the sectors
+ * of the chunk. The server has to support range requests, otherwise the whole file is
+ * downloaded once. The requested sectors are cached in a directory for the region file
+ * in the specified cache directory (if it's not empty), the cache of a region file is
+ * dropped when the file was modified on the server (ETag/Last-Modified header or size).
+ * The recently opened remote region files are reused, so the changes of a region file
+ * on the server are not seen while it's being rendered.
+ */
+std::shared_ptr<RegionReader> openRegionReader(const std::string& filename,
+		const fs::path& cache_dir = fs::path());
+
+/**
+ * Gets the filenames of the region files (r.<x>.<z>.mca) of a remote region directory
+ * from the directory listing the HTTP server sends for the URL of the directory.
+ * Returns false if the directory listing can't be requested.
+ */
+bool listRemoteRegions(const std::string& region_dir, std::vector<std::string>& filenames);
+
+}
+}
+
+#endif /* REGIONSTORAGE_H_ */
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.h"
+
+#include "../util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace mc {
+
+namespace {
+
+// "MCSS" and version of the snapshot file format, the byte order of the host is used
+const uint32_t SNAPSHOT_MAGIC = 0x4d435353;
+const uint32_t SNAPSHOT_VERSION = 1;
+
+// magic, version and offset, size, timestamp and hash of every chunk
+const size_t ENTRY_SIZE = 4 + 4 + 4 + 8;
+const size_t HEADER_SIZE = 8 + 1024 * ENTRY_SIZE;
+
+}
+
+RegionSnapshot::RegionSnapshot()
+	: data(nullptr), size(0) {
+	std::fill(chunk_sizes, chunk_sizes + 1024, 0);
+}
+
+RegionSnapshot::~RegionSnapshot() {
+}
+
+bool RegionSnapshot::read(const std::string& filename) {
+	data = nullptr;
+	size = 0;
+	std::fill(chunk_sizes, chunk_sizes + 1024, 0);
+	boost::system::error_code error;
+	if (!fs::is_regular_file(filename, error) || fs::file_size(filename, error) < HEADER_SIZE)
+		return false;
+
+	try {
+		mapping.open(filename);
+		data = reinterpret_cast<const uint8_t*>(mapping.data());
+		size = mapping.size();
+	} catch (const std::exception& e) {
+		LOG(DEBUG) << "Unable to memory map snapshot '" << filename << "': " << e.what();
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		in.seekg(0, std::ios::end);
+		buffer.resize(in.tellg());
+		in.seekg(0, std::ios::beg);
+		if (!in.read(reinterpret_cast<char*>(&buffer[0]), buffer.size()))
+			return false;
+		data = buffer.data();
+		size = buffer.size();
+	}
+
+	uint32_t magic, version;
+	std::memcpy(&magic, data, 4);
+	std::memcpy(&version, data + 4, 4);
+	if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION)
+		return false;
+	for (size_t i = 0; i < 1024; i++) {
+		const uint8_t* entry = data + 8 + i * ENTRY_SIZE;
+		std::memcpy(&chunk_offsets[i], entry, 4);
+		std::memcpy(&chunk_sizes[i], entry + 4, 4);
+		std::memcpy(&chunk_timestamps[i], entry + 8, 4);
+		std::memcpy(&chunk_hashes[i], entry + 12, 8);
+		if (chunk_sizes[i] != 0 && (chunk_offsets[i] < HEADER_SIZE
+				|| chunk_offsets[i] > size || size - chunk_offsets[i] < chunk_sizes[i])) {
+			LOG(WARNING) << "Corrupt snapshot '" << filename << "': Invalid chunk offset.";
+			std::fill(chunk_sizes, chunk_sizes + 1024, 0);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RegionSnapshot::hasChunk(size_t index) const {
+	return chunk_sizes[index] != 0;
+}
+
+bool RegionSnapshot::hasChunk(size_t index, uint32_t timestamp) const {
+	return chunk_sizes[index] != 0 && chunk_timestamps[index] == timestamp;
+}
+
+ChunkData RegionSnapshot::getChunkData(size_t index, uint32_t timestamp) const {
+	if (!hasChunk(index, timestamp))
+		return ChunkData();
+	return ChunkData(data + chunk_offsets[index], chunk_sizes[index]);
+}
+
+uint64_t RegionSnapshot::getChunkHash(size_t index) const {
+	return chunk_sizes[index] != 0 ? chunk_hashes[index] : 0;
+}
+
+bool convertRegionSnapshot(const std::string& region_file,
+		const std::string& snapshot_file, int& decoded, int& reused) {
+	RegionFile region(region_file);
+	if (!region.read())
+		return false;
+	RegionSnapshot previous;
+	bool has_previous = previous.read(snapshot_file);
+
+	// the snapshot data, timestamps and hashes of the chunks
+	std::vector<std::vector<uint8_t> > chunk_data(1024);
+	uint32_t chunk_timestamps[1024];
+	uint64_t chunk_hashes[1024];
+	std::fill(chunk_timestamps, chunk_timestamps + 1024, 0);
+	std::fill(chunk_hashes, chunk_hashes + 1024, 0);
+	int region_decoded = 0, region_reused = 0;
+	bool changed = !has_previous;
+
+	const RegionFile::ChunkMap& chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		size_t index = it->getLocalZ() * 32 + it->getLocalX();
+		uint32_t timestamp = region.getChunkTimestamp(*it);
+		if (has_previous && previous.hasChunk(index, timestamp)) {
+			ChunkData data = previous.getChunkData(index, timestamp);
+			chunk_data[index].assign(data.data(), data.data() + data.size());
+			chunk_hashes[index] = previous.getChunkHash(index);
+			region_reused++;
+		} else {
+			Chunk chunk;
+			if (region.loadChunk(*it, chunk) != RegionFile::CHUNK_OK) {
+				LOG(WARNING) << "Unable to convert chunk " << *it << " of region '"
+						<< region_file << "'.";
+				continue;
+			}
+			chunk.writeSnapshot(chunk_data[index]);
+			chunk_hashes[index] = chunk.getContentHash();
+			region_decoded++;
+			changed = true;
+		}
+		chunk_timestamps[index] = timestamp;
+	}
+	// chunks removed from the region file change the snapshot too
+	for (size_t i = 0; i < 1024 && !changed; i++)
+		if (previous.hasChunk(i) && chunk_data[i].empty())
+			changed = true;
+	decoded += region_decoded;
+	reused += region_reused;
+	if (!changed)
+		return true;
+
+	std::string tmp_filename = snapshot_file + ".tmp";
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+	out.write(reinterpret_cast<const char*>(&SNAPSHOT_MAGIC), 4);
+	out.write(reinterpret_cast<const char*>(&SNAPSHOT_VERSION), 4);
+	uint32_t offset = HEADER_SIZE;
+	for (size_t i = 0; i < 1024; i++) {
+		uint32_t chunk_size = chunk_data[i].size();
+		out.write(reinterpret_cast<const char*>(&offset), 4);
+		out.write(reinterpret_cast<const char*>(&chunk_size), 4);
+		out.write(reinterpret_cast<const char*>(&chunk_timestamps[i]), 4);
+		out.write(reinterpret_cast<const char*>(&chunk_hashes[i]), 8);
+		offset += chunk_size;
+	}
+	for (size_t i = 0; i < 1024; i++)
+		if (!chunk_data[i].empty())
+			out.write(reinterpret_cast<const char*>(chunk_data[i].data()),
+					chunk_data[i].size());
+	out.close();
+	if (!out) {
+		std::remove(tmp_filename.c_str());
+		return false;
+	}
+	return std::rename(tmp_filename.c_str(), snapshot_file.c_str()) == 0;
+}
+
+}
+}
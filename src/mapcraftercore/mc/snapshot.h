@@ -0,0 +1,100 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "region.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace mapcrafter {
+namespace mc {
+
+/**
+ * The render snapshot of a region file (r.<x>.<z>.mcs), created by mapcrafter_snapshot.
+ *
+ * It has the chunks of the region already decoded (see Chunk::writeSnapshot), in the
+ * original rotation and without world crop, so loading a chunk from it is only copying
+ * (and rotating and cropping) its sections instead of inflating and parsing the NBT
+ * data. The file is memory mapped. A chunk of the snapshot is only used if it has the
+ * same timestamp as the chunk in the region file, other chunks are still loaded from
+ * the region file.
+ *
+ * The file starts with a header with the offset, size, timestamp and content hash (see
+ * Chunk::getContentHash) of every chunk, the data of the chunks follows. The byte order
+ * of the host is used, snapshots of hosts with another byte order are ignored.
+ */
+class RegionSnapshot {
+public:
+	RegionSnapshot();
+	~RegionSnapshot();
+
+	/**
+	 * Opens a snapshot file. Returns false if the file does not exist or is not a valid
+	 * snapshot file.
+	 */
+	bool read(const std::string& filename);
+
+	/**
+	 * Returns whether the snapshot has a chunk (local original coordinates as index
+	 * z*32+x), optionally with the specified timestamp.
+	 */
+	bool hasChunk(size_t index) const;
+	bool hasChunk(size_t index, uint32_t timestamp) const;
+
+	/**
+	 * Returns the snapshot data of a chunk, an empty view if the snapshot doesn't have
+	 * the chunk with the specified timestamp.
+	 */
+	ChunkData getChunkData(size_t index, uint32_t timestamp) const;
+
+	/**
+	 * Returns the content hash of a chunk (0 if the snapshot doesn't have the chunk).
+	 */
+	uint64_t getChunkHash(size_t index) const;
+
+private:
+	boost::iostreams::mapped_file_source mapping;
+	std::vector<uint8_t> buffer;
+	const uint8_t* data;
+	size_t size;
+
+	uint32_t chunk_offsets[1024], chunk_sizes[1024], chunk_timestamps[1024];
+	uint64_t chunk_hashes[1024];
+};
+
+/**
+ * Converts a region file into its render snapshot file. The chunks which have the same
+ * timestamp in an already existing snapshot file are taken from it, the snapshot file is
+ * only written if chunks changed (it's replaced atomically, so a running rendering can
+ * still use the old one). The counts of decoded and reused chunks are added to the
+ * specified counters. Returns false if the region can't be read or the snapshot can't
+ * be written.
+ */
+bool convertRegionSnapshot(const std::string& region_file,
+		const std::string& snapshot_file, int& decoded, int& reused);
+
+}
+}
+
+#endif /* SNAPSHOT_H_ */
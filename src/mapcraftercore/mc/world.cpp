@@ -18,11 +18,15 @@
  */
 
 #include "world.h"
+#include "regionstorage.h"
+#include "../compat/thread.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <map>
 
 namespace mapcrafter {
 namespace mc {
@@ -37,8 +41,70 @@ std::ostream& operator<<(std::ostream& out, Dimension dimension) {
 	return out;
 }
 
+RegionDirectory::RegionDirectory()
+	: modification_time(0), read_time(0) {
+}
+
+RegionDirectory::~RegionDirectory() {
+}
+
+std::shared_ptr<const RegionDirectory> RegionDirectory::get(const fs::path& region_dir) {
+	static thread_ns::mutex mutex;
+	static std::map<std::string, std::shared_ptr<const RegionDirectory> > cache;
+
+	boost::system::error_code error;
+	std::time_t modification_time = fs::last_write_time(region_dir, error);
+	if (error || !fs::is_directory(region_dir, error))
+		return std::shared_ptr<const RegionDirectory>();
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// the modification time has only a resolution of seconds, a directory modified in
+	// the second it was read might have changed after reading it
+	std::shared_ptr<const RegionDirectory>& cached = cache[region_dir.string()];
+	if (cached && cached->modification_time == modification_time
+			&& cached->modification_time < cached->read_time)
+		return cached;
+
+	std::shared_ptr<RegionDirectory> directory(new RegionDirectory);
+	directory->modification_time = modification_time;
+	directory->read_time = std::time(nullptr);
+	fs::directory_iterator it(region_dir, error);
+	for (; !error && it != fs::directory_iterator(); it.increment(error))
+		directory->addRegion(it->path().string(), BOOST_FS_FILENAME(it->path()));
+	if (error)
+		return std::shared_ptr<const RegionDirectory>();
+	cached = directory;
+	return cached;
+}
+
+std::shared_ptr<const RegionDirectory> RegionDirectory::create(
+		const std::string& region_dir, const std::vector<std::string>& filenames) {
+	std::shared_ptr<RegionDirectory> directory(new RegionDirectory);
+	for (auto it = filenames.begin(); it != filenames.end(); ++it)
+		directory->addRegion(region_dir + "/" + *it, *it);
+	return directory;
+}
+
+const RegionDirectory::RegionMap& RegionDirectory::getRegionFiles() const {
+	return region_files;
+}
+
+void RegionDirectory::addRegion(const std::string& region_file,
+		const std::string& filename) {
+	std::string ending = ".mca";
+	if (filename.size() < ending.size()
+			|| !std::equal(ending.rbegin(), ending.rend(), filename.rbegin()))
+		return;
+	int x = 0;
+	int z = 0;
+	if(sscanf(filename.c_str(), "r.%d.%d.mca", &x, &z) != 2)
+		return;
+	region_files[RegionPos(x, z)] = region_file;
+}
+
 World::World(std::string world_dir, Dimension dimension)
-	: world_dir(world_dir), dimension(dimension), rotation(0) {
+	: world_dir(world_dir), dimension(dimension), rotation(0),
+	  available_regions(new AvailableRegions) {
 	std::string world_name = BOOST_FS_FILENAME(this->world_dir);
 
 	// try to find the region directory
@@ -62,30 +128,21 @@ World::World(std::string world_dir, Dimension dimension)
 World::~World() {
 }
 
-bool World::readRegions(const fs::path& region_dir) {
-	if(!fs::exists(region_dir))
-		return false;
-	std::string ending = ".mca";
-	for(fs::directory_iterator it(region_dir); it != fs::directory_iterator(); ++it) {
-		std::string region_file = (*it).path().string();
-		std::string filename = BOOST_FS_FILENAME((*it).path());
-
-		if(!std::equal(ending.rbegin(), ending.rend(), filename.rbegin()))
-			continue;
-		int x = 0;
-		int z = 0;
-		if(sscanf(filename.c_str(), "r.%d.%d.mca", &x, &z) != 2)
-			continue;
-		RegionPos pos(x, z);
+void World::setRegions(std::shared_ptr<const RegionDirectory> directory) {
+	std::shared_ptr<AvailableRegions> regions(new AvailableRegions);
+	regions->directory = directory;
+	const RegionDirectory::RegionMap& region_files = directory->getRegionFiles();
+	for (auto it = region_files.begin(); it != region_files.end(); ++it) {
+		RegionPos pos = it->first;
 		// check if we should not crop this region
 		if (!world_crop.isRegionContained(pos))
 			continue;
 		if (rotation)
 			pos.rotate(rotation);
-		available_regions.insert(pos);
-		region_files[pos] = it->path().string();
+		regions->positions.insert(pos);
+		regions->files[pos] = &it->second;
 	}
-	return true;
+	available_regions = regions;
 }
 
 fs::path World::getWorldDir() const {
@@ -117,46 +174,88 @@ void World::setWorldCrop(const WorldCrop& world_crop) {
 	this->world_crop = world_crop;
 }
 
+bool World::isRemote() const {
+	return isRemotePath(world_dir.string());
+}
+
+fs::path World::getCacheDir() const {
+	return cache_dir;
+}
+
+void World::setCacheDir(const fs::path& cache_dir) {
+	this->cache_dir = cache_dir;
+}
+
+fs::path World::getSnapshotDir() const {
+	return snapshot_dir;
+}
+
+void World::setSnapshotDir(const fs::path& snapshot_dir) {
+	this->snapshot_dir = snapshot_dir;
+}
+
+fs::path World::getSnapshotPath(const fs::path& snapshot_dir,
+		const std::string& region_file) {
+	// r.<x>.<z>.mca -> r.<x>.<z>.mcs
+	return snapshot_dir / (fs::path(region_file).stem().string() + ".mcs");
+}
+
 bool World::load() {
+	if (isRemote()) {
+		std::vector<std::string> filenames;
+		if (!listRemoteRegions(region_dir.string(), filenames)) {
+			std::cerr << "Error: Unable to list the region files of " << region_dir;
+			std::cerr << "!" << std::endl;
+			return false;
+		}
+		setRegions(RegionDirectory::create(region_dir.string(), filenames));
+		return true;
+	}
+
 	if(!fs::exists(world_dir)) {
 		std::cerr << "Error: World directory " << world_dir;
 		std::cerr << " does not exist!" << std::endl;
 		return false;
 	}
 
-	if(!fs::exists(region_dir)) {
+	std::shared_ptr<const RegionDirectory> directory = RegionDirectory::get(region_dir);
+	if (!directory) {
 		std::cerr << "Error: Region directory " << region_dir << " does not exist!" << std::endl;
 		return false;
 	}
-
-	return readRegions(region_dir.string());
+	setRegions(directory);
+	return true;
 }
 
 int World::getAvailableRegionCount() const {
-	return available_regions.size();
+	return available_regions->positions.size();
 }
 
 const World::RegionSet& World::getAvailableRegions() const {
-	return available_regions;
+	return available_regions->positions;
 }
 
 bool World::hasRegion(const RegionPos& pos) const {
-	return available_regions.count(pos) != 0;
+	return available_regions->positions.count(pos) != 0;
 }
 
 fs::path World::getRegionPath(const RegionPos& pos) const {
-	if (!hasRegion(pos))
+	auto it = available_regions->files.find(pos);
+	if (it == available_regions->files.end())
 		return fs::path();
-	return fs::path(region_files.at(pos));
+	return fs::path(*it->second);
 }
 
 bool World::getRegion(const RegionPos& pos, RegionFile& region) const {
-	RegionMap::const_iterator it = region_files.find(pos);
-	if (it == region_files.end())
+	auto it = available_regions->files.find(pos);
+	if (it == available_regions->files.end())
 		return false;
-	region = RegionFile(it->second);
+	region = RegionFile(*it->second);
 	region.setRotation(rotation);
 	region.setWorldCrop(world_crop);
+	region.setCacheDir(cache_dir);
+	if (!snapshot_dir.empty())
+		region.setSnapshotFile(getSnapshotPath(snapshot_dir, *it->second).string());
 	return true;
 }
 
@@ -25,10 +25,13 @@
 #include "region.h"
 #include "worldcrop.h"
 
+#include <ctime>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -60,6 +63,53 @@ struct hash_function {
 	}
 };
 
+/**
+ * The region files (r.<x>.<z>.mca) of a region directory with their positions in the
+ * original rotation, the world crop is not applied yet.
+ *
+ * The index of a local region directory is read once and shared by all World objects of
+ * the directory (all rotations, and the copies of the render threads). It's immutable,
+ * if the modification time of the directory changed (region files were added or
+ * removed), the directory is read again into a new index, and the worlds loaded
+ * afterwards use the new one.
+ */
+class RegionDirectory {
+public:
+	typedef std::unordered_map<RegionPos, std::string, hash_function> RegionMap;
+
+	RegionDirectory();
+	~RegionDirectory();
+
+	/**
+	 * Returns the index of a local region directory, a cached one if the directory
+	 * wasn't modified since it was read. Returns a null pointer if the directory does
+	 * not exist.
+	 */
+	static std::shared_ptr<const RegionDirectory> get(const fs::path& region_dir);
+
+	/**
+	 * Returns the index of the region files with the specified filenames in a (remote)
+	 * region directory, it's not cached.
+	 */
+	static std::shared_ptr<const RegionDirectory> create(const std::string& region_dir,
+			const std::vector<std::string>& filenames);
+
+	/**
+	 * Returns the positions of the region files and their paths.
+	 */
+	const RegionMap& getRegionFiles() const;
+
+private:
+	RegionMap region_files;
+	// modification time of the directory and the time it was read
+	std::time_t modification_time, read_time;
+
+	/**
+	 * Adds a region file with the specified filename (r.<x>.<z>.mca) to the index.
+	 */
+	void addRegion(const std::string& region_file, const std::string& filename);
+};
+
 /**
  * This class represents a Minecraft World.
  *
@@ -69,7 +119,6 @@ struct hash_function {
 class World {
 public:
 	typedef std::unordered_set<RegionPos, hash_function> RegionSet;
-	typedef std::unordered_map<RegionPos, std::string, hash_function> RegionMap;
 
 	/**
 	 * Constructor. You should specify a world directory and you can specify a dimension
@@ -107,9 +156,37 @@ public:
 	WorldCrop getWorldCrop() const;
 	void setWorldCrop(const WorldCrop& world_crop);
 
+	/**
+	 * Returns whether the world is on a HTTP server (i.e. the world directory is a
+	 * http:// URL).
+	 */
+	bool isRemote() const;
+
+	/**
+	 * Returns/Sets the directory to cache the data of a remote world in, see
+	 * openRegionReader. Nothing is cached if it's empty.
+	 */
+	fs::path getCacheDir() const;
+	void setCacheDir(const fs::path& cache_dir);
+
+	/**
+	 * Returns/Sets the directory with the render snapshots of the region files (see
+	 * RegionSnapshot), no snapshots are used if it's empty.
+	 */
+	fs::path getSnapshotDir() const;
+	void setSnapshotDir(const fs::path& snapshot_dir);
+
+	/**
+	 * Returns the path of the render snapshot file of a region file.
+	 */
+	static fs::path getSnapshotPath(const fs::path& snapshot_dir,
+			const std::string& region_file);
+
 	/**
 	 * Loads a world from the specified directory. Returns false if the world- or region
-	 * directory does not exist.
+	 * directory does not exist. The region files of a remote world are taken from the
+	 * directory listing of the region directory, the ones of a local world from the
+	 * shared index of the region directory (see RegionDirectory).
 	 */
 	bool load();
 
@@ -149,17 +226,27 @@ private:
 	// rotation and possible boundaries of the world
 	int rotation;
 	WorldCrop world_crop;
+	// cache directory of a remote world
+	fs::path cache_dir;
+	// directory of the render snapshots
+	fs::path snapshot_dir;
 
-	// (hash-) set containing positions of available region files
-	RegionSet available_regions;
-	// (hash-) map containing positions of available region files and their file paths
-	RegionMap region_files;
+	/**
+	 * The available regions of the world (rotated and cropped) and their region files in
+	 * the index of the region directory. They don't change after loading the world, so
+	 * the copies of a world share them.
+	 */
+	struct AvailableRegions {
+		std::shared_ptr<const RegionDirectory> directory;
+		RegionSet positions;
+		std::unordered_map<RegionPos, const std::string*, hash_function> files;
+	};
+	std::shared_ptr<const AvailableRegions> available_regions;
 
 	/**
-	 * Scans a directory for Anvil *.mca region files and adds them to the available
-	 * region files. Returns false if the directory does not exist.
+	 * Takes the available regions from the index of a region directory.
 	 */
-	bool readRegions(const fs::path& region_dir);
+	void setRegions(std::shared_ptr<const RegionDirectory> directory);
 };
 
 }
@@ -19,6 +19,10 @@
 
 #include "worldcache.h"
 
+#include "worldentities.h"
+
+#include <chrono>
+
 namespace mapcrafter {
 namespace mc {
 
@@ -41,48 +45,136 @@ bool Block::isStairs() const {
 	return id == 53 || id == 67 || id == 108 || id == 109 || id == 114 || id == 128 || id == 134 || id == 135 || id == 136 || id == 156 || id == 163 || id == 164 || id == 180 || id == 203;
 }
 
-WorldCache::WorldCache() {
-	for (int i = 0; i < RSIZE; i++)
-		regioncache[i].used = false;
-	for (int i = 0; i < CSIZE; i++)
-		chunkcache[i].used = false;
+namespace {
+
+/**
+ * Looks for the entry with the specified key in the n-th set (with the specified count
+ * of entries per set) of a set-associative cache.
+ *
+ * Returns the entry if it is found and sets found to true. Otherwise returns the entry
+ * of the set which should be replaced with the key: an unused entry if there is one,
+ * or the least recently used one.
+ */
+template <typename Key, typename Value>
+CacheEntry<Key, Value>& findCacheEntry(std::vector<CacheEntry<Key, Value> >& cache,
+		size_t set, size_t ways, const Key& key, bool& found) {
+	size_t begin = set * ways;
+	size_t victim = begin;
+	for (size_t i = begin; i < begin + ways; i++) {
+		CacheEntry<Key, Value>& entry = cache[i];
+		if (!entry.used) {
+			victim = i;
+			continue;
+		}
+		if (entry.key == key) {
+			found = true;
+			return entry;
+		}
+		if (cache[victim].used && entry.last_used < cache[victim].last_used)
+			victim = i;
+	}
+	found = false;
+	return cache[victim];
 }
 
-WorldCache::WorldCache(const World& world)
-	: world(world) {
-	for (int i = 0; i < RSIZE; i++)
-		regioncache[i].used = false;
-	for (int i = 0; i < CSIZE; i++)
-		chunkcache[i].used = false;
+}
+
+const size_t WorldCache::REGION_CACHE_WAYS;
+const size_t WorldCache::CHUNK_CACHE_WAYS;
+const size_t WorldCache::REGION_CACHE_SIZE;
+const size_t WorldCache::DEFAULT_CHUNK_CACHE_SIZE;
+
+WorldCache::WorldCache()
+	: shared_memory_world_key(0), unpack_chunks(false) {
+	initialize(DEFAULT_CHUNK_CACHE_SIZE);
+}
+
+WorldCache::WorldCache(const World& world, size_t chunk_cache_size,
+		std::shared_ptr<ChunkCache> shared_chunk_cache,
+		std::shared_ptr<ChunkCache> unrotated_chunk_cache)
+	: world(world), shared_chunk_cache(shared_chunk_cache),
+	  unrotated_chunk_cache(unrotated_chunk_cache), shared_memory_world_key(0),
+	  unpack_chunks(false) {
+	initialize(chunk_cache_size);
 }
 
 const World& WorldCache::getWorld() const {
 	return world;
 }
 
+size_t WorldCache::getChunkCacheSize() const {
+	return chunkcache.size();
+}
+
+void WorldCache::setSignCollector(std::shared_ptr<SignCollector> sign_collector) {
+	this->sign_collector = sign_collector;
+}
+
+void WorldCache::setUnpackChunks(bool unpack_chunks) {
+	this->unpack_chunks = unpack_chunks;
+}
+
+void WorldCache::setCompressedChunkCache(
+		std::shared_ptr<CompressedChunkCache> compressed_chunk_cache) {
+	this->compressed_chunk_cache = compressed_chunk_cache;
+}
+
+void WorldCache::setSharedMemoryChunkCache(
+		std::shared_ptr<SharedMemoryChunkCache> shared_memory_chunk_cache,
+		uint64_t world_key) {
+	this->shared_memory_chunk_cache = shared_memory_chunk_cache;
+	this->shared_memory_world_key = world_key;
+}
+
+void WorldCache::setRegionCallback(
+		const std::function<void (const RegionPos&)>& region_callback) {
+	this->region_callback = region_callback;
+}
+
+void WorldCache::setRegionIndex(std::shared_ptr<RegionIndex> region_index) {
+	this->region_index = region_index;
+}
+
+void WorldCache::initialize(size_t chunk_cache_size) {
+	region_sets = REGION_CACHE_SIZE / REGION_CACHE_WAYS;
+	// round up to a multiple of the set size, but use at least one set
+	chunk_sets = (chunk_cache_size + CHUNK_CACHE_WAYS - 1) / CHUNK_CACHE_WAYS;
+	if (chunk_sets == 0)
+		chunk_sets = 1;
+	regioncache.resize(region_sets * REGION_CACHE_WAYS);
+	chunkcache.resize(chunk_sets * CHUNK_CACHE_WAYS);
+	access_counter = 0;
+	neighborhood_center = nullptr;
+	neighborhood_revision = 0;
+}
+
 /**
- * Calculates the position of a region position in the cache.
+ * Calculates the set of a region position in the cache.
  */
-int WorldCache::getRegionCacheIndex(const RegionPos& pos) const {
-	return (((pos.x + 4096) & RMASK) * RWIDTH + (pos.z + 4096)) & RMASK;
+size_t WorldCache::getRegionCacheSet(const RegionPos& pos) const {
+	return static_cast<size_t>(hash_function()(pos)) % region_sets;
 }
 
 /**
- * Calculates the position of a chunk position in the cache.
+ * Calculates the set of a chunk position in the cache.
  */
-int WorldCache::getChunkCacheIndex(const ChunkPos& pos) const {
-	//                4096*32
-	return (((pos.x + 131072) & CMASK) * CWIDTH + (pos.z + 131072)) & CMASK;
+size_t WorldCache::getChunkCacheSet(const ChunkPos& pos) const {
+	return chunk_hash_function()(pos) % chunk_sets;
 }
 
 RegionFile* WorldCache::getRegion(const RegionPos& pos) {
-	CacheEntry<RegionPos, RegionFile>& entry = regioncache[getRegionCacheIndex(pos)];
+	bool found;
+	CacheEntry<RegionPos, RegionFile>& entry = findCacheEntry(regioncache,
+			getRegionCacheSet(pos), REGION_CACHE_WAYS, pos, found);
+	entry.last_used = ++access_counter;
 
 	// check if region is already in cache
-	if (entry.used && entry.key == pos) {
-		//regionstats.hits++;
+	if (found) {
+		regionstats.hits++;
+		MAPCRAFTER_PROBE2(region__cache__hit, pos.x, pos.z);
 		return &entry.value;
 	}
+	MAPCRAFTER_PROBE2(region__cache__miss, pos.x, pos.z);
 
 	// if not try to load the region
 	// but make sure we did not already try to load the region file and it was broken
@@ -90,61 +182,312 @@ RegionFile* WorldCache::getRegion(const RegionPos& pos) {
 		return nullptr;
 
 	// region does not exist, region in cache was not modified
-	if (!world.getRegion(pos, entry.value))
+	if (!world.getRegion(pos, entry.value)) {
+		regionstats.not_found++;
 		return nullptr;
+	}
 
-	if (!entry.value.read()) {
+	// maybe the region is known to be broken from another thread or rendering
+	std::time_t mtime = 0;
+	uint64_t size = 0;
+	const std::string& filename = entry.value.getFilename();
+	bool indexed = region_index && RegionIndex::stat(filename, mtime, size);
+	if (indexed && region_index->isRegionBroken(filename, mtime, size)) {
+		regions_broken.insert(pos);
+		regionstats.invalid++;
+		return nullptr;
+	}
+
+	// read only the headers of the region, the chunks are read when they are needed
+	if (!entry.value.readLazily()) {
 		// the region is not valid, region in cache was probably modified
 		entry.used = false;
 		// remember this region as broken and do not try to load it again
 		regions_broken.insert(pos);
+		regionstats.invalid++;
+		if (indexed)
+			region_index->setRegionBroken(filename, mtime, size);
 		return nullptr;
 	}
 
+	// the chunks of the region known to be broken are not loaded again
+	if (indexed) {
+		region_file_stats[pos] = std::make_pair(mtime, size);
+		std::bitset<1024> broken;
+		if (region_index->findBrokenChunks(filename, mtime, size, broken)) {
+			RegionPos original = pos;
+			int rotation = world.getRotation();
+			if (rotation)
+				original.rotate(4 - rotation);
+			for (int i = 0; i < 1024; i++) {
+				if (!broken[i])
+					continue;
+				ChunkPos chunk(original.x * 32 + i % 32, original.z * 32 + i / 32);
+				if (rotation)
+					chunk.rotate(rotation);
+				chunks_broken.insert(chunk);
+			}
+		}
+	}
+
 	entry.used = true;
 	entry.key = pos;
-	//regionstats.misses++;
+	regionstats.misses++;
+	if (region_callback)
+		region_callback(pos);
 	return &entry.value;
 }
 
-Chunk* WorldCache::getChunk(const ChunkPos& pos) {
-	CacheEntry<ChunkPos, Chunk>& entry = chunkcache[getChunkCacheIndex(pos)];
+const Chunk* WorldCache::getChunk(const ChunkPos& pos) {
+	bool found;
+	CacheEntry<ChunkPos, ChunkCache::ChunkPtr>& entry = findCacheEntry(chunkcache,
+			getChunkCacheSet(pos), CHUNK_CACHE_WAYS, pos, found);
+	entry.last_used = ++access_counter;
+
 	// check if chunk is already in cache
-	if (entry.used && entry.key == pos) {
-		//chunkstats.hits++;
-		return &entry.value;
+	if (found) {
+		chunkstats.hits++;
+		util::Profiler::addMetric(util::Metric::CHUNK_CACHE_HITS);
+		MAPCRAFTER_PROBE3(chunk__cache__hit, pos.x, pos.z,
+				(int) util::ChunkCacheLevel::LOCAL);
+		return entry.value.get();
+	}
+	// the hits are not profiled, they are too cheap to be measured
+	util::ProfileScope profile(util::ProfileStage::CHUNK_CACHE);
+	util::MemoryScope memory(util::MemorySubsystem::CHUNK_CACHE);
+
+	// the chunk of this cache entry is evicted now, keep it compacted for later
+	if (compressed_chunk_cache && entry.used && entry.value)
+		compressed_chunk_cache->put(entry.key, *entry.value);
+
+	// maybe another thread has already loaded this chunk
+	if (shared_chunk_cache) {
+		ChunkCache::ChunkPtr chunk = shared_chunk_cache->get(pos);
+		if (chunk) {
+			chunkstats.shared_hits++;
+			util::Profiler::addMetric(util::Metric::CHUNK_CACHE_HITS);
+			MAPCRAFTER_PROBE3(chunk__cache__hit, pos.x, pos.z,
+					(int) util::ChunkCacheLevel::SHARED);
+			entry.used = true;
+			entry.key = pos;
+			entry.value = chunk;
+			return entry.value.get();
+		}
+	}
+
+	// maybe another rotation of the world has already loaded this chunk
+	int rotation = world.getRotation();
+	ChunkPos original_pos = pos;
+	if (rotation)
+		original_pos.rotate(4 - rotation);
+	if (unrotated_chunk_cache) {
+		ChunkCache::ChunkPtr original = unrotated_chunk_cache->get(original_pos);
+		if (original) {
+			chunkstats.rotation_hits++;
+			util::Profiler::addMetric(util::Metric::CHUNK_CACHE_HITS);
+			MAPCRAFTER_PROBE3(chunk__cache__hit, pos.x, pos.z,
+					(int) util::ChunkCacheLevel::ROTATION);
+			std::shared_ptr<const Chunk> chunk = original;
+			if (rotation) {
+				std::shared_ptr<Chunk> rotated = std::make_shared<Chunk>();
+				rotated->loadRotated(*original, rotation);
+				chunk = rotated;
+			}
+			entry.used = true;
+			entry.key = pos;
+			entry.value = shared_chunk_cache ? shared_chunk_cache->put(pos, chunk) : chunk;
+			return entry.value.get();
+		}
+	}
+
+	// reuse the chunk of this cache entry if nobody else is using it anymore,
+	// the chunks are created non-const, so casting the const away is fine here
+	std::shared_ptr<Chunk> chunk;
+	if (entry.value && entry.value.use_count() == 1)
+		chunk = std::const_pointer_cast<Chunk>(entry.value);
+
+	// maybe this chunk was already decoded and evicted from the caches since then
+	if (compressed_chunk_cache) {
+		if (!chunk)
+			chunk = std::make_shared<Chunk>();
+		chunk->setRotation(rotation);
+		chunk->setWorldCrop(world.getWorldCrop());
+		if (compressed_chunk_cache->get(pos, *chunk)) {
+			chunkstats.compressed_hits++;
+			util::Profiler::addMetric(util::Metric::CHUNK_CACHE_HITS);
+			MAPCRAFTER_PROBE3(chunk__cache__hit, pos.x, pos.z,
+					(int) util::ChunkCacheLevel::COMPRESSED);
+			if (unpack_chunks)
+				chunk->unpackSections();
+			entry.used = true;
+			entry.key = pos;
+			entry.value = shared_chunk_cache ? shared_chunk_cache->put(pos, chunk) : chunk;
+			return entry.value.get();
+		}
 	}
 
 	// if not try to get the region of the chunk from the cache
+	uint64_t region_misses = regionstats.misses;
 	RegionFile* region = getRegion(pos.getRegion());
 	if (region == nullptr) {
-		//chunkstats.unavailable++;
+		chunkstats.region_not_found++;
 		return nullptr;
 	}
+	// the region callback might have decoded the chunk just now
+	if (region_callback && shared_chunk_cache && regionstats.misses != region_misses) {
+		ChunkCache::ChunkPtr decoded = shared_chunk_cache->get(pos);
+		if (decoded) {
+			chunkstats.shared_hits++;
+			util::Profiler::addMetric(util::Metric::CHUNK_CACHE_HITS);
+			MAPCRAFTER_PROBE3(chunk__cache__hit, pos.x, pos.z,
+					(int) util::ChunkCacheLevel::SHARED);
+			entry.used = true;
+			entry.key = pos;
+			entry.value = decoded;
+			return entry.value.get();
+		}
+	}
 
 	// then try to load the chunk
 	// but make sure we did not already try to load the chunk and it was broken
 	if (chunks_broken.count(pos))
 		return nullptr;
+	// most requested chunks which do not exist are in existing regions,
+	// so check this before allocating a chunk
+	if (!region->hasChunk(pos)) {
+		chunkstats.not_found++;
+		return nullptr;
+	}
+
+	if (!chunk)
+		chunk = std::make_shared<Chunk>();
 
-	int status = region->loadChunk(pos, entry.value);
+	// maybe another process has already decoded this version of the chunk
+	if (shared_memory_chunk_cache) {
+		chunk->setRotation(rotation);
+		chunk->setWorldCrop(world.getWorldCrop());
+		if (shared_memory_chunk_cache->get(shared_memory_world_key, pos,
+				region->getChunkTimestamp(pos), *chunk)) {
+			chunkstats.shared_memory_hits++;
+			util::Profiler::addMetric(util::Metric::CHUNK_CACHE_HITS);
+			MAPCRAFTER_PROBE3(chunk__cache__hit, pos.x, pos.z,
+					(int) util::ChunkCacheLevel::SHARED_MEMORY);
+			if (unpack_chunks)
+				chunk->unpackSections();
+			if (sign_collector)
+				sign_collector->addChunk(original_pos, region->getChunkTimestamp(pos),
+						*chunk);
+			entry.used = true;
+			entry.key = pos;
+			entry.value = shared_chunk_cache ? shared_chunk_cache->put(pos, chunk) : chunk;
+			return entry.value.get();
+		}
+	}
+
+	// the chunk is loaded in the original rotation for the other rotations first
+	std::shared_ptr<Chunk> original;
+	if (unrotated_chunk_cache)
+		original = rotation ? std::make_shared<Chunk>() : chunk;
+
+	util::Profiler::addMetric(util::Metric::CHUNK_CACHE_MISSES);
+	MAPCRAFTER_PROBE2(chunk__cache__miss, pos.x, pos.z);
+	auto decode_start = std::chrono::steady_clock::now();
+	MAPCRAFTER_PROBE2(chunk__load__start, pos.x, pos.z);
+	int status = original ? region->loadChunk(pos, *original, true)
+			: region->loadChunk(pos, *chunk);
+	MAPCRAFTER_PROBE3(chunk__load__end, pos.x, pos.z, status);
+	// unpack before the chunk is shared, the rotated copy is unpacked as well
+	if (status == RegionFile::CHUNK_OK && unpack_chunks)
+		(original ? original : chunk)->unpackSections();
+	if (status == RegionFile::CHUNK_OK && original) {
+		unrotated_chunk_cache->put(original_pos, original);
+		if (rotation)
+			chunk->loadRotated(*original, rotation);
+	}
 	// the chunk does not exist, chunk in cache was not modified
-	if (status == RegionFile::CHUNK_DOES_NOT_EXIST)
+	if (status == RegionFile::CHUNK_DOES_NOT_EXIST) {
+		chunkstats.not_found++;
 		return nullptr;
+	}
+	chunkstats.decode_time += std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - decode_start).count();
 
 	if (status != RegionFile::CHUNK_OK) {
-		//chunkstats.unavailable++;
+		chunkstats.invalid++;
 		// the chunk is not valid, chunk in cache was probably modified
 		entry.used = false;
+		entry.value.reset();
 		// remember this chunk as broken and do not try to load it again
 		chunks_broken.insert(pos);
+		auto stats = region_file_stats.find(pos.getRegion());
+		if (stats != region_file_stats.end()) {
+			ChunkPos original = pos;
+			if (rotation)
+				original.rotate(4 - rotation);
+			region_index->setChunkBroken(region->getFilename(), stats->second.first,
+					stats->second.second, original.getLocalZ() * 32 + original.getLocalX());
+		}
 		return nullptr;
 	}
 
+	if (sign_collector)
+		sign_collector->addChunk(original_pos, region->getChunkTimestamp(pos), *chunk);
+	if (shared_memory_chunk_cache)
+		shared_memory_chunk_cache->put(shared_memory_world_key, pos,
+				region->getChunkTimestamp(pos), *chunk);
+
 	entry.used = true;
 	entry.key = pos;
-	//chunkstats.misses++;
-	return &entry.value;
+	if (shared_chunk_cache)
+		entry.value = shared_chunk_cache->put(pos, chunk);
+	else
+		entry.value = chunk;
+	chunkstats.misses++;
+	return entry.value.get();
+}
+
+const Chunk* WorldCache::getChunkOfBlock(const mc::BlockPos& pos, const mc::Chunk* chunk) {
+	if (chunk == nullptr)
+		return getChunk(mc::ChunkPos(pos));
+
+	// the block coordinates relative to the north-west corner of the north-west neighbor
+	const ChunkPos& center = chunk->getPos();
+	int x = pos.x - center.x * 16 + 16;
+	int z = pos.z - center.z * 16 + 16;
+	if (x < 0 || z < 0 || x >= 48 || z >= 48)
+		return getChunk(mc::ChunkPos(pos));
+	int index = (z / 16) * 3 + x / 16;
+	if (index == 4)
+		return chunk;
+
+	if (chunk != neighborhood_center || chunk->getRevision() != neighborhood_revision) {
+		neighborhood_center = chunk;
+		neighborhood_revision = chunk->getRevision();
+		for (int i = 0; i < 9; i++) {
+			neighborhood[i].reset();
+			neighborhood_loaded[i] = false;
+		}
+		// pin the chunk itself too (if it's from this cache), loading the neighbors
+		// must not reuse it
+		bool found;
+		CacheEntry<ChunkPos, ChunkCache::ChunkPtr>& entry = findCacheEntry(chunkcache,
+				getChunkCacheSet(center), CHUNK_CACHE_WAYS, center, found);
+		if (found && entry.value.get() == chunk)
+			neighborhood[4] = entry.value;
+	}
+
+	if (!neighborhood_loaded[index]) {
+		mc::ChunkPos neighbor_pos(center.x + x / 16 - 1, center.z + z / 16 - 1);
+		// pin the chunk, so its cache entry can't reuse it for another chunk
+		if (getChunk(neighbor_pos) != nullptr) {
+			bool found;
+			neighborhood[index] = findCacheEntry(chunkcache,
+					getChunkCacheSet(neighbor_pos), CHUNK_CACHE_WAYS, neighbor_pos,
+					found).value;
+		}
+		neighborhood_loaded[index] = true;
+	}
+	return neighborhood[index].get();
 }
 
 Block WorldCache::getBlock(const mc::BlockPos& pos, const mc::Chunk* chunk, int get) {
@@ -152,10 +495,7 @@ Block WorldCache::getBlock(const mc::BlockPos& pos, const mc::Chunk* chunk, int
 	if (pos.y < 0)
 		return Block();
 
-	mc::ChunkPos chunk_pos(pos);
-	const mc::Chunk* mychunk = chunk;
-	if (chunk == nullptr || chunk_pos != chunk->getPos())
-		mychunk = getChunk(chunk_pos);
+	const mc::Chunk* mychunk = getChunkOfBlock(pos, chunk);
 	// chunk may be nullptr
 	if (mychunk == nullptr) {
 		return Block();
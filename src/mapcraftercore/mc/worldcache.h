@@ -21,15 +21,23 @@
 #define WORLDCACHE_H_
 
 #include "chunk.h"
+#include "chunkcache.h"
 #include "pos.h"
 #include "region.h"
+#include "regionindex.h"
 #include "world.h"
 
+#include <functional>
+#include <map>
+#include <memory>
 #include <set>
+#include <vector>
 
 namespace mapcrafter {
 namespace mc {
 
+class SignCollector;
+
 /**
  * A block with id/data/biome/lighting data.
  */
@@ -57,30 +65,71 @@ const int GET_SKY_LIGHT = 16;
 const int GET_LIGHT = GET_BLOCK_LIGHT | GET_SKY_LIGHT;
 
 /**
- * Some cache statistics for debugging. Not used at the moment.
+ * Some statistics of a region/chunk cache.
+ *
+ * Every world cache has its own statistics, so the counters need no synchronization.
+ * The statistics of multiple world caches (for example of different render threads) can
+ * be merged with the += operator.
  *
  * Maybe add a set of corrupt chunks/regions to dump them at the end of the rendering.
  */
 struct CacheStats {
 	CacheStats()
-			: hits(0), misses(0), region_not_found(0), not_found(0), invalid(0) {
+			: hits(0), shared_hits(0), rotation_hits(0), compressed_hits(0),
+			  shared_memory_hits(0), misses(0), region_not_found(0),
+			  not_found(0), invalid(0), decode_time(0) {
+	}
+
+	CacheStats& operator+=(const CacheStats& other) {
+		hits += other.hits;
+		shared_hits += other.shared_hits;
+		rotation_hits += other.rotation_hits;
+		compressed_hits += other.compressed_hits;
+		shared_memory_hits += other.shared_memory_hits;
+		misses += other.misses;
+		region_not_found += other.region_not_found;
+		not_found += other.not_found;
+		invalid += other.invalid;
+		decode_time += other.decode_time;
+		return *this;
 	}
 
 	void print(const std::string& name) const {
 		std::cout << name << ":" << std::endl;
 		std::cout << "  hits: " << hits << std::endl
+				  << "  shared_hits: " << shared_hits << std::endl
+				  << "  rotation_hits: " << rotation_hits << std::endl
+				  << "  compressed_hits: " << compressed_hits << std::endl
+				  << "  shared_memory_hits: " << shared_memory_hits << std::endl
 				  << "  misses: " << misses << std::endl
 				  << "  region_not_found: " << region_not_found << std::endl
 				  << "  not_found: " << not_found << std::endl
-				  << "  invalid: " << invalid << std::endl;
+				  << "  invalid: " << invalid << std::endl
+				  << "  decode_time: " << decode_time << "s" << std::endl;
 	}
 
-	int hits;
-	int misses;
+	// found in the cache
+	uint64_t hits;
+	// found in the cache shared with other threads (chunks only)
+	uint64_t shared_hits;
+	// found in the cache shared with other rotations, only rotated (chunks only)
+	uint64_t rotation_hits;
+	// found in the cache with the compacted chunks (chunks only)
+	uint64_t compressed_hits;
+	// found in the cache shared with other processes (chunks only)
+	uint64_t shared_memory_hits;
+	// not found in the cache, loaded successfully
+	uint64_t misses;
+
+	// the region of the chunk does not exist (chunks only)
+	uint64_t region_not_found;
+	// region/chunk does not exist
+	uint64_t not_found;
+	// region/chunk is broken, counted once per region/chunk
+	uint64_t invalid;
 
-	int region_not_found;
-	int not_found;
-	int invalid;
+	// seconds spent loading and decoding the chunks of the misses (chunks only)
+	double decode_time;
 };
 
 /**
@@ -88,73 +137,186 @@ struct CacheStats {
  */
 template <typename Key, typename Value>
 struct CacheEntry {
+	CacheEntry()
+		: used(false), last_used(0) {
+	}
+
 	Key key;
 	Value value;
 	bool used;
+	// "time" of the last access, used to find the least recently used entry of a set
+	uint64_t last_used;
 };
 
-#define RBITS 2
-#define RWIDTH (1 << RBITS)
-#define RSIZE (RWIDTH*RWIDTH)
-#define RMASK (RSIZE-1)
-
-#define CBITS 5
-#define CWIDTH (1 << CBITS)
-#define CSIZE (CWIDTH*CWIDTH)
-#define CMASK (CSIZE-1)
-
 /**
  * This is a world cache with regions and chunks.
  *
- * Every region and chunk has a fixed position in the cache. The position in the cache is
- * calculated by using the first few bits of the region/chunk coordinates. Then the
- * regions/chunks are stored with the "smaller" coordinates in a 2D-like array.
+ * The regions and chunks are stored in set-associative caches: The position of a
+ * region/chunk is hashed to one set of the cache, and the region/chunk can be stored in
+ * any of the entries of this set. So two regions/chunks which are hashed to the same set
+ * do not evict each other as long as there are other entries of the set which are not
+ * used or used less recently.
  *
- * For the regions the first 2 bits are used, this are 4x4 regions (4 = 1 << 2) in the
- * cache. The regions store only the raw region file data and are used to read the chunks
- * when necessary.
+ * When someone is trying to access the cache, the cache checks if the requested
+ * region/chunk is already in one of the entries of its set. If yes, the cache returns
+ * the objects. If not, the cache tries to load the region/chunk and puts it in an
+ * unused entry of the set, or in the least recently used entry of the set if all
+ * entries are used (overwrites the region/chunk stored there).
  *
- * For the chunks the first 5 bits are used, this are 16x16 chunk (also the size of a
- * region) in the cache.
+ * The regions store only the headers of the region files and are used to read the
+ * chunks when necessary. The count of chunks in the cache can be configured, the count
+ * of regions is fixed.
  *
- * When someone is trying to access the cache, the cache calculates the position of a
- * region/chunk coordinate in the cache. Then the cache checks if there is already
- * something stored on this position and if the real coordinate of this cache entry is
- * the coordinate of the requested region/chunk. If yes, the cache returns the objects.
- * If not, the cache tries to load the chunk/region and puts it in this cache entry
- * (overwrites an already loaded region/chunk at this cache position).
+ * Optionally the world cache can use a chunk cache which is shared with the world caches
+ * of other threads. Chunks which are not in the own cache are looked up in the shared
+ * cache first, and chunks loaded by this world cache are put into the shared cache to
+ * make them available to the other threads.
+ *
+ * The world caches of different rotations of a world can also share a cache with the
+ * chunks in the original rotation of the world. A chunk found there is only rotated
+ * instead of being read and decoded again, and the chunks loaded by this world cache
+ * are put there in the original rotation.
  */
 class WorldCache {
-private:
-	World world;
+public:
+	/**
+	 * Count of entries per set of the region/chunk cache.
+	 */
+	static const size_t REGION_CACHE_WAYS = 4;
+	static const size_t CHUNK_CACHE_WAYS = 8;
 
-	CacheEntry<RegionPos, RegionFile> regioncache[RSIZE];
-	CacheEntry<ChunkPos, Chunk> chunkcache[CSIZE];
+	/**
+	 * Count of regions in the cache and default count of chunks in the cache.
+	 */
+	static const size_t REGION_CACHE_SIZE = 16;
+	static const size_t DEFAULT_CHUNK_CACHE_SIZE = 1024;
 
-	// provisional set to keep track of broken regions/chunks
-	// we do not want to try to load them again and again
-	std::set<RegionPos> regions_broken;
-	std::set<ChunkPos> chunks_broken;
+	WorldCache();
+	WorldCache(const World& world, size_t chunk_cache_size = DEFAULT_CHUNK_CACHE_SIZE,
+			std::shared_ptr<ChunkCache> shared_chunk_cache = std::shared_ptr<ChunkCache>(),
+			std::shared_ptr<ChunkCache> unrotated_chunk_cache = std::shared_ptr<ChunkCache>());
 
-	CacheStats regionstats;
-	CacheStats chunkstats;
+	const World& getWorld() const;
 
-	int getRegionCacheIndex(const RegionPos& pos) const;
-	int getChunkCacheIndex(const ChunkPos& pos) const;
+	/**
+	 * Returns the count of chunks this cache can hold.
+	 */
+	size_t getChunkCacheSize() const;
 
-public:
-	WorldCache();
-	WorldCache(const World& world);
+	/**
+	 * Sets a collector which gets the signs of the chunks this cache decodes, may be null.
+	 */
+	void setSignCollector(std::shared_ptr<SignCollector> sign_collector);
 
-	const World& getWorld() const;
+	/**
+	 * Sets whether the sections of the chunks this cache decodes are unpacked (see
+	 * Chunk::unpackSections).
+	 */
+	void setUnpackChunks(bool unpack_chunks);
+
+	/**
+	 * Sets a cache which keeps the chunks evicted from this cache compacted, so they
+	 * don't have to be decoded from the region file again, may be null.
+	 */
+	void setCompressedChunkCache(std::shared_ptr<CompressedChunkCache> compressed_chunk_cache);
+
+	/**
+	 * Sets a cache shared with other processes rendering this world, may be null. Chunks
+	 * which have to be read from the region files are looked up there first, and the
+	 * decoded chunks are put into it. The key has to identify this world with its
+	 * rotation and world crop (see SharedMemoryChunkCache).
+	 */
+	void setSharedMemoryChunkCache(
+			std::shared_ptr<SharedMemoryChunkCache> shared_memory_chunk_cache,
+			uint64_t world_key);
+
+	/**
+	 * Sets a function which is called when a region is loaded into the cache, for
+	 * example to decode the needed chunks of the region into the shared chunk cache at
+	 * once. The chunk which needed the region is looked up in the shared chunk cache
+	 * again afterwards. An empty function disables this.
+	 */
+	void setRegionCallback(const std::function<void (const RegionPos&)>& region_callback);
+
+	/**
+	 * Sets an index which remembers the broken regions and chunks (see RegionIndex), may
+	 * be null. The regions and chunks known to be broken are not read again, and the
+	 * ones this cache finds broken are added to it, so the other threads and the next
+	 * renderings don't read them again either.
+	 */
+	void setRegionIndex(std::shared_ptr<RegionIndex> region_index);
 
 	RegionFile* getRegion(const RegionPos& pos);
-	Chunk* getChunk(const ChunkPos& pos);
+	const Chunk* getChunk(const ChunkPos& pos);
+
+	/**
+	 * Returns the chunk of a block, which is usually the specified chunk itself or one
+	 * of its eight neighbors (nullptr if that chunk does not exist). The neighbors of the
+	 * last used chunk are kept, so they are found with some index arithmetic instead of
+	 * looking them up in the cache again. They are loaded when they are needed first and
+	 * pinned until another chunk is used.
+	 */
+	const Chunk* getChunkOfBlock(const mc::BlockPos& pos, const mc::Chunk* chunk);
 
+	/**
+	 * Returns the data of a block. The chunk is a hint where the block is, probably
+	 * in the chunk itself or a neighbor of it (see getChunkOfBlock), may be nullptr.
+	 */
 	Block getBlock(const mc::BlockPos& pos, const mc::Chunk* chunk, int get = GET_ID | GET_DATA);
 
 	const CacheStats& getRegionCacheStats() const;
 	const CacheStats& getChunkCacheStats() const;
+
+private:
+	World world;
+
+	std::vector<CacheEntry<RegionPos, RegionFile> > regioncache;
+	std::vector<CacheEntry<ChunkPos, ChunkCache::ChunkPtr> > chunkcache;
+	size_t region_sets, chunk_sets;
+	// incremented with every access, used as timestamp for the entries
+	uint64_t access_counter;
+
+	// chunk cache shared with other threads, may be null
+	std::shared_ptr<ChunkCache> shared_chunk_cache;
+	// cache with the chunks in the original rotation shared with other rotations of
+	// the world (chunk positions not rotated), may be null
+	std::shared_ptr<ChunkCache> unrotated_chunk_cache;
+	// keeps the evicted chunks compacted (shared with other threads), may be null
+	std::shared_ptr<CompressedChunkCache> compressed_chunk_cache;
+	// chunk cache shared with other processes and the key of the world there, may be null
+	std::shared_ptr<SharedMemoryChunkCache> shared_memory_chunk_cache;
+	uint64_t shared_memory_world_key;
+	// collects the signs of the decoded chunks, may be null
+	std::shared_ptr<SignCollector> sign_collector;
+	// whether the sections of the decoded chunks are unpacked
+	bool unpack_chunks;
+	// called when a region is loaded into the cache, may be empty
+	std::function<void (const RegionPos&)> region_callback;
+	// remembers the broken regions and chunks across threads and renderings, may be
+	// null, and the modification time and size of the loaded region files to look
+	// them up there
+	std::shared_ptr<RegionIndex> region_index;
+	std::map<RegionPos, std::pair<std::time_t, uint64_t> > region_file_stats;
+
+	// the chunk of the last getChunkOfBlock call (with its revision to notice when the
+	// chunk object is reused) and its neighbors (as index (dz + 1) * 3 + (dx + 1))
+	const Chunk* neighborhood_center;
+	uint64_t neighborhood_revision;
+	ChunkCache::ChunkPtr neighborhood[9];
+	bool neighborhood_loaded[9];
+
+	// provisional set to keep track of broken regions/chunks
+	// we do not want to try to load them again and again
+	std::set<RegionPos> regions_broken;
+	std::set<ChunkPos> chunks_broken;
+
+	CacheStats regionstats;
+	CacheStats chunkstats;
+
+	void initialize(size_t chunk_cache_size);
+
+	size_t getRegionCacheSet(const RegionPos& pos) const;
+	size_t getChunkCacheSet(const ChunkPos& pos) const;
 };
 
 }
@@ -19,8 +19,15 @@
 
 #include "worldentities.h"
 
+#include "../compat/thread.h"
 #include "../util/picojson.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
 namespace mapcrafter {
 namespace mc {
 
@@ -122,172 +129,370 @@ const std::string& SignEntity::getText() const {
 	return text;
 }
 
+SignCollector::SignCollector() {
+}
+
+SignCollector::~SignCollector() {
+}
+
+void SignCollector::addChunk(const ChunkPos& pos, uint32_t timestamp, const Chunk& chunk) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	chunks[pos] = std::make_pair(timestamp, chunk.getSigns());
+}
+
+size_t SignCollector::size() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return chunks.size();
+}
+
+WorldEntitiesCache::ChunkEntities::ChunkEntities()
+	: timestamp(0) {
+}
+
+WorldEntitiesCache::RegionEntities::RegionEntities()
+	: mtime(0), size(0) {
+}
+
 WorldEntitiesCache::WorldEntitiesCache(const World& world)
-	: world(world), cache_file(world.getRegionDir() / "entities.nbt.gz") {
+	: world(world), cache_file(world.getRegionDir() / "entities.dat") {
+	// the cache of a remote world is in its local cache directory
+	if (world.isRemote())
+		cache_file = world.getCacheDir() / "entities.dat";
 }
 
 WorldEntitiesCache::~WorldEntitiesCache() {
 }
 
-unsigned int WorldEntitiesCache::readCacheFile() {
-	if (!fs::exists(cache_file)) {
+namespace {
+
+// "MCEC" and version of the cache file format, the byte order of the host is used
+const uint32_t CACHE_MAGIC = 0x4d434543;
+const uint32_t CACHE_VERSION = 2;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+void writeString(std::ostream& out, const std::string& str) {
+	writeValue(out, (uint16_t) str.size());
+	out.write(str.c_str(), str.size());
+}
+
+bool readString(std::istream& in, std::string& str) {
+	uint16_t length;
+	if (!readValue(in, length))
+		return false;
+	str.resize(length);
+	return length == 0 || in.read(&str[0], length);
+}
+
+}
+
+bool WorldEntitiesCache::readCacheFile() {
+	regions.clear();
+	std::ifstream in(cache_file.string().c_str(), std::ios::binary);
+	if (!in) {
 		LOG(DEBUG) << "Cache file " << cache_file << " does not exist.";
-		return 0;
+		return false;
 	}
 
-	nbt::NBTFile nbt_file;
-	nbt_file.readNBT(cache_file.string().c_str(), nbt::Compression::GZIP);
-
-	nbt::TagList nbt_regions = nbt_file.findTag<nbt::TagList>("regions");
-	for (auto region_it = nbt_regions.payload.begin();
-			region_it != nbt_regions.payload.end(); ++region_it) {
-		nbt::TagCompound region = (*region_it)->cast<nbt::TagCompound>();
-		nbt::TagList chunks = region.findTag<nbt::TagList>("chunks");
-		mc::RegionPos region_pos;
-		region_pos.x = region.findTag<nbt::TagInt>("x").payload;
-		region_pos.z = region.findTag<nbt::TagInt>("z").payload;
+	uint32_t magic, version, count;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, count)
+			|| magic != CACHE_MAGIC || version != CACHE_VERSION) {
+		LOG(WARNING) << "Cache file " << cache_file << " is invalid.";
+		return false;
+	}
 
-		for (auto chunk_it = chunks.payload.begin(); chunk_it != chunks.payload.end();
-				++chunk_it) {
-			nbt::TagCompound chunk = (*chunk_it)->cast<nbt::TagCompound>();
-			nbt::TagList entities = chunk.findTag<nbt::TagList>("entities");
-			mc::ChunkPos chunk_pos;
-			chunk_pos.x = chunk.findTag<nbt::TagInt>("x").payload;
-			chunk_pos.z = chunk.findTag<nbt::TagInt>("z").payload;
-
-			for (auto entity_it = entities.payload.begin();
-					entity_it != entities.payload.end(); ++entity_it) {
-				nbt::TagCompound entity = (*entity_it)->cast<nbt::TagCompound>();
-				this->entities[region_pos][chunk_pos].push_back(entity);
+	for (uint32_t i = 0; i < count; i++) {
+		RegionPos pos;
+		int64_t mtime;
+		uint32_t chunks;
+		RegionEntities entities;
+		if (!readValue(in, pos.x) || !readValue(in, pos.z) || !readValue(in, mtime)
+				|| !readValue(in, entities.size) || !readValue(in, chunks))
+			break;
+		entities.mtime = mtime;
+		bool valid = true;
+		for (uint32_t j = 0; j < chunks && valid; j++) {
+			ChunkPos chunk_pos;
+			ChunkEntities chunk;
+			uint32_t signs;
+			valid = readValue(in, chunk_pos.x) && readValue(in, chunk_pos.z)
+					&& readValue(in, chunk.timestamp) && readValue(in, signs);
+			for (uint32_t k = 0; k < signs && valid; k++) {
+				Chunk::Sign sign;
+				valid = readValue(in, sign.first.x) && readValue(in, sign.first.z)
+						&& readValue(in, sign.first.y);
+				for (int l = 0; l < 4 && valid; l++)
+					valid = readString(in, sign.second[l]);
+				if (valid)
+					chunk.signs.push_back(sign);
 			}
+			if (valid)
+				entities.chunks[chunk_pos] = chunk;
 		}
+		if (!valid)
+			break;
+		regions[pos] = entities;
 	}
 
-	LOG(DEBUG) << "Read cache file " << cache_file << ". Last modification time was "
-			<< fs::last_write_time(cache_file) << ".";
-	return fs::last_write_time(cache_file);
+	// a truncated cache is not valid at all
+	if (regions.size() != count) {
+		LOG(WARNING) << "Cache file " << cache_file << " is invalid.";
+		regions.clear();
+		return false;
+	}
+	LOG(DEBUG) << "Read cache file " << cache_file << " with " << count << " regions.";
+	return true;
 }
 
-void WorldEntitiesCache::writeCacheFile() const {
-	nbt::NBTFile nbt_file;
-	nbt::TagList nbt_regions(nbt::TagCompound::TAG_TYPE);
-
-	for (auto region_it = entities.begin(); region_it != entities.end(); ++region_it) {
-		nbt::TagCompound nbt_region;
-		nbt_region.addTag("x", nbt::TagInt(region_it->first.x));
-		nbt_region.addTag("z", nbt::TagInt(region_it->first.z));
-		nbt::TagList nbt_chunks(nbt::TagCompound::TAG_TYPE);
-		for (auto chunk_it = region_it->second.begin();
-				chunk_it != region_it->second.end(); ++chunk_it) {
-			nbt::TagCompound nbt_chunk;
-			nbt_chunk.addTag("x", nbt::TagInt(chunk_it->first.x));
-			nbt_chunk.addTag("z", nbt::TagInt(chunk_it->first.z));
-			nbt::TagList nbt_entities(nbt::TagCompound::TAG_TYPE);
-			for (auto entity_it = chunk_it->second.begin();
-					entity_it != chunk_it->second.end(); ++entity_it) {
-				nbt_entities.payload.push_back(nbt::TagPtr(entity_it->clone()));
+bool WorldEntitiesCache::writeCacheFile() const {
+	// write to a temporary file first to not leave a broken cache behind
+	std::string filename = cache_file.string();
+	std::string tmp_filename = filename + ".tmp";
+	if (world.isRemote()) {
+		boost::system::error_code error;
+		fs::create_directories(cache_file.parent_path(), error);
+	}
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	writeValue(out, CACHE_MAGIC);
+	writeValue(out, CACHE_VERSION);
+	writeValue(out, (uint32_t) regions.size());
+	for (auto region_it = regions.begin(); region_it != regions.end(); ++region_it) {
+		const RegionEntities& entities = region_it->second;
+		writeValue(out, region_it->first.x);
+		writeValue(out, region_it->first.z);
+		writeValue(out, (int64_t) entities.mtime);
+		writeValue(out, entities.size);
+		writeValue(out, (uint32_t) entities.chunks.size());
+		for (auto chunk_it = entities.chunks.begin(); chunk_it != entities.chunks.end();
+				++chunk_it) {
+			const ChunkEntities& chunk = chunk_it->second;
+			writeValue(out, chunk_it->first.x);
+			writeValue(out, chunk_it->first.z);
+			writeValue(out, chunk.timestamp);
+			writeValue(out, (uint32_t) chunk.signs.size());
+			for (auto sign_it = chunk.signs.begin(); sign_it != chunk.signs.end();
+					++sign_it) {
+				writeValue(out, sign_it->first.x);
+				writeValue(out, sign_it->first.z);
+				writeValue(out, sign_it->first.y);
+				for (int i = 0; i < 4; i++)
+					writeString(out, sign_it->second[i]);
 			}
-			nbt_chunk.addTag("entities", nbt_entities);
-			nbt_chunks.payload.push_back(nbt::TagPtr(nbt_chunk.clone()));
 		}
-		nbt_region.addTag("chunks", nbt_chunks);
-		nbt_regions.payload.push_back(nbt::TagPtr(nbt_region.clone()));
 	}
-
-	nbt_file.addTag("regions", nbt_regions);
-	nbt_file.writeNBT(cache_file.string().c_str(), nbt::Compression::GZIP);
+	out.close();
+	if (!out)
+		return false;
+	return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
 }
 
-void WorldEntitiesCache::update(util::IProgressHandler* progress) {
-	unsigned int timestamp = readCacheFile();
+void WorldEntitiesCache::scanRegion(const RegionPos& pos, RegionEntities& entities,
+		const RegionEntities* cached) const {
+	entities.chunks.clear();
+	RegionFile region;
+	if (!world.getRegion(pos, region) || !region.readLazily()) {
+		LOG(ERROR) << "Unable to read region file " << world.getRegionPath(pos) << ".";
+		return;
+	}
 
-	auto regions = world.getAvailableRegions();
-	if (progress != nullptr)
-		progress->setMax(regions.size());
-	for (auto region_it = regions.begin(); region_it != regions.end(); ++region_it) {
+	// only the data of the chunks which aren't cached anymore is read
+	std::vector<ChunkPos> chunks;
+	auto containing_chunks = region.getContainingChunks();
+	for (auto chunk_it = containing_chunks.begin(); chunk_it != containing_chunks.end();
+			++chunk_it) {
+		uint32_t timestamp = region.getChunkTimestamp(*chunk_it);
+		if (cached != nullptr && timestamp != 0) {
+			auto cached_chunk = cached->chunks.find(*chunk_it);
+			if (cached_chunk != cached->chunks.end()
+					&& cached_chunk->second.timestamp == timestamp) {
+				entities.chunks[*chunk_it] = cached_chunk->second;
+				continue;
+			}
+		}
+		chunks.push_back(*chunk_it);
+	}
+	LOG(DEBUG) << "Reading the entities of " << chunks.size() << "/"
+			<< containing_chunks.size() << " chunks of region "
+			<< world.getRegionPath(pos).filename() << ".";
+
+	// the buffer and the document are reused for all chunks
+	nbt::DecompressedBuffer decompressed;
+	nbt::Document document;
+	typedef nbt::Document::Node Node;
+	for (auto chunk_it = chunks.begin(); chunk_it != chunks.end(); ++chunk_it) {
+		ChunkEntities& chunk = entities.chunks[*chunk_it];
+		chunk.timestamp = region.getChunkTimestamp(*chunk_it);
+		try {
+			const ChunkData& data = region.getChunkData(*chunk_it);
+			nbt::decompress(reinterpret_cast<const char*>(data.data()), data.size(),
+					decompressed, nbt::Compression::ZLIB);
+			document.parse(decompressed.data(), decompressed.size());
+
+			const Node* level = document.findChild(document.getRoot(), "Level",
+					nbt::TagCompound::TAG_TYPE);
+			if (level == nullptr)
+				throw nbt::TagNotFound("No level tag found!");
+			const Node* tile_entities = document.findChild(*level, "TileEntities",
+					nbt::TagList::TAG_TYPE);
+			if (tile_entities == nullptr
+					|| tile_entities->list_type != nbt::TagCompound::TAG_TYPE)
+				continue;
+			for (const Node* entity = document.getFirstChild(*tile_entities);
+					entity != nullptr; entity = document.getNextSibling(*entity)) {
+				const Node* id = document.findChild(*entity, "id", nbt::TagString::TAG_TYPE);
+				if (id == nullptr || (id->getString() != "Sign"
+						&& id->getString() != "minecraft:sign"))
+					continue;
+				const Node* x = document.findChild(*entity, "x", nbt::TagInt::TAG_TYPE);
+				const Node* z = document.findChild(*entity, "z", nbt::TagInt::TAG_TYPE);
+				const Node* y = document.findChild(*entity, "y", nbt::TagInt::TAG_TYPE);
+				if (x == nullptr || z == nullptr || y == nullptr) {
+					LOG(WARNING) << "Ignoring sign without position in chunk " << *chunk_it
+							<< ".";
+					continue;
+				}
+
+				Chunk::Sign sign;
+				sign.first = mc::BlockPos(x->getInt(), z->getInt(), y->getInt());
+				// missing lines are empty
+				for (int i = 0; i < 4; i++) {
+					std::string name = "Text" + util::str(i + 1);
+					const Node* line = document.findChild(*entity, name.c_str(),
+							nbt::TagString::TAG_TYPE);
+					if (line != nullptr)
+						sign.second[i] = line->getString();
+				}
+				chunk.signs.push_back(sign);
+			}
+		} catch (const nbt::NBTError& err) {
+			LOG(ERROR) << "Unable to read entities of chunk " << *chunk_it << " in region "
+					<< world.getRegionPath(pos) << ": " << err.what();
+		}
+	}
+}
 
+void WorldEntitiesCache::update(util::IProgressHandler* progress, int threads) {
+	readCacheFile();
+
+	// find the regions which need to be scanned (again),
+	// the regions which don't exist anymore are dropped
+	std::map<RegionPos, RegionEntities> cached_regions;
+	cached_regions.swap(regions);
+	std::vector<RegionPos> outdated_regions;
+	const auto& available_regions = world.getAvailableRegions();
+	for (auto region_it = available_regions.begin();
+			region_it != available_regions.end(); ++region_it) {
 		fs::path region_path = world.getRegionPath(*region_it);
-		if (fs::last_write_time(region_path) < timestamp) {
-			LOG(DEBUG) << "Entities of region " << region_path.filename()
-					<< " are cached (mtime region " << fs::last_write_time(region_path)
-					<< " < mtime cache " << timestamp << ").";
-			if (progress != nullptr)
-				progress->setValue(progress->getValue() + 1);
+		// the modification time of remote region files is unknown, the timestamps
+		// of their chunks tell which chunks need to be scanned again
+		std::time_t mtime;
+		uint64_t size;
+		if (!RegionIndex::stat(region_path.string(), mtime, size))
+			mtime = size = 0;
+
+		RegionEntities& entities = regions[*region_it];
+		auto cached = cached_regions.find(*region_it);
+		if (cached != cached_regions.end() && mtime != 0 && cached->second.mtime == mtime
+				&& cached->second.size == size) {
+			LOG(DEBUG) << "Entities of region " << region_path.filename() << " are cached.";
+			entities = cached->second;
 			continue;
-		} else {
-			LOG(DEBUG) << "Entities of region " << region_path.filename()
-					<< " are outdated. (mtime region file " << fs::last_write_time(region_path)
-					<< " >= mtime cache " << timestamp << "). Updating.";
 		}
+		LOG(DEBUG) << "Entities of region " << region_path.filename()
+				<< " are outdated. Updating.";
+		entities.mtime = mtime;
+		entities.size = size;
+		outdated_regions.push_back(*region_it);
+	}
 
-		RegionFile region;
-		world.getRegion(*region_it, region);
-		region.read();
-
-		auto chunks = region.getContainingChunks();
-		for (auto chunk_it = chunks.begin(); chunk_it != chunks.end(); ++chunk_it) {
-			if (region.getChunkTimestamp(*chunk_it) < timestamp)
-				continue;
-
-			this->entities[*region_it][*chunk_it].clear();
-
-			mc::nbt::NBTFile nbt;
-			const std::vector<uint8_t>& data = region.getChunkData(*chunk_it);
-			nbt.readNBT(reinterpret_cast<const char*>(&data[0]), data.size(),
-					mc::nbt::Compression::ZLIB);
+	if (progress != nullptr) {
+		progress->setMax(available_regions.size());
+		progress->setValue(available_regions.size() - outdated_regions.size());
+	}
 
-			nbt::TagCompound& level = nbt.findTag<nbt::TagCompound>("Level");
-			nbt::TagList& entities = level.findTag<nbt::TagList>("TileEntities");
-			for (auto entity_it = entities.payload.begin();
-					entity_it != entities.payload.end(); ++entity_it) {
-				nbt::TagCompound entity = (*entity_it)->cast<nbt::TagCompound>();
-				this->entities[*region_it][*chunk_it].push_back(entity);
+	// the threads take the next outdated region until all regions are scanned
+	std::atomic<size_t> next_region(0);
+	thread_ns::mutex progress_mutex;
+	auto scan = [&]() {
+		size_t index;
+		while ((index = next_region++) < outdated_regions.size()) {
+			const RegionPos& pos = outdated_regions[index];
+			auto cached = cached_regions.find(pos);
+			scanRegion(pos, regions.at(pos),
+					cached != cached_regions.end() ? &cached->second : nullptr);
+			if (progress != nullptr) {
+				thread_ns::unique_lock<thread_ns::mutex> lock(progress_mutex);
+				progress->setValue(progress->getValue() + 1);
 			}
 		}
-		if (progress != nullptr)
-			progress->setValue(progress->getValue() + 1);
+	};
+	threads = std::max(1, std::min(threads, (int) outdated_regions.size()));
+	if (threads == 1)
+		scan();
+	else {
+		std::vector<thread_ns::thread> scan_threads;
+		for (int i = 0; i < threads; i++)
+			scan_threads.push_back(thread_ns::thread(scan));
+		for (auto it = scan_threads.begin(); it != scan_threads.end(); ++it)
+			it->join();
+	}
+
+	LOG(DEBUG) << "Writing cache file " << cache_file << ".";
+	if (!writeCacheFile())
+		LOG(WARNING) << "Unable to write cache file " << cache_file << ".";
+}
+
+bool WorldEntitiesCache::addCollectedSigns(const SignCollector& collector) {
+	readCacheFile();
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(collector.mutex);
+	size_t count = collector.chunks.size();
+	for (auto chunk_it = collector.chunks.begin(); chunk_it != collector.chunks.end();
+			++chunk_it) {
+		RegionEntities& entities = regions[chunk_it->first.getRegion()];
+		// the other chunks of the region need to be checked by the next update
+		entities.mtime = 0;
+		entities.size = 0;
+		ChunkEntities& chunk = entities.chunks[chunk_it->first];
+		chunk.timestamp = chunk_it->second.first;
+		chunk.signs = chunk_it->second.second;
 	}
+	lock.unlock();
 
-	LOG(DEBUG) << "Writing cache file " << cache_file << " at " << std::time(nullptr) << ".";
-	writeCacheFile();
+	LOG(DEBUG) << "Writing cache file " << cache_file << " with the signs of "
+			<< count << " rendered chunks.";
+	return writeCacheFile();
 }
 
 std::vector<SignEntity> WorldEntitiesCache::getSigns(WorldCrop world_crop) const {
 	std::vector<SignEntity> signs;
 
-	for (auto region_it = entities.begin(); region_it != entities.end(); ++region_it) {
+	for (auto region_it = regions.begin(); region_it != regions.end(); ++region_it) {
 		if (!world_crop.isRegionContained(region_it->first))
 			continue;
-		for (auto chunk_it = region_it->second.begin();
-				chunk_it != region_it->second.end(); ++chunk_it) {
-			if (!world_crop.isChunkContained(chunk_it->first))
-				continue;
-			for (auto entity_it = chunk_it->second.begin();
-					entity_it != chunk_it->second.end(); ++entity_it) {
-				const nbt::TagCompound& entity = *entity_it;
-
-				if (entity.findTag<nbt::TagString>("id").payload != "Sign"
-						&& entity.findTag<nbt::TagString>("id").payload != "minecraft:sign")
-					continue;
-
-				mc::BlockPos pos(
-					entity.findTag<nbt::TagInt>("x").payload,
-					entity.findTag<nbt::TagInt>("z").payload,
-					entity.findTag<nbt::TagInt>("y").payload
-				);
-
-				if (!world_crop.isBlockContainedXZ(pos)
+		const RegionEntities& entities = region_it->second;
+		for (auto chunk_it = entities.chunks.begin(); chunk_it != entities.chunks.end();
+				++chunk_it) {
+			const std::vector<Chunk::Sign>& chunk_signs = chunk_it->second.signs;
+			for (auto sign_it = chunk_signs.begin(); sign_it != chunk_signs.end();
+					++sign_it) {
+				const mc::BlockPos& pos = sign_it->first;
+				if (!world_crop.isChunkContained(mc::ChunkPos(pos))
+						|| !world_crop.isBlockContainedXZ(pos)
 						|| !world_crop.isBlockContainedY(pos))
 					continue;
-
-				mc::SignEntity::Lines lines = {{
-					entity.findTag<nbt::TagString>("Text1").payload,
-					entity.findTag<nbt::TagString>("Text2").payload,
-					entity.findTag<nbt::TagString>("Text3").payload,
-					entity.findTag<nbt::TagString>("Text4").payload
-				}};
-
-				signs.push_back(mc::SignEntity(pos, lines));
+				signs.push_back(mc::SignEntity(pos, sign_it->second));
 			}
 		}
 	}
@@ -20,13 +20,17 @@
 #ifndef WORLDENTITIES_H_
 #define WORLDENTITIES_H_
 
+#include "chunk.h"
 #include "nbt.h"
 #include "pos.h"
 #include "world.h"
 #include "worldcrop.h"
+#include "../compat/thread.h"
 
 #include <array>
+#include <ctime>
 #include <map>
+#include <utility>
 #include <vector>
 #include <boost/filesystem.hpp>
 
@@ -65,33 +69,100 @@ private:
 	std::string text;
 };
 
+/**
+ * Collects the signs of the chunks which are decoded for rendering anyway, so the
+ * entities cache doesn't need to read these chunks again. The world caches of the
+ * render threads add their chunks at the same time.
+ */
+class SignCollector {
+public:
+	SignCollector();
+	~SignCollector();
+
+	/**
+	 * Adds the signs of a decoded chunk (original position) with the timestamp of the
+	 * chunk in its region file.
+	 */
+	void addChunk(const ChunkPos& pos, uint32_t timestamp, const Chunk& chunk);
+
+	/**
+	 * Returns the count of the collected chunks.
+	 */
+	size_t size() const;
+
+private:
+	friend class WorldEntitiesCache;
+
+	mutable thread_ns::mutex mutex;
+	std::map<ChunkPos, std::pair<uint32_t, std::vector<Chunk::Sign> > > chunks;
+};
+
 class WorldEntitiesCache {
 public:
 	WorldEntitiesCache(const World& world);
 	~WorldEntitiesCache();
 
 	/**
-	 * Updates the entity cache.
+	 * Updates the entity cache. Only the region files which were modified since they
+	 * were cached are scanned again, with the specified count of threads.
 	 */
-	void update(util::IProgressHandler* progress = nullptr);
+	void update(util::IProgressHandler* progress = nullptr, int threads = 1);
+
+	/**
+	 * Stores the signs of the chunks collected while rendering in the cache file. Chunks
+	 * whose timestamps didn't change since then aren't read again by the next update.
+	 */
+	bool addCollectedSigns(const SignCollector& collector);
 
 	std::vector<SignEntity> getSigns(WorldCrop crop = WorldCrop()) const;
 private:
+	/**
+	 * The cached entities of a chunk.
+	 */
+	struct ChunkEntities {
+		ChunkEntities();
+
+		// timestamp of the chunk in the region file when it was read
+		uint32_t timestamp;
+		// the positions and the (unparsed) lines of the signs
+		std::vector<Chunk::Sign> signs;
+	};
+
+	/**
+	 * The cached entities of a region file.
+	 */
+	struct RegionEntities {
+		RegionEntities();
+
+		// modification time and size of the region file when it was scanned,
+		// 0 if only some of its chunks were read
+		std::time_t mtime;
+		uint64_t size;
+		std::map<ChunkPos, ChunkEntities> chunks;
+	};
+
 	World world;
 	fs::path cache_file;
 
-	std::map<RegionPos, std::map<ChunkPos, std::vector<nbt::TagCompound> > > entities;
+	std::map<RegionPos, RegionEntities> regions;
 
 	/**
-	 * Reads the file with the cached entities and returns a timestamp when this cache
-	 * was updated the last time.
+	 * Reads the file with the cached entities. Returns false if there is no valid
+	 * cache file.
 	 */
-	unsigned int readCacheFile();
+	bool readCacheFile();
 
 	/**
 	 * Writes the file with the cached entities.
 	 */
-	void writeCacheFile() const;
+	bool writeCacheFile() const;
+
+	/**
+	 * Reads the entities of a region file. The entities of the chunks whose timestamps
+	 * didn't change are taken from the previously cached entities of the region.
+	 */
+	void scanRegion(const RegionPos& pos, RegionEntities& entities,
+			const RegionEntities* cached) const;
 };
 
 } /* namespace mc */
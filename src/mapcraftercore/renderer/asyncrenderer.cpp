@@ -0,0 +1,170 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "asyncrenderer.h"
+
+#include "manager.h"
+#include "../util.h"
+
+namespace mapcrafter {
+namespace renderer {
+
+RenderRequest::RenderRequest()
+	: rotation(0), force(false) {
+}
+
+RenderTask::RenderTask(const RenderRequest& request)
+	: request(request), cancelled(false), future(promise.get_future()) {
+}
+
+RenderTask::~RenderTask() {
+}
+
+const RenderRequest& RenderTask::getRequest() const {
+	return request;
+}
+
+thread_ns::shared_future<RenderResult> RenderTask::getFuture() const {
+	return future;
+}
+
+void RenderTask::cancel() {
+	cancelled = true;
+}
+
+bool RenderTask::isCancelled() const {
+	return cancelled;
+}
+
+void RenderTask::finish(RenderResult result) {
+	if (request.finished_callback)
+		request.finished_callback(result);
+	promise.set_value(result);
+}
+
+AsyncRenderer::AsyncRenderer(const config::MapcrafterConfig& config, int threads,
+		int memory_limit)
+	: config(config), threads(threads), memory_limit(memory_limit),
+	  resource_registry(std::make_shared<ResourceRegistry>()), finishing(false) {
+	if (threads > 1)
+		thread_pool = std::make_shared<thread::ThreadPool>(threads);
+	thread = thread_ns::thread(&AsyncRenderer::run, this);
+}
+
+AsyncRenderer::~AsyncRenderer() {
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		finishing = true;
+	}
+	cancelAll();
+	queued.notify_all();
+	thread.join();
+}
+
+std::shared_ptr<RenderTask> AsyncRenderer::submit(const RenderRequest& request) {
+	std::shared_ptr<RenderTask> task = std::make_shared<RenderTask>(request);
+	if (!config.hasMap(request.map)) {
+		LOG(ERROR) << "Unable to render unknown map '" << request.map << "'.";
+		task->finish(RenderResult::FAILED);
+		return task;
+	}
+	if (!config.getMap(request.map).getRotations().count(request.rotation)) {
+		LOG(ERROR) << "Map '" << request.map << "' doesn't have rotation "
+				<< request.rotation << ".";
+		task->finish(RenderResult::FAILED);
+		return task;
+	}
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	queue.push_back(task);
+	queued.notify_all();
+	return task;
+}
+
+void AsyncRenderer::cancelAll() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	for (auto it = queue.begin(); it != queue.end(); ++it)
+		(*it)->cancel();
+	if (running)
+		running->cancel();
+}
+
+int AsyncRenderer::getPendingCount() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return queue.size() + (running ? 1 : 0);
+}
+
+void AsyncRenderer::run() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (true) {
+		while (queue.empty() && !finishing)
+			queued.wait(lock);
+		if (queue.empty())
+			break;
+		running = queue.front();
+		queue.pop_front();
+		std::shared_ptr<RenderTask> task = running;
+
+		// the requests cancelled while they were waiting are not rendered at all
+		lock.unlock();
+		RenderResult result = task->isCancelled() ? RenderResult::CANCELLED : render(*task);
+		task->finish(result);
+		lock.lock();
+		running.reset();
+	}
+}
+
+RenderResult AsyncRenderer::render(RenderTask& task) {
+	const RenderRequest& request = task.getRequest();
+	LOG(INFO) << "Rendering request of map " << request.map << " in rotation "
+			<< config::ROTATION_NAMES[request.rotation] << ".";
+
+	// the manager renders only the map and rotation of the request
+	RenderManager manager(config);
+	RenderBehaviors behaviors(RenderBehavior::SKIP);
+	behaviors.setRenderBehavior(request.map, request.rotation,
+			request.force ? RenderBehavior::FORCE : RenderBehavior::AUTO);
+	manager.setRenderBehaviors(behaviors);
+	if (!request.changed_chunks.empty()) {
+		std::map<std::string, std::set<mc::ChunkPos> > changed_chunks;
+		changed_chunks[config.getMap(request.map).getWorld()] = request.changed_chunks;
+		manager.setChangedChunks(changed_chunks);
+	}
+	manager.setRequestedTiles(request.tiles);
+	if (request.tile_callback) {
+		std::function<void(const TilePath&)> callback = request.tile_callback;
+		manager.setTileCallback([callback](const std::string& map, int rotation,
+				const TilePath& tile) {
+			callback(tile);
+		});
+	}
+	manager.setStopFlag(&task.cancelled);
+	manager.setMemoryLimit((size_t) memory_limit * 1024 * 1024);
+	manager.setThreadPool(thread_pool);
+	manager.setResourceRegistry(resource_registry);
+
+	if (!manager.run(threads, true))
+		return RenderResult::FAILED;
+	if (manager.wasStopped())
+		return RenderResult::CANCELLED;
+	return RenderResult::COMPLETE;
+}
+
+}
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASYNCRENDERER_H_
+#define ASYNCRENDERER_H_
+
+#include "resourceregistry.h"
+#include "tileset.h"
+#include "../compat/thread.h"
+#include "../config/mapcrafterconfig.h"
+#include "../mc/pos.h"
+#include "../thread/impl/threadpool.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * How a render request ended: All its tiles were rendered, it was cancelled (the
+ * remaining tiles are rendered by the next request of the map), or it failed (for
+ * example because the map or the rotation doesn't exist).
+ */
+enum class RenderResult {
+	COMPLETE, CANCELLED, FAILED
+};
+
+/**
+ * A request to render a map in a rotation. Without changed chunks and tiles the outdated
+ * tiles of the map are rendered like by the run method of the render manager, or all
+ * tiles with force.
+ */
+struct RenderRequest {
+	RenderRequest();
+
+	std::string map;
+	int rotation;
+	// the chunks of the world which changed (in the original rotation of the world),
+	// only their tiles are rendered then instead of scanning the whole world
+	std::set<mc::ChunkPos> changed_chunks;
+	// the tiles to render (of any zoom level), only the render tiles in these tiles are
+	// rendered then
+	std::set<TilePath> tiles;
+	bool force;
+
+	// called with every tile once it's written, by the threads writing the tiles
+	std::function<void(const TilePath&)> tile_callback;
+	// called with the result once the request is finished, before the future is ready
+	std::function<void(RenderResult)> finished_callback;
+};
+
+/**
+ * A submitted render request. The future is ready once the request is finished.
+ */
+class RenderTask {
+public:
+	RenderTask(const RenderRequest& request);
+	~RenderTask();
+
+	const RenderRequest& getRequest() const;
+
+	thread_ns::shared_future<RenderResult> getFuture() const;
+
+	/**
+	 * Cancels the request. A waiting request is not rendered at all, a running request
+	 * finishes the tiles being rendered and their composite tiles.
+	 */
+	void cancel();
+
+	bool isCancelled() const;
+
+private:
+	/**
+	 * Calls the finished callback and makes the future ready.
+	 */
+	void finish(RenderResult result);
+
+	RenderRequest request;
+	std::atomic<bool> cancelled;
+	thread_ns::promise<RenderResult> promise;
+	thread_ns::shared_future<RenderResult> future;
+
+	friend class AsyncRenderer;
+};
+
+/**
+ * Renders the maps of a configuration asynchronously, for applications which embed the
+ * renderer. The submitted requests are rendered one after another by a thread of the
+ * renderer, each one like the run method of a render manager restricted to the map and
+ * rotation of the request. The requests share the render threads and the loaded textures
+ * and block images.
+ */
+class AsyncRenderer {
+public:
+	/**
+	 * Creates the renderer with a count of render threads and the memory limit of the
+	 * caches in MiB (0 for no limit).
+	 */
+	AsyncRenderer(const config::MapcrafterConfig& config, int threads,
+			int memory_limit = 0);
+
+	/**
+	 * Cancels the requests and waits until the running one is finished.
+	 */
+	~AsyncRenderer();
+
+	/**
+	 * Queues a render request. The request fails immediately if the map or the rotation
+	 * doesn't exist.
+	 */
+	std::shared_ptr<RenderTask> submit(const RenderRequest& request);
+
+	/**
+	 * Cancels all waiting requests and the running one.
+	 */
+	void cancelAll();
+
+	/**
+	 * Returns how many requests are waiting or running.
+	 */
+	int getPendingCount() const;
+
+private:
+	/**
+	 * Renders the queued requests, on the thread of the renderer.
+	 */
+	void run();
+
+	/**
+	 * Renders a request and returns its result.
+	 */
+	RenderResult render(RenderTask& task);
+
+	config::MapcrafterConfig config;
+	int threads, memory_limit;
+
+	std::shared_ptr<thread::ThreadPool> thread_pool;
+	std::shared_ptr<ResourceRegistry> resource_registry;
+
+	// the waiting requests, the running one, and whether the renderer is destroyed
+	std::deque<std::shared_ptr<RenderTask> > queue;
+	std::shared_ptr<RenderTask> running;
+	bool finishing;
+
+	// guards the requests, and is notified when a request is queued
+	mutable thread_ns::mutex mutex;
+	thread_ns::condition_variable queued;
+	thread_ns::thread thread;
+};
+
+}
+}
+
+#endif /* ASYNCRENDERER_H_ */
@@ -30,6 +30,10 @@ namespace mapcrafter {
 namespace renderer {
 
 
+BiomeColors::BiomeColors()
+	: biome_index(-1), grass(0), grass_flipped(0), foliage(0), foliage_flipped(0) {
+}
+
 Biome::Biome(uint8_t id, double temperature, double rainfall, uint8_t r, uint8_t g, uint8_t b)
 	: id(id), temperature(temperature), rainfall(rainfall),
 	  extra_r(r), extra_g(g), extra_b(b) {
@@ -81,20 +85,8 @@ uint8_t Biome::getID() const {
  * Calculates the color of the biome with a biome color image.
  */
 uint32_t Biome::getColor(const RGBAImage& colors, bool flip_xy) const {
-	// x is temperature
-	double tmp_temperature = temperature;
-	// y is temperature * rainfall
-	double tmp_rainfall = rainfall * temperature;
-
-	// check if temperature and rainfall are valid
-	if(tmp_temperature > 1)
-		tmp_temperature = 1;
-	if (tmp_rainfall > 1)
-		tmp_rainfall = 1;
-
-	// calculate positions
-	int x = 255 - (255 * tmp_temperature);
-	int y = 255 - (255 * tmp_rainfall);
+	int x, y;
+	getColorPosition(x, y);
 
 	// flip them, if needed
 	if (flip_xy) {
@@ -113,6 +105,48 @@ uint32_t Biome::getColor(const RGBAImage& colors, bool flip_xy) const {
 	return color;
 }
 
+BiomeColors Biome::getColors(const RGBAImage& grass_colors,
+		const RGBAImage& foliage_colors) const {
+	BiomeColors colors;
+	colors.biome_index = getBiomeIndex(*this);
+	// the colors of the biome of the id, not the ones of the slightly different values
+	const Biome& biome = colors.biome_index != -1 ? BIOMES[colors.biome_index] : *this;
+	colors.grass = biome.getColor(grass_colors, false);
+	colors.grass_flipped = biome.getColor(grass_colors, true);
+	colors.foliage = biome.getColor(foliage_colors, false);
+	colors.foliage_flipped = biome.getColor(foliage_colors, true);
+	return colors;
+}
+
+/**
+ * The colors only depend on the (integer) position in the color images and the extra
+ * color values.
+ */
+uint64_t Biome::getColorKey() const {
+	int x, y;
+	getColorPosition(x, y);
+	return (uint64_t) (x & 0xffff) | ((uint64_t) (y & 0xffff) << 16)
+			| ((uint64_t) (extra_r & 0xff) << 32) | ((uint64_t) (extra_g & 0xff) << 40)
+			| ((uint64_t) (extra_b & 0xff) << 48);
+}
+
+void Biome::getColorPosition(int& x, int& y) const {
+	// x is temperature
+	double tmp_temperature = temperature;
+	// y is temperature * rainfall
+	double tmp_rainfall = rainfall * temperature;
+
+	// check if temperature and rainfall are valid
+	if(tmp_temperature > 1)
+		tmp_temperature = 1;
+	if (tmp_rainfall > 1)
+		tmp_rainfall = 1;
+
+	// calculate positions
+	x = 255 - (255 * tmp_temperature);
+	y = 255 - (255 * tmp_rainfall);
+}
+
 bool Biome::isBiomeBlock(uint16_t id, uint16_t data) {
 	return id == 2 // grass block
 		|| id == 18 || id == 161 // leaves
@@ -127,6 +161,8 @@ bool Biome::isBiomeBlock(uint16_t id, uint16_t data) {
 // array with all possible biomes with IDs 0 ... 255
 // empty/unknown biomes in this array have the ID 0
 static Biome ALL_BIOMES[256] = {};
+// the indices of the biomes in BIOMES by their IDs
+static int BIOME_INDICES[256] = {};
 static bool biomes_initialized;
 
 void initializeBiomes() {
@@ -134,6 +170,7 @@ void initializeBiomes() {
 	for (size_t i = 0; i < BIOMES_SIZE; i++) {
 		Biome biome = BIOMES[i];
 		ALL_BIOMES[biome.getID()] = biome;
+		BIOME_INDICES[biome.getID()] = i;
 	}
 
 	biomes_initialized = true;
@@ -150,5 +187,12 @@ Biome getBiome(uint8_t id) {
 	return ALL_BIOMES[DEFAULT_BIOME];
 }
 
+int getBiomeIndex(const Biome& biome) {
+	uint8_t id = biome.getID();
+	if (!(biome == getBiome(id)) || ALL_BIOMES[id].getID() != id)
+		return -1;
+	return BIOME_INDICES[id];
+}
+
 } /* namespace render */
 } /* namespace mapcrafter */
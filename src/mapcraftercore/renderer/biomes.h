@@ -28,6 +28,22 @@ namespace renderer {
 
 class RGBAImage;
 
+/**
+ * The colors of a biome (or of biomes averaged at their borders) in the grass and
+ * foliage color images of the textures, at the position of the biome and at the
+ * flipped position (used for birch leaves). The biome blocks are tinted with them, so
+ * the color images are looked up only once per biome or per column of a chunk.
+ */
+struct BiomeColors {
+	BiomeColors();
+
+	// the index of the biome in BIOMES if these are the colors of one of the biomes,
+	// -1 if they are averaged from different biomes
+	int biome_index;
+	uint32_t grass, grass_flipped;
+	uint32_t foliage, foliage_flipped;
+};
+
 /**
  * A Minecraft Biome with data to tint the biome-depend blocks.
  */
@@ -43,6 +59,9 @@ private:
 
 	// extra color values, for example for the swampland biome
 	int extra_r, extra_g, extra_b;
+
+	// calculates the position of the tinting color in the color images
+	void getColorPosition(int& x, int& y) const;
 public:
 	Biome(uint8_t id = 0, double temperature = 0, double rainfall = 0,
 			uint8_t r = 255, uint8_t g = 255, uint8_t b = 255);
@@ -54,6 +73,20 @@ public:
 	uint8_t getID() const;
 	uint32_t getColor(const RGBAImage& colors, bool flip_xy = false) const;
 
+	/**
+	 * Returns the colors of the biome in the grass and foliage color images (see
+	 * BiomeColors). If the biome is (almost) the same as the biome of its id, the colors
+	 * are the ones of that biome.
+	 */
+	BiomeColors getColors(const RGBAImage& grass_colors,
+			const RGBAImage& foliage_colors) const;
+
+	/**
+	 * Returns a key of the colors of the biome. Biomes with the same key have the same
+	 * colors (see getColor), even if their temperature and rainfall values differ.
+	 */
+	uint64_t getColorKey() const;
+
 	static bool isBiomeBlock(uint16_t id, uint16_t data);
 };
 
@@ -138,6 +171,12 @@ static const int DEFAULT_BIOME = 21;		// Jungle
 
 Biome getBiome(uint8_t id);
 
+/**
+ * Returns the index of a biome in BIOMES if it's (almost) the same as the biome of its
+ * id, -1 if it's averaged from different biomes.
+ */
+int getBiomeIndex(const Biome& biome);
+
 } /* namespace render */
 } /* namespace mapcrafter */
 #endif /* BIOMES_H_ */
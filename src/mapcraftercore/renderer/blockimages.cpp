@@ -22,12 +22,55 @@
 #include "biomes.h"
 #include "../util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <list>
 #include <map>
+#include <sstream>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace mapcrafter {
 namespace renderer {
 
+namespace {
+
+/**
+ * Hashes the paths and the contents of the files in a directory (and its
+ * subdirectories), FNV-1a like the content hashes of the chunks.
+ */
+uint64_t hashDirectory(const fs::path& dir) {
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	auto hashBytes = [&hash, prime](const char* data, size_t len) {
+		for (size_t i = 0; i < len; i++)
+			hash = (hash ^ (uint8_t) data[i]) * prime;
+	};
+
+	std::vector<fs::path> files;
+	boost::system::error_code error;
+	for (fs::recursive_directory_iterator it(dir, error), end; !error && it != end;
+			it.increment(error))
+		if (fs::is_regular_file(it->path()))
+			files.push_back(it->path());
+	std::sort(files.begin(), files.end());
+
+	std::vector<char> buffer(64 * 1024);
+	for (auto it = files.begin(); it != files.end(); ++it) {
+		std::string path = it->string().substr(dir.string().size());
+		hashBytes(path.c_str(), path.size() + 1);
+		std::ifstream in(it->string().c_str(), std::ios::binary);
+		while (in.read(&buffer[0], buffer.size()) || in.gcount() > 0)
+			hashBytes(&buffer[0], in.gcount());
+	}
+	return hash;
+}
+
+}
+
 bool ChestTextures::load(const std::string& filename, int texture_size) {
 	RGBAImage image;
 	if (!image.readPNG(filename)) {
@@ -45,10 +88,10 @@ bool ChestTextures::load(const std::string& filename, int texture_size) {
 	int size = ratio * 14;
 
 	RGBAImage front = image.clip(size, 29 * ratio, size, size);
-	front.alphaBlit(image.clip(size, size, size, 4 * ratio), 0, 0);
-	front.alphaBlit(image.clip(ratio, ratio, 2 * ratio, 4 * ratio), 6 * ratio, 3 * ratio);
+	front.alphaBlit(image.view(size, size, size, 4 * ratio), 0, 0);
+	front.alphaBlit(image.view(ratio, ratio, 2 * ratio, 4 * ratio), 6 * ratio, 3 * ratio);
 	RGBAImage side = image.clip(0, 29 * ratio, size, size);
-	side.alphaBlit(image.clip(0, size, size, 4 * ratio), 0, 0);
+	side.alphaBlit(image.view(0, size, size, 4 * ratio), 0, 0);
 	RGBAImage top = image.clip(size, 0, size, size);
 
 	// resize the chest images to texture size
@@ -78,24 +121,24 @@ bool DoubleChestTextures::load(const std::string& filename, int texture_size) {
 	// chest textures are only 14x14 * ratio pixels, so we need to omit two rows in the middle
 	// => the second image starts not at x*size, it starts at x*size+2*ratio
 	RGBAImage front_left = image.clip(size, 29 * ratio, size, size);
-	front_left.alphaBlit(image.clip(size, size, size, 4 * ratio), 0, 0);
-	front_left.alphaBlit(image.clip(ratio, ratio, 2 * ratio, 4 * ratio), 13 * ratio,
+	front_left.alphaBlit(image.view(size, size, size, 4 * ratio), 0, 0);
+	front_left.alphaBlit(image.view(ratio, ratio, 2 * ratio, 4 * ratio), 13 * ratio,
 	        3 * ratio);
 	RGBAImage front_right = image.clip(2 * size + 2 * ratio, 29 * ratio, size, size);
-	front_right.alphaBlit(image.clip(2 * size + 2 * ratio, size, size, 4 * ratio), 0, 0);
-	front_right.alphaBlit(image.clip(ratio, ratio, 2 * ratio, 4 * ratio), -ratio,
+	front_right.alphaBlit(image.view(2 * size + 2 * ratio, size, size, 4 * ratio), 0, 0);
+	front_right.alphaBlit(image.view(ratio, ratio, 2 * ratio, 4 * ratio), -ratio,
 	        3 * ratio);
 
 	RGBAImage side = image.clip(0, 29 * ratio, size, size);
-	side.alphaBlit(image.clip(0, size, size, 4 * ratio), 0, 0);
+	side.alphaBlit(image.view(0, size, size, 4 * ratio), 0, 0);
 
 	RGBAImage top_left = image.clip(size, 0, size, size);
 	RGBAImage top_right = image.clip(2 * size + 2 * ratio, 0, size, size);
 
 	RGBAImage back_left = image.clip(4 * size + 2, 29 * ratio, size, size);
-	back_left.alphaBlit(image.clip(4 * size + 2, size, size, 4 * ratio), 0, 0);
+	back_left.alphaBlit(image.view(4 * size + 2, size, size, 4 * ratio), 0, 0);
 	RGBAImage back_right = image.clip(5 * size + 4, 29 * ratio, size, size);
-	back_right.alphaBlit(image.clip(5 * size + 4, size, size, 4 * ratio), 0, 0);
+	back_right.alphaBlit(image.view(5 * size + 4, size, size, 4 * ratio), 0, 0);
 
 	// resize the chest images to texture size
 	front_left.resize((*this)[DoubleChestTextures::FRONT_LEFT], texture_size, texture_size);
@@ -219,19 +262,19 @@ bool BedTextures::loadSingle(const std::string& filename, int color_index, int t
 	// Render textures by copying things and adding legs
 	side_head_left.simpleBlit(small_side_head_left, 3 * ratio, 0);
 	side_head_left.simpleBlit(leg.rotate(ROTATE_90).flip(false, true), 0, 0);
-	side_head_left = side_head_left.rotate(ROTATE_270);
+	side_head_left = std::move(side_head_left).rotate(ROTATE_270);
 
 	side_head_right.simpleBlit(small_side_head_right, 7 * ratio, 0);
 	side_head_right.simpleBlit(leg.rotate(ROTATE_90).flip(false, true), 13 * ratio, 0);
-	side_head_right = side_head_right.rotate(ROTATE_90);
+	side_head_right = std::move(side_head_right).rotate(ROTATE_90);
 
 	side_foot_left.simpleBlit(small_side_foot_left, 3 * ratio, 0);
 	side_foot_left.simpleBlit(leg.rotate(ROTATE_90), 0, 13 * ratio);
-	side_foot_left = side_foot_left.rotate(ROTATE_270);
+	side_foot_left = std::move(side_foot_left).rotate(ROTATE_270);
 
 	side_foot_right.simpleBlit(small_side_foot_right, 7 * ratio, 0);
 	side_foot_right.simpleBlit(leg.rotate(ROTATE_90), 13 * ratio, 13 * ratio);
-	side_foot_right = side_foot_right.rotate(ROTATE_90);
+	side_foot_right = std::move(side_foot_right).rotate(ROTATE_90);
 
 	side_head_end.simpleBlit(small_side_head_end.flip(false, true), 0, 7 * ratio);
 	side_head_end.simpleBlit(leg.flip(true, false), 0, 13 * ratio);
@@ -257,7 +300,7 @@ bool BedTextures::loadSingle(const std::string& filename, int color_index, int t
 }
 
 TextureResources::TextureResources()
-	: texture_size(12), texture_blur(0) {
+	: texture_size(12), texture_blur(0), water_opacity(1.0), hash(0) {
 }
 
 TextureResources::~TextureResources() {
@@ -272,7 +315,8 @@ int TextureResources::getTextureBlur() const {
 }
 
 bool TextureResources::loadTextures(const std::string& texture_dir,
-		int texture_size, int texture_blur, double water_opacity) {
+		int texture_size, int texture_blur, double water_opacity, int threads) {
+	util::MemoryScope memory(util::MemorySubsystem::BLOCK_IMAGES);
 	// set texture size and blur
 	this->texture_size = texture_size;
 	this->texture_blur = texture_blur;
@@ -294,15 +338,24 @@ bool TextureResources::loadTextures(const std::string& texture_dir,
 	if (!loadColors(dir + "colormap/foliage.png",
 			dir + "colormap/grass.png"))
 		ok = false;
-	if (!loadBlocks(dir + "blocks", dir + "endportal.png"))
+	if (!loadBlocks(dir + "blocks", dir + "endportal.png", threads))
 		ok = false;
 	if (!ok) {
 		LOG(ERROR) << "Invalid texture directory '" << dir << "'. See previous log messages.";
 		return false;
 	}
+
+	hash = hashDirectory(dir);
+	int options[3] = {texture_size, texture_blur, (int) (water_opacity * 1000000)};
+	for (int i = 0; i < 3; i++)
+		hash = (hash ^ (uint32_t) options[i]) * 0x100000001b3ULL;
 	return true;
 }
 
+uint64_t TextureResources::getHash() const {
+	return hash;
+}
+
 const BlockTextures& TextureResources::getBlockTextures() const {
 	return block_textures;
 }
@@ -373,12 +426,24 @@ bool TextureResources::loadColors(const std::string& foliage_png,
 		LOG(ERROR) << "Unable to read '" << grass_png << "'.";
 		ok = false;
 	}
-	return ok;
+	if (!ok)
+		return false;
+	biome_colors.clear();
+	for (size_t i = 0; i < BIOMES_SIZE; i++)
+		biome_colors.push_back(BIOMES[i].getColors(grass_colors, foliage_colors));
+	return true;
+}
+
+BiomeColors TextureResources::getBiomeColors(const Biome& biome) const {
+	int index = getBiomeIndex(biome);
+	if (index != -1 && (size_t) index < biome_colors.size())
+		return biome_colors[index];
+	return biome.getColors(grass_colors, foliage_colors);
 }
 
 bool TextureResources::loadBlocks(const std::string& block_dir,
-		const std::string& endportal_png) {
-	if (!block_textures.load(block_dir, texture_size, texture_blur, water_opacity))
+		const std::string& endportal_png, int threads) {
+	if (!block_textures.load(block_dir, texture_size, texture_blur, water_opacity, threads))
 		return false;
 	empty_texture.setSize(texture_size, texture_size);
 
@@ -395,9 +460,131 @@ bool TextureResources::loadBlocks(const std::string& block_dir,
 BlockImages::~BlockImages() {
 }
 
+namespace {
+
+// the id of the last created block images, see AbstractBlockImages::biome_cache_id
+std::atomic<uint64_t> last_biome_cache_id(0);
+
+// "MCBI" and version of the block images cache file format, the byte order of the host
+// is used
+const uint32_t CACHE_MAGIC = 0x4d434249;
+const uint32_t CACHE_VERSION = 2;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+void writeImage(std::ostream& out, const RGBAImage& image) {
+	writeValue(out, (uint32_t) image.getWidth());
+	writeValue(out, (uint32_t) image.getHeight());
+	if (image.getWidth() > 0 && image.getHeight() > 0)
+		out.write(reinterpret_cast<const char*>(&image.pixel(0, 0)),
+				sizeof(RGBAPixel) * image.getWidth() * image.getHeight());
+}
+
+bool readImage(std::istream& in, RGBAImage& image) {
+	uint32_t width, height;
+	if (!readValue(in, width) || !readValue(in, height) || width > 1024 || height > 1024)
+		return false;
+	image.setSize(width, height);
+	if (width == 0 || height == 0)
+		return true;
+	return (bool) in.read(reinterpret_cast<char*>(&image.pixel(0, 0)),
+			sizeof(RGBAPixel) * width * height);
+}
+
+/**
+ * Writes / reads a map of images with the keys.
+ */
+template <typename Key>
+void writeImages(std::ostream& out, const std::unordered_map<Key, RGBAImage>& images) {
+	writeValue(out, (uint32_t) images.size());
+	for (auto it = images.begin(); it != images.end(); ++it) {
+		writeValue(out, it->first);
+		writeImage(out, it->second);
+	}
+}
+
+template <typename Key>
+bool readImages(std::istream& in, std::unordered_map<Key, RGBAImage>& images) {
+	images.clear();
+	uint32_t count;
+	if (!readValue(in, count))
+		return false;
+	for (uint32_t i = 0; i < count; i++) {
+		Key key;
+		if (!readValue(in, key) || !readImage(in, images[key]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * A cache of the recently created biome blocks (the ones of averaged biomes) of one
+ * thread, with the least recently used blocks evicted first. The blocks are identified
+ * by id, data and the color they are tinted with and belong to one block images object.
+ */
+class BiomeBlockCache {
+public:
+	static const size_t CAPACITY = 1024;
+
+	typedef std::tuple<uint16_t, uint16_t, uint32_t> Key;
+
+	BiomeBlockCache()
+		: owner(0) {
+	}
+
+	/**
+	 * Returns a cached block, or nullptr if it's not in the cache.
+	 */
+	const RGBAImage* get(uint64_t owner, const Key& key) {
+		if (owner != this->owner) {
+			images.clear();
+			index.clear();
+			this->owner = owner;
+			return nullptr;
+		}
+		auto it = index.find(key);
+		if (it == index.end())
+			return nullptr;
+		images.splice(images.begin(), images, it->second);
+		return &it->second->second;
+	}
+
+	/**
+	 * Puts a block into the cache, call it only after get() didn't find it.
+	 */
+	void put(const Key& key, const RGBAImage& image) {
+		images.push_front(std::make_pair(key, image));
+		index[key] = images.begin();
+		if (images.size() > CAPACITY) {
+			index.erase(images.back().first);
+			images.pop_back();
+		}
+	}
+
+private:
+	typedef std::list<std::pair<Key, RGBAImage> > ImageList;
+
+	uint64_t owner;
+	// blocks ordered from most to least recently used
+	ImageList images;
+	std::map<Key, ImageList::iterator> index;
+};
+
+}
+
 AbstractBlockImages::AbstractBlockImages()
 	: texture_size(12), rotation(0), render_unknown_blocks(false),
-	  render_leaves_transparent(true), max_water_preblit(9042) /* it's over 9000! */ {
+	  render_leaves_transparent(true), generate_threads(1),
+	  max_water_preblit(9042) /* it's over 9000! */,
+	  biome_cache_id(++last_biome_cache_id) {
 }
 
 AbstractBlockImages::~AbstractBlockImages() {
@@ -413,9 +600,11 @@ void AbstractBlockImages::setRenderSpecialBlocks(bool render_unknown_blocks,
 	this->render_leaves_transparent = render_leaves_transparent;
 }
 
-void AbstractBlockImages::generateBlocks(const TextureResources& resources) {
+void AbstractBlockImages::generateBlocks(const TextureResources& resources, int threads) {
+	util::MemoryScope memory(util::MemorySubsystem::BLOCK_IMAGES);
 	this->resources = resources;
 	this->texture_size = resources.getTextureSize();
+	this->generate_threads = threads;
 
 	empty_texture.setSize(texture_size, texture_size);
 	unknown_block.setSize(getBlockSize(), getBlockSize());
@@ -423,9 +612,87 @@ void AbstractBlockImages::generateBlocks(const TextureResources& resources) {
 	// otherwise just keep it a transparent image
 	if (render_unknown_blocks)
 		unknown_block = createUnknownBlock();
+	block_index_ids.clear();
 	createBlocks();
 	createBiomeBlocks();
 	max_water_preblit = createOpaqueWater();
+	buildBlockIndex();
+}
+
+bool AbstractBlockImages::readBlocks(const TextureResources& resources,
+		const std::string& filename) {
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	uint32_t magic, version, key_size;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, key_size)
+			|| magic != CACHE_MAGIC || version != CACHE_VERSION || key_size > 1024)
+		return false;
+	// the block size of the key depends on the texture size
+	this->texture_size = resources.getTextureSize();
+	std::string key(key_size, 0);
+	if (!in.read(&key[0], key_size) || key != getCacheKey(resources))
+		return false;
+
+	this->resources = resources;
+	empty_texture.setSize(texture_size, texture_size);
+
+	int32_t max_water_preblit;
+	uint32_t transparency_count;
+	bool ok = readValue(in, max_water_preblit) && readImage(in, unknown_block)
+			&& readImages(in, block_images) && readImages(in, block_images_bed)
+			&& readValue(in, transparency_count);
+	block_transparency.clear();
+	for (uint32_t i = 0; ok && i < transparency_count; i++) {
+		uint32_t block;
+		ok = readValue(in, block);
+		block_transparency.insert(block);
+	}
+	// a truncated cache file is not valid at all
+	if (!ok) {
+		block_images.clear();
+		block_images_bed.clear();
+		block_transparency.clear();
+		block_index_ids.clear();
+		return false;
+	}
+	this->max_water_preblit = max_water_preblit;
+	createBiomeBlocks();
+	buildBlockIndex();
+	return true;
+}
+
+bool AbstractBlockImages::writeBlocks(const std::string& filename) const {
+	// write to a temporary file first to not leave a broken cache file behind
+	std::string tmp_filename = filename + ".tmp";
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	std::string key = getCacheKey(resources);
+	writeValue(out, CACHE_MAGIC);
+	writeValue(out, CACHE_VERSION);
+	writeValue(out, (uint32_t) key.size());
+	out.write(key.c_str(), key.size());
+	writeValue(out, (int32_t) max_water_preblit);
+	writeImage(out, unknown_block);
+	writeImages(out, block_images);
+	writeImages(out, block_images_bed);
+	writeValue(out, (uint32_t) block_transparency.size());
+	for (auto it = block_transparency.begin(); it != block_transparency.end(); ++it)
+		writeValue(out, *it);
+	out.close();
+	if (!out)
+		return false;
+	return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+std::string AbstractBlockImages::getKey(const TextureResources& resources) const {
+	// the block size of the cache key is the one of the generated block images
+	std::ostringstream key;
+	key << resources.getTextureSize() << " " << getCacheKey(resources);
+	return key.str();
 }
 
 RGBAImage AbstractBlockImages::exportBlocks() const {
@@ -460,12 +727,32 @@ bool AbstractBlockImages::isBlockTransparent(uint16_t id, uint16_t data) const {
 	// FIXME
 	if (id == 64 || id == 71 || id == 26)
 		return true;
+	if (!block_index_ids.empty()) {
+		uint32_t entry = getBlockIndexEntry(id, data);
+		if (entry == 0)
+			return !render_unknown_blocks;
+		return entry & BLOCK_INDEX_TRANSPARENT;
+	}
 	if (block_images.count(id | (data << 16)) == 0)
 		return !render_unknown_blocks;
 	return block_transparency.count(id | (data << 16)) != 0;
 }
 
+uint64_t AbstractBlockImages::getTransparencyHash() const {
+	// the hashes of the blocks are added up, so the order of the map doesn't matter
+	uint64_t hash = render_unknown_blocks;
+	for (auto it = block_images.begin(); it != block_images.end(); ++it) {
+		uint64_t value = ((uint64_t) it->first << 1) | block_transparency.count(it->first);
+		value = (value ^ (value >> 33)) * 0xff51afd7ed558ccdULL;
+		value = (value ^ (value >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+		hash += value ^ (value >> 33);
+	}
+	return hash;
+}
+
 bool AbstractBlockImages::hasBlock(uint16_t id, uint16_t data) const {
+	if (!block_index_ids.empty())
+		return getBlockIndexEntry(id, data) != 0;
 	return block_images.count(id | (data << 16)) != 0;
 }
 
@@ -483,27 +770,54 @@ const RGBAImage& AbstractBlockImages::getBlock(uint16_t id, uint16_t data, uint1
 		return block_images_bed.at(data | (extra_data << 16));
 	}
 
+	if (!block_index_ids.empty()) {
+		uint32_t entry = getBlockIndexEntry(id, data);
+		if (entry == 0)
+			return unknown_block;
+		return *block_index_images[(entry & ~BLOCK_INDEX_TRANSPARENT) - 1];
+	}
 	if (!hasBlock(id, data))
 		return unknown_block;
 	return block_images.at(id | (data << 16));
 }
 
+BiomeColors AbstractBlockImages::getBiomeColors(const Biome& biome) const {
+	return resources.getBiomeColors(biome);
+}
+
 RGBAImage AbstractBlockImages::getBiomeBlock(uint16_t id, uint16_t data,
-		const Biome& biome, uint16_t extra_data) const {
+		const BiomeColors& colors, uint16_t extra_data) const {
 	data = filterBlockData(id, data);
 	if (!hasBlock(id, data))
 		return unknown_block;
 
-	// check if this biome block is precalculated
-	if (biome == getBiome(biome.getID())) {
-		int64_t key = id | (((int64_t) data) << 16) | (((int64_t) biome.getID()) << 32);
-		if (!biome_images.count(key))
+	// check if this is a biome block of one of the biomes, its image is created only once
+	if (colors.biome_index != -1) {
+		auto it = biome_block_offsets.find(id | (data << 16));
+		if (it == biome_block_offsets.end())
 			return unknown_block;
-		return biome_images.at(key);
+		BiomeBlockImage& block = biome_blocks[it->second + colors.biome_index];
+		thread_ns::call_once(block.created, [&]() {
+			block.image = createBiomeBlock(id, data, getBiomeColor(id, data, colors));
+		});
+		return block.image;
 	}
 
-	// create the block if not
-	return createBiomeBlock(id, data, biome);
+	// create the block if not, the created blocks are cached since blocks at the biome
+	// borders are mostly averaged from the same few biomes
+	uint32_t color = getBiomeColor(id, data, colors);
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local BiomeBlockCache cache;
+	BiomeBlockCache::Key key(id, data, color);
+	const RGBAImage* cached = cache.get(biome_cache_id, key);
+	if (cached != nullptr)
+		return *cached;
+	RGBAImage block = createBiomeBlock(id, data, color);
+	cache.put(key, block);
+	return block;
+#else
+	return createBiomeBlock(id, data, color);
+#endif
 }
 
 int AbstractBlockImages::getMaxWaterPreblit() const {
@@ -548,35 +862,103 @@ uint16_t AbstractBlockImages::filterBlockData(uint16_t id, uint16_t data) const
 
 void AbstractBlockImages::setBlockImage(uint16_t id, uint16_t data,
 		const RGBAImage& block) {
-	block_images[id | (data << 16)] = block;
-
 	// check if block contains transparency
-	if (isImageTransparent(block))
+	bool transparent = isImageTransparent(block);
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(block_images_mutex);
+	block_images[id | (data << 16)] = block;
+	if (transparent)
 		block_transparency.insert(id | (data << 16));
 }
 
 void AbstractBlockImages::setBedImage(uint16_t data, uint16_t extra_data,
 		const RGBAImage& block) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(block_images_mutex);
 	block_images_bed[data | (extra_data << 16)] = block;
 }
 
+void AbstractBlockImages::runBlockTasks(const std::vector<std::function<void()> >& tasks) {
+	// the threads take the next task until all tasks are done
+	std::atomic<size_t> next_task(0);
+	auto runTasks = [&]() {
+		size_t i;
+		while ((i = next_task++) < tasks.size())
+			tasks[i]();
+	};
+	std::vector<thread_ns::thread> workers;
+	for (int i = 1; i < generate_threads && i < (int) tasks.size(); i++)
+		workers.push_back(thread_ns::thread(runTasks));
+	runTasks();
+	for (auto it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+}
+
 void AbstractBlockImages::createBiomeBlocks() {
+	biome_block_offsets.clear();
 	for (std::unordered_map<uint32_t, RGBAImage>::iterator it = block_images.begin();
 			it != block_images.end(); ++it) {
 		uint16_t id = it->first & 0xffff;
 		uint16_t data = (it->first & 0xffff0000) >> 16;
 
 		// check if this is a biome block
-		if (!Biome::isBiomeBlock(id, data))
-			continue;
-
-		for (size_t i = 0; i < BIOMES_SIZE; i++) {
-			Biome biome = BIOMES[i];
-			uint64_t b = biome.getID();
-			biome_images[id | ((uint64_t) data << 16) | (b << 32)] =
-					createBiomeBlock(id, data, biome);
+		if (Biome::isBiomeBlock(id, data)) {
+			size_t offset = biome_block_offsets.size() * BIOMES_SIZE;
+			biome_block_offsets[it->first] = offset;
 		}
 	}
+	biome_blocks.reset(new BiomeBlockImage[biome_block_offsets.size() * BIOMES_SIZE]);
+}
+
+std::string AbstractBlockImages::getCacheKey(const TextureResources& resources) const {
+	std::ostringstream key;
+	key << std::hex << resources.getHash() << std::dec << " " << getBlockSize()
+		<< " " << rotation << " " << render_unknown_blocks
+		<< " " << render_leaves_transparent;
+	return key.str();
+}
+
+void AbstractBlockImages::buildBlockIndex() {
+	// at first find the range of the data values of every block id
+	std::map<uint32_t, RGBAImage*, block_images_comparator> blocks_sorted;
+	int max_id = -1;
+	for (auto it = block_images.begin(); it != block_images.end(); ++it) {
+		blocks_sorted[it->first] = &it->second;
+		max_id = std::max(max_id, (int) (it->first & 0xffff));
+	}
+	block_index_ids.assign(max_id + 1, BlockIndexRange{0, 0});
+	for (auto it = blocks_sorted.begin(); it != blocks_sorted.end(); ++it) {
+		uint16_t id = it->first & 0xffff;
+		uint16_t data = (it->first & 0xffff0000) >> 16;
+		block_index_ids[id].size = std::max<uint32_t>(block_index_ids[id].size,
+				(data & 0x1fff) + 1);
+	}
+	uint32_t size = 0;
+	for (auto it = block_index_ids.begin(); it != block_index_ids.end(); ++it) {
+		it->offset = size;
+		size += it->size * 8;
+	}
+
+	// then store the images (ordered by id and data) and their entries
+	block_index.assign(size, 0);
+	block_index_images.clear();
+	for (auto it = blocks_sorted.begin(); it != blocks_sorted.end(); ++it) {
+		uint16_t id = it->first & 0xffff;
+		uint16_t data = (it->first & 0xffff0000) >> 16;
+		block_index_images.push_back(it->second);
+		uint32_t entry = block_index_images.size();
+		if (block_transparency.count(it->first))
+			entry |= BLOCK_INDEX_TRANSPARENT;
+		block_index[block_index_ids[id].offset + (data & 0x1fff) * 8 + (data >> 13)] = entry;
+	}
+}
+
+uint32_t AbstractBlockImages::getBlockIndexEntry(uint16_t id, uint16_t data) const {
+	if (id >= block_index_ids.size())
+		return 0;
+	const BlockIndexRange& range = block_index_ids[id];
+	if ((uint32_t) (data & 0x1fff) >= range.size)
+		return 0;
+	return block_index[range.offset + (data & 0x1fff) * 8 + (data >> 13)];
 }
 
 std::vector<RGBAImage> AbstractBlockImages::getExportBlocks() const {
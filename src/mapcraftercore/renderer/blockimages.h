@@ -20,11 +20,15 @@
 #ifndef BLOCKIMAGES_H_
 #define BLOCKIMAGES_H_
 
+#include "biomes.h"
 #include "blocktextures.h"
 #include "image.h"
 #include "../mc/pos.h"
+#include "../compat/thread.h"
 
 #include <array>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -33,8 +37,6 @@
 namespace mapcrafter {
 namespace renderer {
 
-class Biome;
-
 // general stuff both render views can use
 const int FACE_NORTH = 1;
 const int FACE_EAST = 2;
@@ -202,9 +204,18 @@ public:
 	 * range [0; 1] (Default 1) and is a factor which is applied to the opacity of the
 	 * water texture. With 1.0 the alpha channel of the texture is not changed, with 0.0
 	 * the texture will be completely transparent.
+	 *
+	 * The block textures are loaded with the specified count of threads.
 	 */
 	bool loadTextures(const std::string& texture_dir, int texture_size = 12,
-			int texture_blur = 0, double water_opacity = 1.0);
+			int texture_blur = 0, double water_opacity = 1.0, int threads = 1);
+
+	/**
+	 * Returns a hash of the files in the texture directory and of the texture options
+	 * the textures were loaded with. Block images generated from textures with the same
+	 * hash are the same (with the same block images options).
+	 */
+	uint64_t getHash() const;
 
 	/**
 	 * Returns the loaded block texture files.
@@ -261,6 +272,13 @@ public:
 	 */
 	const RGBAImage& getGrassColors() const;
 
+	/**
+	 * Returns the colors of a biome in the grass and foliage color textures. The colors
+	 * of the biomes in BIOMES are looked up when the textures are loaded, only the ones
+	 * of averaged biomes are looked up here.
+	 */
+	BiomeColors getBiomeColors(const Biome& biome) const;
+
 private:
 	/**
 	 * Loads the chest textures from the supplied files.
@@ -278,11 +296,14 @@ private:
 	/**
 	 * Loads the block textures and the endportal texture from the supplied directory/file.
 	 */
-	bool loadBlocks(const std::string& block_dir, const std::string& endportal_png);
+	bool loadBlocks(const std::string& block_dir, const std::string& endportal_png,
+			int threads);
 
 	// used texture size, blur
 	int texture_size, texture_blur;
 	double water_opacity;
+	// see getHash()
+	uint64_t hash;
 
 	// all the loaded texture images
 	BlockTextures block_textures;
@@ -295,6 +316,8 @@ private:
 	BedTextures bed_textures;
 
 	RGBAImage foliage_colors, grass_colors;
+	// the colors of the biomes in BIOMES (in the same order)
+	std::vector<BiomeColors> biome_colors;
 };
 
 /**
@@ -319,9 +342,30 @@ public:
 			bool render_leaves_transparent) = 0;
 
 	/**
-	 * Generates the block images with the supplied textures.
+	 * Generates the block images with the supplied textures, with the specified count of
+	 * threads.
+	 */
+	virtual void generateBlocks(const TextureResources& resources, int threads = 1) = 0;
+
+	/**
+	 * Reads the block images from a cache file instead of generating them, if the file
+	 * contains block images generated with the same textures and options. Returns false
+	 * if that's not the case or the file is not a valid cache file, the block images
+	 * need to be generated then.
 	 */
-	virtual void generateBlocks(const TextureResources& resources) = 0;
+	virtual bool readBlocks(const TextureResources& resources,
+			const std::string& filename) = 0;
+
+	/**
+	 * Writes the generated block images to a cache file.
+	 */
+	virtual bool writeBlocks(const std::string& filename) const = 0;
+
+	/**
+	 * Returns a key of the textures and options of the configured block images. Block
+	 * images with the same key are the same, so they can be shared between maps.
+	 */
+	virtual std::string getKey(const TextureResources& resources) const = 0;
 
 	/**
 	 * Exports the block images by just blitting all the generated block images together
@@ -335,6 +379,13 @@ public:
 	 */
 	virtual bool isBlockTransparent(uint16_t id, uint16_t data) const = 0;
 
+	/**
+	 * Returns a hash of which blocks have block images and which of them are
+	 * transparent. The visible blocks of a tile depend only on that (and not on the
+	 * other pixels of the block images).
+	 */
+	virtual uint64_t getTransparencyHash() const = 0;
+
 	/**
 	 * Returns whether there is a block image of a specific block.
 	 */
@@ -345,10 +396,22 @@ public:
 	 */
 	virtual const RGBAImage& getBlock(uint16_t id, uint16_t data, uint16_t extra_data = 0) const = 0;
 
+	/**
+	 * Returns the colors of a biome to tint the biome blocks with, see BiomeColors.
+	 */
+	virtual BiomeColors getBiomeColors(const Biome& biome) const = 0;
+
+	/**
+	 * Returns the color of the colors of a biome a biome block is tinted with.
+	 */
+	virtual uint32_t getBiomeColor(uint16_t id, uint16_t data,
+			const BiomeColors& colors) const = 0;
+
 	/**
 	 * Returns the block image of a block whose appearance is depending on the biome.
 	 */
-	virtual RGBAImage getBiomeBlock(uint16_t id, uint16_t data, const Biome& biome, uint16_t extra_data = 0) const = 0;
+	virtual RGBAImage getBiomeBlock(uint16_t id, uint16_t data, const BiomeColors& colors,
+			uint16_t extra_data = 0) const = 0;
 
 	/**
 	 * Returns how many blocks of water are needed in a row until the water becomes (almost)
@@ -391,7 +454,12 @@ public:
 	 * Implements the method of the interface. Handles the creation of the blocks by
 	 * calling the abstract methods (createBlocks(), createBiomeBlocks(), ...).
 	 */
-	virtual void generateBlocks(const TextureResources& resources);
+	virtual void generateBlocks(const TextureResources& resources, int threads = 1);
+
+	virtual bool readBlocks(const TextureResources& resources, const std::string& filename);
+	virtual bool writeBlocks(const std::string& filename) const;
+
+	virtual std::string getKey(const TextureResources& resources) const;
 
 	/**
 	 * Implements the method of the interface. Blits all the block images returned by the
@@ -400,11 +468,14 @@ public:
 	virtual RGBAImage exportBlocks() const;
 
 	virtual bool isBlockTransparent(uint16_t id, uint16_t data) const;
+	virtual uint64_t getTransparencyHash() const;
 	virtual bool hasBlock(uint16_t id, uint16_t data) const;
 	virtual bool hasBedBlock(uint16_t data, uint16_t extra_data) const;
 	virtual const RGBAImage& getBlock(uint16_t id, uint16_t data, uint16_t extra_data = 0) const;
 
-	virtual RGBAImage getBiomeBlock(uint16_t id, uint16_t data, const Biome& biome, uint16_t extra_data = 0) const;
+	virtual BiomeColors getBiomeColors(const Biome& biome) const;
+	virtual RGBAImage getBiomeBlock(uint16_t id, uint16_t data, const BiomeColors& colors,
+			uint16_t extra_data = 0) const;
 
 	virtual int getMaxWaterPreblit() const;
 
@@ -449,11 +520,13 @@ protected:
 	virtual RGBAImage createUnknownBlock() const = 0;
 
 	/**
-	 * Implement this and create the biome-specific version of the specified block.
-	 * This method is called by the createBiomeBlocks() method and the result is stored
-	 * by it, so you don't need to cache any biome block images, just create them in here.
+	 * Implement this and create the biome-specific version of the specified block, tinted
+	 * with the color getBiomeColor returns for the block.
+	 * This method is called by the getBiomeBlock-method and the result is stored by it,
+	 * so you don't need to cache any biome block images, just create them in here.
+	 * It may be called from multiple threads at the same time.
 	 */
-	virtual RGBAImage createBiomeBlock(uint16_t id, uint16_t data, const Biome& biome) const = 0;
+	virtual RGBAImage createBiomeBlock(uint16_t id, uint16_t data, uint32_t color) const = 0;
 
 	/**
 	 * You have to create all your block images in this method and store them with the
@@ -462,10 +535,19 @@ protected:
 	virtual void createBlocks() = 0;
 
 	/**
-	 * Creates the biome block images by iterating the generated blocks (the method is
-	 * called after createBlocks()), checking with the Biome::isBiomeBlock(id, data)
-	 * function if this is a biome block and then calling the createBiomeBlock-method
-	 * for every biome. The biome blocks are stored in the biome_images map then.
+	 * Runs tasks which create block images with the count of threads passed to
+	 * generateBlocks, createBlocks can split the blocks into such tasks. The tasks store
+	 * their block images with setBlockImage and setBedImage (guarded by
+	 * block_images_mutex), they must not read the block images of other tasks.
+	 */
+	void runBlockTasks(const std::vector<std::function<void()> >& tasks);
+
+	/**
+	 * Prepares the biome block images by iterating the generated blocks (the method is
+	 * called after createBlocks()) and checking with the Biome::isBiomeBlock(id, data)
+	 * function if this is a biome block. The images of a biome block are not created
+	 * here, but with the createBiomeBlock-method the first time they are needed, since
+	 * most worlds contain only a few of all the biome/block combinations.
 	 *
 	 * Overwrite this if you need special handling for biome blocks.
 	 */
@@ -481,6 +563,26 @@ protected:
 	 */
 	virtual std::vector<RGBAImage> getExportBlocks() const;
 
+	/**
+	 * Returns a key of the textures and options the block images are generated with,
+	 * cache files of block images with another key are not used. Child classes with
+	 * more options should append them to the key of this parent method.
+	 */
+	virtual std::string getCacheKey(const TextureResources& resources) const;
+
+	/**
+	 * Builds the lookup table of the generated block images (see block_index). This is
+	 * called after all block images are generated, until then the lookups use the maps
+	 * of the block images.
+	 */
+	void buildBlockIndex();
+
+	/**
+	 * Returns the entry of the lookup table of a block (with already filtered data),
+	 * or 0 if there is no image of the block.
+	 */
+	uint32_t getBlockIndexEntry(uint16_t id, uint16_t data) const;
+
 	// some options that were passed to us
 	int texture_size;
 	int rotation;
@@ -490,6 +592,11 @@ protected:
 	TextureResources resources;
 	RGBAImage empty_texture;
 
+	// count of threads the block images are generated with, and guards the block images
+	// while they are generated
+	int generate_threads;
+	thread_ns::mutex block_images_mutex;
+
 	// map of block images
 	// key is a 32 bit integer, first two bytes id, second two bytes data
 	std::unordered_map<uint32_t, RGBAImage> block_images;
@@ -512,15 +619,44 @@ protected:
 		}
 	};
 
-	// map of biome block images
-	// key is a 64 bit integer, first four bytes id, data, next byte is the biome id
-	std::unordered_map<uint64_t, RGBAImage> biome_images;
+	// biome block images of the biomes in BIOMES, created the first time they are needed
+	// biome_block_offsets maps a biome block (id, data as key again) to the offset of
+	// its images in biome_blocks, there is one image for every biome (in the order of
+	// the biomes in BIOMES, see BiomeColors::biome_index)
+	struct BiomeBlockImage {
+		thread_ns::once_flag created;
+		RGBAImage image;
+	};
+	std::unordered_map<uint32_t, size_t> biome_block_offsets;
+	std::unique_ptr<BiomeBlockImage[]> biome_blocks;
 
 	// set of blocks (id, data as key again) which contain transparency
 	std::unordered_set<uint32_t> block_transparency;
+
+	// lookup table of the block images, the entries of a block id start at
+	// block_index_ids[id].offset, the entry of a data value is at
+	// offset + (data & 0x1fff) * 8 + (data >> 13) (the highest three bits are the edge
+	// bits of isometric block images), block_index_ids[id].size is the count of the
+	// data values without the edge bits with entries
+	// an entry is the index + 1 of the image in block_index_images (0 if there is no
+	// image of the block) with the BLOCK_INDEX_TRANSPARENT bit if the image contains
+	// transparency
+	// the table is looked up for every rendered block, so it's allocated from the huge
+	// page arena if it's enabled (like the block images)
+	struct BlockIndexRange {
+		uint32_t offset, size;
+	};
+	std::vector<BlockIndexRange> block_index_ids;
+	std::vector<uint32_t, util::ArenaAllocator<uint32_t> > block_index;
+	std::vector<const RGBAImage*> block_index_images;
+	static const uint32_t BLOCK_INDEX_TRANSPARENT = 1u << 31;
 	RGBAImage unknown_block;
 
 	int max_water_preblit;
+
+	// identifies these block images in the (per thread) caches of the biome blocks which
+	// are created by getBiomeBlock
+	uint64_t biome_cache_id;
 };
 
 }
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blockprofiler.h"
+
+#include "../config.h"
+#include "../compat/thread.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+const char* PATH_NAMES[] = {"hidden", "neighbors", "preblit water", "biome",
+	"render mode", "shared image"};
+
+static_assert(sizeof(PATH_NAMES) / sizeof(PATH_NAMES[0]) == (int) BlockPath::COUNT,
+		"Every path needs a name");
+
+/**
+ * The costs of the sampled blocks of one thread. Other threads only read them while
+ * writing the report, so the lock is hardly ever contended.
+ */
+struct ThreadBlockCosts {
+	thread_ns::mutex mutex;
+	std::map<std::pair<uint16_t, int>, BlockCost> costs;
+};
+
+// the costs of all threads which sampled a block, kept after the threads finished
+thread_ns::mutex costs_mutex;
+std::vector<std::shared_ptr<ThreadBlockCosts> > thread_costs;
+
+#ifdef HAVE_THREAD_LOCAL
+// the blocks until the next sampled block, the block sampled at the moment, and the
+// costs of the thread
+thread_local int countdown = 0;
+thread_local BlockSample* current_sample = nullptr;
+thread_local ThreadBlockCosts* costs = nullptr;
+
+ThreadBlockCosts& getThreadCosts() {
+	if (costs == nullptr) {
+		thread_ns::unique_lock<thread_ns::mutex> lock(costs_mutex);
+		thread_costs.push_back(std::make_shared<ThreadBlockCosts>());
+		costs = thread_costs.back().get();
+	}
+	return *costs;
+}
+#endif
+
+}
+
+const char* getBlockPathName(BlockPath path) {
+	return PATH_NAMES[(int) path];
+}
+
+BlockCost::BlockCost()
+	: samples(0), nanoseconds(0), blits(0) {
+}
+
+BlockCost& BlockCost::operator+=(const BlockCost& other) {
+	samples += other.samples;
+	nanoseconds += other.nanoseconds;
+	blits += other.blits;
+	return *this;
+}
+
+int BlockProfiler::sampling = 0;
+
+bool BlockProfiler::setSampling(int sampling) {
+#ifdef HAVE_THREAD_LOCAL
+	BlockProfiler::sampling = std::max(0, sampling);
+	return true;
+#else
+	return sampling <= 0;
+#endif
+}
+
+int BlockProfiler::getSampling() {
+	return sampling;
+}
+
+std::map<std::pair<uint16_t, int>, BlockCost> BlockProfiler::getCosts() {
+	std::map<std::pair<uint16_t, int>, BlockCost> all;
+	thread_ns::unique_lock<thread_ns::mutex> lock(costs_mutex);
+	for (auto it = thread_costs.begin(); it != thread_costs.end(); ++it) {
+		thread_ns::unique_lock<thread_ns::mutex> thread_lock((*it)->mutex);
+		for (auto cost_it = (*it)->costs.begin(); cost_it != (*it)->costs.end(); ++cost_it)
+			all[cost_it->first] += cost_it->second;
+	}
+	return all;
+}
+
+void BlockProfiler::reset() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(costs_mutex);
+	for (auto it = thread_costs.begin(); it != thread_costs.end(); ++it) {
+		thread_ns::unique_lock<thread_ns::mutex> thread_lock((*it)->mutex);
+		(*it)->costs.clear();
+	}
+}
+
+void BlockProfiler::writeReport(std::ostream& out) {
+	std::map<std::pair<uint16_t, int>, BlockCost> costs = getCosts();
+	std::vector<std::pair<std::pair<uint16_t, int>, BlockCost> > sorted(costs.begin(),
+			costs.end());
+	std::sort(sorted.begin(), sorted.end(), [](
+			const std::pair<std::pair<uint16_t, int>, BlockCost>& cost1,
+			const std::pair<std::pair<uint16_t, int>, BlockCost>& cost2) {
+		return cost1.second.nanoseconds > cost2.second.nanoseconds;
+	});
+	uint64_t total = 0;
+	for (auto it = sorted.begin(); it != sorted.end(); ++it)
+		total += it->second.nanoseconds;
+
+	// the sampled costs are scaled up to estimate the costs of all blocks
+	int scale = std::max(1, sampling);
+	out << "# one in " << scale << " blocks sampled, estimated costs of all blocks"
+			<< std::endl;
+	out << std::setw(6) << "id" << std::setw(10) << "time (s)" << std::setw(8) << "share"
+			<< std::setw(14) << "blocks" << std::setw(14) << "blits"
+			<< std::setw(10) << "ns/block" << "  paths" << std::endl;
+	out << std::fixed;
+	for (auto it = sorted.begin(); it != sorted.end(); ++it) {
+		const BlockCost& cost = it->second;
+		std::string paths;
+		for (int i = 0; i < (int) BlockPath::COUNT; i++)
+			if (it->first.second & (1 << i))
+				paths += std::string(paths.empty() ? "" : ", ")
+						+ getBlockPathName((BlockPath) i);
+		out << std::setw(6) << it->first.first
+				<< std::setw(10) << std::setprecision(3)
+				<< cost.nanoseconds * scale / 1e9
+				<< std::setw(7) << std::setprecision(1)
+				<< (total > 0 ? 100.0 * cost.nanoseconds / total : 0) << "%"
+				<< std::setw(14) << cost.samples * scale
+				<< std::setw(14) << cost.blits * scale
+				<< std::setw(10) << std::setprecision(0)
+				<< (double) cost.nanoseconds / cost.samples
+				<< "  " << (paths.empty() ? "-" : paths) << std::endl;
+	}
+}
+
+bool BlockProfiler::shouldSample() {
+#ifdef HAVE_THREAD_LOCAL
+	if (countdown-- > 0)
+		return false;
+	countdown = sampling - 1;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void BlockProfiler::addThreadPath(BlockPath path) {
+#ifdef HAVE_THREAD_LOCAL
+	if (current_sample != nullptr)
+		current_sample->paths |= 1 << (int) path;
+#endif
+}
+
+void BlockSample::begin() {
+#ifdef HAVE_THREAD_LOCAL
+	active = true;
+	current_sample = this;
+	start = std::chrono::steady_clock::now();
+#endif
+}
+
+void BlockSample::end() {
+#ifdef HAVE_THREAD_LOCAL
+	uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	current_sample = nullptr;
+	ThreadBlockCosts& thread = getThreadCosts();
+	thread_ns::unique_lock<thread_ns::mutex> lock(thread.mutex);
+	BlockCost& cost = thread.costs[std::make_pair(id, paths)];
+	cost.samples++;
+	cost.nanoseconds += nanoseconds;
+	cost.blits += blits;
+#endif
+}
+
+}
+}
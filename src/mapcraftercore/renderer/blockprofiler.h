@@ -0,0 +1,171 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCKPROFILER_H_
+#define BLOCKPROFILER_H_
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * The special cases a block can take on its way from the chunk to the tile, a sampled
+ * block is attributed to the combination of the paths it took.
+ */
+enum class BlockPath {
+	// the render mode hides the block
+	HIDDEN,
+	// the data of the block depends on its neighbors (snowy grass, water sides, stairs,
+	// fences, etc.)
+	NEIGHBORS,
+	// the block is a water block replaced with a preblit water block
+	PREBLIT_WATER,
+	// the image of the block is colored with the biome of the block
+	BIOME,
+	// the render mode modifies the image of the block (lighting for example)
+	RENDER_MODE,
+	// the modified image of another block with the same modifications is reused
+	SHARED_IMAGE,
+
+	COUNT
+};
+
+/**
+ * Returns the name of a path in the report.
+ */
+const char* getBlockPathName(BlockPath path);
+
+/**
+ * The sampled blocks of a block id and a combination of paths, the time spent on them
+ * while iterating the blocks of the tiles (hiding, neighbor checks, creating the block
+ * images), and how many of them are blitted onto the tiles.
+ */
+struct BlockCost {
+	BlockCost();
+
+	BlockCost& operator+=(const BlockCost& other);
+
+	uint64_t samples;
+	uint64_t nanoseconds;
+	uint64_t blits;
+};
+
+/**
+ * Attributes the render time and the blits of the rendering to the block ids and the
+ * paths the blocks take (see BlockPath). Only one block in N is measured with a
+ * BlockSample, the others just count down, so the overhead stays small. The samples
+ * are counted per thread and added up when the report is written. The profiler is
+ * disabled by default and the samples do nothing then.
+ */
+class BlockProfiler {
+public:
+	/**
+	 * Sets that every sampling-th block is measured, 0 disables the profiler. This
+	 * should be done before any threads render. Returns false if the profiler is not
+	 * supported (without thread_local).
+	 */
+	static bool setSampling(int sampling);
+	static int getSampling();
+
+	/**
+	 * Adds a path to the block which is sampled by the calling thread at the moment, if
+	 * there is one.
+	 */
+	static void addPath(BlockPath path) {
+		if (sampling)
+			addThreadPath(path);
+	}
+
+	/**
+	 * Returns the costs of all threads so far, by block id and paths (a bit mask of the
+	 * paths, bit i for path i). The costs are the ones of the sampled blocks only.
+	 */
+	static std::map<std::pair<uint16_t, int>, BlockCost> getCosts();
+
+	/**
+	 * Resets the costs of all threads.
+	 */
+	static void reset();
+
+	/**
+	 * Writes the costs as table sorted by the estimated time spent on the blocks, the
+	 * sampled costs are scaled up by the sampling.
+	 */
+	static void writeReport(std::ostream& out);
+
+private:
+	static bool shouldSample();
+	static void addThreadPath(BlockPath path);
+
+	static int sampling;
+
+	friend class BlockSample;
+};
+
+/**
+ * Measures a block if it's the next one to sample, from its construction until its
+ * destruction. The block iteration of the tile renderers creates one for every block
+ * which isn't air.
+ */
+class BlockSample {
+public:
+	explicit BlockSample(uint16_t id)
+		: id(id), paths(0), blits(0), active(false) {
+		if (BlockProfiler::sampling && BlockProfiler::shouldSample())
+			begin();
+	}
+
+	~BlockSample() {
+		if (active)
+			end();
+	}
+
+	BlockSample(const BlockSample&) = delete;
+	BlockSample& operator=(const BlockSample&) = delete;
+
+	/**
+	 * Counts that the block is blitted onto the tile.
+	 */
+	void addBlit() {
+		blits++;
+	}
+
+private:
+	void begin();
+	void end();
+
+	uint16_t id;
+	int paths;
+	int blits;
+	bool active;
+	std::chrono::steady_clock::time_point start;
+
+	friend class BlockProfiler;
+};
+
+}
+}
+
+#endif /* BLOCKPROFILER_H_ */
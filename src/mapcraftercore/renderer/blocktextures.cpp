@@ -1,8 +1,12 @@
 #include "blocktextures.h"
 
 #include "../util.h"
+#include "../compat/thread.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -973,21 +977,37 @@ BlockTextures::~BlockTextures() {
 }
 
 /**
- * Loads all block textures from the 'blocks' directory.
+ * Loads all block textures from the 'blocks' directory with a count of threads.
  */
-bool BlockTextures::load(const std::string& block_dir, int size, int blur, double water_opacity) {
+bool BlockTextures::load(const std::string& block_dir, int size, int blur, double water_opacity,
+		int threads) {
 	if (!fs::exists(block_dir) || !fs::is_directory(block_dir)) {
 		LOG(ERROR) << "Directory '" << block_dir << "' with block textures does not exist.";
 		return false;
 	}
 
-	// go through all textures and load them
-	bool loaded_all = true;
-	for (size_t i = 0; i < textures.size(); i++) {
-		if (!textures[i]->load(block_dir, size, blur, water_opacity)) {
-			LOG(WARNING) << "Unable to load block texture '" << textures[i]->getName() << ".png'.";
-			loaded_all = false;
+	// go through all textures and load them,
+	// the threads take the next texture until all textures are loaded
+	std::atomic<size_t> next_texture(0);
+	std::atomic<bool> loaded_all(true);
+	auto loadTextures = [&]() {
+		size_t i;
+		while ((i = next_texture++) < textures.size()) {
+			if (!textures[i]->load(block_dir, size, blur, water_opacity)) {
+				LOG(WARNING) << "Unable to load block texture '" << textures[i]->getName() << ".png'.";
+				loaded_all = false;
+			}
 		}
+	};
+	threads = std::max(1, std::min(threads, (int) textures.size()));
+	if (threads == 1)
+		loadTextures();
+	else {
+		std::vector<thread_ns::thread> load_threads;
+		for (int i = 0; i < threads; i++)
+			load_threads.push_back(thread_ns::thread(loadTextures));
+		for (auto it = load_threads.begin(); it != load_threads.end(); ++it)
+			it->join();
 	}
 	if (!loaded_all)
 		LOG(WARNING) << "Unable to load some block textures.";
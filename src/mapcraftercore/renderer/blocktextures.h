@@ -17,7 +17,8 @@ public:
 	BlockTextures();
 	~BlockTextures();
 
-	bool load(const std::string& block_dir, int size, int blur, double water_opacity);
+	bool load(const std::string& block_dir, int size, int blur, double water_opacity,
+			int threads = 1);
 
 	TextureImage
 		ANVIL_BASE,
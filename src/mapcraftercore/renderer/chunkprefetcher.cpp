@@ -0,0 +1,332 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chunkprefetcher.h"
+
+#include "../mc/region.h"
+#include "../thread/impl/threadpool.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+/**
+ * Decodes a chunk of a region file and puts it into the chunk cache, and into the cache
+ * with the chunks in the original rotation (may be null) in the original rotation.
+ * Returns false if the chunk could not be decoded.
+ */
+bool decodeChunk(mc::RegionFile& region, const mc::ChunkPos& pos, int rotation,
+		mc::ChunkCache& chunk_cache, mc::ChunkCache* unrotated_chunk_cache,
+		mc::SignCollector* sign_collector, bool unpack) {
+	mc::ChunkPos original_pos = pos;
+	if (rotation)
+		original_pos.rotate(4 - rotation);
+	std::shared_ptr<mc::Chunk> chunk = std::make_shared<mc::Chunk>();
+	if (!unrotated_chunk_cache) {
+		if (region.loadChunk(pos, *chunk) != mc::RegionFile::CHUNK_OK)
+			return false;
+		if (unpack)
+			chunk->unpackSections();
+		if (sign_collector)
+			sign_collector->addChunk(original_pos, region.getChunkTimestamp(pos), *chunk);
+		chunk_cache.put(pos, chunk);
+		return true;
+	}
+	// keep the chunk in the original rotation for the other rotations too
+	std::shared_ptr<mc::Chunk> original = rotation ? std::make_shared<mc::Chunk>() : chunk;
+	if (region.loadChunk(pos, *original, true) != mc::RegionFile::CHUNK_OK)
+		return false;
+	if (unpack)
+		original->unpackSections();
+	if (sign_collector)
+		sign_collector->addChunk(original_pos, region.getChunkTimestamp(pos), *original);
+	unrotated_chunk_cache->put(original_pos, original);
+	if (rotation)
+		chunk->loadRotated(*original, rotation);
+	chunk_cache.put(pos, chunk);
+	return true;
+}
+
+}
+
+ChunkPrefetcher::ChunkPrefetcher(const mc::World& world, TileSet* tile_set,
+		int threads, std::shared_ptr<mc::ChunkCache> chunk_cache,
+		std::shared_ptr<mc::ChunkCache> unrotated_chunk_cache, int lookahead)
+	: world(world), tile_set(tile_set), chunk_cache(chunk_cache),
+	  unrotated_chunk_cache(unrotated_chunk_cache), thread_count(threads),
+	  lookahead(lookahead),
+	  next_tile(0), current_tile(0), stopped(true) {
+}
+
+ChunkPrefetcher::~ChunkPrefetcher() {
+	stop();
+}
+
+void ChunkPrefetcher::setSignCollector(std::shared_ptr<mc::SignCollector> sign_collector) {
+	this->sign_collector = sign_collector;
+}
+
+void ChunkPrefetcher::start(const std::vector<TilePos>& tiles) {
+	stop();
+
+	this->tiles = tiles;
+	next_tile = 0;
+	current_tile = 0;
+	stopped = false;
+	for (int i = 0; i < thread_count; i++)
+		threads.push_back(thread_ns::thread(&ChunkPrefetcher::run, this));
+}
+
+void ChunkPrefetcher::setCurrentTile(size_t index) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	current_tile = index;
+	condition.notify_all();
+}
+
+void ChunkPrefetcher::stop() {
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		stopped = true;
+		condition.notify_all();
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	threads.clear();
+}
+
+void ChunkPrefetcher::run() {
+	util::Profiler::setThreadName("prefetch");
+	// the regions this thread has opened, only the headers of them are read
+	std::map<mc::RegionPos, mc::RegionFile> regions;
+	std::set<mc::RegionPos> regions_missing;
+	int rotation = world.getRotation();
+
+	while (true) {
+		TilePos tile;
+		{
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			// wait until the tile renderer is close enough to the next tile
+			while (!stopped && next_tile < tiles.size()
+					&& next_tile > current_tile + lookahead)
+				condition.wait(lock);
+			if (stopped || next_tile >= tiles.size())
+				return;
+			// the tile renderer might have overtaken us
+			next_tile = std::max(next_tile, current_tile + 1);
+			if (next_tile >= tiles.size())
+				return;
+			tile = tiles[next_tile++];
+		}
+
+		std::set<mc::ChunkPos> chunks;
+		tile_set->mapTileToChunks(tile, chunks);
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			// another rotation of the world might have decoded the chunk already
+			mc::ChunkPos original_pos = *it;
+			if (rotation)
+				original_pos.rotate(4 - rotation);
+			if (chunk_cache && unrotated_chunk_cache && !chunk_cache->get(*it)) {
+				mc::ChunkCache::ChunkPtr original = unrotated_chunk_cache->get(original_pos);
+				if (original) {
+					std::shared_ptr<mc::Chunk> chunk = std::make_shared<mc::Chunk>();
+					chunk->loadRotated(*original, rotation);
+					chunk_cache->put(*it, chunk);
+					continue;
+				}
+			}
+
+			mc::RegionPos region_pos = it->getRegion();
+			if (regions_missing.count(region_pos))
+				continue;
+			auto region_it = regions.find(region_pos);
+			if (region_it == regions.end()) {
+				// keep only a few regions open
+				if (regions.size() >= 16)
+					regions.clear();
+				mc::RegionFile region;
+				if (!world.getRegion(region_pos, region) || !region.readLazily()) {
+					regions_missing.insert(region_pos);
+					continue;
+				}
+				region_it = regions.insert(std::make_pair(region_pos, region)).first;
+			}
+			if (!region_it->second.hasChunk(*it))
+				continue;
+			if (!chunk_cache) {
+				region_it->second.prefetchChunk(*it);
+			} else if (!chunk_cache->get(*it)) {
+				decodeChunk(region_it->second, *it, rotation, *chunk_cache,
+						unrotated_chunk_cache.get(), sign_collector.get(), false);
+			}
+		}
+	}
+}
+
+RegionChunkDecoder::RegionChunkDecoder(const mc::World& world, TileSet* tile_set,
+		int threads, std::shared_ptr<mc::ChunkCache> chunk_cache,
+		std::shared_ptr<mc::ChunkCache> unrotated_chunk_cache)
+	: world(world), tile_set(tile_set), chunk_cache(chunk_cache),
+	  unrotated_chunk_cache(unrotated_chunk_cache), unpack_chunks(false),
+	  thread_pool(new thread::ThreadPool(threads)) {
+}
+
+RegionChunkDecoder::~RegionChunkDecoder() {
+}
+
+void RegionChunkDecoder::setSignCollector(
+		std::shared_ptr<mc::SignCollector> sign_collector) {
+	this->sign_collector = sign_collector;
+}
+
+void RegionChunkDecoder::setUnpackChunks(bool unpack_chunks) {
+	this->unpack_chunks = unpack_chunks;
+}
+
+void RegionChunkDecoder::start(const std::vector<TilePos>& tiles) {
+	// the chunks of the tiles by region, in the order the tiles are rendered
+	std::map<mc::RegionPos, std::vector<mc::ChunkPos> > chunks;
+	std::set<mc::ChunkPos> added;
+	for (auto tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it) {
+		std::set<mc::ChunkPos> tile_chunks;
+		tile_set->mapTileToChunks(*tile_it, tile_chunks);
+		for (auto it = tile_chunks.begin(); it != tile_chunks.end(); ++it)
+			if (added.insert(*it).second)
+				chunks[it->getRegion()].push_back(*it);
+	}
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	region_chunks.swap(chunks);
+}
+
+int RegionChunkDecoder::decodeRegion(const mc::RegionPos& pos) {
+	std::vector<mc::ChunkPos> chunks;
+	{
+		// the chunks of a region are decoded only once, even if the region is evicted
+		// from the world cache and loaded again
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		auto it = region_chunks.find(pos);
+		if (it == region_chunks.end())
+			return 0;
+		chunks.swap(it->second);
+		region_chunks.erase(it);
+	}
+	// the decoded chunks of the first tiles shouldn't be evicted by the ones of the
+	// last tiles before they are used
+	size_t max_chunks = std::max<size_t>(1, chunk_cache->getCapacity() / 2);
+	if (chunks.size() > max_chunks)
+		chunks.resize(max_chunks);
+
+	util::TraceScope trace("decode region");
+	std::atomic<size_t> next(0);
+	std::atomic<int> decoded(0);
+	int rotation = world.getRotation();
+	auto decode = [&]() {
+		mc::RegionFile region;
+		if (!world.getRegion(pos, region) || !region.readLazily())
+			return;
+		size_t i;
+		while ((i = next++) < chunks.size())
+			if (!chunk_cache->get(chunks[i]) && region.hasChunk(chunks[i])
+					&& decodeChunk(region, chunks[i], rotation, *chunk_cache,
+							unrotated_chunk_cache.get(), sign_collector.get(),
+							unpack_chunks))
+				decoded++;
+	};
+
+	// the helper threads and the calling thread decode the chunks together
+	int helpers = std::min<int>(thread_pool->getThreadCount(), chunks.size() - 1);
+	thread_ns::mutex helpers_mutex;
+	thread_ns::condition_variable helpers_finished;
+	int running = helpers;
+	for (int i = 0; i < helpers; i++)
+		thread_pool->run([&]() {
+			decode();
+			thread_ns::unique_lock<thread_ns::mutex> lock(helpers_mutex);
+			if (--running == 0)
+				helpers_finished.notify_all();
+		});
+	decode();
+	thread_ns::unique_lock<thread_ns::mutex> lock(helpers_mutex);
+	while (running > 0)
+		helpers_finished.wait(lock);
+	return decoded;
+}
+
+RegionReadAhead::RegionReadAhead(const mc::World& world, TileSet* tile_set,
+		int regions_ahead)
+	: world(world), tile_set(tile_set), regions_ahead(regions_ahead),
+	  next_region(0), bytes_read_ahead(0) {
+}
+
+void RegionReadAhead::start(const std::vector<TilePos>& tiles) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	regions.clear();
+	region_indices.clear();
+	next_region = 0;
+
+	std::set<mc::ChunkPos> added;
+	for (auto tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it) {
+		std::set<mc::ChunkPos> tile_chunks;
+		tile_set->mapTileToChunks(*tile_it, tile_chunks);
+		for (auto it = tile_chunks.begin(); it != tile_chunks.end(); ++it) {
+			if (!added.insert(*it).second)
+				continue;
+			mc::RegionPos region = it->getRegion();
+			auto index_it = region_indices.find(region);
+			if (index_it == region_indices.end()) {
+				index_it = region_indices.insert(std::make_pair(region, regions.size())).first;
+				regions.push_back(std::make_pair(region, std::vector<mc::ChunkPos>()));
+			}
+			regions[index_it->second].second.push_back(*it);
+		}
+	}
+
+	readAhead(regions_ahead);
+}
+
+void RegionReadAhead::regionLoaded(const mc::RegionPos& pos) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = region_indices.find(pos);
+	if (it != region_indices.end())
+		readAhead(it->second + 1 + regions_ahead);
+}
+
+size_t RegionReadAhead::getBytesReadAhead() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return bytes_read_ahead;
+}
+
+void RegionReadAhead::readAhead(size_t end) {
+	util::TraceScope trace("read ahead regions");
+	for (; next_region < std::min(end, regions.size()); next_region++) {
+		mc::RegionFile region;
+		if (world.getRegion(regions[next_region].first, region) && region.readLazily())
+			bytes_read_ahead += region.readAheadChunks(regions[next_region].second);
+	}
+}
+
+}
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNKPREFETCHER_H_
+#define CHUNKPREFETCHER_H_
+
+#include "tileset.h"
+#include "../compat/thread.h"
+#include "../mc/chunkcache.h"
+#include "../mc/world.h"
+#include "../mc/worldentities.h"
+
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mapcrafter {
+namespace thread {
+class ThreadPool;
+}
+
+namespace renderer {
+
+/**
+ * Reads the chunks of the next render tiles on background threads ahead of the tile
+ * renderer, so the chunk data is already in the page cache of the operating system
+ * when the tile renderer actually needs it. If a shared chunk cache is supplied, the
+ * prefetcher also decodes the chunks and puts them into the cache. Chunks in a cache
+ * shared with the other rotations of the world (see WorldCache) are only rotated.
+ *
+ * The prefetcher gets all render tiles in the order they are rendered and stays at most
+ * a few tiles ahead of the tile renderer, which tells the prefetcher with
+ * setCurrentTile which tile it is rendering.
+ */
+class ChunkPrefetcher {
+public:
+	ChunkPrefetcher(const mc::World& world, TileSet* tile_set, int threads,
+			std::shared_ptr<mc::ChunkCache> chunk_cache = std::shared_ptr<mc::ChunkCache>(),
+			std::shared_ptr<mc::ChunkCache> unrotated_chunk_cache
+				= std::shared_ptr<mc::ChunkCache>(),
+			int lookahead = 4);
+	~ChunkPrefetcher();
+
+	/**
+	 * Sets a collector which gets the signs of the decoded chunks, may be null.
+	 */
+	void setSignCollector(std::shared_ptr<mc::SignCollector> sign_collector);
+
+	/**
+	 * Starts prefetching the chunks of the supplied render tiles (as passed to the tile
+	 * renderer, i.e. with the tile offset added).
+	 */
+	void start(const std::vector<TilePos>& tiles);
+
+	/**
+	 * Sets the index of the render tile the tile renderer is rendering now.
+	 */
+	void setCurrentTile(size_t index);
+
+	/**
+	 * Stops the prefetching threads, the destructor calls this too.
+	 */
+	void stop();
+
+private:
+	mc::World world;
+	TileSet* tile_set;
+	std::shared_ptr<mc::ChunkCache> chunk_cache, unrotated_chunk_cache;
+	std::shared_ptr<mc::SignCollector> sign_collector;
+	int thread_count;
+	size_t lookahead;
+
+	std::vector<TilePos> tiles;
+	// index of the next tile to prefetch and of the currently rendered tile
+	size_t next_tile, current_tile;
+	bool stopped;
+
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable condition;
+	std::vector<thread_ns::thread> threads;
+
+	void run();
+};
+
+/**
+ * Decodes the chunks of a region which the tile renderer needs for its render work at
+ * once when the world cache of the tile renderer loads the region (see
+ * mc::WorldCache::setRegionCallback), and puts them into the shared chunk cache. The
+ * chunks are decoded by helper threads and the calling thread together, so the chunks
+ * of a region are decoded in one burst which uses all threads, instead of one after
+ * another whenever the tile renderer reaches them.
+ */
+class RegionChunkDecoder {
+public:
+	RegionChunkDecoder(const mc::World& world, TileSet* tile_set, int threads,
+			std::shared_ptr<mc::ChunkCache> chunk_cache,
+			std::shared_ptr<mc::ChunkCache> unrotated_chunk_cache
+				= std::shared_ptr<mc::ChunkCache>());
+	~RegionChunkDecoder();
+
+	/**
+	 * Sets a collector which gets the signs of the decoded chunks, may be null.
+	 */
+	void setSignCollector(std::shared_ptr<mc::SignCollector> sign_collector);
+
+	/**
+	 * Sets whether the sections of the decoded chunks are unpacked (see
+	 * Chunk::unpackSections).
+	 */
+	void setUnpackChunks(bool unpack_chunks);
+
+	/**
+	 * Sets the render tiles of the render work (as passed to the tile renderer, i.e.
+	 * with the tile offset added), their chunks are decoded when their regions are
+	 * loaded.
+	 */
+	void start(const std::vector<TilePos>& tiles);
+
+	/**
+	 * Decodes the chunks of the render tiles in a region which weren't decoded yet, at
+	 * most half as many as the chunk cache holds. Returns the count of decoded chunks.
+	 * This is thread-safe.
+	 */
+	int decodeRegion(const mc::RegionPos& pos);
+
+private:
+	mc::World world;
+	TileSet* tile_set;
+	std::shared_ptr<mc::ChunkCache> chunk_cache, unrotated_chunk_cache;
+	std::shared_ptr<mc::SignCollector> sign_collector;
+	bool unpack_chunks;
+
+	// the chunks of the render tiles in the regions which weren't loaded yet
+	std::map<mc::RegionPos, std::vector<mc::ChunkPos> > region_chunks;
+	thread_ns::mutex mutex;
+
+	std::unique_ptr<thread::ThreadPool> thread_pool;
+};
+
+/**
+ * Plans the reads of the region files for the render work of a tile renderer, for
+ * storage where seeks are expensive (hard disks, network filesystems). The regions
+ * needed by the render tiles are ordered by when the tile renderer needs them first.
+ * Whenever the world cache of the tile renderer loads a region (see
+ * mc::WorldCache::setRegionCallback), the chunk data the render work needs from that
+ * region and the next few regions is read ahead in the background, sorted by the
+ * position in the region files (see mc::RegionFile::readAheadChunks). The chunks are
+ * then read in a few sequential passes over the region files instead of one seek per
+ * chunk in the order the tile renderer needs them.
+ */
+class RegionReadAhead {
+public:
+	RegionReadAhead(const mc::World& world, TileSet* tile_set, int regions_ahead);
+
+	/**
+	 * Sets the render tiles of the render work (as passed to the tile renderer, i.e.
+	 * with the tile offset added) and reads ahead the chunks of the first regions.
+	 */
+	void start(const std::vector<TilePos>& tiles);
+
+	/**
+	 * Reads ahead the chunks of a region and the regions after it which weren't read
+	 * ahead yet. This is thread-safe.
+	 */
+	void regionLoaded(const mc::RegionPos& pos);
+
+	/**
+	 * Returns the count of bytes read ahead so far.
+	 */
+	size_t getBytesReadAhead() const;
+
+private:
+	mc::World world;
+	TileSet* tile_set;
+	int regions_ahead;
+
+	// the regions in the order they are needed, with the chunks needed of them,
+	// and the index of each region in that order
+	std::vector<std::pair<mc::RegionPos, std::vector<mc::ChunkPos> > > regions;
+	std::map<mc::RegionPos, size_t> region_indices;
+	// the regions up to this index were read ahead already
+	size_t next_region;
+	size_t bytes_read_ahead;
+	mutable thread_ns::mutex mutex;
+
+	void readAhead(size_t end);
+};
+
+}
+}
+
+#endif /* CHUNKPREFETCHER_H_ */
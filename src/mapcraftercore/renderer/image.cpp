@@ -23,15 +23,26 @@
 
 #include "image.h"
 
+#include "image/blending.h"
+#include "image/coloring.h"
 #include "image/dithering.h"
 #include "image/quantization.h"
 #include "image/scaling.h"
 #include "../util.h"
 
 #include <jpeglib.h>
+#include <zlib.h>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <sstream>
+#ifdef HAVE_LIBWEBP
+#include <webp/decode.h>
+#include <webp/encode.h>
+#endif
 
 namespace mapcrafter {
 namespace renderer {
@@ -94,10 +105,11 @@ RGBAPixel rgba_multiply(RGBAPixel value, uint8_t r, uint8_t g, uint8_t b, uint8_
 }
 
 int rgba_distance2(RGBAPixel value1, RGBAPixel value2) {
-	return std::pow(rgba_red(value1) - rgba_red(value2), 2)
-		+ std::pow(rgba_green(value1) - rgba_green(value2), 2)
-		+ std::pow(rgba_blue(value1) - rgba_blue(value2), 2)
-		+ std::pow(rgba_alpha(value1) - rgba_alpha(value2), 2);
+	int red = rgba_red(value1) - rgba_red(value2);
+	int green = rgba_green(value1) - rgba_green(value2);
+	int blue = rgba_blue(value1) - rgba_blue(value2);
+	int alpha = rgba_alpha(value1) - rgba_alpha(value2);
+	return red * red + green * green + blue * blue + alpha * alpha;
 }
 
 # ifndef UINT64_C
@@ -159,6 +171,54 @@ void blend(RGBAPixel& dest, const RGBAPixel& source) {
 	}
 }
 
+void blendPremultiplied(RGBAPixel& dest, const RGBAPixel& source) {
+	if (source <= 0xffffff)
+		return;
+	else if (source >= 0xff000000) {
+		dest = source;
+		return;
+	}
+
+	// the same formulas as in blend(), but the destination color channels are already
+	// weighted with the destination alpha, so transparent destinations need no special case
+	int64_t sa = rgba_alpha(source) + 1;
+	int64_t sainv = 257 - sa;
+	int64_t d = dest, s = source;
+	d = ((d << 16) & UINT64_C(0xff00000000)) | ((d << 8) & 0xff0000) | (d & 0xff);
+	s = ((s << 16) & UINT64_C(0xff00000000)) | ((s << 8) & 0xff0000) | (s & 0xff);
+	int64_t newrgb = s * sa + d * sainv;
+	int64_t dainv = 256 - rgba_alpha(dest);
+	int64_t newa = 255 - ((sainv * dainv - 1) >> 8);
+	dest = (newa << 24) | ((newrgb >> 24) & 0xff0000) | ((newrgb >> 16) & 0xff00)
+	        | ((newrgb >> 8) & 0xff);
+}
+
+void blendUnderPremultiplied(RGBAPixel& dest, const RGBAPixel& source) {
+	int da = rgba_alpha(dest);
+	if (da == 255 || source <= 0xffffff)
+		return;
+
+	// the weight of the source is the part of it which the destination doesn't cover, the
+	// color channels never get bigger than the alpha channel, so they can't overflow
+	int k = (rgba_alpha(source) * (255 - da) + 127) / 255;
+	int r = rgba_red(dest) + (rgba_red(source) * k + 127) / 255;
+	int g = rgba_green(dest) + (rgba_green(source) * k + 127) / 255;
+	int b = rgba_blue(dest) + (rgba_blue(source) * k + 127) / 255;
+	dest = rgba(r, g, b, da + k);
+}
+
+RGBAPixel rgba_unpremultiply(RGBAPixel value) {
+	int a = rgba_alpha(value);
+	if (a == 255)
+		return value;
+	if (a == 0)
+		return 0;
+	int r = std::min(255, (rgba_red(value) * 255 + a / 2) / a);
+	int g = std::min(255, (rgba_green(value) * 255 + a / 2) / a);
+	int b = std::min(255, (rgba_blue(value) * 255 + a / 2) / a);
+	return rgba(r, g, b, a);
+}
+
 /**
  * http://www.piko3d.com/tutorials/libpng-tutorial-loading-png-files-from-streams
  */
@@ -176,85 +236,184 @@ void pngWriteData(png_structp pngPtr, png_bytep data, png_size_t length) {
 	((std::ostream*) a)->write((char*) data, length);
 }
 
+/**
+ * Sets the compression settings of an image which is written.
+ */
+void pngSetOptions(png_structp png, const PNGOptions& options) {
+	if (options.compression_level != -1)
+		png_set_compression_level(png, options.compression_level);
+	if (options.filters != -1)
+		png_set_filter(png, PNG_FILTER_TYPE_BASE, options.filters);
+	if (options.strategy != -1)
+		png_set_compression_strategy(png, options.strategy);
+}
+
+#ifdef JCS_EXTENSIONS
+/**
+ * Returns the color space of libjpeg-turbo whose memory layout is the one of the pixels
+ * of an image, so libjpeg-turbo can read/write the rows of an image directly.
+ */
+J_COLOR_SPACE jpegPixelColorSpace() {
+	return mapcrafter::util::isBigEndian() ? JCS_EXT_XBGR : JCS_EXT_RGBX;
+}
+#endif
+
+/**
+ * Composites a row of pixels onto a background color for JPEG, which does not support
+ * transparency. Pixels with only a bit transparency are taken as they are.
+ */
+void jpegCompositeRow(RGBAPixel* dest, const RGBAPixel* source, int count,
+		RGBAPixel background) {
+	std::fill(dest, dest + count, background);
+	blendRow(dest, source, count);
+	for (int x = 0; x < count; x++)
+		if (rgba_alpha(source[x]) >= 250)
+			dest[x] = source[x];
+}
+
+PNGOptions::PNGOptions()
+	: compression_level(-1), filters(-1), strategy(-1) {
+}
+
+JPEGOptions::JPEGOptions()
+	: fast_dct(false), h_sampling(-1), v_sampling(-1) {
+}
+
+RGBAImageView::RGBAImageView()
+	: data(nullptr), width(0), height(0), stride(0) {
+}
+
+RGBAImageView::RGBAImageView(const RGBAImage& image)
+	: data(image.getWidth() * image.getHeight() != 0 ? &image.pixel(0, 0) : nullptr),
+	  width(image.getWidth()), height(image.getHeight()), stride(image.getWidth()) {
+}
+
+RGBAImageView::RGBAImageView(const RGBAPixel* data, int width, int height, int stride)
+	: data(data), width(width), height(height), stride(stride) {
+}
+
+int RGBAImageView::getWidth() const {
+	return width;
+}
+
+int RGBAImageView::getHeight() const {
+	return height;
+}
+
+int RGBAImageView::getStride() const {
+	return stride;
+}
+
+RGBAPixel RGBAImageView::getPixel(int x, int y) const {
+	if (x >= width || x < 0 || y >= height || y < 0)
+		return 0;
+	return data[y * stride + x];
+}
+
+const RGBAPixel& RGBAImageView::pixel(int x, int y) const {
+	return data[y * stride + x];
+}
+
+RGBAImageView RGBAImageView::view(int x, int y, int width, int height) const {
+	int x1 = std::max(0, x), y1 = std::max(0, y);
+	int x2 = std::min(this->width, x + width), y2 = std::min(this->height, y + height);
+	if (x2 <= x1 || y2 <= y1)
+		return RGBAImageView();
+	return RGBAImageView(data + y1 * stride + x1, x2 - x1, y2 - y1, stride);
+}
+
 RGBAImage::RGBAImage(int width, int height)
 	: Image<RGBAPixel>(width, height) {
 }
 
+RGBAImage::RGBAImage(const RGBAImageView& view)
+	: Image<RGBAPixel>(view.getWidth(), view.getHeight()) {
+	simpleBlit(view, 0, 0);
+}
+
 RGBAImage::~RGBAImage() {
 }
 
-void RGBAImage::simpleBlit(const RGBAImage& image, int x, int y) {
+RGBAImageView RGBAImage::view() const {
+	return RGBAImageView(*this);
+}
+
+RGBAImageView RGBAImage::view(int x, int y, int width, int height) const {
+	return RGBAImageView(*this).view(x, y, width, height);
+}
+
+void RGBAImage::simpleBlit(const RGBAImageView& image, int x, int y) {
 	if (x >= width || y >= height)
 		return;
 
+	// copy the visible part of the image row by row
 	int sx = std::max(0, -x);
-	int sy;
-	for (; sx < image.width && sx+x < width; sx++) {
-		sy = std::max(0, -y);
-		for (; sy < image.height && sy+y < height; sy++) {
-				data[(sy+y) * width + (sx+x)] = image.data[sy * image.width + sx];
-		}
-	}
+	int count = std::min(image.getWidth(), width - x) - sx;
+	if (count <= 0)
+		return;
+	for (int sy = std::max(0, -y); sy < image.getHeight() && sy+y < height; sy++)
+		std::copy(&image.pixel(sx, sy), &image.pixel(sx, sy) + count,
+				&data[(sy+y) * width + (sx+x)]);
 }
 
-void RGBAImage::simpleAlphaBlit(const RGBAImage& image, int x, int y) {
+void RGBAImage::simpleAlphaBlit(const RGBAImageView& image, int x, int y) {
 	if (x >= width || y >= height)
 		return;
 
-	/*
-	int dx = MAX(x, 0);
-	int sx = MAX(0, -x);
-	for (; sx < image.width && dx < width; sx++, dx++) {
-		int dy = MAX(y, 0);
-		int sy = MAX(0, -y);
-		for (; sy < image.height && dy < height; sy++, dy++) {
-			//blend(data[dy*width+dx], image.data[sy*image.width+sx]);
-
-			if (ALPHA(image.data[sy*image.width+sx]) != 0) {
-				data[dy * width + dx] = image.data[sy * image.width + sx];
-			}
-		}
-	}
-	*/
-
+	// copy the visible part of the image row by row
 	int sx = std::max(0, -x);
-	int sy;
-	for (; sx < image.width && sx+x < width; sx++) {
-		sy = std::max(0, -y);
-		for (; sy < image.height && sy+y < height; sy++) {
-			if (rgba_alpha(image.data[sy*image.width+sx]) != 0) {
-				data[(sy+y) * width + (sx+x)] = image.data[sy * image.width + sx];
-			}
-		}
-	}
+	int count = std::min(image.getWidth(), width - x) - sx;
+	if (count <= 0)
+		return;
+	for (int sy = std::max(0, -y); sy < image.getHeight() && sy+y < height; sy++)
+		alphaCopyRow(&data[(sy+y) * width + (sx+x)], &image.pixel(sx, sy), count);
 }
 
-void RGBAImage::alphaBlit(const RGBAImage& image, int x, int y) {
-	if (x >= width || y >= height)
+void RGBAImage::alphaBlit(const RGBAImageView& image, int x, int y) {
+	// blend the visible part of the image, images completely inside of this image (most
+	// of the blocks of a tile) keep their width and use the specialized kernels
+	int sx = std::max(0, -x), sy = std::max(0, -y);
+	int count = std::min(image.getWidth(), width - x) - sx;
+	int rows = std::min(image.getHeight(), height - y) - sy;
+	if (count <= 0 || rows <= 0)
 		return;
+	blendRect(&data[(sy+y) * width + (sx+x)], width, &image.pixel(sx, sy),
+			image.getStride(), count, rows);
+}
 
-	/*
-	int dx = MAX(x, 0);
-	int sx = MAX(0, -x);
-	for (; sx < image.width && dx < width; sx++, dx++) {
-		int dy = MAX(y, 0);
-		int sy = MAX(0, -y);
-		for (; sy < image.height && dy < height; sy++, dy++) {
-			blend(data[dy * width + dx], image.data[sy * image.width + sx]);
-		}
-	}
-	*/
+void RGBAImage::alphaBlitPremultiplied(const RGBAImageView& image, int x, int y) {
+	int sx = std::max(0, -x), sy = std::max(0, -y);
+	int count = std::min(image.getWidth(), width - x) - sx;
+	int rows = std::min(image.getHeight(), height - y) - sy;
+	if (count <= 0 || rows <= 0)
+		return;
+	blendRectPremultiplied(&data[(sy+y) * width + (sx+x)], width, &image.pixel(sx, sy),
+			image.getStride(), count, rows);
+}
+
+void RGBAImage::alphaBlitUnderPremultiplied(const RGBAImageView& image, int x, int y,
+		std::vector<int>& row_coverage) {
+	if (x >= width || y >= height)
+		return;
 
 	int sx = std::max(0, -x);
-	int sy;
-	for (; sx < image.width && sx+x < width; sx++) {
-		sy = std::max(0, -y);
-		for (; sy < image.height && sy+y < height; sy++) {
-			blend(data[(sy+y) * width + (sx+x)], image.data[sy * image.width + sx]);
-		}
+	int count = std::min(image.getWidth(), width - x) - sx;
+	if (count <= 0)
+		return;
+	for (int sy = std::max(0, -y); sy < image.getHeight() && sy+y < height; sy++) {
+		int& covered = row_coverage[sy+y];
+		if (covered < width)
+			covered += blendRowUnderPremultiplied(&data[(sy+y) * width + (sx+x)],
+					&image.pixel(sx, sy), count);
 	}
 }
 
+void RGBAImage::unpremultiplyAlpha() {
+	for (size_t i = 0; i < data.size(); i++)
+		if (data[i] < 0xff000000)
+			data[i] = rgba_unpremultiply(data[i]);
+}
+
 void RGBAImage::blendPixel(RGBAPixel color, int x, int y) {
 	if (x >= 0 && y >= 0 && x < width && y < height)
 		blend(data[y * width + x], color);
@@ -280,39 +439,35 @@ void RGBAImage::clear() {
 }
 
 RGBAImage RGBAImage::clip(int x, int y, int width, int height) const {
+	// the part of the clipped image inside of this image, the rest stays transparent
 	RGBAImage image(width, height);
-	for (int xx = 0; xx < width && xx + x < this->width; xx++) {
-		for (int yy = 0; yy < height && yy + y < this->height; yy++) {
-			image.setPixel(xx, yy, getPixel(x + xx, y + yy));
-		}
-	}
+	image.simpleBlit(view(x, y, width, height), std::max(0, -x), std::max(0, -y));
 	return image;
 }
 
-RGBAImage RGBAImage::colorize(double r, double g, double b, double a) const {
-	RGBAImage img(width, height);
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			img.setPixel(x, y, rgba_multiply(getPixel(x, y), r, g, b, a));
-		}
-	}
-	return img;
+RGBAImage RGBAImage::colorize(double r, double g, double b, double a) const & {
+	return RGBAImage(*this).colorize(r, g, b, a);
 }
 
-RGBAImage RGBAImage::colorize(uint8_t r, uint8_t g, uint8_t b, uint8_t a) const {
-	RGBAImage img(width, height);
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			img.setPixel(x, y, rgba_multiply(getPixel(x, y), r, g, b, a));
-		}
-	}
-	return img;
+RGBAImage RGBAImage::colorize(double r, double g, double b, double a) && {
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = rgba_multiply(data[i], r, g, b, a);
+	return std::move(*this);
+}
+
+RGBAImage RGBAImage::colorize(uint8_t r, uint8_t g, uint8_t b, uint8_t a) const & {
+	return RGBAImage(*this).colorize(r, g, b, a);
 }
 
-RGBAImage RGBAImage::rotate(int rotation) const {
+RGBAImage RGBAImage::colorize(uint8_t r, uint8_t g, uint8_t b, uint8_t a) && {
+	multiplyRow(data.data(), data.size(), r, g, b, a);
+	return std::move(*this);
+}
+
+RGBAImage RGBAImage::rotate(int rotation) const & {
 	// TODO rotate by rotation % 4?
-	if (rotation == 0)
-		return *this;
+	if (rotation == 0 || rotation == ROTATE_180)
+		return RGBAImage(*this).rotate(rotation);
 	int newWidth = rotation == ROTATE_90 || rotation == ROTATE_270 ? height : width;
 	int newHeight = rotation == ROTATE_90 || rotation == ROTATE_270 ? width : height;
 	RGBAImage copy(newWidth, newHeight);
@@ -321,8 +476,6 @@ RGBAImage RGBAImage::rotate(int rotation) const {
 			RGBAPixel pixel = 0;
 			if (rotation == ROTATE_90)
 				pixel = getPixel(y, width - x - 1);
-			else if (rotation == ROTATE_180)
-				pixel = getPixel(width - x - 1, height - y - 1);
 			else if (rotation == ROTATE_270)
 				pixel = getPixel(height - y - 1, x);
 			copy.setPixel(x, y, pixel);
@@ -331,26 +484,53 @@ RGBAImage RGBAImage::rotate(int rotation) const {
 	return copy;
 }
 
-RGBAImage RGBAImage::flip(bool flipX, bool flipY) const {
-	RGBAImage copy(width, height);
-	for (int x = 0; x < width; x++) {
-		for (int y = 0; y < height; y++) {
-			int xx = flipX ? width - x - 1 : x;
-			int yy = flipY ? height - y - 1 : y;
-			copy.setPixel(x, y, getPixel(xx, yy));
-		}
-	}
-	return copy;
+RGBAImage RGBAImage::rotate(int rotation) && {
+	// rotating by 180 degrees reverses the order of the pixels
+	if (rotation == ROTATE_180)
+		std::reverse(data.begin(), data.end());
+	else if (rotation != 0)
+		return static_cast<const RGBAImage&>(*this).rotate(rotation);
+	return std::move(*this);
+}
+
+RGBAImage RGBAImage::flip(bool flipX, bool flipY) const & {
+	return RGBAImage(*this).flip(flipX, flipY);
 }
 
-RGBAImage RGBAImage::move(int xOffset, int yOffset) const {
+RGBAImage RGBAImage::flip(bool flipX, bool flipY) && {
+	for (int y = 0; y < height && flipX; y++)
+		std::reverse(data.begin() + y * width, data.begin() + (y + 1) * width);
+	for (int y = 0; y < height / 2 && flipY; y++)
+		std::swap_ranges(data.begin() + y * width, data.begin() + (y + 1) * width,
+				data.begin() + (height - y - 1) * width);
+	return std::move(*this);
+}
+
+RGBAImage RGBAImage::move(int xOffset, int yOffset) const & {
 	RGBAImage img(width, height);
-	for (int y = 0; y < height && y + yOffset < height; y++) {
-		for (int x = 0; x < width && x + xOffset < width; x++) {
-			img.setPixel(x + xOffset, y + yOffset, getPixel(x, y));
+	img.simpleBlit(*this, xOffset, yOffset);
+	return img;
+}
+
+RGBAImage RGBAImage::move(int xOffset, int yOffset) && {
+	// the rows are moved in place, in the order in which no row is overwritten before it
+	// is moved itself
+	int sx = std::max(0, -xOffset), dx = std::max(0, xOffset);
+	int count = std::max(0, width - std::abs(xOffset));
+	for (int i = 0; i < height; i++) {
+		int y = yOffset > 0 ? height - i - 1 : i;
+		RGBAPixel* row = &data[y * width];
+		int sy = y - yOffset;
+		if (sy < 0 || sy >= height || count == 0) {
+			std::fill(row, row + width, 0);
+			continue;
 		}
+		// the source row is the same one if the image is moved only horizontally
+		std::memmove(row + dx, &data[sy * width + sx], count * sizeof(RGBAPixel));
+		std::fill(row, row + dx, 0);
+		std::fill(row + dx + count, row + width, 0);
 	}
-	return img;
+	return std::move(*this);
 }
 
 void RGBAImage::resize(RGBAImage& dest, int width, int height, InterpolationType interpolation) const {
@@ -461,7 +641,10 @@ bool RGBAImage::readPNG(const std::string& filename) {
 	if (!file) {
 		return false;
 	}
+	return readPNG(file);
+}
 
+bool RGBAImage::readPNG(std::istream& file) {
 	uint8_t png_signature[8];
 	file.read((char*) &png_signature, 8);
 	if (png_sig_cmp(png_signature, 0, 8) != 0)
@@ -537,7 +720,12 @@ bool RGBAImage::writePNG(const std::string& filename) const {
 	if (!file) {
 		return false;
 	}
+	bool ok = writePNG(file);
+	file.close();
+	return ok && file;
+}
 
+bool RGBAImage::writePNG(std::ostream& file, const PNGOptions& options) const {
 	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (png == NULL)
 		return false;
@@ -556,6 +744,7 @@ bool RGBAImage::writePNG(const std::string& filename) const {
 	png_set_write_fn(png, (png_voidp) &file, pngWriteData, NULL);
 	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
 	        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	pngSetOptions(png, options);
 
 	png_bytep* rows = (png_bytep*) png_malloc(png, height * sizeof(png_bytep));
 	const uint32_t* p = &data[0];
@@ -569,7 +758,6 @@ bool RGBAImage::writePNG(const std::string& filename) const {
 	else
 		png_write_png(png, info, PNG_TRANSFORM_IDENTITY, NULL);
 
-	file.close();
 	png_free(png, rows);
 	png_destroy_write_struct(&png, &info);
 	return true;
@@ -605,7 +793,13 @@ bool RGBAImage::writeIndexedPNG(const std::string& filename, int palette_bits, b
 	if (!file) {
 		return false;
 	}
+	bool ok = writeIndexedPNG(file, palette_bits, dithered);
+	file.close();
+	return ok && file;
+}
 
+bool RGBAImage::writeIndexedPNG(std::ostream& file, int palette_bits, bool dithered,
+		const PNGOptions& options, Palette* shared_palette) const {
 	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (png == NULL)
 		return false;
@@ -625,11 +819,14 @@ bool RGBAImage::writeIndexedPNG(const std::string& filename, int palette_bits, b
 	png_set_write_fn(png, (png_voidp) &file, pngWriteData, NULL);
 	png_set_IHDR(png, info, width, height, palette_bits, PNG_COLOR_TYPE_PALETTE,
 			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	pngSetOptions(png, options);
 
 	//std::cout << "Doing quantization." << std::endl;
-	Octree* octree;
 	std::vector<RGBAPixel> colors;
-	octreeColorQuantize(*this, palette_size, colors, &octree);
+	if (shared_palette != nullptr)
+		colors = shared_palette->getColors();
+	else
+		octreeColorQuantize(*this, palette_size, colors);
 	palette_size = colors.size();
 	//std::cout << "Finished quantization. " << palette_size << " colors." << std::endl;
 
@@ -656,8 +853,11 @@ bool RGBAImage::writeIndexedPNG(const std::string& filename, int palette_bits, b
 	png_set_PLTE(png, info, palette, palette_size);
 	png_set_tRNS(png, info, palette_alpha, palette_size, NULL);
 
-	OctreePalette p(colors);
+	std::unique_ptr<Palette> own_palette;
+	if (shared_palette == nullptr)
+		own_palette.reset(new OctreePalette(colors));
 	//OctreePalette2 p(colors);
+	Palette& p = shared_palette != nullptr ? *shared_palette : *own_palette;
 	
 	std::vector<int> data_dithered;
 	if (dithered) {
@@ -665,16 +865,19 @@ bool RGBAImage::writeIndexedPNG(const std::string& filename, int palette_bits, b
 		imageDither(copy, p, data_dithered);
 	}
 
+	std::vector<int> row_colors(width);
 	png_bytep* rows = (png_bytep*) png_malloc(png, height * sizeof(png_bytep));
 	for (int y = 0; y < height; y++) {
 		rows[y] = (png_byte*) png_malloc(png, width * sizeof(png_byte));
 		for (int x = 0; x < width; x++)
 			rows[y][x] = 0;
+		if (!dithered && width > 0)
+			p.getNearestColors(&data[y * width], width, &row_colors[0]);
 		for (int x = 0; x < width; x++) {
 			if (dithered) {
 				setRowPixel(rows[y], palette_bits, x, data_dithered[y * width + x]);
 			} else {
-				setRowPixel(rows[y], palette_bits, x, p.getNearestColor(pixel(x, y)));
+				setRowPixel(rows[y], palette_bits, x, row_colors[x]);
 			}
 		}
 	}
@@ -686,13 +889,11 @@ bool RGBAImage::writeIndexedPNG(const std::string& filename, int palette_bits, b
 	//else
 		png_write_png(png, info, PNG_TRANSFORM_IDENTITY, NULL);
 
-	file.close();
 	for (int y = 0; y < height; y++)
 		png_free(png, rows[y]);
 	png_free(png, rows);
 	png_free(png, palette);
 	png_free(png, palette_alpha);
-	delete octree;
 	png_destroy_write_struct(&png, &info);
 	return true;
 }
@@ -746,7 +947,14 @@ my_error_exit (j_common_ptr cinfo)
   longjmp(myerr->setjmp_buffer, 1);
 }
 
-bool RGBAImage::readJPEG(const std::string& filename) {
+bool RGBAImage::readJPEG(const std::string& filename, bool fast) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	return readJPEG(file, fast);
+}
+
+bool RGBAImage::readJPEG(std::istream& in, bool fast) {
 	/* This struct contains the JPEG decompression parameters and pointers to
 	 * working space (which is allocated as needed by the JPEG library).
 	 */
@@ -757,21 +965,11 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 	 */
 	struct my_error_mgr jerr;
 	/* More stuff */
-	FILE * infile;		/* source file */
-	JSAMPARRAY buffer;		/* Output row buffer */
-	int row_stride;		/* physical row width in output buffer */
-
-	/* In this example we want to open the input file before doing anything else,
-	 * so that the setjmp() error recovery below can assume the file is open.
-	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	 * requires it in order to read binary files.
-	 */
-
-	if ((infile = fopen(filename.c_str(), "rb")) == NULL) {
-		//fprintf(stderr, "can't open %s\n", filename.c_str());
-		//return 0;
-		return false;
-	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	std::string encoded = buffer.str();
+	// allocated before setjmp(), its destructor isn't skipped if libjpeg jumps back
+	std::vector<JSAMPROW> rows;
 
 	/* Step 1: allocate and initialize JPEG decompression object */
 
@@ -781,18 +979,17 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 	/* Establish the setjmp return context for my_error_exit to use. */
 	if (setjmp(jerr.setjmp_buffer)) {
 		/* If we get here, the JPEG code has signaled an error.
-		 * We need to clean up the JPEG object, close the input file, and return.
+		 * We need to clean up the JPEG object and return.
 		 */
 		jpeg_destroy_decompress(&cinfo);
-		fclose(infile);
-		return 0;
+		return false;
 	}
 	/* Now we can initialize the JPEG decompression object. */
 	jpeg_create_decompress(&cinfo);
 
 	/* Step 2: specify data source (eg, a file) */
 
-	jpeg_stdio_src(&cinfo, infile);
+	jpeg_mem_src(&cinfo, (unsigned char*) encoded.data(), encoded.size());
 
 	/* Step 3: read file parameters with jpeg_read_header() */
 
@@ -805,9 +1002,16 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 
 	/* Step 4: set parameters for decompression */
 
-	/* In this example, we don't need to change any of the defaults set by
-	 * jpeg_read_header(), so we do nothing here.
-	 */
+#ifdef JCS_EXTENSIONS
+	// let libjpeg-turbo decode directly into the rows of the image
+	cinfo.out_color_space = jpegPixelColorSpace();
+#else
+	cinfo.out_color_space = JCS_RGB;
+#endif
+	if (fast) {
+		cinfo.dct_method = JDCT_IFAST;
+		cinfo.do_fancy_upsampling = FALSE;
+	}
 
 	/* Step 5: Start decompressor */
 
@@ -816,34 +1020,28 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 	 * with the stdio data source.
 	 */
 
-	/* We may need to do some setup of our own at this point before reading
-	 * the data.	After jpeg_start_decompress() we have the correct scaled
-	 * output image dimensions available, as well as the output colormap
-	 * if we asked for color quantization.
-	 * In this example, we need to make an output work buffer of the right size.
-	 */
-	/* JSAMPLEs per row in output buffer */
-	row_stride = cinfo.output_width * cinfo.output_components;
-	/* Make a one-row-high sample array that will go away when done with image */
-	buffer = (*cinfo.mem->alloc_sarray)
-		((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
+	setSize(cinfo.output_width, cinfo.output_height);
 
 	/* Step 6: while (scan lines remain to be read) */
 	/*					 jpeg_read_scanlines(...); */
 
-	setSize(cinfo.output_width, cinfo.output_height);
-
 	/* Here we use the library's state variable cinfo.output_scanline as the
 	 * loop counter, so that we don't have to keep track ourselves.
 	 */
+#ifdef JCS_EXTENSIONS
+	rows.resize(height);
+	for (int y = 0; y < height; y++)
+		rows[y] = (JSAMPROW) &data[y * width];
+	while (cinfo.output_scanline < cinfo.output_height)
+		(void) jpeg_read_scanlines(&cinfo, &rows[cinfo.output_scanline],
+				cinfo.output_height - cinfo.output_scanline);
+#else
+	/* Make a one-row-high sample array that will go away when done with image */
+	JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)
+		((j_common_ptr) &cinfo, JPOOL_IMAGE, cinfo.output_width * 3, 1);
 	while (cinfo.output_scanline < cinfo.output_height) {
-		/* jpeg_read_scanlines expects an array of pointers to scanlines.
-		 * Here the array is only one element long, but you could ask for
-		 * more than one scanline at a time if that's more convenient.
-		 */
 		(void) jpeg_read_scanlines(&cinfo, buffer, 1);
-		/* Assume put_scanline_someplace wants a pointer and sample count. */
-		for(int x = 0; x < width; x++) {
+		for (int x = 0; x < width; x++) {
 			uint8_t red = buffer[0][3 * x];
 			uint8_t green = buffer[0][3 * x + 1];
 			uint8_t blue = buffer[0][3 * x + 2];
@@ -852,6 +1050,7 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 			pixel(x, cinfo.output_scanline - 1) = rgba(red, green, blue, 255);
 		}
 	}
+#endif
 
 	/* Step 7: Finish decompression */
 
@@ -865,13 +1064,6 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 	/* This is an important step since it will release a good deal of memory. */
 	jpeg_destroy_decompress(&cinfo);
 
-	/* After finish_decompress, we can close the input file.
-	 * Here we postpone it until after no more JPEG errors are possible,
-	 * so as to simplify the setjmp error logic above.	(Actually, I don't
-	 * think that jpeg_destroy can do an error exit, but why assume anything...)
-	 */
-	fclose(infile);
-
 	/* At this point you may want to check to see whether any corrupt-data
 	 * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
 	 */
@@ -882,7 +1074,17 @@ bool RGBAImage::readJPEG(const std::string& filename) {
 }
 
 bool RGBAImage::writeJPEG(const std::string& filename, int quality,
-		RGBAPixel background) const {
+		RGBAPixel background, const JPEGOptions& options) const {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	bool ok = writeJPEG(file, quality, background, options);
+	file.close();
+	return ok && file;
+}
+
+bool RGBAImage::writeJPEG(std::ostream& out, int quality,
+		RGBAPixel background, const JPEGOptions& options) const {
 
 	/* This struct contains the JPEG compression parameters and pointers to
 	 * working space (which is allocated as needed by the JPEG library).
@@ -901,7 +1103,8 @@ bool RGBAImage::writeJPEG(const std::string& filename, int quality,
 	 */
 	struct jpeg_error_mgr jerr;
 	/* More stuff */
-	FILE * outfile;		/* target file */
+	unsigned char* encoded = NULL;	/* target memory buffer, allocated by libjpeg */
+	unsigned long encoded_size = 0;
 
 	/* Step 1: allocate and initialize JPEG compression object */
 
@@ -918,16 +1121,9 @@ bool RGBAImage::writeJPEG(const std::string& filename, int quality,
 	/* Note: steps 2 and 3 can be done in either order. */
 
 	/* Here we use the library-supplied code to send compressed data to a
-	 * stdio stream.	You can also write your own code to do something else.
-	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	 * requires it in order to write binary files.
+	 * memory buffer, which is written to the output stream at once.
 	 */
-	if ((outfile = fopen(filename.c_str(), "wb")) == NULL) {
-		//fprintf(stderr, "can't open %s\n", filename.c_str());
-		//exit(1);
-		return false;
-	}
-	jpeg_stdio_dest(&cinfo, outfile);
+	jpeg_mem_dest(&cinfo, &encoded, &encoded_size);
 
 	/* Step 3: set parameters for compression */
 
@@ -936,8 +1132,14 @@ bool RGBAImage::writeJPEG(const std::string& filename, int quality,
 	 */
 	cinfo.image_width = width; 	/* image width and height, in pixels */
 	cinfo.image_height = height;
+#ifdef JCS_EXTENSIONS
+	// libjpeg-turbo takes the composited rows directly and ignores the alpha channel
+	cinfo.input_components = 4;		/* # of color components per pixel */
+	cinfo.in_color_space = jpegPixelColorSpace(); 	/* colorspace of input image */
+#else
 	cinfo.input_components = 3;		/* # of color components per pixel */
 	cinfo.in_color_space = JCS_RGB; 	/* colorspace of input image */
+#endif
 	/* Now use the library's routine to set default compression parameters.
 	 * (You must set at least cinfo.in_color_space before calling this,
 	 * since the defaults depend on the source color space.)
@@ -947,6 +1149,13 @@ bool RGBAImage::writeJPEG(const std::string& filename, int quality,
 	 * Here we just illustrate the use of quality (quantization table) scaling:
 	 */
 	jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+	if (options.fast_dct)
+		cinfo.dct_method = JDCT_IFAST;
+	if (options.h_sampling != -1 && options.v_sampling != -1) {
+		// the chroma components keep a sampling of 1x1, relative to the one of luma
+		cinfo.comp_info[0].h_samp_factor = options.h_sampling;
+		cinfo.comp_info[0].v_samp_factor = options.v_sampling;
+	}
 
 	/* Step 4: Start compressor */
 
@@ -963,45 +1172,130 @@ bool RGBAImage::writeJPEG(const std::string& filename, int quality,
 	 * To keep things simple, we pass one scanline per call; you can pass
 	 * more if you wish, though.
 	 */
+	// the rows are composited onto the background color into a buffer which is reused
+	std::vector<RGBAPixel> row(width);
+#ifdef JCS_EXTENSIONS
+	JSAMPROW scanline = (JSAMPROW) &row[0];
+#else
 	std::vector<JSAMPLE> line_buffer(width * 3, 0);
-	JSAMPLE* scanlineData = &line_buffer[0];
+	JSAMPROW scanline = &line_buffer[0];
+#endif
 
 	while (cinfo.next_scanline < cinfo.image_height) {
 		/* jpeg_write_scanlines expects an array of pointers to scanlines.
 		 * Here the array is only one element long, but you could pass
 		 * more than one scanline at a time if that's more convenient.
 		 */
+		jpegCompositeRow(&row[0], &data[cinfo.next_scanline * width], width, background);
+#ifndef JCS_EXTENSIONS
 		for (int x = 0; x < width; x++) {
-			RGBAPixel color = pixel(x, cinfo.next_scanline);
-			// jpeg does not support transparency
-			// add background color if this pixel has transparency
-			// but ignore a bit transparency
-			if (rgba_alpha(color) < 250) {
-				color = background;
-				blend(color, pixel(x, cinfo.next_scanline));
-			}
-
-			line_buffer[3 * x] = rgba_red(color);
-			line_buffer[3 * x + 1] = rgba_green(color);
-			line_buffer[3 * x + 2] = rgba_blue(color);
+			line_buffer[3 * x] = rgba_red(row[x]);
+			line_buffer[3 * x + 1] = rgba_green(row[x]);
+			line_buffer[3 * x + 2] = rgba_blue(row[x]);
 		}
-		(void) jpeg_write_scanlines(&cinfo, &scanlineData, 1);
+#endif
+		(void) jpeg_write_scanlines(&cinfo, &scanline, 1);
 	}
 
 	/* Step 6: Finish compression */
 
 	jpeg_finish_compress(&cinfo);
-	/* After finish_compress, we can close the output file. */
-	fclose(outfile);
 
 	/* Step 7: release JPEG compression object */
 
 	/* This is an important step since it will release a good deal of memory. */
 	jpeg_destroy_compress(&cinfo);
 
+	/* After destroying the compression object, the memory buffer stays valid. */
+	out.write((const char*) encoded, encoded_size);
+	free(encoded);
+	if (!out)
+		return false;
+
 	/* And we're done! */
 	return true;
 }
 
+bool RGBAImage::readWebP(const std::string& filename) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	return readWebP(file);
+}
+
+bool RGBAImage::readWebP(std::istream& file) {
+#ifdef HAVE_LIBWEBP
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string encoded = buffer.str();
+
+	int webp_width, webp_height;
+	const uint8_t* encoded_data = (const uint8_t*) encoded.data();
+	if (!WebPGetInfo(encoded_data, encoded.size(), &webp_width, &webp_height))
+		return false;
+	setSize(webp_width, webp_height);
+	if (WebPDecodeRGBAInto(encoded_data, encoded.size(), (uint8_t*) &data[0],
+			data.size() * sizeof(RGBAPixel), width * sizeof(RGBAPixel)) == NULL)
+		return false;
+
+	// libwebp decodes the bytes of the pixels in RGBA order
+	if (mapcrafter::util::isBigEndian()) {
+		for (size_t i = 0; i < data.size(); i++) {
+			uint32_t p = data[i];
+			data[i] = rgba(p >> 24, (p >> 16) & 0xff, (p >> 8) & 0xff, p & 0xff);
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool RGBAImage::writeWebP(const std::string& filename, bool lossless, int quality) const {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	bool ok = writeWebP(file, lossless, quality);
+	file.close();
+	return ok && file;
+}
+
+bool RGBAImage::writeWebP(std::ostream& out, bool lossless, int quality) const {
+#ifdef HAVE_LIBWEBP
+	if (width == 0 || height == 0)
+		return false;
+
+	// libwebp expects the bytes of the pixels in RGBA order
+	const uint8_t* pixels = (const uint8_t*) &data[0];
+	std::vector<RGBAPixel> converted;
+	if (mapcrafter::util::isBigEndian()) {
+		converted.resize(data.size());
+		for (size_t i = 0; i < data.size(); i++) {
+			RGBAPixel p = data[i];
+			converted[i] = (rgba_red(p) << 24) | (rgba_green(p) << 16)
+					| (rgba_blue(p) << 8) | rgba_alpha(p);
+		}
+		pixels = (const uint8_t*) &converted[0];
+	}
+
+	uint8_t* encoded = NULL;
+	size_t size;
+	int stride = width * sizeof(RGBAPixel);
+	if (lossless)
+		size = WebPEncodeLosslessRGBA(pixels, width, height, stride, &encoded);
+	else
+		size = WebPEncodeRGBA(pixels, width, height, stride, quality, &encoded);
+	if (size == 0) {
+		WebPFree(encoded);
+		return false;
+	}
+	out.write((const char*) encoded, size);
+	WebPFree(encoded);
+	return (bool) out;
+#else
+	return false;
+#endif
+}
+
 }
 }
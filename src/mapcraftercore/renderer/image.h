@@ -24,10 +24,14 @@
 #include <cmath>
 #include <math.h> // to be sure M_PI is defined
 
+#include "../util/memory.h"
+
 #include <png.h>
 #include <cstdint>
+#include <iosfwd>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 namespace mapcrafter {
@@ -35,6 +39,8 @@ namespace renderer {
 
 typedef uint32_t RGBAPixel;
 
+class Palette;
+
 RGBAPixel rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
 uint8_t rgba_red(RGBAPixel value);
 uint8_t rgba_green(RGBAPixel value);
@@ -50,15 +56,49 @@ int rgba_distance2(RGBAPixel value1, RGBAPixel value2);
 
 void blend(RGBAPixel& dest, const RGBAPixel& source);
 
+/**
+ * Alpha-blends a (straight alpha) source pixel onto a destination pixel with premultiplied
+ * alpha, which needs just one multiply-add per channel.
+ */
+void blendPremultiplied(RGBAPixel& dest, const RGBAPixel& source);
+
+/**
+ * Alpha-blends a (straight alpha) source pixel under a destination pixel with premultiplied
+ * alpha, the destination pixel is in front of the source pixel. Drawing images from front
+ * to back with this results in (up to rounding) the same pixels as drawing them from back
+ * to front with blendPremultiplied(), but opaque destination pixels need no work.
+ */
+void blendUnderPremultiplied(RGBAPixel& dest, const RGBAPixel& source);
+
+/**
+ * Converts a pixel with premultiplied alpha back to straight alpha.
+ */
+RGBAPixel rgba_unpremultiply(RGBAPixel value);
+
 void pngReadData(png_structp pngPtr, png_bytep data, png_size_t length);
 void pngWriteData(png_structp pngPtr, png_bytep data, png_size_t length);
 
+/**
+ * The alignment of the pixel buffers of images, this is a cache line and enough for
+ * aligned SIMD loads/stores of any width. The pixel buffers come from the huge page
+ * arena if it's enabled (see util::HugePageArena), its buffers have this alignment.
+ */
+const size_t IMAGE_ALIGNMENT = util::HugePageArena::ALIGNMENT;
+
 template <typename Pixel>
 class Image {
 public:
 	Image(int width = 0, int height = 0);
+	Image(const Image& other) = default;
+	/**
+	 * Takes the pixel buffer of the other image, which is empty afterwards.
+	 */
+	Image(Image&& other);
 	~Image();
 
+	Image& operator=(const Image& other) = default;
+	Image& operator=(Image&& other);
+
 	int getWidth() const;
 	int getHeight() const;
 
@@ -68,13 +108,19 @@ public:
 	const Pixel& pixel(int x, int y) const;
 	Pixel& pixel(int x, int y);
 
+	/**
+	 * Changes the size of the image. The pixel buffer keeps its capacity, so an image
+	 * which is reused for images of the same or a smaller size doesn't allocate memory.
+	 * Pixels added by growing the image are transparent, the old pixels are left as they
+	 * are (and aren't moved to their old positions).
+	 */
 	void setSize(int width, int height);
 
 protected:
 	int width;
 	int height;
 
-	std::vector<Pixel> data;
+	std::vector<Pixel, util::ArenaAllocator<Pixel> > data;
 };
 
 const int ROTATE_0 = 0;
@@ -93,39 +139,150 @@ enum class InterpolationType {
 	AUTO
 };
 
+/**
+ * Settings how the image data of PNGs is compressed, the ones which are -1 are left to
+ * libpng. Lower compression levels and fewer row filters encode faster, but make larger
+ * files.
+ */
+struct PNGOptions {
+	PNGOptions();
+
+	// the zlib compression level from 0 to 9
+	int compression_level;
+	// the PNG_FILTER_* flags of libpng of the row filters to choose from
+	int filters;
+	// the Z_* strategy of zlib
+	int strategy;
+};
+
+struct JPEGOptions {
+	JPEGOptions();
+
+	// whether to use the faster, but less accurate integer DCT of libjpeg
+	bool fast_dct;
+	// the horizontal/vertical sampling factors of the luma component, 2x2 is 4:2:0
+	// chroma subsampling, 2x1 is 4:2:2 and 1x1 is 4:4:4 (no chroma subsampling)
+	int h_sampling, v_sampling;
+};
+
+class RGBAImage;
+
+/**
+ * A view of the pixels of an image, or a part of them, without copying them. The rows
+ * of the view are stride pixels apart, that's the width of the viewed image. The view
+ * is valid as long as the image is not resized or destroyed.
+ *
+ * The blit and resize methods take views, so parts of an image can be blitted without
+ * clipping them into a new image first. Images convert to views of themselves.
+ */
+class RGBAImageView {
+public:
+	RGBAImageView();
+	RGBAImageView(const RGBAImage& image);
+	RGBAImageView(const RGBAPixel* data, int width, int height, int stride);
+
+	int getWidth() const;
+	int getHeight() const;
+	int getStride() const;
+
+	/**
+	 * Returns a pixel, or a transparent one if it's outside of the view.
+	 */
+	RGBAPixel getPixel(int x, int y) const;
+	const RGBAPixel& pixel(int x, int y) const;
+
+	/**
+	 * Returns the view of a part of this view. The part is cut to the pixels inside of
+	 * this view.
+	 */
+	RGBAImageView view(int x, int y, int width, int height) const;
+
+private:
+	const RGBAPixel* data;
+	int width, height, stride;
+};
+
 // TODO better documentation...
 class RGBAImage : public Image<RGBAPixel> {
 public:
 	RGBAImage(int width = 0, int height = 0);
+	/**
+	 * Copies the pixels of a view into a new image.
+	 */
+	explicit RGBAImage(const RGBAImageView& view);
+	RGBAImage(const RGBAImage& other) = default;
+	RGBAImage(RGBAImage&& other) = default;
 	~RGBAImage();
 
+	RGBAImage& operator=(const RGBAImage& other) = default;
+	RGBAImage& operator=(RGBAImage&& other) = default;
+
+	/**
+	 * Returns a view of this image, or of a part of it. The part is cut to the pixels
+	 * inside of the image, other than with clip().
+	 */
+	RGBAImageView view() const;
+	RGBAImageView view(int x, int y, int width, int height) const;
+
 	/**
 	 * Blits one image to another one. Just copies the pixels over without any processing.
 	 */
-	void simpleBlit(const RGBAImage& image, int x, int y);
+	void simpleBlit(const RGBAImageView& image, int x, int y);
 
 	/**
 	 * Blits one image to another one. Just copies the pixels over, but skips completely
 	 * transparent pixels (alpha(pixel) == 0).
 	 */
-	void simpleAlphaBlit(const RGBAImage& image, int x, int y);
+	void simpleAlphaBlit(const RGBAImageView& image, int x, int y);
 
 	/**
 	 * Blits one image to another one. Also Alphablends transparent pixels of the source
 	 * image with the pixels of the destination image.
 	 */
-	void alphaBlit(const RGBAImage& image, int x, int y);
+	void alphaBlit(const RGBAImageView& image, int x, int y);
+
+	/**
+	 * Like alphaBlit, but the pixels of this image have premultiplied alpha. Use
+	 * unpremultiplyAlpha() to convert the image back to straight alpha afterwards.
+	 */
+	void alphaBlitPremultiplied(const RGBAImageView& image, int x, int y);
+
+	/**
+	 * Like alphaBlitPremultiplied, but blends the image under this image (see
+	 * blendUnderPremultiplied()), so images are drawn from front to back. The opaque pixel
+	 * counts of the rows of this image (height values, zero for a transparent image) are
+	 * updated, the completely opaque rows are skipped.
+	 */
+	void alphaBlitUnderPremultiplied(const RGBAImageView& image, int x, int y,
+			std::vector<int>& row_coverage);
+	void unpremultiplyAlpha();
+
 	void blendPixel(RGBAPixel color, int x, int y);
 
 	void fill(RGBAPixel color, int x1, int y1, int w, int h);
 	void clear();
 
+	/**
+	 * Returns a part of the image as new image, the pixels outside of this image are
+	 * transparent. Use view() to blit a part of the image without copying it.
+	 */
 	RGBAImage clip(int x, int y, int width, int height) const;
-	RGBAImage colorize(double r, double g, double b, double a = 1) const;
-	RGBAImage colorize(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) const;
-	RGBAImage rotate(int rotation) const;
-	RGBAImage flip(bool flip_x, bool flip_y) const;
-	RGBAImage move(int x_off, int y_off) const;
+
+	/**
+	 * These return transformed copies of the image. Called on a temporary image (like
+	 * image.clip(...).colorize(...)), they transform the temporary image in place and
+	 * return it, if possible.
+	 */
+	RGBAImage colorize(double r, double g, double b, double a = 1) const &;
+	RGBAImage colorize(double r, double g, double b, double a = 1) &&;
+	RGBAImage colorize(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) const &;
+	RGBAImage colorize(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) &&;
+	RGBAImage rotate(int rotation) const &;
+	RGBAImage rotate(int rotation) &&;
+	RGBAImage flip(bool flip_x, bool flip_y) const &;
+	RGBAImage flip(bool flip_x, bool flip_y) &&;
+	RGBAImage move(int x_off, int y_off) const &;
+	RGBAImage move(int x_off, int y_off) &&;
 	
 	void resize(RGBAImage& dest, int width, int height,
 			InterpolationType interpolation = InterpolationType::AUTO) const;
@@ -156,12 +313,45 @@ public:
 	void blur(RGBAImage& dest, int radius) const;
 
 	bool readPNG(const std::string& filename);
+	bool readPNG(std::istream& in);
 	bool writePNG(const std::string& filename) const;
 	bool writeIndexedPNG(const std::string& filename, int palette_bits = 8, bool dithered = true) const;
 
-	bool readJPEG(const std::string& filename);
+	/**
+	 * Encodes the image as (indexed) PNG into a stream, for example into a memory
+	 * buffer which is written to a file at once later. Indexed PNGs can use the colors
+	 * of a palette shared by many images instead of quantizing the colors of the image,
+	 * the palette bits must be enough for its colors then.
+	 */
+	bool writePNG(std::ostream& out, const PNGOptions& options = PNGOptions()) const;
+	bool writeIndexedPNG(std::ostream& out, int palette_bits = 8, bool dithered = true,
+			const PNGOptions& options = PNGOptions(), Palette* palette = nullptr) const;
+
+	/**
+	 * Reads/writes JPEG images. Transparent pixels are composited onto the background
+	 * color when writing. If the fast flag is set when reading, the image is decoded
+	 * with the faster, but less accurate integer DCT and without smooth upsampling of
+	 * the chroma components, which is good enough for images which are scaled down
+	 * anyways (like the tiles of composite tiles).
+	 */
+	bool readJPEG(const std::string& filename, bool fast = false);
+	bool readJPEG(std::istream& in, bool fast = false);
 	bool writeJPEG(const std::string& filename, int quality,
-			RGBAPixel background = rgba(255, 255, 255, 255)) const;
+			RGBAPixel background = rgba(255, 255, 255, 255),
+			const JPEGOptions& options = JPEGOptions()) const;
+	bool writeJPEG(std::ostream& out, int quality,
+			RGBAPixel background = rgba(255, 255, 255, 255),
+			const JPEGOptions& options = JPEGOptions()) const;
+
+	/**
+	 * Reads/writes WebP images, lossless or lossy with a quality from 0 to 100. WebP
+	 * images have an alpha channel in both modes. These methods return false if
+	 * Mapcrafter was built without libwebp.
+	 */
+	bool readWebP(const std::string& filename);
+	bool readWebP(std::istream& in);
+	bool writeWebP(const std::string& filename, bool lossless, int quality = 75) const;
+	bool writeWebP(std::ostream& out, bool lossless, int quality = 75) const;
 };
 
 template <typename Pixel>
@@ -170,10 +360,29 @@ Image<Pixel>::Image(int width, int height)
 	data.resize(width * height);
 }
 
+template <typename Pixel>
+Image<Pixel>::Image(Image&& other)
+	: width(other.width), height(other.height), data(std::move(other.data)) {
+	other.width = other.height = 0;
+	other.data.clear();
+}
+
 template <typename Pixel>
 Image<Pixel>::~Image() {
 }
 
+template <typename Pixel>
+Image<Pixel>& Image<Pixel>::operator=(Image&& other) {
+	if (this != &other) {
+		width = other.width;
+		height = other.height;
+		data = std::move(other.data);
+		other.width = other.height = 0;
+		other.data.clear();
+	}
+	return *this;
+}
+
 template <typename Pixel>
 int Image<Pixel>::getWidth() const {
 	return width;
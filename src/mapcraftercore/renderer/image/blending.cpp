@@ -0,0 +1,454 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blending.h"
+
+#ifdef __SSE2__
+#define HAVE_BLENDING_SSE2
+#include <emmintrin.h>
+#endif
+
+// the AVX2 kernels are compiled with the target attribute and only used if the CPU
+// supports AVX2 (detected at runtime)
+#if defined(HAVE_BLENDING_SSE2) && defined(__GNUC__) \
+	&& (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_BLENDING_AVX2
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+/*
+ * With sa = source alpha + 1, sainv = 257 - sa and dainv = 256 - destination alpha,
+ * blend() computes each color channel as (s * sa + d * sainv) >> 8 and the alpha channel
+ * as 255 - ((sainv * dainv - 1) >> 8) for translucent source pixels. The same formulas
+ * result in the source pixel for opaque and in the destination pixel for transparent
+ * source pixels, and all products fit in 16 bits, so the vectorized kernels use them
+ * for all pixels. Only transparent destination pixels need an extra case, they are
+ * replaced by the source pixels. With premultiplied destination pixels (like in
+ * blendPremultiplied()) there is no extra case at all.
+ */
+
+template <bool premultiplied>
+void blendRowScalar(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	for (int i = 0; i < count; i++) {
+		if (premultiplied)
+			blendPremultiplied(dest[i], source[i]);
+		else
+			blend(dest[i], source[i]);
+	}
+}
+
+template <bool premultiplied>
+void blendRectScalar(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height) {
+	for (int y = 0; y < height; y++, dest += dest_stride, source += source_stride)
+		blendRowScalar<premultiplied>(dest, source, width);
+}
+
+void alphaCopyRowScalar(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	for (int i = 0; i < count; i++)
+		if (rgba_alpha(source[i]) != 0)
+			dest[i] = source[i];
+}
+
+#ifdef HAVE_BLENDING_SSE2
+
+/**
+ * Blends two pixels with 16 bits per channel.
+ */
+inline __m128i blendUnpackedSSE2(__m128i s, __m128i d) {
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i c256 = _mm_set1_epi16(256);
+	const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+	// the alpha values of the pixels in all channels
+	__m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)),
+			_MM_SHUFFLE(3, 3, 3, 3));
+	__m128i da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d, _MM_SHUFFLE(3, 3, 3, 3)),
+			_MM_SHUFFLE(3, 3, 3, 3));
+	__m128i sainv = _mm_sub_epi16(c256, sa);
+	sa = _mm_add_epi16(sa, one);
+
+	__m128i rgb = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, sa),
+			_mm_mullo_epi16(d, sainv)), 8);
+	__m128i dainv = _mm_sub_epi16(c256, da);
+	__m128i a = _mm_sub_epi16(c255, _mm_srli_epi16(
+			_mm_sub_epi16(_mm_mullo_epi16(sainv, dainv), one), 8));
+	return _mm_or_si128(_mm_and_si128(alpha_lanes, a), _mm_andnot_si128(alpha_lanes, rgb));
+}
+
+template <bool premultiplied>
+inline void blendRowSSE2(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		__m128i sa = _mm_and_si128(s, alpha_mask);
+		__m128i s_transparent = _mm_cmpeq_epi32(sa, zero);
+		// nothing to do for transparent source pixels, just copy opaque ones
+		if (_mm_movemask_epi8(s_transparent) == 0xffff)
+			continue;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, alpha_mask)) == 0xffff) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), s);
+			continue;
+		}
+
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+		__m128i blended = _mm_packus_epi16(
+				blendUnpackedSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero)),
+				blendUnpackedSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero)));
+		if (premultiplied) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), blended);
+			continue;
+		}
+		// transparent destination pixels are replaced by the source pixels
+		__m128i d_transparent = _mm_cmpeq_epi32(_mm_and_si128(d, alpha_mask), zero);
+		__m128i copy = _mm_andnot_si128(s_transparent, d_transparent);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+				_mm_or_si128(_mm_and_si128(copy, s), _mm_andnot_si128(copy, blended)));
+	}
+	blendRowScalar<premultiplied>(dest + i, source + i, count - i);
+}
+
+/**
+ * Blends the rows of a rectangle with a width known at compile time, the loop of the row
+ * kernel is unrolled and has no tail for the block image widths (multiples of 8).
+ */
+template <bool premultiplied, int width>
+void blendFixedRectSSE2(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int height) {
+	for (int y = 0; y < height; y++, dest += dest_stride, source += source_stride)
+		blendRowSSE2<premultiplied>(dest, source, width);
+}
+
+template <bool premultiplied>
+void blendRectSSE2(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height) {
+	switch (width) {
+	case 16:
+		blendFixedRectSSE2<premultiplied, 16>(dest, dest_stride, source, source_stride, height);
+		break;
+	case 24:
+		blendFixedRectSSE2<premultiplied, 24>(dest, dest_stride, source, source_stride, height);
+		break;
+	case 32:
+		blendFixedRectSSE2<premultiplied, 32>(dest, dest_stride, source, source_stride, height);
+		break;
+	case 48:
+		blendFixedRectSSE2<premultiplied, 48>(dest, dest_stride, source, source_stride, height);
+		break;
+	default:
+		for (int y = 0; y < height; y++, dest += dest_stride, source += source_stride)
+			blendRowSSE2<premultiplied>(dest, source, width);
+		break;
+	}
+}
+
+void alphaCopyRowSSE2(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		__m128i s_transparent = _mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), zero);
+		int transparent = _mm_movemask_epi8(s_transparent);
+		if (transparent == 0xffff)
+			continue;
+		if (transparent != 0) {
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+			s = _mm_or_si128(_mm_and_si128(s_transparent, d),
+					_mm_andnot_si128(s_transparent, s));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), s);
+	}
+	alphaCopyRowScalar(dest + i, source + i, count - i);
+}
+
+#endif
+
+#ifdef HAVE_BLENDING_AVX2
+
+/**
+ * Blends four pixels with 16 bits per channel, the same as blendUnpackedSSE2.
+ */
+TARGET_AVX2 inline __m256i blendUnpackedAVX2(__m256i s, __m256i d) {
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const __m256i c256 = _mm256_set1_epi16(256);
+	const __m256i alpha_lanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0,
+			-1, 0, 0, 0, -1, 0, 0, 0);
+
+	__m256i sa = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)),
+			_MM_SHUFFLE(3, 3, 3, 3));
+	__m256i da = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(d, _MM_SHUFFLE(3, 3, 3, 3)),
+			_MM_SHUFFLE(3, 3, 3, 3));
+	__m256i sainv = _mm256_sub_epi16(c256, sa);
+	sa = _mm256_add_epi16(sa, one);
+
+	__m256i rgb = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, sa),
+			_mm256_mullo_epi16(d, sainv)), 8);
+	__m256i dainv = _mm256_sub_epi16(c256, da);
+	__m256i a = _mm256_sub_epi16(c255, _mm256_srli_epi16(
+			_mm256_sub_epi16(_mm256_mullo_epi16(sainv, dainv), one), 8));
+	return _mm256_blendv_epi8(rgb, a, alpha_lanes);
+}
+
+template <bool premultiplied>
+TARGET_AVX2 inline void blendRowAVX2(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_mask = _mm256_set1_epi32(0xff000000);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+		__m256i sa = _mm256_and_si256(s, alpha_mask);
+		__m256i s_transparent = _mm256_cmpeq_epi32(sa, zero);
+		if (_mm256_movemask_epi8(s_transparent) == -1)
+			continue;
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alpha_mask)) == -1) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), s);
+			continue;
+		}
+
+		__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + i));
+		// unpacking and packing works in the 128-bit lanes, so the order stays the same
+		__m256i blended = _mm256_packus_epi16(
+				blendUnpackedAVX2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero)),
+				blendUnpackedAVX2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero)));
+		if (premultiplied) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), blended);
+			continue;
+		}
+		__m256i d_transparent = _mm256_cmpeq_epi32(_mm256_and_si256(d, alpha_mask), zero);
+		__m256i copy = _mm256_andnot_si256(s_transparent, d_transparent);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+				_mm256_blendv_epi8(blended, s, copy));
+	}
+	blendRowSSE2<premultiplied>(dest + i, source + i, count - i);
+}
+
+template <bool premultiplied, int width>
+TARGET_AVX2 void blendFixedRectAVX2(RGBAPixel* dest, int dest_stride,
+		const RGBAPixel* source, int source_stride, int height) {
+	for (int y = 0; y < height; y++, dest += dest_stride, source += source_stride)
+		blendRowAVX2<premultiplied>(dest, source, width);
+}
+
+template <bool premultiplied>
+TARGET_AVX2 void blendRectAVX2(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height) {
+	switch (width) {
+	case 16:
+		blendFixedRectAVX2<premultiplied, 16>(dest, dest_stride, source, source_stride, height);
+		break;
+	case 24:
+		blendFixedRectAVX2<premultiplied, 24>(dest, dest_stride, source, source_stride, height);
+		break;
+	case 32:
+		blendFixedRectAVX2<premultiplied, 32>(dest, dest_stride, source, source_stride, height);
+		break;
+	case 48:
+		blendFixedRectAVX2<premultiplied, 48>(dest, dest_stride, source, source_stride, height);
+		break;
+	default:
+		for (int y = 0; y < height; y++, dest += dest_stride, source += source_stride)
+			blendRowAVX2<premultiplied>(dest, source, width);
+		break;
+	}
+}
+
+TARGET_AVX2 void alphaCopyRowAVX2(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_mask = _mm256_set1_epi32(0xff000000);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+		__m256i s_transparent = _mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), zero);
+		int transparent = _mm256_movemask_epi8(s_transparent);
+		if (transparent == -1)
+			continue;
+		if (transparent != 0) {
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + i));
+			s = _mm256_blendv_epi8(s, d, s_transparent);
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), s);
+	}
+	alphaCopyRowSSE2(dest + i, source + i, count - i);
+}
+
+#endif
+
+BlendingKernel detectBlendingKernel() {
+#ifdef HAVE_BLENDING_AVX2
+	if (isBlendingKernelSupported(BlendingKernel::AVX2))
+		return BlendingKernel::AVX2;
+#endif
+#ifdef HAVE_BLENDING_SSE2
+	return BlendingKernel::SSE2;
+#else
+	return BlendingKernel::SCALAR;
+#endif
+}
+
+}
+
+bool isBlendingKernelSupported(BlendingKernel kernel) {
+	if (kernel == BlendingKernel::SCALAR)
+		return true;
+#ifdef HAVE_BLENDING_SSE2
+	if (kernel == BlendingKernel::SSE2)
+		return true;
+#endif
+#ifdef HAVE_BLENDING_AVX2
+	if (kernel == BlendingKernel::AVX2) {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+	}
+#endif
+	return false;
+}
+
+BlendingKernel getBlendingKernel() {
+	static const BlendingKernel kernel = detectBlendingKernel();
+	return kernel;
+}
+
+void blendRow(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	blendRow(dest, source, count, getBlendingKernel());
+}
+
+void blendRow(RGBAPixel* dest, const RGBAPixel* source, int count, BlendingKernel kernel) {
+	switch (kernel) {
+#ifdef HAVE_BLENDING_AVX2
+	case BlendingKernel::AVX2: blendRowAVX2<false>(dest, source, count); break;
+#endif
+#ifdef HAVE_BLENDING_SSE2
+	case BlendingKernel::SSE2: blendRowSSE2<false>(dest, source, count); break;
+#endif
+	default: blendRowScalar<false>(dest, source, count); break;
+	}
+}
+
+void blendRowPremultiplied(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	blendRowPremultiplied(dest, source, count, getBlendingKernel());
+}
+
+void blendRowPremultiplied(RGBAPixel* dest, const RGBAPixel* source, int count,
+		BlendingKernel kernel) {
+	switch (kernel) {
+#ifdef HAVE_BLENDING_AVX2
+	case BlendingKernel::AVX2: blendRowAVX2<true>(dest, source, count); break;
+#endif
+#ifdef HAVE_BLENDING_SSE2
+	case BlendingKernel::SSE2: blendRowSSE2<true>(dest, source, count); break;
+#endif
+	default: blendRowScalar<true>(dest, source, count); break;
+	}
+}
+
+void blendRect(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height) {
+	blendRect(dest, dest_stride, source, source_stride, width, height, getBlendingKernel());
+}
+
+void blendRect(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height, BlendingKernel kernel) {
+	switch (kernel) {
+#ifdef HAVE_BLENDING_AVX2
+	case BlendingKernel::AVX2:
+		blendRectAVX2<false>(dest, dest_stride, source, source_stride, width, height);
+		break;
+#endif
+#ifdef HAVE_BLENDING_SSE2
+	case BlendingKernel::SSE2:
+		blendRectSSE2<false>(dest, dest_stride, source, source_stride, width, height);
+		break;
+#endif
+	default:
+		blendRectScalar<false>(dest, dest_stride, source, source_stride, width, height);
+		break;
+	}
+}
+
+void blendRectPremultiplied(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height) {
+	blendRectPremultiplied(dest, dest_stride, source, source_stride, width, height,
+			getBlendingKernel());
+}
+
+void blendRectPremultiplied(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height, BlendingKernel kernel) {
+	switch (kernel) {
+#ifdef HAVE_BLENDING_AVX2
+	case BlendingKernel::AVX2:
+		blendRectAVX2<true>(dest, dest_stride, source, source_stride, width, height);
+		break;
+#endif
+#ifdef HAVE_BLENDING_SSE2
+	case BlendingKernel::SSE2:
+		blendRectSSE2<true>(dest, dest_stride, source, source_stride, width, height);
+		break;
+#endif
+	default:
+		blendRectScalar<true>(dest, dest_stride, source, source_stride, width, height);
+		break;
+	}
+}
+
+int blendRowUnderPremultiplied(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	int opaque = 0;
+	for (int i = 0; i < count; i++) {
+		if (dest[i] >= 0xff000000)
+			continue;
+		blendUnderPremultiplied(dest[i], source[i]);
+		if (dest[i] >= 0xff000000)
+			opaque++;
+	}
+	return opaque;
+}
+
+void alphaCopyRow(RGBAPixel* dest, const RGBAPixel* source, int count) {
+	alphaCopyRow(dest, source, count, getBlendingKernel());
+}
+
+void alphaCopyRow(RGBAPixel* dest, const RGBAPixel* source, int count,
+		BlendingKernel kernel) {
+	switch (kernel) {
+#ifdef HAVE_BLENDING_AVX2
+	case BlendingKernel::AVX2: alphaCopyRowAVX2(dest, source, count); break;
+#endif
+#ifdef HAVE_BLENDING_SSE2
+	case BlendingKernel::SSE2: alphaCopyRowSSE2(dest, source, count); break;
+#endif
+	default: alphaCopyRowScalar(dest, source, count); break;
+	}
+}
+
+}
+}
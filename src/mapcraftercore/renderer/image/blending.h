@@ -0,0 +1,97 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_BLENDING_H_
+#define IMAGE_BLENDING_H_
+
+#include "../image.h"
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * The implementations of the row blending functions. The vectorized ones produce exactly
+ * the same pixels as the scalar one, which uses blend() for every pixel.
+ */
+enum class BlendingKernel {
+	SCALAR,
+	SSE2,
+	AVX2
+};
+
+/**
+ * Returns whether an implementation is available (compiled in and supported by the CPU).
+ */
+bool isBlendingKernelSupported(BlendingKernel kernel);
+
+/**
+ * Returns the fastest available implementation, which is used by default.
+ */
+BlendingKernel getBlendingKernel();
+
+/**
+ * Alpha-blends a row of source pixels onto a row of destination pixels, like calling
+ * blend(dest[i], source[i]) for each pixel.
+ */
+void blendRow(RGBAPixel* dest, const RGBAPixel* source, int count);
+void blendRow(RGBAPixel* dest, const RGBAPixel* source, int count, BlendingKernel kernel);
+
+/**
+ * Alpha-blends a row of source pixels onto a row of destination pixels with premultiplied
+ * alpha, like calling blendPremultiplied(dest[i], source[i]) for each pixel.
+ */
+void blendRowPremultiplied(RGBAPixel* dest, const RGBAPixel* source, int count);
+void blendRowPremultiplied(RGBAPixel* dest, const RGBAPixel* source, int count,
+		BlendingKernel kernel);
+
+/**
+ * Alpha-blends a rectangle of source pixels onto destination pixels, like blendRow() and
+ * blendRowPremultiplied() for each row (the strides are in pixels). The kernel is chosen
+ * once per rectangle, and the widths of the block images of the common texture sizes
+ * (16, 24, 32 and 48 pixels) have kernels with a constant row length.
+ */
+void blendRect(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height);
+void blendRect(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height, BlendingKernel kernel);
+void blendRectPremultiplied(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height);
+void blendRectPremultiplied(RGBAPixel* dest, int dest_stride, const RGBAPixel* source,
+		int source_stride, int width, int height, BlendingKernel kernel);
+
+/**
+ * Alpha-blends a row of source pixels under a row of destination pixels with premultiplied
+ * alpha, like calling blendUnderPremultiplied(dest[i], source[i]) for each pixel. Returns
+ * the count of destination pixels which became opaque. There is only a scalar
+ * implementation, most of the destination pixels are opaque and skipped anyway.
+ */
+int blendRowUnderPremultiplied(RGBAPixel* dest, const RGBAPixel* source, int count);
+
+/**
+ * Copies a row of source pixels to a row of destination pixels, but skips completely
+ * transparent source pixels.
+ */
+void alphaCopyRow(RGBAPixel* dest, const RGBAPixel* source, int count);
+void alphaCopyRow(RGBAPixel* dest, const RGBAPixel* source, int count,
+		BlendingKernel kernel);
+
+}
+}
+
+#endif /* IMAGE_BLENDING_H_ */
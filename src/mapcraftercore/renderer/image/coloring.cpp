@@ -0,0 +1,135 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "coloring.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#define HAVE_COLORING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+/*
+ * The products of the channels and the factors are at most 255 * 255, so they are divided
+ * by 255 with x / 255 = (x + (x >> 8) + 1) >> 8, which is exact for x < 65535 and needs
+ * only 16 bits per channel.
+ */
+
+void multiplyRowScalar(RGBAPixel* pixels, int count, uint8_t r, uint8_t g, uint8_t b,
+		uint8_t a) {
+	for (int i = 0; i < count; i++)
+		pixels[i] = rgba_multiply(pixels[i], r, g, b, a);
+}
+
+void addClampRowScalar(RGBAPixel* pixels, int count, int r, int g, int b) {
+	for (int i = 0; i < count; i++)
+		if (pixels[i] != 0)
+			pixels[i] = rgba_add_clamp(pixels[i], r, g, b);
+}
+
+#ifdef HAVE_COLORING_SSE2
+
+inline __m128i multiplyUnpackedSSE2(__m128i p, __m128i factors) {
+	const __m128i one = _mm_set1_epi16(1);
+	__m128i x = _mm_mullo_epi16(p, factors);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), one), 8);
+}
+
+void multiplyRowSSE2(RGBAPixel* pixels, int count, uint8_t r, uint8_t g, uint8_t b,
+		uint8_t a) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i factors = _mm_set_epi16(a, b, g, r, a, b, g, r);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+		p = _mm_packus_epi16(
+				multiplyUnpackedSSE2(_mm_unpacklo_epi8(p, zero), factors),
+				multiplyUnpackedSSE2(_mm_unpackhi_epi8(p, zero), factors));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), p);
+	}
+	multiplyRowScalar(pixels + i, count - i, r, g, b, a);
+}
+
+void addClampRowSSE2(RGBAPixel* pixels, int count, int r, int g, int b) {
+	// the positive and the negative parts of the values are added / subtracted with
+	// unsigned saturation
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i add = _mm_set1_epi32(rgba(std::max(0, r), std::max(0, g),
+			std::max(0, b), 0));
+	const __m128i sub = _mm_set1_epi32(rgba(std::max(0, -r), std::max(0, -g),
+			std::max(0, -b), 0));
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+		__m128i transparent = _mm_cmpeq_epi32(p, zero);
+		__m128i tinted = _mm_subs_epu8(_mm_adds_epu8(p, add), sub);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i),
+				_mm_andnot_si128(transparent, tinted));
+	}
+	addClampRowScalar(pixels + i, count - i, r, g, b);
+}
+
+#endif
+
+}
+
+void multiplyRow(RGBAPixel* pixels, int count, uint8_t r, uint8_t g, uint8_t b,
+		uint8_t a) {
+	multiplyRow(pixels, count, r, g, b, a, getBlendingKernel());
+}
+
+void multiplyRow(RGBAPixel* pixels, int count, uint8_t r, uint8_t g, uint8_t b,
+		uint8_t a, BlendingKernel kernel) {
+#ifdef HAVE_COLORING_SSE2
+	if (kernel != BlendingKernel::SCALAR) {
+		multiplyRowSSE2(pixels, count, r, g, b, a);
+		return;
+	}
+#endif
+	multiplyRowScalar(pixels, count, r, g, b, a);
+}
+
+void addClampRow(RGBAPixel* pixels, int count, int r, int g, int b) {
+	addClampRow(pixels, count, r, g, b, getBlendingKernel());
+}
+
+void addClampRow(RGBAPixel* pixels, int count, int r, int g, int b,
+		BlendingKernel kernel) {
+	r = std::max(-255, std::min(255, r));
+	g = std::max(-255, std::min(255, g));
+	b = std::max(-255, std::min(255, b));
+#ifdef HAVE_COLORING_SSE2
+	if (kernel != BlendingKernel::SCALAR) {
+		addClampRowSSE2(pixels, count, r, g, b);
+		return;
+	}
+#endif
+	addClampRowScalar(pixels, count, r, g, b);
+}
+
+}
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_COLORING_H_
+#define IMAGE_COLORING_H_
+
+#include "blending.h"
+#include "../image.h"
+
+namespace mapcrafter {
+namespace renderer {
+
+/*
+ * The row coloring functions with integer arithmetic only. They have a scalar and an SSE2
+ * implementation (chosen with the blending kernels, the AVX2 kernel uses the SSE2 one),
+ * which produce exactly the same pixels.
+ */
+
+/**
+ * Multiplies the channels of a row of pixels with factors from 0 to 255 (255 is 1), like
+ * calling rgba_multiply(pixels[i], r, g, b, a) with the integer factors for each pixel.
+ */
+void multiplyRow(RGBAPixel* pixels, int count, uint8_t r, uint8_t g, uint8_t b,
+		uint8_t a = 255);
+void multiplyRow(RGBAPixel* pixels, int count, uint8_t r, uint8_t g, uint8_t b,
+		uint8_t a, BlendingKernel kernel);
+
+/**
+ * Adds values (-255 to 255) to the color channels of a row of pixels and clamps them, like
+ * calling rgba_add_clamp(pixels[i], r, g, b) for each pixel. The alpha channel and
+ * completely transparent pixels (0) stay unchanged.
+ */
+void addClampRow(RGBAPixel* pixels, int count, int r, int g, int b);
+void addClampRow(RGBAPixel* pixels, int count, int r, int g, int b,
+		BlendingKernel kernel);
+
+}
+}
+
+#endif /* IMAGE_COLORING_H_ */
@@ -19,12 +19,106 @@
 
 #include "palette.h"
 
+#include <cassert>
+#include <climits>
+
+#ifdef __SSE2__
+#define HAVE_PALETTE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace mapcrafter {
 namespace renderer {
 
+namespace {
+
+int findNearestColorScalar(const RGBAPixel* colors, size_t count, RGBAPixel color,
+		size_t start = 0, int best_color = -1, int min_distance = INT_MAX) {
+	for (size_t i = start; i < count; i++) {
+		int distance = rgba_distance2(color, colors[i]);
+		if (distance < min_distance) {
+			best_color = i;
+			min_distance = distance;
+		}
+	}
+	return best_color;
+}
+
+#ifdef HAVE_PALETTE_SSE2
+
+inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * Computes the distances of four colors at once. The components of the colors are
+ * unpacked to 16 bits, so the differences can be squared and the squares of two
+ * components added with one madd, and each lane remembers the first color with the
+ * smallest distance of the colors with the lane's index modulo four.
+ */
+int findNearestColorSSE2(const RGBAPixel* colors, size_t count, RGBAPixel color) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i search = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+	__m128i best_distances = _mm_set1_epi32(INT_MAX);
+	__m128i best_indices = _mm_set1_epi32(-1);
+	__m128i indices = _mm_set_epi32(3, 2, 1, 0);
+	__m128i four = _mm_set1_epi32(4);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128((const __m128i*) (colors + i));
+		__m128i d01 = _mm_sub_epi16(_mm_unpacklo_epi8(p, zero), search);
+		__m128i d23 = _mm_sub_epi16(_mm_unpackhi_epi8(p, zero), search);
+		// red+green and blue+alpha squares of the colors 0/1 and 2/3
+		__m128 s01 = _mm_castsi128_ps(_mm_madd_epi16(d01, d01));
+		__m128 s23 = _mm_castsi128_ps(_mm_madd_epi16(d23, d23));
+		__m128i distances = _mm_add_epi32(
+				_mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(3, 1, 3, 1))));
+		__m128i smaller = _mm_cmplt_epi32(distances, best_distances);
+		best_distances = select(smaller, distances, best_distances);
+		best_indices = select(smaller, indices, best_indices);
+		indices = _mm_add_epi32(indices, four);
+	}
+
+	// the first of the lanes' colors with the smallest distance, then the remaining colors
+	int32_t lane_distances[4], lane_indices[4];
+	_mm_storeu_si128((__m128i*) lane_distances, best_distances);
+	_mm_storeu_si128((__m128i*) lane_indices, best_indices);
+	int best_color = -1;
+	int min_distance = INT_MAX;
+	for (int j = 0; j < 4; j++) {
+		if (lane_indices[j] == -1)
+			continue;
+		if (lane_distances[j] < min_distance
+				|| (lane_distances[j] == min_distance && lane_indices[j] < best_color)) {
+			best_color = lane_indices[j];
+			min_distance = lane_distances[j];
+		}
+	}
+	return findNearestColorScalar(colors, count, color, i, best_color, min_distance);
+}
+
+#endif
+
+}
+
+int findNearestColor(const RGBAPixel* colors, size_t count, RGBAPixel color) {
+#ifdef HAVE_PALETTE_SSE2
+	return findNearestColorSSE2(colors, count, color);
+#else
+	return findNearestColorScalar(colors, count, color);
+#endif
+}
+
 Palette::~Palette() {
 }
 
+void Palette::getNearestColors(const RGBAPixel* colors, size_t count, int* indices) {
+	for (size_t i = 0; i < count; i++)
+		indices[i] = getNearestColor(colors[i]);
+}
+
 SimplePalette::SimplePalette() {
 }
 
@@ -40,16 +134,65 @@ const std::vector<RGBAPixel>& SimplePalette::getColors() const {
 }
 
 int SimplePalette::getNearestColor(const RGBAPixel& color) {
-	int best_color = 0;
-	int min_distance = -1;
-	for (size_t i = 0; i < colors.size(); i++) {
-		int distance = rgba_distance2(color, colors[i]);
-		if (min_distance == -1 || distance < min_distance) {
-			best_color = i;
-			min_distance = distance;
+	if (colors.empty())
+		return 0;
+	return findNearestColor(&colors[0], colors.size(), color);
+}
+
+void SimplePalette::getNearestColors(const RGBAPixel* colors, size_t count, int* indices) {
+	for (size_t i = 0; i < count; i++)
+		indices[i] = SimplePalette::getNearestColor(colors[i]);
+}
+
+LookupPalette::LookupPalette(const std::vector<RGBAPixel>& colors)
+	: colors(colors) {
+	assert(colors.size() > 0 && colors.size() <= 256);
+
+	// the reduced values are evenly spread from 0 to 255, so fully transparent and
+	// opaque colors are looked up exactly
+	int color_levels = 1 << COLOR_BITS;
+	int alpha_levels = 1 << ALPHA_BITS;
+	for (int i = 0; i < 256; i++) {
+		levels_color[i] = (i * (color_levels - 1) + 127) / 255;
+		levels_alpha[i] = (i * (alpha_levels - 1) + 127) / 255;
+	}
+
+	lookup.resize(color_levels * color_levels * color_levels * alpha_levels);
+	size_t index = 0;
+	for (int a = 0; a < alpha_levels; a++) {
+		int alpha = a * 255 / (alpha_levels - 1);
+		for (int b = 0; b < color_levels; b++) {
+			int blue = b * 255 / (color_levels - 1);
+			for (int g = 0; g < color_levels; g++) {
+				int green = g * 255 / (color_levels - 1);
+				for (int r = 0; r < color_levels; r++, index++) {
+					int red = r * 255 / (color_levels - 1);
+					lookup[index] = findNearestColor(&colors[0], colors.size(),
+							rgba(red, green, blue, alpha));
+				}
+			}
 		}
 	}
-	return best_color;
+}
+
+LookupPalette::~LookupPalette() {
+}
+
+const std::vector<RGBAPixel>& LookupPalette::getColors() const {
+	return colors;
+}
+
+int LookupPalette::getNearestColor(const RGBAPixel& color) {
+	size_t index = levels_alpha[rgba_alpha(color)];
+	index = (index << COLOR_BITS) | levels_color[rgba_blue(color)];
+	index = (index << COLOR_BITS) | levels_color[rgba_green(color)];
+	index = (index << COLOR_BITS) | levels_color[rgba_red(color)];
+	return lookup[index];
+}
+
+void LookupPalette::getNearestColors(const RGBAPixel* colors, size_t count, int* indices) {
+	for (size_t i = 0; i < count; i++)
+		indices[i] = LookupPalette::getNearestColor(colors[i]);
 }
 
 }
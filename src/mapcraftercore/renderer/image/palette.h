@@ -22,23 +22,39 @@
 
 #include "../image.h"
 
+#include <cstdint>
 #include <vector>
 
 namespace mapcrafter {
 namespace renderer {
 
+/**
+ * Returns the index of the first of some colors with the smallest distance to a color,
+ * or -1 if there are no colors. The distances of four colors are computed at once with
+ * SSE2 if available.
+ */
+int findNearestColor(const RGBAPixel* colors, size_t count, RGBAPixel color);
+
 class Palette {
 public:
 	virtual ~Palette();
 
 	virtual const std::vector<RGBAPixel>& getColors() const = 0;
 	virtual int getNearestColor(const RGBAPixel& color) = 0;
+
+	/**
+	 * Finds the nearest palette colors of many colors at once, for example of a row of
+	 * an image, without a virtual call per color. The default implementation calls
+	 * getNearestColor for every color.
+	 */
+	virtual void getNearestColors(const RGBAPixel* colors, size_t count, int* indices);
 };
 
 /**
  * Trivial color palette implementation.
  *
- * Very bad O(n^2) color lookup performance! Just used in the test cases.
+ * Compares a color with all palette colors, that's slow even with SSE2! Just used in
+ * the test cases.
  */
 class SimplePalette : public Palette {
 public:
@@ -48,9 +64,41 @@ public:
 
 	virtual const std::vector<RGBAPixel>& getColors() const;
 	virtual int getNearestColor(const RGBAPixel& color);
+	virtual void getNearestColors(const RGBAPixel* colors, size_t count, int* indices);
+
+protected:
+	std::vector<RGBAPixel> colors;
+};
+
+/**
+ * Color palette with a precomputed table of the nearest colors, made to be reused for
+ * many images. The table has an entry for every color with its components reduced to
+ * a few bits, so finding a color is just a lookup, but the found colors are only
+ * almost the nearest ones. The palette can have at most 256 colors.
+ *
+ * The palette isn't changed by looking up colors, so it can be used by many threads
+ * at the same time.
+ */
+class LookupPalette : public Palette {
+public:
+	LookupPalette(const std::vector<RGBAPixel>& colors);
+	virtual ~LookupPalette();
+
+	virtual const std::vector<RGBAPixel>& getColors() const;
+	virtual int getNearestColor(const RGBAPixel& color);
+	virtual void getNearestColors(const RGBAPixel* colors, size_t count, int* indices);
+
+	// significant bits of the red, green, blue and alpha components in the table
+	static const int COLOR_BITS = 5;
+	static const int ALPHA_BITS = 3;
 
 protected:
 	std::vector<RGBAPixel> colors;
+	// index of the reduced value of each component value, for the color and alpha
+	// components
+	uint8_t levels_color[256], levels_alpha[256];
+	// palette color index for each reduced color
+	std::vector<uint8_t> lookup;
 };
 
 }
@@ -19,22 +19,33 @@
 
 #include "quantization.h"
 
+#include "../../config.h"
+
+#include <algorithm>
 #include <set>
 #include <queue>
 
 namespace mapcrafter {
 namespace renderer {
 
-Octree::Octree(Octree* parent, int level)
-	: parent(parent), level(level), reference(0), red(0), green(0), blue(0), alpha(0), color_id(-1) {
-	for (int i = 0; i < 16; i++)
-		children[i] = nullptr;
+Octree::Octree(OctreeArena* arena)
+	: parent(nullptr), arena(arena), children_mask(0), level(0),
+	  reference(0), red(0), green(0), blue(0), alpha(0), color_id(-1) {
+	std::fill(children, children + 16, 0);
 }
 
 Octree::~Octree() {
-	for (int i = 0; i < 16; i++)
-		if (children[i])
-			delete children[i];
+}
+
+void Octree::initialize(Octree* parent, int level, OctreeArena* arena) {
+	this->parent = parent;
+	this->arena = arena;
+	std::fill(children, children + 16, 0);
+	children_mask = 0;
+	this->level = level;
+	reference = red = green = blue = alpha = 0;
+	color_id = -1;
+	subtree_colors.clear();
 }
 
 Octree* Octree::getParent() {
@@ -54,37 +65,39 @@ bool Octree::isRoot() const {
 }
 
 bool Octree::isLeaf() const {
-	for (int i = 0; i < 16; i++)
-		if (children[i])
-			return false;
-	return true;
+	return children_mask == 0;
 }
 
 bool Octree::hasChildren(int index) const {
 	assert(index >= 0 && index < 16);
-	return children[index] != nullptr;
+	return children_mask & (1 << index);
 }
 
 int Octree::getChildrenCount() const {
 	int count = 0;
-	for (int i = 0; i < 16; i++)
-		if (children[i])
-			count++;
+	for (uint16_t mask = children_mask; mask; mask &= mask - 1)
+		count++;
 	return count;
 }
 
 Octree* Octree::getChildren(int index) {
 	assert(index >= 0 && index < 16);
-	if (!children[index])
-		children[index] = new Octree(this, level + 1);
-	return children[index];
+	if (!children[index]) {
+		if (arena == nullptr) {
+			own_arena.reset(new OctreeArena());
+			arena = own_arena.get();
+		}
+		children[index] = arena->create(this, level + 1) + 1;
+		children_mask |= 1 << index;
+	}
+	return arena->get(children[index] - 1);
 }
 
 const Octree* Octree::getChildren(int index) const {
 	assert(index >= 0 && index < 16);
 	if (!children[index])
 		return nullptr;
-	return children[index];
+	return arena->get(children[index] - 1);
 }
 
 bool Octree::hasColor() const {
@@ -119,8 +132,9 @@ void Octree::reduceToParent() {
 	parent->alpha += alpha;
 	
 	for (int i = 0; i < 16; i++) {
-		if (parent->children[i] == this) {
-			parent->children[i] = nullptr;
+		if (parent->children[i] && arena->get(parent->children[i] - 1) == this) {
+			parent->children[i] = 0;
+			parent->children_mask &= ~(1 << i);
 			break;
 		}
 	}
@@ -204,6 +218,29 @@ int Octree::findNearestColor(const Octree* octree, RGBAPixel color) {
 	return best_color;
 }
 
+OctreeArena::OctreeArena()
+	: used(0) {
+}
+
+OctreeArena::~OctreeArena() {
+}
+
+uint32_t OctreeArena::create(Octree* parent, int level) {
+	if (used / BLOCK_SIZE == blocks.size())
+		blocks.push_back(std::unique_ptr<Octree[]>(new Octree[BLOCK_SIZE]));
+	uint32_t index = used++;
+	get(index)->initialize(parent, level, this);
+	return index;
+}
+
+void OctreeArena::reset() {
+	used = 0;
+}
+
+size_t OctreeArena::size() const {
+	return used;
+}
+
 SubPalette::SubPalette(const std::vector<RGBAPixel>& palette_colors)
 	: initialized(false), palette_colors(palette_colors) {
 }
@@ -331,23 +368,43 @@ struct NodeComparator {
  */
 void octreeColorQuantize(const RGBAImage& image, size_t max_colors,
 		std::vector<RGBAPixel>& colors, Octree** octree) {
+	octreeColorQuantize(std::vector<const RGBAImage*>(1, &image), max_colors, colors, octree);
+}
+
+void octreeColorQuantize(const std::vector<const RGBAImage*>& images, size_t max_colors,
+		std::vector<RGBAPixel>& colors, Octree** octree) {
 	assert(max_colors > 0);
 
-	// have an octree with the colors as leaves
-	Octree* internal_octree = new Octree();
+	// have an octree with the colors as leaves, its nodes are allocated in an arena of
+	// the thread if the octree isn't returned
+	Octree* internal_octree;
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local OctreeArena thread_arena;
+#else
+	OctreeArena thread_arena;
+#endif
+	if (octree != nullptr) {
+		internal_octree = new Octree();
+	} else {
+		thread_arena.reset();
+		internal_octree = new Octree(&thread_arena);
+	}
 	// and a priority queue of leaves to be processed
 	// the order of leaves is very important, see NodeComparator
 	std::priority_queue<Octree*, std::vector<Octree*>, NodeComparator> queue;
 
 	// insert the colors into the octree
-	for (int x = 0; x < image.getWidth(); x++) {
-		for (int y = 0; y < image.getHeight(); y++) {
-			RGBAPixel color = image.pixel(x, y);
-			Octree* node = Octree::findOrCreateNode(internal_octree, color);
-			node->setColor(color);
-			// add the leaf only once to the queue
-			if (node->getCount() == 1)
-				queue.push(node);
+	for (size_t i = 0; i < images.size(); i++) {
+		const RGBAImage& image = *images[i];
+		for (int x = 0; x < image.getWidth(); x++) {
+			for (int y = 0; y < image.getHeight(); y++) {
+				RGBAPixel color = image.pixel(x, y);
+				Octree* node = Octree::findOrCreateNode(internal_octree, color);
+				node->setColor(color);
+				// add the leaf only once to the queue
+				if (node->getCount() == 1)
+					queue.push(node);
+			}
 		}
 	}
 
@@ -359,9 +416,8 @@ void octreeColorQuantize(const RGBAImage& image, size_t max_colors,
 		
 		// add the color value of the leaf to the parent
 		node->reduceToParent();
+		// (leaf is automatically removed from parent in reduceToParent())
 		Octree* parent = node->getParent();
-		// delete the leaf (leaf is automatically removed from parent in reduceToParent())
-		delete node;
 
 		// add parent to queue if it is a leaf now
 		if (parent->isLeaf())
@@ -24,12 +24,15 @@
 #include "../image.h"
 #include "../../util.h"
 
+#include <memory>
 #include <vector>
+#include <stdint.h>
 
 namespace mapcrafter {
 namespace renderer {
 
 class Octree;
+class OctreeArena;
 
 // number of significant bits to use of the color components
 // determines the count of leaves in the octree
@@ -48,12 +51,13 @@ const int OCTREE_COLOR_BITS = 5;
 class Octree {
 public:
 	/**
-	 * Constructor.
+	 * Creates the root node of an octree. The other nodes are allocated in the supplied
+	 * arena (which must outlive the octree), or in an arena of the root node.
 	 */
-	Octree(Octree* parent = nullptr, int level = 0);
+	Octree(OctreeArena* arena = nullptr);
 
 	/**
-	 * Yeah, destructor.
+	 * Yeah, destructor. The nodes stay in the arena until it's reset.
 	 */
 	~Octree();
 
@@ -124,7 +128,7 @@ public:
 
 	/**
 	 * Reduces the colors of this node to the parent node and automatically removes the
-	 * node from the parent. You have to delete the node after that on your own.
+	 * node from the parent. The node is not used anymore then.
 	 */
 	void reduceToParent();
 
@@ -161,10 +165,19 @@ public:
 	static int findNearestColor(const Octree* octree, RGBAPixel color);
 
 protected:
-	// parent and children of this node
+	/**
+	 * Initializes a node allocated in an arena, a reused node is reset.
+	 */
+	void initialize(Octree* parent, int level, OctreeArena* arena);
+
+	// parent of this node and the arena with the nodes of the octree, the children are
+	// the indices of the nodes in the arena (+1, 0 if there is no child)
 	Octree* parent;
-	Octree* children[16];
-	int level;
+	OctreeArena* arena;
+	uint32_t children[16];
+	// the children which exist (bit i for child i)
+	uint16_t children_mask;
+	uint8_t level;
 
 	// how many colors this node represents
 	// only leaves or reduced nodes have a reference != 0
@@ -178,6 +191,51 @@ protected:
 	// TODO link with color palette?
 	// array of palette colors (color index, color) in subtrees of this node
 	std::vector<std::pair<int, RGBAPixel>> subtree_colors;
+
+	// the arena of a root node created without one
+	std::unique_ptr<OctreeArena> own_arena;
+
+	friend class OctreeArena;
+};
+
+/**
+ * Allocates the nodes of octrees in blocks, instead of every node on its own. Resetting
+ * the arena frees all nodes at once, but keeps the memory of the blocks for the nodes of
+ * the next octrees, so quantizing the colors of one tile after another doesn't allocate
+ * memory again.
+ */
+class OctreeArena {
+public:
+	OctreeArena();
+	~OctreeArena();
+
+	/**
+	 * Allocates a node and returns its index.
+	 */
+	uint32_t create(Octree* parent, int level);
+
+	/**
+	 * Returns the node with an index.
+	 */
+	Octree* get(uint32_t index) {
+		return &blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+	}
+
+	/**
+	 * Frees all nodes, the octrees with nodes of the arena must not be used anymore.
+	 */
+	void reset();
+
+	/**
+	 * Returns the count of allocated nodes.
+	 */
+	size_t size() const;
+
+private:
+	static const uint32_t BLOCK_SIZE = 1024;
+
+	std::vector<std::unique_ptr<Octree[]> > blocks;
+	uint32_t used;
 };
 
 /**
@@ -260,11 +318,19 @@ protected:
 /**
  * Quantizes the colors of a given image to max_colors >= colors. Stores the palette
  * colors in the supplied vector and also the used octree to quantize the colors in the
- * octree pointer pointer if you need it.
+ * octree pointer pointer if you need it. Without that, the nodes of the octree are
+ * allocated in an arena of the calling thread, which is reused for every quantization.
  */
 void octreeColorQuantize(const RGBAImage& image, size_t max_colors,
 		std::vector<RGBAPixel>& colors, Octree** octree = nullptr);
 
+/**
+ * Quantizes the colors of several images together, for example to learn one palette
+ * for many images from a few of them.
+ */
+void octreeColorQuantize(const std::vector<const RGBAImage*>& images, size_t max_colors,
+		std::vector<RGBAPixel>& colors, Octree** octree = nullptr);
+
 }
 }
 
@@ -2,10 +2,16 @@
 
 #include "../image.h"
 
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace mapcrafter {
 namespace renderer {
 
-void imageResizeSimple(const RGBAImage& image, RGBAImage& dest, int width, int height) {
+void imageResizeSimple(const RGBAImageView& image, RGBAImage& dest, int width, int height) {
 	dest.setSize(width, height);
 
 	double x_ratio = (double) width / image.getWidth();
@@ -30,7 +36,7 @@ uint8_t interpolate(uint8_t a, uint8_t b, uint8_t c, uint8_t d, double w, double
 
 }
 
-void imageResizeBilinear(const RGBAImage& image, RGBAImage& dest, int width, int height) {
+void imageResizeBilinear(const RGBAImageView& image, RGBAImage& dest, int width, int height) {
 	dest.setSize(width, height);
 
 	double x_ratio = (double) image.getWidth() / width;
@@ -70,22 +76,143 @@ void imageResizeBilinear(const RGBAImage& image, RGBAImage& dest, int width, int
 	}
 }
 
-void imageResizeHalf(const RGBAImage& image, RGBAImage& dest) {
-	int width = image.getWidth();
-	int height = image.getHeight();
-	dest.setSize(width / 2, height / 2);
-
-	for (int x = 0; x < width - 1; x += 2) {
-		for (int y = 0; y < height - 1; y += 2) {
-			RGBAPixel p1 = (image.pixel(x, y) >> 2) & 0x3f3f3f3f;
-			RGBAPixel p2 = (image.pixel(x + 1, y) >> 2) & 0x3f3f3f3f;
-			RGBAPixel p3 = (image.pixel(x, y + 1) >> 2) & 0x3f3f3f3f;
-			RGBAPixel p4 = (image.pixel(x + 1, y + 1) >> 2) & 0x3f3f3f3f;
-			dest.pixel(x / 2, y / 2) = p1 + p2 + p3 + p4;
+namespace {
+
+/**
+ * Averages a 2x2 block of pixels. Each channel of the four pixels is divided by four
+ * before adding them, so there is no overflow.
+ */
+inline RGBAPixel averagePixels(RGBAPixel p1, RGBAPixel p2, RGBAPixel p3, RGBAPixel p4) {
+	return ((p1 >> 2) & 0x3f3f3f3f) + ((p2 >> 2) & 0x3f3f3f3f)
+			+ ((p3 >> 2) & 0x3f3f3f3f) + ((p4 >> 2) & 0x3f3f3f3f);
+}
+
+/**
+ * Averages a 2x2 block of pixels with premultiplied alpha, i.e. the color channels are
+ * weighted with the alpha of the pixels. Otherwise the colors of transparent pixels
+ * (usually black) would darken the borders of the resulting image. The alpha channel
+ * is computed like in averagePixels().
+ */
+RGBAPixel averagePixelsPremultiplied(RGBAPixel p1, RGBAPixel p2, RGBAPixel p3,
+		RGBAPixel p4) {
+	int a1 = rgba_alpha(p1), a2 = rgba_alpha(p2), a3 = rgba_alpha(p3), a4 = rgba_alpha(p4);
+	// equal weights, so it's just the average
+	if (a1 == a2 && a1 == a3 && a1 == a4)
+		return averagePixels(p1, p2, p3, p4);
+
+	int alpha = a1 + a2 + a3 + a4;
+	int r = a1 * rgba_red(p1) + a2 * rgba_red(p2) + a3 * rgba_red(p3) + a4 * rgba_red(p4);
+	int g = a1 * rgba_green(p1) + a2 * rgba_green(p2) + a3 * rgba_green(p3)
+			+ a4 * rgba_green(p4);
+	int b = a1 * rgba_blue(p1) + a2 * rgba_blue(p2) + a3 * rgba_blue(p3)
+			+ a4 * rgba_blue(p4);
+	return rgba((r + alpha / 2) / alpha, (g + alpha / 2) / alpha, (b + alpha / 2) / alpha,
+			(a1 >> 2) + (a2 >> 2) + (a3 >> 2) + (a4 >> 2));
+}
+
+/**
+ * Averages the 2x2 blocks of two source rows into count destination pixels. If composite
+ * is set, the pixels are averaged with premultiplied alpha (averagePixelsPremultiplied())
+ * and completely transparent results are not written.
+ */
+template <bool composite>
+void resizeHalfRow(const RGBAPixel* row1, const RGBAPixel* row2, RGBAPixel* dest,
+		int count) {
+	int i = 0;
+#ifdef __SSE2__
+	const __m128i mask = _mm_set1_epi32(0x3f3f3f3f);
+	const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= count; i += 4) {
+		const __m128i* p1 = reinterpret_cast<const __m128i*>(row1 + 2 * i);
+		const __m128i* p2 = reinterpret_cast<const __m128i*>(row2 + 2 * i);
+		__m128i row1_lo = _mm_loadu_si128(p1), row1_hi = _mm_loadu_si128(p1 + 1);
+		__m128i row2_lo = _mm_loadu_si128(p2), row2_hi = _mm_loadu_si128(p2 + 1);
+
+		if (composite) {
+			// the vectorized average is only right if the alpha values of each 2x2 block
+			// are equal (like in opaque areas), so check whether the alpha values of both
+			// rows and of the even and odd pixels are the same
+			__m128i a_lo = _mm_and_si128(row1_lo, alpha_mask);
+			__m128i a_hi = _mm_and_si128(row1_hi, alpha_mask);
+			__m128i same = _mm_and_si128(
+					_mm_cmpeq_epi32(a_lo, _mm_and_si128(row2_lo, alpha_mask)),
+					_mm_cmpeq_epi32(a_hi, _mm_and_si128(row2_hi, alpha_mask)));
+			__m128i a_even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a_lo),
+					_mm_castsi128_ps(a_hi), _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i a_odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a_lo),
+					_mm_castsi128_ps(a_hi), _MM_SHUFFLE(3, 1, 3, 1)));
+			if (_mm_movemask_epi8(same) != 0xffff
+					|| _mm_movemask_epi8(_mm_cmpeq_epi32(a_even, a_odd)) != 0xffff) {
+				for (int j = i; j < i + 4; j++) {
+					RGBAPixel result = averagePixelsPremultiplied(row1[2 * j],
+							row1[2 * j + 1], row2[2 * j], row2[2 * j + 1]);
+					if (rgba_alpha(result) != 0)
+						dest[j] = result;
+				}
+				continue;
+			}
+		}
+
+		// the sums of the two rows, for the pixels 0-3 and 4-7
+		__m128i sum1 = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(row1_lo, 2), mask),
+				_mm_and_si128(_mm_srli_epi32(row2_lo, 2), mask));
+		__m128i sum2 = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(row1_hi, 2), mask),
+				_mm_and_si128(_mm_srli_epi32(row2_hi, 2), mask));
+		// and the sums of the even and odd pixels
+		__m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(sum1),
+				_mm_castsi128_ps(sum2), _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(sum1),
+				_mm_castsi128_ps(sum2), _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128i result = _mm_add_epi32(even, odd);
+
+		__m128i* d = reinterpret_cast<__m128i*>(dest + i);
+		if (composite) {
+			__m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(result, alpha_mask), zero);
+			result = _mm_or_si128(_mm_and_si128(transparent, _mm_loadu_si128(d)),
+					_mm_andnot_si128(transparent, result));
 		}
+		_mm_storeu_si128(d, result);
+	}
+#endif
+	for (; i < count; i++) {
+		if (composite) {
+			RGBAPixel result = averagePixelsPremultiplied(row1[2 * i], row1[2 * i + 1],
+					row2[2 * i], row2[2 * i + 1]);
+			if (rgba_alpha(result) != 0)
+				dest[i] = result;
+		} else
+			dest[i] = averagePixels(row1[2 * i], row1[2 * i + 1], row2[2 * i], row2[2 * i + 1]);
 	}
 }
 
 }
+
+void imageResizeHalf(const RGBAImageView& image, RGBAImage& dest) {
+	int width = image.getWidth() / 2;
+	int height = image.getHeight() / 2;
+	dest.setSize(width, height);
+	if (width == 0)
+		return;
+
+	for (int y = 0; y < height; y++)
+		resizeHalfRow<false>(&image.pixel(0, 2 * y), &image.pixel(0, 2 * y + 1),
+				&dest.pixel(0, y), width);
 }
 
+void imageResizeHalfBlit(const RGBAImageView& image, RGBAImage& dest, int x, int y) {
+	int width = image.getWidth() / 2;
+	int height = image.getHeight() / 2;
+
+	// the visible part of the resized image, like in RGBAImage::simpleAlphaBlit
+	int sx = std::max(0, -x);
+	int count = std::min(width, dest.getWidth() - x) - sx;
+	if (count <= 0)
+		return;
+	for (int sy = std::max(0, -y); sy < height && sy + y < dest.getHeight(); sy++)
+		resizeHalfRow<true>(&image.pixel(2 * sx, 2 * sy), &image.pixel(2 * sx, 2 * sy + 1),
+				&dest.pixel(sx + x, sy + y), count);
+}
+
+}
+}
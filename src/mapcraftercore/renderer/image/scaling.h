@@ -24,10 +24,19 @@ namespace mapcrafter {
 namespace renderer {
 
 class RGBAImage;
+class RGBAImageView;
 
-void imageResizeSimple(const RGBAImage& image, RGBAImage& dest, int width, int height);
-void imageResizeBilinear(const RGBAImage& image, RGBAImage& dest, int width, int height);
-void imageResizeHalf(const RGBAImage& image, RGBAImage& dest);
+void imageResizeSimple(const RGBAImageView& image, RGBAImage& dest, int width, int height);
+void imageResizeBilinear(const RGBAImageView& image, RGBAImage& dest, int width, int height);
+void imageResizeHalf(const RGBAImageView& image, RGBAImage& dest);
+
+/**
+ * Resizes an image to the half size and copies it directly to a position of another
+ * image, like RGBAImage::simpleAlphaBlit with the resized image (completely transparent
+ * pixels are skipped). Other than imageResizeHalf, the pixels are averaged with
+ * premultiplied alpha, which is used to compose the composite tiles.
+ */
+void imageResizeHalfBlit(const RGBAImageView& image, RGBAImage& dest, int x, int y);
 
 }
 }
@@ -20,19 +20,30 @@
 #include "manager.h"
 
 #include "blockimages.h"
+#include "blockprofiler.h"
+#include "tilecache.h"
+#include "tilecostindex.h"
+#include "image/scaling.h"
 #include "tilerenderworker.h"
+#include "tilewriter.h"
 #include "renderview.h"
 #include "../config/loggingconfig.h"
+#include "../mc/chunk.h"
+#include "../mc/chunkhashindex.h"
 #include "../thread/impl/singlethread.h"
 #include "../thread/impl/multithreading.h"
 #include "../thread/dispatcher.h"
 #include "../util.h"
 #include "../version.h"
 
+#include <chrono>
 #include <cstring>
+#include <algorithm>
 #include <array>
 #include <fstream>
+#include <iomanip>
 #include <memory>
+#include <sstream>
 #include <thread>
 
 namespace mapcrafter {
@@ -75,8 +86,352 @@ bool RenderBehaviors::isCompleteRenderSkip(const std::string& map) const {
 	return true;
 }
 
+void RenderBehaviors::resetForceRender() {
+	if (default_behavior == RenderBehavior::FORCE)
+		default_behavior = RenderBehavior::AUTO;
+	for (auto it = render_behaviors.begin(); it != render_behaviors.end(); ++it)
+		for (int rotation = 0; rotation < 4; rotation++)
+			if (it->second[rotation] == RenderBehavior::FORCE)
+				it->second[rotation] = RenderBehavior::AUTO;
+}
+
 namespace {
 
+// the shards of a map are made of the tiles this many zoom levels above the render tiles
+const int SHARD_LEVELS = 3;
+
+/**
+ * Returns the shard which renders the subtree of a tile, the subtrees are spread
+ * evenly over the shards without knowing the other subtrees.
+ */
+int getShard(const TilePath& tile, int shards) {
+	return tile_path_hash_function()(tile) % shards;
+}
+
+// the most intervals a rendering waits in watch mode for the worlds to stop changing
+const int WATCH_MAX_DELAY = 5;
+
+// count of tiles rendered of every map/rotation to estimate the time of its rendering
+const size_t PLAN_SAMPLE_TILES = 16;
+
+// the tile widths and chunk cache sizes tried when tuning a map, and the count of tiles
+// of the widest tile width whose area is rendered with every combination of them
+const int TUNE_TILE_WIDTHS[] = {1, 2, 4};
+const size_t TUNE_CHUNK_CACHE_SIZES[] = {256, 1024, 4096};
+const size_t TUNE_SAMPLE_TILES = 4;
+
+// the headers of the region files of the worlds and the broken regions and chunks, in
+// the output directory
+const std::string REGION_INDEX_FILE = "regionindex.dat";
+
+// the journal with the tiles written by a rendering, in the directory of the map rotation
+const std::string JOURNAL_FILE = "renderjournal.dat";
+
+// the hashes of the images of the written tiles, in the directory of the map rotation
+const std::string TILE_HASHES_FILE = "tilehashes.dat";
+
+// the render times of the render tiles, in the directory of the map rotation
+const std::string TILE_COSTS_FILE = "tilecosts.dat";
+
+// the progress of increasing the max zoom level, in the directory of the map rotation
+const std::string INCREASE_ZOOM_FILE = "increasezoom.dat";
+
+// the thumbnails of the written tiles, a tile store in the directory of the map rotation
+const std::string THUMBNAILS_DIR = "thumbnails";
+const std::string THUMBNAILS_FORMAT = "rgba";
+
+// the geometry of the render tiles, a tile store per tile set and options of the tile
+// renderer in this directory of the output directory
+const std::string TILE_GEOMETRY_DIR = "geometry";
+const std::string TILE_GEOMETRY_FORMAT = "geom";
+
+// the version of the rendering in the keys of the tile cache, increased when the same
+// settings and chunks render other tiles
+const int TILE_CACHE_VERSION = 1;
+
+// the name of the shared memory segment with the chunks decoded by all processes on
+// this host, and the version of the chunks in it, increased when the same world settings
+// load other chunks
+const std::string SHARED_MEMORY_CHUNK_CACHE = "mapcrafter_chunk_cache";
+const int SHARED_MEMORY_CHUNK_CACHE_VERSION = 1;
+
+// the digests of the uploaded tiles, in the directory of the map rotation
+const std::string UPLOAD_MANIFEST_FILE = "uploadmanifest.txt";
+
+// the tiles of the additional outputs, a tile store per output in this directory of the
+// map rotation
+const std::string OUTPUTS_DIR = "outputs";
+
+// the tiles checked by the recompression with the time they were written then, in the
+// directories of the tile stores (a tile hash index with the times as hashes)
+const std::string TILES_OPTIMIZED_FILE = "tilesoptimized.dat";
+
+// seconds the recompression waits when the machine is busy
+const int OPTIMIZE_BUSY_WAIT = 10;
+
+/**
+ * Returns the dimension and the crop of a world as lines of its configuration.
+ */
+std::string getWorldCropSettings(const config::WorldSection& world_config) {
+	std::ostringstream settings;
+	// the world section has no getters for the bounds of the crop, its dump has them
+	std::ostringstream world_dump;
+	world_config.dump(world_dump);
+	std::istringstream lines(world_dump.str());
+	const char* world_settings[] = {"dimension", "min_", "max_", "center_", "radius",
+		"crop_unpopulated_chunks", "block_mask"};
+	for (std::string line; std::getline(lines, line);)
+		for (size_t i = 0; i < sizeof(world_settings) / sizeof(world_settings[0]); i++)
+			if (line.compare(0, 2 + std::strlen(world_settings[i]),
+					std::string("  ") + world_settings[i]) == 0)
+				settings << line.substr(2) << std::endl;
+	return settings.str();
+}
+
+/**
+ * Returns the settings of a map rotation which change the pixels of its render tiles,
+ * the hash of them is part of the keys of the tiles in the tile cache. The textures and
+ * their options are part of the key of the block images. The paths of the world and the
+ * settings how the tiles are stored don't matter, neither do the settings of the world
+ * other than the dimension and the crop.
+ */
+std::string getTileCacheSettings(const config::WorldSection& world_config,
+		const config::MapSection& map_config, const std::string& block_images_key,
+		int rotation) {
+	std::ostringstream settings;
+	settings << "version = " << TILE_CACHE_VERSION << std::endl;
+	settings << "block_images = " << block_images_key << std::endl;
+	settings << "rotation = " << rotation << std::endl;
+	settings << "render_view = " << map_config.getRenderView() << std::endl;
+	settings << "render_mode = " << map_config.getRenderMode() << std::endl;
+	settings << "overlay = " << map_config.getOverlay() << std::endl;
+	settings << "texture_blur = " << map_config.getTextureBlur() << std::endl;
+	settings << "water_opacity = " << map_config.getWaterOpacity() << std::endl;
+	settings << "tile_width = " << map_config.getTileWidth() << std::endl;
+	settings << "lighting_intensity = " << map_config.getLightingIntensity() << std::endl;
+	settings << "lighting_water_intensity = " << map_config.getLightingWaterIntensity()
+			<< std::endl;
+	settings << "render_unknown_blocks = " << map_config.renderUnknownBlocks() << std::endl;
+	settings << "render_leaves_transparent = " << map_config.renderLeavesTransparent()
+			<< std::endl;
+	settings << "render_biomes = " << map_config.renderBiomes() << std::endl;
+	settings << "render_block_colors = " << map_config.renderBlockColors() << std::endl;
+	settings << "height_shading = " << map_config.useHeightShading() << std::endl;
+	settings << "render_front_to_back = " << map_config.renderFrontToBack() << std::endl;
+	settings << getWorldCropSettings(world_config);
+	return settings.str();
+}
+
+/**
+ * Returns the key of a world rotation in the chunk cache shared by the processes, the
+ * hash of the directory of the world and the settings which change the loaded chunks.
+ */
+uint64_t getSharedMemoryChunkCacheKey(const config::WorldSection& world_config,
+		int rotation) {
+	std::ostringstream settings;
+	settings << "version = " << SHARED_MEMORY_CHUNK_CACHE_VERSION << std::endl;
+	settings << "input_dir = " << world_config.getInputDir().string() << std::endl;
+	settings << "rotation = " << rotation << std::endl;
+	settings << getWorldCropSettings(world_config);
+	return TileCache::hashSettings(settings.str());
+}
+
+/**
+ * Recompresses the tiles of a tile store which were written before stable_time and not
+ * checked yet. Returns the count of replaced tiles and the saved bytes.
+ */
+void optimizeStore(TileStore& store, int depth, int threads, std::time_t stable_time,
+		std::time_t stop_time, int& replaced_tiles, uint64_t& saved_bytes) {
+	fs::path index_file = store.getOutputDir() / TILES_OPTIMIZED_FILE;
+	TileHashIndex checked, checked_now;
+	checked.read(index_file.string());
+
+	// the checked tiles which weren't written again stay checked
+	std::vector<std::pair<TilePath, std::time_t> > tiles;
+	for (int d = 0; d <= depth; d++) {
+		store.getModificationTimes(d, [&](const TilePath& tile, std::time_t time) {
+			uint64_t checked_time;
+			if (checked.find(tile, checked_time) && checked_time == (uint64_t) time)
+				checked_now.update(tile, checked_time);
+			else if (time <= stable_time)
+				tiles.push_back(std::make_pair(tile, time));
+		});
+	}
+	LOG(INFO) << tiles.size() << " tiles need to be checked.";
+
+	// the load average includes the threads of the recompression, the machine is busy if
+	// the other processes keep all CPUs busy
+	double busy_load = std::max(1u, thread_ns::thread::hardware_concurrency()) + threads;
+	std::atomic<size_t> next(0);
+	std::atomic<int> replaced(0);
+	std::atomic<uint64_t> saved(0);
+	util::LogOutputProgressHandler progress;
+	progress.setMax(tiles.size());
+	thread_ns::mutex mutex;
+
+	auto optimize = [&]() {
+		std::string data, recompressed;
+		size_t i;
+		while ((stop_time == 0 || std::time(nullptr) < stop_time)
+				&& (i = next++) < tiles.size()) {
+			while (util::getLoadAverage() > busy_load
+					&& (stop_time == 0 || std::time(nullptr) < stop_time))
+				std::this_thread::sleep_for(std::chrono::seconds(OPTIMIZE_BUSY_WAIT));
+			// the tile might have been written again in the meantime
+			const TilePath& tile = tiles[i].first;
+			std::time_t time;
+			if (!store.getModificationTime(tile, time) || time != tiles[i].second
+					|| !store.read(tile, data))
+				continue;
+			// tiles which are hardlinks of other tiles are not replaced
+			if (TileWriter::recompressPNG(data, recompressed)
+					&& store.replace(tile, recompressed, time)) {
+				replaced++;
+				saved += data.size() - recompressed.size();
+			}
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			checked_now.update(tile, time);
+			progress.setValue(progress.getValue() + 1);
+		}
+	};
+	std::vector<thread_ns::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.push_back(thread_ns::thread(optimize));
+	optimize();
+	for (auto it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+
+	store.flush();
+	if (!checked_now.write(index_file.string()))
+		LOG(WARNING) << "Unable to write '" << index_file.string() << "'.";
+	replaced_tiles = replaced;
+	saved_bytes = saved;
+}
+
+/**
+ * Calls a function for the indices 0 to count-1 with the specified count of threads and
+ * shows the progress.
+ */
+void forEachParallel(size_t count, int threads, const std::function<void(size_t)>& function) {
+	std::atomic<size_t> next(0);
+	util::LogOutputProgressHandler progress;
+	progress.setMax(count);
+	thread_ns::mutex mutex;
+
+	auto work = [&]() {
+		size_t i;
+		while ((i = next++) < count) {
+			function(i);
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			progress.setValue(progress.getValue() + 1);
+		}
+	};
+	std::vector<thread_ns::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.push_back(thread_ns::thread(work));
+	work();
+	for (auto it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+}
+
+/**
+ * Composes the composite tiles of a map rotation again of the render tiles in the store,
+ * one zoom level after another up to the base tile. The tiles of a zoom level are
+ * composed in parallel, of the thumbnails of their child tiles if there are some.
+ * Returns the count of composed tiles.
+ */
+size_t recomposeStore(TileWriter& writer, TileHashIndex* tile_hashes, int depth,
+		int tile_size, int threads) {
+	std::set<TilePath> children;
+	writer.getStore().getModificationTimes(depth,
+			[&](const TilePath& tile, std::time_t) { children.insert(tile); });
+	LOG(INFO) << "Composing the tiles of " << children.size() << " render tiles.";
+
+	size_t composed = 0;
+	for (int d = depth - 1; d >= 0; d--) {
+		std::set<TilePath> parents;
+		for (auto it = children.begin(); it != children.end(); ++it)
+			parents.insert(it->parent());
+		std::vector<TilePath> tiles(parents.begin(), parents.end());
+		// the composed tiles must be written again, even if their hashes didn't change
+		if (tile_hashes != nullptr)
+			for (auto it = tiles.begin(); it != tiles.end(); ++it)
+				tile_hashes->remove(*it);
+
+		forEachParallel(tiles.size(), threads, [&](size_t i) {
+			RGBAImage image(tile_size, tile_size), child_image;
+			for (int node = 1; node <= 4; node++) {
+				TilePath child = tiles[i] + node;
+				if (!children.count(child))
+					continue;
+				if (writer.readThumbnail(child, child_image)
+						&& child_image.getWidth() == tile_size / 2
+						&& child_image.getHeight() == tile_size / 2) {
+					int x = (node == 2 || node == 4) ? tile_size / 2 : 0;
+					int y = (node == 3 || node == 4) ? tile_size / 2 : 0;
+					image.simpleBlit(child_image, x, y);
+				} else if (writer.readImage(child, child_image)) {
+					TileRenderWorker::blitChildTile(node, child_image, image);
+				} else {
+					LOG(WARNING) << "Unable to read tile " << child.toString() << ".";
+				}
+			}
+			writer.write(tiles[i], image, true);
+		});
+		composed += tiles.size();
+		children.swap(parents);
+	}
+	return composed;
+}
+
+/**
+ * Encodes the tiles of a map rotation in the source store (encoded with the specified
+ * image format) again with the image format of the writer. The tiles keep their
+ * modification times, so the incremental renderings don't consider them changed. Returns
+ * the count of encoded tiles.
+ */
+size_t reencodeStore(TileWriter& writer, TileStore& source, config::ImageFormat format,
+		TileHashIndex* tile_hashes, int depth, int threads) {
+	std::vector<std::pair<TilePath, std::time_t> > tiles;
+	for (int d = 0; d <= depth; d++)
+		source.getModificationTimes(d, [&](const TilePath& tile, std::time_t time) {
+			tiles.push_back(std::make_pair(tile, time));
+		});
+	LOG(INFO) << tiles.size() << " tiles need to be encoded.";
+	if (tile_hashes != nullptr)
+		for (auto it = tiles.begin(); it != tiles.end(); ++it)
+			tile_hashes->remove(it->first);
+
+	std::atomic<size_t> encoded(0);
+	forEachParallel(tiles.size(), threads, [&](size_t i) {
+		const TilePath& tile = tiles[i].first;
+		std::string data;
+		RGBAImage image;
+		// the tiles are decoded accurately, they are not only resized
+		if (!source.read(tile, data)
+				|| !TileWriter::decodeImage(data, image, format, false)) {
+			LOG(WARNING) << "Unable to read tile " << tile.toString() << ".";
+			return;
+		}
+		writer.write(tile, image, tile.getDepth() < depth, tiles[i].second);
+		encoded++;
+	});
+	return encoded;
+}
+
+/**
+ * Creates the tile stores of the additional outputs of a map rotation.
+ */
+std::vector<std::shared_ptr<TileStore> > createOutputStores(
+		const config::MapSection& map_config, const fs::path& output_dir) {
+	std::vector<std::shared_ptr<TileStore> > stores;
+	const std::vector<config::TileOutput>& outputs = map_config.getAdditionalOutputs();
+	for (auto it = outputs.begin(); it != outputs.end(); ++it)
+		stores.push_back(createTileStore(map_config, output_dir / OUTPUTS_DIR / it->name,
+				it->getImageFormatSuffix()));
+	return stores;
+}
+
 void parseRenderBehaviorMaps(const std::vector<std::string>& maps,
 		RenderBehavior behavior, RenderBehaviors& behaviors,
 		const config::MapcrafterConfig& config) {
@@ -122,6 +477,154 @@ void parseRenderBehaviorMaps(const std::vector<std::string>& maps,
 	}
 }
 
+/**
+ * Returns whether a tile is the tile itself or one of its children (or their children).
+ */
+bool isTileContained(const TilePath& tile, const TilePath& child) {
+	int depth = tile.getDepth();
+	if (child.getDepth() < depth)
+		return false;
+	// the paths are the same up to the zoom level of the tile
+	return depth == 0 || (tile.getKey() >> (64 - 2 * depth))
+			== (child.getKey() >> (64 - 2 * depth));
+}
+
+/**
+ * Removes the required render tiles of a tile set whose chunks (and their neighbor
+ * chunks) have still the same content hashes as in the chunk hash index of the last
+ * rendering, and updates the index with the hashes of the chunks of the other required
+ * tiles. Tiles without a rendered image are always required.
+ */
+void filterUnchangedTiles(TileSet* tile_set, const mc::World& world, TileStore& store,
+		mc::ChunkHashIndex& chunk_hashes) {
+	mc::WorldCache world_cache(world);
+	// whether a chunk has changed, every chunk is hashed only once
+	std::map<mc::ChunkPos, bool> chunks_changed;
+	auto isChunkChanged = [&](const mc::ChunkPos& pos) {
+		auto it = chunks_changed.find(pos);
+		if (it != chunks_changed.end())
+			return it->second;
+		const mc::Chunk* chunk = world_cache.getChunk(pos);
+		uint64_t old_hash;
+		bool indexed = chunk_hashes.find(pos, old_hash);
+		bool changed;
+		if (chunk == nullptr) {
+			// chunks which do not exist anymore have changed if they existed before
+			changed = indexed;
+			chunk_hashes.remove(pos);
+		} else {
+			uint64_t hash = chunk->getContentHash();
+			changed = !indexed || hash != old_hash;
+			chunk_hashes.update(pos, hash);
+		}
+		chunks_changed[pos] = changed;
+		return changed;
+	};
+
+	int depth = tile_set->getDepth();
+	tile_set->filterRequired([&](const TilePos& tile) {
+		// the blocks at the borders of the chunks depend on the neighbor chunks too
+		// (hidden faces, lighting), so check the chunks of the tile with their neighbors,
+		// all of them to update the hashes of all of them
+		std::set<mc::ChunkPos> chunks, neighbors;
+		tile_set->mapTileToChunks(tile + tile_set->getTileOffset(), chunks);
+		for (auto it = chunks.begin(); it != chunks.end(); ++it)
+			for (int dx = -1; dx <= 1; dx++)
+				for (int dz = -1; dz <= 1; dz++)
+					neighbors.insert(mc::ChunkPos(it->x + dx, it->z + dz));
+		bool changed = false;
+		for (auto it = neighbors.begin(); it != neighbors.end(); ++it)
+			if (isChunkChanged(*it))
+				changed = true;
+		return changed || !store.exists(TilePath::byTilePos(tile, depth));
+	});
+}
+
+/**
+ * Saves the zoom level of the moved tiles of a map rotation and whether its top tiles
+ * are written already while increasing the max zoom level.
+ */
+bool writeIncreaseZoomProgress(const fs::path& file, int depth, bool composed) {
+	fs::path tmp_file = file.string() + ".tmp";
+	{
+		std::ofstream out(tmp_file.string().c_str());
+		out << depth << " " << (composed ? 1 : 0) << std::endl;
+		if (!out)
+			return false;
+	}
+	boost::system::error_code error;
+	fs::rename(tmp_file, file, error);
+	return !error;
+}
+
+std::string formatCacheStats(const mc::CacheStats& stats, bool chunks) {
+	uint64_t accesses = stats.hits + stats.shared_hits + stats.rotation_hits
+			+ stats.compressed_hits + stats.shared_memory_hits + stats.misses
+			+ stats.region_not_found + stats.not_found;
+	std::stringstream ss;
+	ss << stats.hits << " hits";
+	if (accesses > 0)
+		ss << " (" << std::fixed << std::setprecision(2) << 100.0 * stats.hits / accesses << "%)";
+	if (chunks)
+		ss << ", " << stats.shared_hits << " shared hits, " << stats.rotation_hits
+			<< " rotation hits, " << stats.compressed_hits << " compressed hits, "
+			<< stats.shared_memory_hits << " shared memory hits";
+	ss << ", " << stats.misses << " misses, " << stats.not_found << " not found";
+	if (chunks)
+		ss << ", " << stats.region_not_found << " without region";
+	ss << ", " << stats.invalid << " invalid";
+	if (chunks)
+		ss << ", " << std::fixed << std::setprecision(2) << stats.decode_time
+			<< "s decoding";
+	return ss.str();
+}
+
+std::string formatProfileTimes(const util::ProfileTimes& times) {
+	std::vector<std::pair<double, int> > stages;
+	for (int i = 0; i < (int) util::ProfileStage::COUNT; i++)
+		if (times.calls[i] > 0)
+			stages.push_back(std::make_pair(times.seconds[i], i));
+	std::sort(stages.rbegin(), stages.rend());
+
+	double total = times.getTotal();
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2) << total << "s";
+	for (auto it = stages.begin(); it != stages.end(); ++it) {
+		ss << (it == stages.begin() ? ": " : ", ")
+			<< util::getProfileStageName((util::ProfileStage) it->second) << " "
+			<< std::setprecision(2) << it->first << "s";
+		if (total > 0)
+			ss << " (" << std::setprecision(1) << 100.0 * it->first / total << "%)";
+	}
+	return ss.str();
+}
+
+picojson::value profileTimesToJSON(const util::ProfileTimes& times) {
+	picojson::object json;
+	for (int i = 0; i < (int) util::ProfileStage::COUNT; i++) {
+		picojson::object stage;
+		stage["seconds"] = picojson::value(times.seconds[i]);
+		stage["calls"] = picojson::value((double) times.calls[i]);
+		json[util::getProfileStageKey((util::ProfileStage) i)] = picojson::value(stage);
+	}
+	return picojson::value(json);
+}
+
+picojson::value cacheStatsToJSON(const mc::CacheStats& stats) {
+	picojson::object json;
+	json["hits"] = picojson::value((double) stats.hits);
+	json["sharedHits"] = picojson::value((double) stats.shared_hits);
+	json["rotationHits"] = picojson::value((double) stats.rotation_hits);
+	json["compressedHits"] = picojson::value((double) stats.compressed_hits);
+	json["sharedMemoryHits"] = picojson::value((double) stats.shared_memory_hits);
+	json["misses"] = picojson::value((double) stats.misses);
+	json["regionNotFound"] = picojson::value((double) stats.region_not_found);
+	json["notFound"] = picojson::value((double) stats.not_found);
+	json["invalid"] = picojson::value((double) stats.invalid);
+	json["decodeTime"] = picojson::value(stats.decode_time);
+	return picojson::value(json);
+}
+
 }
 
 RenderBehaviors RenderBehaviors::fromRenderOpts(
@@ -140,13 +643,145 @@ RenderBehaviors RenderBehaviors::fromRenderOpts(
 }
 
 RenderManager::RenderManager(const config::MapcrafterConfig& config)
-	: config(config), web_config(config), time_started_scanning(0) {
+	: config(config), web_config(config), shard(0), shards(1), merge_shards(false),
+	  concurrent_renders(1), single_pass(false), memory_limit(0), pin_threads(false),
+	  max_time(0), stop_time(0), stop_flag(nullptr), stopped(false), use_changed_chunks(false),
+	  shared_thread_pool(false), time_started_scanning(0),
+	  shared_memory_chunk_cache_failed(false),
+	  resource_registry(std::make_shared<ResourceRegistry>()), metrics_interval(10),
+	  dry_run(false), on_demand(false),
+	  on_demand_threads(1) {
 }
 
 void RenderManager::setRenderBehaviors(const RenderBehaviors& render_behaviors) {
 	this->render_behaviors = render_behaviors;
 }
 
+void RenderManager::setCacheStatsFile(const fs::path& cache_stats_file) {
+	this->cache_stats_file = cache_stats_file;
+}
+
+void RenderManager::setProfileFile(const fs::path& profile_file) {
+	this->profile_file = profile_file;
+	if (!util::Profiler::setEnabled(!profile_file.empty()))
+		LOG(WARNING) << "Profiling is not supported by this build of Mapcrafter.";
+	util::Profiler::setThreadName("main");
+}
+
+void RenderManager::setBlockProfileFile(const fs::path& block_profile_file,
+		int sampling) {
+	this->block_profile_file = block_profile_file;
+	if (!BlockProfiler::setSampling(block_profile_file.empty() ? 0 : sampling))
+		LOG(WARNING) << "Block profiling is not supported by this build of Mapcrafter.";
+}
+
+void RenderManager::setTraceFile(const fs::path& trace_file) {
+	this->trace_file = trace_file;
+	if (!util::Profiler::setTracing(!trace_file.empty()))
+		LOG(WARNING) << "Tracing is not supported by this build of Mapcrafter.";
+	util::Profiler::setThreadName("main");
+}
+
+void RenderManager::setMetricsFile(const fs::path& metrics_file, int interval) {
+	this->metrics_file = metrics_file;
+	this->metrics_interval = interval;
+	if (!util::Profiler::setMetrics(!metrics_file.empty()))
+		LOG(WARNING) << "Metrics are not supported by this build of Mapcrafter.";
+	util::Profiler::setThreadName("main");
+}
+
+void RenderManager::setSlowTileTime(double slow_tile_time) {
+	if (slow_tile_time > 0)
+		slow_tiles = std::make_shared<SlowTileLog>(slow_tile_time);
+	else
+		slow_tiles.reset();
+}
+
+void RenderManager::setShard(int shard, int shards) {
+	this->shard = shard;
+	this->shards = shards;
+}
+
+void RenderManager::setMergeShards(bool merge_shards) {
+	this->merge_shards = merge_shards;
+}
+
+void RenderManager::setConcurrentRenders(int concurrent_renders) {
+	this->concurrent_renders = concurrent_renders;
+}
+
+void RenderManager::setSinglePass(bool single_pass) {
+	this->single_pass = single_pass;
+}
+
+void RenderManager::setMemoryLimit(size_t memory_limit) {
+	this->memory_limit = memory_limit;
+}
+
+void RenderManager::setPinThreads(bool pin_threads) {
+	this->pin_threads = pin_threads;
+}
+
+void RenderManager::setMaxTime(int max_time) {
+	this->max_time = max_time;
+}
+
+void RenderManager::setChangedChunks(
+		const std::map<std::string, std::set<mc::ChunkPos> >& changed_chunks) {
+	for (auto it = changed_chunks.begin(); it != changed_chunks.end(); ++it)
+		if (!config.hasWorld(it->first))
+			LOG(WARNING) << "Changed chunks of unknown world '" << it->first << "'.";
+	this->changed_chunks = changed_chunks;
+	use_changed_chunks = true;
+}
+
+bool RenderManager::readChangedChunks(const fs::path& file,
+		std::map<std::string, std::set<mc::ChunkPos> >& changed_chunks) {
+	std::ifstream in(file.string().c_str());
+	if (!in) {
+		LOG(ERROR) << "Unable to read the changed chunks file '" << file.string() << "'!";
+		return false;
+	}
+	std::string line;
+	for (int number = 1; std::getline(in, line); number++) {
+		line = util::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ss(line);
+		std::string world, rest;
+		mc::ChunkPos chunk;
+		if (!(ss >> world >> chunk.x >> chunk.z) || (ss >> rest)) {
+			LOG(ERROR) << "Invalid line " << number << " in the changed chunks file '"
+					<< file.string() << "': " << line;
+			return false;
+		}
+		changed_chunks[world].insert(chunk);
+	}
+	return true;
+}
+
+void RenderManager::setRequestedTiles(const std::set<TilePath>& requested_tiles) {
+	this->requested_tiles = requested_tiles;
+}
+
+void RenderManager::setStopFlag(const std::atomic<bool>* stop_flag) {
+	this->stop_flag = stop_flag;
+}
+
+void RenderManager::setTileCallback(TileCallback tile_callback) {
+	this->tile_callback = tile_callback;
+}
+
+void RenderManager::setThreadPool(std::shared_ptr<thread::ThreadPool> thread_pool) {
+	this->thread_pool = thread_pool;
+	shared_thread_pool = thread_pool != nullptr;
+}
+
+void RenderManager::setResourceRegistry(
+		std::shared_ptr<ResourceRegistry> resource_registry) {
+	this->resource_registry = resource_registry;
+}
+
 bool RenderManager::initialize() {
 	// an output directory would be nice -- create one if it does not exist
 	if (!fs::is_directory(config.getOutputDir()) && !fs::create_directories(config.getOutputDir())) {
@@ -158,11 +793,19 @@ bool RenderManager::initialize() {
 	return web_config.readConfigJS();
 }
 
-bool RenderManager::scanWorlds() {
+bool RenderManager::scanWorlds(int threads) {
 	auto config_worlds = config.getWorlds();
 	auto config_maps = config.getMaps();
 
 	time_started_scanning = std::time(nullptr);
+	// everything of a previous scan is scanned again, the worlds may have changed
+	worlds.clear();
+	tile_sets.clear();
+	unrotated_chunk_caches.clear();
+	compressed_chunk_caches.clear();
+	sign_collectors.clear();
+	required_maps.clear();
+	map_initialized.clear();
 
 	// first of all check which maps/rotations are required
 	// and which tile sets (world, render view, tile width) with which rotations are needed
@@ -195,6 +838,14 @@ bool RenderManager::scanWorlds() {
 	// store the maximum max zoom level of every tile set with its rotations
 	std::map<config::TileSetGroupID, int> tile_sets_max_zoom;
 
+	// the headers of the region files from the last scan,
+	// only the modified region files are read again
+	// the index remembers the broken regions and chunks for the render threads as well
+	region_index = std::make_shared<mc::RegionIndex>();
+	std::string region_index_file = config.getOutputPath(REGION_INDEX_FILE).string();
+	if (region_index->read(region_index_file))
+		LOG(DEBUG) << "Read region index with " << region_index->size() << " regions.";
+
 	// iterate through all tile sets that are needed
 	for (auto tile_set_it = needed_tile_sets.begin();
 			tile_set_it != needed_tile_sets.end(); ++tile_set_it) {
@@ -204,6 +855,8 @@ bool RenderManager::scanWorlds() {
 		// load the world
 		mc::World world(world_config.getInputDir().string(),
 				world_config.getDimension());
+		world.setCacheDir(world_config.getRemoteCacheDir());
+		world.setSnapshotDir(world_config.getSnapshotDir());
 		world.setRotation(tile_set_it->rotation);
 		world.setWorldCrop(world_config.getWorldCrop());
 		if (!world.load()) {
@@ -213,16 +866,26 @@ bool RenderManager::scanWorlds() {
 
 		// create a tile set for this world
 		std::shared_ptr<TileSet> tile_set(render_view->createTileSet(tile_set_it->tile_width));
+		tile_set->setIndexKey(tile_set_it->toString());
+		// a shard keeps only the tiles of its own subtrees, the merge only the tiles
+		// above the shards, so huge worlds are rendered with bounded memory
+		if (shards > 1 || merge_shards) {
+			int shard_index = shard, shard_count = shards;
+			bool merge = merge_shards;
+			tile_set->setSubtreeFilter(SHARD_LEVELS, [=](const TilePath& tile) {
+				return !merge && getShard(tile, shard_count) == shard_index;
+			});
+		}
 		// and scan the tiles of this world,
 		// we automatically center the tiles for cropped worlds, but only...
 		//  - the circular cropped ones and
 		//  - the ones with completely specified x- AND z-bounds
 		if (world_config.needsWorldCentering()) {
 			TilePos tile_offset;
-			tile_set->scan(world, true, tile_offset);
+			tile_set->scan(world, true, tile_offset, region_index.get(), threads);
 			web_config.setTileSetTileOffset(*tile_set_it, tile_offset);
 		} else {
-			tile_set->scan(world);
+			tile_set->scan(world, region_index.get(), threads);
 		}
 
 		// key of this tile_sets_max_zoom map is a TileSetGroupID, not TileSetID as we access it
@@ -239,6 +902,11 @@ bool RenderManager::scanWorlds() {
 		delete render_view;
 	}
 
+	// regions of worlds which were not scanned this time are dropped from the index,
+	// the shards leave the index to the merge
+	if (shards == 1 && !dry_run && !region_index->write(region_index_file))
+		LOG(WARNING) << "Unable to write region index file " << region_index_file << "!";
+
 	// set calculated max zoom of tile sets
 	for (auto tile_set_it = needed_tile_sets.begin();
 			tile_set_it != needed_tile_sets.end(); ++tile_set_it) {
@@ -246,31 +914,155 @@ bool RenderManager::scanWorlds() {
 		int max_zoom = tile_sets_max_zoom[*tile_set_it];
 		tile_sets[*tile_set_it]->setDepth(max_zoom);
 		web_config.setTileSetsMaxZoom(*tile_set_it, max_zoom);
+		// the tiles of the subtrees depend on the zoom level
+		if (shards > 1 || merge_shards)
+			tile_sets[*tile_set_it]->scanSubtrees(
+					worlds[tile_set_it->world_name][tile_set_it->rotation],
+					region_index.get(), threads);
 	}
 
-	writeTemplates();
+	if (shards == 1 && !dry_run)
+		writeTemplates();
 	return true;
 }
 
 void RenderManager::renderMap(const std::string& map, int rotation, int threads,
 		util::IProgressHandler* progress) {
+	renderMaps(std::vector<std::string>(1, map), rotation, threads, progress);
+}
+
+void RenderManager::renderMaps(const std::vector<std::string>& maps, int rotation,
+		int threads, util::IProgressHandler* progress) {
+	if (isStopped()) {
+		LOG(INFO) << "The rendering is stopped, the map is rendered by the next run.";
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		stopped = true;
+		return;
+	}
+
+	std::vector<MapRendering> renderings;
+	for (auto it = maps.begin(); it != maps.end(); ++it) {
+		MapRendering rendering;
+		if (prepareMap(*it, rotation, threads, rendering))
+			renderings.push_back(rendering);
+	}
+
+	// the maps with the same required tiles are rendered together, the threads render
+	// every job for all of these maps one after another, so the chunks are read and
+	// decoded only once for all maps
+	std::vector<bool> rendered(renderings.size(), false);
+	for (size_t i = 0; i < renderings.size(); i++) {
+		if (rendered[i])
+			continue;
+		std::vector<size_t> group;
+		std::vector<RenderContext> contexts;
+		for (size_t j = i; j < renderings.size(); j++) {
+			if (rendered[j] || renderings[j].required_tiles != renderings[i].required_tiles
+					|| renderings[j].required_composite_tiles
+						!= renderings[i].required_composite_tiles)
+				continue;
+			rendered[j] = true;
+			group.push_back(j);
+			contexts.push_back(renderings[j].context);
+		}
+
+		// each map scanned the required tiles of the shared tile set again
+		TileSet* tile_set = renderings[i].context.tile_set;
+		if (renderings.size() > 1) {
+			tile_set->setRequired(renderings[i].required_tiles,
+					renderings[i].required_composite_tiles);
+			if (group.size() > 1)
+				LOG(INFO) << "Rendering " << group.size() << " maps in one pass.";
+		}
+
+		// the composite tiles above the shards are rendered by one thread, and the
+		// maps rendered together are split into jobs to share the decoded chunks, as
+		// are the maps with a time limit to be able to stop between the jobs
+		std::shared_ptr<thread::Dispatcher> dispatcher;
+		if (merge_shards || (group.size() == 1 && ((threads == 1 && stop_time == 0
+				&& stop_flag == nullptr)
+				|| tile_set->getRequiredRenderTilesCount() == 1)))
+			dispatcher = std::make_shared<thread::SingleThreadDispatcher>();
+		else
+			dispatcher = std::make_shared<thread::MultiThreadingDispatcher>(threads,
+					thread_pool.get());
+		dispatcher->setRenderWork(renderings[i].render_work);
+		// the concurrent renders share the memory
+		dispatcher->setMemoryLimit(memory_limit / concurrent_renders);
+		dispatcher->setPinThreads(pin_threads);
+		dispatcher->setStopTime(stop_time);
+		dispatcher->setStopFlag(stop_flag);
+
+		std::map<std::string, util::ProfileTimes> profile_times;
+		if (util::Profiler::isEnabled())
+			profile_times = util::Profiler::getThreadTimes();
+
+		// the maps rendered completely get a coarse preview first, the other progressive
+		// maps a sample of their render tiles with provisional composite tiles
+		bool preview = false;
+		for (size_t j = 0; j < group.size(); j++)
+			preview = renderPreview(renderings[group[j]], threads, progress) || preview;
+		if (!preview)
+			renderProgressive(renderings[i], contexts, threads, progress);
+
+		// do the dance
+		dispatcher->dispatch(contexts, progress);
+		std::vector<std::string> group_maps;
+		for (size_t j = 0; j < group.size(); j++) {
+			finishMap(renderings[group[j]], dispatcher->getRegionCacheStats(j),
+					dispatcher->getChunkCacheStats(j), dispatcher->isComplete());
+			group_maps.push_back(renderings[group[j]].map);
+		}
+		if (util::Profiler::isEnabled())
+			addProfile(group_maps, rotation, profile_times);
+	}
+}
+
+bool RenderManager::prepareMap(const std::string& map, int rotation, int threads,
+		MapRendering& rendering) {
 	// make sure this map/rotation actually exists and should be rendered
 	if (!config.hasMap(map) || !config.getMap(map).getRotations().count(rotation)
 			|| render_behaviors.getRenderBehavior(map, rotation) == RenderBehavior::SKIP)
-		return;
+		return false;
+
+	config::MapSection map_config = config.getMap(map);
+	rendering.map = map;
+	rendering.rotation = rotation;
+
+	// the web config (and the other things shared between the maps) is used by multiple
+	// renders if maps are rendered concurrently
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+
+	// the shards would write to the same bundles
+	if ((shards > 1 || merge_shards)
+			&& map_config.getTileStore() == config::TileStoreType::PACK) {
+		LOG(ERROR) << "Map " << map << " uses the pack tile store, "
+				<< "which can't be rendered with shards.";
+		return false;
+	}
 
-	// do some initialization stuff for every map once
-	if (!map_initialized.count(map)) {
-		initializeMap(map);
+	// do some initialization stuff for every map once, the shards can't move the tiles
+	// around if the max zoom level increased without interfering with each other
+	if (shards > 1) {
+		int max_zoom = web_config.getTileSetsMaxZoom(map_config.getTileSetGroup());
+		int old_max_zoom = web_config.getMapMaxZoom(map);
+		if (old_max_zoom != 0 && old_max_zoom < max_zoom) {
+			LOG(ERROR) << "The max zoom level of map " << map << " was increased, "
+					<< "you have to render it without shards once.";
+			return false;
+		}
+	} else if (!map_initialized.count(map)) {
+		if (!initializeMap(map))
+			return false;
 		map_initialized.insert(map);
 	}
 
-	config::MapSection map_config = config.getMap(map);
 	config::WorldSection world_config = config.getWorld(map_config.getWorld());
-	std::shared_ptr<RenderView> render_view(createRenderView(map_config.getRenderView()));
+	rendering.render_view.reset(createRenderView(map_config.getRenderView()));
 
 	// output a small notice if we render this map incrementally
 	int last_rendered = web_config.getMapLastRendered(map, rotation);
+	lock.unlock();
 	if (last_rendered != 0) {
 		std::time_t t = last_rendered;
 		char buffer[256];
@@ -279,73 +1071,619 @@ void RenderManager::renderMap(const std::string& map, int rotation, int threads,
 	}
 
 	fs::path output_dir = config.getOutputPath(map + "/" + config::ROTATION_NAMES_SHORT[rotation]);
+	rendering.tile_store = createTileStore(map_config, output_dir);
+	TileStore& tile_store = *rendering.tile_store;
 	// get the tile set
 	TileSet* tile_set = tile_sets[map_config.getTileSet(rotation)].get();
-	if (render_behaviors.getRenderBehavior(map, rotation) == RenderBehavior::AUTO) {
-		// if incremental render, scan which tiles might have changed
-		LOG(INFO) << "Scanning required tiles...";
-		// use the incremental check method specified in the config
-		if (map_config.useImageModificationTimes())
-			tile_set->scanRequiredByFiletimes(output_dir, map_config.getImageFormatSuffix());
-		else
-			//tile_set->scanRequiredByTimestamp(settings.last_render[rotation]);
-			tile_set->scanRequiredByTimestamp(web_config.getMapLastRendered(map, rotation));
-	} else {
-		// or just set all tiles required if force-rendering
-		tile_set->resetRequired();
+	scanRequiredTiles(rendering, last_rendered);
+	if (render_behaviors.getRenderBehavior(map, rotation) != RenderBehavior::AUTO) {
+		// the chunk hashes are not updated when force-rendering, they are outdated then
+		fs::remove(output_dir / "chunkhashes.dat");
+		fs::remove(output_dir / JOURNAL_FILE);
 	}
 
-	// maybe we don't have to render anything at all
-	if (tile_set->getRequiredRenderTilesCount() == 0) {
+	// the shards are made of the tiles some zoom levels above the render tiles, every
+	// shard renders about every n-th of them if required. They don't depend on the
+	// required tiles, because the shards change which tiles are required if the
+	// modification times of the tiles are used
+	std::vector<RenderWork>& render_work = rendering.render_work;
+	if (shards > 1 || merge_shards) {
+		std::set<TilePath> shard_tiles = tile_set->getTiles(
+				std::max(0, tile_set->getDepth() - SHARD_LEVELS));
+		if (merge_shards) {
+			// all composite tiles above the shards are rendered again
+			tile_set->resetRequired();
+			RenderWork work;
+			work.tiles.insert(TilePath());
+			work.tiles_skip = shard_tiles;
+			render_work.push_back(work);
+		} else {
+			for (auto it = shard_tiles.begin(); it != shard_tiles.end(); ++it) {
+				if (getShard(*it, shards) != shard || !tile_set->isTileRequired(*it))
+					continue;
+				RenderWork work;
+				work.tiles.insert(*it);
+				render_work.push_back(work);
+			}
+			if (render_work.empty()) {
+				LOG(INFO) << "No tiles of this shard need to get rendered.";
+				return false;
+			}
+		}
+	}
+
+	// maybe we don't have to render anything at all, the composite tiles of an
+	// interrupted rendering might be required without their render tiles
+	if (tile_set->getRequiredRenderTilesCount() == 0
+			&& tile_set->getRequiredCompositeTilesCount() == 0) {
 		LOG(INFO) << "No tiles need to get rendered.";
-		return;
+		return false;
 	}
+	rendering.required_tiles = tile_set->getRequiredRenderTiles();
+	rendering.required_composite_tiles = tile_set->getRequiredCompositeTiles();
 
 	// create block images
-	TextureResources resources;
+	lock.lock();
+	rendering.textures = getTextures(map_config, threads);
+	lock.unlock();
 	// if textures do not work, it does not make much sense
 	// to try the other rotations with the same broken textures
-	if (!resources.loadTextures(map_config.getTextureDir().string(),
-			map_config.getTextureSize(), map_config.getTextureBlur(),
-			map_config.getWaterOpacity())) {
+	if (!rendering.textures) {
 		LOG(ERROR) << "Skipping remaining rotations.";
-		return;
+		return false;
 	}
+	const TextureResources& resources = *rendering.textures;
 
-	// create other stuff for the render dispatcher
-	std::shared_ptr<BlockImages> block_images(render_view->createBlockImages());
-	render_view->configureBlockImages(block_images.get(), world_config, map_config);
+	// create other stuff for the render dispatcher, the block images are shared with
+	// the other maps with the same textures and options
+	std::shared_ptr<BlockImages> block_images(rendering.render_view->createBlockImages());
+	rendering.render_view->configureBlockImages(block_images.get(), world_config, map_config);
 	block_images->setRotation(rotation);
-	block_images->generateBlocks(resources);
+	block_images = resource_registry->getBlockImages(block_images->getKey(resources),
+			[&]() {
+		// the block images of the last rendering can be reused if the textures and the
+		// options didn't change
+		std::string block_images_cache = (output_dir / "blockimages.dat").string();
+		if (!map_config.cacheBlockImages()
+				|| !block_images->readBlocks(resources, block_images_cache)) {
+			block_images->generateBlocks(resources, threads);
+			if (map_config.cacheBlockImages() && shards == 1) {
+				boost::system::error_code error;
+				fs::create_directories(output_dir, error);
+				if (!block_images->writeBlocks(block_images_cache))
+					LOG(WARNING) << "Unable to write the block images cache.";
+			}
+		}
+		return block_images;
+	});
+	rendering.block_images = block_images;
 
-	RenderContext context;
+	RenderContext& context = rendering.context;
 	context.output_dir = output_dir;
 	context.background_color = config.getBackgroundColor();
 	context.world_config = config.getWorld(map_config.getWorld());
 	context.map_config = map_config;
-	context.render_view = render_view.get();
+	context.render_view = rendering.render_view.get();
 	context.block_images = block_images.get();
 	context.tile_set = tile_set;
 	context.world = worlds[map_config.getWorld()][rotation];
+	context.tile_writer = std::make_shared<TileWriter>(map_config,
+			context.background_color, map_config.getWriteThreads(), rendering.tile_store);
+	// the render tiles are rendered partially onto their previous images, if the tiles
+	// required by the chunk timestamps are rendered and the images are stored lossless
+	config::ImageFormat image_format = map_config.getImageFormat();
+	bool lossless = (image_format == config::ImageFormat::PNG && !map_config.isPNGIndexed())
+			|| (image_format == config::ImageFormat::WEBP && map_config.isWebPLossless());
+	if (map_config.renderTilesPartially() && lossless && last_rendered != 0
+			&& render_behaviors.getRenderBehavior(map, rotation) == RenderBehavior::AUTO
+			&& !map_config.useImageModificationTimes() && !on_demand)
+		context.partial_render_since = last_rendered;
+	// the directories of the tiles are created at once instead of checking them for
+	// every tile, the tiles rendered on demand are only a few
+	if (!dry_run && !on_demand)
+		tile_store.prepare(rendering.required_composite_tiles);
+	// the shards would write to the same journal file
+	if (rendering.journal && shards == 1 && !merge_shards) {
+		boost::system::error_code error;
+		fs::create_directories(output_dir, error);
+		if (rendering.journal->open(output_dir / JOURNAL_FILE, time_started_scanning))
+			tile_store.setJournal(rendering.journal.get());
+		else
+			LOG(WARNING) << "Unable to write the render journal.";
+	}
+	if (tile_callback) {
+		TileCallback callback = tile_callback;
+		tile_store.setWrittenCallback([callback, map, rotation](const TilePath& tile) {
+			callback(map, rotation, tile);
+		});
+	}
+	// the shards would write to the same index file too, and the index of the tiles
+	// rendered on demand would never be written
+	if (map_config.useTileHashes() && shards == 1 && !merge_shards && !on_demand) {
+		fs::path tile_hashes_file = output_dir / TILE_HASHES_FILE;
+		rendering.tile_hashes = std::make_shared<TileHashIndex>();
+		if (render_behaviors.getRenderBehavior(map, rotation) == RenderBehavior::AUTO)
+			rendering.tile_hashes->read(tile_hashes_file.string());
+		// the index doesn't match the tiles anymore if the rendering crashes, it's
+		// written again when the rendering is finished or stopped
+		boost::system::error_code error;
+		fs::remove(tile_hashes_file, error);
+		context.tile_writer->setTileHashes(rendering.tile_hashes.get());
+	}
+	// the render times of the tiles of the last renderings tell the dispatcher how long
+	// the tiles take to render, the render times of the rendered tiles are updated
+	if (map_config.useTileCosts() && shards == 1 && !merge_shards && !on_demand) {
+		context.tile_costs = std::make_shared<TileCostIndex>();
+		context.tile_costs->read((output_dir / TILE_COSTS_FILE).string());
+	}
+	context.slow_tiles = slow_tiles;
+	// the thumbnails are outdated once the tiles are written without them
+	if (map_config.cacheTileThumbnails()) {
+		rendering.thumbnails = createTileStore(map_config, output_dir / THUMBNAILS_DIR,
+				THUMBNAILS_FORMAT);
+		context.tile_writer->setThumbnails(rendering.thumbnails.get());
+	} else {
+		boost::system::error_code error;
+		fs::remove_all(output_dir / THUMBNAILS_DIR, error);
+	}
+	// the additional outputs are encoded from the same images as the tiles
+	const std::vector<config::TileOutput>& outputs = map_config.getAdditionalOutputs();
+	rendering.output_stores = createOutputStores(map_config, output_dir);
+	for (size_t i = 0; i < outputs.size(); i++) {
+		if (!dry_run && !on_demand)
+			rendering.output_stores[i]->prepare(rendering.required_composite_tiles);
+		context.tile_writer->addOutput(outputs[i], rendering.output_stores[i]);
+	}
+	// the shards would write to the same manifest, and the tiles rendered on demand are
+	// served by mapcrafter_server instead
+	if (!map_config.getUploadURL().empty() && !dry_run && !on_demand && shards == 1
+			&& !merge_shards) {
+		rendering.uploader = std::make_shared<TileUploader>(config.getOutputDir(),
+				map_config.getUploadURL(), map_config.getUploadRegion(),
+				S3Credentials::fromEnvironment(), map_config.getUploadThreads(),
+				map_config.getUploadRetries());
+		rendering.uploader->readManifest(output_dir / UPLOAD_MANIFEST_FILE);
+		tile_store.setUploader(rendering.uploader.get());
+		for (size_t i = 0; i < rendering.output_stores.size(); i++)
+			rendering.output_stores[i]->setUploader(rendering.uploader.get());
+	}
+
+	lock.lock();
+	// the rotations of the world share the decoded chunks in the original rotation
+	if (map_config.getRotationChunkCacheSize() > 0) {
+		std::shared_ptr<mc::ChunkCache>& cache = unrotated_chunk_caches[map_config.getWorld()];
+		if (!cache)
+			cache = std::make_shared<mc::ChunkCache>(map_config.getRotationChunkCacheSize());
+		context.unrotated_chunk_cache = cache;
+	}
+	// the size of the compressed chunk cache is in megabytes, the cache of a world and
+	// rotation is created with the size of the first map using it
+	if (map_config.getCompressedChunkCacheSize() > 0) {
+		std::shared_ptr<mc::CompressedChunkCache>& cache = compressed_chunk_caches[
+				std::make_pair(map_config.getWorld(), rotation)];
+		if (!cache)
+			cache = std::make_shared<mc::CompressedChunkCache>(
+					(size_t) map_config.getCompressedChunkCacheSize() * 1024 * 1024);
+		context.compressed_chunk_cache = cache;
+	}
+	// the signs of the decoded chunks are stored in the entities cache of the world
+	// after the rendering
+	if (world_config.collectSigns() && !dry_run && !on_demand) {
+		std::shared_ptr<mc::SignCollector>& collector = sign_collectors[map_config.getWorld()];
+		if (!collector)
+			collector = std::make_shared<mc::SignCollector>();
+		context.sign_collector = collector;
+	}
+	// the chunks decoded by other processes on this host are shared in a segment created
+	// with the size of the first map using it
+	if (map_config.getSharedMemoryChunkCacheSize() > 0) {
+		if (!shared_memory_chunk_cache && !shared_memory_chunk_cache_failed) {
+			try {
+				shared_memory_chunk_cache = std::make_shared<mc::SharedMemoryChunkCache>(
+						SHARED_MEMORY_CHUNK_CACHE,
+						(size_t) map_config.getSharedMemoryChunkCacheSize() * 1024 * 1024);
+			} catch (const std::runtime_error& e) {
+				LOG(WARNING) << e.what() << ". Not sharing the chunks with other processes.";
+				shared_memory_chunk_cache_failed = true;
+			}
+		}
+		context.shared_memory_chunk_cache = shared_memory_chunk_cache;
+		context.shared_memory_world_key = getSharedMemoryChunkCacheKey(world_config,
+				rotation);
+	}
+	context.region_index = region_index;
 	context.initializeTileRenderer();
+	// the geometry of the render tiles doesn't depend on the render mode and the
+	// textures, it's shared between the maps of the same tile set whose tile renderers
+	// have the same options (the render modes with preblit water have another one)
+	uint64_t geometry_key;
+	if (map_config.cacheTileGeometry() && !dry_run
+			&& context.tile_renderer->getGeometryKey(geometry_key)) {
+		std::ostringstream dir;
+		dir << map_config.getTileSet(rotation).toString() << "_"
+				<< std::hex << std::setw(16) << std::setfill('0') << geometry_key;
+		std::shared_ptr<TileStore>& store = tile_geometry_stores[dir.str()];
+		if (!store)
+			store = std::make_shared<FileTileStore>(
+					config.getOutputDir() / TILE_GEOMETRY_DIR / dir.str(),
+					TILE_GEOMETRY_FORMAT);
+		context.tile_geometry = store;
+	}
+	// the tile cache is shared with the maps of all worlds and configuration files using
+	// the same directory, the slime overlay depends on the seed of the world though
+	if (!map_config.getTileCacheDir().empty() && !dry_run
+			&& map_config.getOverlay() != OverlayType::SLIME) {
+		std::shared_ptr<TileCache>& cache = tile_caches[
+				map_config.getTileCacheDir().string()];
+		if (!cache)
+			cache = std::make_shared<TileCache>(map_config.getTileCacheDir());
+		context.tile_cache = cache;
+		context.tile_cache_key = TileCache::hashSettings(getTileCacheSettings(world_config,
+				map_config, block_images->getKey(resources), rotation));
+	}
 
 	// update map parameters in web config
 	web_config.setMapMaxZoom(map, context.tile_set->getDepth());
 	web_config.setMapTileSize(map, context.tile_renderer->getTileSize());
-	web_config.writeConfigJS();
+	if (shards == 1)
+		web_config.writeConfigJS();
+	return true;
+}
 
+bool RenderManager::measureRenderTimes(MapRendering& rendering, int threads,
+		double& setup_time, double& render_time, double& composite_time) {
+	typedef std::chrono::steady_clock clock;
+	config::MapSection map_config = config.getMap(rendering.map);
+	TileSet* tile_set = tile_sets[map_config.getTileSet(rendering.rotation)].get();
+
+	clock::time_point start = clock::now();
+	rendering.textures = getTextures(map_config, threads);
+	if (!rendering.textures)
+		return false;
+	rendering.render_view.reset(createRenderView(map_config.getRenderView()));
+	rendering.block_images.reset(rendering.render_view->createBlockImages());
+	RenderContext& context = rendering.context;
+	context.background_color = config.getBackgroundColor();
+	context.world_config = config.getWorld(map_config.getWorld());
+	context.map_config = map_config;
+	rendering.render_view->configureBlockImages(rendering.block_images.get(),
+			context.world_config, map_config);
+	rendering.block_images->setRotation(rendering.rotation);
+	rendering.block_images->generateBlocks(*rendering.textures, threads);
+	context.render_view = rendering.render_view.get();
+	context.block_images = rendering.block_images.get();
+	context.tile_set = tile_set;
+	context.world = worlds[map_config.getWorld()][rendering.rotation];
+	context.initializeTileRenderer();
+	setup_time = std::chrono::duration<double>(clock::now() - start).count();
+
+	// the sample tiles are spread over the required tiles, a composite tile is composed
+	// of four render tiles
+	const std::set<TilePos>& required = tile_set->getRequiredRenderTiles();
+	size_t step = std::max<size_t>(1, required.size() / PLAN_SAMPLE_TILES);
+	int size = context.tile_renderer->getTileSize();
+	RGBAImage image, composite(size, size);
+	std::string data;
+	double render_seconds = 0, composite_seconds = 0;
+	int samples = 0;
+	size_t i = 0;
+	for (auto it = required.begin(); it != required.end(); ++it, ++i) {
+		if (i % step != 0)
+			continue;
+		clock::time_point render_start = clock::now();
+		context.tile_renderer->renderTile(*it + tile_set->getTileOffset(), image);
+		TileWriter::encodeImage(image, map_config, context.background_color, false,
+				nullptr, data);
+		clock::time_point composite_start = clock::now();
+		for (int j = 0; j < 4; j++)
+			imageResizeHalfBlit(image, composite, (j % 2) * size / 2, (j / 2) * size / 2);
+		TileWriter::encodeImage(composite, map_config, context.background_color, true,
+				nullptr, data);
+		clock::time_point composite_end = clock::now();
+		render_seconds += std::chrono::duration<double>(
+				composite_start - render_start).count();
+		composite_seconds += std::chrono::duration<double>(
+				composite_end - composite_start).count();
+		samples++;
+	}
+	// only composite tiles might be required, if a rendering was interrupted
+	if (samples == 0) {
+		RGBAImage empty(size, size);
+		clock::time_point composite_start = clock::now();
+		TileWriter::encodeImage(empty, map_config, context.background_color, true,
+				nullptr, data);
+		composite_seconds = std::chrono::duration<double>(
+				clock::now() - composite_start).count();
+		samples = 1;
+	}
+	render_time = render_seconds / samples;
+	composite_time = composite_seconds / samples;
+	return true;
+}
+
+bool RenderManager::renderPreview(MapRendering& rendering, int threads,
+		util::IProgressHandler* progress) {
+	const RenderContext& context = rendering.context;
+	const config::MapSection& map_config = context.map_config;
+	TileSet* tile_set = context.tile_set;
+	int levels = map_config.getPreviewLevels();
+	int depth = tile_set->getDepth();
+	// the preview would replace the actual tiles of the parts which are not rendered
+	// again, and the tiles with unchanged images which are not written again
+	if (levels == 0 || shards > 1 || merge_shards || depth <= levels
+			|| (rendering.tile_hashes && rendering.tile_hashes->size() > 0)
+			|| rendering.required_tiles.size() != tile_set->getTiles(depth).size())
+		return false;
+
+	// a preview tile covers the render tiles of a composite tile only if the offset
+	// of the render tiles is a multiple of the preview tiles
+	int factor = 1 << levels;
+	TilePos tile_offset = tile_set->getTileOffset();
+	if (tile_offset.getX() % factor != 0 || tile_offset.getY() % factor != 0) {
+		LOG(INFO) << "Skipping the preview, the tile offset of the map doesn't match "
+				<< "the preview tiles.";
+		return false;
+	}
+	TilePos preview_offset(tile_offset.getX() / factor, tile_offset.getY() / factor);
+	std::shared_ptr<TileSet> preview_tile_set(rendering.render_view->createTileSet(
+			tile_set->getTileWidth() * factor));
+	preview_tile_set->scan(context.world, false, preview_offset, nullptr, threads);
+	if (preview_tile_set->getMinDepth() > depth - levels)
+		return false;
+	preview_tile_set->setDepth(depth - levels);
+	// the preview tiles at the edges may not be composite tiles of the map
+	preview_tile_set->filterRequired([&](const TilePos& tile) {
+		return tile_set->hasTile(TilePath::byTilePos(tile, depth - levels));
+	});
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	std::shared_ptr<TextureResources> textures = getTextures(map_config, threads,
+			map_config.getTextureSize() / factor);
+	lock.unlock();
+	if (!textures)
+		return false;
+	std::shared_ptr<BlockImages> block_images(rendering.render_view->createBlockImages());
+	rendering.render_view->configureBlockImages(block_images.get(),
+			context.world_config, map_config);
+	block_images->setRotation(rendering.rotation);
+	block_images->generateBlocks(*textures, threads);
+
+	// the preview tiles are not in the tile hash index, have no thumbnails and their
+	// render times and geometry are not the ones of the tiles, they are replaced anyway
+	RenderContext preview_context = context;
+	preview_context.tile_costs.reset();
+	preview_context.tile_geometry.reset();
+	preview_context.block_images = block_images.get();
+	preview_context.tile_set = preview_tile_set.get();
+	preview_context.tile_writer = std::make_shared<TileWriter>(map_config,
+			context.background_color, map_config.getWriteThreads(), rendering.tile_store);
+	const std::vector<config::TileOutput>& outputs = map_config.getAdditionalOutputs();
+	for (size_t i = 0; i < rendering.output_stores.size(); i++)
+		preview_context.tile_writer->addOutput(outputs[i], rendering.output_stores[i]);
+	preview_context.initializeTileRenderer();
+	// for example the tiles with the block colors don't depend on the texture size
+	if (preview_context.tile_renderer->getTileSize()
+			!= context.tile_renderer->getTileSize()) {
+		LOG(INFO) << "Skipping the preview, it is not available for this map.";
+		return false;
+	}
+
+	LOG(INFO) << "Rendering a preview of the zoom levels up to " << depth - levels << ".";
 	std::shared_ptr<thread::Dispatcher> dispatcher;
-	if (threads == 1 || tile_set->getRequiredRenderTilesCount() == 1)
+	if (threads == 1)
 		dispatcher = std::make_shared<thread::SingleThreadDispatcher>();
 	else
-		dispatcher = std::make_shared<thread::MultiThreadingDispatcher>(threads);
+		dispatcher = std::make_shared<thread::MultiThreadingDispatcher>(threads,
+				thread_pool.get());
+	dispatcher->setMemoryLimit(memory_limit / concurrent_renders);
+	dispatcher->setPinThreads(pin_threads);
+	dispatcher->setStopTime(stop_time);
+	dispatcher->setStopFlag(stop_flag);
+	dispatcher->dispatch(std::vector<RenderContext>(1, preview_context), progress);
+	preview_context.tile_writer->finish();
+	return true;
+}
 
-	// do the dance
-	dispatcher->dispatch(context, progress);
+void RenderManager::renderProgressive(const MapRendering& rendering,
+		const std::vector<RenderContext>& contexts, int threads,
+		util::IProgressHandler* progress) {
+	int levels = 0;
+	for (auto it = contexts.begin(); it != contexts.end(); ++it)
+		levels = std::max(levels, it->map_config.getProgressiveLevels());
+	// the tiles of an interrupted first pass would stay provisional, and the shards
+	// would write provisional tiles above their subtrees
+	if (levels == 0 || shards > 1 || merge_shards || dry_run || stop_time != 0
+			|| stop_flag != nullptr || !rendering.render_work.empty())
+		return;
+	TileSet* tile_set = rendering.context.tile_set;
+	std::set<TilePos> sample = tile_set->sampleRequiredRenderTiles(levels);
+	if (sample.size() == (size_t) tile_set->getRequiredRenderTilesCount())
+		return;
+
+	std::set<TilePos> required_tiles = tile_set->getRequiredRenderTiles();
+	std::set<TilePath> required_composite_tiles = tile_set->getRequiredCompositeTiles();
+	tile_set->filterRequired([&](const TilePos& tile) {
+		return sample.count(tile) != 0;
+	});
+	std::vector<RenderContext> provisional_contexts = contexts;
+	for (auto it = provisional_contexts.begin(); it != provisional_contexts.end(); ++it)
+		it->provisional = true;
+
+	LOG(INFO) << "Rendering " << sample.size() << " of the "
+			<< required_tiles.size() << " render tiles first.";
+	std::shared_ptr<thread::Dispatcher> dispatcher;
+	if (threads == 1)
+		dispatcher = std::make_shared<thread::SingleThreadDispatcher>();
+	else
+		dispatcher = std::make_shared<thread::MultiThreadingDispatcher>(threads,
+				thread_pool.get());
+	dispatcher->setMemoryLimit(memory_limit / concurrent_renders);
+	dispatcher->setPinThreads(pin_threads);
+	dispatcher->dispatch(provisional_contexts, progress);
+
+	// the sampled render tiles are done, all composite tiles are composed again
+	tile_set->setRequired(required_tiles, required_composite_tiles);
+	tile_set->filterRequiredRenderTiles([&](const TilePos& tile) {
+		return sample.count(tile) == 0;
+	});
+}
+
+void RenderManager::scanRequiredTiles(MapRendering& rendering, int last_rendered) {
+	const std::string& map = rendering.map;
+	int rotation = rendering.rotation;
+	config::MapSection map_config = config.getMap(map);
+	fs::path output_dir = config.getOutputPath(map + "/" + config::ROTATION_NAMES_SHORT[rotation]);
+	TileStore& tile_store = *rendering.tile_store;
+	TileSet* tile_set = tile_sets[map_config.getTileSet(rotation)].get();
+	if (render_behaviors.getRenderBehavior(map, rotation) == RenderBehavior::AUTO) {
+		// if incremental render, scan which tiles might have changed
+		LOG(INFO) << "Scanning required tiles...";
+		// use the incremental check method specified in the config, the tiles rendered
+		// on demand are up to date if their files are
+		if (use_changed_chunks && !on_demand) {
+			// the tiles of the changed chunks are required, rotated like the tile set
+			std::set<mc::ChunkPos> chunks;
+			auto world_it = changed_chunks.find(map_config.getWorld());
+			if (world_it != changed_chunks.end()) {
+				for (auto it = world_it->second.begin(); it != world_it->second.end(); ++it) {
+					mc::ChunkPos chunk = *it;
+					chunk.rotate(rotation);
+					chunks.insert(chunk);
+				}
+			}
+			tile_set->scanRequiredByChunks(chunks);
+		} else if (map_config.useImageModificationTimes() || on_demand)
+			tile_set->scanRequiredByFiletimes(tile_store);
+		else {
+			//tile_set->scanRequiredByTimestamp(settings.last_render[rotation]);
+			// the tiles written by an interrupted rendering don't have to be rendered
+			// again if their chunks didn't change since it started
+			rendering.journal = std::make_shared<RenderJournal>();
+			std::set<TilePos> changed_since_journal;
+			bool resume = shards == 1 && !merge_shards
+					&& rendering.journal->read(output_dir / JOURNAL_FILE);
+			if (resume) {
+				tile_set->scanRequiredByTimestamp(rendering.journal->getTimeStarted());
+				changed_since_journal = tile_set->getRequiredRenderTiles();
+			}
+			tile_set->scanRequiredByTimestamp(last_rendered);
+			if (resume) {
+				size_t required = tile_set->getRequiredRenderTilesCount();
+				int depth = tile_set->getDepth();
+				RenderJournal& journal = *rendering.journal;
+				tile_set->filterRequiredRenderTiles([&](const TilePos& tile) {
+					TilePath path = TilePath::byTilePos(tile, depth);
+					return changed_since_journal.count(tile)
+							|| !journal.contains(tile_store.getTileFile(path));
+				});
+				LOG(INFO) << "Resuming interrupted rendering, skipping "
+						<< required - tile_set->getRequiredRenderTilesCount()
+						<< " already rendered tiles.";
+			}
+		}
+
+		// skip the tiles whose chunks were saved again, but didn't change
+		if (map_config.useChunkHashes()) {
+			rendering.chunk_hashes.read((output_dir / "chunkhashes.dat").string());
+			size_t required = tile_set->getRequiredRenderTilesCount();
+			filterUnchangedTiles(tile_set, worlds[map_config.getWorld()][rotation],
+					tile_store, rendering.chunk_hashes);
+			LOG(INFO) << "Skipping " << required - tile_set->getRequiredRenderTilesCount()
+					<< " tiles with unchanged chunks.";
+		}
+	} else {
+		// or just set all tiles required if force-rendering
+		tile_set->resetRequired();
+	}
+
+	// only the render tiles in the requested tiles are rendered
+	if (!requested_tiles.empty()) {
+		auto requested = [&](TilePath path) {
+			for (; path.getDepth() > 0; path = path.parent())
+				if (requested_tiles.count(path))
+					return true;
+			return requested_tiles.count(path) != 0;
+		};
+		int depth = tile_set->getDepth();
+		tile_set->filterRequired([&](const TilePos& tile) {
+			return requested(TilePath::byTilePos(tile, depth));
+		});
+		// the composite tiles above the requested tiles are composed of the other tiles
+		// of the map, these are missing if the map wasn't rendered yet
+		if (last_rendered == 0) {
+			std::set<TilePos> render_tiles = tile_set->getRequiredRenderTiles();
+			std::set<TilePath> composite_tiles;
+			const std::set<TilePath>& required = tile_set->getRequiredCompositeTiles();
+			for (auto it = required.begin(); it != required.end(); ++it)
+				if (requested(*it))
+					composite_tiles.insert(*it);
+			tile_set->setRequired(render_tiles, composite_tiles);
+		}
+		LOG(INFO) << tile_set->getRequiredRenderTilesCount()
+				<< " render tiles of the requested tiles are required.";
+	}
+}
+
+void RenderManager::finishMap(MapRendering& rendering, const mc::CacheStats& region_stats,
+		const mc::CacheStats& chunk_stats, bool complete) {
+	const std::string& map = rendering.map;
+	int rotation = rendering.rotation;
+	config::MapSection map_config = config.getMap(map);
+	fs::path output_dir = rendering.context.output_dir;
+
+	// wait until the last tiles are written
+	rendering.context.tile_writer->finish();
+	if (rendering.tile_hashes) {
+		size_t unchanged = rendering.context.tile_writer->getUnchangedCount();
+		if (unchanged > 0)
+			LOG(INFO) << "Skipped writing " << unchanged << " tiles with unchanged images.";
+		if (!rendering.tile_hashes->write((output_dir / TILE_HASHES_FILE).string()))
+			LOG(WARNING) << "Unable to write the tile hash index.";
+	}
+	if (rendering.context.tile_costs
+			&& !rendering.context.tile_costs->write((output_dir / TILE_COSTS_FILE).string()))
+		LOG(WARNING) << "Unable to write the tile render times.";
+	// the tiles which could not be uploaded are uploaded by the next run when they are
+	// written again
+	if (rendering.uploader) {
+		rendering.uploader->finish();
+		LOG(INFO) << "Uploaded " << rendering.uploader->getUploadedCount() << " tiles, "
+				<< rendering.uploader->getUnchangedCount() << " tiles were unchanged.";
+		if (rendering.uploader->getFailedCount() > 0)
+			LOG(WARNING) << "Unable to upload " << rendering.uploader->getFailedCount()
+					<< " tiles.";
+		if (!rendering.uploader->writeManifest(output_dir / UPLOAD_MANIFEST_FILE))
+			LOG(WARNING) << "Unable to write the upload manifest.";
+	}
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	addCacheStats(map, rotation, region_stats, chunk_stats);
+	// the shards are finished when they are merged
+	if (shards > 1)
+		return;
+	// the remaining tiles stay required for the next run, the tile files that are older
+	// than their chunks or the render journal tell which tiles are still missing, the
+	// tiles outside of the requested tiles as well
+	if (!requested_tiles.empty() && complete)
+		return;
+	if (!complete) {
+		stopped = true;
+		LOG(INFO) << "Stopped rendering map " << map << " in rotation "
+			<< config::ROTATION_NAMES[rotation]
+			<< ", the remaining tiles are rendered by the next run.";
+		return;
+	}
+
+	if (map_config.useChunkHashes()
+			&& render_behaviors.getRenderBehavior(map, rotation) == RenderBehavior::AUTO
+			&& !rendering.chunk_hashes.write((output_dir / "chunkhashes.dat").string()))
+		LOG(WARNING) << "Unable to write the chunk hash index.";
 
 	// update the map settings with last render time
 	web_config.setMapLastRendered(map, rotation, time_started_scanning);
 	web_config.writeConfigJS();
+	// the rendering is complete, it doesn't need to be resumed
+	if (rendering.journal)
+		rendering.journal->remove();
 }
 
 bool RenderManager::run(int threads, bool batch) {
@@ -353,12 +1691,560 @@ bool RenderManager::run(int threads, bool batch) {
 		return false;
 
 	LOG(INFO) << "Scanning worlds...";
-	if (!scanWorlds())
+	if (!scanWorlds(threads))
+		return false;
+
+	// the render threads are started once for all maps and rotations
+	if (threads > 1 && !shared_thread_pool)
+		thread_pool.reset(new thread::ThreadPool(threads));
+	util::MemoryTracker::startSampling();
+	int time_start_all = std::time(nullptr);
+	stop_time = max_time > 0 ? time_started_scanning + max_time : 0;
+	stopped = false;
+	cache_stats.clear();
+	if (concurrent_renders > 1)
+		renderConcurrently(threads, batch);
+	else
+		renderSequentially(threads, batch);
+
+	if (!shared_thread_pool)
+		thread_pool.reset();
+	std::time_t took_all = std::time(nullptr) - time_start_all;
+	LOG(INFO) << "Rendering all worlds took " << took_all << " seconds.";
+	writeCollectedSigns();
+	// the broken regions and chunks found while rendering are kept for the next time
+	std::string region_index_file = config.getOutputPath(REGION_INDEX_FILE).string();
+	if (shards == 1 && !dry_run && region_index && !region_index->write(region_index_file))
+		LOG(WARNING) << "Unable to write region index file " << region_index_file << "!";
+	size_t peak_memory = util::getPeakMemoryUsage();
+	if (peak_memory > 0)
+		LOG(INFO) << "Peak memory usage was " << peak_memory / (1024 * 1024) << " MiB.";
+	util::MemoryTracker::stopSampling();
+	util::MemoryTracker::logUsage();
+	util::HugePageArena::logUsage();
+	if (slow_tiles)
+		slow_tiles->logSummary();
+	writeCacheStats();
+	writeProfile();
+	writeBlockProfile();
+	writeTrace();
+	LOG(INFO) << "Finished.....aaand it's gone!";
+	return true;
+}
+
+bool RenderManager::wasStopped() const {
+	return stopped;
+}
+
+bool RenderManager::isStopped() const {
+	return (stop_time != 0 && std::time(nullptr) >= stop_time)
+			|| (stop_flag != nullptr && *stop_flag);
+}
+
+bool RenderManager::watch(int threads, bool batch, int interval) {
+	while (true) {
+		// the region files modified while rendering are rendered the next time
+		RegionFiles region_files = getRegionFiles();
+		if (!run(threads, batch))
+			return false;
+		// the maps are rendered completely only once
+		render_behaviors.resetForceRender();
+
+		LOG(INFO) << "Watching the worlds for changes...";
+		RegionFiles modified = region_files;
+		while (modified == region_files) {
+			std::this_thread::sleep_for(std::chrono::seconds(interval));
+			modified = getRegionFiles();
+		}
+		// wait until the world is saved
+		for (int i = 0; i < WATCH_MAX_DELAY; i++) {
+			std::this_thread::sleep_for(std::chrono::seconds(interval));
+			RegionFiles current = getRegionFiles();
+			if (current == modified)
+				break;
+			modified = current;
+		}
+		LOG(INFO) << "The worlds were modified, rendering them again.";
+	}
+}
+
+bool RenderManager::plan(int threads) {
+	// the web config has the last render times, if the maps were rendered already
+	dry_run = true;
+	if (fs::is_directory(config.getOutputDir()) && !web_config.readConfigJS())
+		return false;
+
+	LOG(INFO) << "Scanning worlds...";
+	if (!scanWorlds(threads))
+		return false;
+
+	int render_tiles_all = 0, composite_tiles_all = 0;
+	double seconds_all = 0;
+	for (auto map_it = required_maps.begin(); map_it != required_maps.end(); ++map_it) {
+		config::MapSection map_config = config.getMap(map_it->first);
+		for (auto rotation_it = map_it->second.begin();
+				rotation_it != map_it->second.end(); ++rotation_it) {
+			MapRendering rendering;
+			rendering.map = map_it->first;
+			rendering.rotation = *rotation_it;
+			rendering.tile_store = createTileStore(map_config, config.getOutputPath(
+					rendering.map + "/" + config::ROTATION_NAMES_SHORT[*rotation_it]));
+			LOG(INFO) << "Planning map " << rendering.map << " in rotation "
+					<< config::ROTATION_NAMES[*rotation_it] << "...";
+			scanRequiredTiles(rendering, web_config.getMapLastRendered(rendering.map,
+					*rotation_it));
+
+			TileSet* tile_set = tile_sets[map_config.getTileSet(*rotation_it)].get();
+			int render_tiles = tile_set->getRequiredRenderTilesCount();
+			int composite_tiles = tile_set->getRequiredCompositeTilesCount();
+			double seconds = 0;
+			double setup_time, render_time, composite_time;
+			if ((render_tiles > 0 || composite_tiles > 0) && measureRenderTimes(
+					rendering, threads, setup_time, render_time, composite_time))
+				seconds = setup_time + (render_tiles * render_time
+						+ composite_tiles * composite_time) / threads;
+			LOG(INFO) << render_tiles << " render tiles and " << composite_tiles
+					<< " composite tiles are required, rendering them takes about "
+					<< util::format_eta(seconds + 0.5) << ".";
+			render_tiles_all += render_tiles;
+			composite_tiles_all += composite_tiles;
+			seconds_all += seconds;
+		}
+	}
+	LOG(INFO) << "All maps need " << render_tiles_all << " render tiles and "
+			<< composite_tiles_all << " composite tiles, rendering them with "
+			<< threads << " threads takes about " << util::format_eta(seconds_all + 0.5)
+			<< ".";
+	return true;
+}
+
+bool RenderManager::tune(int threads) {
+	typedef std::chrono::steady_clock clock;
+	dry_run = true;
+	LOG(INFO) << "Scanning worlds...";
+	if (!scanWorlds(threads))
+		return false;
+
+	for (auto map_it = required_maps.begin(); map_it != required_maps.end(); ++map_it) {
+		config::MapSection map_config = config.getMap(map_it->first);
+		int rotation = *map_it->second.begin();
+		LOG(INFO) << "Tuning map " << map_it->first << " in rotation "
+				<< config::ROTATION_NAMES[rotation] << "...";
+
+		std::shared_ptr<TextureResources> resources = getTextures(map_config, threads);
+		if (!resources)
+			continue;
+		std::shared_ptr<RenderView> render_view(createRenderView(map_config.getRenderView()));
+		std::shared_ptr<BlockImages> block_images(render_view->createBlockImages());
+		RenderContext context;
+		context.background_color = config.getBackgroundColor();
+		context.world_config = config.getWorld(map_config.getWorld());
+		context.map_config = map_config;
+		render_view->configureBlockImages(block_images.get(), context.world_config,
+				map_config);
+		block_images->setRotation(rotation);
+		block_images->generateBlocks(*resources, threads);
+		context.render_view = render_view.get();
+		context.block_images = block_images.get();
+		context.world = worlds[map_config.getWorld()][rotation];
+
+		// the sample area are the chunks of some of the widest tiles spread over the map,
+		// the tiles of the narrower tile widths are rendered of the same area
+		int widest = TUNE_TILE_WIDTHS[sizeof(TUNE_TILE_WIDTHS) / sizeof(int) - 1];
+		std::shared_ptr<TileSet> wide_tile_set(render_view->createTileSet(widest));
+		wide_tile_set->scan(context.world, nullptr, threads);
+		wide_tile_set->resetRequired();
+		const std::set<TilePos>& wide_tiles = wide_tile_set->getRequiredRenderTiles();
+		size_t step = std::max<size_t>(1, wide_tiles.size() / TUNE_SAMPLE_TILES);
+		std::set<mc::ChunkPos> sample_chunks;
+		size_t i = 0;
+		for (auto it = wide_tiles.begin(); it != wide_tiles.end(); ++it, ++i)
+			if (i % step == 0)
+				wide_tile_set->mapTileToChunks(*it, sample_chunks);
+		if (sample_chunks.empty()) {
+			LOG(INFO) << "The map is empty, there is nothing to tune.";
+			continue;
+		}
+
+		int best_tile_width = 0;
+		size_t best_chunk_cache_size = 0;
+		double best_seconds = 0;
+		bool read_regions = false;
+		for (int tile_width : TUNE_TILE_WIDTHS) {
+			std::shared_ptr<TileSet> tile_set(render_view->createTileSet(tile_width));
+			tile_set->scan(context.world, nullptr, threads);
+			tile_set->resetRequired();
+			const std::set<TilePos>& all_tiles = tile_set->getRequiredRenderTiles();
+			std::set<TilePos> tiles, chunk_tiles;
+			for (auto it = sample_chunks.begin(); it != sample_chunks.end(); ++it)
+				tile_set->mapChunkToTiles(*it, chunk_tiles);
+			for (auto it = chunk_tiles.begin(); it != chunk_tiles.end(); ++it)
+				if (all_tiles.count(*it))
+					tiles.insert(*it);
+			context.tile_set = tile_set.get();
+
+			// a bigger chunk cache needs more memory, so it's only worth it if it's
+			// noticeably faster than the smaller ones
+			size_t chunk_cache_size = 0;
+			double seconds = 0;
+			for (size_t cache_size : TUNE_CHUNK_CACHE_SIZES) {
+				context.chunk_cache_size = cache_size;
+				context.initializeTileRenderer();
+				RGBAImage image;
+				// the region files are read from disk only for the first rendering
+				if (!read_regions && !tiles.empty()) {
+					context.tile_renderer->renderTile(*tiles.begin()
+							+ tile_set->getTileOffset(), image);
+					context.initializeTileRenderer();
+					read_regions = true;
+				}
+				clock::time_point start = clock::now();
+				for (auto it = tiles.begin(); it != tiles.end(); ++it)
+					context.tile_renderer->renderTile(*it + tile_set->getTileOffset(), image);
+				double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+				const mc::CacheStats& stats = context.world_cache->getChunkCacheStats();
+				uint64_t accesses = stats.hits + stats.misses;
+				LOG(INFO) << "tile_width = " << tile_width << ", chunk_cache_size = "
+						<< cache_size << ": " << tiles.size() << " render tiles in "
+						<< std::fixed << std::setprecision(2) << elapsed << " seconds, "
+						<< std::setprecision(1)
+						<< (accesses > 0 ? 100.0 * stats.hits / accesses : 0.0)
+						<< "% chunk cache hits.";
+				if (chunk_cache_size == 0 || elapsed < seconds * 0.95) {
+					chunk_cache_size = cache_size;
+					seconds = elapsed;
+				}
+			}
+			if (best_tile_width == 0 || seconds < best_seconds) {
+				best_tile_width = tile_width;
+				best_chunk_cache_size = chunk_cache_size;
+				best_seconds = seconds;
+			}
+		}
+
+		LOG(INFO) << "The map renders fastest with tile_width = " << best_tile_width
+				<< " and chunk_cache_size = " << best_chunk_cache_size
+				<< " (currently " << map_config.getTileWidth() << " and "
+				<< map_config.getChunkCacheSize() << ").";
+		if (best_tile_width != map_config.getTileWidth())
+			LOG(INFO) << "Changing the tile_width requires rendering the map completely again.";
+	}
+	return true;
+}
+
+bool RenderManager::optimizeTiles(int threads, int min_age) {
+	if (!fs::is_directory(config.getOutputDir())) {
+		LOG(INFO) << "There are no rendered maps to optimize.";
+		return true;
+	}
+	if (!web_config.readConfigJS())
+		return false;
+	if (!util::lowerProcessPriority())
+		LOG(WARNING) << "Unable to lower the priority of the process.";
+
+	std::time_t stable_time = std::time(nullptr) - min_age;
+	std::time_t stop = max_time > 0 ? std::time(nullptr) + max_time : 0;
+	auto config_maps = config.getMaps();
+	for (auto map_it = config_maps.begin(); map_it != config_maps.end(); ++map_it) {
+		const config::MapSection& map_config = *map_it;
+		std::string map = map_config.getShortName();
+		const std::vector<config::TileOutput>& outputs = map_config.getAdditionalOutputs();
+		int depth = web_config.getMapMaxZoom(map);
+		auto rotations = map_config.getRotations();
+		for (auto rotation_it = rotations.begin(); rotation_it != rotations.end();
+				++rotation_it) {
+			if (render_behaviors.getRenderBehavior(map, *rotation_it) == RenderBehavior::SKIP
+					|| web_config.getMapLastRendered(map, *rotation_it) == 0)
+				continue;
+			if (stop != 0 && std::time(nullptr) >= stop)
+				return true;
+
+			// only PNGs can be recompressed without losing anything
+			fs::path output_dir = config.getOutputPath(map + "/"
+					+ config::ROTATION_NAMES_SHORT[*rotation_it]);
+			std::vector<std::shared_ptr<TileStore> > stores;
+			if (map_config.getImageFormat() == config::ImageFormat::PNG)
+				stores.push_back(createTileStore(map_config, output_dir));
+			std::vector<std::shared_ptr<TileStore> > output_stores =
+					createOutputStores(map_config, output_dir);
+			for (size_t i = 0; i < outputs.size(); i++)
+				if (outputs[i].format == config::ImageFormat::PNG)
+					stores.push_back(output_stores[i]);
+			if (stores.empty())
+				continue;
+
+			// the recompressed tiles are uploaded again
+			std::shared_ptr<TileUploader> uploader;
+			if (!map_config.getUploadURL().empty()) {
+				uploader = std::make_shared<TileUploader>(config.getOutputDir(),
+						map_config.getUploadURL(), map_config.getUploadRegion(),
+						S3Credentials::fromEnvironment(), map_config.getUploadThreads(),
+						map_config.getUploadRetries());
+				uploader->readManifest(output_dir / UPLOAD_MANIFEST_FILE);
+			}
+
+			LOG(INFO) << "Optimizing the tiles of map " << map << " in rotation "
+					<< config::ROTATION_NAMES[*rotation_it] << "...";
+			int replaced_all = 0;
+			uint64_t saved_all = 0;
+			for (auto it = stores.begin(); it != stores.end(); ++it) {
+				if (uploader)
+					(*it)->setUploader(uploader.get());
+				int replaced;
+				uint64_t saved;
+				optimizeStore(**it, depth, threads, stable_time, stop, replaced, saved);
+				replaced_all += replaced;
+				saved_all += saved;
+			}
+			LOG(INFO) << "Recompressed " << replaced_all << " tiles, they are "
+					<< saved_all / 1024 << " KiB smaller now.";
+
+			if (uploader) {
+				uploader->finish();
+				if (uploader->getFailedCount() > 0)
+					LOG(WARNING) << "Unable to upload " << uploader->getFailedCount()
+							<< " tiles.";
+				if (!uploader->writeManifest(output_dir / UPLOAD_MANIFEST_FILE))
+					LOG(WARNING) << "Unable to write the upload manifest.";
+			}
+		}
+	}
+	return true;
+}
+
+bool RenderManager::recompositeTiles(int threads) {
+	return rewriteTiles(threads, false);
+}
+
+bool RenderManager::reencodeTiles(int threads) {
+	return rewriteTiles(threads, true);
+}
+
+bool RenderManager::rewriteTiles(int threads, bool reencode) {
+	if (!fs::is_directory(config.getOutputDir())) {
+		LOG(INFO) << "There are no rendered maps.";
+		return true;
+	}
+	if (!web_config.readConfigJS())
+		return false;
+
+	auto config_maps = config.getMaps();
+	for (auto map_it = config_maps.begin(); map_it != config_maps.end(); ++map_it) {
+		const config::MapSection& map_config = *map_it;
+		std::string map = map_config.getShortName();
+		int depth = web_config.getMapMaxZoom(map);
+		int tile_size = web_config.getMapTileSize(map);
+		auto rotations = map_config.getRotations();
+		for (auto rotation_it = rotations.begin(); rotation_it != rotations.end();
+				++rotation_it) {
+			if (render_behaviors.getRenderBehavior(map, *rotation_it) == RenderBehavior::SKIP
+					|| web_config.getMapLastRendered(map, *rotation_it) == 0)
+				continue;
+
+			fs::path output_dir = config.getOutputPath(map + "/"
+					+ config::ROTATION_NAMES_SHORT[*rotation_it]);
+			std::shared_ptr<TileStore> store = createTileStore(map_config, output_dir);
+			std::vector<std::shared_ptr<TileStore> > output_stores =
+					createOutputStores(map_config, output_dir);
+
+			// the tiles are read in the image format with the most recently written base
+			// tile, that's the one of the last rendering (or reencoding), the reencoded
+			// tiles have the same times, then the lossless formats are preferred
+			std::shared_ptr<TileStore> source = store;
+			config::ImageFormat source_format = map_config.getImageFormat();
+			if (reencode) {
+				std::time_t source_time = 0;
+				const config::ImageFormat formats[] = {config::ImageFormat::PNG,
+						config::ImageFormat::WEBP, config::ImageFormat::JPEG};
+				for (config::ImageFormat format : formats) {
+					config::TileOutput output;
+					output.format = format;
+					std::shared_ptr<TileStore> format_store = format == source_format
+							? store : createTileStore(map_config, output_dir,
+									output.getImageFormatSuffix());
+					std::time_t time;
+					if (format_store->getModificationTime(TilePath(), time)
+							&& time > source_time) {
+						source = format_store;
+						source_format = format;
+						source_time = time;
+					}
+				}
+				if (source_time == 0) {
+					LOG(WARNING) << "There are no tiles of map " << map << " in rotation "
+							<< config::ROTATION_NAMES[*rotation_it] << ".";
+					continue;
+				}
+			}
+
+			TileWriter writer(map_config, config.getBackgroundColor(),
+					map_config.getWriteThreads(), store);
+			const std::vector<config::TileOutput>& outputs = map_config.getAdditionalOutputs();
+			for (size_t i = 0; i < outputs.size(); i++)
+				writer.addOutput(outputs[i], output_stores[i]);
+			// the thumbnails don't change when the tiles are only encoded again
+			std::shared_ptr<TileStore> thumbnails;
+			if (map_config.cacheTileThumbnails() && !reencode) {
+				thumbnails = createTileStore(map_config, output_dir / THUMBNAILS_DIR,
+						THUMBNAILS_FORMAT);
+				writer.setThumbnails(thumbnails.get());
+			}
+			// the hashes of the rewritten tiles are updated
+			fs::path tile_hashes_file = output_dir / TILE_HASHES_FILE;
+			std::shared_ptr<TileHashIndex> tile_hashes;
+			if (map_config.useTileHashes() && fs::exists(tile_hashes_file)) {
+				tile_hashes = std::make_shared<TileHashIndex>();
+				tile_hashes->read(tile_hashes_file.string());
+				writer.setTileHashes(tile_hashes.get());
+			}
+			std::shared_ptr<TileUploader> uploader;
+			if (!map_config.getUploadURL().empty()) {
+				uploader = std::make_shared<TileUploader>(config.getOutputDir(),
+						map_config.getUploadURL(), map_config.getUploadRegion(),
+						S3Credentials::fromEnvironment(), map_config.getUploadThreads(),
+						map_config.getUploadRetries());
+				uploader->readManifest(output_dir / UPLOAD_MANIFEST_FILE);
+				store->setUploader(uploader.get());
+				for (auto it = output_stores.begin(); it != output_stores.end(); ++it)
+					(*it)->setUploader(uploader.get());
+			}
+
+			if (reencode) {
+				LOG(INFO) << "Encoding the tiles of map " << map << " in rotation "
+						<< config::ROTATION_NAMES[*rotation_it] << " from "
+						<< source_format << " to " << map_config.getImageFormat() << "...";
+				size_t encoded = reencodeStore(writer, *source, source_format,
+						tile_hashes.get(), depth, threads);
+				writer.finish();
+				LOG(INFO) << "Encoded " << encoded << " tiles.";
+			} else {
+				LOG(INFO) << "Composing the tiles of map " << map << " in rotation "
+						<< config::ROTATION_NAMES[*rotation_it] << "...";
+				size_t composed = recomposeStore(writer, tile_hashes.get(), depth,
+						tile_size, threads);
+				writer.finish();
+				LOG(INFO) << "Composed " << composed << " tiles.";
+			}
+
+			if (tile_hashes && !tile_hashes->write(tile_hashes_file.string()))
+				LOG(WARNING) << "Unable to write '" << tile_hashes_file.string() << "'.";
+			if (uploader) {
+				uploader->finish();
+				if (uploader->getFailedCount() > 0)
+					LOG(WARNING) << "Unable to upload " << uploader->getFailedCount()
+							<< " tiles.";
+				if (!uploader->writeManifest(output_dir / UPLOAD_MANIFEST_FILE))
+					LOG(WARNING) << "Unable to write the upload manifest.";
+			}
+		}
+	}
+	// the web interface requests the tiles in the new image format
+	if (reencode)
+		web_config.writeConfigJS();
+	return true;
+}
+
+bool RenderManager::prepareOnDemand(int threads) {
+	if (!initialize())
+		return false;
+
+	LOG(INFO) << "Scanning worlds...";
+	if (!scanWorlds(threads))
 		return false;
 
+	if (threads > 1 && !shared_thread_pool)
+		thread_pool.reset(new thread::ThreadPool(threads));
+	on_demand = true;
+	on_demand_threads = threads;
+	on_demand_maps.clear();
+	for (auto map_it = required_maps.begin(); map_it != required_maps.end(); ++map_it) {
+		for (auto rotation_it = map_it->second.begin();
+				rotation_it != map_it->second.end(); ++rotation_it) {
+			LOG(INFO) << "Preparing map " << map_it->first << " in rotation "
+					<< config::ROTATION_NAMES[*rotation_it] << "...";
+			// the tiles of the maps without outdated tiles are only read
+			MapRendering& rendering = on_demand_maps[std::make_pair(map_it->first,
+					*rotation_it)];
+			if (!prepareMap(map_it->first, *rotation_it, threads, rendering))
+				continue;
+			int depth = rendering.context.tile_set->getDepth();
+			for (auto it = rendering.required_tiles.begin();
+					it != rendering.required_tiles.end(); ++it)
+				rendering.required_tile_paths.insert(TilePath::byTilePos(*it, depth));
+			LOG(INFO) << rendering.required_tiles.size() << " render tiles and "
+					<< rendering.required_composite_tiles.size()
+					<< " composite tiles are outdated.";
+		}
+	}
+	return true;
+}
+
+bool RenderManager::renderTile(const std::string& map, int rotation, const TilePath& tile,
+		std::string& data) {
+	auto it = on_demand_maps.find(std::make_pair(map, rotation));
+	if (it == on_demand_maps.end())
+		return false;
+	MapRendering& rendering = it->second;
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(on_demand_mutex);
+	RenderContext& context = rendering.context;
+	if (context.tile_set != nullptr) {
+		TileSet* tile_set = context.tile_set;
+		if (!tile_set->hasTile(tile))
+			return false;
+
+		// the outdated tiles of the tile are rendered now, they're up to date afterwards
+		std::set<TilePos> render_tiles;
+		std::set<TilePath> composite_tiles;
+		auto render_it = rendering.required_tile_paths.lower_bound(tile);
+		while (render_it != rendering.required_tile_paths.end()
+				&& isTileContained(tile, *render_it)) {
+			render_tiles.insert(render_it->getTilePos());
+			render_it = rendering.required_tile_paths.erase(render_it);
+		}
+		for (auto tile_it = render_tiles.begin(); tile_it != render_tiles.end(); ++tile_it)
+			rendering.required_tiles.erase(*tile_it);
+		auto composite_it = rendering.required_composite_tiles.lower_bound(tile);
+		while (composite_it != rendering.required_composite_tiles.end()
+				&& isTileContained(tile, *composite_it)) {
+			composite_tiles.insert(*composite_it);
+			composite_it = rendering.required_composite_tiles.erase(composite_it);
+		}
+
+		if (!render_tiles.empty() || !composite_tiles.empty()) {
+			LOG(INFO) << "Rendering tile " << (tile.getDepth() == 0 ? "base" : tile.toString())
+					<< " of map " << map << " in rotation "
+					<< config::ROTATION_NAMES[rotation] << " (" << render_tiles.size()
+					<< " render tiles).";
+			tile_set->setRequired(render_tiles, composite_tiles);
+			util::DummyProgressHandler progress;
+			// the dispatcher splits the tiles two zoom levels above the render tiles
+			// into jobs, the ones below them are rendered by one worker
+			if (on_demand_threads > 1 && tile.getDepth() <= tile_set->getDepth() - 2
+					&& render_tiles.size() > 1) {
+				thread::MultiThreadingDispatcher dispatcher(on_demand_threads,
+						thread_pool.get());
+				dispatcher.setMemoryLimit(memory_limit);
+				dispatcher.dispatch(std::vector<RenderContext>(1, context), &progress);
+			} else {
+				RenderWork work;
+				work.tiles.insert(tile);
+				TileRenderWorker worker;
+				worker.setRenderContext(context);
+				worker.setRenderWork(work);
+				worker.setProgressHandler(&progress);
+				worker();
+			}
+			// the tile writer writes the tiles on the render threads afterwards
+			context.tile_writer->finish();
+		}
+	}
+	return rendering.tile_store->read(tile, data);
+}
+
+void RenderManager::renderSequentially(int threads, bool batch) {
 	int progress_maps = 0;
 	int progress_maps_all = required_maps.size();
-	int time_start_all = std::time(nullptr);
 
 	// go through all required maps
 	for (auto map_it = required_maps.begin(); map_it != required_maps.end(); ++map_it) {
@@ -378,6 +2264,15 @@ bool RenderManager::run(int threads, bool batch) {
 				rotation_it != required_rotations.end(); ++rotation_it) {
 			progress_rotations++;
 
+			std::vector<std::string> maps = getSinglePassMaps(map_it->first, *rotation_it);
+			if (maps[0] != map_it->first) {
+				LOG(INFO) << "[" << progress_maps << "." << progress_rotations << "/"
+					<< progress_maps << "." << progress_rotations_all << "] "
+					<< "Rotation " << config::ROTATION_NAMES[*rotation_it]
+					<< " was rendered together with map " << maps[0] << ".";
+				continue;
+			}
+
 			LOG(INFO) << "[" << progress_maps << "." << progress_rotations << "/"
 				<< progress_maps << "." << progress_rotations_all << "] "
 				<< "Rendering rotation " << config::ROTATION_NAMES[*rotation_it] << "...";
@@ -393,9 +2288,15 @@ bool RenderManager::run(int threads, bool batch) {
 
 			util::LogOutputProgressHandler* log_output = new util::LogOutputProgressHandler;
 			progress->addHandler(log_output);
+			std::unique_ptr<util::MetricsFileProgressHandler> metrics;
+			if (!metrics_file.empty()) {
+				metrics.reset(new util::MetricsFileProgressHandler(metrics_file.string(),
+						metrics_interval));
+				progress->addHandler(metrics.get());
+			}
 
 			std::time_t time_start = std::time(nullptr);
-			renderMap(map_config.getShortName(), *rotation_it, threads, progress.get());
+			renderMaps(maps, *rotation_it, threads, progress.get());
 			std::time_t took = std::time(nullptr) - time_start;
 
 			if (progress_bar != nullptr) {
@@ -411,10 +2312,140 @@ bool RenderManager::run(int threads, bool batch) {
 		}
 	}
 
-	std::time_t took_all = std::time(nullptr) - time_start_all;
-	LOG(INFO) << "Rendering all worlds took " << took_all << " seconds.";
-	LOG(INFO) << "Finished.....aaand it's gone!";
-	return true;
+}
+
+void RenderManager::renderConcurrently(int threads, bool batch) {
+	// the maps/rotations to render, and the tile sets used by the ones being rendered,
+	// the rotations of maps which use the same tile set are not rendered at the same
+	// time because they change which tiles of the tile set are required
+	std::vector<std::pair<std::string, int> > renders;
+	for (auto map_it = required_maps.begin(); map_it != required_maps.end(); ++map_it)
+		for (auto rotation_it = map_it->second.begin();
+				rotation_it != map_it->second.end(); ++rotation_it)
+			if (getSinglePassMaps(map_it->first, *rotation_it)[0] == map_it->first)
+				renders.push_back(std::make_pair(map_it->first, *rotation_it));
+	std::vector<bool> started(renders.size(), false);
+	std::set<config::TileSetID> used_tile_sets;
+	thread_ns::mutex renders_mutex;
+	thread_ns::condition_variable render_finished;
+
+	int renderers = std::max(1, std::min<int>(concurrent_renders, renders.size()));
+	LOG(INFO) << "Rendering " << renders.size() << " maps/rotations, " << renderers
+			<< " at the same time.";
+
+	// all renders show their progress together
+	util::MultiplexingProgressHandler progress;
+	std::unique_ptr<util::ProgressBar> progress_bar;
+	if (batch || !util::isOutTTY()) {
+		util::Logging::getInstance().setSinkLogProgress("__output__", true);
+	} else {
+		progress_bar.reset(new util::ProgressBar);
+		progress.addHandler(progress_bar.get());
+	}
+	util::LogOutputProgressHandler log_output;
+	progress.addHandler(&log_output);
+	std::unique_ptr<util::MetricsFileProgressHandler> metrics;
+	if (!metrics_file.empty()) {
+		metrics.reset(new util::MetricsFileProgressHandler(metrics_file.string(),
+				metrics_interval));
+		progress.addHandler(metrics.get());
+	}
+	thread_ns::mutex progress_mutex;
+
+	// every renderer renders one map/rotation after another with its share of the threads
+	auto renderer = [&](int render_threads) {
+		while (true) {
+			size_t index = 0;
+			{
+				thread_ns::unique_lock<thread_ns::mutex> lock(renders_mutex);
+				while (true) {
+					bool all_started = true;
+					for (index = 0; index < renders.size(); index++) {
+						if (started[index])
+							continue;
+						all_started = false;
+						config::MapSection map_config = config.getMap(renders[index].first);
+						if (!used_tile_sets.count(map_config.getTileSet(renders[index].second)))
+							break;
+					}
+					if (all_started)
+						return;
+					if (index < renders.size())
+						break;
+					render_finished.wait(lock);
+				}
+				started[index] = true;
+				used_tile_sets.insert(config.getMap(renders[index].first)
+						.getTileSet(renders[index].second));
+			}
+
+			const std::string& map = renders[index].first;
+			int rotation = renders[index].second;
+			LOG(INFO) << "Rendering rotation " << config::ROTATION_NAMES[rotation]
+				<< " of map " << map << "...";
+			util::ChildProgressHandler render_progress(&progress, progress_mutex);
+			std::time_t time_start = std::time(nullptr);
+			renderMaps(getSinglePassMaps(map, rotation), rotation, render_threads,
+					&render_progress);
+			std::time_t took = std::time(nullptr) - time_start;
+			LOG(INFO) << "Rendering rotation " << config::ROTATION_NAMES[rotation]
+				<< " of map " << map << " took " << took << " seconds.";
+
+			thread_ns::unique_lock<thread_ns::mutex> lock(renders_mutex);
+			used_tile_sets.erase(config.getMap(map).getTileSet(rotation));
+			render_finished.notify_all();
+		}
+	};
+
+	std::vector<thread_ns::thread> renderer_threads;
+	for (int i = 0; i < renderers; i++)
+		renderer_threads.push_back(thread_ns::thread(renderer,
+				std::max(1, threads / renderers + (i < threads % renderers ? 1 : 0))));
+	for (size_t i = 0; i < renderer_threads.size(); i++)
+		renderer_threads[i].join();
+
+	if (progress_bar)
+		progress_bar->finish();
+}
+
+RenderManager::RegionFiles RenderManager::getRegionFiles() const {
+	std::set<std::string> world_names;
+	auto config_maps = config.getMaps();
+	for (auto map_it = config_maps.begin(); map_it != config_maps.end(); ++map_it)
+		if (!render_behaviors.isCompleteRenderSkip(map_it->getShortName()))
+			world_names.insert(map_it->getWorld());
+
+	RegionFiles region_files;
+	for (auto it = world_names.begin(); it != world_names.end(); ++it) {
+		config::WorldSection world_config = config.getWorld(*it);
+		mc::World world(world_config.getInputDir().string(), world_config.getDimension());
+		boost::system::error_code error;
+		fs::directory_iterator dir_it(world.getRegionDir(), error);
+		for (; !error && dir_it != fs::directory_iterator(); dir_it.increment(error)) {
+			std::string filename = dir_it->path().string();
+			std::pair<std::time_t, uint64_t> file;
+			if (dir_it->path().extension() == ".mca"
+					&& mc::RegionIndex::stat(filename, file.first, file.second))
+				region_files[filename] = file;
+		}
+	}
+	return region_files;
+}
+
+std::vector<std::string> RenderManager::getSinglePassMaps(const std::string& map,
+		int rotation) const {
+	if (!single_pass)
+		return std::vector<std::string>(1, map);
+	config::TileSetID tile_set = config.getMap(map).getTileSet(rotation);
+	std::vector<std::string> maps;
+	for (auto map_it = required_maps.begin(); map_it != required_maps.end(); ++map_it) {
+		if (!map_it->second.count(rotation))
+			continue;
+		config::TileSetID other = config.getMap(map_it->first).getTileSet(rotation);
+		if (!(other < tile_set) && !(tile_set < other))
+			maps.push_back(map_it->first);
+	}
+	return maps;
 }
 
 const std::vector<std::pair<std::string, std::set<int> > >& RenderManager::getRequiredMaps() const {
@@ -499,7 +2530,7 @@ void RenderManager::writeTemplates() const {
 	}
 }
 
-void RenderManager::initializeMap(const std::string& map) {
+bool RenderManager::initializeMap(const std::string& map) {
 	config::MapSection map_config = config.getMap(map);
 
 	// get the max zoom level calculated of the current tile set
@@ -507,6 +2538,7 @@ void RenderManager::initializeMap(const std::string& map) {
 	// get the old max zoom level (from config.js), will be 0 if not rendered yet
 	int old_max_zoom = web_config.getMapMaxZoom(map);
 	// if map already rendered: check if the zoom level of the world has increased
+	std::vector<fs::path> output_dirs;
 	if (old_max_zoom != 0 && old_max_zoom < max_zoom) {
 		LOG(INFO) << "The max zoom level was increased from " << old_max_zoom
 				<< " to " << max_zoom << ".";
@@ -517,8 +2549,16 @@ void RenderManager::initializeMap(const std::string& map) {
 		for (auto rotation_it = rotations.begin(); rotation_it != rotations.end(); ++rotation_it) {
 			fs::path output_dir = config.getOutputPath(map + "/"
 					+ config::ROTATION_NAMES_SHORT[*rotation_it]);
-			for (int i = old_max_zoom; i < max_zoom; i++)
-				increaseMaxZoom(output_dir, map_config.getImageFormatSuffix());
+			// the thumbnails are not moved, they are saved again with the tiles
+			boost::system::error_code error;
+			fs::remove_all(output_dir / THUMBNAILS_DIR, error);
+			if (!increaseMaxZoom(createTileStore(map_config, output_dir),
+					createOutputStores(map_config, output_dir), map_config,
+					old_max_zoom, max_zoom)) {
+				LOG(ERROR) << "Unable to increase the max zoom level of map " << map << ".";
+				return false;
+			}
+			output_dirs.push_back(output_dir);
 		}
 	}
 
@@ -526,105 +2566,201 @@ void RenderManager::initializeMap(const std::string& map) {
 	// (calculated with tile set in scanWorlds-method)
 	web_config.setMapMaxZoom(map, max_zoom);
 	web_config.writeConfigJS();
+	// the web config has the new max zoom level now
+	for (auto it = output_dirs.begin(); it != output_dirs.end(); ++it) {
+		boost::system::error_code error;
+		fs::remove(*it / INCREASE_ZOOM_FILE, error);
+	}
+	return true;
+}
+
+std::shared_ptr<TextureResources> RenderManager::getTextures(
+		const config::MapSection& map_config, int threads, int texture_size) {
+	if (texture_size == 0)
+		texture_size = map_config.getTextureSize();
+	return resource_registry->getTextures(map_config.getTextureDir().string(), texture_size,
+			map_config.getTextureBlur(), map_config.getWaterOpacity(), threads);
+}
+
+void RenderManager::addCacheStats(const std::string& map, int rotation,
+		const mc::CacheStats& region_stats, const mc::CacheStats& chunk_stats) {
+	LOG(INFO) << "Region cache: " << formatCacheStats(region_stats, false);
+	LOG(INFO) << "Chunk cache: " << formatCacheStats(chunk_stats, true);
+
+	picojson::object json;
+	json["map"] = picojson::value(map);
+	json["rotation"] = picojson::value(config::ROTATION_NAMES_SHORT[rotation]);
+	json["regionCache"] = cacheStatsToJSON(region_stats);
+	json["chunkCache"] = cacheStatsToJSON(chunk_stats);
+	cache_stats.push_back(picojson::value(json));
+}
+
+void RenderManager::addProfile(const std::vector<std::string>& maps, int rotation,
+		const std::map<std::string, util::ProfileTimes>& times_before) {
+	// the times of the threads while rendering these maps, with concurrent renders
+	// the times of the other maps rendered meanwhile are included
+	std::map<std::string, util::ProfileTimes> times = util::Profiler::getThreadTimes();
+	util::ProfileTimes total;
+	picojson::object threads_json;
+	for (auto it = times.begin(); it != times.end(); ++it) {
+		auto before = times_before.find(it->first);
+		if (before != times_before.end())
+			it->second -= before->second;
+		total += it->second;
+		threads_json[it->first] = profileTimesToJSON(it->second);
+	}
+
+	std::string maps_str;
+	picojson::array maps_json;
+	for (auto it = maps.begin(); it != maps.end(); ++it) {
+		maps_str += (maps_str.empty() ? "" : ", ") + *it;
+		maps_json.push_back(picojson::value(*it));
+	}
+	LOG(INFO) << "Time spent rendering " << maps_str << " in rotation "
+			<< config::ROTATION_NAMES[rotation] << ": " << formatProfileTimes(total);
+	for (auto it = times.begin(); it != times.end(); ++it)
+		if (it->second.getTotal() > 0)
+			LOG(INFO) << "  Thread " << it->first << ": " << formatProfileTimes(it->second);
+
+	picojson::object json;
+	json["maps"] = picojson::value(maps_json);
+	json["rotation"] = picojson::value(config::ROTATION_NAMES_SHORT[rotation]);
+	json["total"] = profileTimesToJSON(total);
+	json["threads"] = picojson::value(threads_json);
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	profiles.push_back(picojson::value(json));
+}
+
+void RenderManager::writeCollectedSigns() const {
+	for (auto it = sign_collectors.begin(); it != sign_collectors.end(); ++it) {
+		if (it->second->size() == 0)
+			continue;
+		config::WorldSection world_config = config.getWorld(it->first);
+		mc::World world(world_config.getInputDir().string(), world_config.getDimension());
+		world.setCacheDir(world_config.getRemoteCacheDir());
+		if (!world.load())
+			continue;
+		mc::WorldEntitiesCache entities(world);
+		if (!entities.addCollectedSigns(*it->second))
+			LOG(WARNING) << "Unable to write the collected signs of world " << it->first
+					<< ".";
+	}
+}
+
+void RenderManager::writeCacheStats() const {
+	if (cache_stats_file.empty())
+		return;
+	std::ofstream out(cache_stats_file.string());
+	if (!out) {
+		LOG(ERROR) << "Unable to write cache statistics file " << cache_stats_file << "!";
+		return;
+	}
+	out << picojson::value(cache_stats).serialize(true);
+	out.close();
+}
+
+void RenderManager::writeProfile() const {
+	if (profile_file.empty())
+		return;
+	std::ofstream out(profile_file.string());
+	if (!out) {
+		LOG(ERROR) << "Unable to write profile file " << profile_file << "!";
+		return;
+	}
+	out << picojson::value(profiles).serialize(true);
+	out.close();
+}
+
+void RenderManager::writeBlockProfile() const {
+	if (block_profile_file.empty())
+		return;
+	std::ofstream out(block_profile_file.string());
+	if (!out) {
+		LOG(ERROR) << "Unable to write block profile file " << block_profile_file << "!";
+		return;
+	}
+	BlockProfiler::writeReport(out);
+	out.close();
+}
+
+void RenderManager::writeTrace() const {
+	if (!trace_file.empty() && !util::Profiler::writeTrace(trace_file.string()))
+		LOG(ERROR) << "Unable to write trace file " << trace_file << "!";
 }
 
 /**
  * This method increases the max zoom of a rendered map and makes the necessary changes
  * on the tile tree.
  */
-void RenderManager::increaseMaxZoom(const fs::path& dir,
-		std::string image_format, int jpeg_quality) const {
-	if (fs::exists(dir / "1")) {
-		// at first rename the directories 1 2 3 4 (zoom level 0) and make new directories
-		util::moveFile(dir / "1", dir / "1_");
-		fs::create_directories(dir / "1");
-		// then move the old tile trees one zoom level deeper
-		util::moveFile(dir / "1_", dir / "1/4");
-		// also move the images of the directories
-		util::moveFile(dir / (std::string("1.") + image_format),
-				dir / (std::string("1/4.") + image_format));
-	}
-
-	// do the same for the other directories
-	if (fs::exists(dir / "2")) {
-		util::moveFile(dir / "2", dir / "2_");
-		fs::create_directories(dir / "2");
-		util::moveFile(dir / "2_", dir / "2/3");
-		util::moveFile(dir / (std::string("2.") + image_format),
-				dir / (std::string("2/3.") + image_format));
-	}
-	
-	if (fs::exists(dir / "3")) {
-		util::moveFile(dir / "3", dir / "3_");
-		fs::create_directories(dir / "3");
-		util::moveFile(dir / "3_", dir / "3/2");
-		util::moveFile(dir / (std::string("3.") + image_format),
-				dir / (std::string("3/2.") + image_format));
-	}
-	
-	if (fs::exists(dir / "4")) {
-		util::moveFile(dir / "4", dir / "4_");
-		fs::create_directories(dir / "4");
-		util::moveFile(dir / "4_", dir / "4/1");
-		util::moveFile(dir / (std::string("4.") + image_format),
-				dir / (std::string("4/1.") + image_format));
-	}
-
-	// now read the images, which belong to the new directories
-	RGBAImage img1, img2, img3, img4;
-	if (image_format == "png") {
-		img1.readPNG((dir / "1/4.png").string());
-		img2.readPNG((dir / "2/3.png").string());
-		img3.readPNG((dir / "3/2.png").string());
-		img4.readPNG((dir / "4/1.png").string());
-	} else {
-		img1.readJPEG((dir / "1/4.jpg").string());
-		img2.readJPEG((dir / "2/3.jpg").string());
-		img3.readJPEG((dir / "3/2.jpg").string());
-		img4.readJPEG((dir / "4/1.jpg").string());
-	}
-
-	int s = img1.getWidth();
-	// create images for the new directories
-	RGBAImage new1(s, s), new2(s, s), new3(s, s), new4(s, s);
-	RGBAImage old1, old2, old3, old4;
-	// resize the old images...
-	img1.resize(old1, 0, 0, InterpolationType::HALF);
-	img2.resize(old2, 0, 0, InterpolationType::HALF);	
-	img3.resize(old3, 0, 0, InterpolationType::HALF);
-	img4.resize(old4, 0, 0, InterpolationType::HALF);
-
-	// ...to blit them to the images of the new directories
-	new1.simpleAlphaBlit(old1, s/2, s/2);
-	new2.simpleAlphaBlit(old2, 0, s/2);
-	new3.simpleAlphaBlit(old3, s/2, 0);
-	new4.simpleAlphaBlit(old4, 0, 0);
-
-	// now save the new images in the output directory
-	if (image_format == "png") {
-		new1.writePNG((dir / "1.png").string());
-		new2.writePNG((dir / "2.png").string());
-		new3.writePNG((dir / "3.png").string());
-		new4.writePNG((dir / "4.png").string());
-	} else {
-		new1.writeJPEG((dir / "1.jpg").string(), jpeg_quality);
-		new2.writeJPEG((dir / "2.jpg").string(), jpeg_quality);
-		new3.writeJPEG((dir / "3.jpg").string(), jpeg_quality);
-		new4.writeJPEG((dir / "4.jpg").string(), jpeg_quality);
-	}
-
-	// don't forget the base.png
-	RGBAImage base(2*s, 2*s);
-	base.simpleAlphaBlit(new1, 0, 0);
-	base.simpleAlphaBlit(new2, s, 0);
-	base.simpleAlphaBlit(new3, 0, s);
-	base.simpleAlphaBlit(new4, s, s);
-	base = base.resize(0, 0, InterpolationType::HALF);
-	if (image_format == "png")
-		base.writePNG((dir / "base.png").string());
-	else
-		base.writeJPEG((dir / "base.jpg").string(), jpeg_quality);
-}
+bool RenderManager::increaseMaxZoom(std::shared_ptr<TileStore> store,
+		const std::vector<std::shared_ptr<TileStore> >& output_stores,
+		const config::MapSection& map_config, int old_max_zoom, int max_zoom) const {
+	// the zoom level of the moved tiles and whether the top tiles are written already,
+	// the zoom level is saved after the tiles are moved, and before the store removes
+	// what's left of the move, so it is never moved twice
+	fs::path progress_file = store->getOutputDir() / INCREASE_ZOOM_FILE;
+	int depth = old_max_zoom;
+	bool composed = true;
+	std::ifstream in(progress_file.string().c_str());
+	int saved_depth, saved_composed;
+	if (in >> saved_depth >> saved_composed && saved_depth >= old_max_zoom
+			&& saved_depth <= max_zoom) {
+		depth = saved_depth;
+		composed = saved_composed != 0;
+	}
+	in.close();
+
+	while (depth < max_zoom || !composed) {
+		if (composed) {
+			// move the tiles one zoom level deeper, 1/ becomes 1/4/, 2/ becomes 2/3/ and
+			// so on, these are just a few renames
+			if (!store->increaseDepth())
+				return false;
+			for (auto it = output_stores.begin(); it != output_stores.end(); ++it)
+				if (!(*it)->increaseDepth())
+					return false;
+			depth++;
+			composed = false;
+			if (!writeIncreaseZoomProgress(progress_file, depth, composed))
+				return false;
+		}
+		store->finishIncreaseDepth();
+		for (auto it = output_stores.begin(); it != output_stores.end(); ++it)
+			(*it)->finishIncreaseDepth();
+
+		// now compose the new top tiles like the composite tiles, the tiles of zoom
+		// level 1 have only one child tile (the tile they were before), the base tile
+		// is made of them, the writer encodes them in parallel
+		TileWriter writer(map_config, config.getBackgroundColor(), 4, store);
+		const std::vector<config::TileOutput>& outputs = map_config.getAdditionalOutputs();
+		for (size_t i = 0; i < outputs.size() && i < output_stores.size(); i++)
+			writer.addOutput(outputs[i], output_stores[i]);
+		RGBAImage top_images[4];
+		int size = 0;
+		for (int i = 1; i <= 4; i++) {
+			RGBAImage child;
+			if (!writer.readImage(TilePath() + i + (5 - i), child))
+				continue;
+			RGBAImage& image = top_images[i - 1];
+			image.setSize(child.getWidth(), child.getHeight());
+			TileRenderWorker::blitChildTile(5 - i, child, image);
+			writer.write(TilePath() + i, image, true);
+			size = std::max(size, image.getWidth());
+		}
+		if (size > 0) {
+			RGBAImage base(size, size);
+			for (int i = 1; i <= 4; i++)
+				if (top_images[i - 1].getWidth() == size)
+					TileRenderWorker::blitChildTile(i, top_images[i - 1], base);
+			writer.write(TilePath(), base, true);
+		}
+		writer.finish();
 
+		composed = true;
+		if (!writeIncreaseZoomProgress(progress_file, depth, composed))
+			return false;
+	}
+	return true;
+}
 }
 }
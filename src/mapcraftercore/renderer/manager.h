@@ -20,16 +20,31 @@
 #ifndef MANAGER_H_
 #define MANAGER_H_
 
+#include "renderjournal.h"
+#include "resourceregistry.h"
 #include "tilerenderer.h"
+#include "tilehashindex.h"
+#include "tilerenderworker.h"
 #include "tileset.h"
+#include "tilestore.h"
+#include "tileuploader.h"
 #include "../config/mapcrafterconfig.h"
 #include "../config/webconfig.h"
+#include "../compat/thread.h"
+#include "../mc/chunkhashindex.h"
 #include "../mc/world.h"
 #include "../mc/worldcache.h"
+#include "../mc/worldentities.h"
+#include "../thread/impl/threadpool.h"
+#include "../util/picojson.h"
 
+#include <atomic>
 #include <ctime>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
+#include <tuple>
 #include <vector>
 #include <boost/filesystem.hpp>
 
@@ -43,17 +58,66 @@ class IProgressHandler;
 
 namespace renderer {
 
+class BlockImages;
+class RenderView;
+class TextureResources;
+class TileCache;
+
 /**
  * This are the render options from the command line.
  */
 struct RenderOpts {
 	fs::path logging_config;
 	bool batch;
+	fs::path cache_stats;
+	fs::path profile;
+	// file to write the costs of the block types to, and every how many blocks one is
+	// sampled
+	fs::path block_profile;
+	int block_profile_sampling;
+	fs::path trace;
+	fs::path metrics_file;
+	int metrics_interval;
+	// seconds after which a render tile is logged as slow, 0 to not log slow tiles
+	double slow_tiles;
 
 	fs::path config;
+	// file with the configuration files to render as service, and the seconds of the
+	// turns of them
+	fs::path service;
+	int service_slice;
 	std::vector<std::string> render_skip, render_auto, render_force;
 	bool skip_all, force_all;
 	int jobs;
+	int concurrent_renders;
+	bool single_pass;
+	// memory limit of the caches in MiB, 0 for no limit
+	int memory_limit;
+	// whether the render threads are pinned to the CPUs
+	bool pin_threads;
+	// whether the chunk caches, block images and tile images use huge pages
+	bool huge_pages;
+	// seconds after which no new tiles are rendered, 0 for no limit
+	int max_time;
+	// file with the changed chunks of the worlds, empty if they are scanned
+	fs::path changed_chunks;
+
+	// the shard to render (0 to shards-1), and whether the shards are merged
+	int shard, shards;
+	bool merge_shards;
+	// seconds between the checks for modified worlds in watch mode, 0 for no watch mode
+	int watch;
+	// whether the required tiles and the time to render them are only estimated
+	bool plan;
+	// whether the tile widths and chunk cache sizes of the maps are only tuned
+	bool tune;
+	// whether the stable tiles are only recompressed, and the days after which a tile
+	// is stable
+	bool optimize_tiles;
+	int optimize_age;
+	// whether the composite tiles are only composed again, or all tiles are only
+	// encoded again
+	bool recomposite, reencode;
 };
 
 /**
@@ -97,6 +161,12 @@ public:
 	 */
 	bool isCompleteRenderSkip(const std::string& map) const;
 
+	/**
+	 * Changes the force-render behaviors to auto-render, for example for the renderings
+	 * after the first one in watch mode.
+	 */
+	void resetForceRender();
+
 	/**
 	 * Parses the render behaviors of the maps from the command line arguments.
 	 */
@@ -123,6 +193,153 @@ public:
 	 */
 	void setRenderBehaviors(const RenderBehaviors& render_behaviors);
 
+	/**
+	 * Sets a JSON file to write the cache statistics of all rendered maps/rotations to
+	 * when the rendering is finished. An empty path disables this.
+	 */
+	void setCacheStatsFile(const fs::path& cache_stats_file);
+
+	/**
+	 * Sets a JSON file to write the time spent in the stages of the rendering (see
+	 * util::Profiler) of all rendered maps/rotations to, and enables the profiler. The
+	 * times are also logged after rendering each map/rotation. An empty path disables
+	 * this.
+	 */
+	void setProfileFile(const fs::path& profile_file);
+
+	/**
+	 * Sets a file to write the render time and blits of the block types (see
+	 * BlockProfiler) to when the rendering is finished, and enables the block profiler
+	 * which measures one in sampling blocks. An empty path disables this.
+	 */
+	void setBlockProfileFile(const fs::path& block_profile_file, int sampling);
+
+	/**
+	 * Sets a JSON file to write the trace events of the rendering (work units, tiles,
+	 * chunk loads, waiting threads, see util::TraceScope) to when the rendering is
+	 * finished, and enables tracing. An empty path disables this.
+	 */
+	void setTraceFile(const fs::path& trace_file);
+
+	/**
+	 * Sets a file to rewrite with the progress and the metrics of the rendering (see
+	 * util::MetricsFileProgressHandler) every interval seconds, and enables the
+	 * metrics. An empty path disables this.
+	 */
+	void setMetricsFile(const fs::path& metrics_file, int interval);
+
+	/**
+	 * Sets after how many seconds a render tile is logged as slow, with the count of its
+	 * chunks and drawn blocks (see SlowTileLog). The slowest tiles are summarized at the
+	 * end of the rendering. 0 disables this.
+	 */
+	void setSlowTileTime(double slow_tile_time);
+
+	/**
+	 * Renders only one of several shards of the maps, for example to render the maps on
+	 * multiple machines which share the world and output directories. The shards are
+	 * numbered from 0 to shards-1. The render manager doesn't update the files shared by
+	 * the shards (config.js, chunk hashes, etc.) then, this is done when the shards are
+	 * merged.
+	 */
+	void setShard(int shard, int shards);
+
+	/**
+	 * Renders only the composite tiles above the shards of the maps after all shards
+	 * were rendered, the tiles of the shards are read from disk.
+	 */
+	void setMergeShards(bool merge_shards);
+
+	/**
+	 * Sets how many maps/rotations the run method renders at the same time. The threads
+	 * are split between them, so small maps and the end of rendering a map/rotation
+	 * don't leave most of the threads idle. The default is one map/rotation after another.
+	 */
+	void setConcurrentRenders(int concurrent_renders);
+
+	/**
+	 * Sets whether the run method renders the maps with the same world, render view,
+	 * tile width and rotation in one pass. The maps are rendered job by job then, so the
+	 * chunks of a job are read and decoded only once for all of these maps.
+	 */
+	void setSinglePass(bool single_pass);
+
+	/**
+	 * Sets how much memory (in bytes) the caches and tile images of all renders may use
+	 * together. The caches are made smaller to fit, 0 means no limit.
+	 */
+	void setMemoryLimit(size_t memory_limit);
+
+	/**
+	 * Sets whether the render threads are pinned to the CPUs, see
+	 * thread::Dispatcher::setPinThreads.
+	 */
+	void setPinThreads(bool pin_threads);
+
+	/**
+	 * Sets after how many seconds of the run method no new tiles are started. The tiles
+	 * being rendered and the composite tiles of the rendered tiles are still finished,
+	 * the remaining tiles stay required and are rendered by the next run. 0 means no
+	 * time limit.
+	 */
+	void setMaxTime(int max_time);
+
+	/**
+	 * Sets the chunks of the worlds which changed since the last rendering (world name
+	 * -> chunks in the original rotation of the world), for example because a server
+	 * reports them. The incremental renderings render only the tiles of these chunks
+	 * (and the composite tiles above them) then instead of scanning the timestamps of
+	 * all chunks or the modification times of all tiles, the maps of the other worlds
+	 * are up to date.
+	 */
+	void setChangedChunks(
+			const std::map<std::string, std::set<mc::ChunkPos> >& changed_chunks);
+
+	/**
+	 * Reads changed chunks for setChangedChunks from a file, every line is the name of a
+	 * world section and the x and z coordinates of a chunk. Empty lines and lines
+	 * starting with # are ignored. Returns false if the file can't be read or has an
+	 * invalid line.
+	 */
+	static bool readChangedChunks(const fs::path& file,
+			std::map<std::string, std::set<mc::ChunkPos> >& changed_chunks);
+
+	/**
+	 * Sets the tiles to render, the required render tiles of the maps are only the ones
+	 * in these tiles (and the composite tiles above them). The maps are not up to date
+	 * after such a rendering, their last render times are kept, so the next rendering
+	 * renders their other tiles too. Empty sets (the default) render the whole maps.
+	 */
+	void setRequestedTiles(const std::set<TilePath>& requested_tiles);
+
+	/**
+	 * Sets a flag which stops rendering once it's set, like the time limit (see
+	 * setMaxTime): The tiles being rendered and their composite tiles are finished, the
+	 * remaining tiles stay required. Null (the default) means no flag.
+	 */
+	void setStopFlag(const std::atomic<bool>* stop_flag);
+
+	/**
+	 * Sets a function called with the map, rotation and path of every tile once it's
+	 * written (or kept because its image didn't change). It's called by the threads
+	 * writing the tiles, so it has to be thread-safe.
+	 */
+	typedef std::function<void(const std::string&, int, const TilePath&)> TileCallback;
+	void setTileCallback(TileCallback tile_callback);
+
+	/**
+	 * Sets the render threads the run method uses instead of starting its own ones, for
+	 * example to share them with the render managers of other configurations. The
+	 * count of threads of the run method should be the size of the pool then.
+	 */
+	void setThreadPool(std::shared_ptr<thread::ThreadPool> thread_pool);
+
+	/**
+	 * Sets the registry of the textures and block images to use instead of the own one,
+	 * to share them with the render managers of other configurations.
+	 */
+	void setResourceRegistry(std::shared_ptr<ResourceRegistry> resource_registry);
+
 	/**
 	 * Some basic initialization things. blah.
 	 * 
@@ -132,12 +349,12 @@ public:
 	bool initialize();
 
 	/**
-	 * Scans the worlds and create the tile sets.
+	 * Scans the worlds with a specified count of threads and create the tile sets.
 	 * 
 	 * Returns false if a fatal error occured (for example unable to read a world)
 	 * and rendering the maps won't work.
 	 */
-	bool scanWorlds();
+	bool scanWorlds(int threads = 1);
 
 	/**
 	 * Renders a map/rotation with a specified count of threads and logs the progress to
@@ -147,6 +364,14 @@ public:
 	void renderMap(const std::string& map, int rotation, int threads,
 			util::IProgressHandler* progress);
 
+	/**
+	 * Renders a rotation of multiple maps which use the same tile set. The maps whose
+	 * required tiles are the same are rendered in one pass, job by job, so they share
+	 * the decoded chunks.
+	 */
+	void renderMaps(const std::vector<std::string>& maps, int rotation, int threads,
+			util::IProgressHandler* progress);
+
 	/**
 	 * Does the whole rendering work by calling initialize, scanWorlds and renderMap
 	 * for every map/rotation and outputs some additional progress information.
@@ -156,12 +381,215 @@ public:
 	 */
 	bool run(int threads, bool batch);
 
+	/**
+	 * Returns whether the last run stopped rendering a map/rotation because of the time
+	 * limit (see setMaxTime), so the next run has to continue it.
+	 */
+	bool wasStopped() const;
+
+	/**
+	 * Renders the maps like the run method, and keeps watching the region files of the
+	 * worlds afterwards. The maps are rendered again (incrementally) whenever region
+	 * files were modified, the region files are checked every interval seconds. A
+	 * rendering starts once the region files were not modified for one interval, or
+	 * after a few intervals if the world is saved all the time. Returns false only if
+	 * a rendering fails.
+	 */
+	bool watch(int threads, bool batch, int interval);
+
+	/**
+	 * Scans the worlds and which tiles of the maps/rotations need to get rendered, and
+	 * estimates how long rendering them with a count of threads takes. The times are
+	 * measured by rendering a few of the required tiles of every map/rotation, nothing
+	 * is written to the output directory.
+	 */
+	bool plan(int threads);
+
+	/**
+	 * Scans the worlds and renders the same sample area of every map (in its first
+	 * required rotation) with different tile widths and chunk cache sizes, and logs the
+	 * times and chunk cache hit rates of them and recommends the fastest combination.
+	 * The configuration isn't changed and nothing is written to the output directory.
+	 */
+	bool tune(int threads);
+
+	/**
+	 * Recompresses the PNG tiles of the rendered maps/rotations which were not written
+	 * for min_age seconds with the best compression, in the background: The process
+	 * gets the lowest priority and the threads pause while the other processes keep all
+	 * CPUs busy (according to the load average). A tile is only replaced by a smaller encoding of the same
+	 * pixels, and it keeps its modification time, so the incremental renderings don't
+	 * consider it changed. The checked tiles are remembered and checked again only once
+	 * they were written again. The maps which are skipped in the render behaviors are
+	 * skipped here too.
+	 */
+	bool optimizeTiles(int threads, int min_age);
+
+	/**
+	 * Composes the composite tiles of the rendered maps/rotations again of their render
+	 * tiles, without scanning the worlds (for example to repair composite tiles). The
+	 * maps which are skipped in the render behaviors are skipped here too.
+	 */
+	bool recompositeTiles(int threads);
+
+	/**
+	 * Encodes the tiles of the rendered maps/rotations again with the image format and
+	 * quality of the configuration file (and the additional outputs), without scanning
+	 * the worlds. The tiles are decoded from the image format they were rendered with
+	 * last time and keep their modification times. The maps which are skipped in the
+	 * render behaviors are skipped here too.
+	 */
+	bool reencodeTiles(int threads);
+
+	/**
+	 * Prepares rendering the tiles of the maps on demand with renderTile instead of
+	 * rendering the maps completely: Scans the worlds and which tiles are older than
+	 * their chunks (or missing), these are rendered once they are requested. The
+	 * tiles are rendered with the specified count of threads.
+	 */
+	bool prepareOnDemand(int threads);
+
+	/**
+	 * Returns the image data of a tile of a map/rotation prepared with prepareOnDemand.
+	 * The tile is rendered first if it's outdated, a composite tile is composed of its
+	 * children, and the outdated ones of them are rendered as well. Returns false if the
+	 * map/rotation or the tile does not exist. Can be called by multiple threads, they
+	 * render the tiles one after another.
+	 */
+	bool renderTile(const std::string& map, int rotation, const TilePath& tile,
+			std::string& data);
+
 	/**
 	 * Returns which maps with which rotations need to get rendered.
 	 */
 	const std::vector<std::pair<std::string, std::set<int> > >& getRequiredMaps() const;
 
+	/**
+	 * The region files of the worlds: filename -> (modification time, size).
+	 */
+	typedef std::map<std::string, std::pair<std::time_t, uint64_t> > RegionFiles;
+
+	/**
+	 * Returns the region files of the worlds of the maps which are not skipped.
+	 */
+	RegionFiles getRegionFiles() const;
+
 private:
+	/**
+	 * Everything needed to render a map/rotation and to finish it afterwards.
+	 */
+	struct MapRendering {
+		std::string map;
+		int rotation;
+
+		std::shared_ptr<RenderView> render_view;
+		std::shared_ptr<TextureResources> textures;
+		std::shared_ptr<BlockImages> block_images;
+		std::shared_ptr<TileStore> tile_store;
+		RenderContext context;
+		std::vector<RenderWork> render_work;
+
+		// the required render and composite tiles of the tile set for this map/rotation
+		std::set<TilePos> required_tiles;
+		std::set<TilePath> required_composite_tiles;
+		mc::ChunkHashIndex chunk_hashes;
+		// the written tiles, to resume the rendering if it's interrupted
+		std::shared_ptr<RenderJournal> journal;
+		// the hashes of the images of the tiles, to not write unchanged tiles again
+		std::shared_ptr<TileHashIndex> tile_hashes;
+		// the half-size images of the written tiles, to compose the composite tiles of them
+		std::shared_ptr<TileStore> thumbnails;
+		// the stores of the additional outputs of the map
+		std::vector<std::shared_ptr<TileStore> > output_stores;
+		// uploads the written tiles to the bucket of the map
+		std::shared_ptr<TileUploader> uploader;
+		// the required render tiles as paths, if the tiles are rendered on demand
+		std::set<TilePath> required_tile_paths;
+	};
+
+	/**
+	 * Scans the required tiles of a map/rotation and creates everything to render it.
+	 * Returns false if there is nothing to render.
+	 */
+	bool prepareMap(const std::string& map, int rotation, int threads,
+			MapRendering& rendering);
+
+	/**
+	 * Scans which tiles of a map/rotation are required (the tile store of the rendering
+	 * has to be set), and reads the render journal and the chunk hashes for that. Nothing
+	 * in the output directory is changed.
+	 */
+	void scanRequiredTiles(MapRendering& rendering, int last_rendered);
+
+	/**
+	 * Returns whether the time limit is reached or the stop flag is set.
+	 */
+	bool isStopped() const;
+
+	/**
+	 * Renders (and encodes) a sample of the required render tiles of a scanned
+	 * map/rotation without writing them, and composes composite tiles of them. Returns
+	 * the seconds it took to create the block images and the average seconds of a
+	 * render and a composite tile, or false if the textures can't be loaded.
+	 */
+	bool measureRenderTimes(MapRendering& rendering, int threads, double& setup_time,
+			double& render_time, double& composite_time);
+
+	/**
+	 * Renders a coarse preview of a map/rotation which is rendered completely: The
+	 * composite tiles some zoom levels (preview_levels) above the render tiles are
+	 * rendered directly as the render tiles of a tile set with wider tiles and with
+	 * smaller textures, and the composite tiles above them are composed of them. The
+	 * actual rendering replaces the preview tiles afterwards. Returns whether the
+	 * preview was rendered.
+	 */
+	bool renderPreview(MapRendering& rendering, int threads,
+			util::IProgressHandler* progress);
+
+	/**
+	 * Renders a sample of the required render tiles of maps rendered together first if
+	 * one of them is progressive (progressive_levels): One render tile of every composite
+	 * tile some zoom levels above the render tiles, and provisional composite tiles above
+	 * them, which leave out the tiles not rendered yet. The other render tiles and all
+	 * composite tiles are left required for the actual rendering, which replaces the
+	 * provisional composite tiles as their children are done.
+	 */
+	void renderProgressive(const MapRendering& rendering,
+			const std::vector<RenderContext>& contexts, int threads,
+			util::IProgressHandler* progress);
+
+	/**
+	 * Waits until the tiles of a rendered map/rotation are written and updates the
+	 * cache statistics, chunk hashes and web config. The chunk hashes and the time of
+	 * the last rendering are not updated if not all required tiles were rendered.
+	 */
+	void finishMap(MapRendering& rendering, const mc::CacheStats& region_stats,
+			const mc::CacheStats& chunk_stats, bool complete);
+
+	/**
+	 * Composes the composite tiles of the rendered maps/rotations again, or encodes all
+	 * their tiles again (see recompositeTiles and reencodeTiles).
+	 */
+	bool rewriteTiles(int threads, bool reencode);
+
+	/**
+	 * Returns the maps which are rendered together with a rotation of a map, the first
+	 * one is the map which renders them. This is only the map itself if the maps are not
+	 * rendered in single passes.
+	 */
+	std::vector<std::string> getSinglePassMaps(const std::string& map, int rotation) const;
+
+	/**
+	 * Renders the required maps/rotations one after another, each with all threads.
+	 */
+	void renderSequentially(int threads, bool batch);
+
+	/**
+	 * Renders the required maps/rotations with multiple ones at the same time, they
+	 * share the threads and show their progress together.
+	 */
+	void renderConcurrently(int threads, bool batch);
+
 	/**
 	 * Copies a file from the template directory to the output directory and replaces the
 	 * variables from the map (every "{key}" in the file becomes "value").
@@ -187,21 +615,114 @@ private:
 
 	/**
 	 * Does some basic initialization work of a map (check if max zoom level of already
-	 * rendered map has increased for now).
+	 * rendered map has increased for now). Returns false if the map can't be rendered.
+	 */
+	bool initializeMap(const std::string& map);
+
+	/**
+	 * Increases the max zoom level of a map rotation (given as its tile store and the
+	 * stores of its additional outputs) from the old to the new max zoom level. The new
+	 * top tiles are composed from the moved ones with the image format of the map. The
+	 * progress is saved in the directory of the rotation, an interrupted increase is
+	 * continued from there the next time. Returns false if the tiles could not be moved.
 	 */
-	void initializeMap(const std::string& map);
+	bool increaseMaxZoom(std::shared_ptr<TileStore> store,
+			const std::vector<std::shared_ptr<TileStore> >& output_stores,
+			const config::MapSection& map_config, int old_max_zoom, int max_zoom) const;
 
 	/**
-	 * Increases the max zoom level of a map (given as directory, the one with base.png).
+	 * Returns the textures of a map, loaded with a count of threads. The textures are
+	 * loaded only once for all maps/rotations with the same texture settings (see
+	 * ResourceRegistry). Returns
+	 * nullptr if the textures could not be loaded. A texture size other than the one of
+	 * the map can be specified (0 to use the one of the map).
 	 */
-	void increaseMaxZoom(const fs::path& dir, std::string image_format,
-			int jpeg_quality = 85) const;
+	std::shared_ptr<TextureResources> getTextures(const config::MapSection& map_config,
+			int threads, int texture_size = 0);
+
+	/**
+	 * Logs the cache statistics of a rendered map/rotation and remembers them for the
+	 * cache statistics file.
+	 */
+	void addCacheStats(const std::string& map, int rotation,
+			const mc::CacheStats& region_stats, const mc::CacheStats& chunk_stats);
+
+	/**
+	 * Stores the signs collected while rendering in the entities caches of the worlds.
+	 */
+	void writeCollectedSigns() const;
+
+	/**
+	 * Writes the cache statistics of all rendered maps/rotations to the cache statistics
+	 * file (if one is set).
+	 */
+	void writeCacheStats() const;
+
+	/**
+	 * Logs the times the threads spent in the stages of the rendering since the
+	 * supplied times, while rendering a map/rotation (or multiple maps rendered
+	 * together), and remembers them for the profile file.
+	 */
+	void addProfile(const std::vector<std::string>& maps, int rotation,
+			const std::map<std::string, util::ProfileTimes>& times_before);
+
+	/**
+	 * Writes the times of all rendered maps/rotations to the profile file (if one is set).
+	 */
+	void writeProfile() const;
+
+	/**
+	 * Writes the costs of the block types to the block profile file, if there is one.
+	 */
+	void writeBlockProfile() const;
+
+	/**
+	 * Writes the recorded trace events to the trace file (if one is set).
+	 */
+	void writeTrace() const;
 
 	config::MapcrafterConfig config;
 	config::WebConfig web_config;
 
 	RenderBehaviors render_behaviors;
 
+	// the shard of the maps to render if there is more than one, and whether only the
+	// composite tiles above the shards are rendered
+	int shard, shards;
+	bool merge_shards;
+	// count of maps/rotations rendered at the same time
+	int concurrent_renders;
+	// whether maps with the same tile set are rendered in one pass
+	bool single_pass;
+	// memory limit of the caches in bytes, 0 for no limit
+	size_t memory_limit;
+	// whether the render threads are pinned to the CPUs
+	bool pin_threads;
+	// seconds of the run after which no new tiles are rendered (0 for no limit), and
+	// the time when that is
+	int max_time;
+	std::time_t stop_time;
+	// the flag which stops rendering (may be null), and whether the time limit or the
+	// flag stopped rendering a map/rotation
+	const std::atomic<bool>* stop_flag;
+	bool stopped;
+	// whether the changed chunks are known instead of scanned, and the changed chunks:
+	// world name -> chunks in the original rotation
+	bool use_changed_chunks;
+	std::map<std::string, std::set<mc::ChunkPos> > changed_chunks;
+	// the tiles to render, empty for the whole maps
+	std::set<TilePath> requested_tiles;
+	// the function called for every written tile, may be empty
+	TileCallback tile_callback;
+	// the render threads used for all maps and rotations, may be null, and whether
+	// they are shared with other render managers
+	std::shared_ptr<thread::ThreadPool> thread_pool;
+	bool shared_thread_pool;
+
+	// guards the web config and the cache statistics, which are used by
+	// multiple renders if maps are rendered concurrently
+	thread_ns::mutex mutex;
+
 	// time when we started scanning the worlds, used as last last render time of the maps
 	std::time_t time_started_scanning;
 	// set of initialized maps, initializeMap-method must be called for each map,
@@ -213,9 +734,64 @@ private:
 	// (world, render view, rotation) -> tile set
 	std::map<config::TileSetID, std::shared_ptr<TileSet> > tile_sets;
 
+	// decoded chunks in the original rotation shared between the rotations of a world,
+	// if the maps of the world use them: world name -> chunk cache
+	std::map<std::string, std::shared_ptr<mc::ChunkCache> > unrotated_chunk_caches;
+	// compacted chunks evicted from the chunk caches, shared between the maps of a world
+	// with the same rotation: (world name, rotation) -> compressed chunk cache
+	std::map<std::pair<std::string, int>, std::shared_ptr<mc::CompressedChunkCache> >
+		compressed_chunk_caches;
+	// geometry of the render tiles shared between the maps of a tile set:
+	// directory (tile set and key of the tile renderer options) -> tile store
+	std::map<std::string, std::shared_ptr<TileStore> > tile_geometry_stores;
+	// images of render tiles shared between the maps of all worlds with the same tile
+	// cache directory: directory -> tile cache
+	std::map<std::string, std::shared_ptr<TileCache> > tile_caches;
+	// decoded chunks shared with the other processes on this host, created for the first
+	// map using it, null if no map uses it or the segment couldn't be opened
+	std::shared_ptr<mc::SharedMemoryChunkCache> shared_memory_chunk_cache;
+	bool shared_memory_chunk_cache_failed;
+	// signs of the decoded chunks of the worlds which collect them:
+	// world name -> sign collector
+	std::map<std::string, std::shared_ptr<mc::SignCollector> > sign_collectors;
+
+	// the loaded textures and the block images, maybe shared with other render managers
+	std::shared_ptr<ResourceRegistry> resource_registry;
+
+	// the headers of the region files of the last scan and the broken regions and
+	// chunks of the worlds
+	std::shared_ptr<mc::RegionIndex> region_index;
+
 	// all required (= not skipped) maps and rotations
 	// as pair (map name, required rotations)
 	std::vector<std::pair<std::string, std::set<int> > > required_maps;
+
+	// file to write the cache statistics to, and the statistics of the rendered
+	// maps/rotations so far
+	fs::path cache_stats_file;
+	picojson::array cache_stats;
+	// the same for the profiler times
+	fs::path profile_file;
+	picojson::array profiles;
+	// file to write the costs of the block types to
+	fs::path block_profile_file;
+	// file to write the trace events to
+	fs::path trace_file;
+	// file to rewrite with the metrics, and the seconds between the writes
+	fs::path metrics_file;
+	int metrics_interval;
+	// the log of the slow render tiles of all maps/rotations, null if they aren't logged
+	std::shared_ptr<SlowTileLog> slow_tiles;
+
+	// whether the maps are only planned, nothing is written then
+	bool dry_run;
+
+	// whether the tiles are rendered on demand, the prepared maps/rotations for that,
+	// the count of threads to render them, and the lock of the renders
+	bool on_demand;
+	std::map<std::pair<std::string, int>, MapRendering> on_demand_maps;
+	int on_demand_threads;
+	thread_ns::mutex on_demand_mutex;
 };
 
 }
@@ -0,0 +1,416 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapexporter.h"
+
+#include "tileset.h"
+#include "tilestore.h"
+#include "tilewriter.h"
+#include "../compat/thread.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <png.h>
+#include <zlib.h>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// the TIFF tags and field types of the written images
+const uint16_t TIFF_IMAGE_WIDTH = 256;
+const uint16_t TIFF_IMAGE_LENGTH = 257;
+const uint16_t TIFF_BITS_PER_SAMPLE = 258;
+const uint16_t TIFF_COMPRESSION = 259;
+const uint16_t TIFF_PHOTOMETRIC = 262;
+const uint16_t TIFF_STRIP_OFFSETS = 273;
+const uint16_t TIFF_SAMPLES_PER_PIXEL = 277;
+const uint16_t TIFF_ROWS_PER_STRIP = 278;
+const uint16_t TIFF_STRIP_BYTE_COUNTS = 279;
+const uint16_t TIFF_PLANAR_CONFIG = 284;
+const uint16_t TIFF_PREDICTOR = 317;
+const uint16_t TIFF_EXTRA_SAMPLES = 338;
+
+const uint16_t TIFF_SHORT = 3;
+const uint16_t TIFF_LONG = 4;
+const uint16_t TIFF_LONG8 = 16;
+
+struct TIFFEntry {
+	uint16_t tag, type;
+	std::vector<uint64_t> values;
+};
+
+void appendLE(std::string& data, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		data += (char) ((value >> (8 * i)) & 0xff);
+}
+
+int getTypeSize(uint16_t type) {
+	return type == TIFF_SHORT ? 2 : (type == TIFF_LONG ? 4 : 8);
+}
+
+/**
+ * Serializes a TIFF image file directory at an offset in the file, the values which
+ * don't fit into the entries follow the directory.
+ */
+std::string serializeDirectory(const std::vector<TIFFEntry>& entries, uint64_t offset,
+		bool big) {
+	int offset_size = big ? 8 : 4;
+	size_t directory_size = big ? 8 + entries.size() * 20 + 8 : 2 + entries.size() * 12 + 4;
+	std::string directory, values;
+	appendLE(directory, entries.size(), big ? 8 : 2);
+	for (auto it = entries.begin(); it != entries.end(); ++it) {
+		int size = getTypeSize(it->type);
+		appendLE(directory, it->tag, 2);
+		appendLE(directory, it->type, 2);
+		appendLE(directory, it->values.size(), offset_size);
+		std::string* data = &directory;
+		if (it->values.size() * size > (size_t) offset_size) {
+			appendLE(directory, offset + directory_size + values.size(), offset_size);
+			data = &values;
+		}
+		size_t begin = data->size();
+		for (auto value_it = it->values.begin(); value_it != it->values.end(); ++value_it)
+			appendLE(*data, *value_it, size);
+		// the values in the entry are left-justified, the values after the directory
+		// start at word boundaries
+		while (data == &directory ? data->size() - begin < (size_t) offset_size
+				: data->size() % 2 != 0)
+			*data += (char) 0;
+	}
+	appendLE(directory, 0, offset_size);
+	return directory + values;
+}
+
+}
+
+ImageStreamWriter::~ImageStreamWriter() {
+}
+
+PNGStreamWriter::PNGStreamWriter()
+	: png(nullptr), info(nullptr) {
+}
+
+PNGStreamWriter::~PNGStreamWriter() {
+	destroy();
+}
+
+bool PNGStreamWriter::open(const std::string& filename, int width, int height) {
+	destroy();
+	out.open(filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png_ptr == NULL)
+		return false;
+	png = png_ptr;
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL)
+		return false;
+	info = info_ptr;
+
+	if (setjmp(png_jmpbuf(png_ptr)))
+		return false;
+	png_set_write_fn(png_ptr, (png_voidp) &out, pngWriteData, NULL);
+	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	if (util::isBigEndian()) {
+		png_set_bgr(png_ptr);
+		png_set_swap_alpha(png_ptr);
+	}
+	return (bool) out;
+}
+
+bool PNGStreamWriter::write(const RGBAImage& band) {
+	png_structp png_ptr = (png_structp) png;
+	if (png_ptr == NULL)
+		return false;
+	if (setjmp(png_jmpbuf(png_ptr)))
+		return false;
+	for (int y = 0; y < band.getHeight(); y++)
+		png_write_row(png_ptr, (png_bytep) &band.pixel(0, y));
+	return (bool) out;
+}
+
+bool PNGStreamWriter::close() {
+	png_structp png_ptr = (png_structp) png;
+	if (png_ptr == NULL)
+		return false;
+	if (setjmp(png_jmpbuf(png_ptr)))
+		return false;
+	png_write_end(png_ptr, (png_infop) info);
+	destroy();
+	out.close();
+	return (bool) out;
+}
+
+void PNGStreamWriter::destroy() {
+	if (png == nullptr)
+		return;
+	png_structp png_ptr = (png_structp) png;
+	png_infop info_ptr = (png_infop) info;
+	png_destroy_write_struct(&png_ptr, info_ptr != NULL ? &info_ptr : NULL);
+	png = info = nullptr;
+}
+
+TIFFStreamWriter::TIFFStreamWriter(int rows_per_strip)
+	: width(0), height(0), rows_per_strip(rows_per_strip), strip_rows(0), offset(0) {
+}
+
+TIFFStreamWriter::~TIFFStreamWriter() {
+}
+
+bool TIFFStreamWriter::open(const std::string& filename, int width, int height) {
+	this->width = width;
+	this->height = height;
+	strip.clear();
+	strip.reserve((size_t) width * 4 * rows_per_strip);
+	strip_rows = 0;
+	strip_offsets.clear();
+	strip_sizes.clear();
+
+	out.open(filename.c_str(), std::ios::binary);
+	// the header is written when the file is finished, it's a BigTIFF header (16 bytes)
+	// or a smaller classic TIFF header if the file is small enough
+	std::string header(16, '\0');
+	out.write(header.data(), header.size());
+	offset = header.size();
+	return (bool) out;
+}
+
+bool TIFFStreamWriter::write(const RGBAImage& band) {
+	std::vector<uint8_t> row(width * 4);
+	for (int y = 0; y < band.getHeight(); y++) {
+		for (int x = 0; x < width; x++) {
+			RGBAPixel pixel = band.getPixel(x, y);
+			row[4*x] = rgba_red(pixel);
+			row[4*x + 1] = rgba_green(pixel);
+			row[4*x + 2] = rgba_blue(pixel);
+			row[4*x + 3] = rgba_alpha(pixel);
+		}
+		// horizontal differencing, every sample is stored as difference to the same
+		// sample of the pixel on the left, that compresses a lot better
+		for (int i = width * 4 - 1; i >= 4; i--)
+			row[i] -= row[i - 4];
+		strip.insert(strip.end(), row.begin(), row.end());
+		if (++strip_rows == rows_per_strip && !writeStrip())
+			return false;
+	}
+	return (bool) out;
+}
+
+bool TIFFStreamWriter::writeStrip() {
+	uLongf size = compressBound(strip.size());
+	std::vector<uint8_t> compressed(size);
+	if (compress2(&compressed[0], &size, &strip[0], strip.size(), 6) != Z_OK)
+		return false;
+	out.write((const char*) &compressed[0], size);
+	strip_offsets.push_back(offset);
+	strip_sizes.push_back(size);
+	offset += size;
+	strip.clear();
+	strip_rows = 0;
+	return (bool) out;
+}
+
+bool TIFFStreamWriter::close() {
+	if (strip_rows > 0 && !writeStrip())
+		return false;
+	// the directory starts at a word boundary
+	if (offset % 2 != 0) {
+		out.put(0);
+		offset++;
+	}
+
+	std::vector<TIFFEntry> entries = {
+		{TIFF_IMAGE_WIDTH, TIFF_LONG, {(uint64_t) width}},
+		{TIFF_IMAGE_LENGTH, TIFF_LONG, {(uint64_t) height}},
+		{TIFF_BITS_PER_SAMPLE, TIFF_SHORT, {8, 8, 8, 8}},
+		// deflate
+		{TIFF_COMPRESSION, TIFF_SHORT, {8}},
+		// RGB
+		{TIFF_PHOTOMETRIC, TIFF_SHORT, {2}},
+		{TIFF_STRIP_OFFSETS, TIFF_LONG, strip_offsets},
+		{TIFF_SAMPLES_PER_PIXEL, TIFF_SHORT, {4}},
+		{TIFF_ROWS_PER_STRIP, TIFF_LONG, {(uint64_t) rows_per_strip}},
+		{TIFF_STRIP_BYTE_COUNTS, TIFF_LONG, strip_sizes},
+		// chunky (RGBARGBA...)
+		{TIFF_PLANAR_CONFIG, TIFF_SHORT, {1}},
+		// horizontal differencing
+		{TIFF_PREDICTOR, TIFF_SHORT, {2}},
+		// unassociated alpha
+		{TIFF_EXTRA_SAMPLES, TIFF_SHORT, {2}},
+	};
+	std::string directory = serializeDirectory(entries, offset, false);
+	bool big = offset + directory.size() > std::numeric_limits<uint32_t>::max();
+	std::string header;
+	if (big) {
+		entries[5].type = entries[8].type = TIFF_LONG8;
+		directory = serializeDirectory(entries, offset, true);
+		header = "II";
+		appendLE(header, 43, 2);
+		appendLE(header, 8, 2);
+		appendLE(header, 0, 2);
+		appendLE(header, offset, 8);
+	} else {
+		header = "II";
+		appendLE(header, 42, 2);
+		appendLE(header, offset, 4);
+	}
+	out.write(directory.data(), directory.size());
+	out.seekp(0);
+	out.write(header.data(), header.size());
+	out.close();
+	return (bool) out;
+}
+
+std::unique_ptr<ImageStreamWriter> createImageStreamWriter(const std::string& filename) {
+	std::string extension = boost::algorithm::to_lower_copy(
+			fs::path(filename).extension().string());
+	if (extension == ".png")
+		return std::unique_ptr<ImageStreamWriter>(new PNGStreamWriter());
+	if (extension == ".tif" || extension == ".tiff")
+		return std::unique_ptr<ImageStreamWriter>(new TIFFStreamWriter());
+	return nullptr;
+}
+
+ExportArea::ExportArea(int x, int y, int width, int height)
+	: x(x), y(y), width(width), height(height) {
+}
+
+bool ExportArea::isEmpty() const {
+	return width <= 0 || height <= 0;
+}
+
+MapExporter::MapExporter(std::shared_ptr<TileStore> store,
+		config::ImageFormat image_format, int tile_size, RGBAPixel background)
+	: store(store), image_format(image_format), tile_size(tile_size),
+	  background(background), read_tiles(0), failed_tiles(0) {
+}
+
+MapExporter::~MapExporter() {
+}
+
+ExportArea MapExporter::getMapArea(int zoom) {
+	// the tiles of the zoom level from the top left (0, 0) to the bottom right
+	// (2^zoom - 1, 2^zoom - 1)
+	int radius = (1 << zoom) / 2;
+	int min_x = std::numeric_limits<int>::max(), min_y = min_x;
+	int max_x = std::numeric_limits<int>::min(), max_y = max_x;
+	store->getModificationTimes(zoom, [&](const TilePath& tile, std::time_t) {
+		TilePos pos = tile.getTilePos();
+		min_x = std::min(min_x, pos.getX() + radius);
+		min_y = std::min(min_y, pos.getY() + radius);
+		max_x = std::max(max_x, pos.getX() + radius);
+		max_y = std::max(max_y, pos.getY() + radius);
+	});
+	if (min_x > max_x)
+		return ExportArea();
+	return ExportArea(min_x * tile_size, min_y * tile_size,
+			(max_x - min_x + 1) * tile_size, (max_y - min_y + 1) * tile_size);
+}
+
+bool MapExporter::exportImage(ImageStreamWriter& writer, const std::string& filename,
+		int zoom, const ExportArea& area, int threads, util::IProgressHandler* progress) {
+	read_tiles = failed_tiles = 0;
+	if (area.isEmpty() || area.x < 0 || area.y < 0
+			|| (area.x + area.width - 1) / tile_size >= (1 << zoom)
+			|| (area.y + area.height - 1) / tile_size >= (1 << zoom))
+		return false;
+	if (!writer.open(filename, area.width, area.height))
+		return false;
+
+	int radius = (1 << zoom) / 2;
+	int tile_x1 = area.x / tile_size, tile_x2 = (area.x + area.width - 1) / tile_size;
+	int tile_y1 = area.y / tile_size, tile_y2 = (area.y + area.height - 1) / tile_size;
+	if (progress != nullptr) {
+		progress->setMax(tile_y2 - tile_y1 + 1);
+		progress->setValue(0);
+	}
+
+	// the band with the part of the current row of tiles in the area
+	RGBAImage band;
+	std::atomic<size_t> read(0), failed(0);
+	for (int tile_y = tile_y1; tile_y <= tile_y2; tile_y++) {
+		int band_top = std::max(area.y, tile_y * tile_size);
+		int band_bottom = std::min(area.y + area.height, (tile_y + 1) * tile_size);
+		band.setSize(area.width, band_bottom - band_top);
+		band.fill(background, 0, 0, band.getWidth(), band.getHeight());
+
+		// the threads take the next tile of the row until all tiles are read, the
+		// tiles are in different parts of the band
+		std::atomic<int> next_x(tile_x1);
+		auto readTiles = [&]() {
+			std::string data;
+			RGBAImage tile;
+			int tile_x;
+			while ((tile_x = next_x++) <= tile_x2) {
+				TilePath path = TilePath::byTilePos(
+						TilePos(tile_x - radius, tile_y - radius), zoom);
+				if (!store->read(path, data))
+					continue;
+				read++;
+				if (!TileWriter::decodeImage(data, tile, image_format, false)) {
+					LOG(WARNING) << "Unable to decode tile " << path << ".";
+					failed++;
+					continue;
+				}
+				int x = tile_x * tile_size - area.x, y = tile_y * tile_size - band_top;
+				if (background == 0)
+					band.simpleBlit(tile.view(), x, y);
+				else
+					band.alphaBlit(tile.view(), x, y);
+			}
+		};
+		std::vector<thread_ns::thread> workers;
+		for (int i = 1; i < threads && i <= tile_x2 - tile_x1; i++)
+			workers.push_back(thread_ns::thread(readTiles));
+		readTiles();
+		for (auto it = workers.begin(); it != workers.end(); ++it)
+			it->join();
+
+		if (!writer.write(band))
+			return false;
+		if (progress != nullptr)
+			progress->setValue(tile_y - tile_y1 + 1);
+	}
+	read_tiles = read;
+	failed_tiles = failed;
+	return writer.close();
+}
+
+size_t MapExporter::getReadTiles() const {
+	return read_tiles;
+}
+
+size_t MapExporter::getFailedTiles() const {
+	return failed_tiles;
+}
+
+}
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPEXPORTER_H_
+#define MAPEXPORTER_H_
+
+#include "image.h"
+#include "../config/configsections/map.h"
+#include "../util/progress.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+class TileStore;
+
+/**
+ * Writes an image band by band (a few rows at a time), so the image doesn't have to be
+ * in memory at once.
+ */
+class ImageStreamWriter {
+public:
+	virtual ~ImageStreamWriter();
+
+	/**
+	 * Creates the image file. Returns false if it could not be created.
+	 */
+	virtual bool open(const std::string& filename, int width, int height) = 0;
+
+	/**
+	 * Appends the rows of a band to the image, the band is as wide as the image.
+	 */
+	virtual bool write(const RGBAImage& band) = 0;
+
+	/**
+	 * Finishes the image file once all rows are written.
+	 */
+	virtual bool close() = 0;
+};
+
+/**
+ * Writes a PNG image row by row with libpng.
+ */
+class PNGStreamWriter : public ImageStreamWriter {
+public:
+	PNGStreamWriter();
+	virtual ~PNGStreamWriter();
+
+	virtual bool open(const std::string& filename, int width, int height);
+	virtual bool write(const RGBAImage& band);
+	virtual bool close();
+
+private:
+	/**
+	 * Frees the libpng structs.
+	 */
+	void destroy();
+
+	std::ofstream out;
+	// the libpng write and info structs
+	void* png;
+	void* info;
+};
+
+/**
+ * Writes a TIFF image with deflate compressed strips. The strips are written as soon as
+ * their rows are there, the directory with their offsets follows at the end of the file.
+ * Images with more than 4GB are written as BigTIFF.
+ */
+class TIFFStreamWriter : public ImageStreamWriter {
+public:
+	TIFFStreamWriter(int rows_per_strip = 16);
+	virtual ~TIFFStreamWriter();
+
+	virtual bool open(const std::string& filename, int width, int height);
+	virtual bool write(const RGBAImage& band);
+	virtual bool close();
+
+private:
+	/**
+	 * Compresses the buffered rows into a strip and appends it to the file.
+	 */
+	bool writeStrip();
+
+	std::ofstream out;
+	int width, height, rows_per_strip;
+
+	// the rows of the current strip (with the horizontal differencing predictor already
+	// applied), and the count of rows of the strip
+	std::vector<uint8_t> strip;
+	int strip_rows;
+
+	// the offsets and sizes of the written strips
+	std::vector<uint64_t> strip_offsets, strip_sizes;
+	uint64_t offset;
+};
+
+/**
+ * Creates the image writer of a file by its extension (.png, .tif or .tiff). Returns
+ * nullptr for other extensions.
+ */
+std::unique_ptr<ImageStreamWriter> createImageStreamWriter(const std::string& filename);
+
+/**
+ * An area of the image of a zoom level of a map in pixels. The image of a zoom level is
+ * the image of all its tiles, the tile 1/1/... is in its top left corner.
+ */
+struct ExportArea {
+	ExportArea(int x = 0, int y = 0, int width = 0, int height = 0);
+
+	bool isEmpty() const;
+
+	int x, y, width, height;
+};
+
+/**
+ * Exports a zoom level of a rendered map rotation (or a part of it) as one image. The
+ * tiles are read from the tile store row by row and the image is written with an image
+ * writer band by band, so only one row of tiles is in memory at once.
+ */
+class MapExporter {
+public:
+	/**
+	 * The image format of the tiles in the store is needed to decode them. The tiles
+	 * which don't exist are filled with the background color.
+	 */
+	MapExporter(std::shared_ptr<TileStore> store, config::ImageFormat image_format,
+			int tile_size, RGBAPixel background = 0);
+	~MapExporter();
+
+	/**
+	 * Returns the area of the existing tiles of a zoom level, the whole map of that zoom
+	 * level. The area is empty if there are no tiles.
+	 */
+	ExportArea getMapArea(int zoom);
+
+	/**
+	 * Exports an area of a zoom level with an image writer into a file. The tiles of
+	 * each row are read and decoded by multiple threads, the progress handler (may be
+	 * null) gets the exported rows of tiles. Returns false if the image could not be
+	 * written.
+	 */
+	bool exportImage(ImageStreamWriter& writer, const std::string& filename, int zoom,
+			const ExportArea& area, int threads = 1,
+			util::IProgressHandler* progress = nullptr);
+
+	/**
+	 * Returns the count of tiles which were read by the last export, and the count of
+	 * tiles which could not be decoded.
+	 */
+	size_t getReadTiles() const;
+	size_t getFailedTiles() const;
+
+private:
+	std::shared_ptr<TileStore> store;
+	config::ImageFormat image_format;
+	int tile_size;
+	RGBAPixel background;
+
+	size_t read_tiles, failed_tiles;
+};
+
+}
+}
+
+#endif /* MAPEXPORTER_H_ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "renderjournal.h"
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// "MCRJ" and version of the journal file format, the byte order of the host is used
+const uint32_t JOURNAL_MAGIC = 0x4d43524a;
+const uint32_t JOURNAL_VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}
+
+RenderJournal::RenderJournal()
+	: time_started(0), valid_size(0) {
+}
+
+RenderJournal::~RenderJournal() {
+}
+
+bool RenderJournal::read(const fs::path& filename) {
+	this->filename = filename;
+	time_started = 0;
+	tiles.clear();
+	valid_size = 0;
+	std::ifstream in(filename.string().c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	uint32_t magic, version;
+	int64_t time;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, time)
+			|| magic != JOURNAL_MAGIC || version != JOURNAL_VERSION)
+		return false;
+	time_started = time;
+	valid_size = in.tellg();
+
+	// the entries are appended one by one, the rendering might have been killed while
+	// the last one was written
+	while (true) {
+		uint16_t length;
+		if (!readValue(in, length))
+			break;
+		std::string tile(length, '\0');
+		if (!in.read(&tile[0], length))
+			break;
+		tiles.insert(tile);
+		valid_size = in.tellg();
+	}
+	return true;
+}
+
+bool RenderJournal::open(const fs::path& filename, std::time_t time_started) {
+	if (valid_size == 0 || this->filename != filename) {
+		this->filename = filename;
+		this->time_started = time_started;
+		tiles.clear();
+		out.open(filename.string().c_str(), std::ios::binary | std::ios::trunc);
+		writeValue(out, JOURNAL_MAGIC);
+		writeValue(out, JOURNAL_VERSION);
+		writeValue(out, (int64_t) time_started);
+		out.flush();
+		return (bool) out;
+	}
+
+	// cut off a not completely written entry, appended entries would be lost otherwise
+	boost::system::error_code error;
+	fs::resize_file(filename, valid_size, error);
+	if (error)
+		return false;
+	out.open(filename.string().c_str(), std::ios::binary | std::ios::app);
+	return (bool) out;
+}
+
+void RenderJournal::remove() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (out.is_open())
+		out.close();
+	boost::system::error_code error;
+	fs::remove(filename, error);
+}
+
+void RenderJournal::add(const fs::path& file) {
+	std::string tile = getRelativePath(file);
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (!out.is_open())
+		return;
+	// flushed right away, so the entry survives if the rendering is killed
+	writeValue(out, (uint16_t) tile.size());
+	out.write(tile.data(), tile.size());
+	out.flush();
+}
+
+bool RenderJournal::contains(const fs::path& file) const {
+	return tiles.count(getRelativePath(file));
+}
+
+std::time_t RenderJournal::getTimeStarted() const {
+	return time_started;
+}
+
+size_t RenderJournal::size() const {
+	return tiles.size();
+}
+
+std::string RenderJournal::getRelativePath(const fs::path& file) const {
+	std::string directory = filename.branch_path().string() + "/";
+	std::string path = file.string();
+	if (path.compare(0, directory.size(), directory) == 0)
+		return path.substr(directory.size());
+	return path;
+}
+
+}
+}
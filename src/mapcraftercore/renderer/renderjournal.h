@@ -0,0 +1,111 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RENDERJOURNAL_H_
+#define RENDERJOURNAL_H_
+
+#include "../compat/thread.h"
+
+#include <ctime>
+#include <fstream>
+#include <set>
+#include <string>
+#include <stdint.h>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * A journal with the tiles of a map rotation which were written by a rendering.
+ *
+ * Every tile is appended to the journal file once its image is written, and the file is
+ * removed when the rendering is finished. If a rendering is interrupted, the next one
+ * reads the journal and doesn't have to render the tiles again which were written after
+ * the interrupted rendering started and whose chunks didn't change since then.
+ *
+ * The tiles are stored with their path relative to the directory of the journal file.
+ */
+class RenderJournal {
+public:
+	RenderJournal();
+	~RenderJournal();
+
+	/**
+	 * Reads the tiles of an interrupted rendering from a journal file. Returns false if
+	 * the file does not exist or is not a valid journal, the journal is empty then. A
+	 * tile which was not written completely at the end of the file is ignored.
+	 */
+	bool read(const fs::path& filename);
+
+	/**
+	 * Opens a journal file to append the written tiles. The tiles of a previously read
+	 * journal are kept and appended to, otherwise a new journal is created with the time
+	 * the rendering started.
+	 */
+	bool open(const fs::path& filename, std::time_t time_started);
+
+	/**
+	 * Closes the journal file and removes it, call this when the rendering is finished.
+	 */
+	void remove();
+
+	/**
+	 * Appends a written tile file to the journal, can be called by multiple threads.
+	 */
+	void add(const fs::path& file);
+
+	/**
+	 * Returns whether a tile file is in the journal.
+	 */
+	bool contains(const fs::path& file) const;
+
+	/**
+	 * Returns the time the rendering started which created the journal.
+	 */
+	std::time_t getTimeStarted() const;
+
+	/**
+	 * Returns the count of tiles in the journal.
+	 */
+	size_t size() const;
+
+private:
+	/**
+	 * Returns the path of a file relative to the directory of the journal.
+	 */
+	std::string getRelativePath(const fs::path& file) const;
+
+	fs::path filename;
+	std::time_t time_started;
+	std::set<std::string> tiles;
+
+	// size of the valid part of the read journal file
+	uintmax_t valid_size;
+
+	std::ofstream out;
+	thread_ns::mutex mutex;
+};
+
+}
+}
+
+#endif /* RENDERJOURNAL_H_ */
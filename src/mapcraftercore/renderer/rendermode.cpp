@@ -66,7 +66,7 @@ void MultiplexingRenderMode::addRenderMode(RenderMode* render_mode) {
 }
 
 void MultiplexingRenderMode::initialize(const RenderView* render_view, 
-		BlockImages* images, mc::WorldCache* world, mc::Chunk** current_chunk) {
+		BlockImages* images, mc::WorldCache* world, const mc::Chunk** current_chunk) {
 	for (auto it = render_modes.begin(); it != render_modes.end(); ++it)
 		(*it)->initialize(render_view, images, world, current_chunk);
 }
@@ -79,12 +79,40 @@ bool MultiplexingRenderMode::isHidden(const mc::BlockPos& pos, uint16_t id,
 	return false;
 }
 
+void MultiplexingRenderMode::isHiddenRow(const RenderModeBlock* blocks, int count,
+		bool* hidden) {
+	for (auto it = render_modes.begin(); it != render_modes.end(); ++it)
+		(*it)->isHiddenRow(blocks, count, hidden);
+}
+
+bool MultiplexingRenderMode::hidesBlocks() const {
+	for (auto it = render_modes.begin(); it != render_modes.end(); ++it)
+		if ((*it)->hidesBlocks())
+			return true;
+	return false;
+}
+
 void MultiplexingRenderMode::draw(RGBAImage& image, const mc::BlockPos& pos,
 		uint16_t id, uint16_t data) {
 	for (auto it = render_modes.begin(); it != render_modes.end(); ++it)
 		(*it)->draw(image, pos, id, data);
 }
 
+bool MultiplexingRenderMode::modifiesBlockImages() const {
+	for (auto it = render_modes.begin(); it != render_modes.end(); ++it)
+		if ((*it)->modifiesBlockImages())
+			return true;
+	return false;
+}
+
+bool MultiplexingRenderMode::getDrawKey(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, std::vector<int32_t>& key) {
+	for (auto it = render_modes.begin(); it != render_modes.end(); ++it)
+		if (!(*it)->getDrawKey(pos, id, data, key))
+			return false;
+	return true;
+}
+
 std::ostream& operator<<(std::ostream& out, RenderModeType render_mode) {
 	switch (render_mode) {
 	case RenderModeType::PLAIN: return out << "plain";
@@ -105,60 +133,74 @@ std::ostream& operator<<(std::ostream& out, OverlayType overlay) {
 	}
 }
 
+namespace {
+
+/**
+ * Creates the composed render mode of the supplied render modes and the overlay.
+ */
+template <typename... RenderModes>
+RenderMode* createComposedRenderMode(const config::WorldSection& world_config,
+		OverlayType overlay, int rotation, RenderModes*... render_modes) {
+	if (overlay == OverlayType::NONE) {
+		return new ComposedRenderMode<RenderModes...>(render_modes...);
+	} else if (overlay == OverlayType::SLIME) {
+		mc::World world(world_config.getInputDir().string(), world_config.getDimension());
+		return new ComposedRenderMode<RenderModes..., SlimeOverlay>(render_modes...,
+				new SlimeOverlay(world.getWorldDir(), rotation));
+	} else if (overlay == OverlayType::SPAWNDAY) {
+		return new ComposedRenderMode<RenderModes..., SpawnOverlay>(render_modes...,
+				new SpawnOverlay(true));
+	} else if (overlay == OverlayType::SPAWNNIGHT) {
+		return new ComposedRenderMode<RenderModes..., SpawnOverlay>(render_modes...,
+				new SpawnOverlay(false));
+	}
+
+	// this shouldn't happen
+	delete new ComposedRenderMode<RenderModes...>(render_modes...);
+	assert(false);
+	return nullptr;
+}
+
+}
+
 RenderMode* createRenderMode(const config::WorldSection& world_config,
 		const config::MapSection& map_config, int rotation) {
 	RenderModeType type = map_config.getRenderMode();
 	OverlayType overlay = map_config.getOverlay();
-	MultiplexingRenderMode* render_mode = new MultiplexingRenderMode();
-	
-	// create render mode
+
+	// the common combinations of render modes and overlays are composed at compile time
 	if (type == RenderModeType::PLAIN) {
-		// nothing
+		return createComposedRenderMode(world_config, overlay, rotation);
 	} else if (type == RenderModeType::CAVE || type == RenderModeType::CAVELIGHT) {
 		// hide some walls of caves which would cover the view into the caves
+		CaveRenderMode* cave;
 		if (map_config.getRenderView() == RenderViewType::ISOMETRIC)
-			render_mode->addRenderMode(new CaveRenderMode({mc::DIR_SOUTH, mc::DIR_WEST, mc::DIR_TOP}));
+			cave = new CaveRenderMode({mc::DIR_SOUTH, mc::DIR_WEST, mc::DIR_TOP});
 		else
-			render_mode->addRenderMode(new CaveRenderMode({mc::DIR_TOP}));
+			cave = new CaveRenderMode({mc::DIR_TOP});
 		// if we want some shadows, then simulate the sun light because it's dark in caves
 		if (type == RenderModeType::CAVELIGHT)
-			render_mode->addRenderMode(new LightingRenderMode(true, map_config.getLightingIntensity(),
-						map_config.getLightingWaterIntensity(), true));
-		render_mode->addRenderMode(new HeightOverlay());
-	}
-	else if (type == RenderModeType::DAYLIGHT) {
-		render_mode->addRenderMode(new LightingRenderMode(true,
-					map_config.getLightingIntensity(), map_config.getLightingWaterIntensity(),
-					world_config.getDimension() == mc::Dimension::END));
+			return createComposedRenderMode(world_config, overlay, rotation, cave,
+					new LightingRenderMode(true, map_config.getLightingIntensity(),
+							map_config.getLightingWaterIntensity(), true),
+					new HeightOverlay());
+		return createComposedRenderMode(world_config, overlay, rotation, cave,
+				new HeightOverlay());
+	} else if (type == RenderModeType::DAYLIGHT) {
+		return createComposedRenderMode(world_config, overlay, rotation,
+				new LightingRenderMode(true, map_config.getLightingIntensity(),
+						map_config.getLightingWaterIntensity(),
+						world_config.getDimension() == mc::Dimension::END));
 	} else if (type == RenderModeType::NIGHTLIGHT) {
-		render_mode->addRenderMode(new LightingRenderMode(false,
-					map_config.getLightingIntensity(), map_config.getLightingWaterIntensity(),
-					world_config.getDimension() == mc::Dimension::END));
-	} else {
-		// this shouldn't happen
-		delete render_mode;
-		assert(false);
-		return nullptr;
-	}
-	
-	// create overlay
-	if (overlay == OverlayType::NONE) {
-		// nothing
-	} else if (overlay == OverlayType::SLIME) {
-		mc::World world(world_config.getInputDir().string(), world_config.getDimension());
-		render_mode->addRenderMode(new SlimeOverlay(world.getWorldDir(), rotation));
-	} else if (overlay == OverlayType::SPAWNDAY) {
-		render_mode->addRenderMode(new SpawnOverlay(true));
-	} else if (overlay == OverlayType::SPAWNNIGHT) {
-		render_mode->addRenderMode(new SpawnOverlay(false));
-	} else {
-		// this shouldn't happen
-		delete render_mode;
-		assert(false);
-		return nullptr;
+		return createComposedRenderMode(world_config, overlay, rotation,
+				new LightingRenderMode(false, map_config.getLightingIntensity(),
+						map_config.getLightingWaterIntensity(),
+						world_config.getDimension() == mc::Dimension::END));
 	}
 
-	return render_mode;
+	// this shouldn't happen
+	assert(false);
+	return nullptr;
 }
 
 } /* namespace render */
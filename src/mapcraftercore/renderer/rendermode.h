@@ -47,6 +47,14 @@ namespace renderer {
 class BlockImages;
 class RGBAImage;
 
+/**
+ * A block of a row (or column) of blocks that is checked by a render mode at once.
+ */
+struct RenderModeBlock {
+	mc::BlockPos pos;
+	uint16_t id, data;
+};
+
 /**
  * A simple interface to implement different render modes.
  */
@@ -63,19 +71,48 @@ public:
 	 * methods to modify the block images.
 	 */
 	virtual void initialize(const RenderView* render_view, BlockImages* images,
-			mc::WorldCache* world, mc::Chunk** current_chunk) = 0;
+			mc::WorldCache* world, const mc::Chunk** current_chunk) = 0;
 
 	/**
 	 * This method is called by the tile renderer to check if a block should be hidden.
 	 */
 	virtual bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data) = 0;
 
+	/**
+	 * This method is called by the tile renderer to check a row of blocks (all in the
+	 * current chunk) at once. It sets the hidden flags of the blocks that should be
+	 * hidden and leaves the other flags unchanged.
+	 */
+	virtual void isHiddenRow(const RenderModeBlock* blocks, int count, bool* hidden) = 0;
+
+	/**
+	 * Returns whether the isHidden-methods hide any blocks at all. If not, which blocks
+	 * of a tile are visible doesn't depend on the render mode, and the tile renderer can
+	 * reuse the visible blocks found for another render mode (see TileGeometry).
+	 */
+	virtual bool hidesBlocks() const = 0;
+
 	/**
 	 * This method is called by the tile renderer so you can modify block images that
 	 * are about to be rendered.
 	 */
 	virtual void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id,
 			uint16_t data) = 0;
+
+	/**
+	 * Returns whether the draw-method modifies block images at all. If not, the tile
+	 * renderer can use the cached block images instead of copying them for every block.
+	 */
+	virtual bool modifiesBlockImages() const = 0;
+
+	/**
+	 * Appends values to the supplied key that describe how the draw-method modifies the
+	 * image of a block, or returns false if this isn't possible. Blocks with the same
+	 * block image and the same key get the same modified images, that way the tile
+	 * renderer can reuse them.
+	 */
+	virtual bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key) = 0;
 };
 
 #ifdef HAVE_ENUM_CLASS_FORWARD_DECLARATION
@@ -163,18 +200,43 @@ public:
 	 * renderer with the render view.
 	 */
 	virtual void initialize(const RenderView* render_view, BlockImages* images,
-			mc::WorldCache* world, mc::Chunk** current_chunk);
+			mc::WorldCache* world, const mc::Chunk** current_chunk);
 
 	/**
 	 * Dummy implementation of interface method. Returns false as default.
 	 */
 	virtual bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data);
 
+	/**
+	 * Default implementation of interface method. Calls isHidden for each block that is
+	 * not already hidden.
+	 */
+	virtual void isHiddenRow(const RenderModeBlock* blocks, int count, bool* hidden);
+
+	/**
+	 * Dummy implementation of interface method. Returns false as default, render modes
+	 * implementing the isHidden-method have to return true.
+	 */
+	virtual bool hidesBlocks() const;
+
 	/**
 	 * Dummy implementation of interface method.
 	 */
 	virtual void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
 
+	/**
+	 * Dummy implementation of interface method. Returns false as default, render modes
+	 * implementing the draw-method have to return true.
+	 */
+	virtual bool modifiesBlockImages() const;
+
+	/**
+	 * Default implementation of interface method. Returns false if the render mode
+	 * modifies block images (= the draw-method can't be described with a key).
+	 */
+	virtual bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key);
+
 protected:
 	mc::Block getBlock(const mc::BlockPos& pos, int get = mc::GET_ID | mc::GET_DATA);
 
@@ -183,7 +245,7 @@ protected:
 
 	BlockImages* images;
 	mc::WorldCache* world;
-	mc::Chunk** current_chunk;
+	const mc::Chunk** current_chunk;
 };
 
 /**
@@ -203,7 +265,7 @@ public:
 	 * Passes the supplied render data to the render modes.
 	 */
 	virtual void initialize(const RenderView* render_view, BlockImages* images,
-			mc::WorldCache* world, mc::Chunk** current_chunk);
+			mc::WorldCache* world, const mc::Chunk** current_chunk);
 
 	/**
 	 * Calls this method of each render mode and returns true if one render mode returns
@@ -211,15 +273,130 @@ public:
 	 */
 	virtual bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data);
 
+	/**
+	 * Calls this method of each render mode.
+	 */
+	virtual void isHiddenRow(const RenderModeBlock* blocks, int count, bool* hidden);
+
+	/**
+	 * Returns true if one render mode hides blocks.
+	 */
+	virtual bool hidesBlocks() const;
+
 	/**
 	 * Calls this method of each render mode.
 	 */
 	virtual void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
 
+	/**
+	 * Returns true if one render mode modifies block images.
+	 */
+	virtual bool modifiesBlockImages() const;
+
+	/**
+	 * Calls this method of each render mode and returns false if one render mode
+	 * returns false.
+	 */
+	virtual bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key);
+
 protected:
 	std::vector<RenderMode*> render_modes;
 };
 
+/**
+ * The render modes of a composed render mode, this calls the methods of each render mode
+ * directly (not through the render mode interface), so the default implementations of the
+ * base render mode can be inlined.
+ */
+template <typename... RenderModes>
+struct RenderModeChain;
+
+template <>
+struct RenderModeChain<> {
+	void initialize(const RenderView* render_view, BlockImages* images,
+			mc::WorldCache* world, const mc::Chunk** current_chunk) {}
+	bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data) { return false; }
+	void isHiddenRow(const RenderModeBlock* blocks, int count, bool* hidden) {}
+	bool hidesBlocks() const { return false; }
+	void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data) {}
+	bool modifiesBlockImages() const { return false; }
+	bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key) { return true; }
+};
+
+template <typename First, typename... Rest>
+struct RenderModeChain<First, Rest...> {
+	RenderModeChain(First* first, Rest*... rest)
+		: first(first), rest(rest...) {}
+
+	void initialize(const RenderView* render_view, BlockImages* images,
+			mc::WorldCache* world, const mc::Chunk** current_chunk) {
+		first->First::initialize(render_view, images, world, current_chunk);
+		rest.initialize(render_view, images, world, current_chunk);
+	}
+
+	bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data) {
+		return first->First::isHidden(pos, id, data) || rest.isHidden(pos, id, data);
+	}
+
+	void isHiddenRow(const RenderModeBlock* blocks, int count, bool* hidden) {
+		first->First::isHiddenRow(blocks, count, hidden);
+		rest.isHiddenRow(blocks, count, hidden);
+	}
+
+	bool hidesBlocks() const {
+		return first->First::hidesBlocks() || rest.hidesBlocks();
+	}
+
+	void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data) {
+		first->First::draw(image, pos, id, data);
+		rest.draw(image, pos, id, data);
+	}
+
+	bool modifiesBlockImages() const {
+		return first->First::modifiesBlockImages() || rest.modifiesBlockImages();
+	}
+
+	bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key) {
+		return first->First::getDrawKey(pos, id, data, key)
+				&& rest.getDrawKey(pos, id, data, key);
+	}
+
+	std::unique_ptr<First> first;
+	RenderModeChain<Rest...> rest;
+};
+
+/**
+ * This is a render mode that combines a fixed list of render modes into one, like the
+ * multiplexing render mode, but the types of the render modes are known at compile time.
+ * That way there is only one virtual call per block into the composed render mode.
+ */
+template <typename... RenderModes>
+class ComposedRenderMode : public RenderMode {
+public:
+	/**
+	 * Creates the composed render mode, the supplied render modes are destroyed when
+	 * this render mode is destroyed.
+	 */
+	ComposedRenderMode(RenderModes*... render_modes);
+	virtual ~ComposedRenderMode();
+
+	virtual void initialize(const RenderView* render_view, BlockImages* images,
+			mc::WorldCache* world, const mc::Chunk** current_chunk);
+	virtual bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data);
+	virtual void isHiddenRow(const RenderModeBlock* blocks, int count, bool* hidden);
+	virtual bool hidesBlocks() const;
+	virtual void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
+	virtual bool modifiesBlockImages() const;
+	virtual bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key);
+
+protected:
+	RenderModeChain<RenderModes...> render_modes;
+};
+
 /**
  * Types of (of other base render modes composed) render modes that are available for
  * the user.
@@ -261,7 +438,7 @@ BaseRenderMode<Renderer>::~BaseRenderMode() {
 
 template <typename Renderer>
 void BaseRenderMode<Renderer>::initialize(const RenderView* render_view, 
-		BlockImages* images, mc::WorldCache* world, mc::Chunk** current_chunk) {
+		BlockImages* images, mc::WorldCache* world, const mc::Chunk** current_chunk) {
 	// create the render mode renderer by calling the render view factory method
 	// for this renderer type
 	this->renderer_ptr = render_view->createRenderModeRenderer(Renderer::TYPE);
@@ -280,16 +457,89 @@ bool BaseRenderMode<Renderer>::isHidden(const mc::BlockPos& pos, uint16_t id,
 	return false;
 }
 
+template <typename Renderer>
+void BaseRenderMode<Renderer>::isHiddenRow(const RenderModeBlock* blocks, int count,
+		bool* hidden) {
+	for (int i = 0; i < count; i++)
+		if (!hidden[i])
+			hidden[i] = isHidden(blocks[i].pos, blocks[i].id, blocks[i].data);
+}
+
+template <typename Renderer>
+bool BaseRenderMode<Renderer>::hidesBlocks() const {
+	return false;
+}
+
 template <typename Renderer>
 void BaseRenderMode<Renderer>::draw(RGBAImage& image, const mc::BlockPos& pos,
 		uint16_t id, uint16_t data) {
 }
 
+template <typename Renderer>
+bool BaseRenderMode<Renderer>::modifiesBlockImages() const {
+	return false;
+}
+
+template <typename Renderer>
+bool BaseRenderMode<Renderer>::getDrawKey(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, std::vector<int32_t>& key) {
+	return !modifiesBlockImages();
+}
+
 template <typename Renderer>
 mc::Block BaseRenderMode<Renderer>::getBlock(const mc::BlockPos& pos, int get) {
 	return world->getBlock(pos, *current_chunk, get);
 }
 
+template <typename... RenderModes>
+ComposedRenderMode<RenderModes...>::ComposedRenderMode(RenderModes*... render_modes)
+	: render_modes(render_modes...) {
+}
+
+template <typename... RenderModes>
+ComposedRenderMode<RenderModes...>::~ComposedRenderMode() {
+}
+
+template <typename... RenderModes>
+void ComposedRenderMode<RenderModes...>::initialize(const RenderView* render_view,
+		BlockImages* images, mc::WorldCache* world, const mc::Chunk** current_chunk) {
+	render_modes.initialize(render_view, images, world, current_chunk);
+}
+
+template <typename... RenderModes>
+bool ComposedRenderMode<RenderModes...>::isHidden(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data) {
+	return render_modes.isHidden(pos, id, data);
+}
+
+template <typename... RenderModes>
+void ComposedRenderMode<RenderModes...>::isHiddenRow(const RenderModeBlock* blocks,
+		int count, bool* hidden) {
+	render_modes.isHiddenRow(blocks, count, hidden);
+}
+
+template <typename... RenderModes>
+bool ComposedRenderMode<RenderModes...>::hidesBlocks() const {
+	return render_modes.hidesBlocks();
+}
+
+template <typename... RenderModes>
+void ComposedRenderMode<RenderModes...>::draw(RGBAImage& image, const mc::BlockPos& pos,
+		uint16_t id, uint16_t data) {
+	render_modes.draw(image, pos, id, data);
+}
+
+template <typename... RenderModes>
+bool ComposedRenderMode<RenderModes...>::modifiesBlockImages() const {
+	return render_modes.modifiesBlockImages();
+}
+
+template <typename... RenderModes>
+bool ComposedRenderMode<RenderModes...>::getDrawKey(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, std::vector<int32_t>& key) {
+	return render_modes.getDrawKey(pos, id, data, key);
+}
+
 } /* namespace render */
 } /* namespace mapcrafter */
 
@@ -23,11 +23,34 @@
 #include "../image.h"
 #include "../../mc/chunk.h"
 
+#include <cstdlib>
+
 namespace mapcrafter {
 namespace renderer {
 
+namespace {
+
+// the flags of the blocks when computing the hidden mask of a section
+const uint8_t BLOCK_LIGHT = 1;
+const uint8_t BLOCK_TRANSPARENT = 2;
+const uint8_t BLOCK_WATER = 4;
+
+bool isWater(uint16_t id) {
+	return id == 8 || id == 9;
+}
+
+}
+
+CaveRenderMode::HiddenMask::HiddenMask()
+	: revision(0) {
+}
+
 CaveRenderMode::CaveRenderMode(const std::vector<mc::BlockPos>& hidden_dirs)
-	: hidden_dirs(hidden_dirs) {
+	: hidden_dirs(hidden_dirs), hidden_dirs_neighbors(true), hidden_masks(64),
+	  current_mask(nullptr) {
+	for (auto it = hidden_dirs.begin(); it != hidden_dirs.end(); ++it)
+		if (std::abs(it->x) > 1 || std::abs(it->z) > 1 || std::abs(it->y) > 1)
+			hidden_dirs_neighbors = false;
 }
 
 CaveRenderMode::~CaveRenderMode() {
@@ -41,7 +64,39 @@ bool CaveRenderMode::isTransparentBlock(const mc::Block& block) const {
 	return block.id == 0 || images->isBlockTransparent(block.id, block.data);
 }
 
+bool CaveRenderMode::hidesBlocks() const {
+	return true;
+}
+
 bool CaveRenderMode::isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data) {
+	const mc::Chunk* chunk = *current_chunk;
+	if (chunk == nullptr || !hidden_dirs_neighbors || mc::ChunkPos(pos) != chunk->getPos()
+			|| pos.y < 0 || pos.y >= mc::CHUNK_HEIGHT * 16)
+		return isHiddenBlock(pos, id);
+
+	const mc::ChunkPos& chunk_pos = chunk->getPos();
+	if (current_mask == nullptr || current_mask->pos != chunk_pos
+			|| current_mask->revision != chunk->getRevision()) {
+		current_mask = &hidden_masks[(chunk_pos.x & 7) * 8 + (chunk_pos.z & 7)];
+		// reset the mask if it belongs to another chunk or to an old version of it
+		if (current_mask->pos != chunk_pos
+				|| current_mask->revision != chunk->getRevision()) {
+			current_mask->pos = chunk_pos;
+			current_mask->revision = chunk->getRevision();
+			for (int i = 0; i < mc::CHUNK_HEIGHT; i++)
+				current_mask->sections[i].clear();
+		}
+	}
+
+	std::vector<uint64_t>& mask = current_mask->sections[pos.y / 16];
+	if (mask.empty())
+		computeHiddenMask(*chunk, pos.y / 16, mask);
+	mc::LocalBlockPos local(pos);
+	int index = ((local.y % 16) * 16 + local.z) * 16 + local.x;
+	return (mask[index / 64] >> (index % 64)) & 1;
+}
+
+bool CaveRenderMode::isHiddenBlock(const mc::BlockPos& pos, uint16_t id) {
 	mc::BlockPos directions[6] = {
 		mc::DIR_NORTH, mc::DIR_SOUTH, mc::DIR_EAST, mc::DIR_WEST,
 		mc::DIR_TOP, mc::DIR_BOTTOM
@@ -82,5 +137,97 @@ bool CaveRenderMode::isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t dat
 	return true;
 }
 
+void CaveRenderMode::computeHiddenMask(const mc::Chunk& chunk, int section,
+		std::vector<uint64_t>& mask) {
+	// the flags of the blocks of the section and of the blocks around it,
+	// index is (y+1)*18*18 + (z+1)*18 + (x+1) with x, z, y from -1 to 16
+	section_flags.resize(18 * 18 * 18);
+	const mc::ChunkPos& chunk_pos = chunk.getPos();
+	for (int y = -1; y <= 16; y++)
+		for (int z = -1; z <= 16; z++)
+			for (int x = -1; x <= 16; x++) {
+				mc::BlockPos pos(chunk_pos.x * 16 + x, chunk_pos.z * 16 + z,
+						section * 16 + y);
+				uint16_t id, data;
+				uint8_t sky_light;
+				if (x >= 0 && x < 16 && z >= 0 && z < 16 && pos.y >= 0) {
+					mc::LocalBlockPos local(x, z, pos.y);
+					id = chunk.getBlockID(local);
+					data = chunk.getBlockData(local);
+					sky_light = chunk.getSkyLight(local);
+				} else {
+					mc::Block block = world->getBlock(pos, &chunk,
+							mc::GET_ID | mc::GET_DATA | mc::GET_SKY_LIGHT);
+					id = block.id;
+					data = block.data;
+					sky_light = block.sky_light;
+				}
+				uint8_t flags = 0;
+				if (sky_light > 0)
+					flags |= BLOCK_LIGHT;
+				if (id == 0 || images->isBlockTransparent(id, data))
+					flags |= BLOCK_TRANSPARENT;
+				if (isWater(id))
+					flags |= BLOCK_WATER;
+				section_flags[((y+1) * 18 + (z+1)) * 18 + (x+1)] = flags;
+			}
+
+	// the offsets of the neighbor blocks and the blocks in the hidden directions
+	std::vector<int> hidden_offsets;
+	for (auto it = hidden_dirs.begin(); it != hidden_dirs.end(); ++it)
+		hidden_offsets.push_back((it->y * 18 + it->z) * 18 + it->x);
+	int neighbor_offsets[6] = {-18, 18, 1, -1, 18 * 18, -18 * 18};
+
+	mask.assign(64, 0);
+	for (int z = 0; z < 16; z++)
+		for (int x = 0; x < 16; x++) {
+			// whether the first block, that is not water, above the blocks of this column
+			// has sky light (the water surface above a block, see isHiddenBlock)
+			const uint8_t* column = &section_flags[(z+1) * 18 + (x+1)];
+			bool water_surface_light;
+			if (column[17 * 18 * 18] & BLOCK_WATER) {
+				mc::BlockPos pos(chunk_pos.x * 16 + x, chunk_pos.z * 16 + z,
+						section * 16 + 16);
+				mc::Block block;
+				do {
+					pos.y++;
+					block = world->getBlock(pos, &chunk,
+							mc::GET_ID | mc::GET_SKY_LIGHT);
+				} while (isWater(block.id));
+				water_surface_light = block.sky_light > 0;
+			} else
+				water_surface_light = column[17 * 18 * 18] & BLOCK_LIGHT;
+
+			for (int y = 15; y >= 0; y--) {
+				const uint8_t* block = column + (y+1) * 18 * 18;
+				// check if this block touches sky light
+				bool hidden = false;
+				for (int i = 0; i < 6 && !hidden; i++)
+					if (block[neighbor_offsets[i]] & BLOCK_LIGHT)
+						hidden = true;
+
+				// water and blocks under water are hidden if there is sunlight on the
+				// surface of the water
+				if (!hidden && ((block[0] | block[18 * 18]) & BLOCK_WATER))
+					hidden = water_surface_light;
+
+				// show only the blocks with a transparent block on one of the sides
+				if (!hidden) {
+					hidden = true;
+					for (size_t i = 0; i < hidden_offsets.size(); i++)
+						if (block[hidden_offsets[i]] & BLOCK_TRANSPARENT)
+							hidden = false;
+				}
+
+				int index = (y * 16 + z) * 16 + x;
+				if (hidden)
+					mask[index / 64] |= (uint64_t) 1 << (index % 64);
+
+				if (!(block[0] & BLOCK_WATER))
+					water_surface_light = block[0] & BLOCK_LIGHT;
+			}
+		}
+}
+
 } /* namespace render */
 } /* namespace mapcrafter */
@@ -21,6 +21,7 @@
 #define RENDERMODES_CAVE_H_
 
 #include "../rendermode.h"
+#include "../../mc/chunk.h"
 #include "../../mc/pos.h"
 
 #include <vector>
@@ -35,11 +36,24 @@ public:
 
 	virtual bool isHidden(const mc::BlockPos& pos,
 			uint16_t id, uint16_t data);
+	virtual bool hidesBlocks() const;
 
 protected:
 	bool isLight(const mc::BlockPos& pos);
 	bool isTransparentBlock(const mc::Block& block) const;
 
+	/**
+	 * Checks if a block should be hidden by probing its neighbor blocks, this is used
+	 * for blocks that are not in the current chunk.
+	 */
+	bool isHiddenBlock(const mc::BlockPos& pos, uint16_t id);
+
+	/**
+	 * Computes whether the blocks of a section of the current chunk are hidden, with one
+	 * pass over the sky light and transparency of the section and the blocks around it.
+	 */
+	void computeHiddenMask(const mc::Chunk& chunk, int section, std::vector<uint64_t>& mask);
+
 	// we want to hide some additional cave blocks to be able to look "inside" the caves,
 	// so it's possible to specify directions where cave blocks must touch transparent
 	// blocks (or air), there must be a transparent block in at least one directions
@@ -47,6 +61,27 @@ protected:
 	// (because you are looking from the south-west-top at the map and don't want your
 	// view into the cave covered by the southern, western, and top walls)
 	std::vector<mc::BlockPos> hidden_dirs;
+	// whether the hidden directions are neighbor blocks, only then the hidden masks work
+	bool hidden_dirs_neighbors;
+
+	// whether the blocks of a chunk are hidden (a bit per block, index is
+	// ((y%16)*16 + z)*16 + x per section, empty if not computed yet), the revision is the
+	// one of the chunk they were computed for (see mc::Chunk::getRevision)
+	struct HiddenMask {
+		HiddenMask();
+
+		mc::ChunkPos pos;
+		uint64_t revision;
+		std::vector<uint64_t> sections[mc::CHUNK_HEIGHT];
+	};
+
+	// the hidden masks of recently rendered chunks, mapped by their positions (8x8 chunks)
+	std::vector<HiddenMask> hidden_masks;
+	HiddenMask* current_mask;
+
+	// the flags of the blocks of the section whose mask is computed and around it, kept
+	// to reuse the memory
+	std::vector<uint8_t> section_flags;
 };
 
 } /* namespace render */
@@ -27,23 +27,31 @@ namespace renderer {
 
 HeightOverlay::HeightOverlay()
 	: OverlayRenderMode(OverlayMode::PER_BLOCK) {
+	for (int y = 0; y < mc::CHUNK_HEIGHT * 16; y++)
+		colors[y] = calculateColor(y);
 }
 
 RGBAPixel HeightOverlay::getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data) {
+	if (pos.y >= 0 && pos.y < mc::CHUNK_HEIGHT * 16)
+		return colors[pos.y];
+	return calculateColor(pos.y);
+}
+
+RGBAPixel HeightOverlay::calculateColor(int y) {
 	// TODO make the gradient configurable
-	double h1 = (double) (64 - pos.y) / 64;
-	if (pos.y > 64)
+	double h1 = (double) (64 - y) / 64;
+	if (y > 64)
 		h1 = 0;
 
 	double h2 = 0;
-	if (pos.y >= 64 && pos.y < 96)
-		h2 = (double) (96 - pos.y) / 32;
-	else if (pos.y > 16 && pos.y < 64)
-		h2 = (double) (pos.y - 16) / 48;
+	if (y >= 64 && y < 96)
+		h2 = (double) (96 - y) / 32;
+	else if (y > 16 && y < 64)
+		h2 = (double) (y - 16) / 48;
 
 	double h3 = 0;
-	if (pos.y > 64)
-		h3 = (double) (pos.y - 64) / 64;
+	if (y > 64)
+		h3 = (double) (y - 64) / 64;
 
 	int r = h1 * 128.0 + 128.0;
 	int g = h2 * 255.0;
@@ -22,6 +22,7 @@
 
 #include "overlay.h"
 #include "../rendermode.h"
+#include "../../mc/chunk.h"
 
 namespace mapcrafter {
 namespace renderer {
@@ -32,6 +33,16 @@ public:
 
 protected:
 	virtual RGBAPixel getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data);
+
+	/**
+	 * Calculates the overlay color of blocks at a specific height.
+	 */
+	static RGBAPixel calculateColor(int y);
+
+	// the overlay colors of all heights of the world, precomputed because the color is
+	// needed for every drawn block (the tinted block images are cached per color with
+	// the draw keys of the overlay render mode)
+	RGBAPixel colors[mc::CHUNK_HEIGHT * 16];
 };
 
 } /* namespace renderer */
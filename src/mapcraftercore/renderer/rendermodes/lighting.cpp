@@ -27,6 +27,7 @@
 #include "../../mc/pos.h"
 #include "../../util.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace mapcrafter {
@@ -140,7 +141,7 @@ bool isSpecialTransparent(uint16_t id) {
 }
 
 LightingData LightingData::estimate(const mc::Block& block,
-		BlockImages* images, mc::WorldCache* world, mc::Chunk* current_chunk) {
+		BlockImages* images, mc::WorldCache* world, const mc::Chunk* current_chunk) {
 	// estimate the light if this is a special block
 	if (!isSpecialTransparent(block.id))
 		return LightingData(block.block_light, block.sky_light);
@@ -183,6 +184,47 @@ LightingData LightingData::estimate(const mc::Block& block,
 	return LightingData(block_light, sky_light);
 }
 
+bool LightingData::isEstimated(uint16_t id) {
+	return isSpecialTransparent(id);
+}
+
+
+namespace {
+
+/**
+ * Multiplies the color channels of a pixel with a lighting factor, this is the same like
+ * rgba_multiply(pixel, factor, factor, factor), but red and blue are multiplied at once
+ * and divided by 255 with x / 255 = (x + (x >> 8) + 1) >> 8 (exact for x < 65535).
+ */
+inline RGBAPixel shadePixel(RGBAPixel pixel, uint8_t factor) {
+	uint32_t rb = (pixel & 0x00ff00ff) * factor;
+	uint32_t g = ((pixel >> 8) & 0xff) * factor;
+	rb = ((rb + ((rb >> 8) & 0x00ff00ff) + 0x00010001) >> 8) & 0x00ff00ff;
+	g = (g + (g >> 8) + 1) >> 8;
+	return (pixel & 0xff000000) | rb | (g << 8);
+}
+
+/**
+ * Converts a lighting color to the 16.16 fixed-point representation of its lighting
+ * factor (0 - 255).
+ */
+int toFixedPoint(double color) {
+	return color * 255 * 65536;
+}
+
+// the kinds of lighting of blocks and the lighted faces, see LightingRenderMode::Shading
+enum {
+	SHADING_FLAT,
+	SHADING_SLAB,
+	SHADING_SIMPLE,
+	SHADING_SMOOTH
+};
+
+const int LIGHT_LEFT = 1;
+const int LIGHT_RIGHT = 2;
+const int LIGHT_TOP = 4;
+
+}
 
 LightingRenderer::~LightingRenderer() {
 }
@@ -195,72 +237,79 @@ void LightingRenderer::lightAllSimple(RGBAImage& image, LightingColor color) con
 		for (int y = 0; y < size; y++) {
 			uint32_t& pixel = image.pixel(x, y);
 			if (pixel != 0)
-				pixel = rgba_multiply(pixel, factor, factor, factor, 255);
+				pixel = shadePixel(pixel, factor);
 		}
 	}
 }
 
 const RenderModeRendererType LightingRenderer::TYPE = RenderModeRendererType::LIGHTING;
 
-void LightingRenderer::drawBottomTriangle(RGBAImage& image, int size, double c1,
-		double c2, double c3) const {
-	double e1diff = c2 - c1;
-	double e2diff = c3 - c1;
-	double fy = 0;
-	double fyStep = (double) 1 / (size-1);
-	for (int y = 0; y < size; y++, fy+=fyStep) {
-		double color1 = c1 + e1diff*fy;
-		double color2 = c1 + e2diff*fy;
-		double colordiff = color2 - color1;
-		double fx = 0;
-		double fxStep = 0;
-		if (y != 0)
-			fxStep = (double) 1 / y;
-		else
-			fx = 1;
-		for (int x = 0; x <= y; x++, fx+=fxStep) {
-			double color = color1 + colordiff*fx;
-			//color += (1-color)*(1-LIGHTNING_INTENSITY);
-			image.pixel(x, y) = rgba(0, 0, 0, color * 255);
-		}
+void LightingRenderer::drawBottomTriangle(int size, double c1, double c2, double c3) const {
+	int f1 = toFixedPoint(c1);
+	int64_t e1diff = toFixedPoint(c2) - f1;
+	int64_t e2diff = toFixedPoint(c3) - f1;
+	for (int y = 0; y < size; y++) {
+		int color1 = f1 + e1diff * y / (size-1);
+		int color2 = f1 + e2diff * y / (size-1);
+		int step = y != 0 ? (color2 - color1) / y : 0;
+		uint8_t* row = &shade[y * size];
+		int color = color1;
+		for (int x = 0; x <= y; x++, color += step)
+			row[x] = color >> 16;
 	}
 }
 
-void LightingRenderer::drawTopTriangle(RGBAImage& image, int size, double c1,
-		double c2, double c3) const {
-	double e1diff = c2 - c1;
-	double e2diff = c3 - c1;
-	double fy = 0;
-	double fyStep = (double) 1 / (size-1);
-	for (int y = 0; y < size; y++, fy+=fyStep) {
-		double color1 = c1 + e1diff*fy;
-		double color2 = c1 + e2diff*fy;
-		double colordiff = color2 - color1;
-		double fx = 0;
-		double fxStep = 0;
-		if (y != 0)
-			fxStep = (double) 1 / y;
-		else
-			fx = 1;
-		for (int x = 0; x <= y; x++, fx+=fxStep) {
-			double color = color1 + colordiff*fx;
-			//color += (1-color)*(1-LIGHTNING_INTENSITY);
-			image.pixel(size-1-x, size-1-y) = rgba(0, 0, 0, color * 255);
-		}
+void LightingRenderer::drawTopTriangle(int size, double c1, double c2, double c3) const {
+	int f1 = toFixedPoint(c1);
+	int64_t e1diff = toFixedPoint(c2) - f1;
+	int64_t e2diff = toFixedPoint(c3) - f1;
+	for (int y = 0; y < size; y++) {
+		int color1 = f1 + e1diff * y / (size-1);
+		int color2 = f1 + e2diff * y / (size-1);
+		int step = y != 0 ? (color2 - color1) / y : 0;
+		uint8_t* row = &shade[(size-1-y) * size];
+		int color = color1;
+		for (int x = 0; x <= y; x++, color += step)
+			row[size-1-x] = color >> 16;
 	}
 }
 
-void LightingRenderer::createShade(RGBAImage& image, const CornerColors& corners) const {
-	int size = image.getWidth();
-	drawBottomTriangle(image, size, corners[0], corners[2], corners[3]);
-	drawTopTriangle(image, size, corners[3], corners[1], corners[0]);
+void LightingRenderer::createShade(int size, const CornerColors& corners) const {
+	shade.resize(size * size);
+	if (size == 1) {
+		shade[0] = toFixedPoint(corners[0]) >> 16;
+		return;
+	}
+	drawBottomTriangle(size, corners[0], corners[2], corners[3]);
+	drawTopTriangle(size, corners[3], corners[1], corners[0]);
+}
+
+void LightingRenderer::applyShade(RGBAImage& image, const std::vector<FacePixel>& face,
+		int offset, int y_start, int y_end) const {
+	RGBAPixel* pixels = &image.pixel(0, 0) + offset;
+	const uint8_t* factors = &shade[0];
+	bool limited = y_end >= 0;
+	for (size_t i = 0; i < face.size(); i++) {
+		const FacePixel& face_pixel = face[i];
+		if (limited && (face_pixel.shade_y < y_start || face_pixel.shade_y > y_end))
+			continue;
+		RGBAPixel& pixel = pixels[face_pixel.image];
+		if (pixel != 0)
+			pixel = shadePixel(pixel, factors[face_pixel.shade]);
+	}
+}
+
+LightingRenderMode::LightVolume::LightVolume()
+	: revision(0) {
 }
 
 LightingRenderMode::LightingRenderMode(bool day, double lighting_intensity,
 		double lighting_water_intensity, bool simulate_sun_light)
 	: day(day), lighting_intensity(lighting_intensity),
 	  lighting_water_intensity(lighting_water_intensity),
-	  simulate_sun_light(simulate_sun_light) {
+	  simulate_sun_light(simulate_sun_light), light_volumes(64), current_volume(nullptr) {
+	for (int i = 0; i < 16; i++)
+		light_colors[i] = pow(0.8, 15 - i);
 }
 
 LightingRenderMode::~LightingRenderMode() {
@@ -273,37 +322,25 @@ bool LightingRenderMode::isHidden(const mc::BlockPos& pos,
 
 void LightingRenderMode::draw(RGBAImage& image, const mc::BlockPos& pos,
 		uint16_t id, uint16_t data) {
-	bool transparent = images->isBlockTransparent(id, data);
-
-	bool water = (id == 8 || id == 9) && (data & util::binary<1111>::value) == 0;
-	int texture_size = image.getHeight() / 2;
+	applyShading(image, id, data, getShading(pos, id, data));
+}
 
-	if ((id == 78 && (data & util::binary<1111>::value) == 0) || id == 208) {
-		// flat snow and grass paths also get smooth lighting
-		int height = ((data & util::binary<1111>::value) + 1) / 8.0 * texture_size;
-		if (id == 208)
-			height = texture_size * 15.0 / 16.0;
-		renderer->lightTop(image, getCornerColors(pos, CORNERS_BOTTOM),
-				texture_size - height);
-		renderer->lightLeft(image, getCornerColors(pos, CORNERS_LEFT),
-				texture_size - height, texture_size);
-		renderer->lightRight(image, getCornerColors(pos, CORNERS_RIGHT),
-				texture_size - height, texture_size);
-	} else if (id == 44 || id == 126) {
-		// slabs and wooden slabs
-		doSlabLight(image, pos, id, data);
-	} else if (transparent && !water && id != 79) {
-		// transparent blocks (except full water blocks, ice, grass paths)
-		// get simple lighting, they are completely lighted, not per face
-		doSimpleLight(image, pos, id, data);
-	} else {
-		// do smooth lighting for all other blocks
-		doSmoothLight(image, pos, id, data);
-	}
+bool LightingRenderMode::modifiesBlockImages() const {
+	return true;
 }
 
-LightingColor LightingRenderMode::calculateLightingColor(const LightingData& light) const {
-	return pow(0.8, 15 - light.getLightLevel(day));
+bool LightingRenderMode::getDrawKey(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, std::vector<int32_t>& key) {
+	// the shades of the faces depend only on the fixed-point corner colors
+	Shading shading = getShading(pos, id, data);
+	key.push_back(shading.type);
+	key.push_back(shading.faces);
+	key.push_back(shading.factor);
+	for (int i = 0; i < 3; i++)
+		if (shading.faces & (1 << i))
+			for (int j = 0; j < 4; j++)
+				key.push_back(toFixedPoint(shading.colors[i][j]));
+	return true;
 }
 
 LightingData LightingRenderMode::getBlockLight(const mc::BlockPos& pos) {
@@ -323,9 +360,41 @@ LightingData LightingRenderMode::getBlockLight(const mc::BlockPos& pos) {
 	return light;
 }
 
+uint8_t LightingRenderMode::getLightLevel(const mc::BlockPos& pos) {
+	const mc::Chunk* chunk = *current_chunk;
+	if (chunk == nullptr || pos.y < 0 || pos.y >= mc::CHUNK_HEIGHT * 16)
+		return getBlockLight(pos).getLightLevel(day);
+	const mc::ChunkPos& chunk_pos = chunk->getPos();
+	int x = pos.x - chunk_pos.x * 16 + 1;
+	int z = pos.z - chunk_pos.z * 16 + 1;
+	if (x < 0 || x >= 18 || z < 0 || z >= 18)
+		return getBlockLight(pos).getLightLevel(day);
+
+	if (current_volume == nullptr || current_volume->pos != chunk_pos
+			|| current_volume->revision != chunk->getRevision()) {
+		current_volume = &light_volumes[(chunk_pos.x & 7) * 8 + (chunk_pos.z & 7)];
+		// reset the volume if it belongs to another chunk or to an old version of it
+		if (current_volume->pos != chunk_pos
+				|| current_volume->revision != chunk->getRevision()) {
+			current_volume->pos = chunk_pos;
+			current_volume->revision = chunk->getRevision();
+			for (int i = 0; i < mc::CHUNK_HEIGHT; i++)
+				std::fill(current_volume->sections[i].begin(),
+						current_volume->sections[i].end(), 0xff);
+		}
+	}
+
+	std::vector<uint8_t>& section = current_volume->sections[pos.y / 16];
+	if (section.empty())
+		section.resize(18 * 18 * 16, 0xff);
+	uint8_t& level = section[(pos.y % 16) * 18 * 18 + z * 18 + x];
+	if (level == 0xff)
+		level = getBlockLight(pos).getLightLevel(day);
+	return level;
+}
+
 LightingColor LightingRenderMode::getLightingColor(const mc::BlockPos& pos, double intensity) {
-	LightingData lighting = getBlockLight(pos);
-	LightingColor color = calculateLightingColor(lighting);
+	LightingColor color = light_colors[getLightLevel(pos)];
 	return color + (1-color)*(1-intensity);
 }
 
@@ -352,7 +421,40 @@ CornerColors LightingRenderMode::getCornerColors(const mc::BlockPos& pos,
 	return colors;
 }
 
-void LightingRenderMode::doSmoothLight(RGBAImage& image, const mc::BlockPos& pos,
+LightingRenderMode::Shading LightingRenderMode::getShading(const mc::BlockPos& pos,
+		uint16_t id, uint16_t data) {
+	Shading shading;
+	shading.faces = 0;
+	shading.factor = 255;
+
+	bool transparent = images->isBlockTransparent(id, data);
+	bool water = (id == 8 || id == 9) && (data & util::binary<1111>::value) == 0;
+
+	if ((id == 78 && (data & util::binary<1111>::value) == 0) || id == 208) {
+		// flat snow and grass paths also get smooth lighting
+		shading.type = SHADING_FLAT;
+		shading.faces = LIGHT_LEFT | LIGHT_RIGHT | LIGHT_TOP;
+		shading.colors[0] = getCornerColors(pos, CORNERS_LEFT);
+		shading.colors[1] = getCornerColors(pos, CORNERS_RIGHT);
+		shading.colors[2] = getCornerColors(pos, CORNERS_BOTTOM);
+	} else if (id == 44 || id == 126) {
+		// slabs and wooden slabs
+		shading.type = SHADING_SLAB;
+		getSlabShading(shading, pos);
+	} else if (transparent && !water && id != 79) {
+		// transparent blocks (except full water blocks, ice, grass paths)
+		// get simple lighting, they are completely lighted, not per face
+		shading.type = SHADING_SIMPLE;
+		shading.factor = getLightingColor(pos, lighting_intensity) * 255;
+	} else {
+		// do smooth lighting for all other blocks
+		shading.type = SHADING_SMOOTH;
+		getSmoothShading(shading, pos, id, data);
+	}
+	return shading;
+}
+
+void LightingRenderMode::getSmoothShading(Shading& shading, const mc::BlockPos& pos,
 		uint16_t id, uint16_t data) {
 	// check if lighting faces are visible
 	bool light_left = true, light_right = true, light_top = true;
@@ -398,58 +500,91 @@ void LightingRenderMode::doSmoothLight(RGBAImage& image, const mc::BlockPos& pos
 	double intensity = lighting_intensity;
 	double water_intensity = lighting_water_intensity; // 0.65* lighting_intensity;
 
-	// do the lighting
-	if (light_left)
-		renderer->lightLeft(image, getCornerColors(pos, CORNERS_LEFT, under_water[0] ? water_intensity : intensity));
-
-	if (light_right)
-		renderer->lightRight(image, getCornerColors(pos, CORNERS_RIGHT, under_water[1] ? water_intensity : intensity));
-
-	if (light_top)
-		renderer->lightTop(image, getCornerColors(pos, CORNERS_TOP, under_water[2] ? water_intensity : intensity));
+	// get the corner colors of the faces that need lighting
+	if (light_left) {
+		shading.faces |= LIGHT_LEFT;
+		shading.colors[0] = getCornerColors(pos, CORNERS_LEFT,
+				under_water[0] ? water_intensity : intensity);
+	}
+	if (light_right) {
+		shading.faces |= LIGHT_RIGHT;
+		shading.colors[1] = getCornerColors(pos, CORNERS_RIGHT,
+				under_water[1] ? water_intensity : intensity);
+	}
+	if (light_top) {
+		shading.faces |= LIGHT_TOP;
+		shading.colors[2] = getCornerColors(pos, CORNERS_TOP,
+				under_water[2] ? water_intensity : intensity);
+	}
 }
 
-void LightingRenderMode::doSlabLight(RGBAImage& image, const mc::BlockPos& pos,
-		uint16_t id, uint16_t data) {
-	// to apply smooth lighting to a slab,
-	// we move the top shadow down if this is the bottom slab
-	// and we use only the top/bottom part of the side shadows
-
-	// check if the slab is the top or the bottom half of the block
-	bool top = data & 0x8;
-	// set y-offset for the top face shadow
-	int yoff = top ? 0 : image.getHeight()/4;
-	// set limits for the sides where it should apply lighting
-	int ystart = yoff;
-	int yend = yoff + image.getHeight()/4;
-
-	// light the faces
+void LightingRenderMode::getSlabShading(Shading& shading, const mc::BlockPos& pos) {
+	// the faces of the slab get lighting if they are not covered by another,
+	// not transparent, block
 	mc::Block block;
 	block = getBlock(pos + mc::DIR_WEST);
-	if (block.id == 0 || images->isBlockTransparent(block.id, block.data))
-		renderer->lightLeft(image, getCornerColors(pos, CORNERS_LEFT), ystart, yend);
+	if (block.id == 0 || images->isBlockTransparent(block.id, block.data)) {
+		shading.faces |= LIGHT_LEFT;
+		shading.colors[0] = getCornerColors(pos, CORNERS_LEFT);
+	}
 
 	block = getBlock(pos + mc::DIR_SOUTH);
-	if (block.id == 0 || images->isBlockTransparent(block.id, block.data))
-		renderer->lightRight(image, getCornerColors(pos, CORNERS_RIGHT), ystart, yend);
+	if (block.id == 0 || images->isBlockTransparent(block.id, block.data)) {
+		shading.faces |= LIGHT_RIGHT;
+		shading.colors[1] = getCornerColors(pos, CORNERS_RIGHT);
+	}
 
 	block = getBlock(pos + mc::DIR_TOP);
-	if (block.id == 0 || images->isBlockTransparent(block.id, block.data))
-		renderer->lightTop(image, getCornerColors(pos, CORNERS_TOP), yoff);
+	if (block.id == 0 || images->isBlockTransparent(block.id, block.data)) {
+		shading.faces |= LIGHT_TOP;
+		shading.colors[2] = getCornerColors(pos, CORNERS_TOP);
+	}
 }
 
-void LightingRenderMode::doSimpleLight(RGBAImage& image, const mc::BlockPos& pos,
-		uint16_t id, uint16_t data) {
-	uint8_t factor = getLightingColor(pos, lighting_intensity) * 255;
-
-	int size = image.getWidth();
-	for (int x = 0; x < size; x++) {
-		for (int y = 0; y < size; y++) {
-			uint32_t& pixel = image.pixel(x, y);
-			if (pixel != 0)
-				pixel = rgba_multiply(pixel, factor, factor, factor, 255);
+void LightingRenderMode::applyShading(RGBAImage& image, uint16_t id, uint16_t data,
+		const Shading& shading) const {
+	if (shading.type == SHADING_SIMPLE) {
+		int size = image.getWidth();
+		for (int x = 0; x < size; x++) {
+			for (int y = 0; y < size; y++) {
+				uint32_t& pixel = image.pixel(x, y);
+				if (pixel != 0)
+					pixel = shadePixel(pixel, shading.factor);
+			}
 		}
+		return;
 	}
+
+	// the rows of the side faces and the y-offset of the top face that get lighting
+	int side_start = 0, side_end = image.getHeight() / 2;
+	int top_offset = 0;
+	if (shading.type == SHADING_FLAT) {
+		int texture_size = image.getHeight() / 2;
+		int height = ((data & util::binary<1111>::value) + 1) / 8.0 * texture_size;
+		if (id == 208)
+			height = texture_size * 15.0 / 16.0;
+		side_start = top_offset = texture_size - height;
+		side_end = texture_size;
+		// the top face is lighted first here
+		renderer->lightTop(image, shading.colors[2], top_offset);
+	} else if (shading.type == SHADING_SLAB) {
+		// to apply smooth lighting to a slab,
+		// we move the top shadow down if this is the bottom slab
+		// and we use only the top/bottom part of the side shadows
+
+		// check if the slab is the top or the bottom half of the block
+		bool top = data & 0x8;
+		top_offset = top ? 0 : image.getHeight() / 4;
+		side_start = top_offset;
+		side_end = top_offset + image.getHeight() / 4;
+	}
+
+	if (shading.faces & LIGHT_LEFT)
+		renderer->lightLeft(image, shading.colors[0], side_start, side_end);
+	if (shading.faces & LIGHT_RIGHT)
+		renderer->lightRight(image, shading.colors[1], side_start, side_end);
+	if ((shading.faces & LIGHT_TOP) && shading.type != SHADING_FLAT)
+		renderer->lightTop(image, shading.colors[2], top_offset);
 }
 
 } /* namespace render */
@@ -21,8 +21,10 @@
 #define RENDERMODES_LIGHTING_H_
 
 #include "../rendermode.h"
+#include "../../mc/chunk.h"
 
 #include <array>
+#include <vector>
 
 namespace mapcrafter {
 namespace renderer {
@@ -78,7 +80,13 @@ public:
 	uint8_t getLightLevel(bool day) const;
 
 	static LightingData estimate(const mc::Block& block, BlockImages* images,
-			mc::WorldCache* world, mc::Chunk* current_chunk);
+			mc::WorldCache* world, const mc::Chunk* current_chunk);
+
+	/**
+	 * Returns whether the light of a block is estimated from the blocks around it, this
+	 * is the case for some transparent blocks without correct lighting data.
+	 */
+	static bool isEstimated(uint16_t id);
 
 protected:
 	uint8_t block_light, sky_light;
@@ -132,22 +140,42 @@ public:
 	static const RenderModeRendererType TYPE;
 
 protected:
+	// a pixel of a face of a block image (as index in the image data) and the pixel of
+	// the shade (as index and row in the shade) that lights it
+	struct FacePixel {
+		int image;
+		int shade, shade_y;
+	};
+
+	// the shade of the current face, kept to reuse the memory
+	mutable std::vector<uint8_t> shade;
+
 	/**
-	 * Draws the bottom triangle with the given colors.
+	 * Draws the bottom triangle with the given colors into the shade.
 	 * This is the triangle with corners top left, bottom left and bottom right.
 	 */
-	void drawBottomTriangle(RGBAImage& image, int size, double c1, double c2, double c3) const;
-	
+	void drawBottomTriangle(int size, double c1, double c2, double c3) const;
+
 	/**
-	 * Draws the top triangle with the given colors.
+	 * Draws the top triangle with the given colors into the shade.
 	 * This is the triangle with corners top left, top right and bottom right.
 	 */
-	void drawTopTriangle(RGBAImage& image, int size, double c1, double c2, double c3) const;
-	
+	void drawTopTriangle(int size, double c1, double c2, double c3) const;
+
 	/**
 	 * Draws the shade of the corners by drawing two triangles with the supplied colors.
+	 * The shade has size*size lighting factors (0 - 255, row by row), they are
+	 * interpolated in 16.16 fixed-point.
 	 */
-	void createShade(RGBAImage& image, const CornerColors& corners) const;
+	void createShade(int size, const CornerColors& corners) const;
+
+	/**
+	 * Multiplies the (not transparent) face pixels of an image with their lighting
+	 * factors of the shade, but only the ones of the shade rows y_start to y_end.
+	 * The offset is added to the image indexes of the face pixels.
+	 */
+	void applyShade(RGBAImage& image, const std::vector<FacePixel>& face, int offset = 0,
+			int y_start = 0, int y_end = -1) const;
 };
 
 class LightingRenderMode : public BaseRenderMode<LightingRenderer> {
@@ -158,19 +186,38 @@ public:
 
 	virtual bool isHidden(const mc::BlockPos& pos, uint16_t id, uint16_t data);
 	virtual void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
+	virtual bool modifiesBlockImages() const;
+
+	/**
+	 * The key of a block is its type of lighting, the lighted faces and their
+	 * fixed-point corner colors, so blocks with the same lighting share the images.
+	 */
+	virtual bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key);
 
 private:
 	bool day;
 	double lighting_intensity, lighting_water_intensity;
 	bool simulate_sun_light;
 
-	/**
-	 * Calculates the color of the light of a block.
-	 *
-	 * This uses the formula 0.8**(15 - max(block_light, sky_light))
-	 * When calculating nightlight, the skylight is reduced by 11.
-	 */
-	LightingColor calculateLightingColor(const LightingData& light) const;
+	// the colors of the light levels, this uses the formula 0.8**(15 - light_level)
+	LightingColor light_colors[16];
+
+	// the light levels of the blocks of a chunk and of the blocks around it (the
+	// sections are padded by one block horizontally, index is (y%16)*18*18 + (z+1)*18
+	// + (x+1), 0xff if not known yet), the revision is the one of the chunk they were
+	// computed for (see mc::Chunk::getRevision)
+	struct LightVolume {
+		LightVolume();
+
+		mc::ChunkPos pos;
+		uint64_t revision;
+		std::vector<uint8_t> sections[mc::CHUNK_HEIGHT];
+	};
+
+	// the light volumes of recently rendered chunks, mapped by their positions (8x8 chunks)
+	std::vector<LightVolume> light_volumes;
+	LightVolume* current_volume;
 
 	/**
 	 * Returns the light of a block (sky/block light). This also means that the light is
@@ -178,6 +225,13 @@ private:
 	 */
 	LightingData getBlockLight(const mc::BlockPos& pos);
 
+	/**
+	 * Returns the light level of a block (max(block_light, sky_light), when calculating
+	 * nightlight the skylight is reduced by 11). The light levels of the blocks around
+	 * the current chunk are cached in its light volume.
+	 */
+	uint8_t getLightLevel(const mc::BlockPos& pos);
+
 	/**
 	 * Returns the lighting color of a block.
 	 */
@@ -196,23 +250,40 @@ private:
 	CornerColors getCornerColors(const mc::BlockPos& pos, const FaceCorners& corners,
 			double intensity = -1);
 
+	// how a block is lighted: the type of lighting (smooth lighting of the faces of
+	// normal blocks, slabs and flat blocks or simple lighting with one factor), the
+	// lighted faces (left, right, top bits) and their corner colors, see getShading
+	struct Shading {
+		int type;
+		int faces;
+		CornerColors colors[3];
+		uint8_t factor;
+	};
+
+	/**
+	 * Returns how a block is lighted.
+	 */
+	Shading getShading(const mc::BlockPos& pos, uint16_t id, uint16_t data);
+
 	/**
-	 * Applies the smooth lighting to a block by adding lighting to the top, left and
-	 * right face (if not covered by another, not transparent, block).
+	 * Sets the faces of the smooth lighting of a block that get lighting (if not
+	 * covered by another, not transparent, block) and their corner colors.
 	 */
-	void doSmoothLight(RGBAImage& image, const mc::BlockPos& pos,
-			uint16_t id, uint16_t data);
+	void getSmoothShading(Shading& shading, const mc::BlockPos& pos, uint16_t id,
+			uint16_t data);
 
 	/**
-	 * Applies the smooth lighting to a slab (not double slabs).
+	 * Sets the faces of the smooth lighting of a slab (not double slabs) and their
+	 * corner colors.
 	 */
-	void doSlabLight(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
+	void getSlabShading(Shading& shading, const mc::BlockPos& pos);
 
 	/**
-	 * Applies a simple lighting to a block by coloring the whole block with the lighting
-	 * color of the block.
+	 * Applies the lighting to a block image, the smooth lighting to its faces or a
+	 * simple lighting by coloring the whole block with the lighting color of the block.
 	 */
-	void doSimpleLight(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
+	void applyShading(RGBAImage& image, uint16_t id, uint16_t data,
+			const Shading& shading) const;
 };
 
 } /* namespace render */
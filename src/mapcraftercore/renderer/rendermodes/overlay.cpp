@@ -21,8 +21,11 @@
 
 #include "../blockimages.h"
 #include "../image.h"
+#include "../image/coloring.h"
 #include "../../mc/pos.h"
 
+#include <algorithm>
+
 namespace mapcrafter {
 namespace renderer {
 
@@ -40,14 +43,9 @@ void OverlayRenderer::setHighContrast(bool high_contrast) {
 void OverlayRenderer::tintBlock(RGBAImage& image, RGBAPixel color) const {
 	if (high_contrast) {
 		// do the high contrast mode magic
-		auto overlay = getRecolor(color);
-		for (int y = 0; y < image.getWidth(); y++) {
-			for (int x = 0; x < image.getHeight(); x++) {
-				RGBAPixel& pixel = image.pixel(x, y);
-				if (pixel != 0)
-					pixel = rgba_add_clamp(pixel, overlay);
-			}
-		}
+		if (image.getWidth() > 0 && image.getHeight() > 0)
+			tintRow(&image.pixel(0, 0), image.getWidth() * image.getHeight(),
+					getRecolor(color));
 	} else {
 		// otherwise just simple alphablending
 		for (int y = 0; y < image.getWidth(); y++) {
@@ -80,6 +78,12 @@ std::tuple<int, int, int> OverlayRenderer::getRecolor(RGBAPixel color) const {
 	return std::make_tuple(nr, ng, nb);
 }
 
+void OverlayRenderer::tintRow(RGBAPixel* pixels, int count,
+		const std::tuple<int, int, int>& recolor) const {
+	addClampRow(pixels, count, std::get<0>(recolor), std::get<1>(recolor),
+			std::get<2>(recolor));
+}
+
 const RenderModeRendererType OverlayRenderer::TYPE = RenderModeRendererType::OVERLAY;
 
 OverlayRenderMode::OverlayRenderMode(OverlayMode overlay_mode)
@@ -101,7 +105,6 @@ void OverlayRenderMode::draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t
 	} else {
 		// "advanced" mode where each block/position has a color,
 		// and adjacent faces are tinted / or the transparent blocks themselves
-		// TODO potential for optimization, maybe cache colors of blocks?
 		if (images->isBlockTransparent(id, data)) {
 			RGBAPixel color = getBlockColor(pos, id, data);
 			if (rgba_alpha(color) == 0)
@@ -127,6 +130,28 @@ void OverlayRenderMode::draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t
 	}
 }
 
+bool OverlayRenderMode::modifiesBlockImages() const {
+	return true;
+}
+
+bool OverlayRenderMode::getDrawKey(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, std::vector<int32_t>& key) {
+	// the tinted images depend only on the colors of the tinted block / faces,
+	// see draw() for which colors are used
+	if (overlay_mode == OverlayMode::PER_BLOCK || images->isBlockTransparent(id, data)) {
+		key.push_back(getBlockColor(pos, id, data));
+	} else {
+		mc::Block top, left, right;
+		top = getBlock(pos + mc::DIR_TOP, mc::GET_ID | mc::GET_DATA);
+		left = getBlock(pos + mc::DIR_WEST, mc::GET_ID | mc::GET_DATA);
+		right = getBlock(pos + mc::DIR_SOUTH, mc::GET_ID | mc::GET_DATA);
+		key.push_back(getBlockColor(pos + mc::DIR_TOP, top.id, top.data));
+		key.push_back(getBlockColor(pos + mc::DIR_WEST, left.id, left.data));
+		key.push_back(getBlockColor(pos + mc::DIR_SOUTH, right.id, right.data));
+	}
+	return true;
+}
+
 }
 }
 
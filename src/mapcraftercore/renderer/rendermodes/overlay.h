@@ -25,6 +25,7 @@
 
 #include "../image.h"
 
+#include <map>
 #include <tuple>
 
 namespace mapcrafter {
@@ -52,6 +53,12 @@ public:
 protected:
 	std::tuple<int, int, int> getRecolor(RGBAPixel color) const;
 
+	/**
+	 * Tints a row of pixels with the high contrast mode, that's adding the recolor of the
+	 * overlay color with rgba_add_clamp (completely transparent pixels stay unchanged).
+	 */
+	void tintRow(RGBAPixel* pixels, int count, const std::tuple<int, int, int>& recolor) const;
+
 	bool high_contrast;
 };
 
@@ -71,6 +78,9 @@ public:
 	virtual ~OverlayRenderMode();
 
 	virtual void draw(RGBAImage& image, const mc::BlockPos& pos, uint16_t id, uint16_t data);
+	virtual bool modifiesBlockImages() const;
+	virtual bool getDrawKey(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			std::vector<int32_t>& key);
 
 protected:
 	virtual RGBAPixel getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data) = 0;
@@ -57,9 +57,13 @@ int JavaRandom::nextInt(int max) {
 	return val;
 }
 
+SlimeOverlay::SlimeChunk::SlimeChunk()
+	: valid(false), slime(false) {
+}
+
 SlimeOverlay::SlimeOverlay(fs::path world_dir, int rotation)
 	: OverlayRenderMode(OverlayMode::PER_BLOCK), world_dir(world_dir),
-	  rotation(rotation), world_seed(0) {
+	  rotation(rotation), world_seed(0), slime_chunks(64) {
 	try {
 		nbt::NBTFile level_dat;
 		level_dat.readNBT((world_dir / "level.dat").string().c_str());
@@ -89,14 +93,20 @@ bool SlimeOverlay::isSlimeChunk(const mc::ChunkPos& chunk, long long world_seed)
 }
 
 RGBAPixel SlimeOverlay::getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data) {
-	// get original (not rotated) chunk position
 	mc::ChunkPos chunk(pos);
-	if (rotation) {
-		// -rotation = -rotation + 4 (mod 4), rotate accepts only positive numbers
-		chunk.rotate(-rotation + 4);
+	SlimeChunk& slime_chunk = slime_chunks[(chunk.x & 7) * 8 + (chunk.z & 7)];
+	if (!slime_chunk.valid || slime_chunk.pos != chunk) {
+		slime_chunk.valid = true;
+		slime_chunk.pos = chunk;
+		// get original (not rotated) chunk position
+		if (rotation) {
+			// -rotation = -rotation + 4 (mod 4), rotate accepts only positive numbers
+			chunk.rotate(-rotation + 4);
+		}
+		slime_chunk.slime = isSlimeChunk(chunk, world_seed);
 	}
 
-	if (isSlimeChunk(chunk, world_seed))
+	if (slime_chunk.slime)
 		return rgba(60, 200, 20, 255);
 	return rgba(0, 0, 0, 0);
 }
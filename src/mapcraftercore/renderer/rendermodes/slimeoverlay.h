@@ -23,7 +23,10 @@
 
 #include "overlay.h"
 
+#include "../../mc/pos.h"
+
 #include <boost/filesystem.hpp>
+#include <vector>
 
 namespace fs = boost::filesystem;
 
@@ -56,6 +59,17 @@ protected:
 	fs::path world_dir;
 	int rotation;
 	long long world_seed;
+
+	// slime flags of recently used chunks, the flags depend only on the chunk position
+	// (and the world seed), they are mapped by the (rotated) chunk position
+	struct SlimeChunk {
+		SlimeChunk();
+
+		bool valid;
+		mc::ChunkPos pos;
+		bool slime;
+	};
+	std::vector<SlimeChunk> slime_chunks;
 };
 
 }
@@ -21,11 +21,18 @@
 
 #include "lighting.h"
 
+#include <cstring>
+
 namespace mapcrafter {
 namespace renderer {
 
+SpawnOverlay::DarkMask::DarkMask()
+	: revision(0) {
+}
+
 SpawnOverlay::SpawnOverlay(bool day)
-	: OverlayRenderMode(OverlayMode::PER_FACE), day(day) {
+	: OverlayRenderMode(OverlayMode::PER_FACE), day(day), dark_masks(64),
+	  current_mask(nullptr) {
 }
 
 SpawnOverlay::~SpawnOverlay() {
@@ -34,14 +41,94 @@ SpawnOverlay::~SpawnOverlay() {
 RGBAPixel SpawnOverlay::getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data) {
 	// TODO more options
 	// TODO also mobs can't spawn on specific blocks?
-	mc::Block block = getBlock(pos, mc::GET_ID | mc::GET_DATA | mc::GET_LIGHT);
-	LightingData light = LightingData::estimate(block, images, world, *current_chunk);
-	uint8_t light_level = light.getLightLevel(day);
-	if (light_level < 8)
+	const mc::Chunk* chunk = *current_chunk;
+	bool dark;
+	if (chunk == nullptr || mc::ChunkPos(pos) != chunk->getPos()
+			|| pos.y < 0 || pos.y >= mc::CHUNK_HEIGHT * 16) {
+		dark = isDarkBlock(pos);
+	} else {
+		const mc::ChunkPos& chunk_pos = chunk->getPos();
+		if (current_mask == nullptr || current_mask->pos != chunk_pos
+				|| current_mask->revision != chunk->getRevision()) {
+			current_mask = &dark_masks[(chunk_pos.x & 7) * 8 + (chunk_pos.z & 7)];
+			// reset the mask if it belongs to another chunk or to an old version of it
+			if (current_mask->pos != chunk_pos
+					|| current_mask->revision != chunk->getRevision()) {
+				current_mask->pos = chunk_pos;
+				current_mask->revision = chunk->getRevision();
+				for (int i = 0; i < mc::CHUNK_HEIGHT; i++)
+					current_mask->sections[i].clear();
+			}
+		}
+
+		std::vector<uint64_t>& mask = current_mask->sections[pos.y / 16];
+		if (mask.empty())
+			computeDarkMask(*chunk, pos.y / 16, mask);
+		mc::LocalBlockPos local(pos);
+		int index = ((local.y % 16) * 16 + local.z) * 16 + local.x;
+		dark = (mask[index / 64] >> (index % 64)) & 1;
+	}
+
+	if (dark)
 		return rgba(255, 0, 0, 85);
 	return rgba(0, 0, 0, 0);
 }
 
+bool SpawnOverlay::isDarkBlock(const mc::BlockPos& pos) {
+	mc::Block block = getBlock(pos, mc::GET_ID | mc::GET_DATA | mc::GET_LIGHT);
+	LightingData light = LightingData::estimate(block, images, world, *current_chunk);
+	return light.getLightLevel(day) < 8;
+}
+
+void SpawnOverlay::computeDarkMask(const mc::Chunk& chunk, int section,
+		std::vector<uint64_t>& mask) {
+	const uint8_t* block_light = chunk.getSectionArray(section, 1);
+	const uint8_t* sky_light = chunk.getSectionArray(section, 2);
+	if (block_light == nullptr) {
+		// blocks of not existing sections have no block light, but full sky light,
+		// that's too dark only at night
+		mask.assign(64, day ? 0 : ~0ULL);
+		return;
+	}
+
+	// the light level is below 8 if the fourth bit of the block light and (at day) of
+	// the sky light is not set (at night the sky light is reduced by 11, so always below 8)
+	mask.assign(64, 0);
+	for (int i = 0; i < 256; i++) {
+		uint64_t light, sky;
+		std::memcpy(&light, block_light + i * 8, 8);
+		std::memcpy(&sky, sky_light + i * 8, 8);
+		if (day)
+			light |= sky;
+		// gather the fourth bits of the 16 nibbles (little endian), the nibble of block
+		// 2*n is the lower one of byte n, so the bits end up in the order of the blocks
+		uint64_t bits = (~light >> 3) & 0x1111111111111111ULL;
+		bits = (bits | (bits >> 3)) & 0x0303030303030303ULL;
+		bits = (bits | (bits >> 6)) & 0x000f000f000f000fULL;
+		bits = (bits | (bits >> 12)) & 0x000000ff000000ffULL;
+		bits = (bits | (bits >> 24)) & 0xffffULL;
+		mask[i / 4] |= bits << ((i % 4) * 16);
+	}
+
+	// blocks whose light is estimated from the blocks around them are rare,
+	// they are checked one by one
+	const uint8_t* blocks = chunk.getSectionArray(section, 3);
+	const uint8_t* add = chunk.getSectionArray(section, 4);
+	const mc::ChunkPos& chunk_pos = chunk.getPos();
+	for (int i = 0; i < 16 * 16 * 16; i++) {
+		if (!LightingData::isEstimated(blocks[i]) || (add[i / 2] >> ((i % 2) * 4)) & 0xf)
+			continue;
+		mc::BlockPos pos(chunk_pos.x * 16 + i % 16, chunk_pos.z * 16 + (i / 16) % 16,
+				section * 16 + i / 256);
+		mc::Block block(pos, blocks[i], 0);
+		LightingData light = LightingData::estimate(block, images, world, &chunk);
+		if (light.getLightLevel(day) < 8)
+			mask[i / 64] |= 1ULL << (i % 64);
+		else
+			mask[i / 64] &= ~(1ULL << (i % 64));
+	}
+}
+
 }
 }
 
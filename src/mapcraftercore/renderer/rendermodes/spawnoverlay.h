@@ -22,6 +22,10 @@
 #define RENDERMODES_SPAWNOVERLAY_H_
 
 #include "overlay.h"
+#include "../../mc/chunk.h"
+#include "../../mc/pos.h"
+
+#include <vector>
 
 namespace mapcrafter {
 namespace renderer {
@@ -34,7 +38,34 @@ public:
 protected:
 	virtual RGBAPixel getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data);
 
+	/**
+	 * Checks if the light level at a block is too low to prevent mob spawning, this is
+	 * used for blocks that are not in the current chunk.
+	 */
+	bool isDarkBlock(const mc::BlockPos& pos);
+
+	/**
+	 * Computes the light levels below 8 of the blocks of a section of the current
+	 * chunk, 16 blocks at once from the block light / sky light nibbles of the section.
+	 */
+	void computeDarkMask(const mc::Chunk& chunk, int section, std::vector<uint64_t>& mask);
+
 	bool day;
+
+	// whether the light levels of the blocks of a chunk are below 8 (a bit per block,
+	// index is ((y%16)*16 + z)*16 + x per section, empty if not computed yet), the
+	// revision is the one of the chunk they were computed for (see mc::Chunk::getRevision)
+	struct DarkMask {
+		DarkMask();
+
+		mc::ChunkPos pos;
+		uint64_t revision;
+		std::vector<uint64_t> sections[mc::CHUNK_HEIGHT];
+	};
+
+	// the dark masks of recently rendered chunks, mapped by their positions (8x8 chunks)
+	std::vector<DarkMask> dark_masks;
+	DarkMask* current_mask;
 };
 
 }
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "renderservice.h"
+
+#include "../util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// the seconds after which half of the thread seconds of a tenant are forgotten
+const double USAGE_HALF_LIFE = 3600;
+// the checks after which modified worlds are rendered even if they are still modified
+const int WATCH_MAX_DELAY = 5;
+
+}
+
+ServiceTenant::ServiceTenant()
+	: jobs(1), memory_limit(0) {
+}
+
+TenantState::TenantState()
+	: pending(false), running(false), jobs(1), usage(0), pending_since(0) {
+}
+
+int chooseNextTenant(const std::vector<TenantState>& tenants, int free_threads) {
+	int next = -1;
+	for (size_t i = 0; i < tenants.size(); i++) {
+		const TenantState& tenant = tenants[i];
+		if (!tenant.pending || tenant.running)
+			continue;
+		if (next == -1 || tenant.usage < tenants[next].usage
+				|| (tenant.usage == tenants[next].usage
+						&& tenant.pending_since < tenants[next].pending_since))
+			next = i;
+	}
+	if (next != -1 && tenants[next].jobs > free_threads)
+		return -1;
+	return next;
+}
+
+RenderService::RenderService(int threads, int time_slice, int memory_limit)
+	: threads(threads), time_slice(time_slice), memory_limit(memory_limit),
+	  force_render(false), watch(0),
+	  resource_registry(std::make_shared<ResourceRegistry>()),
+	  used_threads(0), turns(0) {
+	if (threads > 1)
+		thread_pool = std::make_shared<thread::ThreadPool>(threads);
+}
+
+RenderService::~RenderService() {
+	for (auto it = tenants.begin(); it != tenants.end(); ++it)
+		if ((*it)->thread.joinable())
+			(*it)->thread.join();
+}
+
+bool RenderService::readTenants(const fs::path& file,
+		std::vector<ServiceTenant>& tenants) {
+	std::ifstream in(file.string().c_str());
+	if (!in) {
+		LOG(ERROR) << "Unable to read the tenants file '" << file.string() << "'!";
+		return false;
+	}
+	std::string line;
+	for (int number = 1; std::getline(in, line); number++) {
+		line = util::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ss(line);
+		std::vector<std::string> fields;
+		std::string field;
+		while (ss >> field)
+			fields.push_back(field);
+		ServiceTenant tenant;
+		std::istringstream jobs(fields.size() > 1 ? fields[1] : "1");
+		std::istringstream memory_limit(fields.size() > 2 ? fields[2] : "0");
+		if (fields.size() > 3 || !(jobs >> tenant.jobs) || !jobs.eof()
+				|| !(memory_limit >> tenant.memory_limit) || !memory_limit.eof()
+				|| tenant.jobs < 1 || tenant.memory_limit < 0) {
+			LOG(ERROR) << "Invalid line " << number << " in the tenants file '"
+					<< file.string() << "': " << line;
+			return false;
+		}
+		tenant.config = fs::path(fields[0]);
+		if (tenant.config.is_relative())
+			tenant.config = file.parent_path() / tenant.config;
+		tenants.push_back(tenant);
+	}
+	return true;
+}
+
+bool RenderService::addTenant(const ServiceTenant& tenant) {
+	std::unique_ptr<Tenant> added(new Tenant);
+	added->tenant = tenant;
+	config::ValidationMap validation = added->config.parseFile(tenant.config.string());
+	if (!validation.isEmpty()) {
+		if (validation.isCritical())
+			LOG(ERROR) << "Unable to parse configuration file " << tenant.config << ":";
+		else
+			LOG(WARNING) << "There is a problem parsing the configuration file "
+					<< tenant.config << ":";
+		validation.log();
+	}
+	if (validation.isCritical())
+		return false;
+
+	fs::path output_dir = BOOST_FS_ABSOLUTE1(added->config.getOutputDir());
+	for (auto it = tenants.begin(); it != tenants.end(); ++it) {
+		if (BOOST_FS_ABSOLUTE1((*it)->config.getOutputDir()) == output_dir) {
+			LOG(ERROR) << "The configuration files " << (*it)->tenant.config << " and "
+					<< tenant.config << " have the same output directory!";
+			return false;
+		}
+	}
+
+	// a tenant can't use more threads than there are
+	added->tenant.jobs = std::max(1, std::min(tenant.jobs, threads));
+	added->state.pending = true;
+	added->state.jobs = added->tenant.jobs;
+	added->state.pending_since = std::time(nullptr);
+	added->force_render = force_render;
+	added->failed = false;
+	added->turns = 0;
+	added->checks_modified = 0;
+	tenants.push_back(std::move(added));
+	return true;
+}
+
+void RenderService::setForceRender(bool force_render) {
+	this->force_render = force_render;
+	for (auto it = tenants.begin(); it != tenants.end(); ++it)
+		if ((*it)->turns == 0)
+			(*it)->force_render = force_render;
+}
+
+void RenderService::setWatch(int interval) {
+	this->watch = interval;
+}
+
+bool RenderService::run() {
+	LOG(INFO) << "Rendering " << tenants.size() << " configurations with " << threads
+			<< " threads and time slices of " << time_slice << " seconds.";
+	std::time_t last_decay = std::time(nullptr);
+	std::time_t last_check = std::time(nullptr);
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (true) {
+		// the recently used thread seconds decay, so the tenants which rendered a lot
+		// a while ago are not behind forever
+		std::time_t now = std::time(nullptr);
+		double decay = std::pow(0.5, (now - last_decay) / USAGE_HALF_LIFE);
+		for (auto it = tenants.begin(); it != tenants.end(); ++it)
+			(*it)->state.usage *= decay;
+		last_decay = now;
+
+		// start as many turns as there are free threads for
+		while (true) {
+			std::vector<TenantState> states;
+			for (auto it = tenants.begin(); it != tenants.end(); ++it)
+				states.push_back((*it)->state);
+			int next = chooseNextTenant(states, threads - used_threads);
+			if (next == -1)
+				break;
+			Tenant& tenant = *tenants[next];
+			tenant.state.pending = false;
+			tenant.state.running = true;
+			used_threads += tenant.state.jobs;
+			turns++;
+			// the thread of the last turn of the tenant is finished already
+			if (tenant.thread.joinable())
+				tenant.thread.join();
+			tenant.thread = thread_ns::thread(&RenderService::renderTurn, this,
+					std::ref(tenant));
+		}
+
+		bool busy = used_threads > 0;
+		for (auto it = tenants.begin(); it != tenants.end(); ++it)
+			busy = busy || (*it)->state.pending;
+		if (!busy && watch == 0)
+			break;
+
+		if (watch == 0) {
+			turn_finished.wait(lock);
+			continue;
+		}
+		turn_finished.wait_for(lock, thread_ns::chrono::seconds(watch));
+		if (std::time(nullptr) >= last_check + watch) {
+			lock.unlock();
+			checkModified();
+			lock.lock();
+			last_check = std::time(nullptr);
+		}
+	}
+
+	bool ok = true;
+	for (auto it = tenants.begin(); it != tenants.end(); ++it) {
+		if ((*it)->thread.joinable())
+			(*it)->thread.join();
+		ok = ok && !(*it)->failed;
+	}
+	LOG(INFO) << "Rendered " << tenants.size() << " configurations in " << turns
+			<< " turns.";
+	return ok;
+}
+
+int RenderService::getTurns() const {
+	return turns;
+}
+
+void RenderService::renderTurn(Tenant& tenant) {
+	std::string name = tenant.tenant.config.string();
+	int jobs = tenant.state.jobs;
+	LOG(INFO) << "Starting turn " << tenant.turns + 1 << " of " << name << " with "
+			<< jobs << " jobs.";
+	std::time_t start = std::time(nullptr);
+
+	RenderManager manager(tenant.config);
+	// the worlds modified while rendering are rendered by the next turn
+	RenderManager::RegionFiles region_files;
+	if (watch > 0)
+		region_files = manager.getRegionFiles();
+	manager.setRenderBehaviors(RenderBehaviors(tenant.force_render
+			? RenderBehavior::FORCE : RenderBehavior::AUTO));
+	int tenant_memory_limit = tenant.tenant.memory_limit > 0
+			? tenant.tenant.memory_limit : memory_limit;
+	manager.setMemoryLimit((size_t) tenant_memory_limit * 1024 * 1024);
+	manager.setMaxTime(time_slice);
+	manager.setThreadPool(thread_pool);
+	manager.setResourceRegistry(resource_registry);
+	bool ok = manager.run(jobs, true);
+
+	std::time_t took = std::time(nullptr) - start;
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	tenant.turns++;
+	tenant.state.running = false;
+	tenant.state.usage += (double) std::max((std::time_t) 1, took) * jobs;
+	used_threads -= jobs;
+	tenant.failed = !ok;
+	if (!ok) {
+		// the tenant is rendered again once its worlds were modified
+		LOG(ERROR) << "Unable to render " << name << ".";
+	} else if (manager.wasStopped()) {
+		// a force-render is continued as incremental rendering
+		tenant.force_render = false;
+		tenant.state.pending = true;
+		tenant.state.pending_since = std::time(nullptr);
+		LOG(INFO) << "The time slice of " << name << " is over after " << took
+				<< " seconds, it continues with the next turn.";
+	} else {
+		tenant.force_render = false;
+		LOG(INFO) << "Rendered " << name << " in " << took << " seconds.";
+	}
+	if (!tenant.state.pending) {
+		tenant.rendered_files = region_files;
+		tenant.checked_files = region_files;
+		tenant.checks_modified = 0;
+	}
+	turn_finished.notify_all();
+}
+
+void RenderService::checkModified() {
+	for (auto it = tenants.begin(); it != tenants.end(); ++it) {
+		Tenant& tenant = **it;
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		if (tenant.state.pending || tenant.state.running)
+			continue;
+		lock.unlock();
+		RenderManager::RegionFiles region_files
+			= RenderManager(tenant.config).getRegionFiles();
+		lock.lock();
+		if (region_files == tenant.rendered_files) {
+			tenant.checks_modified = 0;
+		} else if (region_files == tenant.checked_files
+				|| ++tenant.checks_modified > WATCH_MAX_DELAY) {
+			// rendered once the worlds are saved
+			LOG(INFO) << "The worlds of " << tenant.tenant.config.string()
+					<< " were modified, rendering them again.";
+			tenant.state.pending = true;
+			tenant.state.pending_since = std::time(nullptr);
+		}
+		tenant.checked_files = region_files;
+	}
+}
+
+}
+}
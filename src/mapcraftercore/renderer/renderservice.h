@@ -0,0 +1,188 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RENDERSERVICE_H_
+#define RENDERSERVICE_H_
+
+#include "manager.h"
+#include "resourceregistry.h"
+#include "../compat/thread.h"
+#include "../config/mapcrafterconfig.h"
+#include "../thread/impl/threadpool.h"
+
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * A configuration rendered by the render service, with the count of render threads it
+ * may use at the same time and the memory limit of its caches in MiB (0 for the one of
+ * the service).
+ */
+struct ServiceTenant {
+	ServiceTenant();
+
+	fs::path config;
+	int jobs;
+	int memory_limit;
+};
+
+/**
+ * What the scheduler of the render service knows about a tenant.
+ */
+struct TenantState {
+	TenantState();
+
+	// whether the tenant has something to render, and whether it's rendering now
+	bool pending, running;
+	// the count of threads a turn of the tenant uses
+	int jobs;
+	// the thread seconds the tenant rendered recently (decaying over time)
+	double usage;
+	// since when the tenant has something to render
+	std::time_t pending_since;
+};
+
+/**
+ * Returns the tenant which renders next if a count of render threads is free: The
+ * pending tenant which rendered the least recently, the one waiting the longest if
+ * there are multiple ones. Returns -1 if there is no pending tenant, or if the threads
+ * of the chosen one are not free yet. Other tenants don't take the threads meanwhile,
+ * so tenants with many jobs don't starve.
+ */
+int chooseNextTenant(const std::vector<TenantState>& tenants, int free_threads);
+
+/**
+ * Renders the maps of many configurations (tenants) in one process, for example for a
+ * host of many servers. The tenants share one pool of render threads and the loaded
+ * textures and block images (see ResourceRegistry), instead of running one process with
+ * its own threads and caches per configuration.
+ *
+ * The tenants render in turns: A turn renders a tenant like the run method of the
+ * render manager, with the jobs and the memory limit of the tenant, but stops rendering
+ * new tiles after a time slice. A stopped tenant is pending again and continues with the
+ * next turn. Multiple tenants have turns at the same time as long as there are free
+ * threads, the next turn is the one of the tenant which used the least thread seconds
+ * recently (see chooseNextTenant), so small incremental renderings don't wait for a
+ * large tenant which renders its maps completely.
+ */
+class RenderService {
+public:
+	/**
+	 * Creates the service with a count of render threads shared by the tenants, a time
+	 * slice in seconds, and the memory limit in MiB of the tenants without their own one.
+	 */
+	RenderService(int threads, int time_slice, int memory_limit = 0);
+	~RenderService();
+
+	/**
+	 * Reads the tenants from a file, every line is the path of a configuration file
+	 * (relative to the file), and optionally the jobs and the memory limit in MiB of the
+	 * tenant. Empty lines and lines starting with # are ignored. Returns false if the
+	 * file can't be read or has an invalid line.
+	 */
+	static bool readTenants(const fs::path& file, std::vector<ServiceTenant>& tenants);
+
+	/**
+	 * Adds a tenant. Returns false if the configuration is invalid, or if it has the same
+	 * output directory as another tenant.
+	 */
+	bool addTenant(const ServiceTenant& tenant);
+
+	/**
+	 * Sets whether the maps are rendered completely by the first turns of the tenants.
+	 */
+	void setForceRender(bool force_render);
+
+	/**
+	 * Sets the seconds between the checks for modified worlds of the tenants, their maps
+	 * are rendered again once their worlds were modified. 0 (the default) renders the
+	 * maps of the tenants only once and returns from the run method then.
+	 */
+	void setWatch(int interval);
+
+	/**
+	 * Renders the tenants until they are up to date (or forever when watching the
+	 * worlds). Returns false if the tenants of a non-watching service failed.
+	 */
+	bool run();
+
+	/**
+	 * Returns how many turns the tenants had.
+	 */
+	int getTurns() const;
+
+private:
+	struct Tenant {
+		ServiceTenant tenant;
+		config::MapcrafterConfig config;
+		TenantState state;
+		// whether the maps are rendered completely by the next turn, whether the last
+		// turn failed, and how many turns the tenant had
+		bool force_render, failed;
+		int turns;
+		// the region files when the last turn started, and when they were checked last,
+		// to render the tenant again once they are modified
+		RenderManager::RegionFiles rendered_files, checked_files;
+		int checks_modified;
+		// the thread of the last turn
+		thread_ns::thread thread;
+	};
+
+	/**
+	 * Renders a turn of a tenant, on an own thread.
+	 */
+	void renderTurn(Tenant& tenant);
+
+	/**
+	 * Checks whether the worlds of the tenants which are up to date were modified.
+	 */
+	void checkModified();
+
+	int threads, time_slice, memory_limit;
+	bool force_render;
+	int watch;
+
+	std::shared_ptr<thread::ThreadPool> thread_pool;
+	std::shared_ptr<ResourceRegistry> resource_registry;
+
+	std::vector<std::unique_ptr<Tenant> > tenants;
+	// the count of render threads used by the turns at the moment, and the count of
+	// turns so far
+	int used_threads;
+	int turns;
+
+	// guards the states of the tenants and the used threads, and is notified when a turn
+	// is finished
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable turn_finished;
+};
+
+}
+}
+
+#endif /* RENDERSERVICE_H_ */
@@ -20,12 +20,17 @@
 #include "blockimages.h"
 
 #include "../../biomes.h"
+#include "../../image/coloring.h"
+#include "../../../compat/thread.h"
 #include "../../../util.h"
 
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <sstream>
+#include <utility>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -122,6 +127,87 @@ void TopFaceIterator::next() {
 	}
 }
 
+std::vector<FaceSpan> getFaceSpans(int face, int size) {
+	// mark the pixels of the face like blitFace() and collect the runs of marked pixels
+	int width = 2 * size, height = 2 * size;
+	std::vector<bool> mask(width * height, false);
+	if (face == FACE_TOP) {
+		for (TopFaceIterator it(size); !it.end(); it.next())
+			mask[it.dest_y * width + it.dest_x] = true;
+	} else {
+		int side = face == FACE_SOUTH ? SideFaceIterator::RIGHT : SideFaceIterator::LEFT;
+		int xoff = face == FACE_SOUTH ? size : 0;
+		for (SideFaceIterator it(size, side); !it.end(); it.next())
+			mask[(it.dest_y + size / 2) * width + it.dest_x + xoff] = true;
+	}
+
+	std::vector<FaceSpan> spans;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (!mask[y * width + x])
+				continue;
+			FaceSpan span = {x, y, 0};
+			while (x < width && mask[y * width + x]) {
+				span.count++;
+				x++;
+			}
+			spans.push_back(span);
+		}
+	}
+	return spans;
+}
+
+namespace {
+
+/**
+ * A pixel of a projected face: the index of the pixel in the (square) texture and the
+ * position on the block image.
+ */
+struct FaceProjectionPixel {
+	int src;
+	int dest_x, dest_y;
+};
+
+enum {
+	PROJECTION_TOP,
+	PROJECTION_LEFT,
+	PROJECTION_RIGHT
+};
+
+/**
+ * Returns how the top face iterator / side face iterators project the pixels of a texture
+ * with a size. The projections are computed only once per face and size and shared by
+ * all threads.
+ */
+const std::vector<FaceProjectionPixel>& getFaceProjection(int type, int size) {
+	static thread_ns::mutex mutex;
+	static std::map<std::pair<int, int>, std::vector<FaceProjectionPixel> > projections;
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto key = std::make_pair(type, size);
+	auto it = projections.find(key);
+	if (it != projections.end())
+		return it->second;
+
+	std::vector<FaceProjectionPixel>& projection = projections[key];
+	projection.reserve(size * size);
+	if (type == PROJECTION_TOP) {
+		for (TopFaceIterator it(size); !it.end(); it.next()) {
+			FaceProjectionPixel pixel = {it.src_y * size + it.src_x, it.dest_x, it.dest_y};
+			projection.push_back(pixel);
+		}
+	} else {
+		int side = type == PROJECTION_LEFT ? SideFaceIterator::LEFT : SideFaceIterator::RIGHT;
+		for (SideFaceIterator it(size, side); !it.end(); it.next()) {
+			FaceProjectionPixel pixel = {it.src_y * size + it.src_x, it.dest_x, it.dest_y};
+			projection.push_back(pixel);
+		}
+	}
+	return projection;
+}
+
+}
+
 /**
  * Blits a face on a block image.
  */
@@ -138,29 +224,47 @@ void blitFace(RGBAImage& image, int face, const RGBAImage& texture, int xoff, in
 	int xsize = texture.getWidth();
 	int ysize = texture.getHeight();
 	int size = std::max(xsize, ysize);
+	if (size == 0)
+		return;
 
+	int type = PROJECTION_TOP;
 	if (face == FACE_BOTTOM || face == FACE_TOP) {
 		if (face == FACE_BOTTOM)
 			yoff += ysize;
-		for (TopFaceIterator it(size); !it.end(); it.next()) {
-			uint32_t pixel = texture.getPixel(it.src_x, it.src_y);
-			image.blendPixel(rgba_multiply(pixel, d, d, d), it.dest_x + xoff,
-					it.dest_y + yoff);
-		}
 	} else {
-		int itside = SideFaceIterator::LEFT;
+		type = PROJECTION_LEFT;
 		if (face == FACE_NORTH || face == FACE_SOUTH)
-			itside = SideFaceIterator::RIGHT;
+			type = PROJECTION_RIGHT;
 
 		if (face == FACE_EAST || face == FACE_SOUTH)
 			xoff += xsize;
 		if (face == FACE_WEST || face == FACE_SOUTH)
 			yoff += ysize / 2;
-		for (SideFaceIterator it(size, itside); !it.end(); it.next()) {
-			uint32_t pixel = texture.getPixel(it.src_x, it.src_y);
-			image.blendPixel(rgba_multiply(pixel, d, d, d), it.dest_x + xoff,
-					it.dest_y + yoff);
-		}
+	}
+
+	// the darkened color channels, the same values as rgba_multiply(pixel, d, d, d)
+	uint8_t darkened[256];
+	if (d != 1)
+		for (int c = 0; c < 256; c++)
+			darkened[c] = c * d;
+
+	// gather the pixels of the face from the texture in one pass, the textures are
+	// usually square, other ones are read with their bounds checked
+	const std::vector<FaceProjectionPixel>& projection = getFaceProjection(type, size);
+	const RGBAPixel* data = xsize == ysize ? &texture.pixel(0, 0) : nullptr;
+	int width = image.getWidth(), height = image.getHeight();
+	for (auto it = projection.begin(); it != projection.end(); ++it) {
+		RGBAPixel pixel = data != nullptr ? data[it->src]
+				: texture.getPixel(it->src % size, it->src / size);
+		if (rgba_alpha(pixel) == 0)
+			continue;
+		int x = it->dest_x + xoff, y = it->dest_y + yoff;
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			continue;
+		if (d != 1)
+			pixel = rgba(darkened[rgba_red(pixel)], darkened[rgba_green(pixel)],
+					darkened[rgba_blue(pixel)], rgba_alpha(pixel));
+		blend(image.pixel(x, y), pixel);
 	}
 }
 
@@ -272,7 +376,7 @@ BlockImage BlockImage::rotate(int count) const {
 		// we have to flip the texture if it is moved from/to south|west to/from north|east
 		if (((face == FACE_SOUTH || face == FACE_WEST) && (new_face == FACE_NORTH || new_face == FACE_EAST))
 				|| ((new_face == FACE_SOUTH || new_face == FACE_WEST) && (face == FACE_NORTH || face == FACE_EAST)))
-			texture = texture.flip(true, false);
+			texture = std::move(texture).flip(true, false);
 		rotated.setFace(new_face, texture, getXOffset(face), getYOffset(face));
 	}
 
@@ -332,17 +436,33 @@ bool IsometricBlockImages::isBlockTransparent(uint16_t id, uint16_t data) const
 }
 
 RGBAImage IsometricBlockImages::getBiomeBlock(uint16_t id, uint16_t data,
-		uint16_t extra_data, const Biome& biome) const {
+		uint16_t extra_data, const BiomeColors& colors) const {
 	// return normal block for the snowy grass block
 	if (id == 2 && (data & GRASS_SNOW))
 		return getBlock(id, data, extra_data);
-	return AbstractBlockImages::getBiomeBlock(id, data, biome, extra_data);
+	return AbstractBlockImages::getBiomeBlock(id, data, colors, extra_data);
+}
+
+uint32_t IsometricBlockImages::getBiomeColor(uint16_t id, uint16_t data,
+		const BiomeColors& colors) const {
+	// leaves have the foliage colors
+	// for birches, the color x/y coordinate is flipped
+	if (id == 18)
+		return (data & util::binary<11>::value) == 2 ? colors.foliage_flipped : colors.foliage;
+	return colors.grass;
 }
 
 int IsometricBlockImages::getBlockSize() const {
 	return texture_size * 2;
 }
 
+std::string IsometricBlockImages::getCacheKey(const TextureResources& resources) const {
+	std::ostringstream key;
+	key << AbstractBlockImages::getCacheKey(resources) << " isometric " << dleft
+		<< " " << dright;
+	return key.str();
+}
+
 /**
  * This method filters unnecessary block data, for example the leaves decay counter.
  */
@@ -435,6 +555,7 @@ bool IsometricBlockImages::isImageTransparent(const RGBAImage& image) const {
  * masks and then stores the block image with the special data.
  */
 void IsometricBlockImages::addBlockShadowEdges(uint16_t id, uint16_t data, const RGBAImage& block) {
+	std::vector<std::pair<uint32_t, RGBAImage> > images;
 	for (int n = 0; n <= 1; n++)
 		for (int e = 0; e <= 1; e++)
 			for (int b = 0; b <= 1; b++) {
@@ -452,8 +573,12 @@ void IsometricBlockImages::addBlockShadowEdges(uint16_t id, uint16_t data, const
 					image.alphaBlit(shadow_edge_masks[2], 0, 0);
 					extra_data |= EDGE_BOTTOM;
 				}
-				block_images[id | ((data | extra_data) << 16)] = image;
+				images.push_back(std::make_pair(id | ((data | extra_data) << 16), image));
 			}
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(block_images_mutex);
+	for (auto it = images.begin(); it != images.end(); ++it)
+		block_images[it->first] = it->second;
 }
 
 /**
@@ -471,7 +596,12 @@ void IsometricBlockImages::setBlockImage(uint16_t id, uint16_t data, const RGBAI
 	AbstractBlockImages::setBlockImage(id, data, block);
 
 	// if block is not transparent, add shadow edges
-	if (!isBlockTransparent(id, data))
+	bool transparent;
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(block_images_mutex);
+		transparent = isBlockTransparent(id, data);
+	}
+	if (!transparent)
 		addBlockShadowEdges(id, data, block);
 }
 
@@ -1166,8 +1296,8 @@ void IsometricBlockImages::createRedstoneWire(uint16_t id, uint16_t extra_data,
 	redstone_cross.simpleAlphaBlit(redstone_line.rotate(1), 0, 0);
 
 	//uint8_t color = powered ? 50 : 255;
-	redstone_cross = redstone_cross.colorize(r, g, b);
-	redstone_line = redstone_line.colorize(r, g, b);
+	redstone_cross = std::move(redstone_cross).colorize(r, g, b);
+	redstone_line = std::move(redstone_line).colorize(r, g, b);
 
 	// 1/16 of the texture size
 	double s = (double) texture_size / 16;
@@ -1218,7 +1348,7 @@ void IsometricBlockImages::createRedstoneWire(uint16_t id, uint16_t extra_data,
 			block.setFace(FACE_WEST, redstone_line.rotate(ROTATE_90));
 
 		// rotate the texture to fit the sky directions
-		texture = texture.rotate(ROTATE_270);
+		texture = std::move(texture).rotate(ROTATE_270);
 		block.setFace(FACE_BOTTOM, texture);
 
 		// we can add the block like this without rotation
@@ -1255,7 +1385,7 @@ void IsometricBlockImages::createDoor(uint16_t id, const RGBAImage& texture_bott
 			for (int d = 0; d < 4; d++) {
 				RGBAImage texture = (top ? texture_top : texture_bottom);
 				if (flip_x)
-					texture = texture.flip(true, false);
+					texture = std::move(texture).flip(true, false);
 				BlockImage block;
 
 				uint16_t direction = 0;
@@ -1355,12 +1485,16 @@ void IsometricBlockImages::createIce(uint8_t id, uint16_t extra_data, const RGBA
 	}
 }
 
-void IsometricBlockImages::createCactus() { // id 81
+RGBAImage IsometricBlockImages::buildCactus() const {
 	BlockImage block;
 	block.setFace(FACE_WEST, resources.getBlockTextures().CACTUS_SIDE, 2, 0);
 	block.setFace(FACE_SOUTH, resources.getBlockTextures().CACTUS_SIDE, -2, 0);
 	block.setFace(FACE_TOP, resources.getBlockTextures().CACTUS_TOP);
-	setBlockImage(81, 0, buildImage(block));
+	return buildImage(block);
+}
+
+void IsometricBlockImages::createCactus() { // id 81
+	setBlockImage(81, 0, buildCactus());
 }
 
 /**
@@ -1865,7 +1999,8 @@ void IsometricBlockImages::createFlowerPot() { // id 140
 		RGBAImage block = pot;
 
 		if (i == 9) {
-			RGBAImage cactus = getBlock(81, 0);
+			// built again, the cactus block may be created by another thread
+			RGBAImage cactus = buildCactus();
 			RGBAImage content;
 			cactus.resize(content, s*16, s*16, InterpolationType::NEAREST);
 			block.alphaBlit(content, s*8, s*8);
@@ -1953,21 +2088,13 @@ RGBAImage IsometricBlockImages::createUnknownBlock() const {
 }
 
 RGBAImage IsometricBlockImages::createBiomeBlock(uint16_t id, uint16_t data,
-        const Biome& biome) const {
+        uint32_t color) const {
 	if (!block_images.count(id | (data << 16)))
 		return unknown_block;
 
-	uint32_t color;
-	// leaves have the foliage colors
-	// for birches, the color x/y coordinate is flipped
-	if (id == 18)
-		color = biome.getColor(resources.getFoliageColors(), (data & util::binary<11>::value) == 2);
-	else
-		color = biome.getColor(resources.getGrassColors(), false);
-
-	double r = (double) rgba_red(color) / 255;
-	double g = (double) rgba_green(color) / 255;
-	double b = (double) rgba_blue(color) / 255;
+	uint8_t r = rgba_red(color);
+	uint8_t g = rgba_green(color);
+	uint8_t b = rgba_blue(color);
 
 	// grass block needs something special
 	if (id == 2) {
@@ -1979,10 +2106,8 @@ RGBAImage IsometricBlockImages::createBiomeBlock(uint16_t id, uint16_t data,
 		blitFace(block, FACE_SOUTH, side, 0, 0, false);
 
 		// now tint the top of the block
-		for (TopFaceIterator it(texture_size); !it.end(); it.next()) {
-			uint32_t pixel = block.getPixel(it.dest_x, it.dest_y);
-			block.setPixel(it.dest_x, it.dest_y, rgba_multiply(pixel, r, g, b));
-		}
+		for (auto it = top_face_spans.begin(); it != top_face_spans.end(); ++it)
+			multiplyRow(&block.pixel(it->x, it->y), it->count, r, g, b);
 
 		return block;
 	}
@@ -1992,552 +2117,588 @@ RGBAImage IsometricBlockImages::createBiomeBlock(uint16_t id, uint16_t data,
 
 void IsometricBlockImages::createBlocks() {
 	buildCustomTextures();
+	top_face_spans = getFaceSpans(FACE_TOP, texture_size);
 
 	const BlockTextures& t = resources.getBlockTextures();
 
-	createBlock(1, 0, t.STONE); // stone
-	createBlock(1, 1, t.STONE_GRANITE); // granite
-	createBlock(1, 2, t.STONE_GRANITE_SMOOTH); // polished granite
-	createBlock(1, 3, t.STONE_DIORITE); // diorite
-	createBlock(1, 4, t.STONE_DIORITE_SMOOTH); // polished diorite
-	createBlock(1, 5, t.STONE_ANDESITE); // andesite
-	createBlock(1, 6, t.STONE_ANDESITE_SMOOTH); // polished andesite
-	createGrassBlock(); // id 2
-	createBlock(3, 0, t.DIRT); // dirt
-	createBlock(3, 1, t.DIRT); // grassless dirt
-	createBlock(3, 2, t.DIRT_PODZOL_SIDE, t.DIRT_PODZOL_SIDE, t.DIRT_PODZOL_TOP); // podzol
-	createBlock(4, 0, t.COBBLESTONE); // cobblestone
-	// -- wooden planks
-	createBlock(5, 0, t.PLANKS_OAK); // oak
-	createBlock(5, 1, t.PLANKS_SPRUCE); // pine/spruce
-	createBlock(5, 2, t.PLANKS_BIRCH); // birch
-	createBlock(5, 3, t.PLANKS_JUNGLE); // jungle
-	createBlock(5, 4, t.PLANKS_ACACIA); // acacia
-	createBlock(5, 5, t.PLANKS_BIG_OAK); // dark oak
-	// --
-	// -- saplings
-	createItemStyleBlock(6, 0, t.SAPLING_OAK); // oak
-	createItemStyleBlock(6, 1, t.SAPLING_SPRUCE); // spruce
-	createItemStyleBlock(6, 2, t.SAPLING_BIRCH); // birch
-	createItemStyleBlock(6, 3, t.SAPLING_JUNGLE); // jungle
-	createItemStyleBlock(6, 4, t.SAPLING_ACACIA); // acacia
-	createItemStyleBlock(6, 5, t.SAPLING_ROOFED_OAK); // dark oak
-	// --
-	createBlock(7, 0, t.BEDROCK); // bedrock
-	createWater(); // id 8, 9
-	createLava(); // id 10, 11
-	createBlock(12, 0, t.SAND); // sand
-	createBlock(12, 1, t.RED_SAND); // red sand
-	createBlock(13, 0, t.GRAVEL); // gravel
-	createBlock(14, 0, t.GOLD_ORE); // gold ore
-	createBlock(15, 0, t.IRON_ORE); // iron ore
-	createBlock(16, 0, t.COAL_ORE); // coal ore
-	// -- wood
-	createWood(17, 0, t.LOG_OAK, t.LOG_OAK_TOP); // oak
-	createWood(17, 1, t.LOG_SPRUCE, t.LOG_SPRUCE_TOP); // pine/spruce
-	createWood(17, 2, t.LOG_BIRCH, t.LOG_BIRCH_TOP); // birch
-	createWood(17, 3, t.LOG_JUNGLE, t.LOG_JUNGLE_TOP); // jungle
-	// --
-	createLeaves(); // id 18
-	createBlock(19, 0, t.SPONGE); // sponge
-	createBlock(19, 1, t.SPONGE_WET); // wet sponge
-	createGlass(20, 0, t.GLASS);
-	createBlock(21, 0, t.LAPIS_ORE); // lapis lazuli ore
-	createBlock(22, 0, t.LAPIS_BLOCK); // lapis lazuli block
-	createDispenserDropper(23, t.DISPENSER_FRONT_HORIZONTAL); // dispenser
-	// -- sandstone
-	createBlock(24, 0, t.SANDSTONE_NORMAL, t.SANDSTONE_TOP); // normal
-	createBlock(24, 1, t.SANDSTONE_CARVED, t.SANDSTONE_TOP); // chiseled
-	createBlock(24, 2, t.SANDSTONE_SMOOTH, t.SANDSTONE_TOP); // smooth
-	// --
-	createBlock(25, 0, t.NOTEBLOCK); // noteblock
-	createBed(resources.getBedTextures()); // id 26 bed
-	createStraightRails(27, 0, t.RAIL_GOLDEN); // id 27 powered rail (unpowered)
-	createStraightRails(27, 8, t.RAIL_GOLDEN_POWERED); // id 27 powered rail (powered)
-	createStraightRails(28, 0, t.RAIL_ACTIVATOR); // id 28 detector rail
-	createPiston(29, true); // sticky piston
-	createItemStyleBlock(30, 0, t.WEB); // cobweb
-	// -- tall grass
-	createItemStyleBlock(31, 0, t.DEADBUSH); // dead bush style
-	createItemStyleBlock(31, 1, t.TALLGRASS); // tall grass
-	createItemStyleBlock(31, 2, t.FERN); // fern
-	// --
-	createItemStyleBlock(32, 0, t.DEADBUSH); // dead bush
-	createPiston(33, false); // piston
-	// id 34 // piston extension
-	// -- wool
-	createBlock(35, 0, t.WOOL_COLORED_WHITE); // white
-	createBlock(35, 1, t.WOOL_COLORED_ORANGE); // orange
-	createBlock(35, 2, t.WOOL_COLORED_MAGENTA); // magenta
-	createBlock(35, 3, t.WOOL_COLORED_LIGHT_BLUE); // light blue
-	createBlock(35, 4, t.WOOL_COLORED_YELLOW); // yellow
-	createBlock(35, 5, t.WOOL_COLORED_LIME); // lime
-	createBlock(35, 6, t.WOOL_COLORED_PINK); // pink
-	createBlock(35, 7, t.WOOL_COLORED_GRAY); // gray
-	createBlock(35, 8, t.WOOL_COLORED_SILVER); // light gray
-	createBlock(35, 9, t.WOOL_COLORED_CYAN); // cyan
-	createBlock(35, 10, t.WOOL_COLORED_PURPLE); // purple
-	createBlock(35, 11, t.WOOL_COLORED_BLUE); // blue
-	createBlock(35, 12, t.WOOL_COLORED_BROWN); // brown
-	createBlock(35, 13, t.WOOL_COLORED_GREEN); // green
-	createBlock(35, 14, t.WOOL_COLORED_RED); // red
-	createBlock(35, 15, t.WOOL_COLORED_BLACK); // black
-	// --
-	createBlock(36, 0, empty_texture); // block moved by piston aka 'block 36'
-	createItemStyleBlock(37, 0, t.FLOWER_DANDELION); // dandelion
-	// -- poppy -- different flowers
-	createItemStyleBlock(38, 0, t.FLOWER_ROSE); // poppy
-	createItemStyleBlock(38, 1, t.FLOWER_BLUE_ORCHID); // blue orchid
-	createItemStyleBlock(38, 2, t.FLOWER_ALLIUM); // azure bluet
-	createItemStyleBlock(38, 3, t.FLOWER_HOUSTONIA); //
-	createItemStyleBlock(38, 4, t.FLOWER_TULIP_RED); // red tulip
-	createItemStyleBlock(38, 5, t.FLOWER_TULIP_ORANGE); // orange tulip
-	createItemStyleBlock(38, 6, t.FLOWER_TULIP_WHITE); // white tulip
-	createItemStyleBlock(38, 7, t.FLOWER_TULIP_PINK); // pink tulip
-	createItemStyleBlock(38, 8, t.FLOWER_OXEYE_DAISY); // oxeye daisy
-	// --
-	createItemStyleBlock(39, 0, t.MUSHROOM_BROWN); // brown mushroom
-	createItemStyleBlock(40, 0, t.MUSHROOM_RED); // red mushroom
-	createBlock(41, 0, t.GOLD_BLOCK); // block of gold
-	createBlock(42, 0, t.IRON_BLOCK); // block of iron
-	createSlabs(43, SlabType::STONE, true); // double stone slabs
-	createSlabs(44, SlabType::STONE, false); // normal stone slabs
-	createBlock(45, 0, t.BRICK); // bricks
-	createBlock(46, 0, t.TNT_SIDE, t.TNT_TOP); // tnt
-	createBlock(47, 0, t.BOOKSHELF, t.PLANKS_OAK); // bookshelf
-	createBlock(48, 0, t.COBBLESTONE_MOSSY); // moss stone
-	createBlock(49, 0, t.OBSIDIAN); // obsidian
-	createTorch(50, t.TORCH_ON); // torch
-	createItemStyleBlock(51, 0, t.FIRE_LAYER_0); // fire
-	createBlock(52, 0, t.MOB_SPAWNER); // monster spawner
-	createStairs(53, t.PLANKS_OAK); // oak wood stairs
-	createChest(54, resources.getNormalChest()); // chest
-	createDoubleChest(54, resources.getNormalDoubleChest()); // chest
-	createRedstoneWire(55, 0, 48, 0, 0); // redstone wire not powered
-	createRedstoneWire(55, REDSTONE_POWERED, 192, 0, 0); // redstone wire powered
-	createBlock(56, 0, t.DIAMOND_ORE); // diamond ore
-	createBlock(57, 0, t.DIAMOND_BLOCK); // block of diamond
-	createBlock(58, 0, t.CRAFTING_TABLE_SIDE, t.CRAFTING_TABLE_FRONT, t.CRAFTING_TABLE_TOP); // crafting table
-	// -- wheat
-	createItemStyleBlock(59, 0, t.WHEAT_STAGE_0); //
-	createItemStyleBlock(59, 1, t.WHEAT_STAGE_1); //
-	createItemStyleBlock(59, 2, t.WHEAT_STAGE_2); //
-	createItemStyleBlock(59, 3, t.WHEAT_STAGE_3); //
-	createItemStyleBlock(59, 4, t.WHEAT_STAGE_4); //
-	createItemStyleBlock(59, 5, t.WHEAT_STAGE_5); //
-	createItemStyleBlock(59, 6, t.WHEAT_STAGE_6); //
-	createItemStyleBlock(59, 7, t.WHEAT_STAGE_7); //
-	// --
-	createBlock(60, 0, t.DIRT, t.FARMLAND_WET); // farmland
-	createRotatedBlock(61, 0, t.FURNACE_FRONT_OFF, t.FURNACE_SIDE, t.FURNACE_TOP); // furnace
-	createRotatedBlock(62, 0, t.FURNACE_FRONT_ON, t.FURNACE_SIDE, t.FURNACE_TOP); // burning furnace
-	createSign(); // id 63 // sign post
-	createDoor(64, t.DOOR_WOOD_LOWER, t.DOOR_WOOD_UPPER); // wooden door
-	// -- ladders
-	createSingleFaceBlock(65, 2, FACE_SOUTH, t.LADDER);
-	createSingleFaceBlock(65, 3, FACE_NORTH, t.LADDER);
-	createSingleFaceBlock(65, 4, FACE_EAST, t.LADDER);
-	createSingleFaceBlock(65, 5, FACE_WEST, t.LADDER);
-	// --
-	createRails(); // id 66
-	createStairs(67, t.COBBLESTONE); // cobblestone stairs
-	createWallSign(); // id 68 // wall sign
-	// id 69 // lever
-	createSmallerBlock(70, 0, t.STONE, t.STONE, 0, 1); // stone pressure plate
-	createDoor(71, t.DOOR_IRON_LOWER, t.DOOR_IRON_UPPER); // iron door
-	createSmallerBlock(72, 0, t.PLANKS_OAK, t.PLANKS_OAK, 0, 1); // wooden pressure plate
-	createBlock(73, 0, t.REDSTONE_ORE); // redstone ore
-	createBlock(74, 0, t.REDSTONE_ORE); // glowing redstone ore
-	createTorch(75, t.REDSTONE_TORCH_OFF); // redstone torch off
-	createTorch(76, t.REDSTONE_TORCH_ON); // redstone torch on
-	createButton(77, t.STONE); // stone button
-	createSnow(); // id 78
-	createIce(79, 0, t.ICE); // ice block
-	createBlock(80, 0, t.SNOW); // snow block
-	createCactus(); // id 81
-	createBlock(82, 0, t.CLAY); // clay block
-	createItemStyleBlock(83, 0, t.REEDS); // sugar cane
-	createBlock(84, 0, t.NOTEBLOCK, t.JUKEBOX_TOP.rotate(1)); // jukebox
-	createFence(85, 0, t.PLANKS_OAK); // oak fence
-	createPumkin(86, t.PUMPKIN_FACE_OFF); // pumpkin
-	createBlock(87, 0, t.NETHERRACK); // netherrack
-	createBlock(88, 0, t.SOUL_SAND); // soul sand
-	createBlock(89, 0, t.GLOWSTONE); // glowstone block
-	createBlock(90, 0, t.PORTAL); // nether portal block
-	createPumkin(91, t.PUMPKIN_FACE_ON); // jack-o-lantern
-	createCake(); // id 92
-	createRedstoneRepeater(93, t.REPEATER_OFF); // redstone repeater off
-	createRedstoneRepeater(94, t.REPEATER_ON); // redstone repeater on
-	// stained glass --
-	createGlass(95, 0, t.GLASS_WHITE);
-	createGlass(95, 1, t.GLASS_ORANGE);
-	createGlass(95, 2, t.GLASS_MAGENTA);
-	createGlass(95, 3, t.GLASS_LIGHT_BLUE);
-	createGlass(95, 4, t.GLASS_YELLOW);
-	createGlass(95, 5, t.GLASS_LIME);
-	createGlass(95, 6, t.GLASS_PINK);
-	createGlass(95, 7, t.GLASS_GRAY);
-	createGlass(95, 8, t.GLASS_SILVER);
-	createGlass(95, 9, t.GLASS_CYAN);
-	createGlass(95, 10, t.GLASS_PURPLE);
-	createGlass(95, 11, t.GLASS_BLUE);
-	createGlass(95, 12, t.GLASS_BROWN);
-	createGlass(95, 13, t.GLASS_GREEN);
-	createGlass(95, 14, t.GLASS_RED);
-	createGlass(95, 15, t.GLASS_BLACK);
-	// --
-	createTrapdoor(96, t.TRAPDOOR); // trapdoor
-	// -- monster egg
-	createBlock(97, 0, t.STONE); // stone
-	createBlock(97, 1, t.COBBLESTONE); // cobblestone
-	createBlock(97, 2, t.STONEBRICK); // stone brick
-	// --
-	// -- stone bricks
-	createBlock(98, 0, t.STONEBRICK); // normal
-	createBlock(98, 1, t.STONEBRICK_MOSSY); // mossy
-	createBlock(98, 2, t.STONEBRICK_CRACKED); // cracked
-	createBlock(98, 3, t.STONEBRICK_CARVED); // chiseled
-	// --
-	createHugeMushroom(99, t.MUSHROOM_BLOCK_SKIN_BROWN); // huge brown mushroom
-	createHugeMushroom(100, t.MUSHROOM_BLOCK_SKIN_RED); // huge red mushroom
-	createBarsPane(101, 0, t.IRON_BARS); // iron bars
-	createBarsPane(102, 0, t.GLASS); // glass pane
-	createBlock(103, 0, t.MELON_SIDE, t.MELON_TOP); // melon
-	createStem(104); // pumpkin stem
-	createStem(105); // melon stem
-	createVines(); // id 106 // vines
-	createFenceGate(107, t.PLANKS_OAK); // oak fence gate
-	createStairs(108, t.BRICK); // brick stairs
-	createStairs(109, t.STONEBRICK); // stone brick stairs
-	createBlock(110, 0, t.MYCELIUM_SIDE, t.MYCELIUM_TOP); // mycelium
-	// -- lily pad
-	createSingleFaceBlock(111, 0, FACE_BOTTOM, t.WATERLILY.rotate(3));
-	createSingleFaceBlock(111, 1, FACE_BOTTOM, t.WATERLILY.rotate(2));
-	createSingleFaceBlock(111, 2, FACE_BOTTOM, t.WATERLILY.rotate(1));
-	createSingleFaceBlock(111, 3, FACE_BOTTOM, t.WATERLILY);
-	// --
-	createBlock(112, 0, t.NETHER_BRICK); // nether brick
-	createFence(113, 0, t.NETHER_BRICK); // nether brick fence
-	createStairs(114, t.NETHER_BRICK); // nether brick stairs
-	// -- nether wart
-	createItemStyleBlock(115, 0, t.NETHER_WART_STAGE_0);
-	createItemStyleBlock(115, 1, t.NETHER_WART_STAGE_1);
-	createItemStyleBlock(115, 2, t.NETHER_WART_STAGE_1);
-	createItemStyleBlock(115, 3, t.NETHER_WART_STAGE_2);
-	// --
-	createSmallerBlock(116, 0, t.ENCHANTING_TABLE_SIDE,
-			t.ENCHANTING_TABLE_TOP, 0, texture_size * 0.75); // enchantment table
-	createBrewingStand(); // id 117
-	createCauldron(); // id 118 // cauldron
-	createSmallerBlock(119, 0, resources.getEndportalTexture(), resources.getEndportalTexture(),
-			texture_size * 0.25, texture_size * 0.75); // end portal
-	createSmallerBlock(120, 0, t.ENDFRAME_SIDE, t.ENDFRAME_TOP, 0,
-			texture_size * 0.8125); // end portal frame
-	createBlock(121, 0, t.END_STONE); // end stone
-	createDragonEgg(); // id 122
-	createBlock(123, 0, t.REDSTONE_LAMP_OFF); // redstone lamp inactive
-	createBlock(124, 0, t.REDSTONE_LAMP_ON); // redstone lamp active
-	createSlabs(125, SlabType::WOOD, true); // double wooden slabs
-	createSlabs(126, SlabType::WOOD, false); // normal wooden slabs
-	createCocoas(); // id 127
-	createStairs(128, t.SANDSTONE_NORMAL, t.SANDSTONE_TOP); // sandstone stairs
-	createBlock(129, 0, t.EMERALD_ORE); // emerald ore
-	createChest(130, resources.getEnderChest()); // ender chest
-	createTripwireHook(); // tripwire hook
-	createRedstoneWire(132, 0, 192, 192, 192); // tripwire
-	createBlock(133, 0, t.EMERALD_BLOCK); // block of emerald
-	createStairs(134, t.PLANKS_SPRUCE); // spruce wood stairs
-	createStairs(135, t.PLANKS_BIRCH); // birch wood stairs
-	createStairs(136, t.PLANKS_JUNGLE); // jungle wood stairs
-	createCommandBlock(137, t.COMMAND_BLOCK_FRONT, t.COMMAND_BLOCK_BACK,
-			t.COMMAND_BLOCK_SIDE, t.COMMAND_BLOCK_CONDITIONAL); // id 137
-	createBeacon(); // beacon
-	createFence(139, 0, t.COBBLESTONE); // cobblestone wall
-	createFence(139, 1, t.COBBLESTONE_MOSSY); // cobblestone wall mossy
-	createFlowerPot(); // id 140
-	// carrots --
-	createItemStyleBlock(141, 0, t.CARROTS_STAGE_0);
-	createItemStyleBlock(141, 1, t.CARROTS_STAGE_0);
-	createItemStyleBlock(141, 2, t.CARROTS_STAGE_1);
-	createItemStyleBlock(141, 3, t.CARROTS_STAGE_1);
-	createItemStyleBlock(141, 4, t.CARROTS_STAGE_2);
-	createItemStyleBlock(141, 5, t.CARROTS_STAGE_2);
-	createItemStyleBlock(141, 6, t.CARROTS_STAGE_2);
-	createItemStyleBlock(141, 7, t.CARROTS_STAGE_3);
-	// --
-	// potatoes --
-	createItemStyleBlock(142, 0, t.POTATOES_STAGE_0);
-	createItemStyleBlock(142, 1, t.POTATOES_STAGE_0);
-	createItemStyleBlock(142, 2, t.POTATOES_STAGE_1);
-	createItemStyleBlock(142, 3, t.POTATOES_STAGE_1);
-	createItemStyleBlock(142, 4, t.POTATOES_STAGE_2);
-	createItemStyleBlock(142, 5, t.POTATOES_STAGE_2);
-	createItemStyleBlock(142, 6, t.POTATOES_STAGE_2);
-	createItemStyleBlock(142, 7, t.POTATOES_STAGE_3);
-	// --
-	createButton(143, t.PLANKS_OAK); // wooden button
-	// id 144 // head
-	// id 145 // anvil
-	createChest(146, resources.getTrappedChest()); // trapped chest
-	createDoubleChest(146, resources.getTrappedDoubleChest()); // double trapped chest
-	createSmallerBlock(147, 0, t.GOLD_BLOCK, t.GOLD_BLOCK, 0, 1); // weighted pressure plate (light)
-	createSmallerBlock(148, 0, t.QUARTZ_BLOCK_LINES, t.QUARTZ_BLOCK_LINES, 0, 1); // weighted pressure plate (heavy)
-	createRedstoneRepeater(149, t.COMPARATOR_OFF); // redstone comparator (inactive) // TODO
-	createRedstoneRepeater(150, t.COMPARATOR_ON); // redstone comparator (active) // TODO
-	createSmallerBlock(151, 0, t.DAYLIGHT_DETECTOR_SIDE, t.DAYLIGHT_DETECTOR_TOP, 0, 8); // daylight sensor
-	createBlock(152, 0, t.REDSTONE_BLOCK); // block of redstone
-	createBlock(153, 0, t.QUARTZ_ORE); // nether quartz ore
-	createHopper(); // id 154
-		// block of quartz --
-	createBlock(155, 0, t.QUARTZ_BLOCK_SIDE, t.QUARTZ_BLOCK_TOP);
-	createBlock(155, 1, t.QUARTZ_BLOCK_CHISELED, t.QUARTZ_BLOCK_CHISELED_TOP);
-	createBlock(155, 2, t.QUARTZ_BLOCK_LINES, t.QUARTZ_BLOCK_LINES_TOP);
-	createBlock(155, 3, t.QUARTZ_BLOCK_LINES_TOP, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90), t.QUARTZ_BLOCK_LINES);
-	createBlock(155, 4, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90), t.QUARTZ_BLOCK_LINES_TOP, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90));
-	// --
-	createStairs(156, t.QUARTZ_BLOCK_SIDE); // quartz stairs
-	createStraightRails(157, 0, t.RAIL_ACTIVATOR); // activator rail
-	createDispenserDropper(158, t.DROPPER_FRONT_HORIZONTAL); // dropper
-	// stained clay --
-	createBlock(159, 0, t.HARDENED_CLAY_STAINED_WHITE);
-	createBlock(159, 1, t.HARDENED_CLAY_STAINED_ORANGE);
-	createBlock(159, 2, t.HARDENED_CLAY_STAINED_MAGENTA);
-	createBlock(159, 3, t.HARDENED_CLAY_STAINED_LIGHT_BLUE);
-	createBlock(159, 4, t.HARDENED_CLAY_STAINED_YELLOW);
-	createBlock(159, 5, t.HARDENED_CLAY_STAINED_LIME);
-	createBlock(159, 6, t.HARDENED_CLAY_STAINED_PINK);
-	createBlock(159, 7, t.HARDENED_CLAY_STAINED_GRAY);
-	createBlock(159, 8, t.HARDENED_CLAY_STAINED_SILVER);
-	createBlock(159, 9, t.HARDENED_CLAY_STAINED_CYAN);
-	createBlock(159, 10, t.HARDENED_CLAY_STAINED_PURPLE);
-	createBlock(159, 11, t.HARDENED_CLAY_STAINED_BLUE);
-	createBlock(159, 12, t.HARDENED_CLAY_STAINED_BROWN);
-	createBlock(159, 13, t.HARDENED_CLAY_STAINED_GREEN);
-	createBlock(159, 14, t.HARDENED_CLAY_STAINED_RED);
-	createBlock(159, 15, t.HARDENED_CLAY_STAINED_BLACK);
-	// --
-	// stained glass pane --
-	createBarsPane(160, 0, t.GLASS_WHITE);
-	createBarsPane(160, 1, t.GLASS_ORANGE);
-	createBarsPane(160, 2, t.GLASS_MAGENTA);
-	createBarsPane(160, 3, t.GLASS_LIGHT_BLUE);
-	createBarsPane(160, 4, t.GLASS_YELLOW);
-	createBarsPane(160, 5, t.GLASS_LIME);
-	createBarsPane(160, 6, t.GLASS_PINK);
-	createBarsPane(160, 7, t.GLASS_GRAY);
-	createBarsPane(160, 8, t.GLASS_SILVER);
-	createBarsPane(160, 9, t.GLASS_CYAN);
-	createBarsPane(160, 10, t.GLASS_PURPLE);
-	createBarsPane(160, 11, t.GLASS_BLUE);
-	createBarsPane(160, 12, t.GLASS_BROWN);
-	createBarsPane(160, 13, t.GLASS_GREEN);
-	createBarsPane(160, 14, t.GLASS_RED);
-	createBarsPane(160, 15, t.GLASS_BLACK);
-	// --
-	// id 161 acacia/dark oak leaves, see createLeaves()
-	// some more wood --
-	createWood(162, 0, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // acacia
-	createWood(162, 1, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // acacia (placeholder)
-	createWood(162, 2, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // dark wood
-	createWood(162, 3, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // dark wood (placeholder)
-	// --
-	createStairs(163, t.PLANKS_ACACIA); // acacia wood stairs
-	createStairs(164, t.PLANKS_BIG_OAK); // dark oak wood stairs
-	createBlock(165, 0, t.SLIME); // slime block
-	createBlock(166, 0, empty_texture); // barrier
-	createTrapdoor(167, t.IRON_TRAPDOOR); // iron trapdoor
-	// prismarine --
-	createBlock(168, 0, t.PRISMARINE_ROUGH);
-	createBlock(168, 1, t.PRISMARINE_BRICKS);
-	createBlock(168, 2, t.PRISMARINE_DARK);
-	// --
-	createBlock(169, 0, t.SEA_LANTERN); // sea lantern
-	// hay block --
-	createBlock(170, 0, t.HAY_BLOCK_SIDE, t.HAY_BLOCK_TOP); // normal orientation
-	createBlock(170, 4, t.HAY_BLOCK_TOP, t.HAY_BLOCK_SIDE.rotate(1), t.HAY_BLOCK_SIDE); // east-west
-	createBlock(170, 8, t.HAY_BLOCK_SIDE.rotate(1), t.HAY_BLOCK_TOP, t.HAY_BLOCK_SIDE.rotate(1)); // north-south
-	// --
-	// carpet --
-	createSmallerBlock(171, 0, t.WOOL_COLORED_WHITE, 0, 1);
-	createSmallerBlock(171, 1, t.WOOL_COLORED_ORANGE, 0, 1);
-	createSmallerBlock(171, 2, t.WOOL_COLORED_MAGENTA, 0, 1);
-	createSmallerBlock(171, 3, t.WOOL_COLORED_LIGHT_BLUE, 0, 1);
-	createSmallerBlock(171, 4, t.WOOL_COLORED_YELLOW, 0, 1);
-	createSmallerBlock(171, 5, t.WOOL_COLORED_LIME, 0, 1);
-	createSmallerBlock(171, 6, t.WOOL_COLORED_PINK, 0, 1);
-	createSmallerBlock(171, 7, t.WOOL_COLORED_GRAY, 0, 1);
-	createSmallerBlock(171, 8, t.WOOL_COLORED_SILVER, 0, 1);
-	createSmallerBlock(171, 9, t.WOOL_COLORED_CYAN, 0, 1);
-	createSmallerBlock(171, 10, t.WOOL_COLORED_PURPLE, 0, 1);
-	createSmallerBlock(171, 11, t.WOOL_COLORED_BLUE, 0, 1);
-	createSmallerBlock(171, 12, t.WOOL_COLORED_BROWN, 0, 1);
-	createSmallerBlock(171, 13, t.WOOL_COLORED_GREEN, 0, 1);
-	createSmallerBlock(171, 14, t.WOOL_COLORED_RED, 0, 1);
-	createSmallerBlock(171, 15, t.WOOL_COLORED_BLACK, 0, 1);
-	// --
-	createBlock(172, 0, t.HARDENED_CLAY); // hardened clay
-	createBlock(173, 0, t.COAL_BLOCK); // block of coal
-	createBlock(174, 0, t.ICE_PACKED); // packed ice
-	// large plants, id 175 --
-	// the top texture of the sunflower is a bit modified
-	RGBAImage sunflower_top = t.DOUBLE_PLANT_SUNFLOWER_TOP;
-	sunflower_top.alphaBlit(t.DOUBLE_PLANT_SUNFLOWER_FRONT, 0, -texture_size * 0.25);
-	createLargePlant(0, t.DOUBLE_PLANT_SUNFLOWER_BOTTOM, sunflower_top);
-	createLargePlant(1, t.DOUBLE_PLANT_SYRINGA_BOTTOM, t.DOUBLE_PLANT_SYRINGA_TOP);
-	createLargePlant(2, t.DOUBLE_PLANT_GRASS_BOTTOM, t.DOUBLE_PLANT_GRASS_TOP);
-	createLargePlant(3, t.DOUBLE_PLANT_FERN_BOTTOM, t.DOUBLE_PLANT_FERN_TOP);
-	createLargePlant(4, t.DOUBLE_PLANT_ROSE_BOTTOM, t.DOUBLE_PLANT_ROSE_TOP);
-	createLargePlant(5, t.DOUBLE_PLANT_PAEONIA_BOTTOM, t.DOUBLE_PLANT_PAEONIA_TOP);
-	// --
-	// id 176 // standing banner
-	// id 177 // wall banner
-	createSmallerBlock(178, 0, t.DAYLIGHT_DETECTOR_SIDE, t.DAYLIGHT_DETECTOR_INVERTED_TOP, 0, 8); // inverted daylight sensor
-	// -- red sandstone
-	createBlock(179, 0, t.RED_SANDSTONE_NORMAL, t.RED_SANDSTONE_TOP); // normal
-	createBlock(179, 1, t.RED_SANDSTONE_CARVED, t.RED_SANDSTONE_TOP); // chiseled
-	createBlock(179, 2, t.RED_SANDSTONE_SMOOTH, t.RED_SANDSTONE_TOP); // smooth
-	// --
-	createStairs(180, t.RED_SANDSTONE_NORMAL, t.RED_SANDSTONE_TOP); // red sandstone stairs
-	createSlabs(181, SlabType::STONE2, true); // double red sandstone slabs
-	createSlabs(182, SlabType::STONE2, false); // normal red sandstone slabs
-	createFenceGate(183, t.PLANKS_SPRUCE); // spruce fence gate
-	createFenceGate(184, t.PLANKS_BIRCH); // birch fence gate
-	createFenceGate(185, t.PLANKS_JUNGLE); // jungle fence gate
-	createFenceGate(186, t.PLANKS_BIG_OAK); // dark oak fence gate
-	createFenceGate(187, t.PLANKS_ACACIA); // acacia fence gate
-	createFence(188, 0, t.PLANKS_SPRUCE); // spruce fence
-	createFence(189, 0, t.PLANKS_BIRCH); // birch fence
-	createFence(190, 0, t.PLANKS_JUNGLE); // jungle fence
-	createFence(191, 0, t.PLANKS_BIG_OAK); // dark oak fence
-	createFence(192, 0, t.PLANKS_ACACIA); // acacia fence
-	createDoor(193, t.DOOR_SPRUCE_LOWER, t.DOOR_SPRUCE_UPPER); // spruce door
-	createDoor(194, t.DOOR_BIRCH_LOWER, t.DOOR_BIRCH_UPPER); // birch door
-	createDoor(195, t.DOOR_JUNGLE_LOWER, t.DOOR_JUNGLE_UPPER); // jungle door
-	createDoor(196, t.DOOR_ACACIA_LOWER, t.DOOR_ACACIA_UPPER); // acacia door
-	createDoor(197, t.DOOR_DARK_OAK_LOWER, t.DOOR_DARK_OAK_UPPER); // dark oak door
-	createEndRod(); // id 198
-	createBlock(199, 0, t.CHORUS_PLANT); // chrous plant
-	// chorus flower --
-	createBlock(200, 0, t.CHORUS_FLOWER);
-	createBlock(200, 1, t.CHORUS_FLOWER);
-	createBlock(200, 2, t.CHORUS_FLOWER);
-	createBlock(200, 3, t.CHORUS_FLOWER);
-	createBlock(200, 4, t.CHORUS_FLOWER);
-	createBlock(200, 5, t.CHORUS_FLOWER_DEAD);
-	// --
-	createBlock(201, 0, t.PURPUR_BLOCK); // purpur block
-	// purpur pillar --
-	// TODO is the official data like this or are there also other combination? 0, 4, 8 seems odd...
-	createBlock(202, 0, t.PURPUR_PILLAR, t.PURPUR_PILLAR_TOP); // vertically
-	createBlock(202, 4, t.PURPUR_PILLAR_TOP, t.PURPUR_PILLAR); // east-west
-	createBlock(202, 8, t.PURPUR_PILLAR_TOP, t.PURPUR_PILLAR.rotate(1)); // north-south
-	// --
-	createStairs(203, t.PURPUR_BLOCK); // purpur stairs
-	createSlabs(204, SlabType::PURPUR, true); // purpur double slab
-	createSlabs(205, SlabType::PURPUR, false); // purpur slab
-	createBlock(206, 0, t.END_BRICKS); // end stone bricks
-	// beetroot seeds --
-	createItemStyleBlock(207, 0, t.BEETROOTS_STAGE_0);
-	createItemStyleBlock(207, 2, t.BEETROOTS_STAGE_2);
-	createItemStyleBlock(207, 3, t.BEETROOTS_STAGE_3);
-	// --
-	createSmallerBlock(208, 0, t.GRASS_PATH_SIDE, t.GRASS_PATH_TOP, 0, texture_size * 15.0 / 16.0); // grass paths
-	createBlock(209, 0, resources.getEndportalTexture()); // end gateway
-	createCommandBlock(210, t.REPEATING_COMMAND_BLOCK_FRONT, t.REPEATING_COMMAND_BLOCK_BACK,
-			t.REPEATING_COMMAND_BLOCK_SIDE, t.REPEATING_COMMAND_BLOCK_CONDITIONAL); // id 210
-	createCommandBlock(211, t.CHAIN_COMMAND_BLOCK_FRONT, t.CHAIN_COMMAND_BLOCK_BACK,
-			t.CHAIN_COMMAND_BLOCK_SIDE, t.CHAIN_COMMAND_BLOCK_CONDITIONAL); // id 211
-	// frosted ice --
-	createIce(212, 0, t.FROSTED_ICE_0);
-	createIce(212, 1, t.FROSTED_ICE_1);
-	createIce(212, 2, t.FROSTED_ICE_2);
-	createIce(212, 3, t.FROSTED_ICE_3);
-	// --
-	createBlock(213, 0, t.MAGMA); // magma
-	createBlock(214, 0, t.NETHER_WART_BLOCK); // nether wart block
-	createBlock(215, 0, t.RED_NETHER_BRICK); // red nether brick
-	// bone block --
-	createBlock(216, 0, t.BONE_BLOCK_SIDE, t.BONE_BLOCK_TOP); // vertically
-	createBlock(216, 4, t.BONE_BLOCK_TOP, t.BONE_BLOCK_SIDE, t.BONE_BLOCK_SIDE); // east-west
-	createBlock(216, 8, t.BONE_BLOCK_SIDE, t.BONE_BLOCK_TOP, t.BONE_BLOCK_SIDE); // north-south
-	// --
-	createObserver(218); // observer
-	// shulker box --
-	createShulkerBox(219, 0, resources.getShulkerBoxTextures()); // white
-	createShulkerBox(220, 1, resources.getShulkerBoxTextures()); // orange
-	createShulkerBox(221, 2, resources.getShulkerBoxTextures()); // magenta
-	createShulkerBox(222, 3, resources.getShulkerBoxTextures()); // light blue
-	createShulkerBox(223, 4, resources.getShulkerBoxTextures()); // yellow
-	createShulkerBox(224, 5, resources.getShulkerBoxTextures()); // lime
-	createShulkerBox(225, 6, resources.getShulkerBoxTextures()); // pink
-	createShulkerBox(226, 7, resources.getShulkerBoxTextures()); // gray
-	createShulkerBox(227, 8, resources.getShulkerBoxTextures()); // light gray
-	createShulkerBox(228, 9, resources.getShulkerBoxTextures()); // cyan
-	createShulkerBox(229, 10, resources.getShulkerBoxTextures()); // purple
-	createShulkerBox(230, 11, resources.getShulkerBoxTextures()); // blue
-	createShulkerBox(231, 12, resources.getShulkerBoxTextures()); // brown
-	createShulkerBox(232, 13, resources.getShulkerBoxTextures()); // green
-	createShulkerBox(233, 14, resources.getShulkerBoxTextures()); // red
-	createShulkerBox(234, 15, resources.getShulkerBoxTextures()); // black
-	// glazed terracotta --
-	createGlazedTerracotta(235, t.GLAZED_TERRACOTTA_WHITE); // white
-	createGlazedTerracotta(236, t.GLAZED_TERRACOTTA_ORANGE); // orange
-	createGlazedTerracotta(237, t.GLAZED_TERRACOTTA_MAGENTA); // magenta
-	createGlazedTerracotta(238, t.GLAZED_TERRACOTTA_LIGHT_BLUE); // light blue
-	createGlazedTerracotta(239, t.GLAZED_TERRACOTTA_YELLOW); // yellow
-	createGlazedTerracotta(240, t.GLAZED_TERRACOTTA_LIME); // lime
-	createGlazedTerracotta(241, t.GLAZED_TERRACOTTA_PINK); // pink
-	createGlazedTerracotta(242, t.GLAZED_TERRACOTTA_GRAY); // gray
-	createGlazedTerracotta(243, t.GLAZED_TERRACOTTA_SILVER); // light gray
-	createGlazedTerracotta(244, t.GLAZED_TERRACOTTA_CYAN); // cyan
-	createGlazedTerracotta(245, t.GLAZED_TERRACOTTA_PURPLE); // purple
-	createGlazedTerracotta(246, t.GLAZED_TERRACOTTA_BLUE); // blue
-	createGlazedTerracotta(247, t.GLAZED_TERRACOTTA_BROWN); // brown
-	createGlazedTerracotta(248, t.GLAZED_TERRACOTTA_GREEN); // green
-	createGlazedTerracotta(249, t.GLAZED_TERRACOTTA_RED); // red
-	createGlazedTerracotta(250, t.GLAZED_TERRACOTTA_BLACK); // black
-	// concrete --
-	createBlock(251, 0, t.CONCRETE_WHITE); // white
-	createBlock(251, 1, t.CONCRETE_ORANGE); // orange
-	createBlock(251, 2, t.CONCRETE_MAGENTA); // magenta
-	createBlock(251, 3, t.CONCRETE_LIGHT_BLUE); // light blue
-	createBlock(251, 4, t.CONCRETE_YELLOW); // yellow
-	createBlock(251, 5, t.CONCRETE_LIME); // lime
-	createBlock(251, 6, t.CONCRETE_PINK); // pink
-	createBlock(251, 7, t.CONCRETE_GRAY); // gray
-	createBlock(251, 8, t.CONCRETE_SILVER); // light gray
-	createBlock(251, 9, t.CONCRETE_CYAN); // cyan
-	createBlock(251, 10, t.CONCRETE_PURPLE); // purple
-	createBlock(251, 11, t.CONCRETE_BLUE); // blue
-	createBlock(251, 12, t.CONCRETE_BROWN); // brown
-	createBlock(251, 13, t.CONCRETE_GREEN); // green
-	createBlock(251, 14, t.CONCRETE_RED); // red
-	createBlock(251, 15, t.CONCRETE_BLACK); // black
-	// concrete powder --
-	createBlock(252, 0, t.CONCRETE_POWDER_WHITE); // white
-	createBlock(252, 1, t.CONCRETE_POWDER_ORANGE); // orange
-	createBlock(252, 2, t.CONCRETE_POWDER_MAGENTA); // magenta
-	createBlock(252, 3, t.CONCRETE_POWDER_LIGHT_BLUE); // light blue
-	createBlock(252, 4, t.CONCRETE_POWDER_YELLOW); // yellow
-	createBlock(252, 5, t.CONCRETE_POWDER_LIME); // lime
-	createBlock(252, 6, t.CONCRETE_POWDER_PINK); // pink
-	createBlock(252, 7, t.CONCRETE_POWDER_GRAY); // gray
-	createBlock(252, 8, t.CONCRETE_POWDER_SILVER); // light gray
-	createBlock(252, 9, t.CONCRETE_POWDER_CYAN); // cyan
-	createBlock(252, 10, t.CONCRETE_POWDER_PURPLE); // purple
-	createBlock(252, 11, t.CONCRETE_POWDER_BLUE); // blue
-	createBlock(252, 12, t.CONCRETE_POWDER_BROWN); // brown
-	createBlock(252, 13, t.CONCRETE_POWDER_GREEN); // green
-	createBlock(252, 14, t.CONCRETE_POWDER_RED); // red
-	createBlock(252, 15, t.CONCRETE_POWDER_BLACK); // black
-	// --
-	createBlock(217, 0, empty_texture); // structure void
-	// structure block --
-	createBlock(255, 0, t.STRUCTURE_BLOCK_SAVE);
-	createBlock(255, 1, t.STRUCTURE_BLOCK_LOAD);
-	createBlock(255, 2, t.STRUCTURE_BLOCK_CORNER);
-	createBlock(255, 3, t.STRUCTURE_BLOCK_DATA);
-	// --
+	// the blocks are split into tasks which can create their block images in parallel
+	std::vector<std::function<void()> > tasks;
+	tasks.push_back([&]() {
+		createBlock(1, 0, t.STONE); // stone
+		createBlock(1, 1, t.STONE_GRANITE); // granite
+		createBlock(1, 2, t.STONE_GRANITE_SMOOTH); // polished granite
+		createBlock(1, 3, t.STONE_DIORITE); // diorite
+		createBlock(1, 4, t.STONE_DIORITE_SMOOTH); // polished diorite
+		createBlock(1, 5, t.STONE_ANDESITE); // andesite
+		createBlock(1, 6, t.STONE_ANDESITE_SMOOTH); // polished andesite
+		createGrassBlock(); // id 2
+		createBlock(3, 0, t.DIRT); // dirt
+		createBlock(3, 1, t.DIRT); // grassless dirt
+		createBlock(3, 2, t.DIRT_PODZOL_SIDE, t.DIRT_PODZOL_SIDE, t.DIRT_PODZOL_TOP); // podzol
+		createBlock(4, 0, t.COBBLESTONE); // cobblestone
+		// -- wooden planks
+		createBlock(5, 0, t.PLANKS_OAK); // oak
+		createBlock(5, 1, t.PLANKS_SPRUCE); // pine/spruce
+		createBlock(5, 2, t.PLANKS_BIRCH); // birch
+		createBlock(5, 3, t.PLANKS_JUNGLE); // jungle
+		createBlock(5, 4, t.PLANKS_ACACIA); // acacia
+		createBlock(5, 5, t.PLANKS_BIG_OAK); // dark oak
+		// --
+		// -- saplings
+		createItemStyleBlock(6, 0, t.SAPLING_OAK); // oak
+		createItemStyleBlock(6, 1, t.SAPLING_SPRUCE); // spruce
+		createItemStyleBlock(6, 2, t.SAPLING_BIRCH); // birch
+		createItemStyleBlock(6, 3, t.SAPLING_JUNGLE); // jungle
+		createItemStyleBlock(6, 4, t.SAPLING_ACACIA); // acacia
+		createItemStyleBlock(6, 5, t.SAPLING_ROOFED_OAK); // dark oak
+		// --
+		createBlock(7, 0, t.BEDROCK); // bedrock
+		createWater(); // id 8, 9
+		createLava(); // id 10, 11
+		createBlock(12, 0, t.SAND); // sand
+		createBlock(12, 1, t.RED_SAND); // red sand
+	});
+	tasks.push_back([&]() {
+		createBlock(13, 0, t.GRAVEL); // gravel
+		createBlock(14, 0, t.GOLD_ORE); // gold ore
+		createBlock(15, 0, t.IRON_ORE); // iron ore
+		createBlock(16, 0, t.COAL_ORE); // coal ore
+		// -- wood
+		createWood(17, 0, t.LOG_OAK, t.LOG_OAK_TOP); // oak
+		createWood(17, 1, t.LOG_SPRUCE, t.LOG_SPRUCE_TOP); // pine/spruce
+		createWood(17, 2, t.LOG_BIRCH, t.LOG_BIRCH_TOP); // birch
+		createWood(17, 3, t.LOG_JUNGLE, t.LOG_JUNGLE_TOP); // jungle
+		// --
+		createLeaves(); // id 18
+		createBlock(19, 0, t.SPONGE); // sponge
+		createBlock(19, 1, t.SPONGE_WET); // wet sponge
+		createGlass(20, 0, t.GLASS);
+		createBlock(21, 0, t.LAPIS_ORE); // lapis lazuli ore
+		createBlock(22, 0, t.LAPIS_BLOCK); // lapis lazuli block
+		createDispenserDropper(23, t.DISPENSER_FRONT_HORIZONTAL); // dispenser
+		// -- sandstone
+		createBlock(24, 0, t.SANDSTONE_NORMAL, t.SANDSTONE_TOP); // normal
+		createBlock(24, 1, t.SANDSTONE_CARVED, t.SANDSTONE_TOP); // chiseled
+		createBlock(24, 2, t.SANDSTONE_SMOOTH, t.SANDSTONE_TOP); // smooth
+		// --
+		createBlock(25, 0, t.NOTEBLOCK); // noteblock
+		createBed(resources.getBedTextures()); // id 26 bed
+		createStraightRails(27, 0, t.RAIL_GOLDEN); // id 27 powered rail (unpowered)
+		createStraightRails(27, 8, t.RAIL_GOLDEN_POWERED); // id 27 powered rail (powered)
+		createStraightRails(28, 0, t.RAIL_ACTIVATOR); // id 28 detector rail
+		createPiston(29, true); // sticky piston
+		createItemStyleBlock(30, 0, t.WEB); // cobweb
+		// -- tall grass
+		createItemStyleBlock(31, 0, t.DEADBUSH); // dead bush style
+		createItemStyleBlock(31, 1, t.TALLGRASS); // tall grass
+		createItemStyleBlock(31, 2, t.FERN); // fern
+		// --
+	});
+	tasks.push_back([&]() {
+		createItemStyleBlock(32, 0, t.DEADBUSH); // dead bush
+		createPiston(33, false); // piston
+		// id 34 // piston extension
+		// -- wool
+		createBlock(35, 0, t.WOOL_COLORED_WHITE); // white
+		createBlock(35, 1, t.WOOL_COLORED_ORANGE); // orange
+		createBlock(35, 2, t.WOOL_COLORED_MAGENTA); // magenta
+		createBlock(35, 3, t.WOOL_COLORED_LIGHT_BLUE); // light blue
+		createBlock(35, 4, t.WOOL_COLORED_YELLOW); // yellow
+		createBlock(35, 5, t.WOOL_COLORED_LIME); // lime
+		createBlock(35, 6, t.WOOL_COLORED_PINK); // pink
+		createBlock(35, 7, t.WOOL_COLORED_GRAY); // gray
+		createBlock(35, 8, t.WOOL_COLORED_SILVER); // light gray
+		createBlock(35, 9, t.WOOL_COLORED_CYAN); // cyan
+		createBlock(35, 10, t.WOOL_COLORED_PURPLE); // purple
+		createBlock(35, 11, t.WOOL_COLORED_BLUE); // blue
+		createBlock(35, 12, t.WOOL_COLORED_BROWN); // brown
+		createBlock(35, 13, t.WOOL_COLORED_GREEN); // green
+		createBlock(35, 14, t.WOOL_COLORED_RED); // red
+		createBlock(35, 15, t.WOOL_COLORED_BLACK); // black
+		// --
+		createBlock(36, 0, empty_texture); // block moved by piston aka 'block 36'
+		createItemStyleBlock(37, 0, t.FLOWER_DANDELION); // dandelion
+		// -- poppy -- different flowers
+		createItemStyleBlock(38, 0, t.FLOWER_ROSE); // poppy
+		createItemStyleBlock(38, 1, t.FLOWER_BLUE_ORCHID); // blue orchid
+		createItemStyleBlock(38, 2, t.FLOWER_ALLIUM); // azure bluet
+		createItemStyleBlock(38, 3, t.FLOWER_HOUSTONIA); //
+		createItemStyleBlock(38, 4, t.FLOWER_TULIP_RED); // red tulip
+		createItemStyleBlock(38, 5, t.FLOWER_TULIP_ORANGE); // orange tulip
+		createItemStyleBlock(38, 6, t.FLOWER_TULIP_WHITE); // white tulip
+		createItemStyleBlock(38, 7, t.FLOWER_TULIP_PINK); // pink tulip
+		createItemStyleBlock(38, 8, t.FLOWER_OXEYE_DAISY); // oxeye daisy
+		// --
+	});
+	tasks.push_back([&]() {
+		createItemStyleBlock(39, 0, t.MUSHROOM_BROWN); // brown mushroom
+		createItemStyleBlock(40, 0, t.MUSHROOM_RED); // red mushroom
+		createBlock(41, 0, t.GOLD_BLOCK); // block of gold
+		createBlock(42, 0, t.IRON_BLOCK); // block of iron
+		createSlabs(43, SlabType::STONE, true); // double stone slabs
+		createSlabs(44, SlabType::STONE, false); // normal stone slabs
+		createBlock(45, 0, t.BRICK); // bricks
+		createBlock(46, 0, t.TNT_SIDE, t.TNT_TOP); // tnt
+		createBlock(47, 0, t.BOOKSHELF, t.PLANKS_OAK); // bookshelf
+		createBlock(48, 0, t.COBBLESTONE_MOSSY); // moss stone
+		createBlock(49, 0, t.OBSIDIAN); // obsidian
+		createTorch(50, t.TORCH_ON); // torch
+		createItemStyleBlock(51, 0, t.FIRE_LAYER_0); // fire
+		createBlock(52, 0, t.MOB_SPAWNER); // monster spawner
+		createStairs(53, t.PLANKS_OAK); // oak wood stairs
+		createChest(54, resources.getNormalChest()); // chest
+		createDoubleChest(54, resources.getNormalDoubleChest()); // chest
+		createRedstoneWire(55, 0, 48, 0, 0); // redstone wire not powered
+		createRedstoneWire(55, REDSTONE_POWERED, 192, 0, 0); // redstone wire powered
+		createBlock(56, 0, t.DIAMOND_ORE); // diamond ore
+		createBlock(57, 0, t.DIAMOND_BLOCK); // block of diamond
+		createBlock(58, 0, t.CRAFTING_TABLE_SIDE, t.CRAFTING_TABLE_FRONT, t.CRAFTING_TABLE_TOP); // crafting table
+		// -- wheat
+		createItemStyleBlock(59, 0, t.WHEAT_STAGE_0); //
+		createItemStyleBlock(59, 1, t.WHEAT_STAGE_1); //
+		createItemStyleBlock(59, 2, t.WHEAT_STAGE_2); //
+		createItemStyleBlock(59, 3, t.WHEAT_STAGE_3); //
+		createItemStyleBlock(59, 4, t.WHEAT_STAGE_4); //
+		createItemStyleBlock(59, 5, t.WHEAT_STAGE_5); //
+		createItemStyleBlock(59, 6, t.WHEAT_STAGE_6); //
+		createItemStyleBlock(59, 7, t.WHEAT_STAGE_7); //
+		// --
+		createBlock(60, 0, t.DIRT, t.FARMLAND_WET); // farmland
+		createRotatedBlock(61, 0, t.FURNACE_FRONT_OFF, t.FURNACE_SIDE, t.FURNACE_TOP); // furnace
+	});
+	tasks.push_back([&]() {
+		createRotatedBlock(62, 0, t.FURNACE_FRONT_ON, t.FURNACE_SIDE, t.FURNACE_TOP); // burning furnace
+		createSign(); // id 63 // sign post
+		createDoor(64, t.DOOR_WOOD_LOWER, t.DOOR_WOOD_UPPER); // wooden door
+		// -- ladders
+		createSingleFaceBlock(65, 2, FACE_SOUTH, t.LADDER);
+		createSingleFaceBlock(65, 3, FACE_NORTH, t.LADDER);
+		createSingleFaceBlock(65, 4, FACE_EAST, t.LADDER);
+		createSingleFaceBlock(65, 5, FACE_WEST, t.LADDER);
+		// --
+		createRails(); // id 66
+		createStairs(67, t.COBBLESTONE); // cobblestone stairs
+		createWallSign(); // id 68 // wall sign
+		// id 69 // lever
+		createSmallerBlock(70, 0, t.STONE, t.STONE, 0, 1); // stone pressure plate
+		createDoor(71, t.DOOR_IRON_LOWER, t.DOOR_IRON_UPPER); // iron door
+		createSmallerBlock(72, 0, t.PLANKS_OAK, t.PLANKS_OAK, 0, 1); // wooden pressure plate
+		createBlock(73, 0, t.REDSTONE_ORE); // redstone ore
+		createBlock(74, 0, t.REDSTONE_ORE); // glowing redstone ore
+		createTorch(75, t.REDSTONE_TORCH_OFF); // redstone torch off
+		createTorch(76, t.REDSTONE_TORCH_ON); // redstone torch on
+		createButton(77, t.STONE); // stone button
+		createSnow(); // id 78
+		createIce(79, 0, t.ICE); // ice block
+		createBlock(80, 0, t.SNOW); // snow block
+		createCactus(); // id 81
+		createBlock(82, 0, t.CLAY); // clay block
+		createItemStyleBlock(83, 0, t.REEDS); // sugar cane
+		createBlock(84, 0, t.NOTEBLOCK, t.JUKEBOX_TOP.rotate(1)); // jukebox
+		createFence(85, 0, t.PLANKS_OAK); // oak fence
+		createPumkin(86, t.PUMPKIN_FACE_OFF); // pumpkin
+		createBlock(87, 0, t.NETHERRACK); // netherrack
+		createBlock(88, 0, t.SOUL_SAND); // soul sand
+		createBlock(89, 0, t.GLOWSTONE); // glowstone block
+		createBlock(90, 0, t.PORTAL); // nether portal block
+	});
+	tasks.push_back([&]() {
+		createPumkin(91, t.PUMPKIN_FACE_ON); // jack-o-lantern
+		createCake(); // id 92
+		createRedstoneRepeater(93, t.REPEATER_OFF); // redstone repeater off
+		createRedstoneRepeater(94, t.REPEATER_ON); // redstone repeater on
+		// stained glass --
+		createGlass(95, 0, t.GLASS_WHITE);
+		createGlass(95, 1, t.GLASS_ORANGE);
+		createGlass(95, 2, t.GLASS_MAGENTA);
+		createGlass(95, 3, t.GLASS_LIGHT_BLUE);
+		createGlass(95, 4, t.GLASS_YELLOW);
+		createGlass(95, 5, t.GLASS_LIME);
+		createGlass(95, 6, t.GLASS_PINK);
+		createGlass(95, 7, t.GLASS_GRAY);
+		createGlass(95, 8, t.GLASS_SILVER);
+		createGlass(95, 9, t.GLASS_CYAN);
+		createGlass(95, 10, t.GLASS_PURPLE);
+		createGlass(95, 11, t.GLASS_BLUE);
+		createGlass(95, 12, t.GLASS_BROWN);
+		createGlass(95, 13, t.GLASS_GREEN);
+		createGlass(95, 14, t.GLASS_RED);
+		createGlass(95, 15, t.GLASS_BLACK);
+		// --
+		createTrapdoor(96, t.TRAPDOOR); // trapdoor
+		// -- monster egg
+		createBlock(97, 0, t.STONE); // stone
+		createBlock(97, 1, t.COBBLESTONE); // cobblestone
+		createBlock(97, 2, t.STONEBRICK); // stone brick
+		// --
+		// -- stone bricks
+		createBlock(98, 0, t.STONEBRICK); // normal
+		createBlock(98, 1, t.STONEBRICK_MOSSY); // mossy
+		createBlock(98, 2, t.STONEBRICK_CRACKED); // cracked
+		createBlock(98, 3, t.STONEBRICK_CARVED); // chiseled
+		// --
+	});
+	tasks.push_back([&]() {
+		createHugeMushroom(99, t.MUSHROOM_BLOCK_SKIN_BROWN); // huge brown mushroom
+		createHugeMushroom(100, t.MUSHROOM_BLOCK_SKIN_RED); // huge red mushroom
+		createBarsPane(101, 0, t.IRON_BARS); // iron bars
+		createBarsPane(102, 0, t.GLASS); // glass pane
+		createBlock(103, 0, t.MELON_SIDE, t.MELON_TOP); // melon
+		createStem(104); // pumpkin stem
+		createStem(105); // melon stem
+		createVines(); // id 106 // vines
+		createFenceGate(107, t.PLANKS_OAK); // oak fence gate
+		createStairs(108, t.BRICK); // brick stairs
+		createStairs(109, t.STONEBRICK); // stone brick stairs
+		createBlock(110, 0, t.MYCELIUM_SIDE, t.MYCELIUM_TOP); // mycelium
+		// -- lily pad
+		createSingleFaceBlock(111, 0, FACE_BOTTOM, t.WATERLILY.rotate(3));
+		createSingleFaceBlock(111, 1, FACE_BOTTOM, t.WATERLILY.rotate(2));
+		createSingleFaceBlock(111, 2, FACE_BOTTOM, t.WATERLILY.rotate(1));
+		createSingleFaceBlock(111, 3, FACE_BOTTOM, t.WATERLILY);
+		// --
+		createBlock(112, 0, t.NETHER_BRICK); // nether brick
+		createFence(113, 0, t.NETHER_BRICK); // nether brick fence
+		createStairs(114, t.NETHER_BRICK); // nether brick stairs
+		// -- nether wart
+		createItemStyleBlock(115, 0, t.NETHER_WART_STAGE_0);
+		createItemStyleBlock(115, 1, t.NETHER_WART_STAGE_1);
+		createItemStyleBlock(115, 2, t.NETHER_WART_STAGE_1);
+		createItemStyleBlock(115, 3, t.NETHER_WART_STAGE_2);
+		// --
+		createSmallerBlock(116, 0, t.ENCHANTING_TABLE_SIDE,
+				t.ENCHANTING_TABLE_TOP, 0, texture_size * 0.75); // enchantment table
+		createBrewingStand(); // id 117
+		createCauldron(); // id 118 // cauldron
+		createSmallerBlock(119, 0, resources.getEndportalTexture(), resources.getEndportalTexture(),
+				texture_size * 0.25, texture_size * 0.75); // end portal
+	});
+	tasks.push_back([&]() {
+		createSmallerBlock(120, 0, t.ENDFRAME_SIDE, t.ENDFRAME_TOP, 0,
+				texture_size * 0.8125); // end portal frame
+		createBlock(121, 0, t.END_STONE); // end stone
+		createDragonEgg(); // id 122
+		createBlock(123, 0, t.REDSTONE_LAMP_OFF); // redstone lamp inactive
+		createBlock(124, 0, t.REDSTONE_LAMP_ON); // redstone lamp active
+		createSlabs(125, SlabType::WOOD, true); // double wooden slabs
+		createSlabs(126, SlabType::WOOD, false); // normal wooden slabs
+		createCocoas(); // id 127
+		createStairs(128, t.SANDSTONE_NORMAL, t.SANDSTONE_TOP); // sandstone stairs
+		createBlock(129, 0, t.EMERALD_ORE); // emerald ore
+		createChest(130, resources.getEnderChest()); // ender chest
+		createTripwireHook(); // tripwire hook
+		createRedstoneWire(132, 0, 192, 192, 192); // tripwire
+		createBlock(133, 0, t.EMERALD_BLOCK); // block of emerald
+		createStairs(134, t.PLANKS_SPRUCE); // spruce wood stairs
+		createStairs(135, t.PLANKS_BIRCH); // birch wood stairs
+		createStairs(136, t.PLANKS_JUNGLE); // jungle wood stairs
+		createCommandBlock(137, t.COMMAND_BLOCK_FRONT, t.COMMAND_BLOCK_BACK,
+				t.COMMAND_BLOCK_SIDE, t.COMMAND_BLOCK_CONDITIONAL); // id 137
+		createBeacon(); // beacon
+		createFence(139, 0, t.COBBLESTONE); // cobblestone wall
+		createFence(139, 1, t.COBBLESTONE_MOSSY); // cobblestone wall mossy
+		createFlowerPot(); // id 140
+		// carrots --
+		createItemStyleBlock(141, 0, t.CARROTS_STAGE_0);
+		createItemStyleBlock(141, 1, t.CARROTS_STAGE_0);
+		createItemStyleBlock(141, 2, t.CARROTS_STAGE_1);
+		createItemStyleBlock(141, 3, t.CARROTS_STAGE_1);
+		createItemStyleBlock(141, 4, t.CARROTS_STAGE_2);
+		createItemStyleBlock(141, 5, t.CARROTS_STAGE_2);
+		createItemStyleBlock(141, 6, t.CARROTS_STAGE_2);
+		createItemStyleBlock(141, 7, t.CARROTS_STAGE_3);
+		// --
+	});
+	tasks.push_back([&]() {
+		// potatoes --
+		createItemStyleBlock(142, 0, t.POTATOES_STAGE_0);
+		createItemStyleBlock(142, 1, t.POTATOES_STAGE_0);
+		createItemStyleBlock(142, 2, t.POTATOES_STAGE_1);
+		createItemStyleBlock(142, 3, t.POTATOES_STAGE_1);
+		createItemStyleBlock(142, 4, t.POTATOES_STAGE_2);
+		createItemStyleBlock(142, 5, t.POTATOES_STAGE_2);
+		createItemStyleBlock(142, 6, t.POTATOES_STAGE_2);
+		createItemStyleBlock(142, 7, t.POTATOES_STAGE_3);
+		// --
+		createButton(143, t.PLANKS_OAK); // wooden button
+		// id 144 // head
+		// id 145 // anvil
+		createChest(146, resources.getTrappedChest()); // trapped chest
+		createDoubleChest(146, resources.getTrappedDoubleChest()); // double trapped chest
+		createSmallerBlock(147, 0, t.GOLD_BLOCK, t.GOLD_BLOCK, 0, 1); // weighted pressure plate (light)
+		createSmallerBlock(148, 0, t.QUARTZ_BLOCK_LINES, t.QUARTZ_BLOCK_LINES, 0, 1); // weighted pressure plate (heavy)
+		createRedstoneRepeater(149, t.COMPARATOR_OFF); // redstone comparator (inactive) // TODO
+		createRedstoneRepeater(150, t.COMPARATOR_ON); // redstone comparator (active) // TODO
+		createSmallerBlock(151, 0, t.DAYLIGHT_DETECTOR_SIDE, t.DAYLIGHT_DETECTOR_TOP, 0, 8); // daylight sensor
+		createBlock(152, 0, t.REDSTONE_BLOCK); // block of redstone
+		createBlock(153, 0, t.QUARTZ_ORE); // nether quartz ore
+		createHopper(); // id 154
+			// block of quartz --
+		createBlock(155, 0, t.QUARTZ_BLOCK_SIDE, t.QUARTZ_BLOCK_TOP);
+		createBlock(155, 1, t.QUARTZ_BLOCK_CHISELED, t.QUARTZ_BLOCK_CHISELED_TOP);
+		createBlock(155, 2, t.QUARTZ_BLOCK_LINES, t.QUARTZ_BLOCK_LINES_TOP);
+		createBlock(155, 3, t.QUARTZ_BLOCK_LINES_TOP, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90), t.QUARTZ_BLOCK_LINES);
+		createBlock(155, 4, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90), t.QUARTZ_BLOCK_LINES_TOP, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90));
+		// --
+		createStairs(156, t.QUARTZ_BLOCK_SIDE); // quartz stairs
+		createStraightRails(157, 0, t.RAIL_ACTIVATOR); // activator rail
+		createDispenserDropper(158, t.DROPPER_FRONT_HORIZONTAL); // dropper
+	});
+	tasks.push_back([&]() {
+		// stained clay --
+		createBlock(159, 0, t.HARDENED_CLAY_STAINED_WHITE);
+		createBlock(159, 1, t.HARDENED_CLAY_STAINED_ORANGE);
+		createBlock(159, 2, t.HARDENED_CLAY_STAINED_MAGENTA);
+		createBlock(159, 3, t.HARDENED_CLAY_STAINED_LIGHT_BLUE);
+		createBlock(159, 4, t.HARDENED_CLAY_STAINED_YELLOW);
+		createBlock(159, 5, t.HARDENED_CLAY_STAINED_LIME);
+		createBlock(159, 6, t.HARDENED_CLAY_STAINED_PINK);
+		createBlock(159, 7, t.HARDENED_CLAY_STAINED_GRAY);
+		createBlock(159, 8, t.HARDENED_CLAY_STAINED_SILVER);
+		createBlock(159, 9, t.HARDENED_CLAY_STAINED_CYAN);
+		createBlock(159, 10, t.HARDENED_CLAY_STAINED_PURPLE);
+		createBlock(159, 11, t.HARDENED_CLAY_STAINED_BLUE);
+		createBlock(159, 12, t.HARDENED_CLAY_STAINED_BROWN);
+		createBlock(159, 13, t.HARDENED_CLAY_STAINED_GREEN);
+		createBlock(159, 14, t.HARDENED_CLAY_STAINED_RED);
+		createBlock(159, 15, t.HARDENED_CLAY_STAINED_BLACK);
+		// --
+		// stained glass pane --
+		createBarsPane(160, 0, t.GLASS_WHITE);
+		createBarsPane(160, 1, t.GLASS_ORANGE);
+		createBarsPane(160, 2, t.GLASS_MAGENTA);
+		createBarsPane(160, 3, t.GLASS_LIGHT_BLUE);
+		createBarsPane(160, 4, t.GLASS_YELLOW);
+		createBarsPane(160, 5, t.GLASS_LIME);
+		createBarsPane(160, 6, t.GLASS_PINK);
+		createBarsPane(160, 7, t.GLASS_GRAY);
+		createBarsPane(160, 8, t.GLASS_SILVER);
+		createBarsPane(160, 9, t.GLASS_CYAN);
+		createBarsPane(160, 10, t.GLASS_PURPLE);
+		createBarsPane(160, 11, t.GLASS_BLUE);
+		createBarsPane(160, 12, t.GLASS_BROWN);
+		createBarsPane(160, 13, t.GLASS_GREEN);
+		createBarsPane(160, 14, t.GLASS_RED);
+		createBarsPane(160, 15, t.GLASS_BLACK);
+		// --
+	});
+	tasks.push_back([&]() {
+		// id 161 acacia/dark oak leaves, see createLeaves()
+		// some more wood --
+		createWood(162, 0, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // acacia
+		createWood(162, 1, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // acacia (placeholder)
+		createWood(162, 2, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // dark wood
+		createWood(162, 3, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // dark wood (placeholder)
+		// --
+		createStairs(163, t.PLANKS_ACACIA); // acacia wood stairs
+		createStairs(164, t.PLANKS_BIG_OAK); // dark oak wood stairs
+		createBlock(165, 0, t.SLIME); // slime block
+		createBlock(166, 0, empty_texture); // barrier
+		createTrapdoor(167, t.IRON_TRAPDOOR); // iron trapdoor
+		// prismarine --
+		createBlock(168, 0, t.PRISMARINE_ROUGH);
+		createBlock(168, 1, t.PRISMARINE_BRICKS);
+		createBlock(168, 2, t.PRISMARINE_DARK);
+		// --
+		createBlock(169, 0, t.SEA_LANTERN); // sea lantern
+		// hay block --
+		createBlock(170, 0, t.HAY_BLOCK_SIDE, t.HAY_BLOCK_TOP); // normal orientation
+		createBlock(170, 4, t.HAY_BLOCK_TOP, t.HAY_BLOCK_SIDE.rotate(1), t.HAY_BLOCK_SIDE); // east-west
+		createBlock(170, 8, t.HAY_BLOCK_SIDE.rotate(1), t.HAY_BLOCK_TOP, t.HAY_BLOCK_SIDE.rotate(1)); // north-south
+		// --
+		// carpet --
+		createSmallerBlock(171, 0, t.WOOL_COLORED_WHITE, 0, 1);
+		createSmallerBlock(171, 1, t.WOOL_COLORED_ORANGE, 0, 1);
+		createSmallerBlock(171, 2, t.WOOL_COLORED_MAGENTA, 0, 1);
+		createSmallerBlock(171, 3, t.WOOL_COLORED_LIGHT_BLUE, 0, 1);
+		createSmallerBlock(171, 4, t.WOOL_COLORED_YELLOW, 0, 1);
+		createSmallerBlock(171, 5, t.WOOL_COLORED_LIME, 0, 1);
+		createSmallerBlock(171, 6, t.WOOL_COLORED_PINK, 0, 1);
+		createSmallerBlock(171, 7, t.WOOL_COLORED_GRAY, 0, 1);
+		createSmallerBlock(171, 8, t.WOOL_COLORED_SILVER, 0, 1);
+		createSmallerBlock(171, 9, t.WOOL_COLORED_CYAN, 0, 1);
+		createSmallerBlock(171, 10, t.WOOL_COLORED_PURPLE, 0, 1);
+		createSmallerBlock(171, 11, t.WOOL_COLORED_BLUE, 0, 1);
+		createSmallerBlock(171, 12, t.WOOL_COLORED_BROWN, 0, 1);
+		createSmallerBlock(171, 13, t.WOOL_COLORED_GREEN, 0, 1);
+		createSmallerBlock(171, 14, t.WOOL_COLORED_RED, 0, 1);
+		createSmallerBlock(171, 15, t.WOOL_COLORED_BLACK, 0, 1);
+		// --
+	});
+	tasks.push_back([&]() {
+		createBlock(172, 0, t.HARDENED_CLAY); // hardened clay
+		createBlock(173, 0, t.COAL_BLOCK); // block of coal
+		createBlock(174, 0, t.ICE_PACKED); // packed ice
+		// large plants, id 175 --
+		// the top texture of the sunflower is a bit modified
+		RGBAImage sunflower_top = t.DOUBLE_PLANT_SUNFLOWER_TOP;
+		sunflower_top.alphaBlit(t.DOUBLE_PLANT_SUNFLOWER_FRONT, 0, -texture_size * 0.25);
+		createLargePlant(0, t.DOUBLE_PLANT_SUNFLOWER_BOTTOM, sunflower_top);
+		createLargePlant(1, t.DOUBLE_PLANT_SYRINGA_BOTTOM, t.DOUBLE_PLANT_SYRINGA_TOP);
+		createLargePlant(2, t.DOUBLE_PLANT_GRASS_BOTTOM, t.DOUBLE_PLANT_GRASS_TOP);
+		createLargePlant(3, t.DOUBLE_PLANT_FERN_BOTTOM, t.DOUBLE_PLANT_FERN_TOP);
+		createLargePlant(4, t.DOUBLE_PLANT_ROSE_BOTTOM, t.DOUBLE_PLANT_ROSE_TOP);
+		createLargePlant(5, t.DOUBLE_PLANT_PAEONIA_BOTTOM, t.DOUBLE_PLANT_PAEONIA_TOP);
+		// --
+		// id 176 // standing banner
+		// id 177 // wall banner
+		createSmallerBlock(178, 0, t.DAYLIGHT_DETECTOR_SIDE, t.DAYLIGHT_DETECTOR_INVERTED_TOP, 0, 8); // inverted daylight sensor
+		// -- red sandstone
+		createBlock(179, 0, t.RED_SANDSTONE_NORMAL, t.RED_SANDSTONE_TOP); // normal
+		createBlock(179, 1, t.RED_SANDSTONE_CARVED, t.RED_SANDSTONE_TOP); // chiseled
+		createBlock(179, 2, t.RED_SANDSTONE_SMOOTH, t.RED_SANDSTONE_TOP); // smooth
+		// --
+		createStairs(180, t.RED_SANDSTONE_NORMAL, t.RED_SANDSTONE_TOP); // red sandstone stairs
+		createSlabs(181, SlabType::STONE2, true); // double red sandstone slabs
+		createSlabs(182, SlabType::STONE2, false); // normal red sandstone slabs
+		createFenceGate(183, t.PLANKS_SPRUCE); // spruce fence gate
+		createFenceGate(184, t.PLANKS_BIRCH); // birch fence gate
+	});
+	tasks.push_back([&]() {
+		createFenceGate(185, t.PLANKS_JUNGLE); // jungle fence gate
+		createFenceGate(186, t.PLANKS_BIG_OAK); // dark oak fence gate
+		createFenceGate(187, t.PLANKS_ACACIA); // acacia fence gate
+		createFence(188, 0, t.PLANKS_SPRUCE); // spruce fence
+		createFence(189, 0, t.PLANKS_BIRCH); // birch fence
+		createFence(190, 0, t.PLANKS_JUNGLE); // jungle fence
+		createFence(191, 0, t.PLANKS_BIG_OAK); // dark oak fence
+		createFence(192, 0, t.PLANKS_ACACIA); // acacia fence
+		createDoor(193, t.DOOR_SPRUCE_LOWER, t.DOOR_SPRUCE_UPPER); // spruce door
+		createDoor(194, t.DOOR_BIRCH_LOWER, t.DOOR_BIRCH_UPPER); // birch door
+		createDoor(195, t.DOOR_JUNGLE_LOWER, t.DOOR_JUNGLE_UPPER); // jungle door
+		createDoor(196, t.DOOR_ACACIA_LOWER, t.DOOR_ACACIA_UPPER); // acacia door
+		createDoor(197, t.DOOR_DARK_OAK_LOWER, t.DOOR_DARK_OAK_UPPER); // dark oak door
+		createEndRod(); // id 198
+		createBlock(199, 0, t.CHORUS_PLANT); // chrous plant
+		// chorus flower --
+		createBlock(200, 0, t.CHORUS_FLOWER);
+		createBlock(200, 1, t.CHORUS_FLOWER);
+		createBlock(200, 2, t.CHORUS_FLOWER);
+		createBlock(200, 3, t.CHORUS_FLOWER);
+		createBlock(200, 4, t.CHORUS_FLOWER);
+		createBlock(200, 5, t.CHORUS_FLOWER_DEAD);
+		// --
+		createBlock(201, 0, t.PURPUR_BLOCK); // purpur block
+		// purpur pillar --
+		// TODO is the official data like this or are there also other combination? 0, 4, 8 seems odd...
+		createBlock(202, 0, t.PURPUR_PILLAR, t.PURPUR_PILLAR_TOP); // vertically
+		createBlock(202, 4, t.PURPUR_PILLAR_TOP, t.PURPUR_PILLAR); // east-west
+		createBlock(202, 8, t.PURPUR_PILLAR_TOP, t.PURPUR_PILLAR.rotate(1)); // north-south
+		// --
+		createStairs(203, t.PURPUR_BLOCK); // purpur stairs
+		createSlabs(204, SlabType::PURPUR, true); // purpur double slab
+		createSlabs(205, SlabType::PURPUR, false); // purpur slab
+		createBlock(206, 0, t.END_BRICKS); // end stone bricks
+	});
+	tasks.push_back([&]() {
+		// beetroot seeds --
+		createItemStyleBlock(207, 0, t.BEETROOTS_STAGE_0);
+		createItemStyleBlock(207, 2, t.BEETROOTS_STAGE_2);
+		createItemStyleBlock(207, 3, t.BEETROOTS_STAGE_3);
+		// --
+		createSmallerBlock(208, 0, t.GRASS_PATH_SIDE, t.GRASS_PATH_TOP, 0, texture_size * 15.0 / 16.0); // grass paths
+		createBlock(209, 0, resources.getEndportalTexture()); // end gateway
+		createCommandBlock(210, t.REPEATING_COMMAND_BLOCK_FRONT, t.REPEATING_COMMAND_BLOCK_BACK,
+				t.REPEATING_COMMAND_BLOCK_SIDE, t.REPEATING_COMMAND_BLOCK_CONDITIONAL); // id 210
+		createCommandBlock(211, t.CHAIN_COMMAND_BLOCK_FRONT, t.CHAIN_COMMAND_BLOCK_BACK,
+				t.CHAIN_COMMAND_BLOCK_SIDE, t.CHAIN_COMMAND_BLOCK_CONDITIONAL); // id 211
+		// frosted ice --
+		createIce(212, 0, t.FROSTED_ICE_0);
+		createIce(212, 1, t.FROSTED_ICE_1);
+		createIce(212, 2, t.FROSTED_ICE_2);
+		createIce(212, 3, t.FROSTED_ICE_3);
+		// --
+		createBlock(213, 0, t.MAGMA); // magma
+		createBlock(214, 0, t.NETHER_WART_BLOCK); // nether wart block
+		createBlock(215, 0, t.RED_NETHER_BRICK); // red nether brick
+		// bone block --
+		createBlock(216, 0, t.BONE_BLOCK_SIDE, t.BONE_BLOCK_TOP); // vertically
+		createBlock(216, 4, t.BONE_BLOCK_TOP, t.BONE_BLOCK_SIDE, t.BONE_BLOCK_SIDE); // east-west
+		createBlock(216, 8, t.BONE_BLOCK_SIDE, t.BONE_BLOCK_TOP, t.BONE_BLOCK_SIDE); // north-south
+		// --
+		createObserver(218); // observer
+	});
+	tasks.push_back([&]() {
+		// shulker box --
+		createShulkerBox(219, 0, resources.getShulkerBoxTextures()); // white
+		createShulkerBox(220, 1, resources.getShulkerBoxTextures()); // orange
+		createShulkerBox(221, 2, resources.getShulkerBoxTextures()); // magenta
+		createShulkerBox(222, 3, resources.getShulkerBoxTextures()); // light blue
+		createShulkerBox(223, 4, resources.getShulkerBoxTextures()); // yellow
+		createShulkerBox(224, 5, resources.getShulkerBoxTextures()); // lime
+		createShulkerBox(225, 6, resources.getShulkerBoxTextures()); // pink
+		createShulkerBox(226, 7, resources.getShulkerBoxTextures()); // gray
+		createShulkerBox(227, 8, resources.getShulkerBoxTextures()); // light gray
+		createShulkerBox(228, 9, resources.getShulkerBoxTextures()); // cyan
+		createShulkerBox(229, 10, resources.getShulkerBoxTextures()); // purple
+		createShulkerBox(230, 11, resources.getShulkerBoxTextures()); // blue
+		createShulkerBox(231, 12, resources.getShulkerBoxTextures()); // brown
+		createShulkerBox(232, 13, resources.getShulkerBoxTextures()); // green
+		createShulkerBox(233, 14, resources.getShulkerBoxTextures()); // red
+		createShulkerBox(234, 15, resources.getShulkerBoxTextures()); // black
+		// glazed terracotta --
+		createGlazedTerracotta(235, t.GLAZED_TERRACOTTA_WHITE); // white
+		createGlazedTerracotta(236, t.GLAZED_TERRACOTTA_ORANGE); // orange
+		createGlazedTerracotta(237, t.GLAZED_TERRACOTTA_MAGENTA); // magenta
+		createGlazedTerracotta(238, t.GLAZED_TERRACOTTA_LIGHT_BLUE); // light blue
+		createGlazedTerracotta(239, t.GLAZED_TERRACOTTA_YELLOW); // yellow
+		createGlazedTerracotta(240, t.GLAZED_TERRACOTTA_LIME); // lime
+		createGlazedTerracotta(241, t.GLAZED_TERRACOTTA_PINK); // pink
+		createGlazedTerracotta(242, t.GLAZED_TERRACOTTA_GRAY); // gray
+		createGlazedTerracotta(243, t.GLAZED_TERRACOTTA_SILVER); // light gray
+		createGlazedTerracotta(244, t.GLAZED_TERRACOTTA_CYAN); // cyan
+		createGlazedTerracotta(245, t.GLAZED_TERRACOTTA_PURPLE); // purple
+		createGlazedTerracotta(246, t.GLAZED_TERRACOTTA_BLUE); // blue
+		createGlazedTerracotta(247, t.GLAZED_TERRACOTTA_BROWN); // brown
+		createGlazedTerracotta(248, t.GLAZED_TERRACOTTA_GREEN); // green
+		createGlazedTerracotta(249, t.GLAZED_TERRACOTTA_RED); // red
+		createGlazedTerracotta(250, t.GLAZED_TERRACOTTA_BLACK); // black
+		// concrete --
+		createBlock(251, 0, t.CONCRETE_WHITE); // white
+		createBlock(251, 1, t.CONCRETE_ORANGE); // orange
+		createBlock(251, 2, t.CONCRETE_MAGENTA); // magenta
+		createBlock(251, 3, t.CONCRETE_LIGHT_BLUE); // light blue
+		createBlock(251, 4, t.CONCRETE_YELLOW); // yellow
+		createBlock(251, 5, t.CONCRETE_LIME); // lime
+		createBlock(251, 6, t.CONCRETE_PINK); // pink
+		createBlock(251, 7, t.CONCRETE_GRAY); // gray
+		createBlock(251, 8, t.CONCRETE_SILVER); // light gray
+		createBlock(251, 9, t.CONCRETE_CYAN); // cyan
+		createBlock(251, 10, t.CONCRETE_PURPLE); // purple
+		createBlock(251, 11, t.CONCRETE_BLUE); // blue
+		createBlock(251, 12, t.CONCRETE_BROWN); // brown
+		createBlock(251, 13, t.CONCRETE_GREEN); // green
+		createBlock(251, 14, t.CONCRETE_RED); // red
+		createBlock(251, 15, t.CONCRETE_BLACK); // black
+		// concrete powder --
+		createBlock(252, 0, t.CONCRETE_POWDER_WHITE); // white
+		createBlock(252, 1, t.CONCRETE_POWDER_ORANGE); // orange
+		createBlock(252, 2, t.CONCRETE_POWDER_MAGENTA); // magenta
+		createBlock(252, 3, t.CONCRETE_POWDER_LIGHT_BLUE); // light blue
+		createBlock(252, 4, t.CONCRETE_POWDER_YELLOW); // yellow
+		createBlock(252, 5, t.CONCRETE_POWDER_LIME); // lime
+		createBlock(252, 6, t.CONCRETE_POWDER_PINK); // pink
+		createBlock(252, 7, t.CONCRETE_POWDER_GRAY); // gray
+		createBlock(252, 8, t.CONCRETE_POWDER_SILVER); // light gray
+		createBlock(252, 9, t.CONCRETE_POWDER_CYAN); // cyan
+		createBlock(252, 10, t.CONCRETE_POWDER_PURPLE); // purple
+		createBlock(252, 11, t.CONCRETE_POWDER_BLUE); // blue
+		createBlock(252, 12, t.CONCRETE_POWDER_BROWN); // brown
+		createBlock(252, 13, t.CONCRETE_POWDER_GREEN); // green
+		createBlock(252, 14, t.CONCRETE_POWDER_RED); // red
+		createBlock(252, 15, t.CONCRETE_POWDER_BLACK); // black
+		// --
+	});
+	tasks.push_back([&]() {
+		createBlock(217, 0, empty_texture); // structure void
+		// structure block --
+		createBlock(255, 0, t.STRUCTURE_BLOCK_SAVE);
+		createBlock(255, 1, t.STRUCTURE_BLOCK_LOAD);
+		createBlock(255, 2, t.STRUCTURE_BLOCK_CORNER);
+		createBlock(255, 3, t.STRUCTURE_BLOCK_DATA);
+		// --
+	});
+	runBlockTasks(tasks);
 }
 
 int IsometricBlockImages::createOpaqueWater() {
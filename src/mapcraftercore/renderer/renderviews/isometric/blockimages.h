@@ -26,6 +26,7 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 /**
  * For the rendering we need to transform the Minecraft textures to some kind of block
@@ -153,6 +154,20 @@ public:
 	void next();
 };
 
+/**
+ * A horizontal run of pixels of a face of a block image.
+ */
+struct FaceSpan {
+	int x, y;
+	int count;
+};
+
+/**
+ * Returns the pixels of a face (FACE_TOP, FACE_WEST or FACE_SOUTH) of a block image with
+ * a texture size as horizontal runs, these are the pixels blitFace() writes the face to.
+ */
+std::vector<FaceSpan> getFaceSpans(int face, int size);
+
 void blitFace(RGBAImage& image, int face, const RGBAImage& texture,
 		int xoff = 0, int yoff = 0,
 		bool darken = true, double dleft = 0.6, double dright = 0.75);
@@ -201,7 +216,9 @@ public:
 	/**
 	 * We need to overwrite this because there is a special case for the snowy grass block.
 	 */
-	virtual RGBAImage getBiomeBlock(uint16_t id, uint16_t data, uint16_t extra_data, const Biome& biome) const;
+	virtual RGBAImage getBiomeBlock(uint16_t id, uint16_t data, uint16_t extra_data, const BiomeColors& colors) const;
+
+	virtual uint32_t getBiomeColor(uint16_t id, uint16_t data, const BiomeColors& colors) const;
 
 	virtual int getBlockSize() const;
 
@@ -210,10 +227,14 @@ protected:
 	// defaults to 0.75 and 0.6
 	double dleft, dright;
 
+	// the top face of the block images, to tint the grass blocks with the biome colors
+	std::vector<FaceSpan> top_face_spans;
+
 	RGBAImage shadow_edge_masks[4];
 
 	virtual uint16_t filterBlockData(uint16_t id, uint16_t data) const;
 	virtual bool isImageTransparent(const RGBAImage& block) const;
+	virtual std::string getCacheKey(const TextureResources& resources) const;
 	void addBlockShadowEdges(uint16_t id, uint16_t data, const RGBAImage& block);
 
 	void setBlockImage(uint16_t id, uint16_t data, const BlockImage& block);
@@ -301,6 +322,7 @@ protected:
 	void createButton(uint16_t id, const RGBAImage& tex); // id 77, 143
 	void createSnow(); // id 78
 	void createIce(uint8_t id, uint16_t extra_data, const RGBAImage& texture); // id 79, 212
+	RGBAImage buildCactus() const;
 	void createCactus(); // id 81
 	void createFence(uint16_t id, uint16_t extra_data, const RGBAImage& texture); // id 85, 113, 188-192
 	void createPumkin(uint16_t id, const RGBAImage& front); // id 86, 91
@@ -327,7 +349,7 @@ protected:
 	void createEndRod(); // id 198
 
 	virtual RGBAImage createUnknownBlock() const;
-	virtual RGBAImage createBiomeBlock(uint16_t id, uint16_t data, const Biome& biome) const;
+	virtual RGBAImage createBiomeBlock(uint16_t id, uint16_t data, uint32_t color) const;
 	virtual void createBlocks();
 	virtual int createOpaqueWater();
 
@@ -25,24 +25,18 @@
 namespace mapcrafter {
 namespace renderer {
 
+IsometricLightingRenderer::IsometricLightingRenderer()
+	: face_size(0) {
+}
+
 IsometricLightingRenderer::~IsometricLightingRenderer() {
 }
 
 void IsometricLightingRenderer::lightLeft(RGBAImage& image, const CornerColors& colors,
 		int y_start, int y_end) const {
 	int size = image.getWidth() / 2;
-	RGBAImage shade(size, size);
-	createShade(shade, colors);
-
-	for (SideFaceIterator it(size, SideFaceIterator::LEFT); !it.end(); it.next()) {
-		if (it.src_y < y_start || it.src_y > y_end)
-			continue;
-		uint32_t& pixel = image.pixel(it.dest_x, it.dest_y + size/2);
-		if (pixel != 0) {
-			uint8_t d = rgba_alpha(shade.pixel(it.src_x, it.src_y));
-			pixel = rgba_multiply(pixel, d, d, d);
-		}
-	}
+	createShade(size, colors);
+	applyShade(image, getFace(0, size), 0, y_start, y_end);
 }
 
 void IsometricLightingRenderer::lightLeft(RGBAImage& image, const CornerColors& colors) const {
@@ -52,18 +46,8 @@ void IsometricLightingRenderer::lightLeft(RGBAImage& image, const CornerColors&
 void IsometricLightingRenderer::lightRight(RGBAImage& image, const CornerColors& colors,
 		int y_start, int y_end) const {
 	int size = image.getWidth() / 2;
-	RGBAImage shade(size, size);
-	createShade(shade, colors);
-
-	for (SideFaceIterator it(size, SideFaceIterator::RIGHT); !it.end(); it.next()) {
-		if (it.src_y < y_start || it.src_y > y_end)
-			continue;
-		uint32_t& pixel = image.pixel(it.dest_x + size, it.dest_y + size/2);
-		if (pixel != 0) {
-			uint8_t d = rgba_alpha(shade.pixel(it.src_x, it.src_y));
-			pixel = rgba_multiply(pixel, d, d, d);
-		}
-	}
+	createShade(size, colors);
+	applyShade(image, getFace(1, size), 0, y_start, y_end);
 }
 
 void IsometricLightingRenderer::lightRight(RGBAImage& image, const CornerColors& colors) const {
@@ -72,57 +56,75 @@ void IsometricLightingRenderer::lightRight(RGBAImage& image, const CornerColors&
 
 void IsometricLightingRenderer::lightTop(RGBAImage& image, const CornerColors& colors,
 		int yoff) const {
-		int size = image.getWidth() / 2;
-	RGBAImage shade(size, size);
+	int size = image.getWidth() / 2;
 	// we need to rotate the corners a bit to make them suitable for the TopFaceIterator
 	CornerColors rotated = {{colors[1], colors[3], colors[0], colors[2]}};
-	createShade(shade, rotated);
+	createShade(size, rotated);
+	applyShade(image, getFace(2, size), yoff * image.getWidth());
+}
 
-	for (TopFaceIterator it(size); !it.end(); it.next()) {
-		uint32_t& pixel = image.pixel(it.dest_x, it.dest_y + yoff);
-		if (pixel != 0) {
-			uint8_t d = rgba_alpha(shade.pixel(it.src_x, it.src_y));
-			pixel = rgba_multiply(pixel, d, d, d);
+const std::vector<LightingRenderer::FacePixel>& IsometricLightingRenderer::getFace(
+		int face, int size) const {
+	if (face_size != size) {
+		face_size = size;
+		int width = 2 * size;
+		for (int i = 0; i < 3; i++)
+			faces[i].clear();
+		for (SideFaceIterator it(size, SideFaceIterator::LEFT); !it.end(); it.next()) {
+			FacePixel pixel = {(it.dest_y + size/2) * width + it.dest_x,
+					it.src_y * size + it.src_x, it.src_y};
+			faces[0].push_back(pixel);
+		}
+		for (SideFaceIterator it(size, SideFaceIterator::RIGHT); !it.end(); it.next()) {
+			FacePixel pixel = {(it.dest_y + size/2) * width + it.dest_x + size,
+					it.src_y * size + it.src_x, it.src_y};
+			faces[1].push_back(pixel);
+		}
+		for (TopFaceIterator it(size); !it.end(); it.next()) {
+			FacePixel pixel = {it.dest_y * width + it.dest_x,
+					it.src_y * size + it.src_x, it.src_y};
+			faces[2].push_back(pixel);
 		}
 	}
+	return faces[face];
+}
+
+IsometricOverlayRenderer::IsometricOverlayRenderer()
+	: face_size(-1) {
 }
 
 void IsometricOverlayRenderer::tintLeft(RGBAImage& image, RGBAPixel color) const {
-	int texture_size = image.getWidth() / 2;
-	
-	auto overlay = getRecolor(color);
-	for (SideFaceIterator it(texture_size, SideFaceIterator::LEFT); !it.end(); it.next()) {
-		RGBAPixel& pixel = image.pixel(it.dest_x, it.dest_y + texture_size/2);
-		if (high_contrast)
-			pixel = rgba_add_clamp(pixel, overlay);
-		else
-			blend(pixel, color);
-	}
+	tintFace(image, color, 0);
 }
 
 void IsometricOverlayRenderer::tintRight(RGBAImage& image, RGBAPixel color) const {
-	int texture_size = image.getWidth() / 2;
-	
-	auto overlay = getRecolor(color);
-	for (SideFaceIterator it(texture_size, SideFaceIterator::RIGHT); !it.end(); it.next()) {
-		RGBAPixel& pixel = image.pixel(it.dest_x + texture_size, it.dest_y + texture_size/2);
-		if (high_contrast)
-			pixel = rgba_add_clamp(pixel, overlay);
-		else
-			blend(pixel, color);
-	}
+	tintFace(image, color, 1);
 }
 
 void IsometricOverlayRenderer::tintTop(RGBAImage& image, RGBAPixel color, int offset) const {
+	tintFace(image, color, 2);
+}
+
+void IsometricOverlayRenderer::tintFace(RGBAImage& image, RGBAPixel color,
+		int face) const {
 	int texture_size = image.getWidth() / 2;
+	if (face_size != texture_size) {
+		face_size = texture_size;
+		faces[0] = getFaceSpans(FACE_WEST, texture_size);
+		faces[1] = getFaceSpans(FACE_SOUTH, texture_size);
+		faces[2] = getFaceSpans(FACE_TOP, texture_size);
+	}
 
-	auto overlay = getRecolor(color);
-	for (TopFaceIterator it(texture_size); !it.end(); it.next()) {
-		RGBAPixel& pixel = image.pixel(it.dest_x, it.dest_y);
-		if (high_contrast)
-			pixel = rgba_add_clamp(pixel, overlay);
-		else
-			blend(pixel, color);
+	if (high_contrast) {
+		auto recolor = getRecolor(color);
+		for (auto it = faces[face].begin(); it != faces[face].end(); ++it)
+			tintRow(&image.pixel(it->x, it->y), it->count, recolor);
+	} else {
+		for (auto it = faces[face].begin(); it != faces[face].end(); ++it) {
+			RGBAPixel* row = &image.pixel(it->x, it->y);
+			for (int i = 0; i < it->count; i++)
+				blend(row[i], color);
+		}
 	}
 }
 
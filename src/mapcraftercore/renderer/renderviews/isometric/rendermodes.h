@@ -17,6 +17,7 @@
  * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "blockimages.h"
 #include "../../rendermodes/lighting.h"
 #include "../../rendermodes/overlay.h"
 
@@ -28,6 +29,7 @@ namespace renderer {
 
 class IsometricLightingRenderer : public LightingRenderer {
 public:
+	IsometricLightingRenderer();
 	virtual ~IsometricLightingRenderer();
 
 	virtual void lightLeft(RGBAImage& image, const CornerColors& colors,
@@ -39,13 +41,36 @@ public:
 	virtual void lightRight(RGBAImage& image, const CornerColors& colors) const;
 
 	virtual void lightTop(RGBAImage& image, const CornerColors& colors, int yoff) const;
+
+private:
+	// the face pixels of the left, right and top face of block images with the current
+	// block size, they are computed with the face iterators once per block size
+	mutable int face_size;
+	mutable std::vector<FacePixel> faces[3];
+
+	/**
+	 * Returns the face pixels of a face (0 = left, 1 = right, 2 = top) of a block image.
+	 */
+	const std::vector<FacePixel>& getFace(int face, int size) const;
 };
 
 class IsometricOverlayRenderer : public OverlayRenderer {
 public:
+	IsometricOverlayRenderer();
+
 	virtual void tintLeft(RGBAImage& image, RGBAPixel color) const;
 	virtual void tintRight(RGBAImage& image, RGBAPixel color) const;
 	virtual void tintTop(RGBAImage& image, RGBAPixel color, int offset) const;
+
+protected:
+	/**
+	 * Tints the pixels of a face (0 = left, 1 = right, 2 = top) of a block image.
+	 */
+	void tintFace(RGBAImage& image, RGBAPixel color, int face) const;
+
+	// the rows of pixels of the faces of block images with a texture size
+	mutable int face_size;
+	mutable std::vector<FaceSpan> faces[3];
 };
 
 }
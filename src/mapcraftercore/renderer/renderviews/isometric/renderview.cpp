@@ -76,6 +76,10 @@ void IsometricRenderView::configureTileRenderer(TileRenderer* tile_renderer,
 		const config::MapSection& map_config) const {
 	assert(tile_renderer != nullptr);
 	RenderView::configureTileRenderer(tile_renderer, world_config, map_config);
+
+	IsometricTileRenderer* renderer = dynamic_cast<IsometricTileRenderer*>(tile_renderer);
+	assert(renderer != nullptr);
+	renderer->setFrontToBack(map_config.renderFrontToBack());
 }
 
 } /* namespace renderer */
@@ -21,6 +21,7 @@
 
 #include "../../biomes.h"
 #include "../../blockimages.h"
+#include "../../blockprofiler.h"
 #include "../../image.h"
 #include "../../rendermode.h"
 #include "../../tileset.h"
@@ -28,16 +29,44 @@
 #include "../../../mc/worldcache.h"
 #include "../../../util.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
-#include <set>
 #include <sstream>
 #include <vector>
 
 namespace mapcrafter {
 namespace renderer {
 
+namespace {
+
+/**
+ * Returns how many of the next blocks of a block row are still in the chunk of a block.
+ */
+int getRemainingRowBlocks(const mc::LocalBlockPos& block) {
+	// the row leaves the chunk when x reaches 16 or z reaches -1
+	return std::min(15 - block.x, block.z);
+}
+
+/**
+ * Returns a key to sort the blocks of a tile in drawing order, the same order as
+ * mc::BlockPos::operator< (y ascending, x descending, z ascending). The x- and
+ * z-coordinates are relative to a block of the tile.
+ */
+uint64_t getDrawKey(const mc::BlockPos& pos, const mc::BlockPos& origin) {
+	const int64_t bias = 1 << 23;
+	uint64_t x = bias - (pos.x - origin.x);
+	uint64_t z = bias + (pos.z - origin.z);
+	return ((uint64_t) pos.y << 48) | (x << 24) | z;
+}
+
+bool isWater(uint16_t id) {
+	return id == 8 || id == 9;
+}
+
+}
+
 TileTopBlockIterator::TileTopBlockIterator(const TilePos& tile, int block_size,
 		int tile_width)
 		: block_size(block_size), is_end(false) {
@@ -127,6 +156,12 @@ void BlockRowIterator::next() {
 	current.y--;
 }
 
+void BlockRowIterator::skip(int blocks) {
+	current.x += blocks;
+	current.z -= blocks;
+	current.y -= blocks;
+}
+
 bool BlockRowIterator::end() const {
 	return current.y < 0;
 }
@@ -135,32 +170,367 @@ bool RenderBlock::operator<(const RenderBlock& other) const {
 	return pos < other.pos;
 }
 
+ChunkSurfaceCache::Entry::Entry()
+	: revision(0) {
+}
+
+ChunkSurfaceCache::ChunkSurfaceCache()
+	: entries(SIZE), current(nullptr) {
+}
+
+uint32_t& ChunkSurfaceCache::get(const mc::Chunk& chunk, const mc::LocalBlockPos& pos) {
+	if (current == nullptr || current->pos != chunk.getPos()
+			|| current->revision != chunk.getRevision()) {
+		const mc::ChunkPos& chunk_pos = chunk.getPos();
+		current = &entries[(chunk_pos.x & 15) * 16 + (chunk_pos.z & 15)];
+		// reset the entry if it belongs to another chunk or to an old version of it
+		if (current->pos != chunk_pos || current->revision != chunk.getRevision()) {
+			current->pos = chunk_pos;
+			current->revision = chunk.getRevision();
+			for (int i = 0; i < mc::CHUNK_HEIGHT; i++)
+				std::fill(current->sections[i].begin(), current->sections[i].end(), 0);
+		}
+	}
+
+	std::vector<uint32_t>& section = current->sections[pos.y / 16];
+	if (section.empty())
+		section.resize(16 * 16 * 16, 0);
+	return section[(pos.y % 16) * 256 + pos.z * 16 + pos.x];
+}
+
 IsometricTileRenderer::IsometricTileRenderer(const RenderView* render_view,
 		BlockImages* images, int tile_width, mc::WorldCache* world,
 		RenderMode* render_mode)
-	: TileRenderer(render_view, images, tile_width, world, render_mode) {
+	: TileRenderer(render_view, images, tile_width, world, render_mode),
+	  top_blocks_size(0), front_to_back(false) {
 }
 
 IsometricTileRenderer::~IsometricTileRenderer() {
 }
 
+void IsometricTileRenderer::setFrontToBack(bool front_to_back) {
+	this->front_to_back = front_to_back;
+}
+
 void IsometricTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile) {
+	util::ProfileScope profile(util::ProfileStage::BLOCK_ITERATION);
 	// some vars, set correct image size
 	int block_size = images->getBlockSize();
 	tile.setSize(getTileSize(), getTileSize());
 
+	TileTopBlockIterator first(tile_pos, block_size, tile_width);
+	initializeTopBlocks(tile_pos, block_size);
+	drawBlocks(first.current, top_blocks, tile, 0, 0);
+}
+
+bool IsometricTileRenderer::getGeometryKey(uint64_t& key) const {
+	if (render_mode->hidesBlocks())
+		return false;
+	// FNV-1a like hash of the options
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t values[] = {(uint64_t) tile_width, (uint64_t) images->getBlockSize(),
+			use_preblit_water, (uint64_t) images->getMaxWaterPreblit(),
+			images->getTransparencyHash()};
+	key = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+		key = (key ^ values[i]) * prime;
+	return true;
+}
+
+void IsometricTileRenderer::renderTileGeometry(const TilePos& tile_pos, RGBAImage& tile,
+		TileGeometry& geometry) {
+	util::ProfileScope profile(util::ProfileStage::BLOCK_ITERATION);
+	int block_size = images->getBlockSize();
+	tile.setSize(getTileSize(), getTileSize());
+
+	TileTopBlockIterator first(tile_pos, block_size, tile_width);
+	initializeTopBlocks(tile_pos, block_size);
+	geometry.blocks.clear();
+	drawBlocks(first.current, top_blocks, tile, 0, 0, &geometry);
+}
+
+void IsometricTileRenderer::renderTileFromGeometry(const TilePos& tile_pos,
+		const TileGeometry& geometry, RGBAImage& tile) {
+	tile.setSize(getTileSize(), getTileSize());
+
+	// the part renderers create the images of parts of the blocks concurrently
+	size_t count = geometry.blocks.size();
+	int parts = getPartRenderersCount();
+	geometry_images.resize(count);
+	renderParts(parts, [&](TileRenderer* renderer, int part) {
+		static_cast<IsometricTileRenderer*>(renderer)->createGeometryImages(geometry,
+				count * part / parts, count * (part + 1) / parts, geometry_images);
+	});
+
+	drawn_blocks.clear();
+	for (size_t i = 0; i < count; i++)
+		if (geometry_images[i] != nullptr) {
+			DrawnBlock drawn = {geometry_images[i], geometry.blocks[i].draw_x,
+					geometry.blocks[i].draw_y};
+			drawn_blocks.push_back(drawn);
+		}
+	compositeBlocks(drawn_blocks, tile);
+}
+
+bool IsometricTileRenderer::renderTilePartially(const TilePos& tile_pos,
+		const std::vector<mc::ChunkPos>& changed_chunks, RGBAImage& tile) {
+	int block_size = images->getBlockSize();
+	int size = getTileSize();
+	if (changed_chunks.empty() || tile.getWidth() != size || tile.getHeight() != size)
+		return false;
+
+	// the block rows of a tile are drawn relative to the first top block, a block is
+	// drawn half a block further right per column and a quarter block further down per row
+	TileTopBlockIterator first(tile_pos, block_size, tile_width);
+	mc::BlockPos origin = first.current;
+	auto getDrawX = [&](int col) {
+		return first.draw_x + (col - origin.getCol()) * block_size / 2;
+	};
+	auto getDrawY = [&](int row) {
+		return first.draw_y + (row - origin.getRow()) * block_size / 4;
+	};
+
+	// the rectangle with the blocks of the changed chunks and the blocks next to them,
+	// whose images depend on their neighbors (and the lighting and biomes of them),
+	// the blocks in the same block rows behind them are drawn to the same pixels
+	int x1 = size, y1 = size, x2 = 0, y2 = 0;
+	for (auto it = changed_chunks.begin(); it != changed_chunks.end(); ++it) {
+		mc::BlockPos min(it->x * 16 - 1, it->z * 16 - 1, 0);
+		mc::BlockPos max(it->x * 16 + 16, it->z * 16 + 16, mc::CHUNK_HEIGHT * 16 - 1);
+		x1 = std::min(x1, getDrawX(min.getCol()));
+		x2 = std::max(x2, getDrawX(max.getCol()) + block_size);
+		y1 = std::min(y1, getDrawY(mc::BlockPos(max.x, min.z, max.y).getRow()));
+		y2 = std::max(y2, getDrawY(mc::BlockPos(min.x, max.z, min.y).getRow()) + block_size);
+	}
+	// a few more pixels for the rounding of the drawing positions
+	x1 = std::max(x1 - 2, 0);
+	y1 = std::max(y1 - 2, 0);
+	x2 = std::min(x2 + 2, size);
+	y2 = std::min(y2 + 2, size);
+	if (x1 >= x2 || y1 >= y2)
+		return true;
+	// rendering most of the tile is not worth it
+	if ((int64_t) (x2 - x1) * (y2 - y1) * 4 > (int64_t) size * size * 3)
+		return false;
+
+	util::ProfileScope profile(util::ProfileStage::BLOCK_ITERATION);
+	initializeTopBlocks(tile_pos, block_size);
+	partial_top_blocks.clear();
+	for (auto it = top_blocks.begin(); it != top_blocks.end(); ++it)
+		if (it->draw_x < x2 && it->draw_x + block_size > x1
+				&& it->draw_y < y2 && it->draw_y + block_size > y1)
+			partial_top_blocks.push_back(*it);
+
+	partial_image.setSize(x2 - x1, y2 - y1);
+	partial_image.clear();
+	drawBlocks(origin, partial_top_blocks, partial_image, x1, y1);
+	tile.simpleBlit(partial_image.view(), x1, y1);
+	return true;
+}
+
+void IsometricTileRenderer::initializeTopBlocks(const TilePos& tile_pos, int block_size) {
+	// the top blocks are iterated only once, the other tiles use them relative to
+	// their first top block
+	if (!top_blocks.empty() && top_blocks_size == block_size)
+		return;
+	top_blocks.clear();
+	top_blocks_size = block_size;
+	TileTopBlockIterator first(tile_pos, block_size, tile_width);
+	for (TileTopBlockIterator it(tile_pos, block_size, tile_width); !it.end(); it.next()) {
+		TopBlock top = {it.current - first.current, it.draw_x, it.draw_y};
+		top_blocks.push_back(top);
+	}
+	// ordered by columns, so the part renderers get strips of columns
+	std::stable_sort(top_blocks.begin(), top_blocks.end(),
+			[](const TopBlock& top1, const TopBlock& top2) {
+		return top1.draw_x < top2.draw_x;
+	});
+}
+
+void IsometricTileRenderer::drawBlocks(const mc::BlockPos& origin,
+		const std::vector<TopBlock>& tops, RGBAImage& image, int x, int y,
+		TileGeometry* geometry) {
+	int parts = getPartRenderersCount();
+	if (parts == 1) {
+		collectBlocks(origin, tops.begin(), tops.end());
+
+		// now blit all blocks, the tile has premultiplied alpha while blending
+		std::sort(draw_order.begin(), draw_order.end());
+		drawn_blocks.clear();
+		for (auto it = draw_order.begin(); it != draw_order.end(); ++it) {
+			const RenderBlock& block = blocks[it->second];
+			if (geometry != nullptr)
+				recordBlock(block, *geometry);
+			DrawnBlock drawn = {block.image, block.x - x, block.y - y};
+			drawn_blocks.push_back(drawn);
+		}
+		compositeBlocks(drawn_blocks, image);
+		return;
+	}
+
+	// the part renderers collect the blocks of strips of columns of the tile
+	// concurrently, then the blocks of all strips are merged in drawing order
+	size_t count = tops.size();
+	renderParts(parts, [&](TileRenderer* renderer, int part) {
+		static_cast<IsometricTileRenderer*>(renderer)->collectBlocks(origin,
+				tops.begin() + count * part / parts,
+				tops.begin() + count * (part + 1) / parts);
+	});
+
+	merged_draw_order.clear();
+	for (int i = 0; i < parts; i++) {
+		const IsometricTileRenderer* renderer = i == 0 ? this
+				: static_cast<const IsometricTileRenderer*>(part_renderers[i - 1]);
+		for (auto it = renderer->draw_order.begin(); it != renderer->draw_order.end(); ++it)
+			merged_draw_order.push_back(std::make_pair(it->first,
+					&renderer->blocks[it->second]));
+	}
+	std::sort(merged_draw_order.begin(), merged_draw_order.end());
+	drawn_blocks.clear();
+	for (auto it = merged_draw_order.begin(); it != merged_draw_order.end(); ++it) {
+		if (geometry != nullptr)
+			recordBlock(*it->second, *geometry);
+		DrawnBlock drawn = {it->second->image, it->second->x - x, it->second->y - y};
+		drawn_blocks.push_back(drawn);
+	}
+	compositeBlocks(drawn_blocks, image);
+}
+
+void IsometricTileRenderer::compositeBlocks(const std::vector<DrawnBlock>& drawn,
+		RGBAImage& image) {
+	util::ProfileScope profile_blit(util::ProfileStage::BLIT);
+	drawn_blocks_count += drawn.size();
+	if (front_to_back)
+		row_coverage.assign(image.getHeight(), 0);
+
+	// draws the parts of the blocks in the rows of a band of the image
+	auto drawBand = [&](int top, int bottom) {
+		auto draw = [&](const DrawnBlock& block) {
+			int y1 = std::max(top, block.y);
+			int y2 = std::min(bottom, block.y + block.image->getHeight());
+			if (y1 >= y2)
+				return;
+			RGBAImageView view = block.image->view(0, y1 - block.y,
+					block.image->getWidth(), y2 - y1);
+			if (front_to_back)
+				image.alphaBlitUnderPremultiplied(view, block.x, y1, row_coverage);
+			else
+				image.alphaBlitPremultiplied(view, block.x, y1);
+		};
+		if (front_to_back)
+			for (auto it = drawn.rbegin(); it != drawn.rend(); ++it)
+				draw(*it);
+		else
+			for (auto it = drawn.begin(); it != drawn.end(); ++it)
+				draw(*it);
+	};
+
+	int parts = getPartRenderersCount();
+	int height = image.getHeight();
+	if (parts == 1)
+		drawBand(0, height);
+	else
+		renderParts(parts, [&](TileRenderer*, int part) {
+			drawBand(height * part / parts, height * (part + 1) / parts);
+		});
+	image.unpremultiplyAlpha();
+}
+
+void IsometricTileRenderer::recordBlock(const RenderBlock& block,
+		TileGeometry& geometry) {
+	TileGeometry::Block recorded = {block.pos.x, block.pos.z, block.pos.y, block.x, block.y,
+			block.id, block.data, block.extra_data};
+	geometry.blocks.push_back(recorded);
+}
+
+void IsometricTileRenderer::createGeometryImages(const TileGeometry& geometry,
+		size_t begin, size_t end, std::vector<const RGBAImage*>& block_images) {
+	image_pool.reset();
+	for (size_t i = begin; i < end; i++) {
+		const TileGeometry::Block& block = geometry.blocks[i];
+		mc::BlockPos pos(block.x, block.z, block.y);
+		mc::ChunkPos chunk_pos(pos);
+		if (current_chunk == nullptr || current_chunk->getPos() != chunk_pos)
+			current_chunk = world->getChunk(chunk_pos);
+		block_images[i] = nullptr;
+		if (current_chunk != nullptr)
+			block_images[i] = getBlockImage(pos, block.id, block.data, block.extra_data,
+					current_chunk, image_pool);
+	}
+}
+
+bool IsometricTileRenderer::isWaterRun(const mc::BlockPos& pos, int count) {
+	mc::LocalBlockPos local(pos);
+	if (getRemainingRowBlocks(local) < count - 1 || pos.y - count + 1 < 0)
+		return false;
+	for (int i = 0; i < count; i++, local.x++, local.z--, local.y--) {
+		int height = current_chunk->getHighestBlock(local);
+		if (local.y > height || local.y <= height - current_chunk->getWaterDepth(local))
+			return false;
+		uint32_t& cached = surface_cache.get(*current_chunk, local);
+		if (!(cached & ChunkSurfaceCache::HIDDEN_KNOWN)) {
+			cached |= ChunkSurfaceCache::HIDDEN_KNOWN;
+			util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+			mc::BlockPos global = local.toGlobalPos(current_chunk->getPos());
+			if (render_mode->isHidden(global, current_chunk->getBlockID(local), 0))
+				cached |= ChunkSurfaceCache::HIDDEN;
+		}
+		if (cached & ChunkSurfaceCache::HIDDEN)
+			return false;
+	}
+	return true;
+}
+
+bool IsometricTileRenderer::isOccluder(const mc::BlockPos& pos) {
+	if (pos.y >= mc::CHUNK_HEIGHT * 16)
+		return false;
+	const mc::Chunk* chunk = world->getChunkOfBlock(pos, current_chunk);
+	if (chunk == nullptr)
+		return false;
+	mc::LocalBlockPos local(pos);
+	uint16_t id = chunk->getBlockID(local);
+	if (id == 0)
+		return false;
+	uint16_t data = chunk->getBlockData(local);
+
+	uint32_t& cached = surface_cache.get(*chunk, local);
+	if (!(cached & ChunkSurfaceCache::HIDDEN_KNOWN)) {
+		cached |= ChunkSurfaceCache::HIDDEN_KNOWN;
+		util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+		if (render_mode->isHidden(pos, id, data))
+			cached |= ChunkSurfaceCache::HIDDEN;
+	}
+	if (cached & ChunkSurfaceCache::HIDDEN)
+		return false;
+	if (!(cached & ChunkSurfaceCache::DATA_KNOWN))
+		cached |= ChunkSurfaceCache::DATA_KNOWN | checkNeighbors(pos, id, data);
+	return !images->isBlockTransparent(id, cached & 0xffff);
+}
+
+bool IsometricTileRenderer::isOccluded(const mc::BlockPos& pos) {
+	// the top face is covered by the block above, the side faces by the blocks in front
+	// of them, if one of these blocks is behind something else, this covers it as well
+	return isOccluder(pos + mc::DIR_TOP) && isOccluder(pos + mc::DIR_SOUTH)
+			&& isOccluder(pos + mc::DIR_WEST);
+}
+
+void IsometricTileRenderer::collectBlocks(const mc::BlockPos& origin,
+		std::vector<TopBlock>::const_iterator top_begin,
+		std::vector<TopBlock>::const_iterator top_end) {
+	util::ProfileScope profile(util::ProfileStage::BLOCK_ITERATION);
 	// get the maximum count of water blocks
 	// blitted about each over, until they are nearly opaque
 	int max_water = images->getMaxWaterPreblit();
 
-	// all visible blocks which are rendered in this tile
-	std::set<RenderBlock> blocks;
+	// all visible blocks which are rendered in this tile, the blocks of each block row
+	// are ordered from top to bottom
+	blocks.clear();
+	draw_order.clear();
+	image_pool.reset();
 
 	// iterate over the highest blocks in the tile
-	// we use as tile position tile_pos+tile_offset because the offset means that
-	// we treat the tile position as tile_pos, but it's actually tile_pos+tile_offset
-	for (TileTopBlockIterator it(tile_pos, block_size, tile_width);
-			!it.end(); it.next()) {
+	for (auto it = top_begin; it != top_end; ++it) {
+		mc::BlockPos row_top = origin + it->offset;
 		// water render behavior n1:
 		// are we already in a row of water?
 		bool in_water = false;
@@ -169,11 +539,11 @@ void IsometricTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile)
 		// water counter, how many water blocks are at the moment in this row?
 		int water = 0;
 
-		// the render block objects in our current block row
-		std::set<RenderBlock> row_nodes;
+		// the render blocks of our current block row start here
+		size_t row_start = blocks.size();
 		// then iterate over the blocks, which are on the tile at the same position,
 		// beginning from the highest block
-		for (BlockRowIterator block(it.current); !block.end(); block.next()) {
+		for (BlockRowIterator block(row_top); !block.end(); block.next()) {
 			// get current chunk position
 			mc::ChunkPos current_chunk_pos(block.current);
 
@@ -184,15 +554,40 @@ void IsometricTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile)
 				//if (!state.world->hasChunkSection(current_chunk, block.current.y))
 				//	continue;
 				current_chunk = world->getChunk(current_chunk_pos);
+			// get local block position
+			mc::LocalBlockPos local(block.current);
+
 			if (current_chunk == nullptr) {
 				// here is nothing (= air),
 				// so reset state if we are in water
+				// and skip the blocks of the row in this chunk
 				in_water = false;
+				block.skip(getRemainingRowBlocks(local));
 				continue;
 			}
 
-			// get local block position
-			mc::LocalBlockPos local(block.current);
+			// the blocks above the highest block of the chunk are air, so skip the
+			// blocks of the row until it leaves the chunk or reaches the highest block
+			int highest_block = current_chunk->getHighestBlock();
+			if (block.current.y > highest_block) {
+				block.skip(std::min(getRemainingRowBlocks(local),
+						block.current.y - highest_block - 1));
+				in_water = false;
+				continue;
+			}
+			// the same for missing sections and sections with only air, until the row
+			// leaves the chunk or reaches the section below
+			int section = block.current.y / 16;
+			if (!current_chunk->hasSection(section) || current_chunk->isSectionAir(section)) {
+				block.skip(std::min(getRemainingRowBlocks(local), block.current.y % 16));
+				in_water = false;
+				continue;
+			}
+			// the same for the highest block of this column
+			if (block.current.y > current_chunk->getHighestBlock(local)) {
+				in_water = false;
+				continue;
+			}
 
 			// get block id
 			uint16_t id = current_chunk->getBlockID(local);
@@ -202,16 +597,28 @@ void IsometricTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile)
 				in_water = false;
 				continue;
 			}
+			BlockSample sample(id);
 
 			// get the data and extra data
 			uint16_t data = current_chunk->getBlockData(local);
 			uint16_t extra_data = current_chunk->getBlockExtraData(local, id);
 
-			// check if the render mode hides this block
-			if (render_mode->isHidden(block.current, id, data))
+			// check if the render mode hides this block, this and the block data after
+			// checking the neighbors are cached for the other tiles with this block
+			uint32_t& cached = surface_cache.get(*current_chunk, local);
+			if (!(cached & ChunkSurfaceCache::HIDDEN_KNOWN)) {
+				cached |= ChunkSurfaceCache::HIDDEN_KNOWN;
+				util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+				if (render_mode->isHidden(block.current, id, data))
+					cached |= ChunkSurfaceCache::HIDDEN;
+			}
+			if (cached & ChunkSurfaceCache::HIDDEN) {
+				BlockProfiler::addPath(BlockPath::HIDDEN);
 				continue;
+			}
 
 			bool is_water = (id == 8 || id == 9) && data == 0;
+			int water_skip = 0;
 			if (is_water && !use_preblit_water) {
 				// water render behavior n1:
 				// render only the top sides of the water blocks
@@ -242,48 +649,40 @@ void IsometricTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile)
 					// we can stop searching more blocks
 					// and replace the already added render blocks with a preblit water block
 					if (water > max_water) {
-						std::set<RenderBlock>::const_iterator it = row_nodes.begin();
-						// iterate through the render blocks in this row
-						while (it != row_nodes.end()) {
-							std::set<RenderBlock>::const_iterator current = it++;
-							// check if we have reached the top most water block
-							if (it == row_nodes.end() || (it->id != 8 && it->id != 9)) {
-								RenderBlock top = *current;
-								row_nodes.erase(current);
-
-								// check for neighbors
-								mc::Block south, west;
-								south = getBlock(top.pos + mc::DIR_SOUTH);
-								west = getBlock(top.pos + mc::DIR_WEST);
-
-								id = 8;
-								data = OPAQUE_WATER;
-								bool neighbor_south = !south.isFullWater();
-								if (neighbor_south)
-								//	data |= DATA_SOUTH;
-									data |= OPAQUE_WATER_SOUTH;
-								bool neighbor_west = !west.isFullWater();
-								if (neighbor_west)
-								//	data |= DATA_WEST;
-									data |= OPAQUE_WATER_WEST;
-
-								// get image and replace the old render block with this
-								//top.image = images->getOpaqueWater(neighbor_south,
-								//		neighbor_west);
-								top.image = images->getBlock(id, data, extra_data);
-
-								// don't forget the render mode
-								render_mode->draw(top.image, top.pos, id, data);
-
-								row_nodes.insert(top);
-								break;
-
-							} else {
-								// water render block
-								row_nodes.erase(current);
-							}
-						}
-
+						// remove the water blocks at the bottom of the row, except the
+						// top most one, which is replaced with a preblit water block
+						if (blocks.size() == row_start)
+							break;
+						while (blocks.size() > row_start + 1
+								&& isWater(blocks[blocks.size() - 2].id))
+							blocks.pop_back();
+						RenderBlock& top = blocks.back();
+						BlockProfiler::addPath(BlockPath::PREBLIT_WATER);
+
+						// check for neighbors
+						mc::Block south, west;
+						south = getBlock(top.pos + mc::DIR_SOUTH);
+						west = getBlock(top.pos + mc::DIR_WEST);
+
+						id = 8;
+						data = OPAQUE_WATER;
+						bool neighbor_south = !south.isFullWater();
+						if (neighbor_south)
+						//	data |= DATA_SOUTH;
+							data |= OPAQUE_WATER_SOUTH;
+						bool neighbor_west = !west.isFullWater();
+						if (neighbor_west)
+						//	data |= DATA_WEST;
+							data |= OPAQUE_WATER_WEST;
+
+						// get image and replace the old render block with this
+						//top.image = images->getOpaqueWater(neighbor_south,
+						//		neighbor_west);
+						top.id = id;
+						top.data = data;
+						top.extra_data = extra_data;
+						top.image = getBlockImage(top.pos, id, data, extra_data,
+								current_chunk, image_pool);
 						break;
 					}
 				}
@@ -291,58 +690,64 @@ void IsometricTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile)
 
 			// check for special data (neighbor related)
 			// get block image, check for transparency, create render block...
-			data = checkNeighbors(block.current, id, data);
+			if (!(cached & ChunkSurfaceCache::DATA_KNOWN))
+				cached |= ChunkSurfaceCache::DATA_KNOWN
+						| checkNeighbors(block.current, id, data);
+			if ((cached & 0xffff) != data)
+				BlockProfiler::addPath(BlockPath::NEIGHBORS);
+			data = cached & 0xffff;
+
+			// the water blocks of deep water are replaced with a preblit water block
+			// anyway, if the water depths of the columns show that there is enough water,
+			// the blocks between the top most one and the one which triggers the
+			// replacement are skipped
+			if (use_preblit_water && water == 1 && max_water > 0
+					&& isWaterRun(block.current, max_water + 1)) {
+				water = max_water;
+				water_skip = max_water - 1;
+			}
 			//if (is_water && (data & DATA_WEST) && (data & DATA_SOUTH))
 			//	continue;
-			RGBAImage image;
 			bool transparent = images->isBlockTransparent(id, data);
 
-			// check for biome data
-			if (Biome::isBiomeBlock(id, data))
-				image = images->getBiomeBlock(id, data, getBiomeOfBlock(block.current, current_chunk), extra_data);
-			else
-				image = images->getBlock(id, data, extra_data);
+			// skip unnecessary leaves (below leaves of the same type) before their
+			// images are created
+			if (id == 18 && blocks.size() > row_start && blocks.back().id == 18
+					&& (blocks.back().data & 3) == (data & 3)) {
+				if (!transparent)
+					break;
+				continue;
+			}
+
+			// opaque blocks which are completely covered by their neighbors in front of
+			// them are not drawn, and they hide the rest of the block row
+			if (!transparent && isOccluded(block.current))
+				break;
 
-			RenderBlock node;
-			node.x = it.draw_x;
-			node.y = it.draw_y;
+			blocks.emplace_back();
+			RenderBlock& node = blocks.back();
+			node.x = it->draw_x;
+			node.y = it->draw_y;
 			node.pos = block.current;
-			node.image = image;
 			node.id = id;
 			node.data = data;
+			node.extra_data = extra_data;
 
-			// let the render mode do their magic with the block image
-			render_mode->draw(node.image, node.pos, id, data);
-
-			// insert into current row
-			row_nodes.insert(node);
+			// get the block image (with biome data), and let the render mode do their
+			// magic with it
+			node.image = getBlockImage(block.current, id, data, extra_data, current_chunk,
+					image_pool);
+			sample.addBlit();
 
 			// if this block is not transparent, then break
 			if (!transparent)
 				break;
+			block.skip(water_skip);
 		}
 
-		// iterate through the created render blocks
-		for (std::set<RenderBlock>::const_iterator it = row_nodes.begin();
-		        it != row_nodes.end(); ++it) {
-			std::set<RenderBlock>::const_iterator next = it;
-			next++;
-			// insert render block to
-			if (next == row_nodes.end()) {
-				blocks.insert(*it);
-			} else {
-				// skip unnecessary leaves
-				if (it->id == 18 && next->id == 18 && (next->data & 3) == (it->data & 3))
-					continue;
-				blocks.insert(*it);
-			}
-		}
-	}
-
-	// now blit all blocks
-	for (std::set<RenderBlock>::const_iterator it = blocks.begin(); it != blocks.end();
-			++it) {
-		tile.alphaBlit(it->image, it->x, it->y);
+		// add the created render blocks to the drawing order
+		for (size_t i = row_start; i < blocks.size(); i++)
+			draw_order.push_back(std::make_pair(getDrawKey(blocks[i].pos, origin), i));
 	}
 }
 
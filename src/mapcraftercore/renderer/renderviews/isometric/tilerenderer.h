@@ -22,7 +22,11 @@
 
 #include "../../image.h"
 #include "../../tilerenderer.h"
+#include "../../../mc/chunk.h"
+#include "../../../mc/pos.h"
 
+#include <utility>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -62,6 +66,8 @@ public:
 	~BlockRowIterator();
 
 	void next();
+	// skips the next blocks, the same as calling next() the specified count of times
+	void skip(int blocks);
 	bool end() const;
 
 	mc::BlockPos current;
@@ -75,13 +81,53 @@ struct RenderBlock {
 	// drawing position in pixels on the tile
 	int x, y;
 	bool transparent;
-	RGBAImage image;
+	// the cached block image or a modified copy of it, see TileRenderer::getBlockImage
+	const RGBAImage* image;
 	mc::BlockPos pos;
-	uint8_t id, data;
+	uint16_t id, data, extra_data;
 
 	bool operator<(const RenderBlock& other) const;
 };
 
+/**
+ * Caches per block of recently rendered chunks whether the render mode hides the block
+ * and the block data after checking the neighbors. The tiles of the isometric view
+ * overlap, so the blocks at the borders of the tiles are visited by several tiles.
+ * The blocks of a chunk are invalidated when the chunk is reloaded, see
+ * mc::Chunk::getRevision().
+ */
+class ChunkSurfaceCache {
+public:
+	// flags of the cached values, the lower 16 bits are the checked block data
+	static const uint32_t HIDDEN_KNOWN = 1u << 31;
+	static const uint32_t HIDDEN = 1u << 30;
+	static const uint32_t DATA_KNOWN = 1u << 29;
+
+	ChunkSurfaceCache();
+
+	/**
+	 * Returns the cached value of a block of a chunk, it is 0 if nothing is known yet.
+	 * The reference is valid until the next call.
+	 */
+	uint32_t& get(const mc::Chunk& chunk, const mc::LocalBlockPos& pos);
+
+private:
+	// the chunks are mapped to the entries by their position (16x16 chunks)
+	static const int SIZE = 256;
+
+	struct Entry {
+		Entry();
+
+		mc::ChunkPos pos;
+		uint64_t revision;
+		// the values of the blocks of each section, allocated when needed
+		std::vector<uint32_t> sections[mc::CHUNK_HEIGHT];
+	};
+
+	std::vector<Entry> entries;
+	Entry* current;
+};
+
 /**
  * Renders tiles from world data.
  */
@@ -91,9 +137,143 @@ public:
 			int tile_width, mc::WorldCache* world, RenderMode* render_mode);
 	virtual ~IsometricTileRenderer();
 
+	/**
+	 * Sets whether the blocks are drawn from front to back (blended under the already
+	 * drawn blocks) instead of from back to front. The pixels which are already opaque
+	 * are skipped then, but the colors are slightly different because of rounding.
+	 */
+	void setFrontToBack(bool front_to_back);
+
 	virtual void renderTile(const TilePos& tile_pos, RGBAImage& tile);
 
+	/**
+	 * The geometry of a tile depends on the tile width, the block size, the
+	 * transparency of the block images and the water rendering options.
+	 */
+	virtual bool getGeometryKey(uint64_t& key) const;
+	virtual void renderTileGeometry(const TilePos& tile_pos, RGBAImage& tile,
+			TileGeometry& geometry);
+	virtual void renderTileFromGeometry(const TilePos& tile_pos,
+			const TileGeometry& geometry, RGBAImage& tile);
+
+	/**
+	 * Renders the rectangle of the tile the changed chunks (and the blocks next to them)
+	 * are drawn to, with all block rows drawn into it. The pixels of the rectangle are
+	 * the same as the ones of the completely rendered tile.
+	 */
+	virtual bool renderTilePartially(const TilePos& tile_pos,
+			const std::vector<mc::ChunkPos>& changed_chunks, RGBAImage& tile);
+
 	virtual int getTileSize() const;
+
+private:
+	/**
+	 * A top block of a tile (see TileTopBlockIterator) relative to the first top block
+	 * of the tile, and its drawing position.
+	 */
+	struct TopBlock {
+		mc::BlockPos offset;
+		int draw_x, draw_y;
+	};
+
+	// the top blocks of the tiles, they are the same for every tile (relative to the
+	// first top block) and depend only on the tile width and the block size, ordered
+	// by their columns
+	std::vector<TopBlock> top_blocks;
+	int top_blocks_size;
+	// the top blocks drawn into the rectangle of a partially rendered tile
+	std::vector<TopBlock> partial_top_blocks;
+
+	/**
+	 * Creates the top blocks if they aren't created for the block size yet.
+	 */
+	void initializeTopBlocks(const TilePos& tile_pos, int block_size);
+
+	/**
+	 * Collects and draws the blocks of the block rows of some top blocks onto an image
+	 * (transparent before) whose top left corner is the specified position in the tile.
+	 * The blocks are collected by the part renderers too if there are some. The drawn
+	 * blocks are recorded in the geometry of the tile if one is supplied.
+	 */
+	void drawBlocks(const mc::BlockPos& origin, const std::vector<TopBlock>& tops,
+			RGBAImage& image, int x, int y, TileGeometry* geometry = nullptr);
+
+	/**
+	 * A block image drawn at a position of an image, see compositeBlocks.
+	 */
+	struct DrawnBlock {
+		const RGBAImage* image;
+		int x, y;
+	};
+
+	/**
+	 * Draws block images in drawing order onto an image (transparent before) with
+	 * premultiplied alpha, and converts the image to straight alpha afterwards. With part
+	 * renderers, the image is split into bands of rows which are drawn concurrently, each
+	 * one with the blocks overlapping it. Every pixel is still blended with the same
+	 * blocks in the same order, so the image is the same as the one drawn by one thread.
+	 */
+	void compositeBlocks(const std::vector<DrawnBlock>& drawn, RGBAImage& image);
+
+	/**
+	 * Records a render block in the geometry of a tile.
+	 */
+	static void recordBlock(const RenderBlock& block, TileGeometry& geometry);
+
+	/**
+	 * Creates the images of some blocks of the geometry of a tile (with the render
+	 * mode), the image of a block is nullptr if its chunk doesn't exist anymore.
+	 */
+	void createGeometryImages(const TileGeometry& geometry, size_t begin, size_t end,
+			std::vector<const RGBAImage*>& block_images);
+
+	/**
+	 * Collects the render blocks of the block rows of some top blocks of a tile and
+	 * their draw keys, the ones of the last call are discarded.
+	 */
+	void collectBlocks(const mc::BlockPos& origin,
+			std::vector<TopBlock>::const_iterator top_begin,
+			std::vector<TopBlock>::const_iterator top_end);
+
+	/**
+	 * Returns whether the next count blocks of a block row (beginning with the
+	 * given block) are in the current chunk, are full water blocks at the top of their
+	 * columns (see mc::Chunk::getWaterDepth) and are not hidden by the render mode.
+	 */
+	bool isWaterRun(const mc::BlockPos& pos, int count);
+
+	/**
+	 * Returns whether a block is an opaque block which is not hidden by the render mode,
+	 * its image covers the faces of the blocks behind it completely.
+	 */
+	bool isOccluder(const mc::BlockPos& pos);
+
+	/**
+	 * Returns whether the visible faces (top, south and west) of a block are covered by
+	 * the opaque blocks next to them, the block doesn't need to be drawn then.
+	 */
+	bool isOccluded(const mc::BlockPos& pos);
+
+	// the render blocks of the current tile (ordered by block rows) and their draw
+	// keys with their indexes in the render blocks, kept to reuse the memory
+	std::vector<RenderBlock> blocks;
+	std::vector<std::pair<uint64_t, uint32_t>> draw_order;
+	// the render blocks of the part renderers with their draw keys, see renderTile
+	std::vector<std::pair<uint64_t, const RenderBlock*>> merged_draw_order;
+	// whether the blocks are drawn from front to back, and then the counts of the opaque
+	// pixels of the rows of the tile
+	bool front_to_back;
+	std::vector<int> row_coverage;
+	// the blocks of the current tile in drawing order, see compositeBlocks
+	std::vector<DrawnBlock> drawn_blocks;
+	// the image of the rectangle of a partially rendered tile
+	RGBAImage partial_image;
+	// the images of the blocks of a tile rendered from its geometry
+	std::vector<const RGBAImage*> geometry_images;
+	// the modified block images of the render blocks
+	ImagePool image_pool;
+	// the cached per-block data of the visited chunks
+	ChunkSurfaceCache surface_cache;
 };
 
 }
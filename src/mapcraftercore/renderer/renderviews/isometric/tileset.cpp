@@ -73,5 +73,24 @@ void IsometricTileSet::mapChunkToTiles(const mc::ChunkPos& chunk,
 		addRowColTiles(row + 2*i, col, getTileWidth(), tiles);
 }
 
+void IsometricTileSet::mapTileToChunks(const TilePos& tile,
+		std::set<mc::ChunkPos>& chunks) {
+	// the inverse of mapChunkToTiles: a chunk is mapped to the tiles which cover the
+	// columns [2*tile_width*x, 2*tile_width*(x+1)] and the rows [4*tile_width*y,
+	// 4*tile_width*(y+1)] of the tops of its sections (rows row, row+2, ...,
+	// row+2*CHUNK_HEIGHT), so a tile covers exactly the chunks with a column in the
+	// columns of the tile and a row at most 2*CHUNK_HEIGHT rows above the rows of the
+	// tile, since the rows of the tile are too many to be skipped by the sections
+	int tile_width = getTileWidth();
+	int col_min = 2 * tile_width * tile.getX();
+	int col_max = 2 * tile_width * (tile.getX() + 1);
+	int row_min = 4 * tile_width * tile.getY() - 2 * mc::CHUNK_HEIGHT;
+	int row_max = 4 * tile_width * (tile.getY() + 1);
+	for (int col = col_min; col <= col_max; col++)
+		// row and column have the same parity (row + col = 2 * chunk z)
+		for (int row = row_min + ((row_min + col) & 1); row <= row_max; row += 2)
+			chunks.insert(mc::ChunkPos::byRowCol(row, col));
+}
+
 }
 }
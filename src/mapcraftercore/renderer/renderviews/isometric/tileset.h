@@ -30,6 +30,7 @@ public:
 	IsometricTileSet(int tile_width);
 
 	virtual void mapChunkToTiles(const mc::ChunkPos& chunk, std::set<TilePos>& tiles);
+	virtual void mapTileToChunks(const TilePos& tile, std::set<mc::ChunkPos>& chunks);
 };
 
 }
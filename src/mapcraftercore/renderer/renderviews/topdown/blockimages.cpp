@@ -22,6 +22,9 @@
 #include "../../biomes.h"
 #include "../../../util.h"
 
+#include <utility>
+#include <vector>
+
 namespace mapcrafter {
 namespace renderer {
 
@@ -39,6 +42,10 @@ int TopdownBlockImages::getBlockSize() const {
 	return texture_size;
 }
 
+std::string TopdownBlockImages::getCacheKey(const TextureResources& resources) const {
+	return AbstractBlockImages::getCacheKey(resources) + " topdown";
+}
+
 void TopdownBlockImages::createItemStyleBlock(uint16_t id, uint16_t data,
 		const RGBAImage& texture) {
 	// call parent method because we don't want to rotate the texture
@@ -53,11 +60,11 @@ void blitSideFace(RGBAImage& block, int face, const RGBAImage& texture) {
 	RGBAImage top = texture;
 	top.fill(0, 0, w, texture.getWidth(), texture.getWidth());
 	if (face == FACE_SOUTH)
-		top = top.rotate(2);
+		top = std::move(top).rotate(2);
 	else if (face == FACE_EAST)
-		top = top.rotate(1);
+		top = std::move(top).rotate(1);
 	else if (face == FACE_WEST)
-		top = top.rotate(3);
+		top = std::move(top).rotate(3);
 	block.alphaBlit(top, 0, 0);
 }
 
@@ -183,7 +190,7 @@ void TopdownBlockImages::createPistonExtension() { // id 34
 	
 	// the extension is the connection moved a little + the piston side head
 	RGBAImage extension = getPistonConnection(textures.PISTON_SIDE);
-	extension = extension.move(0, texture_size / 4);
+	extension = std::move(extension).move(0, texture_size / 4);
 	extension.alphaBlit(getPistonHead(textures.PISTON_SIDE), 0, 0);
 
 	setBlockImage(34, 0, front);
@@ -440,8 +447,8 @@ void TopdownBlockImages::createRedstoneWire(uint16_t id, uint16_t extra_data, ui
 	redstone_cross.simpleAlphaBlit(redstone_line.rotate(1), 0, 0);
 
 	//uint8_t color = powered ? 50 : 255;
-	redstone_cross = redstone_cross.colorize(r, g, b);
-	redstone_line = redstone_line.colorize(r, g, b);
+	redstone_cross = std::move(redstone_cross).colorize(r, g, b);
+	redstone_line = std::move(redstone_line).colorize(r, g, b);
 
 	// 1/16 of the texture size
 	double s = (double) texture_size / 16;
@@ -515,7 +522,7 @@ void TopdownBlockImages::createDoor(uint16_t id, const RGBAImage& texture_bottom
 			for (int d = 0; d < 4; d++) {
 				RGBAImage texture = (top ? texture_top : texture_bottom);
 				if (flip_x)
-					texture = texture.flip(true, false);
+					texture = std::move(texture).flip(true, false);
 
 				uint16_t direction = 0;
 				int face = 0;
@@ -571,11 +578,11 @@ void TopdownBlockImages::createLever() { // id 69
 	RGBAImage cobble = textures.COBBLESTONE;
 	RGBAImage lever_side(texture_size, texture_size), lever_top = lever_side, lever_bottom = lever_side;
 	lever_side.alphaBlit(textures.LEVER.rotate(2).move(0, -texture_size / 16.0*3.0), 0, 0);
-	lever_side.alphaBlit(cobble.clip(0, 0, w, t), (texture_size - w) / 2, 0);
-	lever_top.alphaBlit(cobble.clip(0, 0, w, h), (texture_size - w) / 2, (texture_size - h) / 2);
+	lever_side.alphaBlit(cobble.view(0, 0, w, t), (texture_size - w) / 2, 0);
+	lever_top.alphaBlit(cobble.view(0, 0, w, h), (texture_size - w) / 2, (texture_size - h) / 2);
 	lever_top.alphaBlit(textures.LEVER.move(0, -texture_size / 16.0*6.0), 0, 0);
 	lever_bottom.alphaBlit(textures.LEVER.move(0, -texture_size / 16.0*6.0), 0, 0);
-	lever_bottom.alphaBlit(cobble.clip(0, 0, w, h), (texture_size - w) / 2, (texture_size - h) / 2);
+	lever_bottom.alphaBlit(cobble.view(0, 0, w, h), (texture_size - w) / 2, (texture_size - h) / 2);
 
 	setBlockImage(69, 0, lever_bottom.rotate(1));
 	setBlockImage(69, 1, lever_side.rotate(3));
@@ -603,10 +610,10 @@ void TopdownBlockImages::createButton(uint16_t id, const RGBAImage& texture) { /
 	int h = std::max(4.0, std::ceil((double) texture_size / 4.0)); // 4px
 
 	RGBAImage button_side(texture_size, texture_size), button_top = button_side;
-	button_side.alphaBlit(texture.clip(0, 0, w, t), (texture_size - w) / 2, 0);
-	button_side = button_side.colorize(1.1, 1.1, 1.1);
-	button_top.alphaBlit(texture.clip(0, 0, w, h), (texture_size - w) / 2, (texture_size - h) / 2);
-	button_top = button_top.colorize(1.1, 1.1, 1.1);
+	button_side.alphaBlit(texture.view(0, 0, w, t), (texture_size - w) / 2, 0);
+	button_side = std::move(button_side).colorize(1.1, 1.1, 1.1);
+	button_top.alphaBlit(texture.view(0, 0, w, h), (texture_size - w) / 2, (texture_size - h) / 2);
+	button_top = std::move(button_top).colorize(1.1, 1.1, 1.1);
 	
 	setBlockImage(id, 0, button_top);
 	setBlockImage(id, 1, button_side.rotate(3));
@@ -1032,20 +1039,21 @@ RGBAImage TopdownBlockImages::createUnknownBlock() const {
 	return unknown_block;
 }
 
-RGBAImage TopdownBlockImages::createBiomeBlock(uint16_t id, uint16_t data,
-		const Biome& biome) const {if (!block_images.count(id | (data << 16)))
-			return unknown_block;
-	uint32_t color;
+uint32_t TopdownBlockImages::getBiomeColor(uint16_t id, uint16_t data,
+		const BiomeColors& colors) const {
 	// leaves have the foliage colors
 	// for birches, the color x/y coordinate is flipped
 	if (id == 18)
-		color = biome.getColor(resources.getGrassColors(), (data & 0b11) == 2);
-	else
-		color = biome.getColor(resources.getFoliageColors(), false);
+		return (data & 0b11) == 2 ? colors.grass_flipped : colors.grass;
+	return colors.foliage;
+}
 
-	double r = (double) rgba_red(color) / 255;
-	double g = (double) rgba_green(color) / 255;
-	double b = (double) rgba_blue(color) / 255;
+RGBAImage TopdownBlockImages::createBiomeBlock(uint16_t id, uint16_t data,
+		uint32_t color) const {if (!block_images.count(id | (data << 16)))
+			return unknown_block;
+	uint8_t r = rgba_red(color);
+	uint8_t g = rgba_green(color);
+	uint8_t b = rgba_blue(color);
 
 	/*
 	// grass block needs something special
@@ -1074,651 +1082,670 @@ void TopdownBlockImages::createBlocks() {
 	const BlockTextures& t = resources.getBlockTextures();
 	RGBAImage water = t.WATER_STILL.colorize(0, 0.39, 0.89);
 
-	setBlockImage(1, 0, t.STONE);
-	setBlockImage(1, 1, t.STONE_GRANITE); // granite
-	setBlockImage(1, 2, t.STONE_GRANITE_SMOOTH); // polished granite
-	setBlockImage(1, 3, t.STONE_DIORITE); // diorite
-	setBlockImage(1, 4, t.STONE_DIORITE_SMOOTH); // polished diorite
-	setBlockImage(1, 5, t.STONE_ANDESITE); // andesite
-	setBlockImage(1, 6, t.STONE_ANDESITE_SMOOTH); // polished andesite
-	setBlockImage(2, 0, t.GRASS_TOP);
-	setBlockImage(3, 0, t.DIRT);
-	setBlockImage(3, 1, t.DIRT);
-	setBlockImage(3, 2, t.DIRT_PODZOL_TOP);
-	setBlockImage(4, 0, t.COBBLESTONE); // cobblestone
-	// -- wooden planks
-	setBlockImage(5, 0, t.PLANKS_OAK); // oak
-	setBlockImage(5, 1, t.PLANKS_SPRUCE); // pine/spruce
-	setBlockImage(5, 2, t.PLANKS_BIRCH); // birch
-	setBlockImage(5, 3, t.PLANKS_JUNGLE); // jungle
-	setBlockImage(5, 4, t.PLANKS_ACACIA); // acacia
-	setBlockImage(5, 5, t.PLANKS_BIG_OAK); // dark oak
-	// --
-	// -- saplings
-	createItemStyleBlock(6, 0, t.SAPLING_OAK); // oak
-	createItemStyleBlock(6, 1, t.SAPLING_SPRUCE); // spruce
-	createItemStyleBlock(6, 2, t.SAPLING_BIRCH); // birch
-	createItemStyleBlock(6, 3, t.SAPLING_JUNGLE); // jungle
-	createItemStyleBlock(6, 4, t.SAPLING_ACACIA); // acacia
-	createItemStyleBlock(6, 5, t.SAPLING_ROOFED_OAK); // dark oak
-	// --
-	setBlockImage(7, 0, t.BEDROCK); // bedrock
-	setBlockImage(8, 0, water);
-	setBlockImage(9, 0, water);
-	setBlockImage(10, 0, t.LAVA_STILL);
-	setBlockImage(11, 0, t.LAVA_STILL);
-	setBlockImage(12, 0, t.SAND); // sand
-	setBlockImage(12, 1, t.RED_SAND); // red sand
-	setBlockImage(13, 0, t.GRAVEL); // gravel
-	setBlockImage(14, 0, t.GOLD_ORE); // gold ore
-	setBlockImage(15, 0, t.IRON_ORE); // iron ore
-	setBlockImage(16, 0, t.COAL_ORE); // coal ore
-	// -- wood
-	createWood(17, 0, t.LOG_OAK, t.LOG_OAK_TOP); // oak
-	createWood(17, 1, t.LOG_SPRUCE, t.LOG_SPRUCE_TOP); // pine/spruce
-	createWood(17, 2, t.LOG_BIRCH, t.LOG_BIRCH_TOP); // birch
-	createWood(17, 3, t.LOG_JUNGLE, t.LOG_JUNGLE_TOP); // jungle
-	// --
-	setBlockImage(18, 0, t.LEAVES_OAK); // oak
-	setBlockImage(18, 1, t.LEAVES_SPRUCE); // pine/spruce
-	setBlockImage(18, 2, t.LEAVES_OAK); // birch
-	setBlockImage(18, 3, t.LEAVES_JUNGLE); // jungle
-	setBlockImage(19, 0, t.SPONGE); // sponge
-	setBlockImage(19, 1, t.SPONGE_WET); // wet sponge
-	setBlockImage(20, 0, t.GLASS);
-	setBlockImage(21, 0, t.LAPIS_ORE); // lapis lazuli ore
-	setBlockImage(22, 0, t.LAPIS_BLOCK); // lapis lazuli block
-	createDispenserDropper(23, t.DISPENSER_FRONT_HORIZONTAL); // dispenser
-	setBlockImage(24, 0, t.SANDSTONE_TOP); // sandstone
-	setBlockImage(25, 0, t.NOTEBLOCK); // noteblock
-	createBed(resources.getBedTextures()); // id 26 // bed
-	createStraightRails(27, 0, t.RAIL_GOLDEN); // powered rail (unpowered)
-	createStraightRails(27, 8, t.RAIL_GOLDEN_POWERED); // powered rail (powered);
-	createStraightRails(28, 0, t.RAIL_ACTIVATOR); // detector rail
-	createPiston(29, true); // sticky piston
-	createItemStyleBlock(30, 0, t.WEB); // cobweb
-	// -- tall grass
-	createItemStyleBlock(31, 0, t.DEADBUSH); // dead bush style
-	createItemStyleBlock(31, 1, t.TALLGRASS); // tall grass
-	createItemStyleBlock(31, 2, t.FERN); // fern
-	// --
-	createItemStyleBlock(32, 0, t.DEADBUSH); // dead bush
-	createPiston(33, false); // piston
-	createPistonExtension(); // id 34 // piston extension
-	// -- wool
-	setBlockImage(35, 0, t.WOOL_COLORED_WHITE); // white
-	setBlockImage(35, 1, t.WOOL_COLORED_ORANGE); // orange
-	setBlockImage(35, 2, t.WOOL_COLORED_MAGENTA); // magenta
-	setBlockImage(35, 3, t.WOOL_COLORED_LIGHT_BLUE); // light blue
-	setBlockImage(35, 4, t.WOOL_COLORED_YELLOW); // yellow
-	setBlockImage(35, 5, t.WOOL_COLORED_LIME); // lime
-	setBlockImage(35, 6, t.WOOL_COLORED_PINK); // pink
-	setBlockImage(35, 7, t.WOOL_COLORED_GRAY); // gray
-	setBlockImage(35, 8, t.WOOL_COLORED_SILVER); // light gray
-	setBlockImage(35, 9, t.WOOL_COLORED_CYAN); // cyan
-	setBlockImage(35, 10, t.WOOL_COLORED_PURPLE); // purple
-	setBlockImage(35, 11, t.WOOL_COLORED_BLUE); // blue
-	setBlockImage(35, 12, t.WOOL_COLORED_BROWN); // brown
-	setBlockImage(35, 13, t.WOOL_COLORED_GREEN); // green
-	setBlockImage(35, 14, t.WOOL_COLORED_RED); // red
-	setBlockImage(35, 15, t.WOOL_COLORED_BLACK); // black
-	// --
-	setBlockImage(36, 0, empty_texture); // block moved by piston aka 'block 36'
-	createItemStyleBlock(37, 0, t.FLOWER_DANDELION); // dandelion
-	// -- poppy -- different flowers
-	createItemStyleBlock(38, 0, t.FLOWER_ROSE); // poppy
-	createItemStyleBlock(38, 1, t.FLOWER_BLUE_ORCHID); // blue orchid
-	createItemStyleBlock(38, 2, t.FLOWER_ALLIUM); // azure bluet
-	createItemStyleBlock(38, 3, t.FLOWER_HOUSTONIA); //
-	createItemStyleBlock(38, 4, t.FLOWER_TULIP_RED); // red tulip
-	createItemStyleBlock(38, 5, t.FLOWER_TULIP_ORANGE); // orange tulip
-	createItemStyleBlock(38, 6, t.FLOWER_TULIP_WHITE); // white tulip
-	createItemStyleBlock(38, 7, t.FLOWER_TULIP_PINK); // pink tulip
-	createItemStyleBlock(38, 8, t.FLOWER_OXEYE_DAISY); // oxeye daisy
-	// --
-	setBlockImage(39, 0, t.MUSHROOM_BROWN); // brown mushroom
-	setBlockImage(40, 0, t.MUSHROOM_RED); // red mushroom
-	setBlockImage(41, 0, t.GOLD_BLOCK); // block of gold
-	setBlockImage(42, 0, t.IRON_BLOCK); // block of iron
-	// double stone slabs --
-	setBlockImage(43, 0, t.STONE_SLAB_TOP);
-	setBlockImage(43, 1, t.SANDSTONE_TOP);
-	setBlockImage(43, 2, t.PLANKS_OAK);
-	setBlockImage(43, 3, t.COBBLESTONE);
-	setBlockImage(43, 4, t.BRICK);
-	setBlockImage(43, 5, t.STONEBRICK);
-	setBlockImage(43, 6, t.NETHER_BRICK);
-	setBlockImage(43, 7, t.QUARTZ_BLOCK_SIDE);
-	// --
-	// normal stone slabs --
-	setBlockImage(44, 0, t.STONE_SLAB_TOP);
-	setBlockImage(44, 1, t.SANDSTONE_TOP);
-	setBlockImage(44, 2, t.PLANKS_OAK);
-	setBlockImage(44, 3, t.COBBLESTONE);
-	setBlockImage(44, 4, t.BRICK);
-	setBlockImage(44, 5, t.STONEBRICK);
-	setBlockImage(44, 6, t.NETHER_BRICK);
-	setBlockImage(44, 7, t.QUARTZ_BLOCK_SIDE);
-	// --
-	setBlockImage(45, 0, t.BRICK); // bricks
-	setBlockImage(46, 0, t.TNT_TOP); // tnt
-	setBlockImage(47, 0, t.PLANKS_OAK); // bookshelf
-	setBlockImage(48, 0, t.COBBLESTONE_MOSSY); // moss stone
-	setBlockImage(49, 0, t.OBSIDIAN); // obsidian
-	createTorch(50, t.TORCH_ON); // torch
-	createItemStyleBlock(51, 0, t.FIRE_LAYER_0); // fire
-	setBlockImage(52, 0, t.MOB_SPAWNER); // monster spawner
-	createStairs(53, t.PLANKS_OAK); // oak wood stairs
-	createChest(54, resources.getNormalChest()); // chest
-	createDoubleChest(54, resources.getNormalDoubleChest()); // chest
-	createRedstoneWire(55, 0, 48, 0, 0); // redstone wire not powered
-	createRedstoneWire(55, REDSTONE_POWERED, 192, 0, 0); // redstone wire powered
-	setBlockImage(56, 0, t.DIAMOND_ORE); // diamond ore
-	setBlockImage(57, 0, t.DIAMOND_BLOCK); // block of diamond
-	setBlockImage(58, 0, t.CRAFTING_TABLE_TOP); // crafting table
-	// -- wheat
-	createItemStyleBlock(59, 0, t.WHEAT_STAGE_0); //
-	createItemStyleBlock(59, 1, t.WHEAT_STAGE_1); //
-	createItemStyleBlock(59, 2, t.WHEAT_STAGE_2); //
-	createItemStyleBlock(59, 3, t.WHEAT_STAGE_3); //
-	createItemStyleBlock(59, 4, t.WHEAT_STAGE_4); //
-	createItemStyleBlock(59, 5, t.WHEAT_STAGE_5); //
-	createItemStyleBlock(59, 6, t.WHEAT_STAGE_6); //
-	createItemStyleBlock(59, 7, t.WHEAT_STAGE_7); //
-	// --
-	setBlockImage(60, 0, t.FARMLAND_WET); // farmland
-	createRotatedBlock(61, 0, t.FURNACE_TOP); // furnace
-	createRotatedBlock(62, 0, t.FURNACE_TOP); // burning furnace
-	createStandingSign(); // id 63 // sign post
-	createDoor(64, t.DOOR_WOOD_LOWER, t.DOOR_WOOD_UPPER); // wooden door
-	// -- ladders
-	createSideFaceBlock(65, 2, FACE_SOUTH, t.LADDER);
-	createSideFaceBlock(65, 3, FACE_NORTH, t.LADDER);
-	createSideFaceBlock(65, 4, FACE_EAST, t.LADDER);
-	createSideFaceBlock(65, 5, FACE_WEST, t.LADDER);
-	// --
-	createRails(); // id 66
-	createStairs(67, t.COBBLESTONE); // cobblestone stairs
-	createWallSign(); // id 68 // wall sign
-	createLever(); // id 69 // lever
-	setBlockImage(70, 0, t.STONE); // stone pressure plate // TODO
-	createDoor(71, t.DOOR_IRON_LOWER, t.DOOR_IRON_UPPER); // iron door
-	setBlockImage(72, 0, t.PLANKS_OAK); // wooden pressure plate // TODO
-	setBlockImage(73, 0, t.REDSTONE_ORE); // redstone ore
-	setBlockImage(74, 0, t.REDSTONE_ORE); // glowing redstone ore
-	createTorch(75, t.REDSTONE_TORCH_OFF); // redstone torch off
-	createTorch(76, t.REDSTONE_TORCH_ON); // redstone torch on
-	createButton(77, t.STONE); // stone button
-	setBlockImage(78, 0, t.SNOW); // snow
-	setBlockImage(79, 0, t.ICE); // ice
-	setBlockImage(80, 0, t.SNOW); // snow block
-	setBlockImage(81, 0, t.CACTUS_TOP); // cactus
-	setBlockImage(82, 0, t.CLAY); // clay block
-	createItemStyleBlock(83, 0, t.REEDS); // sugar cane
-	setBlockImage(84, 0, t.JUKEBOX_TOP.rotate(1)); // jukebox
-	createFence(85, 0, t.PLANKS_OAK); // oak fence
-	// -- pumpkin
-	setBlockImage(86, 0, t.PUMPKIN_TOP.rotate(2)); // south
-	setBlockImage(86, 1, t.PUMPKIN_TOP.rotate(1)); // west
-	setBlockImage(86, 2, t.PUMPKIN_TOP); // north
-	setBlockImage(86, 3, t.PUMPKIN_TOP.rotate(3)); // east
-	// --
-	setBlockImage(87, 0, t.NETHERRACK); // netherrack
-	setBlockImage(88, 0, t.SOUL_SAND); // soul sand
-	setBlockImage(89, 0, t.GLOWSTONE); // glowstone block
-	setBlockImage(90, 0, t.PORTAL); // nether portal block // TODO?
-	// -- jack-o-lantern
-	setBlockImage(91, 0, t.PUMPKIN_TOP.rotate(2)); // south
-	setBlockImage(91, 1, t.PUMPKIN_TOP.rotate(1)); // west
-	setBlockImage(91, 2, t.PUMPKIN_TOP); // north
-	setBlockImage(91, 3, t.PUMPKIN_TOP.rotate(3)); // east
-	// --
-	createCake(); // id 92 // cake
-	// redstone repeater off --
-	setBlockImage(93, 0, t.REPEATER_OFF);
-	setBlockImage(93, 1, t.REPEATER_OFF.rotate(1));
-	setBlockImage(93, 2, t.REPEATER_OFF.rotate(2));
-	setBlockImage(93, 3, t.REPEATER_OFF.rotate(3));
-	// --
-	// redstone repeater on --
-	setBlockImage(94, 0, t.REPEATER_ON);
-	setBlockImage(94, 1, t.REPEATER_ON.rotate(1));
-	setBlockImage(94, 2, t.REPEATER_ON.rotate(2));
-	setBlockImage(94, 3, t.REPEATER_ON.rotate(3));
-	// --
-	// stained glass --
-	setBlockImage(95, 0, t.GLASS_WHITE);
-	setBlockImage(95, 1, t.GLASS_ORANGE);
-	setBlockImage(95, 2, t.GLASS_MAGENTA);
-	setBlockImage(95, 3, t.GLASS_LIGHT_BLUE);
-	setBlockImage(95, 4, t.GLASS_YELLOW);
-	setBlockImage(95, 5, t.GLASS_LIME);
-	setBlockImage(95, 6, t.GLASS_PINK);
-	setBlockImage(95, 7, t.GLASS_GRAY);
-	setBlockImage(95, 8, t.GLASS_SILVER);
-	setBlockImage(95, 9, t.GLASS_CYAN);
-	setBlockImage(95, 10, t.GLASS_PURPLE);
-	setBlockImage(95, 11, t.GLASS_BLUE);
-	setBlockImage(95, 12, t.GLASS_BROWN);
-	setBlockImage(95, 13, t.GLASS_GREEN);
-	setBlockImage(95, 14, t.GLASS_RED);
-	setBlockImage(95, 15, t.GLASS_BLACK);
-	// --
-	createTrapdoor(96, t.TRAPDOOR); // trapdoor
-	// -- monster egg
-	setBlockImage(97, 0, t.STONE); // stone
-	setBlockImage(97, 1, t.COBBLESTONE); // cobblestone
-	setBlockImage(97, 2, t.STONEBRICK); // stone brick
-	setBlockImage(97, 3, t.STONEBRICK_MOSSY); // mossy stone brick
-	setBlockImage(97, 4, t.STONEBRICK_CRACKED); // cracked stone brick
-	setBlockImage(97, 5, t.STONEBRICK_CARVED); // chiseled stone brick
-	// --
-	// -- stone bricks
-	setBlockImage(98, 0, t.STONEBRICK); // normal
-	setBlockImage(98, 1, t.STONEBRICK_MOSSY); // mossy
-	setBlockImage(98, 2, t.STONEBRICK_CRACKED); // cracked
-	setBlockImage(98, 3, t.STONEBRICK_CARVED); // chiseled
-	// --
-	createHugeMushroom(99, t.MUSHROOM_BLOCK_SKIN_BROWN); // huge brown mushroom
-	createHugeMushroom(100, t.MUSHROOM_BLOCK_SKIN_RED); // huge red mushroom
-	createBarsPane(101, 0, t.IRON_BARS); // iron bars
-	createBarsPane(102, 0, t.GLASS); // glass pane
-	setBlockImage(103, 0, t.MELON_TOP); // melon
-	createStem(104); // pumpkin stem
-	createStem(105); // melon stem
-	createVines(); // id 106
-	createFenceGate(107, t.PLANKS_OAK); // oak fence gate
-	createStairs(108, t.BRICK); // brick stairs
-	createStairs(109, t.STONEBRICK); // stone brick stairs
-	setBlockImage(110, 0, t.MYCELIUM_TOP); // mycelium
-	// -- lily pad
-	setBlockImage(111, 0, t.WATERLILY);
-	setBlockImage(111, 1, t.WATERLILY.rotate(3));
-	setBlockImage(111, 2, t.WATERLILY.rotate(2));
-	setBlockImage(111, 3, t.WATERLILY.rotate(1));
-	// --
-	setBlockImage(112, 0, t.NETHER_BRICK); // nether brick
-	createFence(113, 0, t.NETHER_BRICK); // nether brick fence
-	createStairs(114, t.NETHER_BRICK); // nether brick stairs
-	// -- nether wart
-	createItemStyleBlock(115, 0, t.NETHER_WART_STAGE_0);
-	createItemStyleBlock(115, 1, t.NETHER_WART_STAGE_1);
-	createItemStyleBlock(115, 2, t.NETHER_WART_STAGE_1);
-	createItemStyleBlock(115, 3, t.NETHER_WART_STAGE_2);
-	// --
-	setBlockImage(116, 0, t.ENCHANTING_TABLE_TOP); // enchantment table
-	// -- brewing stand
-	RGBAImage brewing_stand = t.BREWING_STAND_BASE;
-	brewing_stand.alphaBlit(t.BREWING_STAND, 0, 0);
-	AbstractBlockImages::setBlockImage(117, 0, brewing_stand);
-	// --
-	// -- cauldron
-	RGBAImage cauldron = t.CAULDRON_INNER, cauldron_water = cauldron;
-	cauldron.alphaBlit(t.CAULDRON_TOP, 0, 0);
-	cauldron_water.alphaBlit(water, 0, 0);
-	cauldron_water.alphaBlit(t.CAULDRON_TOP, 0, 0);
-	setBlockImage(118, 0, cauldron);
-	setBlockImage(118, 1, cauldron_water);
-	setBlockImage(118, 2, cauldron_water);
-	setBlockImage(118, 3, cauldron_water);
-	// --
-	setBlockImage(119, 0, resources.getEndportalTexture()); // end portal
-	setBlockImage(120, 0, t.ENDFRAME_TOP); // end portal frame
-	setBlockImage(121, 0, t.END_STONE); // end stone
-	setBlockImage(122, 0, t.DRAGON_EGG); // dragon egg
-	createItemStyleBlock(123, 0, t.REDSTONE_LAMP_OFF); // redstone lamp inactive
-	createItemStyleBlock(124, 0, t.REDSTONE_LAMP_ON); // redstone lamp active
-	// // double wooden slabs
-	setBlockImage(125, 0, t.PLANKS_OAK);
-	setBlockImage(125, 1, t.PLANKS_SPRUCE);
-	setBlockImage(125, 2, t.PLANKS_BIRCH);
-	setBlockImage(125, 3, t.PLANKS_JUNGLE);
-	setBlockImage(125, 4, t.PLANKS_ACACIA);
-	setBlockImage(125, 5, t.PLANKS_BIG_OAK);
-	// --
-	// normal wooden slabs --
-	setBlockImage(126, 0, t.PLANKS_OAK);
-	setBlockImage(126, 1, t.PLANKS_SPRUCE);
-	setBlockImage(126, 2, t.PLANKS_BIRCH);
-	setBlockImage(126, 3, t.PLANKS_JUNGLE);
-	setBlockImage(126, 4, t.PLANKS_ACACIA);
-	setBlockImage(126, 5, t.PLANKS_BIG_OAK);
-	// --
-	createCocoas(); // id 127 // cocoas
-	createStairs(128, t.SANDSTONE_NORMAL, t.SANDSTONE_TOP); // sandstone stairs
-	setBlockImage(129, 0, t.EMERALD_ORE);
-	createChest(130, resources.getEnderChest()); // ender chest
-	createTripwireHook(); // id 131 // tripwire hook
-	createRedstoneWire(132, 0, 192, 192, 192); // tripwire
-	setBlockImage(133, 0, t.EMERALD_BLOCK); // block of emerald
-	createStairs(134, t.PLANKS_SPRUCE); // spruce wood stairs
-	createStairs(135, t.PLANKS_BIRCH); // birch wood stairs
-	createStairs(136, t.PLANKS_JUNGLE); // jungle wood stairs
-	createCommandBlock(137, t.COMMAND_BLOCK_FRONT, t.COMMAND_BLOCK_BACK,
-			t.COMMAND_BLOCK_SIDE, t.COMMAND_BLOCK_CONDITIONAL); // command block
-	// -- beacon
-	RGBAImage beacon = t.OBSIDIAN, beacon_block;
-	int beacon_size = texture_size / 16.0 * 10;
-	if (beacon_size % 2)
-		beacon_size--; // odd sizes suck
-	t.BEACON.clip(1, 1, texture_size - 2, texture_size - 2).resize(beacon_block, beacon_size, beacon_size);
-	beacon.alphaBlit(beacon_block, (texture_size - beacon_size) / 2, (texture_size - beacon_size) / 2);
-	beacon.alphaBlit(t.GLASS, 0, 0);
-	setBlockImage(138, 0, beacon);
-	// --
-	createFence(139, 0, t.COBBLESTONE, 8, 6); // cobblestone wall
-	createFence(139, 1, t.COBBLESTONE_MOSSY, 8, 6); // cobblestone wall mossy
-	createFlowerPot(); // id 140 // flower pot
-	// carrots --
-	createItemStyleBlock(141, 0, t.CARROTS_STAGE_0);
-	createItemStyleBlock(141, 1, t.CARROTS_STAGE_0);
-	createItemStyleBlock(141, 2, t.CARROTS_STAGE_1);
-	createItemStyleBlock(141, 3, t.CARROTS_STAGE_1);
-	createItemStyleBlock(141, 4, t.CARROTS_STAGE_2);
-	createItemStyleBlock(141, 5, t.CARROTS_STAGE_2);
-	createItemStyleBlock(141, 6, t.CARROTS_STAGE_2);
-	createItemStyleBlock(141, 7, t.CARROTS_STAGE_3);
-	// --
-	// potatoes --
-	createItemStyleBlock(142, 0, t.POTATOES_STAGE_0);
-	createItemStyleBlock(142, 1, t.POTATOES_STAGE_0);
-	createItemStyleBlock(142, 2, t.POTATOES_STAGE_1);
-	createItemStyleBlock(142, 3, t.POTATOES_STAGE_1);
-	createItemStyleBlock(142, 4, t.POTATOES_STAGE_2);
-	createItemStyleBlock(142, 5, t.POTATOES_STAGE_2);
-	createItemStyleBlock(142, 6, t.POTATOES_STAGE_2);
-	createItemStyleBlock(142, 7, t.POTATOES_STAGE_3);
-	// --
-	createButton(143, t.PLANKS_OAK); // wooden button
-	// id 144 // head
-	// -- anvil
-	setBlockImage(145, 0, t.ANVIL_TOP_DAMAGED_0);
-	setBlockImage(145, 1, t.ANVIL_TOP_DAMAGED_0.rotate(1));
-	setBlockImage(145, 2, t.ANVIL_TOP_DAMAGED_0);
-	setBlockImage(145, 3, t.ANVIL_TOP_DAMAGED_0.rotate(1));
-	setBlockImage(145, 4, t.ANVIL_TOP_DAMAGED_1);
-	setBlockImage(145, 5, t.ANVIL_TOP_DAMAGED_1.rotate(1));
-	setBlockImage(145, 6, t.ANVIL_TOP_DAMAGED_1);
-	setBlockImage(145, 7, t.ANVIL_TOP_DAMAGED_1.rotate(1));
-	setBlockImage(145, 8, t.ANVIL_TOP_DAMAGED_2);
-	setBlockImage(145, 9, t.ANVIL_TOP_DAMAGED_2.rotate(1));
-	setBlockImage(145, 10, t.ANVIL_TOP_DAMAGED_2);
-	setBlockImage(145, 11, t.ANVIL_TOP_DAMAGED_2.rotate(1));
-	// --
-	createChest(146, resources.getTrappedChest()); // trapped chest
-	createDoubleChest(146, resources.getTrappedDoubleChest()); // double trapped chest
-	setBlockImage(147, 0, t.GOLD_BLOCK); // weighted pressure plate (light) // TODO
-	setBlockImage(148, 0, t.GOLD_BLOCK); // weighted pressure plate (heavy) // TODO
-	// redstone comparator (inactive) --
-	setBlockImage(149, 0, t.COMPARATOR_OFF);
-	setBlockImage(149, 1, t.COMPARATOR_OFF.rotate(1));
-	setBlockImage(149, 2, t.COMPARATOR_OFF.rotate(2));
-	setBlockImage(149, 3, t.COMPARATOR_OFF.rotate(3));
-	// --
-	// redstone comparator (active)
-	setBlockImage(150, 0, t.COMPARATOR_ON);
-	setBlockImage(150, 1, t.COMPARATOR_ON.rotate(1));
-	setBlockImage(150, 2, t.COMPARATOR_ON.rotate(2));
-	setBlockImage(150, 3, t.COMPARATOR_ON.rotate(3));
-	// --
-	setBlockImage(151, 0, t.DAYLIGHT_DETECTOR_TOP); // daylight sensor
-	setBlockImage(152, 0, t.REDSTONE_BLOCK); // block of redstone
-	setBlockImage(153, 0, t.QUARTZ_ORE); // quartz ore
-	// -- hopper
-	RGBAImage hopper = t.HOPPER_INSIDE;
-	hopper.alphaBlit(t.HOPPER_TOP, 0, 0);
-	setBlockImage(154, 0, hopper);
-	// --
-	// block of quartz --
-	setBlockImage(155, 0, t.QUARTZ_BLOCK_TOP);
-	setBlockImage(155, 1, t.QUARTZ_BLOCK_CHISELED_TOP);
-	setBlockImage(155, 2, t.QUARTZ_BLOCK_LINES_TOP);
-	setBlockImage(155, 3, t.QUARTZ_BLOCK_LINES);
-	setBlockImage(155, 4, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90));
-	// --
-	createStairs(156, t.QUARTZ_BLOCK_SIDE); // quartz stairs
-	createStraightRails(157, 0, t.RAIL_ACTIVATOR); // activator rail
-	createDispenserDropper(158, t.DROPPER_FRONT_HORIZONTAL); // dropper
-	// stained clay --
-	setBlockImage(159, 0, t.HARDENED_CLAY_STAINED_WHITE);
-	setBlockImage(159, 1, t.HARDENED_CLAY_STAINED_ORANGE);
-	setBlockImage(159, 2, t.HARDENED_CLAY_STAINED_MAGENTA);
-	setBlockImage(159, 3, t.HARDENED_CLAY_STAINED_LIGHT_BLUE);
-	setBlockImage(159, 4, t.HARDENED_CLAY_STAINED_YELLOW);
-	setBlockImage(159, 5, t.HARDENED_CLAY_STAINED_LIME);
-	setBlockImage(159, 6, t.HARDENED_CLAY_STAINED_PINK);
-	setBlockImage(159, 7, t.HARDENED_CLAY_STAINED_GRAY);
-	setBlockImage(159, 8, t.HARDENED_CLAY_STAINED_SILVER);
-	setBlockImage(159, 9, t.HARDENED_CLAY_STAINED_CYAN);
-	setBlockImage(159, 10, t.HARDENED_CLAY_STAINED_PURPLE);
-	setBlockImage(159, 11, t.HARDENED_CLAY_STAINED_BLUE);
-	setBlockImage(159, 12, t.HARDENED_CLAY_STAINED_BROWN);
-	setBlockImage(159, 13, t.HARDENED_CLAY_STAINED_GREEN);
-	setBlockImage(159, 14, t.HARDENED_CLAY_STAINED_RED);
-	setBlockImage(159, 15, t.HARDENED_CLAY_STAINED_BLACK);
-	// --
-	// stained glass pane --
-	createBarsPane(160, 0, t.GLASS_WHITE);
-	createBarsPane(160, 1, t.GLASS_ORANGE);
-	createBarsPane(160, 2, t.GLASS_MAGENTA);
-	createBarsPane(160, 3, t.GLASS_LIGHT_BLUE);
-	createBarsPane(160, 4, t.GLASS_YELLOW);
-	createBarsPane(160, 5, t.GLASS_LIME);
-	createBarsPane(160, 6, t.GLASS_PINK);
-	createBarsPane(160, 7, t.GLASS_GRAY);
-	createBarsPane(160, 8, t.GLASS_SILVER);
-	createBarsPane(160, 9, t.GLASS_CYAN);
-	createBarsPane(160, 10, t.GLASS_PURPLE);
-	createBarsPane(160, 11, t.GLASS_BLUE);
-	createBarsPane(160, 12, t.GLASS_BROWN);
-	createBarsPane(160, 13, t.GLASS_GREEN);
-	createBarsPane(160, 14, t.GLASS_RED);
-	createBarsPane(160, 15, t.GLASS_BLACK);
-	// --
-	setBlockImage(161, 0, t.LEAVES_ACACIA); // acacia leaves
-	setBlockImage(161, 1, t.LEAVES_BIG_OAK); // dark oak leaves
-	// some more wood --
-	createWood(162, 0, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // acacia
-	createWood(162, 1, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // acacia (placeholder)
-	createWood(162, 2, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // dark wood
-	createWood(162, 3, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // dark wood (placeholder)
-	// --
-	createStairs(163, t.PLANKS_ACACIA); // acacia wood stairs
-	createStairs(164, t.PLANKS_BIG_OAK); // dark oak wood stairs
-	setBlockImage(165, 0, t.SLIME); // slime block
-	setBlockImage(166, 0, empty_texture); // barrier
-	createTrapdoor(167, t.IRON_TRAPDOOR); // iron trapdoor
-	// prismarine --
-	setBlockImage(168, 0, t.PRISMARINE_ROUGH);
-	setBlockImage(168, 1, t.PRISMARINE_BRICKS);
-	setBlockImage(168, 2, t.PRISMARINE_DARK);
-	// --
-	setBlockImage(169, 0, t.SEA_LANTERN); // sea lantern
-	// hay block --
-	setBlockImage(170, 0, t.HAY_BLOCK_TOP); // normal orientation
-	setBlockImage(170, 4, t.HAY_BLOCK_SIDE); // east-west
-	setBlockImage(170, 8, t.HAY_BLOCK_SIDE.rotate(1)); // north-south
-	// --
-	// carpet --
-	setBlockImage(171, 0, t.WOOL_COLORED_WHITE);
-	setBlockImage(171, 1, t.WOOL_COLORED_ORANGE);
-	setBlockImage(171, 2, t.WOOL_COLORED_MAGENTA);
-	setBlockImage(171, 3, t.WOOL_COLORED_LIGHT_BLUE);
-	setBlockImage(171, 4, t.WOOL_COLORED_YELLOW);
-	setBlockImage(171, 5, t.WOOL_COLORED_LIME);
-	setBlockImage(171, 6, t.WOOL_COLORED_PINK);
-	setBlockImage(171, 7, t.WOOL_COLORED_GRAY);
-	setBlockImage(171, 8, t.WOOL_COLORED_SILVER);
-	setBlockImage(171, 9, t.WOOL_COLORED_CYAN);
-	setBlockImage(171, 10, t.WOOL_COLORED_PURPLE);
-	setBlockImage(171, 11, t.WOOL_COLORED_BLUE);
-	setBlockImage(171, 12, t.WOOL_COLORED_BROWN);
-	setBlockImage(171, 13, t.WOOL_COLORED_GREEN);
-	setBlockImage(171, 14, t.WOOL_COLORED_RED);
-	setBlockImage(171, 15, t.WOOL_COLORED_BLACK);
-	// --
-	setBlockImage(172, 0, t.HARDENED_CLAY); // hardened clay
-	setBlockImage(173, 0, t.COAL_BLOCK); // block of coal
-	setBlockImage(174, 0, t.ICE_PACKED); // packed ice
-	// large plants, id 175 --
-	// the top texture of the sunflower is a bit modified
-	RGBAImage sunflower_top = t.DOUBLE_PLANT_SUNFLOWER_TOP;
-	sunflower_top.alphaBlit(t.DOUBLE_PLANT_SUNFLOWER_FRONT, 0, -texture_size * 0.25);
-	createLargePlant(0, t.DOUBLE_PLANT_SUNFLOWER_BOTTOM, sunflower_top);
-	createLargePlant(1, t.DOUBLE_PLANT_SYRINGA_BOTTOM, t.DOUBLE_PLANT_SYRINGA_TOP);
-	createLargePlant(2, t.DOUBLE_PLANT_GRASS_BOTTOM, t.DOUBLE_PLANT_GRASS_TOP);
-	createLargePlant(3, t.DOUBLE_PLANT_FERN_BOTTOM, t.DOUBLE_PLANT_FERN_TOP);
-	createLargePlant(4, t.DOUBLE_PLANT_ROSE_BOTTOM, t.DOUBLE_PLANT_ROSE_TOP);
-	createLargePlant(5, t.DOUBLE_PLANT_PAEONIA_BOTTOM, t.DOUBLE_PLANT_PAEONIA_TOP);
-	// --
-	// id 176 // standing banner
-	// id 177 // wall banner
-	setBlockImage(178, 0, t.DAYLIGHT_DETECTOR_INVERTED_TOP); // inverted daylight sensor
-	// -- red sandstone
-	setBlockImage(179, 0, t.RED_SANDSTONE_TOP); // normal
-	setBlockImage(179, 1, t.RED_SANDSTONE_TOP); // chiseled
-	setBlockImage(179, 2, t.RED_SANDSTONE_TOP); // smooth
-	// --
-	createStairs(180, t.RED_SANDSTONE_NORMAL, t.RED_SANDSTONE_TOP); // red sandstone stairs
-	// double red sandstone slabs --
-	setBlockImage(181, 0, t.RED_SANDSTONE_TOP);
-	// --
-	createFenceGate(183, t.PLANKS_SPRUCE); // spruce fence gate
-	createFenceGate(184, t.PLANKS_BIRCH); // birch fence gate
-	createFenceGate(185, t.PLANKS_JUNGLE); // jungle fence gate
-	createFenceGate(186, t.PLANKS_BIG_OAK); // dark oak fence gate
-	createFenceGate(187, t.PLANKS_ACACIA); // acacia fence gate
-	createFence(188, 0, t.PLANKS_SPRUCE); // spruce fence
-	createFence(189, 0, t.PLANKS_BIRCH); // birch fence
-	createFence(190, 0, t.PLANKS_JUNGLE); // jungle fence
-	createFence(191, 0, t.PLANKS_BIG_OAK); // dark oak fence
-	createFence(192, 0, t.PLANKS_ACACIA); // acacia fence
-	createDoor(193, t.DOOR_SPRUCE_LOWER, t.DOOR_SPRUCE_UPPER); // spruce door
-	createDoor(194, t.DOOR_BIRCH_LOWER, t.DOOR_BIRCH_UPPER); // birch door
-	createDoor(195, t.DOOR_JUNGLE_LOWER, t.DOOR_JUNGLE_UPPER); // jungle door
-	createDoor(196, t.DOOR_ACACIA_LOWER, t.DOOR_ACACIA_UPPER); // acacia door
-	createDoor(197, t.DOOR_DARK_OAK_LOWER, t.DOOR_DARK_OAK_UPPER); // dark oak door
-	createEndRod(); // id 198
-	setBlockImage(199, 0, t.CHORUS_PLANT); // chrous plant
-	// chorus flower --
-	setBlockImage(200, 0, t.CHORUS_FLOWER);
-	setBlockImage(200, 1, t.CHORUS_FLOWER);
-	setBlockImage(200, 2, t.CHORUS_FLOWER);
-	setBlockImage(200, 3, t.CHORUS_FLOWER);
-	setBlockImage(200, 4, t.CHORUS_FLOWER);
-	setBlockImage(200, 5, t.CHORUS_FLOWER_DEAD);
-	// --
-	setBlockImage(201, 0, t.PURPUR_BLOCK); // purpur block
-	// purpur pillar --
-	// TODO is the official data like this or are there also other combination? 0, 4, 8 seems odd...
-	setBlockImage(202, 0, t.PURPUR_PILLAR_TOP); // vertically
-	setBlockImage(202, 4, t.PURPUR_PILLAR.rotate(1)); // east-west
-	setBlockImage(202, 8, t.PURPUR_PILLAR); // north-south
-	// --
-	createStairs(203, t.PURPUR_BLOCK); // purpur stairs
-	setBlockImage(204, 0, t.PURPUR_BLOCK); // purpur double slab
-	setBlockImage(205, 0, t.PURPUR_BLOCK); // purpur slab
-	setBlockImage(206, 0, t.END_BRICKS); // end stone bricks
-	// beetroot seeds --
-	createItemStyleBlock(207, 0, t.BEETROOTS_STAGE_0);
-	createItemStyleBlock(207, 1, t.BEETROOTS_STAGE_1);
-	createItemStyleBlock(207, 2, t.BEETROOTS_STAGE_2);
-	createItemStyleBlock(207, 3, t.BEETROOTS_STAGE_3);
-	// --
-	setBlockImage(208, 0, t.GRASS_PATH_TOP); // grass path
-	setBlockImage(209, 0, resources.getEndportalTexture()); // end gateway
-	createCommandBlock(210, t.REPEATING_COMMAND_BLOCK_FRONT, t.REPEATING_COMMAND_BLOCK_BACK,
-			t.REPEATING_COMMAND_BLOCK_SIDE, t.REPEATING_COMMAND_BLOCK_CONDITIONAL); // id 210
-	createCommandBlock(211, t.CHAIN_COMMAND_BLOCK_FRONT, t.CHAIN_COMMAND_BLOCK_BACK,
-			t.CHAIN_COMMAND_BLOCK_SIDE, t.CHAIN_COMMAND_BLOCK_CONDITIONAL); // id 211
-	// frosted ice --
-	setBlockImage(212, 0, t.FROSTED_ICE_0);
-	setBlockImage(212, 1, t.FROSTED_ICE_1);
-	setBlockImage(212, 2, t.FROSTED_ICE_2);
-	setBlockImage(212, 3, t.FROSTED_ICE_3);
-	// --
-	setBlockImage(213, 0, t.MAGMA); // magma
-	setBlockImage(214, 0, t.NETHER_WART_BLOCK); // nether wart block
-	setBlockImage(215, 0, t.RED_NETHER_BRICK); // red nether brick
-	// bone block --
-	setBlockImage(216, 0, t.BONE_BLOCK_TOP); // vertically
-	setBlockImage(216, 4, t.BONE_BLOCK_SIDE); // east-west
-	setBlockImage(216, 8, t.BONE_BLOCK_SIDE); // north-south
-	// observer --
-	setBlockImage(218, 0, t.OBSERVER_BACK);
-	setBlockImage(218, 1, t.OBSERVER_FRONT.rotate(ROTATE_180));
-	setBlockImage(218, 2, t.OBSERVER_TOP.rotate(ROTATE_180));
-	setBlockImage(218, 3, t.OBSERVER_TOP);
-	setBlockImage(218, 4, t.OBSERVER_TOP.rotate(ROTATE_90));
-	setBlockImage(218, 5, t.OBSERVER_TOP.rotate(ROTATE_270));
-	// shulker boxes --
-	for (uint16_t i = 0; i < 16; i++) {
-		setBlockImage((uint16_t) (219 + i), 0, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::BOTTOM].flip(true, false).rotate(ROTATE_180));
-		setBlockImage((uint16_t) (219 + i), 1, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::TOP]);
-		setBlockImage((uint16_t) (219 + i), 2, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE]); // north
-		setBlockImage((uint16_t) (219 + i), 3, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE].rotate(ROTATE_180)); // south
-		setBlockImage((uint16_t) (219 + i), 4, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE].rotate(ROTATE_270)); // west
-		setBlockImage((uint16_t) (219 + i), 5, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE].rotate(ROTATE_90)); // east
-	}
-	// glazed terracotta --
-	createGlazedTerracotta(235, t.GLAZED_TERRACOTTA_WHITE); // white
-	createGlazedTerracotta(236, t.GLAZED_TERRACOTTA_ORANGE); // orange
-	createGlazedTerracotta(237, t.GLAZED_TERRACOTTA_MAGENTA); // magenta
-	createGlazedTerracotta(238, t.GLAZED_TERRACOTTA_LIGHT_BLUE); // light blue
-	createGlazedTerracotta(239, t.GLAZED_TERRACOTTA_YELLOW); // yellow
-	createGlazedTerracotta(240, t.GLAZED_TERRACOTTA_LIME); // lime
-	createGlazedTerracotta(241, t.GLAZED_TERRACOTTA_PINK); // pink
-	createGlazedTerracotta(242, t.GLAZED_TERRACOTTA_GRAY); // gray
-	createGlazedTerracotta(243, t.GLAZED_TERRACOTTA_SILVER); // light gray
-	createGlazedTerracotta(244, t.GLAZED_TERRACOTTA_CYAN); // cyan
-	createGlazedTerracotta(245, t.GLAZED_TERRACOTTA_PURPLE); // purple
-	createGlazedTerracotta(246, t.GLAZED_TERRACOTTA_BLUE); // blue
-	createGlazedTerracotta(247, t.GLAZED_TERRACOTTA_BROWN); // brown
-	createGlazedTerracotta(248, t.GLAZED_TERRACOTTA_GREEN); // green
-	createGlazedTerracotta(249, t.GLAZED_TERRACOTTA_RED); // red
-	createGlazedTerracotta(250, t.GLAZED_TERRACOTTA_BLACK); // black
-	// concrete --
-	setBlockImage(251, 0, t.CONCRETE_WHITE); // white
-	setBlockImage(251, 1, t.CONCRETE_ORANGE); // orange
-	setBlockImage(251, 2, t.CONCRETE_MAGENTA); // magenta
-	setBlockImage(251, 3, t.CONCRETE_LIGHT_BLUE); // light blue
-	setBlockImage(251, 4, t.CONCRETE_YELLOW); // yellow
-	setBlockImage(251, 5, t.CONCRETE_LIME); // lime
-	setBlockImage(251, 6, t.CONCRETE_PINK); // pink
-	setBlockImage(251, 7, t.CONCRETE_GRAY); // gray
-	setBlockImage(251, 8, t.CONCRETE_SILVER); // light gray
-	setBlockImage(251, 9, t.CONCRETE_CYAN); // cyan
-	setBlockImage(251, 10, t.CONCRETE_PURPLE); // purple
-	setBlockImage(251, 11, t.CONCRETE_BLUE); // blue
-	setBlockImage(251, 12, t.CONCRETE_BROWN); // brown
-	setBlockImage(251, 13, t.CONCRETE_GREEN); // green
-	setBlockImage(251, 14, t.CONCRETE_RED); // red
-	setBlockImage(251, 15, t.CONCRETE_BLACK); // black
-	// concrete powder --
-	setBlockImage(252, 0, t.CONCRETE_POWDER_WHITE); // white
-	setBlockImage(252, 1, t.CONCRETE_POWDER_ORANGE); // orange
-	setBlockImage(252, 2, t.CONCRETE_POWDER_MAGENTA); // magenta
-	setBlockImage(252, 3, t.CONCRETE_POWDER_LIGHT_BLUE); // light blue
-	setBlockImage(252, 4, t.CONCRETE_POWDER_YELLOW); // yellow
-	setBlockImage(252, 5, t.CONCRETE_POWDER_LIME); // lime
-	setBlockImage(252, 6, t.CONCRETE_POWDER_PINK); // pink
-	setBlockImage(252, 7, t.CONCRETE_POWDER_GRAY); // gray
-	setBlockImage(252, 8, t.CONCRETE_POWDER_SILVER); // light gray
-	setBlockImage(252, 9, t.CONCRETE_POWDER_CYAN); // cyan
-	setBlockImage(252, 10, t.CONCRETE_POWDER_PURPLE); // purple
-	setBlockImage(252, 11, t.CONCRETE_POWDER_BLUE); // blue
-	setBlockImage(252, 12, t.CONCRETE_POWDER_BROWN); // brown
-	setBlockImage(252, 13, t.CONCRETE_POWDER_GREEN); // green
-	setBlockImage(252, 14, t.CONCRETE_POWDER_RED); // red
-	setBlockImage(252, 15, t.CONCRETE_POWDER_BLACK); // black
-	// --
-	setBlockImage(217, 0, empty_texture); // structure void
-	// structure block --
-	setBlockImage(255, 0, t.STRUCTURE_BLOCK_SAVE);
-	setBlockImage(255, 1, t.STRUCTURE_BLOCK_LOAD);
-	setBlockImage(255, 2, t.STRUCTURE_BLOCK_CORNER);
-	setBlockImage(255, 3, t.STRUCTURE_BLOCK_DATA);
-	// --
+	// the blocks are split into tasks which can create their block images in parallel
+	std::vector<std::function<void()> > tasks;
+	tasks.push_back([&]() {
+		setBlockImage(1, 0, t.STONE);
+		setBlockImage(1, 1, t.STONE_GRANITE); // granite
+		setBlockImage(1, 2, t.STONE_GRANITE_SMOOTH); // polished granite
+		setBlockImage(1, 3, t.STONE_DIORITE); // diorite
+		setBlockImage(1, 4, t.STONE_DIORITE_SMOOTH); // polished diorite
+		setBlockImage(1, 5, t.STONE_ANDESITE); // andesite
+		setBlockImage(1, 6, t.STONE_ANDESITE_SMOOTH); // polished andesite
+		setBlockImage(2, 0, t.GRASS_TOP);
+		setBlockImage(3, 0, t.DIRT);
+		setBlockImage(3, 1, t.DIRT);
+		setBlockImage(3, 2, t.DIRT_PODZOL_TOP);
+		setBlockImage(4, 0, t.COBBLESTONE); // cobblestone
+		// -- wooden planks
+		setBlockImage(5, 0, t.PLANKS_OAK); // oak
+		setBlockImage(5, 1, t.PLANKS_SPRUCE); // pine/spruce
+		setBlockImage(5, 2, t.PLANKS_BIRCH); // birch
+		setBlockImage(5, 3, t.PLANKS_JUNGLE); // jungle
+		setBlockImage(5, 4, t.PLANKS_ACACIA); // acacia
+		setBlockImage(5, 5, t.PLANKS_BIG_OAK); // dark oak
+		// --
+		// -- saplings
+		createItemStyleBlock(6, 0, t.SAPLING_OAK); // oak
+		createItemStyleBlock(6, 1, t.SAPLING_SPRUCE); // spruce
+		createItemStyleBlock(6, 2, t.SAPLING_BIRCH); // birch
+		createItemStyleBlock(6, 3, t.SAPLING_JUNGLE); // jungle
+		createItemStyleBlock(6, 4, t.SAPLING_ACACIA); // acacia
+		createItemStyleBlock(6, 5, t.SAPLING_ROOFED_OAK); // dark oak
+		// --
+		setBlockImage(7, 0, t.BEDROCK); // bedrock
+		setBlockImage(8, 0, water);
+		setBlockImage(9, 0, water);
+		setBlockImage(10, 0, t.LAVA_STILL);
+		setBlockImage(11, 0, t.LAVA_STILL);
+		setBlockImage(12, 0, t.SAND); // sand
+		setBlockImage(12, 1, t.RED_SAND); // red sand
+		setBlockImage(13, 0, t.GRAVEL); // gravel
+		setBlockImage(14, 0, t.GOLD_ORE); // gold ore
+		setBlockImage(15, 0, t.IRON_ORE); // iron ore
+		setBlockImage(16, 0, t.COAL_ORE); // coal ore
+		// -- wood
+		createWood(17, 0, t.LOG_OAK, t.LOG_OAK_TOP); // oak
+		createWood(17, 1, t.LOG_SPRUCE, t.LOG_SPRUCE_TOP); // pine/spruce
+		createWood(17, 2, t.LOG_BIRCH, t.LOG_BIRCH_TOP); // birch
+		createWood(17, 3, t.LOG_JUNGLE, t.LOG_JUNGLE_TOP); // jungle
+		// --
+		setBlockImage(18, 0, t.LEAVES_OAK); // oak
+		setBlockImage(18, 1, t.LEAVES_SPRUCE); // pine/spruce
+		setBlockImage(18, 2, t.LEAVES_OAK); // birch
+		setBlockImage(18, 3, t.LEAVES_JUNGLE); // jungle
+		setBlockImage(19, 0, t.SPONGE); // sponge
+		setBlockImage(19, 1, t.SPONGE_WET); // wet sponge
+		setBlockImage(20, 0, t.GLASS);
+		setBlockImage(21, 0, t.LAPIS_ORE); // lapis lazuli ore
+		setBlockImage(22, 0, t.LAPIS_BLOCK); // lapis lazuli block
+		createDispenserDropper(23, t.DISPENSER_FRONT_HORIZONTAL); // dispenser
+		setBlockImage(24, 0, t.SANDSTONE_TOP); // sandstone
+		setBlockImage(25, 0, t.NOTEBLOCK); // noteblock
+		createBed(resources.getBedTextures()); // id 26 // bed
+		createStraightRails(27, 0, t.RAIL_GOLDEN); // powered rail (unpowered)
+		createStraightRails(27, 8, t.RAIL_GOLDEN_POWERED); // powered rail (powered);
+		createStraightRails(28, 0, t.RAIL_ACTIVATOR); // detector rail
+		createPiston(29, true); // sticky piston
+		createItemStyleBlock(30, 0, t.WEB); // cobweb
+		// -- tall grass
+		createItemStyleBlock(31, 0, t.DEADBUSH); // dead bush style
+		createItemStyleBlock(31, 1, t.TALLGRASS); // tall grass
+		createItemStyleBlock(31, 2, t.FERN); // fern
+		// --
+		createItemStyleBlock(32, 0, t.DEADBUSH); // dead bush
+		createPiston(33, false); // piston
+		createPistonExtension(); // id 34 // piston extension
+	});
+	tasks.push_back([&]() {
+		// -- wool
+		setBlockImage(35, 0, t.WOOL_COLORED_WHITE); // white
+		setBlockImage(35, 1, t.WOOL_COLORED_ORANGE); // orange
+		setBlockImage(35, 2, t.WOOL_COLORED_MAGENTA); // magenta
+		setBlockImage(35, 3, t.WOOL_COLORED_LIGHT_BLUE); // light blue
+		setBlockImage(35, 4, t.WOOL_COLORED_YELLOW); // yellow
+		setBlockImage(35, 5, t.WOOL_COLORED_LIME); // lime
+		setBlockImage(35, 6, t.WOOL_COLORED_PINK); // pink
+		setBlockImage(35, 7, t.WOOL_COLORED_GRAY); // gray
+		setBlockImage(35, 8, t.WOOL_COLORED_SILVER); // light gray
+		setBlockImage(35, 9, t.WOOL_COLORED_CYAN); // cyan
+		setBlockImage(35, 10, t.WOOL_COLORED_PURPLE); // purple
+		setBlockImage(35, 11, t.WOOL_COLORED_BLUE); // blue
+		setBlockImage(35, 12, t.WOOL_COLORED_BROWN); // brown
+		setBlockImage(35, 13, t.WOOL_COLORED_GREEN); // green
+		setBlockImage(35, 14, t.WOOL_COLORED_RED); // red
+		setBlockImage(35, 15, t.WOOL_COLORED_BLACK); // black
+		// --
+		setBlockImage(36, 0, empty_texture); // block moved by piston aka 'block 36'
+		createItemStyleBlock(37, 0, t.FLOWER_DANDELION); // dandelion
+		// -- poppy -- different flowers
+		createItemStyleBlock(38, 0, t.FLOWER_ROSE); // poppy
+		createItemStyleBlock(38, 1, t.FLOWER_BLUE_ORCHID); // blue orchid
+		createItemStyleBlock(38, 2, t.FLOWER_ALLIUM); // azure bluet
+		createItemStyleBlock(38, 3, t.FLOWER_HOUSTONIA); //
+		createItemStyleBlock(38, 4, t.FLOWER_TULIP_RED); // red tulip
+		createItemStyleBlock(38, 5, t.FLOWER_TULIP_ORANGE); // orange tulip
+		createItemStyleBlock(38, 6, t.FLOWER_TULIP_WHITE); // white tulip
+		createItemStyleBlock(38, 7, t.FLOWER_TULIP_PINK); // pink tulip
+		createItemStyleBlock(38, 8, t.FLOWER_OXEYE_DAISY); // oxeye daisy
+		// --
+		setBlockImage(39, 0, t.MUSHROOM_BROWN); // brown mushroom
+		setBlockImage(40, 0, t.MUSHROOM_RED); // red mushroom
+		setBlockImage(41, 0, t.GOLD_BLOCK); // block of gold
+		setBlockImage(42, 0, t.IRON_BLOCK); // block of iron
+		// double stone slabs --
+		setBlockImage(43, 0, t.STONE_SLAB_TOP);
+		setBlockImage(43, 1, t.SANDSTONE_TOP);
+		setBlockImage(43, 2, t.PLANKS_OAK);
+		setBlockImage(43, 3, t.COBBLESTONE);
+		setBlockImage(43, 4, t.BRICK);
+		setBlockImage(43, 5, t.STONEBRICK);
+		setBlockImage(43, 6, t.NETHER_BRICK);
+		setBlockImage(43, 7, t.QUARTZ_BLOCK_SIDE);
+		// --
+		// normal stone slabs --
+		setBlockImage(44, 0, t.STONE_SLAB_TOP);
+		setBlockImage(44, 1, t.SANDSTONE_TOP);
+		setBlockImage(44, 2, t.PLANKS_OAK);
+		setBlockImage(44, 3, t.COBBLESTONE);
+		setBlockImage(44, 4, t.BRICK);
+		setBlockImage(44, 5, t.STONEBRICK);
+		setBlockImage(44, 6, t.NETHER_BRICK);
+		setBlockImage(44, 7, t.QUARTZ_BLOCK_SIDE);
+		// --
+		setBlockImage(45, 0, t.BRICK); // bricks
+		setBlockImage(46, 0, t.TNT_TOP); // tnt
+		setBlockImage(47, 0, t.PLANKS_OAK); // bookshelf
+		setBlockImage(48, 0, t.COBBLESTONE_MOSSY); // moss stone
+		setBlockImage(49, 0, t.OBSIDIAN); // obsidian
+		createTorch(50, t.TORCH_ON); // torch
+		createItemStyleBlock(51, 0, t.FIRE_LAYER_0); // fire
+		setBlockImage(52, 0, t.MOB_SPAWNER); // monster spawner
+		createStairs(53, t.PLANKS_OAK); // oak wood stairs
+		createChest(54, resources.getNormalChest()); // chest
+		createDoubleChest(54, resources.getNormalDoubleChest()); // chest
+		createRedstoneWire(55, 0, 48, 0, 0); // redstone wire not powered
+		createRedstoneWire(55, REDSTONE_POWERED, 192, 0, 0); // redstone wire powered
+		setBlockImage(56, 0, t.DIAMOND_ORE); // diamond ore
+		setBlockImage(57, 0, t.DIAMOND_BLOCK); // block of diamond
+		setBlockImage(58, 0, t.CRAFTING_TABLE_TOP); // crafting table
+		// -- wheat
+		createItemStyleBlock(59, 0, t.WHEAT_STAGE_0); //
+		createItemStyleBlock(59, 1, t.WHEAT_STAGE_1); //
+		createItemStyleBlock(59, 2, t.WHEAT_STAGE_2); //
+		createItemStyleBlock(59, 3, t.WHEAT_STAGE_3); //
+		createItemStyleBlock(59, 4, t.WHEAT_STAGE_4); //
+		createItemStyleBlock(59, 5, t.WHEAT_STAGE_5); //
+		createItemStyleBlock(59, 6, t.WHEAT_STAGE_6); //
+		createItemStyleBlock(59, 7, t.WHEAT_STAGE_7); //
+		// --
+		setBlockImage(60, 0, t.FARMLAND_WET); // farmland
+		createRotatedBlock(61, 0, t.FURNACE_TOP); // furnace
+		createRotatedBlock(62, 0, t.FURNACE_TOP); // burning furnace
+		createStandingSign(); // id 63 // sign post
+		createDoor(64, t.DOOR_WOOD_LOWER, t.DOOR_WOOD_UPPER); // wooden door
+		// -- ladders
+		createSideFaceBlock(65, 2, FACE_SOUTH, t.LADDER);
+		createSideFaceBlock(65, 3, FACE_NORTH, t.LADDER);
+		createSideFaceBlock(65, 4, FACE_EAST, t.LADDER);
+		createSideFaceBlock(65, 5, FACE_WEST, t.LADDER);
+		// --
+	});
+	tasks.push_back([&]() {
+		createRails(); // id 66
+		createStairs(67, t.COBBLESTONE); // cobblestone stairs
+		createWallSign(); // id 68 // wall sign
+		createLever(); // id 69 // lever
+		setBlockImage(70, 0, t.STONE); // stone pressure plate // TODO
+		createDoor(71, t.DOOR_IRON_LOWER, t.DOOR_IRON_UPPER); // iron door
+		setBlockImage(72, 0, t.PLANKS_OAK); // wooden pressure plate // TODO
+		setBlockImage(73, 0, t.REDSTONE_ORE); // redstone ore
+		setBlockImage(74, 0, t.REDSTONE_ORE); // glowing redstone ore
+		createTorch(75, t.REDSTONE_TORCH_OFF); // redstone torch off
+		createTorch(76, t.REDSTONE_TORCH_ON); // redstone torch on
+		createButton(77, t.STONE); // stone button
+		setBlockImage(78, 0, t.SNOW); // snow
+		setBlockImage(79, 0, t.ICE); // ice
+		setBlockImage(80, 0, t.SNOW); // snow block
+		setBlockImage(81, 0, t.CACTUS_TOP); // cactus
+		setBlockImage(82, 0, t.CLAY); // clay block
+		createItemStyleBlock(83, 0, t.REEDS); // sugar cane
+		setBlockImage(84, 0, t.JUKEBOX_TOP.rotate(1)); // jukebox
+		createFence(85, 0, t.PLANKS_OAK); // oak fence
+		// -- pumpkin
+		setBlockImage(86, 0, t.PUMPKIN_TOP.rotate(2)); // south
+		setBlockImage(86, 1, t.PUMPKIN_TOP.rotate(1)); // west
+		setBlockImage(86, 2, t.PUMPKIN_TOP); // north
+		setBlockImage(86, 3, t.PUMPKIN_TOP.rotate(3)); // east
+		// --
+		setBlockImage(87, 0, t.NETHERRACK); // netherrack
+		setBlockImage(88, 0, t.SOUL_SAND); // soul sand
+		setBlockImage(89, 0, t.GLOWSTONE); // glowstone block
+		setBlockImage(90, 0, t.PORTAL); // nether portal block // TODO?
+		// -- jack-o-lantern
+		setBlockImage(91, 0, t.PUMPKIN_TOP.rotate(2)); // south
+		setBlockImage(91, 1, t.PUMPKIN_TOP.rotate(1)); // west
+		setBlockImage(91, 2, t.PUMPKIN_TOP); // north
+		setBlockImage(91, 3, t.PUMPKIN_TOP.rotate(3)); // east
+		// --
+		createCake(); // id 92 // cake
+		// redstone repeater off --
+		setBlockImage(93, 0, t.REPEATER_OFF);
+		setBlockImage(93, 1, t.REPEATER_OFF.rotate(1));
+		setBlockImage(93, 2, t.REPEATER_OFF.rotate(2));
+		setBlockImage(93, 3, t.REPEATER_OFF.rotate(3));
+		// --
+		// redstone repeater on --
+		setBlockImage(94, 0, t.REPEATER_ON);
+		setBlockImage(94, 1, t.REPEATER_ON.rotate(1));
+		setBlockImage(94, 2, t.REPEATER_ON.rotate(2));
+		setBlockImage(94, 3, t.REPEATER_ON.rotate(3));
+		// --
+		// stained glass --
+		setBlockImage(95, 0, t.GLASS_WHITE);
+		setBlockImage(95, 1, t.GLASS_ORANGE);
+		setBlockImage(95, 2, t.GLASS_MAGENTA);
+		setBlockImage(95, 3, t.GLASS_LIGHT_BLUE);
+		setBlockImage(95, 4, t.GLASS_YELLOW);
+		setBlockImage(95, 5, t.GLASS_LIME);
+		setBlockImage(95, 6, t.GLASS_PINK);
+		setBlockImage(95, 7, t.GLASS_GRAY);
+		setBlockImage(95, 8, t.GLASS_SILVER);
+		setBlockImage(95, 9, t.GLASS_CYAN);
+		setBlockImage(95, 10, t.GLASS_PURPLE);
+		setBlockImage(95, 11, t.GLASS_BLUE);
+		setBlockImage(95, 12, t.GLASS_BROWN);
+		setBlockImage(95, 13, t.GLASS_GREEN);
+		setBlockImage(95, 14, t.GLASS_RED);
+		setBlockImage(95, 15, t.GLASS_BLACK);
+		// --
+		createTrapdoor(96, t.TRAPDOOR); // trapdoor
+		// -- monster egg
+		setBlockImage(97, 0, t.STONE); // stone
+		setBlockImage(97, 1, t.COBBLESTONE); // cobblestone
+		setBlockImage(97, 2, t.STONEBRICK); // stone brick
+		setBlockImage(97, 3, t.STONEBRICK_MOSSY); // mossy stone brick
+		setBlockImage(97, 4, t.STONEBRICK_CRACKED); // cracked stone brick
+		setBlockImage(97, 5, t.STONEBRICK_CARVED); // chiseled stone brick
+		// --
+	});
+	tasks.push_back([&]() {
+		// -- stone bricks
+		setBlockImage(98, 0, t.STONEBRICK); // normal
+		setBlockImage(98, 1, t.STONEBRICK_MOSSY); // mossy
+		setBlockImage(98, 2, t.STONEBRICK_CRACKED); // cracked
+		setBlockImage(98, 3, t.STONEBRICK_CARVED); // chiseled
+		// --
+		createHugeMushroom(99, t.MUSHROOM_BLOCK_SKIN_BROWN); // huge brown mushroom
+		createHugeMushroom(100, t.MUSHROOM_BLOCK_SKIN_RED); // huge red mushroom
+		createBarsPane(101, 0, t.IRON_BARS); // iron bars
+		createBarsPane(102, 0, t.GLASS); // glass pane
+		setBlockImage(103, 0, t.MELON_TOP); // melon
+		createStem(104); // pumpkin stem
+		createStem(105); // melon stem
+		createVines(); // id 106
+		createFenceGate(107, t.PLANKS_OAK); // oak fence gate
+		createStairs(108, t.BRICK); // brick stairs
+		createStairs(109, t.STONEBRICK); // stone brick stairs
+		setBlockImage(110, 0, t.MYCELIUM_TOP); // mycelium
+		// -- lily pad
+		setBlockImage(111, 0, t.WATERLILY);
+		setBlockImage(111, 1, t.WATERLILY.rotate(3));
+		setBlockImage(111, 2, t.WATERLILY.rotate(2));
+		setBlockImage(111, 3, t.WATERLILY.rotate(1));
+		// --
+		setBlockImage(112, 0, t.NETHER_BRICK); // nether brick
+		createFence(113, 0, t.NETHER_BRICK); // nether brick fence
+		createStairs(114, t.NETHER_BRICK); // nether brick stairs
+		// -- nether wart
+		createItemStyleBlock(115, 0, t.NETHER_WART_STAGE_0);
+		createItemStyleBlock(115, 1, t.NETHER_WART_STAGE_1);
+		createItemStyleBlock(115, 2, t.NETHER_WART_STAGE_1);
+		createItemStyleBlock(115, 3, t.NETHER_WART_STAGE_2);
+		// --
+		setBlockImage(116, 0, t.ENCHANTING_TABLE_TOP); // enchantment table
+		// -- brewing stand
+		RGBAImage brewing_stand = t.BREWING_STAND_BASE;
+		brewing_stand.alphaBlit(t.BREWING_STAND, 0, 0);
+		AbstractBlockImages::setBlockImage(117, 0, brewing_stand);
+		// --
+		// -- cauldron
+		RGBAImage cauldron = t.CAULDRON_INNER, cauldron_water = cauldron;
+		cauldron.alphaBlit(t.CAULDRON_TOP, 0, 0);
+		cauldron_water.alphaBlit(water, 0, 0);
+		cauldron_water.alphaBlit(t.CAULDRON_TOP, 0, 0);
+		setBlockImage(118, 0, cauldron);
+		setBlockImage(118, 1, cauldron_water);
+		setBlockImage(118, 2, cauldron_water);
+		setBlockImage(118, 3, cauldron_water);
+		// --
+		setBlockImage(119, 0, resources.getEndportalTexture()); // end portal
+		setBlockImage(120, 0, t.ENDFRAME_TOP); // end portal frame
+		setBlockImage(121, 0, t.END_STONE); // end stone
+		setBlockImage(122, 0, t.DRAGON_EGG); // dragon egg
+		createItemStyleBlock(123, 0, t.REDSTONE_LAMP_OFF); // redstone lamp inactive
+		createItemStyleBlock(124, 0, t.REDSTONE_LAMP_ON); // redstone lamp active
+		// // double wooden slabs
+		setBlockImage(125, 0, t.PLANKS_OAK);
+		setBlockImage(125, 1, t.PLANKS_SPRUCE);
+		setBlockImage(125, 2, t.PLANKS_BIRCH);
+		setBlockImage(125, 3, t.PLANKS_JUNGLE);
+		setBlockImage(125, 4, t.PLANKS_ACACIA);
+		setBlockImage(125, 5, t.PLANKS_BIG_OAK);
+		// --
+		// normal wooden slabs --
+		setBlockImage(126, 0, t.PLANKS_OAK);
+		setBlockImage(126, 1, t.PLANKS_SPRUCE);
+		setBlockImage(126, 2, t.PLANKS_BIRCH);
+		setBlockImage(126, 3, t.PLANKS_JUNGLE);
+		setBlockImage(126, 4, t.PLANKS_ACACIA);
+		setBlockImage(126, 5, t.PLANKS_BIG_OAK);
+		// --
+		createCocoas(); // id 127 // cocoas
+		createStairs(128, t.SANDSTONE_NORMAL, t.SANDSTONE_TOP); // sandstone stairs
+		setBlockImage(129, 0, t.EMERALD_ORE);
+		createChest(130, resources.getEnderChest()); // ender chest
+		createTripwireHook(); // id 131 // tripwire hook
+		createRedstoneWire(132, 0, 192, 192, 192); // tripwire
+		setBlockImage(133, 0, t.EMERALD_BLOCK); // block of emerald
+		createStairs(134, t.PLANKS_SPRUCE); // spruce wood stairs
+		createStairs(135, t.PLANKS_BIRCH); // birch wood stairs
+		createStairs(136, t.PLANKS_JUNGLE); // jungle wood stairs
+		createCommandBlock(137, t.COMMAND_BLOCK_FRONT, t.COMMAND_BLOCK_BACK,
+				t.COMMAND_BLOCK_SIDE, t.COMMAND_BLOCK_CONDITIONAL); // command block
+	});
+	tasks.push_back([&]() {
+		// -- beacon
+		RGBAImage beacon = t.OBSIDIAN, beacon_block;
+		int beacon_size = texture_size / 16.0 * 10;
+		if (beacon_size % 2)
+			beacon_size--; // odd sizes suck
+		t.BEACON.clip(1, 1, texture_size - 2, texture_size - 2).resize(beacon_block, beacon_size, beacon_size);
+		beacon.alphaBlit(beacon_block, (texture_size - beacon_size) / 2, (texture_size - beacon_size) / 2);
+		beacon.alphaBlit(t.GLASS, 0, 0);
+		setBlockImage(138, 0, beacon);
+		// --
+		createFence(139, 0, t.COBBLESTONE, 8, 6); // cobblestone wall
+		createFence(139, 1, t.COBBLESTONE_MOSSY, 8, 6); // cobblestone wall mossy
+		createFlowerPot(); // id 140 // flower pot
+		// carrots --
+		createItemStyleBlock(141, 0, t.CARROTS_STAGE_0);
+		createItemStyleBlock(141, 1, t.CARROTS_STAGE_0);
+		createItemStyleBlock(141, 2, t.CARROTS_STAGE_1);
+		createItemStyleBlock(141, 3, t.CARROTS_STAGE_1);
+		createItemStyleBlock(141, 4, t.CARROTS_STAGE_2);
+		createItemStyleBlock(141, 5, t.CARROTS_STAGE_2);
+		createItemStyleBlock(141, 6, t.CARROTS_STAGE_2);
+		createItemStyleBlock(141, 7, t.CARROTS_STAGE_3);
+		// --
+		// potatoes --
+		createItemStyleBlock(142, 0, t.POTATOES_STAGE_0);
+		createItemStyleBlock(142, 1, t.POTATOES_STAGE_0);
+		createItemStyleBlock(142, 2, t.POTATOES_STAGE_1);
+		createItemStyleBlock(142, 3, t.POTATOES_STAGE_1);
+		createItemStyleBlock(142, 4, t.POTATOES_STAGE_2);
+		createItemStyleBlock(142, 5, t.POTATOES_STAGE_2);
+		createItemStyleBlock(142, 6, t.POTATOES_STAGE_2);
+		createItemStyleBlock(142, 7, t.POTATOES_STAGE_3);
+		// --
+		createButton(143, t.PLANKS_OAK); // wooden button
+		// id 144 // head
+		// -- anvil
+		setBlockImage(145, 0, t.ANVIL_TOP_DAMAGED_0);
+		setBlockImage(145, 1, t.ANVIL_TOP_DAMAGED_0.rotate(1));
+		setBlockImage(145, 2, t.ANVIL_TOP_DAMAGED_0);
+		setBlockImage(145, 3, t.ANVIL_TOP_DAMAGED_0.rotate(1));
+		setBlockImage(145, 4, t.ANVIL_TOP_DAMAGED_1);
+		setBlockImage(145, 5, t.ANVIL_TOP_DAMAGED_1.rotate(1));
+		setBlockImage(145, 6, t.ANVIL_TOP_DAMAGED_1);
+		setBlockImage(145, 7, t.ANVIL_TOP_DAMAGED_1.rotate(1));
+		setBlockImage(145, 8, t.ANVIL_TOP_DAMAGED_2);
+		setBlockImage(145, 9, t.ANVIL_TOP_DAMAGED_2.rotate(1));
+		setBlockImage(145, 10, t.ANVIL_TOP_DAMAGED_2);
+		setBlockImage(145, 11, t.ANVIL_TOP_DAMAGED_2.rotate(1));
+		// --
+		createChest(146, resources.getTrappedChest()); // trapped chest
+		createDoubleChest(146, resources.getTrappedDoubleChest()); // double trapped chest
+		setBlockImage(147, 0, t.GOLD_BLOCK); // weighted pressure plate (light) // TODO
+		setBlockImage(148, 0, t.GOLD_BLOCK); // weighted pressure plate (heavy) // TODO
+		// redstone comparator (inactive) --
+		setBlockImage(149, 0, t.COMPARATOR_OFF);
+		setBlockImage(149, 1, t.COMPARATOR_OFF.rotate(1));
+		setBlockImage(149, 2, t.COMPARATOR_OFF.rotate(2));
+		setBlockImage(149, 3, t.COMPARATOR_OFF.rotate(3));
+		// --
+		// redstone comparator (active)
+		setBlockImage(150, 0, t.COMPARATOR_ON);
+		setBlockImage(150, 1, t.COMPARATOR_ON.rotate(1));
+		setBlockImage(150, 2, t.COMPARATOR_ON.rotate(2));
+		setBlockImage(150, 3, t.COMPARATOR_ON.rotate(3));
+		// --
+		setBlockImage(151, 0, t.DAYLIGHT_DETECTOR_TOP); // daylight sensor
+		setBlockImage(152, 0, t.REDSTONE_BLOCK); // block of redstone
+		setBlockImage(153, 0, t.QUARTZ_ORE); // quartz ore
+		// -- hopper
+		RGBAImage hopper = t.HOPPER_INSIDE;
+		hopper.alphaBlit(t.HOPPER_TOP, 0, 0);
+		setBlockImage(154, 0, hopper);
+		// --
+		// block of quartz --
+		setBlockImage(155, 0, t.QUARTZ_BLOCK_TOP);
+		setBlockImage(155, 1, t.QUARTZ_BLOCK_CHISELED_TOP);
+		setBlockImage(155, 2, t.QUARTZ_BLOCK_LINES_TOP);
+		setBlockImage(155, 3, t.QUARTZ_BLOCK_LINES);
+		setBlockImage(155, 4, t.QUARTZ_BLOCK_LINES.rotate(ROTATE_90));
+		// --
+		createStairs(156, t.QUARTZ_BLOCK_SIDE); // quartz stairs
+	});
+	tasks.push_back([&]() {
+		createStraightRails(157, 0, t.RAIL_ACTIVATOR); // activator rail
+		createDispenserDropper(158, t.DROPPER_FRONT_HORIZONTAL); // dropper
+		// stained clay --
+		setBlockImage(159, 0, t.HARDENED_CLAY_STAINED_WHITE);
+		setBlockImage(159, 1, t.HARDENED_CLAY_STAINED_ORANGE);
+		setBlockImage(159, 2, t.HARDENED_CLAY_STAINED_MAGENTA);
+		setBlockImage(159, 3, t.HARDENED_CLAY_STAINED_LIGHT_BLUE);
+		setBlockImage(159, 4, t.HARDENED_CLAY_STAINED_YELLOW);
+		setBlockImage(159, 5, t.HARDENED_CLAY_STAINED_LIME);
+		setBlockImage(159, 6, t.HARDENED_CLAY_STAINED_PINK);
+		setBlockImage(159, 7, t.HARDENED_CLAY_STAINED_GRAY);
+		setBlockImage(159, 8, t.HARDENED_CLAY_STAINED_SILVER);
+		setBlockImage(159, 9, t.HARDENED_CLAY_STAINED_CYAN);
+		setBlockImage(159, 10, t.HARDENED_CLAY_STAINED_PURPLE);
+		setBlockImage(159, 11, t.HARDENED_CLAY_STAINED_BLUE);
+		setBlockImage(159, 12, t.HARDENED_CLAY_STAINED_BROWN);
+		setBlockImage(159, 13, t.HARDENED_CLAY_STAINED_GREEN);
+		setBlockImage(159, 14, t.HARDENED_CLAY_STAINED_RED);
+		setBlockImage(159, 15, t.HARDENED_CLAY_STAINED_BLACK);
+		// --
+		// stained glass pane --
+		createBarsPane(160, 0, t.GLASS_WHITE);
+		createBarsPane(160, 1, t.GLASS_ORANGE);
+		createBarsPane(160, 2, t.GLASS_MAGENTA);
+		createBarsPane(160, 3, t.GLASS_LIGHT_BLUE);
+		createBarsPane(160, 4, t.GLASS_YELLOW);
+		createBarsPane(160, 5, t.GLASS_LIME);
+		createBarsPane(160, 6, t.GLASS_PINK);
+		createBarsPane(160, 7, t.GLASS_GRAY);
+		createBarsPane(160, 8, t.GLASS_SILVER);
+		createBarsPane(160, 9, t.GLASS_CYAN);
+		createBarsPane(160, 10, t.GLASS_PURPLE);
+		createBarsPane(160, 11, t.GLASS_BLUE);
+		createBarsPane(160, 12, t.GLASS_BROWN);
+		createBarsPane(160, 13, t.GLASS_GREEN);
+		createBarsPane(160, 14, t.GLASS_RED);
+		createBarsPane(160, 15, t.GLASS_BLACK);
+		// --
+		setBlockImage(161, 0, t.LEAVES_ACACIA); // acacia leaves
+		setBlockImage(161, 1, t.LEAVES_BIG_OAK); // dark oak leaves
+		// some more wood --
+		createWood(162, 0, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // acacia
+		createWood(162, 1, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // acacia (placeholder)
+		createWood(162, 2, t.LOG_ACACIA, t.LOG_ACACIA_TOP); // dark wood
+		createWood(162, 3, t.LOG_BIG_OAK, t.LOG_BIG_OAK_TOP); // dark wood (placeholder)
+		// --
+		createStairs(163, t.PLANKS_ACACIA); // acacia wood stairs
+		createStairs(164, t.PLANKS_BIG_OAK); // dark oak wood stairs
+		setBlockImage(165, 0, t.SLIME); // slime block
+		setBlockImage(166, 0, empty_texture); // barrier
+		createTrapdoor(167, t.IRON_TRAPDOOR); // iron trapdoor
+		// prismarine --
+		setBlockImage(168, 0, t.PRISMARINE_ROUGH);
+		setBlockImage(168, 1, t.PRISMARINE_BRICKS);
+		setBlockImage(168, 2, t.PRISMARINE_DARK);
+		// --
+		setBlockImage(169, 0, t.SEA_LANTERN); // sea lantern
+		// hay block --
+		setBlockImage(170, 0, t.HAY_BLOCK_TOP); // normal orientation
+		setBlockImage(170, 4, t.HAY_BLOCK_SIDE); // east-west
+		setBlockImage(170, 8, t.HAY_BLOCK_SIDE.rotate(1)); // north-south
+		// --
+		// carpet --
+		setBlockImage(171, 0, t.WOOL_COLORED_WHITE);
+		setBlockImage(171, 1, t.WOOL_COLORED_ORANGE);
+		setBlockImage(171, 2, t.WOOL_COLORED_MAGENTA);
+		setBlockImage(171, 3, t.WOOL_COLORED_LIGHT_BLUE);
+		setBlockImage(171, 4, t.WOOL_COLORED_YELLOW);
+		setBlockImage(171, 5, t.WOOL_COLORED_LIME);
+		setBlockImage(171, 6, t.WOOL_COLORED_PINK);
+		setBlockImage(171, 7, t.WOOL_COLORED_GRAY);
+		setBlockImage(171, 8, t.WOOL_COLORED_SILVER);
+		setBlockImage(171, 9, t.WOOL_COLORED_CYAN);
+		setBlockImage(171, 10, t.WOOL_COLORED_PURPLE);
+		setBlockImage(171, 11, t.WOOL_COLORED_BLUE);
+		setBlockImage(171, 12, t.WOOL_COLORED_BROWN);
+		setBlockImage(171, 13, t.WOOL_COLORED_GREEN);
+		setBlockImage(171, 14, t.WOOL_COLORED_RED);
+		setBlockImage(171, 15, t.WOOL_COLORED_BLACK);
+		// --
+	});
+	tasks.push_back([&]() {
+		setBlockImage(172, 0, t.HARDENED_CLAY); // hardened clay
+		setBlockImage(173, 0, t.COAL_BLOCK); // block of coal
+		setBlockImage(174, 0, t.ICE_PACKED); // packed ice
+		// large plants, id 175 --
+		// the top texture of the sunflower is a bit modified
+		RGBAImage sunflower_top = t.DOUBLE_PLANT_SUNFLOWER_TOP;
+		sunflower_top.alphaBlit(t.DOUBLE_PLANT_SUNFLOWER_FRONT, 0, -texture_size * 0.25);
+		createLargePlant(0, t.DOUBLE_PLANT_SUNFLOWER_BOTTOM, sunflower_top);
+		createLargePlant(1, t.DOUBLE_PLANT_SYRINGA_BOTTOM, t.DOUBLE_PLANT_SYRINGA_TOP);
+		createLargePlant(2, t.DOUBLE_PLANT_GRASS_BOTTOM, t.DOUBLE_PLANT_GRASS_TOP);
+		createLargePlant(3, t.DOUBLE_PLANT_FERN_BOTTOM, t.DOUBLE_PLANT_FERN_TOP);
+		createLargePlant(4, t.DOUBLE_PLANT_ROSE_BOTTOM, t.DOUBLE_PLANT_ROSE_TOP);
+		createLargePlant(5, t.DOUBLE_PLANT_PAEONIA_BOTTOM, t.DOUBLE_PLANT_PAEONIA_TOP);
+		// --
+		// id 176 // standing banner
+		// id 177 // wall banner
+		setBlockImage(178, 0, t.DAYLIGHT_DETECTOR_INVERTED_TOP); // inverted daylight sensor
+		// -- red sandstone
+		setBlockImage(179, 0, t.RED_SANDSTONE_TOP); // normal
+		setBlockImage(179, 1, t.RED_SANDSTONE_TOP); // chiseled
+		setBlockImage(179, 2, t.RED_SANDSTONE_TOP); // smooth
+		// --
+		createStairs(180, t.RED_SANDSTONE_NORMAL, t.RED_SANDSTONE_TOP); // red sandstone stairs
+		// double red sandstone slabs --
+		setBlockImage(181, 0, t.RED_SANDSTONE_TOP);
+		// --
+		createFenceGate(183, t.PLANKS_SPRUCE); // spruce fence gate
+		createFenceGate(184, t.PLANKS_BIRCH); // birch fence gate
+		createFenceGate(185, t.PLANKS_JUNGLE); // jungle fence gate
+		createFenceGate(186, t.PLANKS_BIG_OAK); // dark oak fence gate
+		createFenceGate(187, t.PLANKS_ACACIA); // acacia fence gate
+		createFence(188, 0, t.PLANKS_SPRUCE); // spruce fence
+		createFence(189, 0, t.PLANKS_BIRCH); // birch fence
+		createFence(190, 0, t.PLANKS_JUNGLE); // jungle fence
+		createFence(191, 0, t.PLANKS_BIG_OAK); // dark oak fence
+		createFence(192, 0, t.PLANKS_ACACIA); // acacia fence
+		createDoor(193, t.DOOR_SPRUCE_LOWER, t.DOOR_SPRUCE_UPPER); // spruce door
+		createDoor(194, t.DOOR_BIRCH_LOWER, t.DOOR_BIRCH_UPPER); // birch door
+		createDoor(195, t.DOOR_JUNGLE_LOWER, t.DOOR_JUNGLE_UPPER); // jungle door
+		createDoor(196, t.DOOR_ACACIA_LOWER, t.DOOR_ACACIA_UPPER); // acacia door
+		createDoor(197, t.DOOR_DARK_OAK_LOWER, t.DOOR_DARK_OAK_UPPER); // dark oak door
+		createEndRod(); // id 198
+		setBlockImage(199, 0, t.CHORUS_PLANT); // chrous plant
+		// chorus flower --
+		setBlockImage(200, 0, t.CHORUS_FLOWER);
+		setBlockImage(200, 1, t.CHORUS_FLOWER);
+		setBlockImage(200, 2, t.CHORUS_FLOWER);
+		setBlockImage(200, 3, t.CHORUS_FLOWER);
+		setBlockImage(200, 4, t.CHORUS_FLOWER);
+		setBlockImage(200, 5, t.CHORUS_FLOWER_DEAD);
+		// --
+		setBlockImage(201, 0, t.PURPUR_BLOCK); // purpur block
+		// purpur pillar --
+		// TODO is the official data like this or are there also other combination? 0, 4, 8 seems odd...
+		setBlockImage(202, 0, t.PURPUR_PILLAR_TOP); // vertically
+		setBlockImage(202, 4, t.PURPUR_PILLAR.rotate(1)); // east-west
+		setBlockImage(202, 8, t.PURPUR_PILLAR); // north-south
+		// --
+		createStairs(203, t.PURPUR_BLOCK); // purpur stairs
+		setBlockImage(204, 0, t.PURPUR_BLOCK); // purpur double slab
+		setBlockImage(205, 0, t.PURPUR_BLOCK); // purpur slab
+		setBlockImage(206, 0, t.END_BRICKS); // end stone bricks
+		// beetroot seeds --
+		createItemStyleBlock(207, 0, t.BEETROOTS_STAGE_0);
+		createItemStyleBlock(207, 1, t.BEETROOTS_STAGE_1);
+		createItemStyleBlock(207, 2, t.BEETROOTS_STAGE_2);
+		createItemStyleBlock(207, 3, t.BEETROOTS_STAGE_3);
+		// --
+		setBlockImage(208, 0, t.GRASS_PATH_TOP); // grass path
+		setBlockImage(209, 0, resources.getEndportalTexture()); // end gateway
+		createCommandBlock(210, t.REPEATING_COMMAND_BLOCK_FRONT, t.REPEATING_COMMAND_BLOCK_BACK,
+				t.REPEATING_COMMAND_BLOCK_SIDE, t.REPEATING_COMMAND_BLOCK_CONDITIONAL); // id 210
+		createCommandBlock(211, t.CHAIN_COMMAND_BLOCK_FRONT, t.CHAIN_COMMAND_BLOCK_BACK,
+				t.CHAIN_COMMAND_BLOCK_SIDE, t.CHAIN_COMMAND_BLOCK_CONDITIONAL); // id 211
+		// frosted ice --
+		setBlockImage(212, 0, t.FROSTED_ICE_0);
+		setBlockImage(212, 1, t.FROSTED_ICE_1);
+		setBlockImage(212, 2, t.FROSTED_ICE_2);
+		setBlockImage(212, 3, t.FROSTED_ICE_3);
+		// --
+		setBlockImage(213, 0, t.MAGMA); // magma
+	});
+	tasks.push_back([&]() {
+		setBlockImage(214, 0, t.NETHER_WART_BLOCK); // nether wart block
+		setBlockImage(215, 0, t.RED_NETHER_BRICK); // red nether brick
+		// bone block --
+		setBlockImage(216, 0, t.BONE_BLOCK_TOP); // vertically
+		setBlockImage(216, 4, t.BONE_BLOCK_SIDE); // east-west
+		setBlockImage(216, 8, t.BONE_BLOCK_SIDE); // north-south
+		// observer --
+		setBlockImage(218, 0, t.OBSERVER_BACK);
+		setBlockImage(218, 1, t.OBSERVER_FRONT.rotate(ROTATE_180));
+		setBlockImage(218, 2, t.OBSERVER_TOP.rotate(ROTATE_180));
+		setBlockImage(218, 3, t.OBSERVER_TOP);
+		setBlockImage(218, 4, t.OBSERVER_TOP.rotate(ROTATE_90));
+		setBlockImage(218, 5, t.OBSERVER_TOP.rotate(ROTATE_270));
+		// shulker boxes --
+		for (uint16_t i = 0; i < 16; i++) {
+			setBlockImage((uint16_t) (219 + i), 0, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::BOTTOM].flip(true, false).rotate(ROTATE_180));
+			setBlockImage((uint16_t) (219 + i), 1, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::TOP]);
+			setBlockImage((uint16_t) (219 + i), 2, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE]); // north
+			setBlockImage((uint16_t) (219 + i), 3, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE].rotate(ROTATE_180)); // south
+			setBlockImage((uint16_t) (219 + i), 4, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE].rotate(ROTATE_270)); // west
+			setBlockImage((uint16_t) (219 + i), 5, resources.getShulkerBoxTextures()[i * ShulkerTextures::DATA_SIZE + ShulkerTextures::SIDE].rotate(ROTATE_90)); // east
+		}
+		// glazed terracotta --
+		createGlazedTerracotta(235, t.GLAZED_TERRACOTTA_WHITE); // white
+		createGlazedTerracotta(236, t.GLAZED_TERRACOTTA_ORANGE); // orange
+		createGlazedTerracotta(237, t.GLAZED_TERRACOTTA_MAGENTA); // magenta
+		createGlazedTerracotta(238, t.GLAZED_TERRACOTTA_LIGHT_BLUE); // light blue
+		createGlazedTerracotta(239, t.GLAZED_TERRACOTTA_YELLOW); // yellow
+		createGlazedTerracotta(240, t.GLAZED_TERRACOTTA_LIME); // lime
+		createGlazedTerracotta(241, t.GLAZED_TERRACOTTA_PINK); // pink
+		createGlazedTerracotta(242, t.GLAZED_TERRACOTTA_GRAY); // gray
+		createGlazedTerracotta(243, t.GLAZED_TERRACOTTA_SILVER); // light gray
+		createGlazedTerracotta(244, t.GLAZED_TERRACOTTA_CYAN); // cyan
+		createGlazedTerracotta(245, t.GLAZED_TERRACOTTA_PURPLE); // purple
+		createGlazedTerracotta(246, t.GLAZED_TERRACOTTA_BLUE); // blue
+		createGlazedTerracotta(247, t.GLAZED_TERRACOTTA_BROWN); // brown
+		createGlazedTerracotta(248, t.GLAZED_TERRACOTTA_GREEN); // green
+		createGlazedTerracotta(249, t.GLAZED_TERRACOTTA_RED); // red
+		createGlazedTerracotta(250, t.GLAZED_TERRACOTTA_BLACK); // black
+		// concrete --
+		setBlockImage(251, 0, t.CONCRETE_WHITE); // white
+		setBlockImage(251, 1, t.CONCRETE_ORANGE); // orange
+		setBlockImage(251, 2, t.CONCRETE_MAGENTA); // magenta
+		setBlockImage(251, 3, t.CONCRETE_LIGHT_BLUE); // light blue
+		setBlockImage(251, 4, t.CONCRETE_YELLOW); // yellow
+		setBlockImage(251, 5, t.CONCRETE_LIME); // lime
+		setBlockImage(251, 6, t.CONCRETE_PINK); // pink
+		setBlockImage(251, 7, t.CONCRETE_GRAY); // gray
+		setBlockImage(251, 8, t.CONCRETE_SILVER); // light gray
+		setBlockImage(251, 9, t.CONCRETE_CYAN); // cyan
+		setBlockImage(251, 10, t.CONCRETE_PURPLE); // purple
+		setBlockImage(251, 11, t.CONCRETE_BLUE); // blue
+		setBlockImage(251, 12, t.CONCRETE_BROWN); // brown
+		setBlockImage(251, 13, t.CONCRETE_GREEN); // green
+		setBlockImage(251, 14, t.CONCRETE_RED); // red
+		setBlockImage(251, 15, t.CONCRETE_BLACK); // black
+		// concrete powder --
+		setBlockImage(252, 0, t.CONCRETE_POWDER_WHITE); // white
+		setBlockImage(252, 1, t.CONCRETE_POWDER_ORANGE); // orange
+		setBlockImage(252, 2, t.CONCRETE_POWDER_MAGENTA); // magenta
+		setBlockImage(252, 3, t.CONCRETE_POWDER_LIGHT_BLUE); // light blue
+		setBlockImage(252, 4, t.CONCRETE_POWDER_YELLOW); // yellow
+		setBlockImage(252, 5, t.CONCRETE_POWDER_LIME); // lime
+		setBlockImage(252, 6, t.CONCRETE_POWDER_PINK); // pink
+		setBlockImage(252, 7, t.CONCRETE_POWDER_GRAY); // gray
+		setBlockImage(252, 8, t.CONCRETE_POWDER_SILVER); // light gray
+		setBlockImage(252, 9, t.CONCRETE_POWDER_CYAN); // cyan
+		setBlockImage(252, 10, t.CONCRETE_POWDER_PURPLE); // purple
+		setBlockImage(252, 11, t.CONCRETE_POWDER_BLUE); // blue
+		setBlockImage(252, 12, t.CONCRETE_POWDER_BROWN); // brown
+		setBlockImage(252, 13, t.CONCRETE_POWDER_GREEN); // green
+		setBlockImage(252, 14, t.CONCRETE_POWDER_RED); // red
+		setBlockImage(252, 15, t.CONCRETE_POWDER_BLACK); // black
+		// --
+		setBlockImage(217, 0, empty_texture); // structure void
+		// structure block --
+		setBlockImage(255, 0, t.STRUCTURE_BLOCK_SAVE);
+		setBlockImage(255, 1, t.STRUCTURE_BLOCK_LOAD);
+		setBlockImage(255, 2, t.STRUCTURE_BLOCK_CORNER);
+		setBlockImage(255, 3, t.STRUCTURE_BLOCK_DATA);
+		// --
+	});
+	runBlockTasks(tasks);
 }
 
 int TopdownBlockImages::createOpaqueWater() {
@@ -32,9 +32,13 @@ public:
 
 	virtual const RGBAImage& getOpaqueWater(bool south, bool west) const;
 
+	virtual uint32_t getBiomeColor(uint16_t id, uint16_t data, const BiomeColors& colors) const;
+
 	virtual int getBlockSize() const;
 
 protected:
+	virtual std::string getCacheKey(const TextureResources& resources) const;
+
 	void createItemStyleBlock(uint16_t id, uint16_t data, const RGBAImage& texture);
 	void createSideFaceBlock(uint16_t id, uint16_t data, int face, const RGBAImage& texture);
 	void createRotatedBlock(uint16_t id, uint16_t extra_data, const RGBAImage& texture);
@@ -80,7 +84,7 @@ protected:
 	virtual void setBlockImage(uint16_t id, uint16_t data, const RGBAImage& block);
 
 	virtual RGBAImage createUnknownBlock() const;
-	virtual RGBAImage createBiomeBlock(uint16_t id, uint16_t data, const Biome& biome) const;
+	virtual RGBAImage createBiomeBlock(uint16_t id, uint16_t data, uint32_t color) const;
 
 	virtual void createBlocks();
 	virtual int createOpaqueWater();
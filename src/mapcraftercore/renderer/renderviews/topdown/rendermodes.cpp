@@ -47,17 +47,16 @@ void TopdownLightingRenderer::lightTop(RGBAImage& image, const CornerColors& col
 		int yoff) const {
 	assert(image.getWidth() == image.getHeight());
 	int size = image.getWidth();
-	RGBAImage shade(size, size);
-	createShade(shade, colors);
-	for (int x = 0; x < size; x++) {
-		for (int y = 0; y < size; y++) {
-			uint32_t& pixel = image.pixel(x, y);
-			if (pixel != 0) {
-				uint8_t d = rgba_alpha(shade.pixel(x, y));
-				pixel = rgba_multiply(pixel, d, d, d);
-			}
+	createShade(size, colors);
+	if (face.size() != (size_t) (size * size)) {
+		// the shade maps just to the whole block image
+		face.clear();
+		for (int i = 0; i < size * size; i++) {
+			FacePixel pixel = {i, i, i / size};
+			face.push_back(pixel);
 		}
 	}
+	applyShade(image, face);
 }
 
 void TopdownOverlayRenderer::tintLeft(RGBAImage& image, RGBAPixel color) const {
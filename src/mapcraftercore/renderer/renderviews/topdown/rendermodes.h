@@ -39,6 +39,10 @@ public:
 	virtual void lightRight(RGBAImage& image, const CornerColors& colors) const;
 
 	virtual void lightTop(RGBAImage& image, const CornerColors& colors, int yoff) const;
+
+private:
+	// the face pixels of the top face (the whole block image) of the current block size
+	mutable std::vector<FacePixel> face;
 };
 
 class TopdownOverlayRenderer : public OverlayRenderer {
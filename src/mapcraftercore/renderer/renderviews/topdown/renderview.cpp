@@ -25,6 +25,9 @@
 #include "rendermodes.h"
 #include "../../rendermode.h"
 #include "../../rendermodes/overlay.h"
+#include "../../../config/configsections/map.h"
+
+#include <cassert>
 
 namespace mapcrafter {
 namespace renderer {
@@ -51,5 +54,17 @@ RenderModeRenderer* TopdownRenderView::createRenderModeRenderer(
 	return nullptr;
 }
 
+void TopdownRenderView::configureTileRenderer(TileRenderer* tile_renderer,
+		const config::WorldSection& world_config,
+		const config::MapSection& map_config) const {
+	assert(tile_renderer != nullptr);
+	RenderView::configureTileRenderer(tile_renderer, world_config, map_config);
+
+	TopdownTileRenderer* renderer = dynamic_cast<TopdownTileRenderer*>(tile_renderer);
+	assert(renderer != nullptr);
+	renderer->setRenderBlockColors(map_config.renderBlockColors(),
+			map_config.useHeightShading());
+}
+
 } /* namespace renderer */
 } /* namespace mapcrafter */
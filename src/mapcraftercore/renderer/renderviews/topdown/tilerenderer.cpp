@@ -28,7 +28,7 @@
 #include "../../../mc/worldcache.h"
 #include "../../../util.h"
 
-#include <deque>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -42,19 +42,46 @@ namespace renderer {
 TopdownTileRenderer::TopdownTileRenderer(const RenderView* render_view,
 		BlockImages* images, int tile_width, mc::WorldCache* world,
 		RenderMode* render_mode)
-	: TileRenderer(render_view, images, tile_width, world, render_mode) {
+	: TileRenderer(render_view, images, tile_width, world, render_mode),
+	  render_block_colors(false), height_shading(false) {
 }
 
 TopdownTileRenderer::~TopdownTileRenderer() {
 }
 
+void TopdownTileRenderer::setRenderBlockColors(bool render_block_colors,
+		bool height_shading) {
+	this->render_block_colors = render_block_colors;
+	this->height_shading = height_shading;
+}
+
 namespace {
 
-struct RenderBlock {
-	RGBAImage block;
-	uint16_t id, data;
-	mc::BlockPos pos;
-};
+// the brightness of blocks which are higher/lower than the block north of them,
+// like on the maps in Minecraft
+const double SHADING_HIGHER = 255.0 / 220.0;
+const double SHADING_LOWER = 180.0 / 220.0;
+
+/**
+ * Returns the average color (straight alpha) of an image, the colors of the pixels are
+ * weighted with their alpha.
+ */
+RGBAPixel getAverageColor(const RGBAImage& image) {
+	uint64_t r = 0, g = 0, b = 0, a = 0;
+	int size = image.getWidth() * image.getHeight();
+	for (int y = 0; y < image.getHeight(); y++)
+		for (int x = 0; x < image.getWidth(); x++) {
+			RGBAPixel pixel = image.pixel(x, y);
+			uint64_t alpha = rgba_alpha(pixel);
+			r += rgba_red(pixel) * alpha;
+			g += rgba_green(pixel) * alpha;
+			b += rgba_blue(pixel) * alpha;
+			a += alpha;
+		}
+	if (size == 0 || a == 0)
+		return 0;
+	return rgba(r / a, g / a, b / a, a / size);
+}
 
 }
 
@@ -63,133 +90,329 @@ void TopdownTileRenderer::renderChunk(const mc::Chunk& chunk, RGBAImage& tile, i
 
 	int texture_size = images->getTextureSize();
 
+	// the candidate blocks of a column, see below
+	RenderModeBlock candidates[mc::CHUNK_HEIGHT * 16];
+	uint16_t candidates_extra_data[mc::CHUNK_HEIGHT * 16];
+	// whether there is air (or a skipped section) above a candidate
+	bool candidates_below_air[mc::CHUNK_HEIGHT * 16];
+	bool hidden[mc::CHUNK_HEIGHT * 16];
+
 	for (int x = 0; x < 16; x++) {
 		for (int z = 0; z < 16; z++) {
-			std::deque<RenderBlock> blocks;
+			// the render blocks of the column from top to bottom are the ones from
+			// column_first to column_count - 1, the ones above were replaced by
+			// preblit water
+			int column_first = 0, column_count = 0;
 
 			// TODO make this water thing a bit nicer
 			bool in_water = false;
 			int water = 0;
 
+			// start at the highest block of this column, everything above is air
 			mc::LocalBlockPos localpos(x, z, 0);
-			//int height = chunk.getHeightAt(localpos);
-			//localpos.y = height;
-			localpos.y = -1;
-			if (localpos.y >= mc::CHUNK_HEIGHT*16 || localpos.y < 0)
-				localpos.y = mc::CHUNK_HEIGHT*16 - 1;
-
-			uint16_t id = chunk.getBlockID(localpos);
-			while (id == 0 && localpos.y > 0) {
-				localpos.y--;
-				id = chunk.getBlockID(localpos);
-			}
+			localpos.y = chunk.getHighestBlock(localpos);
 			if (localpos.y < 0)
 				continue;
 
-			while (localpos.y >= 0) {
-				mc::BlockPos globalpos = localpos.toGlobalPos(chunk.getPos());
+			// the candidate blocks of the column are collected from top to bottom down to
+			// the next opaque block, then the render mode checks them at once
+			bool done = false;
+
+			// deep water at the top of the column ends up as a single preblit water block,
+			// the depth of the water is known from the chunk, so the blocks of the water
+			// don't need to be visited one by one if the render mode hides none of them
+			int max_water = images->getMaxWaterPreblit();
+			if (use_preblit_water && max_water > 0
+					&& chunk.getWaterDepth(localpos) > max_water) {
+				for (int i = 0; i <= max_water; i++) {
+					mc::LocalBlockPos waterpos(x, z, localpos.y - i);
+					candidates[i].pos = waterpos.toGlobalPos(chunk.getPos());
+					candidates[i].id = current_chunk->getBlockID(waterpos);
+					candidates[i].data = 0;
+					hidden[i] = false;
+				}
+				{
+					util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+					render_mode->isHiddenRow(candidates, max_water + 1, hidden);
+				}
+				bool *hidden_end = &hidden[max_water + 1];
+				if (std::find(&hidden[0], hidden_end, true) == hidden_end) {
+					RenderBlock& render_block = column[column_count++];
+					render_block.pos = candidates[max_water - 1].pos;
+					render_block.id = 8;
+					render_block.data = OPAQUE_WATER;
+					render_block.block = getBlockImage(render_block.pos, 8, OPAQUE_WATER, 0,
+							&chunk, image_pool);
+					done = true;
+				}
+			}
+			while (!done) {
+				int count = 0;
+				bool below_air = false;
+				while (localpos.y >= 0) {
+					// skip missing sections and sections with only air completely
+					int section = localpos.y / 16;
+					if (!current_chunk->hasSection(section)
+							|| current_chunk->isSectionAir(section)) {
+						below_air = true;
+						localpos.y = section * 16 - 1;
+						continue;
+					}
 
-				uint16_t id;
-				id = current_chunk->getBlockID(localpos);
+					uint16_t id = current_chunk->getBlockID(localpos);
+					if (id == 0) {
+						below_air = true;
+						localpos.y--;
+						continue;
+					}
 
-				if (id == 0) {
-					in_water = false;
+					RenderModeBlock& candidate = candidates[count];
+					candidate.pos = localpos.toGlobalPos(chunk.getPos());
+					candidate.id = id;
+					candidate.data = current_chunk->getBlockData(localpos);
+					candidates_extra_data[count] = current_chunk->getBlockExtraData(localpos, id);
+					candidates_below_air[count] = below_air;
+					hidden[count] = false;
+					below_air = false;
+					count++;
 					localpos.y--;
-					continue;
+					if (!images->isBlockTransparent(id, candidate.data))
+						break;
+				}
+				if (count == 0)
+					break;
+				{
+					util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+					render_mode->isHiddenRow(candidates, count, hidden);
 				}
 
-				uint16_t data, extra_data;
-				data = current_chunk->getBlockData(localpos);
-				extra_data = current_chunk->getBlockExtraData(localpos, id);
-
-				bool is_water = (id == 8 || id == 9) && data == 0;
+				for (int i = 0; i < count && !done; i++) {
+					const mc::BlockPos& globalpos = candidates[i].pos;
+					uint16_t id = candidates[i].id;
+					uint16_t data = candidates[i].data;
+					uint16_t extra_data = candidates_extra_data[i];
+					if (candidates_below_air[i])
+						in_water = false;
 
-				if (render_mode->isHidden(globalpos, id, data)) {
-					localpos.y--;
-					continue;
-				}
+					bool is_water = (id == 8 || id == 9) && data == 0;
 
-				if (is_water && !use_preblit_water) {
-					if (is_water == in_water) {
-						localpos.y--;
+					if (hidden[i])
 						continue;
-					}
-					in_water = is_water;
-				} else if (use_preblit_water) {
-					if (!is_water)
-						water = 0;
-					else {
-						water++;
-						if (water > images->getMaxWaterPreblit()) {
-							auto it = blocks.begin();
-							while (it != blocks.end()) {
-								auto current = it++;
-								if (it == blocks.end() || (it->id != 8 && it->id != 9)) {
-									RenderBlock& top = *current;
-									// blocks.erase(current);
-
-									top.id = 8;
-									top.data = OPAQUE_WATER;
-									top.block = images->getBlock(top.id, top.data);
-									render_mode->draw(top.block, top.pos, top.id, top.data);
-									// blocks.insert(current, top);
-									break;
-								} else {
-									blocks.erase(current);
+
+					if (is_water && !use_preblit_water) {
+						if (is_water == in_water)
+							continue;
+						in_water = is_water;
+					} else if (use_preblit_water) {
+						if (!is_water)
+							water = 0;
+						else {
+							water++;
+							if (water > images->getMaxWaterPreblit()) {
+								// the topmost block above the water blocks at the
+								// bottom of the column is replaced by preblit water
+								// and the ones above it are dropped
+								if (column_count > 0) {
+									int top = column_first;
+									while (top + 1 < column_count
+											&& (column[top + 1].id == 8
+												|| column[top + 1].id == 9))
+										top++;
+									column_first = top;
+									column[top].id = 8;
+									column[top].data = OPAQUE_WATER;
+									column[top].block = getBlockImage(column[top].pos,
+											8, OPAQUE_WATER, 0, &chunk, image_pool);
 								}
+								done = true;
+								break;
 							}
-							break;
 						}
 					}
-				}
 
-				data = checkNeighbors(globalpos, id, data);
-
-				RGBAImage block;
-				if (Biome::isBiomeBlock(id, data)) {
-					block = images->getBiomeBlock(id, data, getBiomeOfBlock(globalpos, &chunk), extra_data);
-				} else {
-					block = images->getBlock(id, data, extra_data);
-				}
+					data = checkNeighbors(globalpos, id, data);
 
-				render_mode->draw(block, globalpos, id, data);
-				RenderBlock render_block;
-				render_block.block = block;
-				render_block.id = id;
-				render_block.data = data;
-				render_block.pos = globalpos;
-				blocks.push_back(render_block);
+					RenderBlock& render_block = column[column_count++];
+					render_block.block = getBlockImage(globalpos, id, data, extra_data,
+							&chunk, image_pool);
+					render_block.id = id;
+					render_block.data = data;
+					render_block.pos = globalpos;
 
-				if (!images->isBlockTransparent(id, data))
-					break;
-				localpos.y--;
+					if (!images->isBlockTransparent(id, data))
+						done = true;
+				}
 			}
 
-			while (blocks.size() > 0) {
-				RenderBlock render_block = blocks.back();
-				tile.alphaBlit(render_block.block, dx + x*texture_size, dy + z*texture_size);
-				blocks.pop_back();
-			}
+			// an opaque bottom block is just copied to the part of the tile of the
+			// column, it would replace the pixels there anyway, and the blocks above
+			// it are blended onto it (the preblit water is not completely opaque)
+			util::ProfileScope profile(util::ProfileStage::BLIT);
+			int tx = dx + x*texture_size, ty = dy + z*texture_size;
+			int i = column_count - 1;
+			drawn_blocks_count += column_count - column_first;
+			if (i >= column_first && column[i].id != 8
+					&& !images->isBlockTransparent(column[i].id, column[i].data))
+				tile.simpleBlit(*column[i--].block, tx, ty);
+			for (; i >= column_first; i--)
+				tile.alphaBlitPremultiplied(*column[i].block, tx, ty);
+			image_pool.reset();
 		}
 	}
 }
 
 void TopdownTileRenderer::renderTile(const TilePos& tile_pos, RGBAImage& tile) {
+	util::ProfileScope profile(util::ProfileStage::BLOCK_ITERATION);
+	if (render_block_colors) {
+		renderBlockColorTile(tile_pos, tile);
+		return;
+	}
+
 	int texture_size = images->getTextureSize();
 	tile.setSize(getTileSize(), getTileSize());
 
+	// every chunk is rendered to its own part of the tile, so the chunks can be
+	// rendered by the part renderers concurrently
+	renderParts(tile_width * tile_width, [&](TileRenderer* renderer, int part) {
+		TopdownTileRenderer* topdown = static_cast<TopdownTileRenderer*>(renderer);
+		int x = part / tile_width, z = part % tile_width;
+		mc::ChunkPos chunkpos(tile_pos.getX() * tile_width + x, tile_pos.getY() * tile_width + z);
+		topdown->current_chunk = topdown->world->getChunk(chunkpos);
+		if (topdown->current_chunk != nullptr)
+			topdown->renderChunk(*topdown->current_chunk, tile,
+					texture_size*16*x, texture_size*16*z);
+	});
+	// the chunks are rendered with premultiplied alpha
+	tile.unpremultiplyAlpha();
+}
+
+int TopdownTileRenderer::getTileSize() const {
+	if (render_block_colors)
+		return 16 * tile_width;
+	return images->getBlockSize() * 16 * tile_width;
+}
+
+void TopdownTileRenderer::renderBlockColorTile(const TilePos& tile_pos, RGBAImage& tile) {
+	int size = 16 * tile_width;
+	tile.setSize(size, size);
+	tile.fill(0, 0, 0, size, size);
+	heights.assign((size + 1) * size, -1);
+
 	for (int x = 0; x < tile_width; x++) {
 		for (int z = 0; z < tile_width; z++) {
 			mc::ChunkPos chunkpos(tile_pos.getX() * tile_width + x, tile_pos.getY() * tile_width + z);
 			current_chunk = world->getChunk(chunkpos);
-			if (current_chunk != nullptr)
-				renderChunk(*current_chunk, tile, texture_size*16*x, texture_size*16*z);
+			if (current_chunk == nullptr)
+				continue;
+			for (int bx = 0; bx < 16; bx++)
+				for (int bz = 0; bz < 16; bz++) {
+					int px = x * 16 + bx, pz = z * 16 + bz;
+					tile.pixel(px, pz) = getColumnColor(*current_chunk, bx, bz,
+							heights[(pz + 1) * size + px]);
+				}
 		}
 	}
+	// the chunks are rendered with premultiplied alpha
+	tile.unpremultiplyAlpha();
+	if (!height_shading)
+		return;
+
+	// the heights of the southern row of the chunks north of the tile
+	for (int x = 0; x < tile_width; x++) {
+		mc::ChunkPos chunkpos(tile_pos.getX() * tile_width + x, tile_pos.getY() * tile_width - 1);
+		current_chunk = world->getChunk(chunkpos);
+		if (current_chunk == nullptr)
+			continue;
+		for (int bx = 0; bx < 16; bx++)
+			getColumnColor(*current_chunk, bx, 15, heights[x * 16 + bx]);
+	}
+
+	for (int pz = 0; pz < size; pz++)
+		for (int px = 0; px < size; px++) {
+			int height = heights[(pz + 1) * size + px];
+			int north = heights[pz * size + px];
+			if (height == -1 || north == -1 || height == north)
+				continue;
+			double factor = height > north ? SHADING_HIGHER : SHADING_LOWER;
+			RGBAPixel& pixel = tile.pixel(px, pz);
+			pixel = rgba_multiply(pixel, factor, factor, factor);
+		}
 }
 
-int TopdownTileRenderer::getTileSize() const {
-	return images->getBlockSize() * 16 * tile_width;
+RGBAPixel TopdownTileRenderer::getColumnColor(const mc::Chunk& chunk, int x, int z,
+		int& height) {
+	// the colors of the visible blocks from top to bottom
+	RGBAPixel colors[mc::CHUNK_HEIGHT];
+	int count = 0;
+	bool in_water = false;
+	height = -1;
+
+	// start at the highest block of this column, everything above is air
+	mc::LocalBlockPos localpos(x, z, 0);
+	localpos.y = chunk.getHighestBlock(localpos);
+	for (; localpos.y >= 0; localpos.y--) {
+		// skip missing sections and sections with only air completely
+		int section = localpos.y / 16;
+		if (!chunk.hasSection(section) || chunk.isSectionAir(section)) {
+			in_water = false;
+			localpos.y = section * 16;
+			continue;
+		}
+
+		uint16_t id = chunk.getBlockID(localpos);
+		if (id == 0) {
+			in_water = false;
+			continue;
+		}
+		uint16_t data = chunk.getBlockData(localpos);
+		mc::BlockPos pos = localpos.toGlobalPos(chunk.getPos());
+		if (render_mode->isHidden(pos, id, data))
+			continue;
+
+		// only the top block of water is visible
+		bool is_water = (id == 8 || id == 9) && data == 0;
+		if (is_water) {
+			if (in_water)
+				continue;
+			in_water = true;
+		}
+
+		if (height == -1)
+			height = pos.y;
+		uint16_t extra_data = chunk.getBlockExtraData(localpos, id);
+		colors[count++] = getBlockColor(pos, id, data, extra_data, chunk);
+		if (!images->isBlockTransparent(id, data))
+			break;
+	}
+
+	RGBAPixel color = 0;
+	while (count > 0)
+		blendPremultiplied(color, colors[--count]);
+	return color;
+}
+
+RGBAPixel TopdownTileRenderer::getBlockColor(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, uint16_t extra_data, const mc::Chunk& chunk) {
+	std::pair<uint64_t, uint64_t> key(id | ((uint64_t) data << 16)
+			| ((uint64_t) extra_data << 32), 0);
+	bool biome_block = Biome::isBiomeBlock(id, data);
+	BiomeColors colors;
+	if (biome_block) {
+		colors = getBiomeColorsOfBlock(pos, &chunk);
+		key.first |= (uint64_t) 1 << 48;
+		key.second = images->getBiomeColor(id, data, colors);
+	}
+
+	auto it = block_colors.find(key);
+	if (it != block_colors.end())
+		return it->second;
+	RGBAPixel color;
+	if (biome_block)
+		color = getAverageColor(images->getBiomeBlock(id, data, colors, extra_data));
+	else
+		color = getAverageColor(images->getBlock(id, data, extra_data));
+	block_colors[key] = color;
+	return color;
 }
 
 }
@@ -20,8 +20,15 @@
 #ifndef TOPDOWN_TILERENDERER_H_
 #define TOPDOWN_TILERENDERER_H_
 
+#include "../../image.h"
 #include "../../tilerenderer.h"
+#include "../../../mc/chunk.h"
+#include "../../../mc/pos.h"
 
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -29,16 +36,76 @@ namespace fs = boost::filesystem;
 namespace mapcrafter {
 namespace renderer {
 
+/**
+ * Hash function for the block colors, the keys are pairs of a block and a biome color key.
+ */
+struct block_color_hash_function {
+	size_t operator()(const std::pair<uint64_t, uint64_t>& key) const {
+		return std::hash<uint64_t>()(key.first * 31 + key.second);
+	}
+};
+
 class TopdownTileRenderer : public TileRenderer {
 public:
 	TopdownTileRenderer(const RenderView* render_view, BlockImages* images,
 			int tile_width, mc::WorldCache* world, RenderMode* render_mode);
 	~TopdownTileRenderer();
 
+	/**
+	 * Sets whether every block is rendered as one pixel with the average color of its
+	 * block image, instead of blitting the block images. The render mode only hides
+	 * blocks then, but doesn't change their colors. With height shading the pixels are
+	 * brighter or darker if their block is higher or lower than the block north of it.
+	 */
+	void setRenderBlockColors(bool render_block_colors, bool height_shading);
+
 	void renderChunk(const mc::Chunk& chunk, RGBAImage& tile, int dx, int dy);
 	virtual void renderTile(const TilePos& tile_pos, RGBAImage& tile);
 
 	virtual int getTileSize() const;
+
+private:
+	/**
+	 * Renders a tile with one pixel per block, see setRenderBlockColors.
+	 */
+	void renderBlockColorTile(const TilePos& tile_pos, RGBAImage& tile);
+
+	/**
+	 * Returns the color (premultiplied alpha) of a column of a chunk, the blended colors
+	 * of its visible blocks down to the first opaque one. The height is the one of the
+	 * highest visible block, -1 if there is none.
+	 */
+	RGBAPixel getColumnColor(const mc::Chunk& chunk, int x, int z, int& height);
+
+	/**
+	 * Returns the average color (straight alpha) of the image of a block.
+	 */
+	RGBAPixel getBlockColor(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			uint16_t extra_data, const mc::Chunk& chunk);
+
+	/**
+	 * A block of a column which is drawn on a tile.
+	 */
+	struct RenderBlock {
+		// the cached block image or a modified copy of it, see TileRenderer::getBlockImage
+		const RGBAImage* block;
+		uint16_t id, data;
+		mc::BlockPos pos;
+	};
+
+	// the render blocks of the current column from top to bottom, a column has at most
+	// one render block per block
+	RenderBlock column[mc::CHUNK_HEIGHT * 16];
+	// the modified block images of the blocks of the current column
+	ImagePool image_pool;
+
+	bool render_block_colors, height_shading;
+	// the average colors of the block images, for the key of a block (id, data, extra
+	// data, and whether it's a biome block) and the color key of its biome
+	std::unordered_map<std::pair<uint64_t, uint64_t>, RGBAPixel,
+		block_color_hash_function> block_colors;
+	// the heights of the columns of the current tile, with the row north of it first
+	std::vector<int> heights;
 };
 
 }
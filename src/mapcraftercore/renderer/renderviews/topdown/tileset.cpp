@@ -40,5 +40,14 @@ void TopdownTileSet::mapChunkToTiles(const mc::ChunkPos& chunk,
 	tiles.insert(TilePos(x, y));
 }
 
+void TopdownTileSet::mapTileToChunks(const TilePos& tile,
+		std::set<mc::ChunkPos>& chunks) {
+	int tile_width = getTileWidth();
+	for (int x = 0; x < tile_width; x++)
+		for (int z = 0; z < tile_width; z++)
+			chunks.insert(mc::ChunkPos(tile.getX() * tile_width + x,
+					tile.getY() * tile_width + z));
+}
+
 }
 }
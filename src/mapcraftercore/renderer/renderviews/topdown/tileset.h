@@ -31,6 +31,7 @@ public:
 	virtual ~TopdownTileSet();
 
 	virtual void mapChunkToTiles(const mc::ChunkPos& chunk, std::set<TilePos>& tiles);
+	virtual void mapTileToChunks(const TilePos& tile, std::set<mc::ChunkPos>& chunks);
 };
 
 }
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourceregistry.h"
+
+#include "blockimages.h"
+
+namespace mapcrafter {
+namespace renderer {
+
+ResourceRegistry::ResourceRegistry(int max_textures, int max_block_images)
+	: max_textures(max_textures), max_block_images(max_block_images), uses(0),
+	  block_images_hits(0), block_images_misses(0) {
+}
+
+ResourceRegistry::~ResourceRegistry() {
+}
+
+std::shared_ptr<TextureResources> ResourceRegistry::getTextures(
+		const std::string& texture_dir, int texture_size, int texture_blur,
+		double water_opacity, int threads) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto key = std::make_tuple(texture_dir, texture_size, texture_blur, water_opacity);
+	auto it = textures.find(key);
+	if (it != textures.end()) {
+		it->second.last_used = ++uses;
+		return it->second.value;
+	}
+
+	std::shared_ptr<TextureResources> resources = std::make_shared<TextureResources>();
+	if (!resources->loadTextures(texture_dir, texture_size, texture_blur, water_opacity,
+			threads))
+		resources.reset();
+	textures[key] = Entry<std::tuple<std::string, int, int, double>, TextureResources>{
+		resources, ++uses};
+	evict(textures, max_textures);
+	return resources;
+}
+
+std::shared_ptr<BlockImages> ResourceRegistry::getBlockImages(const std::string& key,
+		const std::function<std::shared_ptr<BlockImages>()>& create) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = block_images.find(key);
+	if (it != block_images.end()) {
+		block_images_hits++;
+		it->second.last_used = ++uses;
+		return it->second.value;
+	}
+
+	block_images_misses++;
+	std::shared_ptr<BlockImages> images = create();
+	block_images[key] = Entry<std::string, BlockImages>{images, ++uses};
+	evict(block_images, max_block_images);
+	return images;
+}
+
+int ResourceRegistry::getBlockImagesHits() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return block_images_hits;
+}
+
+int ResourceRegistry::getBlockImagesMisses() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return block_images_misses;
+}
+
+template <typename Key, typename Value>
+void ResourceRegistry::evict(std::map<Key, Entry<Key, Value> >& entries, int max) {
+	if ((int) entries.size() <= max)
+		return;
+	auto oldest = entries.begin();
+	for (auto it = entries.begin(); it != entries.end(); ++it)
+		if (it->second.last_used < oldest->second.last_used)
+			oldest = it;
+	entries.erase(oldest);
+}
+
+}
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOURCEREGISTRY_H_
+#define RESOURCEREGISTRY_H_
+
+#include "../compat/thread.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+class BlockImages;
+class TextureResources;
+
+/**
+ * The loaded textures and the generated block images of the maps, by their settings, so
+ * the maps with the same settings share them. A render manager has its own registry, the
+ * tenants of the render service share one. Only the most recently used ones are kept,
+ * the maps which still render with evicted ones keep them until they are finished. All
+ * methods are thread-safe.
+ */
+class ResourceRegistry {
+public:
+	ResourceRegistry(int max_textures = 8, int max_block_images = 16);
+	~ResourceRegistry();
+
+	/**
+	 * Returns the textures of a texture directory with some settings, loads them with a
+	 * count of threads if they aren't loaded yet. Returns nullptr if they can't be
+	 * loaded, that's remembered as well.
+	 */
+	std::shared_ptr<TextureResources> getTextures(const std::string& texture_dir,
+			int texture_size, int texture_blur, double water_opacity, int threads);
+
+	/**
+	 * Returns the block images with a key (see BlockImages::getKey), they are created
+	 * with the supplied function if there are none with that key yet. Other threads
+	 * wait meanwhile.
+	 */
+	std::shared_ptr<BlockImages> getBlockImages(const std::string& key,
+			const std::function<std::shared_ptr<BlockImages>()>& create);
+
+	/**
+	 * Returns how many times the block images were found / had to be created.
+	 */
+	int getBlockImagesHits() const;
+	int getBlockImagesMisses() const;
+
+private:
+	template <typename Key, typename Value>
+	struct Entry {
+		std::shared_ptr<Value> value;
+		uint64_t last_used;
+	};
+
+	/**
+	 * Removes the least recently used entry of a map if it has more than max entries.
+	 */
+	template <typename Key, typename Value>
+	static void evict(std::map<Key, Entry<Key, Value> >& entries, int max);
+
+	int max_textures, max_block_images;
+	// the counter of the uses of the entries, to find the least recently used ones
+	uint64_t uses;
+	int block_images_hits, block_images_misses;
+
+	// (texture dir, size, blur, water opacity) -> textures
+	std::map<std::tuple<std::string, int, int, double>,
+		Entry<std::tuple<std::string, int, int, double>, TextureResources> > textures;
+	// key -> block images
+	std::map<std::string, Entry<std::string, BlockImages> > block_images;
+
+	mutable thread_ns::mutex mutex;
+};
+
+}
+}
+
+#endif /* RESOURCEREGISTRY_H_ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilecache.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <zlib.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+TileCache::TileCache(const fs::path& cache_dir)
+	: cache_dir(cache_dir), hits(0), misses(0) {
+}
+
+TileCache::~TileCache() {
+}
+
+const fs::path& TileCache::getCacheDir() const {
+	return cache_dir;
+}
+
+bool TileCache::read(uint64_t key, RGBAImage& image) {
+	std::ifstream in(getFile(key).string().c_str(), std::ios::binary);
+	if (!in || !image.readPNG(in)) {
+		misses++;
+		return false;
+	}
+	hits++;
+	return true;
+}
+
+bool TileCache::write(uint64_t key, const RGBAImage& image) {
+	// the images are only read by the renderer, the fastest compression is enough
+	PNGOptions options;
+	options.compression_level = Z_BEST_SPEED;
+	fs::path file = getFile(key);
+	boost::system::error_code error;
+	fs::create_directories(file.parent_path(), error);
+
+	// other processes might write the same image at the same time
+	fs::path tmp_file = file.parent_path() / fs::unique_path("%%%%%%%%.tmp");
+	std::ofstream out(tmp_file.string().c_str(), std::ios::binary);
+	bool ok = image.writePNG(out, options);
+	out.close();
+	if (ok && out)
+		fs::rename(tmp_file, file, error);
+	if (!ok || !out || error) {
+		fs::remove(tmp_file, error);
+		return false;
+	}
+	return true;
+}
+
+size_t TileCache::getHits() const {
+	return hits;
+}
+
+size_t TileCache::getMisses() const {
+	return misses;
+}
+
+uint64_t TileCache::hashSettings(const std::string& settings) {
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < settings.size(); i++)
+		hash = (hash ^ (uint8_t) settings[i]) * prime;
+	return hash;
+}
+
+fs::path TileCache::getFile(uint64_t key) const {
+	std::ostringstream name;
+	name << std::hex << std::setfill('0') << std::setw(16) << key;
+	return cache_dir / name.str().substr(0, 2) / (name.str() + ".png");
+}
+
+}
+}
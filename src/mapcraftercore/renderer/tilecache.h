@@ -0,0 +1,95 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILECACHE_H_
+#define TILECACHE_H_
+
+#include "image.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * A cache of the images of render tiles, addressed by what they show instead of by the
+ * map they belong to. The key of a tile is the hash of the settings of its map which
+ * change the pixels (textures, render view, render mode, etc.), the position of the tile
+ * and the contents of its chunks (see TileRenderWorker). Maps of other worlds and
+ * other configuration files with a tile of the same key take its image from the cache
+ * instead of rendering it, like the same area copied to the worlds of other servers.
+ *
+ * The images are stored lossless (as PNG files named by their key) in a directory,
+ * so they can be used for any image format of the maps. The files are written to
+ * temporary files first and renamed then, so multiple processes can share the cache.
+ * Nothing is ever removed from the cache, the directory can just be deleted.
+ */
+class TileCache {
+public:
+	TileCache(const fs::path& cache_dir);
+	~TileCache();
+
+	/**
+	 * Returns the directory of the cache.
+	 */
+	const fs::path& getCacheDir() const;
+
+	/**
+	 * Reads the image of a tile from the cache. Returns false if there is no image with
+	 * the key.
+	 */
+	bool read(uint64_t key, RGBAImage& image);
+
+	/**
+	 * Writes the image of a tile to the cache.
+	 */
+	bool write(uint64_t key, const RGBAImage& image);
+
+	/**
+	 * Returns how many images were found in the cache and how many not.
+	 */
+	size_t getHits() const;
+	size_t getMisses() const;
+
+	/**
+	 * Returns the hash of the settings of a map as key of its tiles, which is extended
+	 * by the positions and the contents of the tiles.
+	 */
+	static uint64_t hashSettings(const std::string& settings);
+
+private:
+	/**
+	 * Returns the file of the image with a key, the files are spread over subdirectories
+	 * by the first byte of their key.
+	 */
+	fs::path getFile(uint64_t key) const;
+
+	fs::path cache_dir;
+	std::atomic<size_t> hits, misses;
+};
+
+}
+}
+
+#endif /* TILECACHE_H_ */
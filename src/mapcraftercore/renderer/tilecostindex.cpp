@@ -0,0 +1,134 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilecostindex.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// "MCTC" and version of the index file format, the byte order of the host is used
+const uint32_t INDEX_MAGIC = 0x4d435443;
+const uint32_t INDEX_VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}
+
+TileCostIndex::TileCostIndex() {
+}
+
+TileCostIndex::~TileCostIndex() {
+}
+
+bool TileCostIndex::read(const std::string& filename) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	costs.clear();
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	uint32_t magic, version, count;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, count)
+			|| magic != INDEX_MAGIC || version != INDEX_VERSION)
+		return false;
+
+	// the position of the tile and its render time
+	int32_t x, y;
+	uint32_t cost;
+	costs.reserve(count);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!readValue(in, x) || !readValue(in, y) || !readValue(in, cost))
+			break;
+		costs[TilePos(x, y)] = cost;
+	}
+
+	// a truncated index is not valid at all
+	if (costs.size() != count) {
+		costs.clear();
+		return false;
+	}
+	return true;
+}
+
+bool TileCostIndex::write(const std::string& filename) const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// write to a temporary file first to not leave a broken index behind
+	std::string tmp_filename = filename + ".tmp";
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	writeValue(out, INDEX_MAGIC);
+	writeValue(out, INDEX_VERSION);
+	writeValue(out, (uint32_t) costs.size());
+	for (auto it = costs.begin(); it != costs.end(); ++it) {
+		writeValue(out, (int32_t) it->first.getX());
+		writeValue(out, (int32_t) it->first.getY());
+		writeValue(out, it->second);
+	}
+	out.close();
+	if (!out)
+		return false;
+	return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+bool TileCostIndex::find(const TilePos& tile, uint32_t& cost) const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = costs.find(tile);
+	if (it == costs.end())
+		return false;
+	cost = it->second;
+	return true;
+}
+
+void TileCostIndex::update(const TilePos& tile, uint32_t cost) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	costs[tile] = cost;
+}
+
+double TileCostIndex::getAverage() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (costs.empty())
+		return 0;
+	double sum = 0;
+	for (auto it = costs.begin(); it != costs.end(); ++it)
+		sum += it->second;
+	return sum / costs.size();
+}
+
+size_t TileCostIndex::size() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return costs.size();
+}
+
+}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILECOSTINDEX_H_
+#define TILECOSTINDEX_H_
+
+#include "tileset.h"
+#include "../compat/thread.h"
+
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * An index with the times it took to render the render tiles of a map rotation.
+ *
+ * The index is persisted between the renderings. The render time of a tile can vary a
+ * lot (tiles of the ocean are much faster than tiles of dense cities), with the times
+ * of the last rendering the render work is split into jobs with about the same
+ * expected render time instead of the same count of tiles.
+ *
+ * The render threads update the index at the same time.
+ */
+class TileCostIndex {
+public:
+	TileCostIndex();
+	~TileCostIndex();
+
+	/**
+	 * Reads the index from a file. Returns false if the file does not exist or is not a
+	 * valid index file, the index is empty then.
+	 */
+	bool read(const std::string& filename);
+
+	/**
+	 * Writes the index to a file.
+	 */
+	bool write(const std::string& filename) const;
+
+	/**
+	 * Looks up the render time (in microseconds) of a tile. Returns true and copies it to
+	 * cost if there is one.
+	 */
+	bool find(const TilePos& tile, uint32_t& cost) const;
+
+	/**
+	 * Adds or replaces the render time (in microseconds) of a tile.
+	 */
+	void update(const TilePos& tile, uint32_t cost);
+
+	/**
+	 * Returns the average render time of the tiles in the index, 0 if it's empty.
+	 */
+	double getAverage() const;
+
+	/**
+	 * Returns the count of tiles in the index.
+	 */
+	size_t size() const;
+
+private:
+	mutable thread_ns::mutex mutex;
+	std::unordered_map<TilePos, uint32_t, tile_pos_hash_function> costs;
+};
+
+}
+}
+
+#endif /* TILECOSTINDEX_H_ */
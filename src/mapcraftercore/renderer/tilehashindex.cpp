@@ -0,0 +1,131 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilehashindex.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// "MCTH" and version of the index file format, the byte order of the host is used
+const uint32_t INDEX_MAGIC = 0x4d435448;
+const uint32_t INDEX_VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}
+
+TileHashIndex::TileHashIndex() {
+}
+
+TileHashIndex::~TileHashIndex() {
+}
+
+bool TileHashIndex::read(const std::string& filename) {
+	hashes.clear();
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	uint32_t magic, version, count;
+	if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, count)
+			|| magic != INDEX_MAGIC || version != INDEX_VERSION)
+		return false;
+
+	for (uint32_t i = 0; i < count; i++) {
+		// the depth of the tile and its path, one byte per node
+		uint8_t depth, node;
+		if (!readValue(in, depth))
+			break;
+		if (depth > TilePath::MAX_DEPTH)
+			break;
+		TilePath tile;
+		for (int j = 0; j < depth && readValue(in, node) && node >= 1 && node <= 4; j++)
+			tile += node;
+		uint64_t hash;
+		if (tile.getDepth() != depth || !readValue(in, hash))
+			break;
+		hashes[tile] = hash;
+	}
+
+	// a truncated index is not valid at all
+	if (hashes.size() != count) {
+		hashes.clear();
+		return false;
+	}
+	return true;
+}
+
+bool TileHashIndex::write(const std::string& filename) const {
+	// write to a temporary file first to not leave a broken index behind
+	std::string tmp_filename = filename + ".tmp";
+	std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+	if (!out)
+		return false;
+
+	writeValue(out, INDEX_MAGIC);
+	writeValue(out, INDEX_VERSION);
+	writeValue(out, (uint32_t) hashes.size());
+	for (auto it = hashes.begin(); it != hashes.end(); ++it) {
+		const TilePath& tile = it->first;
+		writeValue(out, (uint8_t) tile.getDepth());
+		for (int level = 1; level <= tile.getDepth(); level++)
+			writeValue(out, (uint8_t) tile.getNode(level));
+		writeValue(out, it->second);
+	}
+	out.close();
+	if (!out)
+		return false;
+	return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+bool TileHashIndex::find(const TilePath& tile, uint64_t& hash) const {
+	auto it = hashes.find(tile);
+	if (it == hashes.end())
+		return false;
+	hash = it->second;
+	return true;
+}
+
+void TileHashIndex::update(const TilePath& tile, uint64_t hash) {
+	hashes[tile] = hash;
+}
+
+void TileHashIndex::remove(const TilePath& tile) {
+	hashes.erase(tile);
+}
+
+size_t TileHashIndex::size() const {
+	return hashes.size();
+}
+
+}
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEHASHINDEX_H_
+#define TILEHASHINDEX_H_
+
+#include "tileset.h"
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * An index with the hashes of the pixels of the written tiles of a map rotation.
+ *
+ * The index is persisted between the renderings. Tiles which are rendered again with
+ * the same pixels (for example because the timestamps of their chunks changed, but no
+ * visible blocks) don't need to be encoded and written again.
+ */
+class TileHashIndex {
+public:
+	TileHashIndex();
+	~TileHashIndex();
+
+	/**
+	 * Reads the index from a file. Returns false if the file does not exist or is not a
+	 * valid index file, the index is empty then.
+	 */
+	bool read(const std::string& filename);
+
+	/**
+	 * Writes the index to a file.
+	 */
+	bool write(const std::string& filename) const;
+
+	/**
+	 * Looks up the hash of a tile. Returns true and copies it to hash if there is one.
+	 */
+	bool find(const TilePath& tile, uint64_t& hash) const;
+
+	/**
+	 * Adds or replaces the hash of a tile.
+	 */
+	void update(const TilePath& tile, uint64_t hash);
+
+	/**
+	 * Removes the hash of a tile (for example if the tile could not be written).
+	 */
+	void remove(const TilePath& tile);
+
+	/**
+	 * Returns the count of tiles in the index.
+	 */
+	size_t size() const;
+
+private:
+	std::map<TilePath, uint64_t> hashes;
+};
+
+}
+}
+
+#endif /* TILEHASHINDEX_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tileimagestore.h"
+
+#include <utility>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+size_t getImageBytes(const RGBAImage& image) {
+	return image.getWidth() * image.getHeight() * sizeof(RGBAPixel);
+}
+
+}
+
+TileImageStore::TileImageStore(size_t max_bytes)
+	: max_bytes(max_bytes), bytes(0) {
+}
+
+TileImageStore::~TileImageStore() {
+}
+
+void TileImageStore::put(const TilePath& tile, const RGBAImage& image) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	size_t image_bytes = getImageBytes(image);
+	if (bytes + image_bytes > max_bytes || images.count(tile))
+		return;
+	images[tile] = image;
+	bytes += image_bytes;
+}
+
+bool TileImageStore::take(const TilePath& tile, RGBAImage& image) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto it = images.find(tile);
+	if (it == images.end())
+		return false;
+	bytes -= getImageBytes(it->second);
+	std::swap(image, it->second);
+	images.erase(it);
+	return true;
+}
+
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEIMAGESTORE_H_
+#define TILEIMAGESTORE_H_
+
+#include "image.h"
+#include "tileset.h"
+#include "../compat/thread.h"
+
+#include <cstddef>
+#include <map>
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * Keeps the half size images of rendered tiles in memory until the composite tile they
+ * belong to is rendered, so the tiles don't need to be read from disk again. The images
+ * use at most a specific amount of memory, tiles which don't fit are read from disk.
+ *
+ * The store is shared by the render threads.
+ */
+class TileImageStore {
+public:
+	TileImageStore(size_t max_bytes);
+	~TileImageStore();
+
+	/**
+	 * Puts the half size image of a tile into the store, if there is enough memory left.
+	 */
+	void put(const TilePath& tile, const RGBAImage& image);
+
+	/**
+	 * Takes the half size image of a tile out of the store. Returns false if the image
+	 * of the tile is not in the store.
+	 */
+	bool take(const TilePath& tile, RGBAImage& image);
+
+private:
+	size_t max_bytes, bytes;
+	std::map<TilePath, RGBAImage> images;
+
+	thread_ns::mutex mutex;
+};
+
+}
+}
+
+#endif /* TILEIMAGESTORE_H_ */
@@ -20,22 +20,146 @@
 #include "tilerenderer.h"
 
 #include "blockimages.h"
+#include "blockprofiler.h"
 #include "image.h"
 #include "rendermode.h"
 #include "renderview.h"
 #include "tileset.h"
 #include "../mc/pos.h"
+#include "../thread/impl/threadpool.h"
 #include "../util.h"
 
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
 namespace mapcrafter {
 namespace renderer {
 
+namespace {
+
+// the size of an encoded block of a tile geometry, the blocks are encoded by their
+// fields (first the x-coordinates of all blocks and so on), that compresses better
+const size_t GEOMETRY_BLOCK_SIZE = 5 * 4 + 3 * 2;
+
+template <typename T>
+uint8_t* encodeField(const std::vector<TileGeometry::Block>& blocks,
+		T TileGeometry::Block::* field, uint8_t* out) {
+	for (auto it = blocks.begin(); it != blocks.end(); ++it, out += sizeof(T))
+		std::memcpy(out, &((*it).*field), sizeof(T));
+	return out;
+}
+
+template <typename T>
+const uint8_t* decodeField(std::vector<TileGeometry::Block>& blocks,
+		T TileGeometry::Block::* field, const uint8_t* in) {
+	for (auto it = blocks.begin(); it != blocks.end(); ++it, in += sizeof(T))
+		std::memcpy(&((*it).*field), in, sizeof(T));
+	return in;
+}
+
+}
+
+ImagePool::ImagePool()
+	: used(0) {
+}
+
+ImagePool::~ImagePool() {
+}
+
+RGBAImage& ImagePool::get() {
+	if (used == images.size())
+		images.push_back(RGBAImage());
+	return images[used++];
+}
+
+const RGBAImage* ImagePool::find(const std::vector<int32_t>& key) {
+	auto it = keyed_index.find(key);
+	if (it == keyed_index.end())
+		return nullptr;
+	keyed.splice(keyed.begin(), keyed, it->second);
+	return &it->second->second;
+}
+
+RGBAImage& ImagePool::put(const std::vector<int32_t>& key) {
+	keyed.push_front(std::make_pair(key, RGBAImage()));
+	keyed_index[key] = keyed.begin();
+	return keyed.front().second;
+}
+
+void ImagePool::reset() {
+	used = 0;
+	while (keyed.size() > KEYED_CAPACITY) {
+		keyed_index.erase(keyed.back().first);
+		keyed.pop_back();
+	}
+}
+
+TileGeometry::TileGeometry()
+	: key(0) {
+}
+
+void TileGeometry::encode(std::string& data) const {
+	std::vector<uint8_t> fields(blocks.size() * GEOMETRY_BLOCK_SIZE);
+	uint8_t* out = fields.data();
+	out = encodeField(blocks, &Block::x, out);
+	out = encodeField(blocks, &Block::z, out);
+	out = encodeField(blocks, &Block::y, out);
+	out = encodeField(blocks, &Block::draw_x, out);
+	out = encodeField(blocks, &Block::draw_y, out);
+	out = encodeField(blocks, &Block::id, out);
+	out = encodeField(blocks, &Block::data, out);
+	encodeField(blocks, &Block::extra_data, out);
+
+	// the key, the count of blocks and the compressed fields (in host byte order)
+	uint32_t count = blocks.size();
+	size_t header = sizeof(key) + sizeof(count);
+	uLongf compressed_size = compressBound(fields.size());
+	data.resize(header + compressed_size);
+	std::memcpy(&data[0], &key, sizeof(key));
+	std::memcpy(&data[sizeof(key)], &count, sizeof(count));
+	if (compress2((Bytef*) &data[header], &compressed_size, fields.data(), fields.size(),
+			Z_BEST_SPEED) != Z_OK)
+		compressed_size = 0;
+	data.resize(header + compressed_size);
+}
+
+bool TileGeometry::decode(const std::string& data) {
+	uint32_t count;
+	size_t header = sizeof(key) + sizeof(count);
+	if (data.size() <= header)
+		return false;
+	std::memcpy(&key, data.data(), sizeof(key));
+	std::memcpy(&count, data.data() + sizeof(key), sizeof(count));
+	if (count > (1u << 24))
+		return false;
+
+	std::vector<uint8_t> fields(count * GEOMETRY_BLOCK_SIZE);
+	uLongf fields_size = fields.size();
+	if (uncompress(fields.data(), &fields_size, (const Bytef*) data.data() + header,
+			data.size() - header) != Z_OK || fields_size != fields.size())
+		return false;
+	blocks.resize(count);
+	const uint8_t* in = fields.data();
+	in = decodeField(blocks, &Block::x, in);
+	in = decodeField(blocks, &Block::z, in);
+	in = decodeField(blocks, &Block::y, in);
+	in = decodeField(blocks, &Block::draw_x, in);
+	in = decodeField(blocks, &Block::draw_y, in);
+	in = decodeField(blocks, &Block::id, in);
+	in = decodeField(blocks, &Block::data, in);
+	decodeField(blocks, &Block::extra_data, in);
+	return true;
+}
+
 TileRenderer::TileRenderer(const RenderView* render_view, BlockImages* images,
 		int tile_width, mc::WorldCache* world, RenderMode* render_mode)
 	: images(images), tile_width(tile_width), world(world), current_chunk(nullptr),
-	  render_mode(render_mode),
-	  render_biomes(true), use_preblit_water(false) {
+	  render_mode(render_mode), render_mode_modifies(false),
+	  render_biomes(true), use_preblit_water(false), part_thread_pool(nullptr),
+	  drawn_blocks_count(0), biome_grids(64) {
 	render_mode->initialize(render_view, images, world, &current_chunk);
+	render_mode_modifies = render_mode->modifiesBlockImages();
 }
 
 TileRenderer::~TileRenderer() {
@@ -49,15 +173,48 @@ void TileRenderer::setUsePreblitWater(bool use_preblit_water) {
 	this->use_preblit_water = use_preblit_water;
 }
 
+void TileRenderer::setPartRenderers(const std::vector<TileRenderer*>& part_renderers,
+		thread::ThreadPool* part_thread_pool) {
+	this->part_renderers = part_renderers;
+	this->part_thread_pool = part_thread_pool;
+}
+
+bool TileRenderer::renderTilePartially(const TilePos& tile_pos,
+		const std::vector<mc::ChunkPos>& changed_chunks, RGBAImage& tile) {
+	return false;
+}
+
+bool TileRenderer::getGeometryKey(uint64_t& key) const {
+	return false;
+}
+
+void TileRenderer::renderTileGeometry(const TilePos& tile_pos, RGBAImage& tile,
+		TileGeometry& geometry) {
+	geometry.blocks.clear();
+	renderTile(tile_pos, tile);
+}
+
+void TileRenderer::renderTileFromGeometry(const TilePos& tile_pos,
+		const TileGeometry& geometry, RGBAImage& tile) {
+	renderTile(tile_pos, tile);
+}
+
 mc::Block TileRenderer::getBlock(const mc::BlockPos& pos, int get) {
 	return world->getBlock(pos, current_chunk, get);
 }
 
-Biome TileRenderer::getBiomeOfBlock(const mc::BlockPos& pos, const mc::Chunk* chunk) {
+BiomeColors TileRenderer::getBiomeColorsOfBlock(const mc::BlockPos& pos,
+		const mc::Chunk* chunk) {
 	// return default biome if we don't want to render different biomes
 	if (!render_biomes)
-		return getBiome(DEFAULT_BIOME);
-	uint8_t biome_id = chunk->getBiomeAt(mc::LocalBlockPos(pos));
+		return images->getBiomeColors(getBiome(DEFAULT_BIOME));
+
+	mc::LocalBlockPos local(pos);
+	if (mc::ChunkPos(pos) == chunk->getPos())
+		return getBiomeGrid(chunk).colors[local.z * 16 + local.x];
+
+	// the block is not in the chunk, average the biomes directly
+	uint8_t biome_id = chunk->getBiomeAt(local);
 	Biome biome = getBiome(biome_id);
 	int count = 1;
 
@@ -72,7 +229,7 @@ Biome TileRenderer::getBiomeOfBlock(const mc::BlockPos& pos, const mc::Chunk* ch
 			mc::ChunkPos chunk_pos(other);
 			uint8_t other_id = chunk->getBiomeAt(mc::LocalBlockPos(other));
 			if (chunk_pos != chunk->getPos()) {
-				mc::Chunk* other_chunk = world->getChunk(chunk_pos);
+				const mc::Chunk* other_chunk = world->getChunkOfBlock(other, chunk);
 				if (other_chunk == nullptr)
 					continue;
 				other_id = other_chunk->getBiomeAt(mc::LocalBlockPos(other));
@@ -83,7 +240,54 @@ Biome TileRenderer::getBiomeOfBlock(const mc::BlockPos& pos, const mc::Chunk* ch
 		}
 
 	biome /= count;
-	return biome;
+	return images->getBiomeColors(biome);
+}
+
+TileRenderer::BiomeGrid::BiomeGrid()
+	: revision(0) {
+}
+
+const TileRenderer::BiomeGrid& TileRenderer::getBiomeGrid(const mc::Chunk* chunk) {
+	const mc::ChunkPos& chunk_pos = chunk->getPos();
+	BiomeGrid& grid = biome_grids[(chunk_pos.x & 7) * 8 + (chunk_pos.z & 7)];
+	if (grid.pos == chunk_pos && grid.revision == chunk->getRevision())
+		return grid;
+	grid.pos = chunk_pos;
+	grid.revision = chunk->getRevision();
+
+	// the biome ids of the columns of the chunk with a border of one column from the
+	// neighbor chunks (as index (z+1)*18 + x+1), -1 if the neighbor chunk doesn't exist
+	int ids[18 * 18];
+	mc::BlockPos origin(chunk_pos.x * 16, chunk_pos.z * 16, 0);
+	for (int z = -1; z <= 16; z++)
+		for (int x = -1; x <= 16; x++) {
+			int& id = ids[(z + 1) * 18 + x + 1];
+			if (x >= 0 && z >= 0 && x < 16 && z < 16) {
+				id = chunk->getBiomeAt(mc::LocalBlockPos(x, z, 0));
+				continue;
+			}
+			mc::BlockPos pos = origin + mc::BlockPos(x, z, 0);
+			const mc::Chunk* other_chunk = world->getChunkOfBlock(pos, chunk);
+			id = other_chunk == nullptr ? -1 : other_chunk->getBiomeAt(mc::LocalBlockPos(pos));
+		}
+
+	// average them in the same order getBiomeColorsOfBlock does it for each block
+	for (int z = 0; z < 16; z++)
+		for (int x = 0; x < 16; x++) {
+			Biome biome = getBiome(ids[(z + 1) * 18 + x + 1]);
+			int count = 1;
+			for (int dx = -1; dx <= 1; dx++)
+				for (int dz = -1; dz <= 1; dz++) {
+					int id = ids[(z + dz + 1) * 18 + x + dx + 1];
+					if ((dx == 0 && dz == 0) || id == -1)
+						continue;
+					biome += getBiome(id);
+					count++;
+				}
+			biome /= count;
+			grid.colors[z * 16 + x] = images->getBiomeColors(biome);
+		}
+	return grid;
 }
 
 /**
@@ -471,5 +675,88 @@ uint16_t TileRenderer::checkNeighbors(const mc::BlockPos& pos, uint16_t id, uint
 	return data;
 }
 
+uint64_t TileRenderer::getDrawnBlocks() const {
+	uint64_t blocks = drawn_blocks_count;
+	for (auto it = part_renderers.begin(); it != part_renderers.end(); ++it)
+		blocks += (*it)->drawn_blocks_count;
+	return blocks;
+}
+
+int TileRenderer::getPartRenderersCount() const {
+	return part_thread_pool == nullptr ? 1 : part_renderers.size() + 1;
+}
+
+void TileRenderer::renderParts(int parts,
+		const std::function<void (TileRenderer*, int)>& render) {
+	int renderers = std::min(parts, getPartRenderersCount());
+	if (renderers <= 1) {
+		for (int i = 0; i < parts; i++)
+			render(this, i);
+		return;
+	}
+
+	// every tile renderer renders every renderers-th part, this one the first ones
+	int running = renderers - 1;
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable finished;
+	for (int r = 1; r < renderers; r++) {
+		TileRenderer* renderer = part_renderers[r - 1];
+		part_thread_pool->run([&, r, renderer]() {
+			for (int i = r; i < parts; i += renderers)
+				render(renderer, i);
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			if (--running == 0)
+				finished.notify_all();
+		});
+	}
+	for (int i = 0; i < parts; i += renderers)
+		render(this, i);
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (running > 0)
+		finished.wait(lock);
+}
+
+const RGBAImage* TileRenderer::getBlockImage(const mc::BlockPos& pos, uint16_t id,
+		uint16_t data, uint16_t extra_data, const mc::Chunk* chunk,
+		ImagePool& pool) {
+	RGBAImage* image;
+	if (Biome::isBiomeBlock(id, data)) {
+		BlockProfiler::addPath(BlockPath::BIOME);
+		image = &pool.get();
+		*image = images->getBiomeBlock(id, data, getBiomeColorsOfBlock(pos, chunk),
+				extra_data);
+	} else {
+		const RGBAImage& block = images->getBlock(id, data, extra_data);
+		if (!render_mode_modifies)
+			return &block;
+		// blocks with the same image and the same modifications (for example the same
+		// lighting) share one modified image which is kept in the pool
+		draw_key.assign({id, data, extra_data});
+		bool has_draw_key;
+		{
+			util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+			has_draw_key = render_mode->getDrawKey(pos, id, data, draw_key);
+		}
+		if (has_draw_key) {
+			const RGBAImage* drawn = pool.find(draw_key);
+			if (drawn != nullptr) {
+				BlockProfiler::addPath(BlockPath::SHARED_IMAGE);
+				return drawn;
+			}
+			image = &pool.put(draw_key);
+		} else {
+			// copying into an image of the pool reuses its memory
+			image = &pool.get();
+		}
+		*image = block;
+	}
+	if (render_mode_modifies)
+		BlockProfiler::addPath(BlockPath::RENDER_MODE);
+	util::ProfileScope profile(util::ProfileStage::RENDER_MODE);
+	render_mode->draw(*image, pos, id, data);
+	return image;
+}
+
 }
 }
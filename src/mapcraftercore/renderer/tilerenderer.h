@@ -21,9 +21,16 @@
 #define TILERENDERER_H_
 
 #include "biomes.h"
+#include "image.h"
 #include "../mc/worldcache.h" // mc::DIR_*
 
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
 #include <vector>
+#include <stdint.h>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -34,6 +41,11 @@ namespace mapcrafter {
 namespace mc {
 class BlockPos;
 class Chunk;
+class ChunkPos;
+}
+
+namespace thread {
+class ThreadPool;
 }
 
 namespace renderer {
@@ -42,7 +54,86 @@ class BlockImages;
 class TilePos;
 class RenderMode;
 class RenderView;
-class RGBAImage;
+
+/**
+ * A pool of temporary images, for example for the modified block images of a tile. The
+ * images (and their memory) are kept when the pool is reset, so they can be reused for
+ * the next tiles without allocating new images. The addresses of the images stay valid
+ * while new images are added.
+ */
+class ImagePool {
+public:
+	ImagePool();
+	~ImagePool();
+
+	/**
+	 * Returns an unused image of the pool, with undefined size and contents.
+	 */
+	RGBAImage& get();
+
+	/**
+	 * Returns the image that was stored with a key, or nullptr if there is none.
+	 */
+	const RGBAImage* find(const std::vector<int32_t>& key);
+
+	/**
+	 * Returns a new image (with undefined size and contents) that is stored with a key.
+	 * Images with keys are kept when the pool is reset, only the least recently used
+	 * ones are removed then if there are too many of them.
+	 */
+	RGBAImage& put(const std::vector<int32_t>& key);
+
+	/**
+	 * Marks all images as unused again.
+	 */
+	void reset();
+
+private:
+	std::deque<RGBAImage> images;
+	size_t used;
+
+	// the maximum number of images with keys that are kept when the pool is reset
+	static const size_t KEYED_CAPACITY = 1024;
+
+	// the images with keys, the most recently used first, and an index of them
+	typedef std::list<std::pair<std::vector<int32_t>, RGBAImage> > KeyedList;
+	KeyedList keyed;
+	std::map<std::vector<int32_t>, KeyedList::iterator> keyed_index;
+};
+
+/**
+ * The visible blocks of a render tile in drawing order with their block data (after
+ * checking the neighbors) and their drawing positions, what a tile renderer finds out
+ * before it draws the images of the blocks. It doesn't depend on the render mode (if the
+ * render mode doesn't hide blocks) and only on the transparency of the block images, so
+ * the other maps of the same world and rotation and the next renderings with other
+ * textures can draw the tile from it without iterating over the blocks again.
+ */
+struct TileGeometry {
+	TileGeometry();
+
+	struct Block {
+		int32_t x, z, y;
+		// drawing position in pixels on the tile
+		int32_t draw_x, draw_y;
+		uint16_t id, data, extra_data;
+	};
+
+	// describes everything the blocks depend on, the blocks of the world and the
+	// options of the tile renderer (see TileRenderer::getGeometryKey)
+	uint64_t key;
+	std::vector<Block> blocks;
+
+	/**
+	 * Encodes the key and the blocks (compressed) into a buffer.
+	 */
+	void encode(std::string& data) const;
+
+	/**
+	 * Decodes the key and the blocks from a buffer. Returns false if the data is invalid.
+	 */
+	bool decode(const std::string& data);
+};
 
 class TileRenderer {
 public:
@@ -53,23 +144,124 @@ public:
 	void setRenderBiomes(bool render_biomes);
 	void setUsePreblitWater(bool use_preblit_water);
 
+	/**
+	 * Sets other tile renderers of the same render view (each with its own world cache
+	 * and render mode) which render parts of the tiles of this one concurrently on the
+	 * threads of a thread pool. The tile renderers and the thread pool have to exist as
+	 * long as this tile renderer renders tiles.
+	 */
+	void setPartRenderers(const std::vector<TileRenderer*>& part_renderers,
+			thread::ThreadPool* part_thread_pool);
+
 	virtual void renderTile(const TilePos& tile_pos, RGBAImage& tile) = 0;
 
+	/**
+	 * Renders only the part of a tile the specified changed chunks can affect onto the
+	 * previous image of the tile, the rest of the image is kept. Returns false if the
+	 * tile renderer doesn't render parts of tiles or if the part is most of the tile
+	 * anyway, the image is not modified then and the tile has to be rendered completely.
+	 */
+	virtual bool renderTilePartially(const TilePos& tile_pos,
+			const std::vector<mc::ChunkPos>& changed_chunks, RGBAImage& tile);
+
+	/**
+	 * Returns a key of the options of the tile renderer and the block images the
+	 * geometry of the tiles depends on (the caller adds the blocks of the world to it).
+	 * Returns false if the tile renderer doesn't record the geometry of tiles or if the
+	 * render mode hides blocks, the tiles have to be rendered with renderTile then.
+	 */
+	virtual bool getGeometryKey(uint64_t& key) const;
+
+	/**
+	 * Renders a tile like renderTile and records the geometry of it (without the key).
+	 */
+	virtual void renderTileGeometry(const TilePos& tile_pos, RGBAImage& tile,
+			TileGeometry& geometry);
+
+	/**
+	 * Renders a tile from its recorded geometry, only the images of the blocks are
+	 * created and drawn. The image is the same as the one renderTile renders.
+	 */
+	virtual void renderTileFromGeometry(const TilePos& tile_pos,
+			const TileGeometry& geometry, RGBAImage& tile);
+
 	virtual int getTileSize() const = 0;
 
+	/**
+	 * Returns the count of block images drawn by this tile renderer and its part
+	 * renderers so far, the blocks of a tile are the difference before and after it.
+	 */
+	uint64_t getDrawnBlocks() const;
+
 protected:
 	mc::Block getBlock(const mc::BlockPos& pos, int get = mc::GET_ID | mc::GET_DATA);
-	Biome getBiomeOfBlock(const mc::BlockPos& pos, const mc::Chunk* chunk);
+	/**
+	 * Returns the biome colors of a block, the ones of its biome averaged with the
+	 * biomes of the neighbor columns to make smooth edges between biomes. The colors
+	 * only depend on the x- and z-coordinates and are computed once for all columns of
+	 * a chunk.
+	 */
+	BiomeColors getBiomeColorsOfBlock(const mc::BlockPos& pos, const mc::Chunk* chunk);
 	uint16_t checkNeighbors(const mc::BlockPos& pos, uint16_t id, uint16_t data);
 
+	/**
+	 * Returns the count of tile renderers rendering the parts of a tile, this one and
+	 * the part renderers.
+	 */
+	int getPartRenderersCount() const;
+
+	/**
+	 * Renders the parts 0 to parts-1 of a tile by calling the render function with a
+	 * tile renderer and a part. The parts are distributed over this tile renderer and
+	 * the part renderers, and the function is called concurrently for the parts of
+	 * different tile renderers. Returns when all parts are rendered.
+	 */
+	void renderParts(int parts, const std::function<void (TileRenderer*, int)>& render);
+
+	/**
+	 * Returns the image of a block (the biome variant for biome blocks) with the
+	 * modifications of the render mode. This is the cached block image if nothing needs
+	 * to be modified, otherwise the image is created in the supplied image pool, which
+	 * must not be reset until the block is drawn.
+	 */
+	const RGBAImage* getBlockImage(const mc::BlockPos& pos, uint16_t id, uint16_t data,
+			uint16_t extra_data, const mc::Chunk* chunk, ImagePool& pool);
+
 	BlockImages* images;
 	int tile_width;
 	mc::WorldCache* world;
-	mc::Chunk* current_chunk;
+	const mc::Chunk* current_chunk;
 	RenderMode* render_mode;
+	// whether the render mode modifies block images, see getBlockImage
+	bool render_mode_modifies;
 
 	bool render_biomes;
 	bool use_preblit_water;
+
+	std::vector<TileRenderer*> part_renderers;
+	thread::ThreadPool* part_thread_pool;
+
+	// the count of block images this tile renderer drew (see getDrawnBlocks)
+	uint64_t drawn_blocks_count;
+
+private:
+	// the key of the block image that is currently drawn, kept to reuse the memory
+	std::vector<int32_t> draw_key;
+
+	// the colors of the averaged biomes of the columns of a chunk (as index z*16+x), the
+	// revision is the one of the chunk they were computed for (see mc::Chunk::getRevision)
+	struct BiomeGrid {
+		BiomeGrid();
+
+		mc::ChunkPos pos;
+		uint64_t revision;
+		BiomeColors colors[256];
+	};
+
+	// the biome grids of recently rendered chunks, mapped by their positions (8x8 chunks)
+	std::vector<BiomeGrid> biome_grids;
+
+	const BiomeGrid& getBiomeGrid(const mc::Chunk* chunk);
 };
 
 }
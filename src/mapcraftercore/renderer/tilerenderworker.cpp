@@ -20,27 +20,215 @@
 #include "tilerenderworker.h"
 
 #include "blockimages.h"
+#include "chunkprefetcher.h"
 #include "image.h"
 #include "rendermode.h"
 #include "renderview.h"
+#include "tilecache.h"
+#include "tilecostindex.h"
+#include "tileimagestore.h"
 #include "tilerenderer.h"
 #include "tileset.h"
+#include "tilestore.h"
+#include "tilewriter.h"
+#include "image/scaling.h"
 #include "../mc/worldcache.h"
+#include "../thread/impl/threadpool.h"
 #include "../util.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
 namespace mapcrafter {
 namespace renderer {
 
+RenderContext::RenderContext()
+	: render_view(nullptr), block_images(nullptr), tile_set(nullptr),
+	  shared_memory_world_key(0), chunk_cache_size(0), partial_render_since(0),
+	  provisional(false), tile_cache_key(0), tile_threads(1) {
+}
+
 void RenderContext::initializeTileRenderer() {
-	world_cache.reset(new mc::WorldCache(world));
+	size_t cache_size = chunk_cache_size;
+	if (cache_size == 0)
+		cache_size = map_config.getChunkCacheSize();
+	// the part renderers need the chunks at the borders of their parts too, and the
+	// chunks decoded when their region is loaded need to be put somewhere
+	if ((tile_threads > 1 || map_config.getRegionDecodeThreads() > 0) && !chunk_cache)
+		chunk_cache = std::make_shared<mc::ChunkCache>();
+	world_cache.reset(new mc::WorldCache(world, cache_size,
+			chunk_cache, unrotated_chunk_cache));
+	world_cache->setSignCollector(sign_collector);
+	world_cache->setUnpackChunks(map_config.unpackChunks());
+	world_cache->setCompressedChunkCache(compressed_chunk_cache);
+	world_cache->setSharedMemoryChunkCache(shared_memory_chunk_cache,
+			shared_memory_world_key);
+	world_cache->setRegionIndex(region_index);
 	render_mode.reset(createRenderMode(world_config, map_config, world.getRotation()));
 	tile_renderer.reset(render_view->createTileRenderer(block_images,
-			map_config.getTileWidth(), world_cache.get(), render_mode.get()));
+			tile_set->getTileWidth(), world_cache.get(), render_mode.get()));
 	render_view->configureTileRenderer(tile_renderer.get(), world_config, map_config);
+
+	// the part renderers share the chunk caches, but have world caches of their own
+	part_world_caches.clear();
+	part_render_modes.clear();
+	part_renderers.clear();
+	part_thread_pool.reset();
+	if (tile_threads <= 1)
+		return;
+	std::vector<TileRenderer*> renderers;
+	for (int i = 1; i < tile_threads; i++) {
+		part_world_caches.push_back(std::make_shared<mc::WorldCache>(world, cache_size,
+				chunk_cache, unrotated_chunk_cache));
+		part_world_caches.back()->setSignCollector(sign_collector);
+		part_world_caches.back()->setUnpackChunks(map_config.unpackChunks());
+		part_world_caches.back()->setCompressedChunkCache(compressed_chunk_cache);
+		part_world_caches.back()->setSharedMemoryChunkCache(shared_memory_chunk_cache,
+				shared_memory_world_key);
+		part_world_caches.back()->setRegionIndex(region_index);
+		part_render_modes.push_back(std::shared_ptr<RenderMode>(createRenderMode(
+				world_config, map_config, world.getRotation())));
+		part_renderers.push_back(std::shared_ptr<TileRenderer>(
+				render_view->createTileRenderer(block_images, tile_set->getTileWidth(),
+				part_world_caches.back().get(), part_render_modes.back().get())));
+		render_view->configureTileRenderer(part_renderers.back().get(),
+				world_config, map_config);
+		renderers.push_back(part_renderers.back().get());
+	}
+	part_thread_pool = std::make_shared<thread::ThreadPool>(tile_threads - 1);
+	tile_renderer->setPartRenderers(renderers, part_thread_pool.get());
+}
+
+SlowTileLog::SlowTileLog(double threshold, size_t slowest_count)
+	: threshold(threshold), slowest_count(slowest_count), count(0) {
+}
+
+double SlowTileLog::getThreshold() const {
+	return threshold;
+}
+
+void SlowTileLog::add(const SlowTile& slow_tile) {
+	LOG(WARNING) << "Render tile " << slow_tile.tile << " of map " << slow_tile.map
+			<< " in rotation " << config::ROTATION_NAMES[slow_tile.rotation] << " took "
+			<< util::str(std::floor(slow_tile.seconds * 100) / 100) << "s ("
+			<< slow_tile.chunks << " chunks, " << slow_tile.blocks << " blocks).";
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	count++;
+	auto slower = [](const SlowTile& tile1, const SlowTile& tile2) {
+		return tile1.seconds > tile2.seconds;
+	};
+	slowest.insert(std::upper_bound(slowest.begin(), slowest.end(), slow_tile, slower),
+			slow_tile);
+	if (slowest.size() > slowest_count)
+		slowest.pop_back();
+}
+
+std::vector<SlowTileLog::SlowTile> SlowTileLog::getSlowest() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return slowest;
+}
+
+void SlowTileLog::logSummary() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (slowest.empty())
+		return;
+	LOG(INFO) << count << " render tiles took longer than " << threshold
+			<< "s, the slowest ones:";
+	for (auto it = slowest.begin(); it != slowest.end(); ++it)
+		LOG(INFO) << "  " << util::str(std::floor(it->seconds * 100) / 100) << "s: tile "
+				<< it->tile << " of map " << it->map << " in rotation "
+				<< config::ROTATION_NAMES[it->rotation] << " (" << it->chunks
+				<< " chunks, " << it->blocks << " blocks)";
+}
+
+RenderThreadStatus::RenderThreadStatus()
+	: since(std::chrono::steady_clock::now()), render_tile(false), warned(false),
+	  rendered_tiles(0) {
+}
+
+RenderThreadStatus::TileScope::TileScope(RenderThreadStatus* status,
+		const std::string& map, const TilePath& tile, bool render_tile)
+	: status(status) {
+	if (status == nullptr)
+		return;
+	thread_ns::unique_lock<thread_ns::mutex> lock(status->mutex);
+	previous_map = status->map;
+	previous_tile = status->tile;
+	previous_since = status->since;
+	previous_render_tile = status->render_tile;
+	previous_warned = status->warned;
+	status->map = map;
+	status->tile = tile.toString();
+	status->since = std::chrono::steady_clock::now();
+	status->render_tile = render_tile;
+	status->warned = false;
+}
+
+RenderThreadStatus::TileScope::~TileScope() {
+	if (status == nullptr)
+		return;
+	thread_ns::unique_lock<thread_ns::mutex> lock(status->mutex);
+	status->map = previous_map;
+	status->tile = previous_tile;
+	status->render_tile = previous_render_tile;
+	status->warned = previous_warned;
+	// an idle thread is idle since now
+	status->since = previous_map.empty() ? std::chrono::steady_clock::now()
+			: previous_since;
+}
+
+void RenderThreadStatus::tileRendered(const std::string& map,
+		const mc::CacheStats& chunk_stats) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	rendered_tiles++;
+	this->chunk_stats[map] = chunk_stats;
+}
+
+int RenderThreadStatus::getRenderedTiles() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return rendered_tiles;
+}
+
+void RenderThreadStatus::report(std::ostream& out, const std::string& name) const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	double seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - since).count();
+	out << name << ": ";
+	if (map.empty())
+		out << "idle for " << util::str(std::floor(seconds * 10) / 10) << "s";
+	else
+		out << "tile " << (tile.empty() ? "base" : tile) << " of map " << map << " for "
+				<< util::str(std::floor(seconds * 10) / 10) << "s";
+	mc::CacheStats stats;
+	for (auto it = chunk_stats.begin(); it != chunk_stats.end(); ++it)
+		stats += it->second;
+	uint64_t hits = stats.hits + stats.shared_hits + stats.rotation_hits
+			+ stats.compressed_hits + stats.shared_memory_hits;
+	uint64_t accesses = hits + stats.misses + stats.region_not_found + stats.not_found;
+	out << ", " << rendered_tiles << " render tiles rendered";
+	if (accesses > 0)
+		out << ", " << util::str(std::floor(1000.0 * hits / accesses) / 10)
+				<< "% chunk cache hits";
+	out << std::endl;
+}
+
+bool RenderThreadStatus::checkSlowTile(double threshold, std::string& map,
+		std::string& tile, double& seconds) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (!render_tile || warned)
+		return false;
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+	if (seconds < threshold)
+		return false;
+	warned = true;
+	map = this->map;
+	tile = this->tile;
+	return true;
 }
 
 TileRenderWorker::TileRenderWorker()
-	: progress(nullptr) {
+	: progress(nullptr), thread_status(nullptr), render_tile_index(0) {
 }
 
 TileRenderWorker::~TileRenderWorker() {
@@ -64,53 +252,81 @@ void TileRenderWorker::setProgressHandler(util::IProgressHandler* progress) {
 	this->progress = progress;
 }
 
-void TileRenderWorker::saveTile(const TilePath& tile, const RGBAImage& image) {
-	bool png = render_context.map_config.getImageFormat() == config::ImageFormat::PNG;
-	bool png_indexed = render_context.map_config.isPNGIndexed();
-	std::string suffix = std::string(".") + render_context.map_config.getImageFormatSuffix();
-	std::string filename = tile.toString() + suffix;
-	if (tile.getDepth() == 0)
-		filename = std::string("base") + suffix;
-	fs::path file = render_context.output_dir / filename;
-	if (!fs::exists(file.branch_path()))
-		fs::create_directories(file.branch_path());
-
-	if ((png && !png_indexed) && !image.writePNG(file.string()))
-		LOG(WARNING) << "Unable to write '" << file.string() << "'.";
-
-	if ((png && png_indexed) && !image.writeIndexedPNG(file.string()))
-		LOG(WARNING) << "Unable to write '" << file.string() << "'.";
+void TileRenderWorker::setThreadStatus(RenderThreadStatus* thread_status) {
+	this->thread_status = thread_status;
+}
 
-	config::Color bg = render_context.background_color;
-	if (!png && !image.writeJPEG(file.string(),
-			render_context.map_config.getJPEGQuality(), rgba(bg.red, bg.green, bg.blue, 255)))
-		LOG(WARNING) << "Unable to write '" << file.string() << "'.";
+void TileRenderWorker::saveTile(const TilePath& tile, RGBAImage& image) {
+	util::ProfileScope profile(util::ProfileStage::WRITE);
+	bool composite = tile.getDepth() != render_context.tile_set->getDepth();
+	render_context.tile_writer->writeSwap(tile, image, composite);
 }
 
-void TileRenderWorker::renderRecursive(const TilePath& tile, RGBAImage& image) {
-	// if this is tile is not required or we should skip it, try to load it from file
+bool TileRenderWorker::renderRecursive(const TilePath& tile, RGBAImage& image) {
+	util::ProfileScope profile(util::ProfileStage::COMPOSITE);
+	util::MemoryScope memory(util::MemorySubsystem::TILE_BUFFERS);
+	bool render_tile = tile.getDepth() == render_context.tile_set->getDepth();
+	RenderThreadStatus::TileScope status(thread_status,
+			render_context.map_config.getShortName(), tile, render_tile);
+	// if this is tile is not required or we should skip it, try to load it from the tile store
 	if (!render_context.tile_set->isTileRequired(tile)
 			|| render_work.tiles_skip.count(tile)) {
-		bool png = render_context.map_config.getImageFormat() == config::ImageFormat::PNG;
-		fs::path file = render_context.output_dir
-				/ (tile.toString() + "." + render_context.map_config.getImageFormatSuffix());
-		if ((png && image.readPNG(file.string()))
-				|| (!png && image.readJPEG(file.string()))) {
+		// the tile might be still waiting to be written
+		if (render_context.tile_writer->readImage(tile, image)) {
 			if (render_work.tiles_skip.count(tile) && progress != nullptr)
 				progress->setValue(progress->getValue()
 						+ render_context.tile_set->getContainingRenderTiles(tile));
-			return;
+			return false;
+		}
+		// the provisional composite tiles are transparent where tiles are missing
+		if (render_context.provisional) {
+			int size = render_context.tile_renderer->getTileSize();
+			image.setSize(size, size);
+			image.clear();
+			return false;
 		}
 
 		LOG(WARNING) << "Unable to read tile '" << tile.toString()
 				<< "', I will just render it again.";
 	}
 
-	if (tile.getDepth() == render_context.tile_set->getDepth()) {
+	if (render_tile) {
 		// this tile is a render tile, render it
-		render_context.tile_renderer->renderTile(tile.getTilePos()
-				+ render_context.tile_set->getTileOffset(), image);
+		util::TraceScope trace("render tile");
+		if (trace.isActive())
+			trace.setDetail(tile.toString());
+		if (prefetcher)
+			prefetcher->setCurrentTile(render_tile_index++);
+		uint64_t cache_key;
+		bool cached = readCachedTile(tile, cache_key, image);
+		auto start = std::chrono::steady_clock::now();
+		uint64_t drawn_blocks = render_context.tile_renderer->getDrawnBlocks();
+		MAPCRAFTER_PROBE1(tile__render__start, tile.toString().c_str());
+		if (!cached && !renderTilePartially(tile, image)) {
+			auto full_start = std::chrono::steady_clock::now();
+			renderTile(tile, image);
+			if (render_context.tile_costs)
+				render_context.tile_costs->update(tile.getTilePos(),
+						std::chrono::duration_cast<std::chrono::microseconds>(
+								std::chrono::steady_clock::now() - full_start).count());
+		}
+		MAPCRAFTER_PROBE2(tile__render__end, tile.toString().c_str(),
+				render_context.tile_renderer->getDrawnBlocks() - drawn_blocks);
+		if (render_context.slow_tiles)
+			checkSlowTile(tile, std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - start).count(),
+					render_context.tile_renderer->getDrawnBlocks() - drawn_blocks);
+		if (render_context.tile_cache && !cached) {
+			util::ProfileScope profile(util::ProfileStage::WRITE);
+			if (!render_context.tile_cache->write(cache_key, image))
+				LOG(WARNING) << "Unable to write tile '" << tile.toString()
+						<< "' to the tile cache.";
+		}
 		render_work_result.tiles_rendered++;
+		util::Profiler::addMetric(util::Metric::RENDER_TILES);
+		if (thread_status != nullptr)
+			thread_status->tileRendered(render_context.map_config.getShortName(),
+					render_context.world_cache->getChunkCacheStats());
 
 		/*
 		// draws a border on the tile
@@ -124,9 +340,6 @@ void TileRenderWorker::renderRecursive(const TilePath& tile, RGBAImage& image) {
 			}
 		*/
 
-		// save it
-		saveTile(tile, image);
-
 		// update progress
 		if (progress != nullptr)
 			progress->setValue(progress->getValue() + 1);
@@ -134,36 +347,41 @@ void TileRenderWorker::renderRecursive(const TilePath& tile, RGBAImage& image) {
 		// this tile is a composite tile, we need to compose it from its children
 		// just check, if children 1, 2, 3, 4 exists, render it, resize it to the half size
 		// and blit it to the properly position
+		util::TraceScope trace("composite tile");
+		if (trace.isActive())
+			trace.setDetail(tile.toString());
 		//int size = render_context.map_config.getTextureSize() * 32 * TILE_WIDTH;
 		// TODO
 		int size = render_context.tile_renderer->getTileSize();
 		image.setSize(size, size);
+		MAPCRAFTER_PROBE1(composite__start, tile.toString().c_str());
 
-		RGBAImage other;
-		RGBAImage resized;
-		if (render_context.tile_set->hasTile(tile + 1)) {
-			renderRecursive(tile + 1, other);
-			other.resize(resized, 0, 0, InterpolationType::HALF);
-			image.simpleAlphaBlit(resized, 0, 0);
-			other.clear();
-		}
-		if (render_context.tile_set->hasTile(tile + 2)) {
-			renderRecursive(tile + 2, other);
-			other.resize(resized, 0, 0, InterpolationType::HALF);
-			image.simpleAlphaBlit(resized, size / 2, 0);
-			other.clear();
-		}
-		if (render_context.tile_set->hasTile(tile + 3)) {
-			renderRecursive(tile + 3, other);
-			other.resize(resized, 0, 0, InterpolationType::HALF);
-			image.simpleAlphaBlit(resized, 0, size / 2);
-			other.clear();
-		}
-		if (render_context.tile_set->hasTile(tile + 4)) {
-			renderRecursive(tile + 4, other);
-			other.resize(resized, 0, 0, InterpolationType::HALF);
-			image.simpleAlphaBlit(resized, size / 2, size / 2);
+		// the image of the zoom level is transparent before use, like the image of a new
+		// tile, the images handed over to the tile writer are returned transparent
+		RGBAImage& other = composite_images[tile.getDepth()];
+		for (int i = 1; i <= 4; i++) {
+			TilePath child = tile + i;
+			if (!render_context.tile_set->hasTile(child))
+				continue;
+			int x = (i == 2 || i == 4) ? size / 2 : 0;
+			int y = (i == 3 || i == 4) ? size / 2 : 0;
+			// the image of a child tile rendered by another job might be already resized
+			// in memory or saved as thumbnail, otherwise it's rendered or read from disk
+			if (takeTileImage(child, other) || readTileThumbnail(child, size / 2, other)) {
+				image.simpleBlit(other, x, y);
+				other.clear();
+			} else {
+				// the child is resized while it's still in the cache, then it's saved
+				bool rendered = renderRecursive(child, other);
+				blitChildTile(i, other, image, render_context.part_thread_pool.get());
+				if (rendered)
+					saveTile(child, other);
+				else
+					other.clear();
+			}
 		}
+		MAPCRAFTER_PROBE1(composite__end, tile.toString().c_str());
+		util::Profiler::addMetric(util::Metric::COMPOSITE_TILES);
 
 		/*
 		// draws a border on the tile
@@ -175,30 +393,287 @@ void TileRenderWorker::renderRecursive(const TilePath& tile, RGBAImage& image) {
 					tile.setPixel(x, y, rgba(255, 0, 0, 255));
 			}
 		*/
+	}
+	return true;
+}
 
-		// then save the tile
-		saveTile(tile, image);
+void TileRenderWorker::blitChildTile(int child, const RGBAImage& child_image,
+		RGBAImage& image, thread::ThreadPool* thread_pool) {
+	int x = (child == 2 || child == 4) ? image.getWidth() / 2 : 0;
+	int y = (child == 3 || child == 4) ? image.getHeight() / 2 : 0;
+	int parts = thread_pool == nullptr ? 1 : thread_pool->getThreadCount() + 1;
+	int rows = child_image.getHeight() / 2;
+	// small images are not worth handing over to other threads
+	if (parts <= 1 || rows < parts * 16) {
+		imageResizeHalfBlit(child_image, image, x, y);
+		return;
 	}
+
+	// the bands of rows are resized independently, the resized pixels of each row only
+	// depend on the two rows above them
+	auto resizeBand = [&](int part) {
+		int y1 = rows * part / parts, y2 = rows * (part + 1) / parts;
+		imageResizeHalfBlit(child_image.view(0, 2 * y1, child_image.getWidth(),
+				2 * (y2 - y1)), image, x, y + y1);
+	};
+	int running = parts - 1;
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable finished;
+	for (int i = 1; i < parts; i++)
+		thread_pool->run([&, i]() {
+			resizeBand(i);
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			if (--running == 0)
+				finished.notify_all();
+		});
+	resizeBand(0);
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (running > 0)
+		finished.wait(lock);
+}
+
+bool TileRenderWorker::takeTileImage(const TilePath& tile, RGBAImage& image) {
+	if (!render_context.tile_images || !render_work.tiles_skip.count(tile)
+			|| !render_context.tile_images->take(tile, image))
+		return false;
+	if (progress != nullptr)
+		progress->setValue(progress->getValue()
+				+ render_context.tile_set->getContainingRenderTiles(tile));
+	return true;
+}
+
+bool TileRenderWorker::readTileThumbnail(const TilePath& tile, int size,
+		RGBAImage& thumbnail) {
+	bool skip = render_work.tiles_skip.count(tile);
+	if ((render_context.tile_set->isTileRequired(tile) && !skip)
+			|| !render_context.tile_writer->readThumbnail(tile, thumbnail))
+		return false;
+	// the thumbnail is from before the tile size changed
+	if (thumbnail.getWidth() != size || thumbnail.getHeight() != size)
+		return false;
+	if (skip && progress != nullptr)
+		progress->setValue(progress->getValue()
+				+ render_context.tile_set->getContainingRenderTiles(tile));
+	return true;
+}
+
+bool TileRenderWorker::renderTilePartially(const TilePath& tile, RGBAImage& image) {
+	int since = render_context.partial_render_since;
+	if (since == 0)
+		return false;
+	// the chunks of the tile which changed since the last rendering
+	TilePos tile_pos = tile.getTilePos() + render_context.tile_set->getTileOffset();
+	std::set<mc::ChunkPos> chunks;
+	render_context.tile_set->mapTileToChunks(tile_pos, chunks);
+	std::vector<mc::ChunkPos> changed_chunks;
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::RegionFile* region = render_context.world_cache->getRegion(it->getRegion());
+		if (region != nullptr && region->hasChunk(*it)
+				&& (int) region->getChunkTimestamp(*it) > since)
+			changed_chunks.push_back(*it);
+	}
+	if (changed_chunks.empty())
+		return false;
+	if (render_context.tile_writer->readImage(tile, image)
+			&& render_context.tile_renderer->renderTilePartially(tile_pos, changed_chunks,
+					image))
+		return true;
+	image.clear();
+	return false;
+}
+
+void TileRenderWorker::renderTile(const TilePath& tile, RGBAImage& image) {
+	TilePos tile_pos = tile.getTilePos() + render_context.tile_set->getTileOffset();
+	uint64_t key;
+	if (!render_context.tile_geometry
+			|| !render_context.tile_renderer->getGeometryKey(key)) {
+		render_context.tile_renderer->renderTile(tile_pos, image);
+		return;
+	}
+
+	// the key of the geometry describes the options of the tile renderer and the
+	// contents of the tile
+	key = hashTileContents(tile_pos, key);
+
+	TileGeometry geometry;
+	std::string data;
+	if (render_context.tile_geometry->read(tile, data) && geometry.decode(data)
+			&& geometry.key == key) {
+		render_context.tile_renderer->renderTileFromGeometry(tile_pos, geometry, image);
+		return;
+	}
+	render_context.tile_renderer->renderTileGeometry(tile_pos, image, geometry);
+	geometry.key = key;
+	geometry.encode(data);
+	if (!render_context.tile_geometry->write(tile, data))
+		LOG(WARNING) << "Unable to write the geometry of tile '" << tile.toString() << "'.";
+}
+
+bool TileRenderWorker::readCachedTile(const TilePath& tile, uint64_t& key,
+		RGBAImage& image) {
+	if (!render_context.tile_cache)
+		return false;
+	key = hashTileContents(tile.getTilePos() + render_context.tile_set->getTileOffset(),
+			render_context.tile_cache_key);
+	util::ProfileScope profile(util::ProfileStage::TILE_READ);
+	// the size of the image is checked in case of a collision of the keys of tiles with
+	// different sizes
+	int size = render_context.tile_renderer->getTileSize();
+	if (render_context.tile_cache->read(key, image) && image.getWidth() == size
+			&& image.getHeight() == size) {
+		util::Profiler::addMetric(util::Metric::TILE_CACHE_HITS);
+		return true;
+	}
+	// a broken file might be read partially
+	image.clear();
+	util::Profiler::addMetric(util::Metric::TILE_CACHE_MISSES);
+	return false;
+}
+
+uint64_t TileRenderWorker::hashTileContents(const TilePos& tile_pos, uint64_t key) {
+	const uint64_t prime = 0x100000001b3ULL;
+	key = (key ^ (((uint64_t) (uint32_t) tile_pos.getX() << 32)
+			| (uint32_t) tile_pos.getY())) * prime;
+	std::set<mc::ChunkPos> chunks, neighbors;
+	render_context.tile_set->mapTileToChunks(tile_pos, chunks);
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		for (int dx = -1; dx <= 1; dx++)
+			for (int dz = -1; dz <= 1; dz++)
+				neighbors.insert(mc::ChunkPos(it->x + dx, it->z + dz));
+	for (auto it = neighbors.begin(); it != neighbors.end(); ++it)
+		key = (key ^ getChunkHash(*it)) * prime;
+	return key;
+}
+
+void TileRenderWorker::checkSlowTile(const TilePath& tile, double seconds,
+		uint64_t blocks) {
+	if (seconds < render_context.slow_tiles->getThreshold())
+		return;
+	SlowTileLog::SlowTile slow_tile;
+	slow_tile.map = render_context.map_config.getShortName();
+	slow_tile.rotation = render_context.world.getRotation();
+	slow_tile.tile = tile.getTilePos();
+	slow_tile.seconds = seconds;
+	slow_tile.blocks = blocks;
+	// the chunks of the tile which exist
+	std::set<mc::ChunkPos> chunks;
+	render_context.tile_set->mapTileToChunks(tile.getTilePos()
+			+ render_context.tile_set->getTileOffset(), chunks);
+	slow_tile.chunks = 0;
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::RegionFile* region = render_context.world_cache->getRegion(it->getRegion());
+		if (region != nullptr && region->hasChunk(*it))
+			slow_tile.chunks++;
+	}
+	render_context.slow_tiles->add(slow_tile);
+}
+
+uint64_t TileRenderWorker::getChunkHash(const mc::ChunkPos& chunk_pos) {
+	const mc::Chunk* chunk = render_context.world_cache->getChunk(chunk_pos);
+	if (chunk == nullptr)
+		return 0;
+	std::pair<uint64_t, uint64_t>& hash = chunk_hashes[chunk_pos];
+	if (hash.first != chunk->getRevision() || hash.second == 0) {
+		hash.first = chunk->getRevision();
+		hash.second = chunk->getContentHash() ^ ((uint64_t) (uint32_t) chunk_pos.x << 32)
+				^ (uint32_t) chunk_pos.z;
+	}
+	return hash.second;
+}
+
+void TileRenderWorker::collectRenderTiles(const TilePath& tile,
+		std::vector<TilePos>& tiles) const {
+	if (!render_context.tile_set->isTileRequired(tile)
+			|| render_work.tiles_skip.count(tile))
+		return;
+	if (tile.getDepth() == render_context.tile_set->getDepth()) {
+		tiles.push_back(tile.getTilePos() + render_context.tile_set->getTileOffset());
+		return;
+	}
+	for (int i = 1; i <= 4; i++)
+		if (render_context.tile_set->hasTile(tile + i))
+			collectRenderTiles(tile + i, tiles);
 }
 
 void TileRenderWorker::operator()() {
-	int work = 0;
-	for (auto it = render_work.tiles.begin(); it != render_work.tiles.end(); ++it)
-		work += render_context.tile_set->getContainingRenderTiles(*it);
-	if (progress != nullptr) {
-		progress->setMax(work);
-		progress->setValue(0);
-	}
-	
+	int prefetch_threads = render_context.map_config.getPrefetchThreads();
+	int region_decode_threads = render_context.map_config.getRegionDecodeThreads();
+	int regions_ahead = render_context.map_config.getRegionReadAhead();
+	std::vector<TilePos> render_tiles;
+	if (prefetch_threads > 0 || region_decode_threads > 0 || regions_ahead > 0)
+		for (auto it = render_work.tiles.begin(); it != render_work.tiles.end(); ++it)
+			collectRenderTiles(*it, render_tiles);
+
+	// plan the order in which the chunks of the regions are read
+	std::shared_ptr<RegionReadAhead> read_ahead;
+	if (regions_ahead > 0) {
+		if (!region_read_ahead)
+			region_read_ahead = std::make_shared<RegionReadAhead>(render_context.world,
+					render_context.tile_set, regions_ahead);
+		region_read_ahead->start(render_tiles);
+		read_ahead = region_read_ahead;
+	}
+
+	// decode the needed chunks of each region at once when the world caches load it
+	std::shared_ptr<RegionChunkDecoder> decoder;
+	if (region_decode_threads > 0 && render_context.chunk_cache) {
+		if (!region_decoder)
+			region_decoder = std::make_shared<RegionChunkDecoder>(render_context.world,
+					render_context.tile_set, region_decode_threads,
+					render_context.chunk_cache, render_context.unrotated_chunk_cache);
+		region_decoder->setSignCollector(render_context.sign_collector);
+		region_decoder->setUnpackChunks(render_context.map_config.unpackChunks());
+		region_decoder->start(render_tiles);
+		decoder = region_decoder;
+	}
+
+	if (read_ahead || decoder) {
+		auto callback = [read_ahead, decoder](const mc::RegionPos& pos) {
+			if (read_ahead)
+				read_ahead->regionLoaded(pos);
+			if (decoder)
+				decoder->decodeRegion(pos);
+		};
+		render_context.world_cache->setRegionCallback(callback);
+		for (size_t i = 0; i < render_context.part_world_caches.size(); i++)
+			render_context.part_world_caches[i]->setRegionCallback(callback);
+	}
+
+	// start reading the chunks of the render tiles in the background
+	if (prefetch_threads > 0) {
+		if (!prefetcher)
+			prefetcher = std::make_shared<ChunkPrefetcher>(render_context.world,
+					render_context.tile_set, prefetch_threads, render_context.chunk_cache,
+					render_context.unrotated_chunk_cache);
+		prefetcher->setSignCollector(render_context.sign_collector);
+		render_tile_index = 0;
+		prefetcher->start(render_tiles);
+	}
+
+	composite_images.resize(render_context.tile_set->getDepth());
+
 	RGBAImage image;
 	// iterate through the start composite tiles
 	for (auto it = render_work.tiles.begin(); it != render_work.tiles.end(); ++it) {
 		// render this composite tile
-		renderRecursive(*it, image);
+		bool rendered = renderRecursive(*it, image);
+		// and keep the resized image for the parent composite tile
+		if (render_context.tile_images && it->getDepth() > 0) {
+			RGBAImage resized(image.getWidth() / 2, image.getHeight() / 2);
+			blitChildTile(1, image, resized, render_context.part_thread_pool.get());
+			render_context.tile_images->put(*it, resized);
+		}
 
-		// clear image
-		image.clear();
+		// then save it, this clears the image
+		if (rendered)
+			saveTile(*it, image);
+		else
+			image.clear();
 	}
+
+	if (prefetcher)
+		prefetcher->stop();
 }
 
 } /* namespace render */
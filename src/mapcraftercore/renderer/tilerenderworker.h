@@ -23,10 +23,19 @@
 #include "../config/mapcrafterconfig.h"
 #include "../config/configsections/map.h"
 #include "../config/configsections/world.h"
+#include "image.h"
+#include "tileset.h"
+#include "../compat/thread.h"
 #include "../mc/world.h"
+#include "../mc/worldcache.h"
 
+#include <chrono>
+#include <map>
 #include <memory>
+#include <ostream>
 #include <set>
+#include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -34,20 +43,82 @@ namespace fs = boost::filesystem;
 namespace mapcrafter {
 
 namespace mc {
+class ChunkCache;
+class RegionIndex;
+class SignCollector;
 class WorldCache;
 }
 
+namespace thread {
+class ThreadPool;
+}
+
 namespace renderer {
 
 class BlockImages;
+class ChunkPrefetcher;
+class RegionChunkDecoder;
+class RegionReadAhead;
 class RenderMode;
 class RenderView;
-class RGBAImage;
-class TilePath;
+class TileCache;
+class TileCostIndex;
+class TileImageStore;
 class TileRenderer;
 class TileSet;
+class TileStore;
+class TileWriter;
+
+/**
+ * Collects the render tiles which took longer than a threshold to render, like tiles with
+ * huge redstone builds or lots of glass and water. Every slow tile is logged right away
+ * with the count of its chunks and drawn blocks, and the slowest tiles are kept for a
+ * summary at the end of the rendering. The log is shared by the render threads.
+ */
+class SlowTileLog {
+public:
+	struct SlowTile {
+		std::string map;
+		int rotation;
+		TilePos tile;
+		double seconds;
+		int chunks;
+		uint64_t blocks;
+	};
+
+	/**
+	 * The threshold is in seconds, the specified count of the slowest tiles is kept.
+	 */
+	SlowTileLog(double threshold, size_t slowest_count = 10);
+
+	double getThreshold() const;
+
+	/**
+	 * Logs a slow tile and keeps it if it's one of the slowest ones.
+	 */
+	void add(const SlowTile& slow_tile);
+
+	/**
+	 * Returns the slowest tiles so far, the slowest first.
+	 */
+	std::vector<SlowTile> getSlowest() const;
+
+	/**
+	 * Logs the slowest tiles so far, if there are any.
+	 */
+	void logSummary() const;
+
+private:
+	double threshold;
+	size_t slowest_count;
+	size_t count;
+	std::vector<SlowTile> slowest;
+	mutable thread_ns::mutex mutex;
+};
 
 struct RenderContext {
+	RenderContext();
+
 	fs::path output_dir;
 	config::Color background_color;
 	config::WorldSection world_config;
@@ -58,13 +129,73 @@ struct RenderContext {
 	TileSet* tile_set;
 	mc::World world;
 
+	// chunk cache shared between the world caches of multiple threads, may be null
+	std::shared_ptr<mc::ChunkCache> chunk_cache;
+	// cache with the chunks in the original rotation shared between the rotations of
+	// the world, may be null
+	std::shared_ptr<mc::ChunkCache> unrotated_chunk_cache;
+	// cache with the compacted chunks evicted from the chunk caches shared between the
+	// maps of the world with the same rotation, may be null
+	std::shared_ptr<mc::CompressedChunkCache> compressed_chunk_cache;
+	// chunk cache shared with the other processes on this host and the key of the world
+	// rotation there, may be null
+	std::shared_ptr<mc::SharedMemoryChunkCache> shared_memory_chunk_cache;
+	uint64_t shared_memory_world_key;
+	// collects the signs of the decoded chunks for the entities cache of the world,
+	// may be null
+	std::shared_ptr<mc::SignCollector> sign_collector;
+	// remembers the broken regions and chunks of the world across the threads and
+	// renderings, may be null
+	std::shared_ptr<mc::RegionIndex> region_index;
 	std::shared_ptr<mc::WorldCache> world_cache;
+	// count of chunks in the world cache, 0 to use the chunk cache size of the map
+	size_t chunk_cache_size;
+	// the time the last rendering started, the render tiles are rendered partially
+	// onto their previous images where their chunks changed since then (see
+	// TileRenderer::renderTilePartially), 0 to render them completely
+	int partial_render_since;
+	// whether the composite tiles are provisional, they leave out the child tiles which
+	// are not required and not rendered yet instead of rendering them (see
+	// RenderManager::renderProgressive)
+	bool provisional;
+	// store of the images of rendered tiles shared between multiple threads, the
+	// composite tiles take the images of their child tiles from there, may be null
+	std::shared_ptr<TileImageStore> tile_images;
+	// writes the images of the rendered tiles to the tile store on background threads
+	// (or on the render threads without write threads)
+	std::shared_ptr<TileWriter> tile_writer;
+	// the times it took to render the render tiles, updated with the render times of the
+	// completely rendered tiles, may be null
+	std::shared_ptr<TileCostIndex> tile_costs;
+	// collects the render tiles which took long to render, shared between the maps and
+	// threads, may be null
+	std::shared_ptr<SlowTileLog> slow_tiles;
+	// store of the geometry of the render tiles (see TileGeometry) shared between the
+	// maps of the same tile set, the tiles are rendered from the stored geometry if
+	// their chunks didn't change, may be null
+	std::shared_ptr<TileStore> tile_geometry;
+	// cache of the images of render tiles shared between the maps of all worlds (see
+	// TileCache), and the hash of the settings of the map which are part of the keys of
+	// its tiles, may be null
+	std::shared_ptr<TileCache> tile_cache;
+	uint64_t tile_cache_key;
 	std::shared_ptr<RenderMode> render_mode;
 	std::shared_ptr<TileRenderer> tile_renderer;
+	// count of threads rendering the parts of each render tile together, the other
+	// threads render with part renderers of their own (see
+	// TileRenderer::setPartRenderers), 1 renders the tiles with one thread only
+	int tile_threads;
+	std::vector<std::shared_ptr<mc::WorldCache> > part_world_caches;
+	std::vector<std::shared_ptr<RenderMode> > part_render_modes;
+	std::vector<std::shared_ptr<TileRenderer> > part_renderers;
+	std::shared_ptr<thread::ThreadPool> part_thread_pool;
 
 	/**
 	 * Creates/initializes the world cache and tile renderer with the render view and
-	 * other supplied objects (block images, tile set, world).
+	 * other supplied objects (block images, tile set, world). The tiles are as wide as the
+	 * ones of the tile set. If a shared chunk cache is set, the world cache uses it.
+	 * If the tiles are rendered with more than one thread, the part renderers are
+	 * created as well.
 	 *
 	 * This is method is already called in the render management code, but you can copy
 	 * the render context and call this method again if you need multiple tile renderers
@@ -85,6 +216,71 @@ struct RenderWorkResult {
 	int tiles_rendered;
 };
 
+/**
+ * What a render thread is doing, for the status reports (see util::StatusReporter). The
+ * tile render workers of the thread update it, the reports read it from another thread.
+ */
+class RenderThreadStatus {
+public:
+	RenderThreadStatus();
+
+	/**
+	 * Sets the tile of a map the thread works on from its construction until its
+	 * destruction, the previous tile is set again then (a composite tile is worked on
+	 * before and after its children). The status may be null.
+	 */
+	class TileScope {
+	public:
+		TileScope(RenderThreadStatus* status, const std::string& map,
+				const TilePath& tile, bool render_tile = false);
+		~TileScope();
+
+		TileScope(const TileScope&) = delete;
+		TileScope& operator=(const TileScope&) = delete;
+
+	private:
+		RenderThreadStatus* status;
+		std::string previous_map, previous_tile;
+		std::chrono::steady_clock::time_point previous_since;
+		bool previous_render_tile, previous_warned;
+	};
+
+	/**
+	 * Counts a rendered render tile and sets the statistics of the chunk cache of the
+	 * world cache of its map.
+	 */
+	void tileRendered(const std::string& map, const mc::CacheStats& chunk_stats);
+
+	/**
+	 * Returns how many render tiles the thread rendered.
+	 */
+	int getRenderedTiles() const;
+
+	/**
+	 * Writes a line with the tile the thread works on (and for how long), the rendered
+	 * tiles and the chunk cache hits to a status report.
+	 */
+	void report(std::ostream& out, const std::string& name) const;
+
+	/**
+	 * Returns whether the thread has been rendering its render tile for longer than the
+	 * specified seconds, once per tile. The map and tile are returned then.
+	 */
+	bool checkSlowTile(double threshold, std::string& map, std::string& tile,
+			double& seconds);
+
+private:
+	mutable thread_ns::mutex mutex;
+	// the map and tile worked on now, the map is empty if the thread is idle
+	std::string map, tile;
+	std::chrono::steady_clock::time_point since;
+	// whether the tile is a render tile, and whether it was already reported as slow
+	bool render_tile, warned;
+	int rendered_tiles;
+	// the chunk cache statistics of the world caches of the maps
+	std::map<std::string, mc::CacheStats> chunk_stats;
+};
+
 class TileRenderWorker {
 public:
 	TileRenderWorker();
@@ -94,10 +290,98 @@ public:
 	void setRenderWork(const RenderWork& work);
 	const RenderWorkResult& getRenderWorkResult() const;
 
+	/**
+	 * Sets a progress handler whose value is increased by the rendered (and skipped)
+	 * render tiles. The maximum is set by the caller, so multiple render works can add
+	 * to the same progress handler.
+	 */
 	void setProgressHandler(util::IProgressHandler* progress);
 
-	void saveTile(const TilePath& tile, const RGBAImage& image);
-	void renderRecursive(const TilePath& path, RGBAImage& image);
+	/**
+	 * Sets the status of the render thread which the worker updates, may be null.
+	 */
+	void setThreadStatus(RenderThreadStatus* thread_status);
+
+	/**
+	 * Hands the image of a tile over to the tile writer, the image is transparent
+	 * afterwards.
+	 */
+	void saveTile(const TilePath& tile, RGBAImage& image);
+
+	/**
+	 * Renders a tile, a composite tile is composed from its children (which are saved).
+	 * The tile itself is not saved yet, so the caller can resize the image for the
+	 * parent tile before handing it over to the tile writer. Returns false if the image
+	 * was just read from the tile store, it doesn't need to be saved then.
+	 */
+	bool renderRecursive(const TilePath& path, RGBAImage& image);
+
+	/**
+	 * Resizes the image of a child tile (1, 2, 3 or 4) to the half size and blits it to
+	 * its quarter of the image of a composite tile. With a thread pool (may be null),
+	 * bands of rows are resized concurrently by its threads and the calling thread.
+	 */
+	static void blitChildTile(int child, const RGBAImage& child_image, RGBAImage& image,
+			thread::ThreadPool* thread_pool = nullptr);
+
+	/**
+	 * Takes the resized image of a tile to skip from the tile image store of the render
+	 * context. Returns false if it's not in there, it needs to be read from disk then.
+	 */
+	bool takeTileImage(const TilePath& tile, RGBAImage& image);
+
+	/**
+	 * Reads the thumbnail of a tile which is not required or to skip, if the tile writer
+	 * saves thumbnails. Returns false if there is no thumbnail with the half size of a
+	 * tile, the tile needs to be read from disk (and decoded) then.
+	 */
+	bool readTileThumbnail(const TilePath& tile, int size, RGBAImage& thumbnail);
+
+	/**
+	 * Renders a render tile partially onto its previous image if partial rendering is
+	 * enabled, only where the chunks of the tile changed since the last rendering.
+	 * Returns false if the tile has to be rendered completely, the image is transparent
+	 * then.
+	 */
+	bool renderTilePartially(const TilePath& tile, RGBAImage& image);
+
+	/**
+	 * Renders a render tile completely, from its stored geometry if there is a tile
+	 * geometry store and the geometry is still up to date. Otherwise the geometry is
+	 * recorded while rendering and stored.
+	 */
+	void renderTile(const TilePath& tile, RGBAImage& image);
+
+	/**
+	 * Returns the key of a render tile in the tile cache, and reads its image from the
+	 * cache. Returns false if there is no tile cache or the cache doesn't have the
+	 * image, the tile needs to be rendered then.
+	 */
+	bool readCachedTile(const TilePath& tile, uint64_t& key, RGBAImage& image);
+
+	/**
+	 * Extends a key with the position of a render tile and the contents of its chunks and
+	 * of the chunks next to them, whose blocks are checked as neighbors of the blocks of
+	 * the tile.
+	 */
+	uint64_t hashTileContents(const TilePos& tile_pos, uint64_t key);
+
+	/**
+	 * Adds a render tile to the slow tile log of the render context if it took longer
+	 * than the threshold of the log to render.
+	 */
+	void checkSlowTile(const TilePath& tile, double seconds, uint64_t blocks);
+
+	/**
+	 * Returns the hash of the contents of a chunk (see mc::Chunk::getContentHash),
+	 * 0 if the chunk doesn't exist.
+	 */
+	uint64_t getChunkHash(const mc::ChunkPos& chunk);
+
+	/**
+	 * Collects the render tiles renderRecursive will render (in the same order).
+	 */
+	void collectRenderTiles(const TilePath& path, std::vector<TilePos>& tiles) const;
 
 	void operator()();
 
@@ -108,6 +392,26 @@ private:
 
 	// progress handler
 	util::IProgressHandler* progress;
+	RenderThreadStatus* thread_status;
+
+	// prefetches chunks of the next render tiles if enabled,
+	// and index of the current render tile for it
+	std::shared_ptr<ChunkPrefetcher> prefetcher;
+	size_t render_tile_index;
+	// decodes the chunks of the render work in a region at once when the region is
+	// loaded, if enabled
+	std::shared_ptr<RegionChunkDecoder> region_decoder;
+	// reads the chunks of the render work ahead in the order of the region files when
+	// the regions are loaded, if enabled
+	std::shared_ptr<RegionReadAhead> region_read_ahead;
+
+	// the temporary images of the child tiles to compose the composite tiles of each
+	// zoom level, kept to reuse their memory
+	std::vector<RGBAImage> composite_images;
+
+	// the hashes of the contents of the chunks (see getChunkHash) with the revisions of
+	// the chunks they were computed for
+	std::map<mc::ChunkPos, std::pair<uint64_t, uint64_t> > chunk_hashes;
 };
 
 } /* namespace render */
@@ -18,23 +18,92 @@
  */
 
 #include "tileset.h"
+#include "tilestore.h"
 
 #include "../mc/chunk.h"
 #include "../mc/pos.h"
 #include "../mc/world.h"
+#include "../compat/thread.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <ctime>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <set>
 #include <sstream>
+#include <thread>
 
 namespace mapcrafter {
 namespace renderer {
 
+namespace {
+
+/**
+ * Returns the squared distance (in half render tiles) between the area of a tile and
+ * the center of a render tile, 0 if the tile contains the render tile.
+ */
+int64_t getTileDistance(const TilePath& tile, int depth, const TilePos& render_tile) {
+	// doubled coordinates, so the centers of the render tiles are on integral positions
+	int64_t size = int64_t(2) << (depth - tile.getDepth());
+	TilePos pos = tile.getTilePos();
+	int64_t x = 2 * render_tile.getX() + 1, y = 2 * render_tile.getY() + 1;
+	int64_t dx = std::max(pos.getX() * size - x, x - (pos.getX() + 1) * size);
+	int64_t dy = std::max(pos.getY() * size - y, y - (pos.getY() + 1) * size);
+	dx = std::max<int64_t>(0, dx);
+	dy = std::max<int64_t>(0, dy);
+	return dx * dx + dy * dy;
+}
+
+/**
+ * Returns whether all chunks of a region (original, not rotated position) are contained
+ * in the world crop. The crop boundaries are convex, so it's enough to check the chunks
+ * in the corners of the region.
+ */
+bool isRegionCompletelyContained(const mc::WorldCrop& world_crop,
+		const mc::RegionPos& region) {
+	int x = region.x * 32, z = region.z * 32;
+	return world_crop.isChunkContained(mc::ChunkPos(x, z))
+			&& world_crop.isChunkContained(mc::ChunkPos(x + 31, z))
+			&& world_crop.isChunkContained(mc::ChunkPos(x, z + 31))
+			&& world_crop.isChunkContained(mc::ChunkPos(x + 31, z + 31));
+}
+
+/**
+ * Returns the position of a render tile, for the sets of tile positions and for the
+ * render tiles with their timestamps.
+ */
+const TilePos& getRenderTilePos(const TilePos& tile) {
+	return tile;
+}
+
+const TilePos& getRenderTilePos(const std::pair<TilePos, int>& tile) {
+	return tile.first;
+}
+
+bool compareRenderTiles(const std::pair<TilePos, int>& tile1,
+		const std::pair<TilePos, int>& tile2) {
+	return tile1.first < tile2.first;
+}
+
+/**
+ * Returns the render tile with a position, or the end of the render tiles.
+ */
+std::vector<std::pair<TilePos, int> >::const_iterator findRenderTile(
+		const std::vector<std::pair<TilePos, int> >& render_tiles, const TilePos& tile) {
+	auto it = std::lower_bound(render_tiles.begin(), render_tiles.end(),
+			std::make_pair(tile, 0), compareRenderTiles);
+	if (it != render_tiles.end() && it->first != tile)
+		return render_tiles.end();
+	return it;
+}
+
+}
+
 TilePos::TilePos(int x, int y)
 	: x(x), y(y) {
 }
@@ -88,36 +157,47 @@ std::ostream& operator<<(std::ostream& stream, const TilePos& tile) {
 	return stream;
 }
 
-TilePath::TilePath() {
+const int TilePath::MAX_DEPTH;
+
+TilePath::TilePath()
+	: key(0) {
 }
 
 TilePath::~TilePath() {
 }
 
 int TilePath::getDepth() const {
-	return path.size();
+	return key & 63;
 }
 
-const std::vector<int>& TilePath::getPath() const {
-	return path;
+int TilePath::getNode(int level) const {
+	return ((key >> (64 - 2 * level)) & 3) + 1;
+}
+
+uint64_t TilePath::getKey() const {
+	return key;
 }
 
 TilePath TilePath::parent() const {
-	TilePath copy(*this);
-	copy.path.pop_back();
+	int depth = getDepth();
+	if (depth == 0)
+		return *this;
+	TilePath copy;
+	copy.key = (key & ~(uint64_t(3) << (64 - 2 * depth)) & ~uint64_t(63)) | (depth - 1);
 	return copy;
 }
 
 TilePos TilePath::getTilePos() const {
+	int depth = getDepth();
 	// calculate the radius of all tiles on the top zoom level (2^zoomlevel / 2)
-	int radius = pow(2, path.size()) / 2;
+	int radius = (1 << depth) / 2;
 	// the startpoint is top left
 	int x = -radius;
 	int y = -radius;
-	for (size_t i = 0; i < path.size(); i++) {
+	for (int level = 1; level <= depth; level++) {
 		// now for every zoom level:
 		// get the current tile
-		int tile = path[i];
+		int tile = getNode(level);
 		// increase x by the radius if this tile is on the right side (2 or 4)
 		if (tile == 2 || tile == 4)
 			x += radius;
@@ -131,7 +211,12 @@ TilePos TilePath::getTilePos() const {
 }
 
 TilePath& TilePath::operator+=(int node) {
-	path.push_back(node);
+	int depth = getDepth();
+	if (depth >= MAX_DEPTH)
+		throw std::runtime_error("Tile path " + toString() + " is already at the maximum "
+				"zoom level " + util::str(MAX_DEPTH));
+	key = (key & ~uint64_t(63)) | (uint64_t((node - 1) & 3) << (62 - 2 * depth))
+			| (depth + 1);
 	return *this;
 }
 
@@ -140,11 +225,15 @@ TilePath TilePath::operator+(int node) const {
 }
 
 bool TilePath::operator==(const TilePath& other) const {
-	return path == other.path;
+	return key == other.key;
+}
+
+bool TilePath::operator!=(const TilePath& other) const {
+	return key != other.key;
 }
 
 bool TilePath::operator<(const TilePath& other) const {
-	return path < other.path;
+	return key < other.key;
 }
 
 std::ostream& operator<<(std::ostream& stream, const TilePath& path) {
@@ -153,13 +242,13 @@ std::ostream& operator<<(std::ostream& stream, const TilePath& path) {
 }
 
 std::string TilePath::toString() const {
-	std::stringstream ss;
-	for (size_t i = 0; i < path.size(); i++) {
-		ss << path[i];
-		if (i != path.size() - 1)
-			ss << "/";
+	std::string str;
+	for (int level = 1; level <= getDepth(); level++) {
+		if (level != 1)
+			str += '/';
+		str += (char) ('0' + getNode(level));
 	}
-	return ss.str();
+	return str;
 }
 
 TilePath TilePath::byTilePos(const TilePos& tile, int depth) {
@@ -220,60 +309,194 @@ TilePath TilePath::byTilePos(const TilePos& tile, int depth) {
 }
 
 TileSet::TileSet(int tile_width)
-	: tile_width(tile_width), min_depth(0), depth(0) {
+	: tile_width(tile_width), min_depth(0), depth(0), subtree_levels(0) {
 }
 
 TileSet::~TileSet() {
 }
 
-void TileSet::findRenderTiles(const mc::World& world, bool auto_center,
-		TilePos& tile_offset) {
-	// clear maybe already calculated tiles
-	render_tiles.clear();
-	required_render_tiles.clear();
+TileSet::ScannedTiles::ScannedTiles()
+	: bounds_only(false), subtrees_of(nullptr),
+	  x_min(std::numeric_limits<int>::max()), x_max(std::numeric_limits<int>::min()),
+	  y_min(std::numeric_limits<int>::max()), y_max(std::numeric_limits<int>::min()) {
+}
 
-	// the min/max x/y coordinates of the tiles in the world
-	int tiles_x_min = std::numeric_limits<int>::max(),
-	    tiles_x_max = std::numeric_limits<int>::min(),
-	    tiles_y_min = std::numeric_limits<int>::max(),
-	    tiles_y_max = std::numeric_limits<int>::min();
+void TileSet::ScannedTiles::add(const TilePos& tile, int timestamp) {
+	x_min = std::min(x_min, tile.getX());
+	x_max = std::max(x_max, tile.getX());
+	y_min = std::min(y_min, tile.getY());
+	y_max = std::max(y_max, tile.getY());
+	if (bounds_only)
+		return;
+
+	// the tiles of the subtrees which are not kept are dropped, the tiles outside of the
+	// tile set as well (the world changed since its bounds were scanned)
+	if (subtrees_of != nullptr) {
+		TilePath subtree;
+		if (!subtrees_of->getSubtree(tile - subtrees_of->tile_offset, subtree))
+			return;
+		subtrees.insert(subtree);
+		if (!subtrees_of->subtree_filter(subtree))
+			return;
+	}
+
+	auto it = tile_timestamps.insert(std::make_pair(tile, timestamp));
+	if (!it.second)
+		it.first->second = std::max(it.first->second, timestamp);
+}
+
+void TileSet::scanRegions(const mc::World& world,
+		const std::vector<mc::RegionPos>& regions, mc::RegionIndex* region_index,
+		std::atomic<size_t>& next_region, ScannedTiles& scanned) {
+	mc::WorldCrop world_crop = world.getWorldCrop();
+	std::set<TilePos> tiles;
+	std::vector<std::pair<TilePos, int> > region_tiles;
+	std::vector<int32_t> index_tiles;
+	while (true) {
+		size_t index = next_region++;
+		if (index >= regions.size())
+			return;
+
+		// the tiles of regions which are not cropped can be taken from the index
+		std::string region_file = world.getRegionPath(regions[index]).string();
+		std::time_t mtime;
+		uint64_t size;
+		bool use_index = region_index != nullptr && !index_key.empty()
+				&& isRegionCompletelyContained(world_crop,
+						mc::RegionPos::byFilename(region_file))
+				&& mc::RegionIndex::stat(region_file, mtime, size);
+		if (use_index && region_index->findTiles(region_file, mtime, size, index_key,
+				index_tiles)) {
+			for (size_t i = 0; i + 2 < index_tiles.size(); i += 3)
+				scanned.add(TilePos(index_tiles[i], index_tiles[i + 1]),
+						index_tiles[i + 2]);
+			continue;
+		}
 
-	// go through all chunks in the world
-	auto regions = world.getAvailableRegions();
-	for (auto region_it = regions.begin(); region_it != regions.end(); ++region_it) {
 		mc::RegionFile region;
-		if (!world.getRegion(*region_it, region) || !region.readOnlyHeaders())
+		if (!world.getRegion(regions[index], region))
+			continue;
+		if (region_index != nullptr ? !region.readOnlyHeaders(*region_index)
+				: !region.readOnlyHeaders())
 			continue;
+
+		// collect the tiles of all chunks, a tile has the highest timestamp of its chunks
+		region_tiles.clear();
 		const std::set<mc::ChunkPos>& region_chunks = region.getContainingChunks();
 		for (auto chunk_it = region_chunks.begin(); chunk_it != region_chunks.end();
 		        ++chunk_it) {
 			int timestamp = region.getChunkTimestamp(*chunk_it);
-
-			// now get all tiles of the chunk
-			std::set<TilePos> tiles;
+			tiles.clear();
 			mapChunkToTiles(*chunk_it, tiles);
-			for (std::set<TilePos>::const_iterator tile_it = tiles.begin();
-			        tile_it != tiles.end(); ++tile_it) {
-
-				// and update the bounds
-				tiles_x_min = std::min(tiles_x_min, tile_it->getX());
-				tiles_x_max = std::max(tiles_x_max, tile_it->getX());
-				tiles_y_min = std::min(tiles_y_min, tile_it->getY());
-				tiles_y_max = std::max(tiles_y_max, tile_it->getY());
-
-				// update tile timestamp
-				if (!render_tiles.count(*tile_it))
-					tile_timestamps[*tile_it] = timestamp;
-				else
-					tile_timestamps[*tile_it] = std::max(tile_timestamps[*tile_it], timestamp);
-
-				// insert the tile to the set of available render tiles
-				// and also make it required by default
-				render_tiles.insert(*tile_it);
-				required_render_tiles.insert(*tile_it);
+			for (auto tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it)
+				region_tiles.push_back(std::make_pair(*tile_it, timestamp));
+		}
+		std::sort(region_tiles.begin(), region_tiles.end());
+
+		index_tiles.clear();
+		for (size_t i = 0; i < region_tiles.size(); i++) {
+			// sorted by position and timestamp, the last one of a position is used
+			if (i + 1 < region_tiles.size()
+					&& region_tiles[i].first == region_tiles[i + 1].first)
+				continue;
+			const TilePos& tile = region_tiles[i].first;
+			scanned.add(tile, region_tiles[i].second);
+			if (use_index) {
+				index_tiles.push_back(tile.getX());
+				index_tiles.push_back(tile.getY());
+				index_tiles.push_back(region_tiles[i].second);
 			}
 		}
+		if (use_index)
+			region_index->updateTiles(region_file, mtime, size, index_key, index_tiles);
+	}
+}
+
+void TileSet::scanTiles(const mc::World& world, mc::RegionIndex* region_index,
+		int threads, const ScannedTiles& init, std::vector<ScannedTiles>& scanned) {
+	// go through all chunks in the world,
+	// the threads take the regions one by one and collect their tiles separately
+	const auto& available_regions = world.getAvailableRegions();
+	std::vector<mc::RegionPos> regions(available_regions.begin(), available_regions.end());
+	threads = std::max(1, std::min(threads, (int) regions.size()));
+	scanned.assign(threads, init);
+	std::atomic<size_t> next_region(0);
+	if (threads == 1) {
+		scanRegions(world, regions, region_index, next_region, scanned[0]);
+	} else {
+		std::vector<thread_ns::thread> scan_threads;
+		for (int i = 0; i < threads; i++)
+			scan_threads.push_back(thread_ns::thread(&TileSet::scanRegions, this,
+					std::cref(world), std::cref(regions), region_index,
+					std::ref(next_region), std::ref(scanned[i])));
+		for (int i = 0; i < threads; i++)
+			scan_threads[i].join();
 	}
+}
+
+void TileSet::mergeScannedTiles(std::vector<ScannedTiles>& scanned) {
+	render_tiles.clear();
+	for (auto scanned_it = scanned.begin(); scanned_it != scanned.end(); ++scanned_it) {
+		render_tiles.insert(render_tiles.end(), scanned_it->tile_timestamps.begin(),
+				scanned_it->tile_timestamps.end());
+		std::unordered_map<TilePos, int, tile_pos_hash_function>().swap(
+				scanned_it->tile_timestamps);
+	}
+	// sorted by position and timestamp, the last one of the same position is kept
+	std::sort(render_tiles.begin(), render_tiles.end());
+	size_t merged = 0;
+	for (size_t i = 0; i < render_tiles.size(); i++) {
+		if (merged > 0 && render_tiles[merged - 1].first == render_tiles[i].first)
+			render_tiles[merged - 1].second = render_tiles[i].second;
+		else
+			render_tiles[merged++] = render_tiles[i];
+	}
+	render_tiles.resize(merged);
+	render_tiles.shrink_to_fit();
+}
+
+bool TileSet::getSubtree(const TilePos& tile, TilePath& subtree) const {
+	int radius = (1 << depth) / 2;
+	if (tile.getX() < -radius || tile.getX() >= radius
+			|| tile.getY() < -radius || tile.getY() >= radius)
+		return false;
+	subtree = TilePath::byTilePos(tile, depth);
+	for (int i = 0; i < subtree_levels && subtree.getDepth() > 0; i++)
+		subtree = subtree.parent();
+	return true;
+}
+
+void TileSet::addSkippedSubtrees(std::set<TilePath>& tiles) const {
+	for (auto it = skipped_subtrees.begin(); it != skipped_subtrees.end(); ++it)
+		for (TilePath tile = *it; tiles.insert(tile).second && tile.getDepth() > 0; )
+			tile = tile.parent();
+}
+
+void TileSet::findRenderTiles(const mc::World& world, bool auto_center,
+		TilePos& tile_offset, mc::RegionIndex* region_index, int threads) {
+	// clear maybe already calculated tiles
+	render_tiles.clear();
+	required_render_tiles.clear();
+	skipped_subtrees.clear();
+
+	// with a subtree filter, the tiles are scanned once the zoom level is known
+	ScannedTiles init;
+	init.bounds_only = (bool) subtree_filter;
+	std::vector<ScannedTiles> scanned;
+	scanTiles(world, region_index, threads, init, scanned);
+
+	// the min/max x/y coordinates of the tiles in the world
+	int tiles_x_min = std::numeric_limits<int>::max(),
+	    tiles_x_max = std::numeric_limits<int>::min(),
+	    tiles_y_min = std::numeric_limits<int>::max(),
+	    tiles_y_max = std::numeric_limits<int>::min();
+	for (auto scanned_it = scanned.begin(); scanned_it != scanned.end(); ++scanned_it) {
+		tiles_x_min = std::min(tiles_x_min, scanned_it->x_min);
+		tiles_x_max = std::max(tiles_x_max, scanned_it->x_max);
+		tiles_y_min = std::min(tiles_y_min, scanned_it->y_min);
+		tiles_y_max = std::max(tiles_y_max, scanned_it->y_max);
+	}
+	mergeScannedTiles(scanned);
 
 	// center tiles
 	if (auto_center || tile_offset != TilePos(0, 0)) {
@@ -281,22 +504,16 @@ void TileSet::findRenderTiles(const mc::World& world, bool auto_center,
 		if (auto_center)
 			tile_offset = TilePos((tiles_x_min + tiles_x_max) / 2, (tiles_y_min + tiles_y_max) / 2);
 
-		// update all tile positions
-		std::set<TilePos> render_tiles_tmp, required_render_tiles_tmp;
-		std::map<TilePos, int> tile_timestamps_tmp;
+		// update all tile positions, this doesn't change their order
 		for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it)
-			render_tiles_tmp.insert(*it - tile_offset);
-		for (auto it = required_render_tiles.begin(); it != required_render_tiles.end(); ++it)
-			required_render_tiles_tmp.insert(*it - tile_offset);
-		for (auto it = tile_timestamps.begin(); it != tile_timestamps.end(); ++it)
-			tile_timestamps_tmp[it->first - tile_offset] = it->second;
-
-		render_tiles = render_tiles_tmp;
-		required_render_tiles = required_render_tiles_tmp;
-		tile_timestamps = tile_timestamps_tmp;
+			it->first -= tile_offset;
 		this->tile_offset = tile_offset;
 	}
 
+	// all render tiles are required by default
+	for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it)
+		required_render_tiles.insert(required_render_tiles.end(), it->first);
+
 	// now get the necessary depth of the tile quadtree
 	for (min_depth = 0; min_depth < 32; min_depth++) {
 		// for each level calculate the radius and check if the tiles fit in this bounds
@@ -310,31 +527,39 @@ void TileSet::findRenderTiles(const mc::World& world, bool auto_center,
 	}
 }
 
-void TileSet::findRequiredCompositeTiles(const std::set<TilePos>& render_tiles,
+template <typename Iterator>
+void TileSet::findRequiredCompositeTiles(Iterator begin, Iterator end,
 		std::set<TilePath>& tiles) {
-
-	// iterate through the render tiles on the max zoom level
-	// add their parent composite tiles
-	for (std::set<TilePos>::iterator it = render_tiles.begin(); it != render_tiles.end(); ++it) {
-		TilePath path = TilePath::byTilePos(*it, depth);
-		tiles.insert(path.parent());
+	// take the parent composite tiles of the render tiles on the max zoom level,
+	// then go through the composite tiles from bottom to top and add their parents
+	std::vector<TilePath> level;
+	for (Iterator it = begin; it != end; ++it)
+		level.push_back(TilePath::byTilePos(getRenderTilePos(*it), depth).parent());
+	for (int d = depth - 1; d >= 0 && !level.empty(); d--) {
+		std::sort(level.begin(), level.end());
+		level.erase(std::unique(level.begin(), level.end()), level.end());
+		tiles.insert(level.begin(), level.end());
+		for (auto it = level.begin(); it != level.end(); ++it)
+			*it = it->parent();
 	}
+}
 
-	// now iterate through the composite tiles from bottom to top
-	// and also add their parent composite tiles
-	for (int d = depth - 1; d > 0; d--) {
-		std::set<TilePath> tmp;
-		for (std::set<TilePath>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
-			if (it->getDepth() == d)
-				tmp.insert(it->parent());
-		}
-		for (std::set<TilePath>::iterator it = tmp.begin(); it != tmp.end(); ++it)
-			tiles.insert(*it);
+void TileSet::splitRequiredTile(const TilePath& tile, double job_size,
+		std::vector<TilePath>& tiles) const {
+	if (tile.getDepth() == depth || getContainingCost(tile) <= job_size) {
+		tiles.push_back(tile);
+		return;
 	}
+	for (int i = 1; i <= 4; i++)
+		if (isTileRequired(tile + i))
+			splitRequiredTile(tile + i, job_size, tiles);
 }
 
 void TileSet::updateContainingRenderTiles() {
+	render_tile_costs.clear();
+	containing_costs.clear();
 	containing_render_tiles.clear();
+	containing_render_tiles.reserve(composite_tiles.size());
 	// initialize every composite tile with 0
 	for (auto it = composite_tiles.begin(); it != composite_tiles.end(); ++it)
 		containing_render_tiles[*it] = 0;
@@ -350,62 +575,165 @@ void TileSet::updateContainingRenderTiles() {
 	}
 }
 
-void TileSet::scan(const mc::World& world) {
+void TileSet::setIndexKey(const std::string& index_key) {
+	this->index_key = index_key;
+}
+
+void TileSet::setSubtreeFilter(int levels,
+		const std::function<bool(const TilePath&)>& filter) {
+	subtree_levels = levels;
+	subtree_filter = filter;
+}
+
+void TileSet::scanSubtrees(const mc::World& world, mc::RegionIndex* region_index,
+		int threads) {
+	util::MemoryScope memory(util::MemorySubsystem::TILE_SETS);
+	ScannedTiles init;
+	init.subtrees_of = this;
+	std::vector<ScannedTiles> scanned;
+	scanTiles(world, region_index, threads, init, scanned);
+
+	skipped_subtrees.clear();
+	for (auto scanned_it = scanned.begin(); scanned_it != scanned.end(); ++scanned_it)
+		for (auto it = scanned_it->subtrees.begin(); it != scanned_it->subtrees.end(); ++it)
+			if (!subtree_filter(*it))
+				skipped_subtrees.insert(*it);
+	mergeScannedTiles(scanned);
+
+	// the tiles were scanned with the offset of the first scan, all of them are required
+	required_render_tiles.clear();
+	for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it) {
+		it->first -= tile_offset;
+		required_render_tiles.insert(required_render_tiles.end(), it->first);
+	}
+
+	composite_tiles.clear();
+	required_composite_tiles.clear();
+	findRequiredCompositeTiles(render_tiles.begin(), render_tiles.end(), composite_tiles);
+	addSkippedSubtrees(composite_tiles);
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
+
+	updateContainingRenderTiles();
+}
+
+void TileSet::scan(const mc::World& world, mc::RegionIndex* region_index, int threads) {
 	TilePos tile_offset(0, 0);
-	scan(world, false, tile_offset);
+	scan(world, false, tile_offset, region_index, threads);
 	setDepth(min_depth);
 }
 
-void TileSet::scan(const mc::World& world, bool auto_center, TilePos& tile_offset) {
-	findRenderTiles(world, auto_center, tile_offset);
+void TileSet::scan(const mc::World& world, bool auto_center, TilePos& tile_offset,
+		mc::RegionIndex* region_index, int threads) {
+	util::MemoryScope memory(util::MemorySubsystem::TILE_SETS);
+	findRenderTiles(world, auto_center, tile_offset, region_index, threads);
 	setDepth(min_depth);
 }
 
 void TileSet::resetRequired() {
+	util::MemoryScope memory(util::MemorySubsystem::TILE_SETS);
 	required_render_tiles.clear();
 
-	for (auto it = tile_timestamps.begin(); it != tile_timestamps.end(); ++it)
-		required_render_tiles.insert(it->first);
+	for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it)
+		required_render_tiles.insert(required_render_tiles.end(), it->first);
 
 	required_composite_tiles.clear();
-	findRequiredCompositeTiles(required_render_tiles, required_composite_tiles);
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
+	addSkippedSubtrees(required_composite_tiles);
 
 	updateContainingRenderTiles();
 }
 
 void TileSet::scanRequiredByTimestamp(int last_change) {
+	util::MemoryScope memory(util::MemorySubsystem::TILE_SETS);
 	required_render_tiles.clear();
 
-	for (std::map<TilePos, int>::iterator it = tile_timestamps.begin();
-			it != tile_timestamps.end(); ++it) {
+	for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it) {
 		if (it->second >= last_change)
-			required_render_tiles.insert(it->first);
+			required_render_tiles.insert(required_render_tiles.end(), it->first);
 	}
 
 	required_composite_tiles.clear();
-	findRequiredCompositeTiles(required_render_tiles, required_composite_tiles);
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
+
+	updateContainingRenderTiles();
+}
+
+void TileSet::scanRequiredByFiletimes(TileStore& store) {
+	util::MemoryScope memory(util::MemorySubsystem::TILE_SETS);
+	// all render tiles are required, except the ones written after their chunks changed,
+	// the tiles are read from the store at once instead of looking up every tile
+	required_render_tiles.clear();
+	for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it)
+		required_render_tiles.insert(required_render_tiles.end(), it->first);
+
+	store.getModificationTimes(depth, [this](const TilePath& tile, std::time_t time) {
+		auto it = findRenderTile(render_tiles, tile.getTilePos());
+		if (it != render_tiles.end() && time > it->second)
+			required_render_tiles.erase(it->first);
+	});
+
+	required_composite_tiles.clear();
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
 
 	updateContainingRenderTiles();
 }
 
-void TileSet::scanRequiredByFiletimes(const fs::path& output_dir,
-		std::string image_format) {
+void TileSet::scanRequiredByChunks(const std::set<mc::ChunkPos>& chunks) {
+	util::MemoryScope memory(util::MemorySubsystem::TILE_SETS);
+	std::set<TilePos> tiles;
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		mapChunkToTiles(*it, tiles);
+	// the render tiles are stored without the tile offset
 	required_render_tiles.clear();
+	for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+		TilePos tile = *it - tile_offset;
+		if (findRenderTile(render_tiles, tile) != render_tiles.end())
+			required_render_tiles.insert(required_render_tiles.end(), tile);
+	}
 
-	for (std::map<TilePos, int>::iterator it = tile_timestamps.begin();
-			it != tile_timestamps.end(); ++it) {
-		TilePath path = TilePath::byTilePos(it->first, depth);
-		fs::path file = output_dir / (path.toString() + "." + image_format);
-		if (!fs::exists(file) || fs::last_write_time(file) <= it->second)
-			required_render_tiles.insert(it->first);
+	required_composite_tiles.clear();
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
+
+	updateContainingRenderTiles();
+}
+
+void TileSet::filterRequired(const std::function<bool(const TilePos&)>& required) {
+	for (auto it = required_render_tiles.begin(); it != required_render_tiles.end(); ) {
+		if (!required(*it))
+			it = required_render_tiles.erase(it);
+		else
+			++it;
 	}
 
 	required_composite_tiles.clear();
-	findRequiredCompositeTiles(required_render_tiles, required_composite_tiles);
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
 
 	updateContainingRenderTiles();
 }
 
+void TileSet::filterRequiredRenderTiles(const std::function<bool(const TilePos&)>& required) {
+	for (auto it = required_render_tiles.begin(); it != required_render_tiles.end(); ) {
+		if (!required(*it))
+			it = required_render_tiles.erase(it);
+		else
+			++it;
+	}
+	updateContainingRenderTiles();
+}
+
+void TileSet::setRequired(const std::set<TilePos>& render_tiles,
+		const std::set<TilePath>& composite_tiles) {
+	required_render_tiles = render_tiles;
+	required_composite_tiles = composite_tiles;
+	updateContainingRenderTiles();
+}
+
 int TileSet::getTileWidth() const {
 	return tile_width;
 }
@@ -429,8 +757,9 @@ void TileSet::setDepth(int depth) {
 	composite_tiles.clear();
 	required_composite_tiles.clear();
 
-	findRequiredCompositeTiles(render_tiles, composite_tiles);
-	findRequiredCompositeTiles(required_render_tiles, required_composite_tiles);
+	findRequiredCompositeTiles(render_tiles.begin(), render_tiles.end(), composite_tiles);
+	findRequiredCompositeTiles(required_render_tiles.begin(), required_render_tiles.end(),
+			required_composite_tiles);
 
 	updateContainingRenderTiles();
 }
@@ -441,10 +770,23 @@ const TilePos& TileSet::getTileOffset() const {
 
 bool TileSet::hasTile(const TilePath& path) const {
 	if (path.getDepth() == depth)
-		return render_tiles.count(path.getTilePos()) != 0;
+		return findRenderTile(render_tiles, path.getTilePos()) != render_tiles.end();
 	return composite_tiles.count(path) != 0;
 }
 
+std::set<TilePath> TileSet::getTiles(int zoom) const {
+	std::set<TilePath> tiles;
+	if (zoom == depth) {
+		for (auto it = render_tiles.begin(); it != render_tiles.end(); ++it)
+			tiles.insert(TilePath::byTilePos(it->first, depth));
+		return tiles;
+	}
+	for (auto it = composite_tiles.begin(); it != composite_tiles.end(); ++it)
+		if (it->getDepth() == zoom)
+			tiles.insert(*it);
+	return tiles;
+}
+
 bool TileSet::isTileRequired(const TilePath& path) const {
 	if(path.getDepth() == depth)
 		return required_render_tiles.count(path.getTilePos()) != 0;
@@ -468,8 +810,128 @@ const std::set<TilePath>& TileSet::getRequiredCompositeTiles() const {
 }
 
 int TileSet::getContainingRenderTiles(const TilePath& tile) const {
+	if (tile.getDepth() == depth)
+		return isTileRequired(tile) ? 1 : 0;
 	return containing_render_tiles.at(tile);
 }
 
+void TileSet::setRenderTileCosts(
+		const std::unordered_map<TilePos, double, tile_pos_hash_function>& costs) {
+	render_tile_costs.clear();
+	containing_costs.clear();
+	if (costs.empty())
+		return;
+	containing_costs.reserve(containing_render_tiles.size());
+	for (auto it = containing_render_tiles.begin(); it != containing_render_tiles.end(); ++it)
+		containing_costs[it->first] = 0;
+	for (auto it = required_render_tiles.begin(); it != required_render_tiles.end(); ++it) {
+		auto cost_it = costs.find(*it);
+		double cost = cost_it != costs.end() ? cost_it->second : 1;
+		if (cost != 1)
+			render_tile_costs[*it] = cost;
+		TilePath tile = TilePath::byTilePos(*it, depth);
+		while (tile.getDepth() != 0) {
+			tile = tile.parent();
+			containing_costs[tile] += cost;
+		}
+	}
+}
+
+double TileSet::getContainingCost(const TilePath& tile) const {
+	if (containing_costs.empty())
+		return getContainingRenderTiles(tile);
+	if (tile.getDepth() == depth) {
+		if (!isTileRequired(tile))
+			return 0;
+		auto it = render_tile_costs.find(tile.getTilePos());
+		return it != render_tile_costs.end() ? it->second : 1;
+	}
+	return containing_costs.at(tile);
+}
+
+std::vector<std::set<TilePath> > TileSet::partitionRequiredTiles(double job_size,
+		const std::vector<TilePos>& priority_tiles) const {
+	std::vector<TilePath> tiles;
+	for (auto it = required_composite_tiles.begin(); it != required_composite_tiles.end(); ++it)
+		if (it->getDepth() == depth - 2)
+			splitRequiredTile(*it, job_size, tiles);
+
+	// tiles with enough render tiles are a job on their own, the other ones are
+	// collected (in the order of the tiles, so close tiles are mostly in one job)
+	std::vector<std::pair<double, std::set<TilePath> > > jobs;
+	std::pair<double, std::set<TilePath> > merged(0, std::set<TilePath>());
+	for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+		double size = getContainingCost(*it);
+		if (size >= job_size) {
+			jobs.push_back(std::make_pair(size, std::set<TilePath>({*it})));
+			continue;
+		}
+		merged.first += size;
+		merged.second.insert(*it);
+		if (merged.first >= job_size) {
+			jobs.push_back(merged);
+			merged = std::make_pair(0.0, std::set<TilePath>());
+		}
+	}
+	if (!merged.second.empty())
+		jobs.push_back(merged);
+
+	std::stable_sort(jobs.begin(), jobs.end(),
+		[](const std::pair<double, std::set<TilePath> >& job1,
+				const std::pair<double, std::set<TilePath> >& job2) {
+			return job1.first > job2.first;
+		});
+	if (!priority_tiles.empty()) {
+		// the (squared) distance of every job to the closest priority tile
+		std::vector<std::pair<int64_t, size_t> > distances;
+		for (size_t i = 0; i < jobs.size(); i++) {
+			int64_t distance = std::numeric_limits<int64_t>::max();
+			for (auto it = jobs[i].second.begin(); it != jobs[i].second.end(); ++it)
+				for (auto tile_it = priority_tiles.begin(); tile_it != priority_tiles.end();
+						++tile_it)
+					distance = std::min(distance, getTileDistance(*it, depth, *tile_it));
+			distances.push_back(std::make_pair(distance, i));
+		}
+		// the jobs with the same distance stay ordered by their size
+		std::sort(distances.begin(), distances.end());
+		std::vector<std::pair<double, std::set<TilePath> > > sorted_jobs;
+		for (auto it = distances.begin(); it != distances.end(); ++it)
+			sorted_jobs.push_back(jobs[it->second]);
+		jobs.swap(sorted_jobs);
+	}
+	std::vector<std::set<TilePath> > partition;
+	for (auto it = jobs.begin(); it != jobs.end(); ++it)
+		partition.push_back(it->second);
+	return partition;
+}
+
+std::set<TilePos> TileSet::sampleRequiredRenderTiles(int levels) const {
+	int level = std::max(0, depth - levels);
+	// twice the position of the center of a composite tile, in render tiles
+	int64_t center = (1LL << (depth - level)) - 1;
+	std::map<TilePath, std::pair<int64_t, TilePos> > closest;
+	for (auto it = required_render_tiles.begin(); it != required_render_tiles.end(); ++it) {
+		TilePath path = TilePath::byTilePos(*it, depth);
+		// the position of the render tile in its composite tile
+		int64_t x = 0, y = 0;
+		for (int i = level + 1; i <= depth; i++) {
+			int node = path.getNode(i);
+			x = 2 * x + (node == 2 || node == 4);
+			y = 2 * y + (node == 3 || node == 4);
+		}
+		while (path.getDepth() > level)
+			path = path.parent();
+		int64_t distance = (2 * x - center) * (2 * x - center)
+				+ (2 * y - center) * (2 * y - center);
+		auto found = closest.find(path);
+		if (found == closest.end() || distance < found->second.first)
+			closest[path] = std::make_pair(distance, *it);
+	}
+	std::set<TilePos> sample;
+	for (auto it = closest.begin(); it != closest.end(); ++it)
+		sample.insert(it->second.second);
+	return sample;
+}
+
 }
 }
@@ -20,8 +20,14 @@
 #ifndef TILE_H_
 #define TILE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <boost/filesystem.hpp>
 
@@ -62,11 +68,15 @@ namespace mapcrafter {
 
 namespace mc {
 class ChunkPos;
+class RegionIndex;
+class RegionPos;
 class World;
 }
 
 namespace renderer {
 
+class TileStore;
+
 /**
  * This class represents the position of a tile in the quadtree.
  */
@@ -105,6 +115,11 @@ std::ostream& operator<<(std::ostream& stream, const TilePos& tile);
  * This class represents the path to a tile in the quadtree.
  * Every part in the path is a 1, 2, 3 or 4.
  * The length of the path is the zoom level of the tile.
+ *
+ * The path is packed into a 64 bit key, the nodes are two bits each from the highest
+ * bits on, and the lowest six bits are the zoom level. Comparing the keys is the same
+ * as comparing the paths (a parent tile is less than its children, and the children are
+ * less than the next tile).
  */
 class TilePath {
 public:
@@ -117,9 +132,15 @@ public:
 	int getDepth() const;
 
 	/**
-	 * Returns the path.
+	 * Returns the node (1, 2, 3 or 4) of a zoom level of the path, the first node is the
+	 * one of zoom level 1.
+	 */
+	int getNode(int level) const;
+
+	/**
+	 * Returns the packed path, which is an unique key of the tile.
 	 */
-	const std::vector<int>& getPath() const;
+	uint64_t getKey() const;
 
 	/**
 	 * Returns the path of the parent tile.
@@ -133,13 +154,15 @@ public:
 	TilePos getTilePos() const;
 
 	/**
-	 * Adds a node to the path.
+	 * Adds a node to the path. Throws a std::runtime_error if the path is at the
+	 * maximum zoom level already.
 	 */
 	TilePath& operator+=(int node);
 	TilePath operator+(int node) const;
 
 	// some more comparison operations
 	bool operator==(const TilePath& other) const;
+	bool operator!=(const TilePath& other) const;
 	bool operator<(const TilePath& other) const;
 
 	/**
@@ -153,12 +176,32 @@ public:
 	 */
 	static TilePath byTilePos(const TilePos& tile, int depth);
 
+	// the maximum zoom level of a path
+	static const int MAX_DEPTH = 29;
+
 private:
-	std::vector<int> path;
+	uint64_t key;
 };
 
 std::ostream& operator<<(std::ostream& stream, const TilePath& path);
 
+/**
+ * Hash functions to use tile positions and paths in unordered_set/map.
+ */
+struct tile_pos_hash_function {
+	size_t operator()(const TilePos& tile) const {
+		return (static_cast<size_t>(static_cast<uint32_t>(tile.getX())) * 0x9e3779b1u)
+				^ static_cast<uint32_t>(tile.getY());
+	}
+};
+
+struct tile_path_hash_function {
+	size_t operator()(const TilePath& tile) const {
+		uint64_t key = tile.getKey() * 0x9e3779b97f4a7c15ull;
+		return static_cast<size_t>(key ^ (key >> 32));
+	}
+};
+
 /**
  * This class manages all tiles required to render a world.
  */
@@ -169,6 +212,13 @@ public:
 
 	virtual void mapChunkToTiles(const mc::ChunkPos& chunk, std::set<TilePos>& tiles) = 0;
 
+	/**
+	 * The opposite of mapChunkToTiles: Calculates all chunks (which might exist) a
+	 * render tile covers. Like the tiles of mapChunkToTiles, the tile is not centered
+	 * (add the tile offset to the position of a render tile).
+	 */
+	virtual void mapTileToChunks(const TilePos& tile, std::set<mc::ChunkPos>& chunks) = 0;
+
 	/**
 	 * Scans the tiles of a world.
 	 * If you use the constructor with a world object as parameter, this method is
@@ -178,9 +228,46 @@ public:
 	 * found tiles. If set to false (default), it will use tile_offset as center. The
 	 * default value for tile_offset is (0, 0) when using scan without the
 	 * auto_center and tile_offset parameters.
+	 *
+	 * If a region index is supplied, the headers of the region files which were not
+	 * modified are taken from the index, and the index is updated with the others.
+	 * If the tile set has an index key, the tiles of unchanged region files which are
+	 * not cropped are taken from the index as well. The regions are scanned with the
+	 * specified count of threads.
+	 */
+	void scan(const mc::World& world, mc::RegionIndex* region_index = nullptr,
+			int threads = 1);
+	void scan(const mc::World& world, bool auto_center, TilePos& tile_offset,
+			mc::RegionIndex* region_index = nullptr, int threads = 1);
+
+	/**
+	 * Sets the key the scanned tiles of this tile set are stored with in the region
+	 * index. It has to identify the render view, tile width and rotation of the tile
+	 * set (for example the string of the tile set id). Empty by default, the tiles are
+	 * not stored in the index then.
 	 */
-	void scan(const mc::World& world);
-	void scan(const mc::World& world, bool auto_center, TilePos& tile_offset);
+	void setIndexKey(const std::string& index_key);
+
+	/**
+	 * Keeps only the tiles of some subtrees in memory, for example if a shard of a huge
+	 * world is rendered. The subtrees are the tiles the specified count of zoom levels
+	 * above the render tiles (or the top tile), and the function tells which of them
+	 * are kept. It's called by the scanning threads concurrently.
+	 *
+	 * With a filter, scan() only finds the zoom level and the offset of the tiles, the
+	 * tiles are found by scanSubtrees() once the zoom level is set. The roots of the
+	 * other subtrees are contained in the tile set, but not their children. They are
+	 * only required after resetRequired().
+	 */
+	void setSubtreeFilter(int levels, const std::function<bool(const TilePath&)>& filter);
+
+	/**
+	 * Scans the tiles of the subtrees kept by the subtree filter, after the zoom level
+	 * was set with setDepth(). The zoom level must not change afterwards. All found
+	 * render tiles are required.
+	 */
+	void scanSubtrees(const mc::World& world, mc::RegionIndex* region_index = nullptr,
+			int threads = 1);
 
 	/**
 	 * Resets which tiles are required / not required. All tiles will be required.
@@ -195,10 +282,35 @@ public:
 
 	/**
 	 * Scans which tiles are required by using the modification times of the already
-	 * rendered image files.
+	 * rendered tiles in a tile store.
+	 */
+	void scanRequiredByFiletimes(TileStore& store);
+
+	/**
+	 * Sets the render tiles of changed chunks (in the rotation of the tile set) required,
+	 * for example if the changed chunks are known without scanning the timestamps.
+	 */
+	void scanRequiredByChunks(const std::set<mc::ChunkPos>& chunks);
+
+	/**
+	 * Removes the required render tiles for which the supplied function returns false,
+	 * for example tiles whose chunks didn't change since the last rendering. The
+	 * required composite tiles are updated accordingly.
+	 */
+	void filterRequired(const std::function<bool(const TilePos&)>& required);
+
+	/**
+	 * Like filterRequired, but the required composite tiles stay required, for example
+	 * if the removed render tiles are up to date, but not their composite tiles.
+	 */
+	void filterRequiredRenderTiles(const std::function<bool(const TilePos&)>& required);
+
+	/**
+	 * Sets the required render and composite tiles, for example to restore the ones
+	 * scanned before.
 	 */
-	void scanRequiredByFiletimes(const fs::path& output_dir,
-			std::string image_format = "png");
+	void setRequired(const std::set<TilePos>& render_tiles,
+			const std::set<TilePath>& composite_tiles);
 
 	/**
 	 * Returns the width of the tiles in chunks.
@@ -231,6 +343,11 @@ public:
 	 */
 	bool hasTile(const TilePath& path) const;
 
+	/**
+	 * Returns the tiles of a specific zoom level, the required and the not required ones.
+	 */
+	std::set<TilePath> getTiles(int zoom) const;
+
 	/**
 	 * Returns if a specific tile is required, e.g. needs to get rendered.
 	 */
@@ -257,13 +374,50 @@ public:
 	const std::set<TilePath>& getRequiredCompositeTiles() const;
 
 	/**
-	 * Returns the count of required render tiles a specific composite tiles contains.
+	 * Returns the count of required render tiles a specific composite tiles contains
+	 * (1 for a required render tile).
 	 */
 	int getContainingRenderTiles(const TilePath& tile) const;
 
+	/**
+	 * Sets the expected costs (render times) of required render tiles, relative to the
+	 * average render tile (the other ones cost 1). The costs are reset when the required
+	 * tiles change, without costs every required render tile costs 1.
+	 */
+	void setRenderTileCosts(
+			const std::unordered_map<TilePos, double, tile_pos_hash_function>& costs);
+
+	/**
+	 * Returns the expected cost of the required render tiles a tile contains, that is the
+	 * count of required render tiles if there are no costs.
+	 */
+	double getContainingCost(const TilePath& tile) const;
+
+	/**
+	 * Partitions the required tiles into jobs of about the specified cost (the count of
+	 * required render tiles without costs). The composite tiles two zoom levels above
+	 * the render tiles are split into their children if they cost more, and the cheaper
+	 * ones are merged into one job. A job is a set of tiles which don't contain each
+	 * other; the jobs are ordered by their cost, the most expensive first.
+	 *
+	 * If priority render tiles are specified (for example the tiles of areas players
+	 * look at), the jobs are ordered by their distance to the closest one instead.
+	 */
+	std::vector<std::set<TilePath> > partitionRequiredTiles(double job_size,
+			const std::vector<TilePos>& priority_tiles = std::vector<TilePos>()) const;
+
+	/**
+	 * Returns a sample of the required render tiles spread over the map: of the required
+	 * render tiles below every composite tile the specified count of zoom levels above
+	 * the render tiles (or below the top tile), the one closest to its center.
+	 */
+	std::set<TilePos> sampleRequiredRenderTiles(int levels) const;
+
 private:
 	// width of the tiles in chunks
 	int tile_width;
+	// key of the scanned tiles in the region index
+	std::string index_key;
 
 	// the minimum maximum zoom level which would be required to render all tiles
 	int min_depth;
@@ -275,21 +429,29 @@ private:
 	// but are actually rendered as pos+tile_offset
 	TilePos tile_offset;
 
-	// all available render tiles
-	// (= tiles with the highest zoom level, tree leaves in the quadtree)
-	std::set<TilePos> render_tiles;
+	// all available render tiles (sorted) with their timestamps required to re-render a
+	// tile (= tiles with the highest zoom level, tree leaves in the quadtree, and the
+	// highest timestamp of all chunks in a tile)
+	std::vector<std::pair<TilePos, int> > render_tiles;
 	// the render tiles which actually need to get rendered
 	std::set<TilePos> required_render_tiles;
-	// timestamps of render tiles required to re-render a tile
-	// (= highest timestamp of all chunks in a tile)
-	std::map<TilePos, int> tile_timestamps;
 
 	// same here for composite tiles
 	std::set<TilePath> composite_tiles;
 	std::set<TilePath> required_composite_tiles;
 
 	// count of required render tiles contained in a composite tile
-	std::map<TilePath, int> containing_render_tiles;
+	std::unordered_map<TilePath, int, tile_path_hash_function> containing_render_tiles;
+	// the expected costs of the required render tiles which don't cost 1, and the costs
+	// of the required render tiles contained in a composite tile (empty without costs)
+	std::unordered_map<TilePos, double, tile_pos_hash_function> render_tile_costs;
+	std::unordered_map<TilePath, double, tile_path_hash_function> containing_costs;
+
+	// the zoom levels of the subtrees above the render tiles and which of them are kept
+	// (see setSubtreeFilter), and the roots of the subtrees which are not kept
+	int subtree_levels;
+	std::function<bool(const TilePath&)> subtree_filter;
+	std::set<TilePath> skipped_subtrees;
 
 	/**
 	 * This method finds out which render level tiles a world has and which maximum
@@ -298,19 +460,87 @@ private:
 	 * The auto_center parameter describes whether it should automatically center the
 	 * found tiles. If set to false (default), it will use tile_offset as center.
 	 */
-	void findRenderTiles(const mc::World& world, bool auto_center, TilePos& tile_offset);
+	void findRenderTiles(const mc::World& world, bool auto_center, TilePos& tile_offset,
+			mc::RegionIndex* region_index, int threads);
+
+	/**
+	 * Splits a required tile into its required children until they cost at most the
+	 * specified job size, and collects them.
+	 */
+	void splitRequiredTile(const TilePath& tile, double job_size,
+			std::vector<TilePath>& tiles) const;
+
+	/**
+	 * The render tiles found by one thread scanning the world.
+	 */
+	struct ScannedTiles {
+		ScannedTiles();
+
+		/**
+		 * Adds a render tile with the timestamp of one of its chunks and updates the
+		 * bounds.
+		 */
+		void add(const TilePos& tile, int timestamp);
+
+		// whether only the bounds of the tiles are found, and the tile set whose subtree
+		// filter tells which tiles are kept (null to keep all tiles)
+		bool bounds_only;
+		const TileSet* subtrees_of;
+
+		// render tiles with their timestamps (= highest timestamp of all chunks in a tile)
+		std::unordered_map<TilePos, int, tile_pos_hash_function> tile_timestamps;
+		// the roots of the subtrees of the tiles, with a subtree filter only
+		std::unordered_set<TilePath, tile_path_hash_function> subtrees;
+		// the min/max x/y coordinates of the tiles
+		int x_min, x_max, y_min, y_max;
+	};
+
+	/**
+	 * Scans the regions of a world with the specified count of threads, every thread
+	 * collects the tiles it finds in a copy of the supplied scanned tiles.
+	 */
+	void scanTiles(const mc::World& world, mc::RegionIndex* region_index, int threads,
+			const ScannedTiles& init, std::vector<ScannedTiles>& scanned);
+
+	/**
+	 * Scans regions for scanTiles, takes the next region to scan from next_region
+	 * until all regions are scanned. Called by every scanning thread.
+	 */
+	void scanRegions(const mc::World& world, const std::vector<mc::RegionPos>& regions,
+			mc::RegionIndex* region_index, std::atomic<size_t>& next_region,
+			ScannedTiles& scanned);
+
+	/**
+	 * Sets the render tiles to the tiles found by the scanning threads, a tile found by
+	 * multiple threads has the highest of their timestamps.
+	 */
+	void mergeScannedTiles(std::vector<ScannedTiles>& scanned);
+
+	/**
+	 * Returns the root of the subtree of a render tile (see setSubtreeFilter), false if
+	 * the render tile is outside of the tile set.
+	 */
+	bool getSubtree(const TilePos& tile, TilePath& subtree) const;
+
+	/**
+	 * Adds the roots of the subtrees which are not kept and their parents to a set of
+	 * composite tiles.
+	 */
+	void addSkippedSubtrees(std::set<TilePath>& tiles) const;
 
 	/**
 	 * This method finds out which composite tiles are needed, depending on a
 	 * list of available/required render tiles, and puts them into a set.
 	 * So we can find out which composite tiles are available and which composite tiles
-	 * need to get rendered.
+	 * need to get rendered. The render tiles are a range of tile positions (or of render
+	 * tiles with their timestamps).
 	 */
-	void findRequiredCompositeTiles(const std::set<TilePos>& render_tiles,
+	template <typename Iterator>
+	void findRequiredCompositeTiles(Iterator begin, Iterator end,
 			std::set<TilePath>& tiles);
 
 	/**
-	 * Updates the containing_render_tiles map.
+	 * Updates the containing_render_tiles map, and resets the costs.
 	 */
 	void updateContainingRenderTiles();
 };
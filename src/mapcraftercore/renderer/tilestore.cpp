@@ -0,0 +1,1198 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilestore.h"
+
+#include "tileuploader.h"
+#include "../config.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__) || defined(HAVE_OPENAT)
+# include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_OPENAT
+# include <cerrno>
+# include <cstring>
+# include <dirent.h>
+# include <sys/stat.h>
+#endif
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// the tiles of a bundle are the ones of a zoom level below a tile four levels above
+const int BUNDLE_LEVELS = 4;
+const int BUNDLE_SIZE = 1 << BUNDLE_LEVELS;
+const int BUNDLE_SLOTS = BUNDLE_SIZE * BUNDLE_SIZE;
+
+// "MCTB", version of the bundle file format and the count of slots of the index, the
+// values are little endian, so the web interface can read the bundles everywhere
+const uint32_t BUNDLE_MAGIC = 0x4d435442;
+const uint32_t BUNDLE_VERSION = 1;
+const size_t BUNDLE_INDEX_OFFSET = 12;
+const size_t BUNDLE_ENTRY_SIZE = 12;
+const size_t BUNDLE_HEADER_SIZE = BUNDLE_INDEX_OFFSET + BUNDLE_SLOTS * BUNDLE_ENTRY_SIZE;
+
+// a bundle is written once this many bytes of its tiles are buffered, all bundles are
+// written once this many bytes of all tiles are buffered
+const size_t BUNDLE_BUFFER_BYTES = 1024 * 1024;
+const size_t MAX_BUFFERED_BYTES = 16 * 1024 * 1024;
+
+// count of bundle indexes kept in memory
+const size_t INDEX_CACHE_SIZE = 256;
+
+// the suffix of the temporary files of the tiles being written
+const char* TEMP_SUFFIX = ".tmp";
+
+// count of directories of tiles kept open by a file tile store
+const size_t OPEN_DIRECTORIES = 64;
+
+void putUInt32(std::string& out, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		out += (char) ((value >> (8 * i)) & 0xff);
+}
+
+#ifndef HAVE_OPENAT
+/**
+ * Replaces a file with a temporary file, readers see either the old or the new file.
+ */
+bool replaceFile(const std::string& temp, const std::string& file) {
+	boost::system::error_code error;
+	fs::rename(temp, file, error);
+	if (error) {
+		LOG(WARNING) << "Unable to replace '" << file << "' (" << error.message() << ").";
+		std::remove(temp.c_str());
+		return false;
+	}
+	return true;
+}
+#endif
+
+/**
+ * Writes the modified data of the file system of a directory to disk. This is one
+ * syncfs call on Linux instead of syncing every file, elsewhere everything is synced.
+ */
+void syncFileSystem(const fs::path& dir) {
+#ifdef __linux__
+	int fd = ::open(dir.string().c_str(), O_RDONLY);
+	if (fd != -1) {
+		int result = ::syncfs(fd);
+		::close(fd);
+		if (result == 0)
+			return;
+	}
+#endif
+#ifdef HAVE_UNISTD_H
+	::sync();
+#endif
+}
+
+uint32_t getUInt32(const char* data) {
+	const uint8_t* bytes = (const uint8_t*) data;
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+#ifndef HAVE_OPENAT
+bool readFile(const std::string& file, std::string& data) {
+	std::ifstream in(file.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	data = buffer.str();
+	return !in.bad();
+}
+#endif
+
+bool readFileRange(const fs::path& file, uint32_t offset, uint32_t size, std::string& data) {
+	std::ifstream in(file.string().c_str(), std::ios::binary);
+	data.resize(size);
+	return in && in.seekg(offset) && in.read(&data[0], size);
+}
+
+/**
+ * Returns the path of a tile after the tiles were moved one zoom level deeper.
+ */
+TilePath moveDeeper(const TilePath& tile) {
+	TilePath moved;
+	for (int level = 1; level <= tile.getDepth(); level++) {
+		moved += tile.getNode(level);
+		// 1/ -> 1/4/, 2/ -> 2/3/, 3/ -> 3/2/ and 4/ -> 4/1/
+		if (level == 1)
+			moved += 5 - tile.getNode(1);
+	}
+	return moved;
+}
+
+}
+
+TileStore::TileStore(const fs::path& output_dir, const std::string& image_format)
+	: output_dir(output_dir), image_format(image_format), journal(nullptr),
+	  uploader(nullptr),
+	  tile_file_prefix(output_dir.string()), tile_file_suffix("." + image_format),
+	  sync_interval(0), unsynced_tiles(0) {
+	if (!tile_file_prefix.empty() && tile_file_prefix.back() != '/')
+		tile_file_prefix += '/';
+}
+
+TileStore::~TileStore() {
+}
+
+const fs::path& TileStore::getOutputDir() const {
+	return output_dir;
+}
+
+void TileStore::setJournal(RenderJournal* journal) {
+	this->journal = journal;
+}
+
+void TileStore::setUploader(TileUploader* uploader) {
+	this->uploader = uploader;
+}
+
+void TileStore::setWrittenCallback(WrittenCallback written_callback) {
+	this->written_callback = written_callback;
+}
+
+void TileStore::setSyncInterval(int sync_interval) {
+	this->sync_interval = sync_interval;
+}
+
+fs::path TileStore::getTileFile(const TilePath& tile) const {
+	std::string file;
+	getTileFile(tile, file);
+	return file;
+}
+
+void TileStore::getTileFile(const TilePath& tile, std::string& file) const {
+	file.assign(tile_file_prefix);
+	if (tile.getDepth() == 0)
+		file.append("base");
+	for (int level = 1; level <= tile.getDepth(); level++) {
+		if (level != 1)
+			file += '/';
+		file += (char) ('0' + tile.getNode(level));
+	}
+	file.append(tile_file_suffix);
+}
+
+void TileStore::prepare(const std::set<TilePath>& composite_tiles) {
+}
+
+bool TileStore::link(const TilePath& original, const TilePath& tile) {
+	std::string data;
+	return read(original, data) && write(tile, data);
+}
+
+void TileStore::keep(const TilePath& tile) {
+	// nothing was written, there is nothing to sync
+	if (journal != nullptr)
+		journal->add(getTileFile(tile));
+	if (written_callback)
+		written_callback(tile);
+}
+
+bool TileStore::touch(const TilePath& tile) {
+	std::string data;
+	return read(tile, data) && write(tile, data);
+}
+
+bool TileStore::exists(const TilePath& tile) {
+	std::time_t time;
+	return getModificationTime(tile, time);
+}
+
+void TileStore::flush() {
+	if (sync_interval != 0)
+		sync();
+}
+
+void TileStore::written(const TilePath& tile) {
+	if (journal != nullptr)
+		journal->add(getTileFile(tile));
+	if (uploader != nullptr)
+		uploader->upload(getTileFile(tile).string());
+	if (written_callback)
+		written_callback(tile);
+	if (sync_interval > 0 && ++unsynced_tiles >= sync_interval)
+		sync();
+}
+
+void TileStore::sync() {
+	// the tiles written while syncing are synced by the next sync
+	if (unsynced_tiles.exchange(0) == 0)
+		return;
+	util::TraceScope trace("sync tiles");
+	syncFileSystem(output_dir);
+}
+
+/**
+ * A directory of the tile files. The files are accessed relative to the open directory
+ * (with openat and the like), so only their names are resolved by the kernel. Without
+ * these functions the files are accessed by their paths.
+ */
+class FileTileStore::Directory {
+public:
+	~Directory() {
+#ifdef HAVE_OPENAT
+		::close(fd);
+#endif
+	}
+
+	/**
+	 * Opens a directory by its path, or a directory in another directory by its name.
+	 * The directory is created if it doesn't exist and create is set. Returns null if
+	 * it can't be opened.
+	 */
+	static DirectoryPtr open(const fs::path& path, bool create) {
+		boost::system::error_code error;
+		if (create)
+			fs::create_directories(path, error);
+#ifdef HAVE_OPENAT
+		int fd = ::open(path.string().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd == -1)
+			return DirectoryPtr();
+		return DirectoryPtr(new Directory(path.string(), fd));
+#else
+		if (!fs::is_directory(path, error))
+			return DirectoryPtr();
+		return DirectoryPtr(new Directory(path.string()));
+#endif
+	}
+
+	static DirectoryPtr open(const Directory& parent, const std::string& name,
+			bool create) {
+#ifdef HAVE_OPENAT
+		int fd = ::openat(parent.fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd == -1 && errno == ENOENT && create) {
+			// another thread might create it at the same time
+			::mkdirat(parent.fd, name.c_str(), 0777);
+			fd = ::openat(parent.fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		}
+		if (fd == -1)
+			return DirectoryPtr();
+		return DirectoryPtr(new Directory(parent.path + name, fd));
+#else
+		return open(parent.path + name, create);
+#endif
+	}
+
+	/**
+	 * Returns the path of the directory, with a slash at the end.
+	 */
+	const std::string& getPath() const {
+		return path;
+	}
+
+	/**
+	 * Creates a directory in this directory, if it doesn't exist already.
+	 */
+	bool createDirectory(const std::string& name) const {
+#ifdef HAVE_OPENAT
+		return ::mkdirat(fd, name.c_str(), 0777) == 0 || errno == EEXIST;
+#else
+		boost::system::error_code error;
+		fs::create_directory(path + name, error);
+		return !error;
+#endif
+	}
+
+	/**
+	 * Writes data to a file, or creates a hardlink of a file. The data or the link is
+	 * written to a temporary file next to the file first, which then replaces the file,
+	 * so nobody reads a half written file. If the file was a hardlink of other tiles,
+	 * they keep their images. The written file gets the modification time time if it's
+	 * not 0.
+	 */
+	bool writeFile(const std::string& name, const std::string& data,
+			std::time_t time = 0) const {
+		std::string temp = name + TEMP_SUFFIX;
+#ifdef HAVE_OPENAT
+		int file = ::openat(fd, temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+				0666);
+		bool ok = file != -1;
+		for (size_t written = 0; ok && written < data.size(); ) {
+			ssize_t bytes = ::write(file, data.data() + written, data.size() - written);
+			if (bytes == -1 && errno == EINTR)
+				continue;
+			ok = bytes > 0;
+			written += ok ? bytes : 0;
+		}
+		if (ok && time != 0) {
+			struct timespec times[2];
+			times[0].tv_sec = 0;
+			times[0].tv_nsec = UTIME_OMIT;
+			times[1].tv_sec = time;
+			times[1].tv_nsec = 0;
+			::futimens(file, times);
+		}
+		if (file != -1)
+			ok = ::close(file) == 0 && ok;
+		if (!ok) {
+			LOG(WARNING) << "Unable to write '" << path << name << "'.";
+			::unlinkat(fd, temp.c_str(), 0);
+			return false;
+		}
+#else
+		{
+			std::ofstream out((path + temp).c_str(), std::ios::binary);
+			if (!out || !out.write(data.data(), data.size()) || !out.flush()) {
+				LOG(WARNING) << "Unable to write '" << path << name << "'.";
+				std::remove((path + temp).c_str());
+				return false;
+			}
+		}
+		if (time != 0) {
+			boost::system::error_code error;
+			fs::last_write_time(path + temp, time, error);
+		}
+#endif
+		return replaceFile(temp, name);
+	}
+
+	bool linkFile(const Directory& original_dir, const std::string& original,
+			const std::string& name) const {
+		std::string temp = name + TEMP_SUFFIX;
+#ifdef HAVE_OPENAT
+		::unlinkat(fd, temp.c_str(), 0);
+		if (::linkat(original_dir.fd, original.c_str(), fd, temp.c_str(), 0) != 0) {
+			LOG(WARNING) << "Unable to create hardlink '" << path << name << "' of '"
+					<< original_dir.path << original << "' (" << std::strerror(errno)
+					<< ").";
+			return false;
+		}
+#else
+		std::remove((path + temp).c_str());
+		boost::system::error_code error;
+		fs::create_hard_link(original_dir.path + original, path + temp, error);
+		if (error) {
+			LOG(WARNING) << "Unable to create hardlink '" << path << name << "' of '"
+					<< original_dir.path << original << "' (" << error.message() << ").";
+			return false;
+		}
+#endif
+		return replaceFile(temp, name);
+	}
+
+	bool readFile(const std::string& name, std::string& data) const {
+#ifdef HAVE_OPENAT
+		int file = ::openat(fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file == -1)
+			return false;
+		struct stat st;
+		data.clear();
+		if (::fstat(file, &st) == 0)
+			data.reserve(st.st_size);
+		char buffer[16384];
+		ssize_t bytes;
+		while ((bytes = ::read(file, buffer, sizeof(buffer))) != 0) {
+			if (bytes == -1 && errno == EINTR)
+				continue;
+			if (bytes == -1)
+				break;
+			data.append(buffer, bytes);
+		}
+		::close(file);
+		return bytes == 0;
+#else
+		return mapcrafter::renderer::readFile(path + name, data);
+#endif
+	}
+
+	/**
+	 * Returns the modification time of a file and how many hardlinks it has.
+	 */
+	bool getFileStatus(const std::string& name, std::time_t& time, int& links) const {
+#ifdef HAVE_OPENAT
+		struct stat st;
+		if (::fstatat(fd, name.c_str(), &st, 0) != 0)
+			return false;
+		time = st.st_mtime;
+		links = st.st_nlink;
+		return true;
+#else
+		boost::system::error_code error;
+		time = fs::last_write_time(path + name, error);
+		if (!error)
+			links = fs::hard_link_count(path + name, error);
+		return !error;
+#endif
+	}
+
+	bool setModificationTime(const std::string& name, std::time_t time) const {
+#ifdef HAVE_OPENAT
+		struct timespec times[2];
+		times[0].tv_sec = 0;
+		times[0].tv_nsec = UTIME_OMIT;
+		times[1].tv_sec = time;
+		times[1].tv_nsec = 0;
+		return ::utimensat(fd, name.c_str(), times, 0) == 0;
+#else
+		boost::system::error_code error;
+		fs::last_write_time(path + name, time, error);
+		return !error;
+#endif
+	}
+
+	/**
+	 * Returns the names of the files and directories in this directory.
+	 */
+	std::vector<std::string> list() const {
+		std::vector<std::string> names;
+#ifdef HAVE_OPENAT
+		// the directory stream takes the file descriptor, it gets a duplicate of its own
+		int dup_fd = ::openat(fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		DIR* dir = dup_fd == -1 ? nullptr : ::fdopendir(dup_fd);
+		if (dir == nullptr) {
+			if (dup_fd != -1)
+				::close(dup_fd);
+			return names;
+		}
+		for (struct dirent* entry; (entry = ::readdir(dir)) != nullptr;)
+			names.push_back(entry->d_name);
+		::closedir(dir);
+#else
+		boost::system::error_code error;
+		for (fs::directory_iterator it(path, error), end; !error && it != end;
+				it.increment(error))
+			names.push_back(it->path().filename().string());
+#endif
+		return names;
+	}
+
+private:
+#ifdef HAVE_OPENAT
+	Directory(const std::string& path, int fd)
+		: path(path + "/"), fd(fd) {}
+#else
+	Directory(const std::string& path)
+		: path(path + "/") {}
+#endif
+
+	/**
+	 * Replaces a file with a temporary file, readers see either the old or the new file.
+	 */
+	bool replaceFile(const std::string& temp, const std::string& name) const {
+#ifdef HAVE_OPENAT
+		if (::renameat(fd, temp.c_str(), fd, name.c_str()) != 0) {
+			LOG(WARNING) << "Unable to replace '" << path << name << "' ("
+					<< std::strerror(errno) << ").";
+			::unlinkat(fd, temp.c_str(), 0);
+			return false;
+		}
+		return true;
+#else
+		return mapcrafter::renderer::replaceFile(path + temp, path + name);
+#endif
+	}
+
+	std::string path;
+#ifdef HAVE_OPENAT
+	int fd;
+#endif
+};
+
+FileTileStore::FileTileStore(const fs::path& output_dir, const std::string& image_format)
+	: TileStore(output_dir, image_format),
+	  blank_file((output_dir / ("blank." + image_format)).string()),
+	  blank_name("blank." + image_format) {
+}
+
+FileTileStore::~FileTileStore() {
+}
+
+void FileTileStore::prepare(const std::set<TilePath>& composite_tiles) {
+	// the parents are ordered before their children, so mostly only the last directory
+	// of a path needs to be created in the open directory of its parent
+	getDirectory(TilePath(), true);
+	for (auto it = composite_tiles.begin(); it != composite_tiles.end(); ++it) {
+		if (it->getDepth() == 0)
+			continue;
+		DirectoryPtr parent = getDirectory(it->parent(), true);
+		if (parent)
+			parent->createDirectory(getTileName(*it).substr(0, 1));
+	}
+}
+
+bool FileTileStore::write(const TilePath& tile, const std::string& data,
+		std::time_t time) {
+	DirectoryPtr dir = getTileDirectory(tile, true);
+	if (!dir || !dir->writeFile(getTileName(tile), data, time))
+		return false;
+	written(tile);
+	return true;
+}
+
+bool FileTileStore::link(const TilePath& original, const TilePath& tile) {
+	DirectoryPtr original_dir = getTileDirectory(original, false);
+	DirectoryPtr dir = getTileDirectory(tile, true);
+	if (!original_dir || !dir
+			|| !dir->linkFile(*original_dir, getTileName(original), getTileName(tile)))
+		return false;
+	written(tile);
+	return true;
+}
+
+bool FileTileStore::touch(const TilePath& tile) {
+	// the other tiles of a hardlink must keep their time, they might be outdated
+	DirectoryPtr dir = getTileDirectory(tile, false);
+	std::string name = getTileName(tile);
+	std::time_t time;
+	int links;
+	if (!dir || !dir->getFileStatus(name, time, links) || links != 1)
+		return false;
+	if (!dir->setModificationTime(name, std::time(nullptr)))
+		return false;
+	written(tile);
+	return true;
+}
+
+bool FileTileStore::writeBlank(const std::string& data) {
+	DirectoryPtr dir = getDirectory(TilePath(), true);
+	if (!dir || !dir->writeFile(blank_name, data))
+		return false;
+	if (uploader != nullptr)
+		uploader->upload(blank_file);
+	return true;
+}
+
+bool FileTileStore::linkBlank(const TilePath& tile) {
+	DirectoryPtr blank_dir = getDirectory(TilePath(), true);
+	DirectoryPtr dir = getTileDirectory(tile, true);
+	if (!blank_dir || !dir || !dir->linkFile(*blank_dir, blank_name, getTileName(tile)))
+		return false;
+	written(tile);
+	return true;
+}
+
+bool FileTileStore::replace(const TilePath& tile, const std::string& data,
+		std::time_t time) {
+	// the hardlinks of other tiles would keep the old image, and the tile needs its
+	// own file for its time anyway
+	DirectoryPtr dir = getTileDirectory(tile, false);
+	std::string name = getTileName(tile);
+	std::time_t old_time;
+	int links;
+	if (!dir || !dir->getFileStatus(name, old_time, links) || links != 1)
+		return false;
+	if (!dir->writeFile(name, data, time))
+		return false;
+	if (uploader != nullptr)
+		uploader->upload(dir->getPath() + name);
+	return true;
+}
+
+bool FileTileStore::read(const TilePath& tile, std::string& data) {
+	DirectoryPtr dir = getTileDirectory(tile, false);
+	return dir && dir->readFile(getTileName(tile), data);
+}
+
+bool FileTileStore::getModificationTime(const TilePath& tile, std::time_t& time) {
+	DirectoryPtr dir = getTileDirectory(tile, false);
+	int links;
+	return dir && dir->getFileStatus(getTileName(tile), time, links);
+}
+
+void FileTileStore::getModificationTimes(int depth,
+		const ModificationTimeCallback& callback) {
+	if (depth == 0) {
+		std::time_t time;
+		if (getModificationTime(TilePath(), time))
+			callback(TilePath(), time);
+		return;
+	}
+	DirectoryPtr dir = getDirectory(TilePath(), false);
+	if (dir)
+		walkDirectory(*dir, TilePath(), depth, callback);
+}
+
+bool FileTileStore::increaseDepth() {
+	// the new directories of the top tiles are created in a directory next to them, the
+	// move is started once this directory exists
+	fs::path moving = output_dir / "increasedepth";
+	boost::system::error_code error;
+	if (!fs::exists(moving)) {
+		fs::path temp = output_dir / "increasedepth.tmp";
+		fs::remove_all(temp, error);
+		for (int i = 1; i <= 4; i++)
+			fs::create_directories(temp / util::str(i), error);
+		fs::rename(temp, moving, error);
+		if (error) {
+			LOG(WARNING) << "Unable to create '" << moving.string() << "'.";
+			return false;
+		}
+	}
+
+	// every step is a rename, the directory of a top tile is moved into its new
+	// directory, which replaces it then, a new directory which is gone is done already
+	bool ok = true;
+	std::string suffix = "." + image_format;
+	for (int i = 1; i <= 4; i++) {
+		std::string node = util::str(i);
+		std::string child = util::str(5 - i);
+		fs::path moved = moving / node;
+		if (!fs::exists(moved))
+			continue;
+		if (fs::exists(output_dir / node))
+			fs::rename(output_dir / node, moved / child, error);
+		if (!error && fs::exists(output_dir / (node + suffix)))
+			fs::rename(output_dir / (node + suffix), moved / (child + suffix), error);
+		if (!error)
+			fs::rename(moved, output_dir / node, error);
+		if (error) {
+			LOG(WARNING) << "Unable to move the tiles of '" << (output_dir / node).string()
+					<< "' (" << error.message() << ").";
+			ok = false;
+			error.clear();
+		}
+	}
+	{
+		// the open directories are moved to other tiles now
+		thread_ns::unique_lock<thread_ns::mutex> lock(directories_mutex);
+		directories.clear();
+		directories_index.clear();
+	}
+	return ok;
+}
+
+void FileTileStore::finishIncreaseDepth() {
+	boost::system::error_code error;
+	fs::remove_all(output_dir / "increasedepth", error);
+}
+
+void FileTileStore::walkDirectory(const Directory& dir, const TilePath& tile, int depth,
+		const ModificationTimeCallback& callback) {
+	bool files = tile.getDepth() + 1 == depth;
+	std::string suffix = files ? "." + image_format : "";
+	std::vector<std::string> names = dir.list();
+	for (auto it = names.begin(); it != names.end(); ++it) {
+		// only the directories 1/ to 4/ of the child tiles, or their files 1.png to 4.png
+		const std::string& name = *it;
+		if (name.empty() || name[0] < '1' || name[0] > '4' || name.substr(1) != suffix)
+			continue;
+		TilePath child = tile + (name[0] - '0');
+		if (!files) {
+			// the subdirectories are opened relative to this one, not cached
+			DirectoryPtr child_dir = Directory::open(dir, name, false);
+			if (child_dir)
+				walkDirectory(*child_dir, child, depth, callback);
+			continue;
+		}
+		std::time_t time;
+		int links;
+		if (dir.getFileStatus(name, time, links))
+			callback(child, time);
+	}
+}
+
+FileTileStore::DirectoryPtr FileTileStore::getDirectory(const TilePath& tile,
+		bool create) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(directories_mutex);
+	auto it = directories_index.find(tile);
+	if (it != directories_index.end()) {
+		directories.splice(directories.begin(), directories, it->second);
+		return it->second->second;
+	}
+
+	// the directory is opened relative to the closest open directory above it, the
+	// directories in between are kept open too
+	TilePath above = tile;
+	std::vector<int> nodes;
+	while (above.getDepth() > 0 && !directories_index.count(above)) {
+		nodes.push_back(above.getNode(above.getDepth()));
+		above = above.parent();
+	}
+	DirectoryPtr dir;
+	if (directories_index.count(above)) {
+		dir = directories_index[above]->second;
+	} else {
+		dir = Directory::open(output_dir, create);
+		if (dir) {
+			directories.push_front(std::make_pair(above, dir));
+			directories_index[above] = directories.begin();
+		}
+	}
+	for (auto node = nodes.rbegin(); dir && node != nodes.rend(); ++node) {
+		above += *node;
+		dir = Directory::open(*dir, util::str(*node), create);
+		if (dir) {
+			directories.push_front(std::make_pair(above, dir));
+			directories_index[above] = directories.begin();
+		}
+	}
+	while (directories.size() > OPEN_DIRECTORIES) {
+		directories_index.erase(directories.back().first);
+		directories.pop_back();
+	}
+	return dir;
+}
+
+FileTileStore::DirectoryPtr FileTileStore::getTileDirectory(const TilePath& tile,
+		bool create) {
+	// the file of the top tile is in the output directory too
+	return getDirectory(tile.getDepth() == 0 ? tile : tile.parent(), create);
+}
+
+std::string FileTileStore::getTileName(const TilePath& tile) const {
+	if (tile.getDepth() == 0)
+		return "base" + tile_file_suffix;
+	return (char) ('0' + tile.getNode(tile.getDepth())) + tile_file_suffix;
+}
+
+PackTileStore::BufferedBundle::BufferedBundle()
+	: bytes(0) {
+}
+
+PackTileStore::PackTileStore(const fs::path& output_dir, const std::string& image_format)
+	: TileStore(output_dir, image_format), buffered_bytes(0) {
+}
+
+PackTileStore::~PackTileStore() {
+	flush();
+}
+
+bool PackTileStore::write(const TilePath& tile, const std::string& data,
+		std::time_t time) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return put(tile, data, time != 0 ? time : std::time(nullptr));
+}
+
+bool PackTileStore::writeBlank(const std::string& data) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// the web interface shows nothing outside of the map, the blank tile is just stored
+	// like the other tiles
+	blank = data;
+	return true;
+}
+
+bool PackTileStore::linkBlank(const TilePath& tile) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (blank.empty())
+		return false;
+	return put(tile, blank, std::time(nullptr));
+}
+
+bool PackTileStore::replace(const TilePath& tile, const std::string& data,
+		std::time_t time) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return put(tile, data, time);
+}
+
+bool PackTileStore::read(const TilePath& tile, std::string& data) {
+	int slot;
+	fs::path file = getBundleFile(tile, slot);
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto bundle = buffered.find(file);
+	if (bundle != buffered.end()) {
+		auto it = bundle->second.tiles.find(slot);
+		if (it != bundle->second.tiles.end()) {
+			data = it->second.data;
+			return true;
+		}
+	}
+
+	const BundleIndex* index = getIndex(file);
+	if (index == nullptr || (*index)[slot].size == 0)
+		return false;
+	return readFileRange(file, (*index)[slot].offset, (*index)[slot].size, data);
+}
+
+bool PackTileStore::getModificationTime(const TilePath& tile, std::time_t& time) {
+	int slot;
+	fs::path file = getBundleFile(tile, slot);
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	auto bundle = buffered.find(file);
+	if (bundle != buffered.end()) {
+		auto it = bundle->second.tiles.find(slot);
+		if (it != bundle->second.tiles.end()) {
+			time = it->second.time;
+			return true;
+		}
+	}
+
+	const BundleIndex* index = getIndex(file);
+	if (index == nullptr || (*index)[slot].size == 0)
+		return false;
+	time = (*index)[slot].time;
+	return true;
+}
+
+void PackTileStore::getModificationTimes(int depth,
+		const ModificationTimeCallback& callback) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// all tiles are in the bundle files then
+	writeBundles();
+
+	fs::path dir = output_dir / "bundles" / util::str(depth);
+	boost::system::error_code error;
+	for (fs::directory_iterator it(dir, error), end; !error && it != end;
+			it.increment(error)) {
+		if (it->path().extension() != ".bundle")
+			continue;
+		// the tile the bundle is below, like in getBundleFile
+		std::string name = it->path().stem().string();
+		TilePath root;
+		if (depth > BUNDLE_LEVELS) {
+			if ((int) name.size() != depth - BUNDLE_LEVELS
+					|| name.find_first_not_of("1234") != std::string::npos)
+				continue;
+			for (size_t i = 0; i < name.size(); i++)
+				root += name[i] - '0';
+		} else if (name != "base")
+			continue;
+
+		const BundleIndex* index = getIndex(it->path());
+		if (index == nullptr)
+			continue;
+		for (int slot = 0; slot < BUNDLE_SLOTS; slot++)
+			if ((*index)[slot].size != 0)
+				callback(getBundleTile(root, depth, slot), (*index)[slot].time);
+	}
+}
+
+bool PackTileStore::increaseDepth() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	writeBundles();
+	indexes.clear();
+	indexes_map.clear();
+
+	// the old bundles are moved away at once to start the move, then every bundle is
+	// moved back to its new place, so an interrupted move just continues with the
+	// bundles which are left
+	fs::path bundles_dir = output_dir / "bundles";
+	fs::path old_dir = output_dir / "bundles.increasedepth";
+	boost::system::error_code error;
+	if (!fs::exists(old_dir)) {
+		if (!fs::exists(bundles_dir))
+			return true;
+		fs::rename(bundles_dir, old_dir, error);
+		if (error) {
+			LOG(WARNING) << "Unable to move '" << bundles_dir.string() << "'.";
+			return false;
+		}
+	}
+
+	std::vector<int> depths;
+	for (fs::directory_iterator it(old_dir); it != fs::directory_iterator(); ++it) {
+		std::string name = it->path().filename().string();
+		if (fs::is_directory(it->path()) && !name.empty()
+				&& name.find_first_not_of("0123456789") == std::string::npos)
+			depths.push_back(util::as<int>(name));
+	}
+
+	bool ok = true;
+	std::vector<fs::path> top_bundles;
+	std::vector<BufferedTile> top_tiles;
+	for (auto depth_it = depths.begin(); depth_it != depths.end(); ++depth_it) {
+		int depth = *depth_it;
+		fs::path dir = old_dir / util::str(depth);
+		fs::path moved_dir = bundles_dir / util::str(depth + 1);
+		std::vector<fs::path> files;
+		for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it)
+			if (it->path().extension() == ".bundle")
+				files.push_back(it->path());
+
+		for (auto it = files.begin(); it != files.end(); ++it) {
+			std::string name = it->stem().string();
+			if (depth > BUNDLE_LEVELS) {
+				// the bundles of the deeper zoom levels keep their tiles, only the tile
+				// above the bundle gets the additional node of the path
+				if (name.empty() || name[0] < '1' || name[0] > '4')
+					continue;
+				std::string moved = name.substr(0, 1) + (char) ('5' - name[0] + '0')
+						+ name.substr(1);
+				fs::create_directories(moved_dir, error);
+				fs::rename(*it, moved_dir / (moved + ".bundle"), error);
+				if (error) {
+					LOG(WARNING) << "Unable to move '" << it->string() << "'.";
+					ok = false;
+					error.clear();
+				}
+				continue;
+			}
+
+			// the bundles of the top zoom levels are split up, their tiles are written
+			// again, and the old bundles are removed once all of them are written
+			top_bundles.push_back(*it);
+			const BundleIndex* index = getIndex(*it);
+			if (index == nullptr)
+				continue;
+			BundleIndex entries = *index;
+			for (int slot = 0; slot < BUNDLE_SLOTS; slot++) {
+				if (depth == 0 || entries[slot].size == 0)
+					continue;
+				BufferedTile tile;
+				tile.tile = moveDeeper(getBundleTile(TilePath(), depth, slot));
+				tile.time = entries[slot].time;
+				if (!readFileRange(*it, entries[slot].offset, entries[slot].size,
+						tile.data)) {
+					ok = false;
+					continue;
+				}
+				top_tiles.push_back(tile);
+			}
+		}
+	}
+
+	indexes.clear();
+	indexes_map.clear();
+	for (auto it = top_tiles.begin(); it != top_tiles.end(); ++it)
+		if (!put(it->tile, it->data, it->time))
+			ok = false;
+	if (!writeBundles())
+		ok = false;
+	if (ok)
+		for (auto it = top_bundles.begin(); it != top_bundles.end(); ++it)
+			fs::remove(*it, error);
+	return ok;
+}
+
+void PackTileStore::finishIncreaseDepth() {
+	boost::system::error_code error;
+	fs::remove_all(output_dir / "bundles.increasedepth", error);
+}
+
+void PackTileStore::flush() {
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		writeBundles();
+	}
+	TileStore::flush();
+}
+
+fs::path PackTileStore::getBundleFile(const TilePath& tile, int& slot) const {
+	int depth = tile.getDepth();
+	int levels = std::min(depth, BUNDLE_LEVELS);
+	std::string name;
+	for (int level = 1; level <= depth - levels; level++)
+		name += (char) ('0' + tile.getNode(level));
+	int x = 0, y = 0;
+	for (int level = depth - levels + 1; level <= depth; level++) {
+		x = x * 2 + (tile.getNode(level) - 1) % 2;
+		y = y * 2 + (tile.getNode(level) - 1) / 2;
+	}
+	slot = y * BUNDLE_SIZE + x;
+	if (name.empty())
+		name = "base";
+	return output_dir / "bundles" / util::str(depth) / (name + ".bundle");
+}
+
+TilePath PackTileStore::getBundleTile(const TilePath& root, int depth, int slot) {
+	TilePath tile = root;
+	int levels = depth - root.getDepth();
+	int x = slot % BUNDLE_SIZE, y = slot / BUNDLE_SIZE;
+	for (int i = levels - 1; i >= 0; i--)
+		tile += ((x >> i) & 1) + 2 * ((y >> i) & 1) + 1;
+	return tile;
+}
+
+bool PackTileStore::put(const TilePath& tile, const std::string& data, uint32_t time) {
+	int slot;
+	fs::path file = getBundleFile(tile, slot);
+	BufferedBundle& bundle = buffered[file];
+	BufferedTile& buffered_tile = bundle.tiles[slot];
+	bundle.bytes -= buffered_tile.data.size();
+	buffered_bytes -= buffered_tile.data.size();
+	buffered_tile.tile = tile;
+	buffered_tile.data = data;
+	buffered_tile.time = time;
+	bundle.bytes += data.size();
+	buffered_bytes += data.size();
+
+	bool ok = true;
+	if (bundle.bytes >= BUNDLE_BUFFER_BYTES) {
+		ok = writeBundle(file, bundle);
+		buffered_bytes -= bundle.bytes;
+		buffered.erase(file);
+	}
+	if (buffered_bytes >= MAX_BUFFERED_BYTES)
+		writeBundles();
+	return ok;
+}
+
+const PackTileStore::BundleIndex* PackTileStore::getIndex(const fs::path& file) {
+	auto cached = indexes_map.find(file);
+	if (cached != indexes_map.end()) {
+		indexes.splice(indexes.begin(), indexes, cached->second);
+		return cached->second->second.empty() ? nullptr : &cached->second->second;
+	}
+
+	// bundles which don't exist or are invalid have an empty index in the cache
+	BundleIndex index;
+	std::ifstream in(file.string().c_str(), std::ios::binary);
+	std::string header(BUNDLE_HEADER_SIZE, '\0');
+	if (in && in.read(&header[0], header.size())
+			&& getUInt32(&header[0]) == BUNDLE_MAGIC
+			&& getUInt32(&header[4]) == BUNDLE_VERSION
+			&& getUInt32(&header[8]) == (uint32_t) BUNDLE_SLOTS) {
+		in.seekg(0, std::ios::end);
+		uint64_t file_size = in.tellg();
+		index.resize(BUNDLE_SLOTS);
+		for (int i = 0; i < BUNDLE_SLOTS; i++) {
+			const char* entry = &header[BUNDLE_INDEX_OFFSET + i * BUNDLE_ENTRY_SIZE];
+			index[i].offset = getUInt32(entry);
+			index[i].size = getUInt32(entry + 4);
+			index[i].time = getUInt32(entry + 8);
+			// the images of a bundle which was not written completely are missing
+			if ((uint64_t) index[i].offset + index[i].size > file_size)
+				index[i].size = 0;
+		}
+	}
+
+	indexes.push_front(std::make_pair(file, index));
+	indexes_map[file] = indexes.begin();
+	if (indexes.size() > INDEX_CACHE_SIZE) {
+		indexes_map.erase(indexes.back().first);
+		indexes.pop_back();
+	}
+	return index.empty() ? nullptr : &indexes.front().second;
+}
+
+bool PackTileStore::writeBundle(const fs::path& file, const BufferedBundle& bundle) {
+	const BundleIndex* old_index = getIndex(file);
+	BundleIndex index(BUNDLE_SLOTS, IndexEntry {0, 0, 0});
+	if (old_index != nullptr)
+		index = *old_index;
+
+	// the bytes of the images in the file which are still used
+	uint64_t used = 0, file_size = 0;
+	if (old_index != nullptr) {
+		for (int i = 0; i < BUNDLE_SLOTS; i++)
+			if (!bundle.tiles.count(i))
+				used += index[i].size;
+		file_size = fs::file_size(file);
+	}
+
+	// the bundle is rewritten if it's new, or if more than half of it would be unused
+	std::string data;
+	uint64_t offset = file_size;
+	bool rewrite = old_index == nullptr
+			|| file_size - BUNDLE_HEADER_SIZE - used > used + bundle.bytes;
+	if (rewrite) {
+		offset = BUNDLE_HEADER_SIZE;
+		for (int i = 0; i < BUNDLE_SLOTS; i++) {
+			if (bundle.tiles.count(i) || index[i].size == 0) {
+				index[i] = IndexEntry {0, 0, 0};
+				continue;
+			}
+			std::string image;
+			if (!readFileRange(file, index[i].offset, index[i].size, image)) {
+				index[i] = IndexEntry {0, 0, 0};
+				continue;
+			}
+			index[i].offset = offset + data.size();
+			data += image;
+		}
+	}
+	for (auto it = bundle.tiles.begin(); it != bundle.tiles.end(); ++it) {
+		index[it->first].offset = offset + data.size();
+		index[it->first].size = it->second.data.size();
+		index[it->first].time = it->second.time;
+		data += it->second.data;
+	}
+	if (offset + data.size() > 0xffffffffULL) {
+		LOG(WARNING) << "Unable to write '" << file.string() << "', the bundle is too big.";
+		return false;
+	}
+
+	std::string header;
+	putUInt32(header, BUNDLE_MAGIC);
+	putUInt32(header, BUNDLE_VERSION);
+	putUInt32(header, BUNDLE_SLOTS);
+	for (int i = 0; i < BUNDLE_SLOTS; i++) {
+		putUInt32(header, index[i].offset);
+		putUInt32(header, index[i].size);
+		putUInt32(header, index[i].time);
+	}
+
+	bool ok;
+	if (rewrite) {
+		// the new bundle replaces the old one at once
+		fs::path temp = file.string() + ".tmp";
+		boost::system::error_code error;
+		fs::create_directories(file.branch_path(), error);
+		{
+			std::ofstream out(temp.string().c_str(), std::ios::binary | std::ios::trunc);
+			ok = out && out.write(header.data(), header.size())
+					&& out.write(data.data(), data.size());
+		}
+		if (ok) {
+			fs::rename(temp, file, error);
+			ok = !error;
+		}
+	} else {
+		// the images are appended first, the index refers to them only afterwards
+		std::fstream out(file.string().c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		ok = out && out.seekp(offset) && out.write(data.data(), data.size()) && out.flush()
+				&& out.seekp(0) && out.write(header.data(), header.size());
+	}
+	if (!ok) {
+		LOG(WARNING) << "Unable to write '" << file.string() << "'.";
+		// the cached index might not match the file anymore
+		auto cached = indexes_map.find(file);
+		if (cached != indexes_map.end()) {
+			indexes.erase(cached->second);
+			indexes_map.erase(cached);
+		}
+		return false;
+	}
+
+	// update the cached index
+	getIndex(file);
+	indexes.front().second = index;
+	for (auto it = bundle.tiles.begin(); it != bundle.tiles.end(); ++it)
+		written(it->second.tile);
+	return true;
+}
+
+bool PackTileStore::writeBundles() {
+	bool ok = true;
+	for (auto it = buffered.begin(); it != buffered.end(); ++it)
+		if (!writeBundle(it->first, it->second))
+			ok = false;
+	buffered.clear();
+	buffered_bytes = 0;
+	return ok;
+}
+
+std::shared_ptr<TileStore> createTileStore(const config::MapSection& map_config,
+		const fs::path& output_dir, const std::string& image_format) {
+	std::string suffix = image_format.empty() ? map_config.getImageFormatSuffix()
+			: image_format;
+	std::shared_ptr<TileStore> store;
+	if (map_config.getTileStore() == config::TileStoreType::PACK)
+		store = std::make_shared<PackTileStore>(output_dir, suffix);
+	else
+		store = std::make_shared<FileTileStore>(output_dir, suffix);
+	store->setSyncInterval(map_config.getTileSyncInterval());
+	return store;
+}
+
+}
+}
@@ -0,0 +1,381 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILESTORE_H_
+#define TILESTORE_H_
+
+#include "renderjournal.h"
+#include "tileset.h"
+#include "../compat/thread.h"
+#include "../config/configsections/map.h"
+
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+class TileUploader;
+
+/**
+ * Stores the encoded images of the tiles of a map rotation in its output directory.
+ *
+ * The stores are used by multiple threads.
+ */
+class TileStore {
+public:
+	TileStore(const fs::path& output_dir, const std::string& image_format);
+	virtual ~TileStore();
+
+	const fs::path& getOutputDir() const;
+
+	/**
+	 * Sets a journal to which the tiles are added once they are written to disk.
+	 */
+	void setJournal(RenderJournal* journal);
+
+	/**
+	 * Sets an uploader to which the files of the tiles are queued once they are written
+	 * to disk. Only the stores with a file per tile can be uploaded.
+	 */
+	void setUploader(TileUploader* uploader);
+
+	/**
+	 * Sets a function called with every tile once it's written to disk, or once it's
+	 * kept because its image didn't change. It's called by the threads writing the
+	 * tiles.
+	 */
+	typedef std::function<void(const TilePath&)> WrittenCallback;
+	void setWrittenCallback(WrittenCallback written_callback);
+
+	/**
+	 * Sets after how many written tiles the file system of the output directory is
+	 * synced to disk, so the written tiles survive a crash of the machine. 0 means
+	 * never (the default), -1 means only when the store is flushed.
+	 */
+	void setSyncInterval(int sync_interval);
+
+	/**
+	 * Returns the file of a tile in the output directory, like 1/2/3.png, and base.png for
+	 * the tile of the top zoom level. The journal uses it as name of the tile.
+	 */
+	fs::path getTileFile(const TilePath& tile) const;
+
+	/**
+	 * Writes the file of a tile into a buffer, the buffer keeps its memory when it is
+	 * used for the files of multiple tiles.
+	 */
+	void getTileFile(const TilePath& tile, std::string& file) const;
+
+	/**
+	 * Prepares writing the tiles below some composite tiles, this is called with the
+	 * required composite tiles before rendering them.
+	 */
+	virtual void prepare(const std::set<TilePath>& composite_tiles);
+
+	/**
+	 * Writes the encoded image of a tile. Returns false if it could not be written. The
+	 * time when the tile was written can be specified (like with replace), for tiles
+	 * which are only encoded again, 0 means now.
+	 */
+	virtual bool write(const TilePath& tile, const std::string& data,
+			std::time_t time = 0) = 0;
+
+	/**
+	 * Writes a tile with the image of a tile which was written already. Returns false if
+	 * the tile could not be written, the tile has to be written with its image then.
+	 */
+	virtual bool link(const TilePath& original, const TilePath& tile);
+
+	/**
+	 * Keeps a tile which was rendered again with the same image, it's added to the
+	 * journal like the written tiles. With touch, the time when the tile was written is
+	 * updated too (the image modification times tell then that the tile is up to date),
+	 * returns false if that's not possible and the tile has to be written again.
+	 */
+	void keep(const TilePath& tile);
+	virtual bool touch(const TilePath& tile);
+
+	/**
+	 * Writes the encoded image of the blank (completely transparent) tile, and writes a
+	 * tile with the image of the blank tile.
+	 */
+	virtual bool writeBlank(const std::string& data) = 0;
+	virtual bool linkBlank(const TilePath& tile) = 0;
+
+	/**
+	 * Replaces the encoded image of a tile with another encoding of the same image, for
+	 * example a smaller one. The time when the tile was written is set to the specified
+	 * time, so the tile doesn't look like it was rendered again. Returns false if the
+	 * tile could not be replaced, it keeps its old image then.
+	 */
+	virtual bool replace(const TilePath& tile, const std::string& data,
+			std::time_t time) = 0;
+
+	/**
+	 * Reads the encoded image of a tile. Returns false if the tile does not exist.
+	 */
+	virtual bool read(const TilePath& tile, std::string& data) = 0;
+
+	/**
+	 * Returns the time when a tile was written. Returns false if the tile does not exist.
+	 */
+	virtual bool getModificationTime(const TilePath& tile, std::time_t& time) = 0;
+
+	/**
+	 * Calls a function with each existing tile of a zoom level and the time when it was
+	 * written. This reads the tiles in the order they are stored (like walking the
+	 * directories), which is a lot faster than asking for the tiles one after another.
+	 */
+	typedef std::function<void(const TilePath&, std::time_t)> ModificationTimeCallback;
+	virtual void getModificationTimes(int depth,
+			const ModificationTimeCallback& callback) = 0;
+
+	/**
+	 * Returns whether a tile exists.
+	 */
+	bool exists(const TilePath& tile);
+
+	/**
+	 * Moves the tiles one zoom level deeper when the max zoom level of the map increases,
+	 * the tiles of 1/ become the ones of 1/4/, 2/ becomes 2/3/, 3/ becomes 3/2/ and 4/
+	 * becomes 4/1/. The tiles of the top two zoom levels need to be written again then.
+	 *
+	 * The tiles are moved in steps which can be done again, an interrupted move is
+	 * continued by calling this method again until finishIncreaseDepth is called. The
+	 * caller has to remember that the move is done before calling finishIncreaseDepth,
+	 * which removes what's left of the move.
+	 */
+	virtual bool increaseDepth() = 0;
+	virtual void finishIncreaseDepth() = 0;
+
+	/**
+	 * Writes the buffered tiles to disk, and syncs them if a sync interval is set.
+	 */
+	virtual void flush();
+
+protected:
+	/**
+	 * Adds a tile to the journal, call this once a tile is written to disk. The file
+	 * system is synced when enough tiles were written since the last sync.
+	 */
+	void written(const TilePath& tile);
+
+	/**
+	 * Syncs the file system of the output directory if tiles were written since the
+	 * last sync.
+	 */
+	void sync();
+
+	fs::path output_dir;
+	std::string image_format;
+	RenderJournal* journal;
+	TileUploader* uploader;
+	WrittenCallback written_callback;
+
+	// the files of the tiles are the prefix (the output directory) + the path of the
+	// tile + the suffix (the image format)
+	std::string tile_file_prefix, tile_file_suffix;
+
+	// the tiles after which the file system is synced, and the tiles written since
+	// the last sync
+	int sync_interval;
+	std::atomic<int> unsynced_tiles;
+};
+
+/**
+ * Writes every tile to its own file, like 1/2/3.png. The blank tile is blank.png in the
+ * output directory, the web interface shows it outside of the map. The linked tiles are
+ * hardlinks of the files. The files are replaced atomically, so the output directory
+ * can be served by a web server while the tiles are rendered. The directories of the
+ * recently used tiles are kept open and the files are accessed relative to them, so the
+ * kernel doesn't resolve the whole path of every tile again.
+ */
+class FileTileStore : public TileStore {
+public:
+	FileTileStore(const fs::path& output_dir, const std::string& image_format);
+	virtual ~FileTileStore();
+
+	/**
+	 * Creates the directories of the composite tiles, where their child tiles are
+	 * written, at once.
+	 */
+	virtual void prepare(const std::set<TilePath>& composite_tiles);
+
+	virtual bool write(const TilePath& tile, const std::string& data,
+			std::time_t time = 0);
+	virtual bool link(const TilePath& original, const TilePath& tile);
+	virtual bool touch(const TilePath& tile);
+	virtual bool writeBlank(const std::string& data);
+	virtual bool linkBlank(const TilePath& tile);
+	virtual bool replace(const TilePath& tile, const std::string& data, std::time_t time);
+	virtual bool read(const TilePath& tile, std::string& data);
+	virtual bool getModificationTime(const TilePath& tile, std::time_t& time);
+	virtual void getModificationTimes(int depth, const ModificationTimeCallback& callback);
+	virtual bool increaseDepth();
+	virtual void finishIncreaseDepth();
+
+private:
+	class Directory;
+	typedef std::shared_ptr<Directory> DirectoryPtr;
+
+	/**
+	 * Calls the function with the tiles of a zoom level below the tile of a directory.
+	 */
+	void walkDirectory(const Directory& dir, const TilePath& tile, int depth,
+			const ModificationTimeCallback& callback);
+
+	/**
+	 * Returns the directory of a tile (where its child tiles are, the directory of the
+	 * top tile is the output directory), creates it if it doesn't exist and create is
+	 * set. Returns null if that fails.
+	 */
+	DirectoryPtr getDirectory(const TilePath& tile, bool create);
+
+	/**
+	 * Returns the directory with the file of a tile and the name of the file there.
+	 */
+	DirectoryPtr getTileDirectory(const TilePath& tile, bool create);
+	std::string getTileName(const TilePath& tile) const;
+
+	std::string blank_file, blank_name;
+
+	// the recently used directories of the tiles, most recently used first, the files
+	// are accessed relative to them (see Directory)
+	std::list<std::pair<TilePath, DirectoryPtr> > directories;
+	std::unordered_map<TilePath, std::list<std::pair<TilePath, DirectoryPtr> >::iterator,
+		tile_path_hash_function> directories_index;
+	thread_ns::mutex directories_mutex;
+};
+
+/**
+ * Packs the tiles into bundle files instead of writing millions of small files. The
+ * tiles of a bundle are the (up to) 16x16 tiles of a zoom level below the same tile four
+ * zoom levels above, a bundle of zoom level 10 below the tile 1/2/3/4/1/2 is the file
+ * bundles/10/123412.bundle (base.bundle for the top four zoom levels) in the output
+ * directory.
+ *
+ * A bundle file starts with the index of its tiles, which has the offset and size of
+ * the image of each tile in the file and when it was written. The images are appended
+ * to the file, the index is updated after them. The space of replaced images is reused
+ * by rewriting the bundle when more than half of the file is unused.
+ *
+ * The tiles are buffered in memory and a bundle is written to disk at once when enough
+ * of its tiles are buffered, or when the store is flushed.
+ */
+class PackTileStore : public TileStore {
+public:
+	PackTileStore(const fs::path& output_dir, const std::string& image_format);
+	virtual ~PackTileStore();
+
+	virtual bool write(const TilePath& tile, const std::string& data,
+			std::time_t time = 0);
+	virtual bool writeBlank(const std::string& data);
+	virtual bool linkBlank(const TilePath& tile);
+	virtual bool replace(const TilePath& tile, const std::string& data, std::time_t time);
+	virtual bool read(const TilePath& tile, std::string& data);
+	virtual bool getModificationTime(const TilePath& tile, std::time_t& time);
+	virtual void getModificationTimes(int depth, const ModificationTimeCallback& callback);
+	virtual bool increaseDepth();
+	virtual void finishIncreaseDepth();
+	virtual void flush();
+
+	/**
+	 * Returns the bundle file of a tile and the slot of the tile in the bundle.
+	 */
+	fs::path getBundleFile(const TilePath& tile, int& slot) const;
+
+	/**
+	 * Returns the tile in a slot of a bundle of a zoom level below a tile.
+	 */
+	static TilePath getBundleTile(const TilePath& root, int depth, int slot);
+
+private:
+	struct IndexEntry {
+		uint32_t offset, size, time;
+	};
+	typedef std::vector<IndexEntry> BundleIndex;
+
+	struct BufferedTile {
+		TilePath tile;
+		std::string data;
+		uint32_t time;
+	};
+
+	struct BufferedBundle {
+		BufferedBundle();
+
+		std::map<int, BufferedTile> tiles;
+		size_t bytes;
+	};
+
+	/**
+	 * Buffers the image of a tile, and writes its bundle if enough of its tiles are
+	 * buffered. The store must be locked.
+	 */
+	bool put(const TilePath& tile, const std::string& data, uint32_t time);
+
+	/**
+	 * Returns the index of a bundle, or nullptr if the bundle does not exist (or is
+	 * invalid). The store must be locked.
+	 */
+	const BundleIndex* getIndex(const fs::path& file);
+
+	/**
+	 * Writes the buffered tiles of bundles to disk. The store must be locked.
+	 */
+	bool writeBundle(const fs::path& file, const BufferedBundle& bundle);
+	bool writeBundles();
+
+	std::string blank;
+
+	std::map<fs::path, BufferedBundle> buffered;
+	size_t buffered_bytes;
+
+	// the indexes of the recently used bundles, the most recently used first
+	std::list<std::pair<fs::path, BundleIndex> > indexes;
+	std::map<fs::path, std::list<std::pair<fs::path, BundleIndex> >::iterator> indexes_map;
+
+	thread_ns::mutex mutex;
+};
+
+/**
+ * Creates the tile store of a map rotation with the output directory of the rotation.
+ * The files of the tiles have the suffix of the image format of the map, or another
+ * suffix if one is given.
+ */
+std::shared_ptr<TileStore> createTileStore(const config::MapSection& map_config,
+		const fs::path& output_dir, const std::string& image_format = "");
+
+}
+}
+
+#endif /* TILESTORE_H_ */
@@ -0,0 +1,307 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tileuploader.h"
+
+#include "../util.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// the first line of the manifest file, the digests and keys of the files follow
+const std::string MANIFEST_HEADER = "# mapcrafter upload manifest 1";
+
+// the longest delay in seconds before an upload is retried
+const int MAX_RETRY_DELAY = 30;
+
+/**
+ * Encodes a key of the bucket for the path of a request, the slashes are kept.
+ */
+std::string encodeKey(const std::string& key) {
+	const char* digits = "0123456789ABCDEF";
+	std::string encoded;
+	for (size_t i = 0; i < key.size(); i++) {
+		unsigned char c = key[i];
+		if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/')
+			encoded += c;
+		else {
+			encoded += '%';
+			encoded += digits[c >> 4];
+			encoded += digits[c & 0xf];
+		}
+	}
+	return encoded;
+}
+
+/**
+ * Formats a time as UTC, std::gmtime is not thread-safe.
+ */
+std::string formatUTCTime(std::time_t time, const char* format) {
+	static thread_ns::mutex mutex;
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	char buffer[64];
+	std::strftime(buffer, sizeof(buffer), format, std::gmtime(&time));
+	return buffer;
+}
+
+std::string getContentType(const std::string& file) {
+	if (util::endswith(file, ".png"))
+		return "image/png";
+	if (util::endswith(file, ".jpg"))
+		return "image/jpeg";
+	if (util::endswith(file, ".webp"))
+		return "image/webp";
+	return "application/octet-stream";
+}
+
+}
+
+S3Credentials S3Credentials::fromEnvironment() {
+	S3Credentials credentials;
+	const char* access_key_id = std::getenv("AWS_ACCESS_KEY_ID");
+	const char* secret_access_key = std::getenv("AWS_SECRET_ACCESS_KEY");
+	const char* session_token = std::getenv("AWS_SESSION_TOKEN");
+	if (access_key_id != nullptr)
+		credentials.access_key_id = access_key_id;
+	if (secret_access_key != nullptr)
+		credentials.secret_access_key = secret_access_key;
+	if (session_token != nullptr)
+		credentials.session_token = session_token;
+	return credentials;
+}
+
+TileUploader::TileUploader(const fs::path& local_dir, const std::string& url,
+		const std::string& region, const S3Credentials& credentials,
+		int threads, int retries)
+	: local_prefix(local_dir.string()), url_prefix(url), region(region),
+	  credentials(credentials), retries(retries), uploaded(0), unchanged(0), failed(0),
+	  finished(false), active(0) {
+	if (!local_prefix.empty() && local_prefix.back() != '/')
+		local_prefix += '/';
+	if (url_prefix.empty() || url_prefix.back() != '/')
+		url_prefix += '/';
+	for (int i = 0; i < threads; i++)
+		this->threads.push_back(thread_ns::thread(&TileUploader::run, this));
+}
+
+TileUploader::~TileUploader() {
+	finish();
+}
+
+bool TileUploader::readManifest(const fs::path& filename) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	manifest.clear();
+	std::ifstream in(filename.string().c_str());
+	std::string line;
+	if (!std::getline(in, line) || line != MANIFEST_HEADER)
+		return false;
+	while (std::getline(in, line)) {
+		// <digest> <key>, the key might have spaces
+		size_t separator = line.find(' ');
+		if (separator != 64) {
+			manifest.clear();
+			return false;
+		}
+		manifest[line.substr(separator + 1)] = line.substr(0, separator);
+	}
+	return true;
+}
+
+bool TileUploader::writeManifest(const fs::path& filename) const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	std::string tmp_filename = filename.string() + ".tmp";
+	std::ofstream out(tmp_filename.c_str());
+	if (!out)
+		return false;
+	out << MANIFEST_HEADER << "\n";
+	for (auto it = manifest.begin(); it != manifest.end(); ++it)
+		out << it->second << " " << it->first << "\n";
+	out.close();
+	if (!out) {
+		std::remove(tmp_filename.c_str());
+		return false;
+	}
+	return std::rename(tmp_filename.c_str(), filename.string().c_str()) == 0;
+}
+
+void TileUploader::upload(const std::string& file) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	if (!queued.insert(file).second)
+		return;
+	queue.push_back(file);
+	queue_changed.notify_one();
+}
+
+void TileUploader::finish() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (!queue.empty() || active > 0)
+		queue_empty.wait(lock);
+	finished = true;
+	queue_changed.notify_all();
+	lock.unlock();
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+		it->join();
+	threads.clear();
+}
+
+size_t TileUploader::getUploadedCount() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return uploaded;
+}
+
+size_t TileUploader::getUnchangedCount() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return unchanged;
+}
+
+size_t TileUploader::getFailedCount() const {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return failed;
+}
+
+void TileUploader::signRequest(const std::string& method, const std::string& url,
+		const std::string& region, const S3Credentials& credentials,
+		const std::string& payload_sha256, std::time_t time,
+		std::map<std::string, std::string>& headers) {
+	if (credentials.access_key_id.empty())
+		return;
+	std::string host, port, path;
+	util::splitHTTPURL(url, host, port, path);
+	if (port != "80")
+		host += ":" + port;
+
+	std::string date = formatUTCTime(time, "%Y%m%d");
+	headers["x-amz-date"] = formatUTCTime(time, "%Y%m%dT%H%M%SZ");
+	headers["x-amz-content-sha256"] = payload_sha256;
+	if (!credentials.session_token.empty())
+		headers["x-amz-security-token"] = credentials.session_token;
+
+	// the signed headers are lowercase and sorted, the host header too
+	std::map<std::string, std::string> signed_headers;
+	signed_headers["host"] = host;
+	for (auto it = headers.begin(); it != headers.end(); ++it) {
+		std::string name = it->first;
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		signed_headers[name] = util::trim(it->second);
+	}
+	std::string canonical_headers, signed_header_names;
+	for (auto it = signed_headers.begin(); it != signed_headers.end(); ++it) {
+		canonical_headers += it->first + ":" + it->second + "\n";
+		signed_header_names += (signed_header_names.empty() ? "" : ";") + it->first;
+	}
+
+	std::string canonical_request = method + "\n" + path + "\n" + "\n"
+			+ canonical_headers + "\n" + signed_header_names + "\n" + payload_sha256;
+	std::string scope = date + "/" + region + "/s3/aws4_request";
+	std::string string_to_sign = "AWS4-HMAC-SHA256\n" + headers["x-amz-date"] + "\n"
+			+ scope + "\n" + util::toHex(util::sha256(canonical_request));
+
+	std::string key = util::hmacSHA256("AWS4" + credentials.secret_access_key, date);
+	key = util::hmacSHA256(key, region);
+	key = util::hmacSHA256(key, "s3");
+	key = util::hmacSHA256(key, "aws4_request");
+	headers["Authorization"] = "AWS4-HMAC-SHA256 Credential=" + credentials.access_key_id
+			+ "/" + scope + ", SignedHeaders=" + signed_header_names + ", Signature="
+			+ util::toHex(util::hmacSHA256(key, string_to_sign));
+}
+
+void TileUploader::run() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (true) {
+		while (queue.empty() && !finished)
+			queue_changed.wait(lock);
+		if (queue.empty())
+			return;
+		std::string file = queue.front();
+		queue.pop_front();
+		// the file can be queued again while it's uploaded, it might change meanwhile
+		queued.erase(file);
+		active++;
+		lock.unlock();
+		bool ok = uploadFile(file);
+		lock.lock();
+		if (!ok)
+			failed++;
+		active--;
+		if (queue.empty() && active == 0)
+			queue_empty.notify_all();
+	}
+}
+
+bool TileUploader::uploadFile(const std::string& file) {
+	if (file.compare(0, local_prefix.size(), local_prefix) != 0) {
+		LOG(WARNING) << "Unable to upload '" << file << "', it is not in the output directory.";
+		return false;
+	}
+	std::string key = file.substr(local_prefix.size());
+
+	std::ifstream in(file.c_str(), std::ios::binary);
+	if (!in) {
+		LOG(WARNING) << "Unable to read '" << file << "' to upload it.";
+		return false;
+	}
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::string digest = util::toHex(util::sha256(data));
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		auto it = manifest.find(key);
+		if (it != manifest.end() && it->second == digest) {
+			unchanged++;
+			return true;
+		}
+	}
+
+	std::string url = url_prefix + encodeKey(key);
+	for (int attempt = 0; attempt <= retries; attempt++) {
+		if (attempt > 0)
+			std::this_thread::sleep_for(std::chrono::seconds(
+					std::min(1 << std::min(attempt - 1, 8), MAX_RETRY_DELAY)));
+		std::map<std::string, std::string> headers;
+		headers["Content-Type"] = getContentType(file);
+		signRequest("PUT", url, region, credentials, digest, std::time(nullptr), headers);
+		util::HTTPResponse response;
+		if (!util::httpRequest("PUT", url, headers, data, response))
+			continue;
+		if (response.status / 100 == 2) {
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			manifest[key] = digest;
+			uploaded++;
+			return true;
+		}
+		LOG(DEBUG) << "Uploading '" << key << "' failed with status " << response.status
+				<< ": " << response.body;
+	}
+	LOG(WARNING) << "Unable to upload '" << key << "' to '" << url << "'.";
+	return false;
+}
+
+}
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEUPLOADER_H_
+#define TILEUPLOADER_H_
+
+#include "../compat/thread.h"
+
+#include <ctime>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * The credentials to sign requests to an S3-compatible object storage.
+ */
+struct S3Credentials {
+	std::string access_key_id, secret_access_key;
+	// only for temporary credentials
+	std::string session_token;
+
+	/**
+	 * Returns the credentials of the environment variables AWS_ACCESS_KEY_ID,
+	 * AWS_SECRET_ACCESS_KEY and AWS_SESSION_TOKEN. Without an access key the requests
+	 * are not signed.
+	 */
+	static S3Credentials fromEnvironment();
+};
+
+/**
+ * Uploads the written tiles of a map rotation to a bucket of an S3-compatible object
+ * storage on background threads, so the output directory doesn't need to be synced to
+ * the bucket after the rendering.
+ *
+ * The tile stores queue the files of the tiles once they are written. The key of a file
+ * in the bucket is its path relative to the output directory of the config, appended to
+ * the path of the upload URL (http://<host>[:<port>]/<bucket>[/<prefix>], the bucket is
+ * addressed path-style). A file queued again before it is uploaded is uploaded only
+ * once, with its newest content.
+ *
+ * The manifest has the SHA-256 digests of the uploaded files. Files with the same
+ * digest as in the manifest are not uploaded again, most tiles written again by a
+ * rendering have the same images. Failed uploads are retried some times with an
+ * increasing delay.
+ */
+class TileUploader {
+public:
+	TileUploader(const fs::path& local_dir, const std::string& url,
+			const std::string& region, const S3Credentials& credentials,
+			int threads, int retries);
+	~TileUploader();
+
+	/**
+	 * Reads and writes the manifest with the digests of the uploaded files. Reading
+	 * returns false if the file does not exist or is invalid, the manifest is empty then.
+	 */
+	bool readManifest(const fs::path& filename);
+	bool writeManifest(const fs::path& filename) const;
+
+	/**
+	 * Puts a file in the local directory into the queue to upload it.
+	 */
+	void upload(const std::string& file);
+
+	/**
+	 * Waits until all queued files are uploaded and stops the threads, the destructor
+	 * calls this too.
+	 */
+	void finish();
+
+	/**
+	 * Returns how many files were uploaded, how many were not uploaded because they
+	 * didn't change, and how many could not be uploaded.
+	 */
+	size_t getUploadedCount() const;
+	size_t getUnchangedCount() const;
+	size_t getFailedCount() const;
+
+	/**
+	 * Adds the headers (x-amz-date, x-amz-content-sha256 and Authorization) of AWS
+	 * signature version 4 to a request to an S3-compatible object storage. The other
+	 * headers of the request are signed too.
+	 */
+	static void signRequest(const std::string& method, const std::string& url,
+			const std::string& region, const S3Credentials& credentials,
+			const std::string& payload_sha256, std::time_t time,
+			std::map<std::string, std::string>& headers);
+
+private:
+	/**
+	 * Uploads the queued files until the uploader is finished.
+	 */
+	void run();
+
+	/**
+	 * Uploads a file if it changed since its last upload. Returns false if it could
+	 * not be uploaded.
+	 */
+	bool uploadFile(const std::string& file);
+
+	std::string local_prefix, url_prefix;
+	std::string region;
+	S3Credentials credentials;
+	int retries;
+
+	std::deque<std::string> queue;
+	std::set<std::string> queued;
+	// the key and the digest (hex) of every uploaded file
+	std::map<std::string, std::string> manifest;
+	size_t uploaded, unchanged, failed;
+
+	std::vector<thread_ns::thread> threads;
+	bool finished;
+	mutable thread_ns::mutex mutex;
+	thread_ns::condition_variable queue_changed;
+	thread_ns::condition_variable queue_empty;
+	// the files being uploaded
+	int active;
+};
+
+}
+}
+
+#endif /* TILEUPLOADER_H_ */
@@ -0,0 +1,641 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilewriter.h"
+
+#include "image/quantization.h"
+#include "image/scaling.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <zlib.h>
+
+namespace mapcrafter {
+namespace renderer {
+
+namespace {
+
+// count of images which can be queued per thread
+const int QUEUED_PER_THREAD = 4;
+
+// count of render tiles from which the shared palette of indexed PNGs is learned, only
+// tiles with at least a quarter of visible pixels are used, the ones at the edges of
+// the map have hardly any colors
+const size_t PALETTE_SAMPLE_TILES = 16;
+const int PALETTE_SAMPLE_MIN_VISIBLE = 4;
+
+// count of written tiles which are remembered to find duplicates of them
+const size_t DEDUPLICATION_TILES = 16;
+
+/**
+ * FNV-1a like hash of the pixels of an image, over 64-bit words (two pixels) instead of
+ * single bytes.
+ */
+uint64_t hashPixels(const RGBAImage& image) {
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = (hash ^ (uint64_t) image.getWidth()) * prime;
+	hash = (hash ^ (uint64_t) image.getHeight()) * prime;
+	size_t size = (size_t) image.getWidth() * image.getHeight();
+	if (size == 0)
+		return hash;
+	const RGBAPixel* data = &image.pixel(0, 0);
+	for (size_t i = 0; i + 2 <= size; i += 2)
+		hash = (hash ^ (((uint64_t) data[i + 1] << 32) | data[i])) * prime;
+	if (size % 2)
+		hash = (hash ^ data[size - 1]) * prime;
+	return hash;
+}
+
+bool hasSamePixels(const RGBAImage& image1, const RGBAImage& image2) {
+	if (image1.getWidth() != image2.getWidth() || image1.getHeight() != image2.getHeight())
+		return false;
+	size_t size = (size_t) image1.getWidth() * image1.getHeight();
+	return size == 0 || std::equal(&image1.pixel(0, 0), &image1.pixel(0, 0) + size,
+			&image2.pixel(0, 0));
+}
+
+bool isBlank(const RGBAImage& image) {
+	for (int y = 0; y < image.getHeight(); y++)
+		for (int x = 0; x < image.getWidth(); x++)
+			if (image.pixel(x, y) != 0)
+				return false;
+	return true;
+}
+
+bool hasEnoughVisiblePixels(const RGBAImage& image) {
+	int pixels = image.getWidth() * image.getHeight();
+	int visible = 0;
+	for (int y = 0; y < image.getHeight(); y++)
+		for (int x = 0; x < image.getWidth(); x++)
+			if (rgba_alpha(image.pixel(x, y)) != 0)
+				visible++;
+	return visible * PALETTE_SAMPLE_MIN_VISIBLE >= pixels;
+}
+
+}
+
+TileWriter::TileWriter(const config::MapSection& map_config,
+		const config::Color& background_color, int threads, std::shared_ptr<TileStore> store)
+	: map_config(map_config), background_color(background_color),
+	  max_queued(threads * QUEUED_PER_THREAD), store(store), tile_hashes(nullptr),
+	  unchanged_count(0), thumbnails(nullptr), blank_written(false),
+	  links_supported(true), finished(false) {
+	for (int i = 0; i < threads; i++)
+		this->threads.push_back(thread_ns::thread(&TileWriter::run, this));
+}
+
+TileWriter::~TileWriter() {
+	finish();
+}
+
+TileStore& TileWriter::getStore() {
+	return *store;
+}
+
+void TileWriter::setTileHashes(TileHashIndex* tile_hashes) {
+	this->tile_hashes = tile_hashes;
+}
+
+size_t TileWriter::getUnchangedCount() const {
+	return unchanged_count;
+}
+
+void TileWriter::setThumbnails(TileStore* thumbnails) {
+	this->thumbnails = thumbnails;
+}
+
+void TileWriter::addOutput(const config::TileOutput& output,
+		std::shared_ptr<TileStore> store) {
+	outputs.push_back(std::make_pair(output, store));
+}
+
+size_t TileWriter::getMaxQueued() const {
+	return max_queued;
+}
+
+size_t TileWriter::getQueued() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	return queue.size();
+}
+
+void TileWriter::write(const TilePath& tile, const RGBAImage& image, bool composite,
+		std::time_t time) {
+	if (threads.empty()) {
+		writeTile(tile, image, composite, time);
+		return;
+	}
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	// copying into an image of the same size doesn't allocate memory
+	queueTile(lock, tile, composite, time).image = image;
+	condition_queued.notify_one();
+}
+
+void TileWriter::writeSwap(const TilePath& tile, RGBAImage& image, bool composite) {
+	if (threads.empty()) {
+		writeTile(tile, image, composite);
+		image.clear();
+		return;
+	}
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	std::swap(queueTile(lock, tile, composite).image, image);
+	condition_queued.notify_one();
+}
+
+void TileWriter::waitWritten(const TilePath& tile) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	while (pending.count(tile))
+		condition_written.wait(lock);
+}
+
+bool TileWriter::readImage(const TilePath& tile, RGBAImage& image) {
+	util::ProfileScope profile(util::ProfileStage::TILE_READ);
+	waitWritten(tile);
+	std::string data;
+	return store->read(tile, data) && decodeImage(data, image, map_config);
+}
+
+bool TileWriter::readThumbnail(const TilePath& tile, RGBAImage& thumbnail) {
+	util::ProfileScope profile(util::ProfileStage::TILE_READ);
+	if (thumbnails == nullptr)
+		return false;
+	waitWritten(tile);
+	std::string data;
+	return thumbnails->read(tile, data) && decodeThumbnail(data, thumbnail);
+}
+
+void TileWriter::finish() {
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		finished = true;
+		condition_queued.notify_all();
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	threads.clear();
+	store->flush();
+	if (thumbnails != nullptr)
+		thumbnails->flush();
+	for (auto it = outputs.begin(); it != outputs.end(); ++it)
+		it->second->flush();
+}
+
+bool TileWriter::encodeImage(const RGBAImage& image, const config::MapSection& map_config,
+		const config::Color& background_color, bool composite, Palette* palette,
+		std::string& data) {
+	util::ProfileScope profile(util::ProfileStage::ENCODE);
+	util::TraceScope trace("encode");
+	std::ostringstream buffer;
+	bool ok;
+	config::ImageFormat format = map_config.getImageFormat();
+	MAPCRAFTER_PROBE1(encode__start, (int) format);
+	if (format == config::ImageFormat::JPEG) {
+		config::Color bg = background_color;
+		ok = image.writeJPEG(buffer, map_config.getJPEGQuality(),
+				rgba(bg.red, bg.green, bg.blue, 255), getJPEGOptions(map_config));
+	} else if (format == config::ImageFormat::WEBP)
+		ok = image.writeWebP(buffer, map_config.isWebPLossless(), map_config.getWebPQuality());
+	else if (map_config.isPNGIndexed())
+		ok = image.writeIndexedPNG(buffer, 8, true, getPNGOptions(map_config, composite),
+				palette);
+	else
+		ok = image.writePNG(buffer, getPNGOptions(map_config, composite));
+	if (!ok) {
+		MAPCRAFTER_PROBE2(encode__end, (int) format, 0);
+		LOG(WARNING) << "Unable to encode the image of a tile.";
+		return false;
+	}
+	data = buffer.str();
+	MAPCRAFTER_PROBE2(encode__end, (int) format, data.size());
+	return true;
+}
+
+bool TileWriter::encodeImage(const RGBAImage& image, const config::TileOutput& output,
+		const config::MapSection& map_config, const config::Color& background_color,
+		bool composite, std::string& data) {
+	util::ProfileScope profile(util::ProfileStage::ENCODE);
+	util::TraceScope trace("encode");
+	std::ostringstream buffer;
+	bool ok;
+	MAPCRAFTER_PROBE1(encode__start, (int) output.format);
+	if (output.format == config::ImageFormat::JPEG) {
+		config::Color bg = background_color;
+		int quality = output.quality >= 0 ? output.quality : map_config.getJPEGQuality();
+		ok = image.writeJPEG(buffer, quality, rgba(bg.red, bg.green, bg.blue, 255),
+				getJPEGOptions(map_config));
+	} else if (output.format == config::ImageFormat::WEBP) {
+		// without quality the output has the WebP settings of the map
+		bool specified = output.lossless || output.quality >= 0;
+		ok = image.writeWebP(buffer, specified ? output.lossless : map_config.isWebPLossless(),
+				output.quality >= 0 ? output.quality : map_config.getWebPQuality());
+	} else if (map_config.isPNGIndexed())
+		ok = image.writeIndexedPNG(buffer, 8, true, getPNGOptions(map_config, composite),
+				nullptr);
+	else
+		ok = image.writePNG(buffer, getPNGOptions(map_config, composite));
+	if (!ok) {
+		MAPCRAFTER_PROBE2(encode__end, (int) output.format, 0);
+		LOG(WARNING) << "Unable to encode the image of a tile for output " << output.name
+				<< ".";
+		return false;
+	}
+	data = buffer.str();
+	MAPCRAFTER_PROBE2(encode__end, (int) output.format, data.size());
+	return true;
+}
+
+bool TileWriter::decodeImage(const std::string& data, RGBAImage& image,
+		const config::MapSection& map_config) {
+	return decodeImage(data, image, map_config.getImageFormat(),
+			map_config.useJPEGFastDCT());
+}
+
+bool TileWriter::decodeImage(const std::string& data, RGBAImage& image,
+		config::ImageFormat format, bool fast_dct) {
+	std::istringstream in(data);
+	if (format == config::ImageFormat::JPEG)
+		return image.readJPEG(in, fast_dct);
+	else if (format == config::ImageFormat::WEBP)
+		return image.readWebP(in);
+	return image.readPNG(in);
+}
+
+bool TileWriter::recompressPNG(const std::string& data, std::string& recompressed) {
+	RGBAImage image;
+	std::istringstream in(data);
+	if (!image.readPNG(in))
+		return false;
+
+	// the filter chosen by libpng for every row, and the filters which work best for
+	// flat and for smooth images
+	const int filters[] = {PNG_ALL_FILTERS, PNG_FILTER_NONE, PNG_FILTER_PAETH};
+	const int strategies[] = {Z_DEFAULT_STRATEGY, Z_FILTERED};
+	recompressed.clear();
+	for (int filter : filters) {
+		for (int strategy : strategies) {
+			PNGOptions options;
+			options.compression_level = 9;
+			options.filters = filter;
+			options.strategy = strategy;
+			std::ostringstream out;
+			if (!image.writePNG(out, options))
+				continue;
+			std::string encoded = out.str();
+			if (encoded.size() < data.size() && (recompressed.empty()
+					|| encoded.size() < recompressed.size()))
+				recompressed.swap(encoded);
+		}
+	}
+	return !recompressed.empty();
+}
+
+void TileWriter::encodeThumbnail(const RGBAImage& image, std::string& data) {
+	util::ProfileScope profile(util::ProfileStage::ENCODE);
+#ifdef HAVE_THREAD_LOCAL
+	static thread_local RGBAImage thumbnail;
+#else
+	RGBAImage thumbnail;
+#endif
+	thumbnail.setSize(image.getWidth() / 2, image.getHeight() / 2);
+	thumbnail.clear();
+	imageResizeHalfBlit(image, thumbnail, 0, 0);
+
+	// the size of the thumbnail and the compressed pixels (in host byte order)
+	uint32_t size[2] = {(uint32_t) thumbnail.getWidth(), (uint32_t) thumbnail.getHeight()};
+	uLong pixels_size = (uLong) size[0] * size[1] * sizeof(RGBAPixel);
+	uLongf compressed_size = compressBound(pixels_size);
+	data.resize(sizeof(size) + compressed_size);
+	std::memcpy(&data[0], size, sizeof(size));
+	if (pixels_size == 0
+			|| compress2((Bytef*) &data[sizeof(size)], &compressed_size,
+					(const Bytef*) &thumbnail.pixel(0, 0), pixels_size, Z_BEST_SPEED) != Z_OK)
+		compressed_size = 0;
+	data.resize(sizeof(size) + compressed_size);
+}
+
+bool TileWriter::decodeThumbnail(const std::string& data, RGBAImage& thumbnail) {
+	uint32_t size[2];
+	if (data.size() <= sizeof(size))
+		return false;
+	std::memcpy(size, data.data(), sizeof(size));
+	if (size[0] == 0 || size[1] == 0 || size[0] > 1 << 16 || size[1] > 1 << 16)
+		return false;
+	thumbnail.setSize(size[0], size[1]);
+	uLongf pixels_size = (uLongf) size[0] * size[1] * sizeof(RGBAPixel);
+	return uncompress((Bytef*) &thumbnail.pixel(0, 0), &pixels_size,
+			(const Bytef*) data.data() + sizeof(size), data.size() - sizeof(size)) == Z_OK
+			&& pixels_size == (uLongf) size[0] * size[1] * sizeof(RGBAPixel);
+}
+
+PNGOptions TileWriter::getPNGOptions(const config::MapSection& map_config, bool composite) {
+	PNGOptions options;
+	options.compression_level = composite ? map_config.getPNGCompositeCompressionLevel()
+			: map_config.getPNGCompressionLevel();
+
+	config::PNGFilter filter = map_config.getPNGFilter();
+	if (filter == config::PNGFilter::NONE)
+		options.filters = PNG_FILTER_NONE;
+	else if (filter == config::PNGFilter::SUB)
+		options.filters = PNG_FILTER_SUB;
+	else if (filter == config::PNGFilter::UP)
+		options.filters = PNG_FILTER_UP;
+	else if (filter == config::PNGFilter::AVERAGE)
+		options.filters = PNG_FILTER_AVG;
+	else if (filter == config::PNGFilter::PAETH)
+		options.filters = PNG_FILTER_PAETH;
+
+	config::PNGZlibStrategy strategy = map_config.getPNGZlibStrategy();
+	if (strategy == config::PNGZlibStrategy::DEFAULT)
+		options.strategy = Z_DEFAULT_STRATEGY;
+	else if (strategy == config::PNGZlibStrategy::FILTERED)
+		options.strategy = Z_FILTERED;
+	else if (strategy == config::PNGZlibStrategy::HUFFMAN)
+		options.strategy = Z_HUFFMAN_ONLY;
+	else if (strategy == config::PNGZlibStrategy::RLE)
+		options.strategy = Z_RLE;
+	return options;
+}
+
+JPEGOptions TileWriter::getJPEGOptions(const config::MapSection& map_config) {
+	JPEGOptions options;
+	options.fast_dct = map_config.useJPEGFastDCT();
+
+	config::JPEGSubsampling subsampling = map_config.getJPEGSubsampling();
+	if (subsampling == config::JPEGSubsampling::S444) {
+		options.h_sampling = 1;
+		options.v_sampling = 1;
+	} else if (subsampling == config::JPEGSubsampling::S422) {
+		options.h_sampling = 2;
+		options.v_sampling = 1;
+	} else if (subsampling == config::JPEGSubsampling::S420) {
+		options.h_sampling = 2;
+		options.v_sampling = 2;
+	}
+	return options;
+}
+
+void TileWriter::writeTile(const TilePath& tile, const RGBAImage& image, bool composite,
+		std::time_t time) {
+	util::ProfileScope profile(util::ProfileStage::WRITE);
+	util::MemoryScope memory(util::MemorySubsystem::TILE_BUFFERS);
+	util::TraceScope trace("write tile");
+	if (trace.isActive())
+		trace.setDetail(tile.toString());
+	MAPCRAFTER_PROBE1(write__start, tile.toString().c_str());
+	uint64_t hash = 0;
+	bool deduplicate = map_config.useTileDeduplication() && links_supported;
+	if (deduplicate || tile_hashes != nullptr)
+		hash = hashPixels(image);
+	if (tile_hashes != nullptr && keepUnchanged(tile, hash)) {
+		writeThumbnail(tile, image, true);
+		// the outputs might have been added since the tile was written
+		for (auto it = outputs.begin(); it != outputs.end(); ++it)
+			if (!it->second->exists(tile))
+				writeOutput(*it, tile, image, composite);
+		MAPCRAFTER_PROBE2(write__end, tile.toString().c_str(), 0);
+		return;
+	}
+
+	bool written = deduplicate && writeDuplicate(tile, image, hash, composite);
+	if (!written) {
+		std::string data;
+		written = encodeImage(image, map_config, background_color, composite,
+				getPalette(image, composite), data) && store->write(tile, data, time);
+		if (written)
+			util::Profiler::addMetric(util::Metric::TILE_BYTES_WRITTEN, data.size());
+		if (written && deduplicate)
+			addWrittenTile(tile, image, hash);
+		// a tile which could not be written is written again the next time anyway
+		for (auto it = outputs.begin(); written && it != outputs.end(); ++it)
+			writeOutput(*it, tile, image, composite, time);
+	}
+	if (written)
+		writeThumbnail(tile, image, false);
+	MAPCRAFTER_PROBE2(write__end, tile.toString().c_str(), (int) written);
+
+	if (tile_hashes != nullptr) {
+		thread_ns::unique_lock<thread_ns::mutex> lock(tile_hashes_mutex);
+		// a tile which could not be written has to be written the next time
+		if (written)
+			tile_hashes->update(tile, hash);
+		else
+			tile_hashes->remove(tile);
+	}
+}
+
+bool TileWriter::encodeOutput(const Output& output, const RGBAImage& image,
+		bool composite, std::string& data) const {
+	if (!output.first.half_size)
+		return encodeImage(image, output.first, map_config, background_color, composite,
+				data);
+	RGBAImage half(image.getWidth() / 2, image.getHeight() / 2);
+	imageResizeHalfBlit(image, half, 0, 0);
+	return encodeImage(half, output.first, map_config, background_color, composite, data);
+}
+
+bool TileWriter::writeOutput(const Output& output, const TilePath& tile,
+		const RGBAImage& image, bool composite, std::time_t time) {
+	std::string data;
+	if (!encodeOutput(output, image, composite, data)
+			|| !output.second->write(tile, data, time))
+		return false;
+	util::Profiler::addMetric(util::Metric::TILE_BYTES_WRITTEN, data.size());
+	return true;
+}
+
+bool TileWriter::keepUnchanged(const TilePath& tile, uint64_t hash) {
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(tile_hashes_mutex);
+		uint64_t old_hash;
+		if (!tile_hashes->find(tile, old_hash) || old_hash != hash)
+			return false;
+	}
+	// the tile might have been removed, and the image modification times must tell
+	// that the tile is up to date if they are used to find the required tiles
+	if (map_config.useImageModificationTimes()) {
+		if (!store->touch(tile))
+			return false;
+	} else {
+		if (!store->exists(tile))
+			return false;
+		store->keep(tile);
+	}
+	unchanged_count++;
+	return true;
+}
+
+void TileWriter::writeThumbnail(const TilePath& tile, const RGBAImage& image,
+		bool unchanged) {
+	// the top tile is not part of a composite tile
+	if (thumbnails == nullptr || tile.getDepth() == 0
+			|| (unchanged && thumbnails->exists(tile)))
+		return;
+	std::string data;
+	encodeThumbnail(image, data);
+	thumbnails->write(tile, data);
+}
+
+bool TileWriter::writeDuplicate(const TilePath& tile, const RGBAImage& image,
+		uint64_t hash, bool composite) {
+	TilePath original;
+	bool found = false, blank = false;
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(written_tiles_mutex);
+		// the blank tile is written with the first transparent tile
+		if (!blank_written && isBlank(image)) {
+			blank_written = true;
+			std::string data;
+			if (encodeImage(image, map_config, background_color, false, nullptr, data)
+					&& store->writeBlank(data)) {
+				blank_tile.image = image;
+				blank_tile.hash = hash;
+				for (auto it = outputs.begin(); it != outputs.end(); ++it)
+					if (encodeOutput(*it, image, false, data))
+						it->second->writeBlank(data);
+			}
+		}
+
+		if (blank_tile.image.getWidth() != 0 && blank_tile.hash == hash
+				&& hasSamePixels(blank_tile.image, image))
+			blank = true;
+		for (auto it = written_tiles.begin(); it != written_tiles.end(); ) {
+			// the tile is replaced now, it can't be the original of other tiles anymore
+			if (it->tile == tile) {
+				it = written_tiles.erase(it);
+				continue;
+			}
+			if (!blank && !found && it->hash == hash && hasSamePixels(it->image, image)) {
+				original = it->tile;
+				found = true;
+				written_tiles.splice(written_tiles.begin(), written_tiles, it++);
+				continue;
+			}
+			++it;
+		}
+	}
+	if (!blank && !found)
+		return false;
+
+	if (blank ? store->linkBlank(tile) : store->link(original, tile)) {
+		// the original tile has the same image in the outputs
+		for (auto it = outputs.begin(); it != outputs.end(); ++it)
+			if (!(blank ? it->second->linkBlank(tile) : it->second->link(original, tile)))
+				writeOutput(*it, tile, image, composite);
+		return true;
+	}
+	// the filesystem might not support hardlinks, write the tiles normally then
+	if (links_supported.exchange(false))
+		LOG(WARNING) << "Unable to link tile '" << tile.toString() << "' to a tile with "
+				<< "the same image, disabling tile deduplication.";
+	return false;
+}
+
+void TileWriter::addWrittenTile(const TilePath& tile, const RGBAImage& image,
+		uint64_t hash) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(written_tiles_mutex);
+	WrittenTile written;
+	written.tile = tile;
+	written.image = image;
+	written.hash = hash;
+	written_tiles.push_front(written);
+	if (written_tiles.size() > DEDUPLICATION_TILES)
+		written_tiles.pop_back();
+}
+
+Palette* TileWriter::getPalette(const RGBAImage& image, bool composite) {
+	if (map_config.getImageFormat() != config::ImageFormat::PNG || !map_config.isPNGIndexed()
+			|| map_config.getPNGPalette() != config::PNGPalette::MAP)
+		return nullptr;
+
+	thread_ns::unique_lock<thread_ns::mutex> lock(palette_mutex);
+	if (palette || composite || !hasEnoughVisiblePixels(image))
+		return palette.get();
+	palette_samples.push_back(image);
+	if (palette_samples.size() < PALETTE_SAMPLE_TILES)
+		return nullptr;
+
+	std::vector<const RGBAImage*> images;
+	for (size_t i = 0; i < palette_samples.size(); i++)
+		images.push_back(&palette_samples[i]);
+	std::vector<RGBAPixel> colors;
+	octreeColorQuantize(images, 256, colors);
+	palette.reset(new LookupPalette(colors));
+	palette_samples.clear();
+	return palette.get();
+}
+
+TileWriter::QueuedTile& TileWriter::queueTile(
+		thread_ns::unique_lock<thread_ns::mutex>& lock, const TilePath& tile,
+		bool composite, std::time_t time) {
+	while (queue.size() >= max_queued)
+		condition_written.wait(lock);
+	queue.push_back(QueuedTile());
+	QueuedTile& queued = queue.back();
+	queued.tile = tile;
+	queued.composite = composite;
+	queued.time = time;
+	if (!unused_images.empty()) {
+		queued.image = std::move(unused_images.back());
+		unused_images.pop_back();
+	}
+	pending.insert(tile);
+	util::Profiler::addGauge(util::Gauge::QUEUED_TILES, 1);
+	return queued;
+}
+
+void TileWriter::run() {
+	util::Profiler::setThreadName("writer");
+	while (true) {
+		QueuedTile item;
+		{
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			// the queue is written completely before the threads stop
+			while (!finished && queue.empty())
+				condition_queued.wait(lock);
+			if (queue.empty())
+				return;
+			item = std::move(queue.front());
+			queue.pop_front();
+			util::Profiler::addGauge(util::Gauge::QUEUED_TILES, -1);
+			// there is space in the queue again
+			condition_written.notify_all();
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		writeTile(item.tile, item.image, item.composite, item.time);
+		util::Profiler::addMetric(util::Metric::BUSY_TIME,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count());
+		// the images written with writeSwap are returned transparent
+		item.image.clear();
+
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		pending.erase(pending.find(item.tile));
+		unused_images.push_back(std::move(item.image));
+		condition_written.notify_all();
+	}
+}
+
+}
+}
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEWRITER_H_
+#define TILEWRITER_H_
+
+#include "image.h"
+#include "tilehashindex.h"
+#include "tileset.h"
+#include "tilestore.h"
+#include "image/palette.h"
+#include "../compat/thread.h"
+#include "../config/mapcrafterconfig.h"
+#include "../config/configsections/map.h"
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace renderer {
+
+/**
+ * Encodes the images of rendered tiles and writes them to the tile store of a map
+ * rotation on background threads, so the render threads don't have to wait for it. At most a few images per writer thread
+ * are queued, the render threads wait if there are more. Without threads the images
+ * are written right away by the calling thread.
+ *
+ * The images are encoded into memory and written by the store at once. The composite
+ * tiles can be compressed with another compression level than the render
+ * tiles, they are much fewer. Indexed PNGs can share a palette which the writer learns
+ * from the colors of the first render tiles, instead of quantizing every tile.
+ *
+ * With tile deduplication, the writer remembers the pixels of the last written tiles.
+ * Tiles with the same pixels as one of them (like tiles of the ocean) are linked to it
+ * by the store (hardlinks of its file) instead of being encoded again, and completely
+ * transparent tiles are linked to the blank tile of the store, which the web interface
+ * uses for the tiles outside of the map too.
+ *
+ * With an index of the hashes of the tile images, the writer doesn't encode and write
+ * tiles again which have the same pixels as the last time they were written.
+ *
+ * With a store for thumbnails, the writer saves the half-size pixels of every tile
+ * there too, the composite tiles above a tile are composed of them without decoding
+ * the tile.
+ *
+ * The additional outputs of a map (like WebP or half-size tiles) are encoded from the
+ * same images as the tiles and written to stores of their own, so the tiles are
+ * rendered only once for all outputs.
+ *
+ * The writer is shared by the render threads.
+ */
+class TileWriter {
+public:
+	TileWriter(const config::MapSection& map_config, const config::Color& background_color,
+			int threads, std::shared_ptr<TileStore> store);
+	~TileWriter();
+
+	/**
+	 * Returns the store to which the tiles are written.
+	 */
+	TileStore& getStore();
+
+	/**
+	 * Sets an index with the hashes of the images of the written tiles. Tiles with the
+	 * same hash as in the index are not written again, the index is updated with the
+	 * hashes of the other written tiles.
+	 */
+	void setTileHashes(TileHashIndex* tile_hashes);
+
+	/**
+	 * Returns how many tiles were not written again because their images didn't change.
+	 */
+	size_t getUnchangedCount() const;
+
+	/**
+	 * Sets a store to which the thumbnails of the written tiles are saved, that are the
+	 * pixels of the tiles resized to the half size.
+	 */
+	void setThumbnails(TileStore* thumbnails);
+
+	/**
+	 * Adds an additional output of the tiles with the store to which its tiles are
+	 * written. The tiles linked in the store of the tiles are linked in its store too.
+	 */
+	void addOutput(const config::TileOutput& output, std::shared_ptr<TileStore> store);
+
+	/**
+	 * Returns how many images can be queued at most.
+	 */
+	size_t getMaxQueued() const;
+
+	/**
+	 * Returns how many images are queued now.
+	 */
+	size_t getQueued();
+
+	/**
+	 * Puts the image of a tile into the queue to write it to the store. The tile is
+	 * written with the specified modification time if it's not 0, for tiles which are
+	 * only encoded again (see TileStore::write).
+	 */
+	void write(const TilePath& tile, const RGBAImage& image, bool composite = false,
+			std::time_t time = 0);
+
+	/**
+	 * Like write(), but takes the image instead of copying it. The image is swapped with
+	 * an unused image of the writer, it is completely transparent afterwards (but might
+	 * have a different size) and can be used for the next tile.
+	 */
+	void writeSwap(const TilePath& tile, RGBAImage& image, bool composite = false);
+
+	/**
+	 * Waits until a tile is written if it's in the queue.
+	 */
+	void waitWritten(const TilePath& tile);
+
+	/**
+	 * Reads the image of a tile from the store, waits until the tile is written first if
+	 * it's in the queue.
+	 */
+	bool readImage(const TilePath& tile, RGBAImage& image);
+
+	/**
+	 * Reads the thumbnail of a tile, waits until the tile is written first if it's in
+	 * the queue. Returns false if there is no store for thumbnails or no thumbnail of
+	 * the tile.
+	 */
+	bool readThumbnail(const TilePath& tile, RGBAImage& thumbnail);
+
+	/**
+	 * Waits until all queued images are written, stops the threads and flushes the
+	 * store, the destructor calls this too.
+	 */
+	void finish();
+
+	/**
+	 * Encodes an image of a tile with the image format of a map. Returns false (and logs
+	 * a warning) if the image could not be encoded.
+	 */
+	static bool encodeImage(const RGBAImage& image, const config::MapSection& map_config,
+			const config::Color& background_color, bool composite, Palette* palette,
+			std::string& data);
+
+	/**
+	 * Encodes an image of a tile with the image format of an additional output of a map,
+	 * the other settings of the image format are the ones of the map.
+	 */
+	static bool encodeImage(const RGBAImage& image, const config::TileOutput& output,
+			const config::MapSection& map_config, const config::Color& background_color,
+			bool composite, std::string& data);
+
+	/**
+	 * Decodes the image of a tile which was encoded with the image format of a map. The
+	 * tiles are read to compose the tiles of the next lower zoom level, so JPEGs are
+	 * decoded with the fast (less accurate) settings if the map uses the fast DCT.
+	 */
+	static bool decodeImage(const std::string& data, RGBAImage& image,
+			const config::MapSection& map_config);
+
+	/**
+	 * Decodes the image of a tile which was encoded with a specific image format, like
+	 * the tiles of a map which are encoded again with another image format.
+	 */
+	static bool decodeImage(const std::string& data, RGBAImage& image,
+			config::ImageFormat format, bool fast_dct);
+
+	/**
+	 * Encodes a PNG image again with the best compression, a few row filters and zlib
+	 * strategies are tried with the highest compression level. Returns false if the
+	 * data can't be decoded or none of the encodings is smaller than the data.
+	 */
+	static bool recompressPNG(const std::string& data, std::string& recompressed);
+
+	/**
+	 * Resizes the image of a tile to the half size and encodes its pixels as thumbnail,
+	 * and decodes a thumbnail. The pixels are compressed with the fastest zlib level.
+	 */
+	static void encodeThumbnail(const RGBAImage& image, std::string& data);
+	static bool decodeThumbnail(const std::string& data, RGBAImage& thumbnail);
+
+	/**
+	 * Returns the PNG compression settings of a map for render or composite tiles.
+	 */
+	static PNGOptions getPNGOptions(const config::MapSection& map_config, bool composite);
+
+	/**
+	 * Returns the JPEG compression settings of a map.
+	 */
+	static JPEGOptions getJPEGOptions(const config::MapSection& map_config);
+
+private:
+	/**
+	 * Encodes an image and writes it to the store.
+	 */
+	void writeTile(const TilePath& tile, const RGBAImage& image, bool composite,
+			std::time_t time = 0);
+
+	typedef std::pair<config::TileOutput, std::shared_ptr<TileStore> > Output;
+
+	/**
+	 * Encodes an image for an additional output, resized to the half size if the output
+	 * has half-size tiles.
+	 */
+	bool encodeOutput(const Output& output, const RGBAImage& image, bool composite,
+			std::string& data) const;
+
+	/**
+	 * Encodes an image for an additional output and writes it to its store.
+	 */
+	bool writeOutput(const Output& output, const TilePath& tile, const RGBAImage& image,
+			bool composite, std::time_t time = 0);
+
+	/**
+	 * Checks whether a tile has still the same image as the last time it was written,
+	 * it doesn't have to be written again then. Returns false if the tile has to be
+	 * written.
+	 */
+	bool keepUnchanged(const TilePath& tile, uint64_t hash);
+
+	/**
+	 * Saves the thumbnail of a written tile, or of a tile which was kept unchanged if it
+	 * has no thumbnail yet.
+	 */
+	void writeThumbnail(const TilePath& tile, const RGBAImage& image, bool unchanged);
+
+	/**
+	 * Links a tile to a written tile with the same pixels, if there is one. Returns
+	 * false if the tile has to be encoded.
+	 */
+	bool writeDuplicate(const TilePath& tile, const RGBAImage& image, uint64_t hash,
+			bool composite);
+
+	/**
+	 * Remembers the pixels of a written tile to find duplicates of it.
+	 */
+	void addWrittenTile(const TilePath& tile, const RGBAImage& image, uint64_t hash);
+
+	/**
+	 * Returns the palette shared by the indexed PNGs of the map, or nullptr if the tiles
+	 * are quantized on their own. The images of the first render tiles with enough
+	 * visible pixels are used to learn the palette, these tiles are quantized on their
+	 * own still.
+	 */
+	Palette* getPalette(const RGBAImage& image, bool composite);
+
+	config::MapSection map_config;
+	config::Color background_color;
+	size_t max_queued;
+	std::shared_ptr<TileStore> store;
+
+	// the hashes of the images of the written tiles
+	TileHashIndex* tile_hashes;
+	std::atomic<size_t> unchanged_count;
+	thread_ns::mutex tile_hashes_mutex;
+
+	// the store of the thumbnails of the written tiles
+	TileStore* thumbnails;
+
+	// the additional outputs and their stores
+	std::vector<Output> outputs;
+
+	// the palette shared by the indexed PNGs and the tiles to learn it from
+	std::unique_ptr<Palette> palette;
+	std::vector<RGBAImage> palette_samples;
+	thread_ns::mutex palette_mutex;
+
+	// a written tile to which its duplicates are linked
+	struct WrittenTile {
+		TilePath tile;
+		RGBAImage image;
+		uint64_t hash;
+	};
+
+	// the tiles to find duplicates of, the most recently used first, and the blank tile
+	std::list<WrittenTile> written_tiles;
+	WrittenTile blank_tile;
+	bool blank_written;
+	std::atomic<bool> links_supported;
+	thread_ns::mutex written_tiles_mutex;
+
+	struct QueuedTile {
+		TilePath tile;
+		RGBAImage image;
+		bool composite;
+		std::time_t time;
+	};
+
+	// the queued images and the tiles which are queued or being written, and the
+	// (cleared) images of the written tiles which are reused for the next queued tiles
+	std::deque<QueuedTile> queue;
+	std::vector<RGBAImage> unused_images;
+	std::multiset<TilePath> pending;
+	bool finished;
+
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable condition_queued, condition_written;
+	std::vector<thread_ns::thread> threads;
+
+	/**
+	 * Waits until there is space in the queue and queues a tile whose image is set by the
+	 * caller. The queued image is an unused image of one of the written tiles, if there
+	 * is one.
+	 */
+	QueuedTile& queueTile(thread_ns::unique_lock<thread_ns::mutex>& lock,
+			const TilePath& tile, bool composite, std::time_t time = 0);
+
+	void run();
+};
+
+}
+}
+
+#endif /* TILEWRITER_H_ */
@@ -20,14 +20,19 @@
 #ifndef DISPATCHER_H_
 #define DISPATCHER_H_
 
+#include "../mc/worldcache.h"
+#include "../renderer/tilerenderer.h"
+#include "../renderer/tilerenderworker.h"
+#include "../renderer/tileset.h"
+#include "../renderer/tilewriter.h"
 #include "../util.h"
 
-namespace mapcrafter {
-
-namespace renderer {
-struct RenderContext;
-}
+#include <atomic>
+#include <ctime>
+#include <ostream>
+#include <vector>
 
+namespace mapcrafter {
 namespace thread {
 
 /**
@@ -36,10 +41,163 @@ namespace thread {
  */
 class Dispatcher {
 public:
+	Dispatcher()
+		: memory_limit(0), pin_threads(false), stop_time(0), stop_flag(nullptr),
+		  complete(true) {};
 	virtual ~Dispatcher() {};
 
-	virtual void dispatch(const renderer::RenderContext& context,
+	void dispatch(const renderer::RenderContext& context,
+			util::IProgressHandler* progress) {
+		dispatch(std::vector<renderer::RenderContext>(1, context), progress);
+	}
+
+	/**
+	 * Renders multiple maps in one pass. The maps are rendered from the same world with
+	 * the same rotation and tile set, every job is rendered for one map after another,
+	 * so the maps can use the same decoded chunks of a shared chunk cache.
+	 */
+	virtual void dispatch(const std::vector<renderer::RenderContext>& contexts,
 			util::IProgressHandler* progress) = 0;
+
+	/**
+	 * Sets the render work to dispatch instead of all required tiles of the tile set.
+	 * The composite tiles above the tiles of the render work are not rendered then,
+	 * this is used to render a shard of a map.
+	 */
+	void setRenderWork(const std::vector<renderer::RenderWork>& render_work) {
+		this->render_work = render_work;
+	}
+
+	/**
+	 * Sets how much memory (in bytes) the caches and the images of the tiles being
+	 * rendered may use, the caches are made smaller to fit. 0 means no limit, the
+	 * default cache sizes are used then.
+	 */
+	void setMemoryLimit(size_t memory_limit) {
+		this->memory_limit = memory_limit;
+	}
+
+	/**
+	 * Sets a time after which no new render work is started, 0 means no time limit.
+	 * The work being rendered and the composite tiles of the rendered tiles are still
+	 * finished, the other required tiles are not rendered then.
+	 */
+	void setStopTime(std::time_t stop_time) {
+		this->stop_time = stop_time;
+	}
+
+	/**
+	 * Sets a flag after which no new render work is started once it's set, like the
+	 * stop time. This is only used by dispatchers with multiple threads.
+	 */
+	void setStopFlag(const std::atomic<bool>* stop_flag) {
+		this->stop_flag = stop_flag;
+	}
+
+	/**
+	 * Sets whether the render threads are pinned to the CPUs. The threads are spread over
+	 * the NUMA nodes then and set up their caches on their nodes, and the threads of
+	 * each node get a contiguous part of the tiles and an own shared chunk cache. This
+	 * is only used by dispatchers with multiple threads.
+	 */
+	void setPinThreads(bool pin_threads) {
+		this->pin_threads = pin_threads;
+	}
+
+	/**
+	 * Returns whether the last dispatch rendered all required tiles, or whether it
+	 * stopped at the stop time.
+	 */
+	bool isComplete() const {
+		return complete;
+	}
+
+	/**
+	 * Returns the region/chunk cache statistics of the world caches of a map used by
+	 * the last dispatch, merged from all render threads.
+	 */
+	const mc::CacheStats& getRegionCacheStats(size_t context = 0) const {
+		return region_cache_stats[context];
+	}
+
+	const mc::CacheStats& getChunkCacheStats(size_t context = 0) const {
+		return chunk_cache_stats[context];
+	}
+
+protected:
+	/**
+	 * Writes the progress of the maps being rendered (the rendered render tiles of all
+	 * maps together) and how many tiles their tile writers have queued to a status
+	 * report (see util::StatusReporter).
+	 */
+	static void reportProgress(std::ostream& out,
+			const std::vector<renderer::RenderContext>& contexts, int rendered, int max) {
+		std::string maps;
+		size_t queued = 0;
+		for (auto it = contexts.begin(); it != contexts.end(); ++it) {
+			maps += (maps.empty() ? "" : ", ") + it->map_config.getShortName();
+			if (it->tile_writer)
+				queued += it->tile_writer->getQueued();
+		}
+		out << "Rendering map" << (contexts.size() > 1 ? "s " : " ") << maps
+				<< " in rotation " << config::ROTATION_NAMES[contexts[0].world.getRotation()]
+				<< ": " << rendered << " of " << max << " render tiles";
+		if (max > 0)
+			out << " (" << 100 * (int64_t) rendered / max << "%)";
+		out << ", " << queued << " tiles queued to be written" << std::endl;
+	}
+
+	/**
+	 * Returns the approximate memory (in bytes) of the images of the tiles which are
+	 * rendered or queued to be written at the same time by a count of render threads.
+	 */
+	size_t getTileImagesMemory(const std::vector<renderer::RenderContext>& contexts,
+			int threads) const {
+		size_t memory = 0;
+		for (auto it = contexts.begin(); it != contexts.end(); ++it) {
+			size_t tile_size = it->tile_renderer->getTileSize();
+			// every thread has an image for every zoom level of the composite tiles
+			size_t images = threads * (it->tile_set->getDepth() + 1);
+			if (it->tile_writer)
+				images += it->tile_writer->getMaxQueued();
+			memory += images * tile_size * tile_size * sizeof(renderer::RGBAPixel);
+		}
+		return memory;
+	}
+
+	/**
+	 * Returns how many chunks fit into the memory limit if some of it is already used.
+	 */
+	size_t getChunkBudget(size_t used_memory) const {
+		if (used_memory >= memory_limit)
+			return 0;
+		return (memory_limit - used_memory) / CHUNK_MEMORY_USAGE;
+	}
+
+	// approximate memory of a decoded chunk, mostly between 50 and 200 KiB
+	static const size_t CHUNK_MEMORY_USAGE = 128 * 1024;
+
+	// at least this many chunks are cached per world cache, even if they don't fit
+	// into the memory limit
+	static const size_t MIN_CHUNK_CACHE_SIZE = 64;
+
+	// the render work set with setRenderWork, empty to render all required tiles
+	std::vector<renderer::RenderWork> render_work;
+
+	// the memory limit of the caches in bytes, 0 for no limit
+	size_t memory_limit;
+
+	// whether the render threads are pinned to the CPUs
+	bool pin_threads;
+
+	// the time and the flag after which no new work is started (0 and null for none),
+	// and whether the last dispatch rendered all work
+	std::time_t stop_time;
+	const std::atomic<bool>* stop_flag;
+	bool complete;
+
+	// the cache statistics of every map of the last dispatch
+	std::vector<mc::CacheStats> region_cache_stats, chunk_cache_stats;
 };
 
 } /* namespace thread */
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "affinity.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <boost/filesystem.hpp>
+
+#ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+namespace mapcrafter {
+namespace thread {
+
+namespace {
+
+/**
+ * Returns the CPUs this process may run on.
+ */
+std::vector<int> getAllowedCPUs() {
+	std::vector<int> cpus;
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			if (CPU_ISSET(cpu, &set))
+				cpus.push_back(cpu);
+	}
+#endif
+	if (cpus.empty()) {
+		int count = std::max(1, (int) std::thread::hardware_concurrency());
+		for (int cpu = 0; cpu < count; cpu++)
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+/**
+ * Returns the CPUs of the NUMA nodes ordered by the numbers of the nodes, or nothing
+ * if they are not known.
+ */
+std::vector<std::vector<int> > readNodes() {
+	std::map<int, std::vector<int> > nodes;
+	fs::path directory = "/sys/devices/system/node";
+	boost::system::error_code error;
+	if (!fs::is_directory(directory, error))
+		return std::vector<std::vector<int> >();
+	for (fs::directory_iterator it(directory, error), end; !error && it != end;
+			it.increment(error)) {
+		std::string name = it->path().filename().string();
+		if (name.size() <= 4 || name.compare(0, 4, "node") != 0
+				|| name.find_first_not_of("0123456789", 4) != std::string::npos)
+			continue;
+		std::ifstream in((it->path() / "cpulist").string());
+		std::string list;
+		if (in && std::getline(in, list))
+			nodes[std::atoi(name.c_str() + 4)] = parseCPUList(list);
+	}
+
+	std::vector<std::vector<int> > result;
+	for (auto it = nodes.begin(); it != nodes.end(); ++it)
+		result.push_back(it->second);
+	return result;
+}
+
+}
+
+CPUTopology::CPUTopology() {
+	std::vector<int> allowed = getAllowedCPUs();
+	std::set<int> allowed_set(allowed.begin(), allowed.end());
+	// only the CPUs this process may run on are used (for example with taskset)
+	std::vector<std::vector<int> > detected = readNodes();
+	for (auto node_it = detected.begin(); node_it != detected.end(); ++node_it) {
+		std::vector<int> cpus;
+		for (auto it = node_it->begin(); it != node_it->end(); ++it)
+			if (allowed_set.count(*it))
+				cpus.push_back(*it);
+		if (!cpus.empty())
+			nodes.push_back(cpus);
+	}
+	if (nodes.empty())
+		nodes.push_back(allowed);
+}
+
+CPUTopology::CPUTopology(const std::vector<std::vector<int> >& nodes) {
+	for (auto it = nodes.begin(); it != nodes.end(); ++it)
+		if (!it->empty())
+			this->nodes.push_back(*it);
+}
+
+const std::vector<std::vector<int> >& CPUTopology::getNodes() const {
+	return nodes;
+}
+
+std::vector<WorkerPlacement> CPUTopology::placeWorkers(int workers) const {
+	std::vector<WorkerPlacement> placement;
+	if (nodes.empty())
+		return placement;
+	int64_t cpus = 0, cpus_before = 0;
+	for (auto it = nodes.begin(); it != nodes.end(); ++it)
+		cpus += it->size();
+	for (size_t node = 0; node < nodes.size(); node++) {
+		cpus_before += nodes[node].size();
+		// the workers up to this index (exclusively) are on this and the previous nodes
+		int end = workers * cpus_before / cpus;
+		for (int i = 0; (int) placement.size() < end; i++) {
+			WorkerPlacement worker;
+			worker.node = node;
+			worker.cpu = nodes[node][i % nodes[node].size()];
+			placement.push_back(worker);
+		}
+	}
+	return placement;
+}
+
+std::vector<int> parseCPUList(const std::string& list) {
+	std::vector<int> cpus;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+		if (range.empty())
+			continue;
+		size_t dash = range.find('-');
+		std::string first = range.substr(0, dash);
+		std::string last = dash == std::string::npos ? first : range.substr(dash + 1);
+		if (first.empty() || last.empty()
+				|| first.find_first_not_of("0123456789") != std::string::npos
+				|| last.find_first_not_of("0123456789") != std::string::npos)
+			return std::vector<int>();
+		int from = std::atoi(first.c_str()), to = std::atoi(last.c_str());
+		if (from > to)
+			return std::vector<int>();
+		for (int cpu = from; cpu <= to; cpu++)
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+bool pinThread(int cpu) {
+#ifdef __linux__
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+} /* namespace thread */
+} /* namespace mapcrafter */
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AFFINITY_H_
+#define AFFINITY_H_
+
+#include <string>
+#include <vector>
+
+namespace mapcrafter {
+namespace thread {
+
+/**
+ * The NUMA node and the CPU a worker is pinned to.
+ */
+struct WorkerPlacement {
+	int node, cpu;
+};
+
+/**
+ * The CPUs of the NUMA nodes of this machine which this process may run on. The nodes
+ * are read from /sys/devices/system/node on Linux, without this information all CPUs
+ * are one node.
+ */
+class CPUTopology {
+public:
+	/**
+	 * Detects the topology of this machine.
+	 */
+	CPUTopology();
+
+	/**
+	 * Uses the given CPUs of each node, nodes without CPUs are ignored.
+	 */
+	CPUTopology(const std::vector<std::vector<int> >& nodes);
+
+	/**
+	 * Returns the CPUs of each node.
+	 */
+	const std::vector<std::vector<int> >& getNodes() const;
+
+	/**
+	 * Distributes a count of workers over the CPUs. Every node gets a contiguous range
+	 * of the workers with about as many workers as it has CPUs (relative to the other
+	 * nodes), and the workers of a node get its CPUs one after another.
+	 */
+	std::vector<WorkerPlacement> placeWorkers(int workers) const;
+
+private:
+	std::vector<std::vector<int> > nodes;
+};
+
+/**
+ * Parses a list of CPUs in the format of the Linux kernel (for example "0-3,8,10-11").
+ * Returns an empty list if the format is invalid.
+ */
+std::vector<int> parseCPUList(const std::string& list);
+
+/**
+ * Pins the calling thread to a CPU. Returns false if this is not possible or not
+ * supported on this system.
+ */
+bool pinThread(int cpu);
+
+} /* namespace thread */
+} /* namespace mapcrafter */
+
+#endif /* AFFINITY_H_ */
@@ -22,29 +22,123 @@
 
 #include "../../compat/thread.h"
 
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 
 namespace mapcrafter {
 namespace thread {
 
+/**
+ * A bounded queue for multiple producers and multiple consumers. Pushing and popping
+ * items is lock-free: every slot of the ring buffer has a sequence number which says
+ * whether it is free for the producer or filled for the consumer of a specific position
+ * (like in Dmitry Vyukov's bounded MPMC queue). Only producers which wait because the
+ * queue is full and consumers which wait because it is empty use a mutex, and the
+ * other side only takes it to wake them up if somebody is waiting. Because the queue is
+ * bounded, producers can't get too far ahead of the consumers.
+ */
 template <typename T>
 class ConcurrentQueue {
 public:
-	ConcurrentQueue();
+	/**
+	 * Creates a queue for at least the specified count of items, the capacity is rounded
+	 * up to a power of two.
+	 */
+	ConcurrentQueue(size_t capacity);
 	~ConcurrentQueue();
 
-	bool empty();
-	void push(T item);
-	T pop();
+	/**
+	 * Returns how many items can be queued at most.
+	 */
+	size_t getCapacity() const;
+
+	/**
+	 * Returns whether the queue is empty, this may be outdated when it returns.
+	 */
+	bool empty() const;
+
+	/**
+	 * Puts an item into the queue if it is not full. Returns false if it is full.
+	 */
+	bool tryPush(const T& item);
+
+	/**
+	 * Takes the next item out of the queue if it is not empty. Returns false if it is
+	 * empty.
+	 */
+	bool tryPop(T& item);
+
+	/**
+	 * Puts an item into the queue, waits while the queue is full. Returns false (and
+	 * drops the item) if the queue was closed.
+	 */
+	bool push(const T& item);
+
+	/**
+	 * Takes the next item out of the queue, waits while the queue is empty. Returns false
+	 * if the queue is empty and closed.
+	 */
+	bool pop(T& item);
+
+	/**
+	 * Like pop, but waits at most the specified count of milliseconds for an item.
+	 */
+	bool pop(T& item, int timeout);
+
+	/**
+	 * Closes the queue, waiting and future push-calls return false, the remaining items
+	 * can still be popped.
+	 */
+	void close();
 
 private:
-	std::queue<T> queue;
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	/**
+	 * Push and pop without waking up anybody.
+	 */
+	bool tryPushItem(const T& item);
+	bool tryPopItem(T& item);
+
+	/**
+	 * Wakes up the producers or consumers waiting on a condition variable if there
+	 * are any.
+	 */
+	void notify(std::atomic<int>& waiting, thread_ns::condition_variable& condition);
+
+	size_t mask;
+	std::unique_ptr<Slot[]> slots;
+
+	// the positions of the next push and pop, each on their own cache line
+	char padding1[64];
+	std::atomic<size_t> push_position;
+	char padding2[64];
+	std::atomic<size_t> pop_position;
+	char padding3[64];
+
+	std::atomic<bool> closed;
+	std::atomic<int> waiting_producers, waiting_consumers;
 	thread_ns::mutex mutex;
-	thread_ns::condition_variable condition_variable;
+	thread_ns::condition_variable condition_not_full, condition_not_empty;
 };
 
 template <typename T>
-ConcurrentQueue<T>::ConcurrentQueue() {
+ConcurrentQueue<T>::ConcurrentQueue(size_t capacity)
+	: push_position(0), pop_position(0), closed(false), waiting_producers(0),
+	  waiting_consumers(0) {
+	size_t size = 2;
+	while (size < capacity)
+		size *= 2;
+	mask = size - 1;
+	slots.reset(new Slot[size]);
+	for (size_t i = 0; i < size; i++)
+		slots[i].sequence.store(i, std::memory_order_relaxed);
 }
 
 template <typename T>
@@ -52,30 +146,162 @@ ConcurrentQueue<T>::~ConcurrentQueue() {
 }
 
 template <typename T>
-bool ConcurrentQueue<T>::empty() {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	return queue.empty();
+size_t ConcurrentQueue<T>::getCapacity() const {
+	return mask + 1;
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::empty() const {
+	size_t position = pop_position.load(std::memory_order_relaxed);
+	const Slot& slot = slots[position & mask];
+	return slot.sequence.load(std::memory_order_acquire) != position + 1;
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::tryPush(const T& item) {
+	if (!tryPushItem(item))
+		return false;
+	notify(waiting_consumers, condition_not_empty);
+	return true;
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::tryPop(T& item) {
+	if (!tryPopItem(item))
+		return false;
+	notify(waiting_producers, condition_not_full);
+	return true;
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::push(const T& item) {
+	if (closed)
+		return false;
+	if (tryPush(item))
+		return true;
+	// the waiting count is increased before checking again, so a consumer which frees a
+	// slot either is seen here or sees the waiting producer and wakes it up
+	bool pushed;
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		waiting_producers++;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while (!(pushed = tryPushItem(item)) && !closed)
+			condition_not_full.wait(lock);
+		waiting_producers--;
+	}
+	if (pushed)
+		notify(waiting_consumers, condition_not_empty);
+	return pushed;
 }
 
 template <typename T>
-void ConcurrentQueue<T>::push(T item) {
+bool ConcurrentQueue<T>::pop(T& item) {
+	if (tryPop(item))
+		return true;
+	bool popped;
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		waiting_consumers++;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while (!(popped = tryPopItem(item)) && !closed)
+			condition_not_empty.wait(lock);
+		waiting_consumers--;
+	}
+	if (popped)
+		notify(waiting_producers, condition_not_full);
+	return popped;
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::pop(T& item, int timeout) {
+	if (tryPop(item))
+		return true;
+	auto end = thread_ns::chrono::steady_clock::now()
+			+ thread_ns::chrono::milliseconds(timeout);
+	bool popped;
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		waiting_consumers++;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while (!(popped = tryPopItem(item)) && !closed
+				&& thread_ns::chrono::steady_clock::now() < end)
+			condition_not_empty.wait_until(lock, end);
+		waiting_consumers--;
+	}
+	if (popped)
+		notify(waiting_producers, condition_not_full);
+	return popped;
+}
+
+template <typename T>
+void ConcurrentQueue<T>::close() {
 	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	if (queue.empty()) {
-		queue.push(item);
-		condition_variable.notify_one();
-	} else {
-		queue.push(item);
+	closed = true;
+	condition_not_full.notify_all();
+	condition_not_empty.notify_all();
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::tryPushItem(const T& item) {
+	size_t position = push_position.load(std::memory_order_relaxed);
+	while (true) {
+		Slot& slot = slots[position & mask];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+		if (difference == 0) {
+			// the slot is free, try to claim the position
+			if (push_position.compare_exchange_weak(position, position + 1,
+					std::memory_order_relaxed)) {
+				slot.item = item;
+				slot.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (difference < 0) {
+			// the slot still has the item of the previous round, the queue is full
+			return false;
+		} else {
+			// another producer claimed the position
+			position = push_position.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template <typename T>
+bool ConcurrentQueue<T>::tryPopItem(T& item) {
+	size_t position = pop_position.load(std::memory_order_relaxed);
+	while (true) {
+		Slot& slot = slots[position & mask];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+		if (difference == 0) {
+			// the slot is filled, try to claim the position
+			if (pop_position.compare_exchange_weak(position, position + 1,
+					std::memory_order_relaxed)) {
+				item = slot.item;
+				// the slot is free for the producer of the next round
+				slot.sequence.store(position + mask + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (difference < 0) {
+			// the slot isn't filled yet, the queue is empty
+			return false;
+		} else {
+			// another consumer claimed the position
+			position = pop_position.load(std::memory_order_relaxed);
+		}
 	}
 }
 
 template <typename T>
-T ConcurrentQueue<T>::pop() {
+void ConcurrentQueue<T>::notify(std::atomic<int>& waiting,
+		thread_ns::condition_variable& condition) {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiting.load(std::memory_order_relaxed) == 0)
+		return;
+	// the waiting thread holds the mutex until it waits, so it can't miss this
 	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	while (queue.empty())
-		condition_variable.wait(lock);
-	T item = queue.front();
-	queue.pop();
-	return item;
+	condition.notify_all();
 }
 
 } /* namespace thread */
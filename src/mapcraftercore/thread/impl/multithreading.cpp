@@ -19,78 +19,231 @@
 
 #include "multithreading.h"
 
+#include "affinity.h"
 #include "../../mc/worldcache.h"
+#include "../../renderer/tilecostindex.h"
+#include "../../renderer/tileimagestore.h"
 #include "../../renderer/tileset.h"
 #include "../../util.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <ctime>
+#include <set>
+#include <unordered_map>
 
 namespace mapcrafter {
 namespace thread {
 
-ThreadManager::ThreadManager()
-	: finished(false) {
+namespace {
+
+// the render tiles are split into about that many jobs per thread, so the threads
+// finish at about the same time, but a job contains at most as many render tiles
+// as a composite tile two zoom levels above the render tiles
+const int JOBS_PER_THREAD = 8;
+const int MAX_JOB_SIZE = 16;
+
+// milliseconds between the updates of the progress of the threads
+const int PROGRESS_INTERVAL = 200;
+
+// memory for the images of the rendered tiles which the composite tiles of the next
+// zoom level use instead of reading them from disk
+const size_t TILE_IMAGES_MEMORY = 256 * 1024 * 1024;
+
+// the maximum count of threads rendering the parts of one render tile together
+const int MAX_TILE_THREADS = 8;
+
+/**
+ * Sets the expected costs of the required render tiles of the tile set of the maps from
+ * the render times of their last rendering: The cost of a tile is its render time
+ * relative to the average render time of the map, summed up over the maps (1 for the
+ * maps without the render time of the tile) and divided by the count of maps. Returns
+ * false if there are no render times, every render tile costs 1 then.
+ */
+bool setRenderTileCosts(const std::vector<renderer::RenderContext>& contexts) {
+	renderer::TileSet* tile_set = contexts[0].tile_set;
+	std::unordered_map<renderer::TilePos, double, renderer::tile_pos_hash_function> costs;
+	const std::set<renderer::TilePos>& tiles = tile_set->getRequiredRenderTiles();
+	bool known = false;
+	for (auto context_it = contexts.begin(); context_it != contexts.end(); ++context_it) {
+		double average = context_it->tile_costs ? context_it->tile_costs->getAverage() : 0;
+		for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+			uint32_t cost;
+			if (average > 0 && context_it->tile_costs->find(*it, cost)) {
+				costs[*it] += cost / average;
+				known = true;
+			} else
+				costs[*it] += 1;
+		}
+	}
+	if (!known) {
+		costs.clear();
+	} else {
+		for (auto it = costs.begin(); it != costs.end(); ++it)
+			it->second /= contexts.size();
+	}
+	tile_set->setRenderTileCosts(costs);
+	return known;
+}
+
+}
+
+ThreadManager::Worker::Worker(ThreadManager& manager, int worker)
+	: manager(manager), worker(worker) {
+}
+
+ThreadManager::Worker::~Worker() {
+}
+
+bool ThreadManager::Worker::getWork(renderer::RenderWork& work) {
+	return manager.getWork(worker, work);
+}
+
+void ThreadManager::Worker::workFinished(const renderer::RenderWork& work,
+		const renderer::RenderWorkResult& result) {
+	manager.workFinished(worker, result);
+}
+
+ThreadManager::ThreadManager(int workers)
+	: work_queue(workers), result_queue(workers * RESULTS_PER_WORKER), next_worker(0),
+	  composite_tile_set(nullptr), work_pending(0), finished(false), work_wait_time(0),
+	  result_wait_time(0) {
+	for (int i = 0; i < workers; i++)
+		this->workers.push_back(std::unique_ptr<Worker>(new Worker(*this, i)));
 }
 
 ThreadManager::~ThreadManager() {
 }
 
 void ThreadManager::addWork(const renderer::RenderWork& work) {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	work_queue.push(work);
+	addWork(work, next_worker);
+	next_worker = (next_worker + 1) % work_queue.getWorkerCount();
 }
 
-void ThreadManager::addExtraWork(const renderer::RenderWork& work) {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	work_extra_queue.push(work);
-	condition_wait_jobs.notify_one();
+void ThreadManager::addWork(const renderer::RenderWork& work, int worker) {
+	work_pending++;
+	work_queue.push(worker, work);
+	util::Profiler::addGauge(util::Gauge::QUEUED_WORK, 1);
+}
+
+void ThreadManager::addExtraWork(const renderer::RenderWork& work, int worker) {
+	work_pending++;
+	work_queue.pushFront(worker, work);
+	util::Profiler::addGauge(util::Gauge::QUEUED_WORK, 1);
+}
+
+size_t ThreadManager::cancelRenderWork() {
+	size_t removed = work_queue.removeIf([](const renderer::RenderWork& work) {
+		return work.tiles_skip.empty();
+	});
+	util::Profiler::addGauge(util::Gauge::QUEUED_WORK, -(int64_t) removed);
+	if (removed > 0 && (work_pending -= removed) == 0)
+		setFinished();
+	return removed;
+}
+
+void ThreadManager::setCompositeTiles(const renderer::TileSet* tile_set) {
+	composite_tile_set = tile_set;
+	pending_children.clear();
+	const std::set<renderer::TilePath>& tiles = tile_set->getRequiredCompositeTiles();
+	for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+		int required = 0;
+		for (int i = 1; i <= 4; i++)
+			required += tile_set->isTileRequired(*it + i);
+		pending_children[*it] = required;
+	}
 }
 
 void ThreadManager::setFinished() {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	this->finished = true;
-	condition_wait_jobs.notify_all();
-	condition_wait_results.notify_all();
+	work_queue.close();
+	finished = true;
+	result_queue.close();
 }
 
-bool ThreadManager::getWork(renderer::RenderWork& work) {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	while (!finished && (work_queue.empty() && work_extra_queue.empty()))
-		condition_wait_jobs.wait(lock);
-	if (finished)
-		return false;
-	if (!work_extra_queue.empty())
-		work = work_extra_queue.pop();
-	else if (!work_queue.empty())
-		work = work_queue.pop();
-	return true;
+bool ThreadManager::getWork(int worker, renderer::RenderWork& work) {
+	util::TraceScope trace("wait for work");
+	auto start = std::chrono::steady_clock::now();
+	bool has_work = work_queue.pop(worker, work);
+	work_wait_time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	if (has_work)
+		util::Profiler::addGauge(util::Gauge::QUEUED_WORK, -1);
+	return has_work;
 }
 
-void ThreadManager::workFinished(const renderer::RenderWork& work,
-		const renderer::RenderWorkResult& result) {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	if (!result_queue.empty())
-		result_queue.push(result);
-	else {
-		result_queue.push(result);
-		condition_wait_results.notify_one();
+void ThreadManager::workFinished(int worker, const renderer::RenderWorkResult& result) {
+	// the worker which finished the last required child tile of a composite tile renders
+	// the composite tile as well, so the work of a subtree mostly stays with one worker
+	const std::set<renderer::TilePath>& tiles = result.render_work.tiles;
+	for (auto it = tiles.begin(); composite_tile_set != nullptr && it != tiles.end(); ++it) {
+		if (*it == renderer::TilePath())
+			continue;
+		renderer::TilePath parent = it->parent();
+		auto children = pending_children.find(parent);
+		if (children == pending_children.end() || --children->second != 0)
+			continue;
+		renderer::RenderWork work;
+		work.tiles.insert(parent);
+		for (int i = 1; i <= 4; i++)
+			if (composite_tile_set->hasTile(parent + i))
+				work.tiles_skip.insert(parent + i);
+		addExtraWork(work, worker);
 	}
+
+	// waits if the results are not processed fast enough, the results are dropped
+	// when the work is finished
+	result_queue.push(std::make_pair(result, worker));
+	if (--work_pending == 0)
+		setFinished();
 }
 
-bool ThreadManager::getResult(renderer::RenderWorkResult& result) {
-	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
-	while (!finished && result_queue.empty())
-		condition_wait_results.wait(lock);
+bool ThreadManager::getResult(renderer::RenderWorkResult& result, int& worker,
+		int timeout) {
 	if (finished)
 		return false;
-	result = result_queue.pop();
+	auto start = std::chrono::steady_clock::now();
+	std::pair<renderer::RenderWorkResult, int> next;
+	bool has_result = result_queue.pop(next, timeout);
+	result_wait_time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	if (!has_result || finished)
+		return false;
+	result = next.first;
+	worker = next.second;
 	return true;
 }
 
+bool ThreadManager::isFinished() {
+	return finished;
+}
+
+double ThreadManager::getWorkWaitTime() const {
+	return work_wait_time / 1e9;
+}
+
+double ThreadManager::getResultWaitTime() const {
+	return result_wait_time / 1e9;
+}
+
+size_t ThreadManager::getPendingWork() const {
+	return work_pending;
+}
+
+WorkerManager<renderer::RenderWork, renderer::RenderWorkResult>& ThreadManager::getWorkerManager(
+		int worker) {
+	return *workers[worker];
+}
+
 ThreadWorker::ThreadWorker(WorkerManager<renderer::RenderWork, renderer::RenderWorkResult>& manager,
-		const renderer::RenderContext& context)
-	: manager(manager), render_context(context) {
-	render_worker.setRenderContext(context);
+		const std::vector<renderer::RenderContext>& contexts,
+		util::AtomicProgressHandler* progress, renderer::RenderThreadStatus* status)
+	: manager(manager), render_workers(contexts.size()), progress(progress) {
+	for (size_t i = 0; i < contexts.size(); i++) {
+		render_workers[i].setRenderContext(contexts[i]);
+		render_workers[i].setThreadStatus(status);
+	}
 }
 
 ThreadWorker::~ThreadWorker() {
@@ -100,77 +253,352 @@ void ThreadWorker::operator()() {
 	renderer::RenderWork work;
 
 	while (manager.getWork(work)) {
-		render_worker.setRenderWork(work);
-		render_worker();
+		auto start = std::chrono::steady_clock::now();
+		util::TraceScope trace("work unit");
+		if (trace.isActive()) {
+			std::string tiles;
+			for (auto it = work.tiles.begin(); it != work.tiles.end(); ++it)
+				tiles += (tiles.empty() ? "" : " ") + it->toString();
+			trace.setDetail(tiles);
+		}
+		renderer::RenderWorkResult result;
+		for (size_t i = 0; i < render_workers.size(); i++) {
+			// the skipped tiles of composite tiles were already counted by the work
+			// which rendered them
+			render_workers[i].setProgressHandler(work.tiles_skip.empty() ? progress : nullptr);
+			render_workers[i].setRenderWork(work);
+			render_workers[i]();
+			if (i == 0)
+				result = render_workers[i].getRenderWorkResult();
+			else
+				result.tiles_rendered += render_workers[i].getRenderWorkResult().tiles_rendered;
+		}
 
-		manager.workFinished(work, render_worker.getRenderWorkResult());
+		util::Profiler::addMetric(util::Metric::BUSY_TIME,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count());
+		manager.workFinished(work, result);
 	}
 }
 
-MultiThreadingDispatcher::MultiThreadingDispatcher(int threads)
-	: thread_count(threads) {
+MultiThreadingDispatcher::MultiThreadingDispatcher(int threads, ThreadPool* thread_pool)
+	: thread_count(threads), thread_pool(thread_pool), manager(threads) {
 }
 
 MultiThreadingDispatcher::~MultiThreadingDispatcher() {
 }
 
-void MultiThreadingDispatcher::dispatch(const renderer::RenderContext& context,
+void MultiThreadingDispatcher::dispatch(const std::vector<renderer::RenderContext>& contexts,
 		util::IProgressHandler* progress) {
+	util::TraceScope trace("dispatch");
+	region_cache_stats.assign(contexts.size(), mc::CacheStats());
+	chunk_cache_stats.assign(contexts.size(), mc::CacheStats());
+	if (contexts.empty())
+		return;
+	// the maps use the same tile set
+	const renderer::RenderContext& context = contexts[0];
 	auto tiles = context.tile_set->getRequiredCompositeTiles();
 	if (tiles.size() == 0)
 		return;
 
-	int jobs = 0;
-	for (auto tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it)
-		if (tile_it->getDepth() == context.tile_set->getDepth() - 2) {
-			renderer::RenderWork work;
-			work.tiles.insert(*tile_it);
-			manager.addWork(work);
-			jobs++;
+	int render_tiles = 0;
+	size_t work_count = 0;
+	if (render_work.empty()) {
+		// with the render times of the last rendering, the jobs have about the same
+		// expected render time instead of the same count of render tiles (the tiles of
+		// dense cities take a lot longer than the ones of the ocean), and the threads
+		// get ranges of jobs with about the same expected render time
+		bool costs = setRenderTileCosts(contexts);
+		double total_cost = context.tile_set->getContainingCost(renderer::TilePath());
+		if (costs)
+			LOG(DEBUG) << "Scheduling the render tiles with their render times of the "
+					<< "last rendering.";
+
+		// the jobs are small compared to the work of a thread, so there are no big jobs
+		// left at the end
+		double job_size = context.tile_set->getRequiredRenderTilesCount()
+				/ (thread_count * JOBS_PER_THREAD);
+		if (costs)
+			job_size = total_cost / (thread_count * JOBS_PER_THREAD);
+		job_size = std::max(1.0, std::min<double>(MAX_JOB_SIZE, job_size));
+
+		// the composite tiles are added by the workers as soon as their children are
+		// rendered
+		manager.setCompositeTiles(context.tile_set);
+
+		// the tiles with the points of interest of the maps are rendered first, and
+		// their composite tiles as soon as their children are rendered
+		std::vector<renderer::TilePos> priority_tiles;
+		for (auto it = contexts.begin(); it != contexts.end(); ++it) {
+			const std::vector<mc::BlockPos>& points = it->map_config.getPriorityPoints();
+			for (auto point_it = points.begin(); point_it != points.end(); ++point_it) {
+				mc::ChunkPos chunk(*point_it);
+				chunk.rotate(context.world.getRotation());
+				std::set<renderer::TilePos> tiles;
+				context.tile_set->mapChunkToTiles(chunk, tiles);
+				for (auto tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it)
+					priority_tiles.push_back(*tile_it - context.tile_set->getTileOffset());
+			}
+		}
+		auto jobs = context.tile_set->partitionRequiredTiles(job_size, priority_tiles);
+		if (priority_tiles.empty() && jobs.size() >= (size_t) thread_count) {
+			// the order of the tile paths is a Z-order curve over the tiles, every
+			// worker gets a contiguous range of the jobs along it with about the same
+			// count of render tiles, so the chunks at the borders of the jobs are mostly
+			// needed by the same worker (or a neighbor, which steals from it first)
+			std::stable_sort(jobs.begin(), jobs.end(),
+					[](const std::set<renderer::TilePath>& job1,
+							const std::set<renderer::TilePath>& job2) {
+				return *job1.begin() < *job2.begin();
+			});
+			std::vector<std::vector<std::pair<double, size_t> > > bins(thread_count);
+			double done = 0;
+			for (size_t i = 0; i < jobs.size(); i++) {
+				double cost = 0;
+				for (auto it = jobs[i].begin(); it != jobs[i].end(); ++it)
+					cost += context.tile_set->getContainingCost(*it);
+				int worker = std::min<int64_t>(thread_count - 1,
+						done * thread_count / std::max(total_cost, 1.0));
+				bins[worker].push_back(std::make_pair(cost, i));
+				done += cost;
+			}
+			// with render times, every thread renders its most expensive jobs first,
+			// the other threads steal the cheap ones from the back when they're done
+			for (auto bin_it = bins.begin(); bin_it != bins.end(); ++bin_it) {
+				if (costs)
+					std::stable_sort(bin_it->begin(), bin_it->end(),
+							[](const std::pair<double, size_t>& job1,
+									const std::pair<double, size_t>& job2) {
+						return job1.first > job2.first;
+					});
+				for (auto it = bin_it->begin(); it != bin_it->end(); ++it) {
+					renderer::RenderWork work;
+					work.tiles = jobs[it->second];
+					manager.addWork(work, bin_it - bins.begin());
+					work_count++;
+				}
+			}
+		} else {
+			// the jobs are ordered by their distance to the priority tiles (or by their
+			// size), and with fewer jobs than threads every thread gets at most one
+			for (auto job_it = jobs.begin(); job_it != jobs.end(); ++job_it) {
+				renderer::RenderWork work;
+				work.tiles = *job_it;
+				manager.addWork(work);
+				work_count++;
+			}
 		}
+		render_tiles = context.tile_set->getRequiredRenderTilesCount();
+	}
+	for (auto work_it = render_work.begin(); work_it != render_work.end(); ++work_it) {
+		manager.addWork(*work_it);
+		work_count++;
+		for (auto it = work_it->tiles.begin(); it != work_it->tiles.end(); ++it)
+			render_tiles += context.tile_set->getContainingRenderTiles(*it);
+	}
 
-	//int render_tiles = context.tile_set->getRequiredRenderTilesCount();
 	//LOG(INFO) << thread_count << " threads will render " << render_tiles << " render tiles.";
 
+	// with fewer jobs than threads most of the threads would be idle, so the threads
+	// which get the jobs (the jobs are added to the threads one after another) render
+	// the parts of their render tiles with the idle threads
+	if (work_count == 0)
+		manager.setFinished();
+	int part_workers = std::min<int>(work_count, thread_count);
+	int tile_threads = 1;
+	if (part_workers > 0 && part_workers < thread_count)
+		tile_threads = std::min(MAX_TILE_THREADS, thread_count / part_workers);
+
+	// the caches are made smaller if they don't fit into the memory limit: the tile
+	// images get up to a quarter of it, the chunks of the shared cache and of the world
+	// caches of the threads half of the rest each (the chunks of the threads are mostly
+	// in the shared cache too, but they're kept while the threads use them)
+	size_t tile_images_memory = TILE_IMAGES_MEMORY;
+	size_t shared_chunks = 0, thread_chunks = 0;
+	if (memory_limit > 0) {
+		tile_images_memory = std::min(TILE_IMAGES_MEMORY, memory_limit / 4);
+		size_t chunks = getChunkBudget(tile_images_memory
+				+ getTileImagesMemory(contexts, thread_count));
+		shared_chunks = std::max(size_t(MIN_CHUNK_CACHE_SIZE), chunks / 2);
+		thread_chunks = std::max(size_t(MIN_CHUNK_CACHE_SIZE),
+				chunks / 2 / (thread_count * contexts.size()));
+		LOG(INFO) << "Using " << shared_chunks << " shared chunks, " << thread_chunks
+				<< " chunks per thread and " << tile_images_memory / (1024 * 1024)
+				<< " MiB of tile images to fit into the memory limit.";
+	}
+
+	// with pinned threads, the threads are spread over the NUMA nodes, and the ranges
+	// of the jobs of the threads of a node are next to each other
+	std::vector<WorkerPlacement> placement;
+	int nodes = 1;
+	if (pin_threads) {
+		CPUTopology topology;
+		placement = topology.placeWorkers(thread_count);
+		nodes = topology.getNodes().size();
+		LOG(DEBUG) << "Pinning " << thread_count << " threads to the CPUs of " << nodes
+				<< " NUMA node(s).";
+	}
+
+	// the threads (and maps) share one cache with the decoded chunks, so chunks needed
+	// by tiles of different threads and maps are loaded only once, with pinned threads
+	// every node has its own cache which holds the chunks in the memory of the node
+	std::vector<std::shared_ptr<mc::ChunkCache> > chunk_caches(nodes, context.chunk_cache);
+	for (int i = 0; i < nodes; i++) {
+		if (chunk_caches[i])
+			continue;
+		size_t node_chunks = shared_chunks / nodes;
+		if (node_chunks < MIN_CHUNK_CACHE_SIZE)
+			node_chunks = MIN_CHUNK_CACHE_SIZE;
+		if (shared_chunks > 0)
+			chunk_caches[i] = std::make_shared<mc::ChunkCache>(node_chunks);
+		else
+			chunk_caches[i] = std::make_shared<mc::ChunkCache>();
+	}
+	std::vector<renderer::RenderContext> shared_contexts = contexts;
+	for (auto it = shared_contexts.begin(); it != shared_contexts.end(); ++it) {
+		it->chunk_cache = chunk_caches[0];
+		if (thread_chunks > 0)
+			it->chunk_cache_size = std::min<size_t>(thread_chunks,
+					it->map_config.getChunkCacheSize());
+		// only tiles written losslessly can be used instead of the ones read from disk,
+		// and only if the composite tiles above the render work are rendered too
+		if (!it->tile_images && render_work.empty()
+				&& it->map_config.getImageFormat() == config::ImageFormat::PNG
+				&& !it->map_config.isPNGIndexed())
+			it->tile_images = std::make_shared<renderer::TileImageStore>(
+					tile_images_memory / contexts.size());
+	}
+	std::unique_ptr<ThreadPool> own_thread_pool;
+	ThreadPool* pool = thread_pool;
+	if (pool == nullptr) {
+		own_thread_pool.reset(new ThreadPool(thread_count));
+		pool = own_thread_pool.get();
+	}
+
+	// the threads set up their render contexts themselves, each one sets only its own
+	// world caches of the maps
+	std::vector<std::vector<std::shared_ptr<mc::WorldCache> > > world_caches(contexts.size(),
+			std::vector<std::shared_ptr<mc::WorldCache> >(thread_count));
+	int threads_running = thread_count;
+	thread_ns::mutex threads_mutex;
+	thread_ns::condition_variable threads_finished;
+	thread_status.clear();
 	for (int i = 0; i < thread_count; i++) {
-		renderer::RenderContext thread_context = context;
-		thread_context.initializeTileRenderer();
-		threads.push_back(thread_ns::thread(ThreadWorker(manager, thread_context)));
+		thread_progress.push_back(std::unique_ptr<util::AtomicProgressHandler>(
+				new util::AtomicProgressHandler));
+		thread_status.push_back(std::unique_ptr<renderer::RenderThreadStatus>(
+				new renderer::RenderThreadStatus));
+		util::AtomicProgressHandler* worker_progress = thread_progress.back().get();
+		renderer::RenderThreadStatus* worker_status = thread_status.back().get();
+		pool->run([&, i, worker_progress, worker_status]() {
+			// the thread is pinned before it sets up its caches, so their memory is
+			// allocated on its node
+			if (!placement.empty() && !pinThread(placement[i].cpu))
+				LOG(WARNING) << "Unable to pin a render thread to CPU " << placement[i].cpu
+						<< ".";
+			std::vector<renderer::RenderContext> thread_contexts = shared_contexts;
+			for (size_t j = 0; j < thread_contexts.size(); j++) {
+				if (i < part_workers)
+					thread_contexts[j].tile_threads = tile_threads;
+				if (!placement.empty())
+					thread_contexts[j].chunk_cache = chunk_caches[placement[i].node];
+				thread_contexts[j].initializeTileRenderer();
+				world_caches[j][i] = thread_contexts[j].world_cache;
+			}
+			ThreadWorker(manager.getWorkerManager(i), thread_contexts, worker_progress,
+					worker_status)();
+
+			thread_ns::unique_lock<thread_ns::mutex> lock(threads_mutex);
+			if (--threads_running == 0)
+				threads_finished.notify_all();
+		});
 	}
 
-	progress->setMax(context.tile_set->getRequiredRenderTilesCount());
+	// the threads count their progress themselves, it's only sampled here
+	auto updateProgress = [this, progress]() {
+		int rendered = 0;
+		for (size_t i = 0; i < thread_progress.size(); i++)
+			rendered += thread_progress[i]->getValue();
+		if (rendered != progress->getValue())
+			progress->setValue(rendered);
+	};
+
+	progress->setMax(render_tiles * contexts.size());
+	progress->setValue(0);
+	complete = true;
+
+	// the status reports show the progress, the queues and what every thread is doing
+	util::StatusSource status([&](std::ostream& out) {
+		int rendered = 0;
+		for (size_t i = 0; i < thread_progress.size(); i++)
+			rendered += thread_progress[i]->getValue();
+		reportProgress(out, contexts, rendered, render_tiles * contexts.size());
+		out << "Work: " << manager.getPendingWork() << " jobs pending, shared chunk cache "
+				<< chunk_caches[0]->size() << " of " << chunk_caches[0]->getCapacity()
+				<< " chunks" << std::endl;
+		for (size_t i = 0; i < thread_status.size(); i++)
+			thread_status[i]->report(out, "Thread " + util::str(i + 1));
+	});
+	// the workers add the composite tiles and finish the work themselves, the results
+	// only wake this thread up to sample the progress
 	renderer::RenderWorkResult result;
-	while (manager.getResult(result)) {
-		progress->setValue(progress->getValue() + result.tiles_rendered);
-		for (auto tile_it = result.render_work.tiles.begin();
-				tile_it != result.render_work.tiles.end(); ++tile_it) {
-			rendered_tiles.insert(*tile_it);
-			if (*tile_it == renderer::TilePath()) {
-				manager.setFinished();
-				continue;
-			}
+	int worker;
+	while (!manager.isFinished()) {
+		{
+			util::TraceScope trace_wait("wait for results");
+			manager.getResult(result, worker, PROGRESS_INTERVAL);
+		}
+		updateProgress();
 
-			renderer::TilePath parent = tile_it->parent();
-			bool childs_rendered = true;
-			for (int i = 1; i <= 4; i++)
-				if (context.tile_set->isTileRequired(parent + i)
-						&& !rendered_tiles.count(parent + i)) {
-					childs_rendered = false;
-				}
+		// render tiles which take too long are reported while they are still rendered,
+		// in case they never finish
+		if (contexts[0].slow_tiles) {
+			std::string map, tile;
+			double seconds;
+			for (size_t i = 0; i < thread_status.size(); i++)
+				if (thread_status[i]->checkSlowTile(contexts[0].slow_tiles->getThreshold(),
+						map, tile, seconds))
+					LOG(WARNING) << "Thread " << i + 1 << " is rendering tile " << tile
+							<< " of map " << map << " for "
+							<< util::str(std::floor(seconds * 100) / 100) << "s.";
+		}
 
-			if (childs_rendered) {
-				renderer::RenderWork work;
-				work.tiles.insert(parent);
-				for (int i = 1; i <= 4; i++)
-					if (context.tile_set->hasTile(parent + i))
-						work.tiles_skip.insert(parent + i);
-				manager.addExtraWork(work);
-			}
+		// no new render work is started after the stop time, only the composite tiles
+		// of the already rendered tiles are rendered, everything is finished when the
+		// work which is left is done
+		if (complete && stop_time != 0 && std::time(nullptr) >= stop_time) {
+			complete = false;
+			manager.cancelRenderWork();
+			LOG(INFO) << "The time limit is reached, finishing the tiles being rendered.";
+		} else if (complete && stop_flag != nullptr && *stop_flag) {
+			complete = false;
+			manager.cancelRenderWork();
+			LOG(INFO) << "The rendering is stopped, finishing the tiles being rendered.";
 		}
 	}
 
-	for (int i = 0; i < thread_count; i++)
-		threads[i].join();
+	{
+		util::TraceScope trace_wait("wait for threads");
+		thread_ns::unique_lock<thread_ns::mutex> lock(threads_mutex);
+		while (threads_running > 0)
+			threads_finished.wait(lock);
+	}
+	updateProgress();
+
+	// merge the cache statistics of the threads
+	for (size_t i = 0; i < world_caches.size(); i++)
+		for (size_t j = 0; j < world_caches[i].size(); j++) {
+			region_cache_stats[i] += world_caches[i][j]->getRegionCacheStats();
+			chunk_cache_stats[i] += world_caches[i][j]->getChunkCacheStats();
+		}
+}
+
+double MultiThreadingDispatcher::getWorkWaitTime() const {
+	return manager.getWorkWaitTime();
+}
+
+double MultiThreadingDispatcher::getResultWaitTime() const {
+	return manager.getResultWaitTime();
 }
 
 } /* namespace thread */
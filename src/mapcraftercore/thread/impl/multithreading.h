@@ -21,68 +21,189 @@
 #define MULTITHREADING_H_
 
 #include "concurrentqueue.h"
+#include "threadpool.h"
+#include "workstealingqueue.h"
 #include "../dispatcher.h"
 #include "../workermanager.h"
 #include "../../compat/thread.h"
 #include "../../renderer/tilerenderworker.h"
+#include "../../util/progress.h"
 
-#include <set>
+#include <atomic>
+#include <map>
+#include <memory>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace mapcrafter {
 namespace thread {
 
-class ThreadManager : public WorkerManager<renderer::RenderWork, renderer::RenderWorkResult> {
+/**
+ * Distributes the render work to a fixed count of workers. Every worker has its own
+ * queue of work and takes work of other workers only if its own queue is empty.
+ */
+class ThreadManager {
 public:
-	ThreadManager();
-	virtual ~ThreadManager();
+	ThreadManager(int workers);
+	~ThreadManager();
 
+	/**
+	 * Adds work, the work is distributed evenly over the workers.
+	 */
 	void addWork(const renderer::RenderWork& work);
-	void addExtraWork(const renderer::RenderWork& work);
+
+	/**
+	 * Adds work to the queue of a specific worker.
+	 */
+	void addWork(const renderer::RenderWork& work, int worker);
+
+	/**
+	 * Adds work which a specific worker should do next (for example the composite tile
+	 * of tiles the worker rendered).
+	 */
+	void addExtraWork(const renderer::RenderWork& work, int worker);
+
+	/**
+	 * Makes the workers add the work of the composite tiles of a tile set themselves:
+	 * The worker which finishes the last required child tile of a composite tile adds
+	 * the composite tile as extra work for itself. Call this before adding work.
+	 */
+	void setCompositeTiles(const renderer::TileSet* tile_set);
+
+	/**
+	 * Removes the queued work which is not the work of composite tiles (which only put
+	 * together their rendered child tiles). Returns the count of removed work.
+	 */
+	size_t cancelRenderWork();
+
+	/**
+	 * Finishes the work, this happens by itself when all added work is finished.
+	 */
 	void setFinished();
 
-	virtual bool getWork(renderer::RenderWork& work);
-	virtual void workFinished(const renderer::RenderWork& work, const renderer::RenderWorkResult& result);
+	bool getWork(int worker, renderer::RenderWork& work);
+	void workFinished(int worker, const renderer::RenderWorkResult& result);
+
+	/**
+	 * Returns the next result and which worker did the work. Waits at most the
+	 * specified count of milliseconds for a result, returns false if there is none
+	 * then or if the work is finished.
+	 */
+	bool getResult(renderer::RenderWorkResult& result, int& worker, int timeout);
+
+	/**
+	 * Returns whether the work is finished.
+	 */
+	bool isFinished();
+
+	/**
+	 * Returns how many seconds the workers waited in getWork altogether, and how many
+	 * seconds getResult waited for results.
+	 */
+	double getWorkWaitTime() const;
+	double getResultWaitTime() const;
+
+	/**
+	 * Returns the count of work added and not finished yet, the queued work and the work
+	 * the workers are doing.
+	 */
+	size_t getPendingWork() const;
+
+	/**
+	 * Returns the manager of the work of a specific worker.
+	 */
+	WorkerManager<renderer::RenderWork, renderer::RenderWorkResult>& getWorkerManager(int worker);
 
-	bool getResult(renderer::RenderWorkResult& result);
 private:
-	ConcurrentQueue<renderer::RenderWork> work_queue, work_extra_queue;
-	ConcurrentQueue<renderer::RenderWorkResult> result_queue;
-
-	bool finished;
-	thread_ns::mutex mutex;
-	thread_ns::condition_variable condition_wait_jobs, condition_wait_results;
+	/**
+	 * The manager of a single worker, which gets the work of this worker.
+	 */
+	class Worker : public WorkerManager<renderer::RenderWork, renderer::RenderWorkResult> {
+	public:
+		Worker(ThreadManager& manager, int worker);
+		virtual ~Worker();
+
+		virtual bool getWork(renderer::RenderWork& work);
+		virtual void workFinished(const renderer::RenderWork& work,
+				const renderer::RenderWorkResult& result);
+
+	private:
+		ThreadManager& manager;
+		int worker;
+	};
+
+	// the results which can be queued per worker before the workers wait for them to
+	// be processed
+	static const int RESULTS_PER_WORKER = 16;
+
+	WorkStealingQueue<renderer::RenderWork> work_queue;
+	ConcurrentQueue<std::pair<renderer::RenderWorkResult, int> > result_queue;
+	std::vector<std::unique_ptr<Worker> > workers;
+	int next_worker;
+
+	// the tile set of the composite tiles the workers add, and the counts of the
+	// required child tiles of its composite tiles which are not finished yet
+	const renderer::TileSet* composite_tile_set;
+	std::map<renderer::TilePath, std::atomic<int> > pending_children;
+
+	// the count of work added and not finished yet
+	std::atomic<size_t> work_pending;
+	std::atomic<bool> finished;
+
+	// the nanoseconds waited in getWork/getResult
+	std::atomic<uint64_t> work_wait_time, result_wait_time;
 };
 
+/**
+ * Renders the work of a worker, every work for each of the maps. The rendered render
+ * tiles are counted with a progress handler which only this worker changes.
+ */
 class ThreadWorker {
 public:
 	ThreadWorker(WorkerManager<renderer::RenderWork, renderer::RenderWorkResult>& manager,
-			const renderer::RenderContext& context);
+			const std::vector<renderer::RenderContext>& contexts,
+			util::AtomicProgressHandler* progress,
+			renderer::RenderThreadStatus* status = nullptr);
 	~ThreadWorker();
 
 	void operator()();
 private:
 	WorkerManager<renderer::RenderWork, renderer::RenderWorkResult>& manager;
 
-	renderer::RenderContext render_context;
-	renderer::TileRenderWorker render_worker;
+	std::vector<renderer::TileRenderWorker> render_workers;
+	util::AtomicProgressHandler* progress;
 };
 
+/**
+ * Renders the work with a count of threads of a thread pool. The thread pool is used for
+ * multiple dispatches; without one, the dispatcher starts its own threads.
+ */
 class MultiThreadingDispatcher : public Dispatcher {
 public:
-	MultiThreadingDispatcher(int threads);
+	MultiThreadingDispatcher(int threads, ThreadPool* thread_pool = nullptr);
 	virtual ~MultiThreadingDispatcher();
 
-	virtual void dispatch(const renderer::RenderContext& context,
+	using Dispatcher::dispatch;
+	virtual void dispatch(const std::vector<renderer::RenderContext>& contexts,
 			util::IProgressHandler* progress);
+
+	/**
+	 * Returns how many seconds the threads waited for work altogether, and how many
+	 * seconds the dispatching thread waited for the results of the threads.
+	 */
+	double getWorkWaitTime() const;
+	double getResultWaitTime() const;
+
 private:
 	int thread_count;
+	ThreadPool* thread_pool;
 
 	ThreadManager manager;
-	std::vector<thread_ns::thread> threads;
-
-	std::set<renderer::TilePath> rendered_tiles;
+	// the progress of the threads, sampled by the dispatching thread
+	std::vector<std::unique_ptr<util::AtomicProgressHandler> > thread_progress;
+	// what the threads are doing, for the status reports
+	std::vector<std::unique_ptr<renderer::RenderThreadStatus> > thread_status;
 };
 
 } /* namespace thread */
@@ -24,6 +24,8 @@
 #include "../../renderer/tileset.h"
 #include "../../util.h"
 
+#include <algorithm>
+#include <chrono>
 #include <set>
 
 namespace mapcrafter {
@@ -35,22 +37,71 @@ SingleThreadDispatcher::SingleThreadDispatcher() {
 SingleThreadDispatcher::~SingleThreadDispatcher() {
 }
 
-void SingleThreadDispatcher::dispatch(const renderer::RenderContext& context,
+void SingleThreadDispatcher::dispatch(const std::vector<renderer::RenderContext>& contexts,
 		util::IProgressHandler* progress) {
-	int render_tiles = context.tile_set->getRequiredRenderTilesCount();
-	if (render_tiles == 0)
+	region_cache_stats.assign(contexts.size(), mc::CacheStats());
+	chunk_cache_stats.assign(contexts.size(), mc::CacheStats());
+	if (contexts.empty())
+		return;
+	// the merge of the shards renders only composite tiles
+	int render_tiles = contexts[0].tile_set->getRequiredRenderTilesCount();
+	if (render_tiles == 0 && contexts[0].tile_set->getRequiredCompositeTilesCount() == 0)
 		return;
 
 	LOG(INFO) << "Single thread will render " << render_tiles << " render tiles.";
 
+	// the tiles of the render work don't contain each other, one worker can render all
 	renderer::RenderWork work;
-	work.tiles.insert(renderer::TilePath());
+	if (render_work.empty())
+		work.tiles.insert(renderer::TilePath());
+	for (auto it = render_work.begin(); it != render_work.end(); ++it) {
+		work.tiles.insert(it->tiles.begin(), it->tiles.end());
+		work.tiles_skip.insert(it->tiles_skip.begin(), it->tiles_skip.end());
+	}
+
+	int work_tiles = 0;
+	for (auto it = work.tiles.begin(); it != work.tiles.end(); ++it)
+		work_tiles += contexts[0].tile_set->getContainingRenderTiles(*it);
+	progress->setMax(work_tiles * contexts.size());
+	progress->setValue(0);
+
+	// the world caches are made smaller if they don't fit into the memory limit
+	size_t chunks = 0;
+	if (memory_limit > 0) {
+		chunks = std::max(size_t(MIN_CHUNK_CACHE_SIZE),
+				getChunkBudget(getTileImagesMemory(contexts, 1)) / contexts.size());
+		LOG(INFO) << "Using " << chunks << " chunks per map to fit into the memory limit.";
+	}
+
+	// the status reports show the progress and what the thread is doing
+	renderer::RenderThreadStatus thread_status;
+	util::StatusSource status([&](std::ostream& out) {
+		reportProgress(out, contexts, thread_status.getRenderedTiles(),
+				work_tiles * contexts.size());
+		thread_status.report(out, "Thread 1");
+	});
+
+	// a single thread renders one map after another
+	for (size_t i = 0; i < contexts.size(); i++) {
+		renderer::RenderContext context = contexts[i];
+		if (chunks > 0 && chunks < (size_t) context.map_config.getChunkCacheSize()) {
+			context.chunk_cache_size = chunks;
+			context.initializeTileRenderer();
+		}
+		renderer::TileRenderWorker worker;
+		worker.setRenderContext(context);
+		worker.setRenderWork(work);
+		worker.setProgressHandler(progress);
+		worker.setThreadStatus(&thread_status);
+		auto start = std::chrono::steady_clock::now();
+		worker();
+		util::Profiler::addMetric(util::Metric::BUSY_TIME,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count());
 
-	renderer::TileRenderWorker worker;
-	worker.setRenderContext(context);
-	worker.setRenderWork(work);
-	worker.setProgressHandler(progress);
-	worker();
+		region_cache_stats[i] = context.world_cache->getRegionCacheStats();
+		chunk_cache_stats[i] = context.world_cache->getChunkCacheStats();
+	}
 }
 
 } /* namespace thread */
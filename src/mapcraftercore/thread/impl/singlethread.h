@@ -30,7 +30,8 @@ public:
 	SingleThreadDispatcher();
 	virtual ~SingleThreadDispatcher();
 
-	virtual void dispatch(const renderer::RenderContext& context,
+	using Dispatcher::dispatch;
+	virtual void dispatch(const std::vector<renderer::RenderContext>& contexts,
 			util::IProgressHandler* progress);
 };
 
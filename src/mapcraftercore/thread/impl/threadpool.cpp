@@ -0,0 +1,72 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "threadpool.h"
+
+#include "../../util.h"
+
+namespace mapcrafter {
+namespace thread {
+
+ThreadPool::ThreadPool(int threads)
+	: stopped(false) {
+	for (int i = 0; i < threads; i++)
+		this->threads.push_back(thread_ns::thread(&ThreadPool::loop, this, i + 1));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		stopped = true;
+		condition.notify_all();
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+int ThreadPool::getThreadCount() const {
+	return threads.size();
+}
+
+void ThreadPool::run(const std::function<void()>& task) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	tasks.push_back(task);
+	condition.notify_one();
+}
+
+void ThreadPool::loop(int index) {
+	util::Profiler::setThreadName("render " + util::str(index));
+	while (true) {
+		std::function<void()> task;
+		{
+			thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+			// the remaining tasks are run before the threads stop
+			while (!stopped && tasks.empty())
+				condition.wait(lock);
+			if (tasks.empty())
+				return;
+			task.swap(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+} /* namespace thread */
+} /* namespace mapcrafter */
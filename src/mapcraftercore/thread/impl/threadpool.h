@@ -0,0 +1,71 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include "../../compat/thread.h"
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace mapcrafter {
+namespace thread {
+
+/**
+ * A fixed count of threads which run tasks, so the render threads are started only once
+ * and reused for all maps and rotations. The tasks are run in the order they're added
+ * by the next thread which is idle.
+ */
+class ThreadPool {
+public:
+	ThreadPool(int threads);
+
+	/**
+	 * Waits until all tasks are finished and stops the threads.
+	 */
+	~ThreadPool();
+
+	/**
+	 * Returns the count of threads.
+	 */
+	int getThreadCount() const;
+
+	/**
+	 * Adds a task, it's run by a thread of the pool as soon as one is idle.
+	 */
+	void run(const std::function<void()>& task);
+
+private:
+	void loop(int index);
+
+	std::deque<std::function<void()> > tasks;
+	bool stopped;
+
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable condition;
+	std::vector<thread_ns::thread> threads;
+};
+
+} /* namespace thread */
+} /* namespace mapcrafter */
+
+#endif /* THREADPOOL_H_ */
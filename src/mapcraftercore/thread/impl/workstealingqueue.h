@@ -0,0 +1,216 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKSTEALINGQUEUE_H_
+#define WORKSTEALINGQUEUE_H_
+
+#include "../../compat/thread.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mapcrafter {
+namespace thread {
+
+/**
+ * A queue of items which are processed by a fixed count of workers. Every worker has its
+ * own deque of items and takes its items from the front of it. A worker whose deque is
+ * empty takes (steals) an item from the back of the deque of another worker, so the
+ * workers only share a lock when they're waiting for new items. The workers steal from
+ * their neighbors first (the workers before and after them, then the ones two workers
+ * away and so on), so items which are close to each other can be given to neighboring
+ * workers.
+ */
+template <typename T>
+class WorkStealingQueue {
+public:
+	WorkStealingQueue(int workers);
+	~WorkStealingQueue();
+
+	/**
+	 * Returns the count of workers.
+	 */
+	int getWorkerCount() const;
+
+	/**
+	 * Puts an item at the back of the deque of a worker.
+	 */
+	void push(int worker, const T& item);
+
+	/**
+	 * Puts an item at the front of the deque of a worker, so the worker takes it next.
+	 */
+	void pushFront(int worker, const T& item);
+
+	/**
+	 * Takes the next item for a worker, waits until there is one. Returns false if the
+	 * queue was closed.
+	 */
+	bool pop(int worker, T& item);
+
+	/**
+	 * Removes the items of all deques for which the supplied function returns true.
+	 * Returns the count of removed items.
+	 */
+	size_t removeIf(const std::function<bool(const T&)>& remove);
+
+	/**
+	 * Closes the queue, waiting and future pop-calls return false.
+	 */
+	void close();
+
+private:
+	/**
+	 * Takes the next item of the own deque of a worker, or of the deque of another worker.
+	 */
+	bool tryPop(int worker, T& item);
+
+	/**
+	 * Wakes up a waiting worker after an item was put into a deque.
+	 */
+	void pushed();
+
+	struct WorkerDeque {
+		thread_ns::mutex mutex;
+		std::deque<T> items;
+	};
+	std::vector<std::unique_ptr<WorkerDeque> > deques;
+
+	// count of items in all deques
+	std::atomic<size_t> size;
+	bool closed;
+	thread_ns::mutex mutex;
+	thread_ns::condition_variable condition;
+};
+
+template <typename T>
+WorkStealingQueue<T>::WorkStealingQueue(int workers)
+	: size(0), closed(false) {
+	for (int i = 0; i < workers; i++)
+		deques.push_back(std::unique_ptr<WorkerDeque>(new WorkerDeque));
+}
+
+template <typename T>
+WorkStealingQueue<T>::~WorkStealingQueue() {
+}
+
+template <typename T>
+int WorkStealingQueue<T>::getWorkerCount() const {
+	return deques.size();
+}
+
+template <typename T>
+void WorkStealingQueue<T>::push(int worker, const T& item) {
+	WorkerDeque& deque = *deques[worker];
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(deque.mutex);
+		deque.items.push_back(item);
+		size++;
+	}
+	pushed();
+}
+
+template <typename T>
+void WorkStealingQueue<T>::pushFront(int worker, const T& item) {
+	WorkerDeque& deque = *deques[worker];
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(deque.mutex);
+		deque.items.push_front(item);
+		size++;
+	}
+	pushed();
+}
+
+template <typename T>
+bool WorkStealingQueue<T>::pop(int worker, T& item) {
+	while (true) {
+		if (tryPop(worker, item))
+			return true;
+		// waiting workers are notified with the lock held after the size was
+		// increased, so a new item can't get lost between checking the size and waiting
+		thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+		while (!closed && size == 0)
+			condition.wait(lock);
+		if (closed)
+			return false;
+	}
+}
+
+template <typename T>
+size_t WorkStealingQueue<T>::removeIf(const std::function<bool(const T&)>& remove) {
+	size_t removed = 0;
+	for (size_t i = 0; i < deques.size(); i++) {
+		WorkerDeque& deque = *deques[i];
+		thread_ns::unique_lock<thread_ns::mutex> lock(deque.mutex);
+		for (auto it = deque.items.begin(); it != deque.items.end(); ) {
+			if (remove(*it)) {
+				it = deque.items.erase(it);
+				size--;
+				removed++;
+			} else
+				++it;
+		}
+	}
+	return removed;
+}
+
+template <typename T>
+void WorkStealingQueue<T>::close() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	closed = true;
+	condition.notify_all();
+}
+
+template <typename T>
+bool WorkStealingQueue<T>::tryPop(int worker, T& item) {
+	int workers = deques.size();
+	for (int i = 0; i < workers; i++) {
+		// the own deque, then the previous and the next worker, and so on
+		int offset = (i % 2 == 1) ? -(i + 1) / 2 : i / 2;
+		WorkerDeque& deque = *deques[((worker + offset) % workers + workers) % workers];
+		thread_ns::unique_lock<thread_ns::mutex> lock(deque.mutex);
+		if (deque.items.empty())
+			continue;
+		// take the own items from the front, and the ones of other workers from the back
+		if (i == 0) {
+			item = deque.items.front();
+			deque.items.pop_front();
+		} else {
+			item = deque.items.back();
+			deque.items.pop_back();
+		}
+		size--;
+		return true;
+	}
+	return false;
+}
+
+template <typename T>
+void WorkStealingQueue<T>::pushed() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(mutex);
+	condition.notify_one();
+}
+
+} /* namespace thread */
+} /* namespace mapcrafter */
+
+#endif /* WORKSTEALINGQUEUE_H_ */
@@ -31,12 +31,18 @@
 #include "compat/boost.h"
 #include "compat/nullptr.h"
 
+#include "util/digest.h"
 #include "util/filesystem.h"
+#include "util/http.h"
 #include "util/json.h"
 #include "util/logging.h"
 #include "util/progress.h"
 #include "util/math.h"
+#include "util/memory.h"
 #include "util/other.h"
+#include "util/probes.h"
+#include "util/profiler.h"
+#include "util/status.h"
 #include "util/terminal.h"
 
 #endif /* UTIL_H_ */
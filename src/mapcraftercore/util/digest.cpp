@@ -0,0 +1,143 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "digest.h"
+
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace util {
+
+namespace {
+
+const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+	0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+	0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+	0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+	0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+	0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+	0xc67178f2
+};
+
+inline uint32_t rotr(uint32_t x, int n) {
+	return (x >> n) | (x << (32 - n));
+}
+
+/**
+ * Processes a block of 64 bytes.
+ */
+void sha256Block(uint32_t state[8], const uint8_t* block) {
+	uint32_t w[64];
+	for (int i = 0; i < 16; i++)
+		w[i] = (uint32_t) block[i * 4] << 24 | (uint32_t) block[i * 4 + 1] << 16
+				| (uint32_t) block[i * 4 + 2] << 8 | (uint32_t) block[i * 4 + 3];
+	for (int i = 16; i < 64; i++) {
+		uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for (int i = 0; i < 64; i++) {
+		uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+		uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = s0 + maj;
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+}
+
+std::string sha256(const std::string& data) {
+	uint32_t state[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+	size_t full_blocks = data.size() / 64;
+	for (size_t i = 0; i < full_blocks; i++)
+		sha256Block(state, bytes + i * 64);
+
+	// the rest of the data, a 1 bit, zeros and the length in bits fill one or two blocks
+	uint8_t last[128] = {0};
+	size_t rest = data.size() % 64;
+	for (size_t i = 0; i < rest; i++)
+		last[i] = bytes[full_blocks * 64 + i];
+	last[rest] = 0x80;
+	size_t last_size = rest < 56 ? 64 : 128;
+	uint64_t bits = (uint64_t) data.size() * 8;
+	for (int i = 0; i < 8; i++)
+		last[last_size - 1 - i] = bits >> (i * 8);
+	for (size_t i = 0; i < last_size; i += 64)
+		sha256Block(state, last + i);
+
+	std::string digest(32, '\0');
+	for (int i = 0; i < 8; i++)
+		for (int j = 0; j < 4; j++)
+			digest[i * 4 + j] = state[i] >> (24 - j * 8);
+	return digest;
+}
+
+std::string hmacSHA256(const std::string& key, const std::string& data) {
+	std::string block_key = key.size() > 64 ? sha256(key) : key;
+	block_key.resize(64, '\0');
+	std::string inner(64, '\0'), outer(64, '\0');
+	for (int i = 0; i < 64; i++) {
+		inner[i] = block_key[i] ^ 0x36;
+		outer[i] = block_key[i] ^ 0x5c;
+	}
+	return sha256(outer + sha256(inner + data));
+}
+
+std::string toHex(const std::string& data) {
+	const char* digits = "0123456789abcdef";
+	std::string hex(data.size() * 2, '0');
+	for (size_t i = 0; i < data.size(); i++) {
+		uint8_t byte = data[i];
+		hex[i * 2] = digits[byte >> 4];
+		hex[i * 2 + 1] = digits[byte & 0xf];
+	}
+	return hex;
+}
+
+}
+}
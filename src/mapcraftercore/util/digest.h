@@ -0,0 +1,46 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIGEST_H_
+#define DIGEST_H_
+
+#include <string>
+
+namespace mapcrafter {
+namespace util {
+
+/**
+ * Returns the SHA-256 digest (32 bytes) of some data.
+ */
+std::string sha256(const std::string& data);
+
+/**
+ * Returns the HMAC-SHA-256 (32 bytes) of some data with a key.
+ */
+std::string hmacSHA256(const std::string& key, const std::string& data);
+
+/**
+ * Returns the bytes of a string as lowercase hexadecimal digits.
+ */
+std::string toHex(const std::string& data);
+
+}
+}
+
+#endif /* DIGEST_H_ */
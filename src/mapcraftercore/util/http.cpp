@@ -0,0 +1,143 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "http.h"
+
+#include "logging.h"
+#include "other.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <boost/asio.hpp>
+
+using boost::asio::ip::tcp;
+
+namespace mapcrafter {
+namespace util {
+
+std::string HTTPResponse::getHeader(const std::string& name) const {
+	auto it = headers.find(name);
+	return it != headers.end() ? it->second : "";
+}
+
+bool isHTTPURL(const std::string& url) {
+	return startswith(url, "http://");
+}
+
+bool splitHTTPURL(const std::string& url, std::string& host, std::string& port,
+		std::string& path) {
+	if (!isHTTPURL(url))
+		return false;
+	// http://<host>[:<port>]/<path>
+	std::string location = url.substr(std::strlen("http://"));
+	size_t slash = location.find('/');
+	host = location.substr(0, slash);
+	path = slash == std::string::npos ? "/" : location.substr(slash);
+	port = "80";
+	size_t colon = host.find(':');
+	if (colon != std::string::npos) {
+		port = host.substr(colon + 1);
+		host = host.substr(0, colon);
+	}
+	return !host.empty();
+}
+
+bool httpRequest(const std::string& method, const std::string& url,
+		const std::map<std::string, std::string>& headers, const std::string& body,
+		HTTPResponse& response) {
+	std::string host, port, path;
+	if (!splitHTTPURL(url, host, port, path)) {
+		LOG(ERROR) << "Invalid URL '" << url << "'.";
+		return false;
+	}
+
+	std::string data;
+	try {
+		boost::asio::io_service io_service;
+		tcp::resolver resolver(io_service);
+		tcp::socket socket(io_service);
+		boost::asio::connect(socket, resolver.resolve(tcp::resolver::query(host, port)));
+
+		// HTTP/1.0 so the response is not sent with chunked transfer encoding
+		std::ostringstream request;
+		request << method << " " << path << " HTTP/1.0\r\n";
+		request << "Host: " << host;
+		if (port != "80")
+			request << ":" << port;
+		request << "\r\n";
+		for (auto it = headers.begin(); it != headers.end(); ++it)
+			request << it->first << ": " << it->second << "\r\n";
+		if (!body.empty() || method == "PUT" || method == "POST")
+			request << "Content-Length: " << body.size() << "\r\n";
+		request << "Connection: close\r\n\r\n";
+		std::string request_headers = request.str();
+		std::vector<boost::asio::const_buffer> buffers;
+		buffers.push_back(boost::asio::buffer(request_headers));
+		buffers.push_back(boost::asio::buffer(body));
+		boost::asio::write(socket, buffers);
+
+		char buffer[16384];
+		boost::system::error_code error;
+		while (!error) {
+			size_t count = socket.read_some(boost::asio::buffer(buffer), error);
+			data.append(buffer, count);
+		}
+		if (error != boost::asio::error::eof)
+			throw boost::system::system_error(error);
+	} catch (const std::exception& e) {
+		LOG(ERROR) << "Unable to request '" << url << "': " << e.what();
+		return false;
+	}
+
+	size_t headers_end = data.find("\r\n\r\n");
+	int major, minor;
+	if (headers_end == std::string::npos || std::sscanf(data.c_str(), "HTTP/%d.%d %d",
+			&major, &minor, &response.status) != 3) {
+		LOG(ERROR) << "Invalid response to the request of '" << url << "'.";
+		return false;
+	}
+	response.headers.clear();
+	std::istringstream response_headers(data.substr(0, headers_end));
+	std::string line;
+	std::getline(response_headers, line);
+	while (std::getline(response_headers, line)) {
+		size_t separator = line.find(':');
+		if (separator == std::string::npos)
+			continue;
+		std::string name = line.substr(0, separator);
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		response.headers[name] = trim(line.substr(separator + 1));
+	}
+	response.body = data.substr(headers_end + 4);
+
+	std::string content_length = response.getHeader("content-length");
+	if (method != "HEAD" && !content_length.empty()
+			&& response.body.size() != std::strtoull(content_length.c_str(), nullptr, 10)) {
+		LOG(ERROR) << "Incomplete response to the request of '" << url << "'.";
+		return false;
+	}
+	return true;
+}
+
+}
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_H_
+#define HTTP_H_
+
+#include <map>
+#include <string>
+
+namespace mapcrafter {
+namespace util {
+
+/**
+ * The response to a HTTP request.
+ */
+struct HTTPResponse {
+	int status;
+	// the names of the headers are lowercase
+	std::map<std::string, std::string> headers;
+	std::string body;
+
+	std::string getHeader(const std::string& name) const;
+};
+
+/**
+ * Returns whether a path is a http:// URL.
+ */
+bool isHTTPURL(const std::string& url);
+
+/**
+ * Splits a http:// URL into host, port (80 if the URL has none) and path (/ if the URL
+ * has none). Returns false if it's not a http:// URL.
+ */
+bool splitHTTPURL(const std::string& url, std::string& host, std::string& port,
+		std::string& path);
+
+/**
+ * Sends a HTTP request with some headers and a body (if it's not empty) to a http://
+ * URL. Returns false if the server can't be reached or the response is invalid, but not
+ * if the status code says the request failed. The connection is closed afterwards.
+ */
+bool httpRequest(const std::string& method, const std::string& url,
+		const std::map<std::string, std::string>& headers, const std::string& body,
+		HTTPResponse& response);
+
+}
+}
+
+#endif /* HTTP_H_ */
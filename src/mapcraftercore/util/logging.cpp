@@ -131,7 +131,8 @@ std::ostream& operator<<(std::ostream& out, LogLevel level) {
 
 LogStream::LogStream(LogLevel level, const std::string& logger,
 		const std::string& file, int line)
-	: fake(false), message({level, logger, file, line, ""}), ss(new std::stringstream) {
+	: fake(false), message({level, logger, file, line, "", std::time(nullptr)}),
+	  ss(new std::stringstream) {
 	if (message.file.find('/') != std::string::npos)
 		message.file = message.file.substr(message.file.find_last_of('/') + 1);
 }
@@ -158,15 +159,19 @@ LogStream Logger::log(LogLevel level, const std::string& file, int line) {
 	return LogStream(level, name, file, line);
 }
 
+namespace {
 
-std::set<std::string> logged = std::set<std::string>();
+// keys of the messages which were logged once already
+std::set<std::string> logged;
+thread_ns::mutex logged_mutex;
+
+}
 
 LogStream Logger::logOnce(const std::string& key, LogLevel level,
 		const std::string& file, int line) {
 	LogStream log_stream(level, name, file, line);
-	if (!logged.count(key))
-		logged.insert(key);
-	else
+	thread_ns::unique_lock<thread_ns::mutex> lock(logged_mutex);
+	if (!logged.insert(key).second)
 		log_stream.setFake(true);
 	return log_stream;
 }
@@ -191,9 +196,8 @@ FormattedLogSink::~FormattedLogSink() {
 std::string FormattedLogSink::formatLogEntry(const LogMessage& message) {
 	std::string formatted = format;
 
-	std::time_t t = std::time(nullptr);
 	char buffer[256];
-	std::strftime(buffer, sizeof(buffer), date_format.c_str(), std::localtime(&t));
+	std::strftime(buffer, sizeof(buffer), date_format.c_str(), std::localtime(&message.time));
 	formatted = util::replaceAll(formatted, "%(date)", std::string(buffer));
 
 	formatted = util::replaceAll(formatted, "%(level)", LogLevelHelper::levelToString(message.level));
@@ -271,15 +275,17 @@ void LogSyslogSink::sink(const LogMessage& message) {
 
 #endif
 
-thread_ns::mutex Logging::instance_mutex;
-std::shared_ptr<Logging> Logging::instance;
+std::atomic<int> Logging::maximum_verbosity((int) LogLevel::INFO);
 
 Logging::Logging()
-	: default_verbosity(LogLevel::INFO), maximum_verbosity(default_verbosity) {
+	: default_verbosity(LogLevel::INFO), asynchronous_running(false),
+	  asynchronous_stop(false), asynchronous_writing(false) {
+	default_logger = &getLogger(DEFAULT_LOGGER);
 	reset();
 }
 
 Logging::~Logging() {
+	stopAsynchronous();
 }
 
 LogLevel Logging::getDefaultVerbosity() const {
@@ -312,6 +318,16 @@ void Logging::setSinkLogProgress(const std::string& sink, bool log_progress) {
 	sinks_log_progress[sink] = log_progress;
 }
 
+bool Logging::getSinkAsynchronous(const std::string& sink) const {
+	if (sinks_asynchronous.count(sink))
+		return sinks_asynchronous.at(sink);
+	return false;
+}
+
+void Logging::setSinkAsynchronous(const std::string& sink, bool asynchronous) {
+	sinks_asynchronous[sink] = asynchronous;
+}
+
 LogSink* Logging::getSink(const std::string& name) {
 	if (sinks.count(name))
 		return sinks[name].get();
@@ -320,19 +336,30 @@ LogSink* Logging::getSink(const std::string& name) {
 
 void Logging::setSink(const std::string& name, LogSink* sink) {
 	sinks[name] = std::shared_ptr<LogSink>(sink);
+	updateMaximumVerbosity();
 }
 
 void Logging::reset() {
-	default_verbosity = maximum_verbosity = LogLevel::INFO;
-	loggers.clear();
+	// the queued messages are still written to the old sinks
+	stopAsynchronous();
+
+	// the loggers are kept, references to them may be cached
+	default_verbosity = LogLevel::INFO;
 	sinks.clear();
 	sinks_verbosity.clear();
 	sinks_log_progress.clear();
+	sinks_asynchronous.clear();
 
 	setSink("__output__", new LogOutputSink);
 	setSinkLogProgress("__output__", false);
 }
 
+void Logging::flush() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(asynchronous_mutex);
+	while (!asynchronous_queue.empty() || asynchronous_writing)
+		asynchronous_written.wait(lock);
+}
+
 Logger& Logging::getLogger(const std::string& name) {
 	thread_ns::unique_lock<thread_ns::mutex> lock(loggers_mutex);
 	if (!loggers.count(name))
@@ -340,34 +367,89 @@ Logger& Logging::getLogger(const std::string& name) {
 	return *loggers.at(name);
 }
 
+Logger& Logging::getDefaultLogger() {
+	return *default_logger;
+}
+
 Logging& Logging::getInstance() {
-	thread_ns::unique_lock<thread_ns::mutex> lock(instance_mutex);
-	if (!instance)
-		instance.reset(new Logging);
-	return *instance;
+	// initialized thread-safe once, without locking every time
+	static Logging instance;
+	return instance;
 }
 
 void Logging::updateMaximumVerbosity() {
 	LogLevel maximum = LogLevel::EMERGENCY;
 	for (auto it = sinks.begin(); it != sinks.end(); ++it)
 		maximum = std::max(maximum, getSinkVerbosity(it->first));
-	maximum_verbosity = maximum;
+	maximum_verbosity = (int) maximum;
 }
 
 void Logging::handleLogMessage(const LogMessage& message) {
 	thread_ns::unique_lock<thread_ns::mutex> lock(handle_message_mutex);
 	// return already here if there is no log sink with the right verbosity
-	if (message.level > maximum_verbosity)
+	if (!isEnabled(message.level))
 		return;
+	bool queued = false;
 	for (auto it = sinks.begin(); it != sinks.end(); ++it) {
 		// check if this is a progress log message and sink should handle progress messages
 		if (message.logger == "progress" && !getSinkLogProgress(it->first))
 			continue;
-		// if sink has the right verbosity, pass log message to the sink
-		if (message.level <= getSinkVerbosity(it->first))
+		if (message.level > getSinkVerbosity(it->first))
+			continue;
+		// if sink has the right verbosity, pass log message to the sink,
+		// or to the writer thread if the sink is asynchronous
+		if (!getSinkAsynchronous(it->first)) {
 			(*it->second).sink(message);
+			continue;
+		}
+		thread_ns::unique_lock<thread_ns::mutex> queue_lock(asynchronous_mutex);
+		if (!asynchronous_running) {
+			asynchronous_writer = thread_ns::thread(&Logging::writeAsynchronous, this);
+			asynchronous_running = true;
+		}
+		asynchronous_queue.push_back(std::make_pair(it->second, message));
+		asynchronous_queued.notify_one();
+		queued = true;
+	}
+
+	// make sure that errors are written in case the program crashes afterwards
+	if (queued && message.level <= LogLevel::ERROR)
+		flush();
+}
+
+void Logging::writeAsynchronous() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(asynchronous_mutex);
+	while (true) {
+		while (asynchronous_queue.empty() && !asynchronous_stop)
+			asynchronous_queued.wait(lock);
+		if (asynchronous_queue.empty())
+			break;
+
+		// pass the messages to the sinks without blocking the threads which log
+		std::deque<std::pair<std::shared_ptr<LogSink>, LogMessage> > messages;
+		messages.swap(asynchronous_queue);
+		asynchronous_writing = true;
+		lock.unlock();
+		for (auto it = messages.begin(); it != messages.end(); ++it)
+			it->first->sink(it->second);
+		lock.lock();
+		asynchronous_writing = false;
+		asynchronous_written.notify_all();
 	}
 }
 
+void Logging::stopAsynchronous() {
+	thread_ns::unique_lock<thread_ns::mutex> lock(asynchronous_mutex);
+	if (!asynchronous_running)
+		return;
+	asynchronous_stop = true;
+	asynchronous_queued.notify_one();
+	lock.unlock();
+	asynchronous_writer.join();
+
+	lock.lock();
+	asynchronous_running = asynchronous_stop = false;
+}
+
 } /* namespace util */
 } /* namespace mapcrafter */
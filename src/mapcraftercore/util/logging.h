@@ -22,6 +22,9 @@
 
 #include "../compat/thread.h"
 
+#include <atomic>
+#include <ctime>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -29,6 +32,8 @@
 #include <set>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #define STRINGIFY(x) #x
@@ -37,10 +42,22 @@
 #define DEFAULT_LOGGER "default"
 #define DEFAULT_LOGKEY "file__" __FILE__ ":" TOSTRING(__LINE__)
 
-#define LOGN(level, logger) mapcrafter::util::Logging::getInstance().getLogger((logger)).log(mapcrafter::util::LogLevel::level, __FILE__, __LINE__)
-#define LOG(level) LOGN(level, DEFAULT_LOGGER)
+// messages less severe than this level are compiled out, it's set with the
+// OPT_LOG_MAX_LEVEL cmake option
+#ifndef LOG_MAX_LEVEL
+#  define LOG_MAX_LEVEL DEBUG
+#endif
+
+// whether messages with a level are handled by any log sink, the message isn't even
+// formatted (the operands of the << operators aren't evaluated) otherwise
+#define LOG_ENABLED(level) ((int) mapcrafter::util::LogLevel::level <= (int) mapcrafter::util::LogLevel::LOG_MAX_LEVEL \
+	&& mapcrafter::util::Logging::isEnabled(mapcrafter::util::LogLevel::level))
+#define LOG_IF_ENABLED(level) !LOG_ENABLED(level) ? (void) 0 : mapcrafter::util::LogVoidify() &
 
-#define LOGNK_ONCE(level, logger, key) mapcrafter::util::Logging::getInstance().getLogger((logger)).logOnce((key), mapcrafter::util::LogLevel::level, __FILE__, __LINE__)
+#define LOGN(level, logger) LOG_IF_ENABLED(level) mapcrafter::util::Logging::getInstance().getLogger((logger)).log(mapcrafter::util::LogLevel::level, __FILE__, __LINE__)
+#define LOG(level) LOG_IF_ENABLED(level) mapcrafter::util::Logging::getInstance().getDefaultLogger().log(mapcrafter::util::LogLevel::level, __FILE__, __LINE__)
+
+#define LOGNK_ONCE(level, logger, key) LOG_IF_ENABLED(level) mapcrafter::util::Logging::getInstance().getLogger((logger)).logOnce((key), mapcrafter::util::LogLevel::level, __FILE__, __LINE__)
 #define LOGN_ONCE(level, logger) LOGNK_ONCE(level, logger, DEFAULT_LOGKEY)
 #define LOGK_ONCE(level, key) LOGNK_ONCE(level, DEFAULT_LOGGER, std::string("key__") + (key))
 #define LOG_ONCE(level) LOGN_ONCE(level, DEFAULT_LOGGER)
@@ -131,6 +148,9 @@ struct LogMessage {
 
 	// actual logged message
 	std::string message;
+
+	// when this was logged
+	std::time_t time;
 };
 
 /**
@@ -163,6 +183,14 @@ private:
 	std::shared_ptr<std::stringstream> ss;
 };
 
+/**
+ * Turns a log stream into a void expression, that's what the LOG macros need to skip
+ * the log stream with the ?: operator if the log level is not enabled.
+ */
+struct LogVoidify {
+	void operator&(const LogStream&) {}
+};
+
 /**
  * This class represents a logger.
  *
@@ -322,6 +350,16 @@ public:
 	bool getSinkLogProgress(const std::string& sink) const;
 	void setSinkLogProgress(const std::string& sink, bool log_progress);
 
+	/**
+	 * Returns/sets whether the messages of a sink are passed to it by a background
+	 * writer thread, so the threads which log messages don't have to wait for the sink.
+	 * Messages with the level ERROR and more severe ones are still written before the
+	 * thread which logs them continues. Defaults to false. This should be set before
+	 * anything is logged to the sink.
+	 */
+	bool getSinkAsynchronous(const std::string& sink) const;
+	void setSinkAsynchronous(const std::string& sink, bool asynchronous);
+
 	/**
 	 * Returns/sets a sink instance. Returns a nullptr if there is no sink with the
 	 * specific name.
@@ -337,10 +375,30 @@ public:
 	void reset();
 
 	/**
-	 * Returns the instance of a specific logger (thread-safe).
+	 * Waits until the background writer thread passed all queued messages to the
+	 * asynchronous sinks.
+	 */
+	void flush();
+
+	/**
+	 * Returns the instance of a specific logger (thread-safe). The instances are never
+	 * deleted, so the returned references can be kept.
 	 */
 	Logger& getLogger(const std::string& name);
 
+	/**
+	 * Returns the instance of the default logger without looking it up.
+	 */
+	Logger& getDefaultLogger();
+
+	/**
+	 * Returns whether messages with a log level are handled by any sink. This is
+	 * checked by the LOG macros before the message is formatted.
+	 */
+	static bool isEnabled(LogLevel level) {
+		return (int) level <= maximum_verbosity.load(std::memory_order_relaxed);
+	}
+
 	/**
 	 * Returns the singleton instance of the logging facility (thread-safe).
 	 */
@@ -361,16 +419,37 @@ protected:
 	 */
 	void handleLogMessage(const LogMessage& message);
 
-	LogLevel default_verbosity, maximum_verbosity;
+	/**
+	 * Background writer thread, passes the queued messages to the asynchronous sinks.
+	 */
+	void writeAsynchronous();
+
+	/**
+	 * Stops the background writer thread after it wrote the queued messages.
+	 */
+	void stopAsynchronous();
+
+	LogLevel default_verbosity;
 	std::map<std::string, std::shared_ptr<Logger> > loggers;
+	Logger* default_logger;
 	std::map<std::string, std::shared_ptr<LogSink> > sinks;
 	std::map<std::string, LogLevel> sinks_verbosity;
 	std::map<std::string, bool> sinks_log_progress;
+	std::map<std::string, bool> sinks_asynchronous;
 
 	thread_ns::mutex loggers_mutex, handle_message_mutex;
 
-	static thread_ns::mutex instance_mutex;
-	static std::shared_ptr<Logging> instance;
+	// messages queued for the asynchronous sinks, whether the writer thread is running,
+	// should stop, and is passing messages to sinks right now
+	std::deque<std::pair<std::shared_ptr<LogSink>, LogMessage> > asynchronous_queue;
+	thread_ns::thread asynchronous_writer;
+	bool asynchronous_running, asynchronous_stop, asynchronous_writing;
+	thread_ns::mutex asynchronous_mutex;
+	thread_ns::condition_variable asynchronous_queued, asynchronous_written;
+
+	// the maximum verbosity of all sinks as int, it's static to check it without
+	// even getting the instance
+	static std::atomic<int> maximum_verbosity;
 
 	friend class LogStream;
 };
@@ -0,0 +1,638 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory.h"
+
+#include "logging.h"
+#include "../compat/thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#ifdef HAVE_MADVISE_HUGEPAGE
+#  include <sys/mman.h>
+#endif
+
+namespace mapcrafter {
+namespace util {
+
+#ifdef OPT_MEMORY_TRACKING
+
+namespace {
+
+// threads after the maximum count share the last slot
+const int MAX_THREADS = 1024;
+// the subsystems and the total
+const int USAGES = (int) MemorySubsystem::COUNT + 1;
+
+/**
+ * The counters of a thread. Only the thread itself allocates with its slot and updates
+ * the peaks, the memory may be freed by other threads though.
+ */
+struct ThreadSlot {
+	std::atomic<uint64_t> allocations[USAGES], allocated_bytes[USAGES];
+	std::atomic<int64_t> live_bytes[USAGES], peak_bytes[USAGES];
+	// updated by the sampling thread only
+	double sampled_bytes[USAGES];
+	uint64_t samples;
+	std::atomic<bool> finished;
+	char name[32];
+};
+
+/**
+ * Stored in front of every allocation, so the memory is subtracted from the right
+ * thread and subsystem when it's freed. It keeps the alignment of malloc.
+ */
+struct AllocationHeader {
+	uint64_t size;
+	uint32_t slot;
+	uint32_t usage;
+};
+
+// these are initialized statically, allocations happen before dynamic initialization
+ThreadSlot slots[MAX_THREADS];
+std::atomic<int> slot_count(0);
+thread_local int thread_slot = -1;
+thread_local MemorySubsystem thread_subsystem = MemorySubsystem::OTHER;
+
+/**
+ * Marks the slot of a thread as finished when the thread exits, it's not sampled then.
+ */
+struct SlotFinisher {
+	~SlotFinisher() {
+		if (thread_slot != -1)
+			slots[thread_slot].finished = true;
+	}
+};
+thread_local SlotFinisher slot_finisher;
+
+thread_ns::mutex names_mutex;
+
+thread_ns::thread sampler;
+bool sampler_stop = false;
+thread_ns::mutex sampler_mutex;
+// the count of started samplings which are not stopped yet, the render managers of the
+// render service sample at the same time
+int sampler_users = 0;
+thread_ns::mutex sampler_users_mutex;
+thread_ns::condition_variable sampler_condition;
+
+int getThreadSlot() {
+	if (thread_slot == -1) {
+		thread_slot = std::min(slot_count.fetch_add(1), MAX_THREADS - 1);
+		// makes sure that the destructor of the finisher is called
+		(void) &slot_finisher;
+	}
+	return thread_slot;
+}
+
+void addAllocation(ThreadSlot& slot, int usage, int64_t size) {
+	slot.allocations[usage].fetch_add(1, std::memory_order_relaxed);
+	slot.allocated_bytes[usage].fetch_add(size, std::memory_order_relaxed);
+	int64_t live = slot.live_bytes[usage].fetch_add(size, std::memory_order_relaxed) + size;
+	if (live > slot.peak_bytes[usage].load(std::memory_order_relaxed))
+		slot.peak_bytes[usage].store(live, std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size) {
+	AllocationHeader* header = static_cast<AllocationHeader*>(
+			std::malloc(size + sizeof(AllocationHeader)));
+	if (header == nullptr)
+		return nullptr;
+	header->size = size;
+	header->slot = getThreadSlot();
+	header->usage = (uint32_t) thread_subsystem;
+	addAllocation(slots[header->slot], header->usage, size);
+	addAllocation(slots[header->slot], (int) MemorySubsystem::COUNT, size);
+	return header + 1;
+}
+
+void deallocate(void* pointer) {
+	if (pointer == nullptr)
+		return;
+	AllocationHeader* header = static_cast<AllocationHeader*>(pointer) - 1;
+	ThreadSlot& slot = slots[header->slot];
+	slot.live_bytes[header->usage].fetch_sub(header->size, std::memory_order_relaxed);
+	slot.live_bytes[(int) MemorySubsystem::COUNT].fetch_sub(header->size,
+			std::memory_order_relaxed);
+	std::free(header);
+}
+
+void sample(int interval) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(sampler_mutex);
+	while (!sampler_stop) {
+		int count = std::min(slot_count.load(), MAX_THREADS);
+		for (int i = 0; i < count; i++) {
+			if (slots[i].finished)
+				continue;
+			slots[i].samples++;
+			for (int j = 0; j < USAGES; j++)
+				slots[i].sampled_bytes[j] += slots[i].live_bytes[j].load(std::memory_order_relaxed);
+		}
+		sampler_condition.wait_for(lock, thread_ns::chrono::milliseconds(interval));
+	}
+}
+
+}
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem)
+	: previous(thread_subsystem) {
+	thread_subsystem = subsystem;
+}
+
+MemoryScope::~MemoryScope() {
+	thread_subsystem = previous;
+}
+
+#endif
+
+namespace {
+
+/**
+ * Returns the size class of a buffer. The small buffers are rounded up to a power of
+ * two or one and a half times of it (so the classes are multiples of the alignment), the
+ * large ones to whole blocks.
+ */
+std::size_t getSizeClass(std::size_t size) {
+	if (size > HugePageArena::BLOCK_SIZE / 2)
+		return (size + HugePageArena::BLOCK_SIZE - 1) / HugePageArena::BLOCK_SIZE
+				* HugePageArena::BLOCK_SIZE;
+	std::size_t size_class = HugePageArena::ALIGNMENT;
+	while (size_class < size) {
+		if (size_class >= 2 * HugePageArena::ALIGNMENT && size_class + size_class / 2 >= size)
+			return size_class + size_class / 2;
+		size_class *= 2;
+	}
+	return size_class;
+}
+
+/**
+ * Returns the index of a small size class (64, 128, 192, 256, 384, 512, ...).
+ */
+std::size_t getSmallClassIndex(std::size_t size_class) {
+	std::size_t index = 0, power = HugePageArena::ALIGNMENT;
+	while (power * 2 <= size_class) {
+		index += power >= 2 * HugePageArena::ALIGNMENT ? 2 : 1;
+		power *= 2;
+	}
+	return size_class == power ? index : index + 1;
+}
+
+/**
+ * Returns the largest size class of the small buffers which fits into a size.
+ */
+std::size_t getFittingSizeClass(std::size_t size) {
+	std::size_t fitting = 0;
+	for (std::size_t size_class = HugePageArena::ALIGNMENT; size_class <= size;
+			size_class *= 2) {
+		fitting = size_class;
+		if (size_class >= 2 * HugePageArena::ALIGNMENT && size_class + size_class / 2 <= size)
+			fitting = size_class + size_class / 2;
+	}
+	return fitting;
+}
+
+// the freed buffers of one size class
+struct SizeClass {
+	std::vector<void*> free_buffers;
+	thread_ns::mutex mutex;
+};
+
+// the slots of the set of the blocks of the arena, at most half of them are used
+const std::size_t BLOCK_SLOTS = 1 << 16;
+
+// the blocks and the buffers of the huge page arena, see HugePageArena
+struct Arena {
+	Arena() : enabled(false), used(false), explicit_huge_pages(true), block_next(nullptr),
+		block_left(0), block_count(0), mapped_bytes(0), explicit_bytes(0) {
+		std::size_t count = getSmallClassIndex(HugePageArena::BLOCK_SIZE / 2) + 1;
+		small_classes.reset(new SizeClass[count]);
+	}
+
+	std::atomic<bool> enabled, used;
+
+	// the freed buffers of the small size classes, and of the large ones by size, every
+	// size class has an own lock
+	std::unique_ptr<SizeClass[]> small_classes;
+	std::map<std::size_t, std::vector<void*> > large_free_buffers;
+	thread_ns::mutex large_mutex;
+
+	// the following is protected by the block lock:
+	// whether the explicit huge pages didn't run out yet
+	bool explicit_huge_pages;
+	// the rest of the block the small buffers are taken from at the moment
+	char* block_next;
+	std::size_t block_left;
+	// the block numbers (address / block size) of the mapped blocks, a hash set with
+	// linear probing which is only added to, so it's looked up without the lock
+	std::unique_ptr<std::atomic<std::uintptr_t>[]> blocks;
+	std::size_t block_count;
+	std::size_t mapped_bytes, explicit_bytes;
+	thread_ns::mutex block_mutex;
+};
+
+Arena& getArena() {
+	// never destroyed, the buffers may be freed after the static destructors
+	static Arena* arena = new Arena();
+	return *arena;
+}
+
+/**
+ * Maps memory of a multiple of the block size aligned to the block size, with explicit
+ * huge pages if possible and transparent huge pages otherwise. Returns null if it's not
+ * possible to map memory.
+ */
+void* mapHugePages(Arena& arena, std::size_t size) {
+#ifdef HAVE_MADVISE_HUGEPAGE
+#  ifdef MAP_HUGETLB
+	if (arena.explicit_huge_pages) {
+		void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			arena.explicit_bytes += size;
+			return p;
+		}
+		// the reserved huge pages are used up, or there are none
+		arena.explicit_huge_pages = false;
+	}
+#  endif
+	// the kernel backs only aligned memory with transparent huge pages, so a block
+	// more is mapped and the unaligned parts are unmapped again
+	std::size_t mapped = size + HugePageArena::BLOCK_SIZE;
+	void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED)
+		return nullptr;
+	char* start = static_cast<char*>(raw);
+	char* aligned = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(start)
+			+ HugePageArena::BLOCK_SIZE - 1) & ~(HugePageArena::BLOCK_SIZE - 1));
+	if (aligned > start)
+		munmap(start, aligned - start);
+	if (start + mapped > aligned + size)
+		munmap(aligned + size, start + mapped - (aligned + size));
+	// the kernel may not support transparent huge pages, the memory is usable anyway
+	madvise(aligned, size, MADV_HUGEPAGE);
+	return aligned;
+#else
+	return nullptr;
+#endif
+}
+
+/**
+ * Returns the slot of a block number in the set of the blocks, where the probing starts.
+ */
+std::size_t getBlockSlot(std::uintptr_t block) {
+	return (block * 2654435761u) % BLOCK_SLOTS;
+}
+
+/**
+ * Maps the blocks for a buffer and adds them to the set of the blocks. The block lock
+ * must be held. Throws std::bad_alloc if no memory could be mapped.
+ */
+char* mapBlocks(Arena& arena, std::size_t size) {
+	std::size_t count = size / HugePageArena::BLOCK_SIZE;
+	if (arena.block_count + count > BLOCK_SLOTS / 2)
+		throw std::bad_alloc();
+	char* block = static_cast<char*>(mapHugePages(arena, size));
+	if (block == nullptr)
+		throw std::bad_alloc();
+
+	if (!arena.blocks)
+		arena.blocks.reset(new std::atomic<std::uintptr_t>[BLOCK_SLOTS]());
+	std::uintptr_t first = reinterpret_cast<std::uintptr_t>(block) / HugePageArena::BLOCK_SIZE;
+	for (std::uintptr_t number = first; number < first + count; number++) {
+		std::size_t slot = getBlockSlot(number);
+		while (arena.blocks[slot].load(std::memory_order_relaxed) != 0)
+			slot = (slot + 1) % BLOCK_SLOTS;
+		arena.blocks[slot].store(number, std::memory_order_release);
+	}
+	arena.block_count += count;
+	arena.mapped_bytes += size;
+	arena.used = true;
+	return block;
+}
+
+/**
+ * Returns whether an address is in one of the blocks of the arena, without a lock.
+ */
+bool isInBlocks(const Arena& arena, const void* p) {
+	std::uintptr_t number = reinterpret_cast<std::uintptr_t>(p) / HugePageArena::BLOCK_SIZE;
+	for (std::size_t slot = getBlockSlot(number); ; slot = (slot + 1) % BLOCK_SLOTS) {
+		std::uintptr_t block = arena.blocks[slot].load(std::memory_order_acquire);
+		if (block == number)
+			return true;
+		if (block == 0)
+			return false;
+	}
+}
+
+}
+
+const std::size_t HugePageArena::ALIGNMENT;
+const std::size_t HugePageArena::BLOCK_SIZE;
+
+bool HugePageArena::setEnabled(bool enabled) {
+#ifdef HAVE_MADVISE_HUGEPAGE
+	getArena().enabled = enabled;
+	return true;
+#else
+	return !enabled;
+#endif
+}
+
+bool HugePageArena::isEnabled() {
+	return getArena().enabled.load(std::memory_order_relaxed);
+}
+
+void* HugePageArena::allocate(std::size_t size) {
+	Arena& arena = getArena();
+	std::size_t size_class = getSizeClass(size);
+	if (size_class > BLOCK_SIZE / 2) {
+		// the large buffers get own blocks
+		{
+			thread_ns::unique_lock<thread_ns::mutex> lock(arena.large_mutex);
+			std::vector<void*>& free_buffers = arena.large_free_buffers[size_class];
+			if (!free_buffers.empty()) {
+				void* p = free_buffers.back();
+				free_buffers.pop_back();
+				return p;
+			}
+		}
+		thread_ns::unique_lock<thread_ns::mutex> lock(arena.block_mutex);
+		return mapBlocks(arena, size_class);
+	}
+
+	SizeClass& small_class = arena.small_classes[getSmallClassIndex(size_class)];
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(small_class.mutex);
+		if (!small_class.free_buffers.empty()) {
+			void* p = small_class.free_buffers.back();
+			small_class.free_buffers.pop_back();
+			return p;
+		}
+	}
+	thread_ns::unique_lock<thread_ns::mutex> lock(arena.block_mutex);
+	if (arena.block_left < size_class) {
+		char* block = mapBlocks(arena, BLOCK_SIZE);
+		// the rest of the last block is split into buffers of the smaller classes
+		while (arena.block_left >= ALIGNMENT) {
+			std::size_t fitting = getFittingSizeClass(arena.block_left);
+			SizeClass& fitting_class = arena.small_classes[getSmallClassIndex(fitting)];
+			thread_ns::unique_lock<thread_ns::mutex> lock(fitting_class.mutex);
+			fitting_class.free_buffers.push_back(arena.block_next);
+			arena.block_next += fitting;
+			arena.block_left -= fitting;
+		}
+		arena.block_next = block;
+		arena.block_left = BLOCK_SIZE;
+	}
+	void* p = arena.block_next;
+	arena.block_next += size_class;
+	arena.block_left -= size_class;
+	return p;
+}
+
+bool HugePageArena::deallocate(void* p, std::size_t size) {
+	Arena& arena = getArena();
+	if (p == nullptr || !arena.used || !isInBlocks(arena, p))
+		return false;
+	std::size_t size_class = getSizeClass(size);
+	if (size_class > BLOCK_SIZE / 2) {
+		thread_ns::unique_lock<thread_ns::mutex> lock(arena.large_mutex);
+		arena.large_free_buffers[size_class].push_back(p);
+	} else {
+		SizeClass& small_class = arena.small_classes[getSmallClassIndex(size_class)];
+		thread_ns::unique_lock<thread_ns::mutex> lock(small_class.mutex);
+		small_class.free_buffers.push_back(p);
+	}
+	return true;
+}
+
+void HugePageArena::logUsage() {
+	Arena& arena = getArena();
+	if (!arena.used)
+		return;
+	// the used memory is what's neither free nor left in the last block
+	thread_ns::unique_lock<thread_ns::mutex> lock(arena.block_mutex);
+	std::size_t free_bytes = arena.block_left;
+	for (std::size_t size_class = ALIGNMENT; size_class <= BLOCK_SIZE / 2;
+			size_class = getSizeClass(size_class + 1)) {
+		SizeClass& small_class = arena.small_classes[getSmallClassIndex(size_class)];
+		thread_ns::unique_lock<thread_ns::mutex> lock(small_class.mutex);
+		free_bytes += small_class.free_buffers.size() * size_class;
+	}
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(arena.large_mutex);
+		for (auto it = arena.large_free_buffers.begin(); it != arena.large_free_buffers.end();
+				++it)
+			free_bytes += it->second.size() * it->first;
+	}
+	LOG(INFO) << "The huge page arena mapped " << arena.mapped_bytes / (1024 * 1024)
+			<< " MiB (" << arena.explicit_bytes / (1024 * 1024) << " MiB explicit huge pages), "
+			<< (arena.mapped_bytes - free_bytes) / (1024 * 1024) << " MiB are used.";
+}
+
+MemoryUsage::MemoryUsage()
+	: allocations(0), allocated_bytes(0), live_bytes(0), peak_bytes(0), steady_bytes(0) {
+}
+
+bool MemoryTracker::isEnabled() {
+#ifdef OPT_MEMORY_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+void MemoryTracker::setThreadName(const std::string& name) {
+#ifdef OPT_MEMORY_TRACKING
+	ThreadSlot& slot = slots[getThreadSlot()];
+	thread_ns::unique_lock<thread_ns::mutex> lock(names_mutex);
+	std::strncpy(slot.name, name.c_str(), sizeof(slot.name) - 1);
+#endif
+}
+
+void MemoryTracker::startSampling(int interval) {
+#ifdef OPT_MEMORY_TRACKING
+	thread_ns::unique_lock<thread_ns::mutex> users_lock(sampler_users_mutex);
+	if (sampler_users++ > 0)
+		return;
+	sampler_stop = false;
+	sampler = thread_ns::thread(sample, interval);
+#endif
+}
+
+void MemoryTracker::stopSampling() {
+#ifdef OPT_MEMORY_TRACKING
+	thread_ns::unique_lock<thread_ns::mutex> users_lock(sampler_users_mutex);
+	if (sampler_users == 0 || --sampler_users > 0 || !sampler.joinable())
+		return;
+	{
+		thread_ns::unique_lock<thread_ns::mutex> lock(sampler_mutex);
+		sampler_stop = true;
+		sampler_condition.notify_one();
+	}
+	sampler.join();
+#endif
+}
+
+std::map<std::string, std::vector<MemoryUsage> > MemoryTracker::getThreadUsage() {
+	std::map<std::string, std::vector<MemoryUsage> > usage;
+#ifdef OPT_MEMORY_TRACKING
+	// the sampled bytes are not changed meanwhile
+	thread_ns::unique_lock<thread_ns::mutex> sampler_lock(sampler_mutex);
+	thread_ns::unique_lock<thread_ns::mutex> names_lock(names_mutex);
+	// the sampled bytes and count of samples per thread name, for the average
+	std::map<std::string, std::pair<std::vector<double>, uint64_t> > samples;
+	int count = std::min(slot_count.load(), MAX_THREADS);
+	for (int i = 0; i < count; i++) {
+		const ThreadSlot& slot = slots[i];
+		std::string name = slot.name;
+		if (name.empty())
+			name = i == 0 ? "main" : "thread " + std::to_string(i);
+		std::vector<MemoryUsage>& thread_usage = usage[name];
+		std::pair<std::vector<double>, uint64_t>& thread_samples = samples[name];
+		thread_usage.resize(USAGES);
+		thread_samples.first.resize(USAGES);
+		thread_samples.second += slot.samples;
+		for (int j = 0; j < USAGES; j++) {
+			MemoryUsage& u = thread_usage[j];
+			u.allocations += slot.allocations[j].load(std::memory_order_relaxed);
+			u.allocated_bytes += slot.allocated_bytes[j].load(std::memory_order_relaxed);
+			u.live_bytes += slot.live_bytes[j].load(std::memory_order_relaxed);
+			// threads with the same name usually don't run at the same time
+			u.peak_bytes = std::max(u.peak_bytes,
+					slot.peak_bytes[j].load(std::memory_order_relaxed));
+			thread_samples.first[j] += slot.sampled_bytes[j];
+		}
+	}
+	for (auto it = usage.begin(); it != usage.end(); ++it) {
+		const std::pair<std::vector<double>, uint64_t>& thread_samples = samples[it->first];
+		if (thread_samples.second > 0)
+			for (int j = 0; j < USAGES; j++)
+				it->second[j].steady_bytes = thread_samples.first[j] / thread_samples.second;
+	}
+#endif
+	return usage;
+}
+
+void MemoryTracker::logUsage() {
+	if (!isEnabled())
+		return;
+	auto mib = [](double bytes) {
+		std::ostringstream ss;
+		ss << std::fixed << std::setprecision(1) << bytes / (1024 * 1024) << " MiB";
+		return ss.str();
+	};
+	std::map<std::string, std::vector<MemoryUsage> > usage = getThreadUsage();
+	LOG(INFO) << "Memory usage of the threads (peak / steady state, allocations):";
+	for (auto it = usage.begin(); it != usage.end(); ++it)
+		for (int i = 0; i <= (int) MemorySubsystem::COUNT; i++) {
+			const MemoryUsage& u = it->second[i];
+			if (u.allocations == 0)
+				continue;
+			LOG(INFO) << "  " << it->first << ", " << getSubsystemName((MemorySubsystem) i)
+					<< ": " << mib(u.peak_bytes) << " / " << mib(u.steady_bytes) << ", "
+					<< u.allocations << " allocations of " << mib(u.allocated_bytes);
+		}
+}
+
+std::string MemoryTracker::getSubsystemName(MemorySubsystem subsystem) {
+	switch (subsystem) {
+	case MemorySubsystem::OTHER:
+		return "other";
+	case MemorySubsystem::CHUNK_CACHE:
+		return "chunk cache";
+	case MemorySubsystem::REGION_BUFFERS:
+		return "region buffers";
+	case MemorySubsystem::BLOCK_IMAGES:
+		return "block images";
+	case MemorySubsystem::TILE_BUFFERS:
+		return "tile buffers";
+	case MemorySubsystem::TILE_SETS:
+		return "tile sets";
+	default:
+		return "total";
+	}
+}
+
+} /* namespace util */
+} /* namespace mapcrafter */
+
+#ifdef OPT_MEMORY_TRACKING
+
+// gcc warns about freeing memory of operator new, but allocate() uses malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+	void* pointer = mapcrafter::util::allocate(size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return mapcrafter::util::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return mapcrafter::util::allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+	mapcrafter::util::deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	mapcrafter::util::deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	mapcrafter::util::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+	mapcrafter::util::deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	mapcrafter::util::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	mapcrafter::util::deallocate(pointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#  pragma GCC diagnostic pop
+#endif
+
+#endif
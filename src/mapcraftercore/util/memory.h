@@ -0,0 +1,311 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include "../config.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mapcrafter {
+namespace util {
+
+/**
+ * A minimal allocator for std containers which returns memory aligned to Alignment
+ * bytes (which must be a power of two). The memory is obtained from ::operator new with
+ * some extra space, the offset to the original pointer is stored in the bytes right
+ * before the aligned pointer.
+ */
+template <typename T, std::size_t Alignment>
+class AlignedAllocator {
+public:
+	static_assert(Alignment >= sizeof(void*) && (Alignment & (Alignment - 1)) == 0,
+			"Alignment must be a power of two and at least the size of a pointer");
+
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(std::size_t n) {
+		if (n > (SIZE_MAX - Alignment) / sizeof(T))
+			throw std::bad_alloc();
+		char* raw = static_cast<char*>(::operator new(n * sizeof(T) + Alignment));
+		// there is always at least sizeof(void*) space in front of the aligned pointer
+		char* aligned = raw + Alignment
+				- (reinterpret_cast<std::uintptr_t>(raw) & (Alignment - 1));
+		reinterpret_cast<char**>(aligned)[-1] = raw;
+		return reinterpret_cast<T*>(aligned);
+	}
+
+	void deallocate(T* p, std::size_t) {
+		if (p != nullptr)
+			::operator delete(reinterpret_cast<char**>(p)[-1]);
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const {
+		return false;
+	}
+};
+
+/**
+ * An allocator for std containers which default-initializes the elements instead of
+ * value-initializing them, so resizing a vector of bytes leaves the new bytes
+ * uninitialized instead of zeroing them. For buffers which are overwritten anyway.
+ */
+template <typename T>
+class DefaultInitAllocator : public std::allocator<T> {
+public:
+	template <typename U>
+	struct rebind {
+		typedef DefaultInitAllocator<U> other;
+	};
+
+	DefaultInitAllocator() {}
+	template <typename U>
+	DefaultInitAllocator(const DefaultInitAllocator<U>&) {}
+
+	template <typename U>
+	void construct(U* p) {
+		::new (static_cast<void*>(p)) U;
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) {
+		::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+	}
+};
+
+/**
+ * A process-wide pool for the large, long-lived buffers which are accessed randomly
+ * (the decoded chunks of the chunk caches, the block images and the images of the
+ * tiles), to save TLB misses. Once it's enabled, the buffers come from blocks of 2 MiB
+ * huge pages: Explicit huge pages (MAP_HUGETLB) if the system has reserved some,
+ * transparent huge pages (madvise with MADV_HUGEPAGE) otherwise. The buffers are
+ * rounded up to size classes, the freed ones are reused for buffers of the same class
+ * and the blocks are never returned to the system. Without mmap (or until it's
+ * enabled) the buffers are allocated with operator new, see ArenaAllocator. Every size
+ * class has an own lock, and the buffers are recognized as buffers of the arena without
+ * a lock. The arena maps at most 64 GiB.
+ *
+ * The memory tracking counts only the bookkeeping of the arena, not its blocks.
+ */
+class HugePageArena {
+public:
+	/**
+	 * Enables/disables allocating from the arena. The buffers allocated before are
+	 * still freed correctly. Returns false if huge pages are not supported here.
+	 */
+	static bool setEnabled(bool enabled);
+	static bool isEnabled();
+
+	/**
+	 * Allocates a buffer (aligned to ALIGNMENT bytes) from the arena. Throws
+	 * std::bad_alloc if no memory could be mapped.
+	 */
+	static void* allocate(std::size_t size);
+
+	/**
+	 * Returns a buffer of the specified size to the arena, if it was allocated from the
+	 * arena. Returns false (and does nothing) otherwise.
+	 */
+	static bool deallocate(void* p, std::size_t size);
+
+	/**
+	 * Logs how much memory the arena mapped, with how many explicit huge pages, and how
+	 * much of it is used by buffers at the moment. Nothing is logged if the arena was
+	 * never used.
+	 */
+	static void logUsage();
+
+	// the alignment of the buffers, and the size of the blocks (a huge page)
+	static const std::size_t ALIGNMENT = 64;
+	static const std::size_t BLOCK_SIZE = 2 * 1024 * 1024;
+};
+
+/**
+ * An allocator for std containers which allocates from the huge page arena if it's
+ * enabled, and like AlignedAllocator with an alignment of HugePageArena::ALIGNMENT
+ * otherwise.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator() {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>&) {}
+
+	T* allocate(std::size_t n) {
+		if (!HugePageArena::isEnabled())
+			return Fallback().allocate(n);
+		if (n > SIZE_MAX / sizeof(T))
+			throw std::bad_alloc();
+		return static_cast<T*>(HugePageArena::allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		if (!HugePageArena::deallocate(p, n * sizeof(T)))
+			Fallback().deallocate(p, n);
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>&) const {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>&) const {
+		return false;
+	}
+
+private:
+	typedef AlignedAllocator<T, HugePageArena::ALIGNMENT> Fallback;
+};
+
+/**
+ * The subsystems the allocations are counted for by the memory tracking.
+ */
+enum class MemorySubsystem {
+	// everything else
+	OTHER,
+	// the decoded chunks, in the chunk caches
+	CHUNK_CACHE,
+	// the headers and the (compressed) chunk data of the region files
+	REGION_BUFFERS,
+	// the loaded textures and the generated block images
+	BLOCK_IMAGES,
+	// the images of the tiles being rendered, composited and encoded
+	TILE_BUFFERS,
+	// the render and composite tiles of the tile sets
+	TILE_SETS,
+	COUNT
+};
+
+/**
+ * The memory usage of a thread for a subsystem.
+ */
+struct MemoryUsage {
+	MemoryUsage();
+
+	// count and bytes of all allocations
+	uint64_t allocations, allocated_bytes;
+	// bytes allocated and not freed yet now and at most, freed memory is subtracted from
+	// the thread which allocated it
+	int64_t live_bytes, peak_bytes;
+	// the average of the live bytes while the usage was sampled
+	double steady_bytes;
+};
+
+/**
+ * Counts the allocations of all threads per subsystem, if Mapcrafter is built with the
+ * OPT_MEMORY_TRACKING cmake option. The global operator new and delete are replaced
+ * then, they count every allocation for the subsystem of the innermost MemoryScope of
+ * the calling thread. There is no overhead without the build option.
+ */
+class MemoryTracker {
+public:
+	/**
+	 * Returns whether the memory tracking is built in.
+	 */
+	static bool isEnabled();
+
+	/**
+	 * Sets the name of the calling thread, the usage of threads with the same name is
+	 * reported together.
+	 */
+	static void setThreadName(const std::string& name);
+
+	/**
+	 * Starts/stops a background thread which samples the live bytes every interval
+	 * milliseconds, to get the steady state usage. The sampling can be started multiple
+	 * times, it's stopped once it's stopped as often as it was started.
+	 */
+	static void startSampling(int interval = 100);
+	static void stopSampling();
+
+	/**
+	 * Returns the usage of every subsystem (indexed by MemorySubsystem, and the total at
+	 * index MemorySubsystem::COUNT) of the threads: thread name -> usage.
+	 */
+	static std::map<std::string, std::vector<MemoryUsage> > getThreadUsage();
+
+	/**
+	 * Logs the peak and steady state usage of the threads per subsystem.
+	 */
+	static void logUsage();
+
+	/**
+	 * Returns the name of a subsystem for the log output.
+	 */
+	static std::string getSubsystemName(MemorySubsystem subsystem);
+};
+
+/**
+ * Counts the allocations of the calling thread from its construction until its
+ * destruction for a subsystem.
+ */
+class MemoryScope {
+public:
+#ifdef OPT_MEMORY_TRACKING
+	explicit MemoryScope(MemorySubsystem subsystem);
+	~MemoryScope();
+#else
+	explicit MemoryScope(MemorySubsystem) {}
+#endif
+
+	MemoryScope(const MemoryScope&) = delete;
+	MemoryScope& operator=(const MemoryScope&) = delete;
+
+#ifdef OPT_MEMORY_TRACKING
+private:
+	MemorySubsystem previous;
+#endif
+};
+
+} /* namespace util */
+} /* namespace mapcrafter */
+
+#endif /* MEMORY_H_ */
@@ -22,6 +22,8 @@
 #include "../config.h"
 
 #include <cctype>
+#include <cstdlib>
+#include <fstream>
 
 #ifdef HAVE_ENDIAN_H
 # ifdef ENDIAN_H_FREEBSD
@@ -31,6 +33,11 @@
 # endif
 #endif
 
+#ifdef HAVE_UNISTD_H
+# include <sys/resource.h>
+# include <unistd.h>
+#endif
+
 namespace mapcrafter {
 namespace util {
 
@@ -211,5 +218,49 @@ bool endswith(const std::string& str, const std::string& end) {
 	return str.substr(str.size() - end.size(), end.size()) == end;
 }
 
+size_t getPeakMemoryUsage() {
+#ifdef HAVE_UNISTD_H
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+# ifdef __APPLE__
+	// bytes on Mac OS, kilobytes on the other systems
+	return usage.ru_maxrss;
+# else
+	return usage.ru_maxrss * 1024;
+# endif
+#else
+	return 0;
+#endif
+}
+
+size_t getMemoryUsage() {
+#ifdef HAVE_UNISTD_H
+	// the second field is the resident set size in pages (on Linux only)
+	std::ifstream statm("/proc/self/statm");
+	size_t size, resident;
+	if (statm >> size >> resident)
+		return resident * sysconf(_SC_PAGESIZE);
+#endif
+	return 0;
+}
+
+double getLoadAverage() {
+#ifdef HAVE_UNISTD_H
+	double load[1];
+	if (getloadavg(load, 1) == 1)
+		return load[0];
+#endif
+	return -1;
+}
+
+bool lowerProcessPriority() {
+#ifdef HAVE_UNISTD_H
+	return setpriority(PRIO_PROCESS, 0, 19) == 0;
+#else
+	return false;
+#endif
+}
+
 } /* namespace util */
 } /* namespace mapcrafter */
@@ -94,6 +94,30 @@ std::string replaceAll(const std::string& str, const std::string& from, const st
 bool startswith(const std::string& str, const std::string& start);
 bool endswith(const std::string& str, const std::string& end);
 
+/**
+ * Returns the peak memory usage (resident set size in bytes) of this process, or 0 if
+ * it is not available on this platform.
+ */
+size_t getPeakMemoryUsage();
+
+/**
+ * Returns the current memory usage (resident set size in bytes) of this process, or 0
+ * if it is not available on this platform.
+ */
+size_t getMemoryUsage();
+
+/**
+ * Returns the load average of the system of the last minute, or -1 if it is not
+ * available on this platform.
+ */
+double getLoadAverage();
+
+/**
+ * Gives this process the lowest scheduling priority, so it only uses the CPU time the
+ * other processes don't need. Returns false if that is not possible on this platform.
+ */
+bool lowerProcessPriority();
+
 /**
  * TODO this is unused, maybe use it for the config option values? ... or remove it
  */
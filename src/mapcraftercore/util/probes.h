@@ -0,0 +1,94 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROBES_H_
+#define PROBES_H_
+
+#include "../config.h"
+
+/**
+ * Static tracepoints (USDT probes) of the provider "mapcrafter" on the hot paths of
+ * the rendering, for tools like bpftrace and perf which attach to them in a running
+ * process:
+ *
+ *   bpftrace -e 'usdt:./mapcrafter:mapcrafter:tile__render__end { ... }'
+ *
+ * They are only built in with the option OPT_USDT (which needs <sys/sdt.h> of
+ * SystemTap), otherwise the macros expand to nothing. A built-in probe is a single nop
+ * instruction while nothing is attached to it, the arguments are only evaluated, so
+ * they should be cheap (numbers and C strings which exist anyway).
+ *
+ * The probes with their arguments:
+ *
+ * - region__read__start(filename, x, z), region__read__end(filename, x, z, bytes):
+ *   reading the sectors of a chunk from a region file (x/z are the local coordinates of
+ *   the chunk in the region, bytes is 0 if reading failed)
+ * - chunk__load__start(x, z), chunk__load__end(x, z, status): decoding a chunk (status
+ *   is the one of RegionFile::loadChunk)
+ * - region__cache__hit(x, z), region__cache__miss(x, z): looking up a region in the
+ *   cache of a world cache, a miss reads the region headers
+ * - chunk__cache__hit(x, z, level), chunk__cache__miss(x, z): looking up a chunk in the
+ *   caches of a world cache, level is the cache which had the chunk (see ChunkCacheLevel)
+ * - tile__render__start(tile), tile__render__end(tile, blocks): rendering a render tile
+ *   (tile is the tile path as string, blocks the count of drawn blocks)
+ * - composite__start(tile), composite__end(tile): composing a composite tile
+ * - encode__start(format), encode__end(format, bytes): encoding the image of a tile
+ *   (format is a config::ImageFormat, bytes is 0 if encoding failed)
+ * - write__start(tile), write__end(tile, written): writing a tile with its outputs
+ *   (written is 0 if the tile is unchanged or could not be written)
+ */
+
+#ifdef OPT_USDT
+#  include <sys/sdt.h>
+#  define MAPCRAFTER_PROBE(name) DTRACE_PROBE(mapcrafter, name)
+#  define MAPCRAFTER_PROBE1(name, a) DTRACE_PROBE1(mapcrafter, name, a)
+#  define MAPCRAFTER_PROBE2(name, a, b) DTRACE_PROBE2(mapcrafter, name, a, b)
+#  define MAPCRAFTER_PROBE3(name, a, b, c) DTRACE_PROBE3(mapcrafter, name, a, b, c)
+#  define MAPCRAFTER_PROBE4(name, a, b, c, d) DTRACE_PROBE4(mapcrafter, name, a, b, c, d)
+#else
+#  define MAPCRAFTER_PROBE(name)
+#  define MAPCRAFTER_PROBE1(name, a)
+#  define MAPCRAFTER_PROBE2(name, a, b)
+#  define MAPCRAFTER_PROBE3(name, a, b, c)
+#  define MAPCRAFTER_PROBE4(name, a, b, c, d)
+#endif
+
+namespace mapcrafter {
+namespace util {
+
+/**
+ * The cache of a world cache which had a chunk, the level of chunk__cache__hit.
+ */
+enum class ChunkCacheLevel {
+	// the cache of the world cache itself
+	LOCAL = 0,
+	// the chunk cache shared by the threads
+	SHARED = 1,
+	// the cache of the chunks in the original rotation of the world
+	ROTATION = 2,
+	// the cache of the compacted evicted chunks
+	COMPRESSED = 3,
+	// the chunk cache shared by the processes in shared memory
+	SHARED_MEMORY = 4
+};
+
+}
+}
+
+#endif /* PROBES_H_ */
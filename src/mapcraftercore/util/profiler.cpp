@@ -0,0 +1,348 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "profiler.h"
+
+#include "memory.h"
+#include "../config.h"
+#include "../compat/thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+namespace mapcrafter {
+namespace util {
+
+namespace {
+
+const char* STAGE_NAMES[] = {"chunk cache", "region I/O", "inflate", "NBT decode",
+	"block iteration", "render mode", "blitting", "composite", "tile reads", "encoding",
+	"writing"};
+const char* STAGE_KEYS[] = {"chunkCache", "regionIO", "inflate", "nbtDecode",
+	"blockIteration", "renderMode", "blit", "composite", "tileRead", "encode", "write"};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == (int) ProfileStage::COUNT,
+		"Every stage needs a name");
+
+/**
+ * An event of a trace scope, the times are in nanoseconds since tracing was enabled.
+ */
+struct TraceEvent {
+	const char* name;
+	std::string detail;
+	int64_t start, duration;
+};
+
+/**
+ * The times of one thread. Only the thread itself writes them, so relaxed loads and
+ * stores are enough to read them from other threads.
+ */
+struct ThreadProfile {
+	ThreadProfile(const std::string& name, int id)
+		: name(name), id(id), current(nullptr) {
+		for (int i = 0; i < (int) ProfileStage::COUNT; i++) {
+			nanoseconds[i] = 0;
+			calls[i] = 0;
+		}
+		for (int i = 0; i < (int) Metric::COUNT; i++)
+			metrics[i] = 0;
+	}
+
+	std::string name;
+	// the thread id of the trace events
+	int id;
+	std::atomic<uint64_t> nanoseconds[(int) ProfileStage::COUNT];
+	std::atomic<uint64_t> calls[(int) ProfileStage::COUNT];
+	std::atomic<uint64_t> metrics[(int) Metric::COUNT];
+	// the innermost scope of the thread
+	ProfileScope* current;
+
+	// the trace events are written by other threads, so they need a lock
+	thread_ns::mutex events_mutex;
+	std::vector<TraceEvent> events;
+};
+
+// the profiles of all threads which entered a scope, kept after the threads finished
+thread_ns::mutex profiles_mutex;
+std::vector<std::shared_ptr<ThreadProfile> > profiles;
+
+// when tracing was enabled, the time of the trace events is relative to it
+std::chrono::steady_clock::time_point trace_start;
+
+#ifdef HAVE_THREAD_LOCAL
+thread_local std::string thread_name = "other";
+thread_local ThreadProfile* thread_profile = nullptr;
+
+ThreadProfile& getThreadProfile() {
+	if (thread_profile == nullptr) {
+		thread_ns::unique_lock<thread_ns::mutex> lock(profiles_mutex);
+		std::shared_ptr<ThreadProfile> profile = std::make_shared<ThreadProfile>(
+				thread_name, profiles.size() + 1);
+		profiles.push_back(profile);
+		thread_profile = profile.get();
+	}
+	return *thread_profile;
+}
+#endif
+
+/**
+ * Writes a string as JSON string, the names and details of the events are plain text.
+ */
+void writeJSONString(std::ostream& out, const std::string& str) {
+	out << '"';
+	for (size_t i = 0; i < str.size(); i++) {
+		if (str[i] == '"' || str[i] == '\\')
+			out << '\\';
+		if (str[i] >= 0 && str[i] < ' ')
+			out << ' ';
+		else
+			out << str[i];
+	}
+	out << '"';
+}
+
+}
+
+ThreadMetrics::ThreadMetrics() {
+	for (int i = 0; i < (int) Metric::COUNT; i++)
+		values[i] = 0;
+}
+
+ThreadMetrics& ThreadMetrics::operator+=(const ThreadMetrics& other) {
+	for (int i = 0; i < (int) Metric::COUNT; i++)
+		values[i] += other.values[i];
+	return *this;
+}
+
+const char* getProfileStageName(ProfileStage stage) {
+	return STAGE_NAMES[(int) stage];
+}
+
+const char* getProfileStageKey(ProfileStage stage) {
+	return STAGE_KEYS[(int) stage];
+}
+
+ProfileTimes::ProfileTimes() {
+	for (int i = 0; i < (int) ProfileStage::COUNT; i++) {
+		seconds[i] = 0;
+		calls[i] = 0;
+	}
+}
+
+ProfileTimes& ProfileTimes::operator+=(const ProfileTimes& other) {
+	for (int i = 0; i < (int) ProfileStage::COUNT; i++) {
+		seconds[i] += other.seconds[i];
+		calls[i] += other.calls[i];
+	}
+	return *this;
+}
+
+ProfileTimes& ProfileTimes::operator-=(const ProfileTimes& other) {
+	for (int i = 0; i < (int) ProfileStage::COUNT; i++) {
+		seconds[i] -= other.seconds[i];
+		calls[i] -= other.calls[i];
+	}
+	return *this;
+}
+
+double ProfileTimes::getTotal() const {
+	double total = 0;
+	for (int i = 0; i < (int) ProfileStage::COUNT; i++)
+		total += seconds[i];
+	return total;
+}
+
+bool Profiler::enabled = false;
+
+bool Profiler::setEnabled(bool enabled) {
+#ifdef HAVE_THREAD_LOCAL
+	Profiler::enabled = enabled;
+	return true;
+#else
+	return !enabled;
+#endif
+}
+
+bool Profiler::isEnabled() {
+	return enabled;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+#ifdef HAVE_THREAD_LOCAL
+	thread_name = name;
+#endif
+	MemoryTracker::setThreadName(name);
+}
+
+std::map<std::string, ProfileTimes> Profiler::getThreadTimes() {
+	std::map<std::string, ProfileTimes> times;
+	thread_ns::unique_lock<thread_ns::mutex> lock(profiles_mutex);
+	for (auto it = profiles.begin(); it != profiles.end(); ++it) {
+		ProfileTimes& thread_times = times[(*it)->name];
+		for (int i = 0; i < (int) ProfileStage::COUNT; i++) {
+			thread_times.seconds[i] += (*it)->nanoseconds[i].load(std::memory_order_relaxed)
+					/ 1e9;
+			thread_times.calls[i] += (*it)->calls[i].load(std::memory_order_relaxed);
+		}
+	}
+	return times;
+}
+
+bool Profiler::tracing = false;
+
+bool Profiler::setTracing(bool tracing) {
+#ifdef HAVE_THREAD_LOCAL
+	if (tracing && !Profiler::tracing)
+		trace_start = std::chrono::steady_clock::now();
+	Profiler::tracing = tracing;
+	return true;
+#else
+	return !tracing;
+#endif
+}
+
+bool Profiler::isTracing() {
+	return tracing;
+}
+
+bool Profiler::writeTrace(const std::string& filename) {
+	std::ofstream out(filename);
+	if (!out)
+		return false;
+	// the times are in microseconds, with the nanoseconds as decimals
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	thread_ns::unique_lock<thread_ns::mutex> lock(profiles_mutex);
+	for (auto it = profiles.begin(); it != profiles.end(); ++it) {
+		ThreadProfile& profile = **it;
+		out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				<< "\"tid\":" << profile.id << ",\"args\":{\"name\":";
+		writeJSONString(out, profile.name);
+		out << "}}";
+		first = false;
+
+		thread_ns::unique_lock<thread_ns::mutex> events_lock(profile.events_mutex);
+		for (auto event_it = profile.events.begin(); event_it != profile.events.end();
+				++event_it) {
+			out << ",\n{\"name\":";
+			writeJSONString(out, event_it->name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << profile.id
+					<< ",\"ts\":" << event_it->start / 1000.0
+					<< ",\"dur\":" << event_it->duration / 1000.0;
+			if (!event_it->detail.empty()) {
+				out << ",\"args\":{\"detail\":";
+				writeJSONString(out, event_it->detail);
+				out << "}";
+			}
+			out << "}";
+		}
+	}
+	out << "\n]}\n";
+	out.close();
+	return !out.fail();
+}
+
+bool Profiler::metrics = false;
+std::atomic<int64_t> Profiler::gauges[(int) Gauge::COUNT];
+
+bool Profiler::setMetrics(bool metrics) {
+#ifdef HAVE_THREAD_LOCAL
+	Profiler::metrics = metrics;
+	return true;
+#else
+	return !metrics;
+#endif
+}
+
+bool Profiler::hasMetrics() {
+	return metrics;
+}
+
+std::map<std::string, ThreadMetrics> Profiler::getThreadMetrics() {
+	std::map<std::string, ThreadMetrics> metrics;
+	thread_ns::unique_lock<thread_ns::mutex> lock(profiles_mutex);
+	for (auto it = profiles.begin(); it != profiles.end(); ++it) {
+		ThreadMetrics& thread_metrics = metrics[(*it)->name];
+		for (int i = 0; i < (int) Metric::COUNT; i++)
+			thread_metrics.values[i] += (*it)->metrics[i].load(std::memory_order_relaxed);
+	}
+	return metrics;
+}
+
+int64_t Profiler::getGauge(Gauge gauge) {
+	return gauges[(int) gauge].load(std::memory_order_relaxed);
+}
+
+void Profiler::addThreadMetric(Metric metric, uint64_t value) {
+#ifdef HAVE_THREAD_LOCAL
+	std::atomic<uint64_t>& counter = getThreadProfile().metrics[(int) metric];
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+#endif
+}
+
+void ProfileScope::begin() {
+#ifdef HAVE_THREAD_LOCAL
+	ThreadProfile& profile = getThreadProfile();
+	parent = profile.current;
+	profile.current = this;
+	start = std::chrono::steady_clock::now();
+#endif
+}
+
+void ProfileScope::end() {
+#ifdef HAVE_THREAD_LOCAL
+	int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	ThreadProfile& profile = *thread_profile;
+	int index = (int) stage;
+	profile.nanoseconds[index].store(profile.nanoseconds[index].load(
+			std::memory_order_relaxed) + std::max<int64_t>(elapsed - children, 0),
+			std::memory_order_relaxed);
+	profile.calls[index].store(profile.calls[index].load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+	if (parent != nullptr)
+		parent->children += elapsed;
+	profile.current = parent;
+#endif
+}
+
+void TraceScope::end() {
+#ifdef HAVE_THREAD_LOCAL
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	TraceEvent event;
+	event.name = name;
+	event.detail = detail;
+	event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			start - trace_start).count();
+	event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			now - start).count();
+	ThreadProfile& profile = getThreadProfile();
+	thread_ns::unique_lock<thread_ns::mutex> lock(profile.events_mutex);
+	profile.events.push_back(event);
+#endif
+}
+
+} /* namespace util */
+} /* namespace mapcrafter */
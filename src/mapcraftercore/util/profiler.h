@@ -0,0 +1,296 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace mapcrafter {
+namespace util {
+
+/**
+ * The stages of the rendering the profiler measures the time of.
+ */
+enum class ProfileStage {
+	// looking up chunks in the caches of a world cache, rotating cached chunks
+	CHUNK_CACHE,
+	// reading the data of chunks from the region files
+	REGION_IO,
+	// decompressing the data of chunks
+	INFLATE,
+	// decoding the NBT data of chunks
+	NBT_DECODE,
+	// iterating over the blocks of render tiles
+	BLOCK_ITERATION,
+	// the render modes hiding and drawing the blocks
+	RENDER_MODE,
+	// blitting the block images onto render tiles
+	BLIT,
+	// composing the composite tiles of their downsampled children
+	COMPOSITE,
+	// reading (and decoding) already rendered tiles
+	TILE_READ,
+	// encoding the images of tiles and thumbnails
+	ENCODE,
+	// writing tiles to the tile stores, waiting for the tile writer
+	WRITE,
+
+	COUNT
+};
+
+/**
+ * The counters of the metrics of a long running rendering, they are counted per thread.
+ */
+enum class Metric {
+	// the rendered render tiles and composite tiles
+	RENDER_TILES,
+	COMPOSITE_TILES,
+	// the chunks found in the chunk caches, and the ones loaded from the region files
+	CHUNK_CACHE_HITS,
+	CHUNK_CACHE_MISSES,
+	// the size of the (compressed) chunk data loaded from the region files
+	CHUNK_BYTES_READ,
+	// the size of the encoded tiles written to the tile stores
+	TILE_BYTES_WRITTEN,
+	// the render tiles found in the tile cache, and the ones rendered for it
+	TILE_CACHE_HITS,
+	TILE_CACHE_MISSES,
+	// the nanoseconds the thread was busy rendering (or writing tiles)
+	BUSY_TIME,
+
+	COUNT
+};
+
+/**
+ * The gauges of the metrics (counted by all threads together).
+ */
+enum class Gauge {
+	// the render work waiting to be rendered
+	QUEUED_WORK,
+	// the tiles waiting to be written by the tile writers
+	QUEUED_TILES,
+
+	COUNT
+};
+
+/**
+ * The value of every metric of a thread (or of threads together).
+ */
+struct ThreadMetrics {
+	ThreadMetrics();
+
+	ThreadMetrics& operator+=(const ThreadMetrics& other);
+
+	uint64_t values[(int) Metric::COUNT];
+};
+
+/**
+ * Returns the human readable name / the name in the JSON files of a stage.
+ */
+const char* getProfileStageName(ProfileStage stage);
+const char* getProfileStageKey(ProfileStage stage);
+
+/**
+ * The time spent in every stage (excluding the time spent in other stages called from
+ * it) and how often it was entered.
+ */
+struct ProfileTimes {
+	ProfileTimes();
+
+	ProfileTimes& operator+=(const ProfileTimes& other);
+	ProfileTimes& operator-=(const ProfileTimes& other);
+
+	/**
+	 * Returns the time spent in all stages.
+	 */
+	double getTotal() const;
+
+	double seconds[(int) ProfileStage::COUNT];
+	uint64_t calls[(int) ProfileStage::COUNT];
+};
+
+/**
+ * Measures how much time each thread spends in the stages of the rendering. The code
+ * of a stage is marked with a ProfileScope, the profiler is disabled by default and
+ * the scopes do nothing then. It also records trace events and counts the metrics of
+ * the threads, each if enabled.
+ */
+class Profiler {
+public:
+	/**
+	 * Enables/Disables the profiler, this should be done before any threads use it.
+	 * Returns false if the profiler is not supported (without thread_local).
+	 */
+	static bool setEnabled(bool enabled);
+	static bool isEnabled();
+
+	/**
+	 * Sets the name the times of the calling thread are reported with, threads with the
+	 * same name are reported together. This has to be called before the thread enters
+	 * a scope, the threads without a name are called "other".
+	 */
+	static void setThreadName(const std::string& name);
+
+	/**
+	 * Returns the times of all threads so far, by thread name.
+	 */
+	static std::map<std::string, ProfileTimes> getThreadTimes();
+
+	/**
+	 * Enables/Disables recording the trace events of the TraceScopes, independent of
+	 * the profiling. Returns false if tracing is not supported (without thread_local).
+	 */
+	static bool setTracing(bool tracing);
+	static bool isTracing();
+
+	/**
+	 * Writes the trace events recorded so far in the trace event format of Chrome, which
+	 * chrome://tracing and Perfetto can show as timeline of every thread.
+	 */
+	static bool writeTrace(const std::string& filename);
+
+	/**
+	 * Enables/Disables counting the metrics and gauges. Returns false if the metrics are
+	 * not supported (without thread_local).
+	 */
+	static bool setMetrics(bool metrics);
+	static bool hasMetrics();
+
+	/**
+	 * Adds to a metric of the calling thread / to a gauge, if the metrics are enabled.
+	 */
+	static void addMetric(Metric metric, uint64_t value = 1) {
+		if (metrics)
+			addThreadMetric(metric, value);
+	}
+
+	static void addGauge(Gauge gauge, int64_t value) {
+		if (metrics)
+			gauges[(int) gauge].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returns the metrics of all threads so far, by thread name.
+	 */
+	static std::map<std::string, ThreadMetrics> getThreadMetrics();
+
+	/**
+	 * Returns the current value of a gauge.
+	 */
+	static int64_t getGauge(Gauge gauge);
+
+private:
+	static void addThreadMetric(Metric metric, uint64_t value);
+
+	static bool enabled;
+	static bool tracing;
+	static bool metrics;
+	static std::atomic<int64_t> gauges[(int) Gauge::COUNT];
+
+	friend class ProfileScope;
+	friend class TraceScope;
+};
+
+/**
+ * Adds the time from its construction until its destruction to a stage of the calling
+ * thread, the time of the scopes created meanwhile is subtracted.
+ */
+class ProfileScope {
+public:
+	explicit ProfileScope(ProfileStage stage)
+		: stage(stage), parent(nullptr), children(0), active(Profiler::enabled) {
+		if (active)
+			begin();
+	}
+
+	~ProfileScope() {
+		if (active)
+			end();
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	void begin();
+	void end();
+
+	ProfileStage stage;
+	ProfileScope* parent;
+	std::chrono::steady_clock::time_point start;
+	// the time of the direct child scopes in nanoseconds
+	int64_t children;
+	bool active;
+};
+
+/**
+ * Records a trace event with a name (of static storage duration) from its construction
+ * until its destruction for the calling thread, if tracing is enabled. Unlike the
+ * profile scopes, these are meant for the coarse units of work only, like tiles and
+ * chunks, because every single event is kept.
+ */
+class TraceScope {
+public:
+	explicit TraceScope(const char* name)
+		: name(name), active(Profiler::tracing) {
+		if (active)
+			start = std::chrono::steady_clock::now();
+	}
+
+	~TraceScope() {
+		if (active)
+			end();
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	/**
+	 * Returns whether the event is recorded, so the details are only built if necessary.
+	 */
+	bool isActive() const {
+		return active;
+	}
+
+	/**
+	 * Sets details shown with the event, for example the path of a tile.
+	 */
+	void setDetail(const std::string& detail) {
+		this->detail = detail;
+	}
+
+private:
+	void end();
+
+	const char* name;
+	std::string detail;
+	std::chrono::steady_clock::time_point start;
+	bool active;
+};
+
+} /* namespace util */
+} /* namespace mapcrafter */
+
+#endif /* PROFILER_H_ */
@@ -21,10 +21,13 @@
 
 #include "logging.h"
 #include "other.h"
+#include "profiler.h"
 #include "../compat/nullptr.h"
 
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <cmath>
 #include <cstdio>
 #include <ctime>
@@ -124,6 +127,49 @@ void DummyProgressHandler::setValue(int value) {
 	this->value = value;
 }
 
+ChildProgressHandler::ChildProgressHandler(IProgressHandler* parent,
+		thread_ns::mutex& parent_mutex)
+	: parent(parent), parent_mutex(parent_mutex) {
+}
+
+ChildProgressHandler::~ChildProgressHandler() {
+}
+
+void ChildProgressHandler::setMax(int max) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(parent_mutex);
+	parent->setMax(parent->getMax() + max - this->max);
+	this->max = max;
+}
+
+void ChildProgressHandler::setValue(int value) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(parent_mutex);
+	parent->setValue(parent->getValue() + value - this->value);
+	this->value = value;
+}
+
+AtomicProgressHandler::AtomicProgressHandler()
+	: max(0), value(0) {
+}
+
+AtomicProgressHandler::~AtomicProgressHandler() {
+}
+
+int AtomicProgressHandler::getMax() const {
+	return max.load(std::memory_order_relaxed);
+}
+
+void AtomicProgressHandler::setMax(int max) {
+	this->max.store(max, std::memory_order_relaxed);
+}
+
+int AtomicProgressHandler::getValue() const {
+	return value.load(std::memory_order_relaxed);
+}
+
+void AtomicProgressHandler::setValue(int value) {
+	this->value.store(value, std::memory_order_relaxed);
+}
+
 AbstractOutputProgressHandler::AbstractOutputProgressHandler()
 	: start(std::time(nullptr)), last_update(0), last_value(0), last_percentage(0) {
 }
@@ -173,17 +219,19 @@ LogOutputProgressHandler::~LogOutputProgressHandler() {
 
 void LogOutputProgressHandler::update(double percentage, double average_speed,
 		int eta) {
-	if (percentage < last_step + 5)
+	// the completion is always logged, also right after another step
+	if (percentage < last_step + 5 && value != max)
 		return;
 	last_step = percentage;
 
 	// TODO maybe make it possible to specify a format?
-	auto log = LOGN(INFO, "progress");
-	log << std::floor(percentage) << "% complete. ";
-	log << "Processed " << value << "/" << max << " items ";
-	log << "with average " << std::setprecision(1) << std::fixed << average_speed << "/s.";
+	std::string eta_str;
 	if (eta != -1)
-		log << " ETA " << util::format_eta(eta) << ".";
+		eta_str = " ETA " + util::format_eta(eta) + ".";
+	LOGN(INFO, "progress") << std::floor(percentage) << "% complete. "
+			<< "Processed " << value << "/" << max << " items "
+			<< "with average " << std::setprecision(1) << std::fixed << average_speed << "/s."
+			<< eta_str;
 }
 
 ProgressBar::ProgressBar()
@@ -276,5 +324,122 @@ void ProgressBar::finish() {
 	std::cout << std::endl;
 }
 
+namespace {
+
+// the names and descriptions of the metrics in the metrics file
+const char* METRIC_NAMES[][2] = {
+	{"render_tiles_total", "Rendered render tiles."},
+	{"composite_tiles_total", "Rendered composite tiles."},
+	{"chunk_cache_hits_total", "Chunks found in the chunk caches."},
+	{"chunk_cache_misses_total", "Chunks loaded from the region files."},
+	{"chunk_read_bytes_total", "Size of the chunk data loaded from the region files."},
+	{"tile_written_bytes_total", "Size of the encoded tiles written."},
+	{"tile_cache_hits_total", "Render tiles found in the tile cache."},
+	{"tile_cache_misses_total", "Render tiles rendered for the tile cache."},
+};
+
+static_assert(sizeof(METRIC_NAMES) / sizeof(METRIC_NAMES[0]) == (int) Metric::BUSY_TIME,
+		"Every metric except the busy time needs a name");
+
+const char* GAUGE_NAMES[][2] = {
+	{"queued_work", "Render work waiting to be rendered."},
+	{"queued_tiles", "Tiles waiting to be written."},
+};
+
+void writeMetric(std::ostream& out, const std::string& name, const std::string& type,
+		const std::string& help, double value) {
+	out << "# HELP mapcrafter_" << name << " " << help << std::endl;
+	out << "# TYPE mapcrafter_" << name << " " << type << std::endl;
+	out << "mapcrafter_" << name << " " << value << std::endl;
+}
+
+}
+
+MetricsFileProgressHandler::MetricsFileProgressHandler(const std::string& filename,
+		int interval)
+	: filename(filename), interval(interval), last_value(0) {
+	start = last_write = std::chrono::steady_clock::now();
+}
+
+MetricsFileProgressHandler::~MetricsFileProgressHandler() {
+	write();
+}
+
+void MetricsFileProgressHandler::setValue(int value) {
+	this->value = value;
+	if (std::chrono::steady_clock::now() - last_write >= std::chrono::seconds(interval)
+			|| value == max)
+		write();
+}
+
+void MetricsFileProgressHandler::write() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration<double>(now - start).count();
+	double since_last_write = std::chrono::duration<double>(now - last_write).count();
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	writeMetric(out, "progress_tiles", "gauge", "Rendered tiles of the current rendering.",
+			value);
+	writeMetric(out, "progress_max_tiles", "gauge", "Tiles of the current rendering.", max);
+	// the speed of the current rendering since its start and since the last write
+	double average_speed = elapsed > 0 ? value / elapsed : 0;
+	writeMetric(out, "tiles_per_second", "gauge",
+			"Rendered tiles per second since the last update.",
+			since_last_write > 0 ? (value - last_value) / since_last_write : 0);
+	writeMetric(out, "average_tiles_per_second", "gauge",
+			"Rendered tiles per second of the current rendering.", average_speed);
+	writeMetric(out, "eta_seconds", "gauge",
+			"Estimated seconds until the current rendering is finished.",
+			average_speed > 0 ? (max - value) / average_speed : -1);
+
+	std::map<std::string, ThreadMetrics> threads = Profiler::getThreadMetrics();
+	ThreadMetrics total;
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+		total += it->second;
+	for (int i = 0; i < (int) Metric::BUSY_TIME; i++)
+		writeMetric(out, METRIC_NAMES[i][0], "counter", METRIC_NAMES[i][1],
+				total.values[i]);
+	uint64_t hits = total.values[(int) Metric::CHUNK_CACHE_HITS];
+	uint64_t misses = total.values[(int) Metric::CHUNK_CACHE_MISSES];
+	writeMetric(out, "chunk_cache_hit_ratio", "gauge",
+			"Ratio of the chunks found in the chunk caches.",
+			hits + misses > 0 ? (double) hits / (hits + misses) : 0);
+	for (int i = 0; i < (int) Gauge::COUNT; i++)
+		writeMetric(out, GAUGE_NAMES[i][0], "gauge", GAUGE_NAMES[i][1],
+				Profiler::getGauge((Gauge) i));
+
+	// the threads with the same name (for example of multiple renderings) are together
+	out << "# HELP mapcrafter_thread_busy_seconds_total Seconds the threads were busy."
+			<< std::endl;
+	out << "# TYPE mapcrafter_thread_busy_seconds_total counter" << std::endl;
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+		out << "mapcrafter_thread_busy_seconds_total{thread=\"" << it->first << "\"} "
+				<< it->second.values[(int) Metric::BUSY_TIME] / 1e9 << std::endl;
+	out << "# HELP mapcrafter_thread_utilization Ratio of the time the threads were busy "
+			"since the last update." << std::endl;
+	out << "# TYPE mapcrafter_thread_utilization gauge" << std::endl;
+	for (auto it = threads.begin(); it != threads.end(); ++it) {
+		uint64_t busy_time = it->second.values[(int) Metric::BUSY_TIME];
+		double utilization = 0;
+		if (since_last_write > 0)
+			utilization = (busy_time - last_busy_time[it->first]) / 1e9 / since_last_write;
+		out << "mapcrafter_thread_utilization{thread=\"" << it->first << "\"} "
+				<< utilization << std::endl;
+		last_busy_time[it->first] = busy_time;
+	}
+
+	last_write = now;
+	last_value = value;
+
+	// the file is replaced at once, so it's never read while it's written
+	std::string tmp_filename = filename + ".tmp";
+	std::ofstream file(tmp_filename);
+	file << out.str();
+	file.close();
+	if (!file || std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+		LOG(WARNING) << "Unable to write the metrics file " << filename << "!";
+}
+
 } /* namespace util */
 } /* namespace mapcrafter */
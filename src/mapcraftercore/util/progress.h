@@ -20,6 +20,12 @@
 #ifndef PROGRESS_H_
 #define PROGRESS_H_
 
+#include "../compat/thread.h"
+
+#include <chrono>
+#include <map>
+
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -81,6 +87,44 @@ protected:
 	int max, value;
 };
 
+/**
+ * The progress handler of one of several tasks which run at the same time. It adds
+ * its progress to a parent progress handler, which shows the combined progress of all
+ * tasks then. The progress handlers of the tasks use the same mutex for the parent.
+ */
+class ChildProgressHandler : public DummyProgressHandler {
+public:
+	ChildProgressHandler(IProgressHandler* parent, thread_ns::mutex& parent_mutex);
+	virtual ~ChildProgressHandler();
+
+	virtual void setMax(int max);
+	virtual void setValue(int value);
+
+protected:
+	IProgressHandler* parent;
+	thread_ns::mutex& parent_mutex;
+};
+
+/**
+ * A progress handler which is updated by one thread and read by other threads without
+ * any locks, for example to sample the progress of multiple render threads
+ * periodically. Only one thread may change the progress.
+ */
+class AtomicProgressHandler : public IProgressHandler {
+public:
+	AtomicProgressHandler();
+	virtual ~AtomicProgressHandler();
+
+	virtual int getMax() const;
+	virtual void setMax(int max);
+
+	virtual int getValue() const;
+	virtual void setValue(int value);
+
+protected:
+	std::atomic<int> max, value;
+};
+
 class AbstractOutputProgressHandler : public DummyProgressHandler {
 public:
 	AbstractOutputProgressHandler();
@@ -132,6 +176,34 @@ private:
 			double speed_average, int eta = -1) const;
 };
 
+/**
+ * Rewrites a file with the progress and the metrics of the rendering (see
+ * util::Profiler) in the text format of Prometheus periodically, for example for the
+ * textfile collector of the Prometheus node exporter. The metrics have to be enabled.
+ */
+class MetricsFileProgressHandler : public DummyProgressHandler {
+public:
+	MetricsFileProgressHandler(const std::string& filename, int interval);
+	virtual ~MetricsFileProgressHandler();
+
+	virtual void setValue(int value);
+
+	/**
+	 * Writes the file now.
+	 */
+	void write();
+
+protected:
+	std::string filename;
+	// the seconds between the writes of the file
+	int interval;
+
+	std::chrono::steady_clock::time_point start, last_write;
+	// the progress and the busy time of the threads of the last write
+	int last_value;
+	std::map<std::string, uint64_t> last_busy_time;
+};
+
 } /* namespace util */
 } /* namespace mapcrafter */
 #endif /* PROGRESS_H_ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "status.h"
+
+#include "logging.h"
+#include "other.h"
+#include "../config.h"
+#include "../compat/thread.h"
+
+#include <map>
+#include <sstream>
+
+#ifdef HAVE_UNISTD_H
+# include <cerrno>
+# include <csignal>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace mapcrafter {
+namespace util {
+
+namespace {
+
+thread_ns::mutex sources_mutex;
+std::map<int, std::function<void (std::ostream&)> > sources;
+int next_source_id = 0;
+
+#if defined(HAVE_UNISTD_H) && defined(SIGUSR1)
+// the signal handler only writes a byte to this pipe (which is async-signal-safe), the
+// reporting thread waits for bytes to read from it, the write end is non-blocking so
+// the handler never blocks when the pipe is full
+int request_pipe[2] = {-1, -1};
+
+void handleSignal(int) {
+	// the write may change errno of the interrupted code
+	int saved_errno = errno;
+	char request = 0;
+	if (write(request_pipe[1], &request, 1) < 0) {
+		// the report is skipped if the pipe is full, a few reports are pending anyway
+	}
+	errno = saved_errno;
+}
+
+void reportLoop() {
+	char request;
+	while (read(request_pipe[0], &request, 1) == 1)
+		StatusReporter::report();
+}
+#endif
+
+}
+
+bool StatusReporter::installSignalHandler() {
+#if defined(HAVE_UNISTD_H) && defined(SIGUSR1)
+	if (request_pipe[0] != -1)
+		return true;
+	if (pipe(request_pipe) != 0)
+		return false;
+	int flags = fcntl(request_pipe[1], F_GETFL);
+	if (flags == -1 || fcntl(request_pipe[1], F_SETFL, flags | O_NONBLOCK) == -1) {
+		close(request_pipe[0]);
+		close(request_pipe[1]);
+		request_pipe[0] = request_pipe[1] = -1;
+		return false;
+	}
+	// the thread runs until the process exits
+	thread_ns::thread(reportLoop).detach();
+	struct sigaction action;
+	action.sa_handler = handleSignal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	return sigaction(SIGUSR1, &action, nullptr) == 0;
+#else
+	return false;
+#endif
+}
+
+int StatusReporter::addSource(const std::function<void (std::ostream&)>& source) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(sources_mutex);
+	sources[next_source_id] = source;
+	return next_source_id++;
+}
+
+void StatusReporter::removeSource(int id) {
+	thread_ns::unique_lock<thread_ns::mutex> lock(sources_mutex);
+	sources.erase(id);
+}
+
+std::vector<std::string> StatusReporter::getReport() {
+	std::ostringstream out;
+	out << "Memory usage: " << getMemoryUsage() / (1024 * 1024) << " MiB (peak "
+			<< getPeakMemoryUsage() / (1024 * 1024) << " MiB)" << std::endl;
+	{
+		// the sources are called with the lock, so they aren't removed meanwhile
+		thread_ns::unique_lock<thread_ns::mutex> lock(sources_mutex);
+		if (sources.empty())
+			out << "Nothing is being rendered." << std::endl;
+		for (auto it = sources.begin(); it != sources.end(); ++it)
+			it->second(out);
+	}
+
+	std::vector<std::string> lines;
+	std::istringstream in(out.str());
+	std::string line;
+	while (std::getline(in, line))
+		lines.push_back(line);
+	return lines;
+}
+
+void StatusReporter::report() {
+	std::vector<std::string> lines = getReport();
+	LOG(INFO) << "Status report:";
+	for (auto it = lines.begin(); it != lines.end(); ++it)
+		LOG(INFO) << "  " << *it;
+}
+
+StatusSource::StatusSource(const std::function<void (std::ostream&)>& source)
+	: id(StatusReporter::addSource(source)) {
+}
+
+StatusSource::~StatusSource() {
+	StatusReporter::removeSource(id);
+}
+
+} /* namespace util */
+} /* namespace mapcrafter */
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATUS_H_
+#define STATUS_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mapcrafter {
+namespace util {
+
+/**
+ * Logs reports of the status of a running rendering on request, for example when the
+ * process gets the signal SIGUSR1. The parts of the rendering add status sources for as
+ * long as they run, each one writes a few lines about what it's doing to the report.
+ *
+ * The reports are logged by a thread of their own, so they're logged even if all render
+ * threads are stuck.
+ */
+class StatusReporter {
+public:
+	/**
+	 * Installs a handler of SIGUSR1 which makes the reporter log a report. Returns false
+	 * if the signal is not supported on this platform.
+	 */
+	static bool installSignalHandler();
+
+	/**
+	 * Adds a status source, a function which writes lines to the report. Returns an id
+	 * to remove the source again.
+	 */
+	static int addSource(const std::function<void (std::ostream&)>& source);
+	static void removeSource(int id);
+
+	/**
+	 * Returns the lines of a report of the memory usage and of all status sources.
+	 */
+	static std::vector<std::string> getReport();
+
+	/**
+	 * Logs a report.
+	 */
+	static void report();
+};
+
+/**
+ * Adds a status source to the status reporter from its construction until its
+ * destruction.
+ */
+class StatusSource {
+public:
+	explicit StatusSource(const std::function<void (std::ostream&)>& source);
+	~StatusSource();
+
+	StatusSource(const StatusSource&) = delete;
+	StatusSource& operator=(const StatusSource&) = delete;
+
+private:
+	int id;
+};
+
+} /* namespace util */
+} /* namespace mapcrafter */
+
+#endif /* STATUS_H_ */
@@ -0,0 +1,6 @@
+#include "version.h"
+namespace mapcrafter {
+const char* MINECRAFT_VERSION = "1.12";
+const char* MAPCRAFTER_VERSION = "2.4";
+const char* MAPCRAFTER_GITVERSION = "";
+};
@@ -18,8 +18,23 @@
  */
 
 #include "../mapcraftercore/renderer/image.h"
+#include "../mapcraftercore/renderer/image/blending.h"
+#include "../mapcraftercore/renderer/image/coloring.h"
+#include "../mapcraftercore/renderer/image/scaling.h"
+#include "../mapcraftercore/renderer/renderviews/isometric/blockimages.h"
+#include "../mapcraftercore/renderer/renderviews/isometric/rendermodes.h"
+#include "../mapcraftercore/util.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <zlib.h>
 #include <boost/test/unit_test.hpp>
 
 namespace renderer = mapcrafter::renderer;
@@ -50,3 +65,699 @@ BOOST_AUTO_TEST_CASE(image_testIO) {
 		}
 	}
 }
+
+BOOST_AUTO_TEST_CASE(image_testIOStream) {
+	renderer::RGBAImage image(64, 32);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, renderer::rgba(x * 4, y * 8, x * y, 255 - x));
+
+	// an image encoded into memory must be the same as the one written to a file
+	std::ostringstream buffer;
+	BOOST_REQUIRE(image.writePNG(buffer));
+	BOOST_REQUIRE(image.writePNG("test.png"));
+
+	std::ifstream file("test.png", std::ios::binary);
+	std::stringstream file_data;
+	file_data << file.rdbuf();
+	BOOST_CHECK(!buffer.str().empty());
+	BOOST_CHECK(buffer.str() == file_data.str());
+}
+
+BOOST_AUTO_TEST_CASE(image_testPNGOptions) {
+	renderer::RGBAImage image(64, 32);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, renderer::rgba(x * 4, y * 8, x * y, 255 - x));
+
+	// the image must be the same with every compression setting
+	int levels[] = {0, 1, 9};
+	int filters[] = {PNG_FILTER_NONE, PNG_FILTER_UP, PNG_ALL_FILTERS};
+	int strategies[] = {Z_DEFAULT_STRATEGY, Z_HUFFMAN_ONLY, Z_RLE};
+	size_t size_level0 = 0, size_level9 = 0;
+	for (int i = 0; i < 3; i++) {
+		renderer::PNGOptions options;
+		options.compression_level = levels[i];
+		options.filters = filters[i];
+		options.strategy = strategies[i];
+		std::ostringstream buffer;
+		BOOST_REQUIRE(image.writePNG(buffer, options));
+		if (i == 0)
+			size_level0 = buffer.str().size();
+		if (i == 2)
+			size_level9 = buffer.str().size();
+
+		std::ofstream("test.png", std::ios::binary) << buffer.str();
+		renderer::RGBAImage read;
+		BOOST_REQUIRE(read.readPNG("test.png"));
+		BOOST_REQUIRE_EQUAL(read.getWidth(), image.getWidth());
+		BOOST_REQUIRE_EQUAL(read.getHeight(), image.getHeight());
+		bool equal = true;
+		for (int x = 0; x < image.getWidth(); x++)
+			for (int y = 0; y < image.getHeight(); y++)
+				equal = equal && read.getPixel(x, y) == image.getPixel(x, y);
+		BOOST_CHECK(equal);
+	}
+	BOOST_CHECK_LT(size_level9, size_level0);
+}
+
+#ifdef HAVE_LIBWEBP
+BOOST_AUTO_TEST_CASE(image_testWebP) {
+	renderer::RGBAImage image(64, 32);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, renderer::rgba(x * 4, y * 8, x * y, 255 - x));
+
+	// lossless WebPs must be read back exactly, lossy ones keep the alpha channel
+	BOOST_REQUIRE(image.writeWebP("test.webp", true));
+	renderer::RGBAImage read;
+	BOOST_REQUIRE(read.readWebP("test.webp"));
+	BOOST_REQUIRE_EQUAL(read.getWidth(), image.getWidth());
+	BOOST_REQUIRE_EQUAL(read.getHeight(), image.getHeight());
+	bool equal = true;
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			equal = equal && read.getPixel(x, y) == image.getPixel(x, y);
+	BOOST_CHECK(equal);
+
+	BOOST_REQUIRE(image.writeWebP("test.webp", false, 90));
+	BOOST_REQUIRE(read.readWebP("test.webp"));
+	BOOST_CHECK_EQUAL(read.getWidth(), image.getWidth());
+	int max_alpha_difference = 0;
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			max_alpha_difference = std::max(max_alpha_difference,
+					std::abs(renderer::rgba_alpha(read.getPixel(x, y))
+						- renderer::rgba_alpha(image.getPixel(x, y))));
+	BOOST_CHECK_LT(max_alpha_difference, 16);
+	std::remove("test.webp");
+
+	// a lossless WebP written by libwebp with an opaque red and a half transparent blue
+	// pixel, the channels mustn't be swapped since a round trip wouldn't notice
+	const uint8_t encoded[] = {
+		0x52, 0x49, 0x46, 0x46, 0x20, 0x00, 0x00, 0x00, 0x57, 0x45, 0x42, 0x50,
+		0x56, 0x50, 0x38, 0x4c, 0x13, 0x00, 0x00, 0x00, 0x2f, 0x01, 0x00, 0x00,
+		0x10, 0x0f, 0x10, 0xfb, 0x3f, 0xff, 0x0f, 0xfc, 0x8f, 0x0a, 0x15, 0x88,
+		0xe8, 0x7f, 0x00, 0x00
+	};
+	std::istringstream in(std::string((const char*) encoded, sizeof(encoded)));
+	BOOST_REQUIRE(read.readWebP(in));
+	BOOST_REQUIRE_EQUAL(read.getWidth(), 2);
+	BOOST_REQUIRE_EQUAL(read.getHeight(), 1);
+	BOOST_CHECK_EQUAL(read.getPixel(0, 0), renderer::rgba(255, 0, 0, 255));
+	BOOST_CHECK_EQUAL(read.getPixel(1, 0), renderer::rgba(0, 0, 255, 128));
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(image_testJPEG) {
+	// the left half is transparent and composited onto the background color, the
+	// right half is opaque except for a bit transparency which is ignored
+	renderer::RGBAImage image(64, 32);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, renderer::rgba(x * 2, y * 4, 128, x < 32 ? 0 : 252));
+	renderer::RGBAPixel background = renderer::rgba(50, 100, 150, 255);
+
+	renderer::JPEGOptions options[3];
+	options[1].fast_dct = true;
+	options[2].h_sampling = options[2].v_sampling = 1;
+	for (int i = 0; i < 3; i++) {
+		BOOST_REQUIRE(image.writeJPEG("test.jpg", 95, background, options[i]));
+		renderer::RGBAImage read;
+		BOOST_REQUIRE(read.readJPEG("test.jpg", i == 1));
+		BOOST_REQUIRE_EQUAL(read.getWidth(), image.getWidth());
+		BOOST_REQUIRE_EQUAL(read.getHeight(), image.getHeight());
+
+		int max_difference = 0;
+		for (int x = 0; x < image.getWidth(); x++)
+			for (int y = 0; y < image.getHeight(); y++) {
+				renderer::RGBAPixel expected = x < 32 ? background : image.getPixel(x, y);
+				renderer::RGBAPixel pixel = read.getPixel(x, y);
+				BOOST_CHECK_EQUAL(renderer::rgba_alpha(pixel), 255);
+				max_difference = std::max(max_difference, std::max(
+					std::abs(renderer::rgba_red(pixel) - renderer::rgba_red(expected)),
+					std::abs(renderer::rgba_blue(pixel) - renderer::rgba_blue(expected))));
+			}
+		BOOST_CHECK_LT(max_difference, 24);
+	}
+	std::remove("test.jpg");
+}
+
+namespace {
+
+// the image tests have their own random numbers, so they don't change the random
+// numbers of other tests
+std::minstd_rand random_engine(42);
+
+int randomInt(int n) {
+	return random_engine() % n;
+}
+
+renderer::RGBAPixel randomPixel() {
+	// mostly the special alpha values blend() handles differently
+	uint8_t alphas[] = {0, 0, 255, 255, 1, 254, 128};
+	uint8_t a = randomInt(2) ? alphas[randomInt(7)] : randomInt(256);
+	return renderer::rgba(randomInt(256), randomInt(256), randomInt(256), a);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(image_testBlendingKernels) {
+	BOOST_CHECK(renderer::isBlendingKernelSupported(renderer::getBlendingKernel()));
+
+	renderer::BlendingKernel kernels[] = {renderer::BlendingKernel::SSE2,
+			renderer::BlendingKernel::AVX2};
+	for (int k = 0; k < 2; k++) {
+		if (!renderer::isBlendingKernelSupported(kernels[k]))
+			continue;
+		// rows of different lengths and (unaligned) offsets, to test all tails
+		for (int count = 0; count < 40; count++) {
+			int offset = randomInt(4);
+			std::vector<renderer::RGBAPixel> source(count + offset), dest(count + offset);
+			for (int i = 0; i < count + offset; i++) {
+				source[i] = randomPixel();
+				dest[i] = randomPixel();
+			}
+
+			std::vector<renderer::RGBAPixel> expected = dest, actual = dest;
+			renderer::blendRow(&expected[offset], &source[offset], count,
+					renderer::BlendingKernel::SCALAR);
+			renderer::blendRow(&actual[offset], &source[offset], count, kernels[k]);
+			BOOST_CHECK(expected == actual);
+
+			expected = dest;
+			actual = dest;
+			renderer::alphaCopyRow(&expected[offset], &source[offset], count,
+					renderer::BlendingKernel::SCALAR);
+			renderer::alphaCopyRow(&actual[offset], &source[offset], count, kernels[k]);
+			BOOST_CHECK(expected == actual);
+
+			expected = dest;
+			actual = dest;
+			renderer::blendRowPremultiplied(&expected[offset], &source[offset], count,
+					renderer::BlendingKernel::SCALAR);
+			renderer::blendRowPremultiplied(&actual[offset], &source[offset], count,
+					kernels[k]);
+			BOOST_CHECK(expected == actual);
+		}
+	}
+
+	// rectangles with the specialized widths and others, in bigger images
+	int widths[] = {16, 24, 32, 48, 7, 33};
+	for (int w = 0; w < 6; w++) {
+		int width = widths[w], height = 20, stride = 64;
+		std::vector<renderer::RGBAPixel> source(stride * height), dest(stride * height);
+		for (size_t i = 0; i < source.size(); i++) {
+			source[i] = randomPixel();
+			dest[i] = randomPixel();
+		}
+		int offset = randomInt(4);
+		for (int k = 0; k < 2; k++) {
+			if (!renderer::isBlendingKernelSupported(kernels[k]))
+				continue;
+			std::vector<renderer::RGBAPixel> expected = dest, actual = dest;
+			for (int y = 0; y < height; y++)
+				renderer::blendRow(&expected[y * stride + offset], &source[y * stride],
+						width, renderer::BlendingKernel::SCALAR);
+			renderer::blendRect(&actual[offset], stride, &source[0], stride, width,
+					height, kernels[k]);
+			BOOST_CHECK(expected == actual);
+
+			expected = dest;
+			actual = dest;
+			for (int y = 0; y < height; y++)
+				renderer::blendRowPremultiplied(&expected[y * stride + offset],
+						&source[y * stride], width, renderer::BlendingKernel::SCALAR);
+			renderer::blendRectPremultiplied(&actual[offset], stride, &source[0], stride,
+					width, height, kernels[k]);
+			BOOST_CHECK(expected == actual);
+		}
+	}
+
+	// and all combinations of source and destination alpha
+	std::vector<renderer::RGBAPixel> source, dest;
+	for (int sa = 0; sa < 256; sa++)
+		for (int da = 0; da < 256; da++) {
+			source.push_back(renderer::rgba(randomInt(256), randomInt(256),
+					randomInt(256), sa));
+			dest.push_back(renderer::rgba(randomInt(256), randomInt(256),
+					randomInt(256), da));
+		}
+	std::vector<renderer::RGBAPixel> expected = dest;
+	for (size_t i = 0; i < dest.size(); i++)
+		renderer::blend(expected[i], source[i]);
+	for (int k = 0; k < 2; k++) {
+		if (!renderer::isBlendingKernelSupported(kernels[k]))
+			continue;
+		std::vector<renderer::RGBAPixel> actual = dest;
+		renderer::blendRow(&actual[0], &source[0], actual.size(), kernels[k]);
+		BOOST_CHECK(expected == actual);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(image_testColoringKernels) {
+	renderer::BlendingKernel kernels[] = {renderer::BlendingKernel::SCALAR,
+			renderer::BlendingKernel::SSE2};
+	for (int k = 0; k < 2; k++) {
+		if (!renderer::isBlendingKernelSupported(kernels[k]))
+			continue;
+		// rows of different lengths to test all tails
+		for (int count = 0; count < 40; count++) {
+			std::vector<renderer::RGBAPixel> pixels(count);
+			for (int i = 0; i < count; i++)
+				pixels[i] = randomInt(8) ? randomPixel() : 0;
+			uint8_t r = randomInt(256), g = randomInt(256), b = randomInt(256),
+					a = randomInt(256);
+			int add_r = randomInt(511) - 255, add_g = randomInt(511) - 255,
+					add_b = randomInt(511) - 255;
+
+			std::vector<renderer::RGBAPixel> expected = pixels, actual = pixels;
+			for (int i = 0; i < count; i++)
+				expected[i] = renderer::rgba_multiply(pixels[i], r, g, b, a);
+			renderer::multiplyRow(actual.data(), count, r, g, b, a, kernels[k]);
+			BOOST_CHECK(expected == actual);
+
+			expected = pixels;
+			actual = pixels;
+			for (int i = 0; i < count; i++)
+				if (pixels[i] != 0)
+					expected[i] = renderer::rgba_add_clamp(pixels[i], add_r, add_g, add_b);
+			renderer::addClampRow(actual.data(), count, add_r, add_g, add_b, kernels[k]);
+			BOOST_CHECK(expected == actual);
+		}
+	}
+
+	// the integer multiplication is exact for all channel values and factors
+	std::vector<renderer::RGBAPixel> pixels;
+	for (int c = 0; c < 256; c++)
+		pixels.push_back(renderer::rgba(c, c, c, c));
+	for (int f = 0; f < 256; f++) {
+		std::vector<renderer::RGBAPixel> actual = pixels;
+		renderer::multiplyRow(actual.data(), actual.size(), f, f, f, f);
+		for (int c = 0; c < 256; c++)
+			BOOST_CHECK_EQUAL(renderer::rgba_red(actual[c]), c * f / 255);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(image_testFaceSpans) {
+	// the spans cover exactly the pixels of the face iterators
+	int size = 16;
+	for (int face = 0; face < 3; face++) {
+		std::vector<int> expected(4 * size * size), actual(4 * size * size);
+		if (face == 2) {
+			for (renderer::TopFaceIterator it(size); !it.end(); it.next())
+				expected[it.dest_y * 2 * size + it.dest_x]++;
+		} else {
+			int side = face == 0 ? renderer::SideFaceIterator::LEFT
+					: renderer::SideFaceIterator::RIGHT;
+			for (renderer::SideFaceIterator it(size, side); !it.end(); it.next())
+				expected[(it.dest_y + size / 2) * 2 * size + it.dest_x
+						+ (face == 0 ? 0 : size)]++;
+		}
+		int faces[] = {renderer::FACE_WEST, renderer::FACE_SOUTH, renderer::FACE_TOP};
+		std::vector<renderer::FaceSpan> spans = renderer::getFaceSpans(faces[face], size);
+		for (size_t i = 0; i < spans.size(); i++)
+			for (int x = spans[i].x; x < spans[i].x + spans[i].count; x++)
+				actual[spans[i].y * 2 * size + x]++;
+		BOOST_CHECK(expected == actual);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(image_testBlitFace) {
+	// the precomputed face projections blit the same pixels as the face iterators
+	int size = 16;
+	renderer::RGBAImage texture(size, size);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			texture.setPixel(x, y, randomPixel());
+
+	int faces[] = {renderer::FACE_TOP, renderer::FACE_WEST, renderer::FACE_SOUTH};
+	for (int f = 0; f < 3; f++) {
+		renderer::RGBAImage expected(2 * size, 2 * size), actual(2 * size, 2 * size);
+		if (faces[f] == renderer::FACE_TOP) {
+			for (renderer::TopFaceIterator it(size); !it.end(); it.next())
+				expected.blendPixel(texture.getPixel(it.src_x, it.src_y),
+						it.dest_x, it.dest_y + 1);
+		} else {
+			bool left = faces[f] == renderer::FACE_WEST;
+			for (renderer::SideFaceIterator it(size, left ? renderer::SideFaceIterator::LEFT
+					: renderer::SideFaceIterator::RIGHT); !it.end(); it.next()) {
+				renderer::RGBAPixel pixel = renderer::rgba_multiply(
+						texture.getPixel(it.src_x, it.src_y), 0.75, 0.75, 0.75);
+				expected.blendPixel(pixel, it.dest_x + (left ? 0 : size),
+						it.dest_y + size / 2 + 1);
+			}
+		}
+		renderer::blitFace(actual, faces[f], texture, 0, 1, true, 0.75, 0.75);
+		int different = 0;
+		for (int y = 0; y < 2 * size; y++)
+			for (int x = 0; x < 2 * size; x++)
+				if (expected.getPixel(x, y) != actual.getPixel(x, y))
+					different++;
+		BOOST_CHECK_EQUAL(different, 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(image_testPremultipliedAlpha) {
+	BOOST_CHECK_EQUAL(renderer::rgba_unpremultiply(renderer::rgba(10, 20, 30, 0)), 0);
+	BOOST_CHECK_EQUAL(renderer::rgba_unpremultiply(renderer::rgba(10, 20, 30, 255)),
+			renderer::rgba(10, 20, 30, 255));
+	BOOST_CHECK_EQUAL(renderer::rgba_unpremultiply(renderer::rgba(64, 0, 128, 128)),
+			renderer::rgba(128, 0, 255, 128));
+
+	for (int i = 0; i < 1000; i++) {
+		renderer::RGBAPixel source = randomPixel(), dest = randomPixel();
+		uint8_t sa = renderer::rgba_alpha(source);
+
+		// on opaque pixels it's the same like blending with straight alpha
+		renderer::RGBAPixel opaque = dest | 0xff000000, expected = opaque;
+		renderer::blend(expected, source);
+		renderer::blendPremultiplied(opaque, source);
+		BOOST_CHECK_EQUAL(opaque, expected);
+
+		// on transparent pixels it results in the (premultiplied) source pixel
+		renderer::RGBAPixel transparent = 0;
+		renderer::blendPremultiplied(transparent, source);
+		transparent = renderer::rgba_unpremultiply(transparent);
+		BOOST_CHECK_EQUAL(renderer::rgba_alpha(transparent), sa);
+		if (sa != 0) {
+			// with some rounding errors from the premultiplication
+			int tolerance = 255 / sa + 1;
+			BOOST_CHECK(std::abs(renderer::rgba_red(transparent)
+					- renderer::rgba_red(source)) <= tolerance);
+			BOOST_CHECK(std::abs(renderer::rgba_green(transparent)
+					- renderer::rgba_green(source)) <= tolerance);
+			BOOST_CHECK(std::abs(renderer::rgba_blue(transparent)
+					- renderer::rgba_blue(source)) <= tolerance);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(image_testBlendUnder) {
+	for (int i = 0; i < 1000; i++) {
+		renderer::RGBAPixel front = randomPixel(), back = randomPixel();
+
+		// blending the back pixel under the front pixel is like blending the front pixel
+		// onto the back pixel, up to rounding errors
+		renderer::RGBAPixel expected = 0, actual = 0;
+		renderer::blendPremultiplied(expected, back);
+		renderer::blendPremultiplied(expected, front);
+		renderer::blendUnderPremultiplied(actual, front);
+		renderer::blendUnderPremultiplied(actual, back);
+		BOOST_CHECK(std::abs(renderer::rgba_alpha(actual) - renderer::rgba_alpha(expected)) <= 2);
+		BOOST_CHECK(std::abs(renderer::rgba_red(actual) - renderer::rgba_red(expected)) <= 2);
+		BOOST_CHECK(std::abs(renderer::rgba_green(actual) - renderer::rgba_green(expected)) <= 2);
+		BOOST_CHECK(std::abs(renderer::rgba_blue(actual) - renderer::rgba_blue(expected)) <= 2);
+
+		// opaque pixels are copied under transparent pixels and stay as they are
+		renderer::RGBAPixel opaque = front | 0xff000000, transparent = 0;
+		renderer::blendUnderPremultiplied(transparent, opaque);
+		BOOST_CHECK_EQUAL(transparent, opaque);
+		renderer::blendUnderPremultiplied(transparent, back);
+		BOOST_CHECK_EQUAL(transparent, opaque);
+	}
+
+	// the opaque pixels of the rows are counted
+	renderer::RGBAImage image(4, 3), opaque(2, 3);
+	opaque.fill(renderer::rgba(10, 20, 30, 255), 0, 0, 2, 3);
+	std::vector<int> row_coverage(3, 0);
+	image.alphaBlitUnderPremultiplied(opaque, -1, 1, row_coverage);
+	image.alphaBlitUnderPremultiplied(opaque, 0, 0, row_coverage);
+	BOOST_CHECK_EQUAL(row_coverage[0], 2);
+	BOOST_CHECK_EQUAL(row_coverage[1], 2);
+	BOOST_CHECK_EQUAL(row_coverage[2], 2);
+	image.alphaBlitUnderPremultiplied(opaque, 2, 0, row_coverage);
+	BOOST_CHECK_EQUAL(row_coverage[0], 4);
+	BOOST_CHECK_EQUAL(image.getPixel(3, 0), renderer::rgba(10, 20, 30, 255));
+}
+
+BOOST_AUTO_TEST_CASE(image_testAlphaBlit) {
+	renderer::RGBAImage image(13, 11);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, randomPixel());
+
+	// blit the image at positions where it's clipped at every side
+	int positions[] = {-20, -12, -5, 0, 3, 15, 30};
+	for (int i = 0; i < 7; i++)
+		for (int j = 0; j < 7; j++) {
+			int px = positions[i], py = positions[j];
+			renderer::RGBAImage background(31, 23);
+			for (int x = 0; x < background.getWidth(); x++)
+				for (int y = 0; y < background.getHeight(); y++)
+					background.setPixel(x, y, randomPixel());
+
+			renderer::RGBAImage blended = background, copied = background;
+			blended.alphaBlit(image, px, py);
+			copied.simpleAlphaBlit(image, px, py);
+			for (int x = 0; x < background.getWidth(); x++)
+				for (int y = 0; y < background.getHeight(); y++) {
+					renderer::RGBAPixel expected_blended = background.getPixel(x, y);
+					renderer::RGBAPixel expected_copied = expected_blended;
+					int sx = x - px, sy = y - py;
+					if (sx >= 0 && sy >= 0 && sx < image.getWidth() && sy < image.getHeight()) {
+						renderer::RGBAPixel pixel = image.getPixel(sx, sy);
+						renderer::blend(expected_blended, pixel);
+						if (renderer::rgba_alpha(pixel) != 0)
+							expected_copied = pixel;
+					}
+					BOOST_CHECK_EQUAL(blended.getPixel(x, y), expected_blended);
+					BOOST_CHECK_EQUAL(copied.getPixel(x, y), expected_copied);
+				}
+		}
+}
+
+BOOST_AUTO_TEST_CASE(image_testViews) {
+	renderer::RGBAImage image(13, 11);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, randomPixel());
+
+	// the clipped images have transparent pixels outside of the image, the views are cut
+	int rects[][4] = {{0, 0, 13, 11}, {2, 3, 5, 4}, {-3, -2, 8, 6}, {10, 8, 7, 9},
+			{20, 0, 3, 3}};
+	for (int i = 0; i < 5; i++) {
+		int* r = rects[i];
+		renderer::RGBAImage clipped = image.clip(r[0], r[1], r[2], r[3]);
+		BOOST_CHECK_EQUAL(clipped.getWidth(), r[2]);
+		BOOST_CHECK_EQUAL(clipped.getHeight(), r[3]);
+		for (int x = 0; x < r[2]; x++)
+			for (int y = 0; y < r[3]; y++)
+				BOOST_CHECK_EQUAL(clipped.getPixel(x, y), image.getPixel(r[0] + x, r[1] + y));
+
+		renderer::RGBAImageView view = image.view(r[0], r[1], r[2], r[3]);
+		renderer::RGBAImage background(15, 15), blended, expected;
+		for (int x = 0; x < background.getWidth(); x++)
+			for (int y = 0; y < background.getHeight(); y++)
+				background.setPixel(x, y, randomPixel());
+		blended = expected = background;
+		blended.alphaBlit(view, 1 + std::max(0, -r[0]), 2 + std::max(0, -r[1]));
+		expected.alphaBlit(clipped, 1, 2);
+		for (int x = 0; x < background.getWidth(); x++)
+			for (int y = 0; y < background.getHeight(); y++)
+				BOOST_CHECK_EQUAL(blended.getPixel(x, y), expected.getPixel(x, y));
+	}
+
+	// the transformations of temporary images in place must be the same like the copies,
+	// the textures which are rotated are square
+	renderer::RGBAImage square = image.clip(0, 0, 11, 11);
+	for (int rotation = 0; rotation < 4; rotation++) {
+		renderer::RGBAImage rotated = square.rotate(rotation);
+		renderer::RGBAImage temporary = renderer::RGBAImage(square).rotate(rotation);
+		for (int x = 0; x < 11; x++)
+			for (int y = 0; y < 11; y++) {
+				int sx = x, sy = y;
+				if (rotation == renderer::ROTATE_90) {
+					sx = y;
+					sy = 11 - x - 1;
+				} else if (rotation == renderer::ROTATE_180) {
+					sx = 11 - x - 1;
+					sy = 11 - y - 1;
+				} else if (rotation == renderer::ROTATE_270) {
+					sx = 11 - y - 1;
+					sy = x;
+				}
+				BOOST_CHECK_EQUAL(rotated.getPixel(x, y), square.getPixel(sx, sy));
+				BOOST_CHECK_EQUAL(temporary.getPixel(x, y), square.getPixel(sx, sy));
+			}
+	}
+	for (int i = 0; i < 4; i++) {
+		bool flip_x = i % 2, flip_y = i / 2;
+		renderer::RGBAImage flipped = image.flip(flip_x, flip_y);
+		renderer::RGBAImage temporary = renderer::RGBAImage(image).flip(flip_x, flip_y);
+		for (int x = 0; x < 13; x++)
+			for (int y = 0; y < 11; y++) {
+				renderer::RGBAPixel expected = image.getPixel(flip_x ? 13 - x - 1 : x,
+						flip_y ? 11 - y - 1 : y);
+				BOOST_CHECK_EQUAL(flipped.getPixel(x, y), expected);
+				BOOST_CHECK_EQUAL(temporary.getPixel(x, y), expected);
+			}
+	}
+	int offsets[] = {-14, -5, 0, 3, 12};
+	for (int i = 0; i < 5; i++)
+		for (int j = 0; j < 5; j++) {
+			int dx = offsets[i], dy = offsets[j];
+			renderer::RGBAImage moved = image.move(dx, dy);
+			renderer::RGBAImage temporary = renderer::RGBAImage(image).move(dx, dy);
+			for (int x = 0; x < 13; x++)
+				for (int y = 0; y < 11; y++) {
+					renderer::RGBAPixel expected = image.getPixel(x - dx, y - dy);
+					BOOST_CHECK_EQUAL(moved.getPixel(x, y), expected);
+					BOOST_CHECK_EQUAL(temporary.getPixel(x, y), expected);
+				}
+		}
+	renderer::RGBAImage colorized = image.clip(0, 0, 13, 11).colorize(0.5, 1.0, 0.25);
+	for (int x = 0; x < 13; x++)
+		for (int y = 0; y < 11; y++)
+			BOOST_CHECK_EQUAL(colorized.getPixel(x, y),
+					renderer::rgba_multiply(image.getPixel(x, y), 0.5, 1.0, 0.25));
+}
+
+BOOST_AUTO_TEST_CASE(image_testBuffers) {
+	// the pixel buffers are aligned, also after growing them
+	renderer::RGBAImage image(5, 3);
+	for (int size = 1; size < 300; size += 37) {
+		image.setSize(size, size);
+		BOOST_CHECK_EQUAL((uintptr_t) &image.pixel(0, 0) % renderer::IMAGE_ALIGNMENT, 0);
+	}
+
+	// shrinking and growing again doesn't move the buffer
+	image.setSize(256, 256);
+	const renderer::RGBAPixel* pixels = &image.pixel(0, 0);
+	image.setSize(16, 16);
+	image.setSize(256, 256);
+	BOOST_CHECK_EQUAL(&image.pixel(0, 0), pixels);
+
+	// moving takes the buffer, the other image is empty afterwards
+	image.setPixel(3, 4, 0x12345678);
+	renderer::RGBAImage moved(std::move(image));
+	BOOST_CHECK_EQUAL(&moved.pixel(0, 0), pixels);
+	BOOST_CHECK_EQUAL(moved.getPixel(3, 4), 0x12345678);
+	BOOST_CHECK_EQUAL(image.getWidth(), 0);
+	BOOST_CHECK_EQUAL(image.getHeight(), 0);
+	BOOST_CHECK_EQUAL(image.getPixel(0, 0), 0);
+
+	image = std::move(moved);
+	BOOST_CHECK_EQUAL(&image.pixel(0, 0), pixels);
+	BOOST_CHECK_EQUAL(moved.getWidth(), 0);
+
+	// a copy into an image of the same size keeps its buffer
+	renderer::RGBAImage copy(256, 256);
+	const renderer::RGBAPixel* copy_pixels = &copy.pixel(0, 0);
+	copy = image;
+	BOOST_CHECK_EQUAL(&copy.pixel(0, 0), copy_pixels);
+	BOOST_CHECK_EQUAL(copy.getPixel(3, 4), 0x12345678);
+}
+
+BOOST_AUTO_TEST_CASE(image_testResizeHalfBlit) {
+	// an odd size and more than one vector of pixels per row
+	renderer::RGBAImage image(27, 19);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, randomPixel());
+
+	renderer::RGBAImage resized;
+	renderer::imageResizeHalf(image, resized);
+	BOOST_CHECK_EQUAL(resized.getWidth(), 13);
+	BOOST_CHECK_EQUAL(resized.getHeight(), 9);
+
+	// resizing and blitting at once averages with premultiplied alpha
+	renderer::RGBAImage composite(13, 9);
+	for (int x = 0; x < resized.getWidth(); x++)
+		for (int y = 0; y < resized.getHeight(); y++) {
+			renderer::RGBAPixel average = 0;
+			int alpha[4];
+			int sum[3] = {0, 0, 0};
+			for (int i = 0; i < 4; i++) {
+				renderer::RGBAPixel pixel = image.getPixel(2*x + i % 2, 2*y + i / 2);
+				average += (pixel >> 2) & 0x3f3f3f3f;
+				alpha[i] = renderer::rgba_alpha(pixel);
+				sum[0] += alpha[i] * renderer::rgba_red(pixel);
+				sum[1] += alpha[i] * renderer::rgba_green(pixel);
+				sum[2] += alpha[i] * renderer::rgba_blue(pixel);
+			}
+			BOOST_CHECK_EQUAL(resized.getPixel(x, y), average);
+
+			int total = alpha[0] + alpha[1] + alpha[2] + alpha[3];
+			if (alpha[0] != alpha[1] || alpha[0] != alpha[2] || alpha[0] != alpha[3])
+				average = renderer::rgba((sum[0] + total / 2) / total,
+						(sum[1] + total / 2) / total, (sum[2] + total / 2) / total,
+						renderer::rgba_alpha(average));
+			if (renderer::rgba_alpha(average) != 0)
+				composite.setPixel(x, y, average);
+		}
+
+	// resizing and blitting at once must be the same like blitting the resized image
+	int positions[] = {-20, -7, -1, 0, 5, 15, 30};
+	for (int i = 0; i < 7; i++)
+		for (int j = 0; j < 7; j++) {
+			renderer::RGBAImage background(31, 23);
+			for (int x = 0; x < background.getWidth(); x++)
+				for (int y = 0; y < background.getHeight(); y++)
+					background.setPixel(x, y, randomPixel());
+
+			renderer::RGBAImage expected = background;
+			expected.simpleAlphaBlit(composite, positions[i], positions[j]);
+			renderer::imageResizeHalfBlit(image, background, positions[i], positions[j]);
+			for (int x = 0; x < background.getWidth(); x++)
+				for (int y = 0; y < background.getHeight(); y++)
+					BOOST_CHECK_EQUAL(background.getPixel(x, y), expected.getPixel(x, y));
+		}
+}
+
+BOOST_AUTO_TEST_CASE(image_testLightingShade) {
+	int size = 16;
+	renderer::RGBAImage image(2 * size, 2 * size);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, randomPixel());
+
+	// lighting a face with the same color at all corners multiplies its pixels with
+	// the same factor
+	renderer::IsometricLightingRenderer lighting;
+	renderer::CornerColors colors = {{0.5, 0.5, 0.5, 0.5}};
+	uint8_t d = 127;
+	for (int face = 0; face < 3; face++) {
+		renderer::RGBAImage lighted = image, expected = image;
+		if (face == 0) {
+			lighting.lightLeft(lighted, colors);
+			for (renderer::SideFaceIterator it(size, renderer::SideFaceIterator::LEFT);
+					!it.end(); it.next()) {
+				renderer::RGBAPixel& pixel = expected.pixel(it.dest_x, it.dest_y + size/2);
+				if (pixel != 0)
+					pixel = renderer::rgba_multiply(pixel, d, d, d);
+			}
+		} else if (face == 1) {
+			lighting.lightRight(lighted, colors);
+			for (renderer::SideFaceIterator it(size, renderer::SideFaceIterator::RIGHT);
+					!it.end(); it.next()) {
+				renderer::RGBAPixel& pixel = expected.pixel(it.dest_x + size,
+						it.dest_y + size/2);
+				if (pixel != 0)
+					pixel = renderer::rgba_multiply(pixel, d, d, d);
+			}
+		} else {
+			lighting.lightTop(lighted, colors, 0);
+			for (renderer::TopFaceIterator it(size); !it.end(); it.next()) {
+				renderer::RGBAPixel& pixel = expected.pixel(it.dest_x, it.dest_y);
+				if (pixel != 0)
+					pixel = renderer::rgba_multiply(pixel, d, d, d);
+			}
+		}
+		for (int x = 0; x < image.getWidth(); x++)
+			for (int y = 0; y < image.getHeight(); y++)
+				BOOST_CHECK_EQUAL(lighted.getPixel(x, y), expected.getPixel(x, y));
+	}
+
+	// and the shade interpolates between the corners
+	renderer::RGBAImage white(2 * size, 2 * size);
+	white.fill(0xffffffff, 0, 0, 2 * size, 2 * size);
+	renderer::CornerColors gradient = {{0, 1, 0, 1}};
+	lighting.lightLeft(white, gradient);
+	for (renderer::SideFaceIterator it(size, renderer::SideFaceIterator::LEFT);
+			!it.end(); it.next()) {
+		int expected = 255 * it.src_x / (size - 1);
+		int actual = renderer::rgba_red(white.pixel(it.dest_x, it.dest_y + size/2));
+		BOOST_CHECK(std::abs(actual - expected) <= 1);
+	}
+}
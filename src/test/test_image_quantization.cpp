@@ -18,8 +18,11 @@
  */
 
 #include "../mapcraftercore/renderer/image.h"
+#include "../mapcraftercore/renderer/image/palette.h"
 #include "../mapcraftercore/renderer/image/quantization.h"
 
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <set>
 #include <boost/test/unit_test.hpp>
@@ -46,7 +49,6 @@ void traverseReduceOctree(Octree* octree) {
 	}
 	if (octree->isLeaf() && !octree->isRoot()) {
 		octree->reduceToParent();
-		delete octree;
 	}
 }
 
@@ -128,6 +130,76 @@ BOOST_AUTO_TEST_CASE(image_palette) {
 	testPalette(palette4, true);
 }
 
+BOOST_AUTO_TEST_CASE(image_palette_lookup) {
+	// the reduced colors of the lookup table are looked up exactly
+	std::vector<RGBAPixel> colors;
+	for (int i = 0; i < 32; i++)
+		colors.push_back(rgba(i * 255 / 31, 255 - i * 255 / 31, (i * 7 % 32) * 255 / 31,
+				i % 2 ? 255 : 0));
+	LookupPalette palette(colors);
+	testPalette(palette, false);
+
+	// and the other colors are almost the nearest ones, they're at most twice the distance
+	// to the nearest reduced color farther away than the nearest color
+	SimplePalette simple(colors);
+	for (int i = 0; i < 1000; i++) {
+		RGBAPixel color = randomColor();
+		int found = rgba_distance2(color, colors[palette.getNearestColor(color)]);
+		int nearest = rgba_distance2(color, colors[simple.getNearestColor(color)]);
+		BOOST_CHECK_LE(std::sqrt(found), std::sqrt(nearest) + 40);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(image_palette_findNearestColor) {
+	// the vectorized search must find the first of the nearest colors like a simple
+	// loop, also with color counts which aren't a multiple of four and duplicate colors
+	for (int count = 1; count <= 67; count += 3) {
+		std::vector<RGBAPixel> colors;
+		for (int i = 0; i < count; i++)
+			colors.push_back(i % 5 == 4 ? colors[i / 2] : randomColor());
+		for (int i = 0; i < 200; i++) {
+			RGBAPixel color = i < count ? colors[i] : randomColor();
+			int expected = 0;
+			for (int j = 1; j < count; j++)
+				if (rgba_distance2(color, colors[j]) < rgba_distance2(color, colors[expected]))
+					expected = j;
+			BOOST_CHECK_EQUAL(findNearestColor(&colors[0], colors.size(), color), expected);
+		}
+	}
+	BOOST_CHECK_EQUAL(findNearestColor(nullptr, 0, randomColor()), -1);
+}
+
+BOOST_AUTO_TEST_CASE(image_palette_getNearestColors) {
+	std::vector<RGBAPixel> colors;
+	for (int i = 0; i < 256; i++)
+		colors.push_back(randomColor());
+	RGBAImage image(384, 384);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, randomColor());
+	size_t pixels = image.getWidth() * image.getHeight();
+	const RGBAPixel* data = &image.pixel(0, 0);
+
+	SimplePalette simple(colors);
+	OctreePalette octree(colors);
+	LookupPalette lookup(colors);
+	Palette* palettes[] = {&simple, &octree, &lookup};
+	const char* names[] = {"SimplePalette", "OctreePalette", "LookupPalette"};
+	for (int i = 0; i < 3; i++) {
+		// the colors found at once must be the same as the ones found one by one
+		std::vector<int> indices(pixels);
+		auto start = std::chrono::steady_clock::now();
+		palettes[i]->getNearestColors(data, pixels, &indices[0]);
+		auto end = std::chrono::steady_clock::now();
+		bool equal = true;
+		for (size_t j = 0; j < pixels; j++)
+			equal = equal && indices[j] == palettes[i]->getNearestColor(data[j]);
+		BOOST_CHECK(equal);
+		BOOST_TEST_MESSAGE(names[i] << ": " << std::chrono::duration_cast<
+				std::chrono::microseconds>(end - start).count() << " us for a tile");
+	}
+}
+
 BOOST_AUTO_TEST_CASE(image_quantization_octree) {
 	std::srand(std::time(0));
 
@@ -146,3 +218,35 @@ BOOST_AUTO_TEST_CASE(image_quantization_octree) {
 	testOctreeWithImage(platypus);
 }
 
+
+BOOST_AUTO_TEST_CASE(image_quantization_octreeArena) {
+	RGBAImage image(256, 256);
+	for (int x = 0; x < image.getWidth(); x++)
+		for (int y = 0; y < image.getHeight(); y++)
+			image.setPixel(x, y, rgba(x, y, (x * y) % 256, 255 - x % 2 * 128));
+
+	// the octree in the arena of the thread must give the same colors when the arena is
+	// reused, and as many colors as the octree with its own arena
+	std::vector<RGBAPixel> colors1, colors2, colors3;
+	Octree* octree = nullptr;
+	octreeColorQuantize(image, 256, colors1, &octree);
+	octreeColorQuantize(image, 256, colors2);
+	octreeColorQuantize(image, 256, colors3);
+	BOOST_CHECK_EQUAL(colors1.size(), colors2.size());
+	BOOST_CHECK(colors2 == colors3);
+	delete octree;
+
+	// a reset arena allocates its nodes again
+	OctreeArena arena;
+	Octree root(&arena);
+	Octree::findOrCreateNode(&root, rgba(255, 0, 0, 255));
+	BOOST_CHECK_EQUAL(arena.size(), OCTREE_COLOR_BITS);
+	BOOST_CHECK_EQUAL(root.getChildrenCount(), 1);
+	arena.reset();
+	BOOST_CHECK_EQUAL(arena.size(), 0);
+	Octree root2(&arena);
+	Octree* node = Octree::findOrCreateNode(&root2, rgba(0, 255, 0, 255));
+	BOOST_CHECK_EQUAL(arena.size(), OCTREE_COLOR_BITS);
+	BOOST_CHECK(node->isLeaf());
+	BOOST_CHECK_EQUAL(node->getLevel(), OCTREE_COLOR_BITS);
+}
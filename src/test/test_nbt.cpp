@@ -32,6 +32,7 @@ BOOST_AUTO_TEST_CASE(nbt_testIO) {
 	std::vector<std::string> list_data = {"This", "is", "a", "test", "list", "."};
 	std::vector<int32_t> intarray_data = {1, 1, 2, 3, 5, 8, 13, 21};
 	std::vector<int8_t> bytearray_data = {'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd', '!'};
+	std::vector<int64_t> longarray_data = {-1, 0, 1LL << 40, 0x0123456789abcdefLL};
 	
 	nbt::Compression compressions[] = {
 		nbt::Compression::NO_COMPRESSION,
@@ -59,6 +60,7 @@ BOOST_AUTO_TEST_CASE(nbt_testIO) {
 		out.addTag("list", list);
 		out.addTag("bytearray", nbt::TagByteArray(bytearray_data));
 		out.addTag("intarray", nbt::TagIntArray(intarray_data));
+		out.addTag("longarray", nbt::TagLongArray(longarray_data));
 		out.addTag("compound", out);
 		
 		//out.dump(std::cout);
@@ -79,6 +81,7 @@ BOOST_AUTO_TEST_CASE(nbt_testIO) {
 		REQUIRE_TAG(in.hasList<nbt::TagString>("list", list_data.size()), "list");
 		REQUIRE_TAG(in.hasArray<nbt::TagByteArray>("bytearray", bytearray_data.size()), "bytearray");
 		REQUIRE_TAG(in.hasArray<nbt::TagIntArray>("intarray", intarray_data.size()), "intarray");
+		REQUIRE_TAG(in.hasArray<nbt::TagLongArray>("longarray", longarray_data.size()), "longarray");
 
 		BOOST_CHECK_EQUAL(in.findTag<nbt::TagByte>("byte").payload, 42);
 		BOOST_CHECK_EQUAL(in.findTag<nbt::TagShort>("short").payload, 1337);
@@ -96,5 +99,129 @@ BOOST_AUTO_TEST_CASE(nbt_testIO) {
 		
 		BOOST_CHECK(bytearray_data == in.findTag<nbt::TagByteArray>("bytearray").payload);
 		BOOST_CHECK(intarray_data == in.findTag<nbt::TagIntArray>("intarray").payload);
+		BOOST_CHECK(longarray_data == in.findTag<nbt::TagLongArray>("longarray").payload);
 	}
 }
+
+BOOST_AUTO_TEST_CASE(nbt_testDecompress) {
+	nbt::NBTFile out("TestNBTFile");
+	std::vector<int8_t> bytearray_data(100000);
+	for (size_t i = 0; i < bytearray_data.size(); i++)
+		bytearray_data[i] = i % 7;
+	out.addTag("bytearray", nbt::TagByteArray(bytearray_data));
+	out.addTag("string", nbt::TagString("foobar"));
+
+	std::stringstream uncompressed;
+	out.writeNBT(uncompressed, nbt::Compression::NO_COMPRESSION);
+	std::string expected = uncompressed.str();
+
+	nbt::Compression compressions[] = {
+		nbt::Compression::NO_COMPRESSION,
+		nbt::Compression::GZIP,
+		nbt::Compression::ZLIB
+	};
+	// reuse the buffer, it's probably too small at first
+	nbt::DecompressedBuffer decompressed(10);
+	for (size_t i = 0; i < 3; i++) {
+		std::stringstream stream;
+		out.writeNBT(stream, compressions[i]);
+		std::string compressed = stream.str();
+
+		nbt::decompress(compressed.data(), compressed.size(), decompressed, compressions[i]);
+		BOOST_CHECK(std::string(decompressed.begin(), decompressed.end()) == expected);
+
+		nbt::NBTFile in;
+		in.readNBT(compressed.data(), compressed.size(), compressions[i]);
+		BOOST_CHECK(in.findTag<nbt::TagByteArray>("bytearray").payload == bytearray_data);
+	}
+
+	std::string invalid = "This is not compressed data.";
+	BOOST_CHECK_THROW(nbt::decompress(invalid.data(), invalid.size(), decompressed,
+			nbt::Compression::ZLIB), nbt::NBTError);
+}
+
+BOOST_AUTO_TEST_CASE(nbt_testDocument) {
+	std::vector<int32_t> intarray_data = {1, 1, 2, 3, 5, 8, 13, 21};
+	nbt::NBTFile out("TestNBTFile");
+	out.addTag("byte", nbt::TagByte(42));
+	out.addTag("short", nbt::TagShort(1337));
+	out.addTag("int", nbt::TagInt(-23));
+	out.addTag("long", nbt::TagLong(123456789012LL));
+	out.addTag("float", nbt::TagFloat(3.1415926));
+	out.addTag("double", nbt::TagDouble(2.7182818));
+	out.addTag("string", nbt::TagString("foobar"));
+	nbt::TagList list(nbt::TagInt::TAG_TYPE);
+	for (int i = 0; i < 5; i++)
+		list.payload.push_back(nbt::TagPtr(new nbt::TagInt(i * i)));
+	out.addTag("list", list);
+	out.addTag("intarray", nbt::TagIntArray(intarray_data));
+	out.addTag("compound", out);
+
+	std::stringstream stream;
+	out.writeNBT(stream, nbt::Compression::NO_COMPRESSION);
+	std::string data = stream.str();
+
+	nbt::Document document;
+	document.parse(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+	const nbt::Document::Node& root = document.getRoot();
+	BOOST_CHECK_EQUAL(root.getName(), "TestNBTFile");
+	BOOST_CHECK_EQUAL(root.length, 10);
+
+	// the nested compound has the same tags (without itself)
+	const nbt::Document::Node* compound = document.findChild(root, "compound",
+			nbt::TagCompound::TAG_TYPE);
+	BOOST_REQUIRE(compound != nullptr);
+	BOOST_CHECK_EQUAL(compound->length, 9);
+	const nbt::Document::Node* parents[] = {&root, compound};
+	for (int i = 0; i < 2; i++) {
+		const nbt::Document::Node& parent = *parents[i];
+		BOOST_REQUIRE(document.findChild(parent, "byte") != nullptr);
+		BOOST_CHECK_EQUAL(document.findChild(parent, "byte")->getInt(), 42);
+		BOOST_CHECK_EQUAL(document.findChild(parent, "short")->getInt(), 1337);
+		BOOST_CHECK_EQUAL(document.findChild(parent, "int")->getInt(), -23);
+		BOOST_CHECK_EQUAL(document.findChild(parent, "long")->getInt(), 123456789012LL);
+		BOOST_CHECK_CLOSE(document.findChild(parent, "float")->getDouble(), 3.1415926, 0.0001);
+		BOOST_CHECK_CLOSE(document.findChild(parent, "double")->getDouble(), 2.7182818, 0.0001);
+		BOOST_CHECK_EQUAL(document.findChild(parent, "string")->getString(), "foobar");
+		BOOST_CHECK(document.findChild(parent, "string", nbt::TagInt::TAG_TYPE) == nullptr);
+		BOOST_CHECK(document.findChild(parent, "foo") == nullptr);
+		BOOST_CHECK_THROW(document.findChild(parent, "string")->getInt(), nbt::InvalidTagCast);
+
+		const nbt::Document::Node* list = document.findChild(parent, "list");
+		BOOST_REQUIRE(list != nullptr);
+		BOOST_CHECK_EQUAL((int) list->list_type, (int) nbt::TagInt::TAG_TYPE);
+		BOOST_CHECK_EQUAL(list->length, 5);
+		int j = 0;
+		for (const nbt::Document::Node* element = document.getFirstChild(*list);
+				element != nullptr; element = document.getNextSibling(*element), j++)
+			BOOST_CHECK_EQUAL(element->getInt(), j * j);
+		BOOST_CHECK_EQUAL(j, 5);
+
+		const nbt::Document::Node* intarray = document.findChild(parent, "intarray");
+		BOOST_REQUIRE(intarray != nullptr);
+		BOOST_CHECK_EQUAL(intarray->length, (int32_t) intarray_data.size());
+	}
+
+	// the tags are written sorted by name, so the dumps are the same
+	std::stringstream dump1, dump2;
+	out.dump(dump1);
+	document.dump(dump2);
+	BOOST_CHECK_EQUAL(dump1.str(), dump2.str());
+
+	// truncated data is invalid
+	BOOST_CHECK_THROW(document.parse(reinterpret_cast<const uint8_t*>(data.data()),
+			data.size() - 5), nbt::NBTError);
+
+	// too deeply nested lists are invalid, also when they are skipped
+	std::vector<uint8_t> nested;
+	for (int i = 0; i < 1000; i++) {
+		// a list with one list
+		uint8_t list[] = {nbt::TagList::TAG_TYPE, 0, 0, 0, 1};
+		nested.insert(nested.end(), list, list + 5);
+	}
+	// and an empty list of bytes as innermost list
+	uint8_t empty[] = {nbt::TagByte::TAG_TYPE, 0, 0, 0, 0};
+	nested.insert(nested.end(), empty, empty + 5);
+	nbt::BufferReader reader(nested.data(), nested.size());
+	BOOST_CHECK_THROW(reader.skipPayload(nbt::TagList::TAG_TYPE), nbt::NBTError);
+}
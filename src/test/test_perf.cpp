@@ -0,0 +1,369 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MapcrafterPerfTests
+
+#include "../mapcraftercore/config/mapcrafterconfig.h"
+#include "../mapcraftercore/mc/chunk.h"
+#include "../mapcraftercore/mc/region.h"
+#include "../mapcraftercore/mc/world.h"
+#include "../mapcraftercore/renderer/blockimages.h"
+#include "../mapcraftercore/renderer/blocktextures.h"
+#include "../mapcraftercore/renderer/image.h"
+#include "../mapcraftercore/renderer/renderview.h"
+#include "../mapcraftercore/renderer/tilerenderer.h"
+#include "../mapcraftercore/renderer/tilerenderworker.h"
+#include "../mapcraftercore/renderer/tileset.h"
+#include "../mapcraftercore/util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace config = mapcrafter::config;
+namespace mc = mapcrafter::mc;
+namespace renderer = mapcrafter::renderer;
+namespace util = mapcrafter::util;
+namespace fs = boost::filesystem;
+
+/*
+ * The performance tests measure the wall time and the count of heap allocations of
+ * workloads on the test region and compare them with the budgets in
+ * data/perf_budgets.txt, which are recorded per build type.
+ *
+ * The allocations are always checked (with a tolerance of 0.1). The wall time depends on
+ * the machine, so it's only checked with the environment variable MAPCRAFTER_PERF_TIMING=1,
+ * and MAPCRAFTER_PERF_TOLERANCE=<fraction> changes its tolerance (0.5 by default).
+ *
+ * Run the tests with MAPCRAFTER_PERF_RECORD=1 to record the budgets of the build type on
+ * this machine. They are written with the other budgets to perf_budgets.txt in the build
+ * directory (PERF_RECORD_FILE), copy that file to data/ to update the budgets.
+ */
+
+#ifndef PERF_BUILD_TYPE
+#  define PERF_BUILD_TYPE "default"
+#endif
+
+#ifndef PERF_RECORD_FILE
+#  define PERF_RECORD_FILE "perf_budgets.txt"
+#endif
+
+namespace {
+
+std::atomic<uint64_t> allocations(0);
+
+}
+
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+// gcc warns about freeing memory of operator new, but the one above allocates it with malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#  pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+const std::string BUDGETS_FILE = "data/perf_budgets.txt";
+
+struct Budget {
+	double seconds;
+	uint64_t allocations;
+};
+
+/**
+ * The budgets of all build types: (build type, workload) -> budget.
+ */
+std::map<std::pair<std::string, std::string>, Budget> readBudgets(
+		const std::string& filename = BUDGETS_FILE) {
+	std::map<std::pair<std::string, std::string>, Budget> budgets;
+	std::ifstream in(filename);
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ss(line);
+		std::string build_type, workload;
+		Budget budget;
+		if (ss >> build_type >> workload >> budget.seconds >> budget.allocations)
+			budgets[std::make_pair(build_type, workload)] = budget;
+	}
+	return budgets;
+}
+
+void writeBudgets(const std::map<std::pair<std::string, std::string>, Budget>& budgets) {
+	std::ofstream out(PERF_RECORD_FILE);
+	out << "# performance budgets of the perf tests, see test_perf.cpp" << std::endl;
+	out << "# build type, workload, wall time (seconds), heap allocations" << std::endl;
+	for (auto it = budgets.begin(); it != budgets.end(); ++it)
+		out << it->first.first << " " << it->first.second << " " << it->second.seconds
+			<< " " << it->second.allocations << std::endl;
+}
+
+/**
+ * Runs a workload once to warm up and then a few times, and returns the shortest wall
+ * time and the heap allocations of a run.
+ */
+Budget measure(std::function<void ()> workload, int repetitions = 3) {
+	workload();
+	Budget measured = {std::numeric_limits<double>::max(), 0};
+	for (int i = 0; i < repetitions; i++) {
+		uint64_t allocations_before = allocations.load();
+		auto start = std::chrono::steady_clock::now();
+		workload();
+		std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+		measured.seconds = std::min(measured.seconds, seconds.count());
+		measured.allocations = allocations.load() - allocations_before;
+	}
+	return measured;
+}
+
+/**
+ * Checks the measurements of a workload against its budget of this build type, or
+ * records them as budget.
+ */
+void checkBudget(const std::string& workload, const Budget& measured) {
+	auto key = std::make_pair(std::string(PERF_BUILD_TYPE), workload);
+	BOOST_TEST_MESSAGE(workload << ": " << measured.seconds << "s, "
+			<< measured.allocations << " allocations");
+
+	std::map<std::pair<std::string, std::string>, Budget> budgets = readBudgets();
+	const char* record = std::getenv("MAPCRAFTER_PERF_RECORD");
+	if (record != nullptr && std::string(record) == "1") {
+		// the file in the build directory has the budgets recorded by the tests before
+		std::map<std::pair<std::string, std::string>, Budget> recorded
+			= readBudgets(PERF_RECORD_FILE);
+		for (auto it = recorded.begin(); it != recorded.end(); ++it)
+			budgets[it->first] = it->second;
+		budgets[key] = measured;
+		writeBudgets(budgets);
+		BOOST_TEST_MESSAGE("Recorded the budget of " << workload << " in "
+				<< PERF_RECORD_FILE << ".");
+		return;
+	}
+	if (!budgets.count(key)) {
+		BOOST_TEST_MESSAGE("No budget of " << workload << " for build type "
+				<< PERF_BUILD_TYPE << ", record it with MAPCRAFTER_PERF_RECORD=1.");
+		return;
+	}
+
+	const Budget& budget = budgets[key];
+	const char* timing = std::getenv("MAPCRAFTER_PERF_TIMING");
+	if (timing != nullptr && std::string(timing) == "1") {
+		double tolerance = 0.5;
+		const char* tolerance_env = std::getenv("MAPCRAFTER_PERF_TOLERANCE");
+		if (tolerance_env != nullptr)
+			tolerance = std::atof(tolerance_env);
+		BOOST_CHECK_MESSAGE(measured.seconds <= budget.seconds * (1 + tolerance),
+				workload << " took " << measured.seconds << "s, the budget is "
+				<< budget.seconds << "s");
+	}
+	BOOST_CHECK_MESSAGE(measured.allocations <= budget.allocations * 1.1,
+			workload << " made " << measured.allocations << " allocations, the budget is "
+			<< budget.allocations);
+}
+
+void writeTexture(const fs::path& path, int width, int height, uint32_t color) {
+	fs::create_directories(path.parent_path());
+	renderer::RGBAImage image(width, height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			image.pixel(x, y) = renderer::rgba(renderer::rgba_red(color) ^ (x * 4),
+					renderer::rgba_green(color) ^ (y * 4), renderer::rgba_blue(color),
+					renderer::rgba_alpha(color));
+	image.writePNG(path.string());
+}
+
+/**
+ * Writes a texture directory with a plain texture of its own color for every block
+ * texture, Minecraft's textures are not part of the repository.
+ */
+void writeTextures(const fs::path& dir) {
+	renderer::BlockTextures block_textures;
+	for (auto it = block_textures.textures.begin(); it != block_textures.textures.end(); ++it) {
+		const std::string& name = (*it)->getName();
+		uint32_t hash = std::hash<std::string>()(name);
+		bool transparent = name.find("glass") != std::string::npos
+				|| name.find("leaves") != std::string::npos
+				|| name.find("water") != std::string::npos;
+		writeTexture(dir / "blocks" / (name + ".png"), 16, 16, renderer::rgba(hash & 0xff,
+				(hash >> 8) & 0xff, (hash >> 16) & 0xff, transparent ? 180 : 255));
+	}
+
+	uint32_t brown = renderer::rgba(120, 80, 30, 255);
+	const char* chests[] = {"normal", "ender", "trapped"};
+	for (size_t i = 0; i < 3; i++)
+		writeTexture(dir / "entity" / "chest" / (std::string(chests[i]) + ".png"), 64, 64, brown);
+	writeTexture(dir / "entity" / "chest" / "normal_double.png", 128, 64, brown);
+	writeTexture(dir / "entity" / "chest" / "trapped_double.png", 128, 64, brown);
+	const char* colors[] = {"white", "orange", "magenta", "light_blue", "yellow", "lime",
+			"pink", "gray", "silver", "cyan", "purple", "blue", "brown", "green", "red", "black"};
+	for (size_t i = 0; i < 16; i++) {
+		writeTexture(dir / "entity" / "shulker" / ("shulker_" + std::string(colors[i]) + ".png"),
+				64, 64, renderer::rgba(200, 100, 200, 255));
+		writeTexture(dir / "entity" / "bed" / (std::string(colors[i]) + ".png"),
+				64, 64, renderer::rgba(200, 30, 30, 255));
+	}
+	writeTexture(dir / "colormap" / "foliage.png", 256, 256, renderer::rgba(60, 160, 50, 255));
+	writeTexture(dir / "colormap" / "grass.png", 256, 256, renderer::rgba(80, 180, 60, 255));
+	writeTexture(dir / "endportal.png", 16, 16, renderer::rgba(10, 10, 40, 255));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(perf_testReadChunks) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+
+	// Chunk::readNBT of every chunk of the region
+	int failed = 0;
+	checkBudget("read_chunks", measure([&]() {
+		mc::Chunk chunk;
+		for (auto it = chunks.begin(); it != chunks.end(); ++it)
+			if (region.loadChunk(*it, chunk) != mc::RegionFile::CHUNK_OK)
+				failed++;
+	}));
+	BOOST_CHECK_EQUAL(failed, 0);
+}
+
+BOOST_AUTO_TEST_CASE(perf_testRenderTiles) {
+	fs::path texture_dir = fs::temp_directory_path() / fs::unique_path("mapcrafter_perf_%%%%%%%%");
+	writeTextures(texture_dir);
+
+	std::ostringstream config_string;
+	config_string << "output_dir = perf_output" << std::endl;
+	config_string << "template_dir = ." << std::endl;
+	config_string << "[world:test]" << std::endl << "input_dir = data" << std::endl;
+	config_string << "[map:test]" << std::endl << "world = test" << std::endl;
+	config_string << "texture_dir = " << texture_dir.string() << std::endl;
+	config::MapcrafterConfig config;
+	config::ValidationMap validation = config.parseString(config_string.str(), fs::current_path());
+	BOOST_REQUIRE(!validation.isCritical());
+
+	config::MapSection map_config = config.getMap("test");
+	renderer::TextureResources textures;
+	bool textures_loaded = textures.loadTextures(texture_dir.string(),
+			map_config.getTextureSize(), map_config.getTextureBlur(),
+			map_config.getWaterOpacity());
+	fs::remove_all(texture_dir);
+	BOOST_REQUIRE(textures_loaded);
+
+	mc::World world(config.getWorld("test").getInputDir().string());
+	BOOST_REQUIRE(world.load());
+
+	// set up the map like the render manager does
+	std::unique_ptr<renderer::RenderView> render_view(
+			renderer::createRenderView(map_config.getRenderView()));
+	std::unique_ptr<renderer::BlockImages> block_images(render_view->createBlockImages());
+	std::unique_ptr<renderer::TileSet> tile_set(
+			render_view->createTileSet(map_config.getTileWidth()));
+	tile_set->scan(world);
+	renderer::RenderContext context;
+	context.background_color = config.getBackgroundColor();
+	context.world_config = config.getWorld("test");
+	context.map_config = map_config;
+	render_view->configureBlockImages(block_images.get(), context.world_config, map_config);
+	block_images->setRotation(0);
+	block_images->generateBlocks(textures);
+	context.render_view = render_view.get();
+	context.block_images = block_images.get();
+	context.tile_set = tile_set.get();
+	context.world = world;
+	context.initializeTileRenderer();
+
+	// TileRenderer::renderTile of every render tile of the region
+	const std::set<renderer::TilePos>& tiles = tile_set->getRequiredRenderTiles();
+	BOOST_REQUIRE(!tiles.empty());
+	renderer::RGBAImage image;
+	checkBudget("render_tiles", measure([&]() {
+		for (auto it = tiles.begin(); it != tiles.end(); ++it)
+			context.tile_renderer->renderTile(*it + tile_set->getTileOffset(), image);
+	}));
+}
+
+BOOST_AUTO_TEST_CASE(perf_testGenerateBlocks) {
+	fs::path texture_dir = fs::temp_directory_path() / fs::unique_path("mapcrafter_perf_%%%%%%%%");
+	writeTextures(texture_dir);
+	renderer::TextureResources textures;
+	bool textures_loaded = textures.loadTextures(texture_dir.string(), 16, 0, 1.0);
+	fs::remove_all(texture_dir);
+	BOOST_REQUIRE(textures_loaded);
+
+	std::unique_ptr<renderer::RenderView> render_view(
+			renderer::createRenderView(renderer::RenderViewType::ISOMETRIC));
+	auto generate = [&](int threads) {
+		std::unique_ptr<renderer::BlockImages> block_images(render_view->createBlockImages());
+		block_images->setRotation(1);
+		block_images->generateBlocks(textures, threads);
+		return block_images;
+	};
+
+	// the block images generated with multiple threads are the same as the ones
+	// generated with one thread
+	std::unique_ptr<renderer::BlockImages> serial = generate(1);
+	std::unique_ptr<renderer::BlockImages> parallel = generate(4);
+	BOOST_CHECK_EQUAL(serial->getTransparencyHash(), parallel->getTransparencyHash());
+	renderer::RGBAImage serial_blocks = serial->exportBlocks();
+	renderer::RGBAImage parallel_blocks = parallel->exportBlocks();
+	BOOST_REQUIRE_EQUAL(serial_blocks.getWidth(), parallel_blocks.getWidth());
+	BOOST_REQUIRE_EQUAL(serial_blocks.getHeight(), parallel_blocks.getHeight());
+	int different = 0;
+	for (int y = 0; y < serial_blocks.getHeight(); y++)
+		for (int x = 0; x < serial_blocks.getWidth(); x++)
+			if (serial_blocks.getPixel(x, y) != parallel_blocks.getPixel(x, y))
+				different++;
+	BOOST_CHECK_EQUAL(different, 0);
+
+	// BlockImages::generateBlocks of the isometric block images
+	checkBudget("generate_blocks", measure([&]() {
+		generate(4);
+	}));
+}
@@ -17,13 +17,23 @@
  * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "../mapcraftercore/mc/blockstate.h"
 #include "../mapcraftercore/mc/chunk.h"
+#include "../mapcraftercore/mc/chunkhashindex.h"
 #include "../mapcraftercore/mc/region.h"
+#include "../mapcraftercore/mc/snapshot.h"
+#include "../mapcraftercore/mc/world.h"
 #include "../mapcraftercore/util.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <set>
 #include <sstream>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 
 namespace mc = mapcrafter::mc;
@@ -50,4 +60,849 @@ BOOST_AUTO_TEST_CASE(region_testReadWrite) {
 		BOOST_CHECK(in2.loadChunk(*it2, chunk2));
 	}
 
+	// the sector counts of the written chunks are set
+	std::ifstream file("data/r.-1.0.mca", std::ios::binary);
+	uint8_t header[4096];
+	BOOST_REQUIRE(file.read(reinterpret_cast<char*>(header), sizeof(header)));
+	int chunks = 0;
+	for (int i = 0; i < 1024; i++) {
+		if (header[4 * i] == 0 && header[4 * i + 1] == 0 && header[4 * i + 2] == 0)
+			continue;
+		chunks++;
+		BOOST_CHECK_GT(header[4 * i + 3], 0);
+	}
+	BOOST_CHECK_EQUAL(chunks, 120);
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkData) {
+	mc::RegionFile in("data/region/r.-1.0.mca");
+	BOOST_CHECK(in.read());
+	BOOST_CHECK(in.isMemoryMapped());
+
+	std::ifstream file("data/region/r.-1.0.mca", std::ios::binary);
+	std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>());
+
+	// copies of a region file share the region data
+	mc::RegionFile copy = in;
+	auto chunks = in.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = in.getChunkData(*it);
+		BOOST_REQUIRE(!data.empty());
+		BOOST_CHECK(std::search(contents.begin(), contents.end(),
+				data.data(), data.data() + data.size()) != contents.end());
+		BOOST_CHECK_EQUAL(copy.getChunkData(*it).data(), data.data());
+	}
+
+	// chunk data set by the user takes precedence over the region data
+	mc::ChunkPos pos = *chunks.begin();
+	std::vector<uint8_t> data(42, 73);
+	copy.setChunkData(pos, data, 2);
+	BOOST_CHECK_EQUAL(copy.getChunkData(pos).size(), 42);
+	BOOST_CHECK_NE(in.getChunkData(pos).data(), copy.getChunkData(pos).data());
+
+	copy.setChunkData(pos, std::vector<uint8_t>(), 2);
+	BOOST_CHECK(copy.getChunkData(pos).empty());
+	BOOST_CHECK(!copy.hasChunk(pos));
+	BOOST_CHECK_EQUAL(copy.getContainingChunksCount(), 119);
+}
+
+BOOST_AUTO_TEST_CASE(region_testReadLazily) {
+	mc::RegionFile in1("data/region/r.-1.0.mca");
+	mc::RegionFile in2("data/region/r.-1.0.mca");
+	BOOST_CHECK(in1.read());
+	BOOST_CHECK(in2.readLazily());
+	BOOST_CHECK(!in2.isMemoryMapped());
+	BOOST_CHECK_EQUAL(in2.getContainingChunksCount(), 120);
+
+	auto chunks = in1.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		BOOST_CHECK(in2.hasChunk(*it));
+		BOOST_CHECK_EQUAL(in1.getChunkTimestamp(*it), in2.getChunkTimestamp(*it));
+
+		mc::Chunk chunk;
+		BOOST_CHECK(in2.loadChunk(*it, chunk) == mc::RegionFile::CHUNK_OK);
+		BOOST_CHECK_EQUAL(in1.getChunkDataCompression(*it),
+				in2.getChunkDataCompression(*it));
+
+		mc::ChunkData data1 = in1.getChunkData(*it);
+		mc::ChunkData data2 = in2.getChunkData(*it);
+		BOOST_REQUIRE_EQUAL(data1.size(), data2.size());
+		BOOST_CHECK(std::equal(data1.data(), data1.data() + data1.size(), data2.data()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testReadAheadChunks) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.readLazily());
+	auto contained = region.getContainingChunks();
+	std::vector<mc::ChunkPos> chunks(contained.begin(), contained.end());
+	BOOST_REQUIRE(!chunks.empty());
+
+	// the data of all chunks is at most the whole file after the header
+	size_t bytes = region.readAheadChunks(chunks);
+	BOOST_CHECK_GT(bytes, 0);
+	BOOST_CHECK_LE(bytes, fs::file_size("data/region/r.-1.0.mca") - 8192);
+	BOOST_CHECK_EQUAL(region.readAheadChunks(std::vector<mc::ChunkPos>()), 0);
+
+	// chunks which were read already aren't read ahead again
+	mc::Chunk chunk;
+	BOOST_CHECK(region.loadChunk(chunks[0], chunk) == mc::RegionFile::CHUNK_OK);
+	BOOST_CHECK_EQUAL(region.readAheadChunks(std::vector<mc::ChunkPos>(1, chunks[0])), 0);
+	BOOST_CHECK_GT(region.readAheadChunks(std::vector<mc::ChunkPos>(1, chunks[1])), 0);
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkDecoding) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// compare the data of the chunks with the data of the NBT tag tree
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::Chunk chunk;
+		BOOST_REQUIRE(region.loadChunk(*it, chunk) == mc::RegionFile::CHUNK_OK);
+		BOOST_CHECK_EQUAL(chunk.getPos(), *it);
+
+		mc::ChunkData data = region.getChunkData(*it);
+		mc::nbt::NBTFile nbt;
+		nbt.readNBT(reinterpret_cast<const char*>(data.data()), data.size(),
+				mc::nbt::Compression::ZLIB);
+		const mc::nbt::TagCompound& level = nbt.findTag<mc::nbt::TagCompound>("Level");
+
+		const mc::nbt::TagByteArray& biomes = level.findTag<mc::nbt::TagByteArray>("Biomes");
+		for (int i = 0; i < 256; i++)
+			BOOST_CHECK_EQUAL(chunk.getBiomeAt(mc::LocalBlockPos(i % 16, i / 16, 0)),
+					(uint8_t) biomes.payload[i]);
+
+		const mc::nbt::TagList& sections = level.findTag<mc::nbt::TagList>("Sections");
+		for (auto section_it = sections.payload.begin();
+				section_it != sections.payload.end(); ++section_it) {
+			const mc::nbt::TagCompound& section = (*section_it)->cast<mc::nbt::TagCompound>();
+			int y = section.findTag<mc::nbt::TagByte>("Y").payload;
+			BOOST_REQUIRE(chunk.hasSection(y));
+
+			const mc::nbt::TagByteArray& blocks = section.findTag<mc::nbt::TagByteArray>("Blocks");
+			const mc::nbt::TagByteArray& light = section.findTag<mc::nbt::TagByteArray>("SkyLight");
+			const mc::nbt::TagByteArray& block_data = section.findTag<mc::nbt::TagByteArray>("Data");
+			bool air = true;
+			for (int i = 0; i < 4096; i++) {
+				mc::LocalBlockPos pos(i % 16, (i / 16) % 16, y * 16 + i / 256);
+				BOOST_CHECK_EQUAL(chunk.getBlockID(pos), (uint8_t) blocks.payload[i]);
+				BOOST_CHECK_EQUAL(chunk.getSkyLight(pos),
+						(light.payload[i / 2] >> (4 * (i % 2))) & 0xf);
+				BOOST_CHECK_EQUAL(chunk.getBlockData(pos),
+						(block_data.payload[i / 2] >> (4 * (i % 2))) & 0xf);
+				air = air && blocks.payload[i] == 0;
+			}
+			BOOST_CHECK_EQUAL(chunk.isSectionAir(y), air);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkMemoryUsage) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// the uniform arrays of the sections (at least the Add arrays) are not stored for
+	// every section, so the chunks need less memory than the full arrays
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::Chunk chunk;
+		BOOST_REQUIRE(region.loadChunk(*it, chunk) == mc::RegionFile::CHUNK_OK);
+		int sections = 0;
+		for (int i = 0; i < mc::CHUNK_HEIGHT; i++)
+			sections += chunk.hasSection(i);
+		if (sections > 1)
+			BOOST_CHECK_LT(chunk.getMemoryUsage(), sections * (4096 + 4 * 2048));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkHeights) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// the highest block of every column must be the highest non-air block, the water
+	// depth the count of full water blocks from there downwards
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		for (int rotation = 0; rotation < 4; rotation++) {
+			mc::ChunkData data = region.getChunkData(*it);
+			mc::Chunk chunk;
+			chunk.setRotation(rotation);
+			BOOST_REQUIRE(chunk.readNBT(reinterpret_cast<const char*>(data.data()),
+					data.size()));
+			int chunk_highest = -1;
+			for (int x = 0; x < 16; x++)
+				for (int z = 0; z < 16; z++) {
+					mc::LocalBlockPos pos(x, z, mc::CHUNK_HEIGHT * 16 - 1);
+					while (pos.y >= 0 && chunk.getBlockID(pos) == 0)
+						pos.y--;
+					BOOST_CHECK_EQUAL(chunk.getHighestBlock(pos), pos.y);
+					chunk_highest = std::max(chunk_highest, pos.y);
+					int depth = 0;
+					for (; pos.y >= 0; pos.y--, depth++) {
+						uint16_t id = chunk.getBlockID(pos);
+						if ((id != 8 && id != 9) || chunk.getBlockData(pos) != 0)
+							break;
+					}
+					BOOST_CHECK_EQUAL(chunk.getWaterDepth(pos), depth);
+				}
+			BOOST_CHECK_EQUAL(chunk.getHighestBlock(), chunk_highest);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkSectionArrays) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// the arrays of the sections must contain the same values as the single blocks
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		mc::Chunk chunk;
+		chunk.setRotation(1);
+		BOOST_REQUIRE(chunk.readNBT(reinterpret_cast<const char*>(data.data()),
+				data.size()));
+		for (int section = 0; section < mc::CHUNK_HEIGHT; section++) {
+			if (!chunk.hasSection(section)) {
+				BOOST_CHECK(chunk.getSectionArray(section, 0) == nullptr);
+				continue;
+			}
+			const uint8_t* arrays[5];
+			for (int i = 0; i < 5; i++)
+				arrays[i] = chunk.getSectionArray(section, i);
+			for (int i = 0; i < 16 * 16 * 16; i++) {
+				mc::LocalBlockPos pos(i % 16, (i / 16) % 16, section * 16 + i / 256);
+				int shift = (i % 2) * 4;
+				BOOST_CHECK_EQUAL(chunk.getBlockData(pos), (arrays[0][i / 2] >> shift) & 0xf);
+				BOOST_CHECK_EQUAL(chunk.getBlockLight(pos), (arrays[1][i / 2] >> shift) & 0xf);
+				BOOST_CHECK_EQUAL(chunk.getSkyLight(pos), (arrays[2][i / 2] >> shift) & 0xf);
+				BOOST_CHECK_EQUAL(chunk.getBlockID(pos),
+						arrays[3][i] + (((arrays[4][i / 2] >> shift) & 0xf) << 8));
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkRotation) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// the sections of rotated chunks are stored rotated, the blocks must still be the
+	// blocks of the unrotated chunk at the rotated positions
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		mc::Chunk original;
+		BOOST_REQUIRE(original.readNBT(raw, data.size()));
+		for (int rotation = 1; rotation < 4; rotation++) {
+			mc::Chunk chunk;
+			chunk.setRotation(rotation);
+			BOOST_REQUIRE(chunk.readNBT(raw, data.size()));
+			for (int x = 0; x < 16; x++)
+				for (int z = 0; z < 16; z++) {
+					// rotate the position back to the original rotation
+					int ox = x, oz = z;
+					for (int i = 0; i < rotation; i++) {
+						int tmp = ox;
+						ox = oz;
+						oz = 15 - tmp;
+					}
+					BOOST_CHECK_EQUAL(chunk.getBiomeAt(mc::LocalBlockPos(x, z, 0)),
+							original.getBiomeAt(mc::LocalBlockPos(ox, oz, 0)));
+					for (int y = 0; y < mc::CHUNK_HEIGHT * 16; y++) {
+						mc::LocalBlockPos pos(x, z, y), original_pos(ox, oz, y);
+						BOOST_CHECK_EQUAL(chunk.getBlockID(pos), original.getBlockID(original_pos));
+						BOOST_CHECK_EQUAL(chunk.getBlockData(pos),
+								original.getBlockData(original_pos));
+						BOOST_CHECK_EQUAL(chunk.getSkyLight(pos), original.getSkyLight(original_pos));
+					}
+				}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkLoadRotated) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// rotating a loaded chunk must be the same as reading it with the rotation
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		mc::Chunk original;
+		BOOST_REQUIRE(original.readNBT(raw, data.size()));
+		for (int rotation = 0; rotation < 4; rotation++) {
+			mc::Chunk chunk, rotated;
+			chunk.setRotation(rotation);
+			BOOST_REQUIRE(chunk.readNBT(raw, data.size()));
+			rotated.loadRotated(original, rotation);
+			BOOST_CHECK(rotated.getPos() == chunk.getPos());
+			BOOST_CHECK_EQUAL(rotated.getContentHash(), chunk.getContentHash());
+			BOOST_CHECK_EQUAL(rotated.getHighestBlock(), chunk.getHighestBlock());
+			BOOST_CHECK(rotated.getRevision() != original.getRevision());
+			for (int x = 0; x < 16; x++)
+				for (int z = 0; z < 16; z++) {
+					mc::LocalBlockPos pos(x, z, 0);
+					BOOST_CHECK_EQUAL(rotated.getHighestBlock(pos), chunk.getHighestBlock(pos));
+					BOOST_CHECK_EQUAL(rotated.getWaterDepth(pos), chunk.getWaterDepth(pos));
+				}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkUnpackSections) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	// unpacked chunks (and rotated copies of them) must have the same blocks
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		mc::Chunk original, unpacked;
+		BOOST_REQUIRE(original.readNBT(raw, data.size()));
+		BOOST_REQUIRE(unpacked.readNBT(raw, data.size()));
+		BOOST_CHECK(!unpacked.isUnpacked());
+		unpacked.unpackSections();
+		for (int rotation = 0; rotation < 4; rotation++) {
+			mc::Chunk chunk, rotated;
+			chunk.loadRotated(original, rotation);
+			rotated.loadRotated(unpacked, rotation);
+			BOOST_CHECK_EQUAL(rotated.isUnpacked(), unpacked.isUnpacked());
+			for (int i = 0; i < 16 * 16 * mc::CHUNK_HEIGHT * 16; i++) {
+				mc::LocalBlockPos pos(i % 16, (i / 16) % 16, i / 256);
+				BOOST_CHECK_EQUAL(rotated.getBlockID(pos), chunk.getBlockID(pos));
+				BOOST_CHECK_EQUAL(rotated.getBlockData(pos), chunk.getBlockData(pos));
+				BOOST_CHECK_EQUAL(rotated.getBlockLight(pos), chunk.getBlockLight(pos));
+				BOOST_CHECK_EQUAL(rotated.getSkyLight(pos), chunk.getSkyLight(pos));
+			}
+		}
+		// reading the chunk again discards the unpacked arrays
+		BOOST_REQUIRE(unpacked.readNBT(raw, data.size()));
+		BOOST_CHECK(!unpacked.isUnpacked());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkSnapshot) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	mc::WorldCrop world_crop;
+	world_crop.setMinY(40);
+	world_crop.setMinX(-300);
+	world_crop.loadBlockMask("!1 !3:0");
+
+	// reading the snapshot of a chunk must be the same as reading its NBT data,
+	// also with rotation and world crop
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		mc::Chunk original;
+		BOOST_REQUIRE(original.readNBT(raw, data.size()));
+		std::vector<uint8_t> snapshot;
+		original.writeSnapshot(snapshot);
+		for (int rotation = 0; rotation < 4; rotation++) {
+			for (int crop = 0; crop < 2; crop++) {
+				mc::Chunk chunk, loaded;
+				chunk.setRotation(rotation);
+				loaded.setRotation(rotation);
+				if (crop) {
+					chunk.setWorldCrop(world_crop);
+					loaded.setWorldCrop(world_crop);
+				}
+				BOOST_REQUIRE(chunk.readNBT(raw, data.size()));
+				BOOST_REQUIRE(loaded.readSnapshot(snapshot.data(), snapshot.size()));
+				BOOST_CHECK(loaded.getPos() == chunk.getPos());
+				BOOST_CHECK_EQUAL(loaded.getContentHash(), chunk.getContentHash());
+				BOOST_CHECK_EQUAL(loaded.getHighestBlock(), chunk.getHighestBlock());
+				BOOST_CHECK_EQUAL(loaded.getSigns().size(), chunk.getSigns().size());
+			}
+		}
+		// truncated data is invalid
+		mc::Chunk chunk;
+		BOOST_CHECK(!chunk.readSnapshot(snapshot.data(), snapshot.size() / 2));
+	}
+
+	// the chunks of a region are loaded from its snapshot file,
+	// which is only rewritten if chunks changed
+	std::string snapshot_file = "data/region/r.-1.0.mcs";
+	std::remove(snapshot_file.c_str());
+	int decoded = 0, reused = 0;
+	BOOST_REQUIRE(mc::convertRegionSnapshot(region.getFilename(), snapshot_file,
+			decoded, reused));
+	BOOST_CHECK_EQUAL(decoded, (int) chunks.size());
+	BOOST_CHECK_EQUAL(reused, 0);
+	BOOST_REQUIRE(mc::convertRegionSnapshot(region.getFilename(), snapshot_file,
+			decoded, reused));
+	BOOST_CHECK_EQUAL(decoded, (int) chunks.size());
+	BOOST_CHECK_EQUAL(reused, (int) chunks.size());
+
+	mc::RegionSnapshot snapshot;
+	BOOST_REQUIRE(snapshot.read(snapshot_file));
+	mc::RegionFile snapshot_region(region.getFilename());
+	snapshot_region.setRotation(2);
+	snapshot_region.setSnapshotFile(snapshot_file);
+	BOOST_REQUIRE(snapshot_region.readLazily());
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		size_t index = it->getLocalZ() * 32 + it->getLocalX();
+		BOOST_CHECK(snapshot.hasChunk(index, region.getChunkTimestamp(*it)));
+		BOOST_CHECK(!snapshot.hasChunk(index, region.getChunkTimestamp(*it) + 1));
+
+		mc::ChunkPos pos = *it;
+		pos.rotate(2);
+		mc::Chunk original, chunk, loaded;
+		chunk.setRotation(2);
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		BOOST_REQUIRE(original.readNBT(raw, data.size()));
+		BOOST_REQUIRE(chunk.readNBT(raw, data.size()));
+		BOOST_CHECK_EQUAL(snapshot.getChunkHash(index), original.getContentHash());
+		BOOST_REQUIRE(snapshot_region.loadChunk(pos, loaded) == mc::RegionFile::CHUNK_OK);
+		BOOST_CHECK_EQUAL(loaded.getContentHash(), chunk.getContentHash());
+	}
+	std::remove(snapshot_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkCrop) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	mc::WorldCrop world_crop;
+	world_crop.setMinY(40);
+	world_crop.setMinX(-300);
+	world_crop.loadBlockMask("!1 !3:0");
+
+	// the blocks hidden by the world crop and block mask must be air
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		mc::Chunk original, chunk;
+		BOOST_REQUIRE(original.readNBT(raw, data.size()));
+		chunk.setWorldCrop(world_crop);
+		BOOST_REQUIRE(chunk.readNBT(raw, data.size()));
+		for (int x = 0; x < 16; x++)
+			for (int z = 0; z < 16; z++)
+				for (int y = 0; y < mc::CHUNK_HEIGHT * 16; y++) {
+					mc::LocalBlockPos pos(x, z, y);
+					uint16_t id = original.getBlockID(pos);
+					uint8_t block_data = original.getBlockData(pos);
+					bool hidden = y < 40 || pos.toGlobalPos(*it).x < -300
+							|| id == 1 || (id == 3 && block_data == 0);
+					BOOST_CHECK_EQUAL(chunk.getBlockID(pos), hidden ? 0 : id);
+					BOOST_CHECK_EQUAL(chunk.getBlockData(pos), hidden ? 0 : block_data);
+					BOOST_CHECK_EQUAL(chunk.getSkyLight(pos), hidden ? 15 : original.getSkyLight(pos));
+				}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkExtraData) {
+	// a chunk without sections, but with two beds
+	mc::nbt::TagCompound level;
+	level.addTag("xPos", mc::nbt::TagInt(-1));
+	level.addTag("zPos", mc::nbt::TagInt(2));
+	level.addTag("TerrainPopulated", mc::nbt::TagByte(1));
+	level.addTag("Biomes", mc::nbt::TagByteArray(std::vector<int8_t>(256, 1)));
+	level.addTag("Sections", mc::nbt::TagList(mc::nbt::TagCompound::TAG_TYPE));
+	mc::nbt::TagList tile_entities(mc::nbt::TagCompound::TAG_TYPE);
+	int beds[2][4] = {{-15, 10, 34, 3}, {-4, 64, 47, 11}};
+	for (int i = 0; i < 2; i++) {
+		mc::nbt::TagCompound bed;
+		bed.addTag("id", mc::nbt::TagString("minecraft:bed"));
+		bed.addTag("x", mc::nbt::TagInt(beds[i][0]));
+		bed.addTag("y", mc::nbt::TagInt(beds[i][1]));
+		bed.addTag("z", mc::nbt::TagInt(beds[i][2]));
+		bed.addTag("color", mc::nbt::TagInt(beds[i][3]));
+		tile_entities.payload.push_back(mc::nbt::TagPtr(bed.clone()));
+	}
+	level.addTag("TileEntities", tile_entities);
+	mc::nbt::NBTFile nbt;
+	nbt.addTag("Level", level);
+	std::stringstream stream;
+	nbt.writeNBT(stream, mc::nbt::Compression::NO_COMPRESSION);
+	std::string data = stream.str();
+
+	// the beds must be found at their (rotated) positions, other beds are red
+	for (int rotation = 0; rotation < 4; rotation++) {
+		mc::Chunk chunk;
+		chunk.setRotation(rotation);
+		BOOST_REQUIRE(chunk.readNBT(data.data(), data.size(),
+				mc::nbt::Compression::NO_COMPRESSION));
+		for (int i = 0; i < 2; i++) {
+			// rotate the local position of the bed, a rotated position (x, z) is
+			// (z, 15 - x) in the original chunk
+			mc::LocalBlockPos pos(mc::BlockPos(beds[i][0], beds[i][2], beds[i][1]));
+			for (int j = 0; j < rotation; j++) {
+				int x = pos.x;
+				pos.x = 15 - pos.z;
+				pos.z = x;
+			}
+			BOOST_CHECK_EQUAL(chunk.getBlockExtraData(pos, 26), beds[i][3]);
+		}
+		BOOST_CHECK_EQUAL(chunk.getBlockExtraData(mc::LocalBlockPos(5, 5, 5), 26), 14);
+		BOOST_CHECK_EQUAL(chunk.getBlockExtraData(mc::LocalBlockPos(5, 5, 5), 1), 0);
+	}
+}
+
+namespace {
+
+/**
+ * Packs palette indices into longs like Minecraft does, spanning two longs or not.
+ */
+std::vector<int64_t> packBlockStates(const std::vector<uint16_t>& indices, int bits,
+		bool spanning) {
+	std::vector<int64_t> longs;
+	if (spanning) {
+		longs.resize(indices.size() * bits / 64);
+		for (size_t i = 0; i < indices.size(); i++)
+			for (int b = 0; b < bits; b++)
+				if (indices[i] & (1 << b)) {
+					size_t bit = i * bits + b;
+					longs[bit / 64] |= 1LL << (bit % 64);
+				}
+	} else {
+		int per_long = 64 / bits;
+		longs.resize((indices.size() + per_long - 1) / per_long);
+		for (size_t i = 0; i < indices.size(); i++)
+			longs[i / per_long] |= (int64_t) indices[i] << ((i % per_long) * bits);
+	}
+	return longs;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(region_testBlockStates) {
+	std::vector<uint16_t> indices(4096);
+	for (int bits = 4; bits <= 12; bits++) {
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = (i * 7919 + i / 3) % (1 << bits);
+		for (int spanning = 0; spanning < 2; spanning++) {
+			std::vector<int64_t> longs = packBlockStates(indices, bits, spanning);
+			// the longs are big-endian in the NBT data
+			std::vector<uint8_t> data;
+			for (size_t i = 0; i < longs.size(); i++)
+				for (int j = 7; j >= 0; j--)
+					data.push_back((uint64_t) longs[i] >> (j * 8));
+			std::vector<uint16_t> unpacked(4096);
+			BOOST_REQUIRE(mc::unpackBlockStates(data.data(), longs.size(), bits,
+					unpacked.data()));
+			BOOST_CHECK(unpacked == indices);
+		}
+	}
+	uint16_t unpacked[4096];
+	uint8_t data[8 * 300] = {0};
+	BOOST_CHECK(!mc::unpackBlockStates(data, 300, 5, unpacked));
+
+	BOOST_CHECK_EQUAL(mc::getBlockStateBits(1), 4);
+	BOOST_CHECK_EQUAL(mc::getBlockStateBits(16), 4);
+	BOOST_CHECK_EQUAL(mc::getBlockStateBits(17), 5);
+	BOOST_CHECK_EQUAL(mc::getBlockStateBits(300), 9);
+
+	uint16_t id;
+	uint8_t block_data;
+	mc::BlockState state;
+	state.name = "minecraft:polished_andesite";
+	BOOST_CHECK(mc::lookupBlockState(state, id, block_data));
+	BOOST_CHECK_EQUAL(id, 1);
+	BOOST_CHECK_EQUAL(block_data, 6);
+	state.name = "minecraft:spruce_log";
+	state.properties.push_back(std::make_pair("axis", "z"));
+	BOOST_CHECK(mc::lookupBlockState(state, id, block_data));
+	BOOST_CHECK_EQUAL(id, 17);
+	BOOST_CHECK_EQUAL(block_data, 9);
+	state.name = "minecraft:red_wool";
+	state.properties.clear();
+	BOOST_CHECK(mc::lookupBlockState(state, id, block_data));
+	BOOST_CHECK_EQUAL(id, 35);
+	BOOST_CHECK_EQUAL(block_data, 14);
+	state.name = "minecraft:water";
+	state.properties.push_back(std::make_pair("level", "3"));
+	BOOST_CHECK(mc::lookupBlockState(state, id, block_data));
+	BOOST_CHECK_EQUAL(id, 8);
+	BOOST_CHECK_EQUAL(block_data, 3);
+	state.name = "minecraft:not_a_block";
+	BOOST_CHECK(!mc::lookupBlockState(state, id, block_data));
+	BOOST_CHECK_EQUAL(id, 0);
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkPalette) {
+	// a palette with 17 entries, so the indices have 5 bits
+	const char* names[] = {"air", "stone", "granite", "diorite", "andesite", "dirt",
+		"grass_block", "cobblestone", "oak_planks", "bedrock", "sand", "gravel",
+		"gold_ore", "iron_ore", "coal_ore", "glass", "obsidian"};
+	uint16_t expected[][2] = {{0, 0}, {1, 0}, {1, 1}, {1, 3}, {1, 5}, {3, 0}, {2, 0},
+		{4, 0}, {5, 0}, {7, 0}, {12, 0}, {13, 0}, {14, 0}, {15, 0}, {16, 0}, {20, 0},
+		{49, 0}};
+	std::vector<uint16_t> indices(4096);
+	for (size_t i = 0; i < indices.size(); i++)
+		indices[i] = (i * 31 + i / 16) % 17;
+
+	for (int spanning = 0; spanning < 2; spanning++) {
+		mc::nbt::TagList palette(mc::nbt::TagCompound::TAG_TYPE);
+		for (int i = 0; i < 17; i++) {
+			mc::nbt::TagCompound state;
+			state.addTag("Name", mc::nbt::TagString(std::string("minecraft:") + names[i]));
+			palette.payload.push_back(mc::nbt::TagPtr(state.clone()));
+		}
+		mc::nbt::TagCompound section;
+		section.addTag("Y", mc::nbt::TagByte(3));
+		section.addTag("Palette", palette);
+		section.addTag("BlockStates", mc::nbt::TagLongArray(
+				packBlockStates(indices, 5, spanning)));
+		mc::nbt::TagList sections(mc::nbt::TagCompound::TAG_TYPE);
+		sections.payload.push_back(mc::nbt::TagPtr(section.clone()));
+
+		mc::nbt::TagCompound level;
+		level.addTag("xPos", mc::nbt::TagInt(0));
+		level.addTag("zPos", mc::nbt::TagInt(0));
+		level.addTag("Status", mc::nbt::TagString("full"));
+		level.addTag("Biomes", mc::nbt::TagIntArray(std::vector<int32_t>(1024, 4)));
+		level.addTag("Sections", sections);
+		mc::nbt::NBTFile nbt;
+		nbt.addTag("DataVersion", mc::nbt::TagInt(spanning ? 1976 : 2586));
+		nbt.addTag("Level", level);
+		std::stringstream stream;
+		nbt.writeNBT(stream, mc::nbt::Compression::NO_COMPRESSION);
+		std::string data = stream.str();
+
+		mc::Chunk chunk;
+		BOOST_REQUIRE(chunk.readNBT(data.data(), data.size(),
+				mc::nbt::Compression::NO_COMPRESSION));
+		BOOST_CHECK(chunk.hasSection(3));
+		BOOST_CHECK(!chunk.hasSection(2));
+		BOOST_CHECK_EQUAL(chunk.getBiomeAt(mc::LocalBlockPos(5, 7, 0)), 4);
+		for (size_t i = 0; i < indices.size(); i++) {
+			mc::LocalBlockPos pos(i % 16, (i / 16) % 16, 48 + i / 256);
+			BOOST_CHECK_EQUAL(chunk.getBlockID(pos), expected[indices[i]][0]);
+			BOOST_CHECK_EQUAL(chunk.getBlockData(pos), expected[indices[i]][1]);
+			// the sections without light arrays are lit by the sky
+			BOOST_CHECK_EQUAL(chunk.getSkyLight(pos), 15);
+			BOOST_CHECK_EQUAL(chunk.getBlockLight(pos), 0);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(region_testChunkContentHash) {
+	mc::RegionFile region("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(region.read());
+
+	mc::WorldCrop world_crop;
+	world_crop.loadBlockMask("!1");
+
+	mc::ChunkHashIndex index;
+	std::set<uint64_t> hashes;
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		mc::ChunkData data = region.getChunkData(*it);
+		const char* raw = reinterpret_cast<const char*>(data.data());
+		mc::Chunk chunk, same, rotated, masked;
+		BOOST_REQUIRE(chunk.readNBT(raw, data.size()));
+		BOOST_REQUIRE(same.readNBT(raw, data.size()));
+		rotated.setRotation(1);
+		BOOST_REQUIRE(rotated.readNBT(raw, data.size()));
+		masked.setWorldCrop(world_crop);
+		BOOST_REQUIRE(masked.readNBT(raw, data.size()));
+
+		// the same content has the same hash, the rendered content is different with
+		// another rotation or block mask
+		uint64_t hash = chunk.getContentHash();
+		BOOST_CHECK_EQUAL(hash, same.getContentHash());
+		BOOST_CHECK(hash != rotated.getContentHash());
+		BOOST_CHECK(hash != masked.getContentHash());
+		hashes.insert(hash);
+		index.update(*it, hash);
+	}
+	// and different chunks have different hashes
+	BOOST_CHECK_EQUAL(hashes.size(), chunks.size());
+
+	// the index can be persisted
+	BOOST_REQUIRE(index.write("data/chunkhashes.dat"));
+	mc::ChunkHashIndex index2;
+	BOOST_REQUIRE(index2.read("data/chunkhashes.dat"));
+	std::remove("data/chunkhashes.dat");
+	BOOST_CHECK_EQUAL(index2.size(), chunks.size());
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		uint64_t hash, hash2;
+		BOOST_REQUIRE(index.find(*it, hash));
+		BOOST_REQUIRE(index2.find(*it, hash2));
+		BOOST_CHECK_EQUAL(hash, hash2);
+	}
+	uint64_t hash;
+	index2.remove(*chunks.begin());
+	BOOST_CHECK(!index2.find(*chunks.begin(), hash));
+	BOOST_CHECK(!index2.read("data/does-not-exist.dat"));
+	BOOST_CHECK_EQUAL(index2.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(region_testRegionIndex) {
+	mc::RegionFile expected("data/region/r.-1.0.mca");
+	BOOST_REQUIRE(expected.readOnlyHeaders());
+
+	// the first time the headers are read from the file and put into the index,
+	// the second time they are taken from the index
+	mc::RegionIndex index;
+	for (int i = 0; i < 2; i++) {
+		mc::RegionFile region("data/region/r.-1.0.mca");
+		BOOST_REQUIRE(region.readOnlyHeaders(index));
+		BOOST_CHECK_EQUAL(index.size(), 1);
+		BOOST_CHECK(region.getContainingChunks() == expected.getContainingChunks());
+		auto chunks = expected.getContainingChunks();
+		for (auto it = chunks.begin(); it != chunks.end(); ++it)
+			BOOST_CHECK_EQUAL(region.getChunkTimestamp(*it), expected.getChunkTimestamp(*it));
+	}
+
+	// the index can be persisted
+	BOOST_REQUIRE(index.write("data/regionindex.dat"));
+	mc::RegionIndex index2;
+	BOOST_REQUIRE(index2.read("data/regionindex.dat"));
+	std::remove("data/regionindex.dat");
+	BOOST_CHECK_EQUAL(index2.size(), 1);
+
+	// outdated entries are not used
+	mc::RegionIndex::Entry entry;
+	BOOST_CHECK(!index2.find("data/region/r.-1.0.mca", 0, 0, entry));
+	// and cropping is applied to the headers from the index
+	mapcrafter::mc::WorldCrop crop;
+	crop.setMinX(-512);
+	crop.setMaxX(-512 + 15);
+	mc::RegionFile cropped("data/region/r.-1.0.mca");
+	cropped.setWorldCrop(crop);
+	BOOST_REQUIRE(cropped.readOnlyHeaders(index2));
+	auto chunks = cropped.getContainingChunks();
+	BOOST_CHECK(chunks.size() <= 32);
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		BOOST_CHECK_EQUAL(it->x, -32);
+}
+
+BOOST_AUTO_TEST_CASE(region_testRegionIndexTiles) {
+	mc::RegionIndex index;
+	std::time_t mtime;
+	uint64_t size;
+	std::string filename = "data/region/r.-1.0.mca";
+	BOOST_REQUIRE(mc::RegionIndex::stat(filename, mtime, size));
+
+	// the tiles are only stored with an entry of the same region file
+	std::vector<int32_t> tiles = {1, 2, 3, -4, 5, 6}, found;
+	index.updateTiles(filename, mtime, size, "tileset", tiles);
+	BOOST_CHECK(!index.findTiles(filename, mtime, size, "tileset", found));
+	mc::RegionFile region(filename);
+	BOOST_REQUIRE(region.readOnlyHeaders(index));
+	index.updateTiles(filename, mtime, size, "tileset", tiles);
+	BOOST_REQUIRE(index.findTiles(filename, mtime, size, "tileset", found));
+	BOOST_CHECK(found == tiles);
+	BOOST_CHECK(!index.findTiles(filename, mtime, size, "other", found));
+
+	// they are persisted
+	BOOST_REQUIRE(index.write("data/regionindex.dat"));
+	mc::RegionIndex index2;
+	BOOST_REQUIRE(index2.read("data/regionindex.dat"));
+	std::remove("data/regionindex.dat");
+	found.clear();
+	BOOST_REQUIRE(index2.findTiles(filename, mtime, size, "tileset", found));
+	BOOST_CHECK(found == tiles);
+
+	// and dropped if the region file is modified
+	BOOST_CHECK(!index2.findTiles(filename, mtime + 1, size, "tileset", found));
+	mc::RegionIndex::Entry entry;
+	entry.mtime = mtime + 1;
+	entry.size = size;
+	index2.update(filename, entry);
+	BOOST_CHECK(!index2.findTiles(filename, mtime + 1, size, "tileset", found));
+}
+
+BOOST_AUTO_TEST_CASE(region_testRegionIndexBroken) {
+	mc::RegionIndex index;
+	std::time_t mtime;
+	uint64_t size;
+	std::string filename = "data/region/r.-1.0.mca";
+	BOOST_REQUIRE(mc::RegionIndex::stat(filename, mtime, size));
+	mc::RegionFile region(filename);
+	BOOST_REQUIRE(region.readOnlyHeaders(index));
+	mc::RegionIndex::Entry entry;
+	BOOST_REQUIRE(index.find(filename, mtime, size, entry));
+	int chunk1 = -1, chunk2 = -1;
+	for (int i = 0; i < 1024 && chunk2 == -1; i++)
+		if (entry.chunk_exists[i])
+			(chunk1 == -1 ? chunk1 : chunk2) = i;
+	BOOST_REQUIRE(chunk2 != -1);
+
+	// the broken chunks are only remembered for the same region file
+	std::bitset<1024> broken;
+	BOOST_CHECK(!index.findBrokenChunks(filename, mtime, size, broken));
+	index.setChunkBroken(filename, mtime + 1, size, chunk1);
+	BOOST_CHECK(!index.findBrokenChunks(filename, mtime, size, broken));
+	index.setChunkBroken(filename, mtime, size, chunk1);
+	index.setChunkBroken(filename, mtime, size, chunk2);
+	BOOST_REQUIRE(index.findBrokenChunks(filename, mtime, size, broken));
+	BOOST_CHECK_EQUAL(broken.count(), 2);
+
+	// they are persisted
+	BOOST_REQUIRE(index.write("data/regionindex.dat"));
+	mc::RegionIndex index2;
+	BOOST_REQUIRE(index2.read("data/regionindex.dat"));
+	std::remove("data/regionindex.dat");
+	broken.reset();
+	BOOST_REQUIRE(index2.findBrokenChunks(filename, mtime, size, broken));
+	BOOST_CHECK(broken[chunk1] && broken[chunk2]);
+
+	// a modified region file keeps the broken chunks whose timestamp didn't change
+	entry.mtime = mtime + 1;
+	entry.chunk_timestamps[chunk2]++;
+	index2.update(filename, entry);
+	broken.reset();
+	BOOST_REQUIRE(index2.findBrokenChunks(filename, mtime + 1, size, broken));
+	BOOST_CHECK(broken[chunk1] && !broken[chunk2]);
+
+	// a broken region file has no headers
+	BOOST_CHECK(!index2.isRegionBroken(filename, mtime + 1, size));
+	index2.setRegionBroken(filename, mtime + 1, size);
+	BOOST_CHECK(index2.isRegionBroken(filename, mtime + 1, size));
+	BOOST_CHECK(!index2.isRegionBroken(filename, mtime + 2, size));
+	BOOST_CHECK(!index2.find(filename, mtime + 1, size, entry));
+}
+
+BOOST_AUTO_TEST_CASE(region_testRegionDirectory) {
+	fs::path dir = "data/regiondirectory";
+	fs::remove_all(dir);
+	BOOST_REQUIRE(fs::create_directories(dir / "region"));
+	fs::copy_file("data/region/r.-1.0.mca", dir / "region" / "r.-1.0.mca");
+	std::ofstream((dir / "region" / "other.txt").string().c_str());
+	fs::last_write_time(dir / "region", std::time(nullptr) - 10);
+
+	// the index of an unmodified directory is shared
+	std::shared_ptr<const mc::RegionDirectory> index1 = mc::RegionDirectory::get(
+			dir / "region");
+	BOOST_REQUIRE(index1);
+	BOOST_CHECK_EQUAL(index1->getRegionFiles().size(), 1);
+	BOOST_CHECK(mc::RegionDirectory::get(dir / "region") == index1);
+	BOOST_CHECK(!mc::RegionDirectory::get(dir / "nothing"));
+
+	// the worlds use the positions of their rotation, also their copies
+	mc::World world(dir.string());
+	world.setRotation(1);
+	BOOST_REQUIRE(world.load());
+	mc::World copy = world;
+	mc::RegionPos pos(-1, 0);
+	pos.rotate(1);
+	BOOST_CHECK(copy.hasRegion(pos));
+	BOOST_CHECK_EQUAL(copy.getAvailableRegionCount(), 1);
+	BOOST_CHECK_EQUAL(copy.getRegionPath(pos), dir / "region" / "r.-1.0.mca");
+
+	// the directory is read again if it's modified
+	fs::copy_file("data/region/r.-1.0.mca", dir / "region" / "r.2.3.mca");
+	fs::last_write_time(dir / "region", std::time(nullptr) - 5);
+	std::shared_ptr<const mc::RegionDirectory> index2 = mc::RegionDirectory::get(
+			dir / "region");
+	BOOST_REQUIRE(index2);
+	BOOST_CHECK(index2 != index1);
+	BOOST_CHECK_EQUAL(index2->getRegionFiles().size(), 2);
+	BOOST_CHECK_EQUAL(index1->getRegionFiles().size(), 1);
+	BOOST_CHECK_EQUAL(copy.getAvailableRegionCount(), 1);
+
+	fs::remove_all(dir);
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../mapcraftercore/compat/thread.h"
+#include "../mapcraftercore/mc/regionstorage.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace mc = mapcrafter::mc;
+namespace fs = boost::filesystem;
+using boost::asio::ip::tcp;
+
+namespace {
+
+/**
+ * A HTTP server for the tests which serves one file (with range requests) and a
+ * directory listing.
+ */
+class TestServer {
+public:
+	TestServer(const std::string& file, const std::string& listing)
+		: file(file), listing(listing), acceptor(io_service, tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"), 0)),
+		  running(true), requests(0) {
+		thread = thread_ns::thread([this]() { serve(); });
+	}
+
+	~TestServer() {
+		running = false;
+		// wake up the server thread
+		tcp::socket socket(io_service);
+		socket.connect(acceptor.local_endpoint());
+		thread.join();
+	}
+
+	std::string getURL() const {
+		return "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port());
+	}
+
+	int getRequests() const {
+		return requests;
+	}
+
+private:
+	void serve() {
+		while (true) {
+			tcp::socket socket(io_service);
+			acceptor.accept(socket);
+			if (!running)
+				return;
+			requests++;
+
+			boost::asio::streambuf buffer;
+			boost::asio::read_until(socket, buffer, "\r\n\r\n");
+			std::string request((std::istreambuf_iterator<char>(&buffer)),
+					std::istreambuf_iterator<char>());
+			std::string response;
+			size_t first, last;
+			size_t range = request.find("Range: bytes=");
+			if (request.compare(0, 10, "GET /dir/ ") == 0) {
+				response = "HTTP/1.0 200 OK\r\nContent-Length: "
+						+ std::to_string(listing.size()) + "\r\n\r\n" + listing;
+			} else if (request.compare(0, 15, "GET /r.0.0.mca ") == 0
+					&& range != std::string::npos && std::sscanf(request.c_str() + range,
+					"Range: bytes=%zu-%zu", &first, &last) == 2) {
+				last = std::min(last, file.size() - 1);
+				std::string data = file.substr(first, last - first + 1);
+				response = "HTTP/1.0 206 Partial Content\r\nContent-Range: bytes "
+						+ std::to_string(first) + "-" + std::to_string(last) + "/"
+						+ std::to_string(file.size()) + "\r\nETag: \"1\"\r\n\r\n" + data;
+			} else {
+				response = "HTTP/1.0 404 Not Found\r\n\r\n";
+			}
+			boost::system::error_code error;
+			boost::asio::write(socket, boost::asio::buffer(response), error);
+		}
+	}
+
+	std::string file, listing;
+	boost::asio::io_service io_service;
+	tcp::acceptor acceptor;
+	std::atomic<bool> running;
+	std::atomic<int> requests;
+	thread_ns::thread thread;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(regionstorage_testRemote) {
+	std::string file;
+	for (int i = 0; i < 5 * 4096; i++)
+		file += (char) (i * 7 % 251);
+	std::string listing = "<a href=\"r.0.-1.mca\">r.0.-1.mca</a>\n"
+			"<a href=\"r.12.3.mca\">r.12.3.mca</a>\n<a href=\"r.1.mca\">r.1.mca</a>\n";
+	TestServer server(file, listing);
+	fs::path cache_dir = fs::temp_directory_path() / fs::unique_path();
+
+	BOOST_CHECK(mc::isRemotePath(server.getURL()));
+	BOOST_CHECK(!mc::isRemotePath("/tmp/world"));
+
+	std::vector<std::string> filenames;
+	BOOST_REQUIRE(mc::listRemoteRegions(server.getURL() + "/dir", filenames));
+	BOOST_REQUIRE_EQUAL(filenames.size(), 2);
+	BOOST_CHECK_EQUAL(filenames[0], "r.0.-1.mca");
+	BOOST_CHECK_EQUAL(filenames[1], "r.12.3.mca");
+
+	BOOST_CHECK(!mc::openRegionReader(server.getURL() + "/missing.mca")->isOpen());
+
+	// the header is requested when opening the file, the sectors when reading them
+	std::shared_ptr<mc::RegionReader> reader = mc::openRegionReader(
+			server.getURL() + "/r.0.0.mca", cache_dir);
+	BOOST_REQUIRE(reader->isOpen());
+	BOOST_CHECK_EQUAL(reader->getFilesize(), file.size());
+	int requests = server.getRequests();
+	std::vector<uint8_t> data(4096);
+	BOOST_REQUIRE(reader->read(100, &data[0], 4000));
+	BOOST_CHECK(std::string(data.begin(), data.begin() + 4000) == file.substr(100, 4000));
+	BOOST_CHECK_EQUAL(server.getRequests(), requests);
+	BOOST_REQUIRE(reader->read(12288, &data[0], 4096));
+	BOOST_CHECK(std::string(data.begin(), data.end()) == file.substr(12288, 4096));
+	BOOST_CHECK_EQUAL(server.getRequests(), requests + 1);
+	BOOST_CHECK(!reader->read(16384, &data[0], 4097));
+
+	// the same sectors are read from the cache directory
+	reader = mc::openRegionReader(server.getURL() + "/r.0.0.mca", cache_dir);
+	requests = server.getRequests();
+	std::fill(data.begin(), data.end(), 0);
+	BOOST_REQUIRE(reader->read(12288, &data[0], 4096));
+	BOOST_CHECK(std::string(data.begin(), data.end()) == file.substr(12288, 4096));
+	BOOST_CHECK_EQUAL(server.getRequests(), requests);
+	BOOST_CHECK(fs::exists(cache_dir / "r.0.0.mca" / "12288-4096"));
+
+	fs::remove_all(cache_dir);
+}
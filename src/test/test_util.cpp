@@ -17,10 +17,23 @@
  * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "../mapcraftercore/thread/impl/affinity.h"
+#include "../mapcraftercore/thread/impl/concurrentqueue.h"
+#include "../mapcraftercore/thread/impl/threadpool.h"
 #include "../mapcraftercore/util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 
+namespace thread = mapcrafter::thread;
 namespace util = mapcrafter::util;
 
 BOOST_AUTO_TEST_CASE(util_testMath) {
@@ -47,3 +60,408 @@ BOOST_AUTO_TEST_CASE(util_testMath) {
 	BOOST_CHECK_EQUAL(util::binary<11011101>::value, 221);
 }
 
+
+BOOST_AUTO_TEST_CASE(util_testChildProgressHandler) {
+	util::DummyProgressHandler parent;
+	thread_ns::mutex mutex;
+	util::ChildProgressHandler child1(&parent, mutex), child2(&parent, mutex);
+
+	// the parent shows the sum of the progress of its children
+	child1.setMax(10);
+	child2.setMax(30);
+	child1.setValue(4);
+	child2.setValue(5);
+	BOOST_CHECK_EQUAL(parent.getMax(), 40);
+	BOOST_CHECK_EQUAL(parent.getValue(), 9);
+
+	// also if a child starts again
+	child1.setMax(20);
+	child1.setValue(0);
+	BOOST_CHECK_EQUAL(parent.getMax(), 50);
+	BOOST_CHECK_EQUAL(parent.getValue(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(util_testAtomicProgressHandler) {
+	// every thread counts its own progress, the sum is read from another thread
+	std::vector<std::unique_ptr<util::AtomicProgressHandler> > progress;
+	std::vector<thread_ns::thread> threads;
+	for (int i = 0; i < 4; i++)
+		progress.push_back(std::unique_ptr<util::AtomicProgressHandler>(
+				new util::AtomicProgressHandler));
+	for (int i = 0; i < 4; i++)
+		threads.push_back(thread_ns::thread([&progress, i]() {
+			for (int j = 0; j < 10000; j++)
+				progress[i]->setValue(progress[i]->getValue() + 1);
+		}));
+
+	int last = 0;
+	for (int i = 0; i < 100; i++) {
+		int sum = 0;
+		for (int j = 0; j < 4; j++)
+			sum += progress[j]->getValue();
+		BOOST_CHECK(sum >= last && sum <= 40000);
+		last = sum;
+	}
+	for (int i = 0; i < 4; i++)
+		threads[i].join();
+	for (int i = 0; i < 4; i++)
+		BOOST_CHECK_EQUAL(progress[i]->getValue(), 10000);
+}
+
+BOOST_AUTO_TEST_CASE(util_testThreadPool) {
+	std::atomic<int> count(0);
+	{
+		// the pool is used for multiple rounds of tasks and runs all of them
+		thread::ThreadPool pool(3);
+		BOOST_CHECK_EQUAL(pool.getThreadCount(), 3);
+		for (int i = 0; i < 100; i++)
+			pool.run([&count]() { count++; });
+		while (count < 100)
+			std::this_thread::yield();
+		for (int i = 0; i < 100; i++)
+			pool.run([&count]() { count++; });
+	}
+	// the remaining tasks are run before the threads stop
+	BOOST_CHECK_EQUAL(count, 200);
+}
+
+BOOST_AUTO_TEST_CASE(util_testStatusReporter) {
+	auto contains = [](const std::vector<std::string>& report, const std::string& line) {
+		return std::find(report.begin(), report.end(), line) != report.end();
+	};
+	BOOST_CHECK(contains(util::StatusReporter::getReport(), "Nothing is being rendered."));
+	{
+		// the sources write their lines while they exist
+		util::StatusSource source([](std::ostream& out) {
+			out << "first line" << std::endl << "second line" << std::endl;
+		});
+		std::vector<std::string> report = util::StatusReporter::getReport();
+		BOOST_CHECK(contains(report, "first line"));
+		BOOST_CHECK(contains(report, "second line"));
+		BOOST_CHECK(!contains(report, "Nothing is being rendered."));
+	}
+	BOOST_CHECK(!contains(util::StatusReporter::getReport(), "first line"));
+}
+
+BOOST_AUTO_TEST_CASE(util_testConcurrentQueue) {
+	// the queue is bounded, the capacity is a power of two
+	thread::ConcurrentQueue<int> queue(5);
+	BOOST_CHECK_EQUAL(queue.getCapacity(), 8);
+	BOOST_CHECK(queue.empty());
+	for (int i = 0; i < 8; i++)
+		BOOST_CHECK(queue.tryPush(i));
+	BOOST_CHECK(!queue.tryPush(8));
+	int item;
+	for (int i = 0; i < 8; i++) {
+		BOOST_CHECK(queue.tryPop(item));
+		BOOST_CHECK_EQUAL(item, i);
+	}
+	BOOST_CHECK(!queue.tryPop(item));
+	BOOST_CHECK(!queue.pop(item, 10));
+
+	// every item of the producers is taken by exactly one of the consumers, the
+	// producers wait when the queue is full
+	std::atomic<long> sum(0);
+	std::atomic<int> count(0);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 3; i++)
+		threads.push_back(std::thread([&queue, i]() {
+			for (int j = 1; j <= 10000; j++)
+				queue.push(i * 10000 + j);
+		}));
+	for (int i = 0; i < 3; i++)
+		threads.push_back(std::thread([&queue, &sum, &count]() {
+			int item;
+			while (queue.pop(item)) {
+				sum += item;
+				count++;
+			}
+		}));
+	for (int i = 0; i < 3; i++)
+		threads[i].join();
+	while (!queue.empty())
+		std::this_thread::yield();
+	queue.close();
+	for (int i = 3; i < 6; i++)
+		threads[i].join();
+	BOOST_CHECK_EQUAL(count, 30000);
+	BOOST_CHECK_EQUAL(sum, 30000L * 30001 / 2);
+
+	// nothing can be pushed after closing, but the remaining items are popped
+	thread::ConcurrentQueue<int> closed(2);
+	BOOST_CHECK(closed.push(1));
+	closed.close();
+	BOOST_CHECK(!closed.push(2));
+	BOOST_CHECK(closed.pop(item));
+	BOOST_CHECK_EQUAL(item, 1);
+	BOOST_CHECK(!closed.pop(item));
+}
+
+BOOST_AUTO_TEST_CASE(util_testCPUTopology) {
+	std::vector<int> cpus = thread::parseCPUList("0-3,8, 10-11\n");
+	BOOST_CHECK_EQUAL(cpus.size(), 7);
+	BOOST_CHECK_EQUAL(cpus[3], 3);
+	BOOST_CHECK_EQUAL(cpus[4], 8);
+	BOOST_CHECK_EQUAL(cpus[6], 11);
+	BOOST_CHECK(thread::parseCPUList("3-1").empty());
+	BOOST_CHECK(thread::parseCPUList("a,1").empty());
+
+	// the nodes get contiguous ranges of workers by their count of CPUs, and the
+	// workers of a node get its CPUs one after another
+	thread::CPUTopology topology({{0, 1, 2, 3}, {}, {4, 5}});
+	BOOST_CHECK_EQUAL(topology.getNodes().size(), 2);
+	std::vector<thread::WorkerPlacement> placement = topology.placeWorkers(9);
+	BOOST_REQUIRE_EQUAL(placement.size(), 9);
+	int nodes[] = {0, 0, 0, 0, 0, 0, 1, 1, 1};
+	int cpu_of[] = {0, 1, 2, 3, 0, 1, 4, 5, 4};
+	for (int i = 0; i < 9; i++) {
+		BOOST_CHECK_EQUAL(placement[i].node, nodes[i]);
+		BOOST_CHECK_EQUAL(placement[i].cpu, cpu_of[i]);
+	}
+
+	// the detected topology has at least one CPU
+	thread::CPUTopology detected;
+	BOOST_CHECK(!detected.getNodes().empty());
+	BOOST_CHECK_EQUAL(detected.placeWorkers(3).size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(util_testProfiler) {
+	if (!util::Profiler::setEnabled(true))
+		return;
+
+	// a thread of its own to have a thread name nobody else uses
+	std::thread profiled([]() {
+		util::Profiler::setThreadName("test");
+		util::ProfileScope encode(util::ProfileStage::ENCODE);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		{
+			util::ProfileScope write(util::ProfileStage::WRITE);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		util::ProfileScope write(util::ProfileStage::WRITE);
+	});
+	profiled.join();
+	util::Profiler::setEnabled(false);
+
+	std::map<std::string, util::ProfileTimes> threads = util::Profiler::getThreadTimes();
+	BOOST_REQUIRE(threads.count("test"));
+	const util::ProfileTimes& times = threads["test"];
+	int encode = (int) util::ProfileStage::ENCODE, write = (int) util::ProfileStage::WRITE;
+	BOOST_CHECK_EQUAL(times.calls[encode], 1);
+	BOOST_CHECK_EQUAL(times.calls[write], 2);
+	// the time of the nested write scope is not part of the encode time
+	BOOST_CHECK_GE(times.seconds[write], 0.05);
+	BOOST_CHECK_GE(times.seconds[encode], 0.02);
+	BOOST_CHECK_LT(times.seconds[encode], times.seconds[write]);
+	BOOST_CHECK_CLOSE(times.getTotal(), times.seconds[encode] + times.seconds[write], 1e-6);
+
+	util::ProfileTimes difference = times;
+	difference -= times;
+	BOOST_CHECK_EQUAL(difference.getTotal(), 0);
+	BOOST_CHECK_EQUAL(difference.calls[write], 0);
+}
+
+BOOST_AUTO_TEST_CASE(util_testTrace) {
+	if (!util::Profiler::setTracing(true))
+		return;
+	std::thread traced([]() {
+		util::Profiler::setThreadName("trace test");
+		util::TraceScope trace("test event");
+		BOOST_CHECK(trace.isActive());
+		trace.setDetail("some \"detail\"");
+	});
+	traced.join();
+	util::Profiler::setTracing(false);
+	BOOST_CHECK(!util::TraceScope("inactive").isActive());
+
+	std::string filename = "test_trace.json";
+	BOOST_REQUIRE(util::Profiler::writeTrace(filename));
+	std::ifstream in(filename);
+	std::string trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	std::remove(filename.c_str());
+	BOOST_CHECK(trace.find("\"args\":{\"name\":\"trace test\"}") != std::string::npos);
+	BOOST_CHECK(trace.find("\"name\":\"test event\",\"ph\":\"X\"") != std::string::npos);
+	BOOST_CHECK(trace.find("\"detail\":\"some \\\"detail\\\"\"") != std::string::npos);
+	BOOST_CHECK(trace.find("\"inactive\"") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(util_testMetrics) {
+	if (!util::Profiler::setMetrics(true))
+		return;
+	std::thread counted([]() {
+		util::Profiler::setThreadName("metrics test");
+		util::Profiler::addMetric(util::Metric::RENDER_TILES);
+		util::Profiler::addMetric(util::Metric::RENDER_TILES);
+		util::Profiler::addMetric(util::Metric::TILE_BYTES_WRITTEN, 1024);
+	});
+	counted.join();
+	int64_t queued = util::Profiler::getGauge(util::Gauge::QUEUED_TILES);
+	util::Profiler::addGauge(util::Gauge::QUEUED_TILES, 3);
+	util::Profiler::addGauge(util::Gauge::QUEUED_TILES, -1);
+	BOOST_CHECK_EQUAL(util::Profiler::getGauge(util::Gauge::QUEUED_TILES), queued + 2);
+	util::Profiler::addGauge(util::Gauge::QUEUED_TILES, -2);
+	util::Profiler::setMetrics(false);
+
+	std::map<std::string, util::ThreadMetrics> threads = util::Profiler::getThreadMetrics();
+	BOOST_REQUIRE(threads.count("metrics test"));
+	const util::ThreadMetrics& metrics = threads["metrics test"];
+	BOOST_CHECK_EQUAL(metrics.values[(int) util::Metric::RENDER_TILES], 2);
+	BOOST_CHECK_EQUAL(metrics.values[(int) util::Metric::TILE_BYTES_WRITTEN], 1024);
+	BOOST_CHECK_EQUAL(metrics.values[(int) util::Metric::COMPOSITE_TILES], 0);
+}
+
+namespace {
+
+class CollectingLogSink : public util::LogSink {
+public:
+	virtual void sink(const util::LogMessage& message) {
+		messages.push_back(message.message);
+	}
+
+	std::vector<std::string> messages;
+};
+
+int countEvaluation(int& evaluations) {
+	return ++evaluations;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(util_testLogging) {
+	util::Logging& logging = util::Logging::getInstance();
+	CollectingLogSink* sink = new CollectingLogSink;
+	logging.setSink("test", sink);
+	logging.setSinkVerbosity("__output__", util::LogLevel::WARNING);
+	logging.setSinkVerbosity("test", util::LogLevel::INFO);
+	logging.setSinkAsynchronous("test", true);
+
+	// messages no sink handles aren't even formatted
+	int evaluations = 0;
+	LOG(DEBUG) << countEvaluation(evaluations);
+	BOOST_CHECK_EQUAL(evaluations, 0);
+	BOOST_CHECK(!util::Logging::isEnabled(util::LogLevel::DEBUG));
+	BOOST_CHECK(util::Logging::isEnabled(util::LogLevel::INFO));
+
+	std::thread logging_thread([&evaluations]() {
+		for (int i = 0; i < 3; i++)
+			LOG(INFO) << "message " << countEvaluation(evaluations);
+	});
+	logging_thread.join();
+	logging.flush();
+	BOOST_CHECK_EQUAL(evaluations, 3);
+	BOOST_REQUIRE_EQUAL(sink->messages.size(), 3);
+	BOOST_CHECK_EQUAL(sink->messages[2], "message 3");
+
+	if (true)
+		LOG(DEBUG) << "skipped";
+	else
+		BOOST_ERROR("The else branch belongs to the if statement");
+	for (int i = 0; i < 2; i++)
+		LOG_ONCE(INFO) << "logged once";
+	logging.flush();
+	BOOST_REQUIRE_EQUAL(sink->messages.size(), 4);
+	BOOST_CHECK_EQUAL(sink->messages[3], "logged once");
+
+	logging.reset();
+	BOOST_CHECK(!util::Logging::isEnabled(util::LogLevel::DEBUG));
+}
+
+BOOST_AUTO_TEST_CASE(util_testMemoryTracker) {
+	std::thread allocating([]() {
+		util::MemoryTracker::setThreadName("memory test");
+		util::MemoryScope scope(util::MemorySubsystem::TILE_BUFFERS);
+		std::vector<char> buffer(1024 * 1024);
+		{
+			util::MemoryScope inner(util::MemorySubsystem::TILE_SETS);
+			std::unique_ptr<char[]> small(new char[100]);
+		}
+	});
+	allocating.join();
+
+	std::map<std::string, std::vector<util::MemoryUsage> > usage
+		= util::MemoryTracker::getThreadUsage();
+	if (!util::MemoryTracker::isEnabled()) {
+		BOOST_CHECK(usage.empty());
+		return;
+	}
+	BOOST_REQUIRE(usage.count("memory test"));
+	const std::vector<util::MemoryUsage>& thread = usage["memory test"];
+	const util::MemoryUsage& tiles = thread[(int) util::MemorySubsystem::TILE_BUFFERS];
+	BOOST_CHECK_EQUAL(tiles.allocations, 1);
+	BOOST_CHECK_EQUAL(tiles.peak_bytes, 1024 * 1024);
+	BOOST_CHECK_EQUAL(tiles.live_bytes, 0);
+	BOOST_CHECK_EQUAL(thread[(int) util::MemorySubsystem::TILE_SETS].allocated_bytes, 100);
+	BOOST_CHECK_GE(thread[(int) util::MemorySubsystem::COUNT].peak_bytes, 1024 * 1024 + 100);
+}
+
+BOOST_AUTO_TEST_CASE(util_testHugePageArena) {
+	typedef std::vector<uint8_t, util::ArenaAllocator<uint8_t> > Buffer;
+	// a buffer allocated before the arena is enabled is still freed correctly
+	std::unique_ptr<Buffer> before(new Buffer(1000));
+	if (!util::HugePageArena::setEnabled(true)) {
+		BOOST_CHECK(!util::HugePageArena::isEnabled());
+		return;
+	}
+
+	// the buffers are aligned, don't overlap, and the freed ones are reused
+	std::vector<Buffer> buffers;
+	for (size_t size : {1, 64, 65, 1000, 100000, 1024 * 1024, 3 * 1024 * 1024})
+		buffers.push_back(Buffer(size, 0xff));
+	for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+		BOOST_CHECK_EQUAL((uintptr_t) it->data() % util::HugePageArena::ALIGNMENT, 0);
+		BOOST_CHECK(std::all_of(it->begin(), it->end(), [](uint8_t b) { return b == 0xff; }));
+	}
+	const uint8_t* freed = buffers[4].data();
+	buffers[4] = Buffer();
+	Buffer reused(99999);
+	BOOST_CHECK_EQUAL(reused.data(), freed);
+	before.reset();
+
+	// threads allocate and free buffers of the same and different classes concurrently
+	std::atomic<bool> overlapping(false);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; i++)
+		threads.push_back(std::thread([i, &overlapping]() {
+			std::vector<Buffer> buffers;
+			for (int j = 0; j < 2000; j++) {
+				uint8_t value = i * 50 + j % 50;
+				buffers.push_back(Buffer(64 + (j * 97) % 5000, value));
+				if (j % 3 == 0)
+					buffers.erase(buffers.begin() + (j * 7) % buffers.size());
+			}
+			for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+				uint8_t value = it->front();
+				if (value / 50 != i || std::count(it->begin(), it->end(), value)
+						!= (std::ptrdiff_t) it->size())
+					overlapping = true;
+			}
+		}));
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+		it->join();
+	BOOST_CHECK(!overlapping);
+
+	util::HugePageArena::setEnabled(false);
+	Buffer after(1000);
+	buffers.clear();
+}
+
+BOOST_AUTO_TEST_CASE(util_testDigest) {
+	BOOST_CHECK_EQUAL(util::toHex(util::sha256("")),
+			"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	BOOST_CHECK_EQUAL(util::toHex(util::sha256("abc")),
+			"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	// the padding needs a second block
+	BOOST_CHECK_EQUAL(util::toHex(util::sha256(
+			"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")),
+			"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	BOOST_CHECK_EQUAL(util::toHex(util::sha256(std::string(1000000, 'a'))),
+			"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+	// RFC 4231, test cases 2 and 6 (a key longer than a block)
+	BOOST_CHECK_EQUAL(util::toHex(util::hmacSHA256("Jefe", "what do ya want for nothing?")),
+			"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+	BOOST_CHECK_EQUAL(util::toHex(util::hmacSHA256(std::string(131, '\xaa'),
+			"Test Using Larger Than Block-Size Key - Hash Key First")),
+			"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
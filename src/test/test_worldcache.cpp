@@ -0,0 +1,423 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../mapcraftercore/mc/chunkcache.h"
+#include "../mapcraftercore/mc/region.h"
+#include "../mapcraftercore/mc/world.h"
+#include "../mapcraftercore/mc/worldcache.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace mc = mapcrafter::mc;
+namespace ipc = boost::interprocess;
+
+BOOST_AUTO_TEST_CASE(worldcache_testChunkCache) {
+	mc::ChunkCache cache(32);
+	BOOST_CHECK(!cache.get(mc::ChunkPos(0, 0)));
+
+	for (int i = 0; i < 1000; i++) {
+		mc::ChunkPos pos(i % 50, i / 50);
+		auto chunk = std::make_shared<mc::Chunk>();
+		BOOST_CHECK(cache.put(pos, chunk) == chunk);
+		BOOST_CHECK(cache.get(pos) == chunk);
+	}
+	// the cache evicts the least recently used chunks to stay within its capacity
+	BOOST_CHECK(cache.size() <= cache.getCapacity() + 16);
+	BOOST_CHECK(cache.get(mc::ChunkPos(49, 19)));
+
+	// putting a chunk which is already cached returns the cached one
+	auto cached = cache.get(mc::ChunkPos(49, 19));
+	auto other = std::make_shared<mc::Chunk>();
+	BOOST_CHECK(cache.put(mc::ChunkPos(49, 19), other) == cached);
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testSharedChunkCache) {
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+	BOOST_REQUIRE(!chunks.empty());
+
+	auto shared_cache = std::make_shared<mc::ChunkCache>();
+	mc::WorldCache cache1(world, mc::WorldCache::DEFAULT_CHUNK_CACHE_SIZE, shared_cache);
+	mc::WorldCache cache2(world, mc::WorldCache::DEFAULT_CHUNK_CACHE_SIZE, shared_cache);
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		const mc::Chunk* chunk1 = cache1.getChunk(*it);
+		BOOST_REQUIRE(chunk1 != nullptr);
+		BOOST_CHECK(chunk1->getPos() == *it);
+		// the second world cache gets the same chunk from the shared cache
+		BOOST_CHECK(cache2.getChunk(*it) == chunk1);
+	}
+	BOOST_CHECK_EQUAL(shared_cache->size(), chunks.size());
+
+	// a world cache without a shared cache loads the chunks itself
+	mc::WorldCache cache3(world);
+	const mc::Chunk* chunk3 = cache3.getChunk(*chunks.begin());
+	BOOST_REQUIRE(chunk3 != nullptr);
+	BOOST_CHECK(chunk3 != cache1.getChunk(*chunks.begin()));
+	BOOST_CHECK_EQUAL(chunk3->getBlockID(mc::LocalBlockPos(0, 0, 0)),
+			cache1.getChunk(*chunks.begin())->getBlockID(mc::LocalBlockPos(0, 0, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testRegionCallback) {
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+	BOOST_REQUIRE(!chunks.empty());
+
+	// the callback decodes all chunks of the region into the shared cache at once
+	auto shared_cache = std::make_shared<mc::ChunkCache>();
+	mc::WorldCache cache(world, mc::WorldCache::DEFAULT_CHUNK_CACHE_SIZE, shared_cache);
+	int calls = 0;
+	cache.setRegionCallback([&](const mc::RegionPos& pos) {
+		calls++;
+		BOOST_CHECK(pos == mc::RegionPos(-1, 0));
+		mc::RegionFile loaded;
+		BOOST_REQUIRE(world.getRegion(pos, loaded) && loaded.readLazily());
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			auto chunk = std::make_shared<mc::Chunk>();
+			BOOST_REQUIRE(loaded.loadChunk(*it, *chunk) == mc::RegionFile::CHUNK_OK);
+			shared_cache->put(*it, chunk);
+		}
+	});
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		BOOST_CHECK(cache.getChunk(*it) == shared_cache->get(*it).get());
+	BOOST_CHECK_EQUAL(calls, 1);
+	// even the chunk which needed the region is not decoded again
+	const mc::CacheStats& stats = cache.getChunkCacheStats();
+	BOOST_CHECK_EQUAL(stats.misses, 0);
+	BOOST_CHECK_EQUAL(stats.shared_hits, chunks.size());
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testRotationChunkCache) {
+	// the world caches of all rotations share the chunks in the original rotation
+	auto unrotated_cache = std::make_shared<mc::ChunkCache>();
+	for (int rotation = 0; rotation < 4; rotation++) {
+		mc::World world("data");
+		world.setRotation(rotation);
+		BOOST_REQUIRE(world.load());
+		mc::RegionFile region;
+		mc::RegionPos region_pos(-1, 0);
+		region_pos.rotate(rotation);
+		BOOST_REQUIRE(world.getRegion(region_pos, region));
+		BOOST_REQUIRE(region.read());
+		const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+
+		mc::WorldCache cache(world, mc::WorldCache::DEFAULT_CHUNK_CACHE_SIZE,
+				std::shared_ptr<mc::ChunkCache>(), unrotated_cache);
+		mc::WorldCache reference(world);
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			const mc::Chunk* chunk = cache.getChunk(*it);
+			const mc::Chunk* expected = reference.getChunk(*it);
+			BOOST_REQUIRE(chunk != nullptr && expected != nullptr);
+			BOOST_CHECK(chunk->getPos() == *it);
+			BOOST_CHECK_EQUAL(chunk->getContentHash(), expected->getContentHash());
+		}
+		BOOST_CHECK_EQUAL(unrotated_cache->size(), chunks.size());
+
+		// only the first rotation reads and decodes the chunks
+		const mc::CacheStats& stats = cache.getChunkCacheStats();
+		BOOST_CHECK_EQUAL(stats.misses, rotation == 0 ? chunks.size() : 0);
+		BOOST_CHECK_EQUAL(stats.rotation_hits, rotation == 0 ? 0 : chunks.size());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testCompressedChunkCache) {
+	mc::WorldCrop world_crop;
+	world_crop.setMinY(40);
+	world_crop.setMinX(-300);
+	for (int rotation = 0; rotation < 4; rotation++) {
+		mc::World world("data");
+		world.setRotation(rotation);
+		world.setWorldCrop(world_crop);
+		BOOST_REQUIRE(world.load());
+		mc::RegionFile region;
+		mc::RegionPos region_pos(-1, 0);
+		region_pos.rotate(rotation);
+		BOOST_REQUIRE(world.getRegion(region_pos, region));
+		BOOST_REQUIRE(region.read());
+		const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+
+		// the small world cache evicts the chunks into the compressed cache,
+		// the second pass gets them from there
+		auto compressed_cache = std::make_shared<mc::CompressedChunkCache>(64 * 1024 * 1024);
+		mc::WorldCache cache(world, 1);
+		cache.setCompressedChunkCache(compressed_cache);
+		mc::WorldCache reference(world);
+		for (int pass = 0; pass < 2; pass++) {
+			for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+				const mc::Chunk* chunk = cache.getChunk(*it);
+				const mc::Chunk* expected = reference.getChunk(*it);
+				BOOST_REQUIRE(chunk != nullptr && expected != nullptr);
+				BOOST_CHECK(chunk->getPos() == *it);
+				BOOST_CHECK_EQUAL(chunk->getContentHash(), expected->getContentHash());
+				BOOST_CHECK_EQUAL(chunk->getHighestBlock(), expected->getHighestBlock());
+			}
+		}
+		const mc::CacheStats& stats = cache.getChunkCacheStats();
+		BOOST_CHECK_EQUAL(stats.misses, chunks.size());
+		BOOST_CHECK(stats.compressed_hits >= chunks.size() - mc::WorldCache::CHUNK_CACHE_WAYS);
+		BOOST_CHECK(compressed_cache->size() > 0);
+	}
+
+	// the cache stays within its budget of bytes
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::WorldCache cache(world, 1);
+	auto compressed_cache = std::make_shared<mc::CompressedChunkCache>(2 * 1024 * 1024);
+	cache.setCompressedChunkCache(compressed_cache);
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		BOOST_REQUIRE(cache.getChunk(*it) != nullptr);
+	BOOST_CHECK(compressed_cache->size() > 0);
+	BOOST_CHECK(compressed_cache->size() <= compressed_cache->getCapacity());
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testSharedMemoryChunkCache) {
+	// a segment of its own, tests running at the same time don't share it
+	std::string name = "mapcrafter_test_" + std::to_string(getpid());
+	mc::WorldCrop world_crop;
+	world_crop.setMinY(40);
+	mc::World world("data");
+	world.setRotation(1);
+	world.setWorldCrop(world_crop);
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	mc::RegionPos region_pos(-1, 0);
+	region_pos.rotate(1);
+	BOOST_REQUIRE(world.getRegion(region_pos, region));
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+
+	{
+		// the second cache (like the one of another process) gets the chunks decoded by
+		// the first one from the segment
+		auto shared1 = std::make_shared<mc::SharedMemoryChunkCache>(name, 64 * 1024 * 1024);
+		auto shared2 = std::make_shared<mc::SharedMemoryChunkCache>(name, 64 * 1024 * 1024);
+		mc::WorldCache cache1(world), cache2(world);
+		cache1.setSharedMemoryChunkCache(shared1, 42);
+		cache2.setSharedMemoryChunkCache(shared2, 42);
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			const mc::Chunk* expected = cache1.getChunk(*it);
+			const mc::Chunk* chunk = cache2.getChunk(*it);
+			BOOST_REQUIRE(chunk != nullptr && expected != nullptr);
+			BOOST_CHECK(chunk->getPos() == *it);
+			BOOST_CHECK_EQUAL(chunk->getContentHash(), expected->getContentHash());
+			BOOST_CHECK_EQUAL(chunk->getHighestBlock(), expected->getHighestBlock());
+		}
+		BOOST_CHECK_EQUAL(cache1.getChunkCacheStats().misses, chunks.size());
+		BOOST_CHECK_EQUAL(cache2.getChunkCacheStats().shared_memory_hits, chunks.size());
+		BOOST_CHECK_EQUAL(cache2.getChunkCacheStats().misses, 0);
+		BOOST_CHECK(shared2->size() > 0);
+
+		// modified chunks and other worlds aren't taken from the segment
+		const mc::ChunkPos& pos = *chunks.begin();
+		int timestamp = region.getChunkTimestamp(pos);
+		mc::Chunk chunk;
+		chunk.setRotation(1);
+		chunk.setWorldCrop(world_crop);
+		BOOST_CHECK(shared2->get(42, pos, timestamp, chunk));
+		BOOST_CHECK(!shared2->get(42, pos, timestamp + 1, chunk));
+		BOOST_CHECK(!shared2->get(43, pos, timestamp, chunk));
+	}
+
+	// the segment is removed with the last cache using it, and a small segment evicts
+	// chunks to stay within its size
+	auto shared = std::make_shared<mc::SharedMemoryChunkCache>(name, 1024 * 1024);
+	BOOST_CHECK_EQUAL(shared->size(), 0);
+	mc::WorldCache cache(world);
+	cache.setSharedMemoryChunkCache(shared, 42);
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		BOOST_REQUIRE(cache.getChunk(*it) != nullptr);
+	BOOST_CHECK(shared->size() > 0);
+	BOOST_CHECK(shared->size() <= shared->getCapacity());
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testSharedMemoryChunkCacheLockTimeout) {
+	std::string name = "mapcrafter_test_lock_" + std::to_string(getpid());
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	mc::ChunkPos pos = *region.getContainingChunks().begin();
+	mc::WorldCache cache(world);
+	const mc::Chunk* chunk = cache.getChunk(pos);
+	BOOST_REQUIRE(chunk != nullptr);
+
+	// the lock of the segment is taken like by another process
+	mc::SharedMemoryChunkCache shared(name, 1024 * 1024, 1);
+	mc::SharedMemoryChunkCache other(name, 1024 * 1024, 1);
+	ipc::managed_shared_memory memory(ipc::open_only, name.c_str());
+	ipc::interprocess_mutex* mutex = memory.find<ipc::interprocess_mutex>("mutex").first;
+	BOOST_REQUIRE(mutex != nullptr);
+
+	// the chunks are treated as not cached while the lock is held by somebody else, and
+	// also afterwards, since the segment isn't used anymore
+	mc::Chunk loaded;
+	mutex->lock();
+	shared.put(42, pos, 0, *chunk);
+	BOOST_CHECK(!shared.get(42, pos, 0, loaded));
+	mutex->unlock();
+	shared.put(42, pos, 0, *chunk);
+	BOOST_CHECK(!shared.get(42, pos, 0, loaded));
+	BOOST_CHECK_EQUAL(shared.size(), 0);
+
+	// the other one still uses it
+	other.put(42, pos, 0, *chunk);
+	BOOST_CHECK(other.get(42, pos, 0, loaded));
+	size_t chunk_size = other.size();
+	BOOST_REQUIRE(chunk_size > 0);
+
+	// the lock is taken away from threads which put and get chunks, also while they have
+	// references to entries
+	for (int i = 0; i < 200; i++) {
+		mc::SharedMemoryChunkCache racing(name, 1024 * 1024, 1);
+		std::atomic<bool> running(true);
+		std::thread thread([&]() {
+			mc::Chunk loaded;
+			for (int timestamp = 1; running; timestamp++) {
+				racing.put(42, pos, i * 1000000 + timestamp, *chunk);
+				racing.get(42, pos, i * 1000000 + timestamp, loaded);
+			}
+		});
+		usleep(i % 50 * 20);
+		mutex->lock();
+		usleep(2000);
+		mutex->unlock();
+		running = false;
+		thread.join();
+	}
+
+	// all entries of the threads are evictable, so chunks of another world replace them
+	// completely and nothing is left in the segment except the chunks which are cached
+	int count = other.getCapacity() / chunk_size * 4;
+	for (int timestamp = 0; timestamp < count; timestamp++)
+		other.put(43, pos, timestamp, *chunk);
+	size_t cached = 0;
+	for (int timestamp = 0; timestamp < count; timestamp++)
+		if (other.get(43, pos, timestamp, loaded))
+			cached++;
+	BOOST_CHECK(cached > 0);
+	BOOST_CHECK_EQUAL(other.size(), cached * chunk_size);
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testChunkCacheSize) {
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+
+	// the cache size is rounded up to whole sets
+	BOOST_CHECK_EQUAL(mc::WorldCache(world, 1).getChunkCacheSize(),
+			mc::WorldCache::CHUNK_CACHE_WAYS);
+	BOOST_CHECK_EQUAL(mc::WorldCache(world, 1000).getChunkCacheSize(), 1000);
+
+	// a cache much smaller than the count of chunks still returns the right chunks
+	mc::WorldCache small(world, 8), large(world, 4096);
+	for (int pass = 0; pass < 2; pass++) {
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			const mc::Chunk* chunk = small.getChunk(*it);
+			BOOST_REQUIRE(chunk != nullptr);
+			BOOST_CHECK(chunk->getPos() == *it);
+			if (pass == 0)
+				BOOST_CHECK(large.getChunk(*it) != nullptr);
+		}
+	}
+	// chunks which do not exist are not found
+	BOOST_CHECK(small.getChunk(mc::ChunkPos(1000, 1000)) == nullptr);
+	BOOST_CHECK(large.getChunk(mc::ChunkPos(1000, 1000)) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testCacheStats) {
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	mc::ChunkPos pos = *region.getContainingChunks().begin();
+
+	mc::WorldCache cache(world);
+	BOOST_CHECK(cache.getChunk(pos) != nullptr);
+	BOOST_CHECK(cache.getChunk(pos) != nullptr);
+	BOOST_CHECK(cache.getChunk(mc::ChunkPos(1000, 1000)) == nullptr);
+
+	const mc::CacheStats& chunk_stats = cache.getChunkCacheStats();
+	BOOST_CHECK_EQUAL(chunk_stats.misses, 1);
+	BOOST_CHECK_EQUAL(chunk_stats.hits, 1);
+	BOOST_CHECK_EQUAL(chunk_stats.region_not_found, 1);
+	BOOST_CHECK(chunk_stats.decode_time > 0);
+	const mc::CacheStats& region_stats = cache.getRegionCacheStats();
+	BOOST_CHECK_EQUAL(region_stats.misses, 1);
+	BOOST_CHECK_EQUAL(region_stats.not_found, 1);
+
+	mc::CacheStats merged;
+	merged += chunk_stats;
+	merged += chunk_stats;
+	BOOST_CHECK_EQUAL(merged.misses, 2);
+	BOOST_CHECK_EQUAL(merged.hits, 2);
+}
+
+BOOST_AUTO_TEST_CASE(worldcache_testChunkOfBlock) {
+	mc::World world("data");
+	BOOST_REQUIRE(world.load());
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.read());
+	const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+
+	// a small cache, so the neighbor chunks must be pinned to stay valid
+	mc::WorldCache cache(world, 8), reference(world);
+	for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+		const mc::Chunk* chunk = cache.getChunk(*it);
+		BOOST_REQUIRE(chunk != nullptr);
+		int x = it->x * 16, z = it->z * 16;
+		// the blocks of the chunk, its neighbors and some further away
+		for (int dx = -20; dx < 36; dx += 3)
+			for (int dz = -20; dz < 36; dz += 5) {
+				mc::BlockPos pos(x + dx, z + dz, 64);
+				const mc::Chunk* expected = reference.getChunk(mc::ChunkPos(pos));
+				const mc::Chunk* found = cache.getChunkOfBlock(pos, chunk);
+				BOOST_REQUIRE_EQUAL(found == nullptr, expected == nullptr);
+				if (found == nullptr)
+					continue;
+				BOOST_CHECK(found->getPos() == mc::ChunkPos(pos));
+				mc::Block block = cache.getBlock(pos, chunk);
+				BOOST_CHECK_EQUAL(block.id, expected->getBlockID(mc::LocalBlockPos(pos)));
+				BOOST_CHECK_EQUAL(block.data, expected->getBlockData(mc::LocalBlockPos(pos)));
+			}
+	}
+}
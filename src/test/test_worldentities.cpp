@@ -0,0 +1,115 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../mapcraftercore/mc/world.h"
+#include "../mapcraftercore/mc/worldcache.h"
+#include "../mapcraftercore/mc/worldentities.h"
+
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace mc = mapcrafter::mc;
+namespace fs = boost::filesystem;
+
+namespace {
+
+bool compareSigns(const std::vector<mc::SignEntity>& signs1,
+		const std::vector<mc::SignEntity>& signs2) {
+	if (signs1.size() != signs2.size())
+		return false;
+	for (size_t i = 0; i < signs1.size(); i++)
+		if (signs1[i].getPos() != signs2[i].getPos()
+				|| signs1[i].getLines() != signs2[i].getLines())
+			return false;
+	return true;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(worldentities_testCache) {
+	// the entities cache is written into the region directory, so use a copy
+	fs::path world_dir = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(world_dir / "region");
+	fs::copy_file("data/region/r.-1.0.mca", world_dir / "region" / "r.-1.0.mca");
+	mc::World world(world_dir.string());
+	BOOST_REQUIRE(world.load());
+
+	mc::WorldEntitiesCache cache1(world);
+	cache1.update();
+	std::vector<mc::SignEntity> signs = cache1.getSigns();
+	BOOST_CHECK(!signs.empty());
+	BOOST_CHECK(fs::exists(world_dir / "region" / "entities.dat"));
+
+	// the signs must be the same when read from the cache file
+	mc::WorldEntitiesCache cache2(world);
+	cache2.update();
+	BOOST_CHECK(compareSigns(signs, cache2.getSigns()));
+
+	// and when scanned with multiple threads again
+	fs::remove(world_dir / "region" / "entities.dat");
+	mc::WorldEntitiesCache cache3(world);
+	cache3.update(nullptr, 4);
+	BOOST_CHECK(compareSigns(signs, cache3.getSigns()));
+
+	// cropping the signs
+	mc::WorldCrop world_crop;
+	world_crop.setMinY(signs[0].getPos().y);
+	world_crop.setMaxY(signs[0].getPos().y);
+	std::vector<mc::SignEntity> cropped = cache1.getSigns(world_crop);
+	BOOST_CHECK(!cropped.empty());
+	BOOST_CHECK_LT(cropped.size(), signs.size());
+	for (auto it = cropped.begin(); it != cropped.end(); ++it)
+		BOOST_CHECK_EQUAL(it->getPos().y, signs[0].getPos().y);
+
+	fs::remove_all(world_dir);
+}
+
+BOOST_AUTO_TEST_CASE(worldentities_testCollectedSigns) {
+	fs::path world_dir = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(world_dir / "region");
+	fs::copy_file("data/region/r.-1.0.mca", world_dir / "region" / "r.-1.0.mca");
+	mc::World world(world_dir.string());
+	BOOST_REQUIRE(world.load());
+
+	mc::WorldEntitiesCache scanned(world);
+	scanned.update();
+	std::vector<mc::SignEntity> signs = scanned.getSigns();
+	fs::remove(world_dir / "region" / "entities.dat");
+
+	// collect the signs of all chunks like the rendering does
+	std::shared_ptr<mc::SignCollector> collector = std::make_shared<mc::SignCollector>();
+	mc::WorldCache world_cache(world);
+	world_cache.setSignCollector(collector);
+	mc::RegionFile region;
+	BOOST_REQUIRE(world.getRegion(mc::RegionPos(-1, 0), region));
+	BOOST_REQUIRE(region.readOnlyHeaders());
+	auto chunks = region.getContainingChunks();
+	for (auto it = chunks.begin(); it != chunks.end(); ++it)
+		world_cache.getChunk(*it);
+	BOOST_CHECK_EQUAL(collector->size(), chunks.size());
+
+	// the update takes the collected signs then instead of reading the chunks again
+	mc::WorldEntitiesCache collected(world);
+	BOOST_CHECK(collected.addCollectedSigns(*collector));
+	collected.update();
+	BOOST_CHECK(compareSigns(signs, collected.getSigns()));
+
+	fs::remove_all(world_dir);
+}
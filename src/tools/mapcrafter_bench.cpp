@@ -0,0 +1,621 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../mapcraftercore/config/mapcrafterconfig.h"
+#include "../mapcraftercore/mc/chunk.h"
+#include "../mapcraftercore/mc/region.h"
+#include "../mapcraftercore/mc/world.h"
+#include "../mapcraftercore/renderer/blockimages.h"
+#include "../mapcraftercore/renderer/image.h"
+#include "../mapcraftercore/renderer/image/blending.h"
+#include "../mapcraftercore/renderer/image/dithering.h"
+#include "../mapcraftercore/renderer/image/quantization.h"
+#include "../mapcraftercore/renderer/image/scaling.h"
+#include "../mapcraftercore/renderer/renderview.h"
+#include "../mapcraftercore/renderer/tilerenderer.h"
+#include "../mapcraftercore/renderer/tilerenderworker.h"
+#include "../mapcraftercore/renderer/tileset.h"
+#include "../mapcraftercore/renderer/tilestore.h"
+#include "../mapcraftercore/renderer/tilewriter.h"
+#include "../mapcraftercore/thread/impl/multithreading.h"
+#include "../mapcraftercore/thread/impl/singlethread.h"
+#include "../mapcraftercore/util.h"
+#include "../mapcraftercore/util/picojson.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+using namespace mapcrafter;
+using namespace mapcrafter::renderer;
+
+namespace {
+
+const char* RENDER_VIEWS[] = {"isometric", "topdown"};
+const char* RENDER_MODES[] = {"plain", "daylight", "nightlight", "cave", "cavelight"};
+
+/**
+ * The times of the repetitions of a workload, which processes a count of items (chunks,
+ * tiles) each time.
+ */
+struct BenchResult {
+	std::string name, unit;
+	size_t items;
+	std::vector<double> seconds;
+
+	double getMean() const {
+		double sum = 0;
+		for (size_t i = 0; i < seconds.size(); i++)
+			sum += seconds[i];
+		return sum / seconds.size();
+	}
+
+	double getStddev() const {
+		if (seconds.size() < 2)
+			return 0;
+		double mean = getMean(), sum = 0;
+		for (size_t i = 0; i < seconds.size(); i++)
+			sum += (seconds[i] - mean) * (seconds[i] - mean);
+		return std::sqrt(sum / (seconds.size() - 1));
+	}
+
+	picojson::value toJSON() const {
+		picojson::object json;
+		json["name"] = picojson::value(name);
+		json["unit"] = picojson::value(unit);
+		json["items"] = picojson::value((double) items);
+		picojson::array times;
+		for (size_t i = 0; i < seconds.size(); i++)
+			times.push_back(picojson::value(seconds[i]));
+		json["seconds"] = picojson::value(times);
+		json["mean"] = picojson::value(getMean());
+		json["stddev"] = picojson::value(getStddev());
+		json["min"] = picojson::value(*std::min_element(seconds.begin(), seconds.end()));
+		json["max"] = picojson::value(*std::max_element(seconds.begin(), seconds.end()));
+		json["throughput"] = picojson::value(items / getMean());
+		return picojson::value(json);
+	}
+};
+
+/**
+ * Runs a workload a few times without measuring it (so the caches are filled, also the
+ * ones of the CPU), then measures the repetitions of it.
+ */
+BenchResult runBench(const std::string& name, const std::string& unit, size_t items,
+		int warmup, int repetitions, const std::function<void ()>& workload) {
+	typedef std::chrono::steady_clock clock;
+	for (int i = 0; i < warmup; i++)
+		workload();
+
+	BenchResult result;
+	result.name = name;
+	result.unit = unit;
+	result.items = items;
+	for (int i = 0; i < repetitions; i++) {
+		clock::time_point start = clock::now();
+		workload();
+		result.seconds.push_back(std::chrono::duration<double>(clock::now() - start).count());
+	}
+
+	std::cout << std::left << std::setw(40) << name << " " << std::right << std::fixed
+			<< std::setprecision(1) << std::setw(10) << items / result.getMean() << " "
+			<< unit << "/s  (" << std::setprecision(4) << result.getMean() << "s +- "
+			<< result.getStddev() << "s for " << items << " " << unit << ")" << std::endl;
+	return result;
+}
+
+/**
+ * A map of the benchmark configuration set up for rendering.
+ */
+struct BenchMap {
+	std::unique_ptr<RenderView> render_view;
+	std::unique_ptr<BlockImages> block_images;
+	std::unique_ptr<TileSet> tile_set;
+	RenderContext context;
+};
+
+/**
+ * Sets up a map for rendering like the render manager does, with the world and the
+ * textures already loaded.
+ */
+void setupMap(const config::MapcrafterConfig& config, const std::string& map,
+		const mc::World& world, const TextureResources& textures, BenchMap& bench_map) {
+	config::MapSection map_config = config.getMap(map);
+	bench_map.render_view.reset(createRenderView(map_config.getRenderView()));
+	bench_map.block_images.reset(bench_map.render_view->createBlockImages());
+	bench_map.tile_set.reset(bench_map.render_view->createTileSet(map_config.getTileWidth()));
+	bench_map.tile_set->scan(world);
+
+	RenderContext& context = bench_map.context;
+	context.background_color = config.getBackgroundColor();
+	context.world_config = config.getWorld(map_config.getWorld());
+	context.map_config = map_config;
+	bench_map.render_view->configureBlockImages(bench_map.block_images.get(),
+			context.world_config, map_config);
+	bench_map.block_images->setRotation(0);
+	bench_map.block_images->generateBlocks(textures);
+	context.render_view = bench_map.render_view.get();
+	context.block_images = bench_map.block_images.get();
+	context.tile_set = bench_map.tile_set.get();
+	context.world = world;
+	context.initializeTileRenderer();
+}
+
+/**
+ * Returns up to count render tiles spread over the required tiles of a tile set.
+ */
+std::vector<TilePos> getSampleTiles(const TileSet& tile_set, int count) {
+	const std::set<TilePos>& required = tile_set.getRequiredRenderTiles();
+	size_t step = std::max<size_t>(1, required.size() / count);
+	std::vector<TilePos> tiles;
+	size_t i = 0;
+	for (auto it = required.begin(); it != required.end()
+			&& (int) tiles.size() < count; ++it, ++i)
+		if (i % step == 0)
+			tiles.push_back(*it + tile_set.getTileOffset());
+	return tiles;
+}
+
+/**
+ * Returns a random image with pixels of an alpha distribution: "opaque", "transparent",
+ * "mixed" (a third of them each opaque, transparent and semi-transparent) or
+ * "semitransparent". The same seed always gives the same image.
+ */
+RGBAImage createRandomImage(int size, const std::string& alpha, unsigned int seed) {
+	std::mt19937 random(seed);
+	RGBAImage image(size, size);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++) {
+			uint32_t value = random();
+			uint8_t a = 255;
+			int kind = alpha == "opaque" ? 0 : (alpha == "transparent" ? 1
+					: (alpha == "semitransparent" ? 2 : (value >> 24) % 3));
+			if (kind == 1)
+				a = 0;
+			else if (kind == 2)
+				a = 1 + (value >> 24) % 254;
+			image.pixel(x, y) = rgba(value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, a);
+		}
+	return image;
+}
+
+/**
+ * Runs the workloads of the image kernels with images of different sizes and alpha
+ * distributions. The small images are processed several times per repetition, so every
+ * repetition processes about the same count of pixels.
+ */
+void benchImageKernels(int warmup, int repetitions, picojson::array& results) {
+	const int sizes[] = {64, 256, 1024};
+	const char* alphas[] = {"opaque", "transparent", "mixed", "semitransparent"};
+	const BlendingKernel kernels[] = {BlendingKernel::SCALAR, BlendingKernel::SSE2,
+			BlendingKernel::AVX2};
+	const char* kernel_names[] = {"scalar", "sse2", "avx2"};
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		for (size_t j = 0; j < sizeof(alphas) / sizeof(alphas[0]); j++) {
+			int size = sizes[i];
+			int times = std::max(1, (1 << 20) / (size * size));
+			size_t pixels = (size_t) size * size * times;
+			std::string suffix = "_" + std::to_string(size) + "_" + alphas[j];
+			RGBAImage source = createRandomImage(size, alphas[j], 1);
+			// the images are blitted onto images with mixed alpha, like the block images
+			// onto partly rendered tiles
+			RGBAImage dest = createRandomImage(size, "mixed", 2);
+			RGBAImage result;
+
+			results.push_back(runBench("blend" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++) {
+					RGBAPixel* dest_data = &dest.pixel(0, 0);
+					const RGBAPixel* source_data = &source.pixel(0, 0);
+					for (int k = 0; k < size * size; k++)
+						blend(dest_data[k], source_data[k]);
+				}
+			}).toJSON());
+			for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+				if (!isBlendingKernelSupported(kernels[k]))
+					continue;
+				BlendingKernel kernel = kernels[k];
+				results.push_back(runBench(std::string("blend_row_") + kernel_names[k]
+						+ suffix, "pixels", pixels, warmup, repetitions, [&]() {
+					for (int t = 0; t < times; t++)
+						for (int y = 0; y < size; y++)
+							blendRow(&dest.pixel(0, y), &source.pixel(0, y), size, kernel);
+				}).toJSON());
+			}
+			results.push_back(runBench("alpha_blit" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					dest.alphaBlit(source, 0, 0);
+			}).toJSON());
+			results.push_back(runBench("simple_alpha_blit" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					dest.simpleAlphaBlit(source, 0, 0);
+			}).toJSON());
+			results.push_back(runBench("resize_half" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					imageResizeHalf(source, result);
+			}).toJSON());
+			results.push_back(runBench("resize_bilinear" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					imageResizeBilinear(source, result, size * 3 / 4, size * 3 / 4);
+			}).toJSON());
+			results.push_back(runBench("rotate" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					result = source.rotate(1);
+			}).toJSON());
+			results.push_back(runBench("flip" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					result = source.flip(true, false);
+			}).toJSON());
+			results.push_back(runBench("blur" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++)
+					source.blur(result, 2);
+			}).toJSON());
+
+			// the palettes of the indexed PNGs have 256 colors
+			std::vector<RGBAPixel> colors;
+			results.push_back(runBench("octree_quantize" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++) {
+					colors.clear();
+					octreeColorQuantize(source, 256, colors);
+				}
+			}).toJSON());
+			OctreePalette palette(colors);
+			std::vector<int> data;
+			results.push_back(runBench("dither" + suffix, "pixels", pixels,
+					warmup, repetitions, [&]() {
+				for (int t = 0; t < times; t++) {
+					result = source;
+					imageDither(result, palette, data);
+				}
+			}).toJSON());
+		}
+}
+
+/**
+ * The configuration with the maps of the benchmarks, and the loaded world and textures.
+ */
+struct BenchSetup {
+	config::MapcrafterConfig config;
+	mc::World world;
+	TextureResources textures;
+	// the maps of all render views and render modes
+	std::vector<std::string> render_maps;
+};
+
+/**
+ * Creates the configuration of the benchmarks and loads the world and the textures.
+ */
+bool loadBenchSetup(const std::string& world_dir, const std::string& texture_dir,
+		BenchSetup& setup) {
+	// the maps of all render views and render modes, and the maps with the image formats
+	// to encode the tiles with
+	std::ostringstream config_string;
+	// nothing is written to the output directory and the template directory is not
+	// needed, but the configuration requires them
+	config_string << "output_dir = mapcrafter_bench" << std::endl;
+	config_string << "template_dir = ." << std::endl;
+	config_string << "[world:bench]" << std::endl << "input_dir = " << world_dir << std::endl;
+	for (size_t i = 0; i < sizeof(RENDER_VIEWS) / sizeof(RENDER_VIEWS[0]); i++)
+		for (size_t j = 0; j < sizeof(RENDER_MODES) / sizeof(RENDER_MODES[0]); j++) {
+			std::string map = std::string(RENDER_VIEWS[i]) + "_" + RENDER_MODES[j];
+			setup.render_maps.push_back(map);
+			config_string << "[map:" << map << "]" << std::endl
+					<< "render_view = " << RENDER_VIEWS[i] << std::endl
+					<< "render_mode = " << RENDER_MODES[j] << std::endl;
+		}
+	config_string << "[map:png]" << std::endl;
+	config_string << "[map:jpeg]" << std::endl << "image_format = jpeg" << std::endl;
+	config_string << "[map:png_indexed]" << std::endl << "png_indexed = true" << std::endl;
+	config_string << "[global:map]" << std::endl << "world = bench" << std::endl;
+	if (!texture_dir.empty())
+		config_string << "texture_dir = " << texture_dir << std::endl;
+
+	config::ValidationMap validation = setup.config.parseString(config_string.str(),
+			fs::current_path());
+	if (validation.isCritical()) {
+		validation.log();
+		return false;
+	}
+
+	setup.world = mc::World(setup.config.getWorld("bench").getInputDir().string());
+	if (!setup.world.load()) {
+		LOG(ERROR) << "Unable to load world " << world_dir << "!";
+		return false;
+	}
+	if (setup.world.getAvailableRegions().empty()) {
+		LOG(ERROR) << "The world " << world_dir << " has no regions!";
+		return false;
+	}
+
+	config::MapSection png_config = setup.config.getMap("png");
+	return setup.textures.loadTextures(png_config.getTextureDir().string(),
+			png_config.getTextureSize(), png_config.getTextureBlur(),
+			png_config.getWaterOpacity());
+}
+
+/**
+ * Runs the workloads of the renderer: decoding chunks, rendering tiles with every render
+ * view and render mode, compositing and encoding tiles.
+ */
+bool benchRendering(BenchSetup& setup, int tiles, int warmup, int repetitions,
+		picojson::array& results) {
+	const config::MapcrafterConfig& config = setup.config;
+	const mc::World& world = setup.world;
+
+	// decode every chunk of the first region of the world
+	mc::RegionFile region(world.getRegionPath(*world.getAvailableRegions().begin()).string());
+	if (!region.read()) {
+		LOG(ERROR) << "Unable to read region " << region.getFilename() << "!";
+		return false;
+	}
+	results.push_back(runBench("decode_chunks", "chunks", region.getContainingChunksCount(),
+			warmup, repetitions, [&region]() {
+		mc::Chunk chunk;
+		const mc::RegionFile::ChunkMap& chunks = region.getContainingChunks();
+		for (auto it = chunks.begin(); it != chunks.end(); ++it)
+			region.loadChunk(*it, chunk);
+	}).toJSON());
+
+	// render the same tiles again and again, the chunks are decoded in the warm-up
+	// already (or in the first repetition without warm-up)
+	std::vector<RGBAImage> tile_images;
+	for (auto map_it = setup.render_maps.begin(); map_it != setup.render_maps.end();
+			++map_it) {
+		BenchMap bench_map;
+		setupMap(config, *map_it, world, setup.textures, bench_map);
+		std::vector<TilePos> sample_tiles = getSampleTiles(*bench_map.tile_set, tiles);
+		std::vector<RGBAImage> images(sample_tiles.size());
+		TileRenderer* tile_renderer = bench_map.context.tile_renderer.get();
+		results.push_back(runBench("render_" + *map_it, "tiles", sample_tiles.size(),
+				warmup, repetitions, [&]() {
+			for (size_t i = 0; i < sample_tiles.size(); i++)
+				tile_renderer->renderTile(sample_tiles[i], images[i]);
+		}).toJSON());
+		// the isometric tiles with the default render mode are composited/encoded
+		if (*map_it == "isometric_daylight")
+			tile_images = images;
+	}
+
+	if (tile_images.empty()) {
+		LOG(ERROR) << "The world has no tiles to render!";
+		return false;
+	}
+
+	// composite a subtree of 16 render tiles (four composite tiles and their parent)
+	int size = tile_images[0].getWidth();
+	results.push_back(runBench("composite_subtree", "tiles", 5, warmup, repetitions, [&]() {
+		RGBAImage parent(size, size), composite(size, size);
+		for (int i = 0; i < 4; i++) {
+			composite.clear();
+			for (int j = 0; j < 4; j++)
+				imageResizeHalfBlit(tile_images[(i * 4 + j) % tile_images.size()],
+						composite, (j % 2) * size / 2, (j / 2) * size / 2);
+			imageResizeHalfBlit(composite, parent, (i % 2) * size / 2, (i / 2) * size / 2);
+		}
+	}).toJSON());
+
+	const char* formats[] = {"png", "jpeg", "png_indexed"};
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		config::MapSection map_config = config.getMap(formats[i]);
+		results.push_back(runBench(std::string("encode_") + formats[i], "tiles",
+				tile_images.size(), warmup, repetitions, [&]() {
+			std::string data;
+			for (size_t j = 0; j < tile_images.size(); j++)
+				TileWriter::encodeImage(tile_images[j], map_config,
+						config.getBackgroundColor(), false, nullptr, data);
+		}).toJSON());
+	}
+	return true;
+}
+
+
+/**
+ * Renders all tiles of a map with the single thread dispatcher and with the
+ * multi-threading dispatcher with 1, 2, 4 ... threads up to max_threads, and reports the
+ * speedup and efficiency of each thread count compared to the single thread dispatcher.
+ * The tiles are written to a temporary directory, the chunks are decoded again every
+ * time.
+ */
+bool benchScaling(BenchSetup& setup, int max_threads, int warmup, int repetitions,
+		picojson::array& results) {
+	BenchMap bench_map;
+	setupMap(setup.config, "isometric_daylight", setup.world, setup.textures, bench_map);
+	const config::MapSection& map_config = bench_map.context.map_config;
+	size_t tiles = bench_map.tile_set->getRequiredRenderTilesCount();
+	if (tiles == 0) {
+		LOG(ERROR) << "The world has no tiles to render!";
+		return false;
+	}
+
+	fs::path output_dir = fs::temp_directory_path() / fs::unique_path("mapcrafter_bench-%%%%%%");
+	std::vector<int> thread_counts = {0};
+	for (int threads = 1; threads < max_threads; threads *= 2)
+		thread_counts.push_back(threads);
+	thread_counts.push_back(max_threads);
+
+	double single_thread_time = 0;
+	for (auto it = thread_counts.begin(); it != thread_counts.end(); ++it) {
+		int threads = *it;
+		// the wait times of the warm-up are not counted
+		double work_wait_time = 0, result_wait_time = 0;
+		int run = 0;
+		BenchResult result = runBench(threads == 0 ? "dispatch_single_thread"
+				: "dispatch_threads_" + std::to_string(threads), "tiles", tiles,
+				warmup, repetitions, [&]() {
+			RenderContext context = bench_map.context;
+			context.output_dir = output_dir;
+			context.tile_writer = std::make_shared<TileWriter>(map_config,
+					context.background_color, map_config.getWriteThreads(),
+					createTileStore(map_config, output_dir));
+			util::DummyProgressHandler progress;
+			if (threads == 0) {
+				// the single thread uses the world cache of the context
+				context.initializeTileRenderer();
+				thread::SingleThreadDispatcher().dispatch(context, &progress);
+			} else {
+				thread::MultiThreadingDispatcher dispatcher(threads);
+				dispatcher.dispatch(context, &progress);
+				if (run++ >= warmup) {
+					work_wait_time += dispatcher.getWorkWaitTime();
+					result_wait_time += dispatcher.getResultWaitTime();
+				}
+			}
+			context.tile_writer->finish();
+		});
+
+		double mean = result.getMean();
+		if (threads == 0)
+			single_thread_time = mean;
+		picojson::object json = result.toJSON().get<picojson::object>();
+		json["threads"] = picojson::value((double) std::max(1, threads));
+		json["speedup"] = picojson::value(single_thread_time / mean);
+		json["efficiency"] = picojson::value(single_thread_time / mean / std::max(1, threads));
+		if (threads != 0) {
+			json["workWaitTime"] = picojson::value(work_wait_time / repetitions);
+			json["resultWaitTime"] = picojson::value(result_wait_time / repetitions);
+			std::cout << "  speedup " << std::setprecision(2) << single_thread_time / mean
+					<< ", efficiency " << single_thread_time / mean / threads
+					<< ", waiting for work " << std::setprecision(4)
+					<< work_wait_time / repetitions << "s (all threads), for results "
+					<< result_wait_time / repetitions << "s" << std::endl;
+		}
+		results.push_back(picojson::value(json));
+	}
+
+	boost::system::error_code error;
+	fs::remove_all(output_dir, error);
+	return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::string suite, world_dir, texture_dir, output_file;
+	int tiles, threads, warmup, repetitions;
+
+	po::options_description all("Allowed options");
+	all.add_options()
+		("help,h", "shows a help message")
+
+		("suite,s", po::value<std::string>(&suite)->default_value("all"),
+			"the workloads to run: 'render' (decoding, rendering, compositing and encoding "
+			"tiles), 'image' (the image kernels), 'scaling' (rendering the world with "
+			"different counts of threads) or 'all'")
+		("world-dir,w", po::value<std::string>(&world_dir)->default_value("src/test/data"),
+			"the world to use, the test data of the repository by default")
+		("texture-dir,i", po::value<std::string>(&texture_dir),
+			"the path to the textures (default: the one found like mapcrafter does)")
+		("tiles,n", po::value<int>(&tiles)->default_value(16),
+			"the count of tiles to render per render view and render mode")
+		("threads,j", po::value<int>(&threads)->default_value(
+				std::max(1, (int) std::thread::hardware_concurrency())),
+			"the maximum count of threads to render the world with")
+		("warmup", po::value<int>(&warmup)->default_value(1),
+			"how often a workload runs before it is measured")
+		("repetitions,r", po::value<int>(&repetitions)->default_value(5),
+			"how often a workload is measured")
+		("output,o", po::value<std::string>(&output_file),
+			"writes the results to the specified JSON file");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, all), vm);
+	} catch (po::error& ex) {
+		std::cout << "There is a problem parsing the command line arguments: "
+				<< ex.what() << std::endl << std::endl;
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	if (suite != "all" && suite != "render" && suite != "image" && suite != "scaling") {
+		std::cerr << "Invalid suite '" << suite << "'!" << std::endl;
+		return 1;
+	}
+	if (tiles < 1 || threads < 1 || warmup < 0 || repetitions < 1) {
+		std::cerr << "The count of tiles, threads and repetitions must be positive!"
+				<< std::endl;
+		return 1;
+	}
+
+	// the benchmark results are printed, the messages of the renderer would mix with them
+	util::Logging::getInstance().setSinkVerbosity("__output__", util::LogLevel::WARNING);
+
+	picojson::array results;
+	if (suite == "all" || suite == "render" || suite == "scaling") {
+		BenchSetup setup;
+		if (!loadBenchSetup(world_dir, texture_dir, setup))
+			return 1;
+		if (suite != "scaling" && !benchRendering(setup, tiles, warmup, repetitions, results))
+			return 1;
+		if (suite != "render" && !benchScaling(setup, threads, warmup, repetitions, results))
+			return 1;
+	}
+	if (suite == "all" || suite == "image")
+		benchImageKernels(warmup, repetitions, results);
+
+	if (!output_file.empty()) {
+		picojson::object json;
+		json["suite"] = picojson::value(suite);
+		json["tiles"] = picojson::value((double) tiles);
+		json["threads"] = picojson::value((double) threads);
+		json["warmup"] = picojson::value((double) warmup);
+		json["repetitions"] = picojson::value((double) repetitions);
+		json["results"] = picojson::value(results);
+		std::ofstream out(output_file);
+		out << picojson::value(json).serialize(true);
+		if (!out) {
+			LOG(ERROR) << "Unable to write " << output_file << "!";
+			return 1;
+		}
+	}
+
+	return 0;
+}
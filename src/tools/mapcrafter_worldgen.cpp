@@ -0,0 +1,620 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../mapcraftercore/mc/nbt.h"
+#include "../mapcraftercore/mc/pos.h"
+#include "../mapcraftercore/mc/region.h"
+#include "../mapcraftercore/util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+using namespace mapcrafter;
+
+namespace {
+
+// the (pre 1.13) block ids of the blocks the worlds are made of
+const uint8_t AIR = 0;
+const uint8_t STONE = 1;
+const uint8_t GRASS = 2;
+const uint8_t DIRT = 3;
+const uint8_t BEDROCK = 7;
+const uint8_t WATER = 9;
+const uint8_t SAND = 12;
+const uint8_t LOG = 17;
+const uint8_t LEAVES = 18;
+const uint8_t TALL_GRASS = 31;
+const uint8_t DEAD_BUSH = 32;
+const uint8_t DANDELION = 37;
+const uint8_t POPPY = 38;
+const uint8_t SNOW_LAYER = 78;
+const uint8_t ICE = 79;
+
+// the timestamp of all chunks, so the same settings generate the same files
+const uint32_t CHUNK_TIMESTAMP = 1500000000;
+
+/**
+ * A biome of the generated worlds: the blocks of the surface, the wood of the trees
+ * (data value of logs and leaves) and how many trees grow compared to a forest.
+ */
+struct Biome {
+	const char* name;
+	uint8_t id;
+	uint8_t surface, subsurface;
+	uint8_t wood;
+	double trees;
+	bool snowy;
+};
+
+const Biome BIOMES[] = {
+	{"plains", 1, GRASS, DIRT, 0, 0.05, false},
+	{"desert", 2, SAND, SAND, 0, 0, false},
+	{"mountains", 3, GRASS, DIRT, 1, 0.2, false},
+	{"forest", 4, GRASS, DIRT, 0, 1, false},
+	{"taiga", 5, GRASS, DIRT, 1, 0.8, false},
+	{"swamp", 6, GRASS, DIRT, 0, 0.4, false},
+	{"ice_plains", 12, GRASS, DIRT, 1, 0.05, true},
+	{"jungle", 21, GRASS, DIRT, 3, 1.5, false},
+	{"birch_forest", 27, GRASS, DIRT, 2, 1, false},
+};
+
+const Biome* findBiome(const std::string& name) {
+	for (size_t i = 0; i < sizeof(BIOMES) / sizeof(BIOMES[0]); i++)
+		if (name == BIOMES[i].name)
+			return &BIOMES[i];
+	return nullptr;
+}
+
+/**
+ * The settings of a generated world. The chunks are in the rectangle from the minimum
+ * to the maximum chunk (exclusive).
+ */
+struct WorldSettings {
+	uint64_t seed;
+	int min_chunk_x, min_chunk_z, max_chunk_x, max_chunk_z;
+	int height, relief, sea_level;
+	double foliage, caves;
+	// the biomes with their weights, the weights add up to 1
+	std::vector<std::pair<const Biome*, double> > biomes;
+};
+
+// salts to get independent random values for the different features from the seed
+enum class Feature {
+	HEIGHT, BIOME, BIOME_WARP_X, BIOME_WARP_Z, TREE, PLANT, CAVE_1, CAVE_2, SAMPLE
+};
+
+uint64_t mix(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * Returns a random number in [0, 1) which depends only on the seed, the feature and
+ * the position, so every chunk can be generated on its own in any order.
+ */
+double randomValue(const WorldSettings& settings, Feature feature, int64_t x, int64_t y,
+		int64_t z = 0) {
+	uint64_t h = mix(settings.seed + (uint64_t) feature);
+	h = mix(h ^ (uint64_t) x);
+	h = mix(h ^ (uint64_t) y);
+	h = mix(h ^ (uint64_t) z);
+	return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double smooth(double t) {
+	return t * t * (3 - 2 * t);
+}
+
+double lerp(double a, double b, double t) {
+	return a + (b - a) * t;
+}
+
+/**
+ * Value noise in two dimensions with a lattice spacing of 1, in [0, 1).
+ */
+double noise2(const WorldSettings& settings, Feature feature, double x, double z) {
+	double fx = std::floor(x), fz = std::floor(z);
+	int64_t ix = fx, iz = fz;
+	double tx = smooth(x - fx), tz = smooth(z - fz);
+	return lerp(
+			lerp(randomValue(settings, feature, ix, iz),
+					randomValue(settings, feature, ix + 1, iz), tx),
+			lerp(randomValue(settings, feature, ix, iz + 1),
+					randomValue(settings, feature, ix + 1, iz + 1), tx), tz);
+}
+
+/**
+ * Value noise in three dimensions with a lattice spacing of 1, in [0, 1).
+ */
+double noise3(const WorldSettings& settings, Feature feature, double x, double y,
+		double z) {
+	double fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+	int64_t ix = fx, iy = fy, iz = fz;
+	double tx = smooth(x - fx), ty = smooth(y - fy), tz = smooth(z - fz);
+	double layers[2];
+	for (int i = 0; i < 2; i++)
+		layers[i] = lerp(
+				lerp(randomValue(settings, feature, ix, iy + i, iz),
+						randomValue(settings, feature, ix + 1, iy + i, iz), tx),
+				lerp(randomValue(settings, feature, ix, iy + i, iz + 1),
+						randomValue(settings, feature, ix + 1, iy + i, iz + 1), tx), tz);
+	return lerp(layers[0], layers[1], ty);
+}
+
+/**
+ * Returns the height of the terrain of a column: A few octaves of noise scaled so the
+ * terrain is at most relief blocks above or below the mean height.
+ */
+int getTerrainHeight(const WorldSettings& settings, int x, int z) {
+	double sum = 0, amplitude = 1, amplitudes = 0, frequency = 1.0 / 256;
+	for (int octave = 0; octave < 5; octave++) {
+		sum += amplitude * noise2(settings, Feature::HEIGHT, x * frequency, z * frequency);
+		amplitudes += amplitude;
+		amplitude /= 2;
+		frequency *= 2;
+	}
+	double n = std::max(-1.0, std::min(1.0, (sum / amplitudes - 0.5) * 3));
+	int height = std::lround(settings.height + settings.relief * n);
+	return std::max(4, std::min(240, height));
+}
+
+/**
+ * Returns the biome of a column. The world is split into cells of biomes, the borders
+ * of the cells are warped with noise so they aren't straight.
+ */
+const Biome* getBiome(const WorldSettings& settings, int x, int z) {
+	double warped_x = x + 48 * (noise2(settings, Feature::BIOME_WARP_X, x / 64.0, z / 64.0)
+			- 0.5);
+	double warped_z = z + 48 * (noise2(settings, Feature::BIOME_WARP_Z, x / 64.0, z / 64.0)
+			- 0.5);
+	double r = randomValue(settings, Feature::BIOME, (int64_t) std::floor(warped_x / 128),
+			(int64_t) std::floor(warped_z / 128));
+	for (auto it = settings.biomes.begin(); it != settings.biomes.end(); ++it) {
+		if (r < it->second)
+			return it->first;
+		r -= it->second;
+	}
+	return settings.biomes.back().first;
+}
+
+/**
+ * Returns the height of the trunk of a tree growing on a column, or 0 if there is none.
+ * The height of the terrain and the biome of the column are returned too.
+ */
+int getTreeHeight(const WorldSettings& settings, int x, int z, int& ground,
+		const Biome*& biome) {
+	ground = getTerrainHeight(settings, x, z);
+	biome = getBiome(settings, x, z);
+	if (ground <= settings.sea_level + 1 || biome->surface != GRASS)
+		return 0;
+	double chance = settings.foliage * biome->trees * 0.02;
+	double r = randomValue(settings, Feature::TREE, x, z);
+	if (r >= chance)
+		return 0;
+	return 4 + (int) (r / chance * 3);
+}
+
+/**
+ * Returns the water level which leaves about the specified fraction of the columns
+ * under water, estimated with the heights of sampled columns of the world.
+ */
+int getSeaLevel(const WorldSettings& settings, double water) {
+	if (water <= 0)
+		return -1;
+	const int SAMPLES = 4096;
+	int width = settings.max_chunk_x - settings.min_chunk_x;
+	int length = settings.max_chunk_z - settings.min_chunk_z;
+	std::vector<int> heights;
+	for (int i = 0; i < SAMPLES; i++) {
+		int x = settings.min_chunk_x * 16
+				+ (int) (randomValue(settings, Feature::SAMPLE, i, 0) * width * 16);
+		int z = settings.min_chunk_z * 16
+				+ (int) (randomValue(settings, Feature::SAMPLE, i, 1) * length * 16);
+		heights.push_back(getTerrainHeight(settings, x, z));
+	}
+	std::sort(heights.begin(), heights.end());
+	size_t index = std::min<size_t>(water * SAMPLES, SAMPLES);
+	return index < heights.size() ? heights[index] : heights.back() + 1;
+}
+
+bool isOpaque(uint8_t id) {
+	return id == STONE || id == GRASS || id == DIRT || id == BEDROCK || id == SAND
+			|| id == LOG;
+}
+
+/**
+ * Generates a chunk and returns its NBT data (in the format of Minecraft 1.12).
+ */
+std::vector<uint8_t> generateChunk(const WorldSettings& settings,
+		const mc::ChunkPos& pos) {
+	// the block ids and data values of the chunk, indexed by (y * 16 + z) * 16 + x
+	std::vector<uint8_t> blocks(16 * 16 * 256, AIR), data(16 * 16 * 256, 0);
+	auto index = [](int x, int z, int y) {
+		return (y * 16 + z) * 16 + x;
+	};
+	std::vector<int8_t> biomes(256);
+
+	for (int z = 0; z < 16; z++)
+		for (int x = 0; x < 16; x++) {
+			int global_x = pos.x * 16 + x, global_z = pos.z * 16 + z;
+			int ground;
+			const Biome* biome;
+			int tree = getTreeHeight(settings, global_x, global_z, ground, biome);
+			biomes[z * 16 + x] = biome->id;
+
+			// the terrain, with beaches at the water and the ground under water
+			bool beach = ground <= settings.sea_level + 1;
+			blocks[index(x, z, 0)] = BEDROCK;
+			for (int y = 1; y <= ground; y++) {
+				uint8_t id = STONE;
+				if (y == ground)
+					id = beach ? SAND : biome->surface;
+				else if (y > ground - 4)
+					id = beach ? SAND : biome->subsurface;
+				blocks[index(x, z, y)] = id;
+			}
+			for (int y = ground + 1; y <= settings.sea_level; y++)
+				blocks[index(x, z, y)] = y == settings.sea_level && biome->snowy ? ICE : WATER;
+
+			// the caves are where the two noise values are close to 0.5 at the same time,
+			// these are winding tunnels, only below the surface so they don't flood
+			if (settings.caves > 0) {
+				double threshold = 0.045 * std::sqrt(settings.caves);
+				for (int y = 2; y < ground - 5; y++) {
+					if (std::abs(noise3(settings, Feature::CAVE_1, global_x / 32.0, y / 16.0,
+							global_z / 32.0) - 0.5) >= threshold)
+						continue;
+					if (std::abs(noise3(settings, Feature::CAVE_2, global_x / 32.0, y / 16.0,
+							global_z / 32.0) - 0.5) < threshold)
+						blocks[index(x, z, y)] = AIR;
+				}
+			}
+
+			// the plants on the surface
+			if (beach || tree || ground + 1 >= 256)
+				continue;
+			double r = randomValue(settings, Feature::PLANT, global_x, global_z);
+			int plant = index(x, z, ground + 1);
+			if (biome->surface == SAND) {
+				if (r < settings.foliage * 0.02)
+					blocks[plant] = DEAD_BUSH;
+			} else if (r < settings.foliage * 0.03) {
+				blocks[plant] = r < settings.foliage * 0.015 ? DANDELION : POPPY;
+			} else if (r < settings.foliage * 0.3) {
+				blocks[plant] = TALL_GRASS;
+				data[plant] = 1;
+			} else if (biome->snowy) {
+				blocks[plant] = SNOW_LAYER;
+			}
+		}
+
+	// the trees, also the ones of the neighbor chunks with leaves in this chunk
+	for (int tree_z = -2; tree_z < 18; tree_z++)
+		for (int tree_x = -2; tree_x < 18; tree_x++) {
+			int ground;
+			const Biome* biome;
+			int height = getTreeHeight(settings, pos.x * 16 + tree_x, pos.z * 16 + tree_z,
+					ground, biome);
+			int top = ground + height;
+			if (height == 0 || top + 1 >= 256)
+				continue;
+			for (int y = top - 2; y <= top + 1; y++) {
+				int radius = y < top ? 2 : 1;
+				for (int dz = -radius; dz <= radius; dz++)
+					for (int dx = -radius; dx <= radius; dx++) {
+						int x = tree_x + dx, z = tree_z + dz;
+						// no leaves at the corners of the upper layers
+						if (x < 0 || x >= 16 || z < 0 || z >= 16
+								|| (y > top && std::abs(dx) == radius && std::abs(dz) == radius))
+							continue;
+						int i = index(x, z, y);
+						if (blocks[i] == AIR || blocks[i] == TALL_GRASS) {
+							blocks[i] = LEAVES;
+							data[i] = biome->wood | 4;
+						}
+					}
+			}
+			if (tree_x >= 0 && tree_x < 16 && tree_z >= 0 && tree_z < 16)
+				for (int y = ground + 1; y <= top; y++) {
+					blocks[index(tree_x, tree_z, y)] = LOG;
+					data[index(tree_x, tree_z, y)] = biome->wood;
+				}
+		}
+
+	// the sky light goes down to the first opaque block of a column, there is no
+	// block light
+	std::vector<uint8_t> sky_light(16 * 16 * 256, 0);
+	for (int z = 0; z < 16; z++)
+		for (int x = 0; x < 16; x++)
+			for (int y = 255; y >= 0 && !isOpaque(blocks[index(x, z, y)]); y--)
+				sky_light[index(x, z, y)] = 15;
+
+	// the sections with blocks, the others are empty with full sky light
+	mc::nbt::TagList sections(mc::nbt::TagCompound::TAG_TYPE);
+	for (int section = 0; section < 16; section++) {
+		size_t begin = section * 4096, end = begin + 4096;
+		if (std::all_of(blocks.begin() + begin, blocks.begin() + end,
+				[](uint8_t id) { return id == AIR; }))
+			continue;
+		std::vector<int8_t> section_blocks(blocks.begin() + begin, blocks.begin() + end);
+		std::vector<int8_t> section_data(2048, 0), section_sky_light(2048, 0);
+		for (size_t i = 0; i < 4096; i++) {
+			int shift = (i % 2) * 4;
+			section_data[i / 2] |= data[begin + i] << shift;
+			section_sky_light[i / 2] |= sky_light[begin + i] << shift;
+		}
+		mc::nbt::TagCompound tag;
+		tag.addTag("Y", mc::nbt::TagByte(section));
+		tag.addTag("Blocks", mc::nbt::TagByteArray(section_blocks));
+		tag.addTag("Data", mc::nbt::TagByteArray(section_data));
+		tag.addTag("BlockLight", mc::nbt::TagByteArray(std::vector<int8_t>(2048, 0)));
+		tag.addTag("SkyLight", mc::nbt::TagByteArray(section_sky_light));
+		sections.payload.push_back(mc::nbt::TagPtr(tag.clone()));
+	}
+
+	mc::nbt::TagCompound level;
+	level.addTag("xPos", mc::nbt::TagInt(pos.x));
+	level.addTag("zPos", mc::nbt::TagInt(pos.z));
+	level.addTag("TerrainPopulated", mc::nbt::TagByte(1));
+	level.addTag("Biomes", mc::nbt::TagByteArray(biomes));
+	level.addTag("Sections", sections);
+	level.addTag("TileEntities", mc::nbt::TagList(mc::nbt::TagCompound::TAG_TYPE));
+	mc::nbt::NBTFile nbt;
+	nbt.addTag("Level", level);
+	std::stringstream stream;
+	nbt.writeNBT(stream, mc::nbt::Compression::ZLIB);
+	std::string compressed = stream.str();
+	return std::vector<uint8_t>(compressed.begin(), compressed.end());
+}
+
+/**
+ * Writes the level.dat file of the world with the seed (the slime overlay needs it)
+ * and the spawn in the middle of the world.
+ */
+bool writeLevelDat(const WorldSettings& settings, const fs::path& world_dir) {
+	int spawn_x = (settings.min_chunk_x + settings.max_chunk_x) * 8;
+	int spawn_z = (settings.min_chunk_z + settings.max_chunk_z) * 8;
+	mc::nbt::TagCompound data;
+	data.addTag("LevelName", mc::nbt::TagString("Generated world"));
+	data.addTag("RandomSeed", mc::nbt::TagLong(settings.seed));
+	data.addTag("SpawnX", mc::nbt::TagInt(spawn_x));
+	data.addTag("SpawnY", mc::nbt::TagInt(getTerrainHeight(settings, spawn_x, spawn_z) + 1));
+	data.addTag("SpawnZ", mc::nbt::TagInt(spawn_z));
+	mc::nbt::NBTFile nbt;
+	nbt.addTag("Data", data);
+	try {
+		nbt.writeNBT((world_dir / "level.dat").string().c_str());
+	} catch (const std::exception& e) {
+		std::cerr << "Unable to write level.dat: " << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parses the biomes with their weights ("<biome>[:<weight>],...").
+ */
+bool parseBiomes(const std::string& list,
+		std::vector<std::pair<const Biome*, double> >& biomes) {
+	std::stringstream stream(list);
+	std::string entry;
+	double sum = 0;
+	while (std::getline(stream, entry, ',')) {
+		std::string name = util::trim(entry);
+		double weight = 1;
+		size_t colon = name.find(':');
+		if (colon != std::string::npos) {
+			try {
+				weight = util::as<double>(name.substr(colon + 1));
+			} catch (std::invalid_argument& e) {
+				weight = -1;
+			}
+			name = name.substr(0, colon);
+		}
+		const Biome* biome = findBiome(name);
+		if (biome == nullptr || weight <= 0) {
+			std::cerr << "Invalid biome '" << entry << "'!" << std::endl;
+			return false;
+		}
+		biomes.push_back(std::make_pair(biome, weight));
+		sum += weight;
+	}
+	if (biomes.empty()) {
+		std::cerr << "No biomes specified!" << std::endl;
+		return false;
+	}
+	for (auto it = biomes.begin(); it != biomes.end(); ++it)
+		it->second /= sum;
+	return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::string output_dir, biome_list;
+	int width, length, height, relief, threads;
+	int64_t seed;
+	double water, foliage, caves;
+
+	std::string biome_names;
+	for (size_t i = 0; i < sizeof(BIOMES) / sizeof(BIOMES[0]); i++)
+		biome_names += std::string(i ? ", " : "") + BIOMES[i].name;
+
+	po::options_description all("Allowed options");
+	all.add_options()
+		("help,h", "shows a help message")
+
+		("output-dir,o", po::value<std::string>(&output_dir),
+			"the directory to create the world in (required)")
+		("width,x", po::value<int>(&width)->default_value(64),
+			"the width of the world in chunks (east-west)")
+		("length,z", po::value<int>(&length)->default_value(-1),
+			"the length of the world in chunks (north-south), the width by default")
+		("seed,s", po::value<int64_t>(&seed)->default_value(1),
+			"the seed, the same settings and seed generate the same world")
+		("height", po::value<int>(&height)->default_value(64),
+			"the mean height of the terrain")
+		("relief", po::value<int>(&relief)->default_value(24),
+			"how many blocks the terrain goes at most above and below the mean height")
+		("water", po::value<double>(&water)->default_value(0.2),
+			"the fraction of the columns under water, 0 to 1")
+		("foliage", po::value<double>(&foliage)->default_value(0.5),
+			"the density of trees and plants, 0 to 1")
+		("biomes", po::value<std::string>(&biome_list)->default_value(
+				"plains,forest,desert,taiga,swamp"),
+			("the biomes with optional weights (<biome>[:<weight>],...), "
+					"available are " + biome_names).c_str())
+		("caves", po::value<double>(&caves)->default_value(0.3),
+			"the density of the caves, 0 to 1")
+		("jobs,j", po::value<int>(&threads)->default_value(
+				std::max(1, (int) std::thread::hardware_concurrency())),
+			"the count of threads to generate the world with");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, all), vm);
+	} catch (po::error& ex) {
+		std::cout << "There is a problem parsing the command line arguments: "
+				<< ex.what() << std::endl << std::endl;
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << all << std::endl;
+		return 1;
+	}
+
+	if (!vm.count("output-dir")) {
+		std::cerr << "You have to specify an output directory!" << std::endl;
+		return 1;
+	}
+	if (length == -1)
+		length = width;
+	if (width < 1 || length < 1 || threads < 1) {
+		std::cerr << "The size of the world and the count of threads must be positive!"
+				<< std::endl;
+		return 1;
+	}
+	if (height < 4 || height > 240 || relief < 0) {
+		std::cerr << "The height must be between 4 and 240, the relief positive!"
+				<< std::endl;
+		return 1;
+	}
+	if (water < 0 || water > 1 || foliage < 0 || foliage > 1 || caves < 0 || caves > 1) {
+		std::cerr << "The water, foliage and caves must be between 0 and 1!" << std::endl;
+		return 1;
+	}
+
+	WorldSettings settings;
+	settings.seed = seed;
+	// the world is centered around the origin
+	settings.min_chunk_x = -width / 2;
+	settings.min_chunk_z = -length / 2;
+	settings.max_chunk_x = settings.min_chunk_x + width;
+	settings.max_chunk_z = settings.min_chunk_z + length;
+	settings.height = height;
+	settings.relief = relief;
+	settings.foliage = foliage;
+	settings.caves = caves;
+	if (!parseBiomes(biome_list, settings.biomes))
+		return 1;
+	settings.sea_level = getSeaLevel(settings, water);
+
+	fs::path world_dir = output_dir;
+	fs::path region_dir = world_dir / "region";
+	boost::system::error_code error;
+	fs::create_directories(region_dir, error);
+	if (error) {
+		std::cerr << "Unable to create the region directory " << region_dir << ": "
+				<< error.message() << std::endl;
+		return 1;
+	}
+	if (!writeLevelDat(settings, world_dir))
+		return 1;
+
+	std::vector<mc::RegionPos> regions;
+	mc::RegionPos min_region = mc::ChunkPos(settings.min_chunk_x,
+			settings.min_chunk_z).getRegion();
+	mc::RegionPos max_region = mc::ChunkPos(settings.max_chunk_x - 1,
+			settings.max_chunk_z - 1).getRegion();
+	for (int z = min_region.z; z <= max_region.z; z++)
+		for (int x = min_region.x; x <= max_region.x; x++)
+			regions.push_back(mc::RegionPos(x, z));
+
+	// every thread generates the chunks of a region and writes it, one after another
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now();
+	std::atomic<size_t> next_region(0), chunks(0);
+	std::atomic<bool> failed(false);
+	auto generate = [&]() {
+		size_t i;
+		while ((i = next_region++) < regions.size() && !failed) {
+			const mc::RegionPos& region_pos = regions[i];
+			fs::path filename = region_dir
+					/ ("r." + util::str(region_pos.x) + "." + util::str(region_pos.z) + ".mca");
+			mc::RegionFile region(filename.string());
+			for (int z = 0; z < 32; z++)
+				for (int x = 0; x < 32; x++) {
+					mc::ChunkPos pos(region_pos.x * 32 + x, region_pos.z * 32 + z);
+					if (pos.x < settings.min_chunk_x || pos.x >= settings.max_chunk_x
+							|| pos.z < settings.min_chunk_z || pos.z >= settings.max_chunk_z)
+						continue;
+					region.setChunkData(pos, generateChunk(settings, pos), 2);
+					region.setChunkTimestamp(pos, CHUNK_TIMESTAMP);
+					chunks++;
+				}
+			if (!region.write()) {
+				std::cerr << "Unable to write region file " << filename << "!" << std::endl;
+				failed = true;
+			}
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; i++)
+		workers.push_back(std::thread(generate));
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	if (failed)
+		return 1;
+
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+	std::cout << "Generated " << chunks << " chunks in " << regions.size()
+			<< " regions in " << std::fixed << std::setprecision(1) << seconds << "s"
+			<< " (sea level " << settings.sea_level << ")." << std::endl;
+	return 0;
+}
@@ -1,335 +1,340 @@
+/*
+ * Copyright 2012-2016 Moritz Hilscher
+ *
+ * This file is part of Mapcrafter.
+ *
+ * Mapcrafter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mapcrafter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Mapcrafter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the tiles rendered by two builds of Mapcrafter or with two configurations:
+ *
+ *   mapcraftertest render -c render.conf -m map -o before
+ *   (change the code and build again, or use another configuration file)
+ *   mapcraftertest render -c render.conf -m map -o after
+ *   mapcraftertest compare before after
+ *
+ * The render command renders a fixed set of tiles spread over a map and writes them as
+ * PNG files together with the time it took to render them. The compare command reports
+ * the differences of the pixels of the tiles and the ratio of the times.
+ */
+
+#include "../mapcraftercore/config/mapcrafterconfig.h"
 #include "../mapcraftercore/mc/world.h"
-#include "../mapcraftercore/mc/worldcache.h"
 #include "../mapcraftercore/renderer/blockimages.h"
 #include "../mapcraftercore/renderer/image.h"
-#include "../mapcraftercore/renderer/rendermode.h"
 #include "../mapcraftercore/renderer/renderview.h"
 #include "../mapcraftercore/renderer/tilerenderer.h"
+#include "../mapcraftercore/renderer/tilerenderworker.h"
 #include "../mapcraftercore/renderer/tileset.h"
-#include "../mapcraftercore/renderer/image/dithering.h"
-#include "../mapcraftercore/renderer/image/palette.h"
-#include "../mapcraftercore/renderer/image/quantization.h"
-#include "../mapcraftercore/renderer/rendermodes/lighting.h"
 #include "../mapcraftercore/util.h"
-
+#include "../mapcraftercore/util/picojson.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
 
 using namespace mapcrafter;
 using namespace mapcrafter::renderer;
 
-/*
-static int magic_count = 0;
-
-class Octree;
-
-class Octree {
-public:
-	Octree(Octree* parent = nullptr)
-		: parent(parent), reduced(false), reference(0), red(0), green(0), blue(0) {
-		magic_count++;
-		//std::cout << "magic: " << magic_count << std::endl;
-		for (int i = 0; i < 8; i++)
-			children[i] = nullptr;
-	};
-	
-	~Octree() {
-		for (int i = 0; i < 8; i++)
-			if (children[i])
-				delete children[i];
-	};
-
-	Octree* getParent() {
-		return parent;
-	}
+namespace {
 
-	bool hasChildren(int index) {
-		return children[index];
-	}
+// the file with the rendered tiles and their time in the output directory of a rendering
+const std::string TIMING_FILE = "timing.json";
 
-	Octree* getChildren(int index) {
-		if (index < 0 || index >= 8)
-			return nullptr;
-		if (children[index]) {
-			//std::cout << "found children " << index << std::endl;
-			return children[index];
-		}
-		//std::cout << "create children " << index << std::endl;
-		children[index] = new Octree(this);
-		return children[index];
-	}
+std::string getTileFilename(const TilePos& tile) {
+	return std::to_string(tile.getX()) + "_" + std::to_string(tile.getY()) + ".png";
+}
 
-	int getChildrenCount() {
-		int count = 0;
-		for (int i = 0; i < 8; i++)
-			if (children[i])
-				count++;
-		return count;
+/**
+ * Renders count tiles spread over a map (in its first rotation) repetitions times and
+ * writes the tiles of the last repetition and the fastest time to the output directory.
+ * The chunks are decoded again in every repetition, like when rendering a map. The
+ * parts of each tile are rendered with a count of threads.
+ */
+bool renderTiles(const std::string& config_file, const std::string& map,
+		const fs::path& output_dir, int count, int repetitions, int tile_threads) {
+	typedef std::chrono::steady_clock clock;
+
+	config::MapcrafterConfig config;
+	config::ValidationMap validation = config.parseFile(config_file);
+	if (validation.isCritical()) {
+		validation.log();
+		return false;
 	}
-
-	bool isLeaf() const {
-		for (int i = 0; i < 8; i++)
-			if (children[i])
-				return false;
-		return true;
+	if (!config.hasMap(map)) {
+		LOG(ERROR) << "The configuration file has no map '" << map << "'!";
+		return false;
 	}
 
-	bool isReduced() {
-		return reduced;
+	config::MapSection map_config = config.getMap(map);
+	config::WorldSection world_config = config.getWorld(map_config.getWorld());
+	int rotation = *map_config.getRotations().begin();
+	mc::World world(world_config.getInputDir().string(), world_config.getDimension());
+	world.setRotation(rotation);
+	world.setWorldCrop(world_config.getWorldCrop());
+	if (!world.load()) {
+		LOG(ERROR) << "Unable to load world " << map_config.getWorld() << "!";
+		return false;
 	}
 
-	void reduce() {
-		if (reduced)
-			return;
-		reduced = true;
-
-		for (int i = 0; i < 8; i++) {
-			if (!children[i])
-				continue;
-			reference += children[i]->reference;
-			red += children[i]->red;
-			green += children[i]->green;
-			blue += children[i]->blue;
-		}
+	TextureResources textures;
+	if (!textures.loadTextures(map_config.getTextureDir().string(),
+			map_config.getTextureSize(), map_config.getTextureBlur(),
+			map_config.getWaterOpacity()))
+		return false;
+
+	std::unique_ptr<RenderView> render_view(createRenderView(map_config.getRenderView()));
+	std::unique_ptr<BlockImages> block_images(render_view->createBlockImages());
+	std::unique_ptr<TileSet> tile_set(render_view->createTileSet(map_config.getTileWidth()));
+	if (world_config.needsWorldCentering()) {
+		TilePos tile_offset;
+		tile_set->scan(world, true, tile_offset);
+	} else {
+		tile_set->scan(world);
 	}
 
-	int getReference() const {
-		return reference;
+	RenderContext context;
+	context.background_color = config.getBackgroundColor();
+	context.world_config = world_config;
+	context.map_config = map_config;
+	render_view->configureBlockImages(block_images.get(), world_config, map_config);
+	block_images->setRotation(rotation);
+	block_images->generateBlocks(textures);
+	context.render_view = render_view.get();
+	context.block_images = block_images.get();
+	context.tile_set = tile_set.get();
+	context.world = world;
+	context.tile_threads = tile_threads;
+
+	// the same tiles are rendered as long as the world and the tile width don't change
+	const std::set<TilePos>& required = tile_set->getRequiredRenderTiles();
+	size_t step = std::max<size_t>(1, required.size() / count);
+	std::vector<TilePos> tiles;
+	size_t i = 0;
+	for (auto it = required.begin(); it != required.end()
+			&& (int) tiles.size() < count; ++it, ++i)
+		if (i % step == 0)
+			tiles.push_back(*it + tile_set->getTileOffset());
+	if (tiles.empty()) {
+		LOG(ERROR) << "The map has no tiles to render!";
+		return false;
 	}
 
-	int getChildReferences() const {
-		assert(!isLeaf());
-		int ref = 0;
-		for (int i = 0; i < 8; i++)
-			if (children[i])
-				ref += children[i]->reference;
-		return ref;
+	std::vector<RGBAImage> images(tiles.size());
+	double seconds = 0;
+	for (int r = 0; r < repetitions; r++) {
+		context.initializeTileRenderer();
+		clock::time_point start = clock::now();
+		for (size_t j = 0; j < tiles.size(); j++)
+			context.tile_renderer->renderTile(tiles[j], images[j]);
+		double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		if (r == 0 || elapsed < seconds)
+			seconds = elapsed;
 	}
 
-	RGBAPixel getColor() const {
-		assert(reduced || reference > 1);
-		return rgba(red / reference, green / reference, blue / reference, 255);
+	boost::system::error_code error;
+	fs::create_directories(output_dir, error);
+	picojson::array tile_names;
+	for (size_t j = 0; j < tiles.size(); j++) {
+		std::string filename = getTileFilename(tiles[j]);
+		if (!images[j].writePNG((output_dir / filename).string())) {
+			LOG(ERROR) << "Unable to write " << (output_dir / filename).string() << "!";
+			return false;
+		}
+		tile_names.push_back(picojson::value(filename));
 	}
 
-	void setColor(RGBAPixel color) {
-		reduced = false;
-		reference++;
-		red += rgba_red(color);
-		green += rgba_green(color);
-		blue += rgba_blue(color);
+	picojson::object json;
+	json["config"] = picojson::value(config_file);
+	json["map"] = picojson::value(map);
+	json["tiles"] = picojson::value(tile_names);
+	json["seconds"] = picojson::value(seconds);
+	std::ofstream out((output_dir / TIMING_FILE).string());
+	out << picojson::value(json).serialize(true);
+	if (!out) {
+		LOG(ERROR) << "Unable to write " << (output_dir / TIMING_FILE).string() << "!";
+		return false;
 	}
 
-private:
-	Octree* parent;
-	Octree* children[8];
-
-	bool reduced;
-	int reference;
-	int red, green, blue;
-	
-};
-
-int nth_bit(int x, int n) {
-	return (x >> n) & 1;
+	std::cout << "Rendered " << tiles.size() << " tiles of map " << map << " in "
+			<< std::fixed << std::setprecision(4) << seconds << "s." << std::endl;
+	return true;
 }
 
-struct octree_compare {
-	bool operator()(const Octree* octree1, const Octree* octree2) const {
-		return octree1 < octree2;
-		//int ref1 = octree1->getChildReferences();
-		//int ref2 = octree2->getChildReferences();
-		//if (octree1 != octree2)
-		//	return ref1 < ref2;
-		//return false;
-	}
-};
-
-class OctreePalette : public SimplePalette {
-public:
-	OctreePalette(const RGBAImage& source, size_t palette_size) : SimplePalette() {
-		constructFromImage(source, palette_size);
+bool readTiming(const fs::path& dir, picojson::object& json) {
+	std::ifstream in((dir / TIMING_FILE).string());
+	picojson::value value;
+	std::string error = picojson::parse(value, in);
+	if (!in || !error.empty() || !value.is<picojson::object>()
+			|| !value.get("tiles").is<picojson::array>()
+			|| !value.get("seconds").is<double>()) {
+		LOG(ERROR) << "Unable to read " << (dir / TIMING_FILE).string() << "!";
+		return false;
 	}
+	json = value.get<picojson::object>();
+	return true;
+}
 
-	virtual ~OctreePalette() {
-	}
-
-	Octree* getOctree() {
-		return &octree;
-	}
-
-private:
-	Octree octree;
-
-	void constructFromImage(const RGBAImage& image, size_t palette_size) {
-		std::set<Octree*, octree_compare> parents, next_parents;
-		for (int x = 0; x < image.getWidth(); x++)
-			for (int y = 0; y < image.getHeight(); y++) {
-				//std::cout << "adding " << x << " " << y << std::endl;
-				Octree* inserted = addColor(image.pixel(x, y));
-				//std::cout << inserted->getParent()->getChildReferences() << std::endl;
-				next_parents.insert(inserted->getParent());
-			}
-
-		size_t leaves_count = 0;
-		std::cout << next_parents.size() << std::endl;
-		for (int level = 7; level >= 0; level--) {
-			parents = next_parents;
-			next_parents.clear();
-
-			leaves_count = 0;
-			for (auto parent_it = parents.begin(); parent_it != parents.end(); ++parent_it)
-				leaves_count += (*parent_it)->getChildrenCount();
-
-			std::cout << "Level " << level << ": " << leaves_count << " leaves" << std::endl;
-			while (parents.size() > 0 && leaves_count > palette_size) {
-				Octree* parent = *parents.begin();
-				//assert(leaf->isLeaf());
-				assert(!parent->isLeaf());
-				parents.erase(parents.begin());
-				next_parents.insert(parent->getParent());
-				leaves_count -= parent->getChildrenCount() - 1;
-				parent->reduce();
-				//std::cout << "Remove parent with " << parent->getChildrenCount() << " children, ";
-				//std::cout << "Add new parent with " << parent->getParent()->getChildrenCount() << " children" << std::endl;
-				//std::cout << leaves.size() << " -> " << next_leaves.size() << std::endl;
-			}
-			if (leaves_count <= palette_size)
-				break;
+/**
+ * Compares the tiles of two renderings and prints the maximum and mean difference of
+ * the color components of every tile that differs and of all tiles, and the ratio of
+ * the times. Returns whether no difference is bigger than the tolerance.
+ */
+bool compareTiles(const fs::path& dir1, const fs::path& dir2, int tolerance) {
+	picojson::object timing1, timing2;
+	if (!readTiming(dir1, timing1) || !readTiming(dir2, timing2))
+		return false;
+
+	const picojson::array& tiles = timing1["tiles"].get<picojson::array>();
+	int max_delta = 0;
+	uint64_t sum_delta = 0, components = 0;
+	int differing = 0;
+	for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+		std::string filename = it->to_str();
+		RGBAImage image1, image2;
+		if (!image1.readPNG((dir1 / filename).string())
+				|| !image2.readPNG((dir2 / filename).string())) {
+			LOG(ERROR) << "Unable to read tile " << filename << " of both renderings!";
+			return false;
+		}
+		if (image1.getWidth() != image2.getWidth()
+				|| image1.getHeight() != image2.getHeight()) {
+			LOG(ERROR) << "The tiles " << filename << " have different sizes!";
+			return false;
 		}
 
-		std::cout << "Reduced to " << leaves_count << std::endl;
-		for (auto parent_it = parents.begin(); parent_it != parents.end(); ++parent_it)
-			for (int i = 0; i < 8; i++)
-				if ((*parent_it)->hasChildren(i))
-					colors.push_back((*parent_it)->getChildren(i)->getColor());
-		for (auto parent_it = next_parents.begin(); parent_it != next_parents.end(); ++parent_it)
-			for (int i = 0; i < 8; i++)
-				if ((*parent_it)->hasChildren(i)) {
-					Octree* children = (*parent_it)->getChildren(i);
-					if (!parents.count(children))
-						colors.push_back(children->getColor());
+		int tile_max_delta = 0;
+		uint64_t tile_sum_delta = 0;
+		for (int y = 0; y < image1.getHeight(); y++)
+			for (int x = 0; x < image1.getWidth(); x++) {
+				RGBAPixel p1 = image1.pixel(x, y), p2 = image2.pixel(x, y);
+				for (int c = 0; c < 4; c++) {
+					int delta = std::abs((int) ((p1 >> (c * 8)) & 0xff)
+							- (int) ((p2 >> (c * 8)) & 0xff));
+					tile_max_delta = std::max(tile_max_delta, delta);
+					tile_sum_delta += delta;
 				}
-		std::cout << "Really? " << colors.size() << std::endl;
-	}
-
-	Octree* addColor(RGBAPixel color) {
-		uint8_t red = rgba_red(color);
-		uint8_t green = rgba_green(color);
-		uint8_t blue = rgba_blue(color);
-
-		Octree* node = &octree;
-		for (int i = 7; i >= 0; i--) {
-			int index = (nth_bit(red, i) << 2) | (nth_bit(green, i) << 1) | nth_bit(blue, i);
-			node = node->getChildren(index);
+			}
+		uint64_t tile_components = (uint64_t) image1.getWidth() * image1.getHeight() * 4;
+		if (tile_max_delta > 0) {
+			differing++;
+			std::cout << "Tile " << filename << ": max delta " << tile_max_delta
+					<< ", mean delta " << std::fixed << std::setprecision(4)
+					<< (double) tile_sum_delta / tile_components << std::endl;
 		}
-
-		node->setColor(color);
-		return node;
+		max_delta = std::max(max_delta, tile_max_delta);
+		sum_delta += tile_sum_delta;
+		components += tile_components;
 	}
-};
 
-int traverseOctree(Octree* octree) {
-	if (octree->isLeaf())
-		return 1;
+	double seconds1 = timing1["seconds"].get<double>();
+	double seconds2 = timing2["seconds"].get<double>();
+	std::cout << differing << " of " << tiles.size() << " tiles differ, max delta "
+			<< max_delta << ", mean delta " << std::fixed << std::setprecision(4)
+			<< (components > 0 ? (double) sum_delta / components : 0.0) << std::endl;
+	std::cout << "Time " << seconds1 << "s vs. " << seconds2 << "s, ratio "
+			<< std::setprecision(3) << seconds2 / seconds1 << std::endl;
+	return max_delta <= tolerance;
+}
 
-	int count = 0;
-	for (int i = 0; i < 8; i++) {
-		if (octree->hasChildren(i))
-			count += traverseOctree(octree->getChildren(i));
-	}
-	return count;
 }
-*/
 
 int main(int argc, char** argv) {
-	//RGBAImage test(200, 200);
-	RGBAImage test;
-	test.readPNG("input_rgb_big.png");
-
-	//std::set<RGBAPixel> colors;
-	//for (int x = 0; x < test.getWidth(); x++)
-	//	for (int y = 0; y < test.getHeight(); y++)
-	//		colors.insert(test.pixel(x, y));
-
-	std::cout << "start" << std::endl;
-	//OctreePalette palette(test, 256);
-	//std::cout << magic_count << " " << traverseOctree(palette.getOctree()) << " " << colors.size() << std::endl;
-
-	//imageDither(test, palette, true);
-	//imageColorQuantize(test, 256);
-	test.writeIndexedPNG("test.png", 8, true);
-
-	return 0;
-
-	//test.fill(rgba(127, 127, 127, 255), 0, 0, 200, 200);
-
-
-	// std::vector<RGBAPixel> palette;
-	/*
-	palette.push_back(rgba(255, 255, 255, 255));
-	palette.push_back(rgba(0, 0, 0, 255));
-	*/
-	/*
-	for (int i = 0; i < 256; i += 64)
-		palette.push_back(rgba(i, i, i));
-	*/
-
-	/*
-	palette.push_back(rgba(248, 227, 232));
-	palette.push_back(rgba(28, 20, 18));
-	palette.push_back(rgba(31, 26, 40));
-	palette.push_back(rgba(57, 45, 81));
-	palette.push_back(rgba(148, 18, 41));
-	palette.push_back(rgba(179, 151, 192));
-	palette.push_back(rgba(154, 70, 36));
-	palette.push_back(rgba(176, 132, 117));
-
-	test.quantize(TestPalette(palette), true);
-	test.writePNG("test_dithered.png");
-	return 0;
-	*/
-
-	/*
-	std::string view_name = "topdown";
-	RenderView* view = createRenderView(view_name);
-
-	TextureResources resources;
-	resources.setTextureSize(16, 0);
-	resources.loadTextures(util::findTextureDir().string());
-
-	BlockImages* images = view->createBlockImages();
-	images->loadBlocks(resources);
-
-	mc::World world(argv[1]);
-	world.load();
-	mc::WorldCache world_cache(world);
-	TileSet* tile_set = view->createTileSet(1);
-	tile_set->scan(world);
-
-	RenderMode* render_mode = new LightingRenderMode(true, 1.0, false);
-	TileRenderer* tile_renderer = view->createTileRenderer(images, 1, &world_cache, render_mode);
-
-	TilePos tiles_min, tiles_max, tiles_offset;
-
-	auto tiles = tile_set->getRequiredRenderTiles();
-	for (auto it = tiles.begin(); it != tiles.end(); ++it) {
-		if (it == tiles.begin())
-			tiles_min = tiles_max = *it;
-		tiles_min = TilePos(std::min(tiles_min.getX(), it->getX()), std::min(tiles_min.getY(), it->getY()));
-		tiles_max = TilePos(std::max(tiles_max.getX(), it->getX()), std::max(tiles_max.getY(), it->getY()));
+	std::string command, config_file, map, output_dir;
+	std::vector<std::string> compare_dirs;
+	int tiles, repetitions, tile_threads, tolerance;
+
+	po::options_description all("Allowed options");
+	all.add_options()
+		("help,h", "shows a help message")
+
+		("command", po::value<std::string>(&command),
+			"'render' renders tiles of a map, 'compare' compares the tiles of two renderings")
+		("config,c", po::value<std::string>(&config_file),
+			"the configuration file with the map to render")
+		("map,m", po::value<std::string>(&map),
+			"the map to render")
+		("output-dir,o", po::value<std::string>(&output_dir),
+			"the directory to write the rendered tiles and the time to")
+		("tiles,n", po::value<int>(&tiles)->default_value(16),
+			"the count of tiles to render")
+		("repetitions,r", po::value<int>(&repetitions)->default_value(3),
+			"how often the tiles are rendered, the fastest time is taken")
+		("tile-threads,j", po::value<int>(&tile_threads)->default_value(1),
+			"the count of threads rendering the parts of each tile")
+		("tolerance,t", po::value<int>(&tolerance)->default_value(0),
+			"the biggest difference of a color component that is still equivalent")
+		("compare-dirs", po::value<std::vector<std::string>>(&compare_dirs),
+			"the directories of the two renderings to compare");
+
+	po::positional_options_description positional;
+	positional.add("command", 1).add("compare-dirs", 2);
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(all)
+				.positional(positional).run(), vm);
+	} catch (po::error& ex) {
+		std::cout << "There is a problem parsing the command line arguments: "
+				<< ex.what() << std::endl << std::endl;
+		std::cout << all << std::endl;
+		return 1;
 	}
 
-	int tile_size = tile_renderer->getTileSize();
-	RGBAImage image((tiles_max.getX() - tiles_min.getX() + 1) * tile_size,
-			(tiles_max.getY() - tiles_min.getY() + 1) * tile_size);
+	po::notify(vm);
 
-	for (auto it = tiles.begin(); it != tiles.end(); ++it) {
-		LOG(INFO) << *it;
-		RGBAImage tile;
-		tile_renderer->renderTile(*it, tile);
-		TilePos image_tile = *it - tiles_min;
-		image.simpleAlphaBlit(tile, image_tile.getX() * tile_size, image_tile.getY() * tile_size);
+	if (vm.count("help") || command.empty()) {
+		std::cout << "Usage: " << argv[0] << " render -c <config> -m <map> -o <dir>"
+				<< std::endl << "       " << argv[0] << " compare <dir1> <dir2>"
+				<< std::endl << std::endl << all << std::endl;
+		return 1;
+	}
+
+	if (command == "render") {
+		if (config_file.empty() || map.empty() || output_dir.empty()) {
+			std::cerr << "You have to specify a configuration file, a map and an output "
+					<< "directory!" << std::endl;
+			return 1;
+		}
+		if (tiles < 1 || repetitions < 1 || tile_threads < 1) {
+			std::cerr << "The count of tiles, repetitions and threads must be positive!"
+					<< std::endl;
+			return 1;
+		}
+		util::Logging::getInstance().setSinkVerbosity("__output__", util::LogLevel::WARNING);
+		return renderTiles(config_file, map, output_dir, tiles, repetitions,
+				tile_threads) ? 0 : 1;
+	} else if (command == "compare") {
+		if (compare_dirs.size() != 2) {
+			std::cerr << "You have to specify the directories of two renderings!" << std::endl;
+			return 1;
+		}
+		return compareTiles(compare_dirs[0], compare_dirs[1], tolerance) ? 0 : 1;
 	}
 
-	image.writePNG(view_name + ".png");
-	*/
+	std::cerr << "Invalid command '" << command << "'!" << std::endl;
+	return 1;
 }
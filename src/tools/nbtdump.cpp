@@ -1,15 +1,122 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
 
+#include "../mapcraftercore/mc/chunk.h"
 #include "../mapcraftercore/mc/nbt.h"
+#include "../mapcraftercore/mc/region.h"
+#include "../mapcraftercore/util/profiler.h"
 
+namespace fs = boost::filesystem;
+namespace mc = mapcrafter::mc;
 namespace nbt = mapcrafter::mc::nbt;
+namespace util = mapcrafter::util;
+
+/**
+ * Decodes every chunk of the region files (a single one or the ones in a directory)
+ * with a count of threads, and prints the throughput and how much of the time was
+ * spent decompressing and how much decoding the NBT data of the chunks.
+ */
+int decodeChunks(const std::string& path, int threads) {
+	std::vector<std::string> regions;
+	if (fs::is_directory(path)) {
+		for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it)
+			if (it->path().extension() == ".mca")
+				regions.push_back(it->path().string());
+		std::sort(regions.begin(), regions.end());
+	} else {
+		regions.push_back(path);
+	}
+	if (regions.empty()) {
+		std::cerr << "There are no region files in '" << path << "'!" << std::endl;
+		return 1;
+	}
+
+	util::Profiler::setEnabled(true);
+	std::atomic<size_t> next_region(0);
+	std::atomic<uint64_t> bytes(0), chunks(0), failed(0);
+	auto worker = [&]() {
+		util::Profiler::setThreadName("decode");
+		mc::Chunk chunk;
+		for (size_t i = next_region++; i < regions.size(); i = next_region++) {
+			mc::RegionFile region(regions[i]);
+			if (!region.read()) {
+				std::cerr << "Unable to read region file '" << regions[i] << "'!" << std::endl;
+				failed++;
+				continue;
+			}
+			const mc::RegionFile::ChunkMap& positions = region.getContainingChunks();
+			for (auto it = positions.begin(); it != positions.end(); ++it) {
+				bytes += region.getChunkData(*it).size();
+				if (region.loadChunk(*it, chunk) == mc::RegionFile::CHUNK_OK)
+					chunks++;
+				else
+					failed++;
+			}
+		}
+	};
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; i++)
+		workers.push_back(std::thread(worker));
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	double seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+	// the times of the stages are summed up over all threads
+	util::ProfileTimes times = util::Profiler::getThreadTimes()["decode"];
+	double inflate = times.seconds[(int) util::ProfileStage::INFLATE];
+	double parse = times.seconds[(int) util::ProfileStage::NBT_DECODE];
+	double io = times.seconds[(int) util::ProfileStage::REGION_IO];
+	double total = std::max(inflate + parse + io, 1e-9);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Decoded " << chunks << " chunks (" << failed << " failed) of "
+			<< regions.size() << " region files with " << threads << " threads in "
+			<< seconds << "s." << std::endl;
+	std::cout << std::setprecision(1);
+	std::cout << "Throughput: " << bytes / seconds / (1024 * 1024)
+			<< " MB/s compressed data, " << chunks / seconds << " chunks/s" << std::endl;
+	std::cout << "Time of all threads: " << std::setprecision(3) << inflate << "s inflate ("
+			<< std::setprecision(1) << 100 * inflate / total << "%), "
+			<< std::setprecision(3) << parse << "s parsing (" << std::setprecision(1)
+			<< 100 * parse / total << "%), " << std::setprecision(3) << io
+			<< "s region I/O (" << std::setprecision(1) << 100 * io / total << "%)"
+			<< std::endl;
+	return failed == 0 ? 0 : 1;
+}
 
 int main(int argc, char** argv) {	
 	if (argc < 2) {
 		std::cerr << "Usage: ./nbtdump [--gzip|--zlib|--nocompression] [nbtfile]" << std::endl;
+		std::cerr << "       ./nbtdump --decode [regionfile|regiondir] [threads]" << std::endl;
 		return 1;
 	}
+
+	if (std::string(argv[1]) == "--decode") {
+		if (argc < 3) {
+			std::cerr << "You have to specify a region file or directory!" << std::endl;
+			return 1;
+		}
+		int threads = argc > 3 ? std::atoi(argv[3])
+				: std::max(1, (int) std::thread::hardware_concurrency());
+		if (threads < 1) {
+			std::cerr << "Invalid count of threads: " << argv[3] << std::endl;
+			return 1;
+		}
+		return decodeChunks(argv[2], threads);
+	}
 	
 	nbt::Compression cmpr = nbt::Compression::GZIP;
 	std::string filename = argv[1];
@@ -29,8 +136,22 @@ int main(int argc, char** argv) {
 		}
 	}
 	
-	nbt::NBTFile f;
-	f.readNBT(filename.c_str(), cmpr);
-	f.dump(std::cout);
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		std::cerr << "Unable to open file '" << filename << "'!" << std::endl;
+		return 1;
+	}
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	try {
+		nbt::DecompressedBuffer decompressed;
+		nbt::decompress(data.c_str(), data.size(), decompressed, cmpr);
+		nbt::Document document;
+		document.parse(decompressed.data(), decompressed.size());
+		document.dump(std::cout);
+	} catch (const nbt::NBTError& err) {
+		std::cerr << "Unable to read NBT data: " << err.what() << std::endl;
+		return 1;
+	}
 	return 0;
 }